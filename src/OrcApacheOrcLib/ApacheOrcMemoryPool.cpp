@@ -13,28 +13,126 @@
 
 #include <safeint.h>
 
+#include <algorithm>
+
 using namespace Orc::TableOutput::ApacheOrc;
 
 using namespace msl::utilities;
 
-Orc::TableOutput::ApacheOrc::MemoryPool::MemoryPool(size_t initialSize)
+Orc::TableOutput::ApacheOrc::MemoryPool::MemoryPool(size_t initialSize, std::optional<uint64_t> limit)
     : m_initialSize(initialSize)
+    , m_limit(std::move(limit))
 {
 }
 
 char* Orc::TableOutput::ApacheOrc::MemoryPool::malloc(uint64_t size)
+{
+    auto p = HeapAllocate(SafeInt<size_t>(size));
+    Account(size);
+    return p;
+}
+
+void Orc::TableOutput::ApacheOrc::MemoryPool::free(char* p)
+{
+    if (p == nullptr)
+        return;
+
+    CheckHeap();
+
+    const auto size = HeapSize(m_heap, HEAP_NO_SERIALIZE, p);
+    if (size != (SIZE_T)-1)
+    {
+        m_stats.Allocated -= std::min<uint64_t>(m_stats.Allocated, size);
+    }
+
+    HeapRelease(p);
+}
+
+char* Orc::TableOutput::ApacheOrc::MemoryPool::Allocate(size_t size)
+{
+    // Values which would waste most of a chunk get their own allocation, released by Reset()
+    if (size > kChunkSize / 4)
+    {
+        auto p = HeapAllocate(size);
+        m_largeChunks.push_back({p, size});
+        m_stats.Reserved += size;
+
+        m_arenaUsed += size;
+        Account(size);
+        return p;
+    }
+
+    while (m_currentChunk < m_chunks.size() && m_chunkOffset + size > m_chunks[m_currentChunk].Size)
+    {
+        m_currentChunk++;
+        m_chunkOffset = 0L;
+    }
+
+    if (m_currentChunk == m_chunks.size())
+    {
+        m_chunks.push_back({HeapAllocate(kChunkSize), kChunkSize});
+        m_stats.Reserved += kChunkSize;
+    }
+
+    auto p = m_chunks[m_currentChunk].Data + m_chunkOffset;
+    m_chunkOffset += size;
+
+    m_arenaUsed += size;
+    Account(size);
+    return p;
+}
+
+void Orc::TableOutput::ApacheOrc::MemoryPool::Reset()
+{
+    for (const auto& chunk : m_largeChunks)
+    {
+        HeapRelease(chunk.Data);
+        m_stats.Reserved -= chunk.Size;
+    }
+    m_largeChunks.clear();
+
+    m_currentChunk = 0L;
+    m_chunkOffset = 0L;
+
+    m_stats.Allocated -= m_arenaUsed;
+    m_arenaUsed = 0LLU;
+}
+
+bool Orc::TableOutput::ApacheOrc::MemoryPool::NeedsFlush() const
+{
+    // The other half is left to the writer's own buffers
+    return m_limit.has_value() && m_arenaUsed >= m_limit.value() / 2;
+}
+
+char* Orc::TableOutput::ApacheOrc::MemoryPool::HeapAllocate(size_t size)
 {
     CheckHeap();
 
-    auto lpVoid = HeapAlloc(m_heap, HEAP_NO_SERIALIZE, SafeInt<size_t>(size));
+    if (m_limit.has_value())
+    {
+        const auto committed = m_stats.Allocated - m_arenaUsed + m_stats.Reserved;
+        if (committed + size > m_limit.value())
+        {
+            throw Orc::Exception(
+                Severity::Continue,
+                E_OUTOFMEMORY,
+                L"Orc memory pool limit reached (requested: {}, committed: {}, limit: {})",
+                size,
+                committed,
+                m_limit.value());
+        }
+    }
+
+    auto lpVoid = HeapAlloc(m_heap, HEAP_NO_SERIALIZE, size);
     if (lpVoid == nullptr)
         throw Orc::Exception(
-            Severity::Fatal, HRESULT_FROM_WIN32(GetLastError()), L"Failed to allocate heap memory %z", size);
+            Severity::Fatal, HRESULT_FROM_WIN32(GetLastError()), L"Failed to allocate heap memory {}", size);
 
+    m_stats.Allocations++;
     return (char*)lpVoid;
 }
 
-void Orc::TableOutput::ApacheOrc::MemoryPool::free(char* p)
+void Orc::TableOutput::ApacheOrc::MemoryPool::HeapRelease(char* p)
 {
     CheckHeap();
 
@@ -44,6 +142,12 @@ void Orc::TableOutput::ApacheOrc::MemoryPool::free(char* p)
     }
 }
 
+void Orc::TableOutput::ApacheOrc::MemoryPool::Account(uint64_t size)
+{
+    m_stats.Allocated += size;
+    m_stats.Peak = std::max(m_stats.Peak, m_stats.Allocated);
+}
+
 Orc::TableOutput::ApacheOrc::MemoryPool::~MemoryPool()
 {
     if (m_heap != NULL)
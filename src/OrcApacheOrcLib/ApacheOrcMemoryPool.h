@@ -13,20 +13,56 @@
 
 #include "OrcException.h"
 
+#include <optional>
+#include <vector>
+
 namespace Orc::TableOutput::ApacheOrc {
 
+//
+// Memory used by the orc writer and its row batch.
+//
+// malloc/free are what orc::Writer uses for its stream buffers, they are served by a private heap. Values of the row
+// batch (strings, guids...) are carved with Allocate() from chunks which Reset() makes available again once the batch
+// was added to the writer, so that the same memory is used by every batch of a file.
+//
+// With a limit, allocations that would exceed it throw and NeedsFlush() tells when the batch should be written early.
+//
 class MemoryPool : public orc::MemoryPool
 {
 
 public:
-    MemoryPool(size_t initialSize = 0L);
+    static constexpr size_t kChunkSize = 1024 * 1024;
+
+    struct Statistics
+    {
+        uint64_t Allocated = 0LLU;  // bytes currently in use, by the writer and the batch values
+        uint64_t Peak = 0LLU;  // highest value of 'Allocated'
+        uint64_t Reserved = 0LLU;  // bytes held by the batch chunks, used or not
+        uint64_t Allocations = 0LLU;  // number of heap allocations, chunk reuse keeps it low
+    };
+
+    MemoryPool(size_t initialSize = 0L, std::optional<uint64_t> limit = std::nullopt);
 
     virtual char* malloc(uint64_t size) override final;
     virtual void free(char* p) override final;
 
+    char* Allocate(size_t size);
+    void Reset();
+
+    bool NeedsFlush() const;
+
+    const Statistics& GetStatistics() const { return m_stats; }
+    const std::optional<uint64_t>& Limit() const { return m_limit; }
+
     ~MemoryPool();
 
 private:
+    struct Chunk
+    {
+        char* Data = nullptr;
+        size_t Size = 0L;
+    };
+
     void CheckHeap()
     {
         if (m_heap == NULL)
@@ -36,8 +72,23 @@ private:
     }
     void InitializeHeap();
 
+    char* HeapAllocate(size_t size);
+    void HeapRelease(char* p);
+
+    void Account(uint64_t size);
+
     HANDLE m_heap = NULL;
     size_t m_initialSize = 0;
+    std::optional<uint64_t> m_limit;
+
+    // Chunks of kChunkSize bytes are kept across Reset(), larger ones are released
+    std::vector<Chunk> m_chunks;
+    std::vector<Chunk> m_largeChunks;
+    size_t m_currentChunk = 0L;
+    size_t m_chunkOffset = 0L;
+
+    uint64_t m_arenaUsed = 0LLU;
+    Statistics m_stats;
 };
 
 }  // namespace Orc::TableOutput::ApacheOrc
@@ -10,6 +10,8 @@
 #include "ApacheOrcWriter.h"
 #include "ApacheOrcStream.h"
 
+#include "TableOutputBatch.h"
+
 #include "FileStream.h"
 
 #include "WideAnsi.h"
@@ -18,23 +20,37 @@
 #include "Buffer.h"
 #include "BinaryBuffer.h"
 #include "Convert.h"
+#include "Text/Utf16ToUtf8.h"
+#include "Utils/Result.h"
+#include "CaseInsensitive.h"
+#include "Trace.h"
 
 #include <WideAnsi.h>
 
 #include <safeint.h>
 #include <fmt/format.h>
+#include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
 
 #pragma warning(disable : 4521)
 #include <orc/OrcFile.hh>
 #pragma warning(default : 4521)
 
+#include <zstd.h>
+
 using namespace msl::utilities;
 
 namespace fs = std::filesystem;
 
 namespace {
 
+// Fraction of distinct values over non null rows above which orc stores a string column directly
+constexpr double kDictionaryKeySizeThreshold = 0.8;
+
 // Enable the use of std::make_shared with Writer protected constructor
 struct WriterT : public Orc::TableOutput::ApacheOrc::Writer
 {
@@ -45,6 +61,38 @@ struct WriterT : public Orc::TableOutput::ApacheOrc::Writer
     }
 };
 
+size_t CompressZstdSample(std::string_view input)
+{
+    std::vector<char> output(ZSTD_compressBound(input.size()));
+
+    const auto compressed = ZSTD_compress(
+        output.data(), output.size(), input.data(), input.size(), Orc::TableOutput::kAutoZstdLevel);
+    return ZSTD_isError(compressed) ? 0 : compressed;
+}
+
+orc::CompressionKind ToOrcCompression(Orc::TableOutput::Compression codec)
+{
+    using Orc::TableOutput::Compression;
+
+    switch (codec)
+    {
+        case Compression::kNone:
+            return orc::CompressionKind_NONE;
+        case Compression::kSnappy:
+            return orc::CompressionKind_SNAPPY;
+        case Compression::kLz4:
+            return orc::CompressionKind_LZ4;
+        case Compression::kZstd:
+            return orc::CompressionKind_ZSTD;
+        case Compression::kAuto:
+            return ToOrcCompression(Orc::TableOutput::ResolveAutoCompression(CompressZstdSample));
+        case Compression::kGzip:
+        case Compression::kDefault:
+        default:
+            return orc::CompressionKind_ZLIB;
+    }
+}
+
 }  // namespace
 
 class Orc::TableOutput::ApacheOrc::WriterTermination : public TerminationHandler
@@ -90,7 +138,33 @@ Orc::TableOutput::ApacheOrc::Writer::Writer(std::unique_ptr<Options>&& options)
     }
 }
 
-Orc::TableOutput::ApacheOrc::Writer::~Writer() {}
+Orc::TableOutput::ApacheOrc::Writer::~Writer()
+{
+    StopEncoder();
+}
+
+struct Orc::TableOutput::ApacheOrc::Writer::Encoder
+{
+    // orc::Writer buffers and the batch vectors, only used by the encoder thread once it is started
+    std::unique_ptr<MemoryPool> WriterPool;
+
+    std::mutex Mutex;
+    std::condition_variable Submitted;
+    std::condition_variable Added;
+
+    // Batch being added and its values, null when the encoder is idle
+    std::unique_ptr<orc::ColumnVectorBatch> Batch;
+    std::unique_ptr<MemoryPool> Pool;
+
+    // Batch to fill next, given back by the encoder once added
+    std::unique_ptr<orc::ColumnVectorBatch> SpareBatch;
+    std::unique_ptr<MemoryPool> SparePool;
+
+    HRESULT hr = S_OK;
+    bool bStop = false;
+
+    std::thread Thread;
+};
 
 // declarations in orc (Timezone.h) missing from the exported includes
 namespace orc {
@@ -154,6 +228,15 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::SetSchema(const TableOutput::S
     m_Schema = columns;
     m_dwColumnNumber = static_cast<DWORD>(m_Schema.size());
 
+    m_dictionaries.clear();
+    for (const auto& column : m_Schema)
+    {
+        if (column->bDictionary && column->Type == UTF8Type)
+            m_dictionaries.push_back(std::make_unique<StringDictionary>(kMaxDictionaryEntries, kMaxDictionaryBytes));
+        else
+            m_dictionaries.push_back(nullptr);
+    }
+
     AddZoneInfo("GMT", GMT_zoneinfo);
     AddZoneInfo("UTC", UTC_zoneinfo);
 
@@ -251,6 +334,176 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::SetSchema(const TableOutput::S
     return S_OK;
 }
 
+STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteBatch(const TableOutput::RecordBatch& batch)
+{
+    if (batch.ColumnCount() != m_dwColumnNumber)
+    {
+        Log::Error(
+            L"Invalid number of columns in batch written to ApacheOrc (got {}, expected {})",
+            batch.ColumnCount(),
+            m_dwColumnNumber);
+        return E_INVALIDARG;
+    }
+
+    if (m_dwColumnCounter != 0L)
+    {
+        Log::Error(L"Cannot write a batch to ApacheOrc while a row is being written");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+    }
+
+    auto root = dynamic_cast<orc::StructVectorBatch*>(m_Batch.get());
+    if (!root)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+
+    // The batch is split in slices that fit in the rows left in the orc batch
+    size_t row = 0;
+    while (row < batch.RowCount())
+    {
+        const auto count = std::min<size_t>(batch.RowCount() - row, m_dwBatchSize - m_dwBatchRow);
+
+        for (DWORD i = 0; i < m_dwColumnNumber; i++)
+        {
+            if (auto hr = WriteBatchColumn(*root->fields[i], batch[i], row, count, m_dictionaries[i].get()); FAILED(hr))
+            {
+                Log::Error(
+                    L"Failed to write batch column '{}' to ApacheOrc [{}]",
+                    batch[i].Definition().ColumnName,
+                    SystemError(hr));
+                return hr;
+            }
+        }
+
+        row += count;
+        m_dwBatchRow += static_cast<DWORD>(count);
+        m_dwRows += static_cast<DWORD>(count);
+
+        if (m_dwBatchRow >= m_dwBatchSize || m_BatchPool->NeedsFlush())
+        {
+            if (auto hr = Flush(); FAILED(hr))
+                return hr;
+        }
+    }
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::ApacheOrc::Writer::WriteBatchColumn(
+    orc::ColumnVectorBatch& col,
+    const TableOutput::BatchColumn& column,
+    size_t first,
+    size_t count,
+    StringDictionary* pDictionary)
+{
+    using Storage = TableOutput::BatchColumn::Storage;
+
+    const auto dest = static_cast<size_t>(m_dwBatchRow);
+
+    for (size_t i = 0; i < count; i++)
+        col.notNull[dest + i] = column.IsValid(first + i);
+
+    if (column.NullCount() > 0)
+        col.hasNulls = true;
+
+    switch (column.GetStorage())
+    {
+        case Storage::Null: {
+            for (size_t i = 0; i < count; i++)
+                col.notNull[dest + i] = false;
+            col.hasNulls = true;
+            break;
+        }
+        case Storage::Integer: {
+            if (column.Type() == TimeStampType)
+            {
+                auto timestamps = dynamic_cast<orc::TimestampVectorBatch*>(&col);
+                if (!timestamps)
+                    return E_INVALIDARG;
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    ULARGE_INTEGER uli;
+                    uli.QuadPart = static_cast<ULONGLONG>(column.Integers()[first + i]);
+                    FILETIME ft;
+                    ft.dwHighDateTime = uli.HighPart;
+                    ft.dwLowDateTime = uli.LowPart;
+
+                    timestamps->data[dest + i] = std::chrono::system_clock::to_time_t(Orc::ConvertTo(ft));
+                    timestamps->nanoseconds[dest + i] = 0;
+                }
+            }
+            else
+            {
+                auto longs = dynamic_cast<orc::LongVectorBatch*>(&col);
+                if (!longs)
+                    return E_INVALIDARG;
+
+                std::copy(column.Integers() + first, column.Integers() + first + count, longs->data.data() + dest);
+            }
+            break;
+        }
+        case Storage::Bytes:
+        case Storage::FixedBytes: {
+            auto strings = dynamic_cast<orc::StringVectorBatch*>(&col);
+            if (!strings)
+                return E_INVALIDARG;
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!column.IsValid(first + i))
+                    continue;
+
+                const auto value = column.BytesAt(first + i);
+
+                if (pDictionary)
+                {
+                    const auto index =
+                        pDictionary->IsFull() ? pDictionary->Find(value) : pDictionary->Insert(value).first;
+                    if (index.has_value())
+                    {
+                        const auto entry = (*pDictionary)[index.value()];
+                        strings->data[dest + i] = const_cast<char*>(entry.data());
+                        strings->length[dest + i] = entry.size();
+                        continue;
+                    }
+                }
+
+                auto data = m_BatchPool->Allocate(value.size());
+                if (data == nullptr)
+                    return E_OUTOFMEMORY;
+
+                memcpy(data, value.data(), value.size());
+                strings->data[dest + i] = data;
+                strings->length[dest + i] = value.size();
+            }
+            break;
+        }
+        case Storage::WideChars: {
+            auto strings = dynamic_cast<orc::StringVectorBatch*>(&col);
+            if (!strings)
+                return E_INVALIDARG;
+
+            // The whole chunk is converted at once into a single allocation, null rows are empty strings
+            const auto offsets = column.Offsets() + first;
+            auto data = static_cast<char*>(m_BatchPool->Allocate(Text::Utf8MaxLength(offsets[count] - offsets[0])));
+            if (data == nullptr)
+                return E_OUTOFMEMORY;
+
+            std::vector<size_t> utf8Offsets(count + 1);
+            Text::ConvertUtf16ToUtf8(column.WideChars(), offsets, count, data, utf8Offsets.data());
+
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!column.IsValid(first + i))
+                    continue;
+
+                strings->data[dest + i] = data + utf8Offsets[i];
+                strings->length[dest + i] = utf8Offsets[i + 1] - utf8Offsets[i];
+            }
+            break;
+        }
+    }
+    return S_OK;
+}
+
 HRESULT Orc::TableOutput::ApacheOrc::Writer::WriteToFile(const fs::path& path)
 {
     return WriteToFile(path.c_str());
@@ -288,24 +541,245 @@ Orc::TableOutput::ApacheOrc::Writer::WriteToStream(const std::shared_ptr<ByteStr
     m_bCloseStream = bCloseStream;
     m_pByteStream = pStream;
 
+    // The batch and the writer use the pools, they must be gone before they are replaced
+    StopEncoder();
+    m_Batch.reset();
+    m_Writer.reset();
+
     m_OrcStream = std::make_unique<Stream>();
 
     if (auto hr = m_OrcStream->Open(pStream); FAILED(hr))
         return hr;
 
+    for (auto& dictionary : m_dictionaries)
+    {
+        if (dictionary)
+            dictionary->Clear();
+    }
+
+    std::optional<uint64_t> limit;
+    if (m_Options && m_Options->MemoryLimit.has_value())
+        limit = m_Options->MemoryLimit.value();
+
+    // With an encoder, the writer gets half of the limit and each of the two batches a quarter
+    std::shared_ptr<Encoder> encoder;
+    std::optional<uint64_t> writerLimit = limit;
+    if (m_Options && m_Options->dwEncoderThreads > 0)
+    {
+        std::optional<uint64_t> batchLimit;
+        if (limit.has_value())
+        {
+            writerLimit = limit.value() / 2;
+            batchLimit = limit.value() / 4;
+        }
+
+        encoder = std::make_shared<Encoder>();
+        encoder->WriterPool = std::make_unique<MemoryPool>(1024 * 1024 * 20, writerLimit);
+        encoder->SparePool = std::make_unique<MemoryPool>(MemoryPool::kChunkSize * 4, batchLimit);
+        m_BatchPool = std::make_unique<MemoryPool>(MemoryPool::kChunkSize * 4, batchLimit);
+    }
+    else
+    {
+        m_BatchPool = std::make_unique<MemoryPool>(1024 * 1024 * 20, limit);
+    }
+
     orc::WriterOptions options;
     options.setFileVersion(orc::FileVersion(0, 11));
-    options.setCompression(orc::CompressionKind::CompressionKind_ZLIB);
 
-    m_Writer = orc::createWriter(*m_OrcSchema, m_OrcStream.get(), options);
+    if (m_Options)
+    {
+        const auto& compression = m_Options->Compression;
+        options.setCompression(ToOrcCompression(compression.Codec));
+
+        // orc has no compression level, only a strategy (for zstd: level 1 for speed, the default, and 3 otherwise)
+        if (compression.Level.has_value())
+        {
+            options.setCompressionStrategy(
+                compression.Level.value() <= 1 ? orc::CompressionStrategy_SPEED
+                                               : orc::CompressionStrategy_COMPRESSION);
+        }
+    }
+    else
+    {
+        options.setCompression(orc::CompressionKind::CompressionKind_ZLIB);
+    }
+    options.setMemoryPool(encoder ? encoder->WriterPool.get() : m_BatchPool.get());
+
+    // orc only builds dictionaries when asked to, then keeps them for the string columns with few distinct values
+    if (std::any_of(std::cbegin(m_Schema), std::cend(m_Schema), [](const auto& column) { return column->bDictionary; }))
+        options.setDictionaryKeySizeThreshold(kDictionaryKeySizeThreshold);
+
+    if (m_Options && m_Options->RowIndexStride.has_value())
+        options.setRowIndexStride(m_Options->RowIndexStride.value());
+
+    if (m_Options && m_Options->StripeSize.has_value())
+        options.setStripeSize(m_Options->StripeSize.value());
+
+    if (writerLimit.has_value())
+    {
+        // Stripes are buffered until they are written, half of the limit is left to the batch values
+        options.setStripeSize(std::min<uint64_t>(options.getStripeSize(), writerLimit.value() / 2));
+    }
+
+    if (m_Options && !m_Options->BloomFilters.empty())
+    {
+        // The filters are kept with the row index entries, columns missing from this table are ignored
+        std::set<uint64_t> columns;
+        for (size_t i = 0; i < m_Schema.size(); i++)
+        {
+            const auto& name = m_Schema[i].ColumnName;
+            if (std::any_of(
+                    std::cbegin(m_Options->BloomFilters),
+                    std::cend(m_Options->BloomFilters),
+                    [&name](const auto& column) { return equalCaseInsensitive(column, name); }))
+                columns.insert(m_OrcSchema->getSubtype(i)->getColumnId());
+        }
+
+        if (!columns.empty())
+        {
+            // Bloom filters come with the 0.12 file format
+            options.setFileVersion(orc::FileVersion(0, 12));
+            options.setColumnsUseBloomFilter(columns);
+            options.setBloomFilterFPP(0.01);
+        }
+    }
+
+    try
+    {
+        m_Writer = orc::createWriter(*m_OrcSchema, m_OrcStream.get(), options);
+        m_Batch = m_Writer->createRowBatch(m_dwBatchSize);
+
+        if (encoder)
+            encoder->SpareBatch = m_Writer->createRowBatch(m_dwBatchSize);
+    }
+    catch (const Orc::Exception& e)
+    {
+        Log::Error(L"Failed to create ApacheOrc writer: {} [{}]", e.Description, e.ErrorCode());
+        return ToHRESULT(e.ErrorCode());
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("Failed to create ApacheOrc writer: {}", e.what());
+        return E_FAIL;
+    }
+
+    if (encoder)
+    {
+        m_Encoder = std::move(encoder);
+        m_Encoder->Thread = std::thread([this, encoder = m_Encoder.get()]() { Encode(*encoder); });
+    }
+
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::ApacheOrc::Writer::AddBatch(orc::ColumnVectorBatch& batch)
+{
+    const auto activity = Trace::TableFlushStart("ORC", batch.numElements, 0LL);
+
+    try
+    {
+        m_Writer->add(batch);
+    }
+    catch (const Orc::Exception& e)
+    {
+        Log::Error(L"Failed to add batch to ApacheOrc writer: {} [{}]", e.Description, e.ErrorCode());
+        Trace::TableFlushStop(activity, ToHRESULT(e.ErrorCode()));
+        return ToHRESULT(e.ErrorCode());
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("Failed to add batch to ApacheOrc writer: {}", e.what());
+        Trace::TableFlushStop(activity, E_FAIL);
+        return E_FAIL;
+    }
+
+    Trace::TableFlushStop(activity, S_OK);
+    return S_OK;
+}
+
+void Orc::TableOutput::ApacheOrc::Writer::Encode(Encoder& encoder)
+{
+    std::unique_lock<std::mutex> lock(encoder.Mutex);
+
+    for (;;)
+    {
+        encoder.Submitted.wait(lock, [&encoder]() { return encoder.Batch || encoder.bStop; });
+        if (!encoder.Batch)
+            return;
+
+        lock.unlock();
+
+        auto hr = AddBatch(*encoder.Batch);
+
+        // Values were copied by the writer, their memory is used again when this batch is filled next
+        encoder.Pool->Reset();
+
+        lock.lock();
+
+        if (FAILED(hr) && SUCCEEDED(encoder.hr))
+            encoder.hr = hr;
+
+        encoder.SpareBatch = std::move(encoder.Batch);
+        encoder.SparePool = std::move(encoder.Pool);
+        encoder.Added.notify_all();
+    }
+}
+
+HRESULT Orc::TableOutput::ApacheOrc::Writer::SubmitBatch()
+{
+    auto& encoder = *m_Encoder;
+
+    std::unique_lock<std::mutex> lock(encoder.Mutex);
+    encoder.Added.wait(lock, [&encoder]() { return !encoder.Batch; });
+
+    if (FAILED(encoder.hr))
+        return encoder.hr;
 
-    m_Batch = m_Writer->createRowBatch(m_dwBatchSize);
+    encoder.Batch = std::move(m_Batch);
+    encoder.Pool = std::move(m_BatchPool);
 
-    m_BatchPool = std::make_unique<MemoryPool>(1024 * 1024 * 20);
+    m_Batch = std::move(encoder.SpareBatch);
+    m_BatchPool = std::move(encoder.SparePool);
 
+    encoder.Submitted.notify_one();
     return S_OK;
 }
 
+HRESULT Orc::TableOutput::ApacheOrc::Writer::WaitEncoder()
+{
+    if (!m_Encoder)
+        return S_OK;
+
+    auto& encoder = *m_Encoder;
+
+    std::unique_lock<std::mutex> lock(encoder.Mutex);
+    encoder.Added.wait(lock, [&encoder]() { return !encoder.Batch; });
+
+    return encoder.hr;
+}
+
+void Orc::TableOutput::ApacheOrc::Writer::StopEncoder()
+{
+    if (!m_Encoder)
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Encoder->Mutex);
+        m_Encoder->bStop = true;
+    }
+    m_Encoder->Submitted.notify_one();
+
+    // A pending batch is added before the thread ends
+    if (m_Encoder->Thread.joinable())
+        m_Encoder->Thread.join();
+
+    // The batches and the writer were allocated from the writer pool, they must be gone before it is released
+    m_Batch.reset();
+    m_Encoder->SpareBatch.reset();
+    m_Writer.reset();
+    m_Encoder.reset();
+}
+
 STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::Flush()
 {
     auto root = dynamic_cast<orc::StructVectorBatch*>(m_Batch.get());
@@ -318,11 +792,27 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::Flush()
 
         for (DWORD i = 0; i < m_dwColumnNumber; i++)
         {
-            root->fields[m_dwColumnCounter]->numElements = m_dwBatchRow;
+            root->fields[i]->numElements = m_dwBatchRow;
         }
     }
-    m_Writer->add(*m_Batch);
-    m_BatchPool = std::make_unique<MemoryPool>(20 * 1024 * 1024);
+
+    if (m_Encoder)
+    {
+        if (m_dwBatchRow == 0)
+            return S_OK;
+
+        if (auto hr = SubmitBatch(); FAILED(hr))
+            return hr;
+
+        m_dwBatchRow = 0;
+        return S_OK;
+    }
+
+    if (auto hr = AddBatch(*m_Batch); FAILED(hr))
+        return hr;
+
+    // Values were copied by the writer, their memory is used again by the next batch
+    m_BatchPool->Reset();
     m_dwBatchRow = 0;
     return S_OK;
 }
@@ -336,8 +826,22 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::Close()
         return hr;
     }
 
+    if (auto hr = WaitEncoder(); FAILED(hr))
+    {
+        Log::Error(L"Failed to encode ApacheOrc batch [{}]", SystemError(hr));
+        return hr;
+    }
+
     m_Writer->close();
 
+    const auto& stats = m_Encoder ? m_Encoder->WriterPool->GetStatistics() : m_BatchPool->GetStatistics();
+    Log::Debug(
+        L"ApacheOrc memory pool: peak: {}, allocated: {}, reserved: {}, heap allocations: {}",
+        stats.Peak,
+        stats.Allocated,
+        stats.Reserved,
+        stats.Allocations);
+
     if (m_pTermination)
     {
         ScopedLock sl(m_cs);
@@ -422,7 +926,7 @@ HRESULT Orc::TableOutput::ApacheOrc::Writer::WriteEndOfLine()
     m_dwBatchRow++;
     m_dwRows++;
 
-    if (m_dwBatchRow >= m_dwBatchSize)
+    if (m_dwBatchRow >= m_dwBatchSize || m_BatchPool->NeedsFlush())
     {
         return Flush();
     }
@@ -435,7 +939,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::wstring
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(strString.size());
+        auto data = (char*)m_BatchPool->Allocate(strString.size());
         if (data == nullptr)
         {
             AbandonColumn();
@@ -449,7 +953,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::wstring
             AbandonColumn();
             return hr;
         }
-        auto pStr = m_BatchPool->malloc(ansiString.size());
+        auto pStr = m_BatchPool->Allocate(ansiString.size());
         if (pStr == nullptr)
         {
             AbandonColumn();
@@ -471,7 +975,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::wstring
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(strString.size());
+        auto data = (char*)m_BatchPool->Allocate(strString.size());
         if (data == nullptr)
         {
             AbandonColumn();
@@ -484,7 +988,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::wstring
             AbandonColumn();
             return hr;
         }
-        auto pStr = m_BatchPool->malloc(ansiString.size());
+        auto pStr = m_BatchPool->Allocate(ansiString.size());
         if (pStr == nullptr)
         {
             AbandonColumn();
@@ -508,7 +1012,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const WCHAR* szStr
         auto strSize = wcslen(szString);
 
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(strSize);
+        auto data = (char*)m_BatchPool->Allocate(strSize);
         if (data == nullptr)
         {
             AbandonColumn();
@@ -522,7 +1026,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const WCHAR* szStr
             return hr;
         }
 
-        auto pStr = m_BatchPool->malloc(ansiString.size());
+        auto pStr = m_BatchPool->Allocate(ansiString.size());
         if (pStr == nullptr)
         {
             AbandonColumn();
@@ -543,7 +1047,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteCharArray(const WCHAR* sz
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(dwCharCount);
+        auto data = (char*)m_BatchPool->Allocate(dwCharCount);
         if (data == nullptr)
         {
             AbandonColumn();
@@ -557,7 +1061,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteCharArray(const WCHAR* sz
             return hr;
         }
 
-        auto pStr = m_BatchPool->malloc(ansiString.size());
+        auto pStr = m_BatchPool->Allocate(ansiString.size());
         if (pStr == nullptr)
         {
             AbandonColumn();
@@ -592,7 +1096,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::string&
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(strString.size());
+        auto data = (char*)m_BatchPool->Allocate(strString.size());
         if (data == nullptr)
         {
             AbandonColumn();
@@ -613,7 +1117,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const std::string_
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(strString.size());
+        auto data = (char*)m_BatchPool->Allocate(strString.size());
         if (data == nullptr)
         {
             AbandonColumn();
@@ -638,7 +1142,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteString(const CHAR* szStri
 
         auto strSize = strlen(szString);
 
-        auto data = (char*)m_BatchPool->malloc(strSize);
+        auto data = (char*)m_BatchPool->Allocate(strSize);
         if (data == nullptr)
         {
             AbandonColumn();
@@ -659,7 +1163,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteCharArray(const CHAR* szS
     if (root)
     {
         auto col = dynamic_cast<orc::StringVectorBatch*>(root->fields[m_dwColumnCounter]);
-        auto data = (char*)m_BatchPool->malloc(dwCharCount);
+        auto data = (char*)m_BatchPool->Allocate(dwCharCount);
         if (data == nullptr)
         {
             AbandonColumn();
@@ -910,7 +1414,7 @@ STDMETHODIMP Orc::TableOutput::ApacheOrc::Writer::WriteGUID(const GUID& guid)
 
         auto guidSize = sizeof(GUID);
 
-        auto data = (char*)m_BatchPool->malloc(guidSize);
+        auto data = (char*)m_BatchPool->Allocate(guidSize);
         if (data == nullptr)
             return E_OUTOFMEMORY;
 
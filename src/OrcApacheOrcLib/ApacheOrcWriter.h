@@ -8,6 +8,7 @@
 #pragma once
 
 #include "TableOutputWriter.h"
+#include "TableOutputDictionary.h"
 #include "OutputSpec.h"
 #include "CriticalSection.h"
 
@@ -52,7 +53,7 @@ public:
     STDMETHOD(WriteToStream)(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream = true) override final;
 
     STDMETHOD(SetSchema)(const TableOutput::Schema& columns) override final;
-    ;
+    STDMETHOD(WriteBatch)(const TableOutput::RecordBatch& batch) override final;
 
     virtual DWORD GetCurrentColumnID() override final { return m_dwColumnCounter; };
 
@@ -127,6 +128,27 @@ protected:
 
     HRESULT AddColumnAndCheckNumbers();
 
+    // Copy 'count' rows of a batch column, starting at 'first', to the current rows of the orc column
+    HRESULT WriteBatchColumn(
+        orc::ColumnVectorBatch& col,
+        const TableOutput::BatchColumn& column,
+        size_t first,
+        size_t count,
+        StringDictionary* pDictionary);
+
+    // Add the current rows to the orc writer, on the calling thread or on the encoder thread
+    HRESULT AddBatch(orc::ColumnVectorBatch& batch);
+
+    // Background encoding (Options::dwEncoderThreads): the full batch is handed to the encoder thread and rows go to
+    // the spare batch meanwhile. Each batch has its own pool for its values, the writer has a third one.
+    struct Encoder;
+    std::shared_ptr<Encoder> m_Encoder;
+
+    HRESULT SubmitBatch();
+    HRESULT WaitEncoder();
+    void StopEncoder();
+    void Encode(Encoder& encoder);
+
     std::unique_ptr<Options> m_Options;
     std::shared_ptr<WriterTermination> m_pTermination;
 
@@ -146,6 +168,12 @@ protected:
 
     std::unique_ptr<MemoryPool> m_BatchPool;
 
+    // For utf8 columns declared with 'dictionary="yes"', null otherwise: rows point to the entries instead of a copy in
+    // the pool. Entries live as long as the file.
+    static constexpr size_t kMaxDictionaryEntries = 1 << 16;
+    static constexpr size_t kMaxDictionaryBytes = 16 * 1024 * 1024;
+    std::vector<std::unique_ptr<StringDictionary>> m_dictionaries;
+
     std::shared_ptr<ByteStream> m_pByteStream = nullptr;
     bool m_bCloseStream = true;
 
@@ -37,6 +37,13 @@ public:
 
         bool NoError = false;
         bool NoTrunc = false;
+        bool Sparse = false;
+
+        // Only read the clusters allocated by the file system of the input volume, implies Sparse
+        bool Allocated = false;
+
+        // Handles reading blocks concurrently, sequential reads unless greater than 1
+        DWORD Readers = 0L;
 
         ULARGE_INTEGER BlockSize = {512L};
         ULARGE_INTEGER Count = {0L};
@@ -67,6 +67,12 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                     ;
                 else if (BooleanOption(argv[i] + 1, L"noerror", config.NoError))
                     ;
+                else if (BooleanOption(argv[i] + 1, L"sparse", config.Sparse))
+                    ;
+                else if (BooleanOption(argv[i] + 1, L"allocated", config.Allocated))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"readers", config.Readers))
+                    ;
                 else if (ProcessPriorityOption(argv[i] + 1))
                     ;
                 else if (UsageOption(argv[i] + 1))
@@ -115,5 +121,17 @@ HRESULT Main::CheckConfiguration()
         config.BlockSize.QuadPart = 512;
     }
 
+    if (config.Allocated)
+    {
+        // Unallocated clusters are zeroes in the image: they are left as holes in the outputs
+        config.Sparse = true;
+
+        if (config.Readers > 1)
+        {
+            Log::Warn("Option '/readers' is ignored with '/allocated', clusters are read sequentially");
+            config.Readers = 0L;
+        }
+    }
+
     return S_OK;
 }
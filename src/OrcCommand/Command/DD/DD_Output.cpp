@@ -29,7 +29,7 @@ void Main::PrintUsage()
         usageNode,
         "Usage: DFIR-Orc.exe DD [/out=<Folder|Outfile.csv|Archive.7z>] /if=<InputLocation> /of=<OutputLocation> "
         "/bs=<BlockSize> /count=<BlockCount> [/skip=<BlockCount>] [/seek=<BlockCount>] [/hash=<Hashes>] [/noerror] "
-        "[/notrunc]",
+        "[/notrunc] [/sparse] [/allocated] [/readers=<Count>]",
         "Dump tool inspired from linux 'dd' command");
 
     constexpr std::array kSpecificParameters = {
@@ -42,6 +42,19 @@ void Main::PrintUsage()
         Usage::Parameter {"/Hash=<Hashes>", ""},
         Usage::Parameter {"/NoError", ""},
         Usage::Parameter {"/NoTrunc", ""},
+        Usage::Parameter {
+            "/Sparse",
+            "Write outputs as sparse files: runs of zeroes of at least 64KB are not written, block size should be a "
+            "multiple of 64KB. Hashes still cover the whole image"},
+        Usage::Parameter {
+            "/Allocated",
+            "Input is a NTFS, FAT or exFAT volume: only read its allocated clusters, the others are zeroes in the "
+            "image (implies /Sparse). Hashes cover this image and the allocated ranges are listed in "
+            "'<OutputLocation>.clusters'"},
+        Usage::Parameter {
+            "/Readers=<Count>",
+            "Read blocks concurrently with this number of handles, blocks are still written and hashed in order. "
+            "Use large block sizes (several MB) on RAID or NVMe devices"},
     };
 
     Usage::PrintParameters(usageNode, "PARAMETERS", kSpecificParameters);
@@ -89,6 +102,13 @@ void Main::PrintParameters()
 
     PrintValue(node, L"No Error", config.NoError);
     PrintValue(node, L"No Truncation", config.NoTrunc);
+    PrintValue(node, L"Sparse", config.Sparse);
+    PrintValue(node, L"Allocated only", config.Allocated);
+
+    if (config.Readers > 1)
+    {
+        PrintValue(node, L"Readers", config.Readers);
+    }
     PrintValue(node, L"Hashs", config.Hash);
 }
 
@@ -9,6 +9,7 @@
 #include "stdafx.h"
 
 #include "FileStream.h"
+#include "SparseStream.h"
 #include "CryptoHashStream.h"
 
 #include "SystemDetails.h"
@@ -17,10 +18,369 @@
 #include "DD.h"
 
 #include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include <winioctl.h>
 
 using namespace Orc;
 using namespace Orc::Command::DD;
 
+namespace {
+
+// Read the blocks of a range of the input with several handles so that many reads are in flight: block N is read by
+// worker N modulo the worker count and blocks are handed to the caller in the input order. Workers stay at most a few
+// blocks ahead of the caller to bound the memory used.
+class ParallelBlockReader
+{
+public:
+    struct Block
+    {
+        HRESULT hr = E_FAIL;
+        ULONGLONG ullRead = 0LL;
+        CBinaryBuffer data {true};
+    };
+
+    ParallelBlockReader(
+        const std::wstring& strPath,
+        ULONGLONG ullOffset,
+        ULONGLONG ullBlockSize,
+        ULONGLONG ullBlockCount,
+        DWORD dwWorkers)
+        : m_strPath(strPath)
+        , m_ullOffset(ullOffset)
+        , m_ullBlockSize(ullBlockSize)
+        , m_ullBlockCount(ullBlockCount)
+        , m_ullWindow(static_cast<ULONGLONG>(dwWorkers) * 2)
+    {
+        for (DWORD i = 0; i < dwWorkers; i++)
+        {
+            m_Workers.emplace_back([this, i, dwWorkers]() { Work(i, dwWorkers); });
+        }
+    }
+
+    ~ParallelBlockReader()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_bStop = true;
+        }
+        m_Changed.notify_all();
+
+        for (auto& worker : m_Workers)
+        {
+            worker.join();
+        }
+    }
+
+    // Next block in input order, std::nullopt once all the blocks were returned
+    std::optional<Block> Next()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (m_ullNext >= m_ullBlockCount)
+        {
+            return std::nullopt;
+        }
+
+        m_Changed.wait(lock, [this]() { return m_Blocks.find(m_ullNext) != std::cend(m_Blocks); });
+
+        auto it = m_Blocks.find(m_ullNext);
+        Block block = std::move(it->second);
+        m_Blocks.erase(it);
+        m_ullNext++;
+
+        lock.unlock();
+        m_Changed.notify_all();
+        return block;
+    }
+
+private:
+    void Work(DWORD dwWorker, DWORD dwWorkers)
+    {
+        FileStream stream;
+        HRESULT hrOpen = stream.OpenFile(
+            m_strPath.c_str(),
+            FILE_READ_DATA,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            NULL,
+            OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        if (FAILED(hrOpen))
+        {
+            Log::Error(L"Failed to open '{}' to read data [{}]", m_strPath, SystemError(hrOpen));
+        }
+
+        for (ULONGLONG ullIndex = dwWorker; ullIndex < m_ullBlockCount; ullIndex += dwWorkers)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Changed.wait(lock, [this, ullIndex]() { return m_bStop || ullIndex < m_ullNext + m_ullWindow; });
+                if (m_bStop)
+                {
+                    return;
+                }
+            }
+
+            Block block;
+            block.hr = hrOpen;
+            if (SUCCEEDED(block.hr) && !block.data.SetCount(static_cast<size_t>(m_ullBlockSize)))
+            {
+                block.hr = E_OUTOFMEMORY;
+            }
+            if (SUCCEEDED(block.hr))
+            {
+                block.hr = stream.SetFilePointer(m_ullOffset + ullIndex * m_ullBlockSize, FILE_BEGIN, NULL);
+            }
+            if (SUCCEEDED(block.hr))
+            {
+                block.hr = stream.Read(block.data.GetData(), block.data.GetCount(), &block.ullRead);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Blocks.emplace(ullIndex, std::move(block));
+            }
+            m_Changed.notify_all();
+        }
+    }
+
+    const std::wstring m_strPath;
+    const ULONGLONG m_ullOffset;
+    const ULONGLONG m_ullBlockSize;
+    const ULONGLONG m_ullBlockCount;
+    const ULONGLONG m_ullWindow;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_Changed;
+    std::map<ULONGLONG, Block> m_Blocks;
+    ULONGLONG m_ullNext = 0LL;
+    bool m_bStop = false;
+
+    std::vector<std::thread> m_Workers;
+};
+
+// Clusters of a NTFS, FAT or exFAT volume in use, as tracked by the file system driver ($Bitmap, FAT tables). Bytes
+// which are not part of the cluster heap (boot sectors, FAT tables, backup boot sector) are always in use.
+class AllocatedClusters
+{
+public:
+    HRESULT Load(FileStream& volume, ULONGLONG ullVolumeSize)
+    {
+        CBinaryBuffer boot(true);
+        if (!boot.SetCount(4096))
+            return E_OUTOFMEMORY;
+
+        ULONGLONG ullRead = 0LL;
+        if (auto hr = volume.SetFilePointer(0LL, FILE_BEGIN, nullptr); FAILED(hr))
+            return hr;
+        if (auto hr = volume.Read(boot.GetData(), boot.GetCount(), &ullRead); FAILED(hr))
+        {
+            Log::Error(L"Failed to read boot sector of '{}' [{}]", volume.Path(), SystemError(hr));
+            return hr;
+        }
+        if (auto hr = volume.SetFilePointer(0LL, FILE_BEGIN, nullptr); FAILED(hr))
+            return hr;
+
+        const auto pBoot = boot.GetData();
+        const auto Word = [pBoot](size_t offset) { return *reinterpret_cast<const WORD*>(pBoot + offset); };
+        const auto Dword = [pBoot](size_t offset) { return *reinterpret_cast<const DWORD*>(pBoot + offset); };
+
+        if (ullRead < 512 || Word(0x1FE) != 0xAA55)
+        {
+            Log::Error(L"No boot sector found on '{}'", volume.Path());
+            return HRESULT_FROM_WIN32(ERROR_UNRECOGNIZED_VOLUME);
+        }
+
+        if (!memcmp(pBoot + 3, "NTFS    ", 8))
+        {
+            // Sectors per cluster above 0x80 are a negative power of two
+            const ULONGLONG ullSectorSize = Word(0x0B);
+            const BYTE bSectorsPerCluster = pBoot[0x0D];
+            m_ullClusterSize = bSectorsPerCluster <= 0x80 ? ullSectorSize * bSectorsPerCluster
+                                                          : 1LL << (256 - bSectorsPerCluster);
+            m_ullHeapOffset = 0LL;
+        }
+        else if (!memcmp(pBoot + 3, "EXFAT   ", 8))
+        {
+            const ULONGLONG ullSectorSize = 1LL << pBoot[0x6C];
+            m_ullClusterSize = ullSectorSize << pBoot[0x6D];
+            m_ullHeapOffset = Dword(0x58) * ullSectorSize;
+        }
+        else
+        {
+            // FAT12/16/32: clusters start after the reserved sectors, the FATs and the root directory (but on FAT32)
+            const ULONGLONG ullSectorSize = Word(0x0B);
+            const ULONGLONG ullFATSectors = Word(0x16) != 0 ? Word(0x16) : Dword(0x24);
+            if (ullSectorSize == 0 || pBoot[0x0D] == 0 || pBoot[0x10] == 0 || ullFATSectors == 0)
+            {
+                Log::Error(L"File system of '{}' is not supported, only NTFS, FAT and exFAT are", volume.Path());
+                return HRESULT_FROM_WIN32(ERROR_UNRECOGNIZED_VOLUME);
+            }
+
+            const ULONGLONG ullRootSectors = (Word(0x11) * 32 + ullSectorSize - 1) / ullSectorSize;
+            m_ullClusterSize = ullSectorSize * pBoot[0x0D];
+            m_ullHeapOffset = (Word(0x0E) + pBoot[0x10] * ullFATSectors + ullRootSectors) * ullSectorSize;
+        }
+
+        if (m_ullClusterSize == 0)
+        {
+            Log::Error(L"Invalid cluster size in boot sector of '{}'", volume.Path());
+            return HRESULT_FROM_WIN32(ERROR_UNRECOGNIZED_VOLUME);
+        }
+
+        if (auto hr = LoadBitmap(volume); FAILED(hr))
+            return hr;
+
+        m_ullSize = std::max(ullVolumeSize, m_ullHeapOffset + m_ullClusters * m_ullClusterSize);
+        return S_OK;
+    }
+
+    ULONGLONG Size() const { return m_ullSize; }
+    ULONGLONG ClusterSize() const { return m_ullClusterSize; }
+
+    // Call 'fn(ullOffset, ullLength)' with each run of bytes in use within a range, until it fails
+    template <typename Fn>
+    HRESULT ForEachRun(ULONGLONG ullOffset, ULONGLONG ullLength, Fn&& fn) const
+    {
+        const auto ullEnd = std::min(ullOffset + ullLength, m_ullSize);
+        const auto ullHeapEnd = m_ullHeapOffset + m_ullClusters * m_ullClusterSize;
+
+        auto ullRunStart = ullOffset;
+        auto ullCurrent = ullOffset;
+        while (ullCurrent < ullEnd)
+        {
+            ULONGLONG ullNext = 0LL;
+            bool bInUse = true;
+            if (ullCurrent < m_ullHeapOffset)
+            {
+                ullNext = m_ullHeapOffset;
+            }
+            else if (ullCurrent >= ullHeapEnd)
+            {
+                ullNext = ullEnd;
+            }
+            else
+            {
+                const auto ullCluster = (ullCurrent - m_ullHeapOffset) / m_ullClusterSize;
+                bInUse = (m_bitmap[static_cast<size_t>(ullCluster / 8)] & (1 << (ullCluster % 8))) != 0;
+                ullNext = m_ullHeapOffset + (ullCluster + 1) * m_ullClusterSize;
+            }
+            ullNext = std::min(ullNext, ullEnd);
+
+            if (!bInUse)
+            {
+                if (ullCurrent > ullRunStart)
+                {
+                    if (auto hr = fn(ullRunStart, ullCurrent - ullRunStart); FAILED(hr))
+                        return hr;
+                }
+                ullRunStart = ullNext;
+            }
+            ullCurrent = ullNext;
+        }
+
+        if (ullEnd > ullRunStart)
+        {
+            if (auto hr = fn(ullRunStart, ullEnd - ullRunStart); FAILED(hr))
+                return hr;
+        }
+        return S_OK;
+    }
+
+private:
+    HRESULT LoadBitmap(FileStream& volume)
+    {
+        // The bitmap is fetched by windows of 8M clusters, the returned starting LCN is rounded down to a byte
+        constexpr DWORD kWindowBytes = 1024 * 1024;
+
+        CBinaryBuffer buffer(true);
+        if (!buffer.SetCount(offsetof(VOLUME_BITMAP_BUFFER, Buffer) + kWindowBytes))
+            return E_OUTOFMEMORY;
+
+        STARTING_LCN_INPUT_BUFFER input = {0};
+        while (true)
+        {
+            DWORD dwReturned = 0L;
+            const bool bDone = DeviceIoControl(
+                volume.GetHandle(),
+                FSCTL_GET_VOLUME_BITMAP,
+                &input,
+                sizeof(input),
+                buffer.GetData(),
+                static_cast<DWORD>(buffer.GetCount()),
+                &dwReturned,
+                nullptr);
+            if (!bDone && GetLastError() != ERROR_MORE_DATA)
+            {
+                const auto hr = HRESULT_FROM_WIN32(GetLastError());
+                Log::Error(L"Failed to get the cluster bitmap of '{}' [{}]", volume.Path(), SystemError(hr));
+                return hr;
+            }
+
+            const auto pBitmap = reinterpret_cast<const VOLUME_BITMAP_BUFFER*>(buffer.GetData());
+            const auto ullStart = static_cast<ULONGLONG>(pBitmap->StartingLcn.QuadPart);
+            const auto ullClusters = static_cast<ULONGLONG>(pBitmap->BitmapSize.QuadPart);
+            const auto cbBitmap = dwReturned - offsetof(VOLUME_BITMAP_BUFFER, Buffer);
+
+            m_ullClusters = ullStart + ullClusters;
+            m_bitmap.resize(static_cast<size_t>(ullStart / 8));
+            m_bitmap.insert(std::end(m_bitmap), pBitmap->Buffer, pBitmap->Buffer + cbBitmap);
+
+            if (bDone)
+                break;
+
+            input.StartingLcn.QuadPart = ullStart + cbBitmap * 8;
+        }
+
+        m_bitmap.resize(static_cast<size_t>((m_ullClusters + 7) / 8));
+        Log::Debug(L"Loaded bitmap of '{}': {} clusters of {} bytes", volume.Path(), m_ullClusters, m_ullClusterSize);
+        return S_OK;
+    }
+
+    ULONGLONG m_ullClusterSize = 0LL;
+    ULONGLONG m_ullHeapOffset = 0LL;
+    ULONGLONG m_ullClusters = 0LL;
+    ULONGLONG m_ullSize = 0LL;
+    std::vector<BYTE> m_bitmap;
+};
+
+// List the runs of the image read from allocated clusters as 'offset,length' lines
+HRESULT WriteClusterMap(const std::wstring& strPath, const std::vector<std::pair<ULONGLONG, ULONGLONG>>& runs)
+{
+    FileStream stream;
+    if (auto hr = stream.WriteTo(strPath.c_str()); FAILED(hr))
+    {
+        Log::Error(L"Failed to create cluster map '{}' [{}]", strPath, SystemError(hr));
+        return hr;
+    }
+
+    std::string text = "Offset,Length\r\n";
+    for (size_t i = 0; i <= runs.size(); i++)
+    {
+        if (i < runs.size())
+            fmt::format_to(std::back_inserter(text), "{},{}\r\n", runs[i].first, runs[i].second);
+
+        if (text.size() >= 1024 * 1024 || (i == runs.size() && !text.empty()))
+        {
+            ULONGLONG ullWritten = 0LL;
+            if (auto hr = stream.Write(text.data(), text.size(), &ullWritten); FAILED(hr))
+            {
+                Log::Error(L"Failed to write cluster map '{}' [{}]", strPath, SystemError(hr));
+                return hr;
+            }
+            text.clear();
+        }
+    }
+
+    return stream.Close();
+}
+
+}  // namespace
+
 HRESULT Main::Run()
 {
     std::shared_ptr<ByteStream> input_stream;
@@ -69,10 +429,41 @@ HRESULT Main::Run()
             ullMaxBytes - (config.Skip.QuadPart * config.BlockSize.QuadPart));
     }
 
+    bool bParallel = config.Readers > 1;
+    if (bParallel && ullMaxBytes == 0LL)
+    {
+        Log::Warn(L"Size of '{}' is unknown, reading sequentially", config.strIF);
+        bParallel = false;
+    }
+
+    std::unique_ptr<AllocatedClusters> clusters;
+    std::vector<std::pair<ULONGLONG, ULONGLONG>> cluster_runs;
+    if (config.Allocated)
+    {
+        clusters = std::make_unique<AllocatedClusters>();
+        if (auto hr = clusters->Load(*input_file_stream, ullMaxBytes); FAILED(hr))
+        {
+            Log::Critical(L"Failed to load the allocated clusters of '{}' [{}]", config.strIF, SystemError(hr));
+            return hr;
+        }
+
+        if (ullMaxBytes == 0LL)
+        {
+            ullMaxBytes = clusters->Size();
+            ullTotalBytes = config.Count.QuadPart == 0LL
+                ? ullMaxBytes
+                : std::min<ULONGLONG>(
+                    config.Count.QuadPart * config.BlockSize.QuadPart,
+                    ullMaxBytes - (config.Skip.QuadPart * config.BlockSize.QuadPart));
+        }
+    }
+
     if (config.Hash != CryptoHashStream::Algorithm::Undefined)
     {
+        // Parallel and allocated cluster reads bypass the input stream: blocks are hashed once back in input order
         auto hash_stream = std::make_shared<CryptoHashStream>();
-        auto hr = hash_stream->OpenToRead(config.Hash, input_file_stream);
+        auto hr = bParallel || clusters ? hash_stream->OpenToWrite(config.Hash, nullptr)
+                                        : hash_stream->OpenToRead(config.Hash, input_file_stream);
         if (FAILED(hr))
         {
             Log::Critical("Failed to open hash stream for input [{}]", SystemError(hr));
@@ -87,16 +478,33 @@ HRESULT Main::Run()
     }
 
     std::vector<std::pair<std::wstring, std::shared_ptr<ByteStream>>> output_streams;
+    std::vector<std::pair<std::wstring, std::shared_ptr<SparseStream>>> sparse_streams;
     bool bValidOutput = false;
     for (const auto& out : config.OF)
     {
         std::shared_ptr<ByteStream> out_stream;
 
-        auto out_file_stream = std::make_shared<FileStream>();
-
-        if (auto hr = out_file_stream->OpenFile(
+        std::shared_ptr<FileStream> out_file_stream;
+        if (config.Sparse)
+        {
+            // Holes are punched in the existing content when overwriting: the file size is read
+            auto sparse_stream = std::make_shared<SparseStream>();
+            hr = sparse_stream->OpenFile(
+                out.c_str(), GENERIC_READ | GENERIC_WRITE, 0L, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (SUCCEEDED(hr))
+            {
+                sparse_streams.emplace_back(out, sparse_stream);
+            }
+            out_file_stream = std::move(sparse_stream);
+        }
+        else
+        {
+            out_file_stream = std::make_shared<FileStream>();
+            hr = out_file_stream->OpenFile(
                 out.c_str(), GENERIC_WRITE, 0L, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
-            FAILED(hr))
+        }
+
+        if (FAILED(hr))
         {
             Log::Warn(L"Failed to open '{}' for write [{}]", config.strIF, SystemError(hr));
             out_stream = out_file_stream = nullptr;
@@ -132,7 +540,24 @@ HRESULT Main::Run()
 
     ULONGLONG ullCurrentCursor = 0LLU;
 
-    if (config.Skip.QuadPart > 0LL)
+    std::unique_ptr<ParallelBlockReader> reader;
+    if (bParallel)
+    {
+        const auto ullOffset = config.BlockSize.QuadPart * config.Skip.QuadPart;
+        const auto ullEnd = std::min(ullMaxBytes, ullOffset + ullTotalBytes);
+        const auto ullBlocks =
+            ullEnd > ullOffset ? (ullEnd - ullOffset + config.BlockSize.QuadPart - 1) / config.BlockSize.QuadPart : 0LL;
+
+        Log::Debug(L"Reading {} blocks from '{}' with {} readers", ullBlocks, config.strIF, config.Readers);
+        reader = std::make_unique<ParallelBlockReader>(
+            config.strIF, ullOffset, config.BlockSize.QuadPart, ullBlocks, config.Readers);
+    }
+    else if (clusters)
+    {
+        // Runs of allocated clusters are read at their offset
+        ullCurrentCursor = config.BlockSize.QuadPart * config.Skip.QuadPart;
+    }
+    else if (config.Skip.QuadPart > 0LL)
     {
         if (auto hr = input_stream->SetFilePointer(
                 config.BlockSize.QuadPart * config.Skip.QuadPart, FILE_BEGIN, &ullCurrentCursor);
@@ -198,57 +623,160 @@ HRESULT Main::Run()
         auto blockStart = std::chrono::system_clock::now();
 
         ULONGLONG ullRead = 0LL;
-        if (auto hr = input_stream->Read(buffer.GetData(), buffer.GetCount(), &ullRead); FAILED(hr))
+        BYTE* pData = buffer.GetData();
+        std::optional<ParallelBlockReader::Block> block;
+
+        if (reader)
         {
-            if (config.NoError)
+            block = reader->Next();
+            if (!block)
+            {
+                Log::Debug("Done reading from input stream");
+                break;
+            }
+
+            if (FAILED(block->hr))
             {
-                ZeroMemory(buffer.GetData(), buffer.GetCount());
-                ullRead = config.BlockSize.QuadPart;
-                if (auto hr = input_file_stream->SetFilePointer(config.BlockSize.QuadPart, FILE_CURRENT, NULL);
-                    FAILED(hr))
+                if (!config.NoError)
                 {
                     Log::Error(
-                        L"Failed to seek to {} bytes offset after error with '{}' (absolute offset {})",
-                        buffer.GetCount(),
+                        L"Failed to read {} bytes from input stream {} (absolute offset {}) [{}]",
+                        block->data.GetCount(),
                         config.strIF,
-                        ullAbsoluteOffset);
+                        ullAbsoluteOffset,
+                        SystemError(block->hr));
                     break;
                 }
+
+                ZeroMemory(block->data.GetData(), block->data.GetCount());
+                block->ullRead = block->data.GetCount();
             }
-            else
+
+            ullRead = block->ullRead;
+            pData = block->data.GetData();
+            if (ullRead == 0LL)
             {
-                Log::Error(
-                    L"Failed to read {} bytes from input stream {} (absolute offset {})",
-                    buffer.GetCount(),
-                    config.strIF,
-                    ullAbsoluteOffset);
+                Log::Debug("Done reading from input stream");
                 break;
             }
-        }
 
-        if (ullRead == 0LL)
+            // Blocks come in input order: the input hash is computed as in sequential mode
+            ULONGLONG ullHashed = 0LL;
+            if (config.Hash != CryptoHashStream::Algorithm::Undefined
+                && FAILED(hr = input_stream->Write(pData, ullRead, &ullHashed)))
+            {
+                Log::Error(L"Failed to hash {} bytes from '{}' [{}]", ullRead, config.strIF, SystemError(hr));
+            }
+        }
+        else if (clusters)
         {
-            Log::Debug("Done reading from input stream");
-            break;
+            if (ullCurrentCursor >= clusters->Size())
+            {
+                Log::Debug("Done reading from input stream");
+                break;
+            }
+
+            // Unallocated clusters are not read: they are zeroes in the image, holes in the outputs
+            ullRead = std::min<ULONGLONG>(buffer.GetCount(), clusters->Size() - ullCurrentCursor);
+            ZeroMemory(pData, static_cast<size_t>(ullRead));
+
+            const auto ullBlockOffset = ullCurrentCursor;
+            hr = clusters->ForEachRun(ullBlockOffset, ullRead, [&](ULONGLONG ullOffset, ULONGLONG ullLength) {
+                const auto ullImageOffset = ullOffset - config.BlockSize.QuadPart * config.Skip.QuadPart
+                    + config.BlockSize.QuadPart * config.Seek.QuadPart;
+                if (!cluster_runs.empty() && cluster_runs.back().first + cluster_runs.back().second == ullImageOffset)
+                    cluster_runs.back().second += ullLength;
+                else
+                    cluster_runs.emplace_back(ullImageOffset, ullLength);
+
+                ULONGLONG ullRunRead = 0LL;
+                auto hrRun = input_file_stream->SetFilePointer(ullOffset, FILE_BEGIN, nullptr);
+                if (SUCCEEDED(hrRun))
+                    hrRun = input_file_stream->Read(pData + (ullOffset - ullBlockOffset), ullLength, &ullRunRead);
+                if (FAILED(hrRun))
+                {
+                    Log::Error(
+                        L"Failed to read {} bytes from input stream {} (absolute offset {}) [{}]",
+                        ullLength,
+                        config.strIF,
+                        ullOffset,
+                        SystemError(hrRun));
+                    if (config.NoError)
+                    {
+                        ZeroMemory(pData + (ullOffset - ullBlockOffset), static_cast<size_t>(ullLength));
+                        return S_OK;
+                    }
+                }
+                return hrRun;
+            });
+            if (FAILED(hr))
+            {
+                break;
+            }
+
+            ullCurrentCursor += ullRead;
+
+            ULONGLONG ullHashed = 0LL;
+            if (config.Hash != CryptoHashStream::Algorithm::Undefined
+                && FAILED(hr = input_stream->Write(pData, ullRead, &ullHashed)))
+            {
+                Log::Error(L"Failed to hash {} bytes from '{}' [{}]", ullRead, config.strIF, SystemError(hr));
+            }
         }
         else
         {
-            ullCurrentCursor += ullRead;
-            auto ullNewCursor = 0LLU;
-            if (auto hr = input_stream->SetFilePointer(ullCurrentCursor, FILE_BEGIN, &ullNewCursor); FAILED(hr))
+            if (auto hr = input_stream->Read(buffer.GetData(), buffer.GetCount(), &ullRead); FAILED(hr))
+            {
+                if (config.NoError)
+                {
+                    ZeroMemory(buffer.GetData(), buffer.GetCount());
+                    ullRead = config.BlockSize.QuadPart;
+                    if (auto hr = input_file_stream->SetFilePointer(config.BlockSize.QuadPart, FILE_CURRENT, NULL);
+                        FAILED(hr))
+                    {
+                        Log::Error(
+                            L"Failed to seek to {} bytes offset after error with '{}' (absolute offset {})",
+                            buffer.GetCount(),
+                            config.strIF,
+                            ullAbsoluteOffset);
+                        break;
+                    }
+                }
+                else
+                {
+                    Log::Error(
+                        L"Failed to read {} bytes from input stream {} (absolute offset {})",
+                        buffer.GetCount(),
+                        config.strIF,
+                        ullAbsoluteOffset);
+                    break;
+                }
+            }
+
+            if (ullRead == 0LL)
             {
-                Log::Error("Failed to seek to {} offset", ullCurrentCursor);
+                Log::Debug("Done reading from input stream");
+                break;
+            }
+            else
+            {
+                ullCurrentCursor += ullRead;
+                auto ullNewCursor = 0LLU;
+                if (auto hr = input_stream->SetFilePointer(ullCurrentCursor, FILE_BEGIN, &ullNewCursor); FAILED(hr))
+                {
+                    Log::Error("Failed to seek to {} offset", ullCurrentCursor);
+                }
+                assert(ullNewCursor == ullCurrentCursor);
             }
-            assert(ullNewCursor == ullCurrentCursor);
         }
 
         for (const auto& output : output_streams)
         {
             ULONGLONG ullWritten = 0LL;
             auto hr = E_FAIL;
-            if (output.second != nullptr && FAILED(hr = output.second->Write(buffer.GetData(), ullRead, &ullWritten)))
+            if (output.second != nullptr && FAILED(hr = output.second->Write(pData, ullRead, &ullWritten)))
             {
-                Log::Error(L"Failed to write {} bytes to output stream '{}'", buffer.GetCount(), output.first);
+                Log::Error(L"Failed to write {} bytes to output stream '{}'", ullRead, output.first);
             }
         }
 
@@ -287,12 +815,28 @@ HRESULT Main::Run()
         }
     }
 
+    reader.reset();
+
     if (auto hr = input_stream->Close(); FAILED(hr))
     {
         Log::Error(L"Failed to close input stream '{}' [{}]", config.strIF, SystemError(hr));
         return hr;
     }
 
+    for (const auto& [out, sparse_stream] : sparse_streams)
+    {
+        Log::Info(L"Output '{}': {} bytes of zeroes left as holes", out, sparse_stream->SkippedBytes());
+    }
+
+    if (clusters)
+    {
+        for (const auto& output : output_streams)
+        {
+            if (output.second != nullptr)
+                WriteClusterMap(output.first + L".clusters", cluster_runs);
+        }
+    }
+
     for (const auto& output : output_streams)
     {
         auto hr = E_FAIL;
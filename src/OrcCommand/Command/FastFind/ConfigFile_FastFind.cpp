@@ -101,6 +101,24 @@ HRESULT Orc::Config::FastFind::filesystem(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent[dwIndex].AddAttribute(L"resurrect", FASTFIND_FILESYSTEM_RESURRECT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"workers", FASTFIND_FILESYSTEM_WORKERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"outoforder", FASTFIND_FILESYSTEM_OUT_OF_ORDER, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"namescan", FASTFIND_FILESYSTEM_NAME_SCAN, ConfigItem::OPTION)))
+        return hr;
+    return S_OK;
+}
+
+HRESULT Orc::Config::FastFind::process(ConfigItem& parent, DWORD dwIndex)
+{
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = parent.AddChildNode(L"process", dwIndex, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddChild(yara, FASTFIND_PROCESS_YARA)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"workers", FASTFIND_PROCESS_WORKERS, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
@@ -135,6 +153,8 @@ HRESULT Orc::Config::FastFind::root(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddChild(L"output", output, FASTFIND_OUTPUT_STRUCTURED)))
         return hr;
+    if (FAILED(hr = item.AddChild(process, FASTFIND_PROCESS)))
+        return hr;
 
     return S_OK;
 }
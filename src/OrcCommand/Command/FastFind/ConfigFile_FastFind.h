@@ -36,11 +36,17 @@ constexpr auto FASTFIND_FILESYSTEM_FILEFIND = 2L;
 constexpr auto FASTFIND_FILESYSTEM_EXCLUDE = 3L;
 constexpr auto FASTFIND_FILESYSTEM_YARA = 4L;
 constexpr auto FASTFIND_FILESYSTEM_RESURRECT = 5L;
+constexpr auto FASTFIND_FILESYSTEM_WORKERS = 6L;
+constexpr auto FASTFIND_FILESYSTEM_OUT_OF_ORDER = 7L;
+constexpr auto FASTFIND_FILESYSTEM_NAME_SCAN = 8L;
 
 constexpr auto FASTFIND_REGISTRY_LOCATIONS = 0L;
 constexpr auto FASTFIND_REGISTRY_KNOWNLOCATIONS = 1L;
 constexpr auto FASTFIND_REGISTRY_HIVE = 2L;
 
+constexpr auto FASTFIND_PROCESS_YARA = 0L;
+constexpr auto FASTFIND_PROCESS_WORKERS = 1L;
+
 constexpr auto FASTFIND_VERSION = 0L;
 constexpr auto FASTFIND_LOGGING = 1L;
 constexpr auto FASTFIND_LOG = 2L;
@@ -54,6 +60,8 @@ constexpr auto FASTFIND_OUTPUT_REGISTRY = 8L;
 constexpr auto FASTFIND_OUTPUT_OBJECT = 9L;
 constexpr auto FASTFIND_OUTPUT_STRUCTURED = 10L;
 
+constexpr auto FASTFIND_PROCESS = 11L;
+
 constexpr auto FASTFIND_FASTFIND = 0L;
 
 namespace Orc::Config::FastFind {
@@ -62,6 +70,7 @@ HRESULT object(ConfigItem& parent, DWORD dwIndex);
 HRESULT service(ConfigItem& parent, DWORD dwIndex);
 HRESULT registry(ConfigItem& parent, DWORD dwIndex);
 HRESULT filesystem(ConfigItem& parent, DWORD dwIndex);
+HRESULT process(ConfigItem& parent, DWORD dwIndex);
 
 HRESULT root(ConfigItem& item);
 
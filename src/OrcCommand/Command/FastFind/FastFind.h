@@ -8,7 +8,9 @@
 
 #include "UtilitiesMain.h"
 
+#include <chrono>
 #include <string>
+#include <utility>
 #include <vector>
 #include <optional>
 
@@ -43,7 +45,8 @@ public:
         , Files(
               true,
               CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1
-                  | CryptoHashStream::Algorithm::SHA256) {};
+                  | CryptoHashStream::Algorithm::SHA256,
+              false) {};
 
     LocationSet Locations;
     FileFind Files;
@@ -229,6 +232,17 @@ public:
     std::vector<ObjectItem> Items;
 };
 
+// Yara scan of the memory of the running processes
+class ProcessSpec
+{
+public:
+    bool bScan = false;
+    DWORD dwWorkers = 0L;  // 0: one worker per processor
+
+    // Rules of the file system search when the section has no yara configuration of its own
+    std::unique_ptr<YaraConfig> Yara;
+};
+
 const wchar_t kToolName[] = L"FastFind";
 
 class ORCUTILS_API Main : public UtilitiesMain
@@ -254,9 +268,21 @@ public:
 
         ResurrectRecordsMode resurrectRecordsMode = ResurrectRecordsMode::kNo;
 
+        // MFT walker pipeline: 0 worker keeps the single threaded walk
+        DWORD dwWalkerWorkers = 0L;
+        bool bWalkerOutOfOrder = false;
+
+        // Name and path only searches read the $FILE_NAME attributes in place instead of walking the records
+        bool bNameScan = false;
+
+        // Matches are pushed to the console and the outputs within 'streamInterval' of being found
+        bool bStream = false;
+        std::chrono::milliseconds streamInterval = std::chrono::milliseconds(500);
+
         FileSystemSpec FileSystem;
         RegistrySpec Registry;
         ObjectSpec Object;
+        ProcessSpec Process;
 
         std::wstring YaraSource;
         std::unique_ptr<YaraConfig> Yara;
@@ -292,9 +318,29 @@ private:
         const FileDirectory::FileInstance& file,
         LPCWSTR szElement = nullptr);
 
-    HRESULT RunFileSystem();
-    HRESULT RunRegistry();
-    HRESULT RunObject();
+    // Objects and files of the object and file directories with the specs they match, in the order they are written
+    struct ObjectMatches
+    {
+        std::vector<ObjectDirectory::ObjectInstance> Objects;
+        std::vector<FileDirectory::FileInstance> Files;
+
+        std::vector<std::pair<const ObjectSpec::ObjectItem*, size_t>> MatchingObjects;
+        std::vector<std::pair<const ObjectSpec::ObjectItem*, size_t>> MatchingFiles;
+    };
+
+    // Registry hives searched while the volumes are walked
+    class HiveSearches;
+
+    // Writes of the matches, flushed periodically in streaming mode
+    class MatchStream;
+
+    // With 'bFindRegistryHives' the registry hives are found during the walks of the file system search
+    HRESULT RunFileSystem(bool bFindRegistryHives, HiveSearches& hiveSearches, MatchStream& matchStream);
+    HRESULT FindRegistryHives(HiveSearches& hiveSearches);
+    HRESULT RunRegistry(HiveSearches& hiveSearches);
+    ObjectMatches FindObjects() const;
+    HRESULT RunObject(const ObjectMatches& matches);
+    HRESULT RunProcess();
 
     HRESULT RegFlushKeys();
 
@@ -201,6 +201,31 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
                 config.resurrectRecordsMode = *rv;
             }
         }
+
+        if (filesystem[FASTFIND_FILESYSTEM_WORKERS])
+        {
+            if (auto hrWorkers =
+                    GetIntegerFromArg(filesystem[FASTFIND_FILESYSTEM_WORKERS].c_str(), config.dwWalkerWorkers);
+                FAILED(hrWorkers))
+            {
+                Log::Error(
+                    L"Failed to parse 'workers' attribute (value: {}) [{}]",
+                    filesystem[FASTFIND_FILESYSTEM_WORKERS],
+                    SystemError(hrWorkers));
+            }
+        }
+
+        if (filesystem[FASTFIND_FILESYSTEM_OUT_OF_ORDER])
+        {
+            config.bWalkerOutOfOrder =
+                equalCaseInsensitive((const std::wstring&)filesystem[FASTFIND_FILESYSTEM_OUT_OF_ORDER], L"yes");
+        }
+
+        if (filesystem[FASTFIND_FILESYSTEM_NAME_SCAN])
+        {
+            config.bNameScan =
+                equalCaseInsensitive((const std::wstring&)filesystem[FASTFIND_FILESYSTEM_NAME_SCAN], L"yes");
+        }
     }
 
     if (configitem[FASTFIND_REGISTRY])
@@ -322,6 +347,36 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
         }
     }
 
+    if (configitem[FASTFIND_PROCESS])
+    {
+        const ConfigItem& process = configitem[FASTFIND_PROCESS];
+        config.Process.bScan = true;
+
+        if (process[FASTFIND_PROCESS_YARA])
+        {
+            auto yaraConfig = YaraConfig::Get(process[FASTFIND_PROCESS_YARA]);
+            if (!yaraConfig)
+            {
+                Log::Error(L"Failed to parse process Yara configuration [{}]", yaraConfig.error());
+                return ToHRESULT(yaraConfig.error());
+            }
+
+            config.Process.Yara = std::make_unique<YaraConfig>(std::move(*yaraConfig));
+        }
+
+        if (process[FASTFIND_PROCESS_WORKERS])
+        {
+            if (auto hrWorkers = GetIntegerFromArg(process[FASTFIND_PROCESS_WORKERS].c_str(), config.Process.dwWorkers);
+                FAILED(hrWorkers))
+            {
+                Log::Error(
+                    L"Failed to parse process 'workers' attribute (value: {}) [{}]",
+                    process[FASTFIND_PROCESS_WORKERS],
+                    SystemError(hrWorkers));
+            }
+        }
+    }
+
     return S_OK;
 }
 
@@ -346,6 +401,20 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                 }
                 else if (ResurrectRecordsOption(argv[i] + 1, L"ResurrectRecords", config.resurrectRecordsMode))
                     ;
+                else if (ParameterOption(argv[i] + 1, L"Workers", config.dwWalkerWorkers))
+                    ;
+                else if (BooleanOption(argv[i] + 1, L"OutOfOrder", config.bWalkerOutOfOrder))
+                    ;
+                else if (BooleanOption(argv[i] + 1, L"NameScan", config.bNameScan))
+                    ;
+                else if (BooleanOption(argv[i] + 1, L"Stream", config.bStream))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"StreamInterval", config.streamInterval))
+                {
+                    config.bStream = true;
+                }
+                else if (BooleanOption(argv[i] + 1, L"Processes", config.Process.bScan))
+                    ;
                 else if (ShadowsOption(
                              argv[i] + 1, L"Shadows", config.FileSystem.bAddShadows, config.FileSystem.m_shadows))
                 {
@@ -494,6 +563,22 @@ HRESULT Main::CheckConfiguration()
         return hr;
     }
 
+    if (config.Process.bScan)
+    {
+        const auto& yara = config.Process.Yara ? config.Process.Yara : config.Yara;
+        if (!yara || yara->Sources().empty())
+        {
+            Log::Error(L"No yara rules to scan the memory of the processes");
+            return E_INVALIDARG;
+        }
+    }
+
+    if (config.bStream && config.streamInterval.count() <= 0)
+    {
+        Log::Error(L"Invalid streaming interval");
+        return E_INVALIDARG;
+    }
+
     if (!bSomeThingToParse)
     {
         for (const auto& loc : config.FileSystem.Locations.GetAltitudeLocations())
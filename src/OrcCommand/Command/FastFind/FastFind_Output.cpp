@@ -40,7 +40,16 @@ void Main::PrintUsage()
             "/Names=<Name>", "Add additional names to search terms (Kernel32.dll,nt*.sys,:ADSName,*.txt#EAName)"},
         Usage::Parameter {"/Version=<Description>", "Add a custom version description to the output"},
         Usage::Parameter {"/SkipDeleted", "Do not attempt to match against deleted records"},
-        Usage::Parameter {"/Yara", "Add rules files for Yara scan"}};
+        Usage::Parameter {
+            "/NameScan",
+            "With only name and path criteria, only read file names from the MFT (no data size, hash nor $I30 entries)"},
+        Usage::Parameter {
+            "/Stream",
+            "Write the matches to the console and the outputs as they are found, flushed every 500 ms (row based table "
+            "outputs only: parquet and orc files are written at the end)"},
+        Usage::Parameter {"/StreamInterval=<Milliseconds>", "Flush interval of /Stream"},
+        Usage::Parameter {"/Yara", "Add rules files for Yara scan"},
+        Usage::Parameter {"/Processes", "Also scan the memory of the running processes with the Yara rules"}};
 
     Usage::PrintParameters(usageNode, "PARAMETERS", kSpecificParameters);
 
@@ -55,7 +64,10 @@ void Main::PrintUsage()
 
     Usage::PrintLoggingParameters(usageNode);
 
-    constexpr std::array kCustomMiscParameters = {Usage::kMiscParameterCompression};
+    constexpr std::array kCustomMiscParameters = {
+        Usage::kMiscParameterCompression,
+        Usage::kMiscParameterWalkerWorkers,
+        Usage::kMiscParameterWalkerOutOfOrder};
     Usage::PrintMiscellaneousParameters(usageNode, kCustomMiscParameters);
 }
 
@@ -77,6 +89,27 @@ void Main::PrintParameters()
     PrintValue(node, L"Structured", config.outStructured);
     PrintValue(node, L"Statistics", config.outStatistics);
 
+    if (config.dwWalkerWorkers > 0)
+    {
+        PrintValue(node, L"Walker workers", config.dwWalkerWorkers);
+        PrintValue(node, L"Walker out of order", config.bWalkerOutOfOrder);
+    }
+
+    if (config.bNameScan)
+    {
+        PrintValue(node, L"Name scan", config.bNameScan);
+    }
+
+    if (config.bStream)
+    {
+        PrintValue(node, L"Streaming interval", fmt::format(L"{} ms", config.streamInterval.count()));
+    }
+
+    if (config.Process.bScan)
+    {
+        PrintValue(node, L"Process memory scan", config.Process.bScan);
+    }
+
     m_console.PrintNewLine();
 }
 
@@ -8,7 +8,13 @@
 
 #include "stdafx.h"
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
 #include <string>
+#include <thread>
 
 #include "OrcLib.h"
 
@@ -26,12 +32,16 @@
 #include "CryptoHashStream.h"
 
 #include "SnapshotVolumeReader.h"
+#include "YaraScanner.h"
+#include "ProcessMemoryScanner.h"
 
 #include "CaseInsensitive.h"
 
 #include <boost/scope_exit.hpp>
+#include <boost/algorithm/string/join.hpp>
 #include <fmt/chrono.h>
 #include "Text/Fmt/Result.h"
+#include "Text/Iconv.h"
 
 using namespace std;
 
@@ -40,8 +50,32 @@ using namespace Orc::Command::FastFind;
 
 namespace {
 
-void PrintStatistics(Orc::Text::Tree& root, const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms)
+void PrintYaraStatistics(Orc::Text::Tree& root, const std::vector<YaraRuleProfile>& yaraRules)
 {
+    if (yaraRules.empty())
+    {
+        return;
+    }
+
+    auto statsNode = root.AddNode(L"Slowest yara rules:");
+    statsNode.AddEmptyLine();
+
+    for (const auto& rule : yaraRules)
+    {
+        statsNode.Add(
+            "{}: {}{}",
+            rule.Rule,
+            std::chrono::duration_cast<std::chrono::milliseconds>(rule.Time),
+            rule.Disabled ? " (disabled: over budget)" : "");
+    }
+
+    statsNode.AddEmptyLine();
+}
+
+void PrintStatistics(Orc::Text::Tree& root, const FileFind& fileFind)
+{
+    const auto& searchTerms = fileFind.AllSearchTerms();
+
     auto statsNode = root.AddNode(L"Statistics for 'ntfs_find' rules:");
     statsNode.AddEmptyLine();
 
@@ -73,6 +107,27 @@ void PrintStatistics(Orc::Text::Tree& root, const std::vector<std::shared_ptr<Fi
 
         ruleNode.AddEmptyLine();
     }
+
+    PrintYaraStatistics(root, fileFind.SlowestYaraRules());
+}
+
+void WriteYaraStatistics(
+    const std::vector<YaraRuleProfile>& yaraRules,
+    Orc::StructuredOutputWriter::IWriter::Ptr& writer)
+{
+    const auto kNodeRules = L"yara_rules";
+    writer->BeginCollection(kNodeRules);
+    Guard::Scope onExit([&]() { writer->EndCollection(kNodeRules); });
+
+    for (const auto& rule : yaraRules)
+    {
+        writer->BeginElement(nullptr);
+        Guard::Scope onExit([&]() { writer->EndElement(nullptr); });
+
+        writer->WriteNamed(L"rule", std::string_view(rule.Rule));
+        writer->WriteNamed(L"time", std::chrono::duration_cast<std::chrono::milliseconds>(rule.Time).count());
+        writer->WriteNamed(L"disabled", rule.Disabled);
+    }
 }
 
 void WriteNtfsFindStatistics(
@@ -98,9 +153,7 @@ void WriteNtfsFindStatistics(
     }
 }
 
-Orc::Result<void> WriteStatistics(
-    const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms,
-    Orc::StructuredOutputWriter::IWriter::Ptr& writer)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, Orc::StructuredOutputWriter::IWriter::Ptr& writer)
 {
     try
     {
@@ -120,7 +173,8 @@ Orc::Result<void> WriteStatistics(
                 writer->BeginElement(kNodeStats);
                 Guard::Scope onExit([&]() { writer->EndElement(kNodeStats); });
 
-                WriteNtfsFindStatistics(searchTerms, writer);
+                WriteNtfsFindStatistics(fileFind.AllSearchTerms(), writer);
+                WriteYaraStatistics(fileFind.SlowestYaraRules(), writer);
             }
         }
     }
@@ -144,8 +198,7 @@ Orc::Result<void> WriteStatistics(
     return Orc::Success<void>();
 }
 
-Orc::Result<void>
-WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms, const OutputSpec& output)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, const OutputSpec& output)
 {
     auto options = std::make_unique<StructuredOutput::JSON::Options>();
     options->Encoding = OutputSpec::Encoding::UTF8;
@@ -164,7 +217,7 @@ WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& search
         return SystemError(E_FAIL);
     }
 
-    auto rv = WriteStatistics(searchTerms, writer);
+    auto rv = WriteStatistics(fileFind, writer);
     if (rv.has_error())
     {
         Log::Error(L"Failed to write statistics file [{}]", rv);
@@ -182,14 +235,12 @@ WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& search
     return Orc::Success<void>();
 }
 
-Orc::Result<void> WriteStatistics(
-    const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms,
-    const std::filesystem::path& path)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, const std::filesystem::path& path)
 {
     OutputSpec output;
     output.Type = OutputSpec::Kind::JSON;
     output.Path = path;
-    return WriteStatistics(searchTerms, output);
+    return WriteStatistics(fileFind, output);
 }
 
 void PrintFoundFile(
@@ -217,13 +268,284 @@ void PrintFoundValue(Orc::Text::Tree& root, const std::string& key, const std::s
     root.Add(L"{:<24} {} ({})", L"Found registry value:", key, value);
 }
 
+void PrintHiveMatches(Orc::Text::Tree& root, const RegFind::Match& match)
+{
+    for (const auto& key : match.MatchingKeys)
+    {
+        ::PrintFoundKey(root, key.KeyName);
+    }
+
+    for (const auto& value : match.MatchingValues)
+    {
+        ::PrintFoundValue(root, value.ValueName, value.KeyName);
+    }
+}
+
+void LogRegistryHiveMatch(const std::shared_ptr<FileFind::Match>& aFileMatch, bool& bStop)
+{
+    Log::Debug(
+        L"Hive '{}' matches '{}'", aFileMatch->MatchingNames.front().FullPathName, aFileMatch->Term->GetDescription());
+}
+
 void PrintFoundWindowsObject(Orc::Text::Tree& root, const std::wstring& name, const std::wstring& description)
 {
     root.Add(L"{:>24} {} ({})", L"Found windows object:", name, description);
 }
 
+void PrintFoundProcessMemory(Orc::Text::Tree& root, const ProcessMemoryScanner::Match& match, const std::wstring& rules)
+{
+    root.Add(
+        L"{:<24} {} (pid: {}, address: {:#x}, size: {}) [{}]",
+        L"Found process memory:",
+        match.Image,
+        match.Pid,
+        match.BaseAddress,
+        match.RegionSize,
+        rules);
+}
+
+LPCWSTR MemoryTypeToString(DWORD dwMemoryType)
+{
+    switch (dwMemoryType)
+    {
+        case MEM_IMAGE:
+            return L"image";
+        case MEM_MAPPED:
+            return L"mapped";
+        case MEM_PRIVATE:
+            return L"private";
+        default:
+            return L"unknown";
+    }
+}
+
 }  // namespace
 
+// Registry hives found by the walks are searched by a worker thread while the walks go on. Their matches are written
+// once the walks are over, in the order the hives were found: the output is the one of a sequential search.
+class Main::HiveSearches
+{
+public:
+    struct Search
+    {
+        HRESULT hr = S_OK;
+        RegFind::MatchesMap Matches;
+    };
+
+    struct Hive
+    {
+        std::shared_ptr<FileFind::Match> Match;
+        std::vector<Search> Searches;  // one per RegFind for each matching attribute
+    };
+
+    // 'onSearched' is called by the worker thread after each hive is searched
+    HiveSearches(const std::vector<RegFind>& regFinds, std::function<void(const Hive&)> onSearched = nullptr)
+        : m_regFinds(regFinds)
+        , m_onSearched(std::move(onSearched))
+        , m_worker([this]() { Work(); })
+    {
+    }
+
+    HiveSearches(const HiveSearches&) = delete;
+    HiveSearches& operator=(const HiveSearches&) = delete;
+
+    ~HiveSearches() { Stop(); }
+
+    void Submit(const std::shared_ptr<FileFind::Match>& aMatch)
+    {
+        auto hive = std::make_shared<Hive>();
+        hive->Match = aMatch;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_hives.push_back(hive);
+            m_pending.push_back(std::move(hive));
+        }
+
+        m_submitted.notify_one();
+    }
+
+    // Wait for the searches of the hives submitted, returned in the order they were submitted
+    const std::vector<std::shared_ptr<Hive>>& Wait()
+    {
+        Stop();
+        return m_hives;
+    }
+
+private:
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStopped = true;
+        }
+
+        m_submitted.notify_one();
+        if (m_worker.joinable())
+            m_worker.join();
+    }
+
+    void Work()
+    {
+        for (;;)
+        {
+            std::shared_ptr<Hive> hive;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_submitted.wait(lock, [this]() { return m_bStopped || !m_pending.empty(); });
+                if (m_pending.empty())
+                    return;
+
+                hive = std::move(m_pending.front());
+                m_pending.pop_front();
+            }
+
+            SearchHive(*hive);
+
+            if (m_onSearched)
+                m_onSearched(*hive);
+        }
+    }
+
+    void SearchHive(Hive& hive) const
+    {
+        Log::Debug(L"Parsing registry hive '{}'", hive.Match->MatchingNames.front().FullPathName);
+
+        for (const auto& data : hive.Match->MatchingAttributes)
+        {
+            for (const auto& regFind : m_regFinds)
+            {
+                Search search;
+
+                try
+                {
+                    data.DataStream->SetFilePointer(0LL, FILE_BEGIN, NULL);
+                    search.hr = regFind.Find(data.DataStream, search.Matches, nullptr, nullptr);
+                }
+                catch (const std::exception& e)
+                {
+                    Log::Error("Exception while parsing registry hive: {}", e.what());
+                    search.hr = E_UNEXPECTED;
+                }
+
+                hive.Searches.push_back(std::move(search));
+            }
+        }
+    }
+
+    const std::vector<RegFind>& m_regFinds;
+    std::function<void(const Hive&)> m_onSearched;
+
+    std::mutex m_mutex;
+    std::condition_variable m_submitted;
+    std::deque<std::shared_ptr<Hive>> m_pending;
+    std::vector<std::shared_ptr<Hive>> m_hives;
+    bool m_bStopped = false;
+
+    std::thread m_worker;  // last: started once the members above are constructed
+};
+
+// In streaming mode (/Stream) the writes of the matches are serialized with a thread which flushes the console and the
+// outputs at most 'streamInterval' after a match was written: matches show up while the walks go on instead of when
+// the outputs are closed. Columnar table outputs (parquet, orc) are only readable once closed and are not flushed.
+class Main::MatchStream
+{
+public:
+    MatchStream(Main& main)
+        : m_main(main)
+    {
+        if (m_main.config.bStream)
+            m_flusher = std::thread([this]() { Work(); });
+    }
+
+    MatchStream(const MatchStream&) = delete;
+    MatchStream& operator=(const MatchStream&) = delete;
+
+    ~MatchStream() { Stop(); }
+
+    template <typename Fn>
+    void Write(Fn&& fn)
+    {
+        if (!m_main.config.bStream)
+        {
+            fn();
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fn();
+        m_bPending = true;
+    }
+
+    // Flush what is pending and stop flushing, before the outputs are closed
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bStopped = true;
+        }
+
+        m_stopped.notify_one();
+        if (m_flusher.joinable())
+            m_flusher.join();
+    }
+
+private:
+    static bool IsRowOriented(const OutputSpec& output)
+    {
+        return HasAnyFlag(output.Type, OutputSpec::Kind::CSV | OutputSpec::Kind::TSV | OutputSpec::Kind::JSONL);
+    }
+
+    void Work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        for (bool bStopped = false; !bStopped;)
+        {
+            bStopped = m_stopped.wait_for(lock, m_main.config.streamInterval, [this]() { return m_bStopped; });
+            if (!m_bPending)
+                continue;
+
+            Flush();
+            m_bPending = false;
+        }
+    }
+
+    void Flush()
+    {
+        m_main.m_console.Flush();
+
+        if (m_main.pStructuredOutput != nullptr)
+        {
+            if (auto hr = m_main.pStructuredOutput->Flush(); FAILED(hr))
+                Log::Debug(L"Failed to flush structured output [{}]", SystemError(hr));
+        }
+
+        const std::pair<const OutputSpec&, const std::shared_ptr<ITableWriter>&> tables[] = {
+            {m_main.config.outFileSystem, m_main.pFileSystemTableOutput},
+            {m_main.config.outObject, m_main.pObjectTableOutput}};
+
+        for (const auto& [output, writer] : tables)
+        {
+            if (writer == nullptr || !IsRowOriented(output))
+                continue;
+
+            if (auto hr = writer->Flush(); FAILED(hr))
+                Log::Debug(L"Failed to flush table output '{}' [{}]", output.Path, SystemError(hr));
+        }
+    }
+
+    Main& m_main;
+
+    std::mutex m_mutex;
+    std::condition_variable m_stopped;
+    bool m_bPending = false;
+    bool m_bStopped = false;
+
+    std::thread m_flusher;
+};
+
 HRESULT Main::RegFlushKeys()
 {
     bool bSuccess = true;
@@ -244,7 +566,7 @@ HRESULT Main::RegFlushKeys()
     return S_OK;
 }
 
-HRESULT Main::RunFileSystem()
+HRESULT Main::RunFileSystem(bool bFindRegistryHives, HiveSearches& hiveSearches, MatchStream& matchStream)
 {
     HRESULT hr = E_FAIL;
 
@@ -254,11 +576,13 @@ HRESULT Main::RunFileSystem()
         pStructuredOutput->BeginElement(nullptr);
     }
 
-    hr = config.FileSystem.Files.Find(
-        config.FileSystem.Locations,
-        [this](const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop) {
-            const auto strMatchDescr = aMatch->GetMatchDescription();
+    config.FileSystem.Files.SetMFTWalkerPipeline(config.dwWalkerWorkers, config.bWalkerOutOfOrder);
+    config.FileSystem.Files.SetNameScan(config.bNameScan);
+
+    auto onFileSystemMatch = [this, &matchStream](const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop) {
+        const auto strMatchDescr = aMatch->GetMatchDescription();
 
+        matchStream.Write([&]() {
             bool bDeleted = aMatch->DeletedRecord;
             std::for_each(
                 begin(aMatch->MatchingNames),
@@ -275,11 +599,28 @@ HRESULT Main::RunFileSystem()
                 aMatch->Write(*pStructuredOutput, nullptr);
                 pStructuredOutput->EndCollection(L"filefind_match");
             }
+        });
 
-            return;
-        },
-        true,
-        config.resurrectRecordsMode);
+        return;
+    };
+
+    std::vector<FileFind::SharedSearch> searches;
+    searches.push_back({&config.FileSystem.Files, &config.FileSystem.Locations, onFileSystemMatch, true});
+
+    if (bFindRegistryHives)
+    {
+        RegFlushKeys();
+        searches.push_back(
+            {&config.Registry.Files,
+             &config.Registry.Locations,
+             [&hiveSearches](const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop) {
+                 ::LogRegistryHiveMatch(aMatch, bStop);
+                 hiveSearches.Submit(aMatch);
+             },
+             false});
+    }
+
+    hr = FileFind::Find(searches, config.resurrectRecordsMode);
 
     if (FAILED(hr))
     {
@@ -294,9 +635,9 @@ HRESULT Main::RunFileSystem()
     }
 
     m_console.PrintNewLine();
-    ::PrintStatistics(m_console.OutputTree(), config.FileSystem.Files.AllSearchTerms());
+    ::PrintStatistics(m_console.OutputTree(), config.FileSystem.Files);
 
-    auto rv = ::WriteStatistics(config.FileSystem.Files.AllSearchTerms(), config.outStatistics.Path);
+    auto rv = ::WriteStatistics(config.FileSystem.Files, config.outStatistics.Path);
     if (rv.has_error())
     {
         Log::Error(L"Failed to write statistics file [{}]", rv);
@@ -305,7 +646,7 @@ HRESULT Main::RunFileSystem()
     return S_OK;
 }
 
-HRESULT Main::RunRegistry()
+HRESULT Main::FindRegistryHives(HiveSearches& hiveSearches)
 {
     HRESULT hr = E_FAIL;
 
@@ -313,11 +654,9 @@ HRESULT Main::RunRegistry()
 
     hr = config.Registry.Files.Find(
         config.Registry.Locations,
-        [this](const std::shared_ptr<FileFind::Match>& aFileMatch, bool& bStop) {
-            Log::Debug(
-                L"Hive '{}' matches '{}'",
-                aFileMatch->MatchingNames.front().FullPathName,
-                aFileMatch->Term->GetDescription());
+        [&hiveSearches](const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop) {
+            ::LogRegistryHiveMatch(aMatch, bStop);
+            hiveSearches.Submit(aMatch);
         },
         false,
         ResurrectRecordsMode::kNo);
@@ -326,15 +665,20 @@ HRESULT Main::RunRegistry()
         Log::Error(L"Failed to parse location while searching for registry hives");
     }
 
+    return hr;
+}
+
+HRESULT Main::RunRegistry(HiveSearches& hiveSearches)
+{
     if (pStructuredOutput)
     {
         pStructuredOutput->BeginCollection(L"registry");
         pStructuredOutput->BeginElement(nullptr);
     }
 
-    for (const auto& aFileMatch : config.Registry.Files.Matches())
+    for (const auto& hive : hiveSearches.Wait())
     {
-        Log::Debug(L"Parsing registry hive '{}'", aFileMatch->MatchingNames.front().FullPathName);
+        const auto& aFileMatch = hive->Match;
 
         if (pStructuredOutput)
         {
@@ -355,42 +699,30 @@ HRESULT Main::RunRegistry()
             pStructuredOutput->WriteNamed(L"hive_path", aFileMatch->MatchingNames.front().FullPathName.c_str());
         }
 
-        for (const auto& data : aFileMatch->MatchingAttributes)
+        for (const auto& search : hive->Searches)
         {
-            for (auto& aregfind : config.Registry.RegistryFind)
+            if (FAILED(search.hr))
             {
-                data.DataStream->SetFilePointer(0LL, FILE_BEGIN, NULL);
+                Log::Error(
+                    L"Failed while parsing registry hive '{}' [{}]",
+                    aFileMatch->MatchingNames.front().FullPathName,
+                    SystemError(search.hr));
+            }
+            else
+            {
+                Log::Debug(L"Successfully parsed hive '{}'", aFileMatch->MatchingNames.front().FullPathName);
+                // write matching elements
 
-                if (FAILED(hr = aregfind.Find(data.DataStream, nullptr, nullptr)))
-                {
-                    Log::Error(
-                        L"Failed while parsing registry hive '{}' [{}]",
-                        aFileMatch->MatchingNames.front().FullPathName,
-                        SystemError(hr));
-                }
-                else
+                for (const auto& elt : search.Matches)
                 {
-                    Log::Debug(L"Successfully parsed hive '{}'", aFileMatch->MatchingNames.front().FullPathName);
-                    // write matching elements
-
-                    auto& Results = aregfind.Matches();
-
-                    for (const auto& elt : Results)
+                    // In streaming mode, the matches were printed as soon as the hive was searched
+                    if (!config.bStream)
                     {
-                        // write matching keys
-                        for (const auto& key : elt.second->MatchingKeys)
-                        {
-                            ::PrintFoundKey(m_console.OutputTree(), key.KeyName);
-                        }
-
-                        for (const auto& value : elt.second->MatchingValues)
-                        {
-                            ::PrintFoundValue(m_console.OutputTree(), value.ValueName, value.KeyName);
-                        }
-
-                        if (pStructuredOutput)
-                            elt.second->Write(*pStructuredOutput);
+                        ::PrintHiveMatches(m_console.OutputTree(), *elt.second);
                     }
+
+                    if (pStructuredOutput)
+                        elt.second->Write(*pStructuredOutput);
                 }
             }
         }
@@ -454,15 +786,10 @@ Main::LogObjectMatch(const ObjectSpec::ObjectItem& spec, const FileDirectory::Fi
     return S_OK;
 }
 
-HRESULT Main::RunObject()
+Main::ObjectMatches Main::FindObjects() const
 {
     HRESULT hr = E_FAIL;
-
-    if (pStructuredOutput)
-    {
-        pStructuredOutput->BeginCollection(L"object");
-        pStructuredOutput->BeginElement(nullptr);
-    }
+    ObjectMatches matches;
 
     for (const auto& objdir : ObjectDirs)
     {
@@ -475,8 +802,9 @@ HRESULT Main::RunObject()
         }
         else
         {
-            for (const auto& object : objects)
+            for (size_t i = 0; i < objects.size(); i++)
             {
+                const auto& object = objects[i];
                 for (const auto& spec : config.Object.Items)
                 {
                     if (spec.ObjType != ObjectDirectory::Invalid && spec.ObjType != object.Type)
@@ -535,10 +863,11 @@ HRESULT Main::RunObject()
                     }
 
                     // Dropping here means no previous test rejected the object
-                    ::PrintFoundWindowsObject(m_console.OutputTree(), object.Path, spec.Description());
-                    LogObjectMatch(spec, object, nullptr);
+                    matches.MatchingObjects.emplace_back(&spec, matches.Objects.size() + i);
                 }
             }
+
+            std::move(std::begin(objects), std::end(objects), std::back_inserter(matches.Objects));
         }
     }
 
@@ -553,8 +882,9 @@ HRESULT Main::RunObject()
         }
         else
         {
-            for (const auto& file : files)
+            for (size_t i = 0; i < files.size(); i++)
             {
+                const auto& file = files[i];
                 for (const auto& spec : config.Object.Items)
                 {
                     if (spec.ObjType != ObjectDirectory::File)
@@ -613,12 +943,37 @@ HRESULT Main::RunObject()
                     }
 
                     // Dropping here means no previous test rejected the object
-                    LogObjectMatch(spec, file, nullptr);
+                    matches.MatchingFiles.emplace_back(&spec, matches.Files.size() + i);
                 }
             }
+
+            std::move(std::begin(files), std::end(files), std::back_inserter(matches.Files));
         }
     }
 
+    return matches;
+}
+
+HRESULT Main::RunObject(const ObjectMatches& matches)
+{
+    if (pStructuredOutput)
+    {
+        pStructuredOutput->BeginCollection(L"object");
+        pStructuredOutput->BeginElement(nullptr);
+    }
+
+    for (const auto& [spec, index] : matches.MatchingObjects)
+    {
+        const auto& object = matches.Objects[index];
+        ::PrintFoundWindowsObject(m_console.OutputTree(), object.Path, spec->Description());
+        LogObjectMatch(*spec, object, nullptr);
+    }
+
+    for (const auto& [spec, index] : matches.MatchingFiles)
+    {
+        LogObjectMatch(*spec, matches.Files[index], nullptr);
+    }
+
     if (pStructuredOutput)
     {
         pStructuredOutput->EndElement(nullptr);
@@ -628,6 +983,97 @@ HRESULT Main::RunObject()
     return S_OK;
 }
 
+HRESULT Main::RunProcess()
+{
+    HRESULT hr = E_FAIL;
+
+    if (!config.Process.bScan)
+        return S_OK;
+
+    auto& yaraConfig = config.Process.Yara ? config.Process.Yara : config.Yara;
+
+    // The rules are compiled once and shared by the scanners of the workers
+    YaraScanner yara;
+    if (FAILED(hr = yara.Initialize()))
+    {
+        Log::Error(L"Failed to initialize yara for the process memory scan [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = yara.Configure(yaraConfig)))
+    {
+        Log::Error(L"Failed to configure yara for the process memory scan [{}]", SystemError(hr));
+        return hr;
+    }
+
+    for (const auto& source : yaraConfig->Sources())
+    {
+        if (FAILED(hr = yara.AddRules(source)))
+        {
+            Log::Error(L"Failed to load yara rules from source: {} [{}]", source, SystemError(hr));
+            return hr;
+        }
+    }
+
+    if (FAILED(hr = yara.CompileRules()))
+    {
+        Log::Error(L"Failed to compile yara rules for the process memory scan [{}]", SystemError(hr));
+        return hr;
+    }
+
+    ProcessMemoryScanner scanner(yara, config.Process.dwWorkers);
+
+    std::vector<ProcessMemoryScanner::Match> matches;
+    if (FAILED(hr = scanner.Scan({}, matches)))
+    {
+        Log::Error(L"Failed to scan the memory of the processes [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (pStructuredOutput)
+    {
+        pStructuredOutput->BeginCollection(L"process");
+        pStructuredOutput->BeginElement(nullptr);
+    }
+
+    for (const auto& match : matches)
+    {
+        const auto rules = boost::join(match.MatchingRules, ", ");
+
+        std::error_code ec;
+        ::PrintFoundProcessMemory(m_console.OutputTree(), match, ToUtf16(rules, ec));
+
+        if (pStructuredOutput)
+        {
+            pStructuredOutput->BeginElement(L"process_match");
+            pStructuredOutput->WriteNamed(L"pid", static_cast<uint32_t>(match.Pid));
+            pStructuredOutput->WriteNamed(L"image", match.Image);
+            pStructuredOutput->WriteNamed(L"base_address", static_cast<uint64_t>(match.BaseAddress), true);
+            pStructuredOutput->WriteNamed(L"region_size", static_cast<uint64_t>(match.RegionSize));
+            pStructuredOutput->WriteNamed(L"protect", static_cast<uint32_t>(match.Protect), true);
+            pStructuredOutput->WriteNamed(L"type", ::MemoryTypeToString(match.Type));
+            pStructuredOutput->WriteNamed(L"yara_rules", std::string_view(rules));
+            pStructuredOutput->EndElement(L"process_match");
+        }
+    }
+
+    if (pStructuredOutput)
+    {
+        pStructuredOutput->EndElement(nullptr);
+        pStructuredOutput->EndCollection(L"process");
+    }
+
+    const auto& statistics = scanner.GetStatistics();
+    Log::Info(
+        L"Scanned the memory of {} processes ({} denied): {} regions, {} bytes",
+        statistics.Processes,
+        statistics.Denied,
+        statistics.Regions,
+        statistics.ScannedBytes);
+
+    return S_OK;
+}
+
 #include "StructuredOutputWriter.h"
 
 HRESULT Main::Run()
@@ -675,9 +1121,36 @@ HRESULT Main::Run()
             pStructuredOutput->WriteNamed(L"role", strSystemRole.c_str());
     }
 
-    RunFileSystem();
-    RunRegistry();
-    RunObject();
+    // Registry hives are found during the file system walks when both searches walk the volumes the same way
+    const bool bSharedWalk = config.resurrectRecordsMode == ResurrectRecordsMode::kNo;
+
+    // Hives and object directories are searched while the volumes are walked, matches are written afterwards
+    MatchStream matchStream(*this);
+    auto objectSearch = std::async(std::launch::async, [this]() { return FindObjects(); });
+    HiveSearches hiveSearches(config.Registry.RegistryFind, [this, &matchStream](const HiveSearches::Hive& hive) {
+        if (!config.bStream)
+            return;
+
+        matchStream.Write([&]() {
+            for (const auto& search : hive.Searches)
+            {
+                for (const auto& elt : search.Matches)
+                    ::PrintHiveMatches(m_console.OutputTree(), *elt.second);
+            }
+        });
+    });
+
+    RunFileSystem(bSharedWalk, hiveSearches, matchStream);
+    if (!bSharedWalk)
+        FindRegistryHives(hiveSearches);
+
+    // Remaining matches are written by this thread only
+    hiveSearches.Wait();
+    matchStream.Stop();
+
+    RunRegistry(hiveSearches);
+    RunObject(objectSearch.get());
+    RunProcess();
 
     if (pStructuredOutput != nullptr)
         pStructuredOutput->EndElement(L"fast_find");
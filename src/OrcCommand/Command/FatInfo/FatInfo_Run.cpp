@@ -69,16 +69,18 @@ HRESULT Main::Run()
         return hr;
     }
 
+    const auto columnPlan = FatFileInfo::CompileColumnPlan(FatFileInfo::g_FatColumnNames);
+
     m_FileInfoOutput.ForEachOutput(
-        m_Config.output, [this](const MultipleOutput<LocationOutput>::OutputPair& dir) -> HRESULT {
+        m_Config.output, [this, &columnPlan](const MultipleOutput<LocationOutput>::OutputPair& dir) -> HRESULT {
             auto locationNode = m_console.OutputTree().AddNode("Parsing:");
             Print(locationNode, dir.first.m_pLoc);
 
             FatWalker::Callbacks callBacks;
-            callBacks.m_FileEntryCall = [this, &dir](
-                                            const std::shared_ptr<VolumeReader>& volreader,
-                                            const WCHAR* szFullName,
-                                            const std::shared_ptr<FatFileEntry>& fileEntry) {
+            callBacks.m_FileEntryCall = [this, &dir, &columnPlan](
+                                                         const std::shared_ptr<VolumeReader>& volreader,
+                                                         const WCHAR* szFullName,
+                                                         const std::shared_ptr<FatFileEntry>& fileEntry) {
                 try
                 {
                     FatFileInfo fi(
@@ -91,8 +93,7 @@ HRESULT Main::Run()
                         fileEntry,
                         m_CodeVerifier);
 
-                    HRESULT hr =
-                        fi.WriteFileInformation(FatFileInfo::g_FatColumnNames, *dir.second.Writer(), m_Config.Filters);
+                    HRESULT hr = fi.WriteFileInformation(columnPlan, *dir.second.Writer(), m_Config.Filters);
                     if (FAILED(hr))
                     {
                         Log::Error(L"Could not WriteFileInformation for '{}' [{}]", szFullName, SystemError(hr));
@@ -109,7 +110,7 @@ HRESULT Main::Run()
             };
 
             FatWalker walker;
-            walker.Init(dir.first.m_pLoc, static_cast<bool>(m_Config.bResurrectRecords));
+            walker.Init(dir.first.m_pLoc, static_cast<bool>(m_Config.bResurrectRecords), true);
             walker.Process(callBacks);
 
             return S_OK;
@@ -80,11 +80,17 @@ private:
     HRESULT WriteSampleInformation(const std::vector<std::shared_ptr<SampleItem>>& results);
     HRESULT WriteTimeline(const TaskTracker::TimeLine& timeline);
 
-    HRESULT WriteGetThisConfig(
-        const std::wstring& strConfigFile,
+    HRESULT GetGetThisConfig(
+        ConfigItem& getthisconfig,
         const std::vector<std::shared_ptr<Location>>& locs,
         const std::vector<std::shared_ptr<SampleItem>>& results);
 
+    HRESULT WriteGetThisConfig(const std::wstring& strConfigFile, const ConfigItem& getthisconfig);
+
+    // Collect the samples with a GetThis command run in this process, configured with 'getthisconfig'
+    HRESULT CollectSamples(const ConfigItem& getthisconfig);
+
+    // Collect the samples with a GetThis process (when the configured GetThis is not this binary)
     HRESULT RunGetThis(const std::wstring& strConfigFile, LPCWSTR szTempDir);
 
 public:
@@ -8,6 +8,10 @@
 
 #include "stdafx.h"
 
+#include <future>
+
+#include <boost/scope_exit.hpp>
+
 #include "GetSamples.h"
 
 #include "ParameterCheck.h"
@@ -253,16 +257,13 @@ HRESULT Main::WriteTimeline(const TaskTracker::TimeLine& timeline)
     return S_OK;
 }
 
-HRESULT Main::WriteGetThisConfig(
-    const std::wstring& strConfigFile,
+HRESULT Main::GetGetThisConfig(
+    ConfigItem& getthisconfig,
     const std::vector<std::shared_ptr<Location>>& locs,
     const std::vector<std::shared_ptr<SampleItem>>& results)
 {
     HRESULT hr = E_FAIL;
-    // Collect time line related information
-    m_console.Print(L"Writing GetThis configuration to '{}'...", strConfigFile);
 
-    // Create GetThis config file
     std::vector<std::shared_ptr<SampleItem>> tocollect;
 
     std::copy_if(
@@ -271,7 +272,6 @@ HRESULT Main::WriteGetThisConfig(
         std::back_inserter(tocollect),
         [](const std::shared_ptr<SampleItem>& item) -> bool { return item->Status.Authenticode != SignedVerified; });
 
-    ConfigItem getthisconfig;
     hr = Orc::Config::GetThis::root(getthisconfig);
     if (FAILED(hr))
     {
@@ -349,8 +349,15 @@ HRESULT Main::WriteGetThisConfig(
 
     getthisconfig[GETTHIS_LOCATION].Status = ConfigItem::PRESENT;
     getthisconfig.Status = ConfigItem::PRESENT;
+    return S_OK;
+}
+
+HRESULT Main::WriteGetThisConfig(const std::wstring& strConfigFile, const ConfigItem& getthisconfig)
+{
+    m_console.Print(L"Writing GetThis configuration to '{}'...", strConfigFile);
 
-    hr = config_writer.WriteConfig(
+    ConfigFileWriter config_writer;
+    HRESULT hr = config_writer.WriteConfig(
         strConfigFile.c_str(), L"GetThis configuration file generated by GetSamples", getthisconfig);
     if (FAILED(hr))
     {
@@ -362,6 +369,103 @@ HRESULT Main::WriteGetThisConfig(
     return S_OK;
 }
 
+HRESULT Main::CollectSamples(const ConfigItem& getthisconfig)
+{
+    HRESULT hr = E_FAIL;
+
+    m_console.Print(L"Collecting samples...");
+
+    // The command's logger becomes the default one while it is built and is reset when it is destroyed: GetThis logs
+    // to the logger of GetSamples
+    const auto logger = Log::DefaultLogger();
+    BOOST_SCOPE_EXIT(&logger) { Log::SetDefaultLogger(logger); }
+    BOOST_SCOPE_EXIT_END;
+
+    Command::GetThis::Main getThis;
+    Log::SetDefaultLogger(logger);
+
+    ConfigItem schemaitem;
+    hr = getThis.ReadConfiguration(
+        0,
+        nullptr,
+        L"SqlSchema",
+        Command::GetThis::Main::DefaultSchema(),
+        nullptr,
+        nullptr,
+        schemaitem,
+        Orc::Config::Common::sqlschema);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to read GetThis schema [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = getThis.GetSchemaFromConfig(schemaitem)))
+    {
+        Log::Error(L"Failed to process GetThis schema [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = getThis.GetConfigurationFromConfig(getthisconfig)))
+    {
+        Log::Error(L"Failed to process GetThis configuration [{}]", SystemError(hr));
+        return hr;
+    }
+
+    // Arguments forwarded to GetThis, the first one is the command name
+    std::vector<std::wstring> arguments;
+    {
+        std::wstring argument;
+        bool bQuoted = false;
+        for (const auto c : config.getthisArgs)
+        {
+            if (c == L'"')
+                bQuoted = !bQuoted;
+            else if (c == L' ' && !bQuoted)
+            {
+                if (!argument.empty())
+                    arguments.push_back(std::move(argument));
+                argument.clear();
+            }
+            else
+                argument.push_back(c);
+        }
+
+        if (!argument.empty())
+            arguments.push_back(std::move(argument));
+    }
+
+    std::vector<LPCWSTR> argv;
+    std::transform(
+        std::cbegin(arguments), std::cend(arguments), std::back_inserter(argv), [](const std::wstring& argument) {
+            return argument.c_str();
+        });
+
+    if (FAILED(hr = getThis.GetConfigurationFromArgcArgv(static_cast<int>(argv.size()), argv.data())))
+    {
+        Log::Error(L"Failed to parse GetThis arguments [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = getThis.CheckConfiguration()))
+    {
+        Log::Error(L"Failed to check GetThis configuration [{}]", SystemError(hr));
+        return hr;
+    }
+
+    // CheckConfiguration applied the (empty) log configuration to the command's own logger
+    Log::SetDefaultLogger(logger);
+
+    if (FAILED(hr = getThis.Run()))
+    {
+        Log::Error(L"Failed to collect samples [{}]", SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Collecting samples... Done");
+    return S_OK;
+}
+
 HRESULT Main::RunGetThis(const std::wstring& strConfigFile, LPCWSTR szTempDir)
 {
     HRESULT hr = E_FAIL;
@@ -450,17 +554,22 @@ HRESULT Main::Run()
 
     m_console.Print(L"Loading running processes and modules...");
 
+    // Autoruns data and the running code are loaded in different members of the tracker: they are loaded concurrently,
+    // the timeline is built from both by CoalesceResults
+    auto autoruns =
+        std::async(std::launch::async, [this, &tk]() { return LoadAutoRuns(tk, config.tmpdirOutput.Path.c_str()); });
+
     hr = tk.LoadRunningTasksAndModules();
     if (FAILED(hr))
     {
         Log::Error("Failed to load running Tasks and Modules [{}]", SystemError(hr));
+        autoruns.wait();
         return hr;
     }
 
     Log::Info("Loading running processes and modules... Done");
 
-    // Loading Autoruns data
-    hr = LoadAutoRuns(tk, config.tmpdirOutput.Path.c_str());
+    hr = autoruns.get();
     if (FAILED(hr))
     {
         Log::Error("Failed to load autoruns data [{}]", SystemError(hr));
@@ -516,12 +625,29 @@ HRESULT Main::Run()
         }
     }
 
+    if (config.samplesOutput.Type == OutputSpec::Kind::None && config.getThisConfig.Type == OutputSpec::Kind::None)
+    {
+        return S_OK;
+    }
+
+    ConfigItem getthisconfig;
+    hr = GetGetThisConfig(getthisconfig, tk.GetAltitudeLocations(), results);
+    if (FAILED(hr))
+    {
+        Log::Error("Failed to build getthis configuration [{}]", SystemError(hr));
+        return hr;
+    }
+
+    // GetThis runs in this process unless another binary is configured: its configuration is only written to a file
+    // when it is an output or for that binary
+    const bool bInProcess = EmbeddedResource::IsSelf(config.getthisRef);
+
     std::wstring strConfigFile;
     if (config.getThisConfig.Type == OutputSpec::Kind::File)
     {
         strConfigFile = config.getThisConfig.Path;
     }
-    else
+    else if (config.samplesOutput.Type != OutputSpec::Kind::None && !bInProcess)
     {
         hr = UtilGetTempFile(NULL, config.tmpdirOutput.Path.c_str(), L".xml", strConfigFile, NULL);
         if (FAILED(hr))
@@ -530,9 +656,9 @@ HRESULT Main::Run()
         }
     }
 
-    if (config.samplesOutput.Type != OutputSpec::Kind::None || config.getThisConfig.Type != OutputSpec::Kind::None)
+    if (!strConfigFile.empty())
     {
-        hr = WriteGetThisConfig(strConfigFile, tk.GetAltitudeLocations(), results);
+        hr = WriteGetThisConfig(strConfigFile, getthisconfig);
         if (FAILED(hr))
         {
             Log::Error("Failed to write getthis configuration [{}]", SystemError(hr));
@@ -542,7 +668,11 @@ HRESULT Main::Run()
 
     if (config.samplesOutput.Type != OutputSpec::Kind::None)
     {
-        hr = RunGetThis(strConfigFile, config.tmpdirOutput.Path.c_str());
+        if (bInProcess)
+            hr = CollectSamples(getthisconfig);
+        else
+            hr = RunGetThis(strConfigFile, config.tmpdirOutput.Path.c_str());
+
         if (FAILED(hr))
         {
             Log::Error("Failed to run getthis [{}]", SystemError(hr));
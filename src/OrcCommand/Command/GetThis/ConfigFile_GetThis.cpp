@@ -51,5 +51,25 @@ HRESULT Orc::Config::GetThis::root(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddAttribute(L"resurrect", GETTHIS_RESURRECT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = item.AddAttribute(L"blockcache", GETTHIS_BLOCKCACHE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"decompressahead", GETTHIS_DECOMPRESSAHEAD, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"wofcache", GETTHIS_WOFCACHE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"shadowsdelta", GETTHIS_SHADOWSDELTA, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"deduplicate", GETTHIS_DEDUPLICATE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"chunkhashes", GETTHIS_CHUNKHASHES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"knownchunks", GETTHIS_KNOWNCHUNKS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"timebudget", GETTHIS_TIMEBUDGET, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"knowngood", GETTHIS_KNOWNGOOD, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"knowngoodaudit", GETTHIS_KNOWNGOODAUDIT, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
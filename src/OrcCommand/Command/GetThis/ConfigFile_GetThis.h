@@ -27,6 +27,16 @@ constexpr auto GETTHIS_HASH = 9L;
 constexpr auto GETTHIS_FUZZYHASH = 10L;
 constexpr auto GETTHIS_YARA = 11L;
 constexpr auto GETTHIS_RESURRECT = 12L;
+constexpr auto GETTHIS_BLOCKCACHE = 13L;
+constexpr auto GETTHIS_DECOMPRESSAHEAD = 14L;
+constexpr auto GETTHIS_WOFCACHE = 15L;
+constexpr auto GETTHIS_SHADOWSDELTA = 16L;
+constexpr auto GETTHIS_DEDUPLICATE = 17L;
+constexpr auto GETTHIS_CHUNKHASHES = 18L;
+constexpr auto GETTHIS_KNOWNCHUNKS = 19L;
+constexpr auto GETTHIS_TIMEBUDGET = 20L;
+constexpr auto GETTHIS_KNOWNGOOD = 21L;
+constexpr auto GETTHIS_KNOWNGOODAUDIT = 22L;
 
 constexpr auto GETTHIS_GETTHIS = 0L;
 
@@ -13,8 +13,10 @@
 
 #include "OrcCommand.h"
 
+#include <chrono>
 #include <filesystem>
 #include <vector>
+#include <map>
 #include <set>
 #include <string>
 #include <optional>
@@ -29,9 +31,12 @@
 #include "FileFind.h"
 #include "TableOutputWriter.h"
 #include "ByteStream.h"
+#include "FileCopyPool.h"
 #include "OrcLimits.h"
 #include "CryptoHashStream.h"
 #include "FuzzyHashStream.h"
+#include "HashList.h"
+#include "KnownGoodList.h"
 #include "Archive/Appender.h"
 #include "Archive/7z/Archive7z.h"
 #include "Configuration/ShadowsParserOption.h"
@@ -64,7 +69,11 @@ enum LimitStatus
 
     FailedToComputeLimits = 1 << 7,
 
-    NoLimits = 1 << 8
+    NoLimits = 1 << 8,
+
+    TimeBudgetReached = 1 << 9,
+
+    KnownGoodFile = 1 << 10
 };
 
 enum class ContentType
@@ -97,6 +106,7 @@ public:
         std::swap(PerSampleLimits, other.PerSampleLimits);
         std::swap(Content, other.Content);
         std::swap(Terms, other.Terms);
+        std::swap(Priority, other.Priority);
     }
 
     SampleSpec(const SampleSpec&) = default;
@@ -104,6 +114,7 @@ public:
     std::wstring Name;
     Limits PerSampleLimits;
     ContentSpec Content;
+    DWORD Priority = 0L;  // samples of higher priorities are collected first
 
     std::vector<std::shared_ptr<FileFind::SearchTerm>> Terms;
 };
@@ -129,6 +140,16 @@ public:
         bool bFlushRegistry = false;
         bool bReportAll = false;
         ResurrectRecordsMode resurrectRecordsMode;
+        DWORDLONG dwlBlockCache = 0LL;
+        DWORD dwDecompressAhead = 0L;
+        DWORDLONG dwlWofCache = 0LL;
+        bool bShadowsDelta = false;
+        bool bDeduplicate = false;
+        bool bChunkHashes = false;
+        std::wstring strKnownChunks;  // SHA256 of the chunks already held by the server, implies bChunkHashes
+        DWORD dwTimeBudget = 0L;  // seconds given to the collection, no budget if zero
+        std::wstring strKnownGood;  // files not collected, nor matched against content criteria (see KnownGoodList)
+        DWORD dwKnownGoodAudit = 0L;  // one known good file in this many is handled as any other, none if zero
         boost::logic::tribool bAddShadows;
         std::optional<LocationSet::ShadowFilters> m_shadows;
         std::optional<Ntfs::ShadowCopy::ParserType> m_shadowsParser;
@@ -146,6 +167,7 @@ public:
 
         std::wstring YaraSource;
         std::unique_ptr<YaraConfig> Yara;
+        DWORD dwYaraWorkers = 0L;
 
         CryptoHashStream::Algorithm CryptoHashAlgs =
             CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1;
@@ -167,6 +189,7 @@ public:
         CBinaryBuffer MD5;
         CBinaryBuffer SHA1;
         CBinaryBuffer SHA256;
+        CBinaryBuffer BLAKE3;
 
         CBinaryBuffer SSDeep;
 
@@ -184,6 +207,8 @@ public:
         GUID SnapshotID;
         LimitStatus LimitStatus;
         std::wstring SourcePath;
+        std::optional<ULONGLONG> DiskOffset;  // First allocated extent of the data, used to order the reads
+        std::wstring DuplicateOf;  // Name of the sample with the same content, this one is not collected
 
         std::vector<std::shared_ptr<FileFind::Match>> Matches;
 
@@ -195,25 +220,12 @@ public:
             CollectionDate.dwLowDateTime = 0L;
         }
 
-        SampleRef(const SampleRef&) = default;
+        // Samples are handed over from the search to the copy, never duplicated
+        SampleRef(const SampleRef&) = delete;
+        SampleRef& operator=(const SampleRef&) = delete;
 
-        SampleRef(SampleRef&& Other)
-        {
-            std::swap(SampleName, Other.SampleName);
-            std::swap(MD5, Other.MD5);
-            std::swap(SHA1, Other.SHA1);
-            std::swap(SampleSize, Other.SampleSize);
-            CollectionDate = Other.CollectionDate;
-            std::swap(LimitStatus, Other.LimitStatus);
-            std::swap(Matches, Other.Matches);
-            AttributeIndex = Other.AttributeIndex;
-            InstanceID = Other.InstanceID;
-            std::swap(HashStream, Other.HashStream);
-            std::swap(CopyStream, Other.CopyStream);
-            std::swap(Content, Other.Content);
-            std::swap(SnapshotID, Other.SnapshotID);
-            std::swap(SourcePath, Other.SourcePath);
-        }
+        SampleRef(SampleRef&& Other) noexcept = default;
+        SampleRef& operator=(SampleRef&& Other) noexcept = default;
 
         bool IsOfflimits() const
         {
@@ -229,6 +241,8 @@ public:
                 case LocalMaxBytesPerSample:
                 case LocalMaxTotalBytes:
                 case FailedToComputeLimits:
+                case TimeBudgetReached:
+                case KnownGoodFile:
                     return true;
                 default:
                     _ASSERT("Unhandled 'LimitStatus' case");
@@ -237,6 +251,8 @@ public:
             return true;
         }
 
+        bool IsDuplicate() const { return !DuplicateOf.empty(); }
+
         bool operator<(const SampleRef& rigth) const
         {
             if (FRN.SegmentNumberLowPart != rigth.FRN.SegmentNumberLowPart)
@@ -364,7 +380,22 @@ private:
     HRESULT WriteSample(
         const std::filesystem::path& outputDir,
         std::unique_ptr<SampleRef> sample,
-        SampleWrittenCb writtenCb = {}) const;
+        SampleWrittenCb writtenCb = {});
+
+    HRESULT CompleteSample(const SampleRef& sample, HRESULT hrCopy, const SampleWrittenCb& writtenCb) const;
+
+    // Directory output: samples are read here and written by the pool's workers, the hashes, csv and callbacks of the
+    // written ones are completed by this thread.
+    struct PendingCopy
+    {
+        std::unique_ptr<SampleRef> Sample;
+        SampleWrittenCb WrittenCb;
+    };
+
+    std::unique_ptr<FileCopyPool> m_copyPool;
+    std::map<FileCopyPool::JobId, PendingCopy> m_pendingCopies;
+
+    void CompleteSampleCopies(bool bWait);
 
     void UpdateSamplesLimits(SampleSpec& sampleSpec, const SampleRef& sample);
 
@@ -372,6 +403,54 @@ private:
 
     HRESULT FindMatchingSamples();
 
+    // Samples are queued while the volumes are walked and written by windows, ordered by the location of their data
+    struct PendingSample
+    {
+        std::unique_ptr<SampleRef> Sample;
+        SampleSpec* Spec;
+    };
+
+    std::vector<PendingSample> m_pendingSamples;
+
+    void QueueSample(std::unique_ptr<SampleRef> sample, SampleSpec& sampleSpec);
+    void WritePendingSamples();
+
+    // Samples written at the end of the walks by decreasing priority, with limits applied in that order. Each priority
+    // is flushed before the next one so that a collection stopped by its time budget or killed keeps the first ones.
+    bool m_bPrioritized = false;
+    std::chrono::steady_clock::time_point m_collectionStart;
+
+    bool IsTimeBudgetSpent(DWORD dwPercent) const;
+    void FlushSamples();
+
+    // Content deduplication: samples are grouped by data size, content type and a hash of their first and last blocks.
+    // The full BLAKE3 is only computed for the samples of a group, the first sample of the group is kept with its data
+    // stream until then.
+    struct DedupCandidate
+    {
+        std::wstring SampleName;
+        std::shared_ptr<ByteStream> DataStream;
+        CBinaryBuffer BLAKE3;
+    };
+
+    using DedupKey = std::tuple<ULONGLONG, ContentType, std::string>;
+    std::map<DedupKey, std::vector<DedupCandidate>> m_dedupCandidates;
+
+    void DeduplicateSample(SampleRef& sample);
+
+    // Content defined chunks: a sample is collected as a chunk recipe, with its data but for the known chunks
+    std::unique_ptr<HashList> m_knownChunks;
+    ULONGLONG m_ullReferencedBytes = 0LL;
+
+    void ChunkSample(SampleRef& sample);
+
+    // Known good files are reported as not collected, but for the audited ones
+    std::shared_ptr<KnownGoodList> m_knownGood;
+    ULONGLONG m_ullKnownGoodSeen = 0LL;
+    ULONGLONG m_ullKnownGoodAudited = 0LL;
+
+    bool IsKnownGoodSample(const FileFind::Match& match, size_t attributeIndex);
+
     void OnMatchingSample(const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop);
     void OnSampleWritten(const SampleRef& sample, const SampleSpec& sampleSpec, HRESULT hrWrite) const;
 
@@ -262,6 +262,10 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
             {
                 aSpec.Name = item[CONFIG_SAMPLE_NAME];
             }
+            if (item[CONFIG_SAMPLE_PRIORITY])
+            {
+                aSpec.Priority = (DWORD)item[CONFIG_SAMPLE_PRIORITY];
+            }
             if (item[CONFIG_SAMPLE_CONTENT])
             {
                 aSpec.Content = config.GetContentSpecFromString(item[CONFIG_SAMPLE_CONTENT]);
@@ -370,6 +374,63 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
         }
     }
 
+    if (configitem[GETTHIS_BLOCKCACHE])
+    {
+        config.dwlBlockCache = (DWORD64)configitem[GETTHIS_BLOCKCACHE];
+    }
+
+    if (configitem[GETTHIS_DECOMPRESSAHEAD])
+    {
+        if (auto hrAhead = GetIntegerFromArg(configitem[GETTHIS_DECOMPRESSAHEAD].c_str(), config.dwDecompressAhead);
+            FAILED(hrAhead))
+        {
+            Log::Error(
+                L"Failed to parse 'decompressahead' attribute (value: {}) [{}]",
+                configitem[GETTHIS_DECOMPRESSAHEAD].c_str(),
+                SystemError(hrAhead));
+        }
+    }
+
+    if (configitem[GETTHIS_WOFCACHE])
+    {
+        config.dwlWofCache = (DWORD64)configitem[GETTHIS_WOFCACHE];
+    }
+
+    if (configitem[GETTHIS_SHADOWSDELTA])
+    {
+        config.bShadowsDelta = true;
+    }
+
+    if (configitem[GETTHIS_DEDUPLICATE])
+    {
+        config.bDeduplicate = true;
+    }
+
+    if (configitem[GETTHIS_CHUNKHASHES])
+    {
+        config.bChunkHashes = true;
+    }
+
+    if (configitem[GETTHIS_KNOWNCHUNKS])
+    {
+        config.strKnownChunks = configitem[GETTHIS_KNOWNCHUNKS];
+    }
+
+    if (configitem[GETTHIS_TIMEBUDGET])
+    {
+        config.dwTimeBudget = (DWORD)configitem[GETTHIS_TIMEBUDGET];
+    }
+
+    if (configitem[GETTHIS_KNOWNGOOD])
+    {
+        config.strKnownGood = configitem[GETTHIS_KNOWNGOOD];
+    }
+
+    if (configitem[GETTHIS_KNOWNGOODAUDIT])
+    {
+        config.dwKnownGoodAudit = (DWORD)configitem[GETTHIS_KNOWNGOODAUDIT];
+    }
+
     return S_OK;
 }
 
@@ -442,6 +503,26 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                         ;
                     else if (ParameterOption(argv[i] + 1, L"Password", config.Output.Password))
                         ;
+                    else if (FileSizeOption(argv[i] + 1, L"BlockCache", config.dwlBlockCache))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"DecompressAhead", config.dwDecompressAhead))
+                        ;
+                    else if (FileSizeOption(argv[i] + 1, L"WofCache", config.dwlWofCache))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"ShadowsDelta", config.bShadowsDelta))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"Deduplicate", config.bDeduplicate))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"ChunkHashes", config.bChunkHashes))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"KnownChunks", config.strKnownChunks))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"TimeBudget", config.dwTimeBudget))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"KnownGoodAudit", config.dwKnownGoodAudit))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"KnownGood", config.strKnownGood))
+                        ;
                     else if (FileSizeOption(argv[i] + 1, L"MaxPerSampleBytes", config.limits.dwlMaxBytesPerSample))
                         ;
                     else if (FileSizeOption(argv[i] + 1, L"MaxTotalBytes", config.limits.dwlMaxTotalBytes))
@@ -468,6 +549,12 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                             config.Yara = std::make_unique<YaraConfig>();
                         boost::split(config.Yara->Sources(), config.YaraSource, boost::is_any_of(";,"));
                     }
+                    else if (ParameterOption(argv[i] + 1, L"YaraWorkers", config.dwYaraWorkers))
+                    {
+                        if (!config.Yara)
+                            config.Yara = std::make_unique<YaraConfig>();
+                        config.Yara->SetWorkers(config.dwYaraWorkers);
+                    }
                     else if (EncodingOption(argv[i] + 1, config.Output.OutputEncoding))
                         ;
                     else if (ProcessPriorityOption(argv[i] + 1))
@@ -548,6 +635,11 @@ HRESULT Main::CheckConfiguration()
         config.content.Type = ContentType::DATA;
     }
 
+    if (!config.strKnownChunks.empty())
+    {
+        config.bChunkHashes = true;
+    }
+
     bool hasFailed = false;
     std::for_each(begin(config.listofSpecs), end(config.listofSpecs), [this, &hasFailed](SampleSpec& aSpec) {
         if (aSpec.Content.Type == ContentType::INVALID)
@@ -573,6 +665,11 @@ HRESULT Main::CheckConfiguration()
         return E_FAIL;
     }
 
+    m_bPrioritized = config.dwTimeBudget > 0
+        || std::any_of(std::cbegin(config.listofSpecs), std::cend(config.listofSpecs), [](const SampleSpec& aSpec) {
+                         return aSpec.Priority > 0;
+                     });
+
     std::for_each(
         begin(config.listOfExclusions),
         end(config.listOfExclusions),
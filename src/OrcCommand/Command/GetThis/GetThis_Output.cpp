@@ -77,12 +77,13 @@ void PrintValues(
         }
 
         auto sampleNode = samplesNode.AddNode(
-            L"{} {} (Count: {}, Size: {}, Total: {})",
+            L"{} {} (Count: {}, Size: {}, Total: {}, Priority: {})",
             sampleName,
             sample.Content,
             sample.PerSampleLimits.dwMaxSampleCount,
             sample.PerSampleLimits.dwlMaxBytesPerSample,
-            sample.PerSampleLimits.dwlMaxTotalBytes);
+            sample.PerSampleLimits.dwlMaxTotalBytes,
+            sample.Priority);
 
         for (const auto& term : sample.Terms)
         {
@@ -141,9 +142,12 @@ void Main::PrintUsage()
             "enabled)"},
         Usage::Parameter {"/ReportAll", "Add information about rejected samples (due to limits) to CSV"},
         Usage::Parameter {"/NoSigCheck", "Check only sample signatures from autoruns output"},
-        Usage::Parameter {"/Hash=<MD5|SHA1|SHA256>", "Comma-separated list of hashes to compute"},
+        Usage::Parameter {"/Hash=<MD5|SHA1|SHA256|BLAKE3>", "Comma-separated list of hashes to compute"},
         Usage::Parameter {"/FuzzyHash=<SSDeep>", "Comma-separated list of 'FuzzyHash' hashes to compute"},
-        Usage::Parameter {"/Yara=<Rules.yara>", "List of Yara sources"}};
+        Usage::Parameter {"/Yara=<Rules.yara>", "List of Yara sources"},
+        Usage::Parameter {
+            "/YaraWorkers=<Count>",
+            "Number of threads scanning the candidate files with the Yara rules while the MFT walk goes on"}};
     Usage::PrintParameters(usageNode, "PARAMETERS", kSpecificParameters);
 
     Usage::PrintLimitsParameters(usageNode);
@@ -158,7 +162,39 @@ void Main::PrintUsage()
         Usage::kMiscParameterCompression,
         Usage::kMiscParameterPassword,
         Usage::kMiscParameterTempDir,
-        Usage::Parameter {"/FlushRegistry", "Flushes registry hives using RegFlushKey API"}};
+        Usage::Parameter {"/FlushRegistry", "Flushes registry hives using RegFlushKey API"},
+        Usage::Parameter {"/BlockCache=<Size>", "Size of the cache of volume clusters shared by the volume readers"},
+        Usage::Parameter {
+            "/DecompressAhead=<Count>",
+            "Number of WOF chunks or NTFS compression units decompressed concurrently when reading compressed files"},
+        Usage::Parameter {
+            "/WofCache=<Size>",
+            "Size of the cache of decompressed WOF chunks shared by the matching and the collection of a file"},
+        Usage::kMiscParameterShadowsDelta,
+        Usage::Parameter {
+            "/Deduplicate",
+            "Collect samples with the same content only once, duplicates are reported in the CSV with the name of the "
+            "collected sample"},
+        Usage::Parameter {
+            "/ChunkHashes",
+            "Collect samples as '<Sample>.cdc' chunk recipes: a header listing the content defined chunks of the data "
+            "with their SHA256, followed by the data of the chunks"},
+        Usage::Parameter {
+            "/KnownChunks=<FilePath>",
+            "SHA256 of the chunks already held by the server, one per line: such chunks are only referenced in the "
+            "recipes (implies /ChunkHashes)"},
+        Usage::Parameter {
+            "/TimeBudget=<Seconds>",
+            "Time given to the collection: samples are collected by decreasing 'priority' of their specs once the "
+            "search is over, which stops halfway through the budget, and the samples left when it is spent are "
+            "reported as not collected"},
+        Usage::Parameter {
+            "/KnownGood=<FilePath>",
+            "List of known good files (size, name and optional SHA1 of the first 4KB): they are reported as not "
+            "collected and their content is not matched against header, contains, hash or yara criteria"},
+        Usage::Parameter {
+            "/KnownGoodAudit=<Count>",
+            "One known good file in this many is collected and matched as any other file, for assurance"}};
     Usage::PrintMiscellaneousParameters(usageNode, kCustomMiscParameters);
 
     Usage::PrintLoggingParameters(usageNode);
@@ -181,6 +217,40 @@ void Main::PrintParameters()
     PrintValue(node, L"MaxBytesPerSample", config.limits.dwlMaxBytesPerSample);
     PrintValue(node, L"MaxTotalBytes", config.limits.dwlMaxTotalBytes);
     PrintValue(node, L"MaxSampleCount", config.limits.dwMaxSampleCount);
+    PrintValue(node, L"BlockCache", config.dwlBlockCache);
+    if (config.dwDecompressAhead > 1)
+    {
+        PrintValue(node, L"DecompressAhead", config.dwDecompressAhead);
+    }
+    if (config.dwlWofCache > 0)
+    {
+        PrintValue(node, L"WofCache", config.dwlWofCache);
+    }
+    if (config.bShadowsDelta)
+    {
+        PrintValue(node, L"ShadowsDelta", Traits::Boolean(config.bShadowsDelta));
+    }
+    if (config.bDeduplicate)
+    {
+        PrintValue(node, L"Deduplicate", Traits::Boolean(config.bDeduplicate));
+    }
+    if (config.bChunkHashes)
+    {
+        PrintValue(node, L"ChunkHashes", Traits::Boolean(config.bChunkHashes));
+    }
+    if (!config.strKnownChunks.empty())
+    {
+        PrintValue(node, L"KnownChunks", config.strKnownChunks);
+    }
+    if (config.dwTimeBudget > 0)
+    {
+        PrintValue(node, L"TimeBudget (seconds)", config.dwTimeBudget);
+    }
+    if (!config.strKnownGood.empty())
+    {
+        PrintValue(node, L"KnownGood", config.strKnownGood);
+        PrintValue(node, L"KnownGoodAudit", config.dwKnownGoodAudit);
+    }
 
     PrintValues(node, L"Parsed locations", config.Locations.GetParsedLocations());
 
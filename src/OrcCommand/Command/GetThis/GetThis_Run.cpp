@@ -28,10 +28,15 @@
 #include "DevNullStream.h"
 #include "StringsStream.h"
 #include "CryptoHashStream.h"
+#include "ChunkHashStream.h"
+#include "ChunkRecipeStream.h"
 #include "ParameterCheck.h"
 #include "ArchiveExtract.h"
 #include "StructuredOutputWriter.h"
 #include "SnapshotVolumeReader.h"
+#include "UncompressNTFSStream.h"
+#include "UncompressWofStream.h"
+#include "WofChunkCache.h"
 
 #include "SystemDetails.h"
 #include "Utils/WinApi.h"
@@ -55,6 +60,11 @@ namespace {
 const std::wstring_view kGetThisCsv = L"GetThis.csv";
 const std::wstring_view kGetThisStatistics = L"Statistics.json";
 
+// Directory output: samples are read by one thread and written by these workers, with up to 16MB in flight
+constexpr DWORD kCopyWorkers = 4;
+constexpr DWORD kCopyBufferSize = 1024 * 1024;
+constexpr DWORD kCopyBuffers = 16;
+
 enum class CompressorFlags : uint32_t
 {
     kNone = 0,
@@ -78,8 +88,32 @@ std::wstring ToString(const GUID& guid)
     return s;
 }
 
-void PrintStatistics(Orc::Text::Tree& root, const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms)
+void PrintYaraStatistics(Orc::Text::Tree& root, const std::vector<YaraRuleProfile>& yaraRules)
 {
+    if (yaraRules.empty())
+    {
+        return;
+    }
+
+    auto statsNode = root.AddNode(L"Slowest yara rules:");
+    statsNode.AddEmptyLine();
+
+    for (const auto& rule : yaraRules)
+    {
+        statsNode.Add(
+            "{}: {}{}",
+            rule.Rule,
+            std::chrono::duration_cast<std::chrono::milliseconds>(rule.Time),
+            rule.Disabled ? " (disabled: over budget)" : "");
+    }
+
+    statsNode.AddEmptyLine();
+}
+
+void PrintStatistics(Orc::Text::Tree& root, const FileFind& fileFind)
+{
+    const auto& searchTerms = fileFind.AllSearchTerms();
+
     auto statsNode = root.AddNode(L"Statistics for 'ntfs_find' rules:");
     statsNode.AddEmptyLine();
 
@@ -126,6 +160,27 @@ void PrintStatistics(Orc::Text::Tree& root, const std::vector<std::shared_ptr<Fi
 
         statsNode.AddEmptyLine();
     }
+
+    PrintYaraStatistics(root, fileFind.SlowestYaraRules());
+}
+
+void WriteYaraStatistics(
+    const std::vector<YaraRuleProfile>& yaraRules,
+    Orc::StructuredOutputWriter::IWriter::Ptr& writer)
+{
+    const auto kNodeRules = L"yara_rules";
+    writer->BeginCollection(kNodeRules);
+    Guard::Scope onExit([&]() { writer->EndCollection(kNodeRules); });
+
+    for (const auto& rule : yaraRules)
+    {
+        writer->BeginElement(nullptr);
+        Guard::Scope onExit([&]() { writer->EndElement(nullptr); });
+
+        writer->WriteNamed(L"rule", std::string_view(rule.Rule));
+        writer->WriteNamed(L"time", std::chrono::duration_cast<std::chrono::milliseconds>(rule.Time).count());
+        writer->WriteNamed(L"disabled", rule.Disabled);
+    }
 }
 
 void WriteNtfsFindStatistics(
@@ -154,9 +209,7 @@ void WriteNtfsFindStatistics(
     }
 }
 
-Orc::Result<void> WriteStatistics(
-    const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms,
-    Orc::StructuredOutputWriter::IWriter::Ptr& writer)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, Orc::StructuredOutputWriter::IWriter::Ptr& writer)
 {
     try
     {
@@ -176,7 +229,8 @@ Orc::Result<void> WriteStatistics(
                 writer->BeginElement(kNodeStats);
                 Guard::Scope onExit([&]() { writer->EndElement(kNodeStats); });
 
-                WriteNtfsFindStatistics(searchTerms, writer);
+                WriteNtfsFindStatistics(fileFind.AllSearchTerms(), writer);
+                WriteYaraStatistics(fileFind.SlowestYaraRules(), writer);
             }
         }
     }
@@ -200,8 +254,7 @@ Orc::Result<void> WriteStatistics(
     return Orc::Success<void>();
 }
 
-Orc::Result<void>
-WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms, const OutputSpec& output)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, const OutputSpec& output)
 {
     auto options = std::make_unique<StructuredOutput::JSON::Options>();
     options->Encoding = OutputSpec::Encoding::UTF8;
@@ -220,7 +273,7 @@ WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& search
         return SystemError(E_FAIL);
     }
 
-    auto rv = WriteStatistics(searchTerms, writer);
+    auto rv = WriteStatistics(fileFind, writer);
     if (rv.has_error())
     {
         Log::Error(L"Failed to write statistics file [{}]", rv);
@@ -238,19 +291,17 @@ WriteStatistics(const std::vector<std::shared_ptr<FileFind::SearchTerm>>& search
     return Orc::Success<void>();
 }
 
-Orc::Result<void> WriteStatistics(
-    const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms,
-    const std::filesystem::path& path)
+Orc::Result<void> WriteStatistics(const FileFind& fileFind, const std::filesystem::path& path)
 {
     OutputSpec output;
     output.Type = OutputSpec::Kind::JSON;
     output.Path = path;
-    return WriteStatistics(searchTerms, output);
+    return WriteStatistics(fileFind, output);
 }
 
 Orc::Result<void> CompressStatistics(
     const std::unique_ptr<Archive::Appender<Archive::Archive7z>>& compressor,
-    const std::vector<std::shared_ptr<FileFind::SearchTerm>>& searchTerms)
+    const FileFind& fileFind)
 {
     OutputSpec output;
     output.OutputEncoding = OutputSpec::Encoding::UTF8;
@@ -276,7 +327,7 @@ Orc::Result<void> CompressStatistics(
         return SystemError(E_FAIL);
     }
 
-    auto rv = WriteStatistics(searchTerms, writer);
+    auto rv = WriteStatistics(fileFind, writer);
     if (rv.has_error())
     {
         return rv;
@@ -438,19 +489,29 @@ std::wstring RetrieveComputerName(const std::wstring& defaultName)
     return name;
 }
 
-HRESULT CopyStream(Orc::ByteStream& src, const fs::path& outPath)
+HRESULT CreateSampleDirectory(const fs::path& outPath)
 {
-    HRESULT hr = E_FAIL;
     std::error_code ec;
 
     fs::create_directories(outPath.parent_path(), ec);
     if (ec)
     {
-        hr = HRESULT_FROM_WIN32(ec.value());
+        HRESULT hr = HRESULT_FROM_WIN32(ec.value());
         Log::Error(L"Failed to create sample directory [{}]", SystemError(hr));
         return hr;
     }
 
+    return S_OK;
+}
+
+HRESULT CopyStream(Orc::ByteStream& src, const fs::path& outPath)
+{
+    HRESULT hr = CreateSampleDirectory(outPath);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     FileStream outputStream;
     hr = outputStream.WriteTo(outPath.c_str());
     if (FAILED(hr))
@@ -765,6 +826,87 @@ PFILE_NAME GetLastFileName(const std::vector<Orc::FileFind::Match::NameMatch>& n
     return nameMatches[nameMatches.size() - 1].FILENAME();
 }
 
+constexpr ULONGLONG kDedupBlockSize = 64 * 1024;
+
+HRESULT HashStreamRange(ByteStream& stream, ULONGLONG ullOffset, ULONGLONG ullLength, ByteStream& hashstream)
+{
+    HRESULT hr = stream.SetFilePointer(ullOffset, FILE_BEGIN, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    CBinaryBuffer buffer;
+    if (!buffer.SetCount(static_cast<size_t>(std::min<ULONGLONG>(ullLength, 1024 * 1024))))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    while (ullLength > 0)
+    {
+        ULONGLONG ullRead = 0LL;
+        hr = stream.Read(buffer.GetData(), std::min<ULONGLONG>(ullLength, buffer.GetCount()), &ullRead);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (ullRead == 0)
+        {
+            break;
+        }
+
+        ULONGLONG ullWritten = 0LL;
+        hr = hashstream.Write(buffer.GetData(), ullRead, &ullWritten);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        ullLength -= ullRead;
+    }
+
+    return S_OK;
+}
+
+// BLAKE3 of the data, or of its first and last blocks only unless 'bFull'. The stream is rewound for its collection.
+HRESULT ComputeDedupHash(ByteStream& stream, bool bFull, CBinaryBuffer& hash)
+{
+    auto hashstream = std::make_shared<CryptoHashStream>();
+    HRESULT hr = hashstream->OpenToWrite(CryptoHashStream::Algorithm::BLAKE3, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    const auto ullSize = stream.GetSize();
+    if (bFull || ullSize <= 2 * kDedupBlockSize)
+    {
+        hr = HashStreamRange(stream, 0, ullSize, *hashstream);
+    }
+    else
+    {
+        hr = HashStreamRange(stream, 0, kDedupBlockSize, *hashstream);
+        if (SUCCEEDED(hr))
+        {
+            hr = HashStreamRange(stream, ullSize - kDedupBlockSize, kDedupBlockSize, *hashstream);
+        }
+    }
+
+    HRESULT hrRewind = stream.SetFilePointer(0, FILE_BEGIN, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (FAILED(hrRewind))
+    {
+        return hrRewind;
+    }
+
+    return hashstream->GetHash(CryptoHashStream::Algorithm::BLAKE3, hash);
+}
+
 }  // namespace
 
 GUID Main::SampleId::GetSnapshotId(VolumeReader& volumeReader)
@@ -809,6 +951,7 @@ std::unique_ptr<Main::SampleRef> Main::CreateSample(
     sample->AttributeIndex = attributeIndex;
     sample->InstanceID = attribute.InstanceID;
     sample->SourcePath = ::GetMatchFullName(match->MatchingNames.front(), attribute);
+    sample->DiskOffset = attribute.GetFirstDiskOffset(match->VolumeReader);
 
     sample->isRecordInUse = !match->DeletedRecord;
 
@@ -942,7 +1085,7 @@ Main::AddSampleRefToCSV(ITableOutput& output, const Main::SampleRef& sample) con
 
             output.WriteString(name.FullPathName);
 
-            if (sample.IsOfflimits())
+            if (sample.IsOfflimits() || sample.IsDuplicate())
             {
                 output.WriteNothing();
             }
@@ -1017,6 +1160,17 @@ Main::AddSampleRefToCSV(ITableOutput& output, const Main::SampleRef& sample) con
 
             output.WriteBool(sample.isRecordInUse);
 
+            if (sample.IsDuplicate())
+            {
+                output.WriteString(sample.DuplicateOf);
+            }
+            else
+            {
+                output.WriteNothing();
+            }
+
+            output.WriteBytes(sample.BLAKE3);
+
             output.WriteEndOfLine();
         }
     }
@@ -1055,7 +1209,7 @@ HRESULT Main::WriteSample(
         }
     };
 
-    if (sample->IsOfflimits())
+    if (sample->IsOfflimits() || sample->IsDuplicate())
     {
         onItemArchivedCb({});
         return S_OK;
@@ -1070,52 +1224,112 @@ HRESULT Main::WriteSample(
 HRESULT Main::WriteSample(
     const std::filesystem::path& outputDir,
     std::unique_ptr<SampleRef> sample,
-    SampleWrittenCb writtenCb) const
+    SampleWrittenCb writtenCb)
 {
-    HRESULT hr = E_FAIL, hrCopy = E_FAIL, hrCsv = E_FAIL;
+    if (sample->IsOfflimits() || sample->IsDuplicate())
+    {
+        return CompleteSample(*sample, S_OK, writtenCb);
+    }
+
+    const fs::path sampleFile = outputDir / fs::path(sample->SampleName);
 
-    if (!sample->IsOfflimits())
+    if (m_copyPool == nullptr || m_copyPool->Workers() == 0)
     {
-        const fs::path sampleFile = outputDir / fs::path(sample->SampleName);
-        hrCopy = ::CopyStream(*sample->CopyStream, sampleFile);
+        HRESULT hrCopy = ::CopyStream(*sample->CopyStream, sampleFile);
         if (FAILED(hrCopy))
         {
             Log::Error(L"Failed to copy stream of '{}' [{}]", sampleFile, SystemError(hrCopy));
         }
+
+        return CompleteSample(*sample, hrCopy, writtenCb);
     }
 
-    FinalizeHashes(*sample);
+    HRESULT hr = ::CreateSampleDirectory(sampleFile);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to copy stream of '{}' [{}]", sampleFile, SystemError(hr));
+        return CompleteSample(*sample, hr, writtenCb);
+    }
+
+    // The sample is read (and hashed) by Submit, only the writes are left to the workers
+    const auto id = m_copyPool->Submit(*sample->CopyStream, sampleFile);
+
+    hr = sample->CopyStream->Close();
+    if (FAILED(hr))
+    {
+        Log::Warn(L"Failed to close input steam for '{}' [{}]", sampleFile, SystemError(hr));
+    }
+
+    m_pendingCopies.emplace(id, PendingCopy {std::move(sample), std::move(writtenCb)});
+
+    CompleteSampleCopies(false);
+    return S_OK;
+}
+
+HRESULT Main::CompleteSample(const SampleRef& sample, HRESULT hrCopy, const SampleWrittenCb& writtenCb) const
+{
+    HRESULT hr = E_FAIL;
 
-    hrCsv = AddSampleRefToCSV(*m_tableWriter, *sample);
+    FinalizeHashes(sample);
+
+    HRESULT hrCsv = AddSampleRefToCSV(*m_tableWriter, sample);
     if (FAILED(hrCsv))
     {
         Log::Error(
             L"Failed to add sample '{}' metadata to csv [{}]",
-            sample->Matches.front()->MatchingNames.front().FullPathName,
+            sample.Matches.front()->MatchingNames.front().FullPathName,
             SystemError(hrCsv));
     }
 
-    if ((SUCCEEDED(hrCopy) || sample->IsOfflimits()) && SUCCEEDED(hrCsv))
+    if (SUCCEEDED(hrCopy) && SUCCEEDED(hrCsv))
     {
         hr = S_OK;
     }
 
     if (writtenCb)
     {
-        writtenCb(*sample, hr);
+        writtenCb(sample, hr);
     }
 
     return hr;
 }
 
+void Main::CompleteSampleCopies(bool bWait)
+{
+    if (m_copyPool == nullptr)
+    {
+        return;
+    }
+
+    for (const auto& result : m_copyPool->Collect(bWait))
+    {
+        auto it = m_pendingCopies.find(result.Id);
+        if (it == std::end(m_pendingCopies))
+        {
+            Log::Error(L"Unexpected sample copy result (id: {})", result.Id);
+            continue;
+        }
+
+        const auto& sample = *it->second.Sample;
+        if (FAILED(result.hr))
+        {
+            Log::Error(L"Failed to copy stream of '{}' [{}]", sample.SampleName, SystemError(result.hr));
+        }
+
+        CompleteSample(sample, result.hr, it->second.WrittenCb);
+        m_pendingCopies.erase(it);
+    }
+}
+
 void Main::FinalizeHashes(const Main::SampleRef& sample) const
 {
-    if (!sample.HashStream)
+    if (!sample.HashStream || sample.IsDuplicate())
     {
         return;
     }
 
-    if (sample.IsOfflimits() && config.bReportAll && config.CryptoHashAlgs != CryptoHashStream::Algorithm::Undefined)
+    if (sample.IsOfflimits() && sample.LimitStatus != KnownGoodFile && config.bReportAll
+        && config.CryptoHashAlgs != CryptoHashStream::Algorithm::Undefined)
     {
         // Stream that were not collected must be read for HashStream
         ULONGLONG ullBytesWritten = 0LL;
@@ -1133,6 +1347,7 @@ void Main::FinalizeHashes(const Main::SampleRef& sample) const
     sample.HashStream->GetMD5(const_cast<CBinaryBuffer&>(sample.MD5));
     sample.HashStream->GetSHA1(const_cast<CBinaryBuffer&>(sample.SHA1));
     sample.HashStream->GetSHA256(const_cast<CBinaryBuffer&>(sample.SHA256));
+    sample.HashStream->GetBLAKE3(const_cast<CBinaryBuffer&>(sample.BLAKE3));
 
     if (sample.FuzzyHashStream)
     {
@@ -1193,7 +1408,7 @@ HRESULT Main::CloseArchiveOutput()
 
     ::CompressTable(m_compressor, m_tableWriter);
 
-    auto rv = ::CompressStatistics(m_compressor, FileFinder.AllSearchTerms());
+    auto rv = ::CompressStatistics(m_compressor, FileFinder);
     if (rv.has_error())
     {
         Log::Error(L"Failed to write statistics file [{}]", rv);
@@ -1229,11 +1444,15 @@ HRESULT Main::InitDirectoryOutput()
         return hr;
     }
 
+    m_copyPool = std::make_unique<FileCopyPool>(kCopyWorkers, kCopyBufferSize, kCopyBuffers);
     return S_OK;
 }
 
 HRESULT Main::CloseDirectoryOutput()
 {
+    CompleteSampleCopies(true);
+    m_copyPool.reset();
+
     const auto tablePath = std::filesystem::path(config.Output.Path) / kGetThisCsv;
     auto rv = ::WriteTable(m_tableWriter, tablePath);
     if (rv.has_error())
@@ -1243,7 +1462,7 @@ HRESULT Main::CloseDirectoryOutput()
     }
 
     const auto statisticsPath = std::filesystem::path(config.Output.Path) / kGetThisStatistics;
-    rv = ::WriteStatistics(FileFinder.AllSearchTerms(), statisticsPath);
+    rv = ::WriteStatistics(FileFinder, statisticsPath);
     if (rv.has_error())
     {
         Log::Error(L"Failed to write: '{}' [{}]", statisticsPath, rv.error());
@@ -1291,6 +1510,8 @@ void Main::UpdateSamplesLimits(SampleSpec& sampleSpec, const SampleRef& sample)
             break;
 
         case FailedToComputeLimits:
+        case TimeBudgetReached:
+        case KnownGoodFile:
             break;
 
         default:
@@ -1308,6 +1529,12 @@ void Main::OnSampleWritten(const SampleRef& sample, const SampleSpec& sampleSpec
         return;
     }
 
+    if (sample.IsDuplicate())
+    {
+        m_console.Print(L"{}: same content as '{}' ({} bytes)", name, sample.DuplicateOf, sample.SampleSize);
+        return;
+    }
+
     switch (sample.LimitStatus)
     {
         case NoLimits:
@@ -1343,15 +1570,29 @@ void Main::OnSampleWritten(const SampleRef& sample, const SampleSpec& sampleSpec
 
         case FailedToComputeLimits:
             break;
+
+        case TimeBudgetReached:
+            m_console.Print(L"{}: Time budget spent ({} seconds)", name, config.dwTimeBudget);
+            break;
+
+        case KnownGoodFile:
+            m_console.Print(L"{}: Known good file, not collected", name);
+            break;
     }
 }
 
 void Main::OnMatchingSample(const std::shared_ptr<FileFind::Match>& aMatch, bool& bStop)
 {
-    HRESULT hr = E_FAIL;
-
     _ASSERT(aMatch != nullptr);
 
+    // The search is given half of the time budget, the other half is left to collect the samples by priority
+    if (IsTimeBudgetSpent(50))
+    {
+        Log::Warn(L"Half of the time budget is spent, stopping the search");
+        bStop = true;
+        return;
+    }
+
     if (aMatch->MatchingAttributes.empty())
     {
         Log::Warn(
@@ -1388,32 +1629,322 @@ void Main::OnMatchingSample(const std::shared_ptr<FileFind::Match>& aMatch, bool
         }
 
         auto sample = CreateSample(aMatch, i, sampleSpec);
-        UpdateSamplesLimits(sampleSpec, *sample);
+        if (IsKnownGoodSample(*aMatch, i))
+        {
+            sample->LimitStatus = KnownGoodFile;
+        }
+
+        // Prioritized samples get their limits when written, in priority order
+        if (!m_bPrioritized)
+        {
+            UpdateSamplesLimits(sampleSpec, *sample);
+        }
 
         // TODO: memory optimization: check that sampleIds is reset when volume changes
         m_sampleIds.insert(SampleId(*sample));
 
+        QueueSample(std::move(sample), sampleSpec);
+    }
+}
+
+bool Main::IsKnownGoodSample(const FileFind::Match& match, size_t attributeIndex)
+{
+    if (m_knownGood == nullptr)
+    {
+        return false;
+    }
+
+    const auto& attribute = match.MatchingAttributes[attributeIndex];
+    const auto pFileName = match.MatchingNames.front().FILENAME();
+    if (attribute.Type != $DATA || !attribute.AttrName.empty() || attribute.DataStream == nullptr
+        || pFileName == nullptr)
+    {
+        return false;
+    }
+
+    if (!m_knownGood->Contains(
+            std::wstring_view(pFileName->FileName, pFileName->FileNameLength), *attribute.DataStream))
+    {
+        return false;
+    }
+
+    m_ullKnownGoodSeen++;
+    if (config.dwKnownGoodAudit > 0 && m_ullKnownGoodSeen % config.dwKnownGoodAudit == 0)
+    {
+        m_ullKnownGoodAudited++;
+        return false;
+    }
+
+    return true;
+}
+
+void Main::QueueSample(std::unique_ptr<SampleRef> sample, SampleSpec& sampleSpec)
+{
+    constexpr size_t kMaxPendingSamples = 4096;
+
+    // Prioritized samples are all kept until the end of the walks: the first ones to write may be found last
+    m_pendingSamples.push_back({std::move(sample), &sampleSpec});
+    if (!m_bPrioritized && m_pendingSamples.size() >= kMaxPendingSamples)
+    {
+        WritePendingSamples();
+    }
+}
+
+bool Main::IsTimeBudgetSpent(DWORD dwPercent) const
+{
+    if (config.dwTimeBudget == 0)
+    {
+        return false;
+    }
+
+    const auto elapsed = std::chrono::steady_clock::now() - m_collectionStart;
+    return elapsed >= std::chrono::seconds(config.dwTimeBudget) * dwPercent / 100;
+}
+
+void Main::FlushSamples()
+{
+    if (config.Output.Type == OutputSpec::Kind::Archive && m_compressor->CanAppend())
+    {
+        std::error_code ec;
+        m_compressor->Flush(ec);
+        if (ec)
+        {
+            Log::Error(L"Failed to compress samples to '{}' [{}]", config.Output.Path, ec);
+        }
+    }
+    else if (config.Output.Type == OutputSpec::Kind::Directory)
+    {
+        CompleteSampleCopies(true);
+    }
+}
+
+void Main::WritePendingSamples()
+{
+    // Limits were already applied in match order unless samples are prioritized, only the reads are reordered.
+    // Resident data comes first as it has no location, ties keep the match order so the archive content is the same
+    // from one run to another.
+    std::stable_sort(
+        std::begin(m_pendingSamples),
+        std::end(m_pendingSamples),
+        [this](const PendingSample& lhs, const PendingSample& rhs) {
+            if (m_bPrioritized && lhs.Spec->Priority != rhs.Spec->Priority)
+                return lhs.Spec->Priority > rhs.Spec->Priority;
+
+            if (lhs.Sample->VolumeSerial != rhs.Sample->VolumeSerial)
+                return lhs.Sample->VolumeSerial < rhs.Sample->VolumeSerial;
+
+            auto cmpresult = memcmp(&lhs.Sample->SnapshotID, &rhs.Sample->SnapshotID, sizeof(GUID));
+            if (cmpresult != 0)
+                return cmpresult < 0;
+
+            return lhs.Sample->DiskOffset < rhs.Sample->DiskOffset;
+        });
+
+    std::optional<DWORD> priority;
+    bool bTimeBudgetSpent = false;
+
+    for (auto& pending : m_pendingSamples)
+    {
+        HRESULT hr = E_FAIL;
+        auto& sampleSpec = *pending.Spec;
+
+        if (m_bPrioritized)
+        {
+            // Safe point: the samples of the previous priority are written before the next ones are read
+            if (priority && *priority != sampleSpec.Priority)
+            {
+                FlushSamples();
+            }
+            priority = sampleSpec.Priority;
+
+            auto& sample = *pending.Sample;
+            if (!bTimeBudgetSpent && IsTimeBudgetSpent(100))
+            {
+                Log::Warn(
+                    L"Time budget spent, samples of priority {} and lower are not collected", sampleSpec.Priority);
+                bTimeBudgetSpent = true;
+            }
+
+            if (sample.LimitStatus == KnownGoodFile)
+            {
+                // Not collected whatever the limits
+            }
+            else if (bTimeBudgetSpent)
+            {
+                sample.LimitStatus = TimeBudgetReached;
+            }
+            else
+            {
+                const auto& attribute = sample.Matches.front()->MatchingAttributes[sample.AttributeIndex];
+                sample.LimitStatus =
+                    ::SampleLimitStatus(GlobalLimits, sampleSpec.PerSampleLimits, attribute.DataStream->GetSize());
+                UpdateSamplesLimits(sampleSpec, sample);
+            }
+        }
+
+        if (config.bDeduplicate)
+        {
+            DeduplicateSample(*pending.Sample);
+        }
+
+        if (config.bChunkHashes)
+        {
+            ChunkSample(*pending.Sample);
+        }
+
         if (config.Output.Type == OutputSpec::Kind::Archive)
         {
-            hr =
-                WriteSample(*m_compressor, std::move(sample), [this, &sampleSpec](const SampleRef& sample, HRESULT hr) {
+            hr = WriteSample(
+                *m_compressor, std::move(pending.Sample), [this, &sampleSpec](const SampleRef& sample, HRESULT hr) {
                     OnSampleWritten(sample, sampleSpec, hr);
                 });
         }
         else if (config.Output.Type == OutputSpec::Kind::Directory)
         {
             hr = WriteSample(
-                config.Output.Path, std::move(sample), [this, &sampleSpec](const SampleRef& sample, HRESULT hr) {
-                    OnSampleWritten(sample, sampleSpec, hr);
-                });
+                config.Output.Path,
+                std::move(pending.Sample),
+                [this, &sampleSpec](const SampleRef& sample, HRESULT hr) { OnSampleWritten(sample, sampleSpec, hr); });
         }
 
         if (FAILED(hr))
         {
             Log::Warn(L"Failed to add sample");
-            continue;
         }
     }
+
+    m_pendingSamples.clear();
+
+    // Compress the batch while the search goes on, its table rows are written as its samples are archived. Only the
+    // table, the statistics and the headers are then left for CloseArchiveOutput
+    if (config.Output.Type == OutputSpec::Kind::Archive)
+    {
+        FlushSamples();
+    }
+}
+
+void Main::DeduplicateSample(SampleRef& sample)
+{
+    if (sample.IsOfflimits())
+    {
+        return;
+    }
+
+    const auto& dataStream = sample.Matches.front()->MatchingAttributes[sample.AttributeIndex].DataStream;
+    const auto ullSize = dataStream->GetSize();
+    const bool bSmall = ullSize <= 2 * kDedupBlockSize;
+
+    CBinaryBuffer partial;
+    HRESULT hr = ::ComputeDedupHash(*dataStream, false, partial);
+    if (FAILED(hr))
+    {
+        Log::Debug(L"Failed to compute deduplication hash of '{}' [{}]", sample.SourcePath, SystemError(hr));
+        return;
+    }
+
+    auto& candidates = m_dedupCandidates[{ullSize, sample.Content.Type, std::string(std::string_view(partial))}];
+
+    // Small samples are fully hashed by the first pass
+    CBinaryBuffer full;
+    if (bSmall)
+    {
+        full = partial;
+    }
+
+    for (auto& candidate : candidates)
+    {
+        if (candidate.BLAKE3.empty())
+        {
+            hr = ::ComputeDedupHash(*candidate.DataStream, true, candidate.BLAKE3);
+            candidate.DataStream.reset();
+            if (FAILED(hr))
+            {
+                Log::Debug(L"Failed to compute hash of '{}' [{}]", candidate.SampleName, SystemError(hr));
+                continue;
+            }
+        }
+
+        if (full.empty())
+        {
+            hr = ::ComputeDedupHash(*dataStream, true, full);
+            if (FAILED(hr))
+            {
+                Log::Debug(L"Failed to compute hash of '{}' [{}]", sample.SourcePath, SystemError(hr));
+                return;
+            }
+        }
+
+        if (std::string_view(candidate.BLAKE3) == std::string_view(full))
+        {
+            sample.DuplicateOf = candidate.SampleName;
+
+            // Other hashes would require reading the data again
+            if (sample.Content.Type != ContentType::STRINGS
+                && HasFlag(config.CryptoHashAlgs, CryptoHashStream::Algorithm::BLAKE3))
+            {
+                sample.BLAKE3 = full;
+            }
+
+            return;
+        }
+    }
+
+    candidates.push_back({sample.SampleName, full.empty() ? dataStream : nullptr, std::move(full)});
+}
+
+void Main::ChunkSample(SampleRef& sample)
+{
+    // Strings are extracted from the data: their chunks are not comparable from one host to another
+    if (sample.IsOfflimits() || sample.IsDuplicate() || sample.Content.Type != ContentType::DATA)
+    {
+        return;
+    }
+
+    // Chunks are computed on a first read as the recipe header comes before the data, the stream is rewound for its
+    // collection like with deduplication
+    const auto& dataStream = sample.Matches.front()->MatchingAttributes[sample.AttributeIndex].DataStream;
+
+    auto chunkstream = std::make_shared<ChunkHashStream>();
+    HRESULT hr = chunkstream->OpenToWrite(nullptr);
+    if (SUCCEEDED(hr))
+    {
+        hr = ::HashStreamRange(*dataStream, 0, dataStream->GetSize(), *chunkstream);
+    }
+
+    HRESULT hrRewind = dataStream->SetFilePointer(0, FILE_BEGIN, nullptr);
+    if (SUCCEEDED(hr))
+    {
+        hr = hrRewind;
+    }
+
+    std::vector<ChunkHashStream::Chunk> chunks;
+    if (SUCCEEDED(hr))
+    {
+        hr = chunkstream->GetChunks(chunks);
+    }
+
+    if (FAILED(hr))
+    {
+        Log::Warn(
+            L"Failed to compute chunk hashes of '{}', collecting its data [{}]", sample.SourcePath, SystemError(hr));
+        return;
+    }
+
+    std::vector<bool> stored(chunks.size(), true);
+    if (m_knownChunks)
+    {
+        for (size_t i = 0; i < chunks.size(); i++)
+        {
+            const BufferView hash(chunks[i].SHA256.data(), chunks[i].SHA256.size());
+            stored[i] = !m_knownChunks->Contains(CryptoHashStream::Algorithm::SHA256, hash);
+        }
+    }
+
+    auto recipe = std::make_shared<ChunkRecipeStream>(sample.CopyStream, std::move(chunks), std::move(stored));
+    m_ullReferencedBytes += recipe->ReferencedBytes();
+
+    sample.CopyStream = std::move(recipe);
+    sample.SampleName += L".cdc";
 }
 
 HRESULT Main::FindMatchingSamples()
@@ -1427,6 +1958,13 @@ HRESULT Main::FindMatchingSamples()
         return hr;
     }
 
+    FileFinder.SetBlockCache(static_cast<size_t>(config.dwlBlockCache));
+    FileFinder.SetSkipUnchangedShadowRecords(config.bShadowsDelta);
+    FileFinder.SetKnownGood(m_knownGood, config.dwKnownGoodAudit);
+    UncompressWofStream::SetReadAhead(config.dwDecompressAhead);
+    UncompressNTFSStream::SetDecompressThreads(config.dwDecompressAhead);
+    WofChunkCache::Instance().SetMaxBytes(static_cast<size_t>(config.dwlWofCache));
+
     hr = FileFinder.Find(
         config.Locations,
         std::bind(&Main::OnMatchingSample, this, std::placeholders::_1, std::placeholders::_2),
@@ -1438,8 +1976,11 @@ HRESULT Main::FindMatchingSamples()
         Log::Error(L"Failed while parsing locations");
     }
 
+    WritePendingSamples();
+    CompleteSampleCopies(true);
+
     m_console.PrintNewLine();
-    ::PrintStatistics(m_console.OutputTree(), FileFinder.AllSearchTerms());
+    ::PrintStatistics(m_console.OutputTree(), FileFinder);
 
     return S_OK;
 }
@@ -1491,6 +2032,7 @@ HRESULT Main::Run()
     LoadWinTrust();
 
     GetSystemTimeAsFileTime(&CollectionDate);
+    m_collectionStart = std::chrono::steady_clock::now();
 
     try
     {
@@ -1511,6 +2053,34 @@ HRESULT Main::Run()
             return hr;
         }
 
+        if (!config.strKnownChunks.empty())
+        {
+            m_knownChunks = std::make_unique<HashList>();
+            hr = m_knownChunks->LoadFile(config.strKnownChunks);
+            if (FAILED(hr))
+            {
+                Log::Error(
+                    L"Failed to load known chunks '{}', all chunks are collected [{}]",
+                    config.strKnownChunks,
+                    SystemError(hr));
+                m_knownChunks.reset();
+            }
+        }
+
+        if (!config.strKnownGood.empty())
+        {
+            m_knownGood = std::make_shared<KnownGoodList>();
+            hr = m_knownGood->LoadFile(config.strKnownGood);
+            if (FAILED(hr))
+            {
+                Log::Error(
+                    L"Failed to load known good files '{}', all files are collected [{}]",
+                    config.strKnownGood,
+                    SystemError(hr));
+                m_knownGood.reset();
+            }
+        }
+
         hr = FindMatchingSamples();
         if (FAILED(hr))
         {
@@ -1518,11 +2088,35 @@ HRESULT Main::Run()
             return hr;
         }
 
+        if (m_knownGood)
+        {
+            const auto& stats = FileFinder.GetKnownGoodStatistics();
+            Log::Info(
+                L"Known good files: {} not collected, {} collected for audit, {} content checks skipped, {} audited "
+                L"({} matched)",
+                m_ullKnownGoodSeen - m_ullKnownGoodAudited,
+                m_ullKnownGoodAudited,
+                stats.Skipped,
+                stats.Audited,
+                stats.AuditMatches);
+        }
+
+        if (m_knownChunks)
+        {
+            Log::Info(L"Chunks known to the server: {} bytes of samples were only referenced", m_ullReferencedBytes);
+        }
+
         hr = CloseOutput();
         if (FAILED(hr))
         {
             Log::Error(L"Failed to close output [{}]", SystemError(hr));
         }
+
+        if (WofChunkCache::Instance().IsEnabled())
+        {
+            WofChunkCache::Instance().LogStatistics();
+            WofChunkCache::Instance().SetMaxBytes(0);
+        }
     }
     catch (...)
     {
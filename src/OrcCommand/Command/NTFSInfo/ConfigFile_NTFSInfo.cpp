@@ -51,5 +51,29 @@ HRESULT Orc::Config::NTFSInfo::root(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddAttribute(L"popsysobj", NTFSINFO_POP_SYS_OBJ, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = item.AddAttribute(L"workers", NTFSINFO_WORKERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"outoforder", NTFSINFO_OUT_OF_ORDER, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"concurrentvolumes", NTFSINFO_CONCURRENT_VOLUMES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"concurrentshadows", NTFSINFO_CONCURRENT_SHADOWS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"usnbuffer", NTFSINFO_USN_BUFFER, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"shadowsdelta", NTFSINFO_SHADOWS_DELTA, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"columnworkers", NTFSINFO_COLUMN_WORKERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"authenticodeworkers", NTFSINFO_AUTHENTICODE_WORKERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"sorttimeline", NTFSINFO_SORT_TIMELINE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"checkpoint", NTFSINFO_CHECKPOINT, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"checkpointinterval", NTFSINFO_CHECKPOINT_INTERVAL, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"knowngood", NTFSINFO_KNOWNGOOD, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
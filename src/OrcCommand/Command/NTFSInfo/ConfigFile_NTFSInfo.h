@@ -27,6 +27,18 @@ constexpr auto NTFSINFO_WALKER = 10L;
 constexpr auto NTFSINFO_RESURRECT = 11L;
 constexpr auto NTFSINFO_COMPUTER = 12L;
 constexpr auto NTFSINFO_POP_SYS_OBJ = 13L;
+constexpr auto NTFSINFO_WORKERS = 14L;
+constexpr auto NTFSINFO_OUT_OF_ORDER = 15L;
+constexpr auto NTFSINFO_CONCURRENT_VOLUMES = 16L;
+constexpr auto NTFSINFO_USN_BUFFER = 17L;
+constexpr auto NTFSINFO_SHADOWS_DELTA = 18L;
+constexpr auto NTFSINFO_COLUMN_WORKERS = 19L;
+constexpr auto NTFSINFO_AUTHENTICODE_WORKERS = 20L;
+constexpr auto NTFSINFO_SORT_TIMELINE = 21L;
+constexpr auto NTFSINFO_CONCURRENT_SHADOWS = 22L;
+constexpr auto NTFSINFO_CHECKPOINT = 23L;
+constexpr auto NTFSINFO_CHECKPOINT_INTERVAL = 24L;
+constexpr auto NTFSINFO_KNOWNGOOD = 25L;
 
 namespace Orc::Config::NTFSInfo {
 HRESULT root(ConfigItem& item);
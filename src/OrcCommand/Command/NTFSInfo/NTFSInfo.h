@@ -9,8 +9,12 @@
 
 #include "UtilitiesMain.h"
 
+#include <atomic>
+#include <mutex>
 #include <optional>
 
+#include <concrt.h>
+
 #include <boost/logic/tribool.hpp>
 
 #include "OrcCommand.h"
@@ -20,6 +24,10 @@
 #include "MFTWalker.h"
 #include "NtfsFileInfo.h"
 #include "Authenticode.h"
+#include "AuthenticodePool.h"
+#include "ExternalSort.h"
+#include "MFTWalkCheckpoint.h"
+#include "KnownGoodList.h"
 #include "Configuration/ShadowsParserOption.h"
 
 #pragma managed(push, off)
@@ -29,6 +37,7 @@ namespace Orc {
 class DataAttribute;
 class MftRecordAttribute;
 class AttributeListEntry;
+class FileInfoPool;
 
 namespace Command::NTFSInfo {
 
@@ -106,6 +115,41 @@ public:
         boost::logic::tribool bPopSystemObjects;
         std::optional<LocationSet::PathExcludes> m_excludes;
 
+        // MFT walker pipeline: 0 worker keeps the single threaded walk
+        DWORD dwWalkerWorkers = 0L;
+        bool bWalkerOutOfOrder = false;
+
+        // Shadow copies: only output the records which are not the same on the live volume
+        bool bShadowsDelta = false;
+
+        // Number of volumes walked at the same time (0 or 1: one volume after the other)
+        DWORD dwConcurrentVolumes = 0L;
+
+        // Number of shadow copies of a volume walked at the same time (0: as many as volumes)
+        DWORD dwConcurrentShadows = 0L;
+
+        // Batch of offline inputs (directory or manifest), each one with its own output
+        std::wstring strBatch;
+
+        // USN walker pipeline: size of each journal request (0 keeps the serial walk), dwWalkerWorkers requests ahead
+        DWORD dwUSNBufferSize = 0L;
+
+        // Threads evaluating the data columns of file information rows (0: evaluated by the walker)
+        DWORD dwColumnWorkers = 0L;
+
+        // Threads verifying the authenticode signatures of the rows evaluated by the walker (0: verified in place)
+        DWORD dwAuthenticodeWorkers = 0L;
+
+        // Memory (in bytes) used to sort the timeline rows of each volume by time (0: rows written in walk order)
+        ULONGLONG ullTimelineSortBudget = 0LL;
+
+        // Progress of the MFT walks saved every dwCheckpointInterval seconds: a run killed before its end resumes there
+        std::wstring strCheckpoint;
+        DWORD dwCheckpointInterval = 60L;
+
+        // Files of this list are not hashed and their signature is not verified (see KnownGoodList)
+        std::wstring strKnownGood;
+
         Intentions ColumnIntentions;
         Intentions DefaultIntentions;
         std::vector<Filter> Filters;
@@ -113,8 +157,24 @@ public:
     };
 
 private:
+    // Timeline row kept by the sort of a volume's timeline, the other columns are the same for all its rows
+    struct TimelineRow
+    {
+        ULONGLONG Time;
+        ULONGLONG FRN;
+        DWORD Kind;
+        USHORT FileNameID;
+
+        bool operator<(const TimelineRow& other) const { return Time < other.Time; }
+    };
+
+    using TimelineSort = ExternalSort<TimelineRow>;
+
     Configuration config;
 
+    // Columns of the file information rows, compiled once for all of them
+    const NtfsFileInfo::ColumnPlan m_ColumnPlan = NtfsFileInfo::CompileColumnPlan(NtfsFileInfo::g_NtfsColumnNames);
+
     MultipleOutput<LocationOutput> m_FileInfoOutput;
     MultipleOutput<LocationOutput> m_VolStatOutput;
 
@@ -123,13 +183,24 @@ private:
     MultipleOutput<LocationOutput> m_I30Output;
     MultipleOutput<LocationOutput> m_SecDescrOutput;
 
-    MFTWalker::FullNameBuilder m_FullNameBuilder;
-    DWORD dwTotalFileTreated;
+    std::atomic<DWORD> dwTotalFileTreated;
     DWORD m_dwProgress;
 
+    // Serializes console output of concurrent volume walks
+    concurrency::critical_section m_consoleLock;
+
     std::shared_ptr<AuthenticodeCache> m_authenticodeCache;
     Authenticode m_codeVerifier;
 
+    // Shared by the walks of all the volumes, when configured
+    std::unique_ptr<AuthenticodePool> m_authenticodePool;
+
+    std::unique_ptr<KnownGoodList> m_knownGood;
+
+    // Progress of the walks saved to config.strCheckpoint, by all the concurrent walks
+    MFTWalkCheckpoint m_checkpoint;
+    std::mutex m_checkpointLock;
+
     HRESULT Prepare();
     HRESULT GetWriters(std::vector<std::shared_ptr<Location>>& locs);
 
@@ -144,6 +215,7 @@ private:
 
     HRESULT WriteTimeLineEntry(
         ITableOutput& pTimelineOutput,
+        TimelineSort* pTimelineSort,
         const std::shared_ptr<VolumeReader>& volreader,
         MFTRecord* pElt,
         const PFILE_NAME pFileName,
@@ -152,12 +224,18 @@ private:
 
     HRESULT WriteTimeLineEntry(
         ITableOutput& pTimelineOutput,
+        TimelineSort* pTimelineSort,
         const std::shared_ptr<VolumeReader>& volreader,
         MFTRecord* pElt,
         const PFILE_NAME pFileName,
         DWORD dwKind,
         FILETIME time);
 
+    HRESULT WriteTimeLineRow(
+        ITableOutput& pTimelineOutput,
+        const std::shared_ptr<VolumeReader>& volreader,
+        const TimelineRow& row);
+
     std::wstring GetWalkerFromConfig(const ConfigItem& config);
     boost::logic::tribool GetPopulateSystemObjectsFromConfig(const ConfigItem& config);
 
@@ -166,6 +244,14 @@ private:
     HRESULT RunThroughUSNJournal();
     HRESULT RunThroughMFT();
 
+    HRESULT ResumeFromCheckpoint(std::vector<std::shared_ptr<Location>>& locations);
+    HRESULT SaveCheckpoint(const std::wstring& strLocation, const MFTWalkCheckpoint::Location& location, size_t index);
+    HRESULT WalkLocation(
+        const std::shared_ptr<Location>& loc,
+        size_t index,
+        Authenticode& codeVerifier,
+        bool bDisplayProgress);
+
     // USN Walkercallback
     void USNInformation(
         const std::shared_ptr<TableOutput::IWriter>& pWriter,
@@ -175,15 +261,26 @@ private:
 
     // MFT Walker call backs
     void DisplayProgress(const ULONG dwProgress);
-    void ElementInformation(ITableOutput& output, const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt);
+    void ElementInformation(
+        ITableOutput& output,
+        TimelineSort* pTimelineSort,
+        const std::shared_ptr<VolumeReader>& volreader,
+        MFTRecord* pElt);
     void DirectoryInformation(
         ITableOutput& output,
+        const MFTWalker::FullNameBuilder& fullNameBuilder,
+        Authenticode& codeVerifier,
+        SecurityDescriptorTable* pSecurityDescriptors,
         const std::shared_ptr<VolumeReader>& volreader,
         MFTRecord* pElt,
         const PFILE_NAME pFileName,
         const std::shared_ptr<IndexAllocationAttribute>& pAttr);
     void FileAndDataInformation(
         ITableOutput& output,
+        const MFTWalker::FullNameBuilder& fullNameBuilder,
+        Authenticode& codeVerifier,
+        SecurityDescriptorTable* pSecurityDescriptors,
+        FileInfoPool* pFileInfoPool,
         const std::shared_ptr<VolumeReader>& volreader,
         MFTRecord* pElt,
         const PFILE_NAME pFileName,
@@ -202,6 +299,7 @@ private:
         bool bCarvedEntry);
     void TimelineInformation(
         ITableOutput& output,
+        TimelineSort* pTimelineSort,
         const std::shared_ptr<VolumeReader>& volreader,
         MFTRecord* pElt,
         const PFILE_NAME pFileName);
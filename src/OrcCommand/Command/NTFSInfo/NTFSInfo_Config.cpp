@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <thread>
 
 using namespace std;
 
@@ -26,6 +27,31 @@ using namespace Orc::Command::NTFSInfo;
 using namespace Orc::Command;
 using namespace Orc;
 
+namespace {
+
+// Output files cut where a checkpoint was saved and continued by the next run: tables of text rows
+bool IsCheckpointOutput(const OutputSpec& output)
+{
+    if (output.IsSharded())
+        return false;
+
+    switch (output.Type)
+    {
+        case OutputSpec::Kind::None:
+        case OutputSpec::Kind::TableFile:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::CSV:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::TSV:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::JSONL:
+            return true;
+        case OutputSpec::Kind::Directory:
+            return output.TableFormat == OutputSpec::Kind::CSV || output.TableFormat == OutputSpec::Kind::JSONL;
+        default:
+            return false;
+    }
+}
+
+}  // namespace
+
 ConfigItem::InitFunction Main::GetXmlConfigBuilder()
 {
     return Orc::Config::NTFSInfo::root;
@@ -215,6 +241,132 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
         }
     }
 
+    if (configitem[NTFSINFO_WORKERS])
+    {
+        if (auto hrWorkers = GetIntegerFromArg(configitem[NTFSINFO_WORKERS].c_str(), config.dwWalkerWorkers);
+            FAILED(hrWorkers))
+        {
+            Log::Error(
+                L"Failed to parse 'workers' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_WORKERS].c_str(),
+                SystemError(hrWorkers));
+        }
+    }
+
+    if (configitem[NTFSINFO_OUT_OF_ORDER])
+    {
+        using namespace std::string_view_literals;
+        const auto YES = L"yes"sv;
+        config.bWalkerOutOfOrder =
+            equalCaseInsensitive((const std::wstring&)configitem[NTFSINFO_OUT_OF_ORDER], YES, YES.size());
+    }
+
+    if (configitem[NTFSINFO_SHADOWS_DELTA])
+    {
+        using namespace std::string_view_literals;
+        const auto YES = L"yes"sv;
+        config.bShadowsDelta =
+            equalCaseInsensitive((const std::wstring&)configitem[NTFSINFO_SHADOWS_DELTA], YES, YES.size());
+    }
+
+    if (configitem[NTFSINFO_CONCURRENT_VOLUMES])
+    {
+        if (auto hrVolumes =
+                GetIntegerFromArg(configitem[NTFSINFO_CONCURRENT_VOLUMES].c_str(), config.dwConcurrentVolumes);
+            FAILED(hrVolumes))
+        {
+            Log::Error(
+                L"Failed to parse 'concurrentvolumes' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_CONCURRENT_VOLUMES].c_str(),
+                SystemError(hrVolumes));
+        }
+    }
+
+    if (configitem[NTFSINFO_CONCURRENT_SHADOWS])
+    {
+        if (auto hrShadows =
+                GetIntegerFromArg(configitem[NTFSINFO_CONCURRENT_SHADOWS].c_str(), config.dwConcurrentShadows);
+            FAILED(hrShadows))
+        {
+            Log::Error(
+                L"Failed to parse 'concurrentshadows' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_CONCURRENT_SHADOWS].c_str(),
+                SystemError(hrShadows));
+        }
+    }
+
+    if (configitem[NTFSINFO_USN_BUFFER])
+    {
+        if (auto hrBuffer = GetIntegerFromArg(configitem[NTFSINFO_USN_BUFFER].c_str(), config.dwUSNBufferSize);
+            FAILED(hrBuffer))
+        {
+            Log::Error(
+                L"Failed to parse 'usnbuffer' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_USN_BUFFER].c_str(),
+                SystemError(hrBuffer));
+        }
+    }
+
+    if (configitem[NTFSINFO_COLUMN_WORKERS])
+    {
+        if (auto hrWorkers = GetIntegerFromArg(configitem[NTFSINFO_COLUMN_WORKERS].c_str(), config.dwColumnWorkers);
+            FAILED(hrWorkers))
+        {
+            Log::Error(
+                L"Failed to parse 'columnworkers' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_COLUMN_WORKERS].c_str(),
+                SystemError(hrWorkers));
+        }
+    }
+
+    if (configitem[NTFSINFO_AUTHENTICODE_WORKERS])
+    {
+        if (auto hrWorkers = GetIntegerFromArg(
+                configitem[NTFSINFO_AUTHENTICODE_WORKERS].c_str(), config.dwAuthenticodeWorkers);
+            FAILED(hrWorkers))
+        {
+            Log::Error(
+                L"Failed to parse 'authenticodeworkers' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_AUTHENTICODE_WORKERS].c_str(),
+                SystemError(hrWorkers));
+        }
+    }
+
+    if (configitem[NTFSINFO_SORT_TIMELINE])
+    {
+        LARGE_INTEGER budget {0};
+        if (auto hrBudget = GetFileSizeFromArg(configitem[NTFSINFO_SORT_TIMELINE].c_str(), budget); FAILED(hrBudget))
+        {
+            Log::Error(
+                L"Failed to parse 'sorttimeline' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_SORT_TIMELINE].c_str(),
+                SystemError(hrBudget));
+        }
+        else
+        {
+            config.ullTimelineSortBudget = budget.QuadPart;
+        }
+    }
+
+    if (configitem[NTFSINFO_CHECKPOINT])
+        config.strCheckpoint = configitem[NTFSINFO_CHECKPOINT];
+
+    if (configitem[NTFSINFO_CHECKPOINT_INTERVAL])
+    {
+        if (auto hrInterval =
+                GetIntegerFromArg(configitem[NTFSINFO_CHECKPOINT_INTERVAL].c_str(), config.dwCheckpointInterval);
+            FAILED(hrInterval))
+        {
+            Log::Error(
+                L"Failed to parse 'checkpointinterval' attribute (value: {}) [{}]",
+                configitem[NTFSINFO_CHECKPOINT_INTERVAL].c_str(),
+                SystemError(hrInterval));
+        }
+    }
+
+    if (configitem[NTFSINFO_KNOWNGOOD])
+        config.strKnownGood = configitem[NTFSINFO_KNOWNGOOD];
+
     config.bGetKnownLocations = GetKnownLocationFromConfig(configitem);
     config.bPopSystemObjects = GetPopulateSystemObjectsFromConfig(configitem);
 
@@ -330,6 +482,32 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                         ;
                     else if (ParameterOption(argv[i] + 1, L"PopSysObj", config.bPopSystemObjects))
                         ;
+                    else if (ParameterOption(argv[i] + 1, L"Workers", config.dwWalkerWorkers))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"OutOfOrder", config.bWalkerOutOfOrder))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"ShadowsDelta", config.bShadowsDelta))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"ConcurrentVolumes", config.dwConcurrentVolumes))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"ConcurrentShadows", config.dwConcurrentShadows))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"Batch", config.strBatch))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"USNBuffer", config.dwUSNBufferSize))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"ColumnWorkers", config.dwColumnWorkers))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"AuthenticodeWorkers", config.dwAuthenticodeWorkers))
+                        ;
+                    else if (FileSizeOption(argv[i] + 1, L"SortTimeline", config.ullTimelineSortBudget))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"CheckpointInterval", config.dwCheckpointInterval))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"Checkpoint", config.strCheckpoint))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"KnownGood", config.strKnownGood))
+                        ;
                     else if (EncodingOption(argv[i] + 1, config.outFileInfo.OutputEncoding))
                     {
                         config.outI30Info.OutputEncoding = config.outAttrInfo.OutputEncoding =
@@ -396,6 +574,15 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
     if (FAILED(hr = config.locs.AddLocationsFromArgcArgv(argc, argv)))
         return hr;
 
+    if (!config.strBatch.empty())
+    {
+        if (FAILED(hr = config.locs.AddLocationsFromBatch(config.strBatch, config.InputLocations)))
+        {
+            Log::Critical(L"Failed to read batch '{}' [{}]", config.strBatch, SystemError(hr));
+            return hr;
+        }
+    }
+
     if (FAILED(
             hr = FileInfoCommon::GetFiltersFromArgcArgv(
                 argc, argv, config.Filters, NtfsFileInfo::g_NtfsAliasNames, NtfsFileInfo::g_NtfsColumnNames)))
@@ -454,6 +641,20 @@ HRESULT Main::CheckConfiguration()
         config.outFileInfo.OutputEncoding = OutputSpec::Encoding::UTF8;
     }
 
+    if (!config.strBatch.empty())
+    {
+        if (config.outFileInfo.Type != OutputSpec::Kind::Directory
+            && config.outFileInfo.Type != OutputSpec::Kind::Archive)
+        {
+            Log::Critical("Batch mode writes one output per input: a directory or archive output is required");
+            return E_INVALIDARG;
+        }
+
+        // Inputs are independent, a few of them are walked at the same time unless told otherwise
+        if (config.dwConcurrentVolumes == 0)
+            config.dwConcurrentVolumes = std::clamp(std::thread::hardware_concurrency(), 1U, 4U);
+    }
+
     if (config.outFileInfo.Type == OutputSpec::Kind::Directory || config.outFileInfo.Type == OutputSpec::Kind::Archive)
     {
         config.volumesStatsOutput.Path = config.outFileInfo.Path;
@@ -471,6 +672,29 @@ HRESULT Main::CheckConfiguration()
     if (config.strWalker.empty())
         config.strWalker = L"MFT";
 
+    if (!config.strCheckpoint.empty())
+    {
+        if (config.strWalker.compare(L"MFT"))
+        {
+            Log::Warn(L"Checkpoints are only saved by the MFT walker: ignoring '/Checkpoint'");
+            config.strCheckpoint.clear();
+        }
+        else if (
+            !IsCheckpointOutput(config.outFileInfo) || !IsCheckpointOutput(config.outAttrInfo)
+            || !IsCheckpointOutput(config.outI30Info) || !IsCheckpointOutput(config.outTimeLine)
+            || !IsCheckpointOutput(config.outSecDescrInfo))
+        {
+            Log::Warn(
+                L"Checkpoints require unsharded CSV or JSON lines outputs to files or directories: ignoring "
+                L"'/Checkpoint'");
+            config.strCheckpoint.clear();
+        }
+        else if (config.dwCheckpointInterval == 0)
+        {
+            config.dwCheckpointInterval = 60L;
+        }
+    }
+
     config.ColumnIntentions = static_cast<Intentions>(
         config.DefaultIntentions
         | (config.Filters.empty() ? Intentions::FILEINFO_NONE : NtfsFileInfo::GetFilterIntentions(config.Filters)));
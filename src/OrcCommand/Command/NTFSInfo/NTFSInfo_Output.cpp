@@ -50,13 +50,32 @@ void Main::PrintUsage()
 
     Usage::PrintOutputParameters(usageNode, kCustomOutputParameters);
 
-    constexpr std::array kCustomLocationsParameters = {Usage::kKnownLocations};
+    constexpr std::array kCustomLocationsParameters = {Usage::kKnownLocations, Usage::kBatch};
     Usage::PrintLocationParameters(usageNode, kCustomLocationsParameters);
 
     {
         constexpr std::array kCustomMiscParameters = {
             Usage::kMiscParameterComputer,
             Usage::kMiscParameterResurrectRecords,
+            Usage::kMiscParameterWalkerWorkers,
+            Usage::kMiscParameterWalkerOutOfOrder,
+            Usage::kMiscParameterShadowsDelta,
+            Usage::kMiscParameterConcurrentVolumes,
+            Usage::kMiscParameterConcurrentShadows,
+            Usage::kMiscParameterUSNBuffer,
+            Usage::kMiscParameterColumnWorkers,
+            Usage::kMiscParameterAuthenticodeWorkers,
+            Usage::Parameter {
+                "/SortTimeline=<Bytes>",
+                "Memory used to sort the timeline rows of each volume by time, using temporary files beyond it"},
+            Usage::Parameter {
+                "/Checkpoint=<FilePath>",
+                "Save the progress of the walks to this file: a run killed before its end resumes from it"},
+            Usage::Parameter {"/CheckpointInterval=<Seconds>", "Seconds between two checkpoints (default: 60)"},
+            Usage::Parameter {
+                "/KnownGood=<FilePath>",
+                "List of known good files (size, name and optional SHA1 of the first 4KB): they are not hashed and "
+                "their signature is not verified"},
             Usage::Parameter {"/SecDecr=<FilePath>", "Security Descriptor information for the volume"}};
         Usage::PrintMiscellaneousParameters(usageNode, kCustomMiscParameters);
     }
@@ -81,6 +100,61 @@ void Main::PrintParameters()
 
     PrintValues(node, L"Parsed locations", config.locs.GetParsedLocations());
 
+    if (!config.strBatch.empty())
+    {
+        PrintValue(node, L"Batch", config.strBatch);
+    }
+
+    if (config.dwWalkerWorkers > 0)
+    {
+        PrintValue(node, L"Walker workers", config.dwWalkerWorkers);
+        PrintValue(node, L"Walker out of order", config.bWalkerOutOfOrder);
+    }
+
+    if (config.bShadowsDelta)
+    {
+        PrintValue(node, L"Shadows delta", config.bShadowsDelta);
+    }
+
+    if (config.dwConcurrentVolumes > 1)
+    {
+        PrintValue(node, L"Concurrent volumes", config.dwConcurrentVolumes);
+    }
+
+    if (config.dwConcurrentShadows > 1)
+    {
+        PrintValue(node, L"Concurrent shadows", config.dwConcurrentShadows);
+    }
+
+    if (config.dwUSNBufferSize > 0)
+    {
+        PrintValue(node, L"USN buffer size", config.dwUSNBufferSize);
+    }
+
+    if (config.dwColumnWorkers > 0)
+    {
+        PrintValue(node, L"Column workers", config.dwColumnWorkers);
+    }
+
+    if (config.dwAuthenticodeWorkers > 0)
+    {
+        PrintValue(node, L"Authenticode workers", config.dwAuthenticodeWorkers);
+    }
+
+    if (config.ullTimelineSortBudget > 0)
+    {
+        PrintValue(node, L"Timeline sort memory", Traits::ByteQuantity(config.ullTimelineSortBudget));
+    }
+
+    if (!config.strCheckpoint.empty())
+    {
+        PrintValue(node, L"Checkpoint", config.strCheckpoint);
+        PrintValue(node, L"Checkpoint interval (seconds)", config.dwCheckpointInterval);
+    }
+
+    if (!config.strKnownGood.empty())
+        PrintValue(node, L"Known good list", config.strKnownGood);
+
     PrintValue(node, L"Output columns", config.ColumnIntentions, NtfsFileInfo::g_NtfsColumnNames);
     PrintValue(node, L"Default columns", config.DefaultIntentions, NtfsFileInfo::g_NtfsColumnNames);
     PrintValue(node, L"Filters", config.Filters, NtfsFileInfo::g_NtfsColumnNames);
@@ -94,7 +168,7 @@ void Main::PrintFooter()
 
     auto root = m_console.OutputTree();
     auto node = root.AddNode("Statistics");
-    PrintValue(node, L"Lines processed", dwTotalFileTreated);
+    PrintValue(node, L"Lines processed", dwTotalFileTreated.load());
     PrintCommonFooter(node);
 
     m_console.PrintNewLine();
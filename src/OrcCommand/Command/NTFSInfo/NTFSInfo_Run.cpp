@@ -16,11 +16,24 @@
 
 #include <Sddl.h>
 
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 #include "NTFSInfo.h"
 
 #include "USNJournalWalker.h"
 #include "USNRecordFileInfo.h"
+#include "FileDirectory.h"
 #include "MFTRecordFileInfo.h"
+#include "FileInfoPool.h"
 #include "MountedVolumeReader.h"
 #include "MFTWalker.h"
 #include "SystemDetails.h"
@@ -28,6 +41,8 @@
 #include "ParameterCheck.h"
 #include "Privilege.h"
 #include "EmbeddedResource.h"
+#include "Utils/Guard.h"
+#include "Text/Fmt/std_filesystem.h"
 #include "Text/Print/Location.h"
 #include "Text/Print/LocationSet.h"
 
@@ -36,6 +51,168 @@ using namespace std;
 using namespace Orc;
 using namespace Orc::Command::NTFSInfo;
 
+namespace {
+
+// Larger files have their data columns evaluated by the walker
+constexpr auto kMaxPooledFileSize = 32 * 1024 * 1024ULL;
+
+// Data read for the column workers and not evaluated yet
+constexpr auto kMaxPooledPendingBytes = 256 * 1024 * 1024ULL;
+
+// Security descriptor rows are walked with the $Secure record
+constexpr ULONGLONG kSecureRecord = 9ULL;
+
+// Records of a serial walk whose rows were all written: the walker calls back for each record in turn, the previous
+// record is complete when it calls back for another one. Checkpoints are saved at these boundaries.
+class CheckpointRecords
+{
+public:
+    using SaveCall = std::function<void(const MFTWalkCheckpoint::RecordSet& written)>;
+
+    CheckpointRecords(const MFTWalkCheckpoint::RecordSet& previous, DWORD dwIntervalSeconds, SaveCall save)
+        : m_previous(previous)
+        , m_written(previous)
+        , m_ullInterval(dwIntervalSeconds * 1000ULL)
+        , m_ullNextSave(GetTickCount64() + m_ullInterval)
+        , m_save(std::move(save))
+    {
+    }
+
+    // False when the rows of the record were written by a previous run
+    bool Enter(ULONGLONG ullRecord)
+    {
+        if (m_ullCurrent && *m_ullCurrent == ullRecord)
+            return !m_bSkipCurrent;
+
+        if (m_ullCurrent)
+            m_written.Insert(*m_ullCurrent);
+
+        if (const auto ullNow = GetTickCount64(); ullNow >= m_ullNextSave)
+        {
+            m_save(m_written);
+            m_ullNextSave = ullNow + m_ullInterval;
+        }
+
+        m_ullCurrent = ullRecord;
+        m_bSkipCurrent = m_previous.Contains(ullRecord);
+        if (m_bSkipCurrent)
+            m_ullSkipped++;
+
+        return !m_bSkipCurrent;
+    }
+
+    ULONGLONG Skipped() const { return m_ullSkipped; }
+
+private:
+    // A copy: the checkpoint's own set is updated as this walk progresses
+    const MFTWalkCheckpoint::RecordSet m_previous;
+    MFTWalkCheckpoint::RecordSet m_written;
+    const ULONGLONG m_ullInterval;
+    ULONGLONG m_ullNextSave;
+    SaveCall m_save;
+
+    std::optional<ULONGLONG> m_ullCurrent;
+    bool m_bSkipCurrent = false;
+    ULONGLONG m_ullSkipped = 0LL;
+};
+
+// Callbacks of the records written by a previous run are not called
+template <typename Call>
+void SkipWrittenRecords(Call& call, CheckpointRecords& records)
+{
+    if (call == nullptr)
+        return;
+
+    call = [call = std::move(call), &records](
+               const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt, auto&&... args) {
+        if (records.Enter(pElt->GetSafeMFTSegmentNumber()))
+            call(volreader, pElt, std::forward<decltype(args)>(args)...);
+    };
+}
+
+std::optional<std::wstring>
+GetOutputFilePath(const OutputSpec& output, const Command::UtilitiesMain::OutputInfo& info)
+{
+    if (!info.Path())
+        return std::nullopt;
+
+    if (output.Type == OutputSpec::Kind::Directory)
+        return output.Path + L"\\" + *info.Path();
+
+    return *info.Path();
+}
+
+// Cut an output file of a previous run to its size when its checkpoint was saved: the rows which follow are written
+// again. It is then renamed '<name>.part<N><ext>' so that the outputs of this run do not overwrite it.
+HRESULT SetAsidePreviousOutput(const std::filesystem::path& path, ULONGLONG ullSize)
+{
+    {
+        Guard::FileHandle hFile = CreateFileW(
+            path.c_str(), GENERIC_WRITE, 0L, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (!hFile.IsValid())
+        {
+            const auto hr = HRESULT_FROM_WIN32(GetLastError());
+            if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) || hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND))
+            {
+                Log::Warn(L"Output '{}' of the previous run is missing, its rows are lost", path);
+                return S_FALSE;
+            }
+
+            Log::Error(L"Failed to open output '{}' of the previous run [{}]", path, SystemError(hr));
+            return hr;
+        }
+
+        LARGE_INTEGER liFileSize {0};
+        if (!GetFileSizeEx(*hFile, &liFileSize))
+        {
+            const auto hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to get size of output '{}' [{}]", path, SystemError(hr));
+            return hr;
+        }
+
+        if (static_cast<ULONGLONG>(liFileSize.QuadPart) > ullSize)
+        {
+            LARGE_INTEGER liSize;
+            liSize.QuadPart = ullSize;
+            if (!SetFilePointerEx(*hFile, liSize, NULL, FILE_BEGIN) || !SetEndOfFile(*hFile))
+            {
+                const auto hr = HRESULT_FROM_WIN32(GetLastError());
+                Log::Error(L"Failed to cut output '{}' to {} bytes [{}]", path, ullSize, SystemError(hr));
+                return hr;
+            }
+
+            Log::Debug(
+                L"Output '{}' cut to its checkpoint ({} bytes written after it)",
+                path,
+                liFileSize.QuadPart - ullSize);
+        }
+    }
+
+    for (DWORD i = 1; i < 1000; i++)
+    {
+        auto partPath = path;
+        partPath.replace_extension(fmt::format(L"part{}{}", i, path.extension().wstring()));
+
+        if (MoveFileExW(path.c_str(), partPath.c_str(), MOVEFILE_WRITE_THROUGH))
+        {
+            Log::Info(L"Rows of the previous run kept in '{}'", partPath);
+            return S_OK;
+        }
+
+        if (const auto dwError = GetLastError(); dwError != ERROR_ALREADY_EXISTS && dwError != ERROR_FILE_EXISTS)
+        {
+            const auto hr = HRESULT_FROM_WIN32(dwError);
+            Log::Error(L"Failed to rename output '{}' of the previous run [{}]", path, SystemError(hr));
+            return hr;
+        }
+    }
+
+    Log::Error(L"Failed to rename output '{}' of the previous run: too many parts", path);
+    return HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS);
+}
+
+}  // namespace
+
 HRESULT Main::RunThroughUSNJournal()
 {
     HRESULT hr = E_FAIL;
@@ -77,7 +254,10 @@ HRESULT Main::RunThroughUSNJournal()
 
     callbacks.ProgressCallback = [this](const ULONG dwProgress) { DisplayProgress(dwProgress); };
 
-    callbacks.RecordCallback = [this, pFileInfoWriter](
+    // Records are looked up in their parent directory, enumerated once for the following records of the directory
+    auto directoryCache = std::make_shared<FileIdDirectoryCache>();
+
+    callbacks.RecordCallback = [this, pFileInfoWriter, directoryCache](
                                    std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {
         std::shared_ptr<MountedVolumeReader> mountedVolReader = dynamic_pointer_cast<MountedVolumeReader>(volreader);
 
@@ -86,6 +266,11 @@ HRESULT Main::RunThroughUSNJournal()
             return;
         }
 
+        if (directoryCache->Volume() != volreader->GetDevice())
+        {
+            directoryCache->Reset(volreader->GetDevice());
+        }
+
         try
         {
             USNRecordFileInfo fi(
@@ -97,7 +282,11 @@ HRESULT Main::RunThroughUSNJournal()
                 pElt,
                 m_codeVerifier);
 
-            HRESULT hr = fi.WriteFileInformation(NtfsFileInfo::g_NtfsColumnNames, *pFileInfoWriter, config.Filters);
+            fi.SetAuthenticodePool(m_authenticodePool.get());
+            fi.SetDirectoryCache(directoryCache.get());
+            fi.SetKnownGood(m_knownGood.get());
+
+            HRESULT hr = fi.WriteFileInformation(m_ColumnPlan, *pFileInfoWriter, config.Filters);
             if (FAILED(hr))
             {
                 Log::Error(L"Could not WriteFileInformation for '{}'", szFullName);
@@ -125,7 +314,12 @@ HRESULT Main::RunThroughUSNJournal()
         if (config.outFileInfo.Type == OutputSpec::Kind::Directory)
         {
             WCHAR szOutputFile[ORC_MAX_PATH];
-            StringCchPrintf(szOutputFile, ORC_MAX_PATH, L"NTFSInfo_%s_.csv", loc->GetIdentifier().c_str());
+            StringCchPrintf(
+                szOutputFile,
+                ORC_MAX_PATH,
+                L"NTFSInfo_%s_%s",
+                loc->GetIdentifier().c_str(),
+                config.outFileInfo.TableExtension());
             if (nullptr == (pFileInfoWriter = TableOutput::GetWriter(szOutputFile, config.outFileInfo)))
             {
                 Log::Error("Failed to create output file information file");
@@ -136,6 +330,11 @@ HRESULT Main::RunThroughUSNJournal()
         USNJournalWalker walk;
         HRESULT hr = E_FAIL;
 
+        if (config.dwUSNBufferSize > 0)
+        {
+            walk.SetPipeline(config.dwUSNBufferSize, config.dwWalkerWorkers);
+        }
+
         if (FAILED(hr = walk.Initialize(loc)))
         {
             if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
@@ -198,6 +397,10 @@ void Main::DisplayProgress(const ULONG dwProgress)
 
 void Main::FileAndDataInformation(
     ITableOutput& output,
+    const MFTWalker::FullNameBuilder& fullNameBuilder,
+    Authenticode& codeVerifier,
+    SecurityDescriptorTable* pSecurityDescriptors,
+    FileInfoPool* pFileInfoPool,
     const std::shared_ptr<VolumeReader>& volreader,
     MFTRecord* pElt,
     const PFILE_NAME pFileName,
@@ -205,7 +408,7 @@ void Main::FileAndDataInformation(
 {
     try
     {
-        const WCHAR* szFullName = m_FullNameBuilder(pFileName, pDataAttr);
+        const WCHAR* szFullName = fullNameBuilder(pFileName, pDataAttr);
 
         MFTRecordFileInfo fi(
             m_utilitiesConfig.strComputerName,
@@ -216,10 +419,20 @@ void Main::FileAndDataInformation(
             pElt,
             pFileName,
             pDataAttr,
-            m_codeVerifier);
+            codeVerifier,
+            pSecurityDescriptors);
+
+        fi.SetKnownGood(m_knownGood.get());
 
-        HRESULT hr = fi.WriteFileInformation(NtfsFileInfo::g_NtfsColumnNames, output, config.Filters);
+        if (pFileInfoPool == nullptr || pFileInfoPool->Submit(fi) != S_OK)
+        {
+            fi.SetAuthenticodePool(m_authenticodePool.get());
+            HRESULT hr = fi.WriteFileInformation(m_ColumnPlan, output, config.Filters);
+        }
         ++dwTotalFileTreated;
+
+        if (pFileInfoPool != nullptr)
+            pFileInfoPool->Collect(output);
     }
     catch (WCHAR* e)
     {
@@ -229,6 +442,9 @@ void Main::FileAndDataInformation(
 
 void Main::DirectoryInformation(
     ITableOutput& output,
+    const MFTWalker::FullNameBuilder& fullNameBuilder,
+    Authenticode& codeVerifier,
+    SecurityDescriptorTable* pSecurityDescriptors,
     const std::shared_ptr<VolumeReader>& volreader,
     MFTRecord* pElt,
     const PFILE_NAME pFileName,
@@ -236,7 +452,7 @@ void Main::DirectoryInformation(
 {
     try
     {
-        const WCHAR* szFullName = m_FullNameBuilder(pFileName, nullptr);
+        const WCHAR* szFullName = fullNameBuilder(pFileName, nullptr);
 
         MFTRecordFileInfo fi(
             m_utilitiesConfig.strComputerName,
@@ -247,9 +463,10 @@ void Main::DirectoryInformation(
             pElt,
             pFileName,
             nullptr,
-            m_codeVerifier);
+            codeVerifier,
+            pSecurityDescriptors);
 
-        HRESULT hr = fi.WriteFileInformation(NtfsFileInfo::g_NtfsColumnNames, output, config.Filters);
+        HRESULT hr = fi.WriteFileInformation(m_ColumnPlan, output, config.Filters);
         ++dwTotalFileTreated;
     }
     catch (WCHAR* e)
@@ -260,42 +477,30 @@ void Main::DirectoryInformation(
 
 HRESULT Main::WriteTimeLineEntry(
     ITableOutput& timelineOutput,
+    TimelineSort* pTimelineSort,
     const std::shared_ptr<VolumeReader>& volreader,
     MFTRecord* pElt,
     const PFILE_NAME pFileName,
     DWORD dwKind,
     LONGLONG llTime)
 {
-    return WriteTimeLineEntry(timelineOutput, volreader, pElt, pFileName, dwKind, *((FILETIME*)&llTime));
+    return WriteTimeLineEntry(
+        timelineOutput, pTimelineSort, volreader, pElt, pFileName, dwKind, *((FILETIME*)&llTime));
 }
 
 HRESULT Main::WriteTimeLineEntry(
     ITableOutput& timelineOutput,
+    TimelineSort* pTimelineSort,
     const std::shared_ptr<VolumeReader>& volreader,
     MFTRecord* pElt,
     const PFILE_NAME pFileName,
     DWORD dwKind,
     FILETIME llTime)
 {
-    timelineOutput.WriteString(m_utilitiesConfig.strComputerName.c_str());
-
-    timelineOutput.WriteInteger(volreader->VolumeSerialNumber());
-
-    static const Orc::FlagsDefinition KindOfDateDefs[] = {
-        {InvalidKind, L"InvalidKind", L"InvalidKind"},
-        {CreationTime, L"CreationTime", L"CreationTime"},
-        {LastModificationTime, L"LastModificationTime", L"LastModificationTime"},
-        {LastAccessTime, L"LastAccessTime", L"LastAccessTime"},
-        {LastChangeTime, L"LastChangeTime", L"LastChangeTime"},
-        {FileNameCreationDate, L"FileNameCreationDate", L"FileNameCreationDate"},
-        {FileNameLastModificationDate, L"FileNameLastModificationDate", L"FileNameLastModificationDate"},
-        {FileNameLastAccessDate, L"FileNameLastAccessDate", L"FileNameLastAccessDate"},
-        {FileNameLastAttrModificationDate, L"FileNameLastAttrModificationDate", L"FileNameLastAttrModificationDate"},
-        {0xFFFFFFFF, L"TheWorldEndsHere", L"TheWorldEndsHere"}};
-
-    timelineOutput.WriteFlags(dwKind, KindOfDateDefs, L',');
-    timelineOutput.WriteFileTime(llTime);
-    timelineOutput.WriteInteger(pElt->GetSafeMFTSegmentNumber());
+    TimelineRow row;
+    row.Time = (static_cast<ULONGLONG>(llTime.dwHighDateTime) << 32) | llTime.dwLowDateTime;
+    row.FRN = pElt->GetSafeMFTSegmentNumber();
+    row.Kind = dwKind;
 
     const auto& attrs = pElt->GetAttributeList();
     auto usInstanceID = (USHORT)-1;
@@ -313,10 +518,47 @@ HRESULT Main::WriteTimeLineEntry(
             }
         }
     });
-    if (usInstanceID == (USHORT)-1)
+    row.FileNameID = usInstanceID;
+
+    if (pTimelineSort != nullptr)
+    {
+        // Should the sort fail (temporary file), the row is still written, out of order
+        if (auto hr = pTimelineSort->Add(row); SUCCEEDED(hr))
+            return S_OK;
+    }
+
+    return WriteTimeLineRow(timelineOutput, volreader, row);
+}
+
+HRESULT Main::WriteTimeLineRow(
+    ITableOutput& timelineOutput,
+    const std::shared_ptr<VolumeReader>& volreader,
+    const TimelineRow& row)
+{
+    timelineOutput.WriteString(m_utilitiesConfig.strComputerName.c_str());
+
+    timelineOutput.WriteInteger(volreader->VolumeSerialNumber());
+
+    static const Orc::FlagsDefinition KindOfDateDefs[] = {
+        {InvalidKind, L"InvalidKind", L"InvalidKind"},
+        {CreationTime, L"CreationTime", L"CreationTime"},
+        {LastModificationTime, L"LastModificationTime", L"LastModificationTime"},
+        {LastAccessTime, L"LastAccessTime", L"LastAccessTime"},
+        {LastChangeTime, L"LastChangeTime", L"LastChangeTime"},
+        {FileNameCreationDate, L"FileNameCreationDate", L"FileNameCreationDate"},
+        {FileNameLastModificationDate, L"FileNameLastModificationDate", L"FileNameLastModificationDate"},
+        {FileNameLastAccessDate, L"FileNameLastAccessDate", L"FileNameLastAccessDate"},
+        {FileNameLastAttrModificationDate, L"FileNameLastAttrModificationDate", L"FileNameLastAttrModificationDate"},
+        {0xFFFFFFFF, L"TheWorldEndsHere", L"TheWorldEndsHere"}};
+
+    timelineOutput.WriteFlags(row.Kind, KindOfDateDefs, L',');
+    timelineOutput.WriteFileTime(static_cast<LONGLONG>(row.Time));
+    timelineOutput.WriteInteger(row.FRN);
+
+    if (row.FileNameID == (USHORT)-1)
         timelineOutput.WriteNothing();
     else
-        timelineOutput.WriteInteger((DWORD)usInstanceID);
+        timelineOutput.WriteInteger((DWORD)row.FileNameID);
 
     auto snapshot_reader = std::dynamic_pointer_cast<SnapshotVolumeReader>(volreader);
 
@@ -329,29 +571,35 @@ HRESULT Main::WriteTimeLineEntry(
     return S_OK;
 }
 
-void Main::ElementInformation(ITableOutput& output, const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt)
+void Main::ElementInformation(
+    ITableOutput& output,
+    TimelineSort* pSort,
+    const std::shared_ptr<VolumeReader>& volreader,
+    MFTRecord* pElt)
 {
     PSTANDARD_INFORMATION pInfo = pElt->GetStandardInformation();
     if (pInfo == nullptr)
         return;
-    WriteTimeLineEntry(output, volreader, pElt, nullptr, CreationTime, pInfo->CreationTime);
-    WriteTimeLineEntry(output, volreader, pElt, nullptr, LastModificationTime, pInfo->LastModificationTime);
-    WriteTimeLineEntry(output, volreader, pElt, nullptr, LastAccessTime, pInfo->LastAccessTime);
-    WriteTimeLineEntry(output, volreader, pElt, nullptr, LastChangeTime, pInfo->LastChangeTime);
+    WriteTimeLineEntry(output, pSort, volreader, pElt, nullptr, CreationTime, pInfo->CreationTime);
+    WriteTimeLineEntry(output, pSort, volreader, pElt, nullptr, LastModificationTime, pInfo->LastModificationTime);
+    WriteTimeLineEntry(output, pSort, volreader, pElt, nullptr, LastAccessTime, pInfo->LastAccessTime);
+    WriteTimeLineEntry(output, pSort, volreader, pElt, nullptr, LastChangeTime, pInfo->LastChangeTime);
 }
 
 void Main::TimelineInformation(
     ITableOutput& output,
+    TimelineSort* pSort,
     const std::shared_ptr<VolumeReader>& volreader,
     MFTRecord* pElt,
     const PFILE_NAME pFileName)
 {
-    WriteTimeLineEntry(output, volreader, pElt, pFileName, FileNameCreationDate, pFileName->Info.CreationTime);
+    WriteTimeLineEntry(output, pSort, volreader, pElt, pFileName, FileNameCreationDate, pFileName->Info.CreationTime);
+    WriteTimeLineEntry(
+        output, pSort, volreader, pElt, pFileName, FileNameLastModificationDate, pFileName->Info.LastModificationTime);
     WriteTimeLineEntry(
-        output, volreader, pElt, pFileName, FileNameLastModificationDate, pFileName->Info.LastModificationTime);
-    WriteTimeLineEntry(output, volreader, pElt, pFileName, FileNameLastAccessDate, pFileName->Info.LastAccessTime);
+        output, pSort, volreader, pElt, pFileName, FileNameLastAccessDate, pFileName->Info.LastAccessTime);
     WriteTimeLineEntry(
-        output, volreader, pElt, pFileName, FileNameLastAttrModificationDate, pFileName->Info.LastChangeTime);
+        output, pSort, volreader, pElt, pFileName, FileNameLastAttrModificationDate, pFileName->Info.LastChangeTime);
 }
 
 void Main::SecurityDescriptorInformation(
@@ -733,9 +981,397 @@ HRESULT Main::WriteVolStats(
     return S_OK;
 }
 
+HRESULT Main::ResumeFromCheckpoint(std::vector<std::shared_ptr<Location>>& locations)
+{
+    HRESULT hr = m_checkpoint.Load(config.strCheckpoint);
+    if (FAILED(hr))
+    {
+        Log::Error(
+            L"Failed to load checkpoint '{}', walking all the locations [{}]", config.strCheckpoint, SystemError(hr));
+        m_checkpoint = MFTWalkCheckpoint();
+        return S_OK;
+    }
+
+    if (hr == S_FALSE)
+        return S_OK;
+
+    locations.erase(
+        std::remove_if(
+            std::begin(locations),
+            std::end(locations),
+            [this](const std::shared_ptr<Location>& loc) {
+                const auto location = m_checkpoint.Find(loc->GetIdentifier());
+                if (location == nullptr || !location->bComplete)
+                    return false;
+
+                Log::Info(L"Location '{}' was walked by a previous run", loc->GetLocation());
+                return true;
+            }),
+        std::end(locations));
+
+    // Outputs of this run have the same names as the previous ones
+    for (const auto& [strPath, ullSize] : m_checkpoint.Outputs())
+    {
+        if (FAILED(hr = SetAsidePreviousOutput(strPath, ullSize)))
+            return hr;
+    }
+
+    m_checkpoint.ClearOutputs();
+
+    if (FAILED(hr = m_checkpoint.Save(config.strCheckpoint)))
+        return hr;
+
+    return S_OK;
+}
+
+HRESULT Main::SaveCheckpoint(
+    const std::wstring& strLocation,
+    const MFTWalkCheckpoint::Location& location,
+    size_t index)
+{
+    HRESULT hr = E_FAIL;
+
+    const std::array outputs = {
+        std::make_pair(&config.outFileInfo, &m_FileInfoOutput.Outputs()[index].second),
+        std::make_pair(&config.outAttrInfo, &m_AttrOutput.Outputs()[index].second),
+        std::make_pair(&config.outI30Info, &m_I30Output.Outputs()[index].second),
+        std::make_pair(&config.outTimeLine, &m_TimeLineOutput.Outputs()[index].second),
+        std::make_pair(&config.outSecDescrInfo, &m_SecDescrOutput.Outputs()[index].second)};
+
+    // Rows are in the files once flushed, the size of the files is then the size of their checkpoint
+    std::vector<std::pair<std::wstring, ULONGLONG>> sizes;
+    for (const auto& [pOutput, pInfo] : outputs)
+    {
+        const auto& writer = pInfo->Writer();
+        if (writer == nullptr)
+            continue;
+
+        if (FAILED(hr = writer->Flush()))
+        {
+            Log::Error(L"Failed to flush output of '{}' for checkpoint [{}]", strLocation, SystemError(hr));
+            return hr;
+        }
+
+        const auto strPath = GetOutputFilePath(*pOutput, *pInfo);
+        const auto pStreamWriter = std::dynamic_pointer_cast<TableOutput::IStreamWriter>(writer);
+        if (!strPath || pStreamWriter == nullptr || pStreamWriter->GetStream() == nullptr)
+        {
+            Log::Error(L"No output file to checkpoint for '{}'", strLocation);
+            return E_UNEXPECTED;
+        }
+
+        sizes.emplace_back(*strPath, pStreamWriter->GetStream()->GetSize());
+    }
+
+    std::lock_guard<std::mutex> lock(m_checkpointLock);
+
+    m_checkpoint.Set(strLocation, location);
+    for (const auto& [strPath, ullSize] : sizes)
+        m_checkpoint.SetOutput(strPath, ullSize);
+
+    if (FAILED(hr = m_checkpoint.Save(config.strCheckpoint)))
+        return hr;
+
+    Log::Debug(
+        L"Checkpoint of '{}' saved ({})",
+        strLocation,
+        location.bComplete ? std::wstring(L"complete") : fmt::format(L"{} records written", location.Records.Count()));
+    return S_OK;
+}
+
+HRESULT Main::WalkLocation(
+    const std::shared_ptr<Location>& loc,
+    size_t index,
+    Authenticode& codeVerifier,
+    bool bDisplayProgress)
+{
+    auto& fileinfoOutput = m_FileInfoOutput.Outputs()[index];
+    auto& attrOutput = m_AttrOutput.Outputs()[index];
+    auto& i30Output = m_I30Output.Outputs()[index];
+    auto& timelineOutput = m_TimeLineOutput.Outputs()[index];
+    auto& secdescrOutput = m_SecDescrOutput.Outputs()[index];
+
+    BOOST_SCOPE_EXIT(
+        &config,
+        &m_FileInfoOutput,
+        &fileinfoOutput,
+        &m_AttrOutput,
+        &attrOutput,
+        &m_I30Output,
+        &i30Output,
+        &m_TimeLineOutput,
+        &timelineOutput,
+        &m_SecDescrOutput,
+        &secdescrOutput)
+    {
+        m_FileInfoOutput.CloseOne(config.outFileInfo, fileinfoOutput);
+        m_AttrOutput.CloseOne(config.outAttrInfo, attrOutput);
+        m_I30Output.CloseOne(config.outI30Info, i30Output);
+        m_TimeLineOutput.CloseOne(config.outTimeLine, timelineOutput);
+        m_SecDescrOutput.CloseOne(config.outSecDescrInfo, secdescrOutput);
+    }
+    BOOST_SCOPE_EXIT_END;
+
+    {
+        concurrency::critical_section::scoped_lock sl(m_consoleLock);
+        m_console.OutputTree().Add(L"Parsing: {} [{}]", loc->GetLocation(), boost::join(loc->GetPaths(), L", "));
+    }
+
+    MFTWalker walker;
+    MFTWalker::FullNameBuilder fullNameBuilder;
+    MFTWalker::Callbacks callBacks;
+
+    // Owner SIDs are looked up by SecurityId in $Secure instead of opening each file
+    std::shared_ptr<SecurityDescriptorTable> securityDescriptors;
+
+    std::unique_ptr<FileInfoPool> fileInfoPool;
+
+    if (fileinfoOutput.second.Writer() != nullptr)
+    {
+        if (HasFlag(config.DefaultIntentions, Intentions::FILEINFO_OWNERSID)
+            || HasFlag(FileInfo::GetFilterIntentions(config.Filters), Intentions::FILEINFO_OWNERSID))
+        {
+            securityDescriptors = std::make_shared<SecurityDescriptorTable>();
+            walker.SetSecurityDescriptorTable(securityDescriptors);
+        }
+
+        if (config.dwColumnWorkers > 0)
+        {
+            fileInfoPool = std::make_unique<FileInfoPool>(
+                config.outFileInfo.Schema,
+                NtfsFileInfo::g_NtfsColumnNames,
+                config.dwColumnWorkers,
+                kMaxPooledFileSize,
+                kMaxPooledPendingBytes);
+        }
+
+        callBacks.FileNameAndDataCallback = [this,
+                                             &fileinfoOutput,
+                                             &fullNameBuilder,
+                                             &codeVerifier,
+                                             pSecurityDescriptors = securityDescriptors.get(),
+                                             pFileInfoPool = fileInfoPool.get()](
+                                                const std::shared_ptr<VolumeReader>& volreader,
+                                                MFTRecord* pElt,
+                                                const PFILE_NAME pFileName,
+                                                const std::shared_ptr<DataAttribute>& pDataAttr) {
+            FileAndDataInformation(
+                *fileinfoOutput.second.Writer(),
+                fullNameBuilder,
+                codeVerifier,
+                pSecurityDescriptors,
+                pFileInfoPool,
+                volreader,
+                pElt,
+                pFileName,
+                pDataAttr);
+        };
+        callBacks.DirectoryCallback =
+            [this, &fileinfoOutput, &fullNameBuilder, &codeVerifier, pSecurityDescriptors = securityDescriptors.get()](
+                const std::shared_ptr<VolumeReader>& volreader,
+                MFTRecord* pElt,
+                const PFILE_NAME pFileName,
+                const std::shared_ptr<IndexAllocationAttribute>& pAttr) {
+                DirectoryInformation(
+                    *fileinfoOutput.second.Writer(),
+                    fullNameBuilder,
+                    codeVerifier,
+                    pSecurityDescriptors,
+                    volreader,
+                    pElt,
+                    pFileName,
+                    pAttr);
+            };
+    }
+    // Timeline rows are sorted by time once the volume is walked, then written
+    std::unique_ptr<TimelineSort> timelineSort;
+
+    if (timelineOutput.second.Writer() != nullptr)
+    {
+        if (config.ullTimelineSortBudget > 0)
+        {
+            timelineSort = std::make_unique<TimelineSort>(static_cast<size_t>(config.ullTimelineSortBudget));
+        }
+
+        callBacks.ElementCallback = [this, &timelineOutput, pSort = timelineSort.get()](
+                                        const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
+            ElementInformation(*timelineOutput.second.Writer(), pSort, volreader, pElt);
+        };
+        callBacks.FileNameCallback =
+            [this, &timelineOutput, pSort = timelineSort.get()](
+                const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt, const PFILE_NAME pFileName) {
+                TimelineInformation(*timelineOutput.second.Writer(), pSort, volreader, pElt, pFileName);
+            };
+    }
+
+    if (attrOutput.second.Writer() != nullptr)
+    {
+        callBacks.AttributeCallback = [this, &attrOutput](
+                                          const std::shared_ptr<VolumeReader>& volreader,
+                                          MFTRecord* pElt,
+                                          const AttributeListEntry& AttrEntry) {
+            AttrInformation(*attrOutput.second.Writer(), volreader, pElt, AttrEntry);
+        };
+    }
+
+    if (i30Output.second.Writer() != nullptr)
+    {
+        callBacks.I30Callback = [this, &i30Output](
+                                    const std::shared_ptr<VolumeReader>& volreader,
+                                    MFTRecord* pElt,
+                                    const PINDEX_ENTRY& pEntry,
+                                    const PFILE_NAME pFileName,
+                                    bool bCarvedEntry) {
+            I30Information(*i30Output.second.Writer(), volreader, pElt, pEntry, pFileName, bCarvedEntry);
+        };
+    }
+
+    if (secdescrOutput.second.Writer() != nullptr)
+    {
+        callBacks.SecDescCallback = [this, &secdescrOutput](
+                                        const std::shared_ptr<VolumeReader>& volreader,
+                                        const PSECURITY_DESCRIPTOR_ENTRY pEntry) {
+            SecurityDescriptorInformation(*secdescrOutput.second.Writer(), volreader, pEntry);
+        };
+    }
+
+    // Records are only tracked when the walker writes all the rows of a record before the next one
+    std::unique_ptr<CheckpointRecords> checkpointRecords;
+
+    if (!config.strCheckpoint.empty() && config.dwWalkerWorkers == 0 && fileInfoPool == nullptr
+        && timelineSort == nullptr)
+    {
+        MFTWalkCheckpoint::RecordSet previous;
+        {
+            std::lock_guard<std::mutex> lock(m_checkpointLock);
+            if (const auto location = m_checkpoint.Find(loc->GetIdentifier()))
+                previous = location->Records;
+        }
+
+        if (!previous.IsEmpty())
+        {
+            Log::Info(
+                L"Resuming walk of '{}': {} records were written by a previous run",
+                loc->GetLocation(),
+                previous.Count());
+        }
+
+        checkpointRecords = std::make_unique<CheckpointRecords>(
+            previous,
+            config.dwCheckpointInterval,
+            [this, &loc, index](const MFTWalkCheckpoint::RecordSet& written) {
+                MFTWalkCheckpoint::Location location;
+                location.Records = written;
+
+                if (auto hr = SaveCheckpoint(loc->GetIdentifier(), location, index); FAILED(hr))
+                    Log::Error(L"Failed to save checkpoint of '{}' [{}]", loc->GetLocation(), SystemError(hr));
+            });
+
+        SkipWrittenRecords(callBacks.ElementCallback, *checkpointRecords);
+        SkipWrittenRecords(callBacks.FileNameCallback, *checkpointRecords);
+        SkipWrittenRecords(callBacks.FileNameAndDataCallback, *checkpointRecords);
+        SkipWrittenRecords(callBacks.DirectoryCallback, *checkpointRecords);
+        SkipWrittenRecords(callBacks.AttributeCallback, *checkpointRecords);
+        SkipWrittenRecords(callBacks.I30Callback, *checkpointRecords);
+
+        if (callBacks.SecDescCallback != nullptr)
+        {
+            callBacks.SecDescCallback =
+                [call = std::move(callBacks.SecDescCallback), pRecords = checkpointRecords.get()](
+                    const std::shared_ptr<VolumeReader>& volreader, const PSECURITY_DESCRIPTOR_ENTRY pEntry) {
+                    if (pRecords->Enter(kSecureRecord))
+                        call(volreader, pEntry);
+                };
+        }
+    }
+
+    if (bDisplayProgress)
+    {
+        // Progress dots of concurrent walks would be interleaved
+        callBacks.ProgressCallback = [this](const ULONG dwProgress) -> HRESULT {
+            DisplayProgress(dwProgress);
+            return S_OK;
+        };
+    }
+
+    HRESULT hr = E_FAIL;
+
+    walker.SetPipeline(config.dwWalkerWorkers, config.bWalkerOutOfOrder);
+    walker.SetSkipUnchangedShadowRecords(config.bShadowsDelta);
+
+    if (FAILED(hr = walker.Initialize(loc, config.resurrectRecordsMode)))
+    {
+        if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
+        {
+            Log::Warn(L"File system not eligible for '{}'", loc->GetLocation());
+            return S_OK;
+        }
+
+        Log::Critical(L"Failed to init walk for '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    fullNameBuilder = walker.GetFullNameBuilder();
+    hr = walker.Walk(callBacks);
+
+    if (fileInfoPool != nullptr)
+        fileInfoPool->Collect(*fileinfoOutput.second.Writer(), true);
+
+    if (timelineSort != nullptr)
+    {
+        Log::Debug(
+            L"Sorting {} timeline rows of '{}' (runs: {})",
+            timelineSort->Count(),
+            loc->GetLocation(),
+            timelineSort->Runs());
+
+        const auto volreader = loc->GetReader();
+        auto hrSort = timelineSort->Merge([this, &timelineOutput, &volreader](const TimelineRow& row) {
+            WriteTimeLineRow(*timelineOutput.second.Writer(), volreader, row);
+        });
+        if (FAILED(hrSort))
+        {
+            Log::Error(L"Failed to sort the timeline of '{}' [{}]", loc->GetLocation(), SystemError(hrSort));
+        }
+    }
+
+    if (FAILED(hr))
+    {
+        Log::Critical(L"Failed to walk volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    if (!config.strCheckpoint.empty())
+    {
+        if (checkpointRecords != nullptr && checkpointRecords->Skipped() > 0)
+        {
+            Log::Debug(
+                L"Skipped {} records of '{}' written by a previous run",
+                checkpointRecords->Skipped(),
+                loc->GetLocation());
+        }
+
+        MFTWalkCheckpoint::Location location;
+        location.bComplete = true;
+
+        if (auto hrCheckpoint = SaveCheckpoint(loc->GetIdentifier(), location, index); FAILED(hrCheckpoint))
+            Log::Error(L"Failed to save checkpoint of '{}' [{}]", loc->GetLocation(), SystemError(hrCheckpoint));
+    }
+
+    {
+        concurrency::critical_section::scoped_lock sl(m_consoleLock);
+        if (bDisplayProgress)
+            m_console.Print("Done");
+        else
+            m_console.OutputTree().Add(L"Done: {}", loc->GetLocation());
+    }
+
+    walker.Statistics(loc->GetLocation());
+    return S_OK;
+}
+
 HRESULT Main::RunThroughMFT()
 {
-    auto output = m_console.OutputTree();
     HRESULT hr = E_FAIL;
 
     const auto& locs = config.locs.GetAltitudeLocations();
@@ -765,6 +1401,27 @@ HRESULT Main::RunThroughMFT()
         return E_INVALIDARG;
     }
 
+    if (!config.strCheckpoint.empty())
+    {
+        if (FAILED(hr = ResumeFromCheckpoint(locations)))
+        {
+            Log::Error(L"Failed to resume from checkpoint '{}' [{}]", config.strCheckpoint, SystemError(hr));
+            return hr;
+        }
+
+        if (locations.empty())
+        {
+            Log::Info(L"All the locations were walked by a previous run");
+            DeleteFile(config.strCheckpoint.c_str());
+            return S_OK;
+        }
+
+        if (config.dwWalkerWorkers > 0 || config.dwColumnWorkers > 0 || config.ullTimelineSortBudget > 0)
+        {
+            Log::Info(L"Records of pipelined or sorted walks are not tracked, only whole locations are checkpointed");
+        }
+    }
+
     std::copy_if(begin(locs), end(locs), back_inserter(allLocations), [](const std::shared_ptr<Location>& loc) {
         if (loc == nullptr)
             return false;
@@ -826,141 +1483,128 @@ HRESULT Main::RunThroughMFT()
 
     }
 
-    auto fileinfoIterator = begin(m_FileInfoOutput.Outputs());
-    auto attrIterator = begin(m_AttrOutput.Outputs());
-    auto i30Iterator = begin(m_I30Output.Outputs());
-    auto timelineIterator = begin(m_TimeLineOutput.Outputs());
-    auto secdescrIterator = begin(m_SecDescrOutput.Outputs());
+    // Each location has its own writers only with directory or archive outputs: a single table file is shared
+    // between all locations and forces a sequential walk to keep its content deterministic
+    const auto hasPerLocationWriters = [](const OutputSpec& spec) {
+        return spec.Type == OutputSpec::Kind::None || spec.Type == OutputSpec::Kind::Directory
+            || spec.Type == OutputSpec::Kind::Archive;
+    };
 
-    bool hasSomeFailure = false;
+    // Shadow copies of a volume have their own limit: they share the disk of the volume and its parsed snapshots
+    const DWORD dwVolumeWalks = std::max<DWORD>(config.dwConcurrentVolumes, 1L);
+    const DWORD dwShadowWalks = config.dwConcurrentShadows > 0 ? config.dwConcurrentShadows : dwVolumeWalks;
 
-    for (auto& loc : locations)
+    DWORD dwConcurrentWalks =
+        std::min<DWORD>(std::max(dwVolumeWalks, dwShadowWalks), static_cast<DWORD>(locations.size()));
+    if (dwConcurrentWalks > 1
+        && !(hasPerLocationWriters(config.outFileInfo) && hasPerLocationWriters(config.outAttrInfo)
+             && hasPerLocationWriters(config.outI30Info) && hasPerLocationWriters(config.outTimeLine)
+             && hasPerLocationWriters(config.outSecDescrInfo)))
     {
-        BOOST_SCOPE_EXIT(
-            &config,
-            &m_FileInfoOutput,
-            &fileinfoIterator,
-            &m_AttrOutput,
-            &attrIterator,
-            &m_I30Output,
-            &i30Iterator,
-            &m_TimeLineOutput,
-            &timelineIterator,
-            &m_SecDescrOutput,
-            &secdescrIterator)
-        {
-            m_FileInfoOutput.CloseOne(config.outFileInfo, *fileinfoIterator);
-            fileinfoIterator++;
-            m_AttrOutput.CloseOne(config.outAttrInfo, *attrIterator);
-            attrIterator++;
-            m_I30Output.CloseOne(config.outI30Info, *i30Iterator);
-            i30Iterator++;
-            m_TimeLineOutput.CloseOne(config.outTimeLine, *timelineIterator);
-            timelineIterator++;
-            m_SecDescrOutput.CloseOne(config.outSecDescrInfo, *secdescrIterator);
-            secdescrIterator++;
-        }
-        BOOST_SCOPE_EXIT_END;
-
-        output.Add(L"Parsing: {} [{}]", loc->GetLocation(), boost::join(loc->GetPaths(), L", "));
-
-        MFTWalker::Callbacks callBacks;
-
-        if (fileinfoIterator->second.Writer() != nullptr)
-        {
-            callBacks.FileNameAndDataCallback = [this, fileinfoIterator](
-                                                    const std::shared_ptr<VolumeReader>& volreader,
-                                                    MFTRecord* pElt,
-                                                    const PFILE_NAME pFileName,
-                                                    const std::shared_ptr<DataAttribute>& pDataAttr) {
-                FileAndDataInformation(*fileinfoIterator->second.Writer(), volreader, pElt, pFileName, pDataAttr);
-            };
-            callBacks.DirectoryCallback = [this, fileinfoIterator](
-                                              const std::shared_ptr<VolumeReader>& volreader,
-                                              MFTRecord* pElt,
-                                              const PFILE_NAME pFileName,
-                                              const std::shared_ptr<IndexAllocationAttribute>& pAttr) {
-                DirectoryInformation(*fileinfoIterator->second.Writer(), volreader, pElt, pFileName, pAttr);
-            };
-        }
-        if (timelineIterator->second.Writer() != nullptr)
-        {
-            callBacks.ElementCallback =
-                [this, timelineIterator](const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
-                    ElementInformation(*timelineIterator->second.Writer(), volreader, pElt);
-                };
-            callBacks.FileNameCallback =
-                [this, timelineIterator](
-                    const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt, const PFILE_NAME pFileName) {
-                    TimelineInformation(*timelineIterator->second.Writer(), volreader, pElt, pFileName);
-                };
-        }
+        Log::Warn(L"Concurrent volume walks require directory or archive outputs, volumes will be walked sequentially");
+        dwConcurrentWalks = 1;
+    }
 
-        if (attrIterator->second.Writer() != nullptr)
-        {
-            callBacks.AttributeCallback = [this, attrIterator](
-                                              const std::shared_ptr<VolumeReader>& volreader,
-                                              MFTRecord* pElt,
-                                              const AttributeListEntry& AttrEntry) {
-                AttrInformation(*attrIterator->second.Writer(), volreader, pElt, AttrEntry);
-            };
-        }
+    bool hasSomeFailure = false;
 
-        if (i30Iterator->second.Writer() != nullptr)
+    if (dwConcurrentWalks <= 1)
+    {
+        for (size_t i = 0; i < locations.size(); i++)
         {
-            callBacks.I30Callback = [this, i30Iterator](
-                                        const std::shared_ptr<VolumeReader>& volreader,
-                                        MFTRecord* pElt,
-                                        const PINDEX_ENTRY& pEntry,
-                                        const PFILE_NAME pFileName,
-                                        bool bCarvedEntry) {
-                I30Information(*i30Iterator->second.Writer(), volreader, pElt, pEntry, pFileName, bCarvedEntry);
-            };
+            if (FAILED(WalkLocation(locations[i], i, m_codeVerifier, true)))
+                hasSomeFailure = true;
         }
+    }
+    else
+    {
+        Log::Debug(
+            L"Walking {} locations with {} concurrent walks (volumes: {}, shadow copies of a volume: {})",
+            locations.size(),
+            dwConcurrentWalks,
+            dwVolumeWalks,
+            dwShadowWalks);
+
+        const auto shadowParent = [&locations](size_t index) -> std::optional<std::wstring> {
+            if (const auto& shadow = locations[index]->GetShadow(); shadow != nullptr)
+                return shadow->parentIdentifier;
+            return std::nullopt;
+        };
 
-        if (secdescrIterator->second.Writer() != nullptr)
-        {
-            callBacks.SecDescCallback = [this, secdescrIterator](
-                                            const std::shared_ptr<VolumeReader>& volreader,
-                                            const PSECURITY_DESCRIPTOR_ENTRY pEntry) {
-                SecurityDescriptorInformation(*secdescrIterator->second.Writer(), volreader, pEntry);
-            };
-        }
+        std::mutex mutex;
+        std::condition_variable walkEnded;
+        std::deque<size_t> pending;
+        DWORD dwActiveVolumes = 0L;
+        std::map<std::wstring, DWORD> activeShadows;
+        for (size_t i = 0; i < locations.size(); i++)
+            pending.push_back(i);
+
+        // First pending location in order whose limit is not reached: a worker only waits when all of them are
+        auto nextLocation = [&]() -> std::optional<size_t> {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!pending.empty())
+            {
+                auto it = std::find_if(std::cbegin(pending), std::cend(pending), [&](size_t index) {
+                    const auto parent = shadowParent(index);
+                    return parent ? activeShadows[*parent] < dwShadowWalks : dwActiveVolumes < dwVolumeWalks;
+                });
 
-        callBacks.ProgressCallback = [this](const ULONG dwProgress) -> HRESULT {
-            DisplayProgress(dwProgress);
-            return S_OK;
-        };
+                if (it != std::cend(pending))
+                {
+                    const auto index = *it;
+                    pending.erase(it);
 
-        MFTWalker walker;
-        HRESULT hr = E_FAIL;
+                    if (const auto parent = shadowParent(index))
+                        activeShadows[*parent]++;
+                    else
+                        dwActiveVolumes++;
 
-        if (FAILED(hr = walker.Initialize(loc, config.resurrectRecordsMode)))
-        {
-            if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
-            {
-                Log::Warn(L"File system not eligible for '{}'", loc->GetLocation());
+                    return index;
+                }
+
+                walkEnded.wait(lock);
             }
-            else
+            return std::nullopt;
+        };
+
+        auto endLocation = [&](size_t index) {
             {
-                hasSomeFailure = true;
-                Log::Critical(L"Failed to init walk for '{}' [{}]", loc->GetLocation(), SystemError(hr));
+                std::lock_guard<std::mutex> lock(mutex);
+                if (const auto parent = shadowParent(index))
+                    activeShadows[*parent]--;
+                else
+                    dwActiveVolumes--;
             }
+            walkEnded.notify_all();
+        };
+
+        std::atomic<bool> hasSomeWorkerFailure = false;
+
+        std::vector<std::thread> workers;
+        for (DWORD i = 0; i < dwConcurrentWalks; i++)
+        {
+            workers.emplace_back([this, &locations, &nextLocation, &endLocation, &hasSomeWorkerFailure]() {
+                // Authenticode and its cache are not thread safe: each worker uses its own verifier
+                auto authenticodeCache = std::make_shared<AuthenticodeCache>();
+                Authenticode codeVerifier;
+                codeVerifier.SetCache(authenticodeCache);
+
+                // The snapshots of a volume are parsed by the first of its shadow copies and shared by the others
+                for (auto index = nextLocation(); index; index = nextLocation())
+                {
+                    if (FAILED(WalkLocation(locations[*index], *index, codeVerifier, false)))
+                        hasSomeWorkerFailure = true;
+
+                    endLocation(*index);
+                }
+            });
         }
-        else
+
+        for (auto& worker : workers)
         {
-            m_FullNameBuilder = walker.GetFullNameBuilder();
-            if (FAILED(hr = walker.Walk(callBacks)))
-            {
-                hasSomeFailure = true;
-                Log::Critical(L"Failed to walk volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
-            }
-            else
-            {
-                m_console.Print("Done");
-                walker.Statistics(L"");
-            }
+            worker.join();
         }
+
+        hasSomeFailure = hasSomeWorkerFailure;
     }
 
     if (hasSomeFailure)
@@ -968,6 +1612,12 @@ HRESULT Main::RunThroughMFT()
         return E_FAIL;
     }
 
+    // The next run walks everything again
+    if (!config.strCheckpoint.empty() && !DeleteFile(config.strCheckpoint.c_str()))
+    {
+        Log::Warn(L"Failed to delete checkpoint '{}' [{}]", config.strCheckpoint, LastWin32Error());
+    }
+
     return S_OK;
 }
 
@@ -978,6 +1628,24 @@ HRESULT Main::Run()
     if (FAILED(hr = LoadWinTrust()))
         return hr;
 
+    if (config.dwAuthenticodeWorkers > 0)
+    {
+        m_authenticodePool = std::make_unique<AuthenticodePool>(config.dwAuthenticodeWorkers);
+    }
+
+    BOOST_SCOPE_EXIT(&m_authenticodePool)
+    {
+        m_authenticodePool.reset();
+    }
+    BOOST_SCOPE_EXIT_END;
+
+    if (!config.strKnownGood.empty())
+    {
+        m_knownGood = std::make_unique<KnownGoodList>();
+        if (FAILED(hr = m_knownGood->LoadFile(config.strKnownGood)))
+            return hr;
+    }
+
     try
     {
         if (!config.strWalker.compare(L"USN"))
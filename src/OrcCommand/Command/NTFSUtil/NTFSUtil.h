@@ -37,7 +37,9 @@ public:
         HexDump,
         Vss,
         BitLocker,
-        MFT
+        MFT,
+        Bench,
+        Replay
     } Command;
 
     class Configuration : public UtilitiesMain::Configuration
@@ -73,8 +75,16 @@ public:
 
         bool bPrintDetails;
 
-        // output for vss
+        // Bench: duration of each measurement
+        std::chrono::milliseconds benchDuration = std::chrono::seconds(1);
+
+        // Replay: I/O trace to replay, without waiting for the recorded time of the reads
+        std::wstring strReplayTrace;
+        bool bReplayMaxSpeed = false;
+
+        // output for vss || bench
         OutputSpec output;
+        TableOutput::Schema benchSchema;
     };
 
 private:
@@ -112,6 +122,12 @@ private:
     // BitLocker
     HRESULT CommandBitLocker();
 
+    // Volume read throughput and latency
+    HRESULT CommandBench();
+
+    // Replay of an I/O trace
+    HRESULT CommandReplay();
+
 public:
     static LPCWSTR ToolName() { return L"NTFSUtil"; }
     static LPCWSTR ToolDescription() { return L"Various NTFS related utilities"; }
@@ -26,6 +26,7 @@ HRESULT Main::GetSchemaFromConfig(const ConfigItem& schemaitem)
 {
     config.output.Schema = TableOutput::GetColumnsFromConfig(
         config.output.TableKey.empty() ? L"Vss" : config.output.TableKey.c_str(), schemaitem);
+    config.benchSchema = TableOutput::GetColumnsFromConfig(L"Bench", schemaitem);
     return S_OK;
 }
 
@@ -93,6 +94,18 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                 {
                     config.cmd = Main::Command::BitLocker;
                 }
+                else if (BooleanOption(argv[i] + 1, L"bench", bBool))
+                {
+                    config.cmd = Main::Command::Bench;
+                }
+                else if (ParameterOption(argv[i] + 1, L"Duration", config.benchDuration))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"replay", config.strReplayTrace))
+                {
+                    config.cmd = Main::Command::Replay;
+                }
+                else if (BooleanOption(argv[i] + 1, L"max_speed", config.bReplayMaxSpeed))
+                    ;
                 else if (OutputOption(argv[i] + 1, L"out", config.output))
                     ;
                 else if (ProcessPriorityOption(argv[i] + 1))
@@ -131,6 +144,29 @@ HRESULT Main::CheckConfiguration()
         return E_INVALIDARG;
     }
 
+    if (config.cmd == Main::Bench)
+    {
+        if (config.strVolume.empty())
+        {
+            Log::Error("No location set to be measured");
+            return E_INVALIDARG;
+        }
+
+        if (config.benchDuration.count() <= 0)
+        {
+            Log::Error("Invalid measurement duration");
+            return E_INVALIDARG;
+        }
+
+        config.output.Schema = config.benchSchema;
+    }
+
+    if (config.cmd == Main::Replay && config.strReplayTrace.empty())
+    {
+        Log::Error("No I/O trace set to be replayed");
+        return E_INVALIDARG;
+    }
+
     if (config.bConfigure)
     {
         if (config.strVolume.empty() && config.cmd == Main::USN)
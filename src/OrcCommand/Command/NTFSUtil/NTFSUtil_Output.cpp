@@ -37,7 +37,8 @@ void Main::PrintUsage()
         "NTFS Swiss Army knife with a collection of useful features to investigate NTFS.");
 
     auto subcommandsNode = usageNode.AddNode("SUBCOMMAND");
-    subcommandsNode.Add("Available commands: /usn, /vsn, /enumlocs, /loc, /record, /hexdump, /mft, /bitlocker");
+    subcommandsNode.Add(
+        "Available commands: /usn, /vsn, /enumlocs, /loc, /record, /hexdump, /mft, /bitlocker, /bench, /replay");
     subcommandsNode.AddEOL();
 
     {
@@ -133,6 +134,37 @@ void Main::PrintUsage()
             Parameter {"<Location>", "Path to BitLocker image (default: all mounted bitlocker volumes)"}};
     }
 
+    {
+        auto benchNode = usageNode.AddNode("BENCH SUBCOMMAND");
+        benchNode.Add(
+            "Measure the sequential and random read throughput and latency of a location's reader for several read "
+            "sizes and queue depths, and recommend the read profile of the walkers");
+        benchNode.AddEOL();
+        benchNode.Add("Usage: /bench [/duration=<Milliseconds>] [/out=<Outfile.csv>] <Location>");
+        benchNode.AddEOL();
+
+        constexpr std::array kBenchParameters = {
+            Parameter {"/duration=<Milliseconds>", "Duration of each measurement (default: 1000)"},
+            Parameter {"<Location>", "Location (ex: 'D:'). See below for more details."}};
+        Usage::PrintParameters(usageNode, "BENCH PARAMETERS", kBenchParameters);
+    }
+
+    {
+        auto replayNode = usageNode.AddNode("REPLAY SUBCOMMAND");
+        replayNode.Add(
+            "Replay the volume reads of an I/O trace (see /io_trace) with as many threads as the traced process, and "
+            "report their throughput, latency and sequential share by caller subsystem");
+        replayNode.AddEOL();
+        replayNode.Add("Usage: /replay=<Trace.iotrace> [/max_speed] [<Location>]");
+        replayNode.AddEOL();
+
+        constexpr std::array kReplayParameters = {
+            Parameter {"/replay=<Trace.iotrace>", "I/O trace to replay"},
+            Parameter {"/max_speed", "Issue the reads as fast as possible instead of at their recorded time"},
+            Parameter {"<Location>", "Device or image to read (default: the traced locations)"}};
+        Usage::PrintParameters(usageNode, "REPLAY PARAMETERS", kReplayParameters);
+    }
+
     Usage::PrintLocationParameters(usageNode);
     Usage::PrintOutputParameters(usageNode);
     Usage::PrintLoggingParameters(usageNode);
@@ -151,6 +183,11 @@ void Main::PrintParameters()
         PrintValue(node, L"Volume", config.strVolume);
     }
 
+    if (!config.strReplayTrace.empty())
+    {
+        PrintValue(node, L"Trace", config.strReplayTrace);
+    }
+
     m_console.PrintNewLine();
 }
 
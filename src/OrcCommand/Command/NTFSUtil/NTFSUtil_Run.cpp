@@ -9,8 +9,13 @@
 
 #include "stdafx.h"
 
+#include <array>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <sstream>
+#include <thread>
 
 #include <boost/scope_exit.hpp>
 
@@ -26,6 +31,8 @@
 #include "MFTOnline.h"
 #include "MFTOffline.h"
 #include "OfflineMFTReader.h"
+#include "IoTrace.h"
+#include "Telemetry.h"
 
 #include "Utils/Round.h"
 #include "Utils/TypeTraits.h"
@@ -52,6 +59,7 @@
 #include "Filesystem/Ntfs/ShadowCopy/SnapshotsIndexHeader.h"
 #include "ShadowCopyVolumeReader.h"
 #include "Stream/VolumeStreamReader.h"
+#include "VolumeReadProfile.h"
 
 using namespace std;
 
@@ -189,6 +197,335 @@ std::string ToApplicationInfoIdString(const GUID& guid)
     }
 }
 
+// Read sizes and numbers of concurrent reads measured by /bench
+constexpr std::array<ULONG, 5> kBenchBlockSizes = {4 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+constexpr std::array<ULONG, 2> kBenchRandomBlockSizes = {4 * 1024, 64 * 1024};
+constexpr std::array<DWORD, 6> kBenchQueueDepths = {1, 2, 4, 8, 16, 32};
+
+// A profile keeping more bytes in flight is only recommended when it is faster by this ratio
+constexpr double kBenchMinGain = 1.05;
+
+struct BenchResult
+{
+    std::wstring_view Mode;
+    ULONG BlockSize = 0L;
+    DWORD QueueDepth = 0L;
+    ULONGLONG Reads = 0LL;
+    ULONGLONG Bytes = 0LL;
+    std::chrono::microseconds Duration = std::chrono::microseconds::zero();
+    std::chrono::microseconds AverageLatency = std::chrono::microseconds::zero();
+    std::chrono::microseconds P99Latency = std::chrono::microseconds::zero();
+    bool Recommended = false;
+
+    // Bytes per second
+    ULONGLONG Throughput() const
+    {
+        if (Duration.count() == 0)
+            return 0LL;
+
+        return static_cast<ULONGLONG>(static_cast<double>(Bytes) * 1000000.0 / Duration.count());
+    }
+};
+
+void SetLatencies(std::vector<std::chrono::microseconds>& latencies, BenchResult& result)
+{
+    result.Reads = latencies.size();
+    if (latencies.empty())
+        return;
+
+    std::sort(std::begin(latencies), std::end(latencies));
+
+    const auto total = std::accumulate(std::begin(latencies), std::end(latencies), std::chrono::microseconds::zero());
+    result.AverageLatency = total / static_cast<LONGLONG>(latencies.size());
+    result.P99Latency = latencies[(latencies.size() - 1) * 99 / 100];
+}
+
+std::wstring BenchReaderType(Location& location)
+{
+    // Snapshots are read either through VSS or through the internal shadow copy parser
+    if (std::dynamic_pointer_cast<ShadowCopyVolumeReader>(location.GetReader()) != nullptr)
+    {
+        return L"ShadowCopyParser";
+    }
+
+    return ToString(location.GetType());
+}
+
+// Sequential reads from 'ullOffset', which is moved past the data read so that the next run does not read the blocks
+// this one left in the caches. More than one read in flight requires the reader's overlapped read-ahead: S_FALSE is
+// returned when it is not available.
+HRESULT BenchSequential(
+    VolumeReader& reader,
+    ULONG ulBlockSize,
+    DWORD dwQueueDepth,
+    std::chrono::milliseconds duration,
+    ULONGLONG& ullOffset,
+    BenchResult& result)
+{
+    if (dwQueueDepth > 1 && FAILED(reader.EnableReadAhead(dwQueueDepth, ulBlockSize)))
+        return S_FALSE;
+
+    auto readAheadGuard = Guard::CreateScopeGuard([&reader]() { reader.DisableReadAhead(); });
+
+    CBinaryBuffer buffer(true);
+    if (!buffer.CheckCount(ulBlockSize))
+        return E_OUTOFMEMORY;
+
+    const ULONGLONG ullVolumeSize = reader.GetVolumeSize();
+    if (ullVolumeSize != 0 && ullOffset + ulBlockSize > ullVolumeSize)
+        ullOffset = 0LL;
+
+    std::vector<std::chrono::microseconds> latencies;
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + duration;
+
+    for (auto now = start; now < deadline;)
+    {
+        ULONGLONG ullRead = 0LL;
+        HRESULT hr = reader.Read(ullOffset, buffer, ulBlockSize, ullRead);
+        if (FAILED(hr))
+        {
+            Log::Error(L"Failed to read '{}' at offset {} [{}]", reader.GetLocation(), ullOffset, SystemError(hr));
+            return hr;
+        }
+
+        const auto end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - now));
+        now = end;
+
+        result.Bytes += ullRead;
+        ullOffset += ullRead;
+
+        if (ullRead < ulBlockSize || (ullVolumeSize != 0 && ullOffset + ulBlockSize > ullVolumeSize))
+        {
+            if (ullOffset == ullRead)
+                break;  // the whole volume is smaller than a block
+
+            ullOffset = 0LL;
+        }
+    }
+
+    result.Duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    SetLatencies(latencies, result);
+    return S_OK;
+}
+
+// Reads of a block at random offsets, by as many threads as 'readers'
+HRESULT BenchRandom(
+    const std::vector<std::shared_ptr<VolumeReader>>& readers,
+    ULONG ulBlockSize,
+    ULONGLONG ullVolumeSize,
+    std::chrono::milliseconds duration,
+    BenchResult& result)
+{
+    const ULONGLONG ullBlocks = ullVolumeSize / ulBlockSize;
+    if (ullBlocks == 0)
+        return S_FALSE;
+
+    std::vector<std::vector<std::chrono::microseconds>> latencies(readers.size());
+    std::vector<ULONGLONG> bytes(readers.size(), 0LL);
+    std::vector<HRESULT> results(readers.size(), S_OK);
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto deadline = start + duration;
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        workers.emplace_back([&, i]() {
+            CBinaryBuffer buffer(true);
+            if (!buffer.CheckCount(ulBlockSize))
+            {
+                results[i] = E_OUTOFMEMORY;
+                return;
+            }
+
+            std::mt19937_64 generator(i);
+            std::uniform_int_distribution<ULONGLONG> distribution(0, ullBlocks - 1);
+
+            for (auto now = std::chrono::steady_clock::now(); now < deadline;)
+            {
+                const ULONGLONG ullOffset = distribution(generator) * ulBlockSize;
+
+                ULONGLONG ullRead = 0LL;
+                if (FAILED(results[i] = readers[i]->Read(ullOffset, buffer, ulBlockSize, ullRead)))
+                    return;
+
+                const auto end = std::chrono::steady_clock::now();
+                latencies[i].push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - now));
+                bytes[i] += ullRead;
+                now = end;
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    result.Duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    std::vector<std::chrono::microseconds> allLatencies;
+    for (size_t i = 0; i < readers.size(); i++)
+    {
+        if (FAILED(results[i]))
+        {
+            Log::Error(L"Failed to read '{}' [{}]", readers[i]->GetLocation(), SystemError(results[i]));
+            return results[i];
+        }
+
+        result.Bytes += bytes[i];
+        allLatencies.insert(std::end(allLatencies), std::begin(latencies[i]), std::end(latencies[i]));
+    }
+
+    SetLatencies(allLatencies, result);
+    return S_OK;
+}
+
+// The sequential run with the best throughput, unless a run keeping fewer bytes in flight is about as fast
+BenchResult* RecommendProfile(std::vector<BenchResult>& results)
+{
+    std::vector<BenchResult*> sequential;
+    for (auto& result : results)
+    {
+        if (result.Mode == L"sequential" && result.Reads > 0)
+            sequential.push_back(&result);
+    }
+
+    if (sequential.empty())
+        return nullptr;
+
+    std::sort(std::begin(sequential), std::end(sequential), [](const BenchResult* lhs, const BenchResult* rhs) {
+        const auto lhsInFlight = static_cast<ULONGLONG>(lhs->BlockSize) * lhs->QueueDepth;
+        const auto rhsInFlight = static_cast<ULONGLONG>(rhs->BlockSize) * rhs->QueueDepth;
+        if (lhsInFlight != rhsInFlight)
+            return lhsInFlight < rhsInFlight;
+        return lhs->QueueDepth < rhs->QueueDepth;
+    });
+
+    ULONGLONG ullBest = 0LL;
+    for (const auto result : sequential)
+    {
+        ullBest = std::max(ullBest, result->Throughput());
+    }
+
+    for (const auto result : sequential)
+    {
+        if (result->Throughput() * kBenchMinGain >= ullBest)
+        {
+            result->Recommended = true;
+            return result;
+        }
+    }
+
+    return nullptr;
+}
+
+// Replayed reads of a caller subsystem
+struct ReplayResult
+{
+    ULONGLONG Reads = 0LL;
+    ULONGLONG Failed = 0LL;
+    ULONGLONG Sequential = 0LL;  // reads starting where the previous read of the thread on the location ended
+    ULONGLONG Bytes = 0LL;
+    std::vector<std::chrono::microseconds> Latencies;
+
+    void Add(ReplayResult& other)
+    {
+        Reads += other.Reads;
+        Failed += other.Failed;
+        Sequential += other.Sequential;
+        Bytes += other.Bytes;
+        Latencies.insert(std::end(Latencies), std::begin(other.Latencies), std::end(other.Latencies));
+    }
+};
+
+// Results are indexed by Telemetry::Phase, reads out of any phase are the last
+constexpr size_t kReplaySubsystems = static_cast<size_t>(Telemetry::Phase::Count) + 1;
+
+// Reads of 'trace' by as many threads as the traced process used, each through its own readers as the walkers'
+// workers do. At recorded speed a read is not issued before its recorded time from the start of the replay. Failed
+// reads (a location smaller than the traced one) are counted and skipped.
+void ReplayTrace(
+    const IoTrace::Trace& trace,
+    const std::vector<std::shared_ptr<VolumeReader>>& readers,
+    bool bRecordedSpeed,
+    std::vector<ReplayResult>& results,
+    std::chrono::microseconds& duration)
+{
+    std::map<DWORD, std::vector<const IoTrace::Entry*>> threads;
+    for (const auto& read : trace.Reads)
+    {
+        threads[read.ThreadId].push_back(&read);
+    }
+
+    std::vector<std::vector<ReplayResult>> threadResults(threads.size(), std::vector<ReplayResult>(kReplaySubsystems));
+
+    const auto start = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> workers;
+    for (auto it = std::cbegin(threads); it != std::cend(threads); ++it)
+    {
+        workers.emplace_back([&, &reads = it->second, &workerResults = threadResults[workers.size()]]() {
+            std::vector<std::shared_ptr<VolumeReader>> workerReaders(readers.size());
+            std::vector<ULONGLONG> ends(readers.size(), MAXULONGLONG);
+            CBinaryBuffer buffer(true);
+
+            for (const auto pRead : reads)
+            {
+                auto& reader = workerReaders[pRead->Location];
+                if (reader == nullptr)
+                {
+                    reader = readers[pRead->Location]->ReOpen(
+                        FILE_READ_DATA,
+                        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                        FILE_FLAG_NO_BUFFERING | FILE_FLAG_RANDOM_ACCESS);
+                    if (reader == nullptr)
+                        reader = readers[pRead->Location];
+                }
+
+                if (bRecordedSpeed)
+                    std::this_thread::sleep_until(start + std::chrono::microseconds(pRead->Timestamp));
+
+                auto& result = workerResults[std::min<size_t>(pRead->Subsystem, kReplaySubsystems - 1)];
+                if (ends[pRead->Location] == pRead->Offset)
+                    result.Sequential++;
+                ends[pRead->Location] = pRead->Offset + pRead->Length;
+
+                ULONGLONG ullRead = 0LL;
+                const auto before = std::chrono::steady_clock::now();
+                if (!buffer.CheckCount(pRead->Length)
+                    || FAILED(reader->Read(pRead->Offset, buffer, pRead->Length, ullRead)))
+                {
+                    result.Failed++;
+                    continue;
+                }
+
+                result.Latencies.push_back(
+                    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - before));
+                result.Reads++;
+                result.Bytes += ullRead;
+            }
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+
+    results.assign(kReplaySubsystems, ReplayResult());
+    for (auto& workerResults : threadResults)
+    {
+        for (size_t i = 0; i < kReplaySubsystems; i++)
+            results[i].Add(workerResults[i]);
+    }
+}
+
 }  // namespace
 
 HRESULT Main::CommandUSN()
@@ -1126,6 +1463,269 @@ HRESULT Orc::Command::NTFSUtil::Main::CommandBitLocker()
     return S_OK;
 }
 
+HRESULT Main::CommandBench()
+{
+    auto output = m_console.OutputTree();
+
+    LocationSet locations;
+    std::vector<std::shared_ptr<Location>> addedLocs;
+    HRESULT hr = locations.AddLocations(config.strVolume.c_str(), addedLocs);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to add locations from '{}' [{}]", config.strVolume, SystemError(hr));
+        return hr;
+    }
+
+    std::shared_ptr<TableOutput::IWriter> pBenchWriter;
+    if (config.output.Type != OutputSpec::Kind::None)
+    {
+        pBenchWriter = TableOutput::GetWriter(config.output);
+        if (nullptr == pBenchWriter)
+        {
+            Log::Critical("Failed to create output file");
+            return E_FAIL;
+        }
+    }
+
+    Guard::Scope onScopeExit([&] {
+        if (pBenchWriter != nullptr)
+        {
+            pBenchWriter->Close();
+        }
+    });
+
+    for (const auto& loc : addedLocs)
+    {
+        const auto reader = loc->GetReader();
+        if (reader == nullptr || FAILED(hr = reader->LoadDiskProperties()) || !reader->IsReady())
+        {
+            Log::Error(L"Failed to load disk properties for location: '{}'", loc->GetLocation());
+            continue;
+        }
+
+        const auto strReaderType = ::BenchReaderType(*loc);
+        auto locationNode = output.AddNode(L"{} ({})", loc->GetLocation(), strReaderType);
+
+        std::vector<BenchResult> results;
+
+        ULONGLONG ullOffset = 0LL;
+        for (const auto ulBlockSize : kBenchBlockSizes)
+        {
+            for (const auto dwQueueDepth : kBenchQueueDepths)
+            {
+                BenchResult result;
+                result.Mode = L"sequential";
+                result.BlockSize = ulBlockSize;
+                result.QueueDepth = dwQueueDepth;
+
+                hr = ::BenchSequential(*reader, ulBlockSize, dwQueueDepth, config.benchDuration, ullOffset, result);
+                if (FAILED(hr))
+                    break;
+                if (hr == S_FALSE)
+                {
+                    Log::Debug(L"No overlapped read-ahead for '{}', reads are not queued", loc->GetLocation());
+                    break;
+                }
+
+                results.push_back(result);
+            }
+        }
+
+        // Concurrent random reads are done through independent handles, as the walkers' workers do
+        std::vector<std::shared_ptr<VolumeReader>> readers = {reader};
+        for (size_t i = 1; i < kBenchQueueDepths.back(); i++)
+        {
+            auto workerReader = reader->ReOpen(
+                FILE_READ_DATA,
+                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                FILE_FLAG_NO_BUFFERING | FILE_FLAG_RANDOM_ACCESS);
+            if (workerReader == nullptr || workerReader == reader)
+                break;
+
+            readers.push_back(std::move(workerReader));
+        }
+
+        for (const auto ulBlockSize : kBenchRandomBlockSizes)
+        {
+            for (const auto dwQueueDepth : kBenchQueueDepths)
+            {
+                if (dwQueueDepth > readers.size())
+                    break;
+
+                BenchResult result;
+                result.Mode = L"random";
+                result.BlockSize = ulBlockSize;
+                result.QueueDepth = dwQueueDepth;
+
+                const std::vector<std::shared_ptr<VolumeReader>> queue(
+                    std::cbegin(readers), std::cbegin(readers) + dwQueueDepth);
+
+                hr = ::BenchRandom(queue, ulBlockSize, reader->GetVolumeSize(), config.benchDuration, result);
+                if (FAILED(hr) || hr == S_FALSE)
+                    break;
+
+                results.push_back(result);
+            }
+        }
+
+        const auto pRecommended = ::RecommendProfile(results);
+
+        for (const auto& result : results)
+        {
+            locationNode.Add(
+                L"{:<10} {:>8} QD {:>2}: {:>10}/s, {:>8} reads, latency: {:>7} us (avg), {:>7} us (p99){}",
+                result.Mode,
+                Traits::ByteQuantity<ULONGLONG>(result.BlockSize),
+                result.QueueDepth,
+                Traits::ByteQuantity<ULONGLONG>(result.Throughput()),
+                result.Reads,
+                result.AverageLatency.count(),
+                result.P99Latency.count(),
+                result.Recommended ? L" *" : L"");
+
+            if (pBenchWriter != nullptr)
+            {
+                auto& writer = *pBenchWriter;
+                writer.WriteString(loc->GetLocation());
+                writer.WriteString(strReaderType);
+                writer.WriteString(result.Mode);
+                writer.WriteInteger(static_cast<DWORD>(result.BlockSize));
+                writer.WriteInteger(result.QueueDepth);
+                writer.WriteInteger(result.Reads);
+                writer.WriteInteger(result.Bytes);
+                writer.WriteInteger(static_cast<ULONGLONG>(result.Duration.count()));
+                writer.WriteInteger(result.Throughput());
+                writer.WriteInteger(static_cast<ULONGLONG>(result.AverageLatency.count()));
+                writer.WriteInteger(static_cast<ULONGLONG>(result.P99Latency.count()));
+                writer.WriteBool(result.Recommended);
+                writer.WriteEndOfLine();
+            }
+        }
+
+        locationNode.AddEmptyLine();
+        if (pRecommended != nullptr)
+        {
+            const VolumeReadProfile profile(pRecommended->BlockSize, pRecommended->QueueDepth);
+            locationNode.Add(L"Recommended profile: /read_profile={}", profile.ToString());
+        }
+        else
+        {
+            locationNode.Add(L"No sequential read could be measured");
+        }
+
+        locationNode.AddEmptyLine();
+    }
+
+    return S_OK;
+}
+
+HRESULT Main::CommandReplay()
+{
+    auto output = m_console.OutputTree();
+
+    IoTrace::Trace trace;
+    HRESULT hr = IoTrace::Load(config.strReplayTrace, trace);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (trace.Reads.empty())
+    {
+        Log::Warn(L"No read to replay in '{}'", config.strReplayTrace);
+        return S_OK;
+    }
+
+    const auto openReader = [](const std::wstring& strLocation) -> std::shared_ptr<VolumeReader> {
+        LocationSet locations;
+        std::vector<std::shared_ptr<Location>> addedLocs;
+        HRESULT hr = locations.AddLocations(strLocation.c_str(), addedLocs);
+        if (FAILED(hr) || addedLocs.empty())
+        {
+            Log::Error(L"Failed to add locations from '{}' [{}]", strLocation, SystemError(hr));
+            return nullptr;
+        }
+
+        auto reader = addedLocs.front()->GetReader();
+        if (reader == nullptr || FAILED(reader->LoadDiskProperties()) || !reader->IsReady())
+        {
+            Log::Error(L"Failed to load disk properties for location: '{}'", strLocation);
+            return nullptr;
+        }
+
+        return reader;
+    };
+
+    // Reads are replayed against their traced location, or all of them against the location given
+    std::vector<std::shared_ptr<VolumeReader>> readers;
+    if (!config.strVolume.empty())
+    {
+        const auto reader = openReader(config.strVolume);
+        if (reader == nullptr)
+            return E_FAIL;
+
+        readers.assign(trace.Locations.size(), reader);
+    }
+    else
+    {
+        for (const auto& strLocation : trace.Locations)
+        {
+            auto reader = openReader(strLocation);
+            if (reader == nullptr)
+                return E_FAIL;
+
+            readers.push_back(std::move(reader));
+        }
+    }
+
+    const auto bRecordedSpeed = !config.bReplayMaxSpeed;
+    const auto recorded = std::chrono::microseconds(trace.Reads.back().Timestamp);
+
+    std::vector<ReplayResult> results;
+    auto duration = std::chrono::microseconds::zero();
+    ::ReplayTrace(trace, readers, bRecordedSpeed, results, duration);
+
+    auto replayNode = output.AddNode(
+        L"Replay of {} reads at {} speed: {} ms (recorded: {} ms)",
+        trace.Reads.size(),
+        bRecordedSpeed ? L"recorded" : L"maximum",
+        duration.count() / 1000,
+        recorded.count() / 1000);
+
+    const auto addResult = [&replayNode, &duration](std::wstring_view subsystem, ReplayResult& result) {
+        BenchResult latencies;
+        ::SetLatencies(result.Latencies, latencies);
+
+        replayNode.Add(
+            L"{:<13}: {:>10} reads, {:>10} ({:>10}/s), {:>3}% sequential, latency: {:>7} us (avg), {:>7} us (p99), {} "
+            L"failed",
+            subsystem,
+            result.Reads,
+            Traits::ByteQuantity<ULONGLONG>(result.Bytes),
+            Traits::ByteQuantity<ULONGLONG>(
+                duration.count() > 0 ? result.Bytes * 1000000ULL / static_cast<ULONGLONG>(duration.count()) : 0LL),
+            result.Reads + result.Failed > 0 ? result.Sequential * 100 / (result.Reads + result.Failed) : 0LL,
+            latencies.AverageLatency.count(),
+            latencies.P99Latency.count(),
+            result.Failed);
+    };
+
+    ReplayResult total;
+    for (size_t i = 0; i < kReplaySubsystems; i++)
+    {
+        if (results[i].Reads == 0 && results[i].Failed == 0)
+            continue;
+
+        const auto phase = static_cast<Telemetry::Phase>(i);
+        addResult(phase == Telemetry::Phase::Count ? L"other" : Telemetry::ToString(phase), results[i]);
+        total.Add(results[i]);
+    }
+
+    addResult(L"total", total);
+    replayNode.AddEmptyLine();
+    return S_OK;
+}
+
 HRESULT Main::Run()
 {
     switch (config.cmd)
@@ -1150,6 +1750,12 @@ HRESULT Main::Run()
         case Main::BitLocker: {
             return CommandBitLocker();
         }
+        case Main::Bench: {
+            return CommandBench();
+        }
+        case Main::Replay: {
+            return CommandReplay();
+        }
     }
 
     Log::Critical("Unsupported command");
@@ -42,6 +42,12 @@ HRESULT Orc::Config::RegInfo::root(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddChildNode(L"csv_limit", REGINFO_CSVLIMIT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = item.AddAttribute(L"concurrenthives", REGINFO_CONCURRENT_HIVES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"maphives", REGINFO_MAP_HIVES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"splithivewalk", REGINFO_SPLIT_HIVE_WALK, ConfigItem::OPTION)))
+        return hr;
 
     return S_OK;
 }
@@ -25,6 +25,9 @@ constexpr auto REGINFO_COMPUTER = 5L;
 constexpr auto REGINFO_LOCATION = 6L;
 constexpr auto REGINFO_KNOWNLOCATIONS = 7L;
 constexpr auto REGINFO_CSVLIMIT = 8L;
+constexpr auto REGINFO_CONCURRENT_HIVES = 9L;
+constexpr auto REGINFO_MAP_HIVES = 10L;
+constexpr auto REGINFO_SPLIT_HIVE_WALK = 11L;
 
 constexpr auto REGINFO_REGINFO = 0L;
 constexpr auto REGINFO_TEMPLATE = 0L;
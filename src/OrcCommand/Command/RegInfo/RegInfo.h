@@ -107,6 +107,10 @@ public:
         OutputSpec Output;
         size_t CsvValueLengthLimit;
         std::wstring strComputerName;
+        DWORD dwConcurrentHives = 0L;
+        bool bMapHives = false;
+        DWORD dwSplitHiveWalk = 0L;
+        bool bSkipIdenticalHives = false;
     };
 
 private:
@@ -120,7 +124,7 @@ private:
     std::shared_ptr<TableOutput::IWriter> GetRegInfoWriter(const OutputSpec& outFile, const std::wstring& strSuffix)
     {
         WCHAR szOutputFile[MAX_PATH];
-        StringCchPrintf(szOutputFile, MAX_PATH, L"RegInfo_%s.csv", strSuffix.c_str());
+        StringCchPrintf(szOutputFile, MAX_PATH, L"RegInfo_%s%s", strSuffix.c_str(), outFile.TableExtension());
 
         return TableOutput::GetWriter(szOutputFile, outFile);
     }
@@ -134,6 +138,7 @@ private:
         const std::wstring& FileNamePrefix,
         size_t CvsMaxsize);
     HRESULT WriteTermName(ITableOutput& output, const std::shared_ptr<RegFind::SearchTerm>& Term);
+    HRESULT WriteMatches(ITableOutput& output, const RegFind::MatchesMap& matches, const std::wstring& hiveName);
 
 public:
     static LPCWSTR ToolName() { return L"RegInfo"; }
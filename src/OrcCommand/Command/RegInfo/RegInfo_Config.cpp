@@ -107,6 +107,37 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
         config.CsvValueLengthLimit = REGINFO_CSV_DEFALUT_LIMIT;
     }
 
+    if (configitem[REGINFO_CONCURRENT_HIVES])
+    {
+        if (auto hrHives = GetIntegerFromArg(configitem[REGINFO_CONCURRENT_HIVES].c_str(), config.dwConcurrentHives);
+            FAILED(hrHives))
+        {
+            Log::Error(
+                L"Failed to parse 'concurrenthives' attribute (value: {}) [{}]",
+                configitem[REGINFO_CONCURRENT_HIVES].c_str(),
+                SystemError(hrHives));
+        }
+    }
+
+    if (configitem[REGINFO_MAP_HIVES])
+    {
+        using namespace std::string_view_literals;
+        const auto YES = L"yes"sv;
+        config.bMapHives = equalCaseInsensitive((const std::wstring&)configitem[REGINFO_MAP_HIVES], YES, YES.size());
+    }
+
+    if (configitem[REGINFO_SPLIT_HIVE_WALK])
+    {
+        if (auto hrSplit = GetIntegerFromArg(configitem[REGINFO_SPLIT_HIVE_WALK].c_str(), config.dwSplitHiveWalk);
+            FAILED(hrSplit))
+        {
+            Log::Error(
+                L"Failed to parse 'splithivewalk' attribute (value: {}) [{}]",
+                configitem[REGINFO_SPLIT_HIVE_WALK].c_str(),
+                SystemError(hrSplit));
+        }
+    }
+
     if (configitem[REGINFO_COMPUTER])
         Log::Info(L"No computer name specified ({})", configitem[REGINFO_INFORMATION].c_str());
 
@@ -208,6 +239,14 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                         ;
                     else if (ParameterOption(argv[i] + 1, L"Computer", m_utilitiesConfig.strComputerName))
                         ;
+                    else if (ParameterOption(argv[i] + 1, L"ConcurrentHives", config.dwConcurrentHives))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"MapHives", config.bMapHives))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"SplitHiveWalk", config.dwSplitHiveWalk))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"SkipIdenticalHives", config.bSkipIdenticalHives))
+                        ;
                     else if (ProcessPriorityOption(argv[i] + 1))
                         ;
                     else if (UsageOption(argv[i] + 1))
@@ -267,5 +306,12 @@ HRESULT Main::CheckConfiguration()
         return E_INVALIDARG;
     }
 
+    const auto loadMode = config.bMapHives ? RegistryHive::LoadMode::Map : RegistryHive::LoadMode::Read;
+    for (const auto& query : config.m_HiveQuery.m_Queries)
+    {
+        query->QuerySpec.SetHiveLoadMode(loadMode);
+        query->QuerySpec.SetWalkSplitDepth(config.dwSplitHiveWalk);
+    }
+
     return S_OK;
 }
@@ -34,7 +34,12 @@ void Main::PrintUsage()
 
     Usage::PrintOutputParameters(usageNode);
 
-    constexpr std::array kCustomMiscParameters = {Usage::kMiscParameterComputer};
+    constexpr std::array kCustomMiscParameters = {
+        Usage::kMiscParameterComputer,
+        Usage::kMiscParameterConcurrentHives,
+        Usage::kMiscParameterMapHives,
+        Usage::kMiscParameterSplitHiveWalk,
+        Usage::kMiscParameterSkipIdenticalHives};
     Usage::PrintMiscellaneousParameters(usageNode, kCustomMiscParameters);
 }
 
@@ -48,6 +53,26 @@ void Main::PrintParameters()
     PrintValue(node, L"Output", config.Output);
     PrintValues(node, L"Locations", config.m_HiveQuery.m_HivesLocation.GetParsedLocations());
 
+    if (config.dwConcurrentHives > 1)
+    {
+        PrintValue(node, L"Concurrent hives", config.dwConcurrentHives);
+    }
+
+    if (config.bMapHives)
+    {
+        PrintValue(node, L"Map hives", config.bMapHives);
+    }
+
+    if (config.dwSplitHiveWalk > 0)
+    {
+        PrintValue(node, L"Split hive walk", config.dwSplitHiveWalk);
+    }
+
+    if (config.bSkipIdenticalHives)
+    {
+        PrintValue(node, L"Skip identical hives", config.bSkipIdenticalHives);
+    }
+
     for (size_t i = 0; i < config.m_HiveQuery.m_Queries.size(); ++i)
     {
         const auto& query = config.m_HiveQuery.m_Queries[i];
@@ -31,9 +31,25 @@
 
 #include "RegistryWalker.h"
 
+#include <boost/scope_exit.hpp>
+
+#include <atomic>
+#include <future>
+#include <thread>
+
 using namespace Orc;
 using namespace Orc::Command::RegInfo;
 
+namespace {
+
+struct HiveSearch
+{
+    HRESULT hr = S_OK;
+    RegFind::MatchesMap Matches;
+};
+
+}  // namespace
+
 // Characters banned from output (break csv file...)
 // end the table with a null character
 constexpr WCHAR kOutputBadChars[] = {'\n', '"', '\0'};
@@ -427,6 +443,38 @@ HRESULT Main::WriteValueInformation(
     return hr;
 }
 
+HRESULT Main::WriteMatches(ITableOutput& output, const RegFind::MatchesMap& matches, const std::wstring& hiveName)
+{
+    for (const auto& [searchTerm, result] : matches)
+    {
+        for (const auto& key : result->MatchingKeys)
+        {
+            WriteComputerName(output);
+            WriteTermName(output, searchTerm);
+            WriteSearchDescription(output, searchTerm);
+            WriteKeyInformation(output, key);
+            output.WriteNothing();
+            output.WriteNothing();
+            output.WriteNothing();
+            output.WriteNothing();
+            output.WriteNothing();
+            output.WriteNothing();
+            output.WriteEndOfLine();
+        }
+
+        for (const auto& value : result->MatchingValues)
+        {
+            WriteComputerName(output);
+            WriteTermName(output, searchTerm);
+            WriteSearchDescription(output, searchTerm);
+            WriteValueInformation(output, value, hiveName, config.CsvValueLengthLimit);
+            output.WriteEndOfLine();
+        }
+    }
+
+    return S_OK;
+}
+
 HRESULT Main::Run()
 {
     HRESULT hr = LoadWinTrust();
@@ -477,11 +525,85 @@ HRESULT Main::Run()
             }
         }
 
+        const auto& hives = query->StreamList;
+
+        std::vector<std::optional<size_t>> sameAs(hives.size());
+        if (config.bSkipIdenticalHives)
+        {
+            sameAs = HiveQuery::FindIdenticalHives(hives);
+        }
+
+        const auto searchHive = [&query, &hives, &sameAs](size_t index) {
+            const auto& hive = hives[index];
+            HiveSearch search;
+            if (hive.Stream && !sameAs[index])
+            {
+                search.hr = query->QuerySpec.Find(hive.Stream, search.Matches, nullptr, nullptr);
+            }
+            return search;
+        };
+
+        // Hives are searched by up to 'dwConcurrentHives' workers while this thread writes their matches in the order
+        // of the hive list: the output is the same as the one of a sequential search
+        const DWORD dwConcurrentHives = std::min<DWORD>(config.dwConcurrentHives, static_cast<DWORD>(hives.size()));
+
+        std::vector<std::promise<HiveSearch>> searches(dwConcurrentHives > 1 ? hives.size() : 0);
+        std::vector<std::future<HiveSearch>> results;
+        std::atomic<size_t> nextHive = 0;
+        std::vector<std::thread> workers;
+
+        if (dwConcurrentHives > 1)
+        {
+            Log::Debug(L"Searching {} hives with {} concurrent searches", hives.size(), dwConcurrentHives);
+
+            for (auto& search : searches)
+            {
+                results.push_back(search.get_future());
+            }
+
+            for (DWORD i = 0; i < dwConcurrentHives; i++)
+            {
+                workers.emplace_back([&hives, &searches, &nextHive, &searchHive]() {
+                    for (size_t index = nextHive++; index < hives.size(); index = nextHive++)
+                    {
+                        try
+                        {
+                            searches[index].set_value(searchHive(index));
+                        }
+                        catch (...)
+                        {
+                            searches[index].set_exception(std::current_exception());
+                        }
+                    }
+                });
+            }
+        }
+
+        BOOST_SCOPE_EXIT(&workers)
+        {
+            for (auto& worker : workers)
+            {
+                worker.join();
+            }
+        }
+        BOOST_SCOPE_EXIT_END;
+
         auto root = m_console.OutputTree();
-        for (const auto& hive : query->StreamList)
+        for (size_t i = 0; i < hives.size(); ++i)
         {
+            const auto& hive = hives[i];
+            auto search = dwConcurrentHives > 1 ? results[i].get() : searchHive(i);
+
             auto node = root.AddNode("Parsing hive '{}'", hive.FileName);
 
+            if (sameAs[i])
+            {
+                const auto& original = hives[*sameAs[i]].FileName;
+                Log::Info(L"Hive '{}' is the same as '{}', skipped", hive.FileName, original);
+                node.Add(L"Same as '{}'", original);
+                continue;
+            }
+
             if (HasFlag(config.Output.Type, OutputSpec::Kind::Directory))
             {
                 std::wstring fileName(hive.FileName);
@@ -502,43 +624,15 @@ HRESULT Main::Run()
                 continue;
             }
 
-            hr = query->QuerySpec.Find(hive.Stream, nullptr, nullptr);
+            hr = search.hr;
             if (FAILED(hr))
             {
                 Log::Error(L"Failed to search into hive '{}' [{}]", hive.FileName, SystemError(hr));
                 continue;
             }
 
-            auto& output = *pRegInfoWriter;
-            for (const auto& [searchTerm, result] : query->QuerySpec.Matches())
-            {
-                for (const auto& key : result->MatchingKeys)
-                {
-                    WriteComputerName(output);
-                    WriteTermName(output, searchTerm);
-                    WriteSearchDescription(output, searchTerm);
-                    WriteKeyInformation(output, key);
-                    output.WriteNothing();
-                    output.WriteNothing();
-                    output.WriteNothing();
-                    output.WriteNothing();
-                    output.WriteNothing();
-                    output.WriteNothing();
-                    output.WriteEndOfLine();
-                }
-
-                for (const auto& value : result->MatchingValues)
-                {
-                    WriteComputerName(output);
-                    WriteTermName(output, searchTerm);
-                    WriteSearchDescription(output, searchTerm);
-                    WriteValueInformation(output, value, hive.FileName, config.CsvValueLengthLimit);
-                    output.WriteEndOfLine();
-                }
-            }
+            WriteMatches(*pRegInfoWriter, search.Matches, hive.FileName);
         }
-
-        query->QuerySpec.ClearMatches();
     }
 
     return hr;
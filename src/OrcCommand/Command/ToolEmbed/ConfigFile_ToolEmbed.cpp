@@ -46,6 +46,7 @@ HRESULT Orc::Config::ToolEmbed::archive(ConfigItem& parent, DWORD dwIndex)
 }
 
 // <File name="getthis_config" path="..\GetThisCmd\GetThisSample.xml" />
+// <File name="yara_rules" path="rules.yara" compile="yara" />
 HRESULT Orc::Config::ToolEmbed::file(ConfigItem& parent, DWORD dwIndex)
 {
     HRESULT hr = E_FAIL;
@@ -55,6 +56,8 @@ HRESULT Orc::Config::ToolEmbed::file(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent[dwIndex].AddAttribute(L"path", TOOLEMBED_FILEPATH, ConfigItem::MANDATORY)))
         return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"compile", TOOLEMBED_FILECOMPILE, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
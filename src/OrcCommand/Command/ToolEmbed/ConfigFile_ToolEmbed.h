@@ -24,6 +24,7 @@ constexpr auto TOOLEMBED_FILE2ARCHIVE = 3L;
 
 constexpr auto TOOLEMBED_FILENAME = 0L;
 constexpr auto TOOLEMBED_FILEPATH = 1L;
+constexpr auto TOOLEMBED_FILECOMPILE = 2L;
 
 constexpr auto TOOLEMBED_PAIRNAME = 0L;
 constexpr auto TOOLEMBED_PAIRVALUE = 1L;
@@ -49,6 +49,7 @@ private:
     HRESULT
     GetNameValuePairFromConfigItem(const ConfigItem& item, EmbeddedResource::EmbedSpec& spec);
     HRESULT GetAddFileFromConfigItem(const ConfigItem& item, EmbeddedResource::EmbedSpec& spec);
+    HRESULT CompileYaraRules(const std::wstring& strRulesFile, CBinaryBuffer& compiledRules);
     HRESULT GetAddArchiveFromConfigItem(const ConfigItem& item, EmbeddedResource::EmbedSpec& spec);
 
     Configuration config;
@@ -14,6 +14,8 @@
 #include "ParameterCheck.h"
 #include "EmbeddedResource.h"
 #include "SystemDetails.h"
+#include "MemoryStream.h"
+#include "YaraScanner.h"
 
 #include "ConfigFile_ToolEmbed.h"
 
@@ -87,10 +89,72 @@ HRESULT Main::GetAddFileFromConfigItem(const ConfigItem& item, EmbeddedResource:
         }
     }
 
+    if (item[TOOLEMBED_FILECOMPILE])
+    {
+        if (_wcsicmp(item[TOOLEMBED_FILECOMPILE].c_str(), L"yara"))
+        {
+            Log::Error(L"Invalid compile attribute '{}' (expected: yara)", item[TOOLEMBED_FILECOMPILE].c_str());
+            return E_INVALIDARG;
+        }
+
+        HRESULT hr = E_FAIL;
+        CBinaryBuffer compiledRules;
+        if (FAILED(hr = CompileYaraRules(strInputFile, compiledRules)))
+        {
+            return hr;
+        }
+
+        spec = EmbeddedResource::EmbedSpec::AddBinary(
+            std::wstring((const std::wstring&)item[TOOLEMBED_FILENAME]), std::move(compiledRules));
+        return S_OK;
+    }
+
     spec = EmbeddedResource::EmbedSpec::AddFile((const std::wstring&)item[TOOLEMBED_FILENAME], std::move(strInputFile));
     return S_OK;
 }
 
+HRESULT Main::CompileYaraRules(const std::wstring& strRulesFile, CBinaryBuffer& compiledRules)
+{
+    HRESULT hr = E_FAIL;
+
+    YaraScanner scanner;
+    if (FAILED(hr = scanner.Initialize()))
+    {
+        Log::Error("Failed to initialize yara scanner [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = scanner.AddRules(strRulesFile)))
+    {
+        Log::Error(L"Failed to add yara rules '{}' [{}]", strRulesFile, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = scanner.CompileRules()))
+    {
+        Log::Error(L"Failed to compile yara rules '{}' [{}]", strRulesFile, SystemError(hr));
+        return hr;
+    }
+
+    auto memstream = std::make_shared<MemoryStream>();
+    if (FAILED(hr = memstream->OpenForReadWrite()))
+    {
+        Log::Error(L"Failed to open memory stream for compiled yara rules [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = scanner.SaveRules(memstream)))
+    {
+        Log::Error(L"Failed to save compiled yara rules '{}' [{}]", strRulesFile, SystemError(hr));
+        return hr;
+    }
+
+    memstream->GrabBuffer(compiledRules);
+
+    Log::Info(L"Compiled yara rules '{}' ({} bytes)", strRulesFile, compiledRules.GetCount());
+    return S_OK;
+}
+
 HRESULT Main::GetAddArchiveFromConfigItem(const ConfigItem& item, EmbeddedResource::EmbedSpec& spec)
 {
     HRESULT hr = E_FAIL;
@@ -62,6 +62,12 @@ HRESULT Main::WriteEmbedConfig(
                 writer->WriteNamed(L"value", item.Value.c_str());
                 writer->EndElement(L"pair");
                 break;
+            case EmbeddedResource::EmbedSpec::EmbedType::Buffer:
+                writer->BeginElement(L"buffer");
+                writer->WriteNamed(L"name", item.Name.c_str());
+                writer->WriteNamed(L"size", static_cast<uint64_t>(item.BinaryValue.GetCount()));
+                writer->EndElement(L"buffer");
+                break;
             case EmbeddedResource::EmbedSpec::EmbedType::Archive:
                 writer->BeginElement(L"archive");
                 writer->WriteNamed(L"name", item.Name.c_str());
@@ -35,5 +35,13 @@ HRESULT Orc::Config::USNInfo::root(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddAttribute(L"compact", USNINFO_COMPACT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = item.AddAttribute(L"cursor", USNINFO_CURSOR, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"concurrentvolumes", USNINFO_CONCURRENT_VOLUMES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"carve", USNINFO_CARVE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = item.AddAttribute(L"namescan", USNINFO_NAMESCAN, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
@@ -20,6 +20,10 @@ constexpr auto USNINFO_KNOWNLOCATIONS = 2L;
 constexpr auto USNINFO_LOGGING = 3L;
 constexpr auto USNINFO_LOG = 4L;
 constexpr auto USNINFO_COMPACT = 5L;
+constexpr auto USNINFO_CURSOR = 6L;
+constexpr auto USNINFO_CONCURRENT_VOLUMES = 7L;
+constexpr auto USNINFO_CARVE = 8L;
+constexpr auto USNINFO_NAMESCAN = 9L;
 
 constexpr auto USNINFO_USNINFO = 0L;
 
@@ -20,6 +20,7 @@
 #include "Location.h"
 #include "ParameterCheck.h"
 #include "Configuration/ShadowsParserOption.h"
+#include "USNJournalCursor.h"
 
 #pragma managed(push, off)
 
@@ -46,11 +47,26 @@ public:
         LocationSet locs;
 
         bool bCompactForm = false;
+
+        // Carve the USN records of the whole volume instead of reading $UsnJrnl:$J
+        bool bCarve = false;
+
+        // Directory names come from a name only scan of the MFT and are resolved for the records which need them
+        bool bNameScan = false;
+
+        // Incremental collection: file keeping where the previous run stopped reading each journal (empty: full run)
+        std::wstring strCursor;
         boost::logic::tribool bAddShadows;
         std::optional<LocationSet::ShadowFilters> m_shadows;
         std::optional<Ntfs::ShadowCopy::ParserType> m_shadowsParser;
         std::optional<LocationSet::PathExcludes> m_excludes;
         std::vector<std::wstring> m_inputLocations;
+
+        // Number of journals read at the same time (0 or 1: one volume after the other)
+        DWORD dwConcurrentVolumes = 0L;
+
+        // Batch of offline inputs (directory or manifest), each one with its own output
+        std::wstring strBatch;
     };
 
 private:
@@ -89,8 +105,14 @@ private:
         WCHAR* szFullName,
         USN_RECORD* pElt);
 
+    HRESULT WalkIncremental(const std::shared_ptr<Location>& loc, USNJournalCursor& cursor, ITableOutput& output);
+    HRESULT WalkLocation(const std::shared_ptr<Location>& loc, USNJournalCursor& cursor, ITableOutput& output);
+
     Configuration config;
 
+    // Serializes console output of concurrent journal walks
+    concurrency::critical_section m_consoleLock;
+
 public:
     static LPCWSTR ToolName() { return L"USNInfo"; }
     static LPCWSTR ToolDescription() { return L"USN Journal enumeration"; }
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <thread>
 
 #include "USNInfo.h"
 
@@ -92,6 +93,28 @@ HRESULT Main::GetConfigurationFromConfig(const ConfigItem& configitem)
     if (configitem[USNINFO_COMPACT])
         config.bCompactForm = true;
 
+    if (configitem[USNINFO_CARVE])
+        config.bCarve = true;
+
+    if (configitem[USNINFO_NAMESCAN])
+        config.bNameScan = true;
+
+    if (configitem[USNINFO_CURSOR])
+        config.strCursor = configitem[USNINFO_CURSOR];
+
+    if (configitem[USNINFO_CONCURRENT_VOLUMES])
+    {
+        if (auto hrVolumes =
+                GetIntegerFromArg(configitem[USNINFO_CONCURRENT_VOLUMES].c_str(), config.dwConcurrentVolumes);
+            FAILED(hrVolumes))
+        {
+            Log::Error(
+                L"Failed to parse 'concurrentvolumes' attribute (value: {}) [{}]",
+                configitem[USNINFO_CONCURRENT_VOLUMES].c_str(),
+                SystemError(hrVolumes));
+        }
+    }
+
     return S_OK;
 }
 
@@ -118,6 +141,16 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                     ;
                 else if (BooleanOption(argv[i] + 1, L"Compact", config.bCompactForm))
                     ;
+                else if (BooleanOption(argv[i] + 1, L"Carve", config.bCarve))
+                    ;
+                else if (BooleanOption(argv[i] + 1, L"NameScan", config.bNameScan))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"Cursor", config.strCursor))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"ConcurrentVolumes", config.dwConcurrentVolumes))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"Batch", config.strBatch))
+                    ;
                 else if (ShadowsOption(argv[i] + 1, L"Shadows", config.bAddShadows, config.m_shadows))
                     ;
                 else if (LocationExcludeOption(argv[i] + 1, L"Exclude", config.m_excludes))
@@ -149,6 +182,15 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
     if (FAILED(hr = config.locs.AddLocationsFromArgcArgv(argc, argv)))
         return hr;
 
+    if (!config.strBatch.empty())
+    {
+        if (FAILED(hr = config.locs.AddLocationsFromBatch(config.strBatch, config.m_inputLocations)))
+        {
+            Log::Critical(L"Failed to read batch '{}' [{}]", config.strBatch, SystemError(hr));
+            return hr;
+        }
+    }
+
     return S_OK;
 }
 
@@ -175,6 +217,18 @@ HRESULT Main::CheckConfiguration()
         Log::Critical("Missing location parameter");
     }
 
+    if (config.bCarve && !config.strCursor.empty())
+    {
+        Log::Warn(L"Carved records are not incremental: ignoring '/Cursor'");
+        config.strCursor.clear();
+    }
+
+    if (!config.strCursor.empty())
+    {
+        Log::Trace("USN cursor requirement: 'EXACT' altitude enforced");
+        config.locs.GetAltitude() = LocationSet::Altitude::Exact;
+    }
+
     config.locs.Consolidate(
         static_cast<bool>(config.bAddShadows),
         config.m_shadows.value_or(LocationSet::ShadowFilters()),
@@ -190,6 +244,19 @@ HRESULT Main::CheckConfiguration()
         config.output.OutputEncoding = OutputSpec::Encoding::UTF8;
     }
 
+    if (!config.strBatch.empty())
+    {
+        if (config.output.Type != OutputSpec::Kind::Directory && config.output.Type != OutputSpec::Kind::Archive)
+        {
+            Log::Critical("Batch mode writes one output per input: a directory or archive output is required");
+            return E_INVALIDARG;
+        }
+
+        // Inputs are independent, a few of them are read at the same time unless told otherwise
+        if (config.dwConcurrentVolumes == 0)
+            config.dwConcurrentVolumes = std::clamp(std::thread::hardware_concurrency(), 1U, 4U);
+    }
+
     if (config.output.Type == OutputSpec::Kind::Directory)
     {
         if (FAILED(hr = ::VerifyDirectoryExists(config.output.Path.c_str())))
@@ -40,12 +40,27 @@ void Main::PrintUsage()
 
     Usage::PrintOutputParameters(usageNode);
 
-    Usage::PrintLocationParameters(usageNode);
-
-    constexpr std::array kSpecificParameters = {Usage::Parameter {
-        "/Compact",
-        "Non human readable output. When using this option, the full-path column is not filled in and the reason is in "
-        "hexadecimal form in the output CSV file."}};
+    constexpr std::array kCustomLocationsParameters = {Usage::kBatch};
+    Usage::PrintLocationParameters(usageNode, kCustomLocationsParameters);
+
+    constexpr std::array kSpecificParameters = {
+        Usage::Parameter {
+            "/Compact",
+            "Non human readable output. When using this option, the full-path column is not filled in and the reason "
+            "is in hexadecimal form in the output CSV file."},
+        Usage::Parameter {
+            "/Carve",
+            "Carve the USN records found anywhere on the volume (unallocated clusters, remains of older journals, the "
+            "journal itself) instead of reading $UsnJrnl:$J. Records may be output more than once"},
+        Usage::Parameter {
+            "/NameScan",
+            "Build the directory names from a name only scan of the MFT, resolved only for the directories the journal "
+            "records are in, instead of a full enumeration"},
+        Usage::Parameter {
+            "/Cursor=<FilePath>",
+            "Incremental collection: only output the records added since the run which updated 'FilePath' (mounted "
+            "volumes only, the first run or a recreated journal output the whole journal)"},
+        Usage::kMiscParameterConcurrentVolumes};
 
     Usage::PrintParameters(usageNode, "PARAMETERS", kSpecificParameters);
 
@@ -63,6 +78,23 @@ void Main::PrintParameters()
 
     PrintValues(node, L"Parsed locations", config.locs.GetParsedLocations());
     PrintValue(node, L"Compact", Traits::Boolean(config.bCompactForm));
+    PrintValue(node, L"Carve", Traits::Boolean(config.bCarve));
+    PrintValue(node, L"NameScan", Traits::Boolean(config.bNameScan));
+
+    if (!config.strCursor.empty())
+    {
+        PrintValue(node, L"Cursor", config.strCursor);
+    }
+
+    if (!config.strBatch.empty())
+    {
+        PrintValue(node, L"Batch", config.strBatch);
+    }
+
+    if (config.dwConcurrentVolumes > 1)
+    {
+        PrintValue(node, L"Concurrent volumes", config.dwConcurrentVolumes);
+    }
 
     m_console.PrintNewLine();
 }
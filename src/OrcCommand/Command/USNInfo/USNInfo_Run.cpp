@@ -22,6 +22,9 @@
 #include "FileStream.h"
 #include "PipeStream.h"
 
+#include <atomic>
+#include <thread>
+
 using namespace Orc;
 using namespace Orc::Command::USNInfo;
 
@@ -144,6 +147,155 @@ HRESULT Main::USNRecordInformation(
     return S_OK;
 }
 
+HRESULT Main::WalkIncremental(const std::shared_ptr<Location>& loc, USNJournalCursor& cursor, ITableOutput& output)
+{
+    USNJournalWalker walker;
+
+    HRESULT hr = walker.Initialize(loc);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to init USN journal walk for volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    USN_JOURNAL_DATA journal = {0};
+    if (FAILED(hr = walker.QueryJournal(journal)))
+    {
+        Log::Error(L"Failed to query USN journal of volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    const auto ullSerial = loc->GetReader()->VolumeSerialNumber();
+
+    IUSNJournalWalker::Callbacks callbacks;
+
+    const auto previous = cursor.Find(ullSerial);
+    if (previous != nullptr && previous->IsValidFor(journal))
+    {
+        Log::Info(
+            L"Reading USN journal of '{}' from USN {:#x} ({} directories from cursor)",
+            loc->GetLocation(),
+            previous->NextUsn,
+            previous->Directories.size());
+
+        for (const auto& [frn, directory] : previous->Directories)
+        {
+            if (FAILED(hr = walker.AddDirectory(frn, directory.ParentFRN, directory.Name)))
+            {
+                Log::Error(
+                    L"Failed to restore directories of '{}' from cursor [{}]", loc->GetLocation(), SystemError(hr));
+                return hr;
+            }
+        }
+
+        walker.SetIncremental(previous->NextUsn);
+    }
+    else
+    {
+        if (previous != nullptr)
+        {
+            Log::Warn(
+                L"USN journal cursor is not valid anymore for '{}' (journal recreated or records purged), reading the "
+                L"whole journal",
+                loc->GetLocation());
+        }
+
+        callbacks.RecordCallback =
+            [](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {};
+
+        hr = config.bNameScan ? walker.ScanDirectories(loc) : walker.EnumJournal(callbacks);
+        if (FAILED(hr))
+        {
+            Log::Error(L"Failed to enum MFT records '{}' [{}]", loc->GetLocation(), SystemError(hr));
+            return hr;
+        }
+    }
+
+    callbacks.RecordCallback =
+        [this, &output](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {
+            USNRecordInformation(output, volreader, szFullName, pElt);
+        };
+
+    if (FAILED(hr = walker.ReadJournal(callbacks)))
+    {
+        Log::Error(L"Failed to read USN journal of volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    USNJournalCursor::Volume volume;
+    volume.JournalID = journal.UsnJournalID;
+    volume.NextUsn = walker.GetNextUsn();
+    volume.SetDirectories(walker.GetUSNMap());
+
+    Log::Debug(
+        L"USN journal cursor of '{}': next USN {:#x}, {} directories",
+        loc->GetLocation(),
+        volume.NextUsn,
+        volume.Directories.size());
+
+    cursor.Set(ullSerial, std::move(volume));
+    return S_OK;
+}
+
+HRESULT Main::WalkLocation(const std::shared_ptr<Location>& loc, USNJournalCursor& cursor, ITableOutput& output)
+{
+    if (!config.strCursor.empty())
+    {
+        if (loc->GetType() == Location::Type::MountedVolume)
+        {
+            return WalkIncremental(loc, cursor, output);
+        }
+
+        Log::Warn(L"Incremental collection needs a mounted volume, '{}' is fully parsed", loc->GetLocation());
+    }
+
+    USNJournalWalkerOffline walker;
+
+    HRESULT hr = walker.Initialize(loc);
+    if (FAILED(hr))
+    {
+        if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
+        {
+            Log::Warn(L"File system not eligible for volume '{}'", loc->GetLocation());
+            return S_OK;
+        }
+
+        Log::Critical(L"Failed to init walk for volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    if (!walker.GetUsnJournal() && !config.bCarve)
+    {
+        Log::Warn(L"Did not find a USN journal on following volume '{}'", loc->GetLocation());
+        return S_OK;
+    }
+
+    IUSNJournalWalker::Callbacks callbacks;
+    callbacks.RecordCallback =
+        [](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {};
+
+    hr = config.bNameScan ? walker.ScanDirectories(loc) : walker.EnumJournal(callbacks);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to enum MFT records '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    callbacks.RecordCallback =
+        [this, &output](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {
+            USNRecordInformation(output, volreader, szFullName, pElt);
+        };
+
+    hr = config.bCarve ? walker.CarveVolume(callbacks) : walker.ReadJournal(callbacks);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to walk volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
 HRESULT Main::Run()
 {
     HRESULT hr = LoadWinTrust();
@@ -190,64 +342,81 @@ HRESULT Main::Run()
         return hr;
     }
 
-    auto outputIt = std::begin(m_outputs.Outputs());
-    for (const auto& loc : locations)
+    USNJournalCursor cursor;
+    if (!config.strCursor.empty())
     {
-        Guard::Scope onExit([this, &outputIt]() {
-            m_outputs.CloseOne(config.output, *outputIt);
-            outputIt++;
-        });
+        if (auto hrCursor = cursor.Load(config.strCursor); FAILED(hrCursor))
+        {
+            Log::Warn(
+                L"Failed to load USN journal cursor '{}', reading whole journals [{}]",
+                config.strCursor,
+                SystemError(hrCursor));
+        }
+    }
 
-        m_console.Print(L"Parsing: {} [{}]", loc->GetLocation(), boost::join(loc->GetPaths(), L", "));
-        USNJournalWalkerOffline walker;
+    // Output writers are per location only with directory or archive outputs and the cursor is shared by all the
+    // walks: otherwise journals are read one after the other
+    DWORD dwConcurrentVolumes = std::min<DWORD>(config.dwConcurrentVolumes, static_cast<DWORD>(locations.size()));
+    if (dwConcurrentVolumes > 1
+        && (!config.strCursor.empty()
+            || (config.output.Type != OutputSpec::Kind::Directory && config.output.Type != OutputSpec::Kind::Archive)))
+    {
+        Log::Warn(
+            L"Concurrent journal walks require directory or archive output and no cursor, volumes will be walked "
+            L"sequentially");
+        dwConcurrentVolumes = 1;
+    }
 
-        HRESULT hr = walker.Initialize(loc);
-        if (FAILED(hr))
-        {
-            if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
-            {
-                Log::Warn(L"File system not eligible for volume '{}'", loc->GetLocation());
-                continue;
-            }
+    auto& outputs = m_outputs.Outputs();
+    auto walk = [this, &locations, &outputs, &cursor](size_t index) {
+        Guard::Scope onExit([this, &outputs, index]() { m_outputs.CloseOne(config.output, outputs[index]); });
 
-            Log::Critical(L"Failed to init walk for volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
-            continue;
+        const auto& loc = locations[index];
+        {
+            concurrency::critical_section::scoped_lock lock(m_consoleLock);
+            m_console.Print(L"Parsing: {} [{}]", loc->GetLocation(), boost::join(loc->GetPaths(), L", "));
         }
 
-        if (!walker.GetUsnJournal())
+        return WalkLocation(loc, cursor, *outputs[index].second.Writer());
+    };
+
+    if (dwConcurrentVolumes <= 1)
+    {
+        for (size_t i = 0; i < locations.size(); i++)
         {
-            Log::Warn(L"Did not find a USN journal on following volume '{}'", loc->GetLocation());
-            continue;
+            walk(i);
         }
+    }
+    else
+    {
+        Log::Debug(L"Walking {} journals with {} concurrent walks", locations.size(), dwConcurrentVolumes);
 
-        IUSNJournalWalker::Callbacks callbacks;
-        callbacks.RecordCallback =
-            [](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {};
+        std::atomic<size_t> nextLocation = 0;
 
-        hr = walker.EnumJournal(callbacks);
-        if (FAILED(hr))
+        std::vector<std::thread> workers;
+        for (DWORD i = 0; i < dwConcurrentVolumes; i++)
         {
-            Log::Error(L"Failed to enum MFT records '{}' [{}]", loc->GetLocation(), SystemError(hr));
-            continue;
+            workers.emplace_back([&locations, &nextLocation, &walk]() {
+                for (size_t index = nextLocation++; index < locations.size(); index = nextLocation++)
+                {
+                    walk(index);
+                }
+            });
         }
 
-        callbacks.RecordCallback =
-            [this, &outputIt](const std::shared_ptr<VolumeReader>& volreader, WCHAR* szFullName, USN_RECORD* pElt) {
-                USNRecordInformation(*outputIt->second.Writer(), volreader, szFullName, pElt);
-            };
-
-        hr = walker.ReadJournal(callbacks);
-        if (FAILED(hr))
+        for (auto& worker : workers)
         {
-            Log::Error(L"Failed to walk volume '{}' [{}]", loc->GetLocation(), SystemError(hr));
-            continue;
+            worker.join();
         }
     }
 
-    if (FAILED(hr))
+    if (!config.strCursor.empty() && !cursor.Volumes().empty())
     {
-        Log::Error("Failed during the enumeration of output items [{}]", SystemError(hr));
-        return hr;
+        if (FAILED(hr = cursor.Save(config.strCursor)))
+        {
+            Log::Error(L"Failed to save USN journal cursor '{}' [{}]", config.strCursor, SystemError(hr));
+            return hr;
+        }
     }
 
     return S_OK;
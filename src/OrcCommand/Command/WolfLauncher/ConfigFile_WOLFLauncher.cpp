@@ -94,6 +94,10 @@ HRESULT wolf_command(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent[dwIndex].AddAttribute(L"timeout", WOLFLAUNCHER_COMMAND_TIMEOUT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"resources", WOLFLAUNCHER_COMMAND_RESOURCES, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"depends", WOLFLAUNCHER_COMMAND_DEPENDS, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
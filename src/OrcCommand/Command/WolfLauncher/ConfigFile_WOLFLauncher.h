@@ -38,6 +38,8 @@ constexpr auto WOLFLAUNCHER_COMMAND_SYSTEMTYPE = 6L;
 constexpr auto WOLFLAUNCHER_COMMAND_QUEUE = 7L;
 constexpr auto WOLFLAUNCHER_COMMAND_OPTIONAL = 8L;
 constexpr auto WOLFLAUNCHER_COMMAND_TIMEOUT = 9L;
+constexpr auto WOLFLAUNCHER_COMMAND_RESOURCES = 10L;
+constexpr auto WOLFLAUNCHER_COMMAND_DEPENDS = 11L;
 
 constexpr auto WOLFLAUNCHER_DESTINATION = 0L;
 constexpr auto WOLFLAUNCHER_METHOD = 1L;
@@ -106,6 +106,72 @@ void Write(
     writer->WriteNamed(L"other_transfer", counters->OtherTransferCount);
 }
 
+void Write(
+    StructuredOutputWriter::IWriter::Ptr& writer,
+    std::wstring_view key,
+    const std::optional<Telemetry::Statistics>& statistics)
+{
+    if (!statistics)
+    {
+        return;
+    }
+
+    writer->BeginCollection(key.data());
+    Guard::Scope onExit([&]() { writer->EndCollection(key.data()); });
+
+    for (size_t i = 0; i < statistics->size(); i++)
+    {
+        const auto& counters = (*statistics)[i];
+        if (counters.Operations == 0)
+        {
+            continue;
+        }
+
+        writer->BeginElement(nullptr);
+        Guard::Scope onElementExit([&]() { writer->EndElement(nullptr); });
+
+        writer->WriteNamed(L"name", Telemetry::ToString(static_cast<Telemetry::Phase>(i)).data());
+        writer->WriteNamed(L"operations", counters.Operations);
+        writer->WriteNamed(L"bytes", counters.Bytes);
+        writer->WriteNamed(L"duration_us", static_cast<uint64_t>(counters.Duration.count()));
+    }
+}
+
+void Write(
+    StructuredOutputWriter::IWriter::Ptr& writer,
+    std::wstring_view key,
+    const std::optional<MemoryAccounting::Statistics>& statistics)
+{
+    if (!statistics)
+    {
+        return;
+    }
+
+    writer->BeginCollection(key.data());
+    Guard::Scope onExit([&]() { writer->EndCollection(key.data()); });
+
+    for (size_t i = 0; i < statistics->size(); i++)
+    {
+        const auto& usage = (*statistics)[i];
+        if (usage.Peak == 0)
+        {
+            continue;
+        }
+
+        writer->BeginElement(nullptr);
+        Guard::Scope onElementExit([&]() { writer->EndElement(nullptr); });
+
+        writer->WriteNamed(L"name", MemoryAccounting::ToString(static_cast<MemoryAccounting::Tag>(i)).data());
+        writer->WriteNamed(L"peak_bytes", usage.Peak);
+        writer->WriteNamed(L"current_bytes", usage.Current);
+        if (usage.SoftLimit)
+        {
+            writer->WriteNamed(L"soft_limit", usage.SoftLimit);
+            writer->WriteNamed(L"over_soft_limit", usage.OverSoftLimit);
+        }
+    }
+}
+
 void Write(
     StructuredOutputWriter::IWriter::Ptr& writer,
     std::wstring_view key,
@@ -280,6 +346,20 @@ void Write(StructuredOutputWriter::IWriter::Ptr& writer, const Outcome::Command&
     ::Write(writer, L"user_time", command.GetUserTime());
     ::Write(writer, L"kernel_time", command.GetKernelTime());
     ::Write(writer, L"io_counters", command.GetIOCounters());
+
+    const auto& temporaryMemoryPeak = command.GetTemporaryMemoryPeak();
+    if (temporaryMemoryPeak)
+    {
+        const auto kNodeTemporaryMemory = L"temporary_memory";
+        writer->BeginElement(kNodeTemporaryMemory);
+        Guard::Scope onTemporaryMemoryExit([&]() { writer->EndElement(kNodeTemporaryMemory); });
+
+        writer->WriteNamed(L"peak", temporaryMemoryPeak->value);
+        writer->WriteNamed(L"spill", command.GetTemporaryMemorySpills().value_or(0));
+    }
+
+    ::Write(writer, L"phases", command.GetTelemetry());
+    ::Write(writer, L"memory", command.GetMemory());
     ::Write(writer, L"output", command.GetOutput());
 }
 
@@ -338,6 +418,25 @@ void Write(StructuredOutputWriter::IWriter::Ptr& writer, const Outcome::WolfLaun
     writer->WriteNamed(L"command_line", wolfLauncher.GetCommandLineValue());
 }
 
+void Write(StructuredOutputWriter::IWriter::Ptr& writer, const HostProfile& profile)
+{
+    const auto kNodeHostProfile = L"host_profile";
+    writer->BeginElement(kNodeHostProfile);
+    Guard::Scope onExit([&]() { writer->EndElement(kNodeHostProfile); });
+
+    const auto& measures = profile.GetMeasures();
+    writer->WriteNamed(L"processors", static_cast<uint32_t>(measures.Processors));
+    writer->WriteNamed(L"physical_memory", static_cast<uint64_t>(measures.PhysicalMemory));
+    writer->WriteNamed(L"seek_penalty", measures.bSeekPenalty);
+    writer->WriteNamed(L"read_probe", static_cast<uint64_t>(measures.ProbeThroughput));
+
+    writer->WriteNamed(L"threads", static_cast<uint32_t>(profile.Threads()));
+    writer->WriteNamed(L"read_chunk_size", static_cast<uint32_t>(profile.ReadProfile().ChunkSize()));
+    writer->WriteNamed(L"read_queue_depth", static_cast<uint32_t>(profile.ReadProfile().QueueDepth()));
+    writer->WriteNamed(L"cache_size", static_cast<uint64_t>(profile.CacheSize()));
+    writer->WriteNamed(L"row_group_size", static_cast<uint32_t>(profile.RowGroupSize()));
+}
+
 }  // namespace
 
 namespace Orc::Command::Wolf::Outcome {
@@ -381,6 +480,11 @@ Orc::Result<void> Write(const Outcome& outcome, StructuredOutputWriter::IWriter:
 
             ::Write(writer, outcome.GetWolfLauncher());
 
+            if (const auto& hostProfile = outcome.GetHostProfile())
+            {
+                ::Write(writer, *hostProfile);
+            }
+
             {
                 const auto kNodeConsole = L"console";
                 writer->BeginElement(kNodeConsole);
@@ -17,6 +17,9 @@
 #include <windows.h>
 
 #include "StructuredOutputWriter.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
+#include "HostProfile.h"
 #include "Utils/Result.h"
 
 namespace Orc::Command::Wolf::Outcome {
@@ -168,6 +171,21 @@ public:
     const std::optional<IO_COUNTERS>& GetIOCounters() const { return m_ioCounters; }
     void SetIOCounters(const IO_COUNTERS& counters) { m_ioCounters = counters; }
 
+    // Peak memory used by the temporary streams of the command (redirected outputs) and number of spills to disk
+    const std::optional<FileSize>& GetTemporaryMemoryPeak() const { return m_temporaryMemoryPeak; }
+    void SetTemporaryMemoryPeak(uint64_t size) { m_temporaryMemoryPeak = FileSize(size); }
+
+    std::optional<uint64_t> GetTemporaryMemorySpills() const { return m_temporaryMemorySpills; }
+    void SetTemporaryMemorySpills(uint64_t count) { m_temporaryMemorySpills = count; }
+
+    // Operations, bytes and time of the command's main phases, as saved by the tool itself
+    const std::optional<Telemetry::Statistics>& GetTelemetry() const { return m_telemetry; }
+    void SetTelemetry(const Telemetry::Statistics& statistics) { m_telemetry = statistics; }
+
+    // Peak memory of the command's subsystems, as saved by the tool itself
+    const std::optional<MemoryAccounting::Statistics>& GetMemory() const { return m_memory; }
+    void SetMemory(const MemoryAccounting::Statistics& statistics) { m_memory = statistics; }
+
     const Origin& GetOrigin() const { return m_origin; }
     Origin& GetOrigin() { return m_origin; }
 
@@ -216,6 +234,10 @@ private:
     std::optional<std::chrono::seconds> m_userTime;
     std::optional<std::chrono::seconds> m_kernelTime;
     std::optional<IO_COUNTERS> m_ioCounters;
+    std::optional<FileSize> m_temporaryMemoryPeak;
+    std::optional<uint64_t> m_temporaryMemorySpills;
+    std::optional<Telemetry::Statistics> m_telemetry;
+    std::optional<MemoryAccounting::Statistics> m_memory;
     std::optional<int32_t> m_exitCode;
     std::optional<uint32_t> m_pid;
 };
@@ -435,6 +457,9 @@ public:
     const std::vector<Recipient>& Recipients() const { return m_recipients; }
     std::vector<Recipient>& Recipients() { return m_recipients; }
 
+    const std::optional<HostProfile>& GetHostProfile() const { return m_hostProfile; }
+    void SetHostProfile(const HostProfile& profile) { m_hostProfile = profile; }
+
 private:
     mutable std::mutex m_mutex;
     GUID m_id;
@@ -445,6 +470,7 @@ private:
     std::wstring m_outlineFileName;
     std::vector<Recipient> m_recipients;
     WolfLauncher m_wolfLauncher;
+    std::optional<HostProfile> m_hostProfile;
     std::wstring m_timestamp;
     std::chrono::time_point<std::chrono::system_clock> m_startingTime;
     std::chrono::time_point<std::chrono::system_clock> m_endingTime;
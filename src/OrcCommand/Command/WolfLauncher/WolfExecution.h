@@ -19,6 +19,7 @@
 #include "CommandAgent.h"
 #include "CommandMessage.h"
 #include "Configuration/ConfigFile.h"
+#include "FileStream.h"
 #include "TableOutputWriter.h"
 #include "UploadAgent.h"
 #include "UploadMessage.h"
@@ -90,6 +91,9 @@ private:
     GetExecutableToRun(const ConfigItem& item, std::wstring& strExeToRun, std::wstring& strArgToAdd, bool& isSelf);
     HRESULT NotifyTask(const CommandNotification::Ptr& item);
 
+    // Open the archive output, staged for upload if it cannot be streamed to the upload target
+    HRESULT OpenOutputStream(std::shared_ptr<FileStream>& stream);
+
 private:
     Command::Wolf::Journal& m_journal;
     Locker<Command::Wolf::Outcome::Outcome>& m_outcome;
@@ -103,6 +107,7 @@ private:
 
     bool m_bUseJournalWhenEncrypting = true;
     bool m_bTeeClearTextOutput = false;
+    bool m_bChunkedEncryption = false;
 
     bool m_bOptional = false;
 
@@ -110,7 +115,7 @@ private:
 
     std::shared_ptr<WOLFExecutionTerminate> m_pTermination = nullptr;
 
-    ArchiveMessage::UnboundedMessageBuffer m_ArchiveMessageBuffer;
+    ArchiveMessage::BoundedMessageBuffer m_ArchiveMessageBuffer {&ArchiveMessage::Weigh};
     std::unique_ptr<Concurrency::call<ArchiveNotification::Notification>> m_archiveNotification;
     std::unique_ptr<ArchiveAgent> m_archiveAgent;
     std::wstring m_strArchiveName;
@@ -121,6 +126,8 @@ private:
     std::wstring m_strOutputFileName;
     std::wstring m_strArchiveFullPath;
     std::wstring m_strArchiveFileName;
+    bool m_bStreamed = false;
+    std::wstring m_strStagedOutputFullPath;
     Repeat m_RepeatBehavior = Repeat::NotSet;
 
     OutputSpec m_Temporary;
@@ -172,6 +179,10 @@ public:
         return S_OK;
     };
 
+    // Temporary directory of this execution only, see Main::PlaceTemporary
+    void SetTemporaryPath(const std::filesystem::path& path) { m_Temporary.Path = path; }
+    const std::filesystem::path& GetTemporaryPath() const { return m_Temporary.Path; }
+
     HRESULT SetConfigStreams(const std::shared_ptr<ByteStream>& stream, const std::shared_ptr<ByteStream>& localstream)
     {
         if (stream != nullptr)
@@ -203,6 +214,10 @@ public:
     bool TeeClearTextOutput() const { return m_bTeeClearTextOutput; };
     void SetTeeClearTextOutput(bool bTeeClearTextOutput) { m_bTeeClearTextOutput = bTeeClearTextOutput; };
 
+    // Encrypt the archive with ChunkedEncryptedStream instead of a CMS enveloped message
+    bool ChunkedEncryption() const { return m_bChunkedEncryption; };
+    void SetChunkedEncryption(bool bChunkedEncryption) { m_bChunkedEncryption = bChunkedEncryption; };
+
     HRESULT SetJobTimeOutFromConfig(
         const ConfigItem& item,
         std::chrono::milliseconds dwCmdTimeOut,
@@ -248,6 +263,17 @@ public:
     const std::wstring& GetArchiveFileName() const { return m_strArchiveFileName; };
     const std::wstring& GetOutputFullPath() const { return m_strOutputFullPath; };
     const std::wstring& GetOutputFileName() const { return m_strOutputFileName; };
+
+    // Write the archive straight to 'remotePath' on the upload target instead of staging it for upload
+    void SetStreamingPath(const std::wstring& remotePath)
+    {
+        if (!m_bStreamed)
+            m_strStagedOutputFullPath = m_strOutputFullPath;
+        m_strOutputFullPath = remotePath;
+        m_bStreamed = true;
+    }
+    bool IsStreamed() const { return m_bStreamed; }
+
     const std::vector<CommandMessage::Message>& GetCommands() const { return m_Commands; };
 
     std::vector<std::shared_ptr<Recipient>>& Recipients() { return m_Recipients; };
@@ -25,6 +25,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include <boost/tokenizer.hpp>
 #include "Utils/WinApi.h"
@@ -41,6 +42,29 @@ constexpr auto WINVER_MINOR = 2;
 constexpr auto WINVER_PLUS = 4;
 constexpr auto WINVER_MINUS = 5;
 
+namespace {
+
+// Split a ',' or ';' separated attribute, ignoring empty items
+std::vector<std::wstring> SplitList(const std::wstring& list)
+{
+    boost::char_separator<wchar_t> sep(L",;");
+    boost::tokenizer<boost::char_separator<wchar_t>, std::wstring::const_iterator, std::wstring> tokens(list, sep);
+
+    std::vector<std::wstring> items;
+    for (const auto& token : tokens)
+    {
+        auto first = token.find_first_not_of(L" \t");
+        if (first == std::wstring::npos)
+            continue;
+
+        items.push_back(token.substr(first, token.find_last_not_of(L" \t") - first + 1));
+    }
+
+    return items;
+}
+
+}  // namespace
+
 HRESULT
 WolfExecution::GetExecutableToRun(const ConfigItem& item, wstring& strExeToRun, wstring& strArgToAdd, bool& isSelf)
 {
@@ -467,6 +491,16 @@ CommandMessage::Message WolfExecution::SetCommandFromConfigItem(const ConfigItem
                     else
                         command->PushOutputFile(output.dwOrderIndex, strName, strName, szPattern, true);
                 }
+                else if (!_wcsicmp(output[WOLFLAUNCHER_OUTSOURCE].c_str(), L"Pipe"))
+                {
+                    if (szPattern == NULL)
+                    {
+                        Log::Info(L"The pipe output '{}' is missing an argument", strName);
+                        hr = E_FAIL;
+                        return;
+                    }
+                    command->PushOutputPipe(output.dwOrderIndex, strName, strName, szPattern, true);
+                }
                 else if (!_wcsicmp(output[WOLFLAUNCHER_OUTSOURCE].c_str(), L"Directory"))
                 {
                     if (output[WOLFLAUNCHER_OUTFILEMATCH])
@@ -534,6 +568,31 @@ CommandMessage::Message WolfExecution::SetCommandFromConfigItem(const ConfigItem
         command->SetTimeout(timeout);
     }
 
+    if (item[WOLFLAUNCHER_COMMAND_RESOURCES])
+    {
+        // Volume names in "io:<volume>" may use environment variables like "io:%SystemDrive%"
+        std::vector<std::wstring> resources;
+        for (const auto& resource : SplitList(item[WOLFLAUNCHER_COMMAND_RESOURCES]))
+        {
+            std::error_code ec;
+            auto expanded = ExpandEnvironmentStringsApi(resource.c_str(), ec);
+            if (ec)
+            {
+                Log::Warn(L"Failed to expand resource '{}' of command '{}' [{}]", resource, command->Keyword(), ec);
+                expanded = resource;
+            }
+
+            resources.push_back(std::move(expanded));
+        }
+
+        command->SetResources(std::move(resources));
+    }
+
+    if (item[WOLFLAUNCHER_COMMAND_DEPENDS])
+    {
+        command->SetDependencies(SplitList(item[WOLFLAUNCHER_COMMAND_DEPENDS]));
+    }
+
     return command;
 }
 
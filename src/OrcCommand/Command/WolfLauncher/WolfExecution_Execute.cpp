@@ -19,6 +19,9 @@
 #include "FileStream.h"
 #include "TeeStream.h"
 #include "TemporaryStream.h"
+#include "TemporaryMemoryBudget.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
 #include "JournalingStream.h"
 #include "AccumulatingStream.h"
 
@@ -36,6 +39,7 @@
 #include "SystemDetails.h"
 
 #include "EncodeMessageStream.h"
+#include "ChunkedEncryptedStream.h"
 
 #include "WolfTask.h"
 #include "Convert.h"
@@ -65,6 +69,7 @@ Outcome::Command::Output::Type ToOutputFileType(CommandParameter::ParamKind kind
         case ParamKind::StdOutErr:
             return Type::StdOutErr;
         case ParamKind::OutFile:
+        case ParamKind::OutPipe:
             return Type::File;
         case ParamKind::OutDirectory:
             return Type::Directory;
@@ -83,6 +88,7 @@ bool HasFileOutput(Orc::CommandParameter::ParamKind kind)
         case Orc::CommandParameter::ParamKind::StdErr:
         case Orc::CommandParameter::ParamKind::StdOutErr:
         case Orc::CommandParameter::ParamKind::OutFile:
+        case Orc::CommandParameter::ParamKind::OutPipe:
         case Orc::CommandParameter::ParamKind::OutDirectory:
             return true;
         default:
@@ -331,6 +337,24 @@ void WolfExecution::ArchiveNotificationHandler(const ArchiveNotification::Notifi
     }
 }
 
+HRESULT WolfExecution::OpenOutputStream(std::shared_ptr<FileStream>& stream)
+{
+    stream = std::make_shared<FileStream>();
+
+    HRESULT hr = stream->WriteTo(m_strOutputFullPath.c_str());
+    if (SUCCEEDED(hr) || !m_bStreamed)
+    {
+        return hr;
+    }
+
+    Log::Warn(L"Failed to stream archive to '{}', staging it for upload [{}]", m_strOutputFullPath, SystemError(hr));
+    m_journal.Print(m_commandSet, L"Archive", L"Failed to stream to '{}' [{}]", m_strOutputFullPath, SystemError(hr));
+
+    m_strOutputFullPath = m_strStagedOutputFullPath;
+    m_bStreamed = false;
+    return stream->WriteTo(m_strOutputFullPath.c_str());
+}
+
 HRESULT WolfExecution::CreateArchiveAgent()
 {
     HRESULT hr = E_FAIL;
@@ -354,8 +378,8 @@ HRESULT WolfExecution::CreateArchiveAgent()
             return E_FAIL;
         }
 
-        auto pOutputStream = std::make_shared<FileStream>();
-        if (FAILED(hr = pOutputStream->WriteTo(m_strOutputFullPath.c_str())))
+        std::shared_ptr<FileStream> pOutputStream;
+        if (FAILED(hr = OpenOutputStream(pOutputStream)))
         {
             Log::Error(L"Failed to open file for write: '{}' [{}]", m_strOutputFullPath, SystemError(hr));
             return hr;
@@ -369,20 +393,44 @@ HRESULT WolfExecution::CreateArchiveAgent()
             return hr;
         }
 
-        auto pEncodingStream = std::make_shared<EncodeMessageStream>();
+        std::shared_ptr<ByteStream> pEncodingStream;
 
-        for (auto& recipient : m_Recipients)
+        if (ChunkedEncryption())
         {
-            if (FAILED(hr = pEncodingStream->AddRecipient(recipient->Certificate)))
+            std::vector<CBinaryBuffer> certificates;
+            for (auto& recipient : m_Recipients)
+            {
+                certificates.push_back(recipient->Certificate);
+            }
+
+            auto pChunkedStream = std::make_shared<ChunkedEncryptedStream>();
+            if (FAILED(hr = pChunkedStream->OpenToEncrypt(certificates, m_archiveHashStream)))
             {
-                Log::Error(L"Failed to add certificate for recipient '{}' [{}]", recipient->Name, SystemError(hr));
+                Log::Error(L"Failed initialize encryption stream for '{}' [{}]", m_strOutputFullPath, SystemError(hr));
                 return hr;
             }
+
+            pEncodingStream = pChunkedStream;
         }
-        if (FAILED(hr = pEncodingStream->Initialize(m_archiveHashStream)))
+        else
         {
-            Log::Error(L"Failed initialize encoding stream for '{}' [{}]", m_strOutputFullPath, SystemError(hr));
-            return hr;
+            auto pMessageStream = std::make_shared<EncodeMessageStream>();
+
+            for (auto& recipient : m_Recipients)
+            {
+                if (FAILED(hr = pMessageStream->AddRecipient(recipient->Certificate)))
+                {
+                    Log::Error(L"Failed to add certificate for recipient '{}' [{}]", recipient->Name, SystemError(hr));
+                    return hr;
+                }
+            }
+            if (FAILED(hr = pMessageStream->Initialize(m_archiveHashStream)))
+            {
+                Log::Error(L"Failed initialize encoding stream for '{}' [{}]", m_strOutputFullPath, SystemError(hr));
+                return hr;
+            }
+
+            pEncodingStream = pMessageStream;
         }
 
         std::shared_ptr<ByteStream> pFinalStream;
@@ -422,7 +470,8 @@ HRESULT WolfExecution::CreateArchiveAgent()
 
             auto pTeeTream = std::make_shared<TeeStream>();
 
-            if (FAILED(hr = pTeeTream->Open({pClearStream, pFinalStream})))
+            // The clear text copy and the encrypted archive are independent outputs
+            if (FAILED(hr = pTeeTream->Open({pClearStream, pFinalStream}, true)))
             {
                 Log::Error(
                     L"Failed initialize tee stream for '{}' & '{}' [{}]",
@@ -444,7 +493,16 @@ HRESULT WolfExecution::CreateArchiveAgent()
     {
         ArchiveFormat fmt = OrcArchive::GetArchiveFormat(m_strArchiveFileName);
 
-        auto request = ArchiveMessage::MakeOpenRequest(m_strOutputFullPath, fmt, nullptr, m_strCompressionLevel);
+        // The archive agent opens local archives itself
+        std::shared_ptr<FileStream> pOutputStream;
+        if (m_bStreamed && FAILED(hr = OpenOutputStream(pOutputStream)))
+        {
+            Log::Error(L"Failed to open file for write: '{}' [{}]", m_strOutputFullPath, SystemError(hr));
+            return hr;
+        }
+
+        auto request =
+            ArchiveMessage::MakeOpenRequest(m_strOutputFullPath, fmt, pOutputStream, m_strCompressionLevel);
         Concurrency::send(m_ArchiveMessageBuffer, request);
     }
 
@@ -629,6 +687,26 @@ HRESULT WolfExecution::CreateCommandAgent(
                                 {
                                     commandOutcome.SetIOCounters(*taskIoCounters);
                                 }
+
+                                const auto temporaryMemory =
+                                    TemporaryMemoryBudget::Instance().GetStatistics(task->Command());
+                                if (temporaryMemory)
+                                {
+                                    commandOutcome.SetTemporaryMemoryPeak(temporaryMemory->PeakUsage);
+                                    commandOutcome.SetTemporaryMemorySpills(temporaryMemory->SpillCount);
+                                }
+
+                                const auto telemetry = Telemetry::Load(task->Pid());
+                                if (telemetry)
+                                {
+                                    commandOutcome.SetTelemetry(*telemetry);
+                                }
+
+                                const auto memory = MemoryAccounting::Load(task->Pid());
+                                if (memory)
+                                {
+                                    commandOutcome.SetMemory(*memory);
+                                }
                             }
                         }
 
@@ -850,6 +928,8 @@ HRESULT WolfExecution::CompleteArchive(UploadMessage::ITarget* pUploadMessageQue
         return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
     }
 
+    m_ArchiveMessageBuffer.GetStatistics().LogStatistics(m_commandSet);
+
     if (m_pTermination)
     {
         Robustness::RemoveTerminationHandler(m_pTermination);
@@ -881,7 +961,8 @@ HRESULT WolfExecution::CompleteArchive(UploadMessage::ITarget* pUploadMessageQue
             archiveSize());
     }
 
-    if (pUploadMessageQueue && m_Output.UploadOutput)
+    // A streamed archive is already on the upload target
+    if (pUploadMessageQueue && m_Output.UploadOutput && !m_bStreamed)
     {
         if (m_Output.UploadOutput->IsFileUploaded(m_strOutputFileName))
         {
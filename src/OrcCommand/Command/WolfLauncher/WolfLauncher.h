@@ -15,6 +15,8 @@
 #include <agents.h>
 #include <set>
 #include <chrono>
+#include <deque>
+#include <future>
 
 #include <boost/logic/tribool.hpp>
 
@@ -105,6 +107,40 @@ public:
         std::chrono::milliseconds msArchiveTimeOut = 10min;
         std::chrono::milliseconds msCommandTerminationTimeOut = 3h;
 
+        // Memory shared by all temporary streams (redirected outputs, ...) before spilling to disk, 0 for unlimited
+        ULONGLONG ullTempMemoryBudget = 0LL;
+
+        // Temporary directory of each execution is chosen away from the disks it collects (see TemporaryPlacement)
+        bool bAutoTempPlacement = false;
+
+        // Messages, and bytes of their streams, queued to an archive or upload agent before the producers wait
+        ULONGLONG ullQueueMessages = MessageBufferCapacity::kDefaultMessages;
+        ULONGLONG ullQueueBytes = MessageBufferCapacity::kDefaultBytes;
+
+        // Directory where embedded tools and libraries are extracted once for all commands (kept between runs)
+        std::optional<std::wstring> strExtractionCache;
+
+        // File where catalog signature verifications are shared by all commands (kept between runs)
+        std::optional<std::wstring> strAuthenticodeCache;
+
+        // Entries of the table where file hashes are shared by all commands during the run, 0 to disable
+        DWORD dwHashCacheEntries = 0L;
+
+        // Read latency (in msecs) above which commands throttle their volume reads, unset to disable
+        std::optional<DWORD> dwIoThrottleLatency;
+
+        // Archives completing in the background while the next command sets run, unset to complete each in turn
+        std::optional<DWORD> dwPipelinedArchives;
+
+        // Maximum commands run at the same time while archives complete in the background, 0 for no limit
+        DWORD dwPipelinedConcurrency = 0L;
+
+        // WMI queries of the system details are run in the background at startup and shared with the commands
+        bool bPrefetchWMI = false;
+
+        // Host is measured at startup, the commands get the tuned defaults of its HostProfile
+        bool bCalibrate = false;
+
         std::wstring strDbgHelp;
 
         boost::tribool bChildDebug = boost::indeterminate;
@@ -118,6 +154,10 @@ public:
         bool bUseJournalWhenEncrypting = true;
         bool bNoJournaling = false;
         bool bTeeClearTextOutput = false;
+
+        // Archives are written straight to the upload target instead of being staged on disk for upload
+        bool bStreamUpload = false;
+        bool bChunkedEncryption = false;
         bool bWERDontShowUI = false;
         bool bNoLimits = false;
         std::set<std::wstring, CaseInsensitive> NoLimitsKeywords;
@@ -210,6 +250,15 @@ private:
 
     HRESULT Run_Execute();
     HRESULT ExecuteKeyword(WolfExecution& execution);
+    void PlaceTemporary(WolfExecution& execution);
+
+    // Stream the archive of 'execution' to the upload target when it is a file share (/stream_upload)
+    void ConfigureStreaming(WolfExecution& execution);
+
+    // Complete the archive of 'execution' in the background (/pipeline)
+    void CompleteArchiveInBackground(WolfExecution& execution);
+    // Wait until no more than 'dwMaxPending' archives complete in the background
+    HRESULT WaitForPendingArchives(DWORD dwMaxPending);
     HRESULT Run_Keywords();
 
     void ReadLogConfiguration(const ConfigItem& configItem, bool hasConsoleConfigItem);
@@ -229,9 +278,12 @@ private:
     std::shared_ptr<ByteStream> m_pLocalConfigStream;
 
     std::shared_ptr<UploadAgent> m_pUploadAgent;
-    std::unique_ptr<UploadMessage::UnboundedMessageBuffer> m_pUploadMessageQueue;
+    std::unique_ptr<UploadMessage::BoundedMessageBuffer> m_pUploadMessageQueue;
     std::unique_ptr<Concurrency::call<UploadNotification::Notification>> m_pUploadNotification;
     std::vector<std::wstring> m_emptyDirectoriesToRemove;
+
+    // Archive completions running in the background, oldest first
+    std::deque<std::future<HRESULT>> m_pendingArchives;
 };
 
 }  // namespace Command::Wolf
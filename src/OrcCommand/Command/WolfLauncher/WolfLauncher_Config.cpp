@@ -22,6 +22,7 @@
 #include "LocationSet.h"
 #include "CaseInsensitive.h"
 #include "SystemDetails.h"
+#include "IoGovernor.h"
 #include "ConfigFile_OrcConfig.h"
 #include "ConfigFile_WOLFLauncher.h"
 #include "Log/UtilitiesLoggerConfiguration.h"
@@ -40,6 +41,9 @@ namespace {
 
 constexpr std::wstring_view kOrcOffline(L"ORC_Offline");
 
+// Temporary memory budget of the commands when archives are streamed to the upload target
+constexpr ULONGLONG kStreamingMemoryBudget = 256 * 1024 * 1024ULL;
+
 // Very close to std::filesystem::create_directories but keep tracks or created directories
 void CreateDirectories(std::filesystem::path path, std::vector<std::wstring>& newDirectories, std::error_code& ec)
 {
@@ -618,6 +622,7 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
         bool bFromDump = false;
 
         std::wstring strTags;
+        std::wstring strTempPlacement;
 
         ConsoleConfiguration::Parse(argc, argv, m_consoleConfiguration);
 
@@ -676,6 +681,34 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                         ;
                     else if (ParameterOption(argv[i] + 1, L"command_timeout", config.msCommandTerminationTimeOut))
                         ;
+                    else if (ParameterOption(argv[i] + 1, L"temp_memory_budget", config.ullTempMemoryBudget))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"temp_placement", strTempPlacement))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"queue_messages", config.ullQueueMessages))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"queue_bytes", config.ullQueueBytes))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"extraction_cache", config.strExtractionCache))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"authenticode_cache", config.strAuthenticodeCache))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"hash_cache", config.dwHashCacheEntries))
+                        ;
+                    else if (OptionalParameterOption(
+                                 argv[i] + 1,
+                                 L"io_throttle",
+                                 config.dwIoThrottleLatency,
+                                 static_cast<DWORD>(IoGovernor::kDefaultMaxLatency.count())))
+                        ;
+                    else if (ParameterOption(argv[i] + 1, L"pipeline_concurrency", config.dwPipelinedConcurrency))
+                        ;
+                    else if (OptionalParameterOption(argv[i] + 1, L"pipeline", config.dwPipelinedArchives, 1UL))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"prefetch_wmi", config.bPrefetchWMI))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"calibrate", config.bCalibrate))
+                        ;
                     else if (ParameterListOption(argv[i] + 1, L"key-", config.DisableKeywords, L","))
                         ;
                     else if (ParameterListOption(argv[i] + 1, L"-key", config.DisableKeywords, L","))
@@ -709,6 +742,10 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
                         ;
                     else if (BooleanOption(argv[i] + 1, L"tee_cleartext", config.bTeeClearTextOutput))
                         ;
+                    else if (BooleanOption(argv[i] + 1, L"stream_upload", config.bStreamUpload))
+                        ;
+                    else if (BooleanOption(argv[i] + 1, L"chunked_encryption", config.bChunkedEncryption))
+                        ;
                     else if (BooleanOption(argv[i] + 1, L"no_journaling", config.bNoJournaling))
                     {
                         config.bUseJournalWhenEncrypting = false;
@@ -752,6 +789,17 @@ HRESULT Main::GetConfigurationFromArgcArgv(int argc, LPCWSTR argv[])
             SystemDetails::SetSystemTags(std::move(tags));
         }
 
+        if (!strTempPlacement.empty())
+        {
+            if (equalCaseInsensitive(strTempPlacement, L"auto"))
+                config.bAutoTempPlacement = true;
+            else if (!equalCaseInsensitive(strTempPlacement, L"default"))
+            {
+                Log::Error(L"Invalid temporary placement: '{}' (expected 'auto' or 'default')", strTempPlacement);
+                return E_INVALIDARG;
+            }
+        }
+
         config.SelectedAction = WolfLauncherAction::Execute;
         if (bExecute)
             config.SelectedAction = WolfLauncherAction::Execute;
@@ -924,6 +972,18 @@ HRESULT Main::CheckConfiguration()
         }
     }
 
+    if (config.bStreamUpload && config.ullTempMemoryBudget == 0)
+    {
+        // Command outputs stay in memory, only spilling to disk when the archive does not keep up
+        config.ullTempMemoryBudget = kStreamingMemoryBudget;
+    }
+
+    if (config.dwPipelinedArchives && *config.dwPipelinedArchives == 0)
+    {
+        Log::Error("Invalid pipeline: at least one archive must be allowed to complete in the background");
+        return E_INVALIDARG;
+    }
+
     if (config.bRepeatCreateNew)
     {
         config.RepeatBehavior = WolfExecution::Repeat::CreateNew;
@@ -141,6 +141,64 @@ void Main::PrintUsage()
             "/command_timeout",
             "Configures the time (in minutes) the engine will wait for the last command(s) to complete. Upon timeout, "
             "the command engine will stop, kill any pending process and move on with archive completion"},
+        Usage::Parameter {
+            "/temp_memory_budget=<Bytes>",
+            "Configures the memory (in bytes) shared by all commands' temporary outputs. Above this budget, the largest "
+            "outputs are moved to temporary files (default: unlimited)"},
+        Usage::Parameter {
+            "/temp_placement=<auto|default>",
+            "Configures where each command set writes its temporary files. 'auto' selects a RAM disk or the fastest "
+            "writable volume on another physical disk than the collected volumes (default: TempDir)"},
+        Usage::Parameter {
+            "/queue_messages=<Count>",
+            "Configures the number of messages queued to the archive and upload agents. Above it, commands and outputs "
+            "wait for the agents (default: 1024, 0 for unlimited)"},
+        Usage::Parameter {
+            "/queue_bytes=<Bytes>",
+            "Configures the size (in bytes) of the output streams queued to the archive and upload agents. Above it, "
+            "commands and outputs wait for the agents (default: 1GB, 0 for unlimited)"},
+        Usage::Parameter {
+            "/extraction_cache=<Directory>",
+            "Extracts embedded tools and libraries once to this directory, shared by all commands and kept for the "
+            "next runs (default: extracted to the temporary directory by each command)"},
+        Usage::Parameter {
+            "/authenticode_cache=<File>",
+            "Shares catalog signature verifications between commands in this file, kept for the next runs. Entries "
+            "are invalidated when catalogs are updated"},
+        Usage::Parameter {
+            "/hash_cache=<Entries>",
+            "Shares the hashes of up to this number of files between commands during the run: files are hashed once "
+            "while unmodified (default: disabled)"},
+        Usage::Parameter {
+            "/io_throttle[=<Milliseconds>]",
+            "Throttles the volume reads of the commands when their latency exceeds this value (default: 20): reads "
+            "are delayed while the disk is busy and get a low I/O priority"},
+        Usage::Parameter {
+            "/pipeline[=<Archives>]",
+            "Runs the next command set while the archives of up to this number of previous ones complete in the "
+            "background (default: 1)"},
+        Usage::Parameter {
+            "/pipeline_concurrency=<Commands>",
+            "Limits the commands run at the same time while archives complete in the background (default: the "
+            "command set's own limit)"},
+        Usage::Parameter {
+            "/prefetch_wmi",
+            "Queries the system details through WMI in the background at startup. Commands load them from the "
+            "temporary directory instead of querying WMI again"},
+        Usage::Parameter {
+            "/calibrate",
+            "Measures the host at startup (processors, memory, disks of the target volumes and a short read probe) "
+            "and gives the commands tuned defaults for their threads, volume reads, cache sizes and row groups. "
+            "Explicit settings are kept"},
+        Usage::Parameter {
+            "/stream_upload",
+            "Writes archives straight to the upload share instead of staging them in the output directory (file copy "
+            "or BITS over SMB, 'move' operation only). Command outputs stay in memory within the temporary memory "
+            "budget (default: 256MB)"},
+        Usage::Parameter {
+            "/chunked_encryption",
+            "Encrypts archives by independent AES-256-GCM chunks, with a key enveloped for the recipients, instead of "
+            "a CMS message: encryption and decryption use all the cores and can start at any offset"},
         Usage::Parameter {
             "/NoLimits[:<KeyWord1>,<Keyword2>, ...]",
             "Override specified limits on GetThis or GetSamples on all commands or comma separated list (output can "
@@ -194,6 +252,58 @@ void Main::PrintParameters()
     PrintValue(
         node, L"Command timeout", std::chrono::duration_cast<std::chrono::minutes>(config.msCommandTerminationTimeOut));
     PrintValue(node, L"Archive timeout", std::chrono::duration_cast<std::chrono::minutes>(config.msArchiveTimeOut));
+    if (config.ullTempMemoryBudget)
+    {
+        PrintValue(node, L"Temporary memory budget", Traits::ByteQuantity(config.ullTempMemoryBudget));
+    }
+    if (config.bAutoTempPlacement)
+    {
+        PrintValue(node, L"Temporary placement", L"auto");
+    }
+    if (config.ullQueueMessages != MessageBufferCapacity::kDefaultMessages
+        || config.ullQueueBytes != MessageBufferCapacity::kDefaultBytes)
+    {
+        PrintValue(
+            node,
+            L"Agent queue capacity",
+            fmt::format(L"{} messages, {}", config.ullQueueMessages, Traits::ByteQuantity(config.ullQueueBytes)));
+    }
+    if (config.strExtractionCache)
+    {
+        PrintValue(node, L"Extraction cache", *config.strExtractionCache);
+    }
+    if (config.strAuthenticodeCache)
+    {
+        PrintValue(node, L"Authenticode cache", *config.strAuthenticodeCache);
+    }
+    if (config.dwHashCacheEntries)
+    {
+        PrintValue(node, L"Hash cache entries", config.dwHashCacheEntries);
+    }
+    if (config.dwIoThrottleLatency)
+    {
+        PrintValue(node, L"I/O throttle latency", std::chrono::milliseconds(*config.dwIoThrottleLatency));
+    }
+    if (config.bPrefetchWMI)
+    {
+        PrintValue(node, L"Prefetch WMI", config.bPrefetchWMI);
+    }
+    if (config.bCalibrate)
+    {
+        PrintValue(node, L"Calibrate", config.bCalibrate);
+    }
+    if (config.dwPipelinedArchives)
+    {
+        PrintValue(node, L"Pipelined archives", *config.dwPipelinedArchives);
+        if (config.dwPipelinedConcurrency)
+        {
+            PrintValue(node, L"Pipelined concurrency", config.dwPipelinedConcurrency);
+        }
+    }
+    if (config.bStreamUpload)
+    {
+        PrintValue(node, L"Stream upload", config.bStreamUpload);
+    }
 
     const auto kNoLimits = L"No limits";
     if (config.NoLimitsKeywords.empty())
@@ -10,6 +10,7 @@
 
 #include "WolfLauncher.h"
 
+#include <algorithm>
 #include <filesystem>
 
 #include <boost/logic/tribool.hpp>
@@ -27,6 +28,16 @@
 #include "FileStream.h"
 #include "SystemIdentity.h"
 #include "CryptoHashStream.h"
+#include "TemporaryMemoryBudget.h"
+#include "TemporaryPlacement.h"
+#include "ExtractionCache.h"
+#include "HashCache.h"
+#include "IoGovernor.h"
+#include "HostProfile.h"
+#include "Telemetry.h"
+#include "Authenticode.h"
+#include "LocationSet.h"
+#include "Configuration/ConfigCache.h"
 
 #include "Utils/Guard.h"
 #include "Utils/TypeTraits.h"
@@ -362,6 +373,40 @@ Orc::Result<void> DumpOutcome(Command::Wolf::Outcome::Outcome& outcome, const Ou
     return Orc::Success<void>();
 }
 
+// Free space required on a volume to hold the temporary files of a command set
+constexpr ULONGLONG kTempPlacementMinFreeSpace = 1024 * 1024 * 1024ULL;
+
+// Volumes read by a command set: the system volume and any drive named in the arguments of its commands ("C:\",
+// "D:\Windows", ...). Physical drives and offline images do not name a volume and are not found.
+std::vector<std::wstring> GetTargetVolumes(const WolfExecution& exec)
+{
+    std::vector<std::wstring> volumes;
+
+    WCHAR szSystemDrive[MAX_PATH];
+    if (ExpandEnvironmentStringsW(L"%SystemDrive%\\", szSystemDrive, MAX_PATH))
+        volumes.emplace_back(szSystemDrive);
+
+    for (const auto& command : exec.GetCommands())
+    {
+        for (const auto& parameter : command->GetParameters())
+        {
+            if (parameter.Kind != CommandParameter::Argument)
+                continue;
+
+            const auto& argument = parameter.Keyword;
+            for (size_t i = 0; i + 1 < argument.size(); ++i)
+            {
+                if (argument[i + 1] != L':' || !iswalpha(argument[i]) || (i > 0 && iswalnum(argument[i - 1])))
+                    continue;
+
+                volumes.push_back(fmt::format(L"{}:\\", static_cast<wchar_t>(towupper(argument[i]))));
+            }
+        }
+    }
+
+    return volumes;
+}
+
 }  // namespace
 
 namespace Orc {
@@ -406,7 +451,7 @@ HRESULT Main::InitializeUpload(const OutputSpec::Upload& uploadspec)
         return S_OK;
     }
 
-    auto uploadMessageQueue = std::make_unique<UploadMessage::UnboundedMessageBuffer>();
+    auto uploadMessageQueue = std::make_unique<UploadMessage::BoundedMessageBuffer>(&UploadMessage::Weigh);
     auto uploadNotification = std::make_unique<concurrency::call<UploadNotification::Notification>>(
         [this](const UploadNotification::Notification& upload) {
             const std::wstring operation = L"Upload";
@@ -509,6 +554,7 @@ HRESULT Main::CompleteUpload()
     {
         Concurrency::send(m_pUploadMessageQueue.get(), UploadMessage::MakeCompleteRequest());
         concurrency::agent::wait(m_pUploadAgent.get());
+        m_pUploadMessageQueue->GetStatistics().LogStatistics(L"Upload");
     }
 
     return S_OK;
@@ -834,6 +880,110 @@ HRESULT Main::Run_Execute()
         Log::Warn("Failed to configure default altitude [{}]", SystemError(hr));
     }
 
+    TemporaryMemoryBudget::Instance().SetLimit(config.ullTempMemoryBudget);
+
+    MessageBufferCapacity queueCapacity;
+    queueCapacity.Messages = config.ullQueueMessages;
+    queueCapacity.Bytes = config.ullQueueBytes;
+    MessageBufferCapacity::SetDefault(queueCapacity);
+
+    if (config.strExtractionCache)
+    {
+        hr = ExtractionCache::ConfigureDirectory(*config.strExtractionCache);
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to configure extraction cache [{}]", SystemError(hr));
+        }
+    }
+
+    if (config.strAuthenticodeCache)
+    {
+        hr = AuthenticodeCache::ConfigurePersistentCache(*config.strAuthenticodeCache);
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to configure authenticode cache [{}]", SystemError(hr));
+        }
+    }
+
+    if (config.dwHashCacheEntries)
+    {
+        hr = HashCache::Instance().Create(config.dwHashCacheEntries);
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to create hash cache [{}]", SystemError(hr));
+        }
+    }
+
+    if (config.dwIoThrottleLatency)
+    {
+        hr = IoGovernor::Instance().Configure(std::chrono::milliseconds(*config.dwIoThrottleLatency));
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to configure I/O throttling [{}]", SystemError(hr));
+        }
+    }
+
+    if (config.bCalibrate)
+    {
+        std::vector<std::wstring> volumes;
+        for (const auto& exec : m_wolfexecs)
+        {
+            for (auto& volume : ::GetTargetVolumes(*exec))
+            {
+                if (std::find(std::cbegin(volumes), std::cend(volumes), volume) == std::cend(volumes))
+                    volumes.push_back(std::move(volume));
+            }
+        }
+
+        auto profile = HostProfile::Derive(HostProfile::Measure(volumes));
+        hr = profile.Configure();
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to configure host profile [{}]", SystemError(hr));
+        }
+
+        auto [outcome, lock] = m_outcome.Get();
+        outcome.SetHostProfile(profile);
+    }
+
+    hr = Telemetry::ConfigureDirectory(config.TempWorkingDir.Path + L"\\Telemetry");
+    if (FAILED(hr))
+    {
+        Log::Warn("Failed to configure command statistics collection [{}]", SystemError(hr));
+    }
+
+    hr = SystemDetails::ConfigureSnapshot(config.TempWorkingDir.Path + L"\\SystemDetails");
+    if (FAILED(hr))
+    {
+        Log::Warn("Failed to configure system details snapshot [{}]", SystemError(hr));
+    }
+    else if (config.bPrefetchWMI)
+    {
+        SystemDetails::PrefetchWMI();
+    }
+
+    hr = ConfigCache::ConfigureDirectory(config.TempWorkingDir.Path + L"\\ConfigCache");
+    if (FAILED(hr))
+    {
+        Log::Warn("Failed to configure configuration cache [{}]", SystemError(hr));
+    }
+
+    hr = LocationCache::ConfigureDirectory(config.TempWorkingDir.Path + L"\\LocationCache");
+    if (FAILED(hr))
+    {
+        Log::Warn("Failed to configure location cache [{}]", SystemError(hr));
+    }
+    else
+    {
+        // Mounted volumes and physical drives are enumerated once, commands load them from the cache
+        LocationSet locations;
+        hr = locations.EnumerateLocations();
+        if (FAILED(hr))
+        {
+            Log::Warn("Failed to enumerate locations for the location cache [{}]", SystemError(hr));
+        }
+    }
+
     hr = SetLauncherPriority(config.Priority);
     if (FAILED(hr))
     {
@@ -951,6 +1101,7 @@ HRESULT Main::Run_Execute()
         }
 
         exec->SetUseJournalWhenEncrypting(config.bUseJournalWhenEncrypting);
+        exec->SetChunkedEncryption(config.bChunkedEncryption);
 
         // Print command parameters and eventually skip it
         {
@@ -961,6 +1112,7 @@ HRESULT Main::Run_Execute()
             auto parametersNode = commandSetNode.AddNode("Parameters");
             PrintValue(
                 parametersNode, L"UseEncryptionJournal", exec->IsChildDebugActive(config.bUseJournalWhenEncrypting));
+            PrintValue(parametersNode, L"ChunkedEncryption", config.bChunkedEncryption);
             PrintValue(parametersNode, L"Debug", exec->IsChildDebugActive(config.bChildDebug));
             PrintValue(parametersNode, L"RepeatBehavior", WolfExecution::ToString(exec->RepeatBehaviour()));
 
@@ -1062,6 +1214,11 @@ HRESULT Main::Run_Execute()
             commandSetNode.AddEmptyLine();
         }
 
+        if (config.bStreamUpload)
+        {
+            ConfigureStreaming(*exec);
+        }
+
         hr = ExecuteKeyword(*exec);
         if (FAILED(hr))
         {
@@ -1070,6 +1227,9 @@ HRESULT Main::Run_Execute()
         }
     }
 
+    // Outcome and uploads need every archive
+    WaitForPendingArchives(0L);
+
     auto rv = CreateAndUploadOutcome();
     if (rv.has_error())
     {
@@ -1152,8 +1312,44 @@ HRESULT Main::Run_Execute()
     return S_OK;
 }
 
+void Main::PlaceTemporary(WolfExecution& exec)
+{
+    const auto placement = TemporaryPlacement::Choose(
+        ::GetTargetVolumes(exec), config.TempWorkingDir.Path, ::kTempPlacementMinFreeSpace);
+
+    auto path = placement.Path;
+    if (placement.Placement != TemporaryPlacement::Kind::Default)
+    {
+        std::error_code ec;
+        if (std::filesystem::create_directory(path, ec))
+        {
+            m_emptyDirectoriesToRemove.push_back(path);
+        }
+        else if (ec)
+        {
+            Log::Warn(
+                L"Failed to create temporary directory '{}', using '{}' [{}]", path, config.TempWorkingDir.Path, ec);
+            path = config.TempWorkingDir.Path;
+        }
+    }
+
+    Log::Info(
+        L"Temporary directory of '{}': '{}' ({}: {})",
+        exec.GetKeyword(),
+        path,
+        ToString(placement.Placement),
+        placement.Reason);
+
+    exec.SetTemporaryPath(path);
+}
+
 HRESULT Main::ExecuteKeyword(WolfExecution& exec)
 {
+    if (config.bAutoTempPlacement)
+    {
+        PlaceTemporary(exec);
+    }
+
     HRESULT hr = exec.CreateArchiveAgent();
     if (FAILED(hr))
     {
@@ -1161,9 +1357,16 @@ HRESULT Main::ExecuteKeyword(WolfExecution& exec)
         return hr;
     }
 
+    // Commands share the machine with the archives still completing in the background
+    DWORD dwConcurrency = exec.GetConcurrency();
+    if (!m_pendingArchives.empty() && config.dwPipelinedConcurrency != 0)
+    {
+        dwConcurrency = std::min(dwConcurrency, config.dwPipelinedConcurrency);
+    }
+
     // TODO: This should be moved into the try/except and benefit from RAII cleanup below but 'TerminateAllAndComplete'
     // should not be called multiple times without checking
-    hr = exec.CreateCommandAgent(config.bChildDebug, config.msRefreshTimer, exec.GetConcurrency());
+    hr = exec.CreateCommandAgent(config.bChildDebug, config.msRefreshTimer, dwConcurrency);
     if (FAILED(hr))
     {
         Log::Error("Command agent creation failed [{}]", SystemError(hr));
@@ -1176,6 +1379,11 @@ HRESULT Main::ExecuteKeyword(WolfExecution& exec)
         {
             exec.TerminateAllAndComplete();
         }
+        else if (config.dwPipelinedArchives)
+        {
+            CompleteArchiveInBackground(exec);
+            return;
+        }
 
         HRESULT hrComplete = exec.CompleteArchive(m_pUploadMessageQueue.get());
         if (FAILED(hrComplete))
@@ -1206,10 +1414,77 @@ HRESULT Main::ExecuteKeyword(WolfExecution& exec)
     catch (...)
     {
         Log::Critical("Exception raised, attempting job termination and archive completion...");
-        return E_FAIL;
+        hr = E_FAIL;
+        return hr;
     }
 }
 
+void Main::ConfigureStreaming(WolfExecution& exec)
+{
+    if (!config.Output.UploadOutput || m_pUploadAgent == nullptr)
+    {
+        Log::Debug(L"No upload configured, archive '{}' is not streamed", exec.GetOutputFileName());
+        return;
+    }
+
+    auto& upload = *config.Output.UploadOutput;
+    if (!upload.IsFileUploaded(exec.GetOutputFileName()))
+    {
+        return;
+    }
+
+    // BITS over HTTP only uploads local files, parts need the complete archive to be hashed
+    const bool bFileShare = upload.Method == OutputSpec::UploadMethod::FileCopy
+        || (upload.Method == OutputSpec::UploadMethod::BITS && upload.bitsMode == OutputSpecTypes::SMB);
+    if (!bFileShare || upload.Operation != OutputSpec::UploadOperation::Move || upload.PartSize)
+    {
+        Log::Warn(
+            L"Upload of archive '{}' cannot be streamed (file share and 'move' operation without parts only), "
+            L"staging it locally",
+            exec.GetOutputFileName());
+        return;
+    }
+
+    const auto strRemotePath = m_pUploadAgent->GetRemoteFullPath(exec.GetOutputFileName());
+    exec.SetStreamingPath(strRemotePath);
+
+    m_journal.Print(ToolName(), exec.GetKeyword(), Log::Level::Info, L"Streaming archive to '{}'", strRemotePath);
+}
+
+void Main::CompleteArchiveInBackground(WolfExecution& exec)
+{
+    WaitForPendingArchives(*config.dwPipelinedArchives - 1);
+
+    Log::Debug(L"Completing archive '{}' in the background", exec.GetOutputFileName());
+
+    // 'exec' is owned by m_wolfexecs which outlives the pending archives
+    m_pendingArchives.push_back(std::async(std::launch::async, [this, &exec]() {
+        HRESULT hr = exec.CompleteArchive(m_pUploadMessageQueue.get());
+        if (FAILED(hr))
+        {
+            Log::Error(L"Failed to complete archive '{}' [{}]", exec.GetOutputFileName(), SystemError(hr));
+        }
+        return hr;
+    }));
+}
+
+HRESULT Main::WaitForPendingArchives(DWORD dwMaxPending)
+{
+    HRESULT hr = S_OK;
+
+    while (m_pendingArchives.size() > dwMaxPending)
+    {
+        if (auto hrArchive = m_pendingArchives.front().get(); FAILED(hrArchive))
+        {
+            hr = hrArchive;
+        }
+
+        m_pendingArchives.pop_front();
+    }
+
+    return hr;
+}
+
 HRESULT Main::Run_Keywords()
 {
     auto root = m_console.OutputTree();
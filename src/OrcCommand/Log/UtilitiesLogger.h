@@ -15,6 +15,7 @@
 #include <spdlog/sinks/dist_sink.h>
 #include <spdlog/sinks/ostream_sink.h>
 
+#include "Log/AsyncSink.h"
 #include "Log/FileSink.h"
 #include "Log/Syslog/SyslogSink.h"
 
@@ -68,22 +69,39 @@ public:
         using FileSinkT = Log::FileSink<std::mutex>;
 
         FileSink()
-            : SpdlogSink(std::make_unique<FileSinkT>())
-            , m_fileSink(reinterpret_cast<FileSinkT&>(*m_sink))
+            : FileSink(std::make_shared<FileSinkT>())
         {
         }
 
         void Open(const std::filesystem::path& path, FileDisposition disposition, std::error_code& ec)
         {
-            m_fileSink.Open(path, disposition, ec);
+            m_fileSink->Open(path, disposition, ec);
         }
 
-        bool IsOpen() const { return m_fileSink.IsOpen(); }
-        void Close() { return m_fileSink.Close(); }
-        std::optional<std::filesystem::path> OutputPath() const { return m_fileSink.OutputPath(); }
+        bool IsOpen() const { return m_fileSink->IsOpen(); }
+
+        void Close()
+        {
+            // Queued messages belong to the file being closed
+            m_asyncSink.flush();
+            m_fileSink->Close();
+        }
+
+        std::optional<std::filesystem::path> OutputPath() const { return m_fileSink->OutputPath(); }
+
+        // Formatting and writing move to a background thread, see Log::AsyncSink
+        void StartAsync(Log::AsyncSink::OverflowPolicy policy) { m_asyncSink.Start(policy); }
 
     private:
-        FileSinkT& m_fileSink;
+        explicit FileSink(std::shared_ptr<FileSinkT> fileSink)
+            : SpdlogSink(std::make_unique<Log::AsyncSink>(fileSink))
+            , m_fileSink(std::move(fileSink))
+            , m_asyncSink(static_cast<Log::AsyncSink&>(*m_sink))
+        {
+        }
+
+        std::shared_ptr<FileSinkT> m_fileSink;
+        Log::AsyncSink& m_asyncSink;
     };
 
     class SyslogSink : public Log::SpdlogSink
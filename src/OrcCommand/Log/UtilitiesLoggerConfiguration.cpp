@@ -37,6 +37,7 @@ constexpr auto kLogFile = L"logfile"sv;
 constexpr auto kOutput = L"output"sv;
 constexpr auto kEncoding = L"encoding"sv;
 constexpr auto kDisposition = L"disposition"sv;
+constexpr auto kAsync = L"async"sv;
 constexpr auto kVerbose = L"verbose"sv;
 constexpr auto kNoConsole = L"noconsole"sv;
 constexpr auto kConsole = L"console"sv;
@@ -70,7 +71,8 @@ enum LogConfigItems
 
 enum LogFileConfigItems
 {
-    CONFIGITEM_LOG_LOGFILE_OUTPUT = CONFIGITEM_LOG_COMMON_ENUMCOUNT
+    CONFIGITEM_LOG_LOGFILE_OUTPUT = CONFIGITEM_LOG_COMMON_ENUMCOUNT,
+    CONFIGITEM_LOG_LOGFILE_ASYNC
 };
 
 enum SyslogConfigItems
@@ -152,6 +154,12 @@ HRESULT RegisterFileOptions(ConfigItem& parent, DWORD dwIndex)
         return hr;
     }
 
+    hr = fileNode.AddAttribute(kAsync, CONFIGITEM_LOG_LOGFILE_ASYNC, ConfigItem::OPTION);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
     return S_OK;
 }
 
@@ -267,11 +275,43 @@ bool ParseConsoleOptions(std::vector<Option>& options, UtilitiesLoggerConfigurat
     return ParseCommonOptions(options, output);
 }
 
+std::optional<Log::AsyncSink::OverflowPolicy> ParseAsyncPolicy(const std::wstring& value)
+{
+    const auto policy = Log::ToOverflowPolicy(value);
+    if (!policy)
+    {
+        Log::Error(L"Failed to parse log queue overflow policy: {} [{}]", value, policy.error());
+        return {};
+    }
+
+    return *policy;
+}
+
 bool ParseFileOptions(std::vector<Option>& options, UtilitiesLoggerConfiguration::FileOutput& output)
 {
     for (auto& option : options)
     {
-        if (!option.value || option.isParsed)
+        if (option.isParsed)
+        {
+            continue;
+        }
+
+        // 'async' alone blocks logging threads when the queue is full, 'async=drop' drops their messages
+        if (option.key == kAsync)
+        {
+            if (!option.value)
+            {
+                output.async = Log::AsyncSink::OverflowPolicy::Block;
+                option.isParsed = true;
+                continue;
+            }
+
+            output.async = ParseAsyncPolicy(std::wstring(*option.value));
+            option.isParsed = output.async.has_value();
+            continue;
+        }
+
+        if (!option.value)
         {
             continue;
         }
@@ -553,6 +593,11 @@ Orc::Result<void> ApplyFileConfiguration(UtilitiesLogger& logger, const Utilitie
         return ec;
     }
 
+    if (config.file.async)
+    {
+        logger.fileSink()->StartAsync(*config.file.async);
+    }
+
     return Success<void>();
 }
 
@@ -689,6 +734,11 @@ void FileConfigurationToOptions(const UtilitiesLoggerConfiguration::FileOutput&
     {
         options.emplace_back(kDisposition, ToString(*output.disposition));
     }
+
+    if (output.async)
+    {
+        options.emplace_back(kAsync, Log::ToString(*output.async));
+    }
 }
 
 std::optional<std::wstring> FileConfigurationToArgument(const UtilitiesLoggerConfiguration& config)
@@ -860,6 +910,12 @@ void UtilitiesLoggerConfiguration::Parse(const ConfigItem& item, UtilitiesLogger
                 configuration.file.disposition = ToFileDisposition(output.disposition);
             }
         }
+
+        const auto& async = item[CONFIGITEM_LOG_LOGFILE_NODE][CONFIGITEM_LOG_LOGFILE_ASYNC];
+        if (!async.empty())
+        {
+            configuration.file.async = ::ParseAsyncPolicy(async);
+        }
     }
 
     if (item[CONFIGITEM_LOG_SYSLOG_NODE])
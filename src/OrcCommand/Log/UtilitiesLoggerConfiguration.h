@@ -54,6 +54,9 @@ struct UtilitiesLoggerConfiguration
 
         std::optional<Text::Encoding> encoding;
         std::optional<FileDisposition> disposition;
+
+        // Formatting and writing on a background thread, with this policy when the queue is full
+        std::optional<Log::AsyncSink::OverflowPolicy> async;
     };
 
     struct SyslogOutput : Output
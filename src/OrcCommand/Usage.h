@@ -136,7 +136,23 @@ auto PrintLoggingParameters(Orc::Text::Tree& root, CustomParameterLists&&... cus
 
 constexpr std::array kUsageMiscellaneous = {
     Parameter("/Low", "Runs with lowered priority"),
-    Parameter("/Config=<ConfigFile>", "XML configuration file overriding current values")};
+    Parameter("/Config=<ConfigFile>", "XML configuration file overriding current values"),
+    Parameter(
+        "/memory_limits=<Tag:Size,...>",
+        "Memory soft limits of the subsystems (mft_walk, file_find, table_write, temporary_stream, yara), above which "
+        "they flush or spill earlier. Inherited by child processes"),
+    Parameter(
+        "/simd=<Level>",
+        "Highest instruction set used by the vectorized kernels (scalar, sse2, ssse3, sse41, avx2, avx512). 'scalar' "
+        "disables them for troubleshooting. Inherited by child processes"),
+    Parameter(
+        "/read_profile=<ChunkSize>:<QueueDepth>",
+        "Size in bytes and number of the reads kept in flight by the sequential volume reads (see 'NTFSUtil /bench'). "
+        "Inherited by child processes"),
+    Parameter(
+        "/io_trace=<Directory>",
+        "Record the volume reads of each process to '<Directory>\\<Pid>.iotrace' (see 'NTFSUtil /replay'). Inherited "
+        "by child processes")};
 
 constexpr auto kMiscParameterLocal = Usage::Parameter {
     "/Local=<File>",
@@ -155,6 +171,60 @@ constexpr auto kMiscParameterResurrectRecords = Usage::Parameter {
     "/ResurrectRecords",
     "Include records marked as \"not in use\" in enumeration. (they will need the FILE tag)"};
 
+constexpr auto kMiscParameterWalkerWorkers = Usage::Parameter {
+    "/Workers=<Count>",
+    "Use a pipelined MFT walk with 'Count' threads reading and fixing up records (0: single threaded walk)"};
+
+constexpr auto kMiscParameterWalkerOutOfOrder = Usage::Parameter {
+    "/OutOfOrder",
+    "With /Workers, allow records to be processed as soon as they are ready instead of in MFT order"};
+
+constexpr auto kMiscParameterShadowsDelta = Usage::Parameter {
+    "/ShadowsDelta",
+    "With /Shadows (internal parser), skip the records of a shadow copy which are the same on the live volume: only "
+    "the changed records are output for each shadow copy"};
+
+constexpr auto kMiscParameterConcurrentVolumes = Usage::Parameter {
+    "/ConcurrentVolumes=<Count>",
+    "Walk up to 'Count' volumes at the same time (requires directory or archive output, with /Batch defaults to the "
+    "number of processors up to 4)"};
+
+constexpr auto kMiscParameterConcurrentShadows = Usage::Parameter {
+    "/ConcurrentShadows=<Count>",
+    "Walk up to 'Count' shadow copies of a volume at the same time, their snapshots are parsed once for all of them "
+    "(requires directory or archive output)"};
+
+constexpr auto kMiscParameterUSNBuffer = Usage::Parameter {
+    "/USNBuffer=<Size>",
+    "With /Walker=USN, read the journal with 'Size' bytes requests on a reader thread and write records from an "
+    "output thread (/Workers sets the number of requests read ahead)"};
+
+constexpr auto kMiscParameterColumnWorkers = Usage::Parameter {
+    "/ColumnWorkers=<Count>",
+    "Evaluate hashes, PE, version and authenticode columns of files on 'Count' threads, the walker reads the data "
+    "(rows are no longer in walk order)"};
+
+constexpr auto kMiscParameterAuthenticodeWorkers = Usage::Parameter {
+    "/AuthenticodeWorkers=<Count>",
+    "Verify authenticode signatures on 'Count' threads while the walker evaluates the other columns of the row"};
+
+constexpr auto kMiscParameterConcurrentHives = Usage::Parameter {
+    "/ConcurrentHives=<Count>",
+    "Search up to 'Count' hives at the same time (output order is unchanged)"};
+
+constexpr auto kMiscParameterMapHives = Usage::Parameter {
+    "/MapHives",
+    "Map hive files instead of reading them and page other hives in as they are parsed (less memory, fewer reads)"};
+
+constexpr auto kMiscParameterSplitHiveWalk = Usage::Parameter {
+    "/SplitHiveWalk=<Depth>",
+    "Walk the subtrees below the first 'Depth' levels of each hive in parallel (1 or 2, output order is unchanged)"};
+
+constexpr auto kMiscParameterSkipIdenticalHives = Usage::Parameter {
+    "/SkipIdenticalHives",
+    "Search hives identical to a previous one (unchanged in a shadow copy) only once: they are reported as 'same as' "
+    "the first one instead of being searched and output again"};
+
 constexpr auto kMiscParameterCompression =
     Usage::Parameter {"/Compression=<CompressionLevel>", "Set archive compression level"};
 
@@ -187,6 +257,12 @@ auto PrintLimitsParameters(Orc::Text::Tree& root, CustomParameterLists&&... cust
 
 constexpr auto kKnownLocations = Parameter {"/KnownLocations|/kl", "Scan a set of locations known to be of interest"};
 
+constexpr auto kBatch = Parameter {
+    "/Batch=<Directory|Manifest>",
+    "Process many offline inputs ($MFT files, images...) in one run: each file of 'Directory' or each line of "
+    "'Manifest' is a location with its own output (requires directory or archive output, /ConcurrentVolumes inputs "
+    "are processed at the same time)"};
+
 template <typename... CustomParameterLists>
 auto PrintLocationParameters(Orc::Text::Tree& root, CustomParameterLists&&... customParameters)
 {
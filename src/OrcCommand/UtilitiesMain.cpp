@@ -9,6 +9,7 @@
 
 #include "UtilitiesMain.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <set>
 
@@ -31,6 +32,11 @@
 #include "EvtLibrary.h"
 #include "PSAPIExtension.h"
 #include "CaseInsensitive.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
+#include "SimdDispatch.h"
+#include "VolumeReadProfile.h"
+#include "IoTrace.h"
 #include "Utils/WinApi.h"
 
 using namespace std;
@@ -158,6 +164,55 @@ void UtilitiesMain::PrintCommonFooter(Orc::Text::Tree& root)
     durations.push_back(fmt::format(L"{} msecs", dwMillisec));
 
     PrintValue(root, L"Elapsed time", boost::join(durations, L", "));
+
+    const auto statistics = Telemetry::GetStatistics();
+    if (std::any_of(std::cbegin(statistics), std::cend(statistics), [](const auto& c) { return c.Operations > 0; }))
+    {
+        auto node = root.AddNode(L"Phases");
+        for (size_t i = 0; i < statistics.size(); i++)
+        {
+            const auto& counters = statistics[i];
+            if (counters.Operations == 0)
+            {
+                continue;
+            }
+
+            PrintValue(
+                node,
+                std::wstring(Telemetry::ToString(static_cast<Telemetry::Phase>(i))),
+                fmt::format(
+                    L"{} operation(s), {}, {} msecs",
+                    counters.Operations,
+                    Traits::ByteQuantity(counters.Bytes),
+                    std::chrono::duration_cast<std::chrono::milliseconds>(counters.Duration).count()));
+        }
+    }
+
+    const auto memory = MemoryAccounting::GetStatistics();
+    if (std::any_of(std::cbegin(memory), std::cend(memory), [](const auto& usage) { return usage.Peak > 0; }))
+    {
+        auto node = root.AddNode(L"Memory");
+        for (size_t i = 0; i < memory.size(); i++)
+        {
+            const auto& usage = memory[i];
+            if (usage.Peak == 0)
+            {
+                continue;
+            }
+
+            auto text = fmt::format(
+                L"current: {}, peak: {}", Traits::ByteQuantity(usage.Current), Traits::ByteQuantity(usage.Peak));
+            if (usage.SoftLimit)
+            {
+                text += fmt::format(
+                    L", soft limit: {} (exceeded {} time(s))",
+                    Traits::ByteQuantity(usage.SoftLimit),
+                    usage.OverSoftLimit);
+            }
+
+            PrintValue(node, std::wstring(MemoryAccounting::ToString(static_cast<MemoryAccounting::Tag>(i))), text);
+        }
+    }
 }
 
 UtilitiesMain::UtilitiesMain()
@@ -181,6 +236,10 @@ void UtilitiesMain::Configure(int argc, const wchar_t* argv[])
     std::wstring computerName;
     std::wstring fullComputerName;
     std::wstring systemType;
+    std::wstring memoryLimits;
+    std::wstring simdLevel;
+    std::wstring readProfile;
+    std::wstring ioTrace;
 
     for (int i = 0; i < argc; i++)
     {
@@ -195,6 +254,14 @@ void UtilitiesMain::Configure(int argc, const wchar_t* argv[])
                     ;
                 else if (ParameterOption(argv[i] + 1, L"SystemType", systemType))
                     ;
+                else if (ParameterOption(argv[i] + 1, L"memory_limits", memoryLimits))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"simd", simdLevel))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"read_profile", readProfile))
+                    ;
+                else if (ParameterOption(argv[i] + 1, L"io_trace", ioTrace))
+                    ;
                 break;
             default:
                 break;
@@ -225,6 +292,52 @@ void UtilitiesMain::Configure(int argc, const wchar_t* argv[])
     {
         SystemDetails::SetSystemType(systemType);
     }
+
+    if (!memoryLimits.empty())
+    {
+        if (auto hr = MemoryAccounting::ConfigureSoftLimits(memoryLimits); FAILED(hr))
+        {
+            Log::Warn(L"Failed to configure memory soft limits '{}' [{}]", memoryLimits, SystemError(hr));
+        }
+    }
+
+    if (!simdLevel.empty())
+    {
+        const auto level = SimdDispatch::FromString(simdLevel);
+        if (!level)
+        {
+            Log::Warn(L"Invalid vectorization level '{}'", simdLevel);
+        }
+        else if (auto hr = SimdDispatch::Configure(*level); FAILED(hr))
+        {
+            Log::Warn(L"Failed to limit vectorized kernels to '{}' [{}]", simdLevel, SystemError(hr));
+        }
+    }
+
+    if (!readProfile.empty())
+    {
+        const auto profile = VolumeReadProfile::FromString(readProfile);
+        if (!profile)
+        {
+            Log::Warn(L"Invalid volume read profile '{}'", readProfile);
+        }
+        else if (auto hr = VolumeReadProfile::Instance().Configure(*profile); FAILED(hr))
+        {
+            Log::Warn(L"Failed to configure volume read profile '{}' [{}]", readProfile, SystemError(hr));
+        }
+    }
+
+    if (!ioTrace.empty())
+    {
+        if (auto hr = IoTrace::ConfigureDirectory(ioTrace); FAILED(hr))
+        {
+            Log::Warn(L"Failed to configure I/O trace directory '{}' [{}]", ioTrace, SystemError(hr));
+        }
+        else
+        {
+            IoTrace::Instance();
+        }
+    }
 }
 
 bool UtilitiesMain::IsProcessParent(LPCWSTR szImageName)
@@ -288,6 +401,33 @@ bool UtilitiesMain::IsProcessParent(LPCWSTR szImageName)
     return true;
 }
 
+void UtilitiesMain::StartupTimer::Step(std::wstring_view step)
+{
+    const auto now = clock::now();
+    m_steps.emplace_back(step, now - m_last);
+    m_last = now;
+}
+
+void UtilitiesMain::StartupTimer::Concurrent(std::wstring_view step, clock::duration duration)
+{
+    m_steps.emplace_back(fmt::format(L"{} (concurrent)", step), duration);
+}
+
+void UtilitiesMain::StartupTimer::LogSteps() const
+{
+    using namespace std::chrono;
+
+    std::wstring steps;
+    for (const auto& [step, duration] : m_steps)
+    {
+        if (!steps.empty())
+            steps.append(L", ");
+        fmt::format_to(std::back_inserter(steps), L"{}: {}us", step, duration_cast<microseconds>(duration).count());
+    }
+
+    Log::Debug(L"Startup took {}us ({})", duration_cast<microseconds>(m_last - m_start).count(), steps);
+}
+
 HRESULT Orc::Command::UtilitiesMain::LoadCommonExtensions()
 {
     auto ntdll = ExtensionLibrary::GetLibrary<NtDllExtension>();
@@ -1039,7 +1179,8 @@ bool UtilitiesMain::IgnoreConfigOptions(LPCWSTR szArg)
 
 bool UtilitiesMain::IgnoreEarlyOptions(LPCWSTR szArg)
 {
-    const std::vector<std::wstring_view> kIgnoredList = {L"computer", L"fullcomputer", L"systemtype"};
+    const std::vector<std::wstring_view> kIgnoredList = {
+        L"computer", L"fullcomputer", L"systemtype", L"memory_limits", L"simd", L"read_profile", L"io_trace"};
 
     std::wstring arg(szArg);
 
@@ -23,6 +23,8 @@
 #include "ToolVersion.h"
 #include "SystemDetails.h"
 #include "TableOutputWriter.h"
+#include "TableOutputShards.h"
+#include "TemporaryStream.h"
 #include "ExtensionLibrary.h"
 #include "Console.h"
 #include "ResurrectRecordsMode.h"
@@ -43,12 +45,18 @@
 #include "Text/Guid.h"
 #include "Limit.h"
 #include "VolumeReader.h"
+#include "BufferPool.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
+#include "IoTrace.h"
+#include "SimdDispatch.h"
 
 #include "Utils/EnumFlags.h"
 
 #include <conio.h>
 #include <iostream>
 #include <chrono>
+#include <future>
 #include <filesystem>
 
 #include <concrt.h>
@@ -84,6 +92,32 @@ public:
         UtilitiesLoggerConfiguration log;
     };
 
+    // Duration of each startup step, logged at debug level to follow the startup cost of the tools across releases
+    class StartupTimer
+    {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        StartupTimer()
+            : m_start(clock::now())
+            , m_last(m_start)
+        {
+        }
+
+        // Step which ended now, it started with the previous one
+        void Step(std::wstring_view step);
+
+        // Step which ran on another thread along the others
+        void Concurrent(std::wstring_view step, clock::duration duration);
+
+        void LogSteps() const;
+
+    private:
+        clock::time_point m_start;
+        clock::time_point m_last;
+        std::vector<std::pair<std::wstring, clock::duration>> m_steps;
+    };
+
     class OutputInfo
     {
     public:
@@ -137,7 +171,7 @@ public:
     private:
         std::vector<OutputPair> m_outputs;
 
-        ArchiveMessage::UnboundedMessageBuffer m_messageBuf;
+        ArchiveMessage::BoundedMessageBuffer m_messageBuf {&ArchiveMessage::Weigh};
         std::unique_ptr<Concurrency::call<ArchiveNotification::Notification>> m_notificationBuf;
         std::shared_ptr<ArchiveAgent> m_pArchiveAgent;
 
@@ -264,8 +298,25 @@ public:
                 case OutputSpec::Kind::Parquet:
                 case OutputSpec::Kind::Parquet | OutputSpec::Kind::TableFile:
                 case OutputSpec::Kind::ORC:
-                case OutputSpec::Kind::ORC | OutputSpec::Kind::TableFile: {
-                    if (nullptr == (pWriter = ::Orc::TableOutput::GetWriter(output)))
+                case OutputSpec::Kind::ORC | OutputSpec::Kind::TableFile:
+                case OutputSpec::Kind::Columnar:
+                case OutputSpec::Kind::Columnar | OutputSpec::Kind::TableFile:
+                case OutputSpec::Kind::JSONL:
+                case OutputSpec::Kind::JSONL | OutputSpec::Kind::TableFile: {
+                    if (output.IsSharded())
+                    {
+                        const std::filesystem::path path(output.Path);
+                        pWriter = GetShardedWriter(
+                            output,
+                            std::filesystem::path(path).replace_extension().wstring(),
+                            path.extension().wstring());
+                    }
+                    else
+                    {
+                        pWriter = ::Orc::TableOutput::GetWriter(output);
+                    }
+
+                    if (pWriter == nullptr)
                     {
                         Log::Error("Failed to create ouput writer");
                         return E_FAIL;
@@ -282,9 +333,25 @@ public:
                         std::shared_ptr<::Orc::TableOutput::IWriter> pW;
 
                         WCHAR szOutputFile[ORC_MAX_PATH];
-                        StringCchPrintf(
-                            szOutputFile, ORC_MAX_PATH, L"%s_%s.csv", szPrefix, out.first.GetIdentifier().c_str());
-                        if (nullptr == (pW = ::Orc::TableOutput::GetWriter(szOutputFile, output)))
+                        if (output.IsSharded())
+                        {
+                            StringCchPrintf(
+                                szOutputFile, ORC_MAX_PATH, L"%s_%s", szPrefix, out.first.GetIdentifier().c_str());
+                            pW = GetShardedWriter(output, szOutputFile, output.TableExtension());
+                        }
+                        else
+                        {
+                            StringCchPrintf(
+                                szOutputFile,
+                                ORC_MAX_PATH,
+                                L"%s_%s%s",
+                                szPrefix,
+                                out.first.GetIdentifier().c_str(),
+                                output.TableExtension());
+                            pW = ::Orc::TableOutput::GetWriter(szOutputFile, output);
+                        }
+
+                        if (pW == nullptr)
                         {
                             Log::Error("Failed to create output file information");
                             return E_FAIL;
@@ -302,13 +369,34 @@ public:
                         std::shared_ptr<::Orc::TableOutput::IWriter> pW;
 
                         WCHAR szOutputFile[ORC_MAX_PATH];
+                        if (output.IsSharded())
+                        {
+                            StringCchPrintf(
+                                szOutputFile,
+                                ORC_MAX_PATH,
+                                L"%s_%.8d_%s",
+                                szPrefix,
+                                idx++,
+                                out.first.GetIdentifier().c_str());
+                            if (nullptr == (pW = GetShardedWriter(output, szOutputFile, output.TableExtension())))
+                            {
+                                Log::Error("Failed to create output file information file");
+                                return E_FAIL;
+                            }
+
+                            // Parts are added to the archive as they are closed
+                            out.second = {pW, szOutputFile, dataType};
+                            continue;
+                        }
+
                         StringCchPrintf(
                             szOutputFile,
                             ORC_MAX_PATH,
-                            L"%s_%.8d_%s_.csv",
+                            L"%s_%.8d_%s_%s",
                             szPrefix,
                             idx++,
-                            out.first.GetIdentifier().c_str());
+                            out.first.GetIdentifier().c_str(),
+                            output.TableExtension());
                         if (nullptr == (pW = ::Orc::TableOutput::GetWriter(szOutputFile, output)))
                         {
                             Log::Error("Failed to create output file information file");
@@ -419,6 +507,91 @@ public:
             return S_OK;
         }
 
+        // Sharded table output: parts are named 'stem_part000001.ext', the closed parts of an archive output are
+        // handed to the archive agent right away to be compressed while the next ones are written
+        std::shared_ptr<TableOutput::IWriter>
+        GetShardedWriter(const OutputSpec& output, const std::wstring& strStem, const std::wstring& strExtension)
+        {
+            using namespace TableOutput;
+
+            ShardedWriter::PartFactory factory;
+            ShardedWriter::PartClosed onClosed;
+
+            switch (output.Type)
+            {
+                case OutputSpec::Kind::Directory:
+                    factory = [output, strStem, strExtension](DWORD dwPart) {
+                        const auto strPart = ShardedWriter::PartName(strStem, strExtension, dwPart);
+                        return TableOutput::GetWriter(strPart.c_str(), output);
+                    };
+                    break;
+                case OutputSpec::Kind::Archive:
+                    factory = [output, strStem, strExtension](DWORD dwPart) {
+                        return GetArchivePartWriter(output, ShardedWriter::PartName(strStem, strExtension, dwPart));
+                    };
+                    onClosed = [this, strStem, strExtension](DWORD dwPart, const std::shared_ptr<IWriter>& part) {
+                        auto pStreamWriter = std::dynamic_pointer_cast<IStreamWriter>(part);
+                        if (pStreamWriter == nullptr || pStreamWriter->GetStream() == nullptr)
+                            return;
+
+                        const auto strPart = ShardedWriter::PartName(strStem, strExtension, dwPart);
+                        auto stream = pStreamWriter->GetStream();
+                        if (auto hr = stream->SetFilePointer(0LL, FILE_BEGIN, nullptr); FAILED(hr))
+                        {
+                            Log::Error(L"Failed to rewind output part '{}' [{}]", strPart, SystemError(hr));
+                            return;
+                        }
+
+                        Concurrency::send(m_messageBuf, ArchiveMessage::MakeAddStreamRequest(strPart, stream, true));
+                        Concurrency::send(m_messageBuf, ArchiveMessage::MakeFlushQueueRequest());
+                    };
+                    break;
+                default:
+                    factory = [output, strStem, strExtension](DWORD dwPart) {
+                        auto partOutput = output;
+                        partOutput.Path = ShardedWriter::PartName(strStem, strExtension, dwPart);
+                        return TableOutput::GetWriter(partOutput);
+                    };
+                    break;
+            }
+
+            return ShardedWriter::MakeNew(std::move(factory), std::move(onClosed), output.ShardRows, output.ShardSize);
+        }
+
+        // Part of an archive output, kept in a temporary stream until it is closed
+        static std::shared_ptr<TableOutput::IWriter>
+        GetArchivePartWriter(const OutputSpec& output, const std::wstring& strPart)
+        {
+            auto stream = std::make_shared<TemporaryStream>();
+
+            const auto tempDir = std::filesystem::path(output.Path).parent_path();
+            if (auto hr = stream->Open(tempDir.wstring(), strPart, 5 * 1024 * 1024); FAILED(hr))
+            {
+                Log::Error(L"Failed to create temporary stream for output part '{}' [{}]", strPart, SystemError(hr));
+                return nullptr;
+            }
+
+            auto writer = TableOutput::GetStreamWriter(output);
+            if (writer == nullptr)
+                return nullptr;
+
+            // The stream outlives the writer: it is read by the archive agent once the part is closed
+            const bool kDontCloseStream = false;
+            if (auto hr = writer->WriteToStream(stream, kDontCloseStream); FAILED(hr))
+            {
+                Log::Error(L"Failed to write output part '{}' [{}]", strPart, SystemError(hr));
+                return nullptr;
+            }
+
+            if (auto hr = writer->SetSchema(output.Schema); FAILED(hr))
+            {
+                Log::Error(L"Failed to set schema of output part '{}' [{}]", strPart, SystemError(hr));
+                return nullptr;
+            }
+
+            return writer;
+        }
+
         HRESULT CloseOne(const OutputSpec& output, OutputPair& item) const
         {
             switch (output.Type)
@@ -447,6 +620,10 @@ public:
                 case OutputSpec::Kind::TableFile | OutputSpec::Kind::Parquet:
                 case OutputSpec::Kind::ORC:
                 case OutputSpec::Kind::TableFile | OutputSpec::Kind::ORC:
+                case OutputSpec::Kind::Columnar:
+                case OutputSpec::Kind::TableFile | OutputSpec::Kind::Columnar:
+                case OutputSpec::Kind::JSONL:
+                case OutputSpec::Kind::TableFile | OutputSpec::Kind::JSONL:
                     if (!m_outputs.empty() && m_outputs.front().second.Writer() != nullptr)
                     {
                         m_outputs.front().second.Writer()->Close();
@@ -464,6 +641,7 @@ public:
                 {
                     concurrency::agent::wait(
                         m_pArchiveAgent.get(), 120000);  // Wait 2 minutes for archive agent to complete
+                    m_messageBuf.GetStatistics().LogStatistics(L"Archive");
                 }
                 catch (concurrency::operation_timed_out&)
                 {
@@ -809,19 +987,34 @@ public:
     template <class UtilityT>
     static int WMain(int argc, const WCHAR* argv[])
     {
+        StartupTimer startup;
+
         Robustness::Initialize(UtilityT::ToolName());
         Robustness::AddTerminationHandler(std::make_shared<LogTerminationHandler>());
 
         UtilityT Cmd;
         Cmd.Configure(argc, argv);
+        startup.Step(L"logging");
 
         HRESULT hr = E_FAIL;
 
-        WSADATA wsa_data;
-        if (WSAStartup(MAKEWORD(2, 2), &wsa_data))
-        {
-            Log::Error(L"Failed to initialize WinSock 2.2 [{}]", Win32Error(WSAGetLastError()));
-        }
+        Cmd.WaitForDebugger(argc, argv);
+        startup.Step(L"debugger");
+
+        // WinSock and the common extensions do not depend on COM: they are initialized along COM and the header. The
+        // future is declared after 'Cmd' so that an early return waits for it before 'Cmd' is destroyed.
+        auto extensions = std::async(std::launch::async, [&Cmd]() {
+            const auto start = StartupTimer::clock::now();
+
+            WSADATA wsa_data;
+            if (WSAStartup(MAKEWORD(2, 2), &wsa_data))
+            {
+                Log::Error(L"Failed to initialize WinSock 2.2 [{}]", Win32Error(WSAGetLastError()));
+            }
+
+            Cmd.LoadCommonExtensions();
+            return StartupTimer::clock::now() - start;
+        });
 
         if (FAILED(hr = CoInitializeEx(0, COINIT_MULTITHREADED)))
         {
@@ -844,13 +1037,14 @@ public:
         {
             Log::Warn("Failed to initialize COM security");
         }
+        startup.Step(L"COM");
 
-        Cmd.WaitForDebugger(argc, argv);
-
-        // TODO: FIXME
-
-        Cmd.LoadCommonExtensions();
         Cmd.PrintHeader(UtilityT::ToolName(), UtilityT::ToolDescription(), kOrcFileVerStringW);
+        startup.Step(L"header");
+
+        // Configuration is read with XmlLite
+        startup.Concurrent(L"extensions", extensions.get());
+        startup.Step(L"extensions wait");
 
         try
         {
@@ -877,6 +1071,7 @@ public:
                     Log::Critical(L"Failed to process configuration schema [{}]", SystemError(hr));
                     return hr;
                 }
+                startup.Step(L"schema");
             }
 
             if (UtilityT::DefaultConfiguration() != nullptr || UtilityT::ConfigurationExtension() != nullptr)
@@ -902,6 +1097,7 @@ public:
                     Log::Critical(L"Failed to parse xml configuration [{}]", SystemError(hr));
                     return hr;
                 }
+                startup.Step(L"configuration");
             }
 
             if (UtilityT::LocalConfiguration() != nullptr || UtilityT::LocalConfigurationExtension() != nullptr)
@@ -923,6 +1119,7 @@ public:
                     Log::Critical(L"Failed to parse local xml configuration [{}]", SystemError(hr));
                     return hr;
                 }
+                startup.Step(L"local configuration");
             }
 
             if (FAILED(hr = Cmd.GetConfigurationFromArgcArgv(argc, argv)))
@@ -936,6 +1133,7 @@ public:
                 Log::Critical(L"Failed while checking configuration [{}]", SystemError(hr));
                 return hr;
             }
+            startup.Step(L"command line");
         }
         catch (std::exception& e)
         {
@@ -960,6 +1158,8 @@ public:
 
         // Parameters are displayed when the configuration is complete and checked
         Cmd.PrintParameters();
+        startup.Step(L"parameters");
+        startup.LogSteps();
 
         try
         {
@@ -994,6 +1194,25 @@ public:
         Cmd.theFinishTickCount = GetTickCount();
         Cmd.PrintFooter();
 
+        BufferPool::Instance().LogStatistics();
+        MemoryAccounting::LogStatistics();
+        SimdDispatch::LogSelections();
+
+        if (auto hr = Telemetry::Save(); FAILED(hr))
+        {
+            Log::Warn(L"Failed to save command statistics [{}]", SystemError(hr));
+        }
+
+        if (auto hr = MemoryAccounting::Save(); FAILED(hr))
+        {
+            Log::Warn(L"Failed to save command memory statistics [{}]", SystemError(hr));
+        }
+
+        if (auto hr = IoTrace::Instance().Close(); FAILED(hr))
+        {
+            Log::Warn(L"Failed to complete I/O trace [{}]", SystemError(hr));
+        }
+
         if (WSACleanup())
         {
             Log::Error(L"Failed to cleanup WinSock 2.2 [{}]", Win32Error(WSAGetLastError()));
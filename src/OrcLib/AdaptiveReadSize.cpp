@@ -0,0 +1,109 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "AdaptiveReadSize.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+AdaptiveReadSize::AdaptiveReadSize(
+    ULONG ulUnit,
+    ULONG ulInitialSize,
+    ULONG ulMinSize,
+    ULONG ulMaxSize,
+    std::chrono::microseconds maxLatency)
+    : m_ulUnit(std::max(ulUnit, 1UL))
+    , m_MaxLatency(maxLatency)
+{
+    if (ulMaxSize == 0L)
+        ulMaxSize = kDefaultMaxSize;
+
+    // Bounds are multiples of the unit, the unit being the smallest read possible
+    m_ulMinSize = static_cast<ULONG>(std::max<ULONGLONG>(
+        m_ulUnit, (static_cast<ULONGLONG>(ulMinSize) + m_ulUnit - 1) / m_ulUnit * m_ulUnit));
+    m_ulMaxSize = std::max(m_ulMinSize, ulMaxSize / m_ulUnit * m_ulUnit);
+    m_ulSize = Align(ulInitialSize);
+}
+
+ULONG AdaptiveReadSize::Align(ULONGLONG ullSize) const
+{
+    ullSize = ullSize / m_ulUnit * m_ulUnit;
+    return static_cast<ULONG>(std::clamp<ULONGLONG>(ullSize, m_ulMinSize, m_ulMaxSize));
+}
+
+void AdaptiveReadSize::Resize(ULONGLONG ullSize)
+{
+    const auto ulSize = Align(ullSize);
+    if (ulSize > m_ulSize)
+        m_ulIncreases++;
+    else if (ulSize < m_ulSize)
+        m_ulDecreases++;
+
+    m_ulSize = ulSize;
+}
+
+void AdaptiveReadSize::Record(ULONGLONG ullBytes, std::chrono::microseconds duration)
+{
+    m_ulReads++;
+    m_ullBytes += ullBytes;
+    m_Duration += std::max(duration, std::chrono::microseconds(1));
+
+    if (m_ulReads < kReadsPerWindow)
+        return;
+
+    const auto latency = m_Duration / m_ulReads;
+    const double dThroughput = static_cast<double>(m_ullBytes) / m_Duration.count();
+
+    m_ulReads = 0L;
+    m_ullBytes = 0LL;
+    m_Duration = std::chrono::microseconds::zero();
+
+    if (latency > m_MaxLatency)
+    {
+        Resize(m_ulSize / 2);
+        m_dThroughput = 0.0;
+        m_bIncreasing = false;
+        m_ulStableWindows = 0L;
+        return;
+    }
+
+    if (!m_bIncreasing)
+    {
+        // Conditions change (other I/O on the device, cache of a virtual disk...): larger sizes are tried again
+        if (++m_ulStableWindows >= kWindowsBeforeProbe && m_ulSize < m_ulMaxSize)
+        {
+            m_bIncreasing = true;
+            m_ulStableWindows = 0L;
+        }
+        return;
+    }
+
+    if (m_dThroughput > 0.0 && dThroughput < m_dThroughput * kMinGain)
+    {
+        // The last increase did not pay: the previous size is kept if it was faster
+        if (dThroughput < m_dThroughput)
+            Resize(m_ulPreviousSize);
+
+        m_dThroughput = 0.0;
+        m_bIncreasing = false;
+        return;
+    }
+
+    if (m_ulSize >= m_ulMaxSize)
+    {
+        m_dThroughput = 0.0;
+        m_bIncreasing = false;
+        return;
+    }
+
+    m_dThroughput = dThroughput;
+    m_ulPreviousSize = m_ulSize;
+    Resize(static_cast<ULONGLONG>(m_ulSize) * 2);
+}
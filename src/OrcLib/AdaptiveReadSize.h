@@ -0,0 +1,79 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <chrono>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Size of the reads of a sequential scan, tuned from the throughput and the latency measured on the reads done so far.
+// Reads are timed by windows of a few reads: the size doubles as long as it improves the throughput, it is halved when
+// reads take longer than the latency limit on average or when the last increase made them slower. Larger sizes are
+// probed again after a while. Sizes are multiples of the unit (sector, record and page sizes being powers of two, the
+// largest of them) within [min, max].
+class AdaptiveReadSize
+{
+public:
+    static constexpr ULONG kDefaultMinSize = 16 * 1024L;
+    static constexpr ULONG kDefaultMaxSize = 4 * 1024 * 1024L;
+    static constexpr std::chrono::microseconds kDefaultMaxLatency = std::chrono::milliseconds(50);
+
+    // A max size of 0 is the default max size, 'ulInitialSize' is brought within the bounds
+    AdaptiveReadSize(
+        ULONG ulUnit,
+        ULONG ulInitialSize,
+        ULONG ulMinSize = kDefaultMinSize,
+        ULONG ulMaxSize = kDefaultMaxSize,
+        std::chrono::microseconds maxLatency = kDefaultMaxLatency);
+
+    ULONG Size() const { return m_ulSize; }
+    ULONG MinSize() const { return m_ulMinSize; }
+    ULONG MaxSize() const { return m_ulMaxSize; }
+
+    // Account for a read of 'ullBytes' which took 'duration', the size may change after it
+    void Record(ULONGLONG ullBytes, std::chrono::microseconds duration);
+
+    ULONG Increases() const { return m_ulIncreases; }
+    ULONG Decreases() const { return m_ulDecreases; }
+
+private:
+    static constexpr ULONG kReadsPerWindow = 4L;
+    static constexpr ULONG kWindowsBeforeProbe = 32L;
+    static constexpr double kMinGain = 1.1;
+
+    ULONG Align(ULONGLONG ullSize) const;
+    void Resize(ULONGLONG ullSize);
+
+    ULONG m_ulUnit;
+    ULONG m_ulMinSize;
+    ULONG m_ulMaxSize;
+    ULONG m_ulSize;
+    std::chrono::microseconds m_MaxLatency;
+
+    // Current window
+    ULONG m_ulReads = 0L;
+    ULONGLONG m_ullBytes = 0LL;
+    std::chrono::microseconds m_Duration = std::chrono::microseconds::zero();
+
+    // Bytes per microsecond of the window before the last increase, 0 if the size did not just increase
+    double m_dThroughput = 0.0;
+    ULONG m_ulPreviousSize = 0L;
+    bool m_bIncreasing = true;
+    ULONG m_ulStableWindows = 0L;
+
+    ULONG m_ulIncreases = 0L;
+    ULONG m_ulDecreases = 0L;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,203 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "AesExtensionsCipher.h"
+
+#include "CpuId.h"
+#include "SimdDispatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_AES_EXTENSIONS
+#endif
+
+using namespace Orc;
+
+namespace {
+
+#ifdef ORC_AES_EXTENSIONS
+
+constexpr size_t kRoundKeys = 15;
+
+// Blocks decrypted at once: the latency of aesdec is hidden by the independent blocks
+constexpr size_t kLanes = 8;
+
+inline __m128i ExpandKeyStep(__m128i key, __m128i assist)
+{
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, assist);
+}
+
+// Round keys 'i' and 'i + 1' of AES-256 from the two previous ones ('Rcon' must be an immediate)
+template <int Rcon>
+inline void ExpandKeyPair(__m128i (&keys)[kRoundKeys], size_t i)
+{
+    keys[i] = ExpandKeyStep(keys[i - 2], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(keys[i - 1], Rcon), 0xFF));
+    if (i + 1 < kRoundKeys)
+        keys[i + 1] = ExpandKeyStep(keys[i - 1], _mm_shuffle_epi32(_mm_aeskeygenassist_si128(keys[i], 0x00), 0xAA));
+}
+
+inline void LoadKeys(__m128i (&keys)[kRoundKeys], const BYTE (*pKeys)[16])
+{
+    for (size_t i = 0; i < kRoundKeys; i++)
+        keys[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(pKeys[i]));
+}
+
+#endif  // ORC_AES_EXTENSIONS
+
+}  // namespace
+
+bool AesExtensionsCipher::IsSupported()
+{
+#ifdef ORC_AES_EXTENSIONS
+    static const bool bSupported = []() {
+        const bool bSupported = SimdDispatch::Supported() >= SimdDispatch::Level::SSE2 && CpuId().HasAES();
+        const auto level = bSupported ? SimdDispatch::Level::SSE2 : SimdDispatch::Level::Scalar;
+        SimdDispatch::Register(L"aes_extensions", level);
+        return bSupported;
+    }();
+    return bSupported;
+#else
+    return false;
+#endif
+}
+
+AesExtensionsCipher::AesExtensionsCipher(const std::array<BYTE, kKeySize>& key)
+    : m_EncryptKeys {0}
+    , m_DecryptKeys {0}
+{
+#ifdef ORC_AES_EXTENSIONS
+    __m128i keys[kRoundKeys];
+    keys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.data()));
+    keys[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key.data() + kBlockSize));
+
+    ExpandKeyPair<0x01>(keys, 2);
+    ExpandKeyPair<0x02>(keys, 4);
+    ExpandKeyPair<0x04>(keys, 6);
+    ExpandKeyPair<0x08>(keys, 8);
+    ExpandKeyPair<0x10>(keys, 10);
+    ExpandKeyPair<0x20>(keys, 12);
+    ExpandKeyPair<0x40>(keys, 14);
+
+    // Equivalent inverse cipher: decryption uses the round keys in reverse order, through InvMixColumns
+    for (size_t i = 0; i < kRoundKeys; i++)
+    {
+        _mm_store_si128(reinterpret_cast<__m128i*>(m_EncryptKeys[i]), keys[i]);
+
+        const auto& decrypt = keys[kRounds - i];
+        _mm_store_si128(
+            reinterpret_cast<__m128i*>(m_DecryptKeys[i]),
+            i == 0 || i == kRounds ? decrypt : _mm_aesimc_si128(decrypt));
+    }
+
+    SecureZeroMemory(keys, sizeof(keys));
+#else
+    DBG_UNREFERENCED_PARAMETER(key);
+#endif
+}
+
+AesExtensionsCipher::~AesExtensionsCipher()
+{
+    SecureZeroMemory(m_EncryptKeys, sizeof(m_EncryptKeys));
+    SecureZeroMemory(m_DecryptKeys, sizeof(m_DecryptKeys));
+}
+
+void AesExtensionsCipher::EncryptCbc(BYTE* pData, size_t cbData, BYTE (&iv)[kBlockSize]) const
+{
+    _ASSERT(cbData % kBlockSize == 0);
+
+#ifdef ORC_AES_EXTENSIONS
+    __m128i keys[kRoundKeys];
+    LoadKeys(keys, m_EncryptKeys);
+
+    auto chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+    for (size_t offset = 0; offset + kBlockSize <= cbData; offset += kBlockSize)
+    {
+        const auto pBlock = reinterpret_cast<__m128i*>(pData + offset);
+
+        auto block = _mm_xor_si128(_mm_xor_si128(_mm_loadu_si128(pBlock), chain), keys[0]);
+        for (size_t round = 1; round < kRounds; round++)
+            block = _mm_aesenc_si128(block, keys[round]);
+        block = _mm_aesenclast_si128(block, keys[kRounds]);
+
+        _mm_storeu_si128(pBlock, block);
+        chain = block;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), chain);
+#else
+    DBG_UNREFERENCED_PARAMETER(pData);
+    DBG_UNREFERENCED_PARAMETER(cbData);
+    DBG_UNREFERENCED_PARAMETER(iv);
+#endif
+}
+
+void AesExtensionsCipher::DecryptCbc(BYTE* pData, size_t cbData, BYTE (&iv)[kBlockSize]) const
+{
+    _ASSERT(cbData % kBlockSize == 0);
+
+#ifdef ORC_AES_EXTENSIONS
+    __m128i keys[kRoundKeys];
+    LoadKeys(keys, m_DecryptKeys);
+
+    auto chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+
+    size_t offset = 0;
+    for (; offset + kLanes * kBlockSize <= cbData; offset += kLanes * kBlockSize)
+    {
+        const auto pBlocks = reinterpret_cast<__m128i*>(pData + offset);
+
+        __m128i cipher[kLanes];
+        __m128i plain[kLanes];
+        for (size_t i = 0; i < kLanes; i++)
+        {
+            cipher[i] = _mm_loadu_si128(pBlocks + i);
+            plain[i] = _mm_xor_si128(cipher[i], keys[0]);
+        }
+
+        for (size_t round = 1; round < kRounds; round++)
+        {
+            for (size_t i = 0; i < kLanes; i++)
+                plain[i] = _mm_aesdec_si128(plain[i], keys[round]);
+        }
+
+        for (size_t i = 0; i < kLanes; i++)
+        {
+            plain[i] = _mm_aesdeclast_si128(plain[i], keys[kRounds]);
+            _mm_storeu_si128(pBlocks + i, _mm_xor_si128(plain[i], i == 0 ? chain : cipher[i - 1]));
+        }
+
+        chain = cipher[kLanes - 1];
+    }
+
+    for (; offset + kBlockSize <= cbData; offset += kBlockSize)
+    {
+        const auto pBlock = reinterpret_cast<__m128i*>(pData + offset);
+
+        const auto cipher = _mm_loadu_si128(pBlock);
+        auto block = _mm_xor_si128(cipher, keys[0]);
+        for (size_t round = 1; round < kRounds; round++)
+            block = _mm_aesdec_si128(block, keys[round]);
+        block = _mm_aesdeclast_si128(block, keys[kRounds]);
+
+        _mm_storeu_si128(pBlock, _mm_xor_si128(block, chain));
+        chain = cipher;
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(iv), chain);
+#else
+    DBG_UNREFERENCED_PARAMETER(pData);
+    DBG_UNREFERENCED_PARAMETER(cbData);
+    DBG_UNREFERENCED_PARAMETER(iv);
+#endif
+}
@@ -0,0 +1,50 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <cstdint>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// AES-256 in CBC mode computed with the AES instructions (AES-NI), without the CryptoAPI provider calls. Decryption
+// processes several blocks at once, encryption is serial as each block depends on the previous one. Only usable when
+// IsSupported() returns true (CPUID AES and SSE2 flags).
+class AesExtensionsCipher
+{
+public:
+    static constexpr size_t kBlockSize = 16;
+    static constexpr size_t kKeySize = 32;
+
+    static bool IsSupported();
+
+    explicit AesExtensionsCipher(const std::array<BYTE, kKeySize>& key);
+    ~AesExtensionsCipher();
+
+    AesExtensionsCipher(const AesExtensionsCipher&) = delete;
+    AesExtensionsCipher& operator=(const AesExtensionsCipher&) = delete;
+
+    // In place, 'cbData' is a multiple of kBlockSize: 'iv' is updated to chain with the next call
+    void EncryptCbc(BYTE* pData, size_t cbData, BYTE (&iv)[kBlockSize]) const;
+    void DecryptCbc(BYTE* pData, size_t cbData, BYTE (&iv)[kBlockSize]) const;
+
+private:
+    static constexpr size_t kRounds = 14;
+
+    alignas(16) BYTE m_EncryptKeys[kRounds + 1][kBlockSize];
+    alignas(16) BYTE m_DecryptKeys[kRounds + 1][kBlockSize];
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
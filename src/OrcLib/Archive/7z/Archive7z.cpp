@@ -19,6 +19,7 @@
 #include "Archive/7z/OutStreamAdapter.h"
 #include "Archive/7z/ArchiveOpenCallback.h"
 #include "Archive/7z/ArchiveUpdateCallback.h"
+#include "Archive/7z/Header7z.h"
 #include "ByteStream.h"
 
 using namespace Orc::Archive;
@@ -75,42 +76,15 @@ GUID ToGuid(Archive::Format format)
     }
 }
 
-enum class Lib7zCompressionLevel
-{
-    None = 0,
-    Fastest = 1,
-    Fast = 3,
-    Normal = 5,
-    Maximum = 7,
-    Ultra = 9
-};
-
-Lib7zCompressionLevel ToLib7zLevel(CompressionLevel level)
-{
-    switch (level)
-    {
-        case CompressionLevel::kNone:
-            return Lib7zCompressionLevel::None;
-        case CompressionLevel::kFastest:
-            return Lib7zCompressionLevel::Fastest;
-        case CompressionLevel::kFast:
-            return Lib7zCompressionLevel::Fast;
-        case CompressionLevel::kNormal:
-            return Lib7zCompressionLevel::Normal;
-        case CompressionLevel::kMaximum:
-            return Lib7zCompressionLevel::Maximum;
-        case CompressionLevel::kUltra:
-            return Lib7zCompressionLevel::Ultra;
-        case CompressionLevel::kDefault:
-            return Lib7zCompressionLevel::Normal;
-        default:
-            return Lib7zCompressionLevel::Normal;
-    }
-}
-
-void SetCompressionLevel(const CComPtr<IOutArchive>& archiver, CompressionLevel level, std::error_code& ec)
+void SetCompressionLevel(
+    const CComPtr<IOutArchive>& archiver,
+    Archive::Format format,
+    CompressionLevel level,
+    uint32_t threads,
+    bool compressHeaders,
+    std::error_code& ec)
 {
-    Log::Debug("Archive7z: SetCompressionLevel to {}", ToString(level));
+    Log::Debug("Archive7z: SetCompressionLevel to {} with {} threads", ToString(level), threads);
 
     CMyComPtr<ISetProperties> setProperties;
     HRESULT hr = archiver->QueryInterface(IID_ISetProperties, (void**)&setProperties);
@@ -121,9 +95,17 @@ void SetCompressionLevel(const CComPtr<IOutArchive>& archiver, CompressionLevel
         return;
     }
 
-    const uint8_t numProps = 1;
-    const wchar_t* names[numProps] = {L"x"};
-    NWindows::NCOM::CPropVariant values[numProps] = {static_cast<UINT32>(::ToLib7zLevel(level))};
+    // Zip compresses several items concurrently, 7z relies on LZMA2 which splits each solid block between threads
+    const uint8_t maxProps = 4;
+    const wchar_t* names[maxProps] = {L"x", L"mt", L"hc", L"0"};
+    NWindows::NCOM::CPropVariant values[maxProps] = {
+        static_cast<UINT32>(ToLib7zLevel(level)), static_cast<UINT32>(threads), compressHeaders, L"LZMA2"};
+
+    uint8_t numProps = 2;
+    if (format == Archive::Format::k7z)
+    {
+        numProps = level == CompressionLevel::kNone ? 3 : 4;
+    }
 
     hr = setProperties->SetProperties(names, values, numProps);
     if (FAILED(hr))
@@ -134,12 +116,137 @@ void SetCompressionLevel(const CComPtr<IOutArchive>& archiver, CompressionLevel
     }
 }
 
+HRESULT ReadAt(ByteStream& stream, uint64_t offset, uint8_t* buffer, size_t size)
+{
+    HRESULT hr = stream.SetFilePointer(offset, FILE_BEGIN, nullptr);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    while (size)
+    {
+        ULONGLONG read = 0;
+        hr = stream.Read(buffer, size, &read);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+
+        if (read == 0)
+        {
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+
+        buffer += read;
+        size -= static_cast<size_t>(read);
+    }
+
+    return S_OK;
+}
+
+// Read the header of the archive starting at 'offset' in 'stream'
+Header7z ReadHeader(ByteStream& stream, uint64_t offset, std::error_code& ec)
+{
+    std::array<uint8_t, Header7z::kSignatureHeaderSize> signature;
+    HRESULT hr = ::ReadAt(stream, offset, signature.data(), signature.size());
+    if (FAILED(hr))
+    {
+        ec.assign(hr, std::system_category());
+        Log::Error("Failed to read 7z signature header [{}]", ec);
+        return {};
+    }
+
+    const auto startHeader = Header7z::ParseSignatureHeader(signature.data(), signature.size(), ec);
+    if (ec)
+    {
+        Log::Error("Invalid 7z signature header [{}]", ec);
+        return {};
+    }
+
+    const auto headerOffset = offset + Header7z::kSignatureHeaderSize + startHeader.NextHeaderOffset;
+    if (headerOffset > stream.GetSize() || startHeader.NextHeaderSize > stream.GetSize() - headerOffset)
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        Log::Error("Invalid 7z header location [{}]", ec);
+        return {};
+    }
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(startHeader.NextHeaderSize));
+    hr = ::ReadAt(stream, headerOffset, buffer.data(), buffer.size());
+    if (FAILED(hr))
+    {
+        ec.assign(hr, std::system_category());
+        Log::Error("Failed to read 7z header [{}]", ec);
+        return {};
+    }
+
+    if (Crc32(buffer.data(), buffer.size()) != startHeader.NextHeaderCrc)
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        Log::Error("Invalid 7z header checksum [{}]", ec);
+        return {};
+    }
+
+    auto header = Header7z::Parse(buffer.data(), buffer.size(), ec);
+    if (ec)
+    {
+        Log::Error("Unsupported 7z header [{}]", ec);
+        return {};
+    }
+
+    return header;
+}
+
+// Write 'header' right after the packed streams and update the signature header accordingly
+void WriteHeader(ByteStream& stream, const Header7z& header, std::error_code& ec)
+{
+    const auto buffer = header.Serialize();
+
+    Header7z::StartHeader startHeader;
+    startHeader.NextHeaderOffset = header.PackEnd();
+    startHeader.NextHeaderSize = buffer.size();
+    startHeader.NextHeaderCrc = Crc32(buffer.data(), buffer.size());
+    auto signature = Header7z::MakeSignatureHeader(startHeader);
+
+    const auto headerOffset = Header7z::kSignatureHeaderSize + startHeader.NextHeaderOffset;
+    HRESULT hr = stream.SetFilePointer(headerOffset, FILE_BEGIN, nullptr);
+    if (SUCCEEDED(hr))
+    {
+        hr = stream.Write(const_cast<uint8_t*>(buffer.data()), buffer.size(), nullptr);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = stream.SetSize(headerOffset + buffer.size());
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = stream.SetFilePointer(0, FILE_BEGIN, nullptr);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = stream.Write(signature.data(), signature.size(), nullptr);
+    }
+
+    if (FAILED(hr))
+    {
+        ec.assign(hr, std::system_category());
+        Log::Error("Failed to write 7z header [{}]", ec);
+        return;
+    }
+}
+
 }  // namespace
 
 Archive7z::Archive7z(Format format, Archive::CompressionLevel level, std::wstring password)
     : m_format(format)
     , m_compressionLevel(level)
     , m_password(std::move(password))
+    , m_compressionThreads(kAutoCompressionThreads)
+    , m_appendable(false)
 {
 #ifdef _7ZIP_STATIC
     ::Lib7z::Instance();
@@ -160,6 +267,15 @@ void Archive7z::Compress(
     const std::shared_ptr<ByteStream>& outputArchive,
     const std::shared_ptr<ByteStream>& inputArchive,
     std::error_code& ec)
+{
+    Compress(outputArchive, 0, inputArchive, ec);
+}
+
+void Archive7z::Compress(
+    const std::shared_ptr<ByteStream>& outputArchive,
+    uint64_t outputOffset,
+    const std::shared_ptr<ByteStream>& inputArchive,
+    std::error_code& ec)
 {
     if (m_items.empty() && inputArchive == nullptr)
     {
@@ -177,7 +293,8 @@ void Archive7z::Compress(
         return;
     }
 
-    ::SetCompressionLevel(archiver, m_compressionLevel, ec);
+    ::SetCompressionLevel(
+        archiver, m_format, m_compressionLevel, ToCompressionThreads(m_compressionThreads), !m_appendable, ec);
     if (ec)
     {
         Log::Error(
@@ -233,7 +350,8 @@ void Archive7z::Compress(
 
     m_items.clear();
 
-    CComQIPtr<ISequentialOutStream, &IID_ISequentialOutStream> outStream(new OutStreamAdapter(outputArchive));
+    CComQIPtr<ISequentialOutStream, &IID_ISequentialOutStream> outStream(
+        new OutStreamAdapter(outputArchive, outputOffset));
     hr = archiver->UpdateItems(outStream, numberOfNewItems + numberOfArchivedItems, archiveUpdateCallback);
     if (FAILED(hr))
     {
@@ -256,7 +374,125 @@ void Archive7z::SetCompressionLevel(Archive::CompressionLevel level, std::error_
     m_compressionLevel = level;
 }
 
+void Archive7z::SetCompressionThreads(uint32_t threads)
+{
+    m_compressionThreads = threads;
+}
+
 const IArchive::Items& Archive7z::AddedItems() const
 {
     return m_items;
 };
+
+bool Archive7z::EnableAppend()
+{
+    if (m_format != Format::k7z)
+    {
+        return false;
+    }
+
+    m_appendable = true;
+    return true;
+}
+
+void Archive7z::Append(const std::shared_ptr<ByteStream>& archive, std::error_code& ec)
+{
+    if (!m_appendable)
+    {
+        ec = std::make_error_code(std::errc::operation_not_supported);
+        return;
+    }
+
+    if (m_items.empty())
+    {
+        return;
+    }
+
+    // Check the existing archive before compressing anything as pending items cannot be restored afterwards
+    auto header = ::ReadHeader(*archive, 0, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    // The new items are compressed as a standalone archive whose packed streams start where the existing ones end: its
+    // signature header overwrites the last bytes of the existing packed streams which are restored afterwards and its
+    // header overwrites the existing one which is kept in memory.
+    const auto additionOffset = header.PackEnd();
+
+    std::array<uint8_t, Header7z::kSignatureHeaderSize> overlap;
+    HRESULT hr = ::ReadAt(*archive, additionOffset, overlap.data(), overlap.size());
+    if (FAILED(hr))
+    {
+        ec.assign(hr, std::system_category());
+        Log::Error("Failed to read archive packed streams [{}]", ec);
+        return;
+    }
+
+    const auto restoreOverlap = [&](std::error_code& ec) {
+        HRESULT hr = archive->SetFilePointer(additionOffset, FILE_BEGIN, nullptr);
+        if (SUCCEEDED(hr))
+        {
+            hr = archive->Write(overlap.data(), overlap.size(), nullptr);
+        }
+
+        if (FAILED(hr))
+        {
+            ec.assign(hr, std::system_category());
+            Log::Error("Failed to restore archive packed streams [{}]", ec);
+        }
+    };
+
+    // A failed append must not lose the items written by the previous flushes
+    const auto rollback = [&]() {
+        std::error_code rollbackEc;
+        restoreOverlap(rollbackEc);
+        if (!rollbackEc)
+        {
+            ::WriteHeader(*archive, header, rollbackEc);
+        }
+
+        if (rollbackEc)
+        {
+            Log::Critical("Failed to restore archive after append failure [{}]", rollbackEc);
+        }
+    };
+
+    Compress(archive, additionOffset, {}, ec);
+    if (ec)
+    {
+        Log::Error("Failed to compress new items [{}]", ec);
+        rollback();
+        return;
+    }
+
+    auto addition = ::ReadHeader(*archive, additionOffset, ec);
+    if (!ec && addition.PackPos() != 0)
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        Log::Error("Unexpected location of new items packed streams [{}]", ec);
+    }
+
+    if (!ec)
+    {
+        restoreOverlap(ec);
+    }
+
+    if (ec)
+    {
+        rollback();
+        return;
+    }
+
+    const auto appendedSize = addition.PackSize();
+
+    header.Append(std::move(addition));
+    ::WriteHeader(*archive, header, ec);
+    if (ec)
+    {
+        Log::Error("Failed to write appended archive header [{}]", ec);
+        return;
+    }
+
+    Log::Debug("Archive7z: appended {} bytes of packed streams", appendedSize);
+}
@@ -35,14 +35,32 @@ public:
     // List of added items waiting to be processed by the Compress method
     const Items& AddedItems() const override;
 
+    // Only 7z format: headers are then written uncompressed so that they can be merged with 'Header7z'
+    bool EnableAppend() override;
+
+    void Append(const std::shared_ptr<ByteStream>& archive, std::error_code& ec) override;
+
     Archive::CompressionLevel CompressionLevel() const { return m_compressionLevel; }
 
     void SetCompressionLevel(Archive::CompressionLevel level, std::error_code& ec);
 
+    // Upper bound for the coder threads, the job object restrictions still apply
+    uint32_t CompressionThreads() const { return m_compressionThreads; }
+    void SetCompressionThreads(uint32_t threads);
+
 private:
+    // Write the archive at 'outputOffset' in 'outputArchive' as if it was the begining of the stream
+    void Compress(
+        const std::shared_ptr<ByteStream>& outputArchive,
+        uint64_t outputOffset,
+        const std::shared_ptr<ByteStream>& inputArchive,
+        std::error_code& ec);
+
     const Format m_format;
     Archive::CompressionLevel m_compressionLevel;
+    uint32_t m_compressionThreads;
     const std::wstring m_password;
+    bool m_appendable;
     Items m_items;
 };
 
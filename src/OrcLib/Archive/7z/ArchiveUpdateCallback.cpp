@@ -219,6 +219,9 @@ STDMETHODIMP ArchiveUpdateCallback::GetStream(UInt32 index, ISequentialInStream*
         return E_POINTER;
     }
 
+    Trace::ArchiveItemStop(m_itemActivity, S_OK);
+    m_itemActivity = Trace::ArchiveItemStart(GetItem(index)->NameInArchive(), GetItem(index)->Size());
+
     auto item = GetItem(index)->Stream();
     if (item->GetSize() == 0)
     {
@@ -251,6 +254,10 @@ STDMETHODIMP ArchiveUpdateCallback::SetOperationResult(Int32 operationResult)
         m_ec.assign(E_FAIL, std::system_category());
     }
 
+    Trace::ArchiveItemStop(
+        m_itemActivity, operationResult == NArchive::NUpdate::NOperationResult::kOK ? S_OK : E_FAIL);
+    m_itemActivity = {};
+
     return S_OK;
 }
 
@@ -14,6 +14,7 @@
 #include <7zip/extras.h>
 
 #include "Archive/Item.h"
+#include "Trace.h"
 
 namespace Orc {
 
@@ -59,6 +60,9 @@ private:
     const std::wstring m_password;
     const uint64_t m_numberOfInputArchiveItems;
     std::error_code m_ec;
+
+    // 7z compresses the items one after the other: the span of an item runs from its GetStream to the next result
+    Trace::Activity m_itemActivity;
 };
 
 }  // namespace Archive
@@ -0,0 +1,1008 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2020 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "Archive/7z/Header7z.h"
+
+#include <algorithm>
+#include <numeric>
+
+using namespace Orc::Archive;
+using namespace Orc;
+
+namespace {
+
+// Property identifiers from 7-Zip's 'DOC/7zFormat.txt'
+enum PropertyId : uint8_t
+{
+    kEnd = 0x00,
+    kHeader = 0x01,
+    kArchiveProperties = 0x02,
+    kAdditionalStreamsInfo = 0x03,
+    kMainStreamsInfo = 0x04,
+    kFilesInfo = 0x05,
+    kPackInfo = 0x06,
+    kUnPackInfo = 0x07,
+    kSubStreamsInfo = 0x08,
+    kSize = 0x09,
+    kCRC = 0x0A,
+    kFolder = 0x0B,
+    kCodersUnPackSize = 0x0C,
+    kNumUnPackStream = 0x0D,
+    kEmptyStream = 0x0E,
+    kEmptyFile = 0x0F,
+    kAnti = 0x10,
+    kName = 0x11,
+    kCTime = 0x12,
+    kATime = 0x13,
+    kMTime = 0x14,
+    kWinAttributes = 0x15,
+    kComment = 0x16,
+    kEncodedHeader = 0x17,
+    kStartPos = 0x18,
+    kDummy = 0x19
+};
+
+constexpr std::array<uint8_t, 6> kSignature = {'7', 'z', 0xBC, 0xAF, 0x27, 0x1C};
+
+// Upper bound to reject corrupted counts before allocating anything
+constexpr uint64_t kMaxCount = 1 << 24;
+
+// Parsing errors are only reported to the caller with an error_code
+struct FormatError
+{
+};
+
+const std::array<uint32_t, 256> kCrcTable = []() {
+    std::array<uint32_t, 256> table = {};
+    for (uint32_t i = 0; i < table.size(); ++i)
+    {
+        uint32_t value = i;
+        for (int j = 0; j < 8; ++j)
+        {
+            value = (value >> 1) ^ (0xEDB88320 & (0 - (value & 1)));
+        }
+        table[i] = value;
+    }
+    return table;
+}();
+
+uint32_t ReadLE32(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint64_t ReadLE64(const uint8_t* data)
+{
+    return ReadLE32(data) | (static_cast<uint64_t>(ReadLE32(data + 4)) << 32);
+}
+
+void WriteLE32(uint8_t* data, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        data[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+void WriteLE64(uint8_t* data, uint64_t value)
+{
+    WriteLE32(data, static_cast<uint32_t>(value));
+    WriteLE32(data + 4, static_cast<uint32_t>(value >> 32));
+}
+
+class Reader
+{
+public:
+    Reader(const uint8_t* data, size_t size)
+        : m_data(data)
+        , m_size(size)
+        , m_pos(0)
+    {
+    }
+
+    const uint8_t* Current() const { return m_data + m_pos; }
+
+    const uint8_t* ReadBytes(uint64_t size)
+    {
+        if (size > m_size - m_pos)
+        {
+            throw FormatError();
+        }
+
+        const auto data = m_data + m_pos;
+        m_pos += static_cast<size_t>(size);
+        return data;
+    }
+
+    uint8_t ReadByte() { return *ReadBytes(1); }
+
+    uint16_t ReadUInt16()
+    {
+        const auto data = ReadBytes(2);
+        return static_cast<uint16_t>(data[0] | (data[1] << 8));
+    }
+
+    uint32_t ReadUInt32() { return ReadLE32(ReadBytes(4)); }
+
+    uint64_t ReadUInt64() { return ReadLE64(ReadBytes(8)); }
+
+    uint64_t ReadNumber()
+    {
+        const uint8_t first = ReadByte();
+        uint8_t mask = 0x80;
+        uint64_t value = 0;
+        for (int i = 0; i < 8; ++i)
+        {
+            if ((first & mask) == 0)
+            {
+                const uint64_t high = first & (mask - 1);
+                return value | (high << (8 * i));
+            }
+
+            value |= static_cast<uint64_t>(ReadByte()) << (8 * i);
+            mask >>= 1;
+        }
+
+        return value;
+    }
+
+    uint64_t ReadCount()
+    {
+        const auto count = ReadNumber();
+        if (count > kMaxCount)
+        {
+            throw FormatError();
+        }
+
+        return count;
+    }
+
+    std::vector<bool> ReadBits(size_t count)
+    {
+        std::vector<bool> bits(count);
+        uint8_t value = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (i % 8 == 0)
+            {
+                value = ReadByte();
+            }
+
+            bits[i] = (value & (0x80 >> (i % 8))) != 0;
+        }
+
+        return bits;
+    }
+
+    std::vector<bool> ReadOptionalBits(size_t count)
+    {
+        const auto allAreDefined = ReadByte();
+        if (allAreDefined)
+        {
+            return std::vector<bool>(count, true);
+        }
+
+        return ReadBits(count);
+    }
+
+    std::vector<std::optional<uint32_t>> ReadDigests(size_t count)
+    {
+        const auto defined = ReadOptionalBits(count);
+
+        std::vector<std::optional<uint32_t>> digests(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (defined[i])
+            {
+                digests[i] = ReadUInt32();
+            }
+        }
+
+        return digests;
+    }
+
+    void ExpectByte(uint8_t value)
+    {
+        if (ReadByte() != value)
+        {
+            throw FormatError();
+        }
+    }
+
+    void ExpectNumber(uint64_t value)
+    {
+        if (ReadNumber() != value)
+        {
+            throw FormatError();
+        }
+    }
+
+private:
+    const uint8_t* m_data;
+    const size_t m_size;
+    size_t m_pos;
+};
+
+class Writer
+{
+public:
+    const std::vector<uint8_t>& Buffer() const { return m_buffer; }
+
+    void WriteBytes(const uint8_t* data, size_t size) { m_buffer.insert(std::end(m_buffer), data, data + size); }
+
+    void WriteByte(uint8_t value) { m_buffer.push_back(value); }
+
+    void WriteUInt32(uint32_t value)
+    {
+        uint8_t data[4];
+        WriteLE32(data, value);
+        WriteBytes(data, sizeof(data));
+    }
+
+    void WriteUInt64(uint64_t value)
+    {
+        uint8_t data[8];
+        WriteLE64(data, value);
+        WriteBytes(data, sizeof(data));
+    }
+
+    void WriteNumber(uint64_t value)
+    {
+        uint8_t first = 0;
+        uint8_t mask = 0x80;
+        int i = 0;
+        for (; i < 8; ++i)
+        {
+            if (value < (static_cast<uint64_t>(1) << (7 * (i + 1))))
+            {
+                first |= static_cast<uint8_t>(value >> (8 * i));
+                break;
+            }
+
+            first |= mask;
+            mask >>= 1;
+        }
+
+        WriteByte(first);
+        for (; i > 0; --i)
+        {
+            WriteByte(static_cast<uint8_t>(value));
+            value >>= 8;
+        }
+    }
+
+    void WriteBits(const std::vector<bool>& bits)
+    {
+        uint8_t value = 0;
+        for (size_t i = 0; i < bits.size(); ++i)
+        {
+            if (bits[i])
+            {
+                value |= 0x80 >> (i % 8);
+            }
+
+            if (i % 8 == 7)
+            {
+                WriteByte(value);
+                value = 0;
+            }
+        }
+
+        if (bits.size() % 8)
+        {
+            WriteByte(value);
+        }
+    }
+
+    void WriteOptionalBits(const std::vector<bool>& bits)
+    {
+        if (std::all_of(std::cbegin(bits), std::cend(bits), [](bool bit) { return bit; }))
+        {
+            WriteByte(1);
+        }
+        else
+        {
+            WriteByte(0);
+            WriteBits(bits);
+        }
+    }
+
+    void WriteDigests(const std::vector<std::optional<uint32_t>>& digests)
+    {
+        std::vector<bool> defined;
+        std::transform(
+            std::cbegin(digests), std::cend(digests), std::back_inserter(defined), [](const auto& digest) {
+                return digest.has_value();
+            });
+
+        WriteOptionalBits(defined);
+        for (const auto& digest : digests)
+        {
+            if (digest)
+            {
+                WriteUInt32(*digest);
+            }
+        }
+    }
+
+    void WriteProperty(uint8_t id, const Writer& property)
+    {
+        WriteNumber(id);
+        WriteNumber(property.Buffer().size());
+        WriteBytes(property.Buffer().data(), property.Buffer().size());
+    }
+
+private:
+    std::vector<uint8_t> m_buffer;
+};
+
+template <typename T>
+bool AnyDefined(const std::vector<std::optional<T>>& values)
+{
+    return std::any_of(std::cbegin(values), std::cend(values), [](const auto& value) { return value.has_value(); });
+}
+
+}  // namespace
+
+namespace Orc {
+namespace Archive {
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+    {
+        crc = kCrcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+Header7z::StartHeader Header7z::ParseSignatureHeader(const uint8_t* data, size_t size, std::error_code& ec)
+{
+    if (size < kSignatureHeaderSize || !std::equal(std::cbegin(kSignature), std::cend(kSignature), data))
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        return {};
+    }
+
+    // Only major version 0 exists, minor versions are backward compatible
+    if (data[6] != 0 || Crc32(data + 12, 20) != ReadLE32(data + 8))
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        return {};
+    }
+
+    StartHeader startHeader;
+    startHeader.NextHeaderOffset = ReadLE64(data + 12);
+    startHeader.NextHeaderSize = ReadLE64(data + 20);
+    startHeader.NextHeaderCrc = ReadLE32(data + 28);
+    return startHeader;
+}
+
+std::array<uint8_t, Header7z::kSignatureHeaderSize> Header7z::MakeSignatureHeader(const StartHeader& startHeader)
+{
+    std::array<uint8_t, kSignatureHeaderSize> header = {};
+    std::copy(std::cbegin(kSignature), std::cend(kSignature), std::begin(header));
+    header[6] = 0;
+    header[7] = 4;
+
+    WriteLE64(header.data() + 12, startHeader.NextHeaderOffset);
+    WriteLE64(header.data() + 20, startHeader.NextHeaderSize);
+    WriteLE32(header.data() + 28, startHeader.NextHeaderCrc);
+    WriteLE32(header.data() + 8, Crc32(header.data() + 12, 20));
+    return header;
+}
+
+Header7z Header7z::Parse(const uint8_t* data, size_t size, std::error_code& ec)
+{
+    Header7z header;
+    Reader reader(data, size);
+
+    try
+    {
+        // Encoded (compressed or encrypted) headers would require the 7-Zip decoders
+        reader.ExpectByte(kHeader);
+
+        auto id = reader.ReadNumber();
+        if (id == kArchiveProperties || id == kAdditionalStreamsInfo)
+        {
+            throw FormatError();
+        }
+
+        if (id == kMainStreamsInfo)
+        {
+            id = reader.ReadNumber();
+            if (id == kPackInfo)
+            {
+                header.m_packPos = reader.ReadNumber();
+
+                const auto numPackStreams = reader.ReadCount();
+                header.m_packSizes.resize(numPackStreams);
+                header.m_packCrcs.resize(numPackStreams);
+
+                for (id = reader.ReadNumber(); id != kEnd; id = reader.ReadNumber())
+                {
+                    if (id == kSize)
+                    {
+                        std::generate(std::begin(header.m_packSizes), std::end(header.m_packSizes), [&]() {
+                            return reader.ReadNumber();
+                        });
+                    }
+                    else if (id == kCRC)
+                    {
+                        header.m_packCrcs = reader.ReadDigests(numPackStreams);
+                    }
+                    else
+                    {
+                        throw FormatError();
+                    }
+                }
+
+                id = reader.ReadNumber();
+            }
+
+            if (id == kUnPackInfo)
+            {
+                reader.ExpectNumber(kFolder);
+                header.m_folders.resize(reader.ReadCount());
+
+                // External folders are stored in additional streams, never written by 7-Zip
+                reader.ExpectByte(0);
+
+                for (auto& folder : header.m_folders)
+                {
+                    const auto start = reader.Current();
+
+                    const auto numCoders = reader.ReadCount();
+                    uint64_t numInStreams = 0, numOutStreams = 0;
+                    for (uint64_t i = 0; i < numCoders; ++i)
+                    {
+                        const auto flags = reader.ReadByte();
+                        if (flags & 0x80)
+                        {
+                            throw FormatError();
+                        }
+
+                        reader.ReadBytes(flags & 0x0F);
+                        if (flags & 0x10)
+                        {
+                            numInStreams += reader.ReadCount();
+                            numOutStreams += reader.ReadCount();
+                        }
+                        else
+                        {
+                            numInStreams++;
+                            numOutStreams++;
+                        }
+
+                        if (flags & 0x20)
+                        {
+                            reader.ReadBytes(reader.ReadNumber());
+                        }
+                    }
+
+                    if (numOutStreams == 0 || numOutStreams > kMaxCount || numInStreams < numOutStreams - 1)
+                    {
+                        throw FormatError();
+                    }
+
+                    std::vector<bool> isBound(static_cast<size_t>(numOutStreams));
+                    for (uint64_t i = 0; i < numOutStreams - 1; ++i)
+                    {
+                        reader.ReadNumber();
+                        const auto outIndex = reader.ReadNumber();
+                        if (outIndex >= numOutStreams)
+                        {
+                            throw FormatError();
+                        }
+
+                        isBound[static_cast<size_t>(outIndex)] = true;
+                    }
+
+                    folder.NumPackStreams = numInStreams - (numOutStreams - 1);
+                    if (folder.NumPackStreams > 1)
+                    {
+                        for (uint64_t i = 0; i < folder.NumPackStreams; ++i)
+                        {
+                            reader.ReadNumber();
+                        }
+                    }
+
+                    const auto mainStream = std::find(std::cbegin(isBound), std::cend(isBound), false);
+                    if (mainStream == std::cend(isBound))
+                    {
+                        throw FormatError();
+                    }
+
+                    folder.MainStream = std::distance(std::cbegin(isBound), mainStream);
+                    folder.UnpackSizes.resize(static_cast<size_t>(numOutStreams));
+                    folder.Raw.assign(start, reader.Current());
+                }
+
+                reader.ExpectNumber(kCodersUnPackSize);
+                for (auto& folder : header.m_folders)
+                {
+                    std::generate(std::begin(folder.UnpackSizes), std::end(folder.UnpackSizes), [&]() {
+                        return reader.ReadNumber();
+                    });
+                }
+
+                for (id = reader.ReadNumber(); id != kEnd; id = reader.ReadNumber())
+                {
+                    if (id != kCRC)
+                    {
+                        throw FormatError();
+                    }
+
+                    const auto digests = reader.ReadDigests(header.m_folders.size());
+                    for (size_t i = 0; i < digests.size(); ++i)
+                    {
+                        header.m_folders[i].Crc = digests[i];
+                    }
+                }
+
+                id = reader.ReadNumber();
+            }
+
+            uint64_t numFolderPackStreams = 0;
+            for (const auto& folder : header.m_folders)
+            {
+                numFolderPackStreams += folder.NumPackStreams;
+            }
+
+            if (numFolderPackStreams != header.m_packSizes.size())
+            {
+                throw FormatError();
+            }
+
+            if (id == kSubStreamsInfo)
+            {
+                id = reader.ReadNumber();
+                if (id == kNumUnPackStream)
+                {
+                    for (auto& folder : header.m_folders)
+                    {
+                        folder.NumSubStreams = reader.ReadCount();
+                    }
+
+                    id = reader.ReadNumber();
+                }
+
+                for (const auto& folder : header.m_folders)
+                {
+                    if (folder.NumSubStreams == 0)
+                    {
+                        continue;
+                    }
+
+                    if (folder.NumSubStreams > 1 && id != kSize)
+                    {
+                        throw FormatError();
+                    }
+
+                    uint64_t sum = 0;
+                    for (uint64_t i = 1; i < folder.NumSubStreams; ++i)
+                    {
+                        const auto subStreamSize = reader.ReadNumber();
+                        header.m_subStreamSizes.push_back(subStreamSize);
+                        sum += subStreamSize;
+                    }
+
+                    if (sum > folder.UnpackSize())
+                    {
+                        throw FormatError();
+                    }
+
+                    header.m_subStreamSizes.push_back(folder.UnpackSize() - sum);
+                }
+
+                if (id == kSize)
+                {
+                    id = reader.ReadNumber();
+                }
+
+                // Folders with a single sub stream and a known digest do not repeat it
+                size_t numUnknownDigests = 0;
+                for (const auto& folder : header.m_folders)
+                {
+                    if (folder.NumSubStreams == 1 && folder.Crc)
+                    {
+                        header.m_subStreamCrcs.push_back(folder.Crc);
+                    }
+                    else
+                    {
+                        numUnknownDigests += static_cast<size_t>(folder.NumSubStreams);
+                        header.m_subStreamCrcs.resize(
+                            header.m_subStreamCrcs.size() + static_cast<size_t>(folder.NumSubStreams));
+                    }
+                }
+
+                for (; id != kEnd; id = reader.ReadNumber())
+                {
+                    if (id != kCRC)
+                    {
+                        throw FormatError();
+                    }
+
+                    const auto digests = reader.ReadDigests(numUnknownDigests);
+                    auto digest = std::cbegin(digests);
+                    size_t index = 0;
+                    for (const auto& folder : header.m_folders)
+                    {
+                        if (folder.NumSubStreams == 1 && folder.Crc)
+                        {
+                            index++;
+                            continue;
+                        }
+
+                        for (uint64_t i = 0; i < folder.NumSubStreams; ++i)
+                        {
+                            header.m_subStreamCrcs[index++] = *digest++;
+                        }
+                    }
+                }
+
+                id = reader.ReadNumber();
+            }
+            else
+            {
+                for (const auto& folder : header.m_folders)
+                {
+                    header.m_subStreamSizes.push_back(folder.UnpackSize());
+                    header.m_subStreamCrcs.push_back(folder.Crc);
+                }
+            }
+
+            if (id != kEnd)
+            {
+                throw FormatError();
+            }
+
+            id = reader.ReadNumber();
+        }
+
+        if (id == kFilesInfo)
+        {
+            header.m_files.resize(reader.ReadCount());
+
+            std::vector<File*> emptyStreamFiles;
+            for (uint64_t type = reader.ReadNumber(); type != kEnd; type = reader.ReadNumber())
+            {
+                const auto propertySize = reader.ReadNumber();
+                Reader property(reader.ReadBytes(propertySize), static_cast<size_t>(propertySize));
+
+                switch (type)
+                {
+                    case kEmptyStream: {
+                        const auto bits = property.ReadBits(header.m_files.size());
+                        emptyStreamFiles.clear();
+                        for (size_t i = 0; i < bits.size(); ++i)
+                        {
+                            header.m_files[i].HasStream = !bits[i];
+                            if (bits[i])
+                            {
+                                emptyStreamFiles.push_back(&header.m_files[i]);
+                            }
+                        }
+                        break;
+                    }
+                    case kEmptyFile:
+                    case kAnti: {
+                        const auto bits = property.ReadBits(emptyStreamFiles.size());
+                        for (size_t i = 0; i < bits.size(); ++i)
+                        {
+                            (type == kEmptyFile ? emptyStreamFiles[i]->IsEmptyFile : emptyStreamFiles[i]->IsAnti) =
+                                bits[i];
+                        }
+                        break;
+                    }
+                    case kName: {
+                        property.ExpectByte(0);
+                        for (auto& file : header.m_files)
+                        {
+                            for (char16_t c = property.ReadUInt16(); c != 0; c = property.ReadUInt16())
+                            {
+                                file.Name.push_back(c);
+                            }
+                        }
+                        break;
+                    }
+                    case kCTime:
+                    case kATime:
+                    case kMTime:
+                    case kStartPos: {
+                        const auto defined = property.ReadOptionalBits(header.m_files.size());
+                        property.ExpectByte(0);
+                        for (size_t i = 0; i < defined.size(); ++i)
+                        {
+                            auto& file = header.m_files[i];
+                            auto& value = type == kCTime ? file.CTime
+                                : type == kATime         ? file.ATime
+                                : type == kMTime         ? file.MTime
+                                                         : file.StartPos;
+                            if (defined[i])
+                            {
+                                value = property.ReadUInt64();
+                            }
+                        }
+                        break;
+                    }
+                    case kWinAttributes: {
+                        const auto defined = property.ReadOptionalBits(header.m_files.size());
+                        property.ExpectByte(0);
+                        for (size_t i = 0; i < defined.size(); ++i)
+                        {
+                            if (defined[i])
+                            {
+                                header.m_files[i].Attributes = property.ReadUInt32();
+                            }
+                        }
+                        break;
+                    }
+                    case kDummy:
+                        // Alignment padding
+                        break;
+                    default:
+                        throw FormatError();
+                }
+            }
+
+            const auto numFileStreams = std::count_if(
+                std::cbegin(header.m_files), std::cend(header.m_files), [](const auto& file) {
+                    return file.HasStream;
+                });
+
+            if (static_cast<size_t>(numFileStreams) != header.m_subStreamSizes.size())
+            {
+                throw FormatError();
+            }
+
+            id = reader.ReadNumber();
+        }
+
+        if (id != kEnd || (!header.m_subStreamSizes.empty() && header.m_files.empty()))
+        {
+            throw FormatError();
+        }
+    }
+    catch (const FormatError&)
+    {
+        ec = std::make_error_code(std::errc::illegal_byte_sequence);
+        return {};
+    }
+
+    return header;
+}
+
+uint64_t Header7z::Folder::UnpackSize() const
+{
+    return UnpackSizes[MainStream];
+}
+
+uint64_t Header7z::PackSize() const
+{
+    return std::accumulate(std::cbegin(m_packSizes), std::cend(m_packSizes), uint64_t(0));
+}
+
+void Header7z::Append(Header7z&& other)
+{
+    const auto append = [](auto& to, auto& from) {
+        to.insert(std::end(to), std::make_move_iterator(std::begin(from)), std::make_move_iterator(std::end(from)));
+    };
+
+    append(m_packSizes, other.m_packSizes);
+    append(m_packCrcs, other.m_packCrcs);
+    append(m_folders, other.m_folders);
+    append(m_subStreamSizes, other.m_subStreamSizes);
+    append(m_subStreamCrcs, other.m_subStreamCrcs);
+    append(m_files, other.m_files);
+}
+
+std::vector<uint8_t> Header7z::Serialize() const
+{
+    Writer writer;
+    writer.WriteByte(kHeader);
+
+    if (!m_folders.empty())
+    {
+        writer.WriteNumber(kMainStreamsInfo);
+
+        writer.WriteNumber(kPackInfo);
+        writer.WriteNumber(m_packPos);
+        writer.WriteNumber(m_packSizes.size());
+        writer.WriteNumber(kSize);
+        for (const auto packSize : m_packSizes)
+        {
+            writer.WriteNumber(packSize);
+        }
+
+        if (AnyDefined(m_packCrcs))
+        {
+            writer.WriteNumber(kCRC);
+            writer.WriteDigests(m_packCrcs);
+        }
+        writer.WriteNumber(kEnd);
+
+        writer.WriteNumber(kUnPackInfo);
+        writer.WriteNumber(kFolder);
+        writer.WriteNumber(m_folders.size());
+        writer.WriteByte(0);
+        for (const auto& folder : m_folders)
+        {
+            writer.WriteBytes(folder.Raw.data(), folder.Raw.size());
+        }
+
+        writer.WriteNumber(kCodersUnPackSize);
+        std::vector<std::optional<uint32_t>> folderCrcs;
+        for (const auto& folder : m_folders)
+        {
+            for (const auto unpackSize : folder.UnpackSizes)
+            {
+                writer.WriteNumber(unpackSize);
+            }
+
+            folderCrcs.push_back(folder.Crc);
+        }
+
+        if (AnyDefined(folderCrcs))
+        {
+            writer.WriteNumber(kCRC);
+            writer.WriteDigests(folderCrcs);
+        }
+        writer.WriteNumber(kEnd);
+
+        writer.WriteNumber(kSubStreamsInfo);
+        const bool hasNumSubStreams = std::any_of(std::cbegin(m_folders), std::cend(m_folders), [](const auto& folder) {
+            return folder.NumSubStreams != 1;
+        });
+
+        if (hasNumSubStreams)
+        {
+            writer.WriteNumber(kNumUnPackStream);
+            for (const auto& folder : m_folders)
+            {
+                writer.WriteNumber(folder.NumSubStreams);
+            }
+        }
+
+        std::vector<std::optional<uint32_t>> unknownDigests;
+        bool hasSizes = false;
+        size_t index = 0;
+        for (const auto& folder : m_folders)
+        {
+            for (uint64_t i = 1; i < folder.NumSubStreams; ++i)
+            {
+                if (!hasSizes)
+                {
+                    writer.WriteNumber(kSize);
+                    hasSizes = true;
+                }
+
+                writer.WriteNumber(m_subStreamSizes[index + i - 1]);
+            }
+
+            if (folder.NumSubStreams != 1 || !folder.Crc)
+            {
+                unknownDigests.insert(
+                    std::end(unknownDigests),
+                    std::cbegin(m_subStreamCrcs) + index,
+                    std::cbegin(m_subStreamCrcs) + index + static_cast<size_t>(folder.NumSubStreams));
+            }
+
+            index += static_cast<size_t>(folder.NumSubStreams);
+        }
+
+        if (AnyDefined(unknownDigests))
+        {
+            writer.WriteNumber(kCRC);
+            writer.WriteDigests(unknownDigests);
+        }
+        writer.WriteNumber(kEnd);
+
+        writer.WriteNumber(kEnd);
+    }
+
+    if (!m_files.empty())
+    {
+        writer.WriteNumber(kFilesInfo);
+        writer.WriteNumber(m_files.size());
+
+        std::vector<bool> emptyStreams, emptyFiles, antiFiles;
+        for (const auto& file : m_files)
+        {
+            emptyStreams.push_back(!file.HasStream);
+            if (!file.HasStream)
+            {
+                emptyFiles.push_back(file.IsEmptyFile);
+                antiFiles.push_back(file.IsAnti);
+            }
+        }
+
+        const auto writeBits = [&writer](uint8_t id, const std::vector<bool>& bits) {
+            if (std::find(std::cbegin(bits), std::cend(bits), true) == std::cend(bits))
+            {
+                return;
+            }
+
+            Writer property;
+            property.WriteBits(bits);
+            writer.WriteProperty(id, property);
+        };
+
+        writeBits(kEmptyStream, emptyStreams);
+        writeBits(kEmptyFile, emptyFiles);
+        writeBits(kAnti, antiFiles);
+
+        Writer names;
+        names.WriteByte(0);
+        for (const auto& file : m_files)
+        {
+            for (const auto c : file.Name)
+            {
+                names.WriteByte(static_cast<uint8_t>(c));
+                names.WriteByte(static_cast<uint8_t>(c >> 8));
+            }
+
+            names.WriteByte(0);
+            names.WriteByte(0);
+        }
+        writer.WriteProperty(kName, names);
+
+        const auto writeValues = [this, &writer](uint8_t id, auto member) {
+            std::vector<bool> defined;
+            for (const auto& file : m_files)
+            {
+                defined.push_back((file.*member).has_value());
+            }
+
+            if (std::find(std::cbegin(defined), std::cend(defined), true) == std::cend(defined))
+            {
+                return;
+            }
+
+            Writer property;
+            property.WriteOptionalBits(defined);
+            property.WriteByte(0);
+            for (const auto& file : m_files)
+            {
+                if (!(file.*member))
+                {
+                    continue;
+                }
+
+                if constexpr (sizeof(*(m_files.front().*member)) == sizeof(uint32_t))
+                {
+                    property.WriteUInt32(*(file.*member));
+                }
+                else
+                {
+                    property.WriteUInt64(*(file.*member));
+                }
+            }
+
+            writer.WriteProperty(id, property);
+        };
+
+        writeValues(kCTime, &File::CTime);
+        writeValues(kATime, &File::ATime);
+        writeValues(kMTime, &File::MTime);
+        writeValues(kStartPos, &File::StartPos);
+        writeValues(kWinAttributes, &File::Attributes);
+
+        writer.WriteNumber(kEnd);
+    }
+
+    writer.WriteNumber(kEnd);
+    return writer.Buffer();
+}
+
+}  // namespace Archive
+}  // namespace Orc
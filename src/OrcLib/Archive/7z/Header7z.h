@@ -0,0 +1,99 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2020 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace Orc {
+namespace Archive {
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+//
+// Header7z: in memory model of a plain (not encoded) 7z header, enough to graft the content of an archive at the end
+// of another one without recompressing or copying the existing packed streams.
+//
+// Only the layout written by 7-Zip itself is handled: anything unexpected (encoded header, additional streams, external
+// data, unknown file properties) is reported as an error so that callers can fall back to a full archive update.
+//
+class Header7z
+{
+public:
+    static constexpr size_t kSignatureHeaderSize = 32;
+
+    struct StartHeader
+    {
+        uint64_t NextHeaderOffset = 0;
+        uint64_t NextHeaderSize = 0;
+        uint32_t NextHeaderCrc = 0;
+    };
+
+    static StartHeader ParseSignatureHeader(const uint8_t* data, size_t size, std::error_code& ec);
+    static std::array<uint8_t, kSignatureHeaderSize> MakeSignatureHeader(const StartHeader& startHeader);
+
+    static Header7z Parse(const uint8_t* data, size_t size, std::error_code& ec);
+
+    std::vector<uint8_t> Serialize() const;
+
+    // Append the items of 'other' whose packed streams are expected right after the ones of this header
+    void Append(Header7z&& other);
+
+    // Offset of the packed streams relative to the end of the signature header
+    uint64_t PackPos() const { return m_packPos; }
+    uint64_t PackSize() const;
+    uint64_t PackEnd() const { return m_packPos + PackSize(); }
+
+    size_t NumberOfFiles() const { return m_files.size(); }
+
+private:
+    struct Folder
+    {
+        uint64_t UnpackSize() const;
+
+        // Coders and bind pairs as stored in the archive: they are never interpreted
+        std::vector<uint8_t> Raw;
+        uint64_t NumPackStreams = 0;
+        size_t MainStream = 0;
+        std::vector<uint64_t> UnpackSizes;
+        std::optional<uint32_t> Crc;
+        uint64_t NumSubStreams = 1;
+    };
+
+    struct File
+    {
+        std::u16string Name;
+        bool HasStream = true;
+        bool IsEmptyFile = false;
+        bool IsAnti = false;
+        std::optional<uint64_t> CTime;
+        std::optional<uint64_t> ATime;
+        std::optional<uint64_t> MTime;
+        std::optional<uint64_t> StartPos;
+        std::optional<uint32_t> Attributes;
+    };
+
+    uint64_t m_packPos = 0;
+    std::vector<uint64_t> m_packSizes;
+    std::vector<std::optional<uint32_t>> m_packCrcs;
+    std::vector<Folder> m_folders;
+
+    // Sizes and digests of every sub stream of every folder, in folder order
+    std::vector<uint64_t> m_subStreamSizes;
+    std::vector<std::optional<uint32_t>> m_subStreamCrcs;
+
+    std::vector<File> m_files;
+};
+
+}  // namespace Archive
+}  // namespace Orc
@@ -30,13 +30,28 @@ STDMETHODIMP OutStreamAdapter::Write(const void* data, UInt32 size, UInt32* proc
 STDMETHODIMP OutStreamAdapter::Seek(Int64 offset, UInt32 seekOrigin, UInt64* newPosition)
 {
     LARGE_INTEGER move;
-    ULARGE_INTEGER newPos;
+    ULARGE_INTEGER newPos = {0};
 
     move.QuadPart = offset;
+    if (seekOrigin == STREAM_SEEK_SET)
+    {
+        move.QuadPart += m_baseOffset;
+    }
+
     HRESULT hr = m_stream->SetFilePointer(move.QuadPart, seekOrigin, &newPos.QuadPart);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    if (newPos.QuadPart < m_baseOffset)
+    {
+        return HRESULT_FROM_WIN32(ERROR_NEGATIVE_SEEK);
+    }
+
     if (newPosition != NULL)
     {
-        *newPosition = newPos.QuadPart;
+        *newPosition = newPos.QuadPart - m_baseOffset;
     }
 
     return hr;
@@ -45,6 +60,6 @@ STDMETHODIMP OutStreamAdapter::Seek(Int64 offset, UInt32 seekOrigin, UInt64* new
 STDMETHODIMP OutStreamAdapter::SetSize(UInt64 newSize)
 {
     ULARGE_INTEGER size;
-    size.QuadPart = newSize;
+    size.QuadPart = newSize + m_baseOffset;
     return m_stream->SetSize(size.QuadPart);
 }
@@ -26,6 +26,14 @@ class OutStreamAdapter
 public:
     OutStreamAdapter(std::shared_ptr<ByteStream> outByteStream)
         : m_stream(std::move(outByteStream))
+        , m_baseOffset(0)
+    {
+    }
+
+    // Expose the part of 'outByteStream' starting at 'baseOffset' as a whole stream
+    OutStreamAdapter(std::shared_ptr<ByteStream> outByteStream, UInt64 baseOffset)
+        : m_stream(std::move(outByteStream))
+        , m_baseOffset(baseOffset)
     {
     }
 
@@ -40,6 +48,7 @@ public:
 
 private:
     std::shared_ptr<ByteStream> m_stream;
+    const UInt64 m_baseOffset;
 };
 
 }  // namespace Archive
@@ -16,6 +16,7 @@
 #include "Archive/IArchive.h"
 #include "Archive/CompressionLevel.h"
 #include "Archive/Item.h"
+#include "Telemetry.h"
 #include "Utils/WinApi.h"
 
 namespace Orc {
@@ -24,6 +25,10 @@ namespace Archive {
 //
 // Appender: Add new items to existing archives for archiver that does not support this feature natively.
 //
+// When the archiver supports 'IArchive::Append' each flush compresses the new items at the end of the temporary stream
+// and rewrites the headers, the second temporary stream is left unused. Otherwise the whole archive is updated from
+// one temporary stream into the other.
+//
 template <typename T>
 class Appender
 {
@@ -73,6 +78,7 @@ public:
         , m_tempStreams({std::move(tempStream1), std::move(tempStream2)})
         , m_srcStreamIndex(0)
         , m_isFirstFlush(true)
+        , m_canAppend(m_archiver.EnableAppend())
     {
     }
 
@@ -87,6 +93,12 @@ public:
             return;
         }
 
+        Telemetry::Scope telemetry(Telemetry::Phase::ArchiveFlush);
+        for (const auto& item : m_archiver.AddedItems())
+        {
+            telemetry.AddBytes(item->Size());
+        }
+
         if (m_isFirstFlush)
         {
             m_isFirstFlush = false;
@@ -95,8 +107,17 @@ public:
         }
 
         auto& srcStream = m_tempStreams[m_srcStreamIndex];
-        auto& dstStream = m_tempStreams[(m_srcStreamIndex + 1) % 2];
+        if (m_canAppend)
+        {
+            m_archiver.Append(srcStream, ec);
+            if (ec)
+            {
+                Log::Error("Failed to append to archive stream [{}]", ec);
+            }
+            return;
+        }
 
+        auto& dstStream = m_tempStreams[(m_srcStreamIndex + 1) % 2];
         m_archiver.Compress(dstStream, srcStream, ec);
         if (ec)
         {
@@ -150,12 +171,16 @@ public:
 
     const IArchive::Items& AddedItems() const { return m_archiver.AddedItems(); };
 
+    // Flushes only compress the new items: the archive can be flushed as often as wanted while it is being built
+    bool CanAppend() const { return m_canAppend; }
+
 private:
     T m_archiver;
     const std::filesystem::path m_output;
     const std::array<std::shared_ptr<TemporaryStream>, 2> m_tempStreams;
     uint8_t m_srcStreamIndex;
     bool m_isFirstFlush;
+    const bool m_canAppend;
 };
 
 }  // namespace Archive
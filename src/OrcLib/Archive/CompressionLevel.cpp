@@ -10,6 +10,8 @@
 
 #include <cctype>
 
+#include "JobObject.h"
+
 namespace {
 
 using namespace std::string_view_literals;
@@ -67,6 +69,40 @@ CompressionLevel ToCompressionLevel(std::wstring_view compressionLevel, std::err
     return it->second;
 }
 
+uint32_t ToLib7zLevel(CompressionLevel level)
+{
+    switch (level)
+    {
+        case CompressionLevel::kNone:
+            return 0;
+        case CompressionLevel::kFastest:
+            return 1;
+        case CompressionLevel::kFast:
+            return 3;
+        case CompressionLevel::kNormal:
+            return 5;
+        case CompressionLevel::kMaximum:
+            return 7;
+        case CompressionLevel::kUltra:
+            return 9;
+        case CompressionLevel::kDefault:
+        default:
+            return 5;
+    }
+}
+
+uint32_t ToCompressionThreads(uint32_t requested)
+{
+    // Restrictions are set by the parent before this process starts
+    static const auto limit = JobObject::GetJobObject().GetProcessorLimit();
+    if (requested == kAutoCompressionThreads)
+    {
+        return limit;
+    }
+
+    return std::min<uint32_t>(requested, limit);
+}
+
 std::string_view ToString(CompressionLevel level)
 {
     using namespace std::string_view_literals;
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <system_error>
 
@@ -27,6 +28,15 @@ enum class CompressionLevel
 
 CompressionLevel ToCompressionLevel(std::wstring_view compressionLevel, std::error_code& ec);
 
+// Value of the 7-Zip "x" property, from 0 (store) to 9. 'kDefault' is 'kNormal'
+uint32_t ToLib7zLevel(CompressionLevel level);
+
+// Coder threads: 'kAutoCompressionThreads' uses the processors allowed by the job object restrictions
+constexpr uint32_t kAutoCompressionThreads = 0;
+
+// Resolve the number of threads given to the multi-threaded coders (LZMA2 for 7z, one item per thread for zip)
+uint32_t ToCompressionThreads(uint32_t requested);
+
 std::string_view ToString(CompressionLevel);
 std::wstring_view ToWString(CompressionLevel);
 
@@ -48,6 +48,16 @@ public:
 
     // List of added items waiting to be processed by the Compress method
     virtual const Items& AddedItems() const = 0;
+
+    // Request archives that can be extended with 'Append'. Return false if the format does not support it.
+    virtual bool EnableAppend() { return false; }
+
+    // Add the pending items to 'archive', previously written by Compress, without copying its existing content again.
+    // The items are compressed in place at the end of 'archive': their data is read and written only once.
+    virtual void Append(const std::shared_ptr<ByteStream>& archive, std::error_code& ec)
+    {
+        ec = std::make_error_code(std::errc::operation_not_supported);
+    }
 };
 
 }  // namespace Archive
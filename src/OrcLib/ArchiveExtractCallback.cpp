@@ -222,19 +222,17 @@ STDMETHODIMP ArchiveExtractCallback::CryptoGetTextPassword(BSTR* password)
     return S_OK;
 }
 
-STDMETHODIMP ArchiveExtractCallback::GetPropertyFilePath(UInt32 index)
+HRESULT ArchiveExtractCallback::GetItemName(IInArchive* archive, UInt32 index, std::wstring& strName)
 {
     CPropVariant prop;
 
-    HRESULT hr = m_archiveHandler->GetProperty(index, kpidPath, &prop);
+    HRESULT hr = archive->GetProperty(index, kpidPath, &prop);
     if (hr != S_OK)
         return hr;
 
-    m_currentItem.Index = index;
-
     if (prop.vt == VT_EMPTY)
     {
-        m_currentItem.NameInArchive = EmptyFileAlias;
+        strName = EmptyFileAlias;
     }
     else if (prop.vt != VT_BSTR)
     {
@@ -243,11 +241,21 @@ STDMETHODIMP ArchiveExtractCallback::GetPropertyFilePath(UInt32 index)
     else
     {
         if (prop.bstrVal != nullptr)
-            m_currentItem.NameInArchive = (std::wstring)CComBSTR(prop.bstrVal);
+            strName = (std::wstring)CComBSTR(prop.bstrVal);
     }
     return S_OK;
 }
 
+STDMETHODIMP ArchiveExtractCallback::GetPropertyFilePath(UInt32 index)
+{
+    HRESULT hr = GetItemName(m_archiveHandler, index, m_currentItem.NameInArchive);
+    if (hr != S_OK)
+        return hr;
+
+    m_currentItem.Index = index;
+    return S_OK;
+}
+
 STDMETHODIMP ArchiveExtractCallback::GetPropertyAttributes(UInt32 index)
 {
     CPropVariant prop;
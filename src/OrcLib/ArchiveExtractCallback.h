@@ -52,6 +52,9 @@ public:
 
     virtual ~ArchiveExtractCallback();
 
+    // Name of the item 'index' of 'archive' as reported to the callbacks
+    static HRESULT GetItemName(IInArchive* archive, UInt32 index, std::wstring& strName);
+
     STDMETHOD(QueryInterface)(REFIID iid, void** ppvObject);
     STDMETHOD_(ULONG, AddRef)();
     STDMETHOD_(ULONG, Release)();
@@ -125,4 +125,12 @@ ArchiveMessage::Message ArchiveMessage::MakeCancellationRequest()
     return std::make_shared<::ArchiveMessageT>(ArchiveMessage::Cancel);
 }
 
+ULONGLONG ArchiveMessage::Weigh(const Message& message)
+{
+    if (message == nullptr || message->GetStream() == nullptr)
+        return 0LL;
+
+    return message->GetStream()->GetSize();
+}
+
 ArchiveMessage::~ArchiveMessage() {}
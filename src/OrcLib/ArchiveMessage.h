@@ -12,6 +12,7 @@
 
 #include "ByteStream.h"
 #include "Archive.h"
+#include "BoundedMessageBuffer.h"
 #include "OutputSpec.h"
 
 #include <memory>
@@ -52,6 +53,10 @@ public:
     using ITarget = Concurrency::ITarget<Message>;
     using ISource = Concurrency::ISource<Message>;
 
+    // Messages weigh the size of their stream: the buffer caps the outputs waiting for the archive agent
+    using BoundedMessageBuffer = Orc::BoundedMessageBuffer<Message>;
+    static ULONGLONG Weigh(const Message& message);
+
 private:
     Request m_request;
     Status m_status;
@@ -24,6 +24,8 @@
 #include <mscat.h>
 
 #include <array>
+#include <filesystem>
+#include <fstream>
 
 #include <sstream>
 
@@ -32,6 +34,7 @@
 #include "FileFormat/PeParser.h"
 #include "Utils/Guard.h"
 #include "Utils/WinApi.h"
+#include "Text/Iconv.h"
 
 using namespace Orc;
 
@@ -310,8 +313,255 @@ const std::shared_ptr<AuthenticodeCache::SignersInfo>& UpdateSignersCache(
     return cache.Update(catalogPath, std::move(info));
 }
 
+constexpr auto OrcAuthenticodeCacheEnv = L"DFIR-ORC_AUTHENTICODE_CACHE";
+constexpr auto kAuthenticodeCacheHeader = std::string_view("DFIR-ORC AUTHENTICODE CACHE 1");
+
+std::optional<ULONGLONG> GetLastWriteTime(const std::wstring& path)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data))
+    {
+        return std::nullopt;
+    }
+
+    return (static_cast<ULONGLONG>(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+// Adding or removing a catalog updates the catalog directory
+ULONGLONG GetCatalogsStamp()
+{
+    std::error_code ec;
+    const auto path =
+        ExpandEnvironmentStringsApi(L"%WINDIR%\\system32\\CatRoot\\{F750E6C3-38EE-11D1-85E5-00C04FC295EE}", ec);
+    if (ec)
+    {
+        return 0LL;
+    }
+
+    return GetLastWriteTime(path).value_or(0LL);
+}
+
+std::vector<std::string_view> SplitFields(std::string_view line)
+{
+    std::vector<std::string_view> fields;
+
+    size_t start = 0;
+    for (auto pos = line.find('\t'); pos != std::string_view::npos; pos = line.find('\t', start))
+    {
+        fields.push_back(line.substr(start, pos - start));
+        start = pos + 1;
+    }
+
+    fields.push_back(line.substr(start));
+    return fields;
+}
+
+// Order of the catalog lookups: the first hash held by a catalog gives the verification
+using CatalogHash = std::pair<CBinaryBuffer Authenticode::PE_Hashs::*, std::wstring_view>;
+const std::array<CatalogHash, 3> kCatalogHashes = {
+    CatalogHash {&Authenticode::PE_Hashs::sha256, L"SHA256"},
+    CatalogHash {&Authenticode::PE_Hashs::sha1, L"SHA1"},
+    CatalogHash {&Authenticode::PE_Hashs::md5, L"MD5"}};
+
 }  // namespace
 
+AuthenticodeCache::AuthenticodeCache()
+{
+    const auto path = GetPersistentCache();
+    if (!path)
+    {
+        return;
+    }
+
+    if (SUCCEEDED(Load(*path, m_verifications)))
+    {
+        Log::Debug(L"Loaded {} cached catalog verifications from '{}'", m_verifications.size(), *path);
+    }
+}
+
+AuthenticodeCache::~AuthenticodeCache()
+{
+    if (!m_bDirty)
+    {
+        return;
+    }
+
+    const auto path = GetPersistentCache();
+    if (path)
+    {
+        Save(*path);
+    }
+}
+
+HRESULT AuthenticodeCache::ConfigurePersistentCache(const std::wstring& strPath)
+{
+    std::error_code ec;
+    const auto path = std::filesystem::absolute(strPath, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid authenticode cache path '{}' [{}]", strPath, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(path.parent_path(), ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create authenticode cache directory '{}' [{}]", path.parent_path().wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcAuthenticodeCacheEnv, path.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcAuthenticodeCacheEnv, path.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Authenticode catalog verifications are cached in '{}'", path.wstring());
+    return S_OK;
+}
+
+std::optional<std::wstring> AuthenticodeCache::GetPersistentCache()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcAuthenticodeCacheEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strPath(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcAuthenticodeCacheEnv, strPath.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strPath.resize(nbChars);
+    return strPath;
+}
+
+ULONGLONG AuthenticodeCache::CatalogStamp(const std::wstring& strCatalogPath)
+{
+    auto it = m_catalogStamps.find(strCatalogPath);
+    if (it == std::end(m_catalogStamps))
+    {
+        it = m_catalogStamps.emplace(strCatalogPath, GetLastWriteTime(strCatalogPath).value_or(0LL)).first;
+    }
+
+    return it->second;
+}
+
+HRESULT AuthenticodeCache::Load(const std::wstring& strPath, Verifications& verifications)
+{
+    std::ifstream ifs(strPath, std::ios_base::binary);
+    if (!ifs)
+    {
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    // Format: a header line with the catalogs stamp, then one tab separated line per hash:
+    //   <hash> <status> <signed> <verifies> <catalog stamp> <catalog path>
+    std::string line;
+    if (!std::getline(ifs, line))
+    {
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    const auto header = SplitFields(line);
+    if (header.size() != 2 || header[0] != kAuthenticodeCacheHeader)
+    {
+        Log::Warn(L"Ignoring invalid authenticode cache '{}'", strPath);
+        return E_INVALIDARG;
+    }
+
+    const bool bNegativeEntriesValid = header[1] == std::to_string(GetCatalogsStamp());
+
+    while (std::getline(ifs, line))
+    {
+        const auto fields = SplitFields(line);
+        if (fields.size() != 6)
+        {
+            continue;
+        }
+
+        CatalogVerification verification;
+        verification.status = std::strtoul(std::string(fields[1]).c_str(), nullptr, 10);
+        verification.isSigned = fields[2] == "1";
+        verification.bSignatureVerifies = fields[3] == "1";
+        verification.catalogPath = ToUtf16(fields[5]);
+
+        if (verification.catalogPath.empty())
+        {
+            if (!bNegativeEntriesValid)
+            {
+                continue;
+            }
+        }
+        else if (fields[4] != std::to_string(CatalogStamp(verification.catalogPath)))
+        {
+            continue;
+        }
+
+        verifications.emplace(ToUtf16(fields[0]), std::move(verification));
+    }
+
+    return S_OK;
+}
+
+HRESULT AuthenticodeCache::Save(const std::wstring& strPath)
+{
+    // Other commands could have saved verifications since this cache was loaded: merge with them
+    Verifications merged;
+    Load(strPath, merged);
+
+    for (const auto& [hash, verification] : m_verifications)
+    {
+        merged[hash] = verification;
+    }
+
+    const auto tempPath = strPath + L"." + std::to_wstring(GetCurrentProcessId()) + L"."
+        + std::to_wstring(GetCurrentThreadId()) + L".tmp";
+
+    {
+        std::ofstream ofs(tempPath, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            Log::Warn(L"Failed to create authenticode cache '{}'", tempPath);
+            return E_FAIL;
+        }
+
+        ofs << kAuthenticodeCacheHeader << '\t' << GetCatalogsStamp() << '\n';
+
+        for (const auto& [hash, verification] : merged)
+        {
+            const auto stamp = verification.catalogPath.empty() ? 0LL : CatalogStamp(verification.catalogPath);
+
+            ofs << ToUtf8(hash) << '\t' << verification.status << '\t' << (verification.isSigned ? 1 : 0) << '\t'
+                << (verification.bSignatureVerifies ? 1 : 0) << '\t' << stamp << '\t'
+                << ToUtf8(verification.catalogPath) << '\n';
+        }
+
+        ofs.close();
+        if (ofs.fail())
+        {
+            Log::Warn(L"Failed to write authenticode cache '{}'", tempPath);
+            DeleteFile(tempPath.c_str());
+            return E_FAIL;
+        }
+    }
+
+    if (!MoveFileEx(tempPath.c_str(), strPath.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Warn(L"Failed to replace authenticode cache '{}' [{}]", strPath, SystemError(hr));
+        DeleteFile(tempPath.c_str());
+        return hr;
+    }
+
+    Log::Debug(L"Saved {} catalog verifications to '{}'", merged.size(), strPath);
+    return S_OK;
+}
+
 static GUID WVTPolicyGUID = WINTRUST_ACTION_GENERIC_VERIFY_V2;
 
 const FlagsDefinition Authenticode::AuthenticodeStatusDefs[] = {
@@ -543,6 +793,81 @@ Authenticode::VerifySignatureWithCatalogs(
         data.AuthStatus = Authenticode::AUTHENTICODE_CATALOG_SIGNED_VERIFIED;
     else if (data.isSigned)
         data.AuthStatus = Authenticode::AUTHENTICODE_SIGNED_NOT_VERIFIED;
+
+    if (m_authenticodeCache)
+    {
+        AuthenticodeCache::CatalogVerification verification;
+        verification.status = data.AuthStatus;
+        verification.isSigned = data.isSigned;
+        verification.bSignatureVerifies = data.bSignatureVerifies;
+        verification.catalogPath = InfoStruct.wszCatalogFile;
+        m_authenticodeCache->UpdateVerification(MemberTag, std::move(verification));
+    }
+
+    return S_OK;
+}
+
+HRESULT Authenticode::VerifyWithCachedCatalogs(const PE_Hashs& hashs, AuthenticodeData& data)
+{
+    // Same order as the catalog lookups: the first hash held by a catalog gives the verification
+    for (const auto hash : {&hashs.sha256, &hashs.sha1, &hashs.md5})
+    {
+        if (hash->GetCount() == 0)
+        {
+            continue;
+        }
+
+        const auto verification = m_authenticodeCache->FindVerification(hash->ToHex());
+        if (verification == nullptr)
+        {
+            return S_FALSE;
+        }
+
+        if (verification->catalogPath.empty())
+        {
+            continue;
+        }
+
+        data.isSigned = verification->isSigned;
+        data.bSignatureVerifies = verification->bSignatureVerifies;
+        data.AuthStatus = static_cast<Authenticode::Status>(verification->status);
+
+        Log::Debug(L"The file is associated with cached catalog: '{}'", verification->catalogPath);
+
+        if (data.AuthenticodeCache())
+        {
+            auto info = data.AuthenticodeCache()->Find(verification->catalogPath);
+            if (info)
+            {
+                data.SetSignerInfo(std::move(info));
+                return S_OK;
+            }
+        }
+
+        fmt::basic_memory_buffer<char, 65536> catalogData;
+        auto rv = ::MapFile(verification->catalogPath, catalogData);
+        if (rv.has_error())
+        {
+            Log::Error(
+                L"Failed to extract signature information from catalog '{}' [{}]",
+                verification->catalogPath,
+                rv.error());
+            return S_OK;
+        }
+
+        HRESULT hr = ExtractCatalogSigners(
+            verification->catalogPath, std::string_view(catalogData.data(), catalogData.size()), data);
+        if (FAILED(hr))
+        {
+            Log::Debug(L"Failed to extract signer information from catalog '{}'", verification->catalogPath);
+        }
+
+        return S_OK;
+    }
+
+    data.bSignatureVerifies = false;
+    data.isSigned = false;
+    data.AuthStatus = AUTHENTICODE_NOT_SIGNED;
     return S_OK;
 }
 
@@ -715,79 +1040,109 @@ HRESULT Authenticode::Verify(LPCWSTR szFileName, const std::shared_ptr<ByteStrea
     }
 }
 
-HRESULT Authenticode::VerifyAnySignatureWithCatalogs(LPCWSTR szFileName, const PE_Hashs& hashs, AuthenticodeData& data)
+HRESULT Authenticode::VerifyHashWithCatalogs(
+    LPCWSTR szFileName,
+    const CBinaryBuffer& hash,
+    std::wstring_view algorithm,
+    AuthenticodeData& data)
 {
     HRESULT hr = E_FAIL;
-
-    data.isSigned = false;
-    data.bSignatureVerifies = false;
-
     HCATINFO hCatalog = INVALID_HANDLE_VALUE;
     bool bIsCatalogSigned = false;
 
-    if (hCatalog == INVALID_HANDLE_VALUE && hashs.sha256.GetCount())
+    if (FAILED(hr = FindCatalogForHash(hash, bIsCatalogSigned, hCatalog)))
     {
-        if (FAILED(hr = FindCatalogForHash(hashs.sha256, bIsCatalogSigned, hCatalog)))
+        Log::Debug(L"Could not find a catalog for {} hash [{}]", algorithm, SystemError(hr));
+        return S_FALSE;
+    }
+
+    if (!bIsCatalogSigned)
+    {
+        // Hashes held by no catalog are remembered so they are not looked up again
+        if (m_authenticodeCache)
         {
-            Log::Debug("Could not find a catalog for SHA256 hash [{}]", SystemError(hr));
+            AuthenticodeCache::CatalogVerification verification;
+            verification.status = AUTHENTICODE_NOT_SIGNED;
+            m_authenticodeCache->UpdateVerification(hash.ToHex(), std::move(verification));
         }
-        else if (bIsCatalogSigned)
-        {
-            // Only if file is catalog signed and hash was passed, proceed with verification
-            hr = VerifySignatureWithCatalogs(szFileName, hashs.sha256, hCatalog, data);
 
-            if (!CryptCATAdminReleaseCatalogContext(m_hContext, hCatalog, 0))
-            {
-                Log::Error("Failed CryptCATAdminReleaseCatalogContext [{}]", LastWin32Error());
-            }
+        return S_FALSE;
+    }
 
-            return hr;
-        }
+    // Only if file is catalog signed and hash was passed, proceed with verification
+    hr = VerifySignatureWithCatalogs(szFileName, hash, hCatalog, data);
+
+    if (!CryptCATAdminReleaseCatalogContext(m_hContext, hCatalog, 0))
+    {
+        Log::Error("Failed CryptCATAdminReleaseCatalogContext [{}]", LastWin32Error());
     }
 
-    if (hCatalog == INVALID_HANDLE_VALUE && hashs.sha1.GetCount())
+    return hr;
+}
+
+HRESULT Authenticode::VerifyAnySignatureWithCatalogs(LPCWSTR szFileName, const PE_Hashs& hashs, AuthenticodeData& data)
+{
+    CatalogRequest request;
+    request.szFileName = szFileName;
+    request.Hashs = &hashs;
+    request.Data = &data;
+
+    std::vector<CatalogRequest> requests = {request};
+    VerifyAnySignatureWithCatalogs(requests);
+    return requests.front().hr;
+}
+
+HRESULT Authenticode::VerifyAnySignatureWithCatalogs(std::vector<CatalogRequest>& requests)
+{
+    std::vector<CatalogRequest*> pending;
+    for (auto& request : requests)
     {
-        if (FAILED(hr = FindCatalogForHash(hashs.sha1, bIsCatalogSigned, hCatalog)))
+        request.Data->isSigned = false;
+        request.Data->bSignatureVerifies = false;
+
+        if (m_authenticodeCache && VerifyWithCachedCatalogs(*request.Hashs, *request.Data) == S_OK)
         {
-            Log::Debug("Could not find a catalog for SHA1 hash [{}]", SystemError(hr));
+            request.hr = S_OK;
+            continue;
         }
-        else if (bIsCatalogSigned)
-        {
-            // Only if file is catalog signed and hash was passed, proceed with verification
-            hr = VerifySignatureWithCatalogs(szFileName, hashs.sha1, hCatalog, data);
 
-            if (!CryptCATAdminReleaseCatalogContext(m_hContext, hCatalog, 0))
-            {
-                Log::Error("Failed CryptCATAdminReleaseCatalogContext [{}]", LastWin32Error());
-            }
-
-            return hr;
-        }
+        pending.push_back(&request);
     }
 
-    if (hashs.md5.GetCount())
+    // Consecutive lookups of the same algorithm hit the same index of the catalog database
+    for (const auto& [hash, algorithm] : kCatalogHashes)
     {
-        if (FAILED(hr = FindCatalogForHash(hashs.md5, bIsCatalogSigned, hCatalog)))
-        {
-            Log::Debug(L"Could not find a catalog for MD5 hash [{}]", SystemError(hr));
-        }
-        else if (bIsCatalogSigned)
+        std::vector<CatalogRequest*> unresolved;
+        for (auto request : pending)
         {
-            // Only if file is catalog signed and hash was passed, proceed with verification
-            hr = VerifySignatureWithCatalogs(szFileName, hashs.md5, hCatalog, data);
+            const CBinaryBuffer& value = (*request->Hashs).*hash;
+            if (value.GetCount() == 0)
+            {
+                unresolved.push_back(request);
+                continue;
+            }
 
-            if (!CryptCATAdminReleaseCatalogContext(m_hContext, hCatalog, 0))
+            HRESULT hr = VerifyHashWithCatalogs(request->szFileName, value, algorithm, *request->Data);
+            if (hr == S_FALSE)
             {
-                Log::Error("Failed CryptCATAdminReleaseCatalogContext [{}]", LastWin32Error());
+                unresolved.push_back(request);
+                continue;
             }
 
-            return hr;
+            request->hr = hr;
         }
+
+        pending = std::move(unresolved);
+    }
+
+    for (auto request : pending)
+    {
+        request->Data->bSignatureVerifies = false;
+        request->Data->isSigned = false;
+        request->Data->AuthStatus = AUTHENTICODE_NOT_SIGNED;
+        request->hr = S_OK;
     }
 
-    data.bSignatureVerifies = false;
-    data.isSigned = false;
-    data.AuthStatus = AUTHENTICODE_NOT_SIGNED;
     return S_OK;
 }
 
@@ -9,6 +9,8 @@
 
 #include <string>
 #include <map>
+#include <optional>
+#include <unordered_map>
 
 #include "OrcLib.h"
 #include "Flags.h"
@@ -44,9 +46,47 @@ public:
         std::vector<Thumbprint> certificateAuthoritiesThumbprint;
     };
 
+    // Outcome of the catalog lookup of a PE hash, 'catalogPath' is empty when no catalog holds the hash
+    struct CatalogVerification
+    {
+        DWORD status = 0L;
+        bool isSigned = false;
+        bool bSignatureVerifies = false;
+        std::wstring catalogPath;
+    };
+
     using CatalogPath = std::wstring_view;
     using SignersCache = std::unordered_map<CatalogPath, std::shared_ptr<SignersInfo>>;
 
+    // Catalog verifications are loaded from the persistent cache if configured, and merged back on destruction
+    AuthenticodeCache();
+    ~AuthenticodeCache();
+
+    AuthenticodeCache(const AuthenticodeCache&) = delete;
+    AuthenticodeCache& operator=(const AuthenticodeCache&) = delete;
+
+    // Share catalog verifications between runs and commands in 'strPath' (inherited %DFIR-ORC_AUTHENTICODE_CACHE%).
+    // Entries are dropped when their catalog is modified, and negative ones when a catalog is added or removed.
+    static HRESULT ConfigurePersistentCache(const std::wstring& strPath);
+    static std::optional<std::wstring> GetPersistentCache();
+
+    const CatalogVerification* FindVerification(const std::wstring& hash) const
+    {
+        auto it = m_verifications.find(hash);
+        if (it != std::cend(m_verifications))
+        {
+            return &it->second;
+        }
+
+        return nullptr;
+    }
+
+    void UpdateVerification(const std::wstring& hash, CatalogVerification verification)
+    {
+        m_verifications[hash] = std::move(verification);
+        m_bDirty = true;
+    }
+
     std::shared_ptr<SignersInfo> Find(std::wstring_view catalogPath)
     {
         auto it = m_signers.find(catalogPath);
@@ -71,8 +111,22 @@ public:
     const SignersCache& Signers() const { return m_signers; }
 
 private:
+    using Verifications = std::unordered_map<std::wstring, CatalogVerification>;
+
+    HRESULT Load(const std::wstring& strPath, Verifications& verifications);
+    HRESULT Save(const std::wstring& strPath);
+
+    // Last write time of 'strCatalogPath' as of its first check (0 if missing)
+    ULONGLONG CatalogStamp(const std::wstring& strCatalogPath);
+
     std::vector<std::wstring> m_catalogsPath;
     SignersCache m_signers;
+
+    Verifications m_verifications;
+    bool m_bDirty = false;
+
+    // Last write time of the catalogs, checked once when loading cached verifications
+    std::unordered_map<std::wstring, ULONGLONG> m_catalogStamps;
 };
 
 class Authenticode
@@ -199,6 +253,18 @@ public:
     HRESULT Verify(LPCWSTR szFileName, const std::shared_ptr<ByteStream>& pStream, AuthenticodeData& data);
     HRESULT VerifyAnySignatureWithCatalogs(LPCWSTR szFileName, const PE_Hashs& hashs, AuthenticodeData& data);
 
+    // Catalog verification of several files: each hash algorithm (SHA256, SHA1 then MD5) is looked up for all the
+    // files still without a catalog before the next one, 'hr' is the result VerifyAnySignatureWithCatalogs would give
+    struct CatalogRequest
+    {
+        LPCWSTR szFileName = nullptr;
+        const PE_Hashs* Hashs = nullptr;
+        AuthenticodeData* Data = nullptr;
+        HRESULT hr = E_PENDING;
+    };
+
+    HRESULT VerifyAnySignatureWithCatalogs(std::vector<CatalogRequest>& requests);
+
     // Security directory verification
     HRESULT Verify(LPCWSTR szFileName, const CBinaryBuffer& secdir, const PE_Hashs& hashs, AuthenticodeData& data);
     HRESULT SignatureSize(LPCWSTR szFileName, const CBinaryBuffer& secdir, DWORD& cbSize);
@@ -215,6 +281,16 @@ private:
 
     HRESULT FindCatalogForHash(const CBinaryBuffer& hash, bool& isCatalogSigned, HCATINFO& hCatalog);
 
+    // Verify 'hash' with the catalog holding it: S_FALSE when no catalog holds it
+    HRESULT VerifyHashWithCatalogs(
+        LPCWSTR szFileName,
+        const CBinaryBuffer& hash,
+        std::wstring_view algorithm,
+        AuthenticodeData& data);
+
+    // Apply a cached catalog verification: S_FALSE when one of the hashes was never looked up
+    HRESULT VerifyWithCachedCatalogs(const PE_Hashs& hashs, AuthenticodeData& data);
+
     HRESULT EvaluateCheck(LONG lStatus, AuthenticodeData& data);
 
     HRESULT VerifyEmbeddedSignature(LPCWSTR szFileName, HANDLE hFile, AuthenticodeData& data);
@@ -0,0 +1,196 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "AuthenticodePool.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+// Verifications taken at once by a worker, a larger backlog is shared between the workers
+constexpr size_t kMaxBatch = 32;
+
+}  // namespace
+
+AuthenticodePool::AuthenticodePool(DWORD dwWorkers)
+{
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+
+        // Authenticode and its cache are not thread safe: each worker uses its own verifier
+        worker->Verifier.SetCache(std::make_shared<AuthenticodeCache>());
+
+        m_Workers.push_back(std::move(worker));
+    }
+
+    for (const auto& worker : m_Workers)
+    {
+        worker->Thread = std::thread([this, pWorker = worker.get()]() { Work(*pWorker); });
+    }
+
+    Log::Debug("Authenticode pool started (workers: {})", m_Workers.size());
+}
+
+AuthenticodePool::~AuthenticodePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+
+    m_JobReady.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker->Thread.join();
+    }
+
+    Log::Debug(
+        "Authenticode pool stopped (verifications: {}, batches: {}, waiting collections: {})",
+        m_ullSubmitted,
+        m_ullBatches,
+        m_ullWaits);
+}
+
+AuthenticodePool::Ticket
+AuthenticodePool::Submit(std::wstring strFileName, const CBinaryBuffer& secdir, const Authenticode::PE_Hashs& hashs)
+{
+    if (m_Workers.empty())
+        return nullptr;
+
+    auto job = std::make_shared<Job>();
+    job->strFileName = std::move(strFileName);
+    job->SecurityDirectory = secdir;
+    job->Hashs = hashs;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Jobs.push_back(job);
+        m_ullSubmitted++;
+    }
+
+    m_JobReady.notify_one();
+    return job;
+}
+
+HRESULT AuthenticodePool::Collect(const Ticket& ticket, Authenticode::AuthenticodeData& data)
+{
+    if (ticket == nullptr)
+        return E_POINTER;
+
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        if (!ticket->bDone)
+        {
+            m_ullWaits++;
+            m_JobDone.wait(lock, [&ticket]() { return ticket->bDone; });
+        }
+    }
+
+    // Same exchange as DataDetails::SetAuthenticodeData: certificate contexts are not duplicated
+    std::swap(data, ticket->Data);
+    return ticket->hr;
+}
+
+void AuthenticodePool::Work(Worker& worker)
+{
+    for (;;)
+    {
+        std::vector<Ticket> batch;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobReady.wait(lock, [this]() { return m_bStop || !m_Jobs.empty(); });
+
+            // Submitted verifications are completed before stopping, a submitter may still wait for them
+            if (m_Jobs.empty())
+            {
+                return;
+            }
+
+            const auto count = std::clamp<size_t>(m_Jobs.size() / m_Workers.size(), 1, kMaxBatch);
+            for (size_t i = 0; i < count; i++)
+            {
+                batch.push_back(std::move(m_Jobs.front()));
+                m_Jobs.pop_front();
+            }
+
+            m_ullBatches++;
+        }
+
+        Verify(worker, batch);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (const auto& job : batch)
+            {
+                job->bDone = true;
+            }
+        }
+
+        m_JobDone.notify_all();
+    }
+}
+
+void AuthenticodePool::Verify(Worker& worker, std::vector<Ticket>& batch)
+{
+    std::vector<Job*> catalogJobs;
+    std::vector<Authenticode::CatalogRequest> requests;
+
+    for (const auto& job : batch)
+    {
+        job->Data.AuthenticodeCache() = worker.Verifier.Cache();
+
+        if (job->SecurityDirectory.GetCount() == 0)
+        {
+            Authenticode::CatalogRequest request;
+            request.szFileName = job->strFileName.c_str();
+            request.Hashs = &job->Hashs;
+            request.Data = &job->Data;
+
+            catalogJobs.push_back(job.get());
+            requests.push_back(request);
+            continue;
+        }
+
+        try
+        {
+            job->hr = worker.Verifier.Verify(job->strFileName.c_str(), job->SecurityDirectory, job->Hashs, job->Data);
+        }
+        catch (const std::exception& e)
+        {
+            Log::Error("Authenticode verification failed with an exception: {}", e.what());
+            job->hr = E_FAIL;
+        }
+    }
+
+    if (requests.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        worker.Verifier.VerifyAnySignatureWithCatalogs(requests);
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("Authenticode catalog verifications failed with an exception: {}", e.what());
+    }
+
+    for (size_t i = 0; i < requests.size(); i++)
+    {
+        catalogJobs[i]->hr = requests[i].hr == E_PENDING ? E_FAIL : requests[i].hr;
+    }
+}
@@ -0,0 +1,92 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "Authenticode.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Verify authenticode signatures on worker threads.
+//
+// The PE hashes and the security directory of a file are submitted as soon as they are known, the submitter keeps
+// evaluating the other columns of its row and collects the AuthenticodeData when it writes the authenticode columns.
+// Each worker takes the pending verifications in batches: embedded signatures are verified one after the other and
+// catalog lookups are made one hash algorithm at a time over the batch (see Authenticode::CatalogRequest).
+class AuthenticodePool
+{
+    struct Job;
+
+public:
+    using Ticket = std::shared_ptr<Job>;
+
+    explicit AuthenticodePool(DWORD dwWorkers);
+    ~AuthenticodePool();
+
+    AuthenticodePool(const AuthenticodePool&) = delete;
+    AuthenticodePool& operator=(const AuthenticodePool&) = delete;
+
+    DWORD Workers() const { return static_cast<DWORD>(m_Workers.size()); }
+
+    // Verify the signature in 'secdir', or the catalog signature of 'hashs' if it is empty. nullptr when the pool has
+    // no worker: the caller verifies in place
+    Ticket Submit(std::wstring strFileName, const CBinaryBuffer& secdir, const Authenticode::PE_Hashs& hashs);
+
+    // Wait for the verification of 'ticket' and swap its result with 'data' (an empty AuthenticodeData), returns the
+    // verification status
+    HRESULT Collect(const Ticket& ticket, Authenticode::AuthenticodeData& data);
+
+private:
+    struct Job
+    {
+        std::wstring strFileName;
+        CBinaryBuffer SecurityDirectory;
+        Authenticode::PE_Hashs Hashs;
+
+        // Written by the worker, then read by the collector once 'bDone' is set
+        bool bDone = false;
+        HRESULT hr = E_PENDING;
+        Authenticode::AuthenticodeData Data;
+    };
+
+    struct Worker
+    {
+        Authenticode Verifier;
+        std::thread Thread;
+    };
+
+    void Work(Worker& worker);
+    void Verify(Worker& worker, std::vector<Ticket>& batch);
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobReady;
+    std::condition_variable m_JobDone;
+
+    std::deque<Ticket> m_Jobs;
+    bool m_bStop = false;
+
+    ULONGLONG m_ullSubmitted = 0LL;
+    ULONGLONG m_ullBatches = 0LL;
+    ULONGLONG m_ullWaits = 0LL;
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
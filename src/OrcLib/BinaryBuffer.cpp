@@ -11,6 +11,8 @@
 #include "OrcLib.h"
 
 #include "BinaryBuffer.h"
+#include "BufferPool.h"
+#include "LargePages.h"
 
 #include "CryptoUtilities.h"
 
@@ -46,17 +48,30 @@ HANDLE GetBinaryBufferHeap()
 CBinaryBuffer::CBinaryBuffer(const CBinaryBuffer& other)
     : m_pData(nullptr)
     , m_size(0L)
+    , m_capacity(0L)
     , m_bOwnMemory(true)
-    , m_bVirtualAlloc(other.m_bVirtualAlloc)
     , m_bJunk(true)
+    , m_bVirtualAlloc(other.m_bVirtualAlloc)
+    , m_bPooled(false)
+    , m_bInline(false)
 {
     if (other.m_size > 0)
     {
         if (other.m_bOwnMemory)
         {
-            if (m_bVirtualAlloc)
+            if (!m_bVirtualAlloc && other.m_size <= kInlineCapacity)
+            {
+                if (!other.m_bJunk)
+                    CopyMemory(m_inline, other.m_pData, other.m_size);
+                m_pData = m_inline;
+                m_bInline = true;
+                m_bJunk = false;
+                m_size = other.m_size;
+                m_capacity = kInlineCapacity;
+            }
+            else if (m_bVirtualAlloc)
             {
-                m_pData = (BYTE*)VirtualAlloc(NULL, other.m_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                m_pData = BufferPool::Instance().Allocate(other.m_size);
                 m_bOwnMemory = true;
                 if (m_pData == nullptr)
                     throw Exception(Severity::Fatal, E_OUTOFMEMORY, L"out of memory"sv);
@@ -64,7 +79,9 @@ CBinaryBuffer::CBinaryBuffer(const CBinaryBuffer& other)
                 if (!other.m_bJunk)
                     CopyMemory(m_pData, other.m_pData, other.m_size);
                 m_bJunk = false;
+                m_bPooled = true;
                 m_size = other.m_size;
+                m_capacity = BufferPool::BlockSize(other.m_size);
             }
             else
             {
@@ -79,6 +96,7 @@ CBinaryBuffer::CBinaryBuffer(const CBinaryBuffer& other)
                         CopyMemory(m_pData, other.m_pData, other.m_size);
                     m_bJunk = false;
                     m_size = other.m_size;
+                    m_capacity = other.m_size;
                 }
             }
         }
@@ -86,6 +104,7 @@ CBinaryBuffer::CBinaryBuffer(const CBinaryBuffer& other)
         {
             m_pData = other.m_pData;
             m_size = other.m_size;
+            m_capacity = other.m_capacity;
             m_bOwnMemory = other.m_bOwnMemory;
             m_bJunk = other.m_bJunk;
         }
@@ -101,19 +120,55 @@ bool CBinaryBuffer::SetCount(size_t NewSize)
 
         if (NewSize > 0)
         {
+            if (m_pData != nullptr && NewSize <= m_capacity)
+            {
+                m_size = NewSize;
+                m_bJunk = false;
+                return true;
+            }
+
             if (m_bVirtualAlloc)
             {
-                BYTE* NewData = (BYTE*)VirtualAlloc(NULL, NewSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+                BYTE* NewData = BufferPool::Instance().Allocate(NewSize);
                 if (NewData == NULL)
                     return false;
 
                 if (m_pData != nullptr && !m_bJunk)
                 {
                     CopyMemory(NewData, m_pData, min(m_size, NewSize));
-                    VirtualFree(m_pData, 0L, MEM_RELEASE);
                 }
+
+                RemoveAll();
+
+                m_size = NewSize;
+                m_capacity = BufferPool::BlockSize(NewSize);
+                m_pData = NewData;
+                m_bPooled = true;
+                m_bJunk = false;
+            }
+            else if (m_pData == nullptr && NewSize <= kInlineCapacity)
+            {
+                m_pData = m_inline;
                 m_size = NewSize;
+                m_capacity = kInlineCapacity;
+                m_bInline = true;
+                m_bJunk = false;
+            }
+            else if (m_bInline)
+            {
+                BYTE* NewData = (BYTE*)HeapAlloc(GetBinaryBufferHeap(), 0L, NewSize);
+                if (NewData == nullptr)
+                    return false;
+
+                if (!m_bJunk)
+                {
+                    CopyMemory(NewData, m_inline, m_size);
+                }
+
                 m_pData = NewData;
+                m_size = NewSize;
+                m_capacity = NewSize;
+                m_bInline = false;
                 m_bJunk = false;
             }
             else
@@ -138,9 +193,11 @@ bool CBinaryBuffer::SetCount(size_t NewSize)
                 if (m_pData == nullptr)
                 {
                     m_size = 0L;
+                    m_capacity = 0L;
                     return false;
                 }
                 m_size = NewSize;
+                m_capacity = NewSize;
             }
         }
         else
@@ -157,6 +214,51 @@ bool CBinaryBuffer::SetCount(size_t NewSize)
     return true;
 }
 
+bool CBinaryBuffer::Reserve(size_t cbCapacity)
+{
+    if (!m_bOwnMemory)
+        return cbCapacity <= m_size;
+
+    if (m_pData != nullptr && cbCapacity <= m_capacity)
+        return true;
+
+    const auto size = m_size;
+    const auto bJunk = m_bJunk;
+    if (!SetCount(cbCapacity))
+        return false;
+
+    m_size = size;
+    m_bJunk = bJunk;
+    return true;
+}
+
+bool CBinaryBuffer::ReserveLargePages(size_t cbCapacity)
+{
+    if (!m_bOwnMemory || !m_bVirtualAlloc || (m_pData != nullptr && cbCapacity <= m_capacity))
+        return Reserve(cbCapacity);
+
+    size_t cbAllocated = 0;
+    const auto pData = static_cast<BYTE*>(LargePages::Allocate(cbCapacity, cbAllocated));
+    if (pData == nullptr)
+        return Reserve(cbCapacity);
+
+    if (m_pData != nullptr && !m_bJunk)
+    {
+        CopyMemory(pData, m_pData, m_size);
+    }
+
+    const auto size = m_size;
+    const auto bJunk = m_bJunk;
+    RemoveAll();
+
+    // Not pooled: released with VirtualFree
+    m_pData = pData;
+    m_size = size;
+    m_capacity = cbAllocated;
+    m_bJunk = bJunk;
+    return true;
+}
+
 HRESULT CBinaryBuffer::SetData(LPCBYTE pBuffer, size_t cbSize)
 {
     if (!SetCount(cbSize))
@@ -219,9 +321,13 @@ void CBinaryBuffer::ZeroMe()
 
 void CBinaryBuffer::RemoveAll()
 {
-    if (m_bOwnMemory && m_pData)
+    if (m_bOwnMemory && m_pData && !m_bInline)
     {
-        if (m_bVirtualAlloc)
+        if (m_bPooled)
+        {
+            BufferPool::Instance().Free(m_pData, m_capacity);
+        }
+        else if (m_bVirtualAlloc)
         {
             VirtualFree(m_pData, 0L, MEM_RELEASE);
         }
@@ -233,6 +339,9 @@ void CBinaryBuffer::RemoveAll()
 
     m_pData = nullptr;
     m_size = 0L;
+    m_capacity = 0L;
+    m_bPooled = false;
+    m_bInline = false;
     m_bOwnMemory = true;
     m_bJunk = true;
 }
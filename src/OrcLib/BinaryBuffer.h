@@ -15,6 +15,9 @@
 
 #include <string>
 
+#include "Utils/BufferSpan.h"
+#include "Utils/BufferView.h"
+
 #pragma managed(push, off)
 
 #ifndef _LPCBYTE_DEFINED
@@ -27,15 +30,57 @@ class CBinaryBuffer
 {
     friend class MemoryStream;
 
+public:
+    // Heap buffers up to this size (digests up to SHA256, small headers) are stored inline, without allocation
+    static constexpr size_t kInlineCapacity = 32;
+
 private:
     BYTE* m_pData;
     size_t m_size;
+    size_t m_capacity;  // Allocated size when owning the memory
     bool m_bOwnMemory;
     bool m_bJunk;
-    bool m_bVirtualAlloc;
+    bool m_bVirtualAlloc;  // Page aligned memory, allocated from BufferPool
+    bool m_bPooled;
+    bool m_bInline;  // m_pData points to m_inline
+
+    // Aligned as heap allocations are, for Get<T>
+    alignas(MEMORY_ALLOCATION_ALIGNMENT) BYTE m_inline[kInlineCapacity];
 
     static HCRYPTPROV g_hProv;
 
+    // Take over the content of 'other', which is left empty if it owned its memory
+    void MoveFrom(CBinaryBuffer& other) noexcept
+    {
+        m_pData = other.m_pData;
+        m_size = other.m_size;
+        m_capacity = other.m_capacity;
+        m_bOwnMemory = other.m_bOwnMemory;
+        m_bJunk = other.m_bJunk;
+        m_bVirtualAlloc = other.m_bVirtualAlloc;
+        m_bPooled = other.m_bPooled;
+        m_bInline = other.m_bInline;
+
+        if (m_bInline)
+        {
+            CopyMemory(m_inline, other.m_inline, m_size);
+            m_pData = m_inline;
+        }
+
+        if (other.m_bOwnMemory)
+        {
+            // Release the data pointer from the source object so that
+            // the destructor does not free the memory multiple times.
+            other.m_pData = nullptr;
+            other.m_size = 0;
+            other.m_capacity = 0;
+            other.m_bPooled = false;
+            other.m_bInline = false;
+            other.m_bOwnMemory = true;
+            other.m_bJunk = true;
+        }
+    }
+
 public:
     using value_type = uint8_t;
 
@@ -43,19 +88,7 @@ public:
     {
         CBinaryBuffer newThis(other);
         RemoveAll();
-        m_pData = newThis.m_pData;
-        m_size = newThis.m_size;
-        m_bVirtualAlloc = newThis.m_bVirtualAlloc;
-        m_bOwnMemory = newThis.m_bOwnMemory;
-        m_bJunk = newThis.m_bJunk;
-
-        if (newThis.m_bOwnMemory)
-        {
-            newThis.m_pData = nullptr;
-            newThis.m_size = 0;
-            newThis.m_bOwnMemory = true;
-            newThis.m_bJunk = true;
-        }
+        MoveFrom(newThis);
         return *this;
     }
 
@@ -64,37 +97,25 @@ public:
     CBinaryBuffer(bool bVirtualAlloc = false)
         : m_pData(nullptr)
         , m_size(0L)
+        , m_capacity(0L)
         , m_bOwnMemory(true)
         , m_bJunk(true)
-        , m_bVirtualAlloc(bVirtualAlloc) {};
+        , m_bVirtualAlloc(bVirtualAlloc)
+        , m_bPooled(false)
+        , m_bInline(false) {};
 
     // Move constructor.
-    CBinaryBuffer(CBinaryBuffer&& other) noexcept
-        : m_pData(other.m_pData)
-        , m_size(other.m_size)
-        , m_bOwnMemory(other.m_bOwnMemory)
-        , m_bJunk(other.m_bJunk)
-        , m_bVirtualAlloc(other.m_bVirtualAlloc)
-    {
-        // Copy the data pointer and its length from the
-        // source object.
-        if (other.m_bOwnMemory)
-        {
-            // Release the data pointer from the source object so that
-            // the destructor does not free the memory multiple times.
-            other.m_pData = nullptr;
-            other.m_size = 0;
-            other.m_bOwnMemory = true;
-            other.m_bJunk = true;
-        }
-    }
+    CBinaryBuffer(CBinaryBuffer&& other) noexcept { MoveFrom(other); }
 
     CBinaryBuffer(LPBYTE pBuf, size_t dwSize)
         : m_pData(pBuf)
         , m_size(dwSize)
+        , m_capacity(dwSize)
         , m_bOwnMemory(false)
         , m_bJunk(false)
         , m_bVirtualAlloc(false)
+        , m_bPooled(false)
+        , m_bInline(false)
     {
     }
 
@@ -106,23 +127,7 @@ public:
             // Free the existing resource.
             RemoveAll();  // ! may throw because of GetBinaryBufferHeap()
 
-            // Copy the data pointer and its length from the
-            // source object.
-            m_pData = other.m_pData;
-            m_bVirtualAlloc = other.m_bVirtualAlloc;
-            m_size = other.m_size;
-            m_bOwnMemory = other.m_bOwnMemory;
-            m_bJunk = other.m_bJunk;
-
-            if (m_bOwnMemory)
-            {
-                // Release the data pointer from the source object so that
-                // the destructor does not free the memory multiple times.
-                other.m_pData = nullptr;
-                other.m_size = 0;
-                other.m_bOwnMemory = true;
-                other.m_bJunk = true;
-            }
+            MoveFrom(other);
         }
         return *this;
     }
@@ -138,9 +143,21 @@ public:
         return true;
     }
 
+    // Shrinking, or growing within the capacity, never reallocates an owned buffer
     bool SetCount(size_t NewSize);
+
+    // Allocate at least 'cbCapacity' bytes without changing the count so that following SetCount do not reallocate
+    bool Reserve(size_t cbCapacity);
+
+    // Reserve with large pages when available, for long-lived page aligned buffers that are not grown afterwards
+    bool ReserveLargePages(size_t cbCapacity);
+    size_t GetCapacity() const { return m_bOwnMemory ? m_capacity : m_size; }
     BYTE* GetData() const { return m_pData; }
 
+    // Container interface, so that a CBinaryBuffer converts to BufferView and BufferSpan at API boundaries
+    BYTE* data() const { return m_pData; }
+    size_t size() const { return GetCount(); }
+
     inline operator std::string_view() const
     {
         return std::string_view(reinterpret_cast<char*>(GetData()), GetCount());
@@ -288,7 +305,7 @@ public:
         return (T*)((BYTE*)m_pData + m_size);
     };
 
-    bool operator==(const CBinaryBuffer& other)
+    bool operator==(const CBinaryBuffer& other) const
     {
         if (GetCount() != other.GetCount())
             return false;
@@ -0,0 +1,536 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "Blake3Hash.h"
+
+#include "SimdDispatch.h"
+#include "TaskPool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_BLAKE3_SIMD
+#endif
+
+using namespace Orc;
+
+namespace {
+
+constexpr uint32_t kIv[8] =
+    {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+constexpr uint32_t kChunkStart = 1 << 0;
+constexpr uint32_t kChunkEnd = 1 << 1;
+constexpr uint32_t kParent = 1 << 2;
+constexpr uint32_t kRoot = 1 << 3;
+
+constexpr size_t kBlocksPerChunk = Blake3Hash::kChunkSize / Blake3Hash::kBlockSize;
+
+// Chunks hashed by one task of the TaskPool
+constexpr size_t kChunksPerTask = 64;
+
+// Message words used by each of the 7 rounds
+constexpr uint8_t kSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13}};
+
+// The rounds are written once for a single state (uint32_t) and for several states side by side (one per 32 bits
+// lane of a vector register)
+inline uint32_t Add(uint32_t a, uint32_t b)
+{
+    return a + b;
+}
+
+inline uint32_t Xor(uint32_t a, uint32_t b)
+{
+    return a ^ b;
+}
+
+template <int N>
+inline uint32_t Rotr(uint32_t x)
+{
+    return (x >> N) | (x << (32 - N));
+}
+
+#ifdef ORC_BLAKE3_SIMD
+
+inline __m128i Add(__m128i a, __m128i b)
+{
+    return _mm_add_epi32(a, b);
+}
+
+inline __m128i Xor(__m128i a, __m128i b)
+{
+    return _mm_xor_si128(a, b);
+}
+
+template <int N>
+inline __m128i Rotr(__m128i x)
+{
+    if constexpr (N == 16)
+        return _mm_shuffle_epi8(x, _mm_set_epi8(13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    else if constexpr (N == 8)
+        return _mm_shuffle_epi8(x, _mm_set_epi8(12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+    else
+        return _mm_or_si128(_mm_srli_epi32(x, N), _mm_slli_epi32(x, 32 - N));
+}
+
+inline __m256i Add(__m256i a, __m256i b)
+{
+    return _mm256_add_epi32(a, b);
+}
+
+inline __m256i Xor(__m256i a, __m256i b)
+{
+    return _mm256_xor_si256(a, b);
+}
+
+template <int N>
+inline __m256i Rotr(__m256i x)
+{
+    if constexpr (N == 16)
+        return _mm256_shuffle_epi8(
+            x,
+            _mm256_set_epi8(
+                13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2,
+                13, 12, 15, 14, 9, 8, 11, 10, 5, 4, 7, 6, 1, 0, 3, 2));
+    else if constexpr (N == 8)
+        return _mm256_shuffle_epi8(
+            x,
+            _mm256_set_epi8(
+                12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1,
+                12, 15, 14, 13, 8, 11, 10, 9, 4, 7, 6, 5, 0, 3, 2, 1));
+    else
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+}
+
+#endif  // ORC_BLAKE3_SIMD
+
+template <typename V>
+inline void G(V (&v)[16], size_t a, size_t b, size_t c, size_t d, const V& x, const V& y)
+{
+    v[a] = Add(Add(v[a], v[b]), x);
+    v[d] = Rotr<16>(Xor(v[d], v[a]));
+    v[c] = Add(v[c], v[d]);
+    v[b] = Rotr<12>(Xor(v[b], v[c]));
+    v[a] = Add(Add(v[a], v[b]), y);
+    v[d] = Rotr<8>(Xor(v[d], v[a]));
+    v[c] = Add(v[c], v[d]);
+    v[b] = Rotr<7>(Xor(v[b], v[c]));
+}
+
+template <typename V>
+inline void Rounds(V (&v)[16], const V (&m)[16])
+{
+    for (const auto& s : kSchedule)
+    {
+        G(v, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        G(v, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        G(v, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        G(v, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        G(v, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        G(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        G(v, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        G(v, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+}
+
+// 'out' may alias 'cv'
+void Compress(
+    const uint32_t (&cv)[8],
+    const uint32_t (&m)[16],
+    uint32_t cbBlock,
+    ULONGLONG ullCounter,
+    uint32_t flags,
+    uint32_t (&out)[8])
+{
+    uint32_t v[16] = {
+        cv[0],
+        cv[1],
+        cv[2],
+        cv[3],
+        cv[4],
+        cv[5],
+        cv[6],
+        cv[7],
+        kIv[0],
+        kIv[1],
+        kIv[2],
+        kIv[3],
+        static_cast<uint32_t>(ullCounter),
+        static_cast<uint32_t>(ullCounter >> 32),
+        cbBlock,
+        flags};
+
+    Rounds(v, m);
+
+    for (size_t i = 0; i < 8; i++)
+        out[i] = v[i] ^ v[i + 8];
+}
+
+// 'out' may alias 'left' or 'right'
+void Parent(const uint32_t (&left)[8], const uint32_t (&right)[8], uint32_t flags, uint32_t (&out)[8])
+{
+    uint32_t m[16];
+    std::copy(std::cbegin(left), std::cend(left), m);
+    std::copy(std::cbegin(right), std::cend(right), m + 8);
+    Compress(kIv, m, Blake3Hash::kBlockSize, 0LL, kParent | flags, out);
+}
+
+// Chaining values of 'dwChunks' whole chunks, the first one with number 'ullCounter'
+using HashChunksFn = void (*)(const BYTE* pChunks, size_t dwChunks, ULONGLONG ullCounter, uint32_t* pCvs);
+
+void HashChunksScalar(const BYTE* pChunks, size_t dwChunks, ULONGLONG ullCounter, uint32_t* pCvs)
+{
+    for (size_t i = 0; i < dwChunks; i++)
+    {
+        const auto pChunk = pChunks + i * Blake3Hash::kChunkSize;
+
+        uint32_t cv[8];
+        std::copy(std::cbegin(kIv), std::cend(kIv), cv);
+
+        for (size_t block = 0; block < kBlocksPerChunk; block++)
+        {
+            uint32_t m[16];
+            std::memcpy(m, pChunk + block * Blake3Hash::kBlockSize, sizeof(m));
+
+            const uint32_t flags = (block == 0 ? kChunkStart : 0) | (block == kBlocksPerChunk - 1 ? kChunkEnd : 0);
+            Compress(cv, m, Blake3Hash::kBlockSize, ullCounter + i, flags, cv);
+        }
+
+        std::copy(std::cbegin(cv), std::cend(cv), pCvs + i * 8);
+    }
+}
+
+#ifdef ORC_BLAKE3_SIMD
+
+// Rows of 4 words become columns: word i of each row ends up in r[i]
+inline void Transpose(__m128i (&r)[4])
+{
+    const auto t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    const auto t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    const auto t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    const auto t3 = _mm_unpackhi_epi32(r[2], r[3]);
+
+    r[0] = _mm_unpacklo_epi64(t0, t1);
+    r[1] = _mm_unpackhi_epi64(t0, t1);
+    r[2] = _mm_unpacklo_epi64(t2, t3);
+    r[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+inline void Transpose(__m256i (&r)[8])
+{
+    __m256i t[8];
+    for (size_t i = 0; i < 8; i += 2)
+    {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+
+    __m256i u[8];
+    for (size_t i = 0; i < 8; i += 4)
+    {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+
+    // Words 0 to 3 are in the low 128 bits of u[0] to u[3] (rows 0 to 3) and u[4] to u[7] (rows 4 to 7)
+    for (size_t i = 0; i < 4; i++)
+    {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+struct Sse41
+{
+    using V = __m128i;
+    static constexpr size_t kLanes = 4;
+
+    static V Set1(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+    static V Load(const BYTE* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void Store(uint32_t* p, V value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), value); }
+};
+
+struct Avx2
+{
+    using V = __m256i;
+    static constexpr size_t kLanes = 8;
+
+    static V Set1(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+    static V Load(const BYTE* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void Store(uint32_t* p, V value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), value); }
+};
+
+// Low or high halves of the counters of consecutive chunks, one per lane
+template <typename Simd>
+inline typename Simd::V Counters(ULONGLONG ullFirst, bool bHigh)
+{
+    uint32_t words[Simd::kLanes];
+    for (size_t i = 0; i < Simd::kLanes; i++)
+        words[i] = static_cast<uint32_t>((ullFirst + i) >> (bHigh ? 32 : 0));
+    return Simd::Load(reinterpret_cast<const BYTE*>(words));
+}
+
+// One chunk per lane: messages are loaded a row of words per chunk and transposed to a word of each chunk per vector
+template <typename Simd>
+void HashChunksLanes(const BYTE* pChunks, ULONGLONG ullCounter, uint32_t* pCvs)
+{
+    using V = typename Simd::V;
+    constexpr auto kLanes = Simd::kLanes;
+
+    V h[8];
+    for (size_t i = 0; i < 8; i++)
+        h[i] = Simd::Set1(kIv[i]);
+
+    const auto counterLow = Counters<Simd>(ullCounter, false);
+    const auto counterHigh = Counters<Simd>(ullCounter, true);
+
+    for (size_t block = 0; block < kBlocksPerChunk; block++)
+    {
+        V m[16];
+        for (size_t group = 0; group < 16; group += kLanes)
+        {
+            V rows[kLanes];
+            for (size_t lane = 0; lane < kLanes; lane++)
+            {
+                rows[lane] = Simd::Load(
+                    pChunks + lane * Blake3Hash::kChunkSize + block * Blake3Hash::kBlockSize
+                    + group * sizeof(uint32_t));
+            }
+
+            Transpose(rows);
+            std::copy(std::cbegin(rows), std::cend(rows), m + group);
+        }
+
+        const uint32_t flags = (block == 0 ? kChunkStart : 0) | (block == kBlocksPerChunk - 1 ? kChunkEnd : 0);
+        V v[16] = {
+            h[0],
+            h[1],
+            h[2],
+            h[3],
+            h[4],
+            h[5],
+            h[6],
+            h[7],
+            Simd::Set1(kIv[0]),
+            Simd::Set1(kIv[1]),
+            Simd::Set1(kIv[2]),
+            Simd::Set1(kIv[3]),
+            counterLow,
+            counterHigh,
+            Simd::Set1(Blake3Hash::kBlockSize),
+            Simd::Set1(flags)};
+
+        Rounds(v, m);
+
+        for (size_t i = 0; i < 8; i++)
+            h[i] = Xor(v[i], v[i + 8]);
+    }
+
+    // Back to one chaining value per chunk
+    for (size_t group = 0; group < 8; group += kLanes)
+    {
+        V rows[kLanes];
+        std::copy(h + group, h + group + kLanes, rows);
+        Transpose(rows);
+
+        for (size_t lane = 0; lane < kLanes; lane++)
+            Simd::Store(pCvs + lane * 8 + group, rows[lane]);
+    }
+}
+
+// Chunks left over by the lanes go to 'Remainder'
+template <typename Simd, HashChunksFn Remainder>
+void HashChunksSimd(const BYTE* pChunks, size_t dwChunks, ULONGLONG ullCounter, uint32_t* pCvs)
+{
+    for (; dwChunks >= Simd::kLanes; dwChunks -= Simd::kLanes)
+    {
+        HashChunksLanes<Simd>(pChunks, ullCounter, pCvs);
+
+        pChunks += Simd::kLanes * Blake3Hash::kChunkSize;
+        ullCounter += Simd::kLanes;
+        pCvs += Simd::kLanes * 8;
+    }
+
+    Remainder(pChunks, dwChunks, ullCounter, pCvs);
+}
+
+#endif  // ORC_BLAKE3_SIMD
+
+HashChunksFn Kernel()
+{
+    static const SimdDispatch::Kernel<HashChunksFn> kernel(
+        L"blake3",
+        {
+#ifdef ORC_BLAKE3_SIMD
+            {SimdDispatch::Level::AVX2, HashChunksSimd<Avx2, HashChunksSimd<Sse41, HashChunksScalar>>},
+            {SimdDispatch::Level::SSE41, HashChunksSimd<Sse41, HashChunksScalar>},
+#endif
+            {SimdDispatch::Level::Scalar, HashChunksScalar}});
+
+    return kernel.Get();
+}
+
+}  // namespace
+
+Blake3Hash::Blake3Hash()
+    : m_Block {0}
+{
+    std::copy(std::cbegin(kIv), std::cend(kIv), m_ChunkCv);
+}
+
+void Blake3Hash::Update(const BYTE* pData, size_t cbData)
+{
+    while (cbData > 0)
+    {
+        // A chunk is finished only once more input follows: the last one is compressed with the root flag
+        if (ChunkLength() == kChunkSize)
+            FinishChunk();
+
+        if (ChunkLength() == 0 && cbData > kChunkSize)
+        {
+            // Whole chunks are hashed straight from the caller's buffer, keeping at least one byte for the last chunk
+            const size_t dwChunks = (cbData - 1) / kChunkSize;
+            HashChunks(pData, dwChunks);
+
+            pData += dwChunks * kChunkSize;
+            cbData -= dwChunks * kChunkSize;
+            continue;
+        }
+
+        const auto cbChunk = std::min(kChunkSize - ChunkLength(), cbData);
+        UpdateChunk(pData, cbChunk);
+
+        pData += cbChunk;
+        cbData -= cbChunk;
+    }
+}
+
+void Blake3Hash::UpdateChunk(const BYTE* pData, size_t cbData)
+{
+    while (cbData > 0)
+    {
+        // Likewise, a block is compressed only once more input follows: the last one has the chunk end flag
+        if (m_cbBlock == kBlockSize)
+        {
+            uint32_t m[16];
+            std::memcpy(m, m_Block, sizeof(m));
+
+            const uint32_t flags = m_dwBlocksCompressed == 0 ? kChunkStart : 0;
+            Compress(m_ChunkCv, m, kBlockSize, m_ullChunkCounter, flags, m_ChunkCv);
+
+            m_dwBlocksCompressed++;
+            m_cbBlock = 0;
+        }
+
+        const auto cbBlock = std::min(kBlockSize - m_cbBlock, cbData);
+        std::memcpy(m_Block + m_cbBlock, pData, cbBlock);
+
+        m_cbBlock += cbBlock;
+        pData += cbBlock;
+        cbData -= cbBlock;
+    }
+}
+
+void Blake3Hash::FinishChunk()
+{
+    uint32_t m[16];
+    std::memcpy(m, m_Block, sizeof(m));
+
+    const uint32_t flags = kChunkEnd | (m_dwBlocksCompressed == 0 ? kChunkStart : 0);
+
+    uint32_t cv[8];
+    Compress(m_ChunkCv, m, kBlockSize, m_ullChunkCounter, flags, cv);
+    AddChunkCv(cv);
+
+    std::copy(std::cbegin(kIv), std::cend(kIv), m_ChunkCv);
+    m_cbBlock = 0;
+    m_dwBlocksCompressed = 0;
+}
+
+void Blake3Hash::HashChunks(const BYTE* pChunks, size_t dwChunks)
+{
+    const auto kernel = ::Kernel();
+
+    std::vector<uint32_t> cvs(dwChunks * 8);
+    const auto ullCounter = m_ullChunkCounter;
+
+    const auto dwTasks = (dwChunks + kChunksPerTask - 1) / kChunksPerTask;
+    const auto hashTask = [&](size_t task) {
+        const auto dwFirst = task * kChunksPerTask;
+        const auto dwCount = std::min(kChunksPerTask, dwChunks - dwFirst);
+        kernel(pChunks + dwFirst * kChunkSize, dwCount, ullCounter + dwFirst, cvs.data() + dwFirst * 8);
+    };
+
+    if (dwTasks > 1)
+        TaskPool::ParallelFor(TaskPool::Subsystem::Hash, size_t(0), dwTasks, hashTask);
+    else
+        hashTask(0);
+
+    for (size_t i = 0; i < dwChunks; i++)
+    {
+        uint32_t cv[8];
+        std::copy(cvs.data() + i * 8, cvs.data() + (i + 1) * 8, cv);
+        AddChunkCv(cv);
+    }
+}
+
+void Blake3Hash::AddChunkCv(const uint32_t (&cv)[8])
+{
+    uint32_t merged[8];
+    std::copy(std::cbegin(cv), std::cend(cv), merged);
+
+    // Each trailing zero bit of the chunk count completes a subtree: it is merged with the one on its left
+    auto ullChunks = ++m_ullChunkCounter;
+    for (; (ullChunks & 1) == 0; ullChunks >>= 1)
+    {
+        _ASSERT(m_dwCvStack > 0);
+        Parent(m_CvStack[--m_dwCvStack], merged, 0, merged);
+    }
+
+    _ASSERT(m_dwCvStack < kMaxDepth);
+    std::copy(std::cbegin(merged), std::cend(merged), m_CvStack[m_dwCvStack++]);
+}
+
+void Blake3Hash::Digest(BYTE* pDigest) const
+{
+    uint32_t m[16] = {0};
+    std::memcpy(m, m_Block, m_cbBlock);
+
+    const uint32_t flags = kChunkEnd | (m_dwBlocksCompressed == 0 ? kChunkStart : 0);
+    const auto cbBlock = static_cast<uint32_t>(m_cbBlock);
+
+    uint32_t out[8];
+    if (m_dwCvStack == 0)
+    {
+        Compress(m_ChunkCv, m, cbBlock, m_ullChunkCounter, flags | kRoot, out);
+    }
+    else
+    {
+        Compress(m_ChunkCv, m, cbBlock, m_ullChunkCounter, flags, out);
+
+        for (size_t i = m_dwCvStack; i-- > 0;)
+            Parent(m_CvStack[i], out, i == 0 ? kRoot : 0, out);
+    }
+
+    std::memcpy(pDigest, out, kDigestSize);
+}
@@ -0,0 +1,62 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include <cstdint>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// BLAKE3 (unkeyed, 256 bits digest). The input is split into 1KB chunks hashed independently and merged as a binary
+// tree: large updates hash several chunks at once with SSE4.1 or AVX2 and spread the batches over the Hash subsystem
+// of the TaskPool. The portable implementation is used on other processors.
+class Blake3Hash
+{
+public:
+    static constexpr size_t kBlockSize = 64;
+    static constexpr size_t kChunkSize = 1024;
+    static constexpr DWORD kDigestSize = 32;
+
+    Blake3Hash();
+
+    void Update(const BYTE* pData, size_t cbData);
+
+    // Digest of the data hashed so far: hashing can go on afterwards
+    void Digest(BYTE* pDigest) const;
+    DWORD DigestSize() const { return kDigestSize; }
+
+private:
+    // 2^54 chunks of 1KB cover 2^64 bytes
+    static constexpr size_t kMaxDepth = 54;
+
+    size_t ChunkLength() const { return m_dwBlocksCompressed * kBlockSize + m_cbBlock; }
+
+    void UpdateChunk(const BYTE* pData, size_t cbData);
+    void FinishChunk();
+    void HashChunks(const BYTE* pChunks, size_t dwChunks);
+    void AddChunkCv(const uint32_t (&cv)[8]);
+
+    // Chunk being hashed
+    uint32_t m_ChunkCv[8];
+    ULONGLONG m_ullChunkCounter = 0LL;
+    BYTE m_Block[kBlockSize];
+    size_t m_cbBlock = 0;
+    size_t m_dwBlocksCompressed = 0;
+
+    // Chaining values of the complete subtrees left of the current chunk, largest first
+    uint32_t m_CvStack[kMaxDepth][8];
+    size_t m_dwCvStack = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,104 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+/// <summary>
+///     A simple bounded FIFO queue to hand over items between plain threads.
+///     Push blocks while the queue is full, Pop blocks while it is empty. Once closed, Push fails and Pop drains
+///     the remaining items before returning std::nullopt.
+/// </summary>
+template <typename T>
+class BlockingQueue
+{
+public:
+    explicit BlockingQueue(size_t capacity)
+        : m_capacity(capacity ? capacity : 1)
+    {
+    }
+
+    BlockingQueue(const BlockingQueue&) = delete;
+    BlockingQueue& operator=(const BlockingQueue&) = delete;
+
+    bool Push(T&& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this]() { return m_bClosed || m_queue.size() < m_capacity; });
+
+        if (m_bClosed)
+            return false;
+
+        m_queue.push_back(std::move(item));
+        lock.unlock();
+
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    std::optional<T> Pop()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this]() { return m_bClosed || !m_queue.empty(); });
+
+        if (m_queue.empty())
+            return std::nullopt;
+
+        std::optional<T> item(std::move(m_queue.front()));
+        m_queue.pop_front();
+        lock.unlock();
+
+        m_notFull.notify_one();
+        return item;
+    }
+
+    void Close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_bClosed = true;
+        }
+
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    bool IsClosed() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bClosed;
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_queue.size();
+    }
+
+    size_t Capacity() const { return m_capacity; }
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    std::deque<T> m_queue;
+    const size_t m_capacity;
+    bool m_bClosed = false;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
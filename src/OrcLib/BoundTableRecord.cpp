@@ -11,6 +11,7 @@
 #include "BoundTableRecord.h"
 
 #include "WideAnsi.h"
+#include "Text/FastFormat.h"
 
 #include <safeint.h>
 
@@ -21,6 +22,30 @@ using namespace Orc::TableOutput;
 #    define DBMAXCHAR (8000 + 1)
 #endif
 
+namespace {
+
+// Format a value with a Text/FastFormat kernel into a stack buffer then write it to an UTF16 or UTF8 column
+template <size_t MaxLength, typename Kernel>
+HRESULT WriteFastFormat(BoundColumn& column, Kernel&& kernel)
+{
+    if (column.Type == ColumnType::UTF8Type)
+    {
+        CHAR szBuffer[MaxLength];
+        const auto end = kernel(szBuffer);
+        if (end == nullptr)
+            return E_INVALIDARG;
+        return column.WriteString(std::string_view(szBuffer, end - szBuffer));
+    }
+
+    WCHAR szBuffer[MaxLength];
+    const auto end = kernel(szBuffer);
+    if (end == nullptr)
+        return E_INVALIDARG;
+    return column.WriteString(std::wstring_view(szBuffer, end - szBuffer));
+}
+
+}  // namespace
+
 HRESULT BoundColumn::ClearBoundData()
 {
     switch (Type)
@@ -422,42 +447,13 @@ HRESULT BoundColumn::WriteFileTime(FILETIME fileTime)
             if (FAILED(hr = FileTimeToDBTime(fileTime, boundData.TimeStamp)))
                 return hr;
             break;
-        case ColumnType::UTF16Type: {
-            // Convert the Create time to System time.
-            SYSTEMTIME stUTC;
-            FileTimeToSystemTime(&fileTime, &stUTC);
-
-            if (FAILED(
-                    hr = PrintToBuffer(
-                        L"%u-%02u-%02u %02u:%02u:%02u.%03u%s",
-                        stUTC.wYear,
-                        stUTC.wMonth,
-                        stUTC.wDay,
-                        stUTC.wHour,
-                        stUTC.wMinute,
-                        stUTC.wSecond,
-                        stUTC.wMilliseconds)))
-                return hr;
-        }
-        break;
-        case ColumnType::UTF8Type: {
-            // Convert the Create time to System time.
-            SYSTEMTIME stUTC;
-            FileTimeToSystemTime(&fileTime, &stUTC);
-
+        case ColumnType::UTF16Type:
+        case ColumnType::UTF8Type:
             if (FAILED(
-                    hr = PrintToBuffer(
-                        "%u-%02u-%02u %02u:%02u:%02u.%03u%s",
-                        stUTC.wYear,
-                        stUTC.wMonth,
-                        stUTC.wDay,
-                        stUTC.wHour,
-                        stUTC.wMinute,
-                        stUTC.wSecond,
-                        stUTC.wMilliseconds)))
+                    hr = WriteFastFormat<Text::kMaxFileTimeLength>(
+                        *this, [&fileTime](auto out) { return Text::FormatFileTime(fileTime, out); })))
                 return hr;
-        }
-        break;
+            break;
         case ColumnType::FixedBinaryType:
             if (sizeof(FILETIME) > dwLen)
                 return E_NOT_SUFFICIENT_BUFFER;
@@ -493,42 +489,13 @@ HRESULT BoundColumn::WriteFileTime(LONGLONG fileTime)
             if (FAILED(hr = FileTimeToDBTime(ft, boundData.TimeStamp)))
                 return hr;
             break;
-        case ColumnType::UTF16Type: {
-            // Convert the Create time to System time.
-            SYSTEMTIME stUTC;
-            FileTimeToSystemTime(&ft, &stUTC);
-
-            if (FAILED(
-                    hr = PrintToBuffer(
-                        L"%u-%02u-%02u %02u:%02u:%02u.%03u%s",
-                        stUTC.wYear,
-                        stUTC.wMonth,
-                        stUTC.wDay,
-                        stUTC.wHour,
-                        stUTC.wMinute,
-                        stUTC.wSecond,
-                        stUTC.wMilliseconds)))
-                return hr;
-        }
-        break;
-        case ColumnType::UTF8Type: {
-            // Convert the Create time to System time.
-            SYSTEMTIME stUTC;
-            FileTimeToSystemTime(&ft, &stUTC);
-
+        case ColumnType::UTF16Type:
+        case ColumnType::UTF8Type:
             if (FAILED(
-                    hr = PrintToBuffer(
-                        "%u-%02u-%02u %02u:%02u:%02u.%03u%s",
-                        stUTC.wYear,
-                        stUTC.wMonth,
-                        stUTC.wDay,
-                        stUTC.wHour,
-                        stUTC.wMinute,
-                        stUTC.wSecond,
-                        stUTC.wMilliseconds)))
+                    hr = WriteFastFormat<Text::kMaxFileTimeLength>(
+                        *this, [&ft](auto out) { return Text::FormatFileTime(ft, out); })))
                 return hr;
-        }
-        break;
+            break;
         case ColumnType::FixedBinaryType:
             if (sizeof(FILETIME) > dwLen)
                 return E_NOT_SUFFICIENT_BUFFER;
@@ -695,13 +662,13 @@ HRESULT BoundColumn::WriteInteger(DWORD dwInteger)
         }
         break;
         case ColumnType::UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"%d", dwInteger)))
-                return hr;
-            return hr;
         case ColumnType::UTF8Type:
-            if (FAILED(hr = PrintToBuffer("%d", dwInteger)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxDecimalLength>(*this, [dwInteger](auto out) {
+                        return Text::FormatDecimal(static_cast<uint64_t>(dwInteger), out);
+                    })))
                 return hr;
-            return hr;
+            break;
         case ColumnType::BinaryType:
             if (sizeof(DWORD) > dwLen)
                 return E_NOT_SUFFICIENT_BUFFER;
@@ -737,11 +704,11 @@ HRESULT BoundColumn::WriteInteger(LONGLONG dw64Integer)
             boundData.LargeInt = dw64Integer;
             break;
         case ColumnType::UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"%I64d", dw64Integer)))
-                return hr;
-            break;
         case ColumnType::UTF8Type:
-            if (FAILED(hr = PrintToBuffer("%I64d", dw64Integer)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxDecimalLength>(*this, [dw64Integer](auto out) {
+                        return Text::FormatDecimal(static_cast<int64_t>(dw64Integer), out);
+                    })))
                 return hr;
             break;
         case ColumnType::BinaryType:
@@ -779,13 +746,13 @@ HRESULT BoundColumn::WriteInteger(ULONGLONG dw64Integer)
             boundData.LargeInt = SafeInt<_int64>(dw64Integer);
             break;
         case ColumnType::UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"%I64d", dw64Integer)))
-                return hr;
-            return hr;
         case ColumnType::UTF8Type:
-            if (FAILED(hr = PrintToBuffer("%I64d", dw64Integer)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxDecimalLength>(*this, [dw64Integer](auto out) {
+                        return Text::FormatDecimal(static_cast<uint64_t>(dw64Integer), out);
+                    })))
                 return hr;
-            return hr;
+            break;
         case ColumnType::FixedBinaryType:
             if (sizeof(ULONGLONG) > dwLen)
                 return E_NOT_SUFFICIENT_BUFFER;
@@ -813,11 +780,11 @@ HRESULT BoundColumn::WriteIntegerInHex(DWORD dwInteger)
     switch (Type)
     {
         case ColumnType::UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"0x%lX", dwInteger)))
-                return hr;
-            break;
         case ColumnType::UTF8Type:
-            if (FAILED(hr = PrintToBuffer("0x%lX", dwInteger)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxHexIntegerLength + 2>(*this, [dwInteger](auto out) {
+                        return Text::FormatHexInteger(static_cast<uint64_t>(dwInteger), out, true);
+                    })))
                 return hr;
             break;
         case ColumnType::UInt32Type:
@@ -851,11 +818,11 @@ HRESULT BoundColumn::WriteIntegerInHex(DWORDLONG dwlInteger)
     switch (Type)
     {
         case UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"0x%lX", dwlInteger)))
-                return hr;
-            break;
         case UTF8Type:
-            if (FAILED(hr = PrintToBuffer("0x%lX", dwlInteger)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxHexIntegerLength + 2>(*this, [dwlInteger](auto out) {
+                        return Text::FormatHexInteger(static_cast<uint64_t>(dwlInteger), out, true);
+                    })))
                 return hr;
             break;
         case UInt64Type:
@@ -890,11 +857,11 @@ HRESULT BoundColumn::WriteIntegerInHex(LONGLONG dwlInteger)
     switch (Type)
     {
         case UTF16Type:
-            if (FAILED(hr = PrintToBuffer(L"0x%lX", dwlInteger)))
-                return hr;
-            break;
         case UTF8Type:
-            if (FAILED(hr = PrintToBuffer("0x%lX", dwlInteger)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kMaxHexIntegerLength + 2>(*this, [dwlInteger](auto out) {
+                        return Text::FormatHexInteger(static_cast<uint64_t>(dwlInteger), out, true);
+                    })))
                 return hr;
             break;
         case UInt64Type:
@@ -940,37 +907,19 @@ HRESULT BoundColumn::WriteBytesInHex(const BYTE pBytes[], DWORD dwBytesLen)
             memcpy_s(boundData.Binary->Data, dwMaxLen.value_or(DBMAXCHAR), pBytes, dwBytesLen);
             break;
         case UTF16Type: {
-            LPWSTR pCur = boundData.WString->Data;
-            size_t dwBytesLeft = dwMaxLen.value() * sizeof(WCHAR);  // StringCbPrintfExW counts bytes
-
-            if (dwBytesLeft < (dwBytesLen * 2 * sizeof(WCHAR)))
+            if (dwMaxLen.value() < dwBytesLen * 2)
                 return E_NOT_SUFFICIENT_BUFFER;
 
-            for (DWORD i = 0; i < dwLen; i++)
-            {
-                if (FAILED(
-                        hr = StringCbPrintfExW(
-                            pCur, dwBytesLeft, &pCur, &dwBytesLeft, STRSAFE_IGNORE_NULLS, L"%2.2X", pBytes[i])))
-                    return hr;
-            }
-            boundData.WString->iIndicator = (dwMaxLen.value() * sizeof(WCHAR)) - dwBytesLeft;
+            const auto pEnd = Text::FormatHexBytes(pBytes, dwBytesLen, boundData.WString->Data);
+            boundData.WString->iIndicator = (pEnd - boundData.WString->Data) * sizeof(WCHAR);
         }
         break;
         case UTF8Type: {
-            LPSTR pCur = boundData.AString->Data;
-            size_t dwBytesLeft = dwMaxLen.value() * sizeof(CHAR);  // StringCbPrintfExW counts bytes
-
-            if (dwBytesLeft < (dwBytesLen * 2 * sizeof(CHAR)))
+            if (dwMaxLen.value() < dwBytesLen * 2)
                 return E_NOT_SUFFICIENT_BUFFER;
 
-            for (DWORD i = 0; i < dwBytesLen; i++)
-            {
-                if (FAILED(
-                        hr = StringCbPrintfExA(
-                            pCur, dwBytesLeft, &pCur, &dwBytesLeft, STRSAFE_IGNORE_NULLS, "%2.2X", pBytes[i])))
-                    return hr;
-            }
-            boundData.AString->iIndicator = (dwMaxLen.value() * sizeof(CHAR)) - dwBytesLeft;
+            const auto pEnd = Text::FormatHexBytes(pBytes, dwBytesLen, boundData.AString->Data);
+            boundData.AString->iIndicator = (pEnd - boundData.AString->Data) * sizeof(CHAR);
         }
         break;
         case Nothing:
@@ -1295,20 +1244,14 @@ HRESULT BoundColumn::WriteExactFlags(DWORD dwFlags, const FlagsDefinition FlagVa
 HRESULT BoundColumn::WriteGUID(const GUID& guid)
 {
     HRESULT hr = E_FAIL;
-    WCHAR szCLSID[MAX_GUID_STRLEN];
 
     switch (Type)
     {
         case UTF16Type:
-            if (!StringFromGUID2(guid, szCLSID, MAX_GUID_STRLEN))
-                return E_NOT_SUFFICIENT_BUFFER;
-            if (FAILED(hr = PrintToBuffer(L"%s", szCLSID)))
-                return hr;
-            break;
         case UTF8Type:
-            if (!StringFromGUID2(guid, szCLSID, MAX_GUID_STRLEN))
-                return E_NOT_SUFFICIENT_BUFFER;
-            if (FAILED(hr = PrintToBuffer(L"%S", szCLSID)))
+            if (FAILED(
+                    hr = WriteFastFormat<Text::kGuidLength>(
+                        *this, [&guid](auto out) { return Text::FormatGuid(guid, out); })))
                 return hr;
             break;
         case FixedBinaryType:
@@ -0,0 +1,54 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BoundedMessageBuffer.h"
+
+#include <atomic>
+
+#include "Text/Fmt/ByteQuantity.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+std::atomic<ULONGLONG> g_ullDefaultMessages = MessageBufferCapacity::kDefaultMessages;
+std::atomic<ULONGLONG> g_ullDefaultBytes = MessageBufferCapacity::kDefaultBytes;
+
+}  // namespace
+
+MessageBufferCapacity MessageBufferCapacity::GetDefault()
+{
+    MessageBufferCapacity capacity;
+    capacity.Messages = g_ullDefaultMessages;
+    capacity.Bytes = g_ullDefaultBytes;
+    return capacity;
+}
+
+void MessageBufferCapacity::SetDefault(const MessageBufferCapacity& capacity)
+{
+    g_ullDefaultMessages = capacity.Messages;
+    g_ullDefaultBytes = capacity.Bytes;
+}
+
+void MessageBufferStatistics::LogStatistics(std::wstring_view owner) const
+{
+    if (Messages == 0)
+        return;
+
+    Log::Debug(
+        L"{} message buffer: {} messages, queue depth peaked at {} messages ({}), producers waited {} times ({}ms)",
+        owner,
+        Messages,
+        PeakMessages,
+        Traits::ByteQuantity(PeakBytes),
+        Waits,
+        WaitTime.count());
+}
@@ -0,0 +1,188 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string_view>
+
+#include <agents.h>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// MessageBufferCapacity: messages, and bytes of their payload, a message buffer between agents holds before its
+// producers have to wait. 0 is unlimited.
+//
+struct MessageBufferCapacity
+{
+    static constexpr ULONGLONG kDefaultMessages = 1024LL;
+    static constexpr ULONGLONG kDefaultBytes = 1024LL * 1024LL * 1024LL;
+
+    ULONGLONG Messages = kDefaultMessages;
+    ULONGLONG Bytes = kDefaultBytes;
+
+    // Capacity of the buffers which were not given their own. It is read as messages are sent: it can be configured
+    // after the buffers are made (e.g. from the command line, once the configuration file made the archive buffers)
+    static MessageBufferCapacity GetDefault();
+    static void SetDefault(const MessageBufferCapacity& capacity);
+};
+
+struct MessageBufferStatistics
+{
+    ULONGLONG Messages = 0LL;
+    ULONGLONG PeakMessages = 0LL;
+    ULONGLONG PeakBytes = 0LL;
+    ULONGLONG Waits = 0LL;
+    std::chrono::milliseconds WaitTime = std::chrono::milliseconds(0);
+
+    void LogStatistics(std::wstring_view owner) const;
+};
+
+//
+// BoundedMessageBuffer: an unbounded_buffer whose producers wait in 'Concurrency::send' or 'Concurrency::asend' while
+// the buffer is at capacity, until its agent received enough messages. Memory held by messages waiting for a slow
+// agent (e.g. outputs waiting for the compression of the previous ones) is then capped instead of growing with the
+// production rate.
+//
+// A message is always accepted by an empty buffer, whatever its size. Buffers should only be fed by producers which
+// may block: the agent consuming a buffer must never send to it.
+//
+template <typename T>
+class BoundedMessageBuffer : public Concurrency::unbounded_buffer<T>
+{
+public:
+    // Bytes held by a message, usually the size of its stream
+    using Weigh = std::function<ULONGLONG(const T& payload)>;
+
+    BoundedMessageBuffer(Weigh weigh = nullptr)
+        : m_weigh(std::move(weigh))
+    {
+    }
+
+    void SetCapacity(const MessageBufferCapacity& capacity)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_capacity = capacity;
+        m_notFull.notify_all();
+    }
+
+    MessageBufferStatistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_statistics;
+    }
+
+protected:
+    Concurrency::message_status
+    propagate_message(Concurrency::message<T>* pMessage, Concurrency::ISource<T>* pSource) override
+    {
+        Admit(pMessage->payload);
+
+        auto status = Concurrency::unbounded_buffer<T>::propagate_message(pMessage, pSource);
+        if (status != Concurrency::accepted)
+            Release(pMessage->payload);
+
+        return status;
+    }
+
+    Concurrency::message_status
+    send_message(Concurrency::message<T>* pMessage, Concurrency::ISource<T>* pSource) override
+    {
+        Admit(pMessage->payload);
+
+        auto status = Concurrency::unbounded_buffer<T>::send_message(pMessage, pSource);
+        if (status != Concurrency::accepted)
+            Release(pMessage->payload);
+
+        return status;
+    }
+
+    // Both 'receive' and linked targets take messages out through here ('consume_message' calls it as well)
+    Concurrency::message<T>* accept_message(Concurrency::runtime_object_identity msgId) override
+    {
+        auto pMessage = Concurrency::unbounded_buffer<T>::accept_message(msgId);
+        if (pMessage != nullptr)
+            Release(pMessage->payload);
+
+        return pMessage;
+    }
+
+private:
+    bool IsFull(ULONGLONG ullBytes) const
+    {
+        if (m_ullMessages == 0)
+            return false;
+
+        const auto capacity = m_capacity.value_or(MessageBufferCapacity::GetDefault());
+        if (capacity.Messages && m_ullMessages >= capacity.Messages)
+            return true;
+        if (capacity.Bytes && m_ullBytes + ullBytes > capacity.Bytes)
+            return true;
+
+        return false;
+    }
+
+    void Admit(const T& payload)
+    {
+        const auto ullBytes = m_weigh ? m_weigh(payload) : 0LL;
+
+        std::unique_lock<std::mutex> lock(m_lock);
+
+        if (IsFull(ullBytes))
+        {
+            const auto start = std::chrono::steady_clock::now();
+            m_notFull.wait(lock, [this, ullBytes]() { return !IsFull(ullBytes); });
+
+            m_statistics.Waits++;
+            m_statistics.WaitTime +=
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        }
+
+        m_ullMessages++;
+        m_ullBytes += ullBytes;
+
+        m_statistics.Messages++;
+        m_statistics.PeakMessages = std::max(m_statistics.PeakMessages, m_ullMessages);
+        m_statistics.PeakBytes = std::max(m_statistics.PeakBytes, m_ullBytes);
+    }
+
+    void Release(const T& payload)
+    {
+        // The payload is weighed again: a stream which grew since it was sent must not underflow the byte count
+        const auto ullBytes = m_weigh ? m_weigh(payload) : 0LL;
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_ullMessages > 0)
+            m_ullMessages--;
+        m_ullBytes -= std::min(m_ullBytes, ullBytes);
+
+        m_notFull.notify_all();
+    }
+
+    Weigh m_weigh;
+    std::optional<MessageBufferCapacity> m_capacity;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_notFull;
+    ULONGLONG m_ullMessages = 0LL;
+    ULONGLONG m_ullBytes = 0LL;
+    MessageBufferStatistics m_statistics;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
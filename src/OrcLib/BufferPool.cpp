@@ -0,0 +1,157 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BufferPool.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+BufferPool& BufferPool::Instance()
+{
+    // Never destroyed: buffers with static storage duration may be released after it would have been
+    static BufferPool* pool = new BufferPool();
+    return *pool;
+}
+
+size_t BufferPool::ClassIndex(size_t cbSize)
+{
+    size_t index = 0;
+    size_t cbBlock = kMinBlockSize;
+    while (cbBlock < cbSize)
+    {
+        cbBlock <<= 1;
+        index++;
+    }
+
+    return index;
+}
+
+size_t BufferPool::BlockSize(size_t cbSize)
+{
+    if (cbSize > kMaxBlockSize)
+    {
+        // Oversized blocks are only rounded to the page size
+        return ((cbSize + kMinBlockSize - 1) / kMinBlockSize) * kMinBlockSize;
+    }
+
+    return kMinBlockSize << ClassIndex(cbSize);
+}
+
+BYTE* BufferPool::Allocate(size_t cbSize)
+{
+    const auto cbBlock = BlockSize(cbSize);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_statistics.Allocations++;
+        m_statistics.InUseBytes += cbBlock;
+        m_statistics.PeakInUseBytes = std::max(m_statistics.PeakInUseBytes, m_statistics.InUseBytes);
+
+        if (cbBlock > kMaxBlockSize)
+        {
+            m_statistics.Oversized++;
+        }
+        else
+        {
+            auto& freeBlocks = m_freeBlocks[ClassIndex(cbBlock)];
+            if (!freeBlocks.empty())
+            {
+                auto pBlock = freeBlocks.back();
+                freeBlocks.pop_back();
+
+                m_statistics.Hits++;
+                m_statistics.CachedBytes -= cbBlock;
+                return pBlock;
+            }
+        }
+
+        m_statistics.SystemAllocations++;
+    }
+
+    auto pBlock = static_cast<BYTE*>(VirtualAlloc(NULL, cbBlock, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (pBlock == nullptr)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_statistics.InUseBytes -= cbBlock;
+    }
+
+    return pBlock;
+}
+
+void BufferPool::Free(BYTE* pBlock, size_t cbSize)
+{
+    if (pBlock == nullptr)
+        return;
+
+    const auto cbBlock = BlockSize(cbSize);
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        m_statistics.Releases++;
+        m_statistics.InUseBytes -= cbBlock;
+
+        if (cbBlock <= kMaxBlockSize && m_statistics.CachedBytes + cbBlock <= kMaxCachedBytes)
+        {
+            m_freeBlocks[ClassIndex(cbBlock)].push_back(pBlock);
+            m_statistics.CachedBytes += cbBlock;
+            return;
+        }
+
+        m_statistics.SystemReleases++;
+    }
+
+    VirtualFree(pBlock, 0L, MEM_RELEASE);
+}
+
+void BufferPool::Trim()
+{
+    std::array<std::vector<BYTE*>, kClassCount> freeBlocks;
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        std::swap(freeBlocks, m_freeBlocks);
+
+        for (const auto& blocks : freeBlocks)
+            m_statistics.SystemReleases += blocks.size();
+
+        m_statistics.CachedBytes = 0LL;
+    }
+
+    for (const auto& blocks : freeBlocks)
+    {
+        for (auto pBlock : blocks)
+            VirtualFree(pBlock, 0L, MEM_RELEASE);
+    }
+}
+
+BufferPool::Statistics BufferPool::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_statistics;
+}
+
+void BufferPool::LogStatistics() const
+{
+    const auto statistics = GetStatistics();
+
+    Log::Debug(
+        "BufferPool: {} allocations, {} hits, {} system allocations ({} oversized), {} releases, {} system releases, "
+        "peak in use: {} bytes, cached: {} bytes",
+        statistics.Allocations,
+        statistics.Hits,
+        statistics.SystemAllocations,
+        statistics.Oversized,
+        statistics.Releases,
+        statistics.SystemReleases,
+        statistics.PeakInUseBytes,
+        statistics.CachedBytes);
+}
@@ -0,0 +1,80 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <mutex>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// BufferPool: process wide cache of page aligned blocks (thus aligned on any sector size) used by CBinaryBuffer when
+// created with 'bVirtualAlloc', as volume readers do for their read buffers.
+//
+// Blocks are grouped in power of two size classes from kMinBlockSize to kMaxBlockSize. Released blocks are kept for
+// reuse, up to kMaxCachedBytes, so that walking a volume does not allocate once the pool is warm. Larger requests are
+// directly allocated and released.
+//
+class BufferPool
+{
+public:
+    static constexpr size_t kMinBlockSize = 4096;
+    static constexpr size_t kMaxBlockSize = 16 * 1024 * 1024;
+    static constexpr size_t kMaxCachedBytes = 128 * 1024 * 1024;
+
+    struct Statistics
+    {
+        ULONGLONG Allocations = 0LL;  // Blocks requested
+        ULONGLONG Hits = 0LL;  // Requests served from a cached block
+        ULONGLONG SystemAllocations = 0LL;  // Requests that needed a VirtualAlloc
+        ULONGLONG Oversized = 0LL;  // Requests larger than kMaxBlockSize
+        ULONGLONG Releases = 0LL;
+        ULONGLONG SystemReleases = 0LL;  // Released blocks freed with VirtualFree
+        ULONGLONG InUseBytes = 0LL;
+        ULONGLONG PeakInUseBytes = 0LL;
+        ULONGLONG CachedBytes = 0LL;
+    };
+
+    static BufferPool& Instance();
+
+    // Size of the block returned by Allocate for 'cbSize' bytes
+    static size_t BlockSize(size_t cbSize);
+
+    // Return a block of at least 'cbSize' bytes, its actual size is BlockSize(cbSize)
+    BYTE* Allocate(size_t cbSize);
+
+    // Return 'pBlock', obtained from Allocate(cbSize), to the pool
+    void Free(BYTE* pBlock, size_t cbSize);
+
+    // Release all cached blocks
+    void Trim();
+
+    Statistics GetStatistics() const;
+    void LogStatistics() const;
+
+private:
+    static constexpr size_t kClassCount = 13;  // 4 KiB to 16 MiB
+    static_assert((kMinBlockSize << (kClassCount - 1)) == kMaxBlockSize);
+
+    static size_t ClassIndex(size_t cbSize);
+
+    BufferPool() = default;
+
+    mutable std::mutex m_lock;
+    std::array<std::vector<BYTE*>, kClassCount> m_freeBlocks;
+    Statistics m_statistics;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -71,6 +71,9 @@ public:
 
     STDMETHOD(Close)() { return S_OK; }
 
+    // Data of the stream, valid until the next write or resize
+    const BYTE* GetData() const { return m_Buffer.get_raw(); }
+
 private:
     Buffer<BYTE, _DeclElts> m_Buffer;
     size_t m_dwCurrFilePointer = 0;
@@ -21,6 +21,12 @@
 #include "IStreamWrapper.h"
 #include "ISequentialStreamWrapper.h"
 
+#include "Utils/Guard.h"
+
+#include <array>
+
+#include <concrt.h>
+
 using namespace std;
 
 using namespace Orc;
@@ -73,6 +79,9 @@ HRESULT ByteStream::CopyTo(__in ByteStream& outStream, const ULONGLONG ullChunk,
         return hr;
 
     const auto maxReadSize = GetSize();
+    if (CanReadAsync() == S_OK)
+        return CopyToOverlapped(outStream, ullChunk, maxReadSize, pcbBytesWritten);
+
     while (qwBytesCopied < maxReadSize)
     {
         if (FAILED(hr = Read(buffer.GetData(), buffer.GetCount(), &ullBytesRead)))
@@ -101,6 +110,208 @@ HRESULT ByteStream::CopyTo(__in ByteStream& outStream, const ULONGLONG ullChunk,
     return S_OK;
 }
 
+HRESULT ByteStream::CopyToOverlapped(
+    ByteStream& outStream,
+    ULONGLONG ullChunk,
+    ULONGLONG ullSize,
+    PULONGLONG pcbBytesWritten)
+{
+    HRESULT hr = E_FAIL;
+
+    if (ullSize == 0LL)
+        return S_OK;
+
+    struct Slot
+    {
+        CBinaryBuffer Buffer {true};
+        concurrency::event Done;
+        bool bPending = false;
+        HRESULT hr = E_FAIL;
+        ULONGLONG cbRead = 0LL;
+    };
+
+    std::array<Slot, 2> slots;
+    for (auto& slot : slots)
+    {
+        if (!slot.Buffer.SetCount(static_cast<size_t>(ullChunk)))
+            return E_OUTOFMEMORY;
+    }
+
+    // A buffer is in use until its read completes
+    Guard::Scope onExit([&slots]() {
+        for (auto& slot : slots)
+        {
+            if (slot.bPending)
+                slot.Done.wait();
+        }
+    });
+
+    const auto issue = [this](Slot& slot) {
+        slot.Done.reset();
+        slot.bPending = true;
+        auto hr = ReadAsync(slot.Buffer.GetData(), slot.Buffer.GetCount(), [&slot](HRESULT hr, ULONGLONG cbRead) {
+            slot.hr = hr;
+            slot.cbRead = cbRead;
+            slot.Done.set();
+        });
+        if (FAILED(hr))
+            slot.bPending = false;
+        return hr;
+    };
+
+    if (FAILED(hr = issue(slots[0])))
+        return hr;
+
+    ULONGLONG ullIssued = ullChunk;
+    ULONGLONG ullCopied = 0LL;
+    for (size_t current = 0;; current = 1 - current)
+    {
+        auto& slot = slots[current];
+        slot.Done.wait();
+        slot.bPending = false;
+
+        if (FAILED(slot.hr))
+            return slot.hr;
+
+        if (slot.cbRead == 0LL)
+            break;
+
+        // A short read is the end of the stream
+        auto& next = slots[1 - current];
+        if (ullIssued < ullSize && slot.cbRead == ullChunk)
+        {
+            if (FAILED(hr = issue(next)))
+                return hr;
+            ullIssued += ullChunk;
+        }
+
+        const auto cbToWrite = std::min(slot.cbRead, ullSize - ullCopied);
+
+        ULONGLONG ullBytesWritten = 0LL;
+        if (FAILED(hr = outStream.Write(slot.Buffer.GetData(), cbToWrite, &ullBytesWritten)))
+            return hr;
+
+        _ASSERT(cbToWrite == ullBytesWritten);
+        ullCopied += cbToWrite;
+
+        if (pcbBytesWritten)
+            *pcbBytesWritten = ullCopied;
+
+        if (!next.bPending)
+            break;
+    }
+
+    return S_OK;
+}
+
+HRESULT ByteStream::ReadAsync_(PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    ULONGLONG cbRead = 0LL;
+    const auto hr = Read_(pBuffer, cbBytes, &cbRead);
+    completion(hr, cbRead);
+    return S_OK;
+}
+
+HRESULT ByteStream::WriteAsync_(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    ULONGLONG cbWritten = 0LL;
+    const auto hr = Write_(pBuffer, cbBytes, &cbWritten);
+    completion(hr, cbWritten);
+    return S_OK;
+}
+
+HRESULT ByteStream::ReadAsync(PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    if (!completion)
+        return E_INVALIDARG;
+
+    m_readCount++;
+
+    // Completions may run concurrently on other threads
+    return ReadAsync_(pBuffer, cbBytes, [this, completion = std::move(completion)](HRESULT hr, ULONGLONG cbRead) {
+        InterlockedExchangeAdd64(reinterpret_cast<volatile LONGLONG*>(&m_totalRead), static_cast<LONGLONG>(cbRead));
+        completion(hr, cbRead);
+    });
+}
+
+HRESULT ByteStream::WriteAsync(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    if (!completion)
+        return E_INVALIDARG;
+
+    m_writeCount++;
+
+    return WriteAsync_(pBuffer, cbBytes, [this, completion = std::move(completion)](HRESULT hr, ULONGLONG cbWritten) {
+        InterlockedExchangeAdd64(
+            reinterpret_cast<volatile LONGLONG*>(&m_totalWritten), static_cast<LONGLONG>(cbWritten));
+        completion(hr, cbWritten);
+    });
+}
+
+HRESULT ByteStream::ReadV_(gsl::span<const BufferSpan> buffers, PULONGLONG pcbBytesRead)
+{
+    HRESULT hr = S_OK;
+    ULONGLONG cbTotal = 0LL;
+
+    for (const auto& buffer : buffers)
+    {
+        ULONGLONG cbRead = 0LL;
+        if (FAILED(hr = Read_(buffer.data(), buffer.size(), &cbRead)))
+            break;
+
+        cbTotal += cbRead;
+        if (cbRead < buffer.size())
+            break;
+    }
+
+    *pcbBytesRead = cbTotal;
+    return hr;
+}
+
+HRESULT ByteStream::WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten)
+{
+    HRESULT hr = S_OK;
+    ULONGLONG cbTotal = 0LL;
+
+    for (const auto& buffer : buffers)
+    {
+        ULONGLONG cbWritten = 0LL;
+        if (FAILED(hr = Write_(const_cast<uint8_t*>(buffer.data()), buffer.size(), &cbWritten)))
+            break;
+
+        cbTotal += cbWritten;
+        if (cbWritten < buffer.size())
+            break;
+    }
+
+    *pcbBytesWritten = cbTotal;
+    return hr;
+}
+
+HRESULT ByteStream::ReadV(gsl::span<const BufferSpan> buffers, __out_opt PULONGLONG pcbBytesRead)
+{
+    ULONGLONG read = 0LL;
+    const auto hr = ReadV_(buffers, &read);
+    if (pcbBytesRead)
+        *pcbBytesRead = read;
+
+    m_readCount++;
+    m_totalRead += read;
+    return hr;
+}
+
+HRESULT ByteStream::WriteV(gsl::span<const BufferView> buffers, __out_opt PULONGLONG pcbBytesWritten)
+{
+    ULONGLONG written = 0LL;
+    const auto hr = WriteV_(buffers, &written);
+    if (pcbBytesWritten)
+        *pcbBytesWritten = written;
+
+    m_writeCount++;
+    m_totalWritten += written;
+    return hr;
+}
+
 std::shared_ptr<ByteStream> ByteStream::_GetHashStream()
 {
     return nullptr;
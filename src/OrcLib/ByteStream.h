@@ -10,7 +10,10 @@
 #include "OrcLib.h"
 
 #include "ByteStreamVisitor.h"
+#include "Utils/BufferSpan.h"
+#include "Utils/BufferView.h"
 
+#include <functional>
 #include <memory>
 
 #pragma managed(push, off)
@@ -41,6 +44,19 @@ protected:
     STDMETHOD(Write_)
     (__in_bcount(cbBytes) const PVOID pBuffer, __in ULONGLONG cbBytes, __out_opt PULONGLONG pcbBytesWritten) PURE;
 
+public:
+    // Result of an asynchronous read or write and the number of bytes transferred
+    using Completion = std::function<void(HRESULT hr, ULONGLONG cbTransferred)>;
+
+protected:
+    // Default adapter: the synchronous Read_ (Write_) is done by the caller, which then gets the completion
+    virtual HRESULT ReadAsync_(PVOID pBuffer, ULONGLONG cbBytes, Completion completion);
+    virtual HRESULT WriteAsync_(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion);
+
+    // Default: a Read_ (Write_) per buffer, a short one ends the operation
+    virtual HRESULT ReadV_(gsl::span<const BufferSpan> buffers, PULONGLONG pcbBytesRead);
+    virtual HRESULT WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten);
+
 public:
     ByteStream()
         : m_readCount(0)
@@ -76,6 +92,21 @@ public:
         return hr;
     }
 
+    // S_OK when ReadAsync does not block the caller until the data is read
+    STDMETHOD(CanReadAsync)() { return S_FALSE; }
+
+    // Read (write) 'cbBytes' at the current position, which moves past them before the operation completes: several
+    // operations may be outstanding. 'completion' is called once, from any thread, possibly before the call returns;
+    // the buffer and the stream must remain valid until then. Returns the error preventing to start the operation,
+    // 'completion' is then not called.
+    HRESULT ReadAsync(PVOID pBuffer, ULONGLONG cbBytes, Completion completion);
+    HRESULT WriteAsync(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion);
+
+    // Vectored read (write): 'buffers' are filled (written) in order by a single operation, streams forwarding data
+    // pass them along instead of gathering them into one buffer
+    HRESULT ReadV(gsl::span<const BufferSpan> buffers, __out_opt PULONGLONG pcbBytesRead);
+    HRESULT WriteV(gsl::span<const BufferView> buffers, __out_opt PULONGLONG pcbBytesWritten);
+
     uint64_t TotalRead() const { return m_totalRead; }
     uint64_t TotalWritten() const { return m_totalWritten; }
 
@@ -130,6 +161,9 @@ public:
     virtual HRESULT ShrinkContext() { return S_OK; }
 
 private:
+    // CopyTo for sources with asynchronous reads: the next chunk is read while the current one is written
+    HRESULT CopyToOverlapped(ByteStream& outStream, ULONGLONG ullChunk, ULONGLONG ullSize, PULONGLONG pcbBytesWritten);
+
     uint64_t m_readCount;
     uint64_t m_totalRead;
     uint64_t m_writeCount;
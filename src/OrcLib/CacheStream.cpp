@@ -155,8 +155,20 @@ CacheStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMoveMetho
         return hr;
     }
 
-    m_streamOffset = *pCurrPointer;
     m_offset = *pCurrPointer;
+    m_streamOffset = *pCurrPointer;
+
+    // Reads from inside the window are served from it up to its end, the stream resumes after it
+    if (m_offset >= m_cacheOffset && m_offset < m_cacheOffset + m_cacheUse)
+    {
+        m_streamOffset = m_cacheOffset + m_cacheUse;
+        hr = m_stream->SetFilePointer(m_streamOffset, FILE_BEGIN, nullptr);
+        if (FAILED(hr))
+        {
+            return hr;
+        }
+    }
+
     return S_OK;
 }
 
@@ -0,0 +1,25 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "CaseInsensitive.h"
+
+const std::array<wchar_t, 0x10000>& Orc::UpcaseTable()
+{
+    // Computed once for all the code units instead of calling into user32 for each character
+    static const auto table = [] {
+        std::array<wchar_t, 0x10000> upcase;
+        for (size_t i = 0; i < upcase.size(); i++)
+            upcase[i] = static_cast<wchar_t>(i);
+
+        CharUpperBuffW(upcase.data(), static_cast<DWORD>(upcase.size()));
+        return upcase;
+    }();
+
+    return table;
+}
@@ -8,6 +8,9 @@
 
 #pragma once
 
+#include <array>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <string_view>
@@ -17,6 +20,31 @@
 
 namespace Orc {
 
+// Upper case of every UTF-16 code unit, with the same rules as CharUpperBuffW
+const std::array<wchar_t, 0x10000>& UpcaseTable();
+
+inline wchar_t foldCaseInsensitive(wchar_t c)
+{
+    if (c < 0x80)
+        return c >= L'a' && c <= L'z' ? static_cast<wchar_t>(c - (L'a' - L'A')) : c;
+
+    return UpcaseTable()[c];
+}
+
+namespace Detail {
+
+// Four UTF-16 code units packed in 64 bits: set if any of them is not ASCII
+constexpr uint64_t kNonAsciiBlock = 0xFF80FF80FF80FF80LLU;
+
+// Upper case of four ASCII code units: 0x80 is set in the lanes holding 'a' to 'z' and becomes 0x20 once shifted
+inline uint64_t FoldAsciiBlock(uint64_t block)
+{
+    const auto lower = (block + 0x001F001F001F001FLLU) & ~(block + 0x0005000500050005LLU) & 0x0080008000800080LLU;
+    return block - (lower >> 2);
+}
+
+}  // namespace Detail
+
 inline bool lessCaseInsensitive(const std::wstring_view s1, const std::wstring_view s2)
 {
     return std::lexicographical_compare(
@@ -32,15 +60,28 @@ inline bool equalCaseInsensitive(const std::wstring_view s1, const std::wstring_
     if (s1.size() != s2.size())
         return false;
 
-    auto p1 = s1.begin();
-    auto p2 = s2.begin();
+    const auto size = s1.size();
+    size_t i = 0;
 
-    while (p1 != s1.end() && p2 != s2.end())
+    // Four characters at a time while both strings are ASCII, identical blocks need no folding
+    for (; i + 4 <= size; i += 4)
     {
-        if (tolower(*p1) != tolower(*p2))
+        uint64_t block1, block2;
+        std::memcpy(&block1, s1.data() + i, sizeof(block1));
+        std::memcpy(&block2, s2.data() + i, sizeof(block2));
+
+        if (block1 == block2)
+            continue;
+        if ((block1 | block2) & Detail::kNonAsciiBlock)
+            break;
+        if (Detail::FoldAsciiBlock(block1) != Detail::FoldAsciiBlock(block2))
+            return false;
+    }
+
+    for (; i < size; i++)
+    {
+        if (foldCaseInsensitive(s1[i]) != foldCaseInsensitive(s2[i]))
             return false;
-        ++p1;
-        ++p2;
     }
     return true;
 }
@@ -50,21 +91,7 @@ inline bool equalCaseInsensitive(const std::wstring_view s1, const std::wstring_
     if (s1.size() < cchCount || s2.size() < cchCount)
         return false;
 
-    auto p1 = s1.begin();
-    auto p2 = s2.begin();
-    size_t index = 0;
-
-    while (p1 != s1.end() && p2 != s2.end())
-    {
-        if (index == cchCount)
-            return true;
-        if (tolower(*p1) != tolower(*p2))
-            return false;
-        ++p1;
-        ++p2;
-        ++index;
-    }
-    return true;
+    return equalCaseInsensitive(s1.substr(0, cchCount), s2.substr(0, cchCount));
 }
 
 inline bool equalCaseInsensitive(std::string_view s1, std::string_view s2)
@@ -110,8 +137,8 @@ inline size_t hashCaseInsensitive(const std::wstring_view s)
 {
     ULONG hash = 0;
 
-    for (unsigned int i = 0; i < s.size(); i++)
-        hash = tolower(s[i]) + (hash << 6) + (hash << 16) - hash;
+    for (const auto c : s)
+        hash = foldCaseInsensitive(c) + (hash << 6) + (hash << 16) - hash;
     return hash;
 }
 
@@ -0,0 +1,185 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ChunkHashStream.h"
+
+#include "BinaryBuffer.h"
+#include "CryptoHashStream.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+// Normalized chunking: a boundary is harder to find before the average size than after it
+constexpr ULONGLONG kMaskBeforeAverage = ~0ULL << (64 - 18);
+constexpr ULONGLONG kMaskAfterAverage = ~0ULL << (64 - 14);
+
+// Random values for each byte of the gear hash: they must never change or chunk hashes would not match anymore
+const std::array<ULONGLONG, 256>& GearTable()
+{
+    static const auto table = []() {
+        std::array<ULONGLONG, 256> values;
+
+        // splitmix64
+        ULONGLONG state = 0x4F52432D43444331ULL;
+        for (auto& value : values)
+        {
+            state += 0x9E3779B97F4A7C15ULL;
+            ULONGLONG z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+
+        return values;
+    }();
+
+    return table;
+}
+
+}  // namespace
+
+ChunkHashStream::ChunkHashStream()
+    : HashStream()
+    , m_chunkHash(std::make_shared<CryptoHashStream>())
+{
+}
+
+ChunkHashStream::~ChunkHashStream() {}
+
+HRESULT ChunkHashStream::OpenToRead(const std::shared_ptr<ByteStream>& pChainedStream)
+{
+    if (pChainedStream == nullptr)
+        return E_POINTER;
+
+    if (pChainedStream->IsOpen() != S_OK)
+    {
+        Log::Error(L"Chained stream to ChunkHashStream must be opened");
+        return E_FAIL;
+    }
+
+    m_pChainedStream = pChainedStream;
+    return ResetHash(true);
+}
+
+HRESULT ChunkHashStream::OpenToWrite(const std::shared_ptr<ByteStream>& pChainedStream)
+{
+    if (pChainedStream != nullptr && pChainedStream->IsOpen() != S_OK)
+    {
+        Log::Error(L"Chained stream to ChunkHashStream must be opened if provided");
+        return E_FAIL;
+    }
+
+    m_bWriteOnly = true;
+    m_pChainedStream = pChainedStream;
+    return ResetHash(true);
+}
+
+HRESULT ChunkHashStream::ResetHash(bool bContinue)
+{
+    m_chunks.clear();
+    m_ullOffset = 0LL;
+    m_dwChunkLength = 0L;
+    m_ullFingerprint = 0LL;
+    m_bHashIsValid = false;
+
+    if (bContinue)
+    {
+        if (auto hr = m_chunkHash->OpenToWrite(CryptoHashStream::Algorithm::SHA256, nullptr); FAILED(hr))
+        {
+            Log::Error(L"Failed to initialize chunk hash [{}]", SystemError(hr));
+            return hr;
+        }
+
+        m_bHashIsValid = true;
+    }
+
+    return S_OK;
+}
+
+HRESULT ChunkHashStream::HashData(LPBYTE pBuffer, DWORD dwBytesToHash)
+{
+    const auto& gear = ::GearTable();
+
+    DWORD dwChunkStart = 0L;
+    DWORD dwIndex = 0L;
+    while (dwIndex < dwBytesToHash)
+    {
+        // The first bytes of a chunk cannot end it: they are not rolled
+        if (m_dwChunkLength < kMinChunkSize)
+        {
+            const auto dwSkipped = std::min(dwBytesToHash - dwIndex, kMinChunkSize - m_dwChunkLength);
+            m_dwChunkLength += dwSkipped;
+            dwIndex += dwSkipped;
+            continue;
+        }
+
+        m_ullFingerprint = (m_ullFingerprint << 1) + gear[pBuffer[dwIndex]];
+        m_dwChunkLength++;
+        dwIndex++;
+
+        const auto mask = m_dwChunkLength < kAverageChunkSize ? kMaskBeforeAverage : kMaskAfterAverage;
+        if ((m_ullFingerprint & mask) == 0 || m_dwChunkLength >= kMaxChunkSize)
+        {
+            ULONGLONG ullWritten = 0LL;
+            if (auto hr = m_chunkHash->Write(pBuffer + dwChunkStart, dwIndex - dwChunkStart, &ullWritten); FAILED(hr))
+                return hr;
+            if (auto hr = EndChunk(); FAILED(hr))
+                return hr;
+
+            dwChunkStart = dwIndex;
+        }
+    }
+
+    if (dwChunkStart < dwBytesToHash)
+    {
+        ULONGLONG ullWritten = 0LL;
+        if (auto hr = m_chunkHash->Write(pBuffer + dwChunkStart, dwBytesToHash - dwChunkStart, &ullWritten);
+            FAILED(hr))
+            return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT ChunkHashStream::EndChunk()
+{
+    CBinaryBuffer hash;
+    if (auto hr = m_chunkHash->GetSHA256(hash); FAILED(hr))
+        return hr;
+
+    Chunk chunk;
+    chunk.Offset = m_ullOffset;
+    chunk.Length = m_dwChunkLength;
+    std::copy_n(hash.GetData(), std::min(hash.GetCount(), chunk.SHA256.size()), std::begin(chunk.SHA256));
+    m_chunks.push_back(chunk);
+
+    m_ullOffset += m_dwChunkLength;
+    m_dwChunkLength = 0L;
+    m_ullFingerprint = 0LL;
+
+    return m_chunkHash->OpenToWrite(CryptoHashStream::Algorithm::SHA256, nullptr);
+}
+
+HRESULT ChunkHashStream::GetChunks(std::vector<Chunk>& chunks)
+{
+    if (!m_bHashIsValid)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    if (m_dwChunkLength > 0)
+    {
+        if (auto hr = EndChunk(); FAILED(hr))
+            return hr;
+    }
+
+    chunks = m_chunks;
+    return S_OK;
+}
@@ -0,0 +1,69 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "HashStream.h"
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class CryptoHashStream;
+
+//
+// ChunkHashStream: content defined chunks (FastCDC) of the data going through, with the SHA256 of each chunk.
+//
+// Boundaries are found with a gear rolling hash on the content only: the same binary collected on many hosts has the
+// same chunks, and bytes inserted or removed in a file only change the chunks around them. Chunks are between 16KB and
+// 256KB, 64KB on average with the normalized chunking masks.
+//
+class ChunkHashStream : public HashStream
+{
+public:
+    static constexpr DWORD kMinChunkSize = 16 * 1024;
+    static constexpr DWORD kAverageChunkSize = 64 * 1024;
+    static constexpr DWORD kMaxChunkSize = 256 * 1024;
+
+    struct Chunk
+    {
+        ULONGLONG Offset = 0LL;
+        DWORD Length = 0L;
+        std::array<BYTE, 32> SHA256 = {0};
+    };
+
+    ChunkHashStream();
+    virtual ~ChunkHashStream();
+
+    HRESULT OpenToRead(const std::shared_ptr<ByteStream>& pChainedStream);
+    HRESULT OpenToWrite(const std::shared_ptr<ByteStream>& pChainedStream);
+
+    // Chunks of the data hashed so far, the last one ends with the data
+    HRESULT GetChunks(std::vector<Chunk>& chunks);
+
+protected:
+    STDMETHOD(ResetHash)(bool bContinue = false);
+    STDMETHOD(HashData)(LPBYTE pBuffer, DWORD dwBytesToHash);
+
+private:
+    HRESULT EndChunk();
+
+    std::shared_ptr<CryptoHashStream> m_chunkHash;
+    std::vector<Chunk> m_chunks;
+    ULONGLONG m_ullOffset = 0LL;
+    DWORD m_dwChunkLength = 0L;
+    ULONGLONG m_ullFingerprint = 0LL;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,181 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ChunkRecipeStream.h"
+
+#include <fmt/format.h>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+ChunkRecipeStream::ChunkRecipeStream(
+    std::shared_ptr<ByteStream> source,
+    std::vector<ChunkHashStream::Chunk> chunks,
+    std::vector<bool> stored)
+    : ByteStream()
+    , m_source(std::move(source))
+    , m_chunks(std::move(chunks))
+    , m_stored(std::move(stored))
+    , m_discarded(true)
+{
+    m_stored.resize(m_chunks.size(), true);
+
+    ULONGLONG ullSize = 0LL;
+    for (const auto& chunk : m_chunks)
+        ullSize += chunk.Length;
+
+    fmt::format_to(std::back_inserter(m_header), "ORC-CDC,1,{},{}\r\n", ullSize, m_chunks.size());
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        const auto& chunk = m_chunks[i];
+        fmt::format_to(std::back_inserter(m_header), "{},{},", chunk.Offset, chunk.Length);
+        for (const auto byte : chunk.SHA256)
+            fmt::format_to(std::back_inserter(m_header), "{:02x}", byte);
+        fmt::format_to(std::back_inserter(m_header), ",{}\r\n", m_stored[i] ? 1 : 0);
+    }
+    m_header.append("\r\n");
+}
+
+ChunkRecipeStream::~ChunkRecipeStream() {}
+
+HRESULT ChunkRecipeStream::Read_(
+    __out_bcount_part(cbBytes, *pcbBytesRead) PVOID pReadBuffer,
+    __in ULONGLONG cbBytes,
+    __out_opt PULONGLONG pcbBytesRead)
+{
+    if (pcbBytesRead)
+        *pcbBytesRead = 0LL;
+
+    if (m_source == nullptr)
+        return E_POINTER;
+
+    const auto pBuffer = static_cast<BYTE*>(pReadBuffer);
+    ULONGLONG cbRead = 0LL;
+
+    if (m_ullPosition < m_header.size())
+    {
+        const auto cbHeader = std::min<ULONGLONG>(cbBytes, m_header.size() - m_ullPosition);
+        CopyMemory(pBuffer, m_header.data() + m_ullPosition, static_cast<size_t>(cbHeader));
+        cbRead += cbHeader;
+        m_ullPosition += cbHeader;
+    }
+
+    HRESULT hr = S_OK;
+    while (cbRead < cbBytes && m_chunk < m_chunks.size())
+    {
+        const auto& chunk = m_chunks[m_chunk];
+        const auto dwLeft = chunk.Length - m_dwChunkRead;
+
+        // Referenced chunks are read all the same, for the hash streams of the source
+        ULONGLONG ullSourceRead = 0LL;
+        if (m_stored[m_chunk])
+        {
+            hr = m_source->Read(pBuffer + cbRead, std::min<ULONGLONG>(dwLeft, cbBytes - cbRead), &ullSourceRead);
+            cbRead += ullSourceRead;
+            m_ullPosition += ullSourceRead;
+        }
+        else
+        {
+            if (m_discarded.GetCount() < dwLeft && !m_discarded.SetCount(ChunkHashStream::kMaxChunkSize))
+            {
+                hr = E_OUTOFMEMORY;
+                break;
+            }
+
+            hr = m_source->Read(m_discarded.GetData(), dwLeft, &ullSourceRead);
+        }
+
+        if (FAILED(hr))
+            break;
+
+        if (ullSourceRead == 0LL)
+        {
+            Log::Error(L"Chunk recipe source ended before chunk at offset {}", chunk.Offset + m_dwChunkRead);
+            hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+            break;
+        }
+
+        m_dwChunkRead += static_cast<DWORD>(ullSourceRead);
+        if (m_dwChunkRead == chunk.Length)
+        {
+            m_chunk++;
+            m_dwChunkRead = 0L;
+        }
+    }
+
+    if (pcbBytesRead)
+        *pcbBytesRead = cbRead;
+
+    return hr;
+}
+
+HRESULT ChunkRecipeStream::SetFilePointer(
+    __in LONGLONG DistanceToMove,
+    __in DWORD dwMoveMethod,
+    __out_opt PULONG64 pCurrPointer)
+{
+    if (m_source == nullptr)
+        return E_POINTER;
+
+    if (DistanceToMove == 0LL && dwMoveMethod == FILE_CURRENT)
+    {
+        if (pCurrPointer)
+            *pCurrPointer = m_ullPosition;
+        return S_OK;
+    }
+
+    if (DistanceToMove != 0LL || dwMoveMethod != FILE_BEGIN)
+        return E_NOTIMPL;
+
+    if (auto hr = m_source->SetFilePointer(0LL, FILE_BEGIN, nullptr); FAILED(hr))
+        return hr;
+
+    m_ullPosition = 0LL;
+    m_chunk = 0;
+    m_dwChunkRead = 0L;
+
+    if (pCurrPointer)
+        *pCurrPointer = 0LL;
+    return S_OK;
+}
+
+ULONG64 ChunkRecipeStream::GetSize()
+{
+    ULONGLONG ullSize = m_header.size();
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        if (m_stored[i])
+            ullSize += m_chunks[i].Length;
+    }
+
+    return ullSize;
+}
+
+HRESULT ChunkRecipeStream::Close()
+{
+    m_discarded.RemoveAll();
+
+    if (m_source == nullptr)
+        return S_OK;
+
+    return m_source->Close();
+}
+
+ULONGLONG ChunkRecipeStream::ReferencedBytes() const
+{
+    ULONGLONG ullBytes = 0LL;
+    for (size_t i = 0; i < m_chunks.size(); i++)
+    {
+        if (!m_stored[i])
+            ullBytes += m_chunks[i].Length;
+    }
+
+    return ullBytes;
+}
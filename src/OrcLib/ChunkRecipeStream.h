@@ -0,0 +1,88 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "ByteStream.h"
+#include "BinaryBuffer.h"
+#include "ChunkHashStream.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// ChunkRecipeStream: read only view of a stream as a chunk recipe, where the chunks already held by the collection
+// server are only referenced by their hash.
+//
+// The recipe is a text header followed by the data of the stored chunks, in order:
+//
+//   ORC-CDC,1,<data size>,<chunk count>
+//   <offset>,<length>,<sha256>,<1 if stored, 0 if referenced>     (one line per chunk)
+//   <empty line>
+//
+// The source is still read in full so that the hash streams it may be chained to see all of its data. Only rewinding
+// is supported.
+//
+class ChunkRecipeStream : public ByteStream
+{
+public:
+    ChunkRecipeStream(
+        std::shared_ptr<ByteStream> source,
+        std::vector<ChunkHashStream::Chunk> chunks,
+        std::vector<bool> stored);
+    virtual ~ChunkRecipeStream();
+
+    STDMETHOD(IsOpen)() { return m_source != nullptr ? m_source->IsOpen() : S_FALSE; };
+    STDMETHOD(CanRead)() { return S_OK; };
+    STDMETHOD(CanWrite)() { return S_FALSE; };
+    STDMETHOD(CanSeek)() { return S_FALSE; };
+
+    STDMETHOD(Read_)
+    (__out_bcount_part(cbBytes, *pcbBytesRead) PVOID pReadBuffer,
+     __in ULONGLONG cbBytes,
+     __out_opt PULONGLONG pcbBytesRead);
+
+    STDMETHOD(Write_)
+    (__in_bcount(cbBytesToWrite) const PVOID pWriteBuffer,
+     __in ULONGLONG cbBytesToWrite,
+     __out_opt PULONGLONG pcbBytesWritten)
+    {
+        return E_NOTIMPL;
+    };
+
+    STDMETHOD(SetFilePointer)
+    (__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer);
+
+    STDMETHOD_(ULONG64, GetSize)();
+    STDMETHOD(SetSize)(ULONG64 ullSize) { return E_NOTIMPL; };
+
+    STDMETHOD(Close)();
+
+    // Bytes of the source which are only referenced
+    ULONGLONG ReferencedBytes() const;
+
+private:
+    std::shared_ptr<ByteStream> m_source;
+    std::vector<ChunkHashStream::Chunk> m_chunks;
+    std::vector<bool> m_stored;
+    std::string m_header;
+
+    ULONGLONG m_ullPosition = 0LL;
+    size_t m_chunk = 0;
+    DWORD m_dwChunkRead = 0L;
+    CBinaryBuffer m_discarded;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,700 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ChunkedEncryptedStream.h"
+
+#include "TaskPool.h"
+#include "Utils/Guard.h"
+
+#include <algorithm>
+
+#pragma comment(lib, "bcrypt.lib")
+
+using namespace Orc;
+
+namespace {
+
+constexpr uint64_t kMagic = 0x31304B484343524FULL;  // "ORCCHK01"
+
+constexpr DWORD kKeySize = 32;
+constexpr DWORD kTagSize = 16;
+constexpr DWORD kNonceSize = 12;
+
+constexpr DWORD kMaxChunkSize = 64 * 1024 * 1024;
+constexpr DWORD kMaxEnvelopeSize = 1024 * 1024;
+
+#pragma pack(push, 1)
+struct Header
+{
+    uint64_t Magic;
+    uint32_t ChunkSize;
+    uint32_t EnvelopeSize;
+};
+#pragma pack(pop)
+
+// Chunks processed by each parallel_for: enough to keep all the cores busy while bounding the buffered data
+DWORD BatchChunks()
+{
+    const DWORD dwThreads = TaskPool::Instance().Processors();
+    return std::clamp<DWORD>(dwThreads * 2, 2, 32);
+}
+
+// Chunks are never encrypted twice with the same key: a random key per output, the chunk index as nonce
+void GetNonce(ULONGLONG ullChunk, BYTE (&nonce)[kNonceSize])
+{
+    ZeroMemory(nonce, sizeof(nonce));
+    memcpy(nonce, &ullChunk, sizeof(ullChunk));
+}
+
+HRESULT EncryptChunk(
+    BCRYPT_KEY_HANDLE hKey,
+    ULONGLONG ullChunk,
+    bool bLast,
+    const BYTE* pClear,
+    DWORD cbClear,
+    BYTE* pOutput)
+{
+    BYTE nonce[kNonceSize];
+    GetNonce(ullChunk, nonce);
+
+    BYTE lastFlag = bLast ? 1 : 0;
+
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+    BCRYPT_INIT_AUTH_MODE_INFO(info);
+    info.pbNonce = nonce;
+    info.cbNonce = sizeof(nonce);
+    info.pbAuthData = &lastFlag;
+    info.cbAuthData = sizeof(lastFlag);
+    info.pbTag = pOutput + cbClear;
+    info.cbTag = kTagSize;
+
+    ULONG cbResult = 0L;
+    const NTSTATUS status =
+        BCryptEncrypt(hKey, const_cast<PUCHAR>(pClear), cbClear, &info, NULL, 0L, pOutput, cbClear, &cbResult, 0L);
+    if (!NT_SUCCESS(status))
+    {
+        const auto hr = HRESULT_FROM_NT(status);
+        Log::Error("Failed to encrypt chunk #{} [{}]", ullChunk, SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT DecryptChunk(
+    BCRYPT_KEY_HANDLE hKey,
+    ULONGLONG ullChunk,
+    bool bLast,
+    const BYTE* pInput,
+    DWORD cbClear,
+    BYTE* pClear)
+{
+    BYTE nonce[kNonceSize];
+    GetNonce(ullChunk, nonce);
+
+    BYTE lastFlag = bLast ? 1 : 0;
+
+    BCRYPT_AUTHENTICATED_CIPHER_MODE_INFO info;
+    BCRYPT_INIT_AUTH_MODE_INFO(info);
+    info.pbNonce = nonce;
+    info.cbNonce = sizeof(nonce);
+    info.pbAuthData = &lastFlag;
+    info.cbAuthData = sizeof(lastFlag);
+    info.pbTag = const_cast<PUCHAR>(pInput + cbClear);
+    info.cbTag = kTagSize;
+
+    ULONG cbResult = 0L;
+    const NTSTATUS status =
+        BCryptDecrypt(hKey, const_cast<PUCHAR>(pInput), cbClear, &info, NULL, 0L, pClear, cbClear, &cbResult, 0L);
+    if (!NT_SUCCESS(status))
+    {
+        const auto hr = HRESULT_FROM_NT(status);
+        Log::Error("Failed to decrypt chunk #{} [{}]", ullChunk, SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT WrapKey(const std::vector<CBinaryBuffer>& recipients, const BYTE* pbKey, CBinaryBuffer& envelope)
+{
+    std::vector<PCCERT_CONTEXT> certificates;
+    auto certificatesGuard = Guard::CreateScopeGuard([&certificates]() {
+        for (const auto pCertificate : certificates)
+            CertFreeCertificateContext(pCertificate);
+    });
+
+    for (const auto& recipient : recipients)
+    {
+        const auto pCertificate = CertCreateCertificateContext(
+            X509_ASN_ENCODING | PKCS_7_ASN_ENCODING, recipient.GetData(), static_cast<DWORD>(recipient.GetCount()));
+        if (pCertificate == NULL)
+        {
+            const auto hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error("Failed to load recipient certificate [{}]", SystemError(hr));
+            return hr;
+        }
+
+        certificates.push_back(pCertificate);
+    }
+
+    CRYPT_ENCRYPT_MESSAGE_PARA para;
+    ZeroMemory(&para, sizeof(para));
+    para.cbSize = sizeof(para);
+    para.dwMsgEncodingType = X509_ASN_ENCODING | PKCS_7_ASN_ENCODING;
+    para.ContentEncryptionAlgorithm.pszObjId = const_cast<LPSTR>(szOID_NIST_AES256_CBC);
+
+    DWORD cbEnvelope = 0L;
+    if (!CryptEncryptMessage(
+            &para,
+            static_cast<DWORD>(certificates.size()),
+            certificates.data(),
+            pbKey,
+            kKeySize,
+            NULL,
+            &cbEnvelope))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error("Failed to compute content key envelope size [{}]", SystemError(hr));
+        return hr;
+    }
+
+    envelope.SetCount(cbEnvelope);
+    if (!CryptEncryptMessage(
+            &para,
+            static_cast<DWORD>(certificates.size()),
+            certificates.data(),
+            pbKey,
+            kKeySize,
+            envelope.GetData(),
+            &cbEnvelope))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error("Failed to encrypt content key for the recipients [{}]", SystemError(hr));
+        return hr;
+    }
+
+    envelope.SetCount(cbEnvelope);
+    return S_OK;
+}
+
+HRESULT UnwrapKey(const CBinaryBuffer& envelope, CBinaryBuffer& key)
+{
+    std::vector<HCERTSTORE> stores;
+    auto storesGuard = Guard::CreateScopeGuard([&stores]() {
+        for (const auto hStore : stores)
+            CertCloseStore(hStore, 0L);
+    });
+
+    for (const auto dwLocation : {CERT_SYSTEM_STORE_CURRENT_USER, CERT_SYSTEM_STORE_LOCAL_MACHINE})
+    {
+        const auto hStore =
+            CertOpenStore(CERT_STORE_PROV_SYSTEM_W, 0L, NULL, dwLocation | CERT_STORE_READONLY_FLAG, L"MY");
+        if (hStore == NULL)
+        {
+            Log::Debug("Failed to open 'MY' certificate store [{}]", LastWin32Error());
+            continue;
+        }
+
+        stores.push_back(hStore);
+    }
+
+    CRYPT_DECRYPT_MESSAGE_PARA para;
+    ZeroMemory(&para, sizeof(para));
+    para.cbSize = sizeof(para);
+    para.dwMsgAndCertEncodingType = X509_ASN_ENCODING | PKCS_7_ASN_ENCODING;
+    para.cCertStore = static_cast<DWORD>(stores.size());
+    para.rghCertStore = stores.data();
+
+    DWORD cbKey = 0L;
+    if (!CryptDecryptMessage(&para, envelope.GetData(), static_cast<DWORD>(envelope.GetCount()), NULL, &cbKey, NULL))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error("Failed to decrypt content key, no recipient private key available? [{}]", SystemError(hr));
+        return hr;
+    }
+
+    key.SetCount(cbKey);
+    if (!CryptDecryptMessage(
+            &para, envelope.GetData(), static_cast<DWORD>(envelope.GetCount()), key.GetData(), &cbKey, NULL))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error("Failed to decrypt content key [{}]", SystemError(hr));
+        return hr;
+    }
+
+    key.SetCount(cbKey);
+    return S_OK;
+}
+
+HRESULT ReadAll(ByteStream& stream, BYTE* pBuffer, ULONGLONG cbBytes)
+{
+    ULONGLONG cbTotal = 0LL;
+    while (cbTotal < cbBytes)
+    {
+        ULONGLONG cbRead = 0LL;
+        HRESULT hr = stream.Read(pBuffer + cbTotal, cbBytes - cbTotal, &cbRead);
+        if (FAILED(hr))
+            return hr;
+
+        if (cbRead == 0)
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+        cbTotal += cbRead;
+    }
+
+    return S_OK;
+}
+
+}  // namespace
+
+HRESULT ChunkedEncryptedStream::CreateKeys(const BYTE* pbKey, DWORD cbKey)
+{
+    NTSTATUS status = BCryptOpenAlgorithmProvider(&m_hAlg, BCRYPT_AES_ALGORITHM, NULL, 0L);
+    if (!NT_SUCCESS(status))
+    {
+        const auto hr = HRESULT_FROM_NT(status);
+        Log::Error("Failed to open AES algorithm provider [{}]", SystemError(hr));
+        return hr;
+    }
+
+    status = BCryptSetProperty(
+        m_hAlg,
+        BCRYPT_CHAINING_MODE,
+        reinterpret_cast<PUCHAR>(const_cast<LPWSTR>(BCRYPT_CHAIN_MODE_GCM)),
+        sizeof(BCRYPT_CHAIN_MODE_GCM),
+        0L);
+    if (!NT_SUCCESS(status))
+    {
+        const auto hr = HRESULT_FROM_NT(status);
+        Log::Error("Failed to select GCM chaining mode [{}]", SystemError(hr));
+        return hr;
+    }
+
+    const auto dwKeys = BatchChunks();
+    for (DWORD i = 0; i < dwKeys; i++)
+    {
+        BCRYPT_KEY_HANDLE hKey = NULL;
+        status = BCryptGenerateSymmetricKey(m_hAlg, &hKey, NULL, 0L, const_cast<PUCHAR>(pbKey), cbKey, 0L);
+        if (!NT_SUCCESS(status))
+        {
+            const auto hr = HRESULT_FROM_NT(status);
+            Log::Error("Failed to create content key [{}]", SystemError(hr));
+            return hr;
+        }
+
+        m_Keys.push_back(hKey);
+    }
+
+    return S_OK;
+}
+
+void ChunkedEncryptedStream::DestroyKeys()
+{
+    for (const auto hKey : m_Keys)
+    {
+        BCryptDestroyKey(hKey);
+    }
+
+    m_Keys.clear();
+
+    if (m_hAlg != NULL)
+    {
+        BCryptCloseAlgorithmProvider(m_hAlg, 0L);
+        m_hAlg = NULL;
+    }
+}
+
+STDMETHODIMP ChunkedEncryptedStream::OpenToEncrypt(
+    const std::vector<CBinaryBuffer>& recipients,
+    const std::shared_ptr<ByteStream>& pChainedStream,
+    DWORD dwChunkSize)
+{
+    HRESULT hr = E_FAIL;
+
+    if (pChainedStream == nullptr)
+        return E_POINTER;
+
+    if (recipients.empty() || dwChunkSize == 0 || dwChunkSize > kMaxChunkSize)
+        return E_INVALIDARG;
+
+    BYTE key[kKeySize];
+    auto keyGuard = Guard::CreateScopeGuard([&key]() { SecureZeroMemory(key, sizeof(key)); });
+
+    NTSTATUS status = BCryptGenRandom(NULL, key, sizeof(key), BCRYPT_USE_SYSTEM_PREFERRED_RNG);
+    if (!NT_SUCCESS(status))
+    {
+        hr = HRESULT_FROM_NT(status);
+        Log::Error("Failed to generate content key [{}]", SystemError(hr));
+        return hr;
+    }
+
+    CBinaryBuffer envelope;
+    if (FAILED(hr = WrapKey(recipients, key, envelope)))
+        return hr;
+
+    if (FAILED(hr = CreateKeys(key, sizeof(key))))
+        return hr;
+
+    Header header;
+    header.Magic = kMagic;
+    header.ChunkSize = dwChunkSize;
+    header.EnvelopeSize = static_cast<uint32_t>(envelope.GetCount());
+
+    ULONGLONG ullWritten = 0LL;
+    if (FAILED(hr = pChainedStream->Write(&header, sizeof(header), &ullWritten))
+        || FAILED(hr = pChainedStream->Write(envelope.GetData(), envelope.GetCount(), &ullWritten)))
+    {
+        Log::Error("Failed to write encrypted container header [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_dwChunkSize = dwChunkSize;
+    m_ullDataOffset = sizeof(header) + envelope.GetCount();
+    m_Clear.SetCount(static_cast<size_t>(m_dwChunkSize) * m_Keys.size());
+    m_Encrypted.SetCount(static_cast<size_t>(m_dwChunkSize + kTagSize) * m_Keys.size());
+    m_cbClear = 0LL;
+    m_ullNextChunk = 0LL;
+
+    m_pChainedStream = pChainedStream;
+    m_bEncrypting = true;
+
+    Log::Debug("Chunked encryption started (chunk: {} bytes, batch: {} chunks)", m_dwChunkSize, m_Keys.size());
+    return S_OK;
+}
+
+STDMETHODIMP ChunkedEncryptedStream::OpenToDecrypt(const std::shared_ptr<ByteStream>& pChainedStream)
+{
+    HRESULT hr = E_FAIL;
+
+    if (pChainedStream == nullptr)
+        return E_POINTER;
+
+    Header header;
+    if (FAILED(hr = pChainedStream->SetFilePointer(0LL, FILE_BEGIN, NULL))
+        || FAILED(hr = ReadAll(*pChainedStream, reinterpret_cast<BYTE*>(&header), sizeof(header))))
+    {
+        Log::Error("Failed to read encrypted container header [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (header.Magic != kMagic || header.ChunkSize == 0 || header.ChunkSize > kMaxChunkSize
+        || header.EnvelopeSize == 0 || header.EnvelopeSize > kMaxEnvelopeSize)
+    {
+        Log::Error("Invalid encrypted container header");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    CBinaryBuffer envelope;
+    envelope.SetCount(header.EnvelopeSize);
+    if (FAILED(hr = ReadAll(*pChainedStream, envelope.GetData(), envelope.GetCount())))
+    {
+        Log::Error("Failed to read encrypted container envelope [{}]", SystemError(hr));
+        return hr;
+    }
+
+    CBinaryBuffer key;
+    auto keyGuard = Guard::CreateScopeGuard([&key]() { key.ZeroMe(); });
+
+    if (FAILED(hr = UnwrapKey(envelope, key)))
+        return hr;
+
+    if (key.GetCount() != kKeySize)
+    {
+        Log::Error("Invalid encrypted container content key");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    if (FAILED(hr = CreateKeys(key.GetData(), kKeySize)))
+        return hr;
+
+    // There is always a last chunk, it may only be made of its tag
+    const ULONGLONG ullStride = header.ChunkSize + kTagSize;
+    const ULONGLONG ullDataOffset = sizeof(header) + header.EnvelopeSize;
+    const ULONGLONG ullTotal = pChainedStream->GetSize();
+    if (ullTotal < ullDataOffset + kTagSize)
+    {
+        Log::Error("Truncated encrypted container");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    const ULONGLONG ullData = ullTotal - ullDataOffset;
+    m_ullChunks = (ullData + ullStride - 1) / ullStride;
+
+    const ULONGLONG ullLast = ullData - (m_ullChunks - 1) * ullStride;
+    if (ullLast < kTagSize)
+    {
+        Log::Error("Truncated encrypted container");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    m_dwChunkSize = header.ChunkSize;
+    m_ullDataOffset = ullDataOffset;
+    m_ullSize = (m_ullChunks - 1) * m_dwChunkSize + (ullLast - kTagSize);
+    m_ullPosition = 0LL;
+    m_ullClearFirstChunk = 0LL;
+    m_ullClearChunks = 0LL;
+    m_Clear.SetCount(static_cast<size_t>(m_dwChunkSize) * m_Keys.size());
+    m_Encrypted.SetCount(static_cast<size_t>(ullStride) * m_Keys.size());
+
+    m_pChainedStream = pChainedStream;
+    m_bEncrypting = false;
+    return S_OK;
+}
+
+HRESULT ChunkedEncryptedStream::EncryptBatch(bool bFinal)
+{
+    HRESULT hr = E_FAIL;
+
+    // The last chunk is written even when empty: it authenticates the end of the data
+    const ULONGLONG cChunks = m_cbClear == 0 ? (bFinal ? 1 : 0) : (m_cbClear + m_dwChunkSize - 1) / m_dwChunkSize;
+    if (cChunks == 0)
+        return S_OK;
+
+    const ULONGLONG ullStride = m_dwChunkSize + kTagSize;
+
+    std::vector<HRESULT> results(static_cast<size_t>(cChunks), E_FAIL);
+    TaskPool::ParallelFor(TaskPool::Subsystem::Archive, size_t(0), results.size(), [&](size_t i) {
+        const ULONGLONG ullOffset = i * m_dwChunkSize;
+        const auto cbChunk = static_cast<DWORD>(std::min<ULONGLONG>(m_dwChunkSize, m_cbClear - ullOffset));
+
+        results[i] = EncryptChunk(
+            m_Keys[i],
+            m_ullNextChunk + i,
+            bFinal && i == results.size() - 1,
+            m_Clear.GetData() + ullOffset,
+            cbChunk,
+            m_Encrypted.GetData() + i * ullStride);
+    });
+
+    for (const auto result : results)
+    {
+        if (FAILED(result))
+            return result;
+    }
+
+    const ULONGLONG cbEncrypted = m_cbClear + cChunks * kTagSize;
+
+    ULONGLONG ullWritten = 0LL;
+    if (FAILED(hr = m_pChainedStream->Write(m_Encrypted.GetData(), cbEncrypted, &ullWritten)))
+    {
+        Log::Error("Failed to write encrypted chunks [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_ullNextChunk += cChunks;
+    m_cbClear = 0LL;
+    return S_OK;
+}
+
+HRESULT ChunkedEncryptedStream::DecryptBatch(ULONGLONG ullFirstChunk)
+{
+    HRESULT hr = E_FAIL;
+
+    const ULONGLONG cChunks = std::min<ULONGLONG>(m_Keys.size(), m_ullChunks - ullFirstChunk);
+    const ULONGLONG ullStride = m_dwChunkSize + kTagSize;
+    const ULONGLONG cbLastClear = m_ullSize - (m_ullChunks - 1) * m_dwChunkSize;
+    const bool bHasLast = ullFirstChunk + cChunks == m_ullChunks;
+    const ULONGLONG cbEncrypted = bHasLast ? (cChunks - 1) * ullStride + cbLastClear + kTagSize : cChunks * ullStride;
+
+    if (FAILED(hr = m_pChainedStream->SetFilePointer(m_ullDataOffset + ullFirstChunk * ullStride, FILE_BEGIN, NULL))
+        || FAILED(hr = ReadAll(*m_pChainedStream, m_Encrypted.GetData(), cbEncrypted)))
+    {
+        Log::Error("Failed to read encrypted chunks (first: #{}) [{}]", ullFirstChunk, SystemError(hr));
+        return hr;
+    }
+
+    // Invalidate the buffer while it is overwritten
+    m_ullClearChunks = 0LL;
+
+    std::vector<HRESULT> results(static_cast<size_t>(cChunks), E_FAIL);
+    TaskPool::ParallelFor(TaskPool::Subsystem::Archive, size_t(0), results.size(), [&](size_t i) {
+        const bool bLast = ullFirstChunk + i == m_ullChunks - 1;
+
+        results[i] = DecryptChunk(
+            m_Keys[i],
+            ullFirstChunk + i,
+            bLast,
+            m_Encrypted.GetData() + i * ullStride,
+            bLast ? static_cast<DWORD>(cbLastClear) : m_dwChunkSize,
+            m_Clear.GetData() + i * m_dwChunkSize);
+    });
+
+    for (const auto result : results)
+    {
+        if (FAILED(result))
+            return result;
+    }
+
+    m_ullClearFirstChunk = ullFirstChunk;
+    m_ullClearChunks = cChunks;
+    m_cbClear = bHasLast ? (cChunks - 1) * m_dwChunkSize + cbLastClear : cChunks * m_dwChunkSize;
+    return S_OK;
+}
+
+__data_entrypoint(File) HRESULT ChunkedEncryptedStream::Read_(
+    __out_bcount_part(cbBytesToRead, *pcbBytesRead) PVOID pBuffer,
+    __in ULONGLONG cbBytesToRead,
+    __out_opt PULONGLONG pcbBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    if (pcbBytesRead)
+        *pcbBytesRead = 0;
+
+    if (m_pChainedStream == nullptr)
+        return E_POINTER;
+    if (CanRead() != S_OK)
+        return E_NOTIMPL;
+
+    ULONGLONG cbRead = 0LL;
+    while (cbRead < cbBytesToRead && m_ullPosition < m_ullSize)
+    {
+        const ULONGLONG ullChunk = m_ullPosition / m_dwChunkSize;
+        if (ullChunk < m_ullClearFirstChunk || ullChunk >= m_ullClearFirstChunk + m_ullClearChunks)
+        {
+            if (FAILED(hr = DecryptBatch(ullChunk)))
+                return hr;
+        }
+
+        const ULONGLONG ullOffset = m_ullPosition - m_ullClearFirstChunk * m_dwChunkSize;
+        const ULONGLONG cbBytes = std::min(cbBytesToRead - cbRead, m_cbClear - ullOffset);
+
+        memcpy(static_cast<BYTE*>(pBuffer) + cbRead, m_Clear.GetData() + ullOffset, static_cast<size_t>(cbBytes));
+        cbRead += cbBytes;
+        m_ullPosition += cbBytes;
+    }
+
+    if (pcbBytesRead)
+        *pcbBytesRead = cbRead;
+
+    return S_OK;
+}
+
+HRESULT ChunkedEncryptedStream::Write_(
+    __in_bcount(cbBytes) const PVOID pBuffer,
+    __in ULONGLONG cbBytes,
+    __out PULONGLONG pcbBytesWritten)
+{
+    HRESULT hr = E_FAIL;
+
+    if (pcbBytesWritten)
+        *pcbBytesWritten = 0;
+
+    if (m_pChainedStream == nullptr)
+        return E_POINTER;
+    if (CanWrite() != S_OK)
+        return E_NOTIMPL;
+
+    ULONGLONG cbWritten = 0LL;
+    while (cbWritten < cbBytes)
+    {
+        const ULONGLONG cbBytesToCopy = std::min(cbBytes - cbWritten, m_Clear.GetCount() - m_cbClear);
+
+        memcpy(
+            m_Clear.GetData() + m_cbClear,
+            static_cast<const BYTE*>(pBuffer) + cbWritten,
+            static_cast<size_t>(cbBytesToCopy));
+        m_cbClear += cbBytesToCopy;
+        cbWritten += cbBytesToCopy;
+
+        if (m_cbClear == m_Clear.GetCount())
+        {
+            if (FAILED(hr = EncryptBatch(false)))
+                return hr;
+        }
+    }
+
+    if (pcbBytesWritten)
+        *pcbBytesWritten = cbWritten;
+
+    return S_OK;
+}
+
+HRESULT ChunkedEncryptedStream::SetFilePointer(
+    __in LONGLONG lDistanceToMove,
+    __in DWORD dwMoveMethod,
+    __out_opt PULONG64 pqwCurrPointer)
+{
+    if (CanSeek() != S_OK)
+    {
+        Log::Error("SetFilePointer is only implemented when decrypting a ChunkedEncryptedStream");
+        return E_NOTIMPL;
+    }
+
+    LONGLONG llPosition = 0LL;
+    switch (dwMoveMethod)
+    {
+        case FILE_BEGIN:
+            llPosition = lDistanceToMove;
+            break;
+        case FILE_CURRENT:
+            llPosition = static_cast<LONGLONG>(m_ullPosition) + lDistanceToMove;
+            break;
+        case FILE_END:
+            llPosition = static_cast<LONGLONG>(m_ullSize) + lDistanceToMove;
+            break;
+        default:
+            return E_INVALIDARG;
+    }
+
+    if (llPosition < 0)
+        return HRESULT_FROM_WIN32(ERROR_NEGATIVE_SEEK);
+
+    m_ullPosition = static_cast<ULONGLONG>(llPosition);
+    if (pqwCurrPointer)
+        *pqwCurrPointer = m_ullPosition;
+
+    return S_OK;
+}
+
+ULONG64 ChunkedEncryptedStream::GetSize()
+{
+    if (m_bEncrypting)
+        return m_ullNextChunk * m_dwChunkSize + m_cbClear;
+
+    return m_ullSize;
+}
+
+HRESULT ChunkedEncryptedStream::SetSize(ULONG64 ullNewSize)
+{
+    DBG_UNREFERENCED_PARAMETER(ullNewSize);
+    Log::Debug("ChunkedEncryptedStream: SetSize is not implemented");
+    return S_OK;
+}
+
+HRESULT ChunkedEncryptedStream::Close()
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_pChainedStream == nullptr)
+        return S_OK;
+
+    if (m_bEncrypting && !m_Keys.empty())
+    {
+        hr = EncryptBatch(true);
+
+        // Only one last chunk: following calls only close the chained stream
+        DestroyKeys();
+
+        if (FAILED(hr))
+        {
+            Log::Error("Failed to encrypt last chunks [{}]", SystemError(hr));
+            return hr;
+        }
+    }
+
+    return m_pChainedStream->Close();
+}
+
+ChunkedEncryptedStream::~ChunkedEncryptedStream()
+{
+    SecureZeroMemory(m_Clear.GetData(), m_Clear.GetCount());
+    DestroyKeys();
+}
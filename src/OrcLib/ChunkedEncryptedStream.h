@@ -0,0 +1,133 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "ChainingStream.h"
+#include "BinaryBuffer.h"
+
+#include <boost/logic/tribool.hpp>
+
+#include <vector>
+
+#include <bcrypt.h>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// ChunkedEncryptedStream: encrypted container which, unlike the CMS stream of EncodeMessageStream, can be encrypted and
+// decrypted on several threads and read at any offset.
+//
+// Layout:
+//   Header     'ORCCHK01', chunk size and envelope size
+//   Envelope   PKCS#7 enveloped data for the recipients, its content is the random AES-256 key of this output
+//   Chunks     AES-256-GCM encryption of each chunk of chunk size bytes (the last one may be shorter or empty),
+//              followed by its 16 bytes tag
+//
+// The nonce of a chunk is its index and its additional data tells if it is the last one: chunks cannot be reordered,
+// and a truncated container fails authentication. Chunks are processed by batches on the TaskPool archive scheduler,
+// each slot of a batch using its own key handle.
+//
+class ChunkedEncryptedStream : public ChainingStream
+{
+public:
+    static constexpr DWORD kDefaultChunkSize = 1024 * 1024;
+
+    ChunkedEncryptedStream()
+        : ChainingStream()
+    {
+        m_bEncrypting = boost::indeterminate;
+    }
+
+    STDMETHOD(IsOpen)()
+    {
+        if (m_bEncrypting == boost::indeterminate)
+            return S_FALSE;
+        return ChainingStream::IsOpen();
+    };
+    STDMETHOD(CanRead)()
+    {
+        if (m_bEncrypting)
+            return S_FALSE;
+        return ChainingStream::CanRead();
+    };
+    STDMETHOD(CanWrite)()
+    {
+        if (!m_bEncrypting)
+            return S_FALSE;
+        return ChainingStream::CanWrite();
+    };
+    STDMETHOD(CanSeek)()
+    {
+        if (m_bEncrypting)
+            return S_FALSE;
+        return ChainingStream::CanSeek();
+    };
+
+    // Encrypt for the DER encoded certificates of 'recipients'
+    STDMETHOD(OpenToEncrypt)
+    (const std::vector<CBinaryBuffer>& recipients,
+     const std::shared_ptr<ByteStream>& pChainedStream,
+     DWORD dwChunkSize = kDefaultChunkSize);
+
+    // Decrypt with the private key of a recipient from the 'MY' certificate store of the user or the machine
+    STDMETHOD(OpenToDecrypt)(const std::shared_ptr<ByteStream>& pChainedStream);
+
+    STDMETHOD(Read_)
+    (__out_bcount_part(cbBytesToRead, *pcbBytesRead) PVOID pBuffer,
+     __in ULONGLONG cbBytesToRead,
+     __out_opt PULONGLONG pcbBytesRead);
+
+    STDMETHOD(Write_)
+    (__in_bcount(cbBytes) const PVOID pBuffer, __in ULONGLONG cbBytes, __out PULONGLONG pcbBytesWritten);
+
+    STDMETHOD(SetFilePointer)
+    (__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer);
+
+    // Size of the clear text
+    STDMETHOD_(ULONG64, GetSize)();
+    STDMETHOD(SetSize)(ULONG64 ullSize);
+
+    STDMETHOD(Close)();
+
+    ~ChunkedEncryptedStream();
+
+private:
+    HRESULT CreateKeys(const BYTE* pbKey, DWORD cbKey);
+    void DestroyKeys();
+
+    HRESULT EncryptBatch(bool bFinal);
+    HRESULT DecryptBatch(ULONGLONG ullFirstChunk);
+
+    boost::logic::tribool m_bEncrypting;
+
+    BCRYPT_ALG_HANDLE m_hAlg = NULL;
+    std::vector<BCRYPT_KEY_HANDLE> m_Keys;  // One per chunk of a batch
+
+    DWORD m_dwChunkSize = 0L;
+    ULONGLONG m_ullDataOffset = 0LL;  // Offset of the first chunk in the chained stream
+
+    CBinaryBuffer m_Clear;
+    ULONGLONG m_cbClear = 0LL;
+    CBinaryBuffer m_Encrypted;
+
+    // Encryption: index of the next chunk to write
+    ULONGLONG m_ullNextChunk = 0LL;
+
+    // Decryption: chunks of the clear text buffer, total chunk count and clear text size
+    ULONGLONG m_ullClearFirstChunk = 0LL;
+    ULONGLONG m_ullClearChunks = 0LL;
+    ULONGLONG m_ullChunks = 0LL;
+    ULONGLONG m_ullSize = 0LL;
+    ULONGLONG m_ullPosition = 0LL;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
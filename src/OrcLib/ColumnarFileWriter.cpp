@@ -0,0 +1,522 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "ColumnarFileWriter.h"
+
+#include "ByteStream.h"
+#include "FileStream.h"
+#include "Buffer.h"
+#include "Robustness.h"
+#include "Text/Utf16ToUtf8.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+using namespace Orc::TableOutput::Columnar;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Enable the use of std::make_shared with Writer protected constructor
+struct WriterT : public Orc::TableOutput::Columnar::Writer
+{
+    template <typename... Args>
+    inline WriterT(Args&&... args)
+        : Writer(std::forward<Args>(args)...)
+    {
+    }
+};
+
+constexpr uint32_t kNullIndex = UINT32_MAX;
+
+void Pad(std::vector<uint8_t>& buffer)
+{
+    buffer.resize((buffer.size() + 7) & ~static_cast<size_t>(7), 0);
+}
+
+void Append(std::vector<uint8_t>& buffer, const void* pData, size_t cbData)
+{
+    if (cbData == 0)
+        return;
+
+    const auto offset = buffer.size();
+    buffer.resize(offset + cbData);
+    memcpy(buffer.data() + offset, pData, cbData);
+}
+
+template <typename T>
+void Append(std::vector<uint8_t>& buffer, const T& value)
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+    Append(buffer, &value, sizeof(T));
+}
+
+// Row values as stored in the file, UTF-16 text is kept as is
+std::string_view ValueAt(const Orc::TableOutput::BatchColumn& column, size_t row)
+{
+    using Storage = Orc::TableOutput::BatchColumn::Storage;
+
+    if (column.GetStorage() == Storage::WideChars)
+    {
+        const auto value = column.WideCharsAt(row);
+        return std::string_view(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(WCHAR));
+    }
+
+    return column.BytesAt(row);
+}
+
+}  // namespace
+
+class Orc::TableOutput::Columnar::WriterTermination : public TerminationHandler
+{
+public:
+    WriterTermination(const std::wstring& strDescr, std::weak_ptr<Writer> pW)
+        : TerminationHandler(strDescr, ROBUSTNESS_CSV)
+        , m_pWriter(std::move(pW)) {};
+
+    HRESULT operator()();
+
+private:
+    std::weak_ptr<Writer> m_pWriter;
+};
+
+HRESULT Orc::TableOutput::Columnar::WriterTermination::operator()()
+{
+    // Without its footer the file cannot be read
+    if (auto pWriter = m_pWriter.lock(); pWriter)
+    {
+        pWriter->Close();
+    }
+    return S_OK;
+}
+
+std::shared_ptr<Orc::TableOutput::Columnar::Writer>
+Orc::TableOutput::Columnar::Writer::MakeNew(std::unique_ptr<TableOutput::Options>&& options)
+{
+    auto columnarOptions = dynamic_unique_ptr_cast<Columnar::Options>(std::move(options));
+    if (!columnarOptions)
+        columnarOptions = std::make_unique<Columnar::Options>();
+
+    auto retval = std::make_shared<::WriterT>(std::move(columnarOptions));
+
+    std::wstring strDescr = L"Termination for Columnar::Writer";
+    retval->m_pTermination = std::make_shared<WriterTermination>(strDescr, retval);
+    Robustness::AddTerminationHandler(retval->m_pTermination);
+    return retval;
+}
+
+Orc::TableOutput::Columnar::Writer::Writer(std::unique_ptr<Options>&& options)
+    : m_Options(std::move(options))
+{
+    if (m_Options->dwBlockRows == 0)
+        m_Options->dwBlockRows = kDefaultBlockRows;
+}
+
+Orc::TableOutput::Columnar::Writer::~Writer()
+{
+    if (m_pTermination)
+        Close();
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteToFile(const fs::path& path)
+{
+    return WriteToFile(path.c_str());
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteToFile(const WCHAR* szFileName)
+{
+    if (szFileName == NULL)
+        return E_POINTER;
+
+    auto pFileStream = std::make_shared<FileStream>();
+
+    if (auto hr = pFileStream->WriteTo(szFileName); FAILED(hr))
+        return hr;
+
+    return WriteToStream(pFileStream, true);
+}
+
+STDMETHODIMP
+Orc::TableOutput::Columnar::Writer::WriteToStream(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream)
+{
+    if (m_pByteStream != nullptr)
+    {
+        // The previous file is completed before switching
+        if (auto hr = Flush(); FAILED(hr))
+            Log::Error(L"Failed to write pending rows to columnar file [{}]", SystemError(hr));
+
+        if (auto hr = WriteFooter(); FAILED(hr))
+            Log::Error(L"Failed to write columnar file footer [{}]", SystemError(hr));
+
+        if (m_bCloseStream)
+            m_pByteStream->Close();
+    }
+
+    m_pByteStream = pStream;
+    m_bCloseStream = bCloseStream;
+    m_bHeaderWritten = false;
+    m_offset = 0LLU;
+    m_rowCount = 0LLU;
+    m_blockOffsets.clear();
+
+    // Dictionary indexes are only valid within a file
+    for (auto& dictionary : m_dictionaries)
+    {
+        dictionary.Values.Clear();
+        dictionary.bFull = false;
+    }
+
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::Columnar::Writer::SetSchema(const Schema& columns)
+{
+    if (!columns)
+        return E_INVALIDARG;
+
+    if (m_bHeaderWritten)
+    {
+        Log::Error(L"Cannot change the schema of a columnar file once rows were written");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+    }
+
+    m_Schema = columns;
+    m_dictionaries.clear();
+    m_dictionaries.resize(m_Schema.size());
+
+    return m_block.SetSchema(columns, m_Options->dwBlockRows);
+}
+
+STDMETHODIMP Orc::TableOutput::Columnar::Writer::WriteBatch(const RecordBatch& batch)
+{
+    if (batch.ColumnCount() != m_Schema.size())
+    {
+        Log::Error(
+            L"Batch has {} columns, columnar file has {} columns", batch.ColumnCount(), m_Schema.size());
+        return E_INVALIDARG;
+    }
+
+    // Rows written one by one come first
+    if (auto hr = Flush(); FAILED(hr))
+        return hr;
+
+    for (size_t first = 0; first < batch.RowCount(); first += m_Options->dwBlockRows)
+    {
+        const auto count = std::min<size_t>(batch.RowCount() - first, m_Options->dwBlockRows);
+        if (auto hr = WriteBlock(batch, first, count); FAILED(hr))
+            return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteEndOfLine()
+{
+    if (auto hr = m_block.WriteEndOfLine(); FAILED(hr))
+        return hr;
+
+    if (m_block.RowCount() >= m_Options->dwBlockRows)
+        return Flush();
+
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::Columnar::Writer::Flush()
+{
+    if (m_block.empty())
+        return S_OK;
+
+    auto hr = WriteBlock(m_block, 0, m_block.RowCount());
+    m_block.Clear();
+    return hr;
+}
+
+STDMETHODIMP Orc::TableOutput::Columnar::Writer::Close()
+{
+    if (m_pTermination)
+    {
+        Robustness::RemoveTerminationHandler(m_pTermination);
+        m_pTermination = nullptr;
+    }
+
+    if (m_pByteStream == nullptr)
+        return S_OK;
+
+    if (auto hr = Flush(); FAILED(hr))
+        Log::Error(L"Failed to write pending rows to columnar file [{}]", SystemError(hr));
+
+    auto hr = WriteFooter();
+    if (FAILED(hr))
+        Log::Error(L"Failed to write columnar file footer [{}]", SystemError(hr));
+
+    if (m_bCloseStream)
+        m_pByteStream->Close();
+
+    m_pByteStream = nullptr;
+    return hr;
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::Write(const std::vector<uint8_t>& buffer)
+{
+    if (m_pByteStream == nullptr)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+
+    ULONGLONG cbWritten = 0;
+    if (auto hr = m_pByteStream->Write(const_cast<uint8_t*>(buffer.data()), buffer.size(), &cbWritten); FAILED(hr))
+        return hr;
+
+    if (cbWritten != buffer.size())
+        return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+
+    m_offset += cbWritten;
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteFileHeader()
+{
+    m_buffer.clear();
+
+    FileHeader header = {};
+    std::copy(std::cbegin(kMagic), std::cend(kMagic), header.Magic);
+    header.Version = kVersion;
+    header.ColumnCount = static_cast<uint32_t>(m_Schema.size());
+    Append(m_buffer, header);
+    Pad(m_buffer);
+
+    std::string name;
+    for (const auto& column : m_Schema)
+    {
+        name.clear();
+        Text::AppendUtf16ToUtf8(column->ColumnName, name);
+
+        ColumnHeader columnHeader = {};
+        columnHeader.Type = static_cast<uint32_t>(column->Type);
+        columnHeader.FixedWidth = static_cast<uint32_t>(BatchColumn(*column).FixedWidth());
+        columnHeader.NameSize = static_cast<uint32_t>(name.size());
+        Append(m_buffer, columnHeader);
+        Append(m_buffer, name.data(), name.size());
+        Pad(m_buffer);
+    }
+
+    if (auto hr = Write(m_buffer); FAILED(hr))
+    {
+        Log::Error(L"Failed to write columnar file header [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_bHeaderWritten = true;
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteBlock(const RecordBatch& batch, size_t first, size_t count)
+{
+    if (!m_bHeaderWritten)
+    {
+        if (auto hr = WriteFileHeader(); FAILED(hr))
+            return hr;
+    }
+
+    m_buffer.clear();
+    Append(m_buffer, BlockHeader {});
+
+    for (size_t i = 0; i < batch.ColumnCount(); i++)
+    {
+        EncodeChunk(batch[i], m_dictionaries[i], first, count);
+    }
+
+    BlockHeader header = {};
+    header.RowCount = count;
+    header.Size = m_buffer.size();
+    memcpy(m_buffer.data(), &header, sizeof(header));
+
+    const auto offset = m_offset;
+    if (auto hr = Write(m_buffer); FAILED(hr))
+    {
+        Log::Error(L"Failed to write columnar file block [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_blockOffsets.push_back(offset);
+    m_rowCount += count;
+    return S_OK;
+}
+
+void Orc::TableOutput::Columnar::Writer::EncodeChunk(
+    const BatchColumn& column,
+    Dictionary& dictionary,
+    size_t first,
+    size_t count)
+{
+    using Storage = BatchColumn::Storage;
+
+    const auto headerOffset = m_buffer.size();
+    Append(m_buffer, ChunkHeader {});
+
+    ChunkHeader header = {};
+
+    const auto pValid = column.Validity() + first;
+    Append(m_buffer, pValid, count);
+    Pad(m_buffer);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!pValid[i])
+            header.NullCount++;
+    }
+
+    switch (column.GetStorage())
+    {
+        case Storage::Null:
+            header.Encoding = static_cast<uint32_t>(Encoding::Null);
+            break;
+
+        case Storage::Integer: {
+            header.Encoding = static_cast<uint32_t>(Encoding::Integer);
+
+            const auto pValues = column.Integers() + first;
+            Append(m_buffer, pValues, count * sizeof(int64_t));
+
+            bool bFirst = true;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!pValid[i])
+                    continue;
+
+                if (bFirst)
+                {
+                    header.Min = header.Max = pValues[i];
+                    bFirst = false;
+                }
+                else
+                {
+                    header.Min = std::min(header.Min, pValues[i]);
+                    header.Max = std::max(header.Max, pValues[i]);
+                }
+            }
+            break;
+        }
+
+        case Storage::FixedBytes:
+            header.Encoding = static_cast<uint32_t>(Encoding::Fixed);
+            Append(m_buffer, column.Bytes() + first * column.FixedWidth(), count * column.FixedWidth());
+            Pad(m_buffer);
+            break;
+
+        case Storage::Bytes:
+        case Storage::WideChars: {
+            if (!dictionary.bFull && dictionary.Values.IsFull())
+            {
+                Log::Debug(
+                    L"Columnar: dictionary of column '{}' is full, switching to plain values",
+                    column.Definition().ColumnName);
+
+                dictionary.Values.Clear();
+                dictionary.bFull = true;
+            }
+
+            if (dictionary.bFull)
+            {
+                header.Encoding = static_cast<uint32_t>(Encoding::Plain);
+
+                uint32_t offset = 0;
+                Append(m_buffer, offset);
+                for (size_t i = 0; i < count; i++)
+                {
+                    offset += static_cast<uint32_t>(ValueAt(column, first + i).size());
+                    Append(m_buffer, offset);
+                }
+
+                for (size_t i = 0; i < count; i++)
+                {
+                    const auto value = ValueAt(column, first + i);
+                    Append(m_buffer, value.data(), value.size());
+                }
+                Pad(m_buffer);
+                break;
+            }
+
+            header.Encoding = static_cast<uint32_t>(Encoding::Dictionary);
+            header.DictionaryBase = static_cast<uint32_t>(dictionary.Values.size());
+
+            std::vector<uint32_t> indexes(count, kNullIndex);
+            for (size_t i = 0; i < count; i++)
+            {
+                if (!pValid[i])
+                    continue;
+
+                indexes[i] = dictionary.Values.Insert(ValueAt(column, first + i)).first;
+            }
+
+            header.DictionaryCount = static_cast<uint32_t>(dictionary.Values.size()) - header.DictionaryBase;
+
+            uint32_t offset = 0;
+            for (auto i = header.DictionaryBase; i < header.DictionaryBase + header.DictionaryCount; i++)
+            {
+                offset += static_cast<uint32_t>(dictionary.Values[i].size());
+                Append(m_buffer, offset);
+            }
+
+            for (auto i = header.DictionaryBase; i < header.DictionaryBase + header.DictionaryCount; i++)
+            {
+                Append(m_buffer, dictionary.Values[i].data(), dictionary.Values[i].size());
+            }
+            Pad(m_buffer);
+
+            Append(m_buffer, indexes.data(), indexes.size() * sizeof(uint32_t));
+            Pad(m_buffer);
+            break;
+        }
+    }
+
+    header.Size = m_buffer.size() - headerOffset - sizeof(ChunkHeader);
+    memcpy(m_buffer.data() + headerOffset, &header, sizeof(header));
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteFooter()
+{
+    if (!m_bHeaderWritten)
+    {
+        if (auto hr = WriteFileHeader(); FAILED(hr))
+            return hr;
+    }
+
+    m_buffer.clear();
+    Append(m_buffer, m_blockOffsets.data(), m_blockOffsets.size() * sizeof(uint64_t));
+
+    FileTrailer trailer = {};
+    trailer.BlockCount = m_blockOffsets.size();
+    trailer.RowCount = m_rowCount;
+    trailer.BlockOffsets = m_offset;
+    std::copy(std::cbegin(kMagic), std::cend(kMagic), trailer.Magic);
+    Append(m_buffer, trailer);
+
+    return Write(m_buffer);
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return m_block.WriteString(buffer.size() > 0 ? std::wstring_view(buffer.get(), buffer.size()) : L""sv);
+}
+
+HRESULT Orc::TableOutput::Columnar::Writer::WriteFormated_(std::string_view szFormat, fmt::format_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<CHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return m_block.WriteString(buffer.size() > 0 ? std::string_view(buffer.get(), buffer.size()) : ""sv);
+}
@@ -0,0 +1,249 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutputWriter.h"
+#include "TableOutputBatch.h"
+#include "TableOutputDictionary.h"
+
+#include <vector>
+
+#pragma managed(push, off)
+
+//
+// Columnar: native table file, written without encoding work so that tools pay almost nothing for it and meant to be
+// memory mapped by the analysis side.
+//
+// All integers are little endian and every section starts on an 8 bytes boundary:
+//
+//   FileHeader, then for each column: ColumnHeader followed by its UTF-8 name
+//   Blocks of up to 'BlockRows' rows: BlockHeader, then for each column: ChunkHeader, one validity byte per row and
+//   the values of the chunk
+//   Offsets (uint64_t) of every block, then the FileTrailer at the very end of the file
+//
+// Chunk values by encoding:
+//   Integer:     int64_t per row: integers, sizes, FRNs, enums, flags and timestamps (FILETIME)
+//   Fixed:       'FixedWidth' bytes per row (GUID, fixed size binary)
+//   Dictionary:  the entries added to the column dictionary by this block ('DictionaryCount' uint32_t end offsets
+//                then the bytes), then one uint32_t dictionary index per row. Indexes are global to the file.
+//   Plain:       'RowCount + 1' uint32_t offsets then the bytes, once the dictionary of a column is full
+//
+// Text is stored as written: UTF-8 for UTF8Type, UTF-16LE for UTF16Type and XMLType.
+//
+namespace Orc::TableOutput::Columnar {
+
+// A column falls back to plain chunks when its dictionary gets larger than this
+constexpr size_t kMaxDictionaryEntries = 1 << 20;
+constexpr size_t kMaxDictionaryBytes = 64 * 1024 * 1024;
+
+enum class Encoding : uint32_t
+{
+    Null = 0,
+    Integer,
+    Fixed,
+    Dictionary,
+    Plain
+};
+
+#pragma pack(push, 1)
+
+struct FileHeader
+{
+    char Magic[8];  // kMagic
+    uint32_t Version;
+    uint32_t ColumnCount;
+};
+
+struct ColumnHeader
+{
+    uint32_t Type;  // TableOutput::ColumnType
+    uint32_t FixedWidth;
+    uint32_t NameSize;  // bytes of the UTF-8 name following this header, padded to 8
+    uint32_t Reserved;
+};
+
+struct BlockHeader
+{
+    uint64_t RowCount;
+    uint64_t Size;  // from this header to the next block
+};
+
+struct ChunkHeader
+{
+    uint32_t Encoding;
+    uint32_t NullCount;
+    uint64_t Size;  // from the end of this header to the next chunk
+    int64_t Min;  // over non null values of Integer chunks, zero otherwise
+    int64_t Max;
+    uint32_t DictionaryBase;  // index of the first entry added by this block
+    uint32_t DictionaryCount;
+};
+
+struct FileTrailer
+{
+    uint64_t BlockCount;
+    uint64_t RowCount;
+    uint64_t BlockOffsets;  // file offset of the block offsets array
+    char Magic[8];  // kMagic
+};
+
+#pragma pack(pop)
+
+constexpr char kMagic[8] = {'D', 'F', 'I', 'R', 'C', 'O', 'L', '1'};
+constexpr uint32_t kVersion = 1;
+
+class WriterTermination;
+
+class Writer : public ::Orc::TableOutput::IStreamWriter
+{
+public:
+    static std::shared_ptr<Writer> MakeNew(std::unique_ptr<TableOutput::Options>&& options);
+
+    Writer(const Writer&) = delete;
+
+    virtual ~Writer();
+
+    STDMETHOD(WriteToFile)(const std::filesystem::path& path) override final;
+    STDMETHOD(WriteToFile)(const WCHAR* szFileName) override final;
+    STDMETHOD(WriteToStream)(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream = true) override final;
+
+    std::shared_ptr<ByteStream> GetStream() const override final { return m_pByteStream; }
+
+    STDMETHOD(SetSchema)(const Schema& columns) override final;
+    STDMETHOD(WriteBatch)(const RecordBatch& batch) override final;
+
+    STDMETHOD(Flush)() override final;
+    STDMETHOD(Close)() override final;
+
+    // Rows written one value at a time are gathered in a block
+    virtual DWORD GetCurrentColumnID() override final { return m_block.GetCurrentColumnID(); }
+    virtual const Column& GetCurrentColumn() override final { return m_block.GetCurrentColumn(); }
+
+    STDMETHOD(WriteNothing)() override final { return m_block.WriteNothing(); }
+
+    STDMETHOD(WriteString)(const std::wstring& strString) override final { return m_block.WriteString(strString); }
+    STDMETHOD(WriteString)(std::wstring_view strString) override final { return m_block.WriteString(strString); }
+    STDMETHOD(WriteString)(const WCHAR* szString) override final { return m_block.WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_block.WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteString)(const std::string& strString) override final { return m_block.WriteString(strString); }
+    STDMETHOD(WriteString)(std::string_view strString) override final { return m_block.WriteString(strString); }
+    STDMETHOD(WriteString)(const CHAR* szString) override final { return m_block.WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_block.WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteAttributes)(DWORD dwAttibutes) override final { return m_block.WriteAttributes(dwAttibutes); }
+
+    STDMETHOD(WriteFileTime)(FILETIME fileTime) override final { return m_block.WriteFileTime(fileTime); }
+    STDMETHOD(WriteFileTime)(LONGLONG fileTime) override final { return m_block.WriteFileTime(fileTime); }
+    STDMETHOD(WriteTimeStamp)(time_t tmStamp) override final { return m_block.WriteTimeStamp(tmStamp); }
+    STDMETHOD(WriteTimeStamp)(tm tmStamp) override final { return m_block.WriteTimeStamp(tmStamp); }
+
+    STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final { return m_block.WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return m_block.WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final
+    {
+        return m_block.WriteFileSize(nFileSizeHigh, nFileSizeLow);
+    }
+
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return m_block.WriteInteger(dwInteger); }
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return m_block.WriteInteger(dw64Integer); }
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return m_block.WriteInteger(dw64Integer); }
+
+    STDMETHOD(WriteBytes)(const BYTE pBytes[], DWORD dwLen) override final { return m_block.WriteBytes(pBytes, dwLen); }
+    STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final { return m_block.WriteBytes(Buffer); }
+
+    STDMETHOD(WriteBool)(bool bBoolean) override final { return m_block.WriteBool(bBoolean); }
+
+    STDMETHOD(WriteEnum)(DWORD dwEnum) override final { return m_block.WriteEnum(dwEnum); }
+    STDMETHOD(WriteEnum)(DWORD dwEnum, const WCHAR* EnumValues[]) override final
+    {
+        return m_block.WriteEnum(dwEnum, EnumValues);
+    }
+
+    STDMETHOD(WriteFlags)(DWORD dwFlags) override final { return m_block.WriteFlags(dwFlags); }
+    STDMETHOD(WriteFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator) override final
+    {
+        return m_block.WriteFlags(dwFlags, FlagValues, cSeparator);
+    }
+
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags) override final { return m_block.WriteExactFlags(dwFlags); }
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[]) override final
+    {
+        return m_block.WriteExactFlags(dwFlags, FlagValues);
+    }
+
+    STDMETHOD(WriteGUID)(const GUID& guid) override final { return m_block.WriteGUID(guid); }
+
+    STDMETHOD(WriteXML)(const WCHAR* szString) override final { return m_block.WriteXML(szString); }
+    STDMETHOD(WriteXML)(const CHAR* szString) override final { return m_block.WriteXML(szString); }
+    STDMETHOD(WriteXML)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_block.WriteXML(szArray, dwCharCount);
+    }
+    STDMETHOD(WriteXML)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_block.WriteXML(szArray, dwCharCount);
+    }
+
+    STDMETHOD(AbandonRow)() override final { return m_block.AbandonRow(); }
+    STDMETHOD(AbandonColumn)() override final { return m_block.AbandonColumn(); }
+
+    virtual HRESULT WriteEndOfLine() override final;
+
+protected:
+    Writer(std::unique_ptr<Options>&& options);
+
+    HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
+    HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
+
+    // Strings already seen in a column, keyed by their bytes as stored in the file
+    struct Dictionary
+    {
+        StringDictionary Values {kMaxDictionaryEntries, kMaxDictionaryBytes};
+        bool bFull = false;
+    };
+
+    HRESULT WriteFileHeader();
+    HRESULT WriteBlock(const RecordBatch& batch, size_t first, size_t count);
+    HRESULT WriteFooter();
+
+    void EncodeChunk(const BatchColumn& column, Dictionary& dictionary, size_t first, size_t count);
+
+    HRESULT Write(const std::vector<uint8_t>& buffer);
+
+    std::unique_ptr<Options> m_Options;
+    std::shared_ptr<WriterTermination> m_pTermination;
+
+    Schema m_Schema;
+    RecordBatch m_block;
+    std::vector<Dictionary> m_dictionaries;
+
+    std::shared_ptr<ByteStream> m_pByteStream;
+    bool m_bCloseStream = true;
+    bool m_bHeaderWritten = false;
+
+    uint64_t m_offset = 0LLU;
+    uint64_t m_rowCount = 0LLU;
+    std::vector<uint64_t> m_blockOffsets;
+
+    // Reused for every block
+    std::vector<uint8_t> m_buffer;
+};
+
+}  // namespace Orc::TableOutput::Columnar
+
+#pragma managed(pop)
@@ -26,6 +26,7 @@
 #include "Robustness.h"
 
 #include <array>
+#include <atomic>
 #include <boost/algorithm/string.hpp>
 
 #include "Log/Log.h"
@@ -194,11 +195,11 @@ std::shared_ptr<ProcessRedirect>
 CommandAgent::PrepareRedirection(const shared_ptr<CommandExecute>& cmd, const CommandParameter& output)
 {
     HRESULT hr = E_FAIL;
-    DBG_UNREFERENCED_PARAMETER(cmd);
 
     std::shared_ptr<ProcessRedirect> retval;
 
     auto stream = std::make_shared<TemporaryStream>();
+    stream->SetBudgetTag(cmd->GetKeyword());
 
     if (FAILED(hr = stream->Open(m_TempDir, L"CommandRedirection", 4 * 1024 * 1024)))
     {
@@ -220,14 +221,25 @@ CommandAgent::PrepareRedirection(const shared_ptr<CommandExecute>& cmd, const Co
                 stream,
                 false);
             break;
+        case CommandParameter::OutPipe:
+            retval = ProcessRedirect::MakeRedirect(ProcessRedirect::OutputFile, stream, false);
+            break;
         default:
             break;
     }
 
+    // The child opens output file pipes by name, which must be unique
+    std::wstring strSuffix = output.Keyword;
+    if (output.Kind == CommandParameter::OutPipe)
+    {
+        static std::atomic<ULONG> ulPipeCount {0L};
+        strSuffix = fmt::format(L"{}_{}_{}", output.Keyword, GetCurrentProcessId(), ulPipeCount++);
+    }
+
     if (retval)
     {
         HRESULT hr2 = E_FAIL;
-        if (FAILED(hr2 = retval->CreatePipe(output.Keyword.c_str())))
+        if (FAILED(hr2 = retval->CreatePipe(strSuffix.c_str())))
         {
             Log::Error("Could not create pipe for process redirection [{}]", SystemError(hr2));
             return nullptr;
@@ -396,7 +408,8 @@ std::shared_ptr<CommandExecute> CommandAgent::PrepareCommandExecute(const std::s
     for (const auto& parameter : message->GetParameters())
     {
         std::wstring pattern;
-        if (parameter.Kind == CommandParameter::ParamKind::OutFile
+        if ((parameter.Kind == CommandParameter::ParamKind::OutFile
+             || parameter.Kind == CommandParameter::ParamKind::OutPipe)
             && ParseCommandLineArgumentValue(parameter.Pattern, L"out", pattern))
         {
             std::filesystem::path filename = parameter.Name;
@@ -478,6 +491,42 @@ std::shared_ptr<CommandExecute> CommandAgent::PrepareCommandExecute(const std::s
                     }
                 }
                 break;
+                case CommandParameter::OutPipe: {
+                    wstring strInterpretedName;
+
+                    if (FAILED(hr = GetOutputFile(parameter.Name.c_str(), strInterpretedName)))
+                    {
+                        Log::Error(L"GetOutputFile failed, skipping pipe '{}' [{}]", parameter.Name, SystemError(hr));
+                        return;
+                    }
+
+                    wstring strFileName;
+
+                    if (FAILED(hr = ApplyPattern(strInterpretedName, L"", L"", strFileName)))
+                    {
+                        Log::Error(L"Failed to apply pattern on '{}' [{}]", parameter.Name, SystemError(hr));
+                        return;
+                    }
+
+                    auto redir = PrepareRedirection(retval, parameter);
+                    if (!redir)
+                    {
+                        hr = E_FAIL;
+                        return;
+                    }
+
+                    // The output is archived from memory (or the temporary budget's spill file) when complete
+                    retval->AddRedirection(redir);
+                    retval->AddOnCompleteAction(make_shared<OnComplete>(
+                        OnComplete::ArchiveAndDelete, strFileName, redir->GetStream(), &m_archive));
+
+                    wstring Arg;
+                    if (FAILED(hr = ApplyPattern(parameter.Pattern, parameter.Keyword, redir->PipeName(), Arg)))
+                        return;
+                    if (!Arg.empty())
+                        retval->AddArgument(Arg, parameter.OrderId);
+                }
+                break;
                 case CommandParameter::OutTempFile: {
                     // I don't really know if we need those...
                 }
@@ -784,6 +833,7 @@ HRESULT CommandAgent::MoveCompletedCommand(const std::shared_ptr<CommandExecute>
     Concurrency::critical_section::scoped_lock s(m_cs);
 
     m_CompletedCommands.push_back(command);
+    m_Scheduler.Complete(command->GetKeyword());
 
     std::for_each(m_RunningCommands.begin(), m_RunningCommands.end(), [command](std::shared_ptr<CommandExecute>& item) {
         if (item)
@@ -798,80 +848,104 @@ HRESULT CommandAgent::ExecuteNextCommand()
 {
     HRESULT hr = E_FAIL;
 
-    if (!m_MaximumRunningSemaphore.TryAcquire())
-        return S_OK;
-
-    std::shared_ptr<CommandExecute> command;
-
+    // Start as many commands as the semaphore and their declared resources allow
+    for (;;)
     {
-        Concurrency::critical_section::scoped_lock lock(m_cs);
+        if (!m_MaximumRunningSemaphore.TryAcquire())
+            return S_OK;
+
+        std::shared_ptr<CommandExecute> command;
 
-        if (!m_CommandQueue.try_pop(command))
         {
-            // nothing queued, release the semaphore
-            command = nullptr;
-            m_MaximumRunningSemaphore.Release();
+            Concurrency::critical_section::scoped_lock lock(m_cs);
+
+            if (auto runnable = m_Scheduler.PopRunnable(m_bStopping))
+            {
+                command = std::move(*runnable);
+            }
+            else
+            {
+                // nothing runnable, release the semaphore
+                m_MaximumRunningSemaphore.Release();
+
+                if (m_Scheduler.IsStalled(m_bStopping))
+                {
+                    for (const auto& [keyword, cmd] : m_Scheduler.Clear())
+                    {
+                        Log::Critical(L"Command '{}' canceled, its dependencies cannot complete", keyword);
+                    }
+                }
+                return S_OK;
+            }
         }
+
+        if (FAILED(hr = ExecuteCommand(command)))
+            return hr;
     }
+}
+
+HRESULT CommandAgent::ExecuteCommand(const std::shared_ptr<CommandExecute>& command)
+{
+    HRESULT hr = E_FAIL;
 
-    if (command)
+    hr = command->CreateChildProcess(m_Job, m_bWillRequireBreakAway);
+    if (FAILED(hr))
     {
-        hr = command->CreateChildProcess(m_Job, m_bWillRequireBreakAway);
-        if (FAILED(hr))
-        {
-            m_MaximumRunningSemaphore.Release();
-            command->CompleteExecution();
-            return S_OK;
-        }
+        m_MaximumRunningSemaphore.Release();
+        command->CompleteExecution();
 
-        {
-            Concurrency::critical_section::scoped_lock s(m_cs);
-            m_RunningCommands.push_back(command);
-        }
+        Concurrency::critical_section::scoped_lock s(m_cs);
+        m_Scheduler.Complete(command->GetKeyword());
+        return S_OK;
+    }
 
-        if (command->GetTimeout().has_value() && command->GetTimeout()->count() != 0)
-        {
-            auto timer = std::make_shared<Concurrency::timer<CommandMessage::Message>>(
-                (unsigned int)command->GetTimeout()->count(),
-                CommandMessage::MakeAbortMessage(command->GetKeyword(), command->ProcessID(), command->ProcessHandle()),
-                static_cast<CommandMessage::ITarget*>(&m_cmdAgentBuffer));
+    {
+        Concurrency::critical_section::scoped_lock s(m_cs);
+        m_RunningCommands.push_back(command);
+    }
 
-            command->SetTimeoutTimer(timer);
-            timer->start();
-        }
+    if (command->GetTimeout().has_value() && command->GetTimeout()->count() != 0)
+    {
+        auto timer = std::make_shared<Concurrency::timer<CommandMessage::Message>>(
+            (unsigned int)command->GetTimeout()->count(),
+            CommandMessage::MakeAbortMessage(command->GetKeyword(), command->ProcessID(), command->ProcessHandle()),
+            static_cast<CommandMessage::ITarget*>(&m_cmdAgentBuffer));
 
-        // Register a callback that will handle process termination (release semaphore, notify, etc...)
-        HANDLE hWaitObject = INVALID_HANDLE_VALUE;
-        CompletionBlock* pBlockPtr = (CompletionBlock*)Concurrency::Alloc(sizeof(CompletionBlock));
-        CompletionBlock* pBlock = new (pBlockPtr) CompletionBlock;
-        pBlock->pAgent = this;
-        pBlock->command = command;
-
-        if (!RegisterWaitForSingleObject(
-                &hWaitObject,
-                command->ProcessHandle(),
-                WaitOrTimerCallbackFunction,
-                pBlock,
-                INFINITE,
-                WT_EXECUTEDEFAULT | WT_EXECUTEONLYONCE))
-        {
-            hr = HRESULT_FROM_WIN32(GetLastError());
-            Log::Error(L"Could not register for process '{}' termination [{}]", command->GetKeyword(), SystemError(hr));
-            return hr;
-        }
+        command->SetTimeoutTimer(timer);
+        timer->start();
+    }
 
-        auto notification = CommandNotification::NotifyCreated(command->GetKeyword(), command->ProcessID());
+    // Register a callback that will handle process termination (release semaphore, notify, etc...)
+    HANDLE hWaitObject = INVALID_HANDLE_VALUE;
+    CompletionBlock* pBlockPtr = (CompletionBlock*)Concurrency::Alloc(sizeof(CompletionBlock));
+    CompletionBlock* pBlock = new (pBlockPtr) CompletionBlock;
+    pBlock->pAgent = this;
+    pBlock->command = command;
+
+    if (!RegisterWaitForSingleObject(
+            &hWaitObject,
+            command->ProcessHandle(),
+            WaitOrTimerCallbackFunction,
+            pBlock,
+            INFINITE,
+            WT_EXECUTEDEFAULT | WT_EXECUTEONLYONCE))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Could not register for process '{}' termination [{}]", command->GetKeyword(), SystemError(hr));
+        return hr;
+    }
 
-        notification->SetOriginFriendlyName(command->GetOriginFriendlyName());
-        notification->SetOriginResourceName(command->GetOriginResourceName());
-        notification->SetExecutableSha1(command->GetExecutableSha1());
-        notification->SetOrcTool(command->GetOrcTool());
-        notification->SetIsSelfOrcExecutable(command->IsSelfOrcExecutable());
-        notification->SetProcessHandle(command->ProcessHandle());
-        notification->SetProcessCommandLine(command->m_commandLine);
+    auto notification = CommandNotification::NotifyCreated(command->GetKeyword(), command->ProcessID());
 
-        SendResult(notification);
-    }
+    notification->SetOriginFriendlyName(command->GetOriginFriendlyName());
+    notification->SetOriginResourceName(command->GetOriginResourceName());
+    notification->SetExecutableSha1(command->GetExecutableSha1());
+    notification->SetOrcTool(command->GetOrcTool());
+    notification->SetIsSelfOrcExecutable(command->IsSelfOrcExecutable());
+    notification->SetProcessHandle(command->ProcessHandle());
+    notification->SetProcessCommandLine(command->m_commandLine);
+
+    SendResult(notification);
 
     return S_OK;
 }
@@ -1248,7 +1322,17 @@ void CommandAgent::run()
                 {
                     auto command = PrepareCommandExecute(request);
 
-                    m_CommandQueue.push(command);
+                    Concurrency::critical_section::scoped_lock s(m_cs);
+                    if (command)
+                    {
+                        m_Scheduler.Push(
+                            command->GetKeyword(), command, {request->GetResources(), request->GetDependencies()});
+                    }
+                    else
+                    {
+                        // Do not leave its dependents waiting
+                        m_Scheduler.Complete(request->Keyword());
+                    }
                 }
                 else
                 {
@@ -1341,11 +1425,7 @@ void CommandAgent::run()
                 m_bStopping = true;
                 {
                     Concurrency::critical_section::scoped_lock lock(m_cs);
-
-                    std::shared_ptr<CommandExecute> cmd;
-                    while (m_CommandQueue.try_pop(cmd))
-                    {
-                    }
+                    m_Scheduler.Clear();
                 }
                 if (!TerminateJobObject(m_Job.GetHandle(), (UINT)-1))
                 {
@@ -1360,10 +1440,9 @@ void CommandAgent::run()
                 m_bStopping = true;
                 {
                     Concurrency::critical_section::scoped_lock lock(m_cs);
-                    std::shared_ptr<CommandExecute> cmd;
-                    while (m_CommandQueue.try_pop(cmd))
+                    for (const auto& [keyword, cmd] : m_Scheduler.Clear())
                     {
-                        Log::Info(L"Canceling command {}", cmd->GetKeyword());
+                        Log::Info(L"Canceling command {}", keyword);
                     }
                 }
                 SendResult(CommandNotification::NotifyCanceled());
@@ -1396,7 +1475,7 @@ void CommandAgent::run()
             Log::Error(L"Failed to execute next command [{}]", SystemError(hr));
         }
 
-        if (m_bStopping && m_RunningCommands.size() == 0 && m_CommandQueue.empty())
+        if (m_bStopping && m_RunningCommands.size() == 0 && m_Scheduler.Empty())
         {
             // delete temporary resources
             m_Resources.DeleteTemporaryResources();
@@ -14,15 +14,15 @@
 #include "ArchiveMessage.h"
 
 #include "CommandAgentResources.h"
+#include "CommandScheduler.h"
 #include "JobObject.h"
 
 #include <optional>
+#include <thread>
 #include <vector>
 
 #include <agents.h>
 
-#include <concurrent_queue.h>
-
 #pragma managed(push, off)
 
 auto constexpr DEFAULT_MAX_RUNNING_PROCESSES = 20;
@@ -88,6 +88,7 @@ public:
         , m_MaximumRunningSemaphore(max_running_tasks)
         , m_Resources()
     {
+        m_Scheduler.SetCapacity(L"cpu", std::thread::hardware_concurrency());
     }
 
     static HRESULT ApplyPattern(
@@ -140,7 +141,8 @@ protected:
 
     Concurrency::critical_section m_cs;
 
-    Concurrency::concurrent_queue<std::shared_ptr<CommandExecute>> m_CommandQueue;
+    // Protected by m_cs
+    CommandScheduler<std::shared_ptr<CommandExecute>> m_Scheduler;
     std::vector<std::shared_ptr<CommandExecute>> m_RunningCommands;
     std::vector<std::shared_ptr<CommandExecute>> m_CompletedCommands;
 
@@ -159,6 +161,7 @@ protected:
     void StartCommandExecute(const std::shared_ptr<CommandMessage>& message);
 
     HRESULT ExecuteNextCommand();
+    HRESULT ExecuteCommand(const std::shared_ptr<CommandExecute>& command);
 
     static DWORD WINAPI JobObjectNotificationRoutine(__in LPVOID lpParameter);
     static VOID CALLBACK WaitOrTimerCallbackFunction(__in PVOID lpParameter, __in BOOLEAN TimerOrWaitFired);
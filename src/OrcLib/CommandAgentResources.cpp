@@ -10,6 +10,7 @@
 #include "CommandAgentResources.h"
 
 #include "EmbeddedResource.h"
+#include "ExtractionCache.h"
 
 #include "Temporary.h"
 
@@ -27,6 +28,17 @@ HRESULT CommandAgentResources::ExtractResource(
 
     if (EmbeddedResource::IsResourceBased(strRef))
     {
+        hr = ExtractionCache::Instance().ExtractToFile(strRef, strKeyword, RESSOURCE_READ_EXECUTE_BA, strExtracted);
+        if (hr == S_OK)
+        {
+            m_CachedResources.insert(strRef);
+            return S_OK;
+        }
+        else if (FAILED(hr))
+        {
+            Log::Warn(L"Failed to extract resource '{}' to the extraction cache [{}]", strRef, SystemError(hr));
+        }
+
         hr = EmbeddedResource::ExtractToFile(
             strRef, strKeyword, RESSOURCE_READ_EXECUTE_BA, m_strTempDirectory, strExtracted);
         if (FAILED(hr))
@@ -80,6 +92,12 @@ HRESULT CommandAgentResources::DeleteTemporaryResource(const std::wstring& strRe
         return S_OK;  // Nothing to delete here
     }
 
+    if (m_CachedResources.find(strRef) != end(m_CachedResources))
+    {
+        Log::Debug(L"Resource '{}' is shared in the extraction cache", strRef);
+        return S_OK;
+    }
+
     if (!it->second.empty())
     {
         Log::Debug(L"No temporary file associated with '{}'", strRef);
@@ -101,6 +119,9 @@ HRESULT CommandAgentResources::DeleteTemporaryResources()
         begin(m_TempResources), end(m_TempResources), [this](const std::pair<std::wstring, std::wstring>& item) {
             HRESULT hr = E_FAIL;
 
+            if (m_CachedResources.find(item.first) != end(m_CachedResources))
+                return;
+
             if (FAILED(hr = UtilDeleteTemporaryFile(item.second.c_str())))
             {
                 Log::Error(
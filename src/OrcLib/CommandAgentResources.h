@@ -8,6 +8,7 @@
 #pragma once
 
 #include <map>
+#include <set>
 #include <boost/logic/tribool.hpp>
 
 #include "OrcLib.h"
@@ -23,6 +24,7 @@ class CommandAgentResources
 private:
     std::wstring m_strTempDirectory;
     std::map<std::wstring, std::wstring, CaseInsensitive> m_TempResources;
+    std::set<std::wstring, CaseInsensitive> m_CachedResources;  // shared extractions, not deleted
 
     HRESULT ExtractResource(const std::wstring& strRef, const std::wstring& strKeyword, std::wstring& strExtracted);
 
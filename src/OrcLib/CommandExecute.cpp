@@ -168,7 +168,8 @@ CommandExecute::CommandExecute(const std::wstring& Keyword)
 HRESULT CommandExecute::AddRedirection(const shared_ptr<ProcessRedirect>& redirect)
 {
     if (std::any_of(m_Redirections.begin(), m_Redirections.end(), [redirect](const shared_ptr<ProcessRedirect>& item) {
-            return redirect->Selection() & item->Selection();
+            // A command may write several output files through pipes
+            return redirect->Selection() & item->Selection() & ~ProcessRedirect::OutputFile;
         }))
     {
         Log::Error("a redirection for this handle is already added");
@@ -467,6 +468,10 @@ HRESULT CommandExecute::WaitCompletion(DWORD dwTimeOut)
                         m_Redirections.begin(),
                         m_Redirections.end(),
                         [&bCompleted](const shared_ptr<ProcessRedirect>& item) {
+                            // The process exited without opening its output file pipe
+                            if (item->Selection() & ProcessRedirect::OutputFile
+                                && item->Status() == ProcessRedirect::PipeCreated)
+                                item->Close();
                             if (item->Status() > ProcessRedirect::PipeCreated
                                 && item->Status() < ProcessRedirect::Complete)
                                 bCompleted = false;
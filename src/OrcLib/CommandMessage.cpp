@@ -175,6 +175,24 @@ CommandMessage::PushOutputFile(const LONG OrderID, const std::wstring& szName, c
     return S_OK;
 }
 
+HRESULT CommandMessage::PushOutputPipe(
+    const LONG OrderID,
+    const std::wstring& szName,
+    const std::wstring& Keyword,
+    const std::wstring& pattern,
+    bool bHash)
+{
+    CommandParameter output(CommandParameter::OutPipe);
+
+    output.OrderId = OrderID;
+    output.Name = szName;
+    output.Keyword = Keyword;
+    output.Pattern = pattern;
+    output.bHash = bHash;
+    m_Parameters.push_back(std::move(output));
+    return S_OK;
+}
+
 HRESULT CommandMessage::PushOutputDirectory(
     const LONG OrderID,
     const std::wstring& szName,
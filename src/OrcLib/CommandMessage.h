@@ -31,6 +31,7 @@ public:
         InFile,
         Argument,
         OutFile,
+        OutPipe,  // output file written through a pipe read by the agent, without temporary file
         OutTempFile,
         OutDirectory,
         StdOut,
@@ -108,6 +109,8 @@ public:
         std::swap(m_Keyword, other.m_Keyword);
         std::swap(m_Parameters, other.m_Parameters);
         std::swap(m_QueueAction, other.m_QueueAction);
+        std::swap(m_Resources, other.m_Resources);
+        std::swap(m_Dependencies, other.m_Dependencies);
         m_dwPid = other.m_dwPid;
     };
 
@@ -145,6 +148,14 @@ public:
         const std::wstring& pattern,
         bool bHash = false);
 
+    // The command writes 'szFileName' sequentially to a pipe whose path replaces the output file path in 'pattern'
+    HRESULT PushOutputPipe(
+        const LONG OrderID,
+        const std::wstring& szFileName,
+        const std::wstring& Keyword,
+        const std::wstring& pattern,
+        bool bHash = false);
+
     HRESULT PushOutputDirectory(
         const LONG OrderID,
         const std::wstring& szFileName,
@@ -200,6 +211,13 @@ public:
     void SetTimeout(std::chrono::milliseconds timeout) { m_timeout = timeout; }
     const std::optional<std::chrono::milliseconds>& GetTimeout() const { return m_timeout; }
 
+    // Resources stressed by the command ("io:C:", "cpu", "memory") and keywords of the commands to wait for
+    void SetResources(std::vector<std::wstring> resources) { m_Resources = std::move(resources); }
+    const std::vector<std::wstring>& GetResources() const { return m_Resources; }
+
+    void SetDependencies(std::vector<std::wstring> dependencies) { m_Dependencies = std::move(dependencies); }
+    const std::vector<std::wstring>& GetDependencies() const { return m_Dependencies; }
+
     const Parameters& GetParameters() { return m_Parameters; };
 
     CmdRequest Request() const { return m_Request; };
@@ -232,6 +250,9 @@ private:
     DWORD m_dwPid;
     HANDLE m_hProcess;
     std::optional<std::chrono::milliseconds> m_timeout;
+
+    std::vector<std::wstring> m_Resources;
+    std::vector<std::wstring> m_Dependencies;
 };
 
 }  // namespace Orc
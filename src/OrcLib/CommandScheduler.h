@@ -0,0 +1,187 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Order queued commands by the resources they declare and the commands they depend on.
+//
+// A resource is either a class ("cpu", "memory") or a class instance ("io:C:", "io:\\.\HarddiskVolume2"), split at
+// the first ':'. Each instance of a class can be held by as many running commands as the class capacity: "io" and
+// unknown classes default to one (commands using the same volume are serialized), "cpu" is set by the caller to the
+// processor count. Commands without requirements are only bounded by the caller.
+//
+// A dependency is the keyword of another command: the dependent waits for it to complete, whatever its outcome. Once
+// no more commands are expected, unknown dependencies are ignored.
+//
+// Not thread safe: the caller must serialize all calls.
+template <typename T>
+class CommandScheduler
+{
+public:
+    struct Requirements
+    {
+        std::vector<std::wstring> Resources;
+        std::vector<std::wstring> Dependencies;
+    };
+
+    void SetCapacity(const std::wstring& resourceClass, DWORD dwCapacity)
+    {
+        m_Capacities[resourceClass] = std::max(dwCapacity, 1UL);
+    }
+
+    DWORD Capacity(const std::wstring& resourceClass) const
+    {
+        auto it = m_Capacities.find(resourceClass);
+        if (it == std::cend(m_Capacities))
+            return 1UL;
+        return it->second;
+    }
+
+    void Push(const std::wstring& keyword, T item, Requirements requirements)
+    {
+        // A resource declared twice is used once
+        auto& resources = requirements.Resources;
+        std::sort(std::begin(resources), std::end(resources));
+        resources.erase(std::unique(std::begin(resources), std::end(resources)), std::end(resources));
+
+        m_Known.insert(keyword);
+        m_Pending.push_back({keyword, std::move(item), std::move(requirements)});
+    }
+
+    // Release 'keyword' resources if it was running and satisfy its dependents
+    void Complete(const std::wstring& keyword)
+    {
+        m_Known.insert(keyword);
+        m_Completed.insert(keyword);
+
+        auto it = m_Running.find(keyword);
+        if (it == std::end(m_Running))
+            return;
+
+        for (const auto& resource : it->second)
+        {
+            auto held = m_Held.find(resource);
+            if (held != std::end(m_Held) && --held->second == 0)
+                m_Held.erase(held);
+        }
+
+        m_Running.erase(it);
+    }
+
+    // First pending command, in queue order, whose dependencies are complete and whose resources are available
+    std::optional<T> PopRunnable(bool bNoMoreCommands)
+    {
+        for (auto it = std::begin(m_Pending); it != std::end(m_Pending); ++it)
+        {
+            if (!IsReady(it->requirements, bNoMoreCommands))
+                continue;
+
+            for (const auto& resource : it->requirements.Resources)
+                m_Held[resource]++;
+
+            m_Running.emplace(it->keyword, std::move(it->requirements.Resources));
+
+            T item = std::move(it->item);
+            m_Pending.erase(it);
+            return item;
+        }
+
+        return std::nullopt;
+    }
+
+    bool Empty() const { return m_Pending.empty(); }
+    size_t Pending() const { return m_Pending.size(); }
+    size_t Running() const { return m_Running.size(); }
+
+    // Commands left pending while none is running and none can start: a dependency cycle for instance
+    bool IsStalled(bool bNoMoreCommands) const
+    {
+        if (m_Pending.empty() || !m_Running.empty() || !bNoMoreCommands)
+            return false;
+
+        return std::none_of(std::cbegin(m_Pending), std::cend(m_Pending), [this](const Entry& entry) {
+            return IsReady(entry.requirements, true);
+        });
+    }
+
+    // Drop all the pending commands, returning them in queue order
+    std::vector<std::pair<std::wstring, T>> Clear()
+    {
+        std::vector<std::pair<std::wstring, T>> retval;
+        retval.reserve(m_Pending.size());
+
+        for (auto& entry : m_Pending)
+            retval.emplace_back(std::move(entry.keyword), std::move(entry.item));
+
+        m_Pending.clear();
+        return retval;
+    }
+
+private:
+    struct Entry
+    {
+        std::wstring keyword;
+        T item;
+        Requirements requirements;
+    };
+
+    static std::wstring ResourceClass(const std::wstring& resource)
+    {
+        return resource.substr(0, resource.find(L':'));
+    }
+
+    bool IsReady(const Requirements& requirements, bool bNoMoreCommands) const
+    {
+        for (const auto& dependency : requirements.Dependencies)
+        {
+            if (m_Completed.find(dependency) != std::cend(m_Completed))
+                continue;
+
+            if (bNoMoreCommands && m_Known.find(dependency) == std::cend(m_Known))
+                continue;
+
+            return false;
+        }
+
+        for (const auto& resource : requirements.Resources)
+        {
+            auto held = m_Held.find(resource);
+            if (held != std::cend(m_Held) && held->second >= Capacity(ResourceClass(resource)))
+                return false;
+        }
+
+        return true;
+    }
+
+    std::map<std::wstring, DWORD> m_Capacities;
+    std::map<std::wstring, DWORD> m_Held;
+
+    std::list<Entry> m_Pending;
+    std::multimap<std::wstring, std::vector<std::wstring>> m_Running;
+
+    std::set<std::wstring> m_Known;
+    std::set<std::wstring> m_Completed;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
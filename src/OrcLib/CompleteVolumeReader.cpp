@@ -10,12 +10,24 @@
 
 #include "CompleteVolumeReader.h"
 #include "ByteStream.h"
+#include "IoTrace.h"
 #include "Kernel32Extension.h"
+#include "Telemetry.h"
+#include "Trace.h"
 
 #include "Log/Log.h"
 
+#include <boost/scope_exit.hpp>
+
 using namespace Orc;
 
+namespace {
+
+// Larger reads are sequential scans (MFT, data streams) that would only flush the cache
+constexpr ULONGLONG kMaxCachedReadSize = 32 * 1024LL;
+
+}  // namespace
+
 CompleteVolumeReader::CompleteVolumeReader(const WCHAR* szLocation)
     : VolumeReader(szLocation)
 {
@@ -88,12 +100,28 @@ CompleteVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG byte
 
     concurrency::critical_section::scoped_lock sl(m_cs);
 
+    ullBytesRead = 0LL;
+    IoTrace::Instance().RecordRead(m_szLocation, offset, bytesToRead);
+    Telemetry::Scope telemetry(Telemetry::Phase::VolumeRead);
+    const auto activity = Trace::VolumeReadStart(offset, bytesToRead);
+    BOOST_SCOPE_EXIT(&telemetry, &activity, &ullBytesRead)
+    {
+        telemetry.AddBytes(ullBytesRead);
+        Trace::VolumeReadStop(activity, ullBytesRead);
+    }
+    BOOST_SCOPE_EXIT_END;
+
     // Unaligned read
     if (m_BytesPerSector == 0)
     {
         return ReadUnaligned(offset, data, bytesToRead, ullBytesRead);
     }
 
+    if (m_pBlockCache && bytesToRead <= kMaxCachedReadSize && m_pBlockCache->BlockSize() % m_BytesPerSector == 0)
+    {
+        return ReadCached(offset, data, bytesToRead, ullBytesRead);
+    }
+
     hr = Seek(offset);
     if (FAILED(hr))
     {
@@ -102,6 +130,14 @@ CompleteVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG byte
 
     const auto initialOffset = m_Extents[0].GetSeekOffset() + m_LocalPositionOffset;
 
+    // Sector aligned reads to a sector aligned buffer go straight to the caller's buffer, without the bounce copy
+    if (m_LocalPositionOffset == 0 && bytesToRead % m_BytesPerSector == 0 && bytesToRead <= MAXDWORD
+        && data.CheckCount(static_cast<size_t>(bytesToRead))
+        && reinterpret_cast<ULONG_PTR>(data.GetData()) % m_BytesPerSector == 0)
+    {
+        return ReadDirect(initialOffset, data, bytesToRead, ullBytesRead);
+    }
+
     ULONGLONG alignedBytesToRead;
     if (bytesToRead % m_BytesPerSector || m_LocalPositionOffset > 0)
     {
@@ -119,7 +155,21 @@ CompleteVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG byte
     }
 
     DWORD dwBytesRead = 0;
-    hr = m_Extents[0].Read(localReadBuffer.GetData(), alignedBytesToRead, &dwBytesRead);
+    hr = S_FALSE;
+    if (m_pReadAhead)
+    {
+        hr = m_pReadAhead->Read(
+            m_Extents[0].GetSeekOffset(),
+            localReadBuffer.GetData(),
+            static_cast<DWORD>(alignedBytesToRead),
+            dwBytesRead);
+    }
+
+    if (hr == S_FALSE)
+    {
+        hr = m_Extents[0].Read(localReadBuffer.GetData(), static_cast<DWORD>(alignedBytesToRead), &dwBytesRead);
+    }
+
     if (FAILED(hr))
     {
         return hr;
@@ -137,7 +187,6 @@ CompleteVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG byte
 
     ullBytesRead = std::min(static_cast<ULONGLONG>(dwBytesRead - m_LocalPositionOffset), bytesToRead);
 
-    // TODO: this trigger a reallocation even if smaller
     data.SetCount(ullBytesRead);
 
     CopyMemory(data.GetData(), localReadBuffer.GetData() + m_LocalPositionOffset, static_cast<size_t>(ullBytesRead));
@@ -153,6 +202,107 @@ CompleteVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG byte
     return S_OK;
 }
 
+HRESULT
+CompleteVolumeReader::ReadDirect(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG bytesToRead, ULONGLONG& ullBytesRead)
+{
+    DWORD dwBytesRead = 0;
+    HRESULT hr = S_FALSE;
+    if (m_pReadAhead)
+    {
+        hr = m_pReadAhead->Read(offset, data.GetData(), static_cast<DWORD>(bytesToRead), dwBytesRead);
+    }
+
+    if (hr == S_FALSE)
+    {
+        hr = m_Extents[0].Read(data.GetData(), static_cast<DWORD>(bytesToRead), &dwBytesRead);
+    }
+
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    ullBytesRead = dwBytesRead;
+    data.SetCount(static_cast<size_t>(ullBytesRead));
+
+    return Seek(offset + ullBytesRead);
+}
+
+HRESULT
+CompleteVolumeReader::ReadCached(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG bytesToRead, ULONGLONG& ullBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    const ULONG blockSize = m_pBlockCache->BlockSize();
+    const ULONGLONG firstBlock = (offset / blockSize) * blockSize;
+
+    if (data.OwnsBuffer() && !data.SetCount(static_cast<size_t>(bytesToRead)))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    CBinaryBuffer block(true);
+    if (!block.CheckCount(blockSize))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ullBytesRead = 0LL;
+    for (ULONGLONG blockOffset = firstBlock; blockOffset < offset + bytesToRead; blockOffset += blockSize)
+    {
+        DWORD dwValidBytes = 0L;
+        if (!m_pBlockCache->Lookup(blockOffset, block.GetData(), dwValidBytes))
+        {
+            LARGE_INTEGER liPosition;
+            liPosition.QuadPart = static_cast<LONGLONG>(blockOffset);
+
+            if (FAILED(hr = m_Extents[0].Seek(liPosition, NULL, FILE_BEGIN)))
+            {
+                return hr;
+            }
+
+            if (FAILED(hr = m_Extents[0].Read(block.GetData(), blockSize, &dwValidBytes)))
+            {
+                return hr;
+            }
+
+            m_pBlockCache->Insert(blockOffset, block.GetData(), dwValidBytes);
+        }
+
+        const ULONGLONG blockStart = std::max(offset, blockOffset) - blockOffset;
+        if (dwValidBytes <= blockStart)
+        {
+            break;
+        }
+
+        const ULONGLONG toCopy = std::min(dwValidBytes - blockStart, bytesToRead - ullBytesRead);
+        CopyMemory(data.GetData() + ullBytesRead, block.GetData() + blockStart, static_cast<size_t>(toCopy));
+        ullBytesRead += toCopy;
+
+        if (dwValidBytes < blockSize)
+        {
+            // End of volume
+            break;
+        }
+    }
+
+    data.SetCount(static_cast<size_t>(ullBytesRead));
+
+    return Seek(offset + ullBytesRead);
+}
+
+ULONG CompleteVolumeReader::GetMaxTransferLength() const
+{
+    ULONG ulMaxTransferLength = 0L;
+    for (const auto& extent : m_Extents)
+    {
+        if (extent.GetMaxTransferLength() > 0
+            && (ulMaxTransferLength == 0 || extent.GetMaxTransferLength() < ulMaxTransferLength))
+            ulMaxTransferLength = extent.GetMaxTransferLength();
+    }
+    return ulMaxTransferLength;
+}
+
 std::shared_ptr<VolumeReader> CompleteVolumeReader::ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags)
 {
     auto retval = DuplicateReader();
@@ -164,9 +314,60 @@ std::shared_ptr<VolumeReader> CompleteVolumeReader::ReOpen(DWORD dwDesiredAccess
         complete_reader->m_Extents.push_back(extent.ReOpen(dwDesiredAccess, dwShareMode, dwFlags));
     }
 
+    complete_reader->m_pBlockCache = m_pBlockCache;
+
     return retval;
 }
 
+HRESULT CompleteVolumeReader::EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    if (m_Extents.empty() || m_BytesPerSector == 0)
+        return E_NOTIMPL;
+
+    if (m_pReadAhead)
+        return S_OK;
+
+    m_pReadAhead = OverlappedReadAhead::Create(m_Extents[0], m_BytesPerSector, dwQueueDepth, dwChunkSize);
+    if (m_pReadAhead == nullptr)
+    {
+        Log::Debug(L"Read-ahead is not available for '{}'", m_szLocation);
+        return E_NOTIMPL;
+    }
+
+    return S_OK;
+}
+
+void CompleteVolumeReader::DisableReadAhead()
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+    m_pReadAhead.reset();
+}
+
+HRESULT CompleteVolumeReader::EnableBlockCache(size_t cbMaxBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    if (m_Extents.empty() || m_BytesPerSector == 0)
+        return E_NOTIMPL;
+
+    if (cbMaxBytes == 0)
+    {
+        m_pBlockCache.reset();
+        return S_OK;
+    }
+
+    if (m_pBlockCache)
+        return S_OK;
+
+    const ULONG blockSize = m_BytesPerCluster ? m_BytesPerCluster : 4096;
+    m_pBlockCache = std::make_shared<VolumeBlockCache>(blockSize, cbMaxBytes);
+
+    Log::Debug(L"Enabled block cache for '{}' (block: {}, max bytes: {})", m_szLocation, blockSize, cbMaxBytes);
+    return S_OK;
+}
+
 // Read from disk.
 HRESULT CompleteVolumeReader::Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
 {
@@ -215,4 +416,18 @@ HRESULT CompleteVolumeReader::ParseBootSector()
     return hr;
 }
 
-CompleteVolumeReader::~CompleteVolumeReader() {}
+CompleteVolumeReader::~CompleteVolumeReader()
+{
+    if (m_pBlockCache && m_pBlockCache.use_count() == 1)
+    {
+        const auto stats = m_pBlockCache->GetStatistics();
+        Log::Debug(
+            L"Block cache for '{}': hits: {}, misses: {}, insertions: {}, evictions: {}, peak bytes: {}",
+            m_szLocation,
+            stats.ullHits,
+            stats.ullMisses,
+            stats.ullInsertions,
+            stats.ullEvictions,
+            stats.cbPeakBytes);
+    }
+}
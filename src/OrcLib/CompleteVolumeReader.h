@@ -10,6 +10,8 @@
 #include "VolumeReader.h"
 #include "DiskExtent.h"
 #include "BinaryBuffer.h"
+#include "OverlappedReadAhead.h"
+#include "VolumeBlockCache.h"
 
 #include <concrt.h>
 
@@ -30,8 +32,15 @@ public:
 
     uint64_t Position() const override;
 
+    ULONG GetMaxTransferLength() const override;
+
     virtual std::shared_ptr<VolumeReader> ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags);
 
+    HRESULT EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize = 0L) override;
+    void DisableReadAhead() override;
+
+    HRESULT EnableBlockCache(size_t cbMaxBytes) override;
+
     virtual ~CompleteVolumeReader();
 
 protected:
@@ -42,8 +51,12 @@ protected:
 private:
     HRESULT Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
     HRESULT ReadUnaligned(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead);
+    HRESULT ReadCached(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead);
+    HRESULT ReadDirect(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead);
 
     concurrency::critical_section m_cs;
+    std::unique_ptr<OverlappedReadAhead> m_pReadAhead;
+    std::shared_ptr<VolumeBlockCache> m_pBlockCache;
 };
 
 }  // namespace Orc
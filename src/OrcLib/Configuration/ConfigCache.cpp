@@ -0,0 +1,357 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "StdAfx.h"
+
+#include "ConfigCache.h"
+
+#include "Utils/Guard.h"
+
+#include "Log/Log.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcConfigCacheEnv = L"DFIR-ORC_CONFIG_CACHE";
+
+constexpr uint64_t kMagic = 0x313047464343524FULL;  // "ORCCFG01"
+constexpr uint64_t kFnvOffsetBasis = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+
+// File layout: Header, followed by the serialized root item
+//   item: type, flags, status (1 byte each), index, order index (4 bytes each), name, data (4 bytes character count
+//   followed by the UTF-16 characters), sub items and node list (4 bytes count followed by the items)
+#pragma pack(push, 1)
+struct Header
+{
+    uint64_t Magic;
+    uint64_t Schema;
+    uint64_t XmlHash;
+    uint64_t XmlSize;
+};
+#pragma pack(pop)
+
+uint64_t Fnv1a(const void* pData, size_t cbData, uint64_t hash = kFnvOffsetBasis)
+{
+    const auto pBytes = reinterpret_cast<const uint8_t*>(pData);
+    for (size_t i = 0; i < cbData; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= kFnvPrime;
+    }
+
+    return hash;
+}
+
+// Parsing only changes status, data, order indexes and node lists, this fingerprint is the same before and after
+uint64_t SchemaFingerprint(const ConfigItem& item, uint64_t hash = kFnvOffsetBasis)
+{
+    hash = Fnv1a(&item.Type, sizeof(item.Type), hash);
+    hash = Fnv1a(&item.Flags, sizeof(item.Flags), hash);
+    hash = Fnv1a(&item.dwIndex, sizeof(item.dwIndex), hash);
+    hash = Fnv1a(item.strName.data(), item.strName.size() * sizeof(wchar_t), hash);
+
+    const auto count = static_cast<uint32_t>(item.SubItems.size());
+    hash = Fnv1a(&count, sizeof(count), hash);
+    for (const auto& subItem : item.SubItems)
+        hash = SchemaFingerprint(subItem, hash);
+
+    return hash;
+}
+
+std::filesystem::path GetCachePath(const std::wstring& directory, uint64_t xmlHash, uint64_t schema)
+{
+    return std::filesystem::path(directory) / fmt::format(L"{:016X}-{:016X}.cfg", xmlHash, schema);
+}
+
+template <typename T>
+void Append(std::vector<uint8_t>& output, const T& value)
+{
+    const auto pBytes = reinterpret_cast<const uint8_t*>(&value);
+    output.insert(std::cend(output), pBytes, pBytes + sizeof(T));
+}
+
+void Append(std::vector<uint8_t>& output, const std::wstring& value)
+{
+    Append(output, static_cast<uint32_t>(value.size()));
+
+    const auto pBytes = reinterpret_cast<const uint8_t*>(value.data());
+    output.insert(std::cend(output), pBytes, pBytes + value.size() * sizeof(wchar_t));
+}
+
+void Serialize(std::vector<uint8_t>& output, const ConfigItem& item)
+{
+    Append(output, item.Type);
+    Append(output, item.Flags);
+    Append(output, item.Status);
+    Append(output, static_cast<uint32_t>(item.dwIndex));
+    Append(output, static_cast<uint32_t>(item.dwOrderIndex));
+    Append(output, item.strName);
+    Append(output, item.strData);
+
+    Append(output, static_cast<uint32_t>(item.SubItems.size()));
+    for (const auto& subItem : item.SubItems)
+        Serialize(output, subItem);
+
+    Append(output, static_cast<uint32_t>(item.NodeList.size()));
+    for (const auto& node : item.NodeList)
+        Serialize(output, node);
+}
+
+class Deserializer
+{
+public:
+    Deserializer(BufferView input)
+        : m_input(input)
+        , m_offset(0)
+    {
+    }
+
+    bool Read(ConfigItem& item)
+    {
+        uint32_t index = 0, orderIndex = 0, subItems = 0, nodes = 0;
+
+        if (!Read(item.Type) || !Read(item.Flags) || !Read(item.Status) || !Read(index) || !Read(orderIndex)
+            || !Read(item.strName) || !Read(item.strData))
+            return false;
+
+        item.dwIndex = index;
+        item.dwOrderIndex = orderIndex;
+
+        if (!Read(subItems) || subItems > Remaining())
+            return false;
+
+        item.SubItems.resize(subItems);
+        for (auto& subItem : item.SubItems)
+        {
+            if (!Read(subItem))
+                return false;
+        }
+
+        if (!Read(nodes) || nodes > Remaining())
+            return false;
+
+        item.NodeList.resize(nodes);
+        for (auto& node : item.NodeList)
+        {
+            if (!Read(node))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_input.size(); }
+
+private:
+    size_t Remaining() const { return m_input.size() - m_offset; }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        if (Remaining() < sizeof(T))
+            return false;
+
+        memcpy(&value, m_input.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool Read(std::wstring& value)
+    {
+        uint32_t count = 0;
+        if (!Read(count) || Remaining() / sizeof(wchar_t) < count)
+            return false;
+
+        value.resize(count);
+        memcpy(value.data(), m_input.data() + m_offset, count * sizeof(wchar_t));
+        m_offset += count * sizeof(wchar_t);
+        return true;
+    }
+
+    BufferView m_input;
+    size_t m_offset;
+};
+
+}  // namespace
+
+HRESULT ConfigCache::ConfigureDirectory(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid configuration cache directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create configuration cache directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcConfigCacheEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcConfigCacheEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"Parsed configurations are cached in '{}'", directory.wstring());
+    return S_OK;
+}
+
+std::optional<std::wstring> ConfigCache::GetDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcConfigCacheEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcConfigCacheEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+HRESULT ConfigCache::Load(BufferView xml, ConfigItem& config)
+{
+    const auto directory = GetDirectory();
+    if (!directory)
+        return S_FALSE;
+
+    const auto xmlHash = Fnv1a(xml.data(), xml.size());
+    const auto schema = SchemaFingerprint(config);
+    const auto path = GetCachePath(*directory, xmlHash, schema);
+
+    Guard::FileHandle hFile = CreateFileW(
+        path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+    if (!hFile.IsValid())
+        return S_FALSE;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(*hFile, &size) || static_cast<ULONGLONG>(size.QuadPart) < sizeof(Header) || size.HighPart != 0)
+    {
+        Log::Debug(L"Invalid configuration cache file '{}'", path.wstring());
+        return S_FALSE;
+    }
+
+    Guard::Handle hMapping = CreateFileMappingW(*hFile, NULL, PAGE_READONLY, 0L, 0L, NULL);
+    if (!hMapping.IsValid())
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Debug(L"Failed to map configuration cache file '{}' [{}]", path.wstring(), SystemError(hr));
+        return S_FALSE;
+    }
+
+    const auto pView = reinterpret_cast<const uint8_t*>(MapViewOfFile(*hMapping, FILE_MAP_READ, 0L, 0L, 0L));
+    if (pView == nullptr)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Debug(L"Failed to map configuration cache file '{}' [{}]", path.wstring(), SystemError(hr));
+        return S_FALSE;
+    }
+
+    auto unmapGuard = Guard::CreateScopeGuard([pView]() { UnmapViewOfFile(pView); });
+
+    Header header;
+    memcpy(&header, pView, sizeof(Header));
+    if (header.Magic != kMagic || header.Schema != schema || header.XmlHash != xmlHash || header.XmlSize != xml.size())
+    {
+        Log::Debug(L"Configuration cache file '{}' does not match its configuration", path.wstring());
+        return S_FALSE;
+    }
+
+    ConfigItem item;
+    Deserializer deserializer(BufferView(pView + sizeof(Header), size.LowPart - sizeof(Header)));
+    if (!deserializer.Read(item) || !deserializer.AtEnd() || SchemaFingerprint(item) != schema)
+    {
+        Log::Debug(L"Invalid configuration cache file '{}'", path.wstring());
+        return S_FALSE;
+    }
+
+    config = std::move(item);
+
+    Log::Debug(L"Loaded configuration '{}' from configuration cache", config.strName);
+    return S_OK;
+}
+
+HRESULT ConfigCache::Save(BufferView xml, const ConfigItem& config)
+{
+    const auto directory = GetDirectory();
+    if (!directory)
+        return S_FALSE;
+
+    const auto xmlHash = Fnv1a(xml.data(), xml.size());
+    const auto schema = SchemaFingerprint(config);
+    const auto path = GetCachePath(*directory, xmlHash, schema);
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec))
+        return S_FALSE;
+
+    std::vector<uint8_t> output;
+    Append(output, Header {kMagic, schema, xmlHash, xml.size()});
+    Serialize(output, config);
+
+    const auto tempPath = std::filesystem::path(path).concat(fmt::format(L".{}.tmp", GetCurrentProcessId()));
+
+    {
+        std::ofstream ofs(tempPath, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            Log::Debug(L"Failed to create configuration cache file '{}'", tempPath.wstring());
+            return E_FAIL;
+        }
+
+        ofs.write(reinterpret_cast<const char*>(output.data()), output.size());
+        ofs.close();
+        if (ofs.fail())
+        {
+            Log::Debug(L"Failed to write configuration cache file '{}'", tempPath.wstring());
+            std::filesystem::remove(tempPath, ec);
+            return E_FAIL;
+        }
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_WRITE_THROUGH))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        std::filesystem::remove(tempPath, ec);
+
+        // Another process saved it first
+        if (hr == HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS) || hr == HRESULT_FROM_WIN32(ERROR_FILE_EXISTS))
+            return S_FALSE;
+
+        Log::Debug(L"Failed to rename configuration cache file '{}' [{}]", tempPath.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"Saved configuration '{}' to configuration cache ({} bytes)", config.strName, output.size());
+    return S_OK;
+}
@@ -0,0 +1,49 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "ConfigItem.h"
+
+#include "Utils/BufferView.h"
+
+#include <optional>
+#include <string>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// ConfigCache: compiled form of the validated ConfigItem trees read by ConfigFile::LookupAndReadConfiguration.
+//
+// When %DFIR-ORC_CONFIG_CACHE% designates a directory (WolfLauncher sets it for its commands), the first process to
+// parse and check a configuration saves the resulting tree in a compact binary file named after the hash of the xml
+// source. Following processes memory map it and rebuild the tree without going through XmlLite and CheckConfig.
+//
+// Each file also records a fingerprint of the schema (names, types, flags and indexes of the items) the tree was parsed
+// with so a tool never loads a tree built for another schema, even when it shares the same xml source.
+//
+class ConfigCache
+{
+public:
+    static HRESULT ConfigureDirectory(const std::wstring& strDirectory);
+    static std::optional<std::wstring> GetDirectory();
+
+    // Replace 'config', initialized with the schema, with the tree saved for 'xml'. Returns S_FALSE when the cache is
+    // disabled or holds no usable entry.
+    static HRESULT Load(BufferView xml, ConfigItem& config);
+
+    // Save 'config', parsed from 'xml' and checked. Returns S_FALSE when the cache is disabled or already holds it.
+    static HRESULT Save(BufferView xml, const ConfigItem& config);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -13,8 +13,10 @@
 #include "ConfigItem.h"
 #include "ConfigFile.h"
 #include "ConfigFileReader.h"
+#include "ConfigCache.h"
 
 #include "EmbeddedResource.h"
+#include "FileStream.h"
 
 #include "MemoryStream.h"
 
@@ -36,6 +38,78 @@ using namespace std;
 
 using namespace Orc;
 
+namespace {
+
+HRESULT ReadConfigFile(const std::wstring& strConfigFile, CBinaryBuffer& buffer)
+{
+    HRESULT hr = E_FAIL;
+
+    auto filestream = std::make_shared<FileStream>();
+    if (FAILED(hr = filestream->ReadFrom(strConfigFile.c_str())))
+    {
+        return hr;
+    }
+
+    if (!buffer.SetCount(static_cast<size_t>(filestream->GetSize())))
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    ULONGLONG ullRead = 0LL;
+    if (FAILED(hr = filestream->Read(buffer.GetData(), buffer.GetCount(), &ullRead)))
+    {
+        return hr;
+    }
+
+    buffer.SetCount(static_cast<size_t>(ullRead));
+    return S_OK;
+}
+
+// Parse and check the configuration in 'buffer' unless the configuration cache already holds its tree
+HRESULT ReadAndCheckConfig(
+    ConfigFileReader& r,
+    const CBinaryBuffer& buffer,
+    LPCWSTR szKind,
+    const std::wstring& strName,
+    ConfigItem& config)
+{
+    HRESULT hr = E_FAIL;
+
+    const BufferView xml(buffer.GetData(), buffer.GetCount());
+    if (ConfigCache::Load(xml, config) == S_OK)
+    {
+        return S_OK;
+    }
+
+    auto memstream = std::make_shared<MemoryStream>();
+    if (FAILED(hr = memstream->OpenForReadOnly(buffer.GetData(), buffer.GetCount())))
+    {
+        Log::Error(L"Failed to create stream for config {} '{}' [{}]", szKind, strName, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = r.ReadConfig(memstream, config)))
+    {
+        Log::Error(L"Failed to read config {} '{}' [{}]", szKind, strName, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = r.CheckConfig(config)))
+    {
+        Log::Error(L"Config {} '{}' is incorrect and cannot be used [{}]", szKind, strName, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = ConfigCache::Save(xml, config)))
+    {
+        Log::Debug(L"Failed to save config {} '{}' to configuration cache [{}]", szKind, strName, SystemError(hr));
+    }
+
+    return S_OK;
+}
+
+}  // namespace
+
 ConfigFile::ConfigFile()
 {
     m_hHeap = HeapCreate(HEAP_GENERATE_EXCEPTIONS, 0L, 0L);
@@ -225,16 +299,16 @@ HRESULT ConfigFile::LookupAndReadConfiguration(
     {
         Log::Debug(L"Load configuration from file: '{}'", strConfigResource);
 
-        // Config file is used, let's read it
-        if (FAILED(hr = r.ReadConfig(strConfigFile.c_str(), Config)))
+        CBinaryBuffer buffer;
+        if (FAILED(hr = ::ReadConfigFile(strConfigFile, buffer)))
         {
             Log::Error(L"Failed to read config file '{}' [{}]", strConfigFile, SystemError(hr));
             return hr;
         }
 
-        if (FAILED(hr = r.CheckConfig(Config)))
+        // Config file is used, let's read it
+        if (FAILED(hr = ::ReadAndCheckConfig(r, buffer, L"file", strConfigFile, Config)))
         {
-            Log::Error(L"Config file '{}' is incorrect and cannot be used [{}]", strConfigFile, SystemError(hr));
             return hr;
         }
 
@@ -247,26 +321,9 @@ HRESULT ConfigFile::LookupAndReadConfiguration(
         CBinaryBuffer buffer;
         if (SUCCEEDED(hr = EmbeddedResource::ExtractToBuffer(strConfigResource, buffer)))
         {
-            auto memstream = std::make_shared<MemoryStream>();
-
-            if (FAILED(hr = memstream->OpenForReadOnly(buffer.GetData(), buffer.GetCount())))
-            {
-                Log::Error(
-                    L"Failed to create stream for config resource '{}' [{}]", strConfigResource, SystemError(hr));
-                return hr;
-            }
-
             // Config file is used, let's read it
-            if (FAILED(hr = r.ReadConfig(memstream, Config)))
-            {
-                Log::Error(L"Failed to read config resource '{}' [{}]", strConfigResource, SystemError(hr));
-                return hr;
-            }
-
-            if (FAILED(hr = r.CheckConfig(Config)))
+            if (FAILED(hr = ::ReadAndCheckConfig(r, buffer, L"resource", strConfigResource, Config)))
             {
-                Log::Error(
-                    L"Config resource '{}' is incorrect and cannot be used [{}]", strConfigResource, SystemError(hr));
                 return hr;
             }
 
@@ -290,23 +347,8 @@ HRESULT ConfigFile::LookupAndReadConfiguration(
         if (SUCCEEDED(hr = EmbeddedResource::ExtractToBuffer(strConfigRef, buffer)))
         {
             // Config file is used, let's read it
-            auto memstream = std::make_shared<MemoryStream>();
-
-            if (FAILED(hr = memstream->OpenForReadOnly(buffer.GetData(), buffer.GetCount())))
-            {
-                Log::Error(L"Failed to create stream for config resource '{}' [{}]", strConfigRef, SystemError(hr));
-                return hr;
-            }
-
-            if (FAILED(hr = r.ReadConfig(memstream, Config)))
-            {
-                Log::Error(L"Failed to read config resource '{}' [{}]", strConfigRef, SystemError(hr));
-                return hr;
-            }
-
-            if (FAILED(hr = r.CheckConfig(Config)))
+            if (FAILED(hr = ::ReadAndCheckConfig(r, buffer, L"resource", strConfigRef, Config)))
             {
-                Log::Error(L"Config resource '{}' is incorrect and cannot be used [{}]", strConfigRef, SystemError(hr));
                 return hr;
             }
 
@@ -40,6 +40,33 @@ HRESULT Orc::Config::Common::output(ConfigItem& parent, DWORD dwIndex, std::wstr
         return hr;
     if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"password", CONFIG_OUTPUT_PASSWORD, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"buffers", CONFIG_OUTPUT_BUFFERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"rowgroup", CONFIG_OUTPUT_ROWGROUP, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"encoders", CONFIG_OUTPUT_ENCODERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"memory", CONFIG_OUTPUT_MEMORY, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"shardrows", CONFIG_OUTPUT_SHARDROWS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"shardsize", CONFIG_OUTPUT_SHARDSIZE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"sortkeys", CONFIG_OUTPUT_SORTKEYS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(
+            hr = parent.SubItems[dwIndex].AddAttribute(
+                L"bloomfilters", CONFIG_OUTPUT_BLOOMFILTERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"rowindex", CONFIG_OUTPUT_ROWINDEX, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(
+            hr = parent.SubItems[dwIndex].AddAttribute(L"stripesize", CONFIG_OUTPUT_STRIPESIZE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(
+            hr = parent.SubItems[dwIndex].AddAttribute(
+                L"tableformat", CONFIG_OUTPUT_TABLEFORMAT, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
@@ -106,6 +133,8 @@ HRESULT Orc::Config::Common::upload(ConfigItem& parent, DWORD dwIndex, std::wstr
         return hr;
     if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"uri", CONFIG_UPLOAD_URI, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"partsize", CONFIG_UPLOAD_PARTSIZE, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
@@ -174,6 +203,10 @@ HRESULT Orc::Config::Common::ntfs_criterias(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent[dwIndex].AddAttribute(L"yara_rule", CONFIG_FILEFIND_YARA_RULE, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"hash_list", CONFIG_FILEFIND_HASH_LIST, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"blake3", CONFIG_FILEFIND_BLAKE3, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
@@ -215,6 +248,16 @@ HRESULT Orc::Config::Common::yara(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"scan_method", CONFIG_YARA_SCAN_METHOD, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"workers", CONFIG_YARA_WORKERS, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"pending", CONFIG_YARA_PENDING, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"cache", CONFIG_YARA_CACHE, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"profiling", CONFIG_YARA_PROFILING, ConfigItem::OPTION)))
+        return hr;
+    if (FAILED(hr = parent.SubItems[dwIndex].AddAttribute(L"rule_budget", CONFIG_YARA_RULE_BUDGET, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 };
 
@@ -344,6 +387,8 @@ HRESULT Orc::Config::Common::sample(ConfigItem& parent, DWORD dwIndex)
         return hr;
     if (FAILED(hr = parent[dwIndex].AddAttribute(L"name", CONFIG_SAMPLE_NAME, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = parent[dwIndex].AddAttribute(L"priority", CONFIG_SAMPLE_PRIORITY, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
@@ -479,6 +524,8 @@ HRESULT Orc::Config::Common::sch_column_common(ConfigItem& item)
         return hr;
     if (FAILED(hr = item.AddAttribute(L"fmt", CONFIG_SCHEMA_COLUMN_FMT, ConfigItem::OPTION)))
         return hr;
+    if (FAILED(hr = item.AddAttribute(L"dictionary", CONFIG_SCHEMA_COLUMN_DICTIONARY, ConfigItem::OPTION)))
+        return hr;
     return S_OK;
 }
 
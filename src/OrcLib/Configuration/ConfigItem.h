@@ -188,6 +188,17 @@ constexpr auto CONFIG_OUTPUT_TABLE = 4U;
 constexpr auto CONFIG_OUTPUT_KEY = 5U;
 constexpr auto CONFIG_OUTPUT_DISPOSITION = 6U;
 constexpr auto CONFIG_OUTPUT_PASSWORD = 7U;
+constexpr auto CONFIG_OUTPUT_BUFFERS = 8U;
+constexpr auto CONFIG_OUTPUT_ROWGROUP = 9U;
+constexpr auto CONFIG_OUTPUT_ENCODERS = 10U;
+constexpr auto CONFIG_OUTPUT_MEMORY = 11U;
+constexpr auto CONFIG_OUTPUT_SHARDROWS = 12U;
+constexpr auto CONFIG_OUTPUT_SHARDSIZE = 13U;
+constexpr auto CONFIG_OUTPUT_SORTKEYS = 14U;
+constexpr auto CONFIG_OUTPUT_BLOOMFILTERS = 15U;
+constexpr auto CONFIG_OUTPUT_ROWINDEX = 16U;
+constexpr auto CONFIG_OUTPUT_STRIPESIZE = 17U;
+constexpr auto CONFIG_OUTPUT_TABLEFORMAT = 18U;
 
 // UPLOAD
 constexpr auto CONFIG_UPLOAD_METHOD = 0U;
@@ -202,6 +213,7 @@ constexpr auto CONFIG_UPLOAD_AUTHSCHEME = 8U;
 constexpr auto CONFIG_UPLOAD_FILTER_EXC = 9U;
 constexpr auto CONFIG_UPLOAD_FILTER_INC = 10U;
 constexpr auto CONFIG_UPLOAD_URI = 11U;
+constexpr auto CONFIG_UPLOAD_PARTSIZE = 12U;
 
 // DOWNLOAD
 constexpr auto CONFIG_DOWNLOAD_METHOD = 0U;
@@ -265,12 +277,19 @@ constexpr auto CONFIG_FILEFIND_ATTR_TYPE = 27U;
 constexpr auto CONFIG_FILEFIND_CONTAINS = 28U;
 constexpr auto CONFIG_FILEFIND_CONTAINS_HEX = 29U;
 constexpr auto CONFIG_FILEFIND_YARA_RULE = 30U;
+constexpr auto CONFIG_FILEFIND_HASH_LIST = 31U;
+constexpr auto CONFIG_FILEFIND_BLAKE3 = 32U;
 
 constexpr auto CONFIG_YARA_SOURCE = 0L;
 constexpr auto CONFIG_YARA_BLOCK = 1L;
 constexpr auto CONFIG_YARA_OVERLAP = 2L;
 constexpr auto CONFIG_YARA_TIMEOUT = 3L;
 constexpr auto CONFIG_YARA_SCAN_METHOD = 4L;
+constexpr auto CONFIG_YARA_WORKERS = 5L;
+constexpr auto CONFIG_YARA_PENDING = 6L;
+constexpr auto CONFIG_YARA_CACHE = 7L;
+constexpr auto CONFIG_YARA_PROFILING = 8L;
+constexpr auto CONFIG_YARA_RULE_BUDGET = 9L;
 
 constexpr auto CONFIG_TEMPLATE_NAME = 0L;
 constexpr auto CONFIG_TEMPLATE_LOCATION = 1L;
@@ -290,6 +309,7 @@ constexpr auto CONFIG_SAMPLE_CONTENT = 3U;
 constexpr auto CONFIG_SAMPLE_EXCLUDE = 4U;
 constexpr auto CONFIG_SAMPLE_FILEFIND = 5U;
 constexpr auto CONFIG_SAMPLE_NAME = 6U;
+constexpr auto CONFIG_SAMPLE_PRIORITY = 7U;
 
 constexpr auto CONFIG_SAMPLE = 5U;
 
@@ -316,7 +336,8 @@ constexpr auto CONFIG_SCHEMA_COLUMN_ARTIFACT = 2U;
 constexpr auto CONFIG_SCHEMA_COLUMN_NULL = 3U;
 constexpr auto CONFIG_SCHEMA_COLUMN_NOTNULL = 4U;
 constexpr auto CONFIG_SCHEMA_COLUMN_FMT = 5U;
-constexpr auto CONFIG_SCHEMA_COLUMN_COMMON_MAX = 5U;
+constexpr auto CONFIG_SCHEMA_COLUMN_DICTIONARY = 6U;
+constexpr auto CONFIG_SCHEMA_COLUMN_COMMON_MAX = 6U;
 
 constexpr auto CONFIG_SCHEMA_COLUMN_UTF8_MAXLEN = CONFIG_SCHEMA_COLUMN_COMMON_MAX + 1U;
 constexpr auto CONFIG_SCHEMA_COLUMN_UTF8_LEN = CONFIG_SCHEMA_COLUMN_COMMON_MAX + 2U;
@@ -0,0 +1,193 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "ContentPatternMatcher.h"
+
+#include <algorithm>
+#include <deque>
+
+using namespace Orc;
+
+namespace {
+
+constexpr ULONG kNoState = MAXULONG;
+
+}  // namespace
+
+size_t ContentPatternMatcher::Add(std::string_view pattern)
+{
+    auto it = std::find(std::cbegin(m_Patterns), std::cend(m_Patterns), pattern);
+    if (it != std::cend(m_Patterns))
+        return std::distance(std::cbegin(m_Patterns), it);
+
+    m_Patterns.emplace_back(pattern);
+    m_bCompiled = false;
+    return m_Patterns.size() - 1;
+}
+
+ULONG ContentPatternMatcher::AddState()
+{
+    m_States.emplace_back();
+    return static_cast<ULONG>(m_States.size() - 1);
+}
+
+ULONG ContentPatternMatcher::Transition(ULONG ulState, BYTE b) const
+{
+    const auto& next = m_States[ulState].Next;
+    auto it = std::lower_bound(
+        std::cbegin(next), std::cend(next), b, [](const auto& item, BYTE value) { return item.first < value; });
+
+    if (it == std::cend(next) || it->first != b)
+        return kNoState;
+
+    return it->second;
+}
+
+ULONG ContentPatternMatcher::Step(ULONG ulState, BYTE b) const
+{
+    while (ulState != 0)
+    {
+        const auto ulNext = Transition(ulState, b);
+        if (ulNext != kNoState)
+            return ulNext;
+
+        ulState = m_States[ulState].Fail;
+    }
+    return m_Root[b];
+}
+
+void ContentPatternMatcher::Compile()
+{
+    m_States.clear();
+    m_Root.fill(0L);
+    AddState();
+
+    // Trie of the patterns, empty patterns are found by any stream and have no state
+    for (ULONG i = 0; i < m_Patterns.size(); i++)
+    {
+        const auto& pattern = m_Patterns[i];
+        if (pattern.empty())
+            continue;
+
+        ULONG ulState = 0L;
+        for (const auto c : pattern)
+        {
+            const auto b = static_cast<BYTE>(c);
+
+            auto ulNext = Transition(ulState, b);
+            if (ulNext == kNoState)
+            {
+                ulNext = AddState();
+
+                auto& next = m_States[ulState].Next;
+                auto it = std::lower_bound(std::begin(next), std::end(next), b, [](const auto& item, BYTE value) {
+                    return item.first < value;
+                });
+                next.emplace(it, b, ulNext);
+            }
+            ulState = ulNext;
+        }
+        m_States[ulState].Outputs.push_back(i);
+    }
+
+    for (const auto& [b, ulChild] : m_States[0].Next)
+        m_Root[b] = ulChild;
+
+    // Breadth first computation of the failure links, outputs are merged so that a match needs no link walking
+    std::deque<ULONG> queue;
+    for (const auto& [b, ulChild] : m_States[0].Next)
+    {
+        m_States[ulChild].Fail = 0L;
+        queue.push_back(ulChild);
+    }
+
+    while (!queue.empty())
+    {
+        const auto ulState = queue.front();
+        queue.pop_front();
+
+        for (size_t i = 0; i < m_States[ulState].Next.size(); i++)
+        {
+            const auto [b, ulChild] = m_States[ulState].Next[i];
+
+            m_States[ulChild].Fail = Step(m_States[ulState].Fail, b);
+
+            const auto& inherited = m_States[m_States[ulChild].Fail].Outputs;
+            m_States[ulChild].Outputs.insert(
+                std::end(m_States[ulChild].Outputs), std::cbegin(inherited), std::cend(inherited));
+
+            queue.push_back(ulChild);
+        }
+    }
+
+    m_bCompiled = true;
+}
+
+void ContentPatternMatcher::Clear()
+{
+    m_Patterns.clear();
+    m_States.clear();
+    m_Root.fill(0L);
+    m_bCompiled = false;
+}
+
+ContentPatternMatcher::Scan::Scan(const ContentPatternMatcher& matcher)
+    : m_Matcher(matcher)
+    , m_Found(matcher.m_Patterns.size(), false)
+{
+    _ASSERT(matcher.m_bCompiled);
+
+    for (size_t i = 0; i < matcher.m_Patterns.size(); i++)
+    {
+        if (matcher.m_Patterns[i].empty())
+        {
+            m_Found[i] = true;
+            m_FoundCount++;
+        }
+    }
+}
+
+void ContentPatternMatcher::Scan::Feed(const BYTE* pData, size_t cbData)
+{
+    if (!m_Matcher.m_bCompiled || m_Matcher.m_States.size() < 2)
+        return;
+
+    const auto& root = m_Matcher.m_Root;
+    const auto& states = m_Matcher.m_States;
+
+    size_t i = 0;
+    while (i < cbData && !AllFound())
+    {
+        if (m_ulState == 0)
+        {
+            // Most of the data does not start any pattern
+            while (i < cbData && root[pData[i]] == 0)
+                i++;
+
+            if (i == cbData)
+                break;
+
+            m_ulState = root[pData[i++]];
+        }
+        else
+        {
+            m_ulState = m_Matcher.Step(m_ulState, pData[i++]);
+        }
+
+        for (const auto id : states[m_ulState].Outputs)
+        {
+            if (!m_Found[id])
+            {
+                m_Found[id] = true;
+                m_FoundCount++;
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Searches a stream for a whole set of binary strings in one pass: the strings are compiled into an Aho-Corasick
+// automaton which is fed with the consecutive blocks of the stream, matches spanning two blocks are found as well.
+// While the automaton is in its initial state, the bytes which cannot start any string are skipped with memchr like
+// loops.
+class ContentPatternMatcher
+{
+public:
+    ContentPatternMatcher() = default;
+    ContentPatternMatcher(const ContentPatternMatcher&) = delete;
+    ContentPatternMatcher& operator=(const ContentPatternMatcher&) = delete;
+
+    // Register a string, identical strings share the same identifier
+    size_t Add(std::string_view pattern);
+
+    // Build the automaton: must be called after the last Add and before any Scan
+    void Compile();
+
+    void Clear();
+
+    bool empty() const { return m_Patterns.empty(); }
+    size_t size() const { return m_Patterns.size(); }
+
+    // Search state of one stream
+    class Scan
+    {
+    public:
+        Scan(const ContentPatternMatcher& matcher);
+
+        void Feed(const BYTE* pData, size_t cbData);
+
+        bool Found(size_t id) const { return m_Found[id]; }
+        bool AllFound() const { return m_FoundCount == m_Found.size(); }
+
+    private:
+        const ContentPatternMatcher& m_Matcher;
+        ULONG m_ulState = 0L;
+        std::vector<bool> m_Found;
+        size_t m_FoundCount = 0;
+    };
+
+private:
+    struct State
+    {
+        std::vector<std::pair<BYTE, ULONG>> Next;  // sorted by byte
+        ULONG Fail = 0L;
+        std::vector<ULONG> Outputs;  // patterns ending here (including via fail links)
+    };
+
+    ULONG Transition(ULONG ulState, BYTE b) const;
+    ULONG Step(ULONG ulState, BYTE b) const;
+    ULONG AddState();
+
+    std::vector<std::string> m_Patterns;
+    std::vector<State> m_States;
+
+    // Transitions of the initial state, 0 for the bytes which do not start any pattern
+    std::array<ULONG, 256> m_Root {};
+    bool m_bCompiled = false;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -310,6 +310,16 @@ bool CpuId::HasSHA() const
     return m_function7_ebx[29];
 }
 
+bool CpuId::HasAVX512BW() const
+{
+    return m_function7_ebx[30];
+}
+
+bool CpuId::HasAVX512VL() const
+{
+    return m_function7_ebx[31];
+}
+
 bool CpuId::HasPREFETCHWT1() const
 {
     return m_function7_ecx[0];
@@ -64,6 +64,8 @@ public:
     bool HasAVX512ER() const;
     bool HasAVX512CD() const;
     bool HasSHA() const;
+    bool HasAVX512BW() const;
+    bool HasAVX512VL() const;
 
     bool HasPREFETCHWT1() const;
 
@@ -17,7 +17,9 @@
 #include "BinaryBuffer.h"
 #include "DevNullStream.h"
 #include "FileStream.h"
+#include "TaskPool.h"
 
+#include <array>
 #include <sstream>
 #include <iomanip>
 
@@ -137,6 +139,9 @@ HRESULT CryptoHashStream::ResetHash(bool bContinue)
         CryptDestroyHash(m_Sha256);
 
     m_MD5 = m_Sha1 = m_Sha256 = NULL;
+    m_Sha1Ext.reset();
+    m_Sha256Ext.reset();
+    m_Blake3.reset();
     m_bHashIsValid = false;
 
     if (bContinue)
@@ -158,33 +163,77 @@ HRESULT CryptoHashStream::ResetHash(bool bContinue)
             Log::Debug("Failed to initialise MD5 hash [{}]", SystemError(hr));
         }
 
-        if (HasFlag(m_Algorithms, Algorithm::SHA1) && !CryptCreateHash(g_hProv, CALG_SHA1, 0, 0, &m_Sha1))
+        const bool bShaExtensions = ShaExtensionsHash::IsSupported();
+        if (bShaExtensions && HasFlag(m_Algorithms, Algorithm::SHA1))
+            m_Sha1Ext.emplace(ShaExtensionsHash::Algorithm::SHA1);
+        if (bShaExtensions && HasFlag(m_Algorithms, Algorithm::SHA256))
+            m_Sha256Ext.emplace(ShaExtensionsHash::Algorithm::SHA256);
+
+        if (HasFlag(m_Algorithms, Algorithm::SHA1) && !m_Sha1Ext
+            && !CryptCreateHash(g_hProv, CALG_SHA1, 0, 0, &m_Sha1))
         {
             hr = HRESULT_FROM_WIN32(GetLastError());
             Log::Debug("Failed to initialise SHA1 hash [{}]", SystemError(hr));
         }
-        if (HasFlag(m_Algorithms, Algorithm::SHA256) && !CryptCreateHash(g_hProv, CALG_SHA_256, 0, 0, &m_Sha256))
+        if (HasFlag(m_Algorithms, Algorithm::SHA256) && !m_Sha256Ext
+            && !CryptCreateHash(g_hProv, CALG_SHA_256, 0, 0, &m_Sha256))
         {
             hr = HRESULT_FROM_WIN32(GetLastError());
             Log::Debug("Failed to initialise SHA256 hash [{}]", SystemError(hr));
         }
+        if (HasFlag(m_Algorithms, Algorithm::BLAKE3))
+            m_Blake3.emplace();
     }
     return S_OK;
 }
 
 HRESULT CryptoHashStream::HashData(LPBYTE pBuffer, DWORD dwBytesToHash)
 {
-    if (m_bHashIsValid)
+    if (!m_bHashIsValid)
+        return S_OK;
+
+    const auto hashWith = [pBuffer, dwBytesToHash](HCRYPTHASH hHash, std::optional<ShaExtensionsHash>& ext) -> HRESULT {
+        if (ext)
+            ext->Update(pBuffer, dwBytesToHash);
+        else if (hHash != NULL && !CryptHashData(hHash, pBuffer, dwBytesToHash, 0))
+            return HRESULT_FROM_WIN32(GetLastError());
+        return S_OK;
+    };
+
+    std::optional<ShaExtensionsHash> none;
+    const std::array<std::pair<HCRYPTHASH, std::optional<ShaExtensionsHash>*>, 3> hashes = {
+        std::make_pair(m_MD5, &none), std::make_pair(m_Sha1, &m_Sha1Ext), std::make_pair(m_Sha256, &m_Sha256Ext)};
+
+    const auto dwActive = std::count_if(std::cbegin(hashes), std::cend(hashes), [](const auto& hash) {
+        return hash.first != NULL || hash.second->has_value();
+    }) + (m_Blake3 ? 1 : 0);
+
+    // BLAKE3 comes last, after the algorithms of the table
+    const auto hash = [&](size_t i) -> HRESULT {
+        if (i < hashes.size())
+            return hashWith(hashes[i].first, *hashes[i].second);
+        if (m_Blake3)
+            m_Blake3->Update(pBuffer, dwBytesToHash);
+        return S_OK;
+    };
+
+    // Algorithms do not share any state: each one gets its own worker for large buffers
+    std::array<HRESULT, 4> results = {S_OK, S_OK, S_OK, S_OK};
+    if (dwActive > 1 && dwBytesToHash >= kParallelHashThreshold)
+    {
+        TaskPool::ParallelFor(
+            TaskPool::Subsystem::Hash, size_t(0), results.size(), [&](size_t i) { results[i] = hash(i); });
+    }
+    else
+    {
+        for (size_t i = 0; i < results.size(); i++)
+            results[i] = hash(i);
+    }
+
+    for (const auto hr : results)
     {
-        if (m_MD5)
-            if (!CryptHashData(m_MD5, pBuffer, dwBytesToHash, 0))
-                return HRESULT_FROM_WIN32(GetLastError());
-        if (m_Sha1)
-            if (!CryptHashData(m_Sha1, pBuffer, dwBytesToHash, 0))
-                return HRESULT_FROM_WIN32(GetLastError());
-        if (m_Sha256)
-            if (!CryptHashData(m_Sha256, pBuffer, dwBytesToHash, 0))
-                return HRESULT_FROM_WIN32(GetLastError());
+        if (FAILED(hr))
+            return hr;
     }
     return S_OK;
 }
@@ -194,6 +243,7 @@ HRESULT CryptoHashStream::GetHash(Algorithm alg, CBinaryBuffer& hash)
     if (m_bHashIsValid)
     {
         HCRYPTHASH hHash = NULL;
+        const std::optional<ShaExtensionsHash>* pExt = nullptr;
         DWORD cbHash = 0L;
         switch (alg)
         {
@@ -204,15 +254,33 @@ HRESULT CryptoHashStream::GetHash(Algorithm alg, CBinaryBuffer& hash)
             case Algorithm::SHA1:
                 cbHash = BYTES_IN_SHA1_HASH;
                 hHash = m_Sha1;
+                pExt = &m_Sha1Ext;
                 break;
             case Algorithm::SHA256:
                 cbHash = BYTES_IN_SHA256_HASH;
                 hHash = m_Sha256;
+                pExt = &m_Sha256Ext;
                 break;
+            case Algorithm::BLAKE3:
+                if (!m_Blake3)
+                {
+                    hash.RemoveAll();
+                    return MK_E_UNAVAILABLE;
+                }
+                hash.SetCount(m_Blake3->DigestSize());
+                m_Blake3->Digest(hash.GetData());
+                return S_OK;
             default:
                 return E_INVALIDARG;
         }
 
+        if (pExt != nullptr && pExt->has_value())
+        {
+            hash.SetCount(cbHash);
+            (*pExt)->Digest(hash.GetData());
+            return S_OK;
+        }
+
         if (hHash == NULL)
         {
             hash.RemoveAll();
@@ -254,6 +322,7 @@ CryptoHashStream::Algorithm CryptoHashStream::GetSupportedAlgorithm(std::wstring
     constexpr auto MD5 = L"MD5"sv;
     constexpr auto SHA1 = L"SHA1"sv;
     constexpr auto SHA256 = L"SHA256"sv;
+    constexpr auto BLAKE3 = L"BLAKE3"sv;
 
     if (equalCaseInsensitive(svAlgo, MD5, MD5.size()))
     {
@@ -267,6 +336,10 @@ CryptoHashStream::Algorithm CryptoHashStream::GetSupportedAlgorithm(std::wstring
     {
         return Algorithm::SHA256;
     }
+    if (equalCaseInsensitive(svAlgo, BLAKE3, BLAKE3.size()))
+    {
+        return Algorithm::BLAKE3;
+    }
     return Algorithm::Undefined;
 }
 
@@ -295,6 +368,13 @@ std::wstring CryptoHashStream::GetSupportedAlgorithm(Algorithm algs)
         else
             retval.append(L",SHA256"sv);
     }
+    if (HasFlag(algs, Algorithm::BLAKE3))
+    {
+        if (retval.empty())
+            retval.append(L"BLAKE3"sv);
+        else
+            retval.append(L",BLAKE3"sv);
+    }
 
     return retval;
 }
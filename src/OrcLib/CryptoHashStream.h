@@ -12,9 +12,12 @@
 
 #include <memory>
 #include <filesystem>
+#include <optional>
 
+#include "Blake3Hash.h"
 #include "CryptoUtilities.h"
 #include "CryptoHashStreamAlgorithm.h"
+#include "ShaExtensionsHash.h"
 #include "Text/Fmt/CryptoHashStreamAlgorithm.h"
 #include "Utils/Result.h"
 
@@ -27,6 +30,9 @@ class CryptoHashStream : public HashStream
 public:
     using Algorithm = CryptoHashStreamAlgorithm;
 
+    // Buffers at least this large are hashed by all the algorithms concurrently
+    static constexpr DWORD kParallelHashThreshold = 64 * 1024;
+
     CryptoHashStream()
         : HashStream()
         , m_Algorithms(Algorithm::Undefined)
@@ -48,6 +54,7 @@ public:
     HRESULT GetSHA256(CBinaryBuffer& hash) { return GetHash(Algorithm::SHA256, hash); };
     HRESULT GetSHA1(CBinaryBuffer& hash) { return GetHash(Algorithm::SHA1, hash); };
     HRESULT GetMD5(CBinaryBuffer& hash) { return GetHash(Algorithm::MD5, hash); };
+    HRESULT GetBLAKE3(CBinaryBuffer& hash) { return GetHash(Algorithm::BLAKE3, hash); };
 
     static Algorithm GetSupportedAlgorithm(std::wstring_view svAlgo);
     static std::wstring GetSupportedAlgorithm(Algorithm algs);
@@ -58,6 +65,13 @@ protected:
     HCRYPTHASH m_Sha1;
     HCRYPTHASH m_MD5;
 
+    // Used instead of m_Sha1 and m_Sha256 when the processor has the SHA extensions
+    std::optional<ShaExtensionsHash> m_Sha1Ext;
+    std::optional<ShaExtensionsHash> m_Sha256Ext;
+
+    // No CryptoAPI provider implements BLAKE3
+    std::optional<Blake3Hash> m_Blake3;
+
     static HCRYPTPROV g_hProv;
 
     STDMETHOD(ResetHash(bool bContinue = false));
@@ -17,7 +17,8 @@ enum class CryptoHashStreamAlgorithm : char
     Undefined = 0,
     MD5 = 1 << 0,
     SHA1 = 1 << 1,
-    SHA256 = 1 << 2
+    SHA256 = 1 << 2,
+    BLAKE3 = 1 << 3
 };
 
 ENABLE_BITMASK_OPERATORS(CryptoHashStreamAlgorithm)
@@ -24,6 +24,7 @@ public:
 #define BYTES_IN_MD5_HASH 16
 #define BYTES_IN_SHA1_HASH 20
 #define BYTES_IN_SHA256_HASH 32
+#define BYTES_IN_BLAKE3_HASH 32
 #define BYTES_IN_FIRSTBYTES 16
 
 #pragma managed(pop)
@@ -21,6 +21,9 @@
 #include "FileStream.h"
 
 #include "OrcException.h"
+#include "Telemetry.h"
+#include "Trace.h"
+#include "Text/Utf16ToUtf8.h"
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/scope_exit.hpp>
@@ -81,6 +84,15 @@ Orc::TableOutput::CSV::Writer::MakeNew(std::unique_ptr<TableOutput::Options>&& o
     if (FAILED(retval->InitializeBuffer(retval->m_Options->dwBufferSize)))
         return nullptr;
 
+    if (retval->m_Options->dwWriteBuffers > 1)
+    {
+        if (auto hr = retval->StartBackgroundWriter(retval->m_Options->dwWriteBuffers); FAILED(hr))
+        {
+            Log::Error(L"Failed to start CSV background writer [{}]", SystemError(hr));
+            return nullptr;
+        }
+    }
+
     std::wstring strDescr = L"Termination for CSV::Writer";
     retval->m_pTermination = std::make_shared<WriterTermination>(strDescr, retval);
     Robustness::AddTerminationHandler(retval->m_pTermination);
@@ -90,6 +102,8 @@ Orc::TableOutput::CSV::Writer::MakeNew(std::unique_ptr<TableOutput::Options>&& o
 STDMETHODIMP Orc::TableOutput::CSV::Writer::SetSchema(const Schema& schema)
 {
     m_Schema.reserve(schema.size());
+    m_formatted.clear();
+    m_formatted.reserve(schema.size());
 
     bool bFirst = true;
 
@@ -108,6 +122,8 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::SetSchema(const Schema& schema)
                 m_Options->StringDelimiter,
                 csv_col->Format.value_or(L"{}"),
                 m_Options->StringDelimiter);
+            csv_col->Prefix = (bFirst ? emptyStr : m_Options->Delimiter) + m_Options->StringDelimiter;
+            csv_col->Suffix = m_Options->StringDelimiter;
         }
         else if (csv_col->Type == ColumnType::BinaryType || csv_col->Type == ColumnType::FixedBinaryType)
         {
@@ -127,6 +143,16 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::SetSchema(const Schema& schema)
                 fmt::format(L"{}{}", bFirst ? emptyStr : m_Options->Delimiter, csv_col->Format.value_or(L"{}"));
         }
 
+        if (csv_col->Prefix.empty() && !bFirst)
+        {
+            csv_col->Prefix = m_Options->Delimiter;
+        }
+        Text::AppendUtf16ToUtf8(csv_col->Prefix, csv_col->Utf8Prefix);
+        Text::AppendUtf16ToUtf8(csv_col->Suffix, csv_col->Utf8Suffix);
+        csv_col->bDefaultFormat = !csv_col->Format.has_value();
+
+        m_formatted.push_back(csv_col->bDictionary ? std::make_unique<FormattedValues>() : nullptr);
+
         m_Schema.AddColumn(std::move(csv_col));
         bFirst = false;
     }
@@ -166,12 +192,103 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::InitializeBuffer(DWORD dwBufferSize)
         dwPagesToAlloc++;
 
     DWORD dwBytesToAlloc = dwPagesToAlloc * PageSize();
-    m_buffer.reserve(dwBytesToAlloc / sizeof(decltype(m_buffer)::value_type));
-    m_bufferUtf8.reserve(dwBytesToAlloc);
+    m_page.Wide.reserve(dwBytesToAlloc / sizeof(decltype(m_page.Wide)::value_type));
+
+    if (IsUtf8())
+    {
+        m_page.Utf8.reserve(dwBytesToAlloc);
+
+        m_Utf8Delimiter.clear();
+        Text::AppendUtf16ToUtf8(m_Options->Delimiter, m_Utf8Delimiter);
+        m_Utf8EndOfLine.clear();
+        Text::AppendUtf16ToUtf8(m_Options->EndOfLine, m_Utf8EndOfLine);
+    }
 
     return S_OK;
 }
 
+HRESULT Orc::TableOutput::CSV::Writer::StartBackgroundWriter(DWORD dwBuffers)
+{
+    if (m_pages)
+        return S_OK;
+
+    // The page being formatted is one of the 'dwBuffers' pages
+    auto pages = std::make_unique<PageQueue>(dwBuffers - 1);
+
+    for (size_t i = 0; i < pages->Count; i++)
+    {
+        Page page;
+        page.Utf8.reserve(m_page.Utf8.capacity());
+        page.Wide.reserve(m_page.Wide.capacity());
+        pages->Free.Push(std::move(page));
+    }
+
+    pages->Thread = std::thread([this, queue = pages.get()]() {
+        while (auto page = queue->Full.Pop())
+        {
+            if (auto hr = WritePage(*page); FAILED(hr))
+            {
+                Log::Error(L"Failed to write CSV page [{}]", SystemError(hr));
+                queue->hrLastError = hr;
+            }
+            queue->Free.Push(std::move(*page));
+        }
+    });
+
+    m_pages = std::move(pages);
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::CSV::Writer::StopBackgroundWriter()
+{
+    if (!m_pages)
+        return S_OK;
+
+    m_pages->Full.Close();
+    if (m_pages->Thread.joinable())
+        m_pages->Thread.join();
+
+    const HRESULT hr = m_pages->hrLastError;
+    m_pages.reset();
+    return hr;
+}
+
+HRESULT Orc::TableOutput::CSV::Writer::SubmitPage()
+{
+    if (m_page.Utf8.size() == 0 && m_page.Wide.size() == 0)
+        return S_OK;
+
+    auto page = m_pages->Free.Pop();
+    if (!page)
+        return E_UNEXPECTED;
+
+    std::swap(m_page, *page);
+    if (!m_pages->Full.Push(std::move(*page)))
+        return E_UNEXPECTED;
+
+    return m_pages->hrLastError;
+}
+
+HRESULT Orc::TableOutput::CSV::Writer::WaitForPages()
+{
+    // Every page is back in the free list once written
+    std::vector<Page> pages;
+    pages.reserve(m_pages->Count);
+
+    for (size_t i = 0; i < m_pages->Count; i++)
+    {
+        auto page = m_pages->Free.Pop();
+        if (!page)
+            break;
+        pages.push_back(std::move(*page));
+    }
+
+    for (auto& page : pages)
+        m_pages->Free.Push(std::move(page));
+
+    return m_pages->hrLastError;
+}
+
 STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteBOM()
 {
     if (m_pByteStream == nullptr)
@@ -229,6 +346,13 @@ HRESULT Orc::TableOutput::CSV::Writer::WriteToFile(const WCHAR* szFileName)
 
 STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteToStream(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream)
 {
+    if (m_pages)
+    {
+        // Pages queued for the previous stream must be written before switching
+        if (auto hr = SubmitPage(); SUCCEEDED(hr))
+            WaitForPages();
+    }
+
     if (m_pByteStream != nullptr && m_bCloseStream)
     {
         m_pByteStream->Close();
@@ -252,9 +376,41 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::Flush()
 {
     ScopedLock sl(m_cs);
 
+    if (m_pages)
+    {
+        if (auto hr = SubmitPage(); FAILED(hr))
+            return hr;
+
+        return WaitForPages();
+    }
+
+    return WritePage(m_page);
+}
+
+void Orc::TableOutput::CSV::Writer::TranscodeWideText(Page& page)
+{
+    if (page.Wide.size() == 0)
+        return;
+
+    const auto size = page.Utf8.size();
+    page.Utf8.resize(size + Text::Utf8MaxLength(page.Wide.size()));
+
+    const auto cbUtf8 = Text::ConvertUtf16ToUtf8(
+        std::wstring_view(page.Wide.data(), page.Wide.size()), page.Utf8.data() + size);
+
+    page.Utf8.resize(size + cbUtf8);
+    page.Wide.clear();
+}
+
+HRESULT Orc::TableOutput::CSV::Writer::WritePage(Page& page)
+{
     // Always clearing the buffer is the best trade-off. It is a growable buffer, a failure in this function coud
     // trigger a massive memory usage as caller will continue to fill it
-    BOOST_SCOPE_EXIT(&m_buffer) { m_buffer.clear(); }
+    BOOST_SCOPE_EXIT(&page)
+    {
+        page.Utf8.clear();
+        page.Wide.clear();
+    }
     BOOST_SCOPE_EXIT_END;
 
     if (m_pByteStream == nullptr)
@@ -262,54 +418,38 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::Flush()
         return S_OK;
     }
 
-    std::string_view writeBuffer;
-    DWORD dwBytesToWrite = 0L;
+    Telemetry::Scope telemetry(Telemetry::Phase::TableWrite);
 
-    // TODO: fix this with a growable buffer
-    // utf8 buffer size must follow utf16 buffer with a margin for conversion
-    const auto kBufferElementCb = sizeof(decltype(m_buffer)::value_type);
-    const auto kExpectedUtf8Cb = (m_buffer.size() + 8192) * kBufferElementCb;
-    if (m_bufferUtf8.capacity() < kExpectedUtf8Cb)
-    {
-        m_bufferUtf8.reserve(kExpectedUtf8Cb);
-    }
+    std::string_view writeBuffer;
 
     switch (m_Options->Encoding)
     {
         case OutputSpec::Encoding::UTF8:
-            dwBytesToWrite = WideCharToMultiByte(
-                CP_UTF8,
-                0L,
-                reinterpret_cast<LPCWCH>(m_buffer.data()),
-                m_buffer.size(),
-                reinterpret_cast<LPSTR>(m_bufferUtf8.data()),
-                m_bufferUtf8.capacity(),
-                NULL,
-                NULL);
-
-            if (!dwBytesToWrite)
-            {
-                return HRESULT_FROM_WIN32(GetLastError());
-            }
-
-            writeBuffer = std::string_view(m_bufferUtf8.data(), dwBytesToWrite);
+            // Only the text formatted as UTF-16 since the last UTF-8 value is left to transcode
+            TranscodeWideText(page);
+            writeBuffer = std::string_view(page.Utf8.data(), page.Utf8.size());
             break;
         case OutputSpec::Encoding::UTF16:
-            writeBuffer = std::string_view(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size() * sizeof(wchar_t));
+            writeBuffer =
+                std::string_view(reinterpret_cast<char*>(page.Wide.data()), page.Wide.size() * sizeof(wchar_t));
             break;
         default:
             return E_INVALIDARG;
     }
 
     ULONGLONG ullBytesWritten;
+    const auto activity = Trace::TableFlushStart("CSV", 0LL, writeBuffer.size());
     // TODO: this const cast is safe but interface requires it
     auto hr = m_pByteStream->Write(const_cast<char*>(writeBuffer.data()), writeBuffer.size(), &ullBytesWritten);
+    Trace::TableFlushStop(activity, hr);
     if (FAILED(hr))
     {
         return hr;
     }
 
-    if (ullBytesWritten < dwBytesToWrite)
+    telemetry.AddBytes(ullBytesWritten);
+
+    if (ullBytesWritten < writeBuffer.size())
     {
         return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
     }
@@ -329,6 +469,11 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::Close()
 
     Flush();
 
+    if (auto hr = StopBackgroundWriter(); FAILED(hr))
+    {
+        Log::Error(L"CSV background writer failed [{}]", SystemError(hr));
+    }
+
     if (m_pByteStream != nullptr && m_bCloseStream)
     {
         m_pByteStream->Close();
@@ -384,7 +529,8 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteNothing()
 {
     if (m_dwColumnCounter > 0)  // First column does not need the ",", second column will be prepended with it
     {
-        if (auto hr = FormatToBuffer(m_Options->Delimiter); FAILED(hr))
+        AppendText(m_Options->Delimiter, m_Utf8Delimiter);
+        if (auto hr = FlushIfFull(); FAILED(hr))
             return hr;
     }
     AddColumnAndCheckNumbers();
@@ -461,6 +607,14 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteAttributes(DWORD dwFileAttribut
 
 HRESULT Orc::TableOutput::CSV::Writer::WriteFileTime(FILETIME fileTime)
 {
+    if (m_Schema[m_dwColumnCounter].Type == ColumnType::TimeStampType)
+    {
+        if (auto hr = FastFormatColumn(
+                Text::kMaxFileTimeLength, [&fileTime](auto* out) { return Text::FormatFileTime(fileTime, out); });
+            hr != S_FALSE)
+            return hr;
+    }
+
     // Convert the Create time to System time.
     SYSTEMTIME stUTC;
     FileTimeToSystemTime(&fileTime, &stUTC);
@@ -522,13 +676,7 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteTimeStamp(tm tmStamp)
 STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteFileSize(LARGE_INTEGER fileSize)
 {
     // File	size calculation only required for Very	big	files.
-    if (auto hr = FormatColumn(fileSize.QuadPart); FAILED(hr))
-    {
-        AbandonColumn();
-        return hr;
-    }
-    AddColumnAndCheckNumbers();
-    return S_OK;
+    return WriteDecimal(fileSize.QuadPart);
 }
 
 STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteFileSize(DWORD nFileSizeHigh, DWORD nFileSizeLow)
@@ -554,7 +702,8 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::AbandonColumn()
 
 HRESULT Orc::TableOutput::CSV::Writer::WriteEndOfLine()
 {
-    if (auto hr = FormatToBuffer(m_Options->EndOfLine); FAILED(hr))
+    AppendText(m_Options->EndOfLine, m_Utf8EndOfLine);
+    if (auto hr = FlushIfFull(); FAILED(hr))
         return hr;
 
     auto counter = m_dwColumnCounter;
@@ -822,6 +971,10 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteExactFlags(DWORD dwFlags, const
 
 STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteGUID(const GUID& guid)
 {
+    if (auto hr = FastFormatColumn(Text::kGuidLength, [&guid](auto* out) { return Text::FormatGuid(guid, out); });
+        hr != S_FALSE)
+        return hr;
+
     WCHAR szCLSID[MAX_GUID_STRLEN];
     if (!StringFromGUID2(guid, szCLSID, MAX_GUID_STRLEN))
     {
@@ -922,6 +1075,15 @@ STDMETHODIMP Orc::TableOutput::CSV::Writer::WriteBytes(const BYTE pBytes[], DWOR
         return WriteNothing();
     }
 
+    const auto type = m_Schema[m_dwColumnCounter].Type;
+    if (type == ColumnType::BinaryType || type == ColumnType::FixedBinaryType)
+    {
+        if (auto hr = FastFormatColumn(
+                dwLen * 2, [pBytes, dwLen](auto* out) { return Text::FormatHexBytes(pBytes, dwLen, out); });
+            hr != S_FALSE)
+            return hr;
+    }
+
     Buffer<BYTE> buffer;
     buffer.view_of((BYTE*)pBytes, dwLen, dwLen);
 
@@ -11,10 +11,17 @@
 #include "OrcLib.h"
 
 #include "TableOutputWriter.h"
+#include "TableOutputDictionary.h"
 
 #include "OutputSpec.h"
 #include "WideAnsi.h"
 #include "CriticalSection.h"
+#include "BlockingQueue.h"
+#include "Text/FastFormat.h"
+#include "MemoryAccounting.h"
+
+#include <atomic>
+#include <thread>
 
 #pragma managed(push, off)
 
@@ -29,6 +36,13 @@ public:
         : ::Orc::TableOutput::Column(base) {};
     std::wstring FormatColumn;
 
+    // Used instead of 'FormatColumn' by the Text/FastFormat kernels when the column has no user defined 'Format'
+    bool bDefaultFormat = false;
+    std::wstring Prefix;  // delimiter and string delimiter
+    std::wstring Suffix;  // string delimiter
+    std::string Utf8Prefix;  // 'Prefix' and 'Suffix' for Encoding::UTF8 output
+    std::string Utf8Suffix;
+
     virtual ~Column() override final {};
 };
 
@@ -44,8 +58,9 @@ public:
     {
         std::swap(m_pTermination, other.m_pTermination);
         wcscpy_s(m_szFileName, other.m_szFileName);
-        std::swap(m_buffer, other.m_buffer);
-        std::swap(m_bufferUtf8, other.m_bufferUtf8);
+        std::swap(m_page, other.m_page);
+        std::swap(m_Utf8Delimiter, other.m_Utf8Delimiter);
+        std::swap(m_Utf8EndOfLine, other.m_Utf8EndOfLine);
         std::swap(m_Options, other.m_Options);
         std::swap(m_bBOMWritten, other.m_bBOMWritten);
         std::swap(m_pByteStream, other.m_pByteStream);
@@ -53,6 +68,8 @@ public:
         std::swap(m_dwColumnCounter, other.m_dwColumnCounter);
         std::swap(m_dwColumnNumber, other.m_dwColumnNumber);
         std::swap(m_dwPageSize, other.m_dwPageSize);
+        std::swap(m_formatted, other.m_formatted);
+        std::swap(m_memory, other.m_memory);
     }
 
     std::shared_ptr<ByteStream> GetStream() const { return m_pByteStream; };
@@ -85,18 +102,7 @@ public:
 
     STDMETHOD(WriteString)(const std::string& strString) override final
     {
-        if (strString.empty())
-        {
-            return WriteNothing();
-        }
-
-        auto [hr, wstr] = AnsiToWide(strString);
-        if (FAILED(hr))
-        {
-            return hr;
-        }
-
-        return WriteColumn(wstr);
+        return WriteString(std::string_view(strString));
     }
     STDMETHOD(WriteString)(std::string_view strString) override final
     {
@@ -105,6 +111,18 @@ public:
             return WriteNothing();
         }
 
+        if (IsDictionaryColumn())
+        {
+            return WriteDictionaryColumn('A', strString, [this, strString](std::wstring_view strFormat) {
+                auto [hr, wstr] = AnsiToWide(strString);
+                if (FAILED(hr))
+                {
+                    return hr;
+                }
+                return AppendFormatted(strFormat, wstr);
+            });
+        }
+
         auto [hr, wstr] = AnsiToWide(strString);
         if (FAILED(hr))
         {
@@ -138,12 +156,7 @@ public:
 
     STDMETHOD(WriteString)(const std::wstring& strString) override final
     {
-        if (strString.empty())
-        {
-            return WriteNothing();
-        }
-
-        return WriteColumn(strString);
+        return WriteString(std::wstring_view(strString));
     }
 
     STDMETHOD(WriteString)(std::wstring_view strString) override final
@@ -153,6 +166,15 @@ public:
             return WriteNothing();
         }
 
+        if (IsDictionaryColumn())
+        {
+            const std::string_view key(
+                reinterpret_cast<const char*>(strString.data()), strString.size() * sizeof(WCHAR));
+            return WriteDictionaryColumn('W', key, [this, strString](std::wstring_view strFormat) {
+                return AppendFormatted(strFormat, strString);
+            });
+        }
+
         return WriteColumn(strString);
     }
 
@@ -175,12 +197,12 @@ public:
     STDMETHOD(WriteTimeStamp)(tm tmStamp) override final;
 
     STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final;
-    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return WriteColumn(fileSize); }
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return WriteDecimal(fileSize); }
     STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final;
 
-    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return WriteColumn(dwInteger); }
-    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return WriteColumn(dw64Integer); }
-    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return WriteColumn(dw64Integer); }
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return WriteDecimal(dwInteger); }
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return WriteDecimal(dw64Integer); }
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return WriteDecimal(dw64Integer); }
 
     STDMETHOD(WriteBytes)(const BYTE pSHA1[], DWORD dwLen) override final;
     STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final;
@@ -213,13 +235,36 @@ public:
 protected:
     STDMETHOD(WriteHeaders)(const ::Orc::TableOutput::Schema& columns);
 
-    fmt::wmemory_buffer m_buffer;
+    //
+    // Text of a page. UTF-16 output only uses 'Wide'. UTF-8 output is 'Utf8' followed by 'Wide': values with a
+    // Text/FastFormat kernel (integers, timestamps, hex, guids) are written straight to 'Utf8' while the other ones
+    // are formatted to 'Wide', which is transcoded in bulk when a value is next written to 'Utf8' or when the page is
+    // written.
+    //
+    struct Page
+    {
+        fmt::memory_buffer Utf8;
+        fmt::wmemory_buffer Wide;
+    };
+
+    Page m_page;
+
+    // Page buffers (the one being formatted and the queued ones) charged to the 'table_write' memory tag
+    MemoryAccounting::Allocation m_memory {MemoryAccounting::Tag::TableWrite};
+
+    ULONGLONG BufferBytes() const
+    {
+        const auto ullPageBytes = m_page.Utf8.capacity() + m_page.Wide.capacity() * sizeof(WCHAR);
+        return ullPageBytes * (1 + (m_pages ? m_pages->Count : 0));
+    }
 
     std::shared_ptr<WriterTermination> m_pTermination;
 
     WCHAR m_szFileName[ORC_MAX_PATH] = {0};
 
-    std::vector<char> m_bufferUtf8;
+    // Options 'Delimiter' and 'EndOfLine' for Encoding::UTF8 output
+    std::string m_Utf8Delimiter;
+    std::string m_Utf8EndOfLine;
 
     bool m_bBOMWritten = false;
     std::shared_ptr<ByteStream> m_pByteStream = nullptr;
@@ -231,6 +276,20 @@ protected:
 
     std::unique_ptr<Options> m_Options;
 
+    // Formatted text of the values already written to a column declared with 'dictionary="yes"'
+    struct FormattedValues
+    {
+        static constexpr size_t kMaxEntries = 1 << 16;
+        static constexpr size_t kMaxBytes = 16 * 1024 * 1024;
+
+        StringDictionary Values {kMaxEntries, kMaxBytes};
+        std::vector<std::wstring> Text;
+    };
+
+    // Indexed by column, null for the columns without 'dictionary="yes"'
+    std::vector<std::unique_ptr<FormattedValues>> m_formatted;
+    std::string m_dictionaryKey;
+
     // Taille d'une page (en octets)
     DWORD m_dwPageSize = 0L;
     DWORD PageSize()
@@ -291,17 +350,29 @@ protected:
 
     template <typename... Args>
     HRESULT FormatToBuffer(std::wstring_view strFormat, Args&&... args)
+    {
+        if (auto hr = AppendFormatted(strFormat, std::forward<Args>(args)...); FAILED(hr))
+        {
+            return hr;
+        }
+
+        return FlushIfFull();
+    }
+
+    // Format to the current page, without flushing it
+    template <typename... Args>
+    HRESULT AppendFormatted(std::wstring_view strFormat, Args&&... args)
     {
         try
         {
             if (strFormat.find(L"\"{}\"") != std::wstring::npos)
             {
-                auto escapedBuffer = EscapeQuoteInserter(m_buffer);
+                auto escapedBuffer = EscapeQuoteInserter(m_page.Wide);
                 fmt::format_to(std::back_inserter(escapedBuffer), strFormat, std::forward<Args>(args)...);
             }
             else
             {
-                fmt::format_to(std::back_inserter(m_buffer), strFormat, std::forward<Args>(args)...);
+                fmt::format_to(std::back_inserter(m_page.Wide), strFormat, std::forward<Args>(args)...);
             }
         }
         catch (const fmt::format_error& error)
@@ -310,10 +381,39 @@ protected:
             return E_INVALIDARG;
         }
 
-        // Flush when buffer is over 80% of its capacity
-        if (m_buffer.size() > (80 * m_buffer.capacity() / 100))
+        return S_OK;
+    }
+
+    bool IsUtf8() const { return m_Options->Encoding == OutputSpec::Encoding::UTF8; }
+
+    // Append the text of 'page.Wide' to 'page.Utf8' (UTF-8 output only)
+    static void TranscodeWideText(Page& page);
+
+    // Append text known in both encodings, like delimiters
+    void AppendText(std::wstring_view wide, std::string_view utf8)
+    {
+        if (IsUtf8())
+        {
+            TranscodeWideText(m_page);
+            m_page.Utf8.append(utf8.data(), utf8.data() + utf8.size());
+        }
+        else
+        {
+            m_page.Wide.append(wide.data(), wide.data() + wide.size());
+        }
+    }
+
+    // Flush when buffer is over 80% of its capacity, or holds a memory page when table writers are over their soft
+    // limit
+    HRESULT FlushIfFull()
+    {
+        const bool bOverSoftLimit = !m_memory.Set(BufferBytes());
+
+        if (m_page.Wide.size() > (80 * m_page.Wide.capacity() / 100)
+            || m_page.Utf8.size() > (80 * m_page.Utf8.capacity() / 100)
+            || (bOverSoftLimit && m_page.Utf8.size() + m_page.Wide.size() * sizeof(WCHAR) > PageSize()))
         {
-            if (auto hr = Flush(); FAILED(hr))
+            if (auto hr = m_pages ? SubmitPage() : Flush(); FAILED(hr))
             {
                 return hr;
             }
@@ -346,10 +446,171 @@ protected:
         return S_OK;
     }
 
+    //
+    // Write the current column with a Text/FastFormat kernel writing at most 'maxLength' characters. Returns S_FALSE,
+    // with nothing written, when the column has a user defined format or when 'kernel' cannot format the value: the
+    // caller must then go through FormatColumn.
+    //
+    template <typename Kernel>
+    HRESULT FastFormatColumn(size_t maxLength, Kernel&& kernel)
+    {
+        auto pCol = static_cast<const Column*>(&m_Schema[m_dwColumnCounter]);
+        if (!pCol->bDefaultFormat)
+            return S_FALSE;
+
+        bool bFormatted = false;
+        if (IsUtf8())
+        {
+            TranscodeWideText(m_page);
+            bFormatted = AppendFastFormatted(m_page.Utf8, pCol->Utf8Prefix, pCol->Utf8Suffix, maxLength, kernel);
+        }
+        else
+        {
+            bFormatted = AppendFastFormatted(m_page.Wide, pCol->Prefix, pCol->Suffix, maxLength, kernel);
+        }
+
+        if (!bFormatted)
+            return S_FALSE;
+
+        if (auto hr = FlushIfFull(); FAILED(hr))
+        {
+            AbandonColumn();
+            return hr;
+        }
+        AddColumnAndCheckNumbers();
+        return S_OK;
+    }
+
+    template <typename Buffer, typename String, typename Kernel>
+    static bool
+    AppendFastFormatted(Buffer& buffer, const String& prefix, const String& suffix, size_t maxLength, Kernel& kernel)
+    {
+        const auto size = buffer.size();
+        buffer.resize(size + prefix.size() + maxLength + suffix.size());
+
+        auto out = std::copy(std::cbegin(prefix), std::cend(prefix), buffer.data() + size);
+        out = kernel(out);
+        if (out == nullptr)
+        {
+            buffer.resize(size);
+            return false;
+        }
+        out = std::copy(std::cbegin(suffix), std::cend(suffix), out);
+        buffer.resize(out - buffer.data());
+        return true;
+    }
+
+    template <typename T>
+    HRESULT WriteDecimal(T value)
+    {
+        using integer_type = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+
+        if (auto hr = FastFormatColumn(
+                Text::kMaxDecimalLength,
+                [value](auto* out) { return Text::FormatDecimal(static_cast<integer_type>(value), out); });
+            hr != S_FALSE)
+            return hr;
+
+        if (IsDictionaryColumn())
+        {
+            const auto integer = static_cast<integer_type>(value);
+            const std::string_view key(reinterpret_cast<const char*>(&integer), sizeof(integer));
+            return WriteDictionaryColumn('I', key, [this, value](std::wstring_view strFormat) {
+                return AppendFormatted(strFormat, value);
+            });
+        }
+
+        return WriteColumn(value);
+    }
+
+    bool IsDictionaryColumn() const
+    {
+        return m_dwColumnCounter < m_formatted.size() && m_formatted[m_dwColumnCounter] != nullptr;
+    }
+
+    //
+    // Write the current column with the text formatted the first time 'key' was written to it, 'format' appends it to
+    // the page otherwise. 'kind' keeps apart the keys of values of different types.
+    //
+    template <typename Format>
+    HRESULT WriteDictionaryColumn(char kind, std::string_view key, Format&& format)
+    {
+        auto pCol = static_cast<const Column*>(&m_Schema[m_dwColumnCounter]);
+        auto& formatted = *m_formatted[m_dwColumnCounter];
+
+        m_dictionaryKey.assign(1, kind);
+        m_dictionaryKey.append(key);
+
+        if (auto index = formatted.Values.Find(m_dictionaryKey))
+        {
+            const auto& text = formatted.Text[index.value()];
+            m_page.Wide.append(text.data(), text.data() + text.size());
+        }
+        else
+        {
+            const auto size = m_page.Wide.size();
+            if (auto hr = format(std::wstring_view(pCol->FormatColumn)); FAILED(hr))
+            {
+                AbandonColumn();
+                return hr;
+            }
+
+            if (!formatted.Values.IsFull())
+            {
+                formatted.Values.Insert(m_dictionaryKey);
+                formatted.Text.emplace_back(m_page.Wide.data() + size, m_page.Wide.size() - size);
+            }
+        }
+
+        if (auto hr = FlushIfFull(); FAILED(hr))
+        {
+            AbandonColumn();
+            return hr;
+        }
+        AddColumnAndCheckNumbers();
+        return S_OK;
+    }
+
     HRESULT AddColumnAndCheckNumbers();
 
     STDMETHOD(InitializeBuffer)(DWORD dwBufferSize);
 
+    // Encode 'page' and write it to the stream, 'page' is always cleared
+    HRESULT WritePage(Page& page);
+
+    //
+    // Asynchronous mode (Options::dwWriteBuffers > 1): full pages are handed over to a background thread which encodes
+    // and writes them to the stream while the next page is formatted. Written pages are recycled, a writer only waits
+    // when all the pages are queued.
+    //
+    struct PageQueue
+    {
+        PageQueue(size_t count)
+            : Full(count)
+            , Free(count)
+            , Count(count)
+        {
+        }
+
+        BlockingQueue<Page> Full;
+        BlockingQueue<Page> Free;
+        const size_t Count;  // pages in circulation, the page being formatted excluded
+
+        std::atomic<HRESULT> hrLastError = S_OK;
+        std::thread Thread;
+    };
+
+    std::unique_ptr<PageQueue> m_pages;
+
+    HRESULT StartBackgroundWriter(DWORD dwBuffers);
+    HRESULT StopBackgroundWriter();
+
+    // Queue the current page and swap it with a free one
+    HRESULT SubmitPage();
+
+    // Wait until every queued page is written to the stream
+    HRESULT WaitForPages();
+
     STDMETHOD(WriteBOM)();
 };
 }  // namespace Orc::TableOutput::CSV
@@ -0,0 +1,561 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "CsvMappedFileReader.h"
+
+#include "SimdDispatch.h"
+#include "TaskPool.h"
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <limits>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_CSV_SIMD
+#endif
+
+using namespace Orc;
+using namespace Orc::TableOutput::CSV;
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+
+// Bit i is set when byte i of a 64 bytes block is a quote, a separator or a line feed
+struct BlockMasks
+{
+    uint64_t quote;
+    uint64_t separator;
+    uint64_t lineFeed;
+};
+
+using ClassifyFn = BlockMasks (*)(const char* p, char cSeparator, char cQuote);
+
+BlockMasks ClassifyScalar(const char* p, char cSeparator, char cQuote)
+{
+    BlockMasks masks = {0LL, 0LL, 0LL};
+    for (size_t i = 0; i < kBlockSize; i++)
+    {
+        const uint64_t bit = 1ULL << i;
+        if (p[i] == cQuote)
+            masks.quote |= bit;
+        else if (p[i] == cSeparator)
+            masks.separator |= bit;
+        else if (p[i] == '\n')
+            masks.lineFeed |= bit;
+    }
+    return masks;
+}
+
+#ifdef ORC_CSV_SIMD
+
+template <bool bAVX2>
+BlockMasks ClassifySimd(const char* p, char cSeparator, char cQuote)
+{
+    if constexpr (bAVX2)
+    {
+        const auto quote = _mm256_set1_epi8(cQuote);
+        const auto separator = _mm256_set1_epi8(cSeparator);
+        const auto lineFeed = _mm256_set1_epi8('\n');
+
+        const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+
+        const auto mask = [&lo, &hi](__m256i value) {
+            return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, value))))
+                | (static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, value))))
+                   << 32);
+        };
+
+        return {mask(quote), mask(separator), mask(lineFeed)};
+    }
+    else
+    {
+        const auto quote = _mm_set1_epi8(cQuote);
+        const auto separator = _mm_set1_epi8(cSeparator);
+        const auto lineFeed = _mm_set1_epi8('\n');
+
+        __m128i bytes[4];
+        for (size_t i = 0; i < 4; i++)
+        {
+            bytes[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+        }
+
+        const auto mask = [&bytes](__m128i value) {
+            uint64_t result = 0LL;
+            for (size_t i = 0; i < 4; i++)
+            {
+                result |= static_cast<uint64_t>(static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes[i], value))))
+                    << (i * 16);
+            }
+            return result;
+        };
+
+        return {mask(quote), mask(separator), mask(lineFeed)};
+    }
+}
+
+#endif  // ORC_CSV_SIMD
+
+ClassifyFn Kernel()
+{
+    static const SimdDispatch::Kernel<ClassifyFn> kernel(
+        L"csv_classify",
+        {
+#ifdef ORC_CSV_SIMD
+            {SimdDispatch::Level::AVX2, ClassifySimd<true>},
+            {SimdDispatch::Level::SSE2, ClassifySimd<false>},
+#endif
+            {SimdDispatch::Level::Scalar, ClassifyScalar}});
+
+    return kernel.Get();
+}
+
+// Bit i of the result is the parity of the bits 0 to i of 'x': set from an opening quote up to its closing quote
+inline uint64_t PrefixXor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+inline size_t FirstBit(uint64_t x)
+{
+    unsigned long index = 0;
+#ifdef _M_X64
+    _BitScanForward64(&index, x);
+#else
+    if (!_BitScanForward(&index, static_cast<uint32_t>(x)))
+    {
+        _BitScanForward(&index, static_cast<uint32_t>(x >> 32));
+        index += 32;
+    }
+#endif
+    return index;
+}
+
+inline ULONGLONG CountBits(uint64_t x)
+{
+    return std::bitset<64>(x).count();
+}
+
+// Call 'onBlock(offset, masks, inQuotes)' for each block of [begin, end), 'begin' being outside quotes.
+// Bytes past 'end' in the last block are masked out.
+template <typename OnBlock>
+HRESULT ForEachBlock(const char* pData, size_t begin, size_t end, char cSeparator, char cQuote, OnBlock&& onBlock)
+{
+    const auto classify = Kernel();
+
+    uint64_t inQuotesCarry = 0LL;
+    for (size_t offset = begin; offset < end; offset += kBlockSize)
+    {
+        BlockMasks masks;
+        if (end - offset >= kBlockSize)
+        {
+            masks = classify(pData + offset, cSeparator, cQuote);
+        }
+        else
+        {
+            // Separators and quotes are never NUL
+            char tail[kBlockSize] = {0};
+            CopyMemory(tail, pData + offset, end - offset);
+            masks = classify(tail, cSeparator, cQuote);
+        }
+
+        const auto inQuotes = PrefixXor(masks.quote) ^ inQuotesCarry;
+        inQuotesCarry = (inQuotes >> 63) ? ~0ULL : 0ULL;
+
+        if (auto hr = onBlock(offset, masks, inQuotes); hr != S_OK)
+            return hr;
+    }
+
+    return S_OK;
+}
+
+// Build rows from the separators and line feeds found outside quotes
+class RowBuilder
+{
+public:
+    RowBuilder(const char* pData, char cQuote, ULONGLONG ullFirstLine, size_t rowBegin)
+        : m_pData(pData)
+        , m_cQuote(cQuote)
+        , m_FieldBegin(rowBegin)
+    {
+        m_Row.ullLineNumber = ullFirstLine;
+        m_ullNextLine = ullFirstLine;
+    }
+
+    void AddField(size_t end, bool bEndOfLine)
+    {
+        auto field = std::string_view(m_pData + m_FieldBegin, end - m_FieldBegin);
+
+        if (bEndOfLine && !field.empty() && field.back() == '\r')
+            field.remove_suffix(1);
+
+        if (field.size() >= 2 && field.front() == m_cQuote && field.back() == m_cQuote)
+            field = field.substr(1, field.size() - 2);
+
+        m_Row.Fields.push_back(field);
+        m_FieldBegin = end + 1;
+    }
+
+    // 'ullLines' is the count of lines of the row, more than one for quoted fields spanning several lines
+    HRESULT EndRow(ULONGLONG ullLines, const MappedFileReader::RowCallback& onRow)
+    {
+        HRESULT hr = S_OK;
+
+        // Blank lines are not rows
+        if (m_Row.Fields.size() > 1 || !m_Row.Fields.front().empty())
+            hr = onRow(m_Row);
+
+        m_ullNextLine += ullLines;
+        m_Row.ullLineNumber = m_ullNextLine;
+        m_Row.Fields.clear();
+        return hr;
+    }
+
+    bool HasPendingField(size_t end) const { return m_FieldBegin < end || !m_Row.Fields.empty(); }
+
+private:
+    const char* m_pData;
+    char m_cQuote;
+    size_t m_FieldBegin;
+    ULONGLONG m_ullNextLine;
+    MappedFileReader::Row m_Row;
+};
+
+}  // namespace
+
+HRESULT MappedFileReader::OpenFile(const WCHAR* szFileName, bool bFirstRowIsColumnNames, char cSeparator, char cQuote)
+{
+    HRESULT hr = E_FAIL;
+
+    if (IsFileOpened())
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+
+    if (cSeparator == '\0' || cQuote == '\0' || cSeparator == cQuote || cSeparator == '\n' || cQuote == '\n')
+        return E_INVALIDARG;
+
+    m_cSeparator = cSeparator;
+    m_cQuote = cQuote;
+
+    m_hFile = CreateFileW(
+        szFileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (!m_hFile.IsValid())
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to open csv file '{}' [{}]", szFileName, SystemError(hr));
+        return hr;
+    }
+
+    LARGE_INTEGER liSize;
+    if (!GetFileSizeEx(*m_hFile, &liSize))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to get size of csv file '{}' [{}]", szFileName, SystemError(hr));
+        Close();
+        return hr;
+    }
+
+    if (static_cast<ULONGLONG>(liSize.QuadPart) > std::numeric_limits<size_t>::max())
+    {
+        Log::Error(L"Csv file '{}' is too large to be mapped ({} bytes)", szFileName, liSize.QuadPart);
+        Close();
+        return HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE);
+    }
+
+    // Empty files cannot be mapped, they have no rows anyway
+    if (liSize.QuadPart > 0)
+    {
+        m_hMapping = CreateFileMappingW(*m_hFile, NULL, PAGE_READONLY, 0L, 0L, NULL);
+        if (!m_hMapping.IsValid())
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to map csv file '{}' [{}]", szFileName, SystemError(hr));
+            Close();
+            return hr;
+        }
+
+        m_pData = static_cast<const char*>(MapViewOfFile(*m_hMapping, FILE_MAP_READ, 0L, 0L, 0L));
+        if (m_pData == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to map view of csv file '{}' [{}]", szFileName, SystemError(hr));
+            Close();
+            return hr;
+        }
+
+        m_cbData = static_cast<size_t>(liSize.QuadPart);
+    }
+
+    m_RowsBegin = 0;
+    m_ullRowsFirstLine = 1LL;
+
+    const auto data = std::string_view(m_pData, m_cbData);
+    if (data.substr(0, 2) == "\xFF\xFE")
+    {
+        Log::Error(L"Csv file '{}' is UTF-16 encoded, only UTF-8 files can be mapped", szFileName);
+        Close();
+        return HRESULT_FROM_WIN32(ERROR_UNSUPPORTED_TYPE);
+    }
+
+    if (data.substr(0, 3) == "\xEF\xBB\xBF")
+    {
+        m_RowsBegin = 3;
+    }
+
+    if (bFirstRowIsColumnNames && m_RowsBegin < m_cbData)
+    {
+        // The header ends at the first line feed outside quotes
+        size_t headerEnd = m_cbData;
+        ForEachBlock(
+            m_pData,
+            m_RowsBegin,
+            m_cbData,
+            m_cSeparator,
+            m_cQuote,
+            [&headerEnd](size_t offset, const BlockMasks& masks, uint64_t inQuotes) -> HRESULT {
+                if (const auto lineFeeds = masks.lineFeed & ~inQuotes)
+                {
+                    headerEnd = offset + FirstBit(lineFeeds);
+                    return S_FALSE;
+                }
+                return S_OK;
+            });
+
+        const auto headerBegin = m_RowsBegin;
+        m_RowsBegin = std::min(headerEnd + 1, m_cbData);
+        m_ullRowsFirstLine = 1LL + std::count(m_pData + headerBegin, m_pData + m_RowsBegin, '\n');
+
+        ParseRange(headerBegin, headerEnd, 1LL, [this](const Row& row) -> HRESULT {
+            m_ColumnNames = row.Fields;
+            return S_FALSE;
+        });
+    }
+
+    Log::Debug(L"Mapped csv file '{}' ({} bytes, {} columns)", szFileName, m_cbData, m_ColumnNames.size());
+    return S_OK;
+}
+
+HRESULT MappedFileReader::Close()
+{
+    m_ColumnNames.clear();
+
+    if (m_pData != nullptr)
+    {
+        UnmapViewOfFile(m_pData);
+        m_pData = nullptr;
+        m_cbData = 0;
+    }
+
+    if (m_hMapping.IsValid())
+        CloseHandle(m_hMapping.release());
+
+    if (m_hFile.IsValid())
+        CloseHandle(m_hFile.release());
+
+    return S_OK;
+}
+
+HRESULT MappedFileReader::ParseRange(size_t begin, size_t end, ULONGLONG ullFirstLine, const RowCallback& onRow) const
+{
+    RowBuilder builder(m_pData, m_cQuote, ullFirstLine, begin);
+
+    // Lines of the current row, quoted line feeds included
+    ULONGLONG ullRowLines = 1LL;
+
+    auto hr = ForEachBlock(
+        m_pData,
+        begin,
+        end,
+        m_cSeparator,
+        m_cQuote,
+        [&builder, &ullRowLines, &onRow](size_t offset, const BlockMasks& masks, uint64_t inQuotes) -> HRESULT {
+            const auto quotedLineFeeds = masks.lineFeed & inQuotes;
+
+            auto structurals = (masks.separator | masks.lineFeed) & ~inQuotes;
+            while (structurals)
+            {
+                const auto bit = FirstBit(structurals);
+                const auto bitMask = 1ULL << bit;
+                structurals &= structurals - 1;
+
+                const bool bEndOfLine = (masks.lineFeed & bitMask) != 0;
+                builder.AddField(offset + bit, bEndOfLine);
+
+                if (bEndOfLine)
+                {
+                    if (quotedLineFeeds)
+                        ullRowLines += CountBits(quotedLineFeeds & (bitMask - 1));
+
+                    if (auto hr = builder.EndRow(ullRowLines, onRow); hr != S_OK)
+                        return hr;
+
+                    // Quoted line feeds of this block before this one belong to the previous row
+                    ullRowLines = 1LL - (quotedLineFeeds ? CountBits(quotedLineFeeds & (bitMask - 1)) : 0LL);
+                }
+            }
+
+            if (quotedLineFeeds)
+                ullRowLines += CountBits(quotedLineFeeds);
+
+            return S_OK;
+        });
+
+    if (hr != S_OK)
+        return hr;
+
+    // Last row without a line feed
+    if (builder.HasPendingField(end))
+    {
+        builder.AddField(end, true);
+        return builder.EndRow(ullRowLines, onRow);
+    }
+
+    return S_OK;
+}
+
+HRESULT MappedFileReader::ParseRows(const RowCallback& onRow) const
+{
+    if (!IsFileOpened())
+        return E_POINTER;
+
+    return ParseRange(m_RowsBegin, m_cbData, m_ullRowsFirstLine, onRow);
+}
+
+HRESULT MappedFileReader::ParseRowsParallel(const RowCallback& onRow, size_t cbChunk) const
+{
+    if (!IsFileOpened())
+        return E_POINTER;
+
+    // Chunks end right after a line feed
+    std::vector<Chunk> chunks;
+    for (size_t begin = m_RowsBegin; begin < m_cbData;)
+    {
+        size_t end = begin + std::max<size_t>(cbChunk, kBlockSize);
+        if (end >= m_cbData)
+        {
+            end = m_cbData;
+        }
+        else
+        {
+            const auto lineFeed = static_cast<const char*>(memchr(m_pData + end, '\n', m_cbData - end));
+            end = lineFeed ? lineFeed - m_pData + 1 : m_cbData;
+        }
+
+        chunks.push_back({begin, end});
+        begin = end;
+    }
+
+    if (chunks.size() <= 1)
+        return ParseRows(onRow);
+
+    // When a chunk does not start outside quotes, the first such chunk follows one ending with a quoted line feed: a
+    // chunk parsed as if it started outside quotes finds quoted line feeds if and only if the file has some
+    TaskPool::ParallelFor(TaskPool::Subsystem::Table, size_t(0), chunks.size(), [this, &chunks](size_t i) {
+        auto& chunk = chunks[i];
+        ForEachBlock(
+            m_pData,
+            chunk.Begin,
+            chunk.End,
+            m_cSeparator,
+            m_cQuote,
+            [&chunk](size_t, const BlockMasks& masks, uint64_t inQuotes) -> HRESULT {
+                if (masks.lineFeed & inQuotes)
+                {
+                    chunk.bQuotedLineFeed = true;
+                    return S_FALSE;
+                }
+
+                chunk.ullLineCount += CountBits(masks.lineFeed);
+                return S_OK;
+            });
+    });
+
+    ULONGLONG ullFirstLine = m_ullRowsFirstLine;
+    std::vector<ULONGLONG> firstLines;
+    for (const auto& chunk : chunks)
+    {
+        if (chunk.bQuotedLineFeed)
+        {
+            Log::Debug("Csv file has quoted fields spanning several lines, it is parsed sequentially");
+            return ParseRows(onRow);
+        }
+
+        firstLines.push_back(ullFirstLine);
+        ullFirstLine += chunk.ullLineCount;
+    }
+
+    // First value returned by 'onRow' which stopped the parsing, other chunks stop at their next row
+    std::atomic<HRESULT> stopResult(S_OK);
+    std::vector<HRESULT> results(chunks.size(), S_OK);
+
+    TaskPool::ParallelFor(TaskPool::Subsystem::Table, size_t(0), chunks.size(), [&](size_t i) {
+        if (stopResult != S_OK)
+            return;
+
+        results[i] = ParseRange(chunks[i].Begin, chunks[i].End, firstLines[i], [&stopResult, &onRow](const Row& row) {
+            if (stopResult != S_OK)
+                return S_FALSE;
+
+            const auto hr = onRow(row);
+            if (hr != S_OK)
+            {
+                HRESULT expected = S_OK;
+                stopResult.compare_exchange_strong(expected, hr);
+            }
+
+            return hr;
+        });
+    });
+
+    if (stopResult != S_OK)
+        return stopResult;
+
+    for (const auto hr : results)
+    {
+        if (hr != S_OK)
+            return hr;
+    }
+
+    return S_OK;
+}
+
+std::string_view MappedFileReader::Unquote(std::string_view field, std::string& storage) const
+{
+    const char doubled[] = {m_cQuote, m_cQuote};
+
+    auto pos = field.find(std::string_view(doubled, 2));
+    if (pos == std::string_view::npos)
+        return field;
+
+    storage.clear();
+    while (pos != std::string_view::npos)
+    {
+        storage.append(field.data(), pos + 1);
+        field.remove_prefix(pos + 2);
+        pos = field.find(std::string_view(doubled, 2));
+    }
+
+    storage.append(field);
+    return storage;
+}
+
+MappedFileReader::~MappedFileReader()
+{
+    Close();
+}
@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "Utils/Guard.h"
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+namespace TableOutput::CSV {
+
+//
+// MappedFileReader: reader for large UTF-8 CSV files, like the ones written by NTFSInfo.
+//
+// The file is mapped in memory and its structure (quotes, separators and line feeds) is indexed 64 bytes at a time with
+// SSE2 or AVX2, the quoted spans being computed from the quote positions with a prefix xor. Rows are handed out as views
+// on the mapping: nothing is copied nor converted to UTF-16.
+//
+// Without quoted fields spanning several lines, rows are found in chunks parsed on several threads.
+//
+class MappedFileReader
+{
+public:
+    static constexpr size_t kDefaultChunkSize = 16 * 1024 * 1024;
+
+    class Row
+    {
+    public:
+        // Line of the row in the file, starting at 1
+        ULONGLONG ullLineNumber = 0LL;
+
+        // Fields of the row, without their enclosing quotes: quotes doubled inside a quoted field are kept (see Unquote)
+        std::vector<std::string_view> Fields;
+    };
+
+    // Called for each row: S_OK continues parsing, any other value stops it and is returned by ParseRows
+    using RowCallback = std::function<HRESULT(const Row& row)>;
+
+    MappedFileReader() = default;
+    ~MappedFileReader();
+
+    MappedFileReader(const MappedFileReader&) = delete;
+    MappedFileReader& operator=(const MappedFileReader&) = delete;
+
+    HRESULT OpenFile(const WCHAR* szFileName, bool bFirstRowIsColumnNames = true, char cSeparator = ',', char cQuote = '"');
+    HRESULT Close();
+
+    bool IsFileOpened() const { return m_pData != nullptr || m_hFile.IsValid(); }
+
+    // Views on the header row, valid until the file is closed
+    const std::vector<std::string_view>& GetColumnNames() const { return m_ColumnNames; }
+
+    // Parse the rows in file order on the calling thread, views are valid until 'onRow' returns
+    HRESULT ParseRows(const RowCallback& onRow) const;
+
+    // Parse the rows by chunks on several threads: 'onRow' is called concurrently, in file order within a chunk only.
+    // Files with quoted fields spanning several lines are parsed by ParseRows.
+    HRESULT ParseRowsParallel(const RowCallback& onRow, size_t cbChunk = kDefaultChunkSize) const;
+
+    // Value of a field with its doubled quotes unescaped, 'storage' is only used when there are some
+    std::string_view Unquote(std::string_view field, std::string& storage) const;
+
+private:
+    struct Chunk
+    {
+        size_t Begin = 0;
+        size_t End = 0;
+        ULONGLONG ullLineCount = 0LL;
+        bool bQuotedLineFeed = false;
+    };
+
+    HRESULT ParseRange(size_t begin, size_t end, ULONGLONG ullFirstLine, const RowCallback& onRow) const;
+
+    Guard::FileHandle m_hFile;
+    Guard::Handle m_hMapping;
+    const char* m_pData = nullptr;
+    size_t m_cbData = 0;
+
+    char m_cSeparator = ',';
+    char m_cQuote = '"';
+
+    std::vector<std::string_view> m_ColumnNames;
+
+    // Rows following the header
+    size_t m_RowsBegin = 0;
+    ULONGLONG m_ullRowsFirstLine = 1LL;
+};
+
+}  // namespace TableOutput::CSV
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -35,6 +35,7 @@ private:
     CBinaryBuffer m_Sha1;
     CBinaryBuffer m_Sha256;
     CBinaryBuffer m_MD5;
+    CBinaryBuffer m_Blake3;
 
     std::wstring m_ssdeep;
 
@@ -109,6 +110,12 @@ public:
         return S_OK;
     }
     CBinaryBuffer& SHA256() { return m_Sha256; }
+    HRESULT SetBLAKE3(CBinaryBuffer&& buffer)
+    {
+        std::swap(m_Blake3, buffer);
+        return S_OK;
+    }
+    CBinaryBuffer& BLAKE3() { return m_Blake3; }
 
     HRESULT SetSSDeep(std::wstring&& ssdeep)
     {
@@ -120,7 +127,7 @@ public:
     bool HashAvailable() const
     {
         return m_MD5.GetCount() == BYTES_IN_MD5_HASH || m_Sha1.GetCount() == BYTES_IN_SHA1_HASH
-            || m_Sha256.GetCount() == BYTES_IN_SHA256_HASH;
+            || m_Sha256.GetCount() == BYTES_IN_SHA256_HASH || m_Blake3.GetCount() == BYTES_IN_BLAKE3_HASH;
     }
 
     void SetHashChecked(bool bChecked) { m_bHashChecked = bChecked; }
@@ -10,8 +10,11 @@
 
 #include "DiskExtent.h"
 
+#include "IoGovernor.h"
 #include "Kernel32Extension.h"
 
+#include <chrono>
+
 #include <crtdbg.h>
 
 #include "Log/Log.h"
@@ -50,6 +53,8 @@ CDiskExtent::CDiskExtent(CDiskExtent&& Other) noexcept
     Other.m_LogicalSectorSize = 0;
     m_PhysicalSectorSize = Other.m_PhysicalSectorSize;
     Other.m_PhysicalSectorSize = 0;
+    m_MaxTransferLength = Other.m_MaxTransferLength;
+    Other.m_MaxTransferLength = 0;
     m_liCurrentPos = Other.m_liCurrentPos;
     m_Start = Other.m_Start;
     m_Name = std::move(Other.m_Name);
@@ -62,6 +67,7 @@ CDiskExtent::CDiskExtent(const CDiskExtent& Other) noexcept
     m_Length = Other.m_Length;
     m_LogicalSectorSize = Other.m_LogicalSectorSize;
     m_PhysicalSectorSize = Other.m_PhysicalSectorSize;
+    m_MaxTransferLength = Other.m_MaxTransferLength;
     m_liCurrentPos = Other.m_liCurrentPos;
     m_Start = Other.m_Start;
 }
@@ -74,6 +80,7 @@ CDiskExtent& CDiskExtent::operator=(const CDiskExtent& other)
     m_LogicalSectorSize = other.m_LogicalSectorSize;
     m_Name = other.m_Name;
     m_PhysicalSectorSize = other.m_PhysicalSectorSize;
+    m_MaxTransferLength = other.m_MaxTransferLength;
     m_Start = other.m_Start;
     return *this;
 }
@@ -112,6 +119,8 @@ HRESULT CDiskExtent::Open(DWORD dwShareMode, DWORD dwCreationDisposition, DWORD
         return hr;
     }
 
+    IoGovernor::Instance().SetLowPriority(m_hFile);
+
     ULARGE_INTEGER liLength = {0};
     DWORD dwOutBytes = 0;
     DWORD ioctlLastError, lastError;
@@ -180,8 +189,12 @@ HRESULT CDiskExtent::Read(__in_bcount(dwCount) PVOID lpBuf, DWORD dwCount, PDWOR
     _ASSERT(INVALID_HANDLE_VALUE != m_hFile);
     _ASSERT(pdwBytesRead != nullptr);
 
+    auto& governor = IoGovernor::Instance();
+    governor.Throttle(dwCount);
+
     DWORD dwBytesRead = 0;
     Log::Trace(L"CDiskExtent: Reading {} bytes", dwCount);
+    const auto start = std::chrono::steady_clock::now();
     if (!ReadFile(m_hFile, lpBuf, dwCount, &dwBytesRead, NULL))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
@@ -190,6 +203,10 @@ HRESULT CDiskExtent::Read(__in_bcount(dwCount) PVOID lpBuf, DWORD dwCount, PDWOR
         return hr;
     }
 
+    governor.Record(
+        dwBytesRead,
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start));
+
     m_liCurrentPos.QuadPart += dwBytesRead;
     *pdwBytesRead = dwBytesRead;
     return S_OK;
@@ -234,6 +251,7 @@ CDiskExtent CDiskExtent::ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD
     ext.m_LogicalSectorSize = m_LogicalSectorSize;
     ext.m_Name = m_Name;
     ext.m_PhysicalSectorSize = m_PhysicalSectorSize;
+    ext.m_MaxTransferLength = m_MaxTransferLength;
     ext.m_Start = m_Start;
 
     const auto k32 = ExtensionLibrary::GetLibrary<Kernel32Extension>();
@@ -253,6 +271,11 @@ CDiskExtent CDiskExtent::ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD
             ext.m_hFile = INVALID_HANDLE_VALUE;
         }
     }
+
+    if (ext.m_hFile != INVALID_HANDLE_VALUE)
+    {
+        IoGovernor::Instance().SetLowPriority(ext.m_hFile);
+    }
     return ext;
 }
 
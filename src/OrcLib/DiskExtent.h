@@ -48,6 +48,7 @@ private:
 
     ULONG m_LogicalSectorSize = 0LU;
     ULONG m_PhysicalSectorSize = 0LU;
+    ULONG m_MaxTransferLength = 0LU;  // largest single read accepted by the device, 0 if unknown
     HANDLE m_hFile = INVALID_HANDLE_VALUE;
 
 public:
@@ -62,6 +63,7 @@ public:
     virtual ULONGLONG GetSeekOffset() const { return m_liCurrentPos.QuadPart - m_Start; }
     virtual ULONGLONG GetLength() const { return m_Length; }
     virtual ULONG GetLogicalSectorSize() const { return m_LogicalSectorSize; }
+    virtual ULONG GetMaxTransferLength() const { return m_MaxTransferLength; }
     virtual HANDLE GetHandle() const { return m_hFile; };
 
     virtual CDiskExtent ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags) const;
@@ -28,6 +28,7 @@
 #include "Utils/String.h"
 #include "XmlLiteExtension.h"
 #include "YaraStaticExtension.h"
+#include "YaraScanner.h"
 #include "Utils/Guard.h"
 
 using namespace std;
@@ -910,6 +911,12 @@ void CompileYaraRule(YaraStaticExtension& yara, CBinaryBuffer& buffer, const Xml
         return;
     }
 
+    if (YaraScanner::IsCompiledRules(buffer))
+    {
+        Log::Debug(L"Skip compilation of precompiled Yara rules '{}'", yaraSource.value);
+        return;
+    }
+
     YR_COMPILER* compiler = nullptr;
 
     auto ret = yara.yr_compiler_create(&compiler);
@@ -1297,6 +1304,27 @@ HRESULT EmbeddedResource::UpdateResources(const std::wstring& strPEToUpdate, con
 
                 break;
             }
+            case EmbeddedResource::EmbedSpec::EmbedType::Buffer: {
+                if (SUCCEEDED(
+                        hr = TryUpdateResource(
+                            INVALID_HANDLE_VALUE,
+                            strPEToUpdate.c_str(),
+                            EmbeddedResource::BINARY(),
+                            item.Name.c_str(),
+                            item.BinaryValue.GetData(),
+                            (DWORD)item.BinaryValue.GetCount(),
+                            kMaxAttempt)))
+                {
+                    Log::Info(L"Successfully added {} bytes as resource '{}'", item.BinaryValue.GetCount(), item.Name);
+                    resourceRegistry.MarkAsEmbedded(item.Name, L"res");
+                }
+                else
+                {
+                    return hr;
+                }
+
+                break;
+            }
             case EmbeddedResource::EmbedSpec::EmbedType::Archive: {
                 ArchiveFormat fmt = ArchiveFormat::Unknown;
 
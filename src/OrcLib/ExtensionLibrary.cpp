@@ -9,6 +9,7 @@
 
 #include "ExtensionLibrary.h"
 #include "EmbeddedResource.h"
+#include "ExtractionCache.h"
 #include "ParameterCheck.h"
 #include "Temporary.h"
 
@@ -57,6 +58,9 @@ HRESULT ExtensionLibrary::TryLoad(const std::wstring& strFileRef)
 
     if (EmbeddedResource::IsResourceBased(strFileRef))
     {
+        if (auto hr = TryLoadCached(strFileRef, strSID); hr != S_FALSE)
+            return hr;
+
         std::wstring strExtractedFile;
         if (auto hr = EmbeddedResource::ExtractToFile(
                 strFileRef,
@@ -104,6 +108,9 @@ HRESULT ExtensionLibrary::TryLoad(const std::wstring& strFileRef)
         Log::Debug(L"ExtensionLibrary: Loaded value {}={} successfully", strFileRef, strNewLibRef);
         if (EmbeddedResource::IsResourceBased(strNewLibRef))
         {
+            if (auto hr = TryLoadCached(strNewLibRef, strSID); hr != S_FALSE)
+                return hr;
+
             std::vector<std::pair<std::wstring, std::wstring>> strExtractedFiles;
 
             if (FAILED(
@@ -265,6 +272,58 @@ HRESULT Orc::ExtensionLibrary::ToDesiredName(const std::wstring& libName)
     return S_OK;
 }
 
+HRESULT Orc::ExtensionLibrary::TryLoadCached(const std::wstring& strLibRef, const std::wstring& strSID)
+{
+    WCHAR szSDDL[ORC_MAX_PATH] = {0};
+    swprintf_s(szSDDL, ORC_MAX_PATH, RESSOURCE_READ_EXECUTE_SID, strSID.c_str());
+
+    std::vector<std::pair<std::wstring, std::wstring>> files;
+    auto hr = ExtractionCache::Instance().Extract(strLibRef, m_strDesiredName.value_or(m_strKeyword), szSDDL, files);
+    if (hr == S_FALSE)
+        return S_FALSE;
+
+    if (FAILED(hr))
+    {
+        Log::Warn(
+            L"Failed to extract '{}' to the extraction cache, extracting to temp dir [{}]", strLibRef, SystemError(hr));
+        return S_FALSE;
+    }
+
+    // Cached files keep their name in archive: the desired name selects one of them
+    std::filesystem::path libFile;
+    for (const auto& [nameInArchive, extractedPath] : files)
+    {
+        if (m_strDesiredName && boost::iequals(nameInArchive, *m_strDesiredName))
+        {
+            libFile = extractedPath;
+            break;
+        }
+
+        if (!m_strDesiredName || files.size() == 1)
+            libFile = extractedPath;
+    }
+
+    if (libFile.empty())
+    {
+        Log::Error(L"Desired file name '{}' was not found in cached files of '{}'", m_strDesiredName, strLibRef);
+        return E_INVALIDARG;
+    }
+
+    // Cached files are shared with other processes
+    m_libFile = libFile;
+    m_bDeleteOnClose = false;
+
+    auto [hrLoad, hModule] = LoadThisLibrary(m_libFile);
+    if (hModule == NULL || FAILED(hrLoad))
+    {
+        Log::Debug(L"Failed to load extension lib using '{}' path [{}]", m_libFile, SystemError(hrLoad));
+        return FAILED(hrLoad) ? hrLoad : E_FAIL;
+    }
+    m_hModule = hModule;
+    Log::Debug(L"ExtensionLibrary: Loaded '{}' successfully from extraction cache", m_libFile);
+    return S_OK;
+}
+
 FARPROC Orc::ExtensionLibrary::GetEntryPoint(const CHAR* szFunctionName, bool bMandatory)
 {
     HRESULT hr = E_FAIL;
@@ -214,6 +214,9 @@ protected:
 
     HRESULT ToDesiredName(const std::wstring& libName);
 
+    // Load the library from the extraction cache, S_FALSE when the cache is not used
+    HRESULT TryLoadCached(const std::wstring& strLibRef, const std::wstring& strSID);
+
     template <class Library>
     static const std::shared_ptr<Library> GetShared(bool bMakeNew = true)
     {
@@ -226,8 +229,13 @@ protected:
             static CriticalSection g_cs;
             ScopedLock sc(g_cs);
 
-            shared = std::make_shared<Library>();
-            g_pLibrary = shared;
+            // Extensions may be loaded concurrently at startup: another thread may have made it while we waited
+            shared = g_pLibrary.lock();
+            if (shared == nullptr)
+            {
+                shared = std::make_shared<Library>();
+                g_pLibrary = shared;
+            }
         }
 
         return shared;
@@ -0,0 +1,82 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ExternalSort.h"
+
+#include "FileStream.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+using namespace Orc::Detail;
+
+HRESULT SortRun::Create()
+{
+    auto stream = std::make_shared<FileStream>();
+
+    if (auto hr = stream->CreateNew(L".run", 0L, FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        FAILED(hr))
+    {
+        Log::Error(L"Failed to create sort run file [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_stream = std::move(stream);
+    return S_OK;
+}
+
+HRESULT SortRun::Write(const void* pBuffer, size_t cbBuffer)
+{
+    ULONGLONG cbWritten = 0;
+    if (auto hr = m_stream->Write(const_cast<void*>(pBuffer), cbBuffer, &cbWritten); FAILED(hr))
+    {
+        Log::Error(L"Failed to write sort run file '{}' [{}]", m_stream->Path(), SystemError(hr));
+        return hr;
+    }
+
+    if (cbWritten != cbBuffer)
+    {
+        Log::Error(
+            L"Failed to write sort run file '{}' (written: {}, expected: {})", m_stream->Path(), cbWritten, cbBuffer);
+        return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+    }
+
+    return S_OK;
+}
+
+HRESULT SortRun::Rewind()
+{
+    return m_stream->SetFilePointer(0LL, FILE_BEGIN, nullptr);
+}
+
+HRESULT SortRun::Read(void* pBuffer, size_t cbBuffer, size_t& cbRead)
+{
+    cbRead = 0;
+
+    // Records never straddle two reads: the buffer is a whole number of records, as the file
+    ULONGLONG cbTotal = 0;
+    while (cbTotal < cbBuffer)
+    {
+        ULONGLONG cbThisRead = 0;
+        if (auto hr = m_stream->Read(static_cast<BYTE*>(pBuffer) + cbTotal, cbBuffer - cbTotal, &cbThisRead);
+            FAILED(hr))
+        {
+            Log::Error(L"Failed to read sort run file '{}' [{}]", m_stream->Path(), SystemError(hr));
+            return hr;
+        }
+
+        if (cbThisRead == 0)
+            break;
+
+        cbTotal += cbThisRead;
+    }
+
+    cbRead = static_cast<size_t>(cbTotal);
+    return S_OK;
+}
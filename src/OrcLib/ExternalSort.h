@@ -0,0 +1,213 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <type_traits>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class FileStream;
+
+namespace Detail {
+
+// Temporary file holding one sorted run, deleted when closed
+class SortRun
+{
+public:
+    HRESULT Create();
+    HRESULT Write(const void* pBuffer, size_t cbBuffer);
+    HRESULT Rewind();
+    HRESULT Read(void* pBuffer, size_t cbBuffer, size_t& cbRead);
+
+private:
+    std::shared_ptr<FileStream> m_stream;
+};
+
+}  // namespace Detail
+
+//
+// ExternalSort: stable sort of fixed size records which may not fit in memory.
+//
+// Records are appended to a buffer. When it holds half of the memory budget (stable_sort may allocate as much), it is
+// sorted and written to a temporary file as a run. Merge reads the runs back, each one through its share of the
+// budget, and hands the records over in order with a k-way merge. Records which compare equal keep the order they were
+// added in.
+//
+template <typename T, typename Less = std::less<T>>
+class ExternalSort
+{
+    static_assert(std::is_trivially_copyable_v<T>, "Records are written to the runs as they are in memory");
+
+public:
+    static constexpr size_t kMinRecords = 4096;
+
+    explicit ExternalSort(size_t cbMemoryBudget, Less less = Less())
+        : m_less(std::move(less))
+        , m_maxRecords(std::max<size_t>(cbMemoryBudget / 2 / sizeof(T), kMinRecords))
+    {
+    }
+
+    ExternalSort(const ExternalSort&) = delete;
+    ExternalSort& operator=(const ExternalSort&) = delete;
+
+    HRESULT Add(const T& record)
+    {
+        if (m_records.size() == m_maxRecords)
+        {
+            if (auto hr = Spill(); FAILED(hr))
+                return hr;
+        }
+
+        if (m_records.capacity() == 0)
+            m_records.reserve(std::min<size_t>(m_maxRecords, kMinRecords * 16));
+
+        m_records.push_back(record);
+        m_ullCount++;
+        return S_OK;
+    }
+
+    // Call 'fn' with each record added, in order. The sorter is empty afterwards
+    template <typename Fn>
+    HRESULT Merge(Fn&& fn)
+    {
+        if (m_runs.empty())
+        {
+            std::stable_sort(std::begin(m_records), std::end(m_records), m_less);
+            for (const auto& record : m_records)
+                fn(record);
+
+            Clear();
+            return S_OK;
+        }
+
+        // The records left in memory become the last run so that the whole budget goes to the read buffers
+        if (!m_records.empty())
+        {
+            if (auto hr = Spill(); FAILED(hr))
+                return hr;
+        }
+        m_records.shrink_to_fit();
+
+        const size_t cRunRecords = std::max<size_t>(2 * m_maxRecords / m_runs.size(), 1);
+        std::vector<Cursor> cursors(m_runs.size());
+        for (size_t i = 0; i < m_runs.size(); i++)
+        {
+            cursors[i].Buffer.resize(cRunRecords);
+
+            if (auto hr = m_runs[i].Rewind(); FAILED(hr))
+                return hr;
+            if (auto hr = Refill(i, cursors[i]); FAILED(hr))
+                return hr;
+        }
+
+        // Top of the heap is the smallest record, the earliest run on ties
+        auto greater = [this, &cursors](size_t left, size_t right) {
+            const auto& l = cursors[left].Current();
+            const auto& r = cursors[right].Current();
+            if (m_less(r, l))
+                return true;
+            if (m_less(l, r))
+                return false;
+            return left > right;
+        };
+
+        std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+        for (size_t i = 0; i < cursors.size(); i++)
+        {
+            if (!cursors[i].AtEnd())
+                heap.push(i);
+        }
+
+        while (!heap.empty())
+        {
+            const auto i = heap.top();
+            heap.pop();
+
+            auto& cursor = cursors[i];
+            fn(cursor.Current());
+
+            if (++cursor.Next == cursor.Count)
+            {
+                if (auto hr = Refill(i, cursor); FAILED(hr))
+                    return hr;
+            }
+
+            if (!cursor.AtEnd())
+                heap.push(i);
+        }
+
+        Clear();
+        return S_OK;
+    }
+
+    ULONGLONG Count() const { return m_ullCount; }
+    size_t Runs() const { return m_runs.size(); }
+
+private:
+    struct Cursor
+    {
+        std::vector<T> Buffer;
+        size_t Count = 0;
+        size_t Next = 0;
+
+        bool AtEnd() const { return Next == Count; }
+        const T& Current() const { return Buffer[Next]; }
+    };
+
+    HRESULT Spill()
+    {
+        std::stable_sort(std::begin(m_records), std::end(m_records), m_less);
+
+        Detail::SortRun run;
+        if (auto hr = run.Create(); FAILED(hr))
+            return hr;
+        if (auto hr = run.Write(m_records.data(), m_records.size() * sizeof(T)); FAILED(hr))
+            return hr;
+
+        m_runs.push_back(std::move(run));
+        m_records.clear();
+        return S_OK;
+    }
+
+    HRESULT Refill(size_t run, Cursor& cursor)
+    {
+        size_t cbRead = 0;
+        if (auto hr = m_runs[run].Read(cursor.Buffer.data(), cursor.Buffer.size() * sizeof(T), cbRead); FAILED(hr))
+            return hr;
+
+        cursor.Count = cbRead / sizeof(T);
+        cursor.Next = 0;
+        return S_OK;
+    }
+
+    void Clear()
+    {
+        m_records.clear();
+        m_runs.clear();
+        m_ullCount = 0;
+    }
+
+    Less m_less;
+    size_t m_maxRecords;
+    std::vector<T> m_records;
+    std::vector<Detail::SortRun> m_runs;
+    ULONGLONG m_ullCount = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,317 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ExtractionCache.h"
+
+#include "CryptoHashStream.h"
+#include "EmbeddedResource.h"
+
+#include "Log/Log.h"
+
+#include <filesystem>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcExtractionCacheEnv = L"DFIR-ORC_EXTRACTION_CACHE";
+
+}  // namespace
+
+ExtractionCache& ExtractionCache::Instance()
+{
+    static ExtractionCache instance;
+    return instance;
+}
+
+HRESULT ExtractionCache::ConfigureDirectory(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid extraction cache directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create extraction cache directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcExtractionCacheEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcExtractionCacheEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Embedded resources are extracted to cache directory '{}'", directory.wstring());
+    return S_OK;
+}
+
+std::optional<std::wstring> ExtractionCache::GetDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcExtractionCacheEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcExtractionCacheEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+HRESULT ExtractionCache::Extract(
+    const std::wstring& strResourceRef,
+    const std::wstring& strFileName,
+    LPCWSTR szSDDL,
+    std::vector<std::pair<std::wstring, std::wstring>>& outputFiles)
+{
+    const auto directory = GetDirectory();
+    if (!directory || EmbeddedResource::IsSelf(strResourceRef))
+    {
+        return S_FALSE;
+    }
+
+    HRESULT hr = E_FAIL;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    const auto strLookup = strResourceRef + L"|" + strFileName + L"|" + (szSDDL ? szSDDL : L"");
+    auto it = m_Extracted.find(strLookup);
+    if (it != std::cend(m_Extracted))
+    {
+        outputFiles.insert(std::end(outputFiles), std::cbegin(it->second), std::cend(it->second));
+        return S_OK;
+    }
+
+    std::wstring key;
+    if (FAILED(hr = GetKey(strResourceRef, strFileName, szSDDL, key)))
+    {
+        return hr;
+    }
+
+    const auto strEntry = *directory + L"\\" + key;
+
+    if (GetFileAttributes(strEntry.c_str()) == INVALID_FILE_ATTRIBUTES)
+    {
+        if (FAILED(hr = Populate(strResourceRef, strFileName, szSDDL, strEntry)))
+        {
+            return hr;
+        }
+    }
+    else
+    {
+        Log::Debug(L"Reusing extraction of '{}' from '{}'", strResourceRef, strEntry);
+    }
+
+    std::vector<std::pair<std::wstring, std::wstring>> files;
+    if (FAILED(hr = List(strEntry, files)))
+    {
+        return hr;
+    }
+
+    outputFiles.insert(std::end(outputFiles), std::cbegin(files), std::cend(files));
+    m_Extracted.emplace(strLookup, std::move(files));
+    return S_OK;
+}
+
+HRESULT ExtractionCache::ExtractToFile(
+    const std::wstring& strResourceRef,
+    const std::wstring& strFileName,
+    LPCWSTR szSDDL,
+    std::wstring& outputFile)
+{
+    std::vector<std::pair<std::wstring, std::wstring>> outputFiles;
+
+    HRESULT hr = Extract(strResourceRef, strFileName, szSDDL, outputFiles);
+    if (hr != S_OK)
+    {
+        return hr;
+    }
+
+    if (outputFiles.size() != 1)
+    {
+        Log::Error(L"Expected one file extracted from '{}' (found: {})", strResourceRef, outputFiles.size());
+        return E_INVALIDARG;
+    }
+
+    outputFile = outputFiles.front().second;
+    return S_OK;
+}
+
+HRESULT ExtractionCache::GetKey(
+    const std::wstring& strResourceRef,
+    const std::wstring& strFileName,
+    LPCWSTR szSDDL,
+    std::wstring& key)
+{
+    HRESULT hr = E_FAIL;
+
+    std::wstring MotherShip, ResName, NameInArchive, FormatName;
+    if (FAILED(
+            hr = EmbeddedResource::SplitResourceReference(
+                strResourceRef, MotherShip, ResName, NameInArchive, FormatName)))
+    {
+        Log::Debug(L"'{}' is not a supported resource reference [{}]", strResourceRef, SystemError(hr));
+        return hr;
+    }
+
+    HMODULE hModule = NULL;
+    HRSRC hRes = NULL;
+    std::wstring strBinaryPath;
+    if (FAILED(hr = EmbeddedResource::LocateResource(
+                   MotherShip, ResName, EmbeddedResource::BINARY(), hModule, hRes, strBinaryPath)))
+    {
+        Log::Debug(L"Could not locate resource '{}' [{}]", strResourceRef, SystemError(hr));
+        return hr;
+    }
+
+    // The resource is hashed in place from the mapped image, without copying it
+    HGLOBAL hGlobal = LoadResource(hModule, hRes);
+    const LPVOID pData = hGlobal ? LockResource(hGlobal) : nullptr;
+    const DWORD cbData = SizeofResource(hModule, hRes);
+    if (pData == nullptr || cbData == 0)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Debug(L"Could not load resource '{}' [{}]", strResourceRef, SystemError(hr));
+        return FAILED(hr) ? hr : E_FAIL;
+    }
+
+    const auto header = NameInArchive + L"|" + FormatName + L"|" + strFileName + L"|" + (szSDDL ? szSDDL : L"") + L"|";
+
+    auto hashstream = std::make_shared<CryptoHashStream>();
+    if (FAILED(hr = hashstream->OpenToWrite(CryptoHashStream::Algorithm::SHA256, nullptr)))
+    {
+        return hr;
+    }
+
+    ULONGLONG ullWritten = 0LL;
+    if (FAILED(hr = hashstream->Write((const PVOID)header.data(), header.size() * sizeof(WCHAR), &ullWritten)))
+    {
+        return hr;
+    }
+
+    if (FAILED(hr = hashstream->Write(pData, cbData, &ullWritten)))
+    {
+        return hr;
+    }
+
+    if (FAILED(hr = hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, key)))
+    {
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT ExtractionCache::Populate(
+    const std::wstring& strResourceRef,
+    const std::wstring& strFileName,
+    LPCWSTR szSDDL,
+    const std::wstring& strEntry)
+{
+    using namespace std::filesystem;
+
+    HRESULT hr = E_FAIL;
+
+    // Concurrent processes could populate the same entry: each one extracts in its own directory and the first rename
+    // wins
+    const auto strTemp = strEntry + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+
+    std::error_code ec;
+    remove_all(strTemp, ec);
+    create_directory(strTemp, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create extraction directory '{}' [{}]", strTemp, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::vector<std::pair<std::wstring, std::wstring>> extracted;
+    if (FAILED(hr = EmbeddedResource::ExtractToDirectory(strResourceRef, strFileName, szSDDL, strTemp, extracted)))
+    {
+        Log::Error(L"Failed to extract resource '{}' to '{}' [{}]", strResourceRef, strTemp, SystemError(hr));
+        remove_all(strTemp, ec);
+        return hr;
+    }
+
+    // Files keep their name in archive so libraries find their dependencies
+    for (const auto& [nameInArchive, extractedPath] : extracted)
+    {
+        const path extractedFile(extractedPath);
+        const auto desiredFile = extractedFile.parent_path() / path(nameInArchive).filename();
+        if (desiredFile == extractedFile)
+        {
+            continue;
+        }
+
+        rename(extractedFile, desiredFile, ec);
+        if (ec)
+        {
+            Log::Warn(L"Failed to rename extracted file '{}' to '{}' [{}]", extractedPath, desiredFile.wstring(), ec);
+        }
+    }
+
+    if (!MoveFileEx(strTemp.c_str(), strEntry.c_str(), 0L))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        remove_all(strTemp, ec);
+
+        if (GetFileAttributes(strEntry.c_str()) == INVALID_FILE_ATTRIBUTES)
+        {
+            Log::Error(L"Failed to move extraction of '{}' to '{}' [{}]", strResourceRef, strEntry, SystemError(hr));
+            return hr;
+        }
+
+        Log::Debug(L"Extraction of '{}' was completed by another process", strResourceRef);
+        return S_OK;
+    }
+
+    Log::Debug(L"Extracted '{}' to '{}'", strResourceRef, strEntry);
+    return S_OK;
+}
+
+HRESULT ExtractionCache::List(
+    const std::wstring& strEntry,
+    std::vector<std::pair<std::wstring, std::wstring>>& outputFiles)
+{
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(strEntry, ec))
+    {
+        if (entry.is_regular_file(ec))
+        {
+            outputFiles.emplace_back(entry.path().filename().wstring(), entry.path().wstring());
+        }
+    }
+
+    if (ec)
+    {
+        Log::Error(L"Failed to list extracted files in '{}' [{}]", strEntry, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (outputFiles.empty())
+    {
+        Log::Error(L"No extracted file in '{}'", strEntry);
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    return S_OK;
+}
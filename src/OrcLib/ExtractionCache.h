@@ -0,0 +1,79 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Extract embedded resources once into a directory shared by this process and its child processes.
+//
+// An extraction is stored in '<directory>\<hash>' where the hash covers the resource content, the name in archive, the
+// file name and the security descriptor: the same tool or library embedded in several binaries, or extracted by several
+// commands, is written once. Entries are populated in a temporary directory renamed on completion so concurrent
+// processes never use a partial extraction. Extracted files are shared: callers must not delete nor rename them.
+//
+// The cache is disabled unless a directory is configured.
+class ExtractionCache
+{
+public:
+    static ExtractionCache& Instance();
+
+    // Use 'strDirectory' for this process and the processes it creates (inherited %DFIR-ORC_EXTRACTION_CACHE%)
+    static HRESULT ConfigureDirectory(const std::wstring& strDirectory);
+
+    // Directory configured by this process or by a parent process
+    static std::optional<std::wstring> GetDirectory();
+
+    // Get (name in archive, extracted path) of the files of 'strResourceRef', a resource directly embedded is extracted
+    // as 'strFileName'. Returns S_FALSE if the cache is disabled or does not apply to the reference.
+    HRESULT Extract(
+        const std::wstring& strResourceRef,
+        const std::wstring& strFileName,
+        LPCWSTR szSDDL,
+        std::vector<std::pair<std::wstring, std::wstring>>& outputFiles);
+
+    // Same as above for a reference to a single file
+    HRESULT ExtractToFile(
+        const std::wstring& strResourceRef,
+        const std::wstring& strFileName,
+        LPCWSTR szSDDL,
+        std::wstring& outputFile);
+
+private:
+    ExtractionCache() = default;
+
+    static HRESULT
+    GetKey(const std::wstring& strResourceRef, const std::wstring& strFileName, LPCWSTR szSDDL, std::wstring& key);
+
+    static HRESULT Populate(
+        const std::wstring& strResourceRef,
+        const std::wstring& strFileName,
+        LPCWSTR szSDDL,
+        const std::wstring& strEntry);
+
+    static HRESULT List(const std::wstring& strEntry, std::vector<std::pair<std::wstring, std::wstring>>& outputFiles);
+
+    std::mutex m_mutex;
+
+    // Files of the references already resolved by this process, by reference, file name and security descriptor
+    std::map<std::wstring, std::vector<std::pair<std::wstring, std::wstring>>> m_Extracted;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -117,6 +117,10 @@ enum class Intentions : DWORDLONG
     FILEINFO_SECURITY_DIRECTORY_SIZE = (One << 59),
     FILEINFO_SECURITY_DIRECTORY_SIGNATURE_SIZE = (One << 60),
 
+    FILEINFO_BLAKE3 = (One << 61),
+
+    FILEINFO_KNOWNGOOD = (One << 62),
+
     FILEINFO_ALL = (unsigned long long)-1
 };
 
@@ -89,6 +89,13 @@ const ColumnNameDef FatFileInfo::g_FatColumnNames[] = {
 
     {Intentions::FILEINFO_PE_MD5, L"PeMD5", L"MD5 of PE file", 0L},
 
+    {Intentions::FILEINFO_BLAKE3, L"BLAKE3", L"BLAKE3 ", 0L},
+
+    {Intentions::FILEINFO_KNOWNGOOD,
+     L"KnownGood",
+     L"The file is in the known good list: its content was neither hashed nor verified",
+     0L},
+
     {Intentions::FILEINFO_NONE, NULL, NULL, 0L}};
 
 const ColumnNameDef FatFileInfo::g_FatAliasNames[] = {
@@ -30,6 +30,7 @@ public:
 
     using ClusterChain = std::vector<FatTableEntry>;
     using FatTableChunks = std::vector<std::shared_ptr<CBinaryBuffer>>;
+    using ChainCache = std::vector<ULONG>;
 
     FatTable(FatTableType type)
         : m_FatTableType(type)
@@ -56,13 +57,62 @@ public:
 
     const FatTableChunks& GetFatTableChunks() { return mFatTableChunks; }
 
+    ULONGLONG GetEntryCount() const
+    {
+        if (!mChainCache.empty())
+            return mChainCache.size();
+
+        ULONGLONG ullTableSize = 0;
+        for (const auto& chunk : mFatTableChunks)
+            ullTableSize += chunk->GetCount();
+
+        return (ullTableSize * 8) / GetEntrySizeInBits();
+    }
+
+    // Decode the whole table once into an array of next cluster numbers: chains are then followed without looking up
+    // the chunks again. Chunks are released once the cache is built.
+    HRESULT LoadChainCache()
+    {
+        if (!mChainCache.empty())
+            return S_OK;
+
+        const auto ullEntryCount = GetEntryCount();
+        if (ullEntryCount > MAXDWORD)
+            return HRESULT_FROM_WIN32(ERROR_ARITHMETIC_OVERFLOW);
+
+        ChainCache cache;
+        cache.resize(static_cast<size_t>(ullEntryCount));
+
+        for (ULONG i = 0; i < cache.size(); i++)
+        {
+            FatTableEntry entry;
+            if (FAILED(GetEntry(i, entry)))
+            {
+                cache.resize(i);
+                break;
+            }
+
+            cache[i] = entry.GetValue();
+        }
+
+        mChainCache = std::move(cache);
+        mFatTableChunks.clear();
+        return S_OK;
+    }
+
     HRESULT FillClusterChain(ULONG firstClusterNumber, ClusterChain& clusterChain) const
     {
         clusterChain.clear();
         FatTableEntry entry(firstClusterNumber, GetEntrySizeInBits());
 
+        // A chain cannot be longer than the table: a longer one loops on itself
+        const auto ullEntryCount = GetEntryCount();
+
         do
         {
+            if (clusterChain.size() > ullEntryCount)
+                return E_FAIL;
+
             clusterChain.push_back(entry);
 
             if (FAILED(GetEntry(entry.GetValue(), entry)))
@@ -75,6 +125,15 @@ public:
 
     HRESULT GetEntry(ULONG entryNumber, FatTableEntry& entry) const
     {
+        if (!mChainCache.empty())
+        {
+            if (entryNumber >= mChainCache.size())
+                return E_FAIL;
+
+            entry = FatTableEntry(mChainCache[entryNumber], GetEntrySizeInBits());
+            return S_OK;
+        }
+
         ULONGLONG ulCurrentOffset = 0;
         ULONGLONG ulTargetOffset = (static_cast<ULONGLONG>(entryNumber) * GetEntrySizeInBits()) / 8;
 
@@ -130,6 +189,7 @@ public:
 
 private:
     FatTableChunks mFatTableChunks;
+    ChainCache mChainCache;
     FatTableType m_FatTableType;
 };
 
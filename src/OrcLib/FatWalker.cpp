@@ -10,10 +10,12 @@
 #include "FatWalker.h"
 #include "VolumeReader.h"
 #include "Location.h"
+#include "TaskPool.h"
 
 #include <boost/algorithm/string.hpp>
 #include <sstream>
 #include <algorithm>
+#include <functional>
 
 using namespace Orc;
 
@@ -25,7 +27,7 @@ FatWalker::FatWalker()
 
 FatWalker::~FatWalker() {}
 
-HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRecords)
+HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRecords, bool bParallelTraversal)
 {
     HRESULT hr = E_FAIL;
 
@@ -127,6 +129,14 @@ HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRec
         fatTable.AddChunk(bufferPtr);
     }
 
+    if (FAILED(hr = fatTable.LoadChainCache()))
+    {
+        Log::Debug(
+            L"Failed to cache the Fat table from location {}, chains are read from the table [{}]",
+            m_Location->GetLocation(),
+            SystemError(hr));
+    }
+
     m_ullRootDirectoryOffset =
         ullFirstFatTableOffset + ((ULONGLONG)nbFatTables * (ULONGLONG)nbSectorPerFatTable * (ULONGLONG)ulSectorSize);
 
@@ -149,7 +159,7 @@ HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRec
         fatTable.FillClusterChain(rootDirectoryCluster, clusterChain);
 
         // read root directory - it starts at cluster 2. there is actually no cluster 0 and no cluster 1
-        if (S_OK != (hr = ReadClusterChain(clusterChain, m_RootDirectoryBuffer)))
+        if (S_OK != (hr = ReadClusterChain(reader, clusterChain, m_RootDirectoryBuffer)))
         {
             Log::Error(
                 L"Failed to read root directory from location {} [{}]", m_Location->GetLocation(), SystemError(hr));
@@ -165,6 +175,40 @@ HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRec
     FatFileEntryList subFolders;
     ParseFolder(fatTable, m_RootDirectoryBuffer, m_RootFolder, subFolders);
 
+    if (bParallelTraversal)
+        return ParseSubFoldersInParallel(fatTable, subFolders, parsedClusterSet);
+
+    return ParseSubFolders(fatTable, subFolders, parsedClusterSet);
+}
+
+bool FatWalker::ClaimClusters(const FatTable::ClusterChain& clusterChain, ParsedClusterSet& parsedClusterSet)
+{
+    // check if we have already parsed at least one of the clusters
+    const bool alreadyParsed =
+        std::any_of(std::begin(clusterChain), std::end(clusterChain), [&parsedClusterSet](const FatTableEntry& entry) {
+            return entry.IsUsed() && parsedClusterSet.find(entry.GetValue()) != parsedClusterSet.end();
+        });
+
+    if (alreadyParsed)
+        return false;
+
+    for (const auto& entry : clusterChain)
+    {
+        if (entry.IsUsed())
+            parsedClusterSet.insert(entry.GetValue());
+    }
+
+    return true;
+}
+
+HRESULT FatWalker::ParseSubFolders(
+    const FatTable& fatTable,
+    FatFileEntryList& subFolders,
+    ParsedClusterSet& parsedClusterSet)
+{
+    HRESULT hr = E_FAIL;
+    std::shared_ptr<VolumeReader> reader(m_Location->GetReader());
+
     while (!subFolders.empty())
     {
         // we put the deleted folder entries at the end of the structure
@@ -180,40 +224,18 @@ HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRec
         if (nullptr == subfolder || !subfolder->IsFolder())
             continue;
 
-        // get the subfolder cluster chain and check if we have already parsed at least one its clusters
-        bool alreadyParsed = false;
         const FatTable::ClusterChain& clusterChain(subfolder->GetClusterChain());
-        std::for_each(
-            std::begin(clusterChain),
-            std::end(clusterChain),
-            [&parsedClusterSet, &alreadyParsed](const FatTableEntry& entry) {
-                if (entry.IsUsed())
-                {
-                    if (parsedClusterSet.find(entry.GetValue()) != parsedClusterSet.end())
-                        alreadyParsed = true;
-                }
-            });
-
-        if (alreadyParsed)
+        if (!ClaimClusters(clusterChain, parsedClusterSet))
             continue;
 
         // read subfolder entries
         CBinaryBuffer buffer;
-        if (S_OK != (hr = ReadClusterChain(clusterChain, buffer)))
+        if (S_OK != (hr = ReadClusterChain(reader, clusterChain, buffer)))
         {
             Log::Error(L"Failed to read subfolder {} [{}]", subfolder->m_Name, SystemError(hr));
             continue;
         }
 
-        // update parsed cluster set
-        std::for_each(
-            std::begin(clusterChain), std::end(clusterChain), [&parsedClusterSet](const FatTableEntry& entry) {
-                if (entry.IsUsed())
-                {
-                    parsedClusterSet.insert(entry.GetValue());
-                }
-            });
-
         // parse subfolder
         ParseFolder(fatTable, buffer, subfolder, subFolders);
     }
@@ -221,6 +243,92 @@ HRESULT FatWalker::Init(const std::shared_ptr<Location>& loc, bool bResurrectRec
     return S_OK;
 }
 
+HRESULT FatWalker::ParseSubFoldersInParallel(
+    const FatTable& fatTable,
+    const FatFileEntryList& subFolders,
+    ParsedClusterSet& parsedClusterSet)
+{
+    std::mutex parsedClustersLock;
+    std::mutex deletedFoldersLock;
+    FatFileEntryList deletedFolders;
+    bool bDeletedPass = false;
+
+    // Each worker reads with its own reader, the original one is kept as a fallback
+    std::shared_ptr<VolumeReader> reader(m_Location->GetReader());
+    concurrency::combinable<std::shared_ptr<VolumeReader>> readers([&reader]() -> std::shared_ptr<VolumeReader> {
+        auto workerReader = reader->ReOpen(
+            FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_RANDOM_ACCESS);
+        if (workerReader == reader)
+            return nullptr;
+        return workerReader;
+    });
+    std::mutex sharedReaderLock;
+
+    // Subfolders are scheduled as tasks on the walk scheduler, idle workers steal them from busy ones
+    TaskPool::Scope scope(TaskPool::Subsystem::Walk);
+    concurrency::task_group tasks;
+    std::function<void(const FatFileEntry*)> parseSubFolder = [&](const FatFileEntry* subfolder) {
+        if (nullptr == subfolder || !subfolder->IsFolder())
+            return;
+
+        // active folders are parsed first, deleted ones wait for the second pass
+        if (!bDeletedPass && subfolder->IsDeleted())
+        {
+            std::lock_guard<std::mutex> lock(deletedFoldersLock);
+            deletedFolders.push_back(subfolder);
+            return;
+        }
+
+        const FatTable::ClusterChain& clusterChain(subfolder->GetClusterChain());
+        {
+            std::lock_guard<std::mutex> lock(parsedClustersLock);
+            if (!ClaimClusters(clusterChain, parsedClusterSet))
+                return;
+        }
+
+        HRESULT hr = E_FAIL;
+        CBinaryBuffer buffer;
+        if (auto& workerReader = readers.local(); workerReader != nullptr)
+        {
+            hr = ReadClusterChain(workerReader, clusterChain, buffer);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(sharedReaderLock);
+            hr = ReadClusterChain(reader, clusterChain, buffer);
+        }
+
+        if (S_OK != hr)
+        {
+            Log::Error(L"Failed to read subfolder {} [{}]", subfolder->m_Name, SystemError(hr));
+            return;
+        }
+
+        FatFileEntryList children;
+        ParseFolder(fatTable, buffer, subfolder, children);
+
+        for (const auto child : children)
+        {
+            tasks.run([&parseSubFolder, child]() { parseSubFolder(child); });
+        }
+    };
+
+    for (const auto subfolder : subFolders)
+    {
+        tasks.run([&parseSubFolder, subfolder]() { parseSubFolder(subfolder); });
+    }
+    tasks.wait();
+
+    bDeletedPass = true;
+    for (const auto subfolder : deletedFolders)
+    {
+        tasks.run([&parseSubFolder, subfolder]() { parseSubFolder(subfolder); });
+    }
+    tasks.wait();
+
+    return S_OK;
+}
+
 HRESULT FatWalker::Process(const Callbacks& callbacks)
 {
     std::shared_ptr<VolumeReader> reader(m_Location->GetReader());
@@ -298,10 +406,12 @@ HRESULT FatWalker::ReadRootDirectory(CBinaryBuffer& buffer, DWORD size)
     return S_OK;
 }
 
-HRESULT FatWalker::ReadClusterChain(const FatTable::ClusterChain& clusterChain, CBinaryBuffer& buffer)
+HRESULT FatWalker::ReadClusterChain(
+    const std::shared_ptr<VolumeReader>& reader,
+    const FatTable::ClusterChain& clusterChain,
+    CBinaryBuffer& buffer)
 {
     HRESULT hr = E_FAIL;
-    std::shared_ptr<VolumeReader> reader(m_Location->GetReader());
 
     if (nullptr == reader)
     {
@@ -321,36 +431,46 @@ HRESULT FatWalker::ReadClusterChain(const FatTable::ClusterChain& clusterChain,
 
     hr = S_OK;
 
-    std::for_each(
-        std::begin(clusterChain),
-        std::end(clusterChain),
-        [this, &hr, ulClusterSize, &offset, &reader, &buffer](const FatTableEntry& entry) {
-            ULONG clusterNumber = 0;
+    // contiguous clusters are read at once
+    CBinaryBuffer localBuffer;
+    auto it = std::begin(clusterChain);
 
-            if (entry.IsUsed() && (clusterNumber = entry.GetValue()) >= 2)
-            {
-                CBinaryBuffer localBuffer;
-                localBuffer.SetCount(ulClusterSize);
-                ULONGLONG ullBytesRead;
-                ULONGLONG seekOffset =
-                    m_ullRootDirectoryOffset + ((ULONGLONG)(clusterNumber - 2) * (ULONGLONG)ulClusterSize);
-
-                hr = reader->Read(seekOffset, localBuffer, ulClusterSize, ullBytesRead);
-                if (S_OK == hr && ulClusterSize == ullBytesRead)
-                {
-                    memcpy(buffer.GetData() + offset, localBuffer.GetData(), ulClusterSize);
-                    offset += ulClusterSize;
-                }
-                else
-                {
-                    Log::Error(
-                        L"Failed to read cluster number {} from location {} [{}]",
-                        clusterNumber,
-                        m_Location->GetLocation(),
-                        SystemError(hr));
-                }
-            }
-        });
+    while (it != std::end(clusterChain))
+    {
+        ULONG clusterNumber = 0;
+
+        if (!it->IsUsed() || (clusterNumber = it->GetValue()) < 2)
+        {
+            ++it;
+            continue;
+        }
+
+        ULONG clusterCount = 1;
+        for (++it; it != std::end(clusterChain) && it->IsUsed() && it->GetValue() == clusterNumber + clusterCount; ++it)
+            clusterCount++;
+
+        ULONGLONG ullBytesToRead = (ULONGLONG)clusterCount * (ULONGLONG)ulClusterSize;
+        ULONGLONG ullBytesRead;
+        ULONGLONG seekOffset = m_ullRootDirectoryOffset + ((ULONGLONG)(clusterNumber - 2) * (ULONGLONG)ulClusterSize);
+
+        localBuffer.SetCount(static_cast<size_t>(ullBytesToRead));
+
+        hr = reader->Read(seekOffset, localBuffer, ullBytesToRead, ullBytesRead);
+        if (S_OK == hr && ullBytesToRead == ullBytesRead)
+        {
+            memcpy(buffer.GetData() + offset, localBuffer.GetData(), static_cast<size_t>(ullBytesToRead));
+            offset += ullBytesToRead;
+        }
+        else
+        {
+            Log::Error(
+                L"Failed to read {} clusters from cluster number {} from location {} [{}]",
+                clusterCount,
+                clusterNumber,
+                m_Location->GetLocation(),
+                SystemError(hr));
+        }
+    }
 
     return hr;
 }
@@ -450,6 +570,8 @@ HRESULT FatWalker::ParseFolder(
             fileEntry.m_ParentFolder = parentFolder;
 
             PrintFileEntry(fileEntry);
+
+            std::lock_guard<std::mutex> lock(m_FatFSLock);
             FatFileSystem::iterator it = m_FatFS.insert(std::make_shared<FatFileEntry>(fileEntry)).first;
 
             if (fileEntry.IsFolder())
@@ -18,6 +18,7 @@
 #include <set>
 #include <map>
 #include <memory>
+#include <mutex>
 
 #pragma managed(push, off)
 
@@ -44,7 +45,8 @@ public:
         FatFileEntryCall m_FileEntryCall;
     };
 
-    HRESULT Init(const std::shared_ptr<Location>& loc, bool bResurrectRecords);
+    // With bParallelTraversal, subfolders are read and parsed by the concurrency runtime's workers
+    HRESULT Init(const std::shared_ptr<Location>& loc, bool bResurrectRecords, bool bParallelTraversal = false);
     HRESULT Process(const Callbacks& Callbacks);
 
     static UCHAR ComputeDosNameChecksum(const FatFile83& fatFile83);
@@ -65,7 +67,18 @@ public:
 
 private:
     HRESULT ReadRootDirectory(CBinaryBuffer& buffer, DWORD size);
-    HRESULT ReadClusterChain(const FatTable::ClusterChain& clusterChain, CBinaryBuffer& buffer);
+    HRESULT ReadClusterChain(
+        const std::shared_ptr<VolumeReader>& reader,
+        const FatTable::ClusterChain& clusterChain,
+        CBinaryBuffer& buffer);
+
+    static bool ClaimClusters(const FatTable::ClusterChain& clusterChain, ParsedClusterSet& parsedClusterSet);
+
+    HRESULT ParseSubFolders(const FatTable& fatTable, FatFileEntryList& subFolders, ParsedClusterSet& parsedClusterSet);
+    HRESULT ParseSubFoldersInParallel(
+        const FatTable& fatTable,
+        const FatFileEntryList& subFolders,
+        ParsedClusterSet& parsedClusterSet);
 
     HRESULT ParseFolder(
         const FatTable& fatTable,
@@ -94,6 +107,8 @@ private:
     ULONGLONG m_ullRootDirectoryOffset;
     bool m_bResurrectRecords;
 
+    // ParseFolder inserts into m_FatFS from the workers of the parallel traversal
+    std::mutex m_FatFSLock;
     FatFileSystem m_FatFS;
     const FatFileEntry* m_RootFolder = nullptr;
 
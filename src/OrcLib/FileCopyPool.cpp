@@ -0,0 +1,298 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileCopyPool.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+FileCopyPool::FileCopyPool(DWORD dwWorkers, DWORD dwBufferSize, DWORD dwBuffers)
+    : m_dwBufferSize(dwBufferSize)
+{
+    // VirtualAlloc'ed buffers are page aligned, which is what the storage stack prefers for large transfers
+    for (DWORD i = 0; i < dwBuffers; i++)
+    {
+        const auto pBuffer =
+            static_cast<LPBYTE>(VirtualAlloc(NULL, m_dwBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+        if (pBuffer == nullptr)
+        {
+            Log::Error("Failed to allocate copy buffer #{} ({} bytes) [{}]", i, m_dwBufferSize, LastWin32Error());
+            break;
+        }
+
+        m_Buffers.push_back(pBuffer);
+    }
+
+    m_FreeBuffers = m_Buffers;
+
+    // Each worker waits for its own writes: completion events cannot be shared by concurrent writes to the same file
+    for (DWORD i = 0; i < dwWorkers && !m_Buffers.empty(); i++)
+    {
+        Guard::Handle hEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+        if (!hEvent.IsValid())
+        {
+            Log::Error("Failed to create event for copy worker #{} [{}]", i, LastWin32Error());
+            break;
+        }
+
+        m_Events.push_back(std::move(hEvent));
+    }
+
+    for (const auto& hEvent : m_Events)
+    {
+        m_Workers.emplace_back([this, hEvent = *hEvent]() { Work(hEvent); });
+    }
+
+    Log::Debug(
+        "File copy pool started (workers: {}, buffers: {} of {} bytes)",
+        m_Workers.size(),
+        m_Buffers.size(),
+        m_dwBufferSize);
+}
+
+FileCopyPool::~FileCopyPool()
+{
+    {
+        // Submitted copies are always completed, a dropped write would leave a truncated file behind
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_WriteDone.wait(lock, [this]() { return m_Writes.empty() && m_ullRunningCopies == 0; });
+        m_bStop = true;
+    }
+
+    m_WriteReady.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+
+    for (const auto pBuffer : m_Buffers)
+    {
+        VirtualFree(pBuffer, 0L, MEM_RELEASE);
+    }
+
+    Log::Debug("File copy pool stopped (copies: {}, throttled reads: {})", m_ullSubmittedCopies, m_ullThrottled);
+}
+
+FileCopyPool::JobId FileCopyPool::Submit(ByteStream& input, const std::filesystem::path& outPath)
+{
+    auto file = std::make_shared<File>();
+    file->Path = outPath.wstring();
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        file->Id = m_NextId++;
+        m_ullSubmittedCopies++;
+        m_ullRunningCopies++;
+    }
+
+    if (m_Workers.empty())
+    {
+        file->hr = HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+        Log::Error(L"Failed to copy '{}': no copy worker is running", file->Path);
+    }
+    else
+    {
+        file->Handle = CreateFileW(
+            outPath.c_str(),
+            GENERIC_WRITE,
+            0L,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,
+            NULL);
+        if (!file->Handle.IsValid())
+        {
+            file->hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to create '{}' [{}]", file->Path, SystemError(file->hr));
+        }
+    }
+
+    // Workers only update 'file' once its first write is queued
+    HRESULT hr = file->hr;
+    ULONGLONG ullOffset = 0LL;
+
+    while (SUCCEEDED(hr))
+    {
+        const auto pBuffer = GetFreeBuffer();
+
+        ULONGLONG cbRead = 0LL;
+        while (cbRead < m_dwBufferSize)
+        {
+            ULONGLONG cbChunk = 0LL;
+            hr = input.Read(pBuffer + cbRead, m_dwBufferSize - cbRead, &cbChunk);
+            if (FAILED(hr) || cbChunk == 0)
+            {
+                break;
+            }
+
+            cbRead += cbChunk;
+        }
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+
+        if (FAILED(hr))
+        {
+            Log::Error(L"Failed while reading input of '{}' [{}]", file->Path, SystemError(hr));
+            file->hr = hr;
+        }
+
+        // A failed write stops the copy as well
+        if (FAILED(file->hr) || cbRead == 0)
+        {
+            m_FreeBuffers.push_back(pBuffer);
+            break;
+        }
+
+        m_Writes.push_back({file, ullOffset, pBuffer, static_cast<DWORD>(cbRead)});
+        file->ullPendingWrites++;
+
+        lock.unlock();
+        m_WriteReady.notify_one();
+
+        // Short read: end of the input
+        if (cbRead < m_dwBufferSize)
+        {
+            break;
+        }
+
+        ullOffset += cbRead;
+    }
+
+    const auto id = file->Id;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        file->bRead = true;
+        CompleteIfDone(*file);
+    }
+
+    m_WriteDone.notify_all();
+    return id;
+}
+
+std::vector<FileCopyPool::Result> FileCopyPool::Collect(bool bWait)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    if (bWait)
+    {
+        m_WriteDone.wait(lock, [this]() { return m_ullRunningCopies == 0; });
+    }
+
+    std::vector<Result> results;
+    std::swap(results, m_Results);
+    return results;
+}
+
+LPBYTE FileCopyPool::GetFreeBuffer()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    if (m_FreeBuffers.empty())
+    {
+        m_ullThrottled++;
+        m_WriteDone.wait(lock, [this]() { return !m_FreeBuffers.empty(); });
+    }
+
+    const auto pBuffer = m_FreeBuffers.back();
+    m_FreeBuffers.pop_back();
+    return pBuffer;
+}
+
+void FileCopyPool::CompleteIfDone(File& file)
+{
+    if (!file.bRead || file.ullPendingWrites != 0)
+    {
+        return;
+    }
+
+    if (file.Handle.IsValid() && !CloseHandle(file.Handle.release()) && SUCCEEDED(file.hr))
+    {
+        file.hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to close '{}' [{}]", file.Path, SystemError(file.hr));
+    }
+
+    m_Results.push_back({file.Id, file.hr, file.ullBytesWritten});
+    m_ullRunningCopies--;
+}
+
+void FileCopyPool::Work(HANDLE hEvent)
+{
+    for (;;)
+    {
+        Write write;
+        bool bSkip = false;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WriteReady.wait(lock, [this]() { return m_bStop || !m_Writes.empty(); });
+
+            if (m_bStop)
+            {
+                return;
+            }
+
+            write = std::move(m_Writes.front());
+            m_Writes.pop_front();
+
+            // Another write to this file failed, its remaining buffers are dropped
+            bSkip = FAILED(write.Target->hr);
+        }
+
+        HRESULT hr = S_OK;
+        DWORD cbWritten = 0L;
+
+        if (!bSkip)
+        {
+            OVERLAPPED overlapped = {0};
+            overlapped.Offset = static_cast<DWORD>(write.ullOffset);
+            overlapped.OffsetHigh = static_cast<DWORD>(write.ullOffset >> 32);
+            overlapped.hEvent = hEvent;
+
+            const HANDLE hFile = *write.Target->Handle;
+            if (!WriteFile(hFile, write.pBuffer, write.cbBytes, NULL, &overlapped))
+            {
+                const auto dwError = GetLastError();
+                if (dwError != ERROR_IO_PENDING)
+                {
+                    hr = HRESULT_FROM_WIN32(dwError);
+                }
+            }
+
+            if (SUCCEEDED(hr) && !GetOverlappedResult(hFile, &overlapped, &cbWritten, TRUE))
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+            }
+            else if (SUCCEEDED(hr) && cbWritten != write.cbBytes)
+            {
+                hr = HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+
+            auto& file = *write.Target;
+            if (FAILED(hr) && SUCCEEDED(file.hr))
+            {
+                Log::Error(L"Failed while writing '{}' (offset: {}) [{}]", file.Path, write.ullOffset, SystemError(hr));
+                file.hr = hr;
+            }
+
+            file.ullBytesWritten += cbWritten;
+            file.ullPendingWrites--;
+            m_FreeBuffers.push_back(write.pBuffer);
+            CompleteIfDone(file);
+        }
+
+        m_WriteDone.notify_all();
+    }
+}
@@ -0,0 +1,106 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "ByteStream.h"
+#include "Utils/Guard.h"
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Copy streams to files: the input is read on the submitting thread, in submission order, into large page aligned
+// buffers which worker threads write to the output files with overlapped writes at their offset.
+//
+// Copies are submitted by a single thread which collects the results later on, in any order. Submitting blocks while
+// all the buffers are queued or being written: the submitting thread is throttled to the writing pace.
+class FileCopyPool
+{
+public:
+    using JobId = ULONGLONG;
+
+    struct Result
+    {
+        JobId Id = 0LL;
+        HRESULT hr = E_FAIL;
+        ULONGLONG ullBytesWritten = 0LL;
+    };
+
+    FileCopyPool(DWORD dwWorkers, DWORD dwBufferSize, DWORD dwBuffers);
+    ~FileCopyPool();
+
+    FileCopyPool(const FileCopyPool&) = delete;
+    FileCopyPool& operator=(const FileCopyPool&) = delete;
+
+    // Number of workers which could be started, copies submitted to a pool without workers fail
+    DWORD Workers() const { return static_cast<DWORD>(m_Workers.size()); }
+
+    // Read 'input' until its end and create 'outPath' with its content, 'input' is not used once this returns
+    JobId Submit(ByteStream& input, const std::filesystem::path& outPath);
+
+    // Results of the copies completed since last call, 'bWait' waits for all the submitted copies
+    std::vector<Result> Collect(bool bWait = false);
+
+private:
+    struct File
+    {
+        JobId Id;
+        std::wstring Path;
+        Guard::FileHandle Handle;
+        HRESULT hr = S_OK;
+        ULONGLONG ullBytesWritten = 0LL;
+        ULONGLONG ullPendingWrites = 0LL;
+        bool bRead = false;
+    };
+
+    struct Write
+    {
+        std::shared_ptr<File> Target;
+        ULONGLONG ullOffset;
+        LPBYTE pBuffer;
+        DWORD cbBytes;
+    };
+
+    LPBYTE GetFreeBuffer();
+    void CompleteIfDone(File& file);
+    void Work(HANDLE hEvent);
+
+    const DWORD m_dwBufferSize;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WriteReady;
+    std::condition_variable m_WriteDone;
+
+    std::deque<Write> m_Writes;
+    std::vector<LPBYTE> m_Buffers;
+    std::vector<LPBYTE> m_FreeBuffers;
+    std::vector<Result> m_Results;
+    ULONGLONG m_ullRunningCopies = 0LL;
+    bool m_bStop = false;
+
+    JobId m_NextId = 1LL;
+    ULONGLONG m_ullSubmittedCopies = 0LL;
+    ULONGLONG m_ullThrottled = 0LL;
+
+    std::vector<Guard::Handle> m_Events;
+    std::vector<std::thread> m_Workers;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
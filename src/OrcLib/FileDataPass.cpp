@@ -0,0 +1,237 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileDataPass.h"
+
+#include "BufferPool.h"
+#include "ByteStream.h"
+#include "CryptoHashStream.h"
+#include "FuzzyHashStream.h"
+#include "TaskPool.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kReadBlockSize = 1024 * 1024;
+
+// Authenticode hashes are padded with zeroes to a multiple of 8 bytes
+constexpr size_t kPeHashAlignment = 8;
+
+// Smaller blocks are not worth scheduling the fuzzy hash next to the other hashes
+constexpr size_t kMinOverlappedBlockSize = 64 * 1024;
+
+}  // namespace
+
+FileDataPass::FileDataPass() = default;
+
+FileDataPass::~FileDataPass() = default;
+
+void FileDataPass::AddFirstBytes(size_t cbFirstBytes)
+{
+    m_cbFirstBytes = cbFirstBytes;
+}
+
+HRESULT FileDataPass::AddCryptoHash(CryptoHashStreamAlgorithm algs)
+{
+    if (algs == CryptoHashStreamAlgorithm::Undefined)
+        return S_OK;
+
+    auto hashstream = std::make_shared<CryptoHashStream>();
+    if (auto hr = hashstream->OpenToWrite(algs, nullptr); FAILED(hr))
+        return hr;
+
+    m_CryptoHash = std::move(hashstream);
+    return S_OK;
+}
+
+HRESULT FileDataPass::AddFuzzyHash(FuzzyHashStreamAlgorithm algs)
+{
+    if (algs == FuzzyHashStreamAlgorithm::Undefined)
+        return S_OK;
+
+    auto hashstream = std::make_shared<FuzzyHashStream>();
+    if (auto hr = hashstream->OpenToWrite(algs, nullptr); FAILED(hr))
+        return hr;
+
+    m_FuzzyHash = std::move(hashstream);
+    return S_OK;
+}
+
+HRESULT FileDataPass::AddPeHash(CryptoHashStreamAlgorithm algs, const PeParser::PeChunks& chunks)
+{
+    if (algs == CryptoHashStreamAlgorithm::Undefined)
+        return S_OK;
+
+    for (size_t i = 1; i < chunks.size(); i++)
+    {
+        if (chunks[i].offset < chunks[i - 1].offset + chunks[i - 1].length)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    auto hashstream = std::make_shared<CryptoHashStream>();
+    if (auto hr = hashstream->OpenToWrite(algs, nullptr); FAILED(hr))
+        return hr;
+
+    m_PeHash = std::move(hashstream);
+    m_PeChunks = chunks;
+    return S_OK;
+}
+
+bool FileDataPass::IsEmpty() const
+{
+    return m_cbFirstBytes == 0 && !m_CryptoHash && !m_FuzzyHash && !m_PeHash;
+}
+
+HRESULT FileDataPass::Run(ByteStream& stream)
+{
+    HRESULT hr = E_FAIL;
+
+    if (IsEmpty())
+        return S_OK;
+
+    const auto ullSize = stream.GetSize();
+
+    if (m_PeHash)
+    {
+        const auto& last = m_PeChunks.back();
+        if (last.offset > ullSize || last.length > ullSize - last.offset)
+        {
+            Log::Debug("Authenticode chunks exceed the stream size ({}), pe hash is dropped", ullSize);
+            m_PeHash.reset();
+        }
+    }
+
+    m_FirstBytes.RemoveAll();
+    m_ullBytesRead = 0LL;
+
+    if (FAILED(hr = stream.SetFilePointer(0LL, FILE_BEGIN, NULL)))
+        return hr;
+
+    size_t cbBlock = kReadBlockSize;
+    auto pBlock = BufferPool::Instance().Allocate(cbBlock);
+    if (pBlock == nullptr)
+    {
+        cbBlock = BufferPool::kMinBlockSize;
+        pBlock = BufferPool::Instance().Allocate(cbBlock);
+        if (pBlock == nullptr)
+            return E_OUTOFMEMORY;
+    }
+
+    const auto cbBuffer = BufferPool::BlockSize(cbBlock);
+
+    for (;;)
+    {
+        ULONGLONG ullRead = 0LL;
+        if (FAILED(hr = stream.Read(pBlock, cbBuffer, &ullRead)))
+            break;
+
+        if (ullRead == 0)
+            break;
+
+        if (FAILED(hr = Consume(pBlock, static_cast<size_t>(ullRead))))
+            break;
+    }
+
+    BufferPool::Instance().Free(pBlock, cbBlock);
+
+    if (FAILED(hr))
+        return hr;
+
+    if (m_PeHash)
+    {
+        const BYTE padding[kPeHashAlignment] = {0};
+        if (const auto alignment = m_ullBytesRead % kPeHashAlignment)
+        {
+            ULONGLONG ullWritten = 0LL;
+            if (FAILED(hr = m_PeHash->Write(const_cast<BYTE*>(padding), kPeHashAlignment - alignment, &ullWritten)))
+                return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT FileDataPass::Consume(BYTE* pData, size_t cbData)
+{
+    const auto ullOffset = m_ullBytesRead;
+    m_ullBytesRead += cbData;
+
+    if (m_FirstBytes.GetCount() < m_cbFirstBytes)
+    {
+        const auto cbCaptured = m_FirstBytes.GetCount();
+        const auto cbCopy = std::min(m_cbFirstBytes - cbCaptured, cbData);
+        if (!m_FirstBytes.SetCount(cbCaptured + cbCopy))
+            return E_OUTOFMEMORY;
+
+        std::copy_n(pData, cbCopy, m_FirstBytes.GetData() + cbCaptured);
+    }
+
+    if (!m_FuzzyHash)
+        return HashBlock(pData, cbData, ullOffset);
+
+    // The fuzzy hash costs more than the crypto hashes together: both read the block at the same time
+    HRESULT hrFuzzy = E_FAIL;
+    HRESULT hrHashes = S_OK;
+    if ((m_CryptoHash || m_PeHash) && cbData >= kMinOverlappedBlockSize)
+    {
+        TaskPool::ParallelFor(TaskPool::Subsystem::Hash, size_t(0), size_t(2), [&](size_t i) {
+            if (i == 0)
+            {
+                ULONGLONG ullWritten = 0LL;
+                hrFuzzy = m_FuzzyHash->Write(pData, cbData, &ullWritten);
+            }
+            else
+            {
+                hrHashes = HashBlock(pData, cbData, ullOffset);
+            }
+        });
+    }
+    else
+    {
+        ULONGLONG ullWritten = 0LL;
+        hrFuzzy = m_FuzzyHash->Write(pData, cbData, &ullWritten);
+        if (SUCCEEDED(hrFuzzy))
+            hrHashes = HashBlock(pData, cbData, ullOffset);
+    }
+
+    if (FAILED(hrFuzzy))
+        return hrFuzzy;
+
+    return hrHashes;
+}
+
+HRESULT FileDataPass::HashBlock(BYTE* pData, size_t cbData, ULONGLONG ullOffset)
+{
+    HRESULT hr = E_FAIL;
+    const auto ullEndOffset = ullOffset + cbData;
+
+    ULONGLONG ullWritten = 0LL;
+    if (m_CryptoHash && FAILED(hr = m_CryptoHash->Write(pData, cbData, &ullWritten)))
+        return hr;
+
+    if (m_PeHash)
+    {
+        // Chunks are ordered, only the part of each one within this block is hashed
+        for (const auto& chunk : m_PeChunks)
+        {
+            const auto ullBegin = std::max<ULONGLONG>(chunk.offset, ullOffset);
+            const auto ullEnd = std::min<ULONGLONG>(chunk.offset + chunk.length, ullEndOffset);
+            if (ullBegin >= ullEnd)
+                continue;
+
+            if (FAILED(hr = m_PeHash->Write(pData + (ullBegin - ullOffset), ullEnd - ullBegin, &ullWritten)))
+                return hr;
+        }
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,78 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "BinaryBuffer.h"
+#include "CryptoHashStreamAlgorithm.h"
+#include "FuzzyHashStreamAlgorithm.h"
+#include "FileFormat/PeParser.h"
+
+#include <memory>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class ByteStream;
+class CryptoHashStream;
+class FuzzyHashStream;
+
+//
+// FileDataPass: single sequential read of a data stream feeding every consumer of its content.
+//
+// The consumers are added first (first bytes, hashes of the whole data, authenticode hash of a PE), then Run reads the
+// stream once from its beginning and hands each block to all of them. The authenticode hash only receives the bytes of
+// the chunks given by PeParser::GetHashedChunks, followed by the zero padding to a multiple of 8 bytes. The fuzzy hash
+// of a large block runs on the hash scheduler alongside the other hashes of the same block.
+//
+class FileDataPass
+{
+public:
+    FileDataPass();
+    ~FileDataPass();
+
+    void AddFirstBytes(size_t cbFirstBytes);
+    HRESULT AddCryptoHash(CryptoHashStreamAlgorithm algs);
+    HRESULT AddFuzzyHash(FuzzyHashStreamAlgorithm algs);
+    HRESULT AddPeHash(CryptoHashStreamAlgorithm algs, const PeParser::PeChunks& chunks);
+
+    bool IsEmpty() const;
+
+    // A pe hash whose chunks do not fit in the stream is dropped, the other consumers are still fed
+    HRESULT Run(ByteStream& stream);
+
+    ULONGLONG BytesRead() const { return m_ullBytesRead; }
+
+    CBinaryBuffer& FirstBytes() { return m_FirstBytes; }
+    const std::shared_ptr<CryptoHashStream>& CryptoHash() const { return m_CryptoHash; }
+    const std::shared_ptr<FuzzyHashStream>& FuzzyHash() const { return m_FuzzyHash; }
+    const std::shared_ptr<CryptoHashStream>& PeHash() const { return m_PeHash; }
+
+private:
+    HRESULT Consume(BYTE* pData, size_t cbData);
+
+    // Crypto and pe hashes of a block at 'ullOffset' in the stream
+    HRESULT HashBlock(BYTE* pData, size_t cbData, ULONGLONG ullOffset);
+
+    size_t m_cbFirstBytes = 0;
+    CBinaryBuffer m_FirstBytes;
+
+    std::shared_ptr<CryptoHashStream> m_CryptoHash;
+    std::shared_ptr<FuzzyHashStream> m_FuzzyHash;
+
+    std::shared_ptr<CryptoHashStream> m_PeHash;
+    PeParser::PeChunks m_PeChunks;
+
+    ULONGLONG m_ullBytesRead = 0LL;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -32,6 +32,74 @@ using namespace Orc;
 //
 static const auto STATUS_NO_MORE_FILES = ((NTSTATUS)0x80000006L);
 
+namespace {
+
+constexpr auto FileIdBothDirectoryInformation = static_cast<FILE_INFORMATION_CLASS>(37);
+
+// Large enough for a few hundred entries per call
+constexpr auto kDirectoryBufferSize = 64 * 1024;
+
+constexpr ULONG kFileDirectoryFile = 0x00000001;
+constexpr ULONG kFileSynchronousIoNonAlert = 0x00000020;
+constexpr ULONG kFileOpenByFileId = 0x00002000;
+constexpr ULONG kFileOpenForBackupIntent = 0x00004000;
+
+// Call 'onEntry' with each entry of an opened directory
+template <typename DirectoryInformation, typename Fn>
+HRESULT QueryDirectory(HANDLE hDirectory, FILE_INFORMATION_CLASS informationClass, Fn onEntry)
+{
+    HRESULT hr = E_FAIL;
+
+    const auto pNtDll = ExtensionLibrary::GetLibrary<NtDllExtension>();
+    if (pNtDll == nullptr)
+        return E_FAIL;
+
+    CBinaryBuffer FileInformation(true);
+    FileInformation.SetCount(kDirectoryBufferSize);
+    IO_STATUS_BLOCK IoStatusBlock;
+    ZeroMemory(&IoStatusBlock, sizeof(IoStatusBlock));
+
+    while ((hr = pNtDll->NtQueryDirectoryFile(
+                hDirectory,
+                nullptr,
+                nullptr,
+                nullptr,
+                &IoStatusBlock,
+                FileInformation.GetData(),
+                (ULONG)FileInformation.GetCount(),
+                informationClass,
+                FALSE,
+                nullptr,
+                FALSE))
+           != HRESULT_FROM_NT(STATUS_NO_MORE_FILES))
+    {
+        if (FAILED(hr))
+        {
+            Log::Error("Failed NtQueryDirectoryFile [{}]", SystemError(hr));
+            return hr;
+        }
+
+        DWORD dwWalkedBytes = 0L;
+
+        auto pDirInfo = reinterpret_cast<DirectoryInformation*>(FileInformation.GetData());
+
+        while (dwWalkedBytes < IoStatusBlock.Information)
+        {
+            onEntry(pDirInfo);
+
+            if (pDirInfo->NextEntryOffset == 0)
+                break;
+
+            dwWalkedBytes += pDirInfo->NextEntryOffset;
+            pDirInfo = reinterpret_cast<DirectoryInformation*>(((BYTE*)pDirInfo) + pDirInfo->NextEntryOffset);
+        }
+    }
+
+    return S_OK;
+}
+
+}  // namespace
+
 HRESULT FileDirectory::FileInstance::Write(ITableOutput& output, const std::wstring& strDescription) const
 {
     SystemDetails::WriteComputerName(output);
@@ -78,15 +146,9 @@ HRESULT FileDirectory::FileInstance::Write(IStructuredOutput& pWriterOutput, LPC
 
 HRESULT FileDirectory::ParseFileDirectory(const std::wstring& aObjDir, FileDirectory::Callback aCallback)
 {
-    HRESULT hr = E_FAIL;
-
     if (aCallback == nullptr)
         return E_POINTER;
 
-    const auto pNtDll = ExtensionLibrary::GetLibrary<NtDllExtension>();
-    if (pNtDll == nullptr)
-        return E_FAIL;
-
     HANDLE hPipeRoot = CreateFile(
         aObjDir.c_str(),
         GENERIC_READ,
@@ -107,42 +169,8 @@ HRESULT FileDirectory::ParseFileDirectory(const std::wstring& aObjDir, FileDirec
     }
     BOOST_SCOPE_EXIT_END;
 
-    DWORD dwPageSize = 0L;
-    if (FAILED(hr = SystemDetails::GetPageSize(dwPageSize)))
-        return hr;
-
-    CBinaryBuffer FileInformation(true);
-    FileInformation.SetCount(dwPageSize * 4);
-    IO_STATUS_BLOCK IoStatusBlock;
-    ZeroMemory(&IoStatusBlock, sizeof(IoStatusBlock));
-
-    while ((hr = pNtDll->NtQueryDirectoryFile(
-                hPipeRoot,
-                nullptr,
-                nullptr,
-                nullptr,
-                &IoStatusBlock,
-                FileInformation.GetData(),
-                (ULONG)FileInformation.GetCount(),
-                FileDirectoryInformation,
-                FALSE,
-                nullptr,
-                FALSE))
-           != HRESULT_FROM_NT(STATUS_NO_MORE_FILES))
-    {
-
-        if (FAILED(hr))
-        {
-            Log::Error("Failed NtQueryDirectoryFile [{}]", SystemError(hr));
-            return hr;
-        }
-
-        DWORD dwWalkedBytes = 0L;
-
-        PFILE_DIRECTORY_INFORMATION pDirInfo = (PFILE_DIRECTORY_INFORMATION)FileInformation.GetData();
-
-        while (dwWalkedBytes < IoStatusBlock.Information)
-        {
+    return ::QueryDirectory<FILE_DIRECTORY_INFORMATION>(
+        hPipeRoot, FileDirectoryInformation, [&aObjDir, &aCallback](PFILE_DIRECTORY_INFORMATION pDirInfo) {
             std::wstring strFileName;
             strFileName.assign(pDirInfo->FileName, pDirInfo->FileNameLength / sizeof(WCHAR));
 
@@ -153,16 +181,7 @@ HRESULT FileDirectory::ParseFileDirectory(const std::wstring& aObjDir, FileDirec
             path.append(strFileName);
 
             aCallback(std::move(strFileName), std::move(path), pDirInfo);
-
-            if (pDirInfo->NextEntryOffset == 0)
-                break;
-
-            dwWalkedBytes += pDirInfo->NextEntryOffset;
-            pDirInfo = (PFILE_DIRECTORY_INFORMATION)(((BYTE*)pDirInfo) + pDirInfo->NextEntryOffset);
-        }
-    }
-
-    return S_OK;
+        });
 }
 
 HRESULT FileDirectory::ParseFileDirectory(const std::wstring& aObjDir, std::vector<FileInstance>& objects)
@@ -183,4 +202,97 @@ HRESULT FileDirectory::ParseFileDirectory(const std::wstring& aObjDir, std::vect
         });
 }
 
+HRESULT FileDirectory::ParseFileIdDirectory(HANDLE hVolume, ULONGLONG ullDirectoryFRN, IdCallback aCallback)
+{
+    if (aCallback == nullptr)
+        return E_POINTER;
+
+    const auto pNtDll = ExtensionLibrary::GetLibrary<NtDllExtension>();
+    if (pNtDll == nullptr)
+        return E_FAIL;
+
+    UNICODE_STRING sFileID = {
+        sizeof(ullDirectoryFRN), sizeof(ullDirectoryFRN), reinterpret_cast<WCHAR*>(&ullDirectoryFRN)};
+
+    OBJECT_ATTRIBUTES ObjAttr;
+    ZeroMemory(&ObjAttr, sizeof(ObjAttr));
+    ObjAttr.Length = sizeof(OBJECT_ATTRIBUTES);
+    ObjAttr.RootDirectory = hVolume;
+    ObjAttr.ObjectName = &sFileID;
+
+    IO_STATUS_BLOCK IoStatusBlock;
+    HANDLE hDirectory = INVALID_HANDLE_VALUE;
+
+    HRESULT hr = pNtDll->NtOpenFile(
+        &hDirectory,
+        FILE_LIST_DIRECTORY | SYNCHRONIZE,
+        &ObjAttr,
+        &IoStatusBlock,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        kFileOpenByFileId | kFileDirectoryFile | kFileSynchronousIoNonAlert | kFileOpenForBackupIntent);
+    if (FAILED(hr))
+    {
+        Log::Debug("Failed to open directory (frn: {:#x}) [{}]", ullDirectoryFRN, SystemError(hr));
+        return hr;
+    }
+
+    BOOST_SCOPE_EXIT(&hDirectory)
+    {
+        CloseHandle(hDirectory);
+    }
+    BOOST_SCOPE_EXIT_END;
+
+    return ::QueryDirectory<FILE_ID_BOTH_DIR_INFORMATION>(hDirectory, FileIdBothDirectoryInformation, aCallback);
+}
+
 FileDirectory::~FileDirectory() {}
+
+void FileIdDirectoryCache::Reset(HANDLE hVolume)
+{
+    m_hVolume = hVolume;
+    m_directories.clear();
+}
+
+const FileIdDirectoryCache::Entry* FileIdDirectoryCache::Find(ULONGLONG ullParentFRN, ULONGLONG ullFRN)
+{
+    auto it = std::find_if(std::begin(m_directories), std::end(m_directories), [ullParentFRN](const auto& directory) {
+        return directory.FRN == ullParentFRN;
+    });
+
+    if (it != std::end(m_directories))
+    {
+        m_directories.splice(std::begin(m_directories), m_directories, it);
+    }
+    else
+    {
+        if (m_directories.size() >= m_maxDirectories)
+        {
+            m_directories.pop_back();
+        }
+
+        m_directories.push_front({ullParentFRN, {}});
+        auto& entries = m_directories.front().Entries;
+
+        // A failure leaves the directory empty: its files are not looked up again in the enumeration
+        FileDirectory::ParseFileIdDirectory(m_hVolume, ullParentFRN, [&entries](PFILE_ID_BOTH_DIR_INFORMATION pInfo) {
+            entries.emplace(
+                static_cast<ULONGLONG>(pInfo->FileId.QuadPart),
+                Entry {pInfo->FileAttributes,
+                       pInfo->CreationTime,
+                       pInfo->LastAccessTime,
+                       pInfo->LastWriteTime,
+                       pInfo->ChangeTime,
+                       pInfo->EndOfFile,
+                       std::wstring(pInfo->ShortName, pInfo->ShortNameLength / sizeof(WCHAR))});
+        });
+    }
+
+    const auto& entries = m_directories.front().Entries;
+    const auto entry = entries.find(ullFRN);
+    if (entry == std::cend(entries))
+    {
+        return nullptr;
+    }
+
+    return &entry->second;
+}
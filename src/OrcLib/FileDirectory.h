@@ -9,6 +9,8 @@
 
 #include <Winternl.h>
 #include <functional>
+#include <list>
+#include <unordered_map>
 
 #include "OrcLib.h"
 
@@ -35,6 +37,26 @@ struct FILE_DIRECTORY_INFORMATION
 };
 using PFILE_DIRECTORY_INFORMATION = FILE_DIRECTORY_INFORMATION*;
 
+struct FILE_ID_BOTH_DIR_INFORMATION
+{
+    ULONG NextEntryOffset;
+    ULONG FileIndex;
+    LARGE_INTEGER CreationTime;
+    LARGE_INTEGER LastAccessTime;
+    LARGE_INTEGER LastWriteTime;
+    LARGE_INTEGER ChangeTime;
+    LARGE_INTEGER EndOfFile;
+    LARGE_INTEGER AllocationSize;
+    ULONG FileAttributes;
+    ULONG FileNameLength;
+    ULONG EaSize;
+    CCHAR ShortNameLength;
+    WCHAR ShortName[12];
+    LARGE_INTEGER FileId;
+    WCHAR FileName[1];
+};
+using PFILE_ID_BOTH_DIR_INFORMATION = FILE_ID_BOTH_DIR_INFORMATION*;
+
 class FileDirectory
 {
 public:
@@ -83,14 +105,66 @@ public:
         HRESULT Write(IStructuredOutput& pWriter, LPCWSTR szElement = L"object") const;
     };
 
+    using IdCallback = std::function<void(const PFILE_ID_BOTH_DIR_INFORMATION pDirectoryInformation)>;
+
 private:
 public:
     HRESULT ParseFileDirectory(const std::wstring& aObjDir, Callback aCallback);
     HRESULT ParseFileDirectory(const std::wstring& aObjDir, std::vector<FileInstance>& objects);
 
+    // Entries of the directory with the file reference number 'ullDirectoryFRN', on the volume opened as 'hVolume'
+    static HRESULT ParseFileIdDirectory(HANDLE hVolume, ULONGLONG ullDirectoryFRN, IdCallback aCallback);
+
     ~FileDirectory();
 };
 
+//
+// FileIdDirectoryCache: metadata of the files of the last enumerated directories, by file reference number.
+//
+// Looking up the files of the USN journal one by one costs a few system calls per file. The first lookup in a
+// directory enumerates it instead, with large buffers holding many entries per call, and the following lookups in the
+// same directory are answered from the cache. A directory which cannot be enumerated is cached empty: its files are
+// then looked up one by one by the caller.
+//
+class FileIdDirectoryCache
+{
+public:
+    struct Entry
+    {
+        ULONG FileAttributes;
+        LARGE_INTEGER CreationTime;
+        LARGE_INTEGER LastAccessTime;
+        LARGE_INTEGER LastWriteTime;
+        LARGE_INTEGER ChangeTime;
+        LARGE_INTEGER EndOfFile;
+        std::wstring ShortName;
+    };
+
+    FileIdDirectoryCache(size_t maxDirectories = 64)
+        : m_maxDirectories(maxDirectories)
+    {
+    }
+
+    HANDLE Volume() const { return m_hVolume; }
+
+    // Forget the cached directories, following lookups are made on 'hVolume'
+    void Reset(HANDLE hVolume);
+
+    // nullptr when the file is not in this directory (anymore) or when the directory cannot be enumerated
+    const Entry* Find(ULONGLONG ullParentFRN, ULONGLONG ullFRN);
+
+private:
+    struct Directory
+    {
+        ULONGLONG FRN;
+        std::unordered_map<ULONGLONG, Entry> Entries;
+    };
+
+    HANDLE m_hVolume = INVALID_HANDLE_VALUE;
+    size_t m_maxDirectories;
+    std::list<Directory> m_directories;  // most recently used first
+};
+
 }  // namespace Orc
 
 #pragma managed(pop)
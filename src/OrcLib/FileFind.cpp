@@ -12,6 +12,7 @@
 
 #include <sstream>
 #include <iomanip>
+#include <limits>
 
 #include <fmt/format.h>
 #include <boost/algorithm/searching/boyer_moore.hpp>
@@ -26,8 +27,11 @@
 #include "ParameterCheck.h"
 #include "Configuration/ConfigFile.h"
 #include "MFTWalker.h"
+#include "SharedMFTWalk.h"
 #include "DevNullStream.h"
 #include "SnapshotVolumeReader.h"
+#include "ShadowCopyVolumeReader.h"
+#include "HashCache.h"
 #include "TableOutputWriter.h"
 #include "StructuredOutputWriter.h"
 #include "Convert.h"
@@ -35,6 +39,8 @@
 #include "SystemDetails.h"
 #include "Log/Log.h"
 #include "MemoryStream.h"
+#include "Trace.h"
+#include "Utils/Guard.h"
 
 constexpr const unsigned int FILESPEC_FILENAME_INDEX = 1;
 constexpr const unsigned int FILESPEC_SPEC_INDEX = 3;
@@ -106,6 +112,39 @@ uint64_t SumStreamsReadLength(const std::vector<FileFind::Match::AttributeMatch>
     return sum;
 }
 
+// Streams up to this size are loaded in memory and scanned by the yara pool, bigger ones by the walking thread
+constexpr uint64_t kMaxPooledYaraScan = 32 * 1024 * 1024;
+
+// Terms are compiled when added to FileFind, a term which was not is matched from its spec
+bool MatchWildcard(const WildcardPattern& pattern, const std::wstring& strSpec, std::wstring_view name)
+{
+    if (pattern.empty())
+        return WildcardPattern(strSpec).Match(name);
+
+    return pattern.Match(name);
+}
+
+bool HasMatchingTermYaraRule(const FileFind::SearchTerm& term, const MatchingRuleCollection& matchingRules)
+{
+    const bool bCompiled = term.YaraRulePatterns.size() == term.YaraRules.size();
+
+    for (size_t i = 0; i < term.YaraRules.size(); i++)
+    {
+        const auto pattern = bCompiled ? WildcardPattern() : WildcardPattern(std::string_view(term.YaraRules[i]));
+        const auto& termRule = bCompiled ? term.YaraRulePatterns[i] : pattern;
+
+        for (const auto& matchingRule : matchingRules)
+        {
+            if (termRule.Match(std::string_view(matchingRule)))
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 bool IsExcludedDataAttribute(const Orc::MFTRecord& record, const Orc::DataAttribute& dataAttribute)
 {
     // TODO: ignore hash for $BadClus, $Mft... (frn from 0-10) ?
@@ -158,6 +197,99 @@ inline bool IsEqual(const FILE_REFERENCE& ref1, const FILE_REFERENCE& ref2)
         && ref1.SegmentNumberLowPart == ref2.SegmentNumberLowPart && ref1.SequenceNumber == ref2.SequenceNumber;
 }
 
+std::vector<std::shared_ptr<Location>> ParsedLocations(const LocationSet& locations)
+{
+    const auto& lowest_locs = locations.GetAltitudeLocations();
+    std::vector<std::shared_ptr<Location>> locs;
+
+    // keep only the locations we're parsing
+    std::copy_if(
+        begin(lowest_locs), end(lowest_locs), back_inserter(locs), [](const shared_ptr<Location>& item) -> bool {
+            return item->GetParse();
+        });
+
+    return locs;
+}
+
+// Walking one of the locations walks the other: same volume and same sub directories
+bool IsSameWalk(Location& lhs, Location& rhs)
+{
+    return equalCaseInsensitive(lhs.GetIdentifier(), rhs.GetIdentifier()) && lhs.GetSubDirs() == rhs.GetSubDirs();
+}
+
+// A stream of a shadow copy whose extents the diff area does not remap has the data of the live volume
+bool IsUnchangedFromLiveVolume(const FileFind::Match& match, const FileFind::Match::AttributeMatch& attribute)
+{
+    const auto pShadowReader = std::dynamic_pointer_cast<ShadowCopyVolumeReader>(match.VolumeReader);
+    if (pShadowReader == nullptr)
+        return false;
+
+    const auto dataAttr = attribute.DataAttr.lock();
+    if (dataAttr == nullptr || !dataAttr->IsNonResident())
+        return false;
+
+    const auto pNonResidentInfo = dataAttr->GetNonResidentInformation(match.VolumeReader);
+    if (pNonResidentInfo == nullptr)
+        return false;
+
+    return pShadowReader->IsUnchanged(pNonResidentInfo->ExtentsVector);
+}
+
+// Identity of a data stream of a match in the run's hash cache, when it has one
+std::optional<HashCache::Key>
+GetHashCacheKey(const FileFind::Match& match, const FileFind::Match::AttributeMatch& attribute)
+{
+    if (!HashCache::Instance().IsEnabled() || attribute.Type != $DATA || match.DeletedRecord
+        || match.StandardInformation == nullptr || match.VolumeReader == nullptr)
+        return std::nullopt;
+
+    // Snapshots share the volume serial number: only streams still identical to the live volume share its entries
+    if (std::dynamic_pointer_cast<SnapshotVolumeReader>(match.VolumeReader)
+        && !IsUnchangedFromLiveVolume(match, attribute))
+        return std::nullopt;
+
+    HashCache::Key key;
+    key.VolumeSerialNumber = match.VolumeReader->VolumeSerialNumber();
+    key.FRN = NtfsFullSegmentNumber(&match.FRN);
+    key.DataInstance = attribute.InstanceID;
+    key.DataSize = attribute.DataSize;
+
+    const auto& lastModification = match.StandardInformation->LastModificationTime;
+    key.LastModificationTime =
+        (static_cast<LONGLONG>(lastModification.dwHighDateTime) << 32) | lastModification.dwLowDateTime;
+    return key;
+}
+
+// Fill the hashes of 'algs' missing from 'attribute' with the cached ones
+void LoadCachedHashes(
+    const HashCache::Key& key,
+    CryptoHashStream::Algorithm algs,
+    FileFind::Match::AttributeMatch& attribute)
+{
+    auto& cache = HashCache::Instance();
+    if (HasFlag(algs, CryptoHashStream::Algorithm::MD5) && attribute.MD5.empty())
+        cache.Lookup(key, HashCache::Hash::MD5, attribute.MD5);
+    if (HasFlag(algs, CryptoHashStream::Algorithm::SHA1) && attribute.SHA1.empty())
+        cache.Lookup(key, HashCache::Hash::SHA1, attribute.SHA1);
+    if (HasFlag(algs, CryptoHashStream::Algorithm::SHA256) && attribute.SHA256.empty())
+        cache.Lookup(key, HashCache::Hash::SHA256, attribute.SHA256);
+    if (HasFlag(algs, CryptoHashStream::Algorithm::BLAKE3) && attribute.BLAKE3.empty())
+        cache.Lookup(key, HashCache::Hash::BLAKE3, attribute.BLAKE3);
+}
+
+void StoreCachedHashes(const HashCache::Key& key, const FileFind::Match::AttributeMatch& attribute)
+{
+    auto& cache = HashCache::Instance();
+    if (!attribute.MD5.empty())
+        cache.Store(key, HashCache::Hash::MD5, attribute.MD5);
+    if (!attribute.SHA1.empty())
+        cache.Store(key, HashCache::Hash::SHA1, attribute.SHA1);
+    if (!attribute.SHA256.empty())
+        cache.Store(key, HashCache::Hash::SHA256, attribute.SHA256);
+    if (!attribute.BLAKE3.empty())
+        cache.Store(key, HashCache::Hash::BLAKE3, attribute.BLAKE3);
+}
+
 }  // namespace
 
 std::wregex& FileFind::DOSPattern()
@@ -524,6 +656,8 @@ HRESULT FileFind::Match::Write(IStructuredOutput& pWriter, LPCWSTR szElement)
                     pWriter.WriteNamed(L"MD5", data_it->MD5, false);
                     pWriter.WriteNamed(L"SHA1", data_it->SHA1, false);
                     pWriter.WriteNamed(L"SHA256", data_it->SHA256, false);
+                    if (!data_it->BLAKE3.empty())
+                        pWriter.WriteNamed(L"BLAKE3", data_it->BLAKE3, false);
                 }
                 pWriter.EndElement(nullptr);
             }
@@ -881,6 +1015,47 @@ std::shared_ptr<FileFind::SearchTerm> FileFind::GetSearchTermFromConfig(const Co
             Log::Warn(L"Invalid hex string passed as sha256: {}", item[CONFIG_FILEFIND_SHA256]);
         }
     }
+    if (item[CONFIG_FILEFIND_BLAKE3])
+    {
+        fs->BLAKE3.SetCount(BYTES_IN_BLAKE3_HASH);
+        if (SUCCEEDED(
+                hr = GetBytesFromHexaString(
+                    item[CONFIG_FILEFIND_BLAKE3].c_str(),
+                    (DWORD)item[CONFIG_FILEFIND_BLAKE3].size(),
+                    fs->BLAKE3.GetData(),
+                    BYTES_IN_BLAKE3_HASH)))
+            fs->Required |= FileFind::SearchTerm::DATA_BLAKE3;
+        else
+        {
+            Log::Warn(L"Invalid hex string passed as blake3: {}", item[CONFIG_FILEFIND_BLAKE3]);
+        }
+    }
+    if (item[CONFIG_FILEFIND_HASH_LIST])
+    {
+        std::wstring strHashList;
+        if (FAILED(hr = ExpandFilePath(item[CONFIG_FILEFIND_HASH_LIST].c_str(), strHashList)))
+        {
+            Log::Warn(L"Invalid hash list file: {} [{}]", item[CONFIG_FILEFIND_HASH_LIST], SystemError(hr));
+        }
+        else
+        {
+            auto hashes = std::make_shared<HashList>();
+            if (FAILED(hr = hashes->LoadFile(strHashList)))
+            {
+                Log::Warn(L"Failed to load hash list: {} [{}]", strHashList, SystemError(hr));
+            }
+            else if (hashes->Count() == 0)
+            {
+                Log::Warn(L"Hash list '{}' does not contain any valid hash", strHashList);
+            }
+            else
+            {
+                fs->HashListSpec = item[CONFIG_FILEFIND_HASH_LIST];
+                fs->Hashes = std::move(hashes);
+                fs->Required |= FileFind::SearchTerm::DATA_HASH_LIST;
+            }
+        }
+    }
     if (item[CONFIG_FILEFIND_CONTAINS])
     {
         if (SUCCEEDED(
@@ -1262,6 +1437,25 @@ wstring FileFind::SearchTerm::GetDescription() const
             stream << fmt::format(L"{:02X}", SHA256[i]);
         bFirst = false;
     }
+    if (Required & SearchTerm::Criteria::DATA_BLAKE3)
+    {
+        if (!bFirst)
+            stream << L", ";
+        stream << L"BLAKE3=";
+
+        for (DWORD i = 0; i < BYTES_IN_BLAKE3_HASH; i++)
+            stream << fmt::format(L"{:02X}", BLAKE3[i]);
+        bFirst = false;
+    }
+    if (Required & SearchTerm::Criteria::DATA_HASH_LIST)
+    {
+        if (!bFirst)
+            stream << L", ";
+        stream << L"Hash in list " << HashListSpec;
+        if (Hashes)
+            stream << L" (" << Hashes->Count() << L" hashes)";
+        bFirst = false;
+    }
 
     if (Required & SearchTerm::Criteria::CONTAINS)
     {
@@ -1336,6 +1530,24 @@ std::pair<bool, std::wstring> Orc::FileFind::SearchTerm::IsValidTerm()
     return {true, L""s};
 }
 
+void Orc::FileFind::SearchTerm::CompileWildcards()
+{
+    const auto compile = [this](Criteria match, const std::wstring& strSpec, WildcardPattern& pattern) {
+        pattern = Required & match ? WildcardPattern(strSpec) : WildcardPattern();
+    };
+
+    compile(Criteria::NAME_MATCH, FileName, FileNamePattern);
+    compile(Criteria::PATH_MATCH, Path, PathPattern);
+    compile(Criteria::ADS_MATCH, ADSName, ADSNamePattern);
+    compile(Criteria::EA_MATCH, EAName, EANamePattern);
+    compile(Criteria::ATTR_NAME_MATCH, AttrName, AttrNamePattern);
+
+    YaraRulePatterns.clear();
+    YaraRulePatterns.reserve(YaraRules.size());
+    for (const auto& rule : YaraRules)
+        YaraRulePatterns.emplace_back(std::string_view(rule));
+}
+
 HRESULT FileFind::SearchTerm::AddTermToConfig(ConfigItem& item)
 {
     ConfigItem& ntfs_find = item;
@@ -1442,6 +1654,16 @@ HRESULT FileFind::SearchTerm::AddTermToConfig(ConfigItem& item)
         ntfs_find.SubItems[CONFIG_FILEFIND_SHA256].strData = SHA256.ToHex();
         ntfs_find.SubItems[CONFIG_FILEFIND_SHA256].Status = ConfigItem::PRESENT;
     }
+    if (Required & DATA_BLAKE3)
+    {
+        ntfs_find.SubItems[CONFIG_FILEFIND_BLAKE3].strData = BLAKE3.ToHex();
+        ntfs_find.SubItems[CONFIG_FILEFIND_BLAKE3].Status = ConfigItem::PRESENT;
+    }
+    if (Required & DATA_HASH_LIST)
+    {
+        ntfs_find.SubItems[CONFIG_FILEFIND_HASH_LIST].strData = HashListSpec;
+        ntfs_find.SubItems[CONFIG_FILEFIND_HASH_LIST].Status = ConfigItem::PRESENT;
+    }
     if (Required & HEADER || Required & HEADER_HEX)
     {
         ntfs_find.SubItems[CONFIG_FILEFIND_HEADER_HEX].strData = Header.ToHex();
@@ -1614,6 +1836,12 @@ HRESULT FileFind::InitializeYara(std::unique_ptr<YaraConfig>& config)
         }
     }
 
+    if (FAILED(hr = m_YaraScan->CompileRules()))
+    {
+        Log::Error("Failed to compile yara rules [{}]", SystemError(hr));
+        return hr;
+    }
+
     {
         std::sort(begin(yara_rules), end(yara_rules));
         auto new_end = std::unique(begin(yara_rules), end(yara_rules));
@@ -1647,6 +1875,16 @@ HRESULT FileFind::InitializeYara(std::unique_ptr<YaraConfig>& config)
 
     m_YaraScan->PrintConfiguration();
 
+    if (config && config->workers() > 0)
+    {
+        m_YaraPool = std::make_unique<YaraScanPool>(*m_YaraScan, config->workers(), config->pendingSize());
+        if (m_YaraPool->Workers() == 0)
+        {
+            Log::Error("Failed to start yara scan workers, streams will be scanned by the walking thread");
+            m_YaraPool.reset();
+        }
+    }
+
     return S_OK;
 }
 
@@ -1874,6 +2112,8 @@ HRESULT FileFind::AddTerm(const shared_ptr<SearchTerm>& pMatch)
         }
     }
 
+    pMatch->CompileWildcards();
+
     return S_OK;
 }
 
@@ -2012,6 +2252,8 @@ HRESULT FileFind::AddExcludeTerm(const shared_ptr<SearchTerm>& pMatch)
             m_ExcludeTerms.push_back(pMatch);
     }
 
+    pMatch->CompileWildcards();
+
     return S_OK;
 }
 FileFind::SearchTerm::Criteria
@@ -2036,12 +2278,12 @@ FileFind::MatchName(const std::shared_ptr<FileFind::SearchTerm>& aTerm, const PF
     {
         if (pFileName == nullptr)
             return SearchTerm::Criteria::NONE;
-        WCHAR szName[ORC_MAX_PATH];
-        szName[0] = L'\0';  // avoid false positive warning C6054
-        wcsncpy_s(szName, pFileName->FileName, pFileName->FileNameLength);
         if (aTerm->FileName.empty())
             return SearchTerm::Criteria::NONE;
-        if (PathMatchSpec(szName, aTerm->FileName.c_str()))
+        if (MatchWildcard(
+                aTerm->FileNamePattern,
+                aTerm->FileName,
+                std::wstring_view(pFileName->FileName, pFileName->FileNameLength)))
             return SearchTerm::Criteria::NAME_MATCH;
     }
     return SearchTerm::Criteria::NONE;
@@ -2053,7 +2295,7 @@ FileFind::RegexName(const std::shared_ptr<FileFind::SearchTerm>& aTerm, const PF
     SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
     if (aTerm->Required & SearchTerm::Criteria::NAME_REGEX)
     {
-        if (regex_match(pFileName->FileName, pFileName->FileName + pFileName->FileNameLength, aTerm->FileNameRegEx))
+        if (aTerm->FileNameRegEx.Match(pFileName->FileName, pFileName->FileName + pFileName->FileNameLength))
             matchedSpec |= SearchTerm::Criteria::NAME_REGEX;
 
         return matchedSpec;
@@ -2145,18 +2387,29 @@ FileFind::SearchTerm::Criteria FileFind::AddMatchingName(
     SearchTerm::Criteria requiredSpec,
     std::shared_ptr<Match>& aFileMatch,
     MFTRecord* pElt) const
+{
+    return AddMatchingName(
+        aTerm, requiredSpec, aFileMatch, pElt->GetFileNames(), pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+}
+
+FileFind::SearchTerm::Criteria FileFind::AddMatchingName(
+    const std::shared_ptr<SearchTerm>& aTerm,
+    SearchTerm::Criteria requiredSpec,
+    std::shared_ptr<Match>& aFileMatch,
+    const std::vector<PFILE_NAME>& fileNames,
+    const FILE_REFERENCE& frn,
+    bool bDeleted) const
 {
     SearchTerm::Criteria retval = SearchTerm::Criteria::NONE;
 
-    for (auto name_iter = begin(pElt->GetFileNames()); name_iter != end(pElt->GetFileNames()); ++name_iter)
+    for (auto name_iter = begin(fileNames); name_iter != end(fileNames); ++name_iter)
     {
         SearchTerm::Criteria matchedSpec = MatchName(aTerm, requiredSpec, aFileMatch, *name_iter);
 
         if (requiredSpec == matchedSpec)
         {
             if (aFileMatch == nullptr)
-                aFileMatch = std::make_shared<Match>(
-                    m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+                aFileMatch = NewMatch(m_pVolReader, aTerm, frn, bDeleted);
 
             aFileMatch->AddFileNameMatch(m_FullNameBuilder, *name_iter);
 
@@ -2235,7 +2488,7 @@ FileFind::MatchPath(const std::shared_ptr<FileFind::SearchTerm>& aTerm, const WC
 
         if (aTerm->Path.empty())
             return SearchTerm::Criteria::NONE;
-        if (PathMatchSpec(szFullName, aTerm->Path.c_str()))
+        if (MatchWildcard(aTerm->PathPattern, aTerm->Path, szFullName))
             return SearchTerm::Criteria::PATH_MATCH;
     }
     return SearchTerm::Criteria::NONE;
@@ -2259,7 +2512,7 @@ FileFind::RegexPath(const std::shared_ptr<FileFind::SearchTerm>& aTerm, const WC
         if (szFullName[0] != L'\\')
             return SearchTerm::Criteria::NONE;
 
-        if (regex_match(szFullName, szFullName + wcslen(szFullName), aTerm->PathRegEx))
+        if (aTerm->PathRegEx.Match(szFullName, szFullName + wcslen(szFullName)))
             matchedSpec |= SearchTerm::Criteria::PATH_REGEX;
 
         return matchedSpec;
@@ -2351,18 +2604,29 @@ FileFind::SearchTerm::Criteria FileFind::AddMatchingPath(
     SearchTerm::Criteria requiredSpec,
     std::shared_ptr<Match>& aFileMatch,
     MFTRecord* pElt) const
+{
+    return AddMatchingPath(
+        aTerm, requiredSpec, aFileMatch, pElt->GetFileNames(), pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+}
+
+FileFind::SearchTerm::Criteria FileFind::AddMatchingPath(
+    const std::shared_ptr<SearchTerm>& aTerm,
+    SearchTerm::Criteria requiredSpec,
+    std::shared_ptr<Match>& aFileMatch,
+    const std::vector<PFILE_NAME>& fileNames,
+    const FILE_REFERENCE& frn,
+    bool bDeleted) const
 {
     SearchTerm::Criteria retval = SearchTerm::Criteria::NONE;
 
-    for (auto name_iter = begin(pElt->GetFileNames()); name_iter != end(pElt->GetFileNames()); ++name_iter)
+    for (auto name_iter = begin(fileNames); name_iter != end(fileNames); ++name_iter)
     {
         SearchTerm::Criteria matchedSpec = MatchPath(aTerm, requiredSpec, aFileMatch, *name_iter);
 
         if (matchedSpec == requiredSpec)
         {
             if (aFileMatch == nullptr)
-                aFileMatch = std::make_shared<Match>(
-                    m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+                aFileMatch = NewMatch(m_pVolReader, aTerm, frn, bDeleted);
 
             if (aFileMatch == nullptr)
                 return SearchTerm::Criteria::NONE;
@@ -2454,7 +2718,7 @@ FileFind::SearchTerm::Criteria FileFind::MatchEA(
 
             auto found = std::find_if(
                 begin(ea_attr->Items()), end(ea_attr->Items()), [aTerm](const ExtendedAttribute::Item& item) {
-                    return PathMatchSpec(item.first.c_str(), aTerm->EAName.c_str());
+                    return MatchWildcard(aTerm->EANamePattern, aTerm->EAName, item.first);
                 });
             if (found != end(ea_attr->Items()))
                 return SearchTerm::Criteria::EA_MATCH;
@@ -2484,7 +2748,7 @@ FileFind::SearchTerm::Criteria FileFind::RegexEA(
 
             auto found = std::find_if(
                 begin(ea_attr->Items()), end(ea_attr->Items()), [aTerm](const ExtendedAttribute::Item& item) {
-                    return regex_match(item.first, aTerm->EANameRegEx);
+                    return aTerm->EANameRegEx.Match(item.first);
                 });
             if (found != end(ea_attr->Items()))
                 return SearchTerm::Criteria::EA_REGEX;
@@ -2510,11 +2774,7 @@ FileFind::MatchAttr(const std::shared_ptr<SearchTerm>& aTerm, LPCWSTR szAttrName
 {
     SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
 
-    WCHAR szLocalAttrName[ORC_MAX_PATH];
-    szLocalAttrName[0] = L'\0';  // avoid false positive warning C6054
-    wcsncpy_s(szLocalAttrName, szAttrName, AttrNameLen);
-
-    if (PathMatchSpec(szLocalAttrName, aTerm->AttrName.c_str()))
+    if (MatchWildcard(aTerm->AttrNamePattern, aTerm->AttrName, std::wstring_view(szAttrName, AttrNameLen)))
         return matchedSpec | SearchTerm::Criteria::ATTR_NAME_MATCH;
     return SearchTerm::Criteria::NONE;
 }
@@ -2528,7 +2788,7 @@ FileFind::RegExAttr(const std::shared_ptr<SearchTerm>& aTerm, LPCWSTR szAttrName
     szLocalAttrName[0] = L'\0';  // avoid false positive warning C6054
     wcsncpy_s(szLocalAttrName, szAttrName, AttrNameLen);
 
-    if (regex_match(szLocalAttrName, aTerm->AttrNameRegEx))
+    if (aTerm->AttrNameRegEx.Match(szLocalAttrName))
         return matchedSpec | SearchTerm::Criteria::ATTR_NAME_REGEX;
     return SearchTerm::Criteria::NONE;
 }
@@ -2631,8 +2891,7 @@ FileFind::SearchTerm::Criteria FileFind::MatchAttributes(
         if (matchedAttributesSpecs == requiredSpec)
         {
             if (aFileMatch == nullptr)
-                aFileMatch = std::make_shared<Match>(
-                    m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+                aFileMatch = NewMatch(m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
 
             if (m_bProvideStream)
                 aFileMatch->AddAttributeMatch(m_pVolReader, pAttr);
@@ -2723,10 +2982,7 @@ FileFind::MatchADS(const std::shared_ptr<FileFind::SearchTerm>& aTerm, LPCWSTR s
 {
     if (aTerm->Required & SearchTerm::Criteria::ADS_MATCH)
     {
-        WCHAR szADSName[ORC_MAX_PATH];
-        szADSName[0] = L'\0';  // avoid false positive warning C6054
-        wcsncpy_s(szADSName, szAttrName, AttrNameLen);
-        if (PathMatchSpec(szADSName, aTerm->ADSName.c_str()))
+        if (MatchWildcard(aTerm->ADSNamePattern, aTerm->ADSName, std::wstring_view(szAttrName, AttrNameLen)))
             return SearchTerm::Criteria::ADS_MATCH;
     }
     return SearchTerm::Criteria::NONE;
@@ -2738,7 +2994,7 @@ FileFind::RegexADS(const std::shared_ptr<FileFind::SearchTerm>& aTerm, LPCWSTR s
     SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
     if (aTerm->Required & SearchTerm::Criteria::ADS_REGEX)
     {
-        if (regex_match(szAttrName, szAttrName + AttrNameLen, aTerm->ADSNameRegEx))
+        if (aTerm->ADSNameRegEx.Match(szAttrName, szAttrName + AttrNameLen))
             matchedSpec = static_cast<FileFind::SearchTerm::Criteria>(matchedSpec | SearchTerm::Criteria::ADS_REGEX);
 
         return matchedSpec;
@@ -2869,8 +3125,7 @@ FileFind::SearchTerm::Criteria FileFind::AddMatchingDataNameAndSize(
         if (matchedDataNameOrSizeSpecs == requiredSpec)
         {
             if (aFileMatch == nullptr)
-                aFileMatch = std::make_shared<Match>(
-                    m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+                aFileMatch = NewMatch(m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
 
             if (m_bProvideStream)
                 aFileMatch->AddAttributeMatch(m_pVolReader, attribute);
@@ -2955,11 +3210,20 @@ FileFind::SearchTerm::Criteria FileFind::MatchHash(
     SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
 
     if (aTerm->Required & SearchTerm::Criteria::DATA_MD5 || aTerm->Required & SearchTerm::Criteria::DATA_SHA1
-        || aTerm->Required & SearchTerm::Criteria::DATA_SHA256)
+        || aTerm->Required & SearchTerm::Criteria::DATA_SHA256 || aTerm->Required & SearchTerm::Criteria::DATA_BLAKE3
+        || aTerm->Required & SearchTerm::Criteria::DATA_HASH_LIST)
     {
         if (pDataAttr == nullptr)
             return SearchTerm::Criteria::NONE;
 
+        // A stream whose size is unknown to the hash list cannot match it, no need to hash it
+        if (aTerm->Required & SearchTerm::Criteria::DATA_HASH_LIST && aTerm->Hashes)
+        {
+            ULONGLONG ullDataSize = 0LL;
+            if (SUCCEEDED(pDataAttr->DataSize(m_pVolReader, ullDataSize)) && aTerm->Hashes->RejectsSize(ullDataSize))
+                return SearchTerm::Criteria::NONE;
+        }
+
         if (FAILED(hr = pDataAttr->GetHashInformation(m_pVolReader, m_NeededHash)))
         {
             Log::Error(L"Failed to compute hash for data attribute [{}]", SystemError(hr));
@@ -2990,6 +3254,29 @@ FileFind::SearchTerm::Criteria FileFind::MatchHash(
             else
                 return SearchTerm::Criteria::NONE;
         }
+        if (aTerm->Required & SearchTerm::Criteria::DATA_BLAKE3)
+        {
+            CBinaryBuffer& blake3 = pDataAttr->GetDetails()->BLAKE3();
+            if (blake3 == aTerm->BLAKE3)
+                matchedSpec |= SearchTerm::Criteria::DATA_BLAKE3;
+            else
+                return SearchTerm::Criteria::NONE;
+        }
+        if (aTerm->Required & SearchTerm::Criteria::DATA_HASH_LIST)
+        {
+            const auto& details = pDataAttr->GetDetails();
+            const auto algs = aTerm->Hashes ? aTerm->Hashes->Algorithms() : CryptoHashStream::Algorithm::Undefined;
+
+            if ((HasFlag(algs, CryptoHashStream::Algorithm::MD5)
+                 && aTerm->Hashes->Contains(CryptoHashStream::Algorithm::MD5, details->MD5()))
+                || (HasFlag(algs, CryptoHashStream::Algorithm::SHA1)
+                    && aTerm->Hashes->Contains(CryptoHashStream::Algorithm::SHA1, details->SHA1()))
+                || (HasFlag(algs, CryptoHashStream::Algorithm::SHA256)
+                    && aTerm->Hashes->Contains(CryptoHashStream::Algorithm::SHA256, details->SHA256())))
+                matchedSpec |= SearchTerm::Criteria::DATA_HASH_LIST;
+            else
+                return SearchTerm::Criteria::NONE;
+        }
     }
     return matchedSpec;
 }
@@ -3001,6 +3288,27 @@ FileFind::SearchTerm::Criteria FileFind::MatchContains(
     HRESULT hr = E_FAIL;
     SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
 
+    if (aTerm->Required & SearchTerm::Criteria::CONTAINS && aTerm->ContainsPattern && !m_ContentMatcher.empty())
+    {
+        const auto pScan = SearchContent(pDataAttr);
+        if (pScan == nullptr || !pScan->Found(*aTerm->ContainsPattern))
+            return SearchTerm::Criteria::NONE;
+
+        return SearchTerm::Criteria::CONTAINS;
+    }
+
+    const auto resident = pDataAttr->GetResidentData();
+    if (aTerm->Required & SearchTerm::Criteria::CONTAINS && resident)
+    {
+        boost::algorithm::boyer_moore<const BYTE*> boyermoore(aTerm->Contains.begin(), aTerm->Contains.end());
+
+        const auto pEnd = resident->data() + resident->size();
+        if (boyermoore(resident->data(), pEnd) == std::make_pair(pEnd, pEnd))
+            return SearchTerm::Criteria::NONE;
+
+        return SearchTerm::Criteria::CONTAINS;
+    }
+
     if (aTerm->Required & SearchTerm::Criteria::CONTAINS)
     {
         auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
@@ -3086,6 +3394,23 @@ FileFind::FileFindMatchAllYaraRules(const Orc::MFTRecord& record, size_t dataAtt
     }
 
     const auto& dataAttribute = record.GetDataAttributes()[dataAttributeIndex];
+    if (const auto resident = dataAttribute->GetResidentData())
+    {
+        // Scanned in place, in the record
+        const CBinaryBuffer buffer(const_cast<uint8_t*>(resident->data()), resident->size());
+
+        auto [hrScan, matchingRules] = m_YaraScan->Scan(buffer);
+        if (FAILED(hrScan))
+        {
+            auto ec = SystemError(hrScan);
+            Log::Error(L"Failed Yara scan on '{}' [{}]", ::GetFileName(record, *dataAttribute), ec);
+            return ec;
+        }
+
+        m_yaraMatchCache.Set(record, dataAttributeIndex, matchingRules);
+        return matchingRules;
+    }
+
     auto dataStream = dataAttribute->GetDataStream(m_pVolReader);
     if (dataStream == nullptr)
     {
@@ -3154,19 +3479,85 @@ std::pair<Orc::FileFind::SearchTerm::Criteria, std::optional<MatchingRuleCollect
         return {SearchTerm::Criteria::YARA, std::nullopt};
     }
 
-    for (const auto& termRule : aTerm->YaraRules)
+    if (::HasMatchingTermYaraRule(*aTerm, matchingRules))
     {
-        for (const auto& matchingRule : matchingRules)
+        // Legacy: return all matching rules as one of requested is matching
+        return {SearchTerm::Criteria::YARA, std::move(matchingRules)};
+    }
+
+    return {SearchTerm::Criteria::NONE, std::nullopt};
+}
+
+std::optional<YaraScanPool::JobId> FileFind::SubmitYaraScan(MFTRecord& record, size_t dataAttributeIndex) const
+{
+    if (!m_YaraPool)
+    {
+        return {};
+    }
+
+    if (dataAttributeIndex < m_YaraJobsOfRecord.size() && m_YaraJobsOfRecord[dataAttributeIndex])
+    {
+        // Already submitted for another term
+        return m_YaraJobsOfRecord[dataAttributeIndex];
+    }
+
+    const auto& dataAttribute = record.GetDataAttributes()[dataAttributeIndex];
+    if (dataAttribute->GetResidentData())
+    {
+        // Resident data is scanned in place by MatchYara, copying it for the pool would cost more than the scan
+        return {};
+    }
+
+    auto dataStream = dataAttribute->GetDataStream(m_pVolReader);
+    if (dataStream == nullptr)
+    {
+        return {};
+    }
+
+    const auto ullSize = dataStream->GetSize();
+    if (ullSize > kMaxPooledYaraScan)
+    {
+        return {};
+    }
+
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = dataStream->SetFilePointer(0LL, FILE_BEGIN, nullptr)))
+    {
+        Log::Debug(
+            L"Failed to seek on '{}' for yara scan pool [{}]", ::GetFileName(record, *dataAttribute), SystemError(hr));
+        return {};
+    }
+
+    YaraScanner::MemoryBlockBuffer buffer(static_cast<size_t>(ullSize));
+
+    ULONGLONG ullTotalRead = 0LL;
+    while (ullTotalRead < ullSize)
+    {
+        ULONGLONG ullBytesRead = 0LL;
+        if (FAILED(hr = dataStream->Read(buffer.data() + ullTotalRead, ullSize - ullTotalRead, &ullBytesRead)))
         {
-            if (PathMatchSpecA(matchingRule.c_str(), termRule.c_str()))
-            {
-                // Legacy: return all matching rules as one of requested is matching
-                return {SearchTerm::Criteria::YARA, std::move(matchingRules)};
-            }
+            Log::Debug(
+                L"Failed to read '{}' for yara scan pool [{}]", ::GetFileName(record, *dataAttribute), SystemError(hr));
+            return {};
+        }
+
+        if (ullBytesRead == 0)
+        {
+            break;
         }
+
+        ullTotalRead += ullBytesRead;
     }
 
-    return {SearchTerm::Criteria::NONE, std::nullopt};
+    buffer.resize(static_cast<size_t>(ullTotalRead));
+
+    const auto id = m_YaraPool->Submit(std::move(buffer));
+    if (dataAttributeIndex < m_YaraJobsOfRecord.size())
+    {
+        m_YaraJobsOfRecord[dataAttributeIndex] = id;
+    }
+
+    return id;
 }
 
 // TODO: remove this legacy function
@@ -3215,17 +3606,11 @@ std::pair<Orc::FileFind::SearchTerm::Criteria, std::optional<MatchingRuleCollect
         {
             if (!aTerm->YaraRules.empty())
             {
-                for (const auto& termRule : aTerm->YaraRules)
+                if (::HasMatchingTermYaraRule(*aTerm, matchingRules))
                 {
-                    for (const auto& matchingRule : matchingRules)
-                    {
-                        if (PathMatchSpecA(matchingRule.c_str(), termRule.c_str()))
-                        {
-                            return {
-                                SearchTerm::Criteria::YARA,
-                                matchingRules};  // With the first matchingRule in the rules spec, we have a winner
-                        }
-                    }
+                    return {
+                        SearchTerm::Criteria::YARA,
+                        matchingRules};  // With the first matchingRule in the rules spec, we have a winner
                 }
                 return {
                     SearchTerm::Criteria::NONE,
@@ -3238,86 +3623,165 @@ std::pair<Orc::FileFind::SearchTerm::Criteria, std::optional<MatchingRuleCollect
     return {matchedSpec, std::nullopt};
 }
 
-FileFind::SearchTerm::Criteria FileFind::MatchHeader(
-    const std::shared_ptr<FileFind::SearchTerm>& aTerm,
-    const std::shared_ptr<DataAttribute>& pDataAttr) const
+HRESULT FileFind::ReadHeader(
+    const std::shared_ptr<DataAttribute>& pDataAttr,
+    ULONGLONG cbLength,
+    std::string_view& header) const
 {
     HRESULT hr = E_FAIL;
-    SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
 
-    if (aTerm->Required & SearchTerm::Criteria::HEADER)
+    auto it = std::find_if(std::begin(m_HeaderCache), std::end(m_HeaderCache), [&pDataAttr](const auto& entry) {
+        return entry.DataAttr == pDataAttr;
+    });
+
+    if (it != std::end(m_HeaderCache) && (it->cbRequested >= cbLength || it->Data.GetCount() < it->cbRequested))
     {
-        auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
-        if (pDataStream == nullptr)
-            return SearchTerm::Criteria::NONE;
+        header = std::string_view(it->Data.GetP<char>(), std::min<size_t>(it->Data.GetCount(), cbLength));
+        return S_OK;
+    }
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
-        {
-            Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-            return SearchTerm::Criteria::NONE;
-        }
+    if (const auto resident = pDataAttr->GetResidentData())
+    {
+        header = std::string_view(
+            reinterpret_cast<const char*>(resident->data()), std::min<size_t>(resident->size(), cbLength));
+        return S_OK;
+    }
 
-        CBinaryBuffer buffer;
-        buffer.SetCount(aTerm->HeaderLen);
-        ULONGLONG ullBytesRead = 0;
-        ULONGLONG ullBytesToRead = aTerm->HeaderLen;
+    auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
+    if (pDataStream == nullptr)
+        return E_POINTER;
 
-        if (FAILED(hr = pDataStream->Read(buffer.GetData(), ullBytesToRead, &ullBytesRead)))
-            return SearchTerm::Criteria::NONE;
+    if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    {
+        Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+        return hr;
+    }
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
-        {
-            Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-            return SearchTerm::Criteria::NONE;
-        }
+    // Read the longest header of all the terms so that the other terms find it in the cache
+    const auto cbRead = std::max(cbLength, m_cbHeaderLength);
 
-        // Match the header here
-        if (ullBytesRead < ullBytesToRead)
-            return SearchTerm::Criteria::NONE;
-        if (!memcmp(buffer.GetData(), aTerm->Header.GetData(), aTerm->HeaderLen))
-            return matchedSpec |= SearchTerm::Criteria::HEADER;
+    CBinaryBuffer buffer;
+    buffer.SetCount(static_cast<size_t>(cbRead));
+    ULONGLONG ullBytesRead = 0;
+
+    hr = pDataStream->Read(buffer.GetData(), cbRead, &ullBytesRead);
+
+    if (HRESULT hrSeek = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr); FAILED(hrSeek))
+    {
+        Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hrSeek));
+        return hrSeek;
     }
-    return SearchTerm::Criteria::NONE;
+
+    if (FAILED(hr))
+        return hr;
+
+    buffer.SetCount(static_cast<size_t>(ullBytesRead));
+
+    if (it == std::end(m_HeaderCache))
+        it = m_HeaderCache.insert(std::end(m_HeaderCache), {pDataAttr, cbRead, std::move(buffer)});
+    else
+        *it = {pDataAttr, cbRead, std::move(buffer)};
+
+    header = std::string_view(it->Data.GetP<char>(), std::min<size_t>(it->Data.GetCount(), cbLength));
+    return S_OK;
 }
 
-FileFind::SearchTerm::Criteria
-FileFind::RegExHeader(const std::shared_ptr<SearchTerm>& aTerm, const std::shared_ptr<DataAttribute>& pDataAttr) const
+const ContentPatternMatcher::Scan* FileFind::SearchContent(const std::shared_ptr<DataAttribute>& pDataAttr) const
 {
     HRESULT hr = E_FAIL;
-    SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
 
-    if (aTerm->Required & SearchTerm::Criteria::HEADER_REGEX)
-    {
-        auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
-        if (pDataStream == nullptr)
-            return SearchTerm::Criteria::NONE;
+    auto it = std::find_if(std::cbegin(m_ContentCache), std::cend(m_ContentCache), [&pDataAttr](const auto& entry) {
+        return entry.DataAttr == pDataAttr;
+    });
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    if (it != std::cend(m_ContentCache))
+        return &it->Scan;
+
+    if (const auto resident = pDataAttr->GetResidentData())
+    {
+        ContentPatternMatcher::Scan scan(m_ContentMatcher);
+        scan.Feed(resident->data(), resident->size());
+
+        m_ContentCache.push_back({pDataAttr, std::move(scan)});
+        return &m_ContentCache.back().Scan;
+    }
+
+    auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
+    if (pDataStream == nullptr)
+        return nullptr;
+
+    if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    {
+        Log::Debug("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+        return nullptr;
+    }
+
+    constexpr size_t kContentBlockSize = 4 * 1024 * 1024;
+    if (m_ContentBuffer.GetCount() < kContentBlockSize && !m_ContentBuffer.SetCount(kContentBlockSize))
+        return nullptr;
+
+    // All the strings are searched at once, the pass stops early once every one of them was found
+    ContentPatternMatcher::Scan scan(m_ContentMatcher);
+
+    ULONGLONG ullAccumulatedBytes = 0;
+    const ULONGLONG ullBytesToRead = pDataStream->GetSize();
+    while (ullAccumulatedBytes < ullBytesToRead && !scan.AllFound())
+    {
+        ULONGLONG ullBytesRead = 0;
+        if (FAILED(hr = pDataStream->Read(m_ContentBuffer.GetData(), m_ContentBuffer.GetCount(), &ullBytesRead)))
         {
-            Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-            return SearchTerm::Criteria::NONE;
+            Log::Debug(L"Failed to read data attribute [{}]", SystemError(hr));
+            return nullptr;
         }
 
-        CBinaryBuffer buffer;
-        buffer.SetCount(aTerm->HeaderLen);
-        ULONGLONG ullBytesRead = 0;
-        ULONGLONG ullBytesToRead = aTerm->HeaderLen;
+        if (ullBytesRead == 0)
+            break;
+
+        ullAccumulatedBytes += ullBytesRead;
+        scan.Feed(m_ContentBuffer.GetData(), static_cast<size_t>(ullBytesRead));
+    }
+
+    if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    {
+        Log::Debug(L"Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+        return nullptr;
+    }
+
+    m_ContentCache.push_back({pDataAttr, std::move(scan)});
+    return &m_ContentCache.back().Scan;
+}
 
-        if (FAILED(hr = pDataStream->Read(buffer.GetData(), ullBytesToRead, &ullBytesRead)))
+FileFind::SearchTerm::Criteria FileFind::MatchHeader(
+    const std::shared_ptr<FileFind::SearchTerm>& aTerm,
+    const std::shared_ptr<DataAttribute>& pDataAttr) const
+{
+    if (aTerm->Required & SearchTerm::Criteria::HEADER)
+    {
+        std::string_view header;
+        if (FAILED(ReadHeader(pDataAttr, aTerm->HeaderLen, header)))
             return SearchTerm::Criteria::NONE;
 
         // Match the header here
-        if (regex_match(
-                (LPSTR)buffer.GetData(),
-                ((LPSTR)buffer.GetData()) + (buffer.GetCount() / sizeof(CHAR)),
-                aTerm->HeaderRegEx))
-            return matchedSpec |= SearchTerm::Criteria::HEADER_REGEX;
+        if (header.size() < aTerm->HeaderLen)
+            return SearchTerm::Criteria::NONE;
+        if (!memcmp(header.data(), aTerm->Header.GetData(), aTerm->HeaderLen))
+            return SearchTerm::Criteria::HEADER;
+    }
+    return SearchTerm::Criteria::NONE;
+}
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
-        {
-            Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+FileFind::SearchTerm::Criteria
+FileFind::RegExHeader(const std::shared_ptr<SearchTerm>& aTerm, const std::shared_ptr<DataAttribute>& pDataAttr) const
+{
+    if (aTerm->Required & SearchTerm::Criteria::HEADER_REGEX)
+    {
+        std::string_view header;
+        if (FAILED(ReadHeader(pDataAttr, aTerm->HeaderLen, header)))
             return SearchTerm::Criteria::NONE;
-        }
+
+        // Match the header here
+        if (aTerm->HeaderRegEx.Match(header.data(), header.data() + header.size()))
+            return SearchTerm::Criteria::HEADER_REGEX;
     }
     return SearchTerm::Criteria::NONE;
 }
@@ -3325,44 +3789,165 @@ FileFind::RegExHeader(const std::shared_ptr<SearchTerm>& aTerm, const std::share
 FileFind::SearchTerm::Criteria
 FileFind::HexHeader(const std::shared_ptr<SearchTerm>& aTerm, const std::shared_ptr<DataAttribute>& pDataAttr) const
 {
-    HRESULT hr = E_FAIL;
-
     if (aTerm->Required & SearchTerm::Criteria::HEADER_HEX)
     {
-        SearchTerm::Criteria matchedSpec = SearchTerm::Criteria::NONE;
+        std::string_view header;
+        if (FAILED(ReadHeader(pDataAttr, aTerm->HeaderLen, header)))
+            return SearchTerm::Criteria::NONE;
 
-        auto pDataStream = pDataAttr->GetDataStream(m_pVolReader);
-        if (pDataStream == nullptr)
+        // Match the header here
+        if (header.size() < aTerm->HeaderLen)
             return SearchTerm::Criteria::NONE;
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+        if (!memcmp(header.data(), aTerm->Header.GetData(), aTerm->HeaderLen))
+            return SearchTerm::Criteria::HEADER_HEX;
+    }
+    return SearchTerm::Criteria::NONE;
+}
+
+void FileFind::PlanDataCriteria(SearchTerm& term)
+{
+    const auto hashMask = SearchTerm::Criteria::DATA_MD5 | SearchTerm::Criteria::DATA_SHA1
+        | SearchTerm::Criteria::DATA_SHA256 | SearchTerm::Criteria::DATA_BLAKE3 | SearchTerm::Criteria::DATA_HASH_LIST;
+
+    // Ordered by their static cost: headers only read the first bytes, hashes are computed once per attribute for all
+    // the terms while CONTAINS reads the whole data (once per attribute for all the terms, but without early exit)
+    const SearchTerm::Criteria steps[] = {
+        SearchTerm::Criteria::HEADER,
+        SearchTerm::Criteria::HEADER_HEX,
+        SearchTerm::Criteria::HEADER_REGEX,
+        hashMask,
+        SearchTerm::Criteria::CONTAINS};
+
+    term.DataPlan.clear();
+    for (const auto spec : steps)
+    {
+        const auto required = term.Required & spec;
+        if (required != SearchTerm::Criteria::NONE)
         {
-            Log::Critical("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-            return SearchTerm::Criteria::NONE;
+            term.DataPlan.push_back({required});
         }
+    }
 
-        CBinaryBuffer buffer;
-        buffer.SetCount(aTerm->HeaderLen);
-        ULONGLONG ullBytesRead = 0;
-        ULONGLONG ullBytesToRead = aTerm->HeaderLen;
+    term.DataPlanEvaluations = 0LLU;
 
-        if (FAILED(hr = pDataStream->Read(buffer.GetData(), ullBytesToRead, &ullBytesRead)))
-            return SearchTerm::Criteria::NONE;
+    if (!term.DataPlan.empty())
+    {
+        Log::Debug(L"Data criteria plan for '{}': {}", term.GetDescription(), DataPlanDescription(term));
+    }
+}
 
-        // Match the header here
-        if (ullBytesRead < ullBytesToRead)
-            return SearchTerm::Criteria::NONE;
+void FileFind::UpdateDataPlan(SearchTerm& term)
+{
+    // Replanning is only worth it with several steps which were all evaluated enough to trust their statistics
+    constexpr uint64_t kReplanInterval = 4096;
+    constexpr uint64_t kMinEvaluations = 256;
 
-        if (!memcmp(buffer.GetData(), aTerm->Header.GetData(), aTerm->HeaderLen))
-            return matchedSpec |= SearchTerm::Criteria::HEADER_HEX;
+    if (term.DataPlan.size() < 2 || ++term.DataPlanEvaluations % kReplanInterval)
+        return;
 
-        if (FAILED(hr = pDataStream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    if (std::any_of(std::cbegin(term.DataPlan), std::cend(term.DataPlan), [](const auto& step) {
+            return step.Evaluated < kMinEvaluations;
+        }))
+    {
+        return;
+    }
+
+    // Expected cost to reject an attribute: the average time of a step over its rejection rate (smoothed)
+    const auto score = [](const SearchTerm::DataCriteriaStep& step) {
+        const double average = static_cast<double>(step.Time.count()) / step.Evaluated;
+        const double rejection = static_cast<double>(step.Rejected + 1) / (step.Evaluated + 2);
+        return average / rejection;
+    };
+
+    auto plan = term.DataPlan;
+    std::stable_sort(std::begin(plan), std::end(plan), [&score](const auto& lhs, const auto& rhs) {
+        return score(lhs) < score(rhs);
+    });
+
+    if (std::equal(
+            std::cbegin(plan), std::cend(plan), std::cbegin(term.DataPlan), [](const auto& lhs, const auto& rhs) {
+                return lhs.Spec == rhs.Spec;
+            }))
+    {
+        return;
+    }
+
+    std::swap(term.DataPlan, plan);
+    Log::Debug(L"Data criteria plan changed for '{}': {}", term.GetDescription(), DataPlanDescription(term, true));
+}
+
+std::wstring FileFind::DataPlanDescription(const SearchTerm& term, bool bWithStatistics)
+{
+    std::wstring description;
+
+    const auto append = [&description](std::wstring_view name) {
+        if (!description.empty())
+            description.append(L" > ");
+        description.append(name);
+    };
+
+    for (const auto& step : term.DataPlan)
+    {
+        std::wstring_view name;
+        if (step.Spec & SearchTerm::Criteria::HEADER)
+            name = L"header";
+        else if (step.Spec & SearchTerm::Criteria::HEADER_HEX)
+            name = L"header_hex";
+        else if (step.Spec & SearchTerm::Criteria::HEADER_REGEX)
+            name = L"header_regex";
+        else if (step.Spec & SearchTerm::Criteria::CONTAINS)
+            name = L"contains";
+        else
+            name = L"hash";
+
+        if (bWithStatistics && step.Evaluated)
         {
-            Log::Critical(L"Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-            return SearchTerm::Criteria::NONE;
+            append(fmt::format(
+                L"{} (evaluated: {}, rejected: {}, average: {}us)",
+                name,
+                step.Evaluated,
+                step.Rejected,
+                std::chrono::duration_cast<std::chrono::microseconds>(step.Time).count() / step.Evaluated));
+        }
+        else
+        {
+            append(name);
         }
     }
-    return SearchTerm::Criteria::NONE;
+
+    if (term.Required & SearchTerm::Criteria::YARA)
+        append(L"yara");
+
+    return description;
+}
+
+FileFind::SearchTerm::Criteria FileFind::MatchDataCriteria(
+    const std::shared_ptr<SearchTerm>& aTerm,
+    SearchTerm::DataCriteriaStep& step,
+    const std::shared_ptr<DataAttribute>& pDataAttr) const
+{
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    SearchTerm::Criteria aSpec = SearchTerm::Criteria::NONE;
+    if (step.Spec & SearchTerm::Criteria::HEADER)
+        aSpec = MatchHeader(aTerm, pDataAttr);
+    else if (step.Spec & SearchTerm::Criteria::HEADER_HEX)
+        aSpec = HexHeader(aTerm, pDataAttr);
+    else if (step.Spec & SearchTerm::Criteria::HEADER_REGEX)
+        aSpec = RegExHeader(aTerm, pDataAttr);
+    else if (step.Spec & SearchTerm::Criteria::CONTAINS)
+        aSpec = MatchContains(aTerm, pDataAttr);
+    else
+        aSpec = MatchHash(aTerm, pDataAttr);
+
+    step.Time +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start);
+    ++step.Evaluated;
+    if (aSpec == SearchTerm::Criteria::NONE)
+        ++step.Rejected;
+
+    return aSpec;
 }
 
 FileFind::SearchTerm::Criteria FileFind::AddMatchingData(
@@ -3375,6 +3960,9 @@ FileFind::SearchTerm::Criteria FileFind::AddMatchingData(
         static_cast<SearchTerm::Criteria>(aTerm->Required & SearchTerm::DataMask());
     SearchTerm::Criteria retval = SearchTerm::Criteria::NONE;
 
+    if (aTerm->DataPlan.empty())
+        PlanDataCriteria(*aTerm);
+
     const auto& dataAttributes = pElt->GetDataAttributes();
     for (size_t dataAttributeIndex = 0; dataAttributeIndex < dataAttributes.size(); ++dataAttributeIndex)
     {
@@ -3387,75 +3975,131 @@ FileFind::SearchTerm::Criteria FileFind::AddMatchingData(
 
         auto matchedDataSpecs = SearchTerm::Criteria::NONE;
         MatchingRuleCollection matchedRules;
+        std::optional<YaraScanPool::JobId> yaraJob;
 
         auto dataStream = data_attr->GetDataStream(m_pVolReader);
         if (dataStream == nullptr)
             continue;
 
-        if (requiredDataSpecs & SearchTerm::Criteria::HEADER)
-        {
-            SearchTerm::Criteria aSpec = MatchHeader(aTerm, data_attr);
-            if (aSpec == SearchTerm::Criteria::NONE)
-                continue;
-            matchedDataSpecs |= aSpec;
-        }
-        if (requiredDataSpecs & SearchTerm::Criteria::HEADER_HEX)
-        {
-            SearchTerm::Criteria aSpec = HexHeader(aTerm, data_attr);
-            if (aSpec == SearchTerm::Criteria::NONE)
-                continue;
-            matchedDataSpecs |= aSpec;
-        }
-        if (requiredDataSpecs & SearchTerm::Criteria::HEADER_REGEX)
-        {
-            SearchTerm::Criteria aSpec = RegExHeader(aTerm, data_attr);
-            if (aSpec == SearchTerm::Criteria::NONE)
-                continue;
-            matchedDataSpecs |= aSpec;
-        }
-        if (requiredDataSpecs & SearchTerm::Criteria::DATA_MD5 || requiredDataSpecs & SearchTerm::Criteria::DATA_SHA1
-            || requiredDataSpecs & SearchTerm::Criteria::DATA_SHA256)
+        bool bAudited = false;
+        if (m_KnownGood)
         {
-            SearchTerm::Criteria aSpec = MatchHash(aTerm, data_attr);
-            if (aSpec == SearchTerm::Criteria::NONE)
+            const auto& knownGood = LookupKnownGood(*pElt, data_attr, *dataStream);
+            if (knownGood.bSkip)
                 continue;
-            matchedDataSpecs |= aSpec;
+            bAudited = knownGood.bAudited;
         }
-        if (requiredDataSpecs & SearchTerm::Criteria::CONTAINS)
+
+        auto step = std::begin(aTerm->DataPlan);
+        for (; step != std::end(aTerm->DataPlan); ++step)
         {
-            SearchTerm::Criteria aSpec = MatchContains(aTerm, data_attr);
+            SearchTerm::Criteria aSpec = MatchDataCriteria(aTerm, *step, data_attr);
             if (aSpec == SearchTerm::Criteria::NONE)
-                continue;
+                break;
             matchedDataSpecs |= aSpec;
         }
+        if (step != std::end(aTerm->DataPlan))
+            continue;
+
         if (requiredDataSpecs & SearchTerm::Criteria::YARA)
         {
-            auto [aSpec, matched] = MatchYara(aTerm, *pElt, dataAttributeIndex);
-            if (matched.has_value())
-                std::swap(matchedRules, matched.value());
-            if (aSpec == SearchTerm::Criteria::NONE)
-                continue;
-            matchedDataSpecs |= aSpec;
+            // Scanned by the pool: the criteria is assumed to match until CompletePendingYaraMatches gets the result
+            if (yaraJob = SubmitYaraScan(*pElt, dataAttributeIndex); yaraJob.has_value())
+            {
+                matchedDataSpecs |= SearchTerm::Criteria::YARA;
+            }
+            else
+            {
+                auto [aSpec, matched] = MatchYara(aTerm, *pElt, dataAttributeIndex);
+                if (matched.has_value())
+                    std::swap(matchedRules, matched.value());
+                if (aSpec == SearchTerm::Criteria::NONE)
+                    continue;
+                matchedDataSpecs |= aSpec;
+            }
         }
         if (matchedDataSpecs == requiredSpec)
         {
+            if (bAudited)
+            {
+                m_KnownGoodStatistics.AuditMatches++;
+                Log::Warn(
+                    L"Known good file (frn: {:#018x}) matched term '{}'",
+                    NtfsFullSegmentNumber(&pElt->GetFileReferenceNumber()),
+                    aTerm->GetDescription());
+            }
+
             if (aFileMatch == nullptr)
-                aFileMatch = std::make_shared<Match>(
-                    m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+                aFileMatch = NewMatch(m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
 
             data_attr->GetHashInformation(m_pVolReader, m_MatchHash);
 
+            const auto attributeCount = aFileMatch->MatchingAttributes.size();
+
             if (m_bProvideStream)
                 aFileMatch->AddAttributeMatch(m_pVolReader, data_attr, std::move(matchedRules));
             else
                 aFileMatch->AddAttributeMatch(data_attr, std::move(matchedRules));
 
+            if (yaraJob.has_value())
+            {
+                const auto& attributes = aFileMatch->MatchingAttributes;
+                auto it = std::find_if(
+                    std::cbegin(attributes), std::cend(attributes), [&data_attr](const Match::AttributeMatch& attr) {
+                        return attr.DataAttr.lock() == data_attr;
+                    });
+
+                if (it != std::cend(attributes))
+                {
+                    m_YaraScansOfMatch.push_back(
+                        {static_cast<size_t>(std::distance(std::cbegin(attributes), it)),
+                         *yaraJob,
+                         attributes.size() > attributeCount});
+                }
+            }
+            else
+            {
+                m_bMatchWithoutYaraScan = true;
+            }
+
             retval = requiredSpec;
         }
     }
     return retval;
 }
 
+const FileFind::KnownGoodCacheEntry& FileFind::LookupKnownGood(
+    MFTRecord& record,
+    const std::shared_ptr<DataAttribute>& dataAttr,
+    ByteStream& dataStream) const
+{
+    if (m_KnownGoodCache.DataAttr == dataAttr)
+        return m_KnownGoodCache;
+
+    m_KnownGoodCache = {dataAttr, false, false};
+
+    const auto pFileName = record.GetDefaultFileName();
+    if (dataAttr->NameLength() != 0 || pFileName == nullptr)
+        return m_KnownGoodCache;
+
+    if (!m_KnownGood->Contains(std::wstring_view(pFileName->FileName, pFileName->FileNameLength), dataStream))
+        return m_KnownGoodCache;
+
+    m_ullKnownGoodSeen++;
+    if (m_dwKnownGoodAuditRate && m_ullKnownGoodSeen % m_dwKnownGoodAuditRate == 0)
+    {
+        m_KnownGoodStatistics.Audited++;
+        m_KnownGoodCache.bAudited = true;
+    }
+    else
+    {
+        m_KnownGoodStatistics.Skipped++;
+        m_KnownGoodCache.bSkip = true;
+    }
+
+    return m_KnownGoodCache;
+}
+
 FileFind::SearchTerm::Criteria FileFind::ExcludeMatchingData(
     const std::shared_ptr<SearchTerm>& aTerm,
     SearchTerm::Criteria requiredSpec,
@@ -3463,6 +4107,9 @@ FileFind::SearchTerm::Criteria FileFind::ExcludeMatchingData(
 {
     SearchTerm::Criteria requiredDataSpecs = aTerm->Required & SearchTerm::DataMask();
 
+    if (aTerm->DataPlan.empty())
+        PlanDataCriteria(*aTerm);
+
     auto found = std::find_if(
         begin(aFileMatch->MatchingAttributes),
         end(aFileMatch->MatchingAttributes),
@@ -3476,39 +4123,9 @@ FileFind::SearchTerm::Criteria FileFind::ExcludeMatchingData(
             if (!data_attr)
                 return false;
 
-            if (requiredDataSpecs & SearchTerm::Criteria::HEADER)
-            {
-                SearchTerm::Criteria aSpec = MatchHeader(aTerm, data_attr);
-                if (aSpec == SearchTerm::Criteria::NONE)
-                    return false;
-                matchedDataSpecs |= aSpec;
-            }
-            if (requiredDataSpecs & SearchTerm::Criteria::HEADER_HEX)
-            {
-                SearchTerm::Criteria aSpec = HexHeader(aTerm, data_attr);
-                if (aSpec == SearchTerm::Criteria::NONE)
-                    return false;
-                matchedDataSpecs |= aSpec;
-            }
-            if (requiredDataSpecs & SearchTerm::Criteria::HEADER_REGEX)
-            {
-                SearchTerm::Criteria aSpec = RegExHeader(aTerm, data_attr);
-                if (aSpec == SearchTerm::Criteria::NONE)
-                    return false;
-                matchedDataSpecs |= aSpec;
-            }
-            if (requiredDataSpecs & SearchTerm::Criteria::DATA_MD5
-                || requiredDataSpecs & SearchTerm::Criteria::DATA_SHA1
-                || requiredDataSpecs & SearchTerm::Criteria::DATA_SHA256)
-            {
-                SearchTerm::Criteria aSpec = MatchHash(aTerm, data_attr);
-                if (aSpec == SearchTerm::Criteria::NONE)
-                    return false;
-                matchedDataSpecs |= aSpec;
-            }
-            if (requiredDataSpecs & SearchTerm::Criteria::CONTAINS)
+            for (auto& step : aTerm->DataPlan)
             {
-                SearchTerm::Criteria aSpec = MatchContains(aTerm, data_attr);
+                SearchTerm::Criteria aSpec = MatchDataCriteria(aTerm, step, data_attr);
                 if (aSpec == SearchTerm::Criteria::NONE)
                     return false;
                 matchedDataSpecs |= aSpec;
@@ -3558,12 +4175,33 @@ FileFind::Match::AttributeMatch::AttributeMatch(const std::shared_ptr<MftRecordA
         MD5 = pAttr->GetDetails()->MD5();
         SHA1 = pAttr->GetDetails()->SHA1();
         SHA256 = pAttr->GetDetails()->SHA256();
+        BLAKE3 = pAttr->GetDetails()->BLAKE3();
     }
     DataAttr = std::dynamic_pointer_cast<DataAttribute>(pAttr);
     DataStream = pAttr->GetDetails()->GetDataStream();
     RawStream = pAttr->GetDetails()->GetRawStream();
 }
 
+std::optional<ULONGLONG>
+FileFind::Match::AttributeMatch::GetFirstDiskOffset(const std::shared_ptr<VolumeReader>& volReader) const
+{
+    auto dataAttr = DataAttr.lock();
+    if (dataAttr == nullptr || !dataAttr->IsNonResident())
+        return std::nullopt;
+
+    const auto pNonResidentInfo = dataAttr->GetNonResidentInformation(volReader);
+    if (pNonResidentInfo == nullptr)
+        return std::nullopt;
+
+    for (const auto& extent : pNonResidentInfo->ExtentsVector)
+    {
+        if (!extent.bZero)
+            return extent.DiskOffset;
+    }
+
+    return std::nullopt;
+}
+
 FileFind::SearchTerm::Criteria FileFind::LookupTermInRecordAddMatching(
     const std::shared_ptr<SearchTerm>& aTerm,
     const SearchTerm::Criteria matched,
@@ -3572,9 +4210,17 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermInRecordAddMatching(
 {
     auto profiler = aTerm->GetScopedMatchProfiler();
 
+    Trace::Activity activity;
+    if (Trace::IsEnabled(Trace::FileFind))
+        activity = Trace::FileFindTermStart(pElt->GetSafeMFTSegmentNumber(), aTerm->GetDescription());
+    auto activityGuard = Guard::CreateScopeGuard([&activity]() { Trace::FileFindTermStop(activity); });
+
     const SearchTerm::Criteria requiredSpecs = aTerm->Required;
     SearchTerm::Criteria matchedSpecs = matched;
 
+    m_YaraScansOfMatch.clear();
+    m_bMatchWithoutYaraScan = false;
+
     if (aTerm->DependsOnName())
     {
         SearchTerm::Criteria requiredNameSpecs =
@@ -3642,6 +4288,8 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermInRecordAddMatching(
         uint64_t finalReadLength = ::SumStreamsReadLength(*pElt, m_pVolReader);
         profiler.AddReadLength(finalReadLength - initialReadLength);
 
+        UpdateDataPlan(*aTerm);
+
         if (requiredDataSpecs == matchedDataSpecs)
             matchedSpecs |= matchedDataSpecs;
         else
@@ -3652,8 +4300,7 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermInRecordAddMatching(
     {
         // We do have a positive match. Fill in the blanks
         if (aFileMatch == nullptr)
-            aFileMatch =
-                std::make_shared<Match>(m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
+            aFileMatch = NewMatch(m_pVolReader, aTerm, pElt->GetFileReferenceNumber(), !pElt->IsRecordInUse());
 
         aFileMatch->Term = aTerm;
         aFileMatch->DeletedRecord = !pElt->IsRecordInUse();
@@ -3764,7 +4411,7 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermIn$I30AddMatching(
     {
         // We do have a positive match. Fill in the blanks
         if (aFileMatch == nullptr)
-            aFileMatch = std::make_shared<Match>(m_pVolReader, aTerm);
+            aFileMatch = NewMatch(m_pVolReader, aTerm);
 
         aFileMatch->Term = aTerm;
 
@@ -3787,6 +4434,56 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermIn$I30AddMatching(
     return SearchTerm::Criteria::NONE;
 }
 
+FileFind::SearchTerm::Criteria FileFind::LookupTermInNamesAddMatching(
+    const std::shared_ptr<SearchTerm>& aTerm,
+    const SearchTerm::Criteria matched,
+    std::shared_ptr<Match>& aFileMatch,
+    const MFTWalker::NameScanRecord& record) const
+{
+    auto profiler = aTerm->GetScopedMatchProfiler();
+
+    SearchTerm::Criteria matchedSpecs = matched;
+
+    m_YaraScansOfMatch.clear();
+    m_bMatchWithoutYaraScan = false;
+
+    if (aTerm->DependsOnName())
+    {
+        SearchTerm::Criteria requiredNameSpecs =
+            static_cast<SearchTerm::Criteria>(aTerm->Required & SearchTerm::NameMask());
+        SearchTerm::Criteria matchedNameSpecs = AddMatchingName(
+            aTerm, requiredNameSpecs, aFileMatch, record.FileNames, record.FileReferenceNumber, !record.bInUse);
+        if (requiredNameSpecs == matchedNameSpecs)
+            matchedSpecs |= matchedNameSpecs;
+        else
+            return SearchTerm::Criteria::NONE;
+    }
+    if (aTerm->DependsOnPath())
+    {
+        SearchTerm::Criteria requiredPathSpecs =
+            static_cast<SearchTerm::Criteria>(aTerm->Required & SearchTerm::PathMask());
+        SearchTerm::Criteria matchedPathSpecs = AddMatchingPath(
+            aTerm, requiredPathSpecs, aFileMatch, record.FileNames, record.FileReferenceNumber, !record.bInUse);
+        if (requiredPathSpecs == matchedPathSpecs)
+            matchedSpecs |= matchedPathSpecs;
+        else
+            return SearchTerm::Criteria::NONE;
+    }
+
+    // Name and path criteria only add matching names: there is no default name nor default data stream to add
+    if (matchedSpecs != aTerm->Required || aFileMatch == nullptr || aFileMatch->MatchingNames.empty())
+        return SearchTerm::Criteria::NONE;
+
+    aFileMatch->Term = aTerm;
+    aFileMatch->DeletedRecord = !record.bInUse;
+
+    if (record.StandardInformation.has_value())
+        aFileMatch->StandardInformation = std::make_unique<STANDARD_INFORMATION>(*record.StandardInformation);
+
+    profiler.AddMatch();
+    return matchedSpecs;
+}
+
 FileFind::SearchTerm::Criteria FileFind::LookupTermInMatchExcludeMatching(
     const std::shared_ptr<SearchTerm>& aTerm,
     const SearchTerm::Criteria matched,
@@ -3853,6 +4550,8 @@ FileFind::SearchTerm::Criteria FileFind::LookupTermInMatchExcludeMatching(
 
         profiler.AddReadLength(finalReadLength - initialReadLength);
 
+        UpdateDataPlan(*aTerm);
+
         if (requiredDataSpecs == matchedDataSpecs)
             matchedSpecs |= matchedDataSpecs;
         else
@@ -3874,6 +4573,10 @@ HRESULT FileFind::ComputeMatchHashes(const std::shared_ptr<Match>& aMatch)
 
     for (auto& attr_match : aMatch->MatchingAttributes)
     {
+        const auto key = GetHashCacheKey(*aMatch, attr_match);
+        if (key)
+            LoadCachedHashes(*key, m_MatchHash, attr_match);
+
         CryptoHashStream::Algorithm needed = CryptoHashStream::Algorithm::Undefined;
         if (HasFlag(m_MatchHash, CryptoHashStream::Algorithm::MD5) && attr_match.MD5.empty())
             needed |= CryptoHashStream::Algorithm::MD5;
@@ -3881,6 +4584,8 @@ HRESULT FileFind::ComputeMatchHashes(const std::shared_ptr<Match>& aMatch)
             needed |= CryptoHashStream::Algorithm::SHA1;
         if (HasFlag(m_MatchHash, CryptoHashStream::Algorithm::SHA256) && attr_match.SHA256.empty())
             needed |= CryptoHashStream::Algorithm::SHA256;
+        if (HasFlag(m_MatchHash, CryptoHashStream::Algorithm::BLAKE3) && attr_match.BLAKE3.empty())
+            needed |= CryptoHashStream::Algorithm::BLAKE3;
 
         if (needed != CryptoHashStream::Algorithm::Undefined)
         {
@@ -3898,8 +4603,11 @@ HRESULT FileFind::ComputeMatchHashes(const std::shared_ptr<Match>& aMatch)
             if (FAILED(hr = hashstream->OpenToWrite(needed, nullptr)))
                 return hr;
 
+            const auto activity = Trace::FileScanStart("Hash", stream->GetSize());
             ULONGLONG ullWritten = 0LL;
-            if (FAILED(hr = stream->CopyTo(*hashstream, &ullWritten)))
+            hr = stream->CopyTo(*hashstream, &ullWritten);
+            Trace::FileScanStop(activity, hr);
+            if (FAILED(hr))
                 return hr;
 
             if (ullWritten > 0)
@@ -3922,23 +4630,105 @@ HRESULT FileFind::ComputeMatchHashes(const std::shared_ptr<Match>& aMatch)
                     if (hr != MK_E_UNAVAILABLE)
                         return hr;
                 }
+                if (HasFlag(needed, CryptoHashStream::Algorithm::BLAKE3)
+                    && FAILED(hr = hashstream->GetHash(CryptoHashStream::Algorithm::BLAKE3, attr_match.BLAKE3)))
+                {
+                    if (hr != MK_E_UNAVAILABLE)
+                        return hr;
+                }
+
+                if (key)
+                    StoreCachedHashes(*key, attr_match);
             }
         }
     }
     return S_OK;
 }
 
-HRESULT FileFind::EvaluateMatchCallCallback(
-    FileFind::FoundMatchCallback aCallback,
-    bool& bStop,
-    const std::shared_ptr<Match>& aMatch)
+std::shared_ptr<FileFind::Match> FileFind::NewMatch(
+    const std::shared_ptr<VolumeReader>& volReader,
+    const std::shared_ptr<SearchTerm>& aTerm,
+    const FILE_REFERENCE& aFRN,
+    bool bDeleted) const
 {
-    HRESULT hr = E_FAIL;
-
-    if (FAILED(hr = ExcludeMatch(aMatch)))
-        return hr;
+    if (m_storeMatches)
+    {
+        MemoryAccounting::Charge(MemoryAccounting::Tag::FileFind, sizeof(Match));
+        return std::shared_ptr<Match>(new Match(volReader, aTerm, aFRN, bDeleted), [](Match* pMatch) {
+            delete pMatch;
+            MemoryAccounting::Release(MemoryAccounting::Tag::FileFind, sizeof(Match));
+        });
+    }
 
-    if (hr == S_OK)
+    std::unique_ptr<Match> match;
+    {
+        std::lock_guard<std::mutex> lock(m_MatchPool->Lock);
+        if (!m_MatchPool->Free.empty())
+        {
+            match = std::move(m_MatchPool->Free.back());
+            m_MatchPool->Free.pop_back();
+        }
+    }
+
+    if (match)
+    {
+        match->VolumeReader = volReader;
+        match->Term = aTerm;
+        match->FRN = aFRN;
+        match->DeletedRecord = bDeleted;
+    }
+    else
+    {
+        match = std::make_unique<Match>(volReader, aTerm, aFRN, bDeleted);
+        MemoryAccounting::Charge(MemoryAccounting::Tag::FileFind, sizeof(Match));
+    }
+
+    // Callbacks may keep the match (i.e. GetThis until the sample is written), it returns to the pool once released
+    // unless file find is over its memory soft limit
+    return std::shared_ptr<Match>(match.release(), [pool = std::weak_ptr<MatchPool>(m_MatchPool)](Match* pMatch) {
+        constexpr size_t kMaxPooledMatches = 256;
+
+        std::unique_ptr<Match> match(pMatch);
+        if (auto matchPool = pool.lock())
+        {
+            match->Reset();
+            match->VolumeReader.reset();
+
+            std::lock_guard<std::mutex> lock(matchPool->Lock);
+            if (matchPool->Free.size() < kMaxPooledMatches
+                && !MemoryAccounting::IsOverSoftLimit(MemoryAccounting::Tag::FileFind))
+            {
+                matchPool->Free.push_back(std::move(match));
+                return;
+            }
+        }
+
+        match.reset();
+        MemoryAccounting::Release(MemoryAccounting::Tag::FileFind, sizeof(Match));
+    });
+}
+
+std::shared_ptr<FileFind::Match>
+FileFind::NewMatch(const std::shared_ptr<VolumeReader>& volReader, const std::shared_ptr<SearchTerm>& aTerm) const
+{
+    FILE_REFERENCE frn;
+    frn.SequenceNumber = 0;
+    frn.SegmentNumberHighPart = 0;
+    frn.SegmentNumberLowPart = 0L;
+    return NewMatch(volReader, aTerm, frn, false);
+}
+
+HRESULT FileFind::EvaluateMatchCallCallback(
+    FileFind::FoundMatchCallback aCallback,
+    bool& bStop,
+    const std::shared_ptr<Match>& aMatch)
+{
+    HRESULT hr = E_FAIL;
+
+    if (FAILED(hr = ExcludeMatch(aMatch)))
+        return hr;
+
+    if (hr == S_OK)
     {
         Log::Debug("Match has been excluded");
         return S_OK;
@@ -3977,11 +4767,291 @@ HRESULT FileFind::EvaluateMatchCallCallback(
     return S_OK;
 }
 
+HRESULT FileFind::EvaluateOrDeferMatch(
+    FileFind::FoundMatchCallback aCallback,
+    bool& bStop,
+    const std::shared_ptr<Match>& aMatch)
+{
+    if (m_YaraScansOfMatch.empty())
+    {
+        return EvaluateMatchCallCallback(aCallback, bStop, aMatch);
+    }
+
+    m_PendingYaraMatches.push_back({aMatch, std::move(m_YaraScansOfMatch), m_bMatchWithoutYaraScan, aCallback});
+    m_YaraScansOfMatch.clear();
+    return S_OK;
+}
+
+HRESULT FileFind::CompletePendingYaraMatches(bool& bStop, bool bWait)
+{
+    if (!m_YaraPool)
+    {
+        return S_OK;
+    }
+
+    for (auto& result : m_YaraPool->Collect(bWait))
+    {
+        const auto id = result.Id;
+        m_YaraResults.emplace(id, std::move(result));
+    }
+
+    HRESULT hr = S_OK;
+
+    for (auto it = std::begin(m_PendingYaraMatches); it != std::end(m_PendingYaraMatches);)
+    {
+        auto& pending = *it;
+
+        const bool bReady = std::all_of(
+            std::cbegin(pending.Scans), std::cend(pending.Scans), [this](const PendingYaraScan& scan) {
+                return m_YaraResults.find(scan.Id) != std::cend(m_YaraResults);
+            });
+
+        if (!bReady)
+        {
+            ++it;
+            continue;
+        }
+
+        auto& match = *pending.FileMatch;
+        std::vector<bool> removed(match.MatchingAttributes.size(), false);
+        bool bMatched = pending.Matched;
+
+        for (const auto& scan : pending.Scans)
+        {
+            const auto& result = m_YaraResults[scan.Id];
+            auto& attribute = match.MatchingAttributes[scan.AttributeIndex];
+
+            bool bScanMatched = false;
+            if (FAILED(result.hr))
+            {
+                Log::Critical(
+                    L"Failed Yara on '{}' (frn: {:#x}) [{}]",
+                    match.MatchingNames.front().FullPathName,
+                    NtfsFullSegmentNumber(&match.FRN),
+                    SystemError(result.hr));
+            }
+            else if (!result.MatchingRules.empty())
+            {
+                if (match.Term->YaraRules.empty())
+                {
+                    Log::Critical("Unexpected empty Yara rule in aTerm");
+                    bScanMatched = true;
+                }
+                else if (::HasMatchingTermYaraRule(*match.Term, result.MatchingRules))
+                {
+                    // Legacy: return all matching rules as one of requested is matching
+                    bScanMatched = true;
+                    if (attribute.YaraRules.has_value())
+                        attribute.YaraRules->insert(
+                            std::end(*attribute.YaraRules),
+                            std::cbegin(result.MatchingRules),
+                            std::cend(result.MatchingRules));
+                    else
+                        attribute.YaraRules = result.MatchingRules;
+                }
+            }
+
+            bMatched |= bScanMatched;
+            if (!bScanMatched && scan.Added)
+            {
+                removed[scan.AttributeIndex] = true;
+            }
+        }
+
+        if (bMatched && !bStop)
+        {
+            for (size_t i = removed.size(); i > 0; --i)
+            {
+                if (removed[i - 1])
+                {
+                    match.MatchingAttributes.erase(std::begin(match.MatchingAttributes) + (i - 1));
+                }
+            }
+
+            if (FAILED(hr = EvaluateMatchCallCallback(pending.Callback, bStop, pending.FileMatch)))
+            {
+                Log::Error(L"Failed to evaluate match '{}' [{}]", match.GetMatchDescription(), SystemError(hr));
+            }
+        }
+
+        it = m_PendingYaraMatches.erase(it);
+    }
+
+    // Results are only kept for the pending matches: jobs are numbered in submission order so older ones are useless
+    YaraScanPool::JobId oldest = std::numeric_limits<YaraScanPool::JobId>::max();
+    for (const auto& pending : m_PendingYaraMatches)
+    {
+        for (const auto& scan : pending.Scans)
+        {
+            oldest = std::min(oldest, scan.Id);
+        }
+    }
+
+    m_YaraResults.erase(std::begin(m_YaraResults), m_YaraResults.lower_bound(oldest));
+    return hr;
+}
+
+void FileFind::CompileNameTerms()
+{
+    m_NameMatcher.Clear();
+    m_NameIsCompiled.assign(m_Terms.size(), false);
+    m_NameIsMatched.assign(m_Terms.size(), false);
+    m_NameMatches.clear();
+
+    for (size_t i = 0; i < m_Terms.size(); i++)
+    {
+        // Only terms whose name criteria is a single wildcard spec can be pre-filtered, regex terms are not compiled
+        if ((m_Terms[i]->Required & SearchTerm::NameMask()) != SearchTerm::Criteria::NAME_MATCH)
+            continue;
+
+        m_NameIsCompiled[i] = m_NameMatcher.Add(m_Terms[i]->FileName, i);
+    }
+
+    m_NameMatcher.Compile();
+
+    if (!m_NameMatcher.empty())
+        Log::Debug(L"Compiled {} wildcard name terms (out of {} terms)", m_NameMatcher.size(), m_Terms.size());
+}
+
+void FileFind::CompileContentTerms()
+{
+    m_ContentMatcher.Clear();
+    m_cbHeaderLength = 0LL;
+
+    const auto addTerm = [this](const std::shared_ptr<SearchTerm>& term) {
+        if (term->Required
+            & (SearchTerm::Criteria::HEADER | SearchTerm::Criteria::HEADER_HEX | SearchTerm::Criteria::HEADER_REGEX))
+            m_cbHeaderLength = std::max<ULONGLONG>(m_cbHeaderLength, term->HeaderLen);
+
+        term->ContainsPattern.reset();
+        if (term->Required & SearchTerm::Criteria::CONTAINS)
+            term->ContainsPattern = m_ContentMatcher.Add(
+                std::string_view(reinterpret_cast<const char*>(term->Contains.GetData()), term->Contains.GetCount()));
+    };
+
+    for (const auto& term : m_AllTerms)
+        addTerm(term);
+
+    for (const auto& [name, term] : m_ExcludeNameTerms)
+        addTerm(term);
+    for (const auto& [path, term] : m_ExcludePathTerms)
+        addTerm(term);
+    for (const auto& [size, term] : m_ExcludeSizeTerms)
+        addTerm(term);
+    for (const auto& term : m_ExcludeTerms)
+        addTerm(term);
+
+    m_ContentMatcher.Compile();
+
+    if (!m_ContentMatcher.empty())
+        Log::Debug(
+            L"Compiled {} content strings, headers are read on {} bytes", m_ContentMatcher.size(), m_cbHeaderLength);
+}
+
+void FileFind::ResetCompiledNames()
+{
+    for (const auto index : m_NameMatches)
+        m_NameIsMatched[index] = false;
+    m_NameMatches.clear();
+}
+
+void FileFind::MatchCompiledNames(const PFILE_NAME pFileName)
+{
+    const auto first = m_NameMatches.size();
+    m_NameMatcher.Match(std::wstring_view(pFileName->FileName, pFileName->FileNameLength), m_NameMatches);
+
+    for (auto i = first; i < m_NameMatches.size(); i++)
+        m_NameIsMatched[m_NameMatches[i]] = true;
+}
+
+void FileFind::SizeFilter::Compile(const std::vector<std::shared_ptr<SearchTerm>>& terms)
+{
+    Index.Clear();
+    IsIndexed.assign(terms.size(), false);
+    IsMatched.assign(terms.size(), false);
+    Matches.clear();
+
+    for (size_t i = 0; i < terms.size(); i++)
+    {
+        const auto& term = *terms[i];
+        if (!(term.Required
+              & (SearchTerm::Criteria::SIZE_EQ | SearchTerm::Criteria::SIZE_GT | SearchTerm::Criteria::SIZE_GE
+                 | SearchTerm::Criteria::SIZE_LT | SearchTerm::Criteria::SIZE_LE)))
+            continue;
+
+        // Same bounds as SizeMatch, a term whose range is empty is indexed without range: it never matches
+        auto ullLow = std::numeric_limits<ULONGLONG>::min();
+        auto ullHigh = std::numeric_limits<ULONGLONG>::max();
+        bool bEmpty = false;
+        if (term.Required & SearchTerm::Criteria::SIZE_EQ)
+        {
+            ullLow = ullHigh = term.SizeEQ;
+        }
+        else
+        {
+            if (term.Required & SearchTerm::Criteria::SIZE_GT)
+            {
+                if (term.SizeG == std::numeric_limits<ULONGLONG>::max())
+                    bEmpty = true;
+                else
+                    ullLow = term.SizeG + 1;
+            }
+            else if (term.Required & SearchTerm::Criteria::SIZE_GE)
+                ullLow = term.SizeG;
+
+            if (term.Required & SearchTerm::Criteria::SIZE_LT)
+            {
+                if (term.SizeL == 0LL)
+                    bEmpty = true;
+                else
+                    ullHigh = term.SizeL - 1;
+            }
+            else if (term.Required & SearchTerm::Criteria::SIZE_LE)
+                ullHigh = term.SizeL;
+        }
+
+        IsIndexed[i] = true;
+        if (!bEmpty)
+            Index.Add(ullLow, ullHigh, i);
+    }
+
+    Index.Compile();
+
+    bEnabled = std::find(std::cbegin(IsIndexed), std::cend(IsIndexed), true) != std::cend(IsIndexed);
+}
+
+void FileFind::SizeFilter::Reset()
+{
+    for (const auto index : Matches)
+        IsMatched[index] = false;
+    Matches.clear();
+}
+
+void FileFind::SizeFilter::Match(ULONGLONG ullSize)
+{
+    const auto first = Matches.size();
+    Index.Match(ullSize, Matches);
+
+    for (auto i = first; i < Matches.size(); i++)
+        IsMatched[Matches[i]] = true;
+}
+
 HRESULT FileFind::FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCallback aCallback)
 {
     HRESULT hr = E_FAIL;
     shared_ptr<FileFind::Match> retval;
 
+    m_HeaderCache.clear();
+    m_ContentCache.clear();
+
+    if (m_YaraPool)
+    {
+        if (FAILED(hr = CompletePendingYaraMatches(bStop, false)))
+            return hr;
+
+        m_YaraJobsOfRecord.assign(pElt->GetDataAttributes().size(), std::nullopt);
+    }
+
     if (!m_ExactNameTerms.empty() || (!m_ExactPathTerms.empty() && m_FullNameBuilder != nullptr))
     {
         auto& names = pElt->GetFileNames();
@@ -4007,7 +5077,7 @@ HRESULT FileFind::FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCa
                         LookupTermInRecordAddMatching(name_it->second, SearchTerm::Criteria::NAME_EXACT, retval, pElt);
                     if (matched != SearchTerm::Criteria::NONE)
                     {
-                        if (FAILED(hr = EvaluateMatchCallCallback(aCallback, bStop, retval)))
+                        if (FAILED(hr = EvaluateOrDeferMatch(aCallback, bStop, retval)))
                             return hr;
                         retval.reset();
                     }
@@ -4029,7 +5099,7 @@ HRESULT FileFind::FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCa
                         LookupTermInRecordAddMatching(path_it->second, SearchTerm::Criteria::PATH_EXACT, retval, pElt);
                     if (matched != SearchTerm::Criteria::NONE)
                     {
-                        if (FAILED(hr = EvaluateMatchCallCallback(aCallback, bStop, retval)))
+                        if (FAILED(hr = EvaluateOrDeferMatch(aCallback, bStop, retval)))
                             return hr;
 
                         retval.reset();
@@ -4062,7 +5132,7 @@ HRESULT FileFind::FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCa
                     LookupTermInRecordAddMatching(attr_it->second, SearchTerm::Criteria::SIZE_EQ, retval, pElt);
                 if (matched != SearchTerm::Criteria::NONE)
                 {
-                    if (FAILED(hr = EvaluateMatchCallCallback(aCallback, bStop, retval)))
+                    if (FAILED(hr = EvaluateOrDeferMatch(aCallback, bStop, retval)))
                         return hr;
                     retval.reset();
                 }
@@ -4074,12 +5144,38 @@ HRESULT FileFind::FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCa
         }
     }
 
-    for (auto term_it : m_Terms)
+    ResetCompiledNames();
+    if (!m_NameMatcher.empty())
+    {
+        for (const auto& name : pElt->GetFileNames())
+            MatchCompiledNames(name);
+    }
+
+    m_TermSizes.Reset();
+    if (m_TermSizes.bEnabled)
+    {
+        for (const auto& data_attr : pElt->GetDataAttributes())
+        {
+            ULONGLONG ullDataSize = 0LL;
+            if (data_attr != nullptr && SUCCEEDED(data_attr->DataSize(m_pVolReader, ullDataSize)))
+                m_TermSizes.Match(ullDataSize);
+        }
+    }
+
+    for (size_t i = 0; i < m_Terms.size(); i++)
     {
-        auto matched = LookupTermInRecordAddMatching(term_it, SearchTerm::Criteria::NONE, retval, pElt);
+        // None of the names matched the term's compiled wildcard spec: it cannot match
+        if (m_NameIsCompiled[i] && !m_NameIsMatched[i])
+            continue;
+
+        // None of the data attributes has a size within the term's range
+        if (m_TermSizes.Rejects(i))
+            continue;
+
+        auto matched = LookupTermInRecordAddMatching(m_Terms[i], SearchTerm::Criteria::NONE, retval, pElt);
         if (matched != SearchTerm::Criteria::NONE)
         {
-            if (FAILED(hr = EvaluateMatchCallCallback(aCallback, bStop, retval)))
+            if (FAILED(hr = EvaluateOrDeferMatch(aCallback, bStop, retval)))
                 return hr;
             retval.reset();
         }
@@ -4140,9 +5236,16 @@ HRESULT FileFind::FindI30Match(const PFILE_NAME pFileName, bool& bStop, FileFind
                 retval->Reset();
         }
     }
-    for (auto term_it = begin(m_Terms); term_it != end(m_Terms); ++term_it)
+    ResetCompiledNames();
+    if (!m_NameMatcher.empty())
+        MatchCompiledNames(pFileName);
+
+    for (size_t i = 0; i < m_Terms.size(); i++)
     {
-        auto matched = LookupTermIn$I30AddMatching(*term_it, SearchTerm::Criteria::NONE, retval, pFileName);
+        if (m_NameIsCompiled[i] && !m_NameIsMatched[i])
+            continue;
+
+        auto matched = LookupTermIn$I30AddMatching(m_Terms[i], SearchTerm::Criteria::NONE, retval, pFileName);
         if (matched != SearchTerm::Criteria::NONE)
         {
             if (FAILED(hr = EvaluateMatchCallCallback(aCallback, bStop, retval)))
@@ -4173,6 +5276,14 @@ CryptoHashStream::Algorithm FileFind::GetNeededHashAlgorithms()
         {
             retval |= CryptoHashStream::Algorithm::SHA256;
         }
+        if (term->Required & SearchTerm::Criteria::DATA_BLAKE3)
+        {
+            retval |= CryptoHashStream::Algorithm::BLAKE3;
+        }
+        if (term->Required & SearchTerm::Criteria::DATA_HASH_LIST && term->Hashes)
+        {
+            retval |= term->Hashes->Algorithms();
+        }
         return retval;
     };
 
@@ -4221,6 +5332,148 @@ CryptoHashStream::Algorithm FileFind::GetNeededHashAlgorithms()
     return needed;
 }
 
+bool FileFind::CanScanNames() const
+{
+    if (!m_bNameScan || !m_SizeTerms.empty() || !m_ExcludeSizeTerms.empty())
+        return false;
+
+    const auto onlyNameOrPath = [](const std::shared_ptr<SearchTerm>& term) { return term->DependsOnlyOnNameOrPath(); };
+    const auto itemOnlyNameOrPath = [&onlyNameOrPath](const auto& item) { return onlyNameOrPath(item.second); };
+
+    if (!std::all_of(std::cbegin(m_AllTerms), std::cend(m_AllTerms), onlyNameOrPath)
+        || !std::all_of(std::cbegin(m_ExcludeTerms), std::cend(m_ExcludeTerms), onlyNameOrPath)
+        || !std::all_of(std::cbegin(m_ExcludeNameTerms), std::cend(m_ExcludeNameTerms), itemOnlyNameOrPath)
+        || !std::all_of(std::cbegin(m_ExcludePathTerms), std::cend(m_ExcludePathTerms), itemOnlyNameOrPath))
+        return false;
+
+    // Records are selected by their names while the MFT is read: path patterns need the full names to be known
+    return std::all_of(std::cbegin(m_Terms), std::cend(m_Terms), [](const std::shared_ptr<SearchTerm>& term) {
+        return term->DependsOnName();
+    });
+}
+
+bool FileFind::CanLookupPaths(ResurrectRecordsMode resurrectRecordsMode) const
+{
+    // Deleted records are not in the indexes, neither is a record reached through its parent directory only skipped
+    // from the walk of a shadow copy
+    if (resurrectRecordsMode != ResurrectRecordsMode::kNo || m_bSkipUnchangedShadowRecords)
+        return false;
+
+    return !m_ExactPathTerms.empty() && m_ExactNameTerms.empty() && m_Terms.empty() && CanScanNames();
+}
+
+bool FileFind::IsNameScanCandidate(const PFILE_NAME pFileName)
+{
+    if (!m_ExactNameTerms.empty() || !m_NameScanPathNames.empty())
+    {
+        m_NameScanBuffer.assign(pFileName->FileName, pFileName->FileNameLength);
+
+        if (m_ExactNameTerms.find(m_NameScanBuffer) != std::cend(m_ExactNameTerms)
+            || m_NameScanPathNames.find(m_NameScanBuffer) != std::cend(m_NameScanPathNames))
+            return true;
+    }
+
+    if (!m_NameMatcher.empty())
+    {
+        ResetCompiledNames();
+        MatchCompiledNames(pFileName);
+
+        if (!m_NameMatches.empty())
+            return true;
+    }
+
+    for (size_t i = 0; i < m_Terms.size(); i++)
+    {
+        if (m_NameIsCompiled[i])
+            continue;
+
+        const auto& term = m_Terms[i];
+        if ((term->Required & SearchTerm::Criteria::NAME_EXACT)
+            && ExactName(term, pFileName) == SearchTerm::Criteria::NONE)
+            continue;
+        if ((term->Required & SearchTerm::Criteria::NAME_MATCH)
+            && MatchName(term, pFileName) == SearchTerm::Criteria::NONE)
+            continue;
+        if ((term->Required & SearchTerm::Criteria::NAME_REGEX)
+            && RegexName(term, pFileName) == SearchTerm::Criteria::NONE)
+            continue;
+
+        return true;
+    }
+
+    return false;
+}
+
+HRESULT FileFind::FindNameScanMatch(
+    const MFTWalker::NameScanRecord& record,
+    bool& bStop,
+    FileFind::FoundMatchCallback aCallback)
+{
+    HRESULT hr = E_FAIL;
+    shared_ptr<FileFind::Match> retval;
+
+    const auto lookupTerm = [this, &record, &retval, &bStop, &aCallback](
+                                const std::shared_ptr<SearchTerm>& term, SearchTerm::Criteria matched) -> HRESULT {
+        if (LookupTermInNamesAddMatching(term, matched, retval, record) != SearchTerm::Criteria::NONE)
+        {
+            HRESULT hr = EvaluateOrDeferMatch(aCallback, bStop, retval);
+            retval.reset();
+            return hr;
+        }
+
+        if (retval != nullptr)
+            retval->Reset();
+        return S_OK;
+    };
+
+    for (const auto pFileName : record.FileNames)
+    {
+        if (!m_InLocationBuilder(pFileName))
+            continue;
+
+        if (!m_ExactNameTerms.empty())
+        {
+            std::wstring strName(pFileName->FileName, pFileName->FileNameLength);
+            auto name_list = m_ExactNameTerms.equal_range(strName);
+
+            for (auto name_it = name_list.first; name_it != name_list.second; ++name_it)
+            {
+                if (FAILED(hr = lookupTerm(name_it->second, SearchTerm::Criteria::NAME_EXACT)))
+                    return hr;
+            }
+        }
+        if (!m_ExactPathTerms.empty() && m_FullNameBuilder != nullptr)
+        {
+            std::wstring strPath(m_FullNameBuilder(pFileName, nullptr));
+            auto path_list = m_ExactPathTerms.equal_range(strPath);
+
+            for (auto path_it = path_list.first; path_it != path_list.second; ++path_it)
+            {
+                if (FAILED(hr = lookupTerm(path_it->second, SearchTerm::Criteria::PATH_EXACT)))
+                    return hr;
+            }
+        }
+    }
+
+    ResetCompiledNames();
+    if (!m_NameMatcher.empty())
+    {
+        for (const auto pFileName : record.FileNames)
+            MatchCompiledNames(pFileName);
+    }
+
+    for (size_t i = 0; i < m_Terms.size(); i++)
+    {
+        if (m_NameIsCompiled[i] && !m_NameIsMatched[i])
+            continue;
+
+        if (FAILED(hr = lookupTerm(m_Terms[i], SearchTerm::Criteria::NONE)))
+            return hr;
+    }
+
+    return S_OK;
+}
+
 HRESULT FileFind::ExcludeMatch(const std::shared_ptr<Match>& aMatch)
 {
     if (!m_ExcludeNameTerms.empty() || !m_ExcludePathTerms.empty())
@@ -4282,9 +5535,22 @@ HRESULT FileFind::ExcludeMatch(const std::shared_ptr<Match>& aMatch)
         }
     }
 
-    for (auto term_it = begin(m_ExcludeTerms); term_it != end(m_ExcludeTerms); ++term_it)
+    m_ExcludeTermSizes.Reset();
+    if (m_ExcludeTermSizes.bEnabled)
     {
-        auto matched = LookupTermInMatchExcludeMatching(*term_it, SearchTerm::Criteria::NONE, aMatch);
+        for (const auto& match_attr : aMatch->MatchingAttributes)
+        {
+            if (match_attr.Type == $DATA)
+                m_ExcludeTermSizes.Match(match_attr.DataSize);
+        }
+    }
+
+    for (size_t i = 0; i < m_ExcludeTerms.size(); i++)
+    {
+        if (m_ExcludeTermSizes.Rejects(i))
+            continue;
+
+        auto matched = LookupTermInMatchExcludeMatching(m_ExcludeTerms[i], SearchTerm::Criteria::NONE, aMatch);
         if (matched != SearchTerm::Criteria::NONE)
         {
             return S_OK;
@@ -4302,18 +5568,10 @@ HRESULT FileFind::Find(
 {
     HRESULT hr = E_FAIL;
 
-    if (m_ExactNameTerms.empty() && m_ExactPathTerms.empty() && m_Terms.empty() && m_SizeTerms.empty()
-        && m_I30ExactNameTerms.empty() && m_I30ExactPathTerms.empty() && m_I30Terms.empty())
+    if (!HasTerms())
         return S_OK;
 
-    const auto& lowest_locs = locations.GetAltitudeLocations();
-    std::vector<std::shared_ptr<Location>> locs;
-
-    // keep only the locations we're parsing
-    std::copy_if(
-        begin(lowest_locs), end(lowest_locs), back_inserter(locs), [](const shared_ptr<Location>& item) -> bool {
-            return item->GetParse();
-        });
+    const auto locs = ::ParsedLocations(locations);
 
     m_NeededHash = GetNeededHashAlgorithms();
 
@@ -4333,6 +5591,135 @@ HRESULT FileFind::Find(
         }
     }
 
+    EndFind();
+
+    if (hasSomeFailure)
+    {
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+HRESULT FileFind::Find(const std::vector<SharedSearch>& searches, ResurrectRecordsMode resurrectRecordsMode)
+{
+    HRESULT hr = E_FAIL;
+
+    std::vector<const SharedSearch*> active;
+    for (const auto& search : searches)
+    {
+        if (!search.Find->HasTerms())
+            continue;
+
+        search.Find->m_NeededHash = search.Find->GetNeededHashAlgorithms();
+
+        if (FAILED(hr = search.Find->InitializeYara()))
+            return hr;
+
+        active.push_back(&search);
+    }
+
+    // Locations of all the searches grouped by walk, in order of first appearance
+    struct LocationWalk
+    {
+        std::shared_ptr<Location> Walked;
+        std::vector<const SharedSearch*> Searches;
+    };
+
+    std::vector<LocationWalk> walks;
+    for (const auto search : active)
+    {
+        for (const auto& location : ::ParsedLocations(*search->Locations))
+        {
+            auto it = std::find_if(std::begin(walks), std::end(walks), [&location](const LocationWalk& walk) {
+                return ::IsSameWalk(*walk.Walked, *location);
+            });
+
+            if (it == std::end(walks))
+            {
+                walks.push_back({location, {search}});
+            }
+            else if (std::find(std::cbegin(it->Searches), std::cend(it->Searches), search) == std::cend(it->Searches))
+            {
+                it->Searches.push_back(search);
+            }
+        }
+    }
+
+    bool hasSomeFailure = false;
+
+    for (const auto& walk : walks)
+    {
+        const auto& location = walk.Walked;
+
+        if (walk.Searches.size() == 1)
+        {
+            const auto& search = *walk.Searches.front();
+
+            hr = search.Find->Find(location, search.Callback, search.bParseI30Data, resurrectRecordsMode);
+            if (FAILED(hr))
+            {
+                Log::Error(L"Failed FileFind::Find on '{}'", location->GetLocation());
+                hasSomeFailure = true;
+            }
+            continue;
+        }
+
+        // Walker settings of the first search apply to the shared walk
+        const auto& first = *walk.Searches.front()->Find;
+
+        SharedMFTWalk shared;
+        shared.Walker().SetPipeline(first.m_dwWalkerWorkers, first.m_bWalkerOutOfOrder);
+        shared.Walker().SetSkipUnchangedShadowRecords(first.m_bSkipUnchangedShadowRecords);
+
+        auto stops = std::make_unique<bool[]>(walk.Searches.size());
+        for (size_t i = 0; i < walk.Searches.size(); ++i)
+        {
+            const auto& search = *walk.Searches[i];
+
+            stops[i] = false;
+            search.Find->BeginWalk(location, shared.Walker());
+            shared.Subscribe(search.Find->WalkCallbacks(search.Callback, search.bParseI30Data, stops[i]));
+        }
+
+        if (FAILED(hr = shared.Initialize(location, resurrectRecordsMode)))
+        {
+            if (hr == HRESULT_FROM_WIN32(ERROR_FILE_SYSTEM_LIMITATION))
+            {
+                Log::Debug(L"File system not eligible for volume '{}' [{}]", location->GetLocation(), SystemError(hr));
+            }
+            else
+            {
+                Log::Critical(L"Failed to init walk for volume '{}' [{}]", location->GetLocation(), SystemError(hr));
+                hasSomeFailure = true;
+            }
+            continue;
+        }
+
+        Log::Debug(L"Walking '{}' once for {} searches", location->GetLocation(), walk.Searches.size());
+
+        if (FAILED(hr = shared.Walk()) && hr != HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+        {
+            Log::Debug(L"Failed to walk volume '{}' [{}]", location->GetLocation(), SystemError(hr));
+            hasSomeFailure = true;
+        }
+        else
+        {
+            Log::Debug("Done");
+            shared.Walker().Statistics(L"Done");
+        }
+
+        for (size_t i = 0; i < walk.Searches.size(); ++i)
+        {
+            walk.Searches[i]->Find->EndWalk(location, stops[i]);
+        }
+    }
+
+    for (const auto search : active)
+    {
+        search->Find->EndFind();
+    }
+
     if (hasSomeFailure)
     {
         return E_FAIL;
@@ -4341,6 +5728,26 @@ HRESULT FileFind::Find(
     return S_OK;
 }
 
+bool FileFind::HasTerms() const
+{
+    return !m_ExactNameTerms.empty() || !m_ExactPathTerms.empty() || !m_Terms.empty() || !m_SizeTerms.empty()
+        || !m_I30ExactNameTerms.empty() || !m_I30ExactPathTerms.empty() || !m_I30Terms.empty();
+}
+
+void FileFind::EndFind()
+{
+    m_HeaderCache.clear();
+    m_ContentCache.clear();
+
+    for (const auto& term : m_AllTerms)
+    {
+        if (term->DataPlan.size() > 1)
+        {
+            Log::Debug(L"Data criteria plan for '{}': {}", term->GetDescription(), DataPlanDescription(*term, true));
+        }
+    }
+}
+
 HRESULT FileFind::Find(
     const std::shared_ptr<Location>& location,
     FileFind::FoundMatchCallback aCallback,
@@ -4349,8 +5756,7 @@ HRESULT FileFind::Find(
 {
     HRESULT hr = E_FAIL;
 
-    if (m_ExactNameTerms.empty() && m_ExactPathTerms.empty() && m_Terms.empty() && m_SizeTerms.empty()
-        && m_I30ExactNameTerms.empty() && m_I30ExactPathTerms.empty() && m_I30Terms.empty())
+    if (!HasTerms())
         return S_OK;
 
     m_NeededHash = GetNeededHashAlgorithms();
@@ -4362,11 +5768,10 @@ HRESULT FileFind::Find(
     }
 
     MFTWalker walk;
+    walk.SetPipeline(m_dwWalkerWorkers, m_bWalkerOutOfOrder);
+    walk.SetSkipUnchangedShadowRecords(m_bSkipUnchangedShadowRecords);
 
-    m_FullNameBuilder = walk.GetFullNameBuilder();
-    m_InLocationBuilder = walk.GetInLocationBuilder();
-
-    m_pVolReader = location->GetReader();
+    BeginWalk(location, walk);
 
     if (FAILED(hr = walk.Initialize(location, resurrectRecordsMode)))
     {
@@ -4382,71 +5787,40 @@ HRESULT FileFind::Find(
     }
     else
     {
-        MFTWalker::Callbacks cbs;
-        auto pCB = aCallback;
-
         bool bStop = false;
 
-        cbs.ElementCallback =
-            [this, aCallback, &bStop, &hr](const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
-                DBG_UNREFERENCED_PARAMETER(volreader);
-                try
-                {
-                    if (pElt)
-                    {
-                        if (FAILED(hr = FindMatch(pElt, bStop, aCallback)))
-                        {
-                            Log::Error(L"FindMatch failed");
-                            pElt->CleanCachedData();
-                            return;
-                        }
-                        pElt->CleanCachedData();
-                    }
-                }
-                catch (WCHAR* e)
-                {
-                    Log::Error(L"Could not parse record: '{}'", e);
-                }
-                return;
-            };
+        bool bLookedUp = false;
+        if (CanLookupPaths(resurrectRecordsMode))
+        {
+            Log::Debug(L"Only exact path criteria, looking up paths of '{}'", location->GetLocation());
 
-        cbs.ProgressCallback = [&bStop](ULONG ulProgress) -> HRESULT {
-            if (bStop)
+            std::vector<std::wstring> paths;
+            for (const auto& [path, term] : m_ExactPathTerms)
+                paths.push_back(path);
+
+            hr = walk.LookupPaths(paths, ScanNamesCallbacks(aCallback, bStop));
+            bLookedUp = SUCCEEDED(hr) || hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+            if (!bLookedUp)
             {
-                return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+                Log::Debug(
+                    L"Failed to look up paths of '{}', reading its MFT [{}]", location->GetLocation(), SystemError(hr));
             }
-            return S_OK;
-        };
+        }
 
-        if (bParseI30Data && (!m_I30ExactNameTerms.empty() || !m_I30ExactPathTerms.empty() || !m_I30Terms.empty()))
-        {
-            cbs.I30Callback = [this, aCallback, &bStop, &hr](
-                                  const std::shared_ptr<VolumeReader>& volreader,
-                                  MFTRecord* pElt,
-                                  const PINDEX_ENTRY pEntry,
-                                  const PFILE_NAME pFileName,
-                                  bool bCarvedEntry) {
-                DBG_UNREFERENCED_PARAMETER(volreader);
-                DBG_UNREFERENCED_PARAMETER(bCarvedEntry);
-                DBG_UNREFERENCED_PARAMETER(pEntry);
-                DBG_UNREFERENCED_PARAMETER(pElt);
-                try
-                {
-                    if (FAILED(hr = FindI30Match(pFileName, bStop, aCallback)))
-                    {
-                        Log::Error(L"FindI30Match failed");
-                        return;
-                    }
-                }
-                catch (WCHAR* e)
-                {
-                    Log::Error(L"Could not parse record: '{}'", e);
-                }
-                return;
-            };
+        if (!bLookedUp)
+        {
+            if (CanScanNames())
+            {
+                Log::Debug(L"Only name and path criteria, scanning names of '{}'", location->GetLocation());
+                hr = walk.ScanNames(ScanNamesCallbacks(aCallback, bStop));
+            }
+            else
+            {
+                hr = walk.Walk(WalkCallbacks(aCallback, bParseI30Data, bStop));
+            }
         }
 
-        if (FAILED(hr = walk.Walk(cbs)) && hr != HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+        if (FAILED(hr) && hr != HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
         {
             Log::Debug(L"Failed to walk volume '{}' [{}]", location->GetLocation(), SystemError(hr));
         }
@@ -4455,6 +5829,164 @@ HRESULT FileFind::Find(
             Log::Debug("Done");
             walk.Statistics(L"Done");
         }
+
+        EndWalk(location, bStop);
+    }
+
+    return hr;
+}
+
+void FileFind::BeginWalk(const std::shared_ptr<Location>& location, MFTWalker& walk)
+{
+    CompileNameTerms();
+    CompileContentTerms();
+
+    m_TermSizes.Compile(m_Terms);
+    m_ExcludeTermSizes.Compile(m_ExcludeTerms);
+    if (m_TermSizes.bEnabled || m_ExcludeTermSizes.bEnabled)
+        Log::Debug(
+            L"Indexed {} size ranges of terms and {} of exclusion terms",
+            m_TermSizes.Index.size(),
+            m_ExcludeTermSizes.Index.size());
+
+    if (m_YaraPool)
+    {
+        const auto dependsOnData = [](const auto& item) { return item.second->DependsOnData(); };
+        if (std::any_of(std::cbegin(m_ExcludeNameTerms), std::cend(m_ExcludeNameTerms), dependsOnData)
+            || std::any_of(std::cbegin(m_ExcludePathTerms), std::cend(m_ExcludePathTerms), dependsOnData)
+            || std::any_of(std::cbegin(m_ExcludeSizeTerms), std::cend(m_ExcludeSizeTerms), dependsOnData)
+            || std::any_of(std::cbegin(m_ExcludeTerms), std::cend(m_ExcludeTerms), [](const auto& term) {
+                   return term->DependsOnData();
+               }))
+        {
+            // Deferred matches are excluded once their record is released: data exclusion criteria cannot be checked
+            Log::Warn("Yara scan pool disabled: some exclusion terms depend on data");
+            m_YaraPool.reset();
+        }
+    }
+
+    m_FullNameBuilder = walk.GetFullNameBuilder();
+    m_InLocationBuilder = walk.GetInLocationBuilder();
+
+    m_pVolReader = location->GetReader();
+
+    if (m_cbBlockCache && m_pVolReader)
+    {
+        HRESULT hr = m_pVolReader->EnableBlockCache(m_cbBlockCache);
+        if (FAILED(hr))
+        {
+            Log::Debug(L"Block cache is not available for '{}' [{}]", location->GetLocation(), SystemError(hr));
+        }
+    }
+}
+
+MFTWalker::Callbacks FileFind::WalkCallbacks(FileFind::FoundMatchCallback aCallback, bool bParseI30Data, bool& bStop)
+{
+    MFTWalker::Callbacks cbs;
+
+    cbs.ElementCallback = [this, aCallback, &bStop](const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
+        DBG_UNREFERENCED_PARAMETER(volreader);
+        try
+        {
+            if (pElt)
+            {
+                if (FAILED(FindMatch(pElt, bStop, aCallback)))
+                {
+                    Log::Error(L"FindMatch failed");
+                    pElt->CleanCachedData();
+                    return;
+                }
+                pElt->CleanCachedData();
+            }
+        }
+        catch (WCHAR* e)
+        {
+            Log::Error(L"Could not parse record: '{}'", e);
+        }
+        return;
+    };
+
+    cbs.ProgressCallback = [&bStop](ULONG ulProgress) -> HRESULT {
+        if (bStop)
+        {
+            return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+        }
+        return S_OK;
+    };
+
+    if (bParseI30Data && (!m_I30ExactNameTerms.empty() || !m_I30ExactPathTerms.empty() || !m_I30Terms.empty()))
+    {
+        cbs.I30Callback = [this, aCallback, &bStop](
+                              const std::shared_ptr<VolumeReader>& volreader,
+                              MFTRecord* pElt,
+                              const PINDEX_ENTRY pEntry,
+                              const PFILE_NAME pFileName,
+                              bool bCarvedEntry) {
+            DBG_UNREFERENCED_PARAMETER(volreader);
+            DBG_UNREFERENCED_PARAMETER(bCarvedEntry);
+            DBG_UNREFERENCED_PARAMETER(pEntry);
+            DBG_UNREFERENCED_PARAMETER(pElt);
+            try
+            {
+                if (FAILED(FindI30Match(pFileName, bStop, aCallback)))
+                {
+                    Log::Error(L"FindI30Match failed");
+                    return;
+                }
+            }
+            catch (WCHAR* e)
+            {
+                Log::Error(L"Could not parse record: '{}'", e);
+            }
+            return;
+        };
+    }
+
+    return cbs;
+}
+
+MFTWalker::NameScanCallbacks FileFind::ScanNamesCallbacks(FileFind::FoundMatchCallback aCallback, bool& bStop)
+{
+    MFTWalker::NameScanCallbacks cbs;
+
+    // Exact paths cannot be built while the MFT is read: their file name selects the records
+    m_NameScanPathNames.clear();
+    for (const auto& [path, term] : m_ExactPathTerms)
+    {
+        const auto pos = path.find_last_of(L'\\');
+        m_NameScanPathNames.insert(pos == std::wstring::npos ? path : path.substr(pos + 1));
+    }
+
+    cbs.NameFilterCallback = [this](const PFILE_NAME pFileName) { return IsNameScanCandidate(pFileName); };
+
+    cbs.NameMatchCallback = [this, aCallback, &bStop](
+                                const std::shared_ptr<VolumeReader>& volreader,
+                                const MFTWalker::NameScanRecord& record) {
+        DBG_UNREFERENCED_PARAMETER(volreader);
+        if (FAILED(FindNameScanMatch(record, bStop, aCallback)))
+        {
+            Log::Error(L"FindNameScanMatch failed");
+        }
+    };
+
+    cbs.ProgressCallback = [&bStop](ULONG ulProgress) -> HRESULT {
+        if (bStop)
+        {
+            return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+        }
+        return S_OK;
+    };
+
+    return cbs;
+}
+
+HRESULT FileFind::EndWalk(const std::shared_ptr<Location>& location, bool& bStop)
+{
+    // Report the matches still waiting for their scans before leaving the location
+    HRESULT hr = CompletePendingYaraMatches(bStop, true);
+    if (FAILED(hr))
+    {
+        Log::Error(L"Failed to complete yara matches for '{}' [{}]", location->GetLocation(), SystemError(hr));
     }
 
     return hr;
@@ -4490,6 +6022,16 @@ const std::vector<FileFind::SearchTerm::Ptr>& FileFind::AllSearchTerms() const
     return m_AllTerms;
 }
 
+std::vector<YaraRuleProfile> FileFind::SlowestYaraRules() const
+{
+    if (!m_YaraScan)
+    {
+        return {};
+    }
+
+    return m_YaraScan->SlowestRules();
+}
+
 FileFind::YaraMatchCache::YaraMatchCache()
     : m_frn({0})
     , m_match()
@@ -10,17 +10,29 @@
 #include "OrcLib.h"
 
 #include "CaseInsensitive.h"
+#include "ContentPatternMatcher.h"
 #include "VolumeReader.h"
 #include "MFTWalker.h"
 #include "MFTRecord.h"
 #include "MftRecordAttribute.h"
 #include "CryptoHashStream.h"
+#include "HashList.h"
+#include "KnownGoodList.h"
 #include "LocationSet.h"
+#include "SizeIntervalIndex.h"
 #include "TableOutput.h"
 #include "YaraScanner.h"
-
+#include "YaraScanPool.h"
+#include "WildcardNameMatcher.h"
+#include "MemoryAccounting.h"
+#include "Utils/Regex.h"
+
+#include <list>
+#include <map>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <iterator>
 #include <regex>
@@ -206,7 +218,9 @@ public:
             ATTR_NAME_MATCH = 1 << 28,
             ATTR_NAME_REGEX = 1 << 29,
             CONTAINS = 1 << 30,
-            YARA = 1 << 31
+            YARA = 1 << 31,
+            DATA_HASH_LIST = 1LL << 32,
+            DATA_BLAKE3 = 1LL << 33
         };
 
         SearchTermProfiling m_profiling;
@@ -247,19 +261,19 @@ public:
         std::wstring Name;  // Generic 'name information'
 
         std::wstring Path;  // Match against a full path (without DOS device name)
-        std::wregex PathRegEx;  // Match against a full path regex (without DOS device name)
+        WRegex PathRegEx;  // Match against a full path regex (without DOS device name)
 
         std::wstring FileName;  // the actual file name
-        std::wregex FileNameRegEx;  // Regular expression to match the file name against
+        WRegex FileNameRegEx;  // Regular expression to match the file name against
 
         std::wstring ADSName;  // the name of the ADS
-        std::wregex ADSNameRegEx;  // Regular expression to match the sub name against
+        WRegex ADSNameRegEx;  // Regular expression to match the sub name against
 
         std::wstring EAName;  // the name of the EA
-        std::wregex EANameRegEx;  // Regular expression to match the sub name against
+        WRegex EANameRegEx;  // Regular expression to match the sub name against
 
         std::wstring AttrName;  // the Attribute Name
-        std::wregex AttrNameRegEx;  // Regular expression to match the attribute name against
+        WRegex AttrNameRegEx;  // Regular expression to match the attribute name against
 
         DWORD dwAttrType = $UNUSED;
 
@@ -270,19 +284,44 @@ public:
         CBinaryBuffer MD5;
         CBinaryBuffer SHA1;
         CBinaryBuffer SHA256;
+        CBinaryBuffer BLAKE3;
+
+        std::wstring HashListSpec;  // Path of the hash list file
+        std::shared_ptr<const HashList> Hashes;
 
         std::wstring strHeaderRegEx;
-        std::regex HeaderRegEx;
+        Regex HeaderRegEx;
         DWORD HeaderLen = 0L;
 
         CBinaryBuffer Header;
 
         CBinaryBuffer Contains;
         bool bContainsIsHex = false;
+        std::optional<size_t> ContainsPattern;  // Identifier of Contains in the content matcher of FileFind
 
         std::wstring YaraRulesSpec;
         std::vector<std::string> YaraRules;
 
+        // Wildcard specs above compiled when the term is added to FileFind
+        WildcardPattern FileNamePattern;
+        WildcardPattern PathPattern;
+        WildcardPattern ADSNamePattern;
+        WildcardPattern EANamePattern;
+        WildcardPattern AttrNamePattern;
+        std::vector<WildcardPattern> YaraRulePatterns;
+
+        // Data criteria but YARA in their evaluation order, planned by FileFind (YARA is always evaluated last)
+        struct DataCriteriaStep
+        {
+            Criteria Spec = Criteria::NONE;  // Hash criteria are evaluated as a single step
+            uint64_t Evaluated = 0LLU;
+            uint64_t Rejected = 0LLU;
+            std::chrono::nanoseconds Time {};
+        };
+
+        std::vector<DataCriteriaStep> DataPlan;
+        uint64_t DataPlanEvaluations = 0LLU;
+
         SearchTerm() {};
 
         SearchTerm(const std::wstring& strName)
@@ -292,6 +331,7 @@ public:
         };
 
         std::pair<bool, std::wstring> IsValidTerm();
+        void CompileWildcards();
 
         SearchTerm(SearchTerm&& other) noexcept = default;
 
@@ -318,7 +358,8 @@ public:
 
         static Criteria DataMask()
         {
-            return HEADER | HEADER_HEX | HEADER_REGEX | DATA_MD5 | DATA_SHA1 | DATA_SHA256 | CONTAINS | YARA;
+            return HEADER | HEADER_HEX | HEADER_REGEX | DATA_MD5 | DATA_SHA1 | DATA_SHA256 | DATA_BLAKE3
+                | DATA_HASH_LIST | CONTAINS | YARA;
         };
         bool DependsOnData() const { return Required & DataMask() ? true : false; };
 
@@ -392,8 +433,11 @@ public:
 
             std::shared_ptr<ByteStream> DataStream;
             std::shared_ptr<ByteStream> RawStream;
-            CBinaryBuffer MD5, SHA1, SHA256;
+            CBinaryBuffer MD5, SHA1, SHA256, BLAKE3;
             std::optional<MatchingRuleCollection> YaraRules;
+
+            // Volume offset of the first allocated extent, std::nullopt for resident data or once the record is freed
+            std::optional<ULONGLONG> GetFirstDiskOffset(const std::shared_ptr<VolumeReader>& volReader) const;
         };
 
         Match(Match&& other) noexcept = default;
@@ -506,6 +550,41 @@ public:
     HRESULT AddExcludeTermsFromConfig(const ConfigItem& items);
     HRESULT AddExcludeTerm(const std::shared_ptr<SearchTerm>& FindSpec);
 
+    // Forwarded to MFTWalker::SetPipeline for each walked location
+    void SetMFTWalkerPipeline(DWORD dwWorkers, bool bOutOfOrder = false)
+    {
+        m_dwWalkerWorkers = dwWorkers;
+        m_bWalkerOutOfOrder = bOutOfOrder;
+    }
+
+    // Size of the block cache enabled on each walked location's reader (0 to disable)
+    void SetBlockCache(size_t cbMaxBytes) { m_cbBlockCache = cbMaxBytes; }
+
+    // Forwarded to MFTWalker::SetSkipUnchangedShadowRecords for each walked location
+    void SetSkipUnchangedShadowRecords(bool bSkip) { m_bSkipUnchangedShadowRecords = bSkip; }
+
+    // When all the terms only have name and path criteria, locations searched alone are read with MFTWalker::ScanNames.
+    // Matches then have no data attribute (no size, hash nor stream) and $I30 entries are not parsed. Terms which are
+    // all exact paths are resolved with MFTWalker::LookupPaths, without reading the whole MFT.
+    void SetNameScan(bool bNameScan) { m_bNameScan = bNameScan; }
+
+    // Unnamed data of the files in the known good list is not matched against the content criteria (header, contains,
+    // hash and yara). One known good file in 'dwAuditRate' (0 for none) is checked anyway: a match is logged.
+    void SetKnownGood(std::shared_ptr<const KnownGoodList> knownGood, DWORD dwAuditRate = 0L)
+    {
+        m_KnownGood = std::move(knownGood);
+        m_dwKnownGoodAuditRate = dwAuditRate;
+    }
+
+    struct KnownGoodStatistics
+    {
+        ULONGLONG Skipped = 0LL;
+        ULONGLONG Audited = 0LL;
+        ULONGLONG AuditMatches = 0LL;  // audited files matching a term: the list should not have them
+    };
+
+    const KnownGoodStatistics& GetKnownGoodStatistics() const { return m_KnownGoodStatistics; }
+
     HRESULT Find(
         const LocationSet& locations,
         FoundMatchCallback aCallback,
@@ -518,10 +597,21 @@ public:
         bool bParseI30Data,
         ResurrectRecordsMode resurrectRecordsMode);
 
-        const std::vector<std::shared_ptr<Match>>& Matches() const
+    struct SharedSearch
     {
-        return m_Matches;
-    }
+        FileFind* Find;
+        const LocationSet* Locations;
+        FoundMatchCallback Callback;
+        bool bParseI30Data;
+    };
+
+    // Run the searches with a single walk for the locations they have in common (same volume and sub directories):
+    // the MFT is read and parsed once for all of them. Walker settings of the first search apply to a shared walk.
+    static HRESULT Find(const std::vector<SharedSearch>& searches, ResurrectRecordsMode resurrectRecordsMode);
+
+    // Empty unless the FileFind was created with 'storeMatches': matches are then only given to the callbacks and are
+    // recycled for the next ones once released, memory usage does not depend on the number of matches
+    const std::vector<std::shared_ptr<Match>>& Matches() const { return m_Matches; }
 
     void PrintSpecs() const;
 
@@ -529,6 +619,9 @@ public:
 
     const std::vector<std::shared_ptr<SearchTerm>>& AllSearchTerms() const;
 
+    // Slowest yara rules when the yara configuration enables their profiling
+    std::vector<YaraRuleProfile> SlowestYaraRules() const;
+
 private:
     using TermMapOfNames = std::unordered_multimap<
         std::wstring,
@@ -554,6 +647,32 @@ private:
 
     std::vector<std::shared_ptr<SearchTerm>> m_AllTerms;
 
+    // Wildcard name specs of m_Terms compiled into a single matcher (identifiers are indexes in m_Terms)
+    WildcardNameMatcher m_NameMatcher;
+    std::vector<bool> m_NameIsCompiled;
+    std::vector<bool> m_NameIsMatched;
+    std::vector<size_t> m_NameMatches;
+
+    // Size ranges of a vector of terms indexed by interval (identifiers are indexes in the vector): terms with a size
+    // criteria but none of whose ranges contains the size of a data attribute are skipped
+    struct SizeFilter
+    {
+        SizeIntervalIndex Index;
+        std::vector<bool> IsIndexed;
+        std::vector<bool> IsMatched;
+        std::vector<size_t> Matches;
+        bool bEnabled = false;
+
+        void Compile(const std::vector<std::shared_ptr<SearchTerm>>& terms);
+        void Reset();
+        void Match(ULONGLONG ullSize);
+
+        bool Rejects(size_t index) const { return IsIndexed[index] && !IsMatched[index]; }
+    };
+
+    SizeFilter m_TermSizes;
+    SizeFilter m_ExcludeTermSizes;
+
     static std::wregex& DOSPattern();
     static std::wregex& RegexPattern();
     static std::wregex& RegexOnlyPattern();
@@ -586,6 +705,57 @@ private:
 
     mutable YaraMatchCache m_yaraMatchCache;
 
+    // Headers read from the data attributes of the current record, shared by the header criteria of all the terms
+    struct HeaderCacheEntry
+    {
+        std::shared_ptr<DataAttribute> DataAttr;
+        ULONGLONG cbRequested;  // Largest length requested: less bytes in Data means the end of the data was reached
+        CBinaryBuffer Data;
+    };
+
+    mutable std::vector<HeaderCacheEntry> m_HeaderCache;
+
+    // Length of the longest header criteria: headers are read once per data attribute at this length
+    ULONGLONG m_cbHeaderLength = 0LL;
+
+    // CONTAINS strings of all the terms, searched in a single pass per data attribute of the current record
+    ContentPatternMatcher m_ContentMatcher;
+
+    struct ContentCacheEntry
+    {
+        std::shared_ptr<DataAttribute> DataAttr;
+        ContentPatternMatcher::Scan Scan;
+    };
+
+    mutable std::vector<ContentCacheEntry> m_ContentCache;
+    mutable CBinaryBuffer m_ContentBuffer;
+
+    // With 'workers' in the yara configuration, data attributes which passed all their other criteria are loaded in
+    // memory and scanned by the pool while the walk goes on. The match waits in m_PendingYaraMatches for the scans of
+    // its attributes, attributes not matching the term's rules are then removed before the callback is called.
+    std::unique_ptr<YaraScanPool> m_YaraPool;
+
+    struct PendingYaraScan
+    {
+        size_t AttributeIndex;  // Index in Match::MatchingAttributes
+        YaraScanPool::JobId Id;
+        bool Added;  // The attribute was added to the match by its data criteria: removed if the scan does not match
+    };
+
+    struct PendingYaraMatch
+    {
+        std::shared_ptr<Match> FileMatch;
+        std::vector<PendingYaraScan> Scans;
+        bool Matched;  // Another attribute matched the data criteria without being scanned by the pool
+        FoundMatchCallback Callback;
+    };
+
+    mutable std::vector<PendingYaraScan> m_YaraScansOfMatch;  // Scans submitted for the match being built
+    mutable bool m_bMatchWithoutYaraScan = false;
+    mutable std::vector<std::optional<YaraScanPool::JobId>> m_YaraJobsOfRecord;  // Indexed like the data attributes
+    std::list<PendingYaraMatch> m_PendingYaraMatches;
+    std::map<YaraScanPool::JobId, YaraScanPool::Result> m_YaraResults;
+
     bool m_bProvideStream = false;
     CryptoHashStream::Algorithm m_MatchHash = CryptoHashStream::Algorithm::Undefined;
 
@@ -593,6 +763,69 @@ private:
 
     bool m_storeMatches;
 
+    // Matches released by the callbacks when they are not stored, reused with their vectors' capacity. Live and
+    // pooled matches are charged to the 'file_find' memory tag (their fixed size only)
+    struct MatchPool
+    {
+        ~MatchPool() { MemoryAccounting::Release(MemoryAccounting::Tag::FileFind, Free.size() * sizeof(Match)); }
+
+        std::mutex Lock;
+        std::vector<std::unique_ptr<Match>> Free;
+    };
+
+    std::shared_ptr<MatchPool> m_MatchPool = std::make_shared<MatchPool>();
+
+    std::shared_ptr<Match> NewMatch(
+        const std::shared_ptr<VolumeReader>& volReader,
+        const std::shared_ptr<SearchTerm>& aTerm,
+        const FILE_REFERENCE& aFRN,
+        bool bDeleted) const;
+    std::shared_ptr<Match>
+    NewMatch(const std::shared_ptr<VolumeReader>& volReader, const std::shared_ptr<SearchTerm>& aTerm) const;
+
+    DWORD m_dwWalkerWorkers = 0L;
+    bool m_bWalkerOutOfOrder = false;
+    size_t m_cbBlockCache = 0;
+    bool m_bSkipUnchangedShadowRecords = false;
+
+    // Name scan: file names of exact path terms, and a buffer for the names looked up while the MFT is read
+    bool m_bNameScan = false;
+    std::unordered_set<std::wstring, CaseInsensitiveUnordered, CaseInsensitiveUnordered> m_NameScanPathNames;
+    std::wstring m_NameScanBuffer;
+
+    // Known good data attribute of the current record, looked up once for all the terms
+    std::shared_ptr<const KnownGoodList> m_KnownGood;
+    DWORD m_dwKnownGoodAuditRate = 0L;
+    mutable ULONGLONG m_ullKnownGoodSeen = 0LL;
+
+    struct KnownGoodCacheEntry
+    {
+        std::shared_ptr<DataAttribute> DataAttr;
+        bool bSkip = false;
+        bool bAudited = false;
+    };
+
+    mutable KnownGoodCacheEntry m_KnownGoodCache;
+    mutable KnownGoodStatistics m_KnownGoodStatistics;
+
+    const KnownGoodCacheEntry& LookupKnownGood(
+        MFTRecord& record,
+        const std::shared_ptr<DataAttribute>& dataAttr,
+        ByteStream& dataStream) const;
+
+    bool HasTerms() const;
+
+    // Steps of the walk of a location, the walker may be shared with other searches
+    void BeginWalk(const std::shared_ptr<Location>& location, MFTWalker& walk);
+    MFTWalker::Callbacks WalkCallbacks(FoundMatchCallback aCallback, bool bParseI30Data, bool& bStop);
+    HRESULT EndWalk(const std::shared_ptr<Location>& location, bool& bStop);
+    void EndFind();
+
+    void CompileNameTerms();
+    void CompileContentTerms();
+    void ResetCompiledNames();
+    void MatchCompiledNames(const PFILE_NAME pFileName);
+
     SearchTerm::Criteria DiscriminateName(const std::wstring& strName);
     SearchTerm::Criteria DiscriminateADS(const std::wstring& strADS);
     SearchTerm::Criteria DiscriminateEA(const std::wstring& strEA);
@@ -617,6 +850,13 @@ private:
         SearchTerm::Criteria required,
         std::shared_ptr<Match>& aFileMatch,
         MFTRecord* pElt) const;
+    SearchTerm::Criteria AddMatchingName(
+        const std::shared_ptr<SearchTerm>& aTerm,
+        SearchTerm::Criteria required,
+        std::shared_ptr<Match>& aFileMatch,
+        const std::vector<PFILE_NAME>& fileNames,
+        const FILE_REFERENCE& frn,
+        bool bDeleted) const;
     SearchTerm::Criteria ExcludeMatchingName(
         const std::shared_ptr<SearchTerm>& aTerm,
         SearchTerm::Criteria required,
@@ -642,6 +882,13 @@ private:
         SearchTerm::Criteria required,
         std::shared_ptr<Match>& aFileMatch,
         MFTRecord* pElt) const;
+    SearchTerm::Criteria AddMatchingPath(
+        const std::shared_ptr<SearchTerm>& aTerm,
+        SearchTerm::Criteria required,
+        std::shared_ptr<Match>& aFileMatch,
+        const std::vector<PFILE_NAME>& fileNames,
+        const FILE_REFERENCE& frn,
+        bool bDeleted) const;
     SearchTerm::Criteria ExcludeMatchingPath(
         const std::shared_ptr<SearchTerm>& aTerm,
         SearchTerm::Criteria required,
@@ -667,6 +914,10 @@ private:
         SearchTerm::Criteria required,
         const std::shared_ptr<Match>& aFileMatch) const;
 
+    HRESULT ReadHeader(const std::shared_ptr<DataAttribute>& pDataAttr, ULONGLONG cbLength, std::string_view& header)
+        const;
+    const ContentPatternMatcher::Scan* SearchContent(const std::shared_ptr<DataAttribute>& pDataAttr) const;
+
     SearchTerm::Criteria
     MatchHeader(const std::shared_ptr<SearchTerm>& aTerm, const std::shared_ptr<DataAttribute>& pDataAttr) const;
     SearchTerm::Criteria
@@ -690,6 +941,17 @@ private:
     Result<MatchingRuleCollection>
     FileFindMatchAllYaraRules(const Orc::MFTRecord& record, size_t dataAttributeIndex) const;
 
+    // Data criteria are first ordered by a static estimate of their cost. Once each step was evaluated enough, they are
+    // ordered by their measured time over their rejection rate so the cheapest and most selective ones run first.
+    static void PlanDataCriteria(SearchTerm& term);
+    static void UpdateDataPlan(SearchTerm& term);
+    static std::wstring DataPlanDescription(const SearchTerm& term, bool bWithStatistics = false);
+
+    SearchTerm::Criteria MatchDataCriteria(
+        const std::shared_ptr<SearchTerm>& aTerm,
+        SearchTerm::DataCriteriaStep& step,
+        const std::shared_ptr<DataAttribute>& pDataAttr) const;
+
     SearchTerm::Criteria AddMatchingData(
         const std::shared_ptr<SearchTerm>& aTerm,
         SearchTerm::Criteria required,
@@ -743,6 +1005,11 @@ private:
         const SearchTerm::Criteria matched,
         std::shared_ptr<Match>& aMatch,
         const PFILE_NAME pFileName) const;  // matches against a $I30 $FILE_NALME
+    SearchTerm::Criteria LookupTermInNamesAddMatching(
+        const std::shared_ptr<SearchTerm>& aTerm,
+        const SearchTerm::Criteria matched,
+        std::shared_ptr<Match>& aMatch,
+        const MFTWalker::NameScanRecord& record) const;  // matches against the names of a name scan
     SearchTerm::Criteria LookupTermInMatchExcludeMatching(
         const std::shared_ptr<SearchTerm>& aTerm,
         const SearchTerm::Criteria matched,
@@ -756,10 +1023,20 @@ private:
 
     HRESULT ExcludeMatch(const std::shared_ptr<Match>& aMatch);
 
+    std::optional<YaraScanPool::JobId> SubmitYaraScan(MFTRecord& record, size_t dataAttributeIndex) const;
+    HRESULT EvaluateOrDeferMatch(FoundMatchCallback aCallback, bool& bStop, const std::shared_ptr<Match>& aMatch);
+    HRESULT CompletePendingYaraMatches(bool& bStop, bool bWait);
+
     HRESULT FindMatch(MFTRecord* pElt, bool& bStop, FileFind::FoundMatchCallback aCallback);
 
     HRESULT FindI30Match(const PFILE_NAME pFileName, bool& bStop, FileFind::FoundMatchCallback aCallback);
 
+    bool CanScanNames() const;
+    bool CanLookupPaths(ResurrectRecordsMode resurrectRecordsMode) const;
+    bool IsNameScanCandidate(const PFILE_NAME pFileName);
+    MFTWalker::NameScanCallbacks ScanNamesCallbacks(FoundMatchCallback aCallback, bool& bStop);
+    HRESULT FindNameScanMatch(const MFTWalker::NameScanRecord& record, bool& bStop, FoundMatchCallback aCallback);
+
     CryptoHashStream::Algorithm GetNeededHashAlgorithms();
 };
 
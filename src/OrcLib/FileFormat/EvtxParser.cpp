@@ -0,0 +1,989 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileFormat/EvtxParser.h"
+
+#include "ByteStream.h"
+#include "TaskPool.h"
+#include "Text/Guid.h"
+
+#include <algorithm>
+#include <string_view>
+#include <unordered_map>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr std::string_view kFileSignature("ElfFile\0", 8);
+constexpr std::string_view kChunkSignature("ElfChnk\0", 8);
+constexpr DWORD kRecordSignature = 0x00002a2a;
+
+constexpr size_t kChunkFreeSpaceOffset = 0x30;
+constexpr size_t kRecordHeaderSize = 24;  // signature, size, record id, written time
+constexpr size_t kTemplateHeaderSize = 24;  // next template offset, guid, data size
+constexpr size_t kNameHeaderSize = 8;  // next name offset, hash, character count
+
+// Nesting of BinXml values (UserData and EventData of classic providers are a template instance in a substitution)
+constexpr ULONG kMaxDepth = 8L;
+
+enum class Token : BYTE
+{
+    EndOfFragment = 0x00,
+    OpenStartElement = 0x01,
+    CloseStartElement = 0x02,
+    CloseEmptyElement = 0x03,
+    EndElement = 0x04,
+    Value = 0x05,
+    Attribute = 0x06,
+    CDataSection = 0x07,
+    CharRef = 0x08,
+    EntityRef = 0x09,
+    PITarget = 0x0A,
+    PIData = 0x0B,
+    TemplateInstance = 0x0C,
+    NormalSubstitution = 0x0D,
+    OptionalSubstitution = 0x0E,
+    FragmentHeader = 0x0F
+};
+
+constexpr BYTE kHasMoreData = 0x40;
+
+enum class ValueType : BYTE
+{
+    Null = 0x00,
+    String = 0x01,
+    AnsiString = 0x02,
+    Int8 = 0x03,
+    UInt8 = 0x04,
+    Int16 = 0x05,
+    UInt16 = 0x06,
+    Int32 = 0x07,
+    UInt32 = 0x08,
+    Int64 = 0x09,
+    UInt64 = 0x0A,
+    Real32 = 0x0B,
+    Real64 = 0x0C,
+    Bool = 0x0D,
+    Binary = 0x0E,
+    Guid = 0x0F,
+    SizeT = 0x10,
+    FileTime = 0x11,
+    SysTime = 0x12,
+    Sid = 0x13,
+    HexInt32 = 0x14,
+    HexInt64 = 0x15,
+    BinXml = 0x21
+};
+
+constexpr BYTE kArrayFlag = 0x80;
+
+// Bounded reads in [offset, end) of a chunk, offsets are relative to the chunk as BinXml ones are
+class Cursor
+{
+public:
+    Cursor(const BYTE* pChunk, size_t cbChunk, size_t offset, size_t end)
+        : m_pChunk(pChunk)
+        , m_offset(offset)
+        , m_end(std::min(end, cbChunk))
+    {
+    }
+
+    size_t Offset() const { return m_offset; }
+    size_t Left() const { return m_offset < m_end ? m_end - m_offset : 0; }
+    const BYTE* Data() const { return m_pChunk + m_offset; }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        if (Left() < sizeof(T))
+            return false;
+
+        memcpy(&value, m_pChunk + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool Peek(BYTE& value) const
+    {
+        if (Left() < 1)
+            return false;
+
+        value = m_pChunk[m_offset];
+        return true;
+    }
+
+    bool Skip(size_t cb)
+    {
+        if (Left() < cb)
+            return false;
+
+        m_offset += cb;
+        return true;
+    }
+
+private:
+    const BYTE* m_pChunk;
+    size_t m_offset;
+    size_t m_end;
+};
+
+struct Value
+{
+    BYTE Type;
+    const BYTE* pData;
+    size_t cbData;
+};
+
+// Template definitions are parsed once per chunk into the nodes applied to each record instantiating them
+struct Node
+{
+    enum class Kind : BYTE
+    {
+        Open,
+        Close,
+        EndOfAttributes,
+        Attribute,
+        Text,
+        Substitution
+    };
+
+    Kind NodeKind;
+    WORD wIndex = 0;
+    std::wstring strText;  // element or attribute name, static text
+};
+
+using Nodes = std::vector<Node>;
+
+template <typename T>
+T Load(const BYTE* pData)
+{
+    T value;
+    memcpy(&value, pData, sizeof(T));
+    return value;
+}
+
+size_t ValueSize(ValueType type)
+{
+    switch (type)
+    {
+        case ValueType::Int8:
+        case ValueType::UInt8:
+            return 1;
+        case ValueType::Int16:
+        case ValueType::UInt16:
+            return 2;
+        case ValueType::Int32:
+        case ValueType::UInt32:
+        case ValueType::Real32:
+        case ValueType::Bool:
+        case ValueType::HexInt32:
+            return 4;
+        case ValueType::Int64:
+        case ValueType::UInt64:
+        case ValueType::Real64:
+        case ValueType::FileTime:
+        case ValueType::HexInt64:
+            return 8;
+        case ValueType::Guid:
+        case ValueType::SysTime:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+void RenderTime(const SYSTEMTIME& st, std::wstring& out)
+{
+    fmt::format_to(
+        std::back_inserter(out),
+        L"{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:03}",
+        st.wYear,
+        st.wMonth,
+        st.wDay,
+        st.wHour,
+        st.wMinute,
+        st.wSecond,
+        st.wMilliseconds);
+}
+
+void RenderSid(const BYTE* pData, size_t cbData, std::wstring& out)
+{
+    if (cbData < 8)
+        return;
+
+    const BYTE subAuthorityCount = pData[1];
+    if (cbData < 8 + subAuthorityCount * sizeof(DWORD))
+        return;
+
+    ULONGLONG ullAuthority = 0LL;
+    for (size_t i = 2; i < 8; i++)
+        ullAuthority = (ullAuthority << 8) | pData[i];
+
+    fmt::format_to(std::back_inserter(out), L"S-{}-{}", pData[0], ullAuthority);
+    for (BYTE i = 0; i < subAuthorityCount; i++)
+        fmt::format_to(std::back_inserter(out), L"-{}", Load<DWORD>(pData + 8 + i * sizeof(DWORD)));
+}
+
+// Render a single value of a fixed size 'type'
+void RenderScalar(ValueType type, const BYTE* pData, std::wstring& out)
+{
+    auto it = std::back_inserter(out);
+
+    switch (type)
+    {
+        case ValueType::Int8:
+            fmt::format_to(it, L"{}", Load<INT8>(pData));
+            break;
+        case ValueType::UInt8:
+            fmt::format_to(it, L"{}", Load<UINT8>(pData));
+            break;
+        case ValueType::Int16:
+            fmt::format_to(it, L"{}", Load<INT16>(pData));
+            break;
+        case ValueType::UInt16:
+            fmt::format_to(it, L"{}", Load<UINT16>(pData));
+            break;
+        case ValueType::Int32:
+            fmt::format_to(it, L"{}", Load<INT32>(pData));
+            break;
+        case ValueType::UInt32:
+            fmt::format_to(it, L"{}", Load<UINT32>(pData));
+            break;
+        case ValueType::Int64:
+            fmt::format_to(it, L"{}", Load<INT64>(pData));
+            break;
+        case ValueType::UInt64:
+            fmt::format_to(it, L"{}", Load<UINT64>(pData));
+            break;
+        case ValueType::Real32:
+            fmt::format_to(it, L"{}", Load<float>(pData));
+            break;
+        case ValueType::Real64:
+            fmt::format_to(it, L"{}", Load<double>(pData));
+            break;
+        case ValueType::Bool:
+            out.append(Load<DWORD>(pData) ? L"true" : L"false");
+            break;
+        case ValueType::HexInt32:
+            fmt::format_to(it, L"0x{:x}", Load<UINT32>(pData));
+            break;
+        case ValueType::HexInt64:
+            fmt::format_to(it, L"0x{:x}", Load<UINT64>(pData));
+            break;
+        case ValueType::Guid:
+            out.append(ToStringW(Load<GUID>(pData)));
+            break;
+        case ValueType::FileTime: {
+            SYSTEMTIME st;
+            const auto ft = Load<FILETIME>(pData);
+            if (FileTimeToSystemTime(&ft, &st))
+                RenderTime(st, out);
+            break;
+        }
+        case ValueType::SysTime:
+            RenderTime(Load<SYSTEMTIME>(pData), out);
+            break;
+        default:
+            break;
+    }
+}
+
+void Render(const Value& value, std::wstring& out)
+{
+    const auto type = static_cast<ValueType>(value.Type & ~kArrayFlag);
+    const bool bArray = (value.Type & kArrayFlag) != 0;
+
+    switch (type)
+    {
+        case ValueType::String: {
+            std::wstring_view text(reinterpret_cast<const WCHAR*>(value.pData), value.cbData / sizeof(WCHAR));
+            if (!bArray)
+            {
+                out.append(text.substr(0, text.find(L'\0')));
+                break;
+            }
+
+            // String arrays are null separated
+            bool bFirst = true;
+            while (!text.empty())
+            {
+                const auto pos = text.find(L'\0');
+                if (!bFirst)
+                    out.append(L", ");
+                out.append(text.substr(0, pos));
+                bFirst = false;
+                if (pos == std::wstring_view::npos)
+                    break;
+                text.remove_prefix(pos + 1);
+            }
+            break;
+        }
+        case ValueType::AnsiString:
+            for (size_t i = 0; i < value.cbData && value.pData[i] != '\0'; i++)
+                out.push_back(static_cast<WCHAR>(value.pData[i]));
+            break;
+        case ValueType::Binary:
+            for (size_t i = 0; i < value.cbData; i++)
+                fmt::format_to(std::back_inserter(out), L"{:02X}", value.pData[i]);
+            break;
+        case ValueType::SizeT:
+            if (value.cbData == sizeof(UINT64))
+                fmt::format_to(std::back_inserter(out), L"0x{:x}", Load<UINT64>(value.pData));
+            else if (value.cbData == sizeof(UINT32))
+                fmt::format_to(std::back_inserter(out), L"0x{:x}", Load<UINT32>(value.pData));
+            break;
+        case ValueType::Sid:
+            RenderSid(value.pData, value.cbData, out);
+            break;
+        default: {
+            const auto cbItem = ValueSize(type);
+            if (cbItem == 0)
+                break;
+
+            for (size_t offset = 0; offset + cbItem <= value.cbData; offset += cbItem)
+            {
+                if (offset > 0)
+                    out.append(L", ");
+                RenderScalar(type, value.pData + offset, out);
+
+                if (!bArray)
+                    break;
+            }
+            break;
+        }
+    }
+}
+
+DWORD ToNumber(const std::wstring& text)
+{
+    return static_cast<DWORD>(wcstoul(text.c_str(), nullptr, 0));
+}
+
+class ChunkParser
+{
+public:
+    ChunkParser(const BYTE* pChunk, size_t cbChunk)
+        : m_pChunk(pChunk)
+        , m_cbChunk(cbChunk)
+    {
+    }
+
+    bool ParseRecord(size_t offset, size_t end, EvtxParser::Record& record)
+    {
+        Evaluation evaluation(*this, record);
+        Cursor cursor(m_pChunk, m_cbChunk, offset, end);
+        return ParseFragment(cursor, evaluation, 0L);
+    }
+
+private:
+    // Fills a record with the values of the elements it knows of while the nodes of its fragment are applied
+    class Evaluation
+    {
+    public:
+        Evaluation(ChunkParser& parser, EvtxParser::Record& record)
+            : m_parser(parser)
+            , m_record(record)
+        {
+        }
+
+        bool Apply(const Nodes& nodes, const std::vector<Value>& values, ULONG ulDepth)
+        {
+            for (const auto& node : nodes)
+            {
+                switch (node.NodeKind)
+                {
+                    case Node::Kind::Open:
+                        if (!m_stack.empty())
+                            m_stack.back().bHasChildren = true;
+                        m_stack.push_back({node.strText});
+                        m_strAttribute.clear();
+                        break;
+                    case Node::Kind::Close:
+                        Close();
+                        break;
+                    case Node::Kind::EndOfAttributes:
+                        m_strAttribute.clear();
+                        break;
+                    case Node::Kind::Attribute:
+                        m_strAttribute = node.strText;
+                        break;
+                    case Node::Kind::Text:
+                        OnValue(nullptr, node.strText);
+                        break;
+                    case Node::Kind::Substitution: {
+                        if (node.wIndex >= values.size())
+                            break;
+
+                        const auto& value = values[node.wIndex];
+                        if (value.Type == static_cast<BYTE>(ValueType::Null) || value.cbData == 0)
+                            break;
+
+                        if (value.Type == static_cast<BYTE>(ValueType::BinXml))
+                        {
+                            if (ulDepth >= kMaxDepth)
+                                return false;
+
+                            const auto offset = static_cast<size_t>(value.pData - m_parser.m_pChunk);
+                            Cursor cursor(m_parser.m_pChunk, m_parser.m_cbChunk, offset, offset + value.cbData);
+                            if (!m_parser.ParseFragment(cursor, *this, ulDepth + 1))
+                                return false;
+                            break;
+                        }
+
+                        std::wstring text;
+                        Render(value, text);
+                        OnValue(&value, text);
+                        break;
+                    }
+                }
+            }
+            return true;
+        }
+
+    private:
+        struct Element
+        {
+            std::wstring strName;
+            std::wstring strDataName;
+            std::wstring strText;
+            bool bHasChildren = false;
+        };
+
+        bool IsIn(std::wstring_view section) const { return m_stack.size() >= 2 && m_stack[1].strName == section; }
+
+        void OnValue(const Value* pValue, const std::wstring& text)
+        {
+            if (m_stack.empty())
+                return;
+
+            auto& element = m_stack.back();
+            if (m_strAttribute.empty())
+            {
+                element.strText.append(text);
+                return;
+            }
+
+            if (m_stack.size() == 3 && IsIn(L"System"))
+            {
+                if (element.strName == L"Provider" && m_strAttribute == L"Name")
+                    m_record.Provider = text;
+                else if (element.strName == L"Security" && m_strAttribute == L"UserID")
+                    m_record.UserId = text;
+                else if (element.strName == L"TimeCreated" && m_strAttribute == L"SystemTime" && pValue != nullptr)
+                {
+                    if (pValue->Type == static_cast<BYTE>(ValueType::FileTime) && pValue->cbData >= sizeof(FILETIME))
+                        m_record.TimeCreated = Load<FILETIME>(pValue->pData);
+                    else if (
+                        pValue->Type == static_cast<BYTE>(ValueType::SysTime) && pValue->cbData >= sizeof(SYSTEMTIME))
+                    {
+                        const auto st = Load<SYSTEMTIME>(pValue->pData);
+                        SystemTimeToFileTime(&st, &m_record.TimeCreated);
+                    }
+                }
+            }
+            else if (m_stack.size() == 3 && IsIn(L"EventData") && m_strAttribute == L"Name")
+                element.strDataName = text;
+
+            m_strAttribute.clear();
+        }
+
+        void Close()
+        {
+            if (m_stack.empty())
+                return;
+
+            auto& element = m_stack.back();
+            if (m_stack.size() == 3 && IsIn(L"System"))
+            {
+                if (element.strName == L"EventID")
+                    m_record.dwEventId = ToNumber(element.strText);
+                else if (element.strName == L"Level")
+                    m_record.dwLevel = ToNumber(element.strText);
+                else if (element.strName == L"Task")
+                    m_record.dwTask = ToNumber(element.strText);
+                else if (element.strName == L"Opcode")
+                    m_record.dwOpcode = ToNumber(element.strText);
+                else if (element.strName == L"Keywords")
+                    m_record.ullKeywords = wcstoull(element.strText.c_str(), nullptr, 0);
+                else if (element.strName == L"Channel")
+                    m_record.Channel = std::move(element.strText);
+                else if (element.strName == L"Computer")
+                    m_record.Computer = std::move(element.strText);
+            }
+            else if (m_stack.size() == 3 && IsIn(L"EventData"))
+            {
+                auto& name = element.strDataName.empty() ? element.strName : element.strDataName;
+                m_record.Data.emplace_back(std::move(name), std::move(element.strText));
+            }
+            else if (m_stack.size() >= 3 && IsIn(L"UserData") && !element.bHasChildren)
+            {
+                m_record.Data.emplace_back(std::move(element.strName), std::move(element.strText));
+            }
+
+            m_stack.pop_back();
+            m_strAttribute.clear();
+        }
+
+        ChunkParser& m_parser;
+        EvtxParser::Record& m_record;
+        std::vector<Element> m_stack;
+        std::wstring m_strAttribute;
+    };
+
+    const std::wstring* GetName(DWORD dwOffset)
+    {
+        if (auto it = m_Names.find(dwOffset); it != std::end(m_Names))
+            return &it->second;
+
+        if (dwOffset + kNameHeaderSize > m_cbChunk)
+            return nullptr;
+
+        const auto wCount = Load<WORD>(m_pChunk + dwOffset + 6);
+        if (dwOffset + kNameHeaderSize + wCount * sizeof(WCHAR) > m_cbChunk)
+            return nullptr;
+
+        std::wstring name(reinterpret_cast<const WCHAR*>(m_pChunk + dwOffset + kNameHeaderSize), wCount);
+        return &m_Names.emplace(dwOffset, std::move(name)).first->second;
+    }
+
+    // Names are stored inline at their first use in the chunk, later uses refer to it by offset
+    bool SkipInlineName(Cursor& cursor, DWORD dwOffset)
+    {
+        if (dwOffset != cursor.Offset())
+            return true;
+
+        WORD wCount = 0;
+        return cursor.Skip(6) && cursor.Read(wCount) && cursor.Skip((wCount + 1) * sizeof(WCHAR));
+    }
+
+    bool ReadName(Cursor& cursor, std::wstring& name)
+    {
+        DWORD dwOffset = 0L;
+        if (!cursor.Read(dwOffset))
+            return false;
+
+        const auto pName = GetName(dwOffset);
+        if (pName == nullptr)
+            return false;
+
+        name = *pName;
+        return SkipInlineName(cursor, dwOffset);
+    }
+
+    bool ReadString(Cursor& cursor, std::wstring& text)
+    {
+        WORD wCount = 0;
+        if (!cursor.Read(wCount) || cursor.Left() < wCount * sizeof(WCHAR))
+            return false;
+
+        text.assign(reinterpret_cast<const WCHAR*>(cursor.Data()), wCount);
+        return cursor.Skip(wCount * sizeof(WCHAR));
+    }
+
+    // Parse element content until the end of the fragment, template instances are not expected here
+    bool ParseNodes(Cursor& cursor, Nodes& nodes)
+    {
+        BYTE byte = 0;
+        while (cursor.Read(byte))
+        {
+            const auto token = static_cast<Token>(byte & ~kHasMoreData);
+            switch (token)
+            {
+                case Token::EndOfFragment:
+                    return true;
+                case Token::OpenStartElement: {
+                    DWORD dwNameOffset = 0L;
+                    if (!cursor.Skip(sizeof(WORD) + sizeof(DWORD)) || !cursor.Read(dwNameOffset))
+                        return false;
+
+                    const auto pName = GetName(dwNameOffset);
+                    if (pName == nullptr)
+                        return false;
+
+                    // Inline names are found before or after the attribute list size, depending on the writer
+                    if (!SkipInlineName(cursor, dwNameOffset))
+                        return false;
+                    if ((byte & kHasMoreData) && !cursor.Skip(sizeof(DWORD)))
+                        return false;
+                    if (!SkipInlineName(cursor, dwNameOffset))
+                        return false;
+
+                    nodes.push_back({Node::Kind::Open, 0, *pName});
+                    break;
+                }
+                case Token::CloseStartElement:
+                    nodes.push_back({Node::Kind::EndOfAttributes});
+                    break;
+                case Token::CloseEmptyElement:
+                case Token::EndElement:
+                    nodes.push_back({Node::Kind::Close});
+                    break;
+                case Token::Value: {
+                    BYTE type = 0;
+                    Node node {Node::Kind::Text};
+                    if (!cursor.Read(type) || static_cast<ValueType>(type) != ValueType::String
+                        || !ReadString(cursor, node.strText))
+                        return false;
+                    nodes.push_back(std::move(node));
+                    break;
+                }
+                case Token::Attribute: {
+                    Node node {Node::Kind::Attribute};
+                    if (!ReadName(cursor, node.strText))
+                        return false;
+                    nodes.push_back(std::move(node));
+                    break;
+                }
+                case Token::CDataSection: {
+                    Node node {Node::Kind::Text};
+                    if (!ReadString(cursor, node.strText))
+                        return false;
+                    nodes.push_back(std::move(node));
+                    break;
+                }
+                case Token::CharRef: {
+                    WORD wChar = 0;
+                    if (!cursor.Read(wChar))
+                        return false;
+                    nodes.push_back({Node::Kind::Text, 0, std::wstring(1, static_cast<WCHAR>(wChar))});
+                    break;
+                }
+                case Token::EntityRef: {
+                    Node node {Node::Kind::Text};
+                    if (!ReadName(cursor, node.strText))
+                        return false;
+
+                    static const std::pair<std::wstring_view, WCHAR> kEntities[] = {
+                        {L"amp", L'&'}, {L"lt", L'<'}, {L"gt", L'>'}, {L"quot", L'"'}, {L"apos", L'\''}};
+                    const auto it = std::find_if(std::cbegin(kEntities), std::cend(kEntities), [&](const auto& e) {
+                        return e.first == node.strText;
+                    });
+                    if (it != std::cend(kEntities))
+                        nodes.push_back({Node::Kind::Text, 0, std::wstring(1, it->second)});
+                    break;
+                }
+                case Token::PITarget: {
+                    std::wstring target;
+                    if (!ReadName(cursor, target))
+                        return false;
+                    break;
+                }
+                case Token::PIData: {
+                    std::wstring data;
+                    if (!ReadString(cursor, data))
+                        return false;
+                    break;
+                }
+                case Token::NormalSubstitution:
+                case Token::OptionalSubstitution: {
+                    Node node {Node::Kind::Substitution};
+                    BYTE type = 0;
+                    if (!cursor.Read(node.wIndex) || !cursor.Read(type))
+                        return false;
+                    nodes.push_back(std::move(node));
+                    break;
+                }
+                case Token::FragmentHeader:
+                    if (!cursor.Skip(3))
+                        return false;
+                    break;
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::shared_ptr<const Nodes> GetTemplate(DWORD dwOffset)
+    {
+        if (auto it = m_Templates.find(dwOffset); it != std::end(m_Templates))
+            return it->second;
+
+        std::shared_ptr<Nodes> pNodes;
+        if (dwOffset + kTemplateHeaderSize <= m_cbChunk)
+        {
+            const auto dwSize = Load<DWORD>(m_pChunk + dwOffset + 20);
+            const size_t begin = dwOffset + kTemplateHeaderSize;
+
+            pNodes = std::make_shared<Nodes>();
+            Cursor cursor(m_pChunk, m_cbChunk, begin, begin + dwSize);
+            if (!ParseNodes(cursor, *pNodes))
+            {
+                Log::Debug(L"Failed to parse template definition at chunk offset {}", dwOffset);
+                pNodes.reset();
+            }
+        }
+
+        // Failures are cached too: the records instantiating a corrupted template are skipped at once
+        m_Templates.emplace(dwOffset, pNodes);
+        return pNodes;
+    }
+
+    bool ParseTemplateInstance(Cursor& cursor, Evaluation& evaluation, ULONG ulDepth)
+    {
+        DWORD dwDefinitionOffset = 0L;
+        if (!cursor.Skip(1 + sizeof(DWORD)) || !cursor.Read(dwDefinitionOffset))
+            return false;
+
+        const auto pNodes = GetTemplate(dwDefinitionOffset);
+        if (pNodes == nullptr)
+            return false;
+
+        // The definition follows the instance of its first use in the chunk
+        if (dwDefinitionOffset == cursor.Offset())
+        {
+            DWORD dwSize = 0L;
+            if (!cursor.Skip(sizeof(DWORD) + sizeof(GUID)) || !cursor.Read(dwSize) || !cursor.Skip(dwSize))
+                return false;
+        }
+
+        DWORD dwCount = 0L;
+        if (!cursor.Read(dwCount) || cursor.Left() < dwCount * sizeof(DWORD))
+            return false;
+
+        std::vector<Value> values;
+        values.reserve(dwCount);
+        for (DWORD i = 0; i < dwCount; i++)
+        {
+            WORD wSize = 0;
+            BYTE type = 0;
+            cursor.Read(wSize);
+            cursor.Read(type);
+            cursor.Skip(1);
+            values.push_back({type, nullptr, wSize});
+        }
+
+        for (auto& value : values)
+        {
+            value.pData = cursor.Data();
+            if (!cursor.Skip(value.cbData))
+                return false;
+        }
+
+        return evaluation.Apply(*pNodes, values, ulDepth);
+    }
+
+    bool ParseFragment(Cursor& cursor, Evaluation& evaluation, ULONG ulDepth)
+    {
+        BYTE byte = 0;
+        if (cursor.Peek(byte) && static_cast<Token>(byte) == Token::FragmentHeader && !cursor.Skip(4))
+            return false;
+
+        if (!cursor.Peek(byte))
+            return false;
+
+        if (static_cast<Token>(byte & ~kHasMoreData) == Token::TemplateInstance)
+        {
+            cursor.Skip(1);
+            return ParseTemplateInstance(cursor, evaluation, ulDepth);
+        }
+
+        Nodes nodes;
+        return ParseNodes(cursor, nodes) && evaluation.Apply(nodes, {}, ulDepth);
+    }
+
+    const BYTE* m_pChunk;
+    size_t m_cbChunk;
+
+    std::unordered_map<DWORD, std::wstring> m_Names;
+    std::unordered_map<DWORD, std::shared_ptr<const Nodes>> m_Templates;
+};
+
+HRESULT ReadFully(ByteStream& stream, BYTE* pBuffer, ULONGLONG cbBuffer, ULONGLONG& cbRead)
+{
+    cbRead = 0LL;
+    while (cbRead < cbBuffer)
+    {
+        ULONGLONG cbThisRead = 0LL;
+        if (auto hr = stream.Read(pBuffer + cbRead, cbBuffer - cbRead, &cbThisRead); FAILED(hr))
+            return hr;
+
+        if (cbThisRead == 0)
+            break;
+
+        cbRead += cbThisRead;
+    }
+    return S_OK;
+}
+
+}  // namespace
+
+HRESULT EvtxParser::Record::Write(ITableOutput& output) const
+{
+    output.WriteInteger(ullRecordId);
+    output.WriteFileTime(TimeCreated);
+    output.WriteFileTime(WrittenTime);
+    output.WriteInteger(dwEventId);
+    output.WriteInteger(dwLevel);
+    output.WriteInteger(dwTask);
+    output.WriteInteger(dwOpcode);
+    output.WriteInteger(ullKeywords);
+    output.WriteString(Provider);
+    output.WriteString(Channel);
+    output.WriteString(Computer);
+    output.WriteString(UserId);
+
+    std::wstring strData;
+    for (const auto& [name, value] : Data)
+    {
+        if (!strData.empty())
+            strData.append(L"; ");
+        fmt::format_to(std::back_inserter(strData), L"{}={}", name, value);
+    }
+    output.WriteString(strData);
+
+    return output.WriteEndOfLine();
+}
+
+const TableOutput::Schema& EvtxParser::GetSchema()
+{
+    static const TableOutput::Schema schema {
+        {TableOutput::UInt64Type, L"EventRecordID"},
+        {TableOutput::TimeStampType, L"TimeCreated"},
+        {TableOutput::TimeStampType, L"TimeWritten"},
+        {TableOutput::UInt32Type, L"EventID"},
+        {TableOutput::UInt32Type, L"Level"},
+        {TableOutput::UInt32Type, L"Task"},
+        {TableOutput::UInt32Type, L"Opcode"},
+        {TableOutput::UInt64Type, L"Keywords"},
+        {TableOutput::UTF16Type, L"Provider"},
+        {TableOutput::UTF16Type, L"Channel"},
+        {TableOutput::UTF16Type, L"Computer"},
+        {TableOutput::UTF16Type, L"UserID"},
+        {TableOutput::UTF16Type, L"EventData"}};
+    return schema;
+}
+
+HRESULT EvtxParser::ParseChunk(const BYTE* pChunk, size_t cbChunk, std::vector<Record>& records, ULONG& ulCorrupted)
+{
+    ulCorrupted = 0L;
+
+    if (cbChunk < kChunkHeaderSize || memcmp(pChunk, kChunkSignature.data(), kChunkSignature.size()))
+        return S_FALSE;
+
+    const auto end = std::min<size_t>(cbChunk, Load<DWORD>(pChunk + kChunkFreeSpaceOffset));
+
+    ChunkParser parser(pChunk, cbChunk);
+
+    size_t offset = kChunkHeaderSize;
+    while (offset + kRecordHeaderSize <= end)
+    {
+        const auto dwSize = Load<DWORD>(pChunk + offset + 4);
+        if (Load<DWORD>(pChunk + offset) != kRecordSignature || dwSize < kRecordHeaderSize + sizeof(DWORD)
+            || offset + dwSize > end)
+        {
+            ulCorrupted++;
+            break;
+        }
+
+        Record record;
+        record.ullRecordId = Load<ULONGLONG>(pChunk + offset + 8);
+        record.WrittenTime = Load<FILETIME>(pChunk + offset + 16);
+
+        if (parser.ParseRecord(offset + kRecordHeaderSize, offset + dwSize - sizeof(DWORD), record))
+            records.push_back(std::move(record));
+        else
+            ulCorrupted++;
+
+        offset += dwSize;
+    }
+
+    return S_OK;
+}
+
+EvtxParser::EvtxParser(ULONG ulBatchChunks)
+    : m_ulBatchChunks(ulBatchChunks ? ulBatchChunks : TaskPool::Instance().Processors() * 4)
+{
+}
+
+HRESULT EvtxParser::Parse(ByteStream& stream, const RecordCallback& onRecord)
+{
+    if (auto hr = stream.SetFilePointer(0LL, FILE_BEGIN, nullptr); FAILED(hr))
+    {
+        Log::Error(L"Failed to seek to the event log header [{}]", SystemError(hr));
+        return hr;
+    }
+
+    std::vector<BYTE> header(kFileHeaderSize);
+    ULONGLONG cbRead = 0LL;
+    if (auto hr = ReadFully(stream, header.data(), header.size(), cbRead); FAILED(hr))
+    {
+        Log::Error(L"Failed to read the event log header [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (cbRead < kFileHeaderSize || memcmp(header.data(), kFileSignature.data(), kFileSignature.size()))
+    {
+        Log::Error(L"Invalid event log header signature");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    // The chunk count of the header is not updated by a dirty log: parse every chunk of the stream
+    const auto ullSize = stream.GetSize();
+    const auto ullChunks = ullSize > kFileHeaderSize ? (ullSize - kFileHeaderSize) / kChunkSize : 0LL;
+
+    std::vector<std::vector<BYTE>> buffers(static_cast<size_t>(std::min<ULONGLONG>(m_ulBatchChunks, ullChunks)));
+    for (auto& buffer : buffers)
+        buffer.resize(kChunkSize);
+
+    for (ULONGLONG ullFirst = 0; ullFirst < ullChunks; ullFirst += buffers.size())
+    {
+        // Reads stay sequential on this thread, chunks are parsed in parallel
+        size_t nbChunks = 0;
+        for (; nbChunks < buffers.size() && ullFirst + nbChunks < ullChunks; nbChunks++)
+        {
+            if (auto hr = ReadFully(stream, buffers[nbChunks].data(), kChunkSize, cbRead); FAILED(hr))
+            {
+                Log::Error(L"Failed to read event log chunk {} [{}]", ullFirst + nbChunks, SystemError(hr));
+                return hr;
+            }
+
+            if (cbRead < kChunkSize)
+                break;
+        }
+
+        std::vector<std::vector<Record>> records(nbChunks);
+        std::vector<HRESULT> results(nbChunks, S_OK);
+        std::vector<ULONG> corrupted(nbChunks, 0L);
+
+        TaskPool::ParallelFor(TaskPool::Subsystem::Table, size_t(0), nbChunks, [&](size_t i) {
+            results[i] = ParseChunk(buffers[i].data(), kChunkSize, records[i], corrupted[i]);
+        });
+
+        for (size_t i = 0; i < nbChunks; i++)
+        {
+            if (results[i] != S_OK)
+            {
+                Log::Debug(L"Skipped event log chunk {} without signature", ullFirst + i);
+                continue;
+            }
+
+            m_ulChunks++;
+            m_ulCorrupted += corrupted[i];
+
+            for (const auto& record : records[i])
+            {
+                m_ullRecords++;
+                if (auto hr = onRecord(record); hr != S_OK)
+                    return hr;
+            }
+        }
+
+        if (nbChunks < buffers.size() && ullFirst + nbChunks < ullChunks)
+            break;
+    }
+
+    if (m_ulCorrupted > 0)
+        Log::Warn(L"Skipped {} corrupted event log records", m_ulCorrupted);
+
+    return S_OK;
+}
@@ -0,0 +1,95 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutput.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class ByteStream;
+
+//
+// EvtxParser: reads the records of an event log file (.evtx) without the Windows Event Log API.
+//
+// The file is a 4KB header followed by independent 64KB chunks. Each chunk holds its records, their BinXML (binary XML)
+// and the templates they instantiate: chunks are read sequentially from the stream (a file, or a raw NTFS stream) and
+// parsed in parallel on the Table scheduler. Templates are parsed once per chunk and cached by their offset, each
+// record only decodes its substitution values. Records are not rendered as XML: the System fields and the EventData
+// (or UserData) values are extracted straight into a Record, written as one row of GetSchema().
+//
+// Checksums are not verified (dirty logs are common on a live host), chunks without a signature are skipped and a
+// record which cannot be decoded is counted and skipped.
+//
+class EvtxParser
+{
+public:
+    static constexpr ULONG kFileHeaderSize = 0x1000;
+    static constexpr ULONG kChunkSize = 0x10000;
+    static constexpr ULONG kChunkHeaderSize = 0x200;
+
+    class Record
+    {
+    public:
+        ULONGLONG ullRecordId = 0LL;
+        FILETIME WrittenTime = {0};
+        FILETIME TimeCreated = {0};
+        DWORD dwEventId = 0L;
+        DWORD dwLevel = 0L;
+        DWORD dwTask = 0L;
+        DWORD dwOpcode = 0L;
+        ULONGLONG ullKeywords = 0LL;
+        std::wstring Provider;
+        std::wstring Channel;
+        std::wstring Computer;
+        std::wstring UserId;
+
+        // EventData 'Data' values by their Name attribute, UserData leaf values by their element name
+        std::vector<std::pair<std::wstring, std::wstring>> Data;
+
+        // Write the record as a row of GetSchema()
+        HRESULT Write(ITableOutput& output) const;
+    };
+
+    // Called in file order on the thread calling Parse, anything but S_OK stops the parsing
+    using RecordCallback = std::function<HRESULT(const Record& record)>;
+
+    static const TableOutput::Schema& GetSchema();
+
+    // Parse the records of a single chunk, appended to 'records'
+    static HRESULT ParseChunk(const BYTE* pChunk, size_t cbChunk, std::vector<Record>& records, ULONG& ulCorrupted);
+
+    // 'ulBatchChunks' chunks are read before being parsed in parallel (0: 4 per processor)
+    EvtxParser(ULONG ulBatchChunks = 0L);
+
+    HRESULT Parse(ByteStream& stream, const RecordCallback& onRecord);
+
+    ULONGLONG Records() const { return m_ullRecords; }
+    ULONG Chunks() const { return m_ulChunks; }
+    ULONG CorruptedRecords() const { return m_ulCorrupted; }
+
+private:
+    ULONG m_ulBatchChunks;
+
+    ULONGLONG m_ullRecords = 0LL;
+    ULONG m_ulChunks = 0L;
+    ULONG m_ulCorrupted = 0L;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -53,6 +53,9 @@ public:
     void ReadSecurityDirectory(std::vector<uint8_t>& buffer, std::error_code& ec) const;
     void GetAuthenticodeHash(CryptoHashStreamAlgorithm algorithms, PeHash& output, std::error_code& ec) const;
 
+    // Ranges of the file covered by the authenticode hash, in increasing offsets
+    void GetHashedChunks(PeChunks& chunks, std::error_code& ec) const;
+
 private:
     bool HasImageDataDirectory(uint8_t index) const;
     IMAGE_DATA_DIRECTORY GetImageDataDirectory(uint8_t index, std::error_code& ec) const;
@@ -62,7 +65,6 @@ private:
     uint64_t GetSecurityDirectoryOffset() const;
     uint64_t GetChecksumOffset() const;
 
-    void GetHashedChunks(PeChunks& chunks, std::error_code& ec) const;
     void Hash(CryptoHashStreamAlgorithm algorithms, const PeChunks& chunks, PeHash& output, std::error_code& ec) const;
 
 private:
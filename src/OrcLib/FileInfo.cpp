@@ -13,6 +13,7 @@
 #include "CryptoHashStream.h"
 #include "FuzzyHashStream.h"
 #include "MemoryStream.h"
+#include "FileDataPass.h"
 #include "MFTRecordFileInfo.h"
 #include "VolumeReader.h"
 
@@ -90,6 +91,15 @@ Orc::Result<Orc::CBinaryBuffer> ReadExtendedAttribute(
     return std::errc::no_such_file_or_directory;
 }
 
+// Content work skipped for the files of the known good list
+constexpr auto KnownGoodSkippedIntentions = Orc::Intentions::FILEINFO_MD5 | Orc::Intentions::FILEINFO_SHA1
+    | Orc::Intentions::FILEINFO_SHA256 | Orc::Intentions::FILEINFO_BLAKE3 | Orc::Intentions::FILEINFO_SSDEEP
+    | Orc::Intentions::FILEINFO_TLSH | Orc::Intentions::FILEINFO_PE_MD5 | Orc::Intentions::FILEINFO_PE_SHA1
+    | Orc::Intentions::FILEINFO_PE_SHA256 | Orc::Intentions::FILEINFO_SIGNED_HASH
+    | Orc::Intentions::FILEINFO_AUTHENTICODE_STATUS | Orc::Intentions::FILEINFO_AUTHENTICODE_SIGNER
+    | Orc::Intentions::FILEINFO_AUTHENTICODE_SIGNER_THUMBPRINT | Orc::Intentions::FILEINFO_AUTHENTICODE_CA
+    | Orc::Intentions::FILEINFO_AUTHENTICODE_CA_THUMBPRINT;
+
 // Directory can have some of those attribute but usually they don't
 bool IsFailureAcceptedForDirectories(const Orc::Intentions& intention)
 {
@@ -125,6 +135,8 @@ bool IsFailureAcceptedForDirectories(const Orc::Intentions& intention)
         case Intentions::FILEINFO_SIGNED_HASH:
         case Intentions::FILEINFO_SECURITY_DIRECTORY_SIZE:
         case Intentions::FILEINFO_SECURITY_DIRECTORY_SIGNATURE_SIZE:
+        case Intentions::FILEINFO_BLAKE3:
+        case Intentions::FILEINFO_KNOWNGOOD:
         case Intentions::FILEINFO_RECORDINUSE:
             return true;
     }
@@ -132,6 +144,60 @@ bool IsFailureAcceptedForDirectories(const Orc::Intentions& intention)
     return false;
 }
 
+// Hashes of 'details' selected by 'algs' and 'pe_algs' with their slot in the hash cache
+std::vector<std::pair<Orc::HashCache::Hash, Orc::CBinaryBuffer*>> CacheableHashes(
+    Orc::DataDetails& details,
+    Orc::CryptoHashStreamAlgorithm algs,
+    Orc::CryptoHashStreamAlgorithm pe_algs)
+{
+    using namespace Orc;
+    using Algorithm = CryptoHashStreamAlgorithm;
+
+    std::vector<std::pair<HashCache::Hash, CBinaryBuffer*>> hashes;
+    if (HasFlag(algs, Algorithm::MD5))
+        hashes.emplace_back(HashCache::Hash::MD5, &details.MD5());
+    if (HasFlag(algs, Algorithm::SHA1))
+        hashes.emplace_back(HashCache::Hash::SHA1, &details.SHA1());
+    if (HasFlag(algs, Algorithm::SHA256))
+        hashes.emplace_back(HashCache::Hash::SHA256, &details.SHA256());
+    if (HasFlag(algs, Algorithm::BLAKE3))
+        hashes.emplace_back(HashCache::Hash::BLAKE3, &details.BLAKE3());
+    if (HasFlag(pe_algs, Algorithm::MD5))
+        hashes.emplace_back(HashCache::Hash::PeMD5, &details.PeMD5());
+    if (HasFlag(pe_algs, Algorithm::SHA1))
+        hashes.emplace_back(HashCache::Hash::PeSHA1, &details.PeSHA1());
+    if (HasFlag(pe_algs, Algorithm::SHA256))
+        hashes.emplace_back(HashCache::Hash::PeSHA256, &details.PeSHA256());
+    return hashes;
+}
+
+// Hashes of 'algs' computed by 'hashstream', hashes that are not available are left empty
+HRESULT GetCryptoHashes(
+    Orc::CryptoHashStream& hashstream,
+    Orc::CryptoHashStreamAlgorithm algs,
+    Orc::CBinaryBuffer& md5,
+    Orc::CBinaryBuffer& sha1,
+    Orc::CBinaryBuffer& sha256,
+    Orc::CBinaryBuffer* pBlake3 = nullptr)
+{
+    using namespace Orc;
+    using Algorithm = CryptoHashStreamAlgorithm;
+
+    const std::pair<Algorithm, CBinaryBuffer*> hashes[] = {
+        {Algorithm::MD5, &md5}, {Algorithm::SHA1, &sha1}, {Algorithm::SHA256, &sha256}, {Algorithm::BLAKE3, pBlake3}};
+
+    for (const auto& [alg, value] : hashes)
+    {
+        if (!HasFlag(algs, alg) || value == nullptr)
+            continue;
+
+        if (auto hr = hashstream.GetHash(alg, *value); FAILED(hr) && hr != MK_E_UNAVAILABLE)
+            return hr;
+    }
+
+    return S_OK;
+}
+
 }  // namespace
 
 using namespace Orc;
@@ -150,7 +216,7 @@ const WCHAR* FileInfo::g_pszArchiveFileExtensions[] =
     {L".ZIP", L".RAR", L".CAB", L".UPX", L".TAR", L".ARC", L".LHA", L".TZ", NULL};
 
 FileInfo::FileInfo(
-    std::wstring strComputerName,
+    std::wstring_view strComputerName,
     const std::shared_ptr<VolumeReader>& pVolReader,
     Intentions DefaultIntentions,
     const std::vector<Filter>& Filters,
@@ -160,21 +226,13 @@ FileInfo::FileInfo(
     : m_PEInfo(*this)
     , m_hFile(INVALID_HANDLE_VALUE)
     , m_pVolReader(pVolReader)
+    , m_strComputerName(strComputerName)
     , m_szFullName(szFullName)
     , m_dwFullNameLen(dwLen)
     , m_DefaultIntentions(DefaultIntentions)
     , m_Filters(Filters)
     , m_codeVerifyTrust(codeVerifyTrust)
 {
-    if (strComputerName.empty())
-    {
-        SystemDetails::GetOrcComputerName(m_strComputerName);
-    }
-    else
-    {
-        m_strComputerName = strComputerName;
-    }
-
     if (!m_Filters.empty())
         m_ColumnIntentions = static_cast<Intentions>(DefaultIntentions | GetFilterIntentions(Filters));
 }
@@ -185,183 +243,172 @@ FileInfo::~FileInfo()
         CloseHandle(m_hFile);
 }
 
-HRESULT FileInfo::HandleIntentions(const Intentions& intention, ITableOutput& output)
+FileInfo::ColumnWriter FileInfo::GetColumnWriter(Intentions intention)
 {
-    HRESULT hr = E_FAIL;
-
     switch (intention)
     {
         case Intentions::FILEINFO_COMPUTERNAME:
-            hr = WriteComputerName(output);
-            break;
+            return &FileInfo::WriteComputerName;
 
         case Intentions::FILEINFO_VOLUMEID:
-            hr = WriteVolumeID(output);
-            break;
+            return &FileInfo::WriteVolumeID;
 
         case Intentions::FILEINFO_FILENAME:
-            hr = WriteFileName(output);
-            break;
+            return &FileInfo::WriteFileName;
 
         case Intentions::FILEINFO_PARENTNAME:
-            hr = WriteParentName(output);
-            break;
+            return &FileInfo::WriteParentName;
 
         case Intentions::FILEINFO_FULLNAME:
-            hr = WriteFullName(output);
-            break;
+            return &FileInfo::WriteFullName;
 
         case Intentions::FILEINFO_EXTENSION:
-            hr = WriteExtension(output);
-            break;
+            return &FileInfo::WriteExtension;
 
         case Intentions::FILEINFO_FILESIZE:
-            hr = WriteSizeInBytes(output);
-            break;
+            return &FileInfo::WriteSizeInBytes;
 
         case Intentions::FILEINFO_ATTRIBUTES:
-            hr = WriteAttributes(output);
-            break;
+            return &FileInfo::WriteAttributes;
 
         case Intentions::FILEINFO_CREATIONDATE:
-            hr = WriteCreationDate(output);
-            break;
+            return &FileInfo::WriteCreationDate;
 
         case Intentions::FILEINFO_LASTMODDATE:
-            hr = WriteLastModificationDate(output);
-            break;
+            return &FileInfo::WriteLastModificationDate;
 
         case Intentions::FILEINFO_LASTACCDATE:
-            hr = WriteLastAccessDate(output);
-            break;
+            return &FileInfo::WriteLastAccessDate;
 
         case Intentions::FILEINFO_RECORDINUSE:
-            hr = WriteRecordInUse(output);
-            break;
+            return &FileInfo::WriteRecordInUse;
 
         case Intentions::FILEINFO_SHORTNAME:
-            hr = WriteShortName(output);
-            break;
+            return &FileInfo::WriteShortName;
 
         case Intentions::FILEINFO_MD5:
-            hr = WriteMD5(output);
-            break;
+            return &FileInfo::WriteMD5;
 
         case Intentions::FILEINFO_SHA1:
-            hr = WriteSHA1(output);
-            break;
+            return &FileInfo::WriteSHA1;
 
         case Intentions::FILEINFO_FIRST_BYTES:
-            hr = WriteFirstBytes(output);
-            break;
+            return &FileInfo::WriteFirstBytes;
 
         case Intentions::FILEINFO_VERSION:
-            hr = WriteVersion(output);
-            break;
+            return &FileInfo::WriteVersion;
 
         case Intentions::FILEINFO_COMPANY:
-            hr = WriteCompanyName(output);
-            break;
+            return &FileInfo::WriteCompanyName;
 
         case Intentions::FILEINFO_PRODUCT:
-            hr = WriteProductName(output);
-            break;
+            return &FileInfo::WriteProductName;
 
         case Intentions::FILEINFO_ORIGINALNAME:
-            hr = WriteOriginalFileName(output);
-            break;
+            return &FileInfo::WriteOriginalFileName;
 
         case Intentions::FILEINFO_PLATFORM:
-            hr = WritePlatform(output);
-            break;
+            return &FileInfo::WritePlatform;
 
         case Intentions::FILEINFO_TIMESTAMP:
-            hr = WriteTimeStamp(output);
-            break;
+            return &FileInfo::WriteTimeStamp;
 
         case Intentions::FILEINFO_SUBSYSTEM:
-            hr = WriteSubSystem(output);
-            break;
+            return &FileInfo::WriteSubSystem;
 
         case Intentions::FILEINFO_FILETYPE:
-            hr = WriteFileType(output);
-            break;
+            return &FileInfo::WriteFileType;
 
         case Intentions::FILEINFO_FILEOS:
-            hr = WriteFileOS(output);
-            break;
+            return &FileInfo::WriteFileOS;
 
         case Intentions::FILEINFO_SHA256:
-            hr = WriteSHA256(output);
-            break;
+            return &FileInfo::WriteSHA256;
+
+        case Intentions::FILEINFO_BLAKE3:
+            return &FileInfo::WriteBLAKE3;
+
+        case Intentions::FILEINFO_KNOWNGOOD:
+            return &FileInfo::WriteKnownGood;
 
         case Intentions::FILEINFO_PE_MD5:
-            hr = WritePeMD5(output);
-            break;
+            return &FileInfo::WritePeMD5;
 
         case Intentions::FILEINFO_PE_SHA1:
-            hr = WritePeSHA1(output);
-            break;
+            return &FileInfo::WritePeSHA1;
 
         case Intentions::FILEINFO_PE_SHA256:
-            hr = WritePeSHA256(output);
-            break;
+            return &FileInfo::WritePeSHA256;
 
         case Intentions::FILEINFO_SECURITY_DIRECTORY:
-            hr = WriteSecurityDirectory(output);
-            break;
+            return &FileInfo::WriteSecurityDirectory;
 
         case Intentions::FILEINFO_AUTHENTICODE_STATUS:
-            hr = WriteAuthenticodeStatus(output);
-            break;
+            return &FileInfo::WriteAuthenticodeStatus;
 
         case Intentions::FILEINFO_AUTHENTICODE_SIGNER:
-            hr = WriteAuthenticodeSigner(output);
-            break;
+            return &FileInfo::WriteAuthenticodeSigner;
 
         case Intentions::FILEINFO_AUTHENTICODE_SIGNER_THUMBPRINT:
-            hr = WriteAuthenticodeSignerThumbprint(output);
-            break;
+            return &FileInfo::WriteAuthenticodeSignerThumbprint;
 
         case Intentions::FILEINFO_AUTHENTICODE_CA:
-            hr = WriteAuthenticodeCA(output);
-            break;
+            return &FileInfo::WriteAuthenticodeCA;
 
         case Intentions::FILEINFO_AUTHENTICODE_CA_THUMBPRINT:
-            hr = WriteAuthenticodeCAThumbprint(output);
-            break;
+            return &FileInfo::WriteAuthenticodeCAThumbprint;
 
         case Intentions::FILEINFO_SSDEEP:
-            hr = WriteSSDeep(output);
-            break;
+            return &FileInfo::WriteSSDeep;
 
         case Intentions::FILEINFO_TLSH:
-            hr = output.WriteNothing();
-            break;
+            return &FileInfo::WriteNothing;
 
         case Intentions::FILEINFO_SIGNED_HASH:
-            hr = WriteSignedHash(output);
-            break;
+            return &FileInfo::WriteSignedHash;
 
         case Intentions::FILEINFO_SECURITY_DIRECTORY_SIZE:
-            hr = WriteSecurityDirectorySize(output);
-            break;
+            return &FileInfo::WriteSecurityDirectorySize;
 
         case Intentions::FILEINFO_SECURITY_DIRECTORY_SIGNATURE_SIZE:
-            hr = WriteSecurityDirectorySignatureSize(output);
-            break;
+            return &FileInfo::WriteSecurityDirectorySignatureSize;
 
         case Intentions::FILEINFO_OWNER:
         case Intentions::FILEINFO_OWNERID:
         case Intentions::FILEINFO_OWNERSID:
-            return output.WriteNothing();
+            return &FileInfo::WriteNothing;
 
         default:
-            return E_FAIL;
-            break;
+            return nullptr;
     }
+}
 
-    return hr;
+FileInfo::ColumnPlan FileInfo::CompileColumnPlan(const ColumnNameDef columnNames[])
+{
+    return CompileColumnPlan(columnNames, &FileInfo::GetColumnWriter);
+}
+
+FileInfo::ColumnPlan
+FileInfo::CompileColumnPlan(const ColumnNameDef columnNames[], ColumnWriter (*getWriter)(Intentions))
+{
+    ColumnPlan plan;
+
+    for (auto pCurCol = columnNames; pCurCol->dwIntention != Intentions::FILEINFO_NONE; pCurCol++)
+    {
+        plan.Steps.push_back({pCurCol, getWriter(pCurCol->dwIntention)});
+        plan.ColumnIntentions = plan.ColumnIntentions | pCurCol->dwIntention;
+    }
+
+    return plan;
+}
+
+HRESULT FileInfo::HandleIntentions(const Intentions& intention, ITableOutput& output)
+{
+    const auto writer = GetColumnWriter(intention);
+    if (writer == nullptr)
+        return E_FAIL;
+
+    return (this->*writer)(output);
 }
 
 HRESULT FileInfo::WriteFileInformation(
@@ -376,46 +423,82 @@ HRESULT FileInfo::WriteFileInformation(
     const ColumnNameDef* pCurCol = columnNames;
     while (pCurCol->dwIntention != Intentions::FILEINFO_NONE)
     {
-        DWORD ColId = output.GetCurrentColumnID();
+        hr = WriteColumn(*pCurCol, localIntentions, output);
+        pCurCol++;
+    }
+    output.WriteEndOfLine();
+
+    return hr;
+}
+
+HRESULT
+FileInfo::WriteFileInformation(const ColumnPlan& plan, ITableOutput& output, const std::vector<Filter>& filters)
+{
+    HRESULT hr = E_FAIL;
+
+    const auto localIntentions = FilterIntentions(filters);
+    m_RowIntentions = localIntentions;
+
+    OpenColumnData(localIntentions & plan.ColumnIntentions);
+
+    for (const auto& step : plan.Steps)
+        hr = WriteColumn(*step.Column, step.Writer, localIntentions, output);
+
+    output.WriteEndOfLine();
+
+    return hr;
+}
 
-        try
+HRESULT FileInfo::WriteColumn(const ColumnNameDef& column, Intentions localIntentions, ITableOutput& output)
+{
+    return WriteColumn(column, nullptr, localIntentions, output);
+}
+
+HRESULT FileInfo::WriteColumn(
+    const ColumnNameDef& column,
+    ColumnWriter writer,
+    Intentions localIntentions,
+    ITableOutput& output)
+{
+    HRESULT hr = E_FAIL;
+
+    DWORD ColId = output.GetCurrentColumnID();
+
+    try
+    {
+        if (HasFlag(localIntentions, column.dwIntention))
         {
-            if (HasFlag(localIntentions, pCurCol->dwIntention))
+            hr = writer != nullptr ? (this->*writer)(output) : HandleIntentions(column.dwIntention, output);
+            if (FAILED(hr))
             {
-                if (FAILED(hr = HandleIntentions(pCurCol->dwIntention, output)))
+                if (IsDirectory() && ::IsFailureAcceptedForDirectories(column.dwIntention))
                 {
-                    if (IsDirectory() && ::IsFailureAcceptedForDirectories(pCurCol->dwIntention))
-                    {
-                        if (output.GetCurrentColumnID() == ColId)
-                            hr = output.WriteNothing();
-                    }
-                    else
-                    {
-                        Log::Debug(
-                            L"Failed to write column '{}' for '{}' [{}]",
-                            pCurCol->szColumnName,
-                            m_szFullName,
-                            SystemError(hr));
-
-                        if (output.GetCurrentColumnID() == ColId)
-                            hr = output.AbandonColumn();
-                    }
+                    if (output.GetCurrentColumnID() == ColId)
+                        hr = output.WriteNothing();
+                }
+                else
+                {
+                    Log::Debug(
+                        L"Failed to write column '{}' for '{}' [{}]",
+                        column.szColumnName,
+                        m_szFullName,
+                        SystemError(hr));
+
+                    if (output.GetCurrentColumnID() == ColId)
+                        hr = output.AbandonColumn();
                 }
             }
-            else
-                hr = output.WriteNothing();
         }
-        catch (Orc::Exception& e)
-        {
-            Log::Error(L"Error while writing column '{}': {}", output.GetCurrentColumn().ColumnName, e.Description);
-            output.AbandonColumn();
-        }
-
-        _ASSERT(output.GetCurrentColumnID() == ColId + 1);
-
-        pCurCol++;
+        else
+            hr = output.WriteNothing();
+    }
+    catch (Orc::Exception& e)
+    {
+        Log::Error(L"Error while writing column '{}': {}", output.GetCurrentColumn().ColumnName, e.Description);
+        output.AbandonColumn();
     }
-    output.WriteEndOfLine();
+
+    _ASSERT(output.GetCurrentColumnID() == ColId + 1);
 
     return hr;
 }
@@ -633,6 +716,10 @@ HRESULT FileInfo::OpenFirstBytes()
     if (FAILED(hr = CheckStream()))
         return hr;
 
+    // The data pass captures the first bytes when the data is read for the hashes
+    if (!GetDetails()->HashChecked() && SUCCEEDED(CheckHash()) && GetDetails()->FirstBytesAvailable())
+        return S_OK;
+
     CBinaryBuffer FBBuffer;
     FBBuffer.SetCount(BYTES_IN_FIRSTBYTES);
     FBBuffer.ZeroMe();
@@ -678,39 +765,224 @@ HRESULT FileInfo::OpenHash()
     if (FAILED(hr = CheckStream()))
         return hr;
 
-    Intentions localIntentions = FilterIntentions(m_Filters);
+    const auto localIntentions = m_RowIntentions ? *m_RowIntentions : FilterIntentions(m_Filters);
+    if (FAILED(hr = OpenDataPass(localIntentions)))
+        return hr;
+
+    SubmitAuthenticode(localIntentions);
+    return hr;
+}
+
+HRESULT FileInfo::OpenDataPass(Intentions localIntentions)
+{
+    HRESULT hr = E_FAIL;
 
+    const auto& details = GetDetails();
+
+    CryptoHashStream::Algorithm algs = CryptoHashStream::Algorithm::Undefined;
+    if (HasFlag(localIntentions, Intentions::FILEINFO_MD5))
+        algs |= CryptoHashStream::Algorithm::MD5;
+    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA1))
+        algs |= CryptoHashStream::Algorithm::SHA1;
+    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA256))
+        algs |= CryptoHashStream::Algorithm::SHA256;
+    if (HasFlag(localIntentions, Intentions::FILEINFO_BLAKE3))
+        algs |= CryptoHashStream::Algorithm::BLAKE3;
+
+    FuzzyHashStream::Algorithm fuzzy_algs = FuzzyHashStream::Algorithm::Undefined;
+#ifdef ORC_BUILD_SSDEEP
+    if (HasFlag(localIntentions, Intentions::FILEINFO_SSDEEP))
+        fuzzy_algs |= FuzzyHashStream::Algorithm::SSDeep;
+#endif
+
+    CryptoHashStream::Algorithm pe_algs = CryptoHashStream::Algorithm::Undefined;
     if (HasAnyFlag(
             localIntentions,
-            Intentions::FILEINFO_MD5 | Intentions::FILEINFO_SHA1 | Intentions::FILEINFO_SHA256
-                | Intentions::FILEINFO_SSDEEP))
+            Intentions::FILEINFO_PE_MD5 | Intentions::FILEINFO_PE_SHA1 | Intentions::FILEINFO_PE_SHA256
+                | Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
     {
-        if (HasAnyFlag(
-                localIntentions,
-                Intentions::FILEINFO_PE_MD5 | Intentions::FILEINFO_PE_SHA1 | Intentions::FILEINFO_PE_SHA256
-                    | Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
+        if (FAILED(hr = m_PEInfo.CheckPEInformation()))
+            return hr;
+
+        if (m_PEInfo.HasPEHeader())
+        {
+            if (HasFlag(localIntentions, Intentions::FILEINFO_PE_MD5))
+                pe_algs |= CryptoHashStream::Algorithm::MD5;
+            if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA1))
+                pe_algs |= CryptoHashStream::Algorithm::SHA1;
+            if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA256))
+                pe_algs |= CryptoHashStream::Algorithm::SHA256;
+            if (HasAnyFlag(
+                    localIntentions,
+                    Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
+            {
+                pe_algs |= CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1
+                    | CryptoHashStream::Algorithm::SHA256;
+            }
+        }
+    }
+
+    if (algs == CryptoHashStream::Algorithm::Undefined && fuzzy_algs == FuzzyHashStream::Algorithm::Undefined
+        && pe_algs == CryptoHashStream::Algorithm::Undefined)
+        return S_OK;
+
+    // Fuzzy hashes are not cached
+    if (fuzzy_algs == FuzzyHashStream::Algorithm::Undefined && LoadCachedHashes(algs, pe_algs))
+        return S_OK;
+
+    FileDataPass pass;
+
+    if (HasFlag(localIntentions, Intentions::FILEINFO_FIRST_BYTES) && !details->FirstBytesAvailable())
+        pass.AddFirstBytes(BYTES_IN_FIRSTBYTES);
+
+    if (FAILED(hr = pass.AddCryptoHash(algs)))
+        return hr;
+
+    if (FAILED(hr = pass.AddFuzzyHash(fuzzy_algs)))
+        return hr;
+
+    // A pe that cannot be parsed still gets its other hashes
+    HRESULT hrPeHash = S_OK;
+    if (pe_algs != CryptoHashStream::Algorithm::Undefined)
+    {
+        if (FAILED(hrPeHash = m_PEInfo.AddPeHash(pass, pe_algs)))
+            pe_algs = CryptoHashStream::Algorithm::Undefined;
+    }
+
+    // PE files are read through the window already holding their headers
+    auto stream = pass.PeHash() ? m_PEInfo.GetStream() : details->GetDataStream();
+    if (stream == nullptr)
+        return E_POINTER;
+
+    if (FAILED(hr = pass.Run(*stream)))
+    {
+        Log::Debug(L"Failed to read data of '{}' [{}]", m_szFullName, SystemError(hr));
+        return hr;
+    }
+
+    if (HasFlag(localIntentions, Intentions::FILEINFO_FIRST_BYTES) && !details->FirstBytesAvailable())
+        details->SetFirstBytes(std::move(pass.FirstBytes()));
+
+    if (pass.BytesRead() > 0)
+    {
+        if (pass.CryptoHash()
+            && FAILED(
+                hr = GetCryptoHashes(
+                    *pass.CryptoHash(),
+                    algs,
+                    details->MD5(),
+                    details->SHA1(),
+                    details->SHA256(),
+                    &details->BLAKE3())))
+            return hr;
+
+#ifdef ORC_BUILD_SSDEEP
+        if (pass.FuzzyHash())
         {
-            if (FAILED(hr = m_PEInfo.CheckPEInformation()))
+            hr = pass.FuzzyHash()->GetHash(FuzzyHashStream::Algorithm::SSDeep, details->SSDeep());
+            if (FAILED(hr) && hr != MK_E_UNAVAILABLE)
                 return hr;
-            if (m_PEInfo.HasPEHeader())
-                return m_PEInfo.OpenAllHash(localIntentions);
-            else
-                return OpenCryptoAndFuzzyHash(localIntentions);
         }
-        else
-            return OpenCryptoAndFuzzyHash(localIntentions);
+#endif
     }
-    else if (HasAnyFlag(
-                 localIntentions,
-                 Intentions::FILEINFO_PE_MD5 | Intentions::FILEINFO_PE_SHA1 | Intentions::FILEINFO_PE_SHA256
-                     | Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
+
+    if (pass.PeHash())
     {
-        if (FAILED(hr = m_PEInfo.CheckPEInformation()))
+        if (FAILED(
+                hr = GetCryptoHashes(
+                    *pass.PeHash(), pe_algs, details->PeMD5(), details->PeSHA1(), details->PeSHA256())))
             return hr;
-        if (m_PEInfo.HasPEHeader())
-            return m_PEInfo.OpenPeHash(localIntentions);
     }
-    return S_OK;
+    else
+    {
+        pe_algs = CryptoHashStream::Algorithm::Undefined;
+    }
+
+    if (pass.BytesRead() > 0)
+        StoreCachedHashes(algs, pe_algs);
+
+    return hrPeHash;
+}
+
+bool FileInfo::LoadCachedHashes(CryptoHashStreamAlgorithm algs, CryptoHashStreamAlgorithm pe_algs)
+{
+    auto& cache = HashCache::Instance();
+    if (!cache.IsEnabled())
+        return false;
+
+    const auto key = GetHashCacheKey();
+    if (!key)
+        return false;
+
+    const auto hashes = CacheableHashes(*GetDetails(), algs, pe_algs);
+    if (hashes.empty())
+        return false;
+
+    // Only use the cache if it has all the hashes, the data has to be read otherwise
+    std::vector<CBinaryBuffer> values(hashes.size());
+    for (size_t i = 0; i < hashes.size(); i++)
+    {
+        if (!cache.Lookup(*key, hashes[i].first, values[i]))
+            return false;
+    }
+
+    for (size_t i = 0; i < hashes.size(); i++)
+        *hashes[i].second = std::move(values[i]);
+
+    Log::Trace(L"Hashes of '{}' found in hash cache", m_szFullName);
+    return true;
+}
+
+void FileInfo::StoreCachedHashes(CryptoHashStreamAlgorithm algs, CryptoHashStreamAlgorithm pe_algs)
+{
+    auto& cache = HashCache::Instance();
+    if (!cache.IsEnabled())
+        return;
+
+    const auto key = GetHashCacheKey();
+    if (!key)
+        return;
+
+    for (const auto& [hash, value] : CacheableHashes(*GetDetails(), algs, pe_algs))
+    {
+        if (value->GetCount() > 0)
+            cache.Store(*key, hash, *value);
+    }
+}
+
+void FileInfo::OpenColumnData(Intentions intentions)
+{
+    if (intentions == Intentions::FILEINFO_NONE || IsDirectory() || GetDetails() == nullptr)
+        return;
+
+    // The data pass also reads the first bytes and the pe information it needs for the pe hashes
+    if (HasAnyFlag(
+            intentions,
+            Intentions::FILEINFO_MD5 | Intentions::FILEINFO_SHA1 | Intentions::FILEINFO_SHA256
+                | Intentions::FILEINFO_BLAKE3 | Intentions::FILEINFO_SSDEEP | Intentions::FILEINFO_PE_MD5
+                | Intentions::FILEINFO_PE_SHA1 | Intentions::FILEINFO_PE_SHA256 | Intentions::FILEINFO_SIGNED_HASH
+                | Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
+        CheckHash();
+
+    if (HasFlag(intentions, Intentions::FILEINFO_FIRST_BYTES))
+        CheckFirstBytes();
+
+    if (HasAnyFlag(
+            intentions,
+            Intentions::FILEINFO_PLATFORM | Intentions::FILEINFO_TIMESTAMP | Intentions::FILEINFO_SUBSYSTEM))
+        m_PEInfo.CheckPEInformation();
+
+    if (HasAnyFlag(
+            intentions,
+            Intentions::FILEINFO_VERSION | Intentions::FILEINFO_COMPANY | Intentions::FILEINFO_PRODUCT
+                | Intentions::FILEINFO_ORIGINALNAME | Intentions::FILEINFO_FILETYPE | Intentions::FILEINFO_FILEOS))
+        m_PEInfo.CheckVersionInformation();
+
+    if (HasAnyFlag(
+            intentions,
+            Intentions::FILEINFO_SECURITY_DIRECTORY | Intentions::FILEINFO_SECURITY_DIRECTORY_SIZE
+                | Intentions::FILEINFO_SECURITY_DIRECTORY_SIGNATURE_SIZE))
+        m_PEInfo.CheckSecurityDirectory();
 }
 
 HRESULT FileInfo::OpenCryptoHash(Intentions localIntentions)
@@ -727,6 +999,11 @@ HRESULT FileInfo::OpenCryptoHash(Intentions localIntentions)
         algs |= CryptoHashStream::Algorithm::SHA1;
     if (HasFlag(localIntentions, Intentions::FILEINFO_SHA256))
         algs |= CryptoHashStream::Algorithm::SHA256;
+    if (HasFlag(localIntentions, Intentions::FILEINFO_BLAKE3))
+        algs |= CryptoHashStream::Algorithm::BLAKE3;
+
+    if (LoadCachedHashes(algs, CryptoHashStream::Algorithm::Undefined))
+        return S_OK;
 
     auto stream = GetDetails()->GetDataStream();
 
@@ -766,6 +1043,14 @@ HRESULT FileInfo::OpenCryptoHash(Intentions localIntentions)
             if (hr != MK_E_UNAVAILABLE)
                 return hr;
         }
+        if (HasFlag(algs, CryptoHashStream::Algorithm::BLAKE3)
+            && FAILED(hr = hashstream->GetHash(CryptoHashStream::Algorithm::BLAKE3, GetDetails()->BLAKE3())))
+        {
+            if (hr != MK_E_UNAVAILABLE)
+                return hr;
+        }
+
+        StoreCachedHashes(algs, CryptoHashStream::Algorithm::Undefined);
     }
 
     return S_OK;
@@ -815,97 +1100,6 @@ HRESULT FileInfo::OpenFuzzyHash(Intentions localIntentions)
     return S_OK;
 }
 
-HRESULT FileInfo::OpenCryptoAndFuzzyHash(Intentions localIntentions)
-{
-    HRESULT hr = E_FAIL;
-
-    if (GetDetails()->HashAvailable())
-        return S_OK;
-
-    CryptoHashStream::Algorithm crypto_algs = CryptoHashStream::Algorithm::Undefined;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_MD5))
-        crypto_algs |= CryptoHashStream::Algorithm::MD5;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA1))
-        crypto_algs |= CryptoHashStream::Algorithm::SHA1;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA256))
-        crypto_algs |= CryptoHashStream::Algorithm::SHA256;
-
-    FuzzyHashStream::Algorithm fuzzy_algs = FuzzyHashStream::Algorithm::Undefined;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SSDEEP))
-        fuzzy_algs |= FuzzyHashStream::Algorithm::SSDeep;
-
-    auto stream = GetDetails()->GetDataStream();
-
-    if (stream == nullptr)
-        return E_POINTER;
-
-    stream->SetFilePointer(0L, FILE_BEGIN, NULL);
-
-    std::shared_ptr<ByteStream> hashing_stream;
-    std::shared_ptr<CryptoHashStream> crypto_hashstream;
-    std::shared_ptr<FuzzyHashStream> fuzzy_hashstream;
-
-    if (crypto_algs != CryptoHashStream::Algorithm::Undefined)
-    {
-        crypto_hashstream = std::make_shared<CryptoHashStream>();
-        if (crypto_hashstream == nullptr)
-            return E_OUTOFMEMORY;
-
-        if (FAILED(hr = crypto_hashstream->OpenToWrite(crypto_algs, nullptr)))
-            return hr;
-
-        hashing_stream = crypto_hashstream;
-    }
-
-    if (fuzzy_algs != FuzzyHashStream::Algorithm::Undefined)
-    {
-        fuzzy_hashstream = std::make_shared<FuzzyHashStream>();
-        if (fuzzy_hashstream == nullptr)
-            return E_OUTOFMEMORY;
-
-        if (FAILED(hr = fuzzy_hashstream->OpenToWrite(fuzzy_algs, hashing_stream)))
-            return hr;
-
-        hashing_stream = fuzzy_hashstream;
-    }
-
-    ULONGLONG ullWritten = 0LL;
-    if (FAILED(hr = stream->CopyTo(*hashing_stream, &ullWritten)))
-        return hr;
-
-    if (ullWritten > 0)
-    {
-        if (HasFlag(crypto_algs, CryptoHashStream::Algorithm::MD5)
-            && FAILED(hr = crypto_hashstream->GetHash(CryptoHashStream::Algorithm::MD5, GetDetails()->MD5())))
-        {
-            if (hr != MK_E_UNAVAILABLE)
-                return hr;
-        }
-        if (HasFlag(crypto_algs, CryptoHashStream::Algorithm::SHA1)
-            && FAILED(hr = crypto_hashstream->GetHash(CryptoHashStream::Algorithm::SHA1, GetDetails()->SHA1())))
-        {
-            if (hr != MK_E_UNAVAILABLE)
-                return hr;
-        }
-        if (HasFlag(crypto_algs, CryptoHashStream::Algorithm::SHA256)
-            && FAILED(hr = crypto_hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, GetDetails()->SHA256())))
-        {
-            if (hr != MK_E_UNAVAILABLE)
-                return hr;
-        }
-#ifdef ORC_BUILD_SSDEEP
-        if (HasFlag(fuzzy_algs, FuzzyHashStream::Algorithm::SSDeep)
-            && FAILED(hr = fuzzy_hashstream->GetHash(FuzzyHashStream::Algorithm::SSDeep, GetDetails()->SSDeep())))
-        {
-            if (hr != MK_E_UNAVAILABLE)
-                return hr;
-        }
-#endif
-    }
-
-    return S_OK;
-}
-
 HRESULT FileInfo::CheckAuthenticodeData()
 {
     if (GetDetails() == nullptr)
@@ -917,6 +1111,31 @@ HRESULT FileInfo::CheckAuthenticodeData()
     return OpenAuthenticode();
 }
 
+void FileInfo::SubmitAuthenticode(Intentions localIntentions)
+{
+    if (m_pAuthenticodePool == nullptr || m_AuthenticodeTicket != nullptr)
+        return;
+
+    if (!HasAnyFlag(
+            localIntentions,
+            Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER
+                | Intentions::FILEINFO_AUTHENTICODE_SIGNER_THUMBPRINT | Intentions::FILEINFO_AUTHENTICODE_CA
+                | Intentions::FILEINFO_AUTHENTICODE_CA_THUMBPRINT))
+        return;
+
+    const auto& details = GetDetails();
+    if (IsDirectory() || details->HasAuthenticodeData() || !m_PEInfo.HasPEHeader())
+        return;
+
+    // OpenAuthenticode reports the failure
+    if (FAILED(m_PEInfo.CheckSecurityDirectory()))
+        return;
+
+    // An empty security directory is verified with the catalogs
+    m_AuthenticodeTicket = m_pAuthenticodePool->Submit(
+        std::wstring(m_szFullName, m_dwFullNameLen), details->SecurityDirectory(), details->GetPEHashs());
+}
+
 HRESULT FileInfo::OpenAuthenticode()
 {
     HRESULT hr = E_FAIL;
@@ -930,6 +1149,29 @@ HRESULT FileInfo::OpenAuthenticode()
         return S_OK;
     }
 
+    if (m_AuthenticodeTicket != nullptr)
+    {
+        const auto ticket = std::move(m_AuthenticodeTicket);
+        hr = m_pAuthenticodePool->Collect(ticket, data);
+
+        // The pool worker used its own cache, this thread goes on with the cache of its verifier
+        data.AuthenticodeCache() = m_codeVerifyTrust.Cache();
+
+        if (FAILED(hr) && !GetDetails()->SecurityDirectoryAvailable())
+        {
+            Log::Debug(L"Failed to verify signature with WinVerifyTrust [{}]", hr);
+            hr = VerifySignatureWithCatalogHint(GetDetails()->GetPEHashs(), data);
+        }
+
+        if (FAILED(hr))
+        {
+            Log::Warn(L"WinVerifyTrust failed for file '{}' [{}]", m_szFullName, SystemError(hr));
+        }
+
+        GetDetails()->SetAuthenticodeData(std::move(data));
+        return S_OK;
+    }
+
     if (FAILED(hr = m_PEInfo.CheckSecurityDirectory()))
         return hr;
 
@@ -954,6 +1196,23 @@ HRESULT FileInfo::OpenAuthenticode()
     return S_OK;
 }
 
+std::optional<CBinaryBuffer> FileInfo::GetCatalogHint()
+{
+    auto mftRecordInfo = dynamic_cast<MFTRecordFileInfo*>(this);
+    if (!mftRecordInfo || mftRecordInfo->MftRecord() == nullptr)
+    {
+        return std::nullopt;
+    }
+
+    auto catalogHint = ::ReadExtendedAttribute(m_pVolReader, *mftRecordInfo->MftRecord(), L"$CI.CATALOGHINT");
+    if (!catalogHint)
+    {
+        return std::nullopt;
+    }
+
+    return std::move(*catalogHint);
+}
+
 HRESULT FileInfo::VerifyAnySignatureWithCatalogs(
     const std::wstring_view path,
     const Authenticode::PE_Hashs& peHashes,
@@ -966,14 +1225,13 @@ HRESULT FileInfo::VerifyAnySignatureWithCatalogs(
     }
 
     Log::Debug(L"Failed to verify signature with WinVerifyTrust [{}]", hr);
+    return VerifySignatureWithCatalogHint(peHashes, data);
+}
 
-    auto mftRecordInfo = dynamic_cast<MFTRecordFileInfo*>(this);
-    if (!mftRecordInfo || mftRecordInfo->MftRecord() == nullptr)
-    {
-        return E_FAIL;
-    }
-
-    auto catalogHint = ::ReadExtendedAttribute(m_pVolReader, *mftRecordInfo->MftRecord(), L"$CI.CATALOGHINT");
+HRESULT
+FileInfo::VerifySignatureWithCatalogHint(const Authenticode::PE_Hashs& peHashes, Authenticode::AuthenticodeData& data)
+{
+    auto catalogHint = GetCatalogHint();
     if (!catalogHint)
     {
         return E_FAIL;
@@ -1007,52 +1265,64 @@ HRESULT FileInfo::WriteVolumeID(ITableOutput& output)
     return S_OK;
 }
 
-HRESULT FileInfo::WriteFullName(ITableOutput& output)
+std::wstring_view FileInfo::FileNameOf(std::wstring_view fullName)
 {
-    return output.WriteString(m_szFullName);
+    const auto separator = fullName.find_last_of(L"\\/");
+    if (separator != std::wstring_view::npos)
+        return fullName.substr(separator + 1);
+
+    if (fullName.size() >= 2 && fullName[1] == L':')
+        return fullName.substr(2);
+
+    return fullName;
 }
 
-HRESULT FileInfo::WriteFileName(ITableOutput& output)
+std::wstring_view FileInfo::ParentNameOf(std::wstring_view fullName)
 {
-    WCHAR fname[_MAX_FNAME];
-    WCHAR ext[_MAX_EXT];
-    errno_t err = 0;
+    const auto separator = fullName.find_last_of(L"\\/");
+    if (separator != std::wstring_view::npos)
+    {
+        // Internal [76]: avoid path ending with '\\' for weak csv parsers
+        auto parent = fullName.substr(0, separator + 1);
+        if (parent.back() == L'\\')
+            parent.remove_suffix(1);
+        return parent;
+    }
 
-    if ((err = _wsplitpath_s(m_szFullName, NULL, 0, NULL, 0, fname, _MAX_FNAME, ext, _MAX_EXT)) != 0)
-        return HRESULT_FROM_WIN32(err);
+    if (fullName.size() >= 2 && fullName[1] == L':')
+        return fullName.substr(0, 2);
 
-    return output.WriteFormated(L"{}{}", fname, ext);
+    return {};
 }
 
-HRESULT FileInfo::WriteParentName(ITableOutput& output)
+std::wstring_view FileInfo::ExtensionOf(std::wstring_view fullName)
 {
-    WCHAR drive[_MAX_DRIVE];
-    WCHAR dir[_MAX_DIR];
-    errno_t err;
+    const auto fileName = FileNameOf(fullName);
+    const auto dot = fileName.find_last_of(L'.');
+    if (dot == std::wstring_view::npos)
+        return {};
 
-    if ((err = _wsplitpath_s(m_szFullName, drive, _MAX_DRIVE, dir, _MAX_DIR, NULL, 0L, NULL, 0L)) != 0)
-        return HRESULT_FROM_WIN32(err);
+    return fileName.substr(dot);
+}
 
-    // Internal [76]: avoid path ending with '\\' for weak csv parsers
-    const auto dirLength = wcslen(dir);
-    if (dirLength && dir[dirLength - 1] == L'\\')
-    {
-        dir[dirLength - 1] = L'\0';
-    }
+HRESULT FileInfo::WriteFullName(ITableOutput& output)
+{
+    return output.WriteString(std::wstring_view(m_szFullName, m_dwFullNameLen));
+}
 
-    return output.WriteFormated(L"{}{}", drive, dir);
+HRESULT FileInfo::WriteFileName(ITableOutput& output)
+{
+    return output.WriteString(FileNameOf(std::wstring_view(m_szFullName, m_dwFullNameLen)));
 }
 
-HRESULT FileInfo::WriteExtension(ITableOutput& output)
+HRESULT FileInfo::WriteParentName(ITableOutput& output)
 {
-    WCHAR ext[_MAX_EXT];
-    errno_t err;
-    if ((err = _wsplitpath_s(m_szFullName, NULL, 0L, NULL, 0L, NULL, 0L, ext, _MAX_EXT)) != 0)
-    {
-        return HRESULT_FROM_WIN32(err);
-    }
+    return output.WriteString(ParentNameOf(std::wstring_view(m_szFullName, m_dwFullNameLen)));
+}
 
-    return output.WriteFormated(L"{}", ext);
+HRESULT FileInfo::WriteExtension(ITableOutput& output)
+{
+    return output.WriteString(ExtensionOf(std::wstring_view(m_szFullName, m_dwFullNameLen)));
 }
 
 HRESULT FileInfo::WriteOwnerId(ITableOutput& output)
@@ -1494,6 +1764,26 @@ HRESULT FileInfo::WriteSHA256(ITableOutput& output)
     return GetDetails()->SHA256().GetCount() > 0 ? output.WriteBytes(GetDetails()->SHA256()) : output.WriteNothing();
 }
 
+HRESULT FileInfo::WriteBLAKE3(ITableOutput& output)
+{
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = CheckHash()))
+    {
+        if (hr == HRESULT_FROM_WIN32(ERROR_INVALID_FUNCTION) || hr == HRESULT_FROM_WIN32(ERROR_DIRECTORY))
+            return output.WriteNothing();
+        return hr;
+    }
+    return GetDetails()->BLAKE3().GetCount() > 0 ? output.WriteBytes(GetDetails()->BLAKE3()) : output.WriteNothing();
+}
+
+HRESULT FileInfo::WriteKnownGood(ITableOutput& output)
+{
+    if (m_pKnownGood == nullptr)
+        return output.WriteNothing();
+
+    return output.WriteBool(IsKnownGood());
+}
+
 HRESULT FileInfo::WriteSSDeep(ITableOutput& output)
 {
 #ifdef ORC_BUILD_SSDEEP
@@ -1846,9 +2136,37 @@ Intentions FileInfo::FilterIntentions(const std::vector<Filter>& filters)
                 intentions = static_cast<Intentions>(intentions & (Intentions)~item.intent);
         }
     });
+
+    if (HasAnyFlag(intentions, KnownGoodSkippedIntentions) && IsKnownGood())
+        intentions = static_cast<Intentions>(intentions & (Intentions)~KnownGoodSkippedIntentions);
+
     return intentions;
 }
 
+bool FileInfo::IsKnownGood()
+{
+    if (m_pKnownGood == nullptr)
+        return false;
+
+    if (m_bKnownGood.has_value())
+        return *m_bKnownGood;
+
+    m_bKnownGood = false;
+    if (IsDirectory())
+        return false;
+
+    const auto stream = GetFileStream();
+    if (stream == nullptr)
+        return false;
+
+    std::wstring_view name(m_szFullName, m_dwFullNameLen);
+    if (const auto pos = name.find_last_of(L'\\'); pos != std::wstring_view::npos)
+        name.remove_prefix(pos + 1);
+
+    m_bKnownGood = m_pKnownGood->Contains(name, *stream);
+    return *m_bKnownGood;
+}
+
 size_t FileInfo::FindVersionQueryValueRec(
     const WCHAR* szValueName,
     size_t dwValueCchLength,
@@ -9,9 +9,14 @@
 
 #include <vector>
 #include <memory>
+#include <optional>
 
+#include "AuthenticodePool.h"
+#include "CryptoHashStreamAlgorithm.h"
 #include "DataDetails.h"
 #include "FSUtils.h"
+#include "HashCache.h"
+#include "KnownGoodList.h"
 #include "PEInfo.h"
 
 #include "TableOutput.h"
@@ -29,9 +34,10 @@ class FileInfo : public IIntentionsHandler
 {
 public:
     friend class PEInfo;
+    friend class FileInfoPool;
 
     FileInfo(
-        std::wstring strComputerName,
+        std::wstring_view strComputerName,
         const std::shared_ptr<VolumeReader>& pVolReader,
         Intentions dwDefaultIntentions,
         const std::vector<Filter>& filters,
@@ -42,9 +48,44 @@ public:
 
     const WCHAR* GetFullName() const { return m_szFullName; }
 
+    // Components of a full name as _wsplitpath_s splits it, as views into the name
+    static std::wstring_view FileNameOf(std::wstring_view fullName);
+    static std::wstring_view ParentNameOf(std::wstring_view fullName);
+    static std::wstring_view ExtensionOf(std::wstring_view fullName);
+
+    // Verify the authenticode signature on 'pPool' once the pe hashes are known, the row collects it when it writes the
+    // authenticode columns (nullptr: verified in place when the columns are written)
+    void SetAuthenticodePool(AuthenticodePool* pPool) { m_pAuthenticodePool = pPool; }
+
+    // Files of the list are not hashed and their signature is not verified: the KnownGood column flags their rows
+    void SetKnownGood(const KnownGoodList* pKnownGood) { m_pKnownGood = pKnownGood; }
+    bool IsKnownGood();
+
+    using ColumnWriter = HRESULT (FileInfo::*)(ITableOutput& output);
+
+    // The columns of a run compiled once: rows are written by running the writer of each column in order, and the
+    // data the selected columns depend on is opened before the first of them
+    struct ColumnPlan
+    {
+        struct Step
+        {
+            const ColumnNameDef* Column = nullptr;
+            ColumnWriter Writer = nullptr;  // nullptr: the column is dispatched by HandleIntentions
+        };
+
+        std::vector<Step> Steps;
+        Intentions ColumnIntentions = Intentions::FILEINFO_NONE;
+    };
+
+    static ColumnPlan CompileColumnPlan(const ColumnNameDef columnNames[]);
+
     virtual HRESULT HandleIntentions(const Intentions& intention, ITableOutput& writer);
     HRESULT
     WriteFileInformation(const ColumnNameDef columnNames[], ITableOutput& output, const std::vector<Filter>& filters);
+    HRESULT WriteFileInformation(const ColumnPlan& plan, ITableOutput& output, const std::vector<Filter>& filters);
+
+    // Write one column of a row: its value when 'localIntentions' has it, nothing otherwise
+    HRESULT WriteColumn(const ColumnNameDef& column, Intentions localIntentions, ITableOutput& output);
 
     // abstract methods
     virtual bool IsDirectory() = 0;
@@ -81,15 +122,39 @@ protected:
 
     DWORD GetRequiredAccessMask(const ColumnNameDef columnNames[]);
 
+    // Writer of the column of 'intention', nullptr when this kind of file has none
+    static ColumnWriter GetColumnWriter(Intentions intention);
+    static ColumnPlan CompileColumnPlan(const ColumnNameDef columnNames[], ColumnWriter (*getWriter)(Intentions));
+
     // open methods
     HRESULT OpenFirstBytes();
     virtual HRESULT OpenHash();
     HRESULT OpenCryptoHash(Intentions localIntentions);
     HRESULT OpenFuzzyHash(Intentions localIntentions);
-    HRESULT OpenCryptoAndFuzzyHash(Intentions localIntentions);
+
+    // Read the data once for the first bytes and every hash required by 'localIntentions'
+    HRESULT OpenDataPass(Intentions localIntentions);
+
+    // Open upfront the data (hashes, first bytes, pe and version information) needed by the columns of 'intentions',
+    // failures are left to the columns to report
+    void OpenColumnData(Intentions intentions);
     HRESULT OpenAuthenticode();
 
+    // Submit the authenticode verification to the pool, if any, when 'localIntentions' has authenticode columns
+    void SubmitAuthenticode(Intentions localIntentions);
+
+    // Identity of the data stream in the run's hash cache, when it has one
+    virtual std::optional<HashCache::Key> GetHashCacheKey() const { return std::nullopt; }
+
+    // Content of the $CI.CATALOGHINT extended attribute, when the file has one
+    virtual std::optional<CBinaryBuffer> GetCatalogHint();
+
+    // Fill the hashes of 'algs' and the pe hashes of 'pe_algs' from the hash cache, true if all of them were cached
+    bool LoadCachedHashes(CryptoHashStreamAlgorithm algs, CryptoHashStreamAlgorithm pe_algs);
+    void StoreCachedHashes(CryptoHashStreamAlgorithm algs, CryptoHashStreamAlgorithm pe_algs);
+
     // write functions
+    HRESULT WriteNothing(ITableOutput& output) { return output.WriteNothing(); }
     HRESULT WriteComputerName(ITableOutput& output);
     virtual HRESULT WriteVolumeID(ITableOutput& output);
 
@@ -129,6 +194,9 @@ protected:
     HRESULT WriteMD5(ITableOutput& output);
     HRESULT WriteSHA1(ITableOutput& output);
     HRESULT WriteSHA256(ITableOutput& output);
+    HRESULT WriteBLAKE3(ITableOutput& output);
+
+    HRESULT WriteKnownGood(ITableOutput& output);
 
     HRESULT WriteSSDeep(ITableOutput& output);
 
@@ -152,7 +220,9 @@ protected:
     PEInfo m_PEInfo;
     HANDLE m_hFile = INVALID_HANDLE_VALUE;
 
-    std::wstring m_strComputerName;
+    // Rows are built for a single name: the computer name and the full name are borrowed from the caller which outlives
+    // them, an empty computer name is resolved when it is written
+    std::wstring_view m_strComputerName;
 
     const WCHAR* m_szFullName = nullptr;
     DWORD m_dwFullNameLen = 0LU;
@@ -164,6 +234,15 @@ protected:
     Authenticode& m_codeVerifyTrust;
 
 private:
+    AuthenticodePool* m_pAuthenticodePool = nullptr;
+    AuthenticodePool::Ticket m_AuthenticodeTicket;
+
+    const KnownGoodList* m_pKnownGood = nullptr;
+    std::optional<bool> m_bKnownGood;
+
+    // Intentions of the row being written with a column plan, its filters are evaluated once
+    std::optional<Intentions> m_RowIntentions;
+
     Intentions FilterIntentions(const std::vector<Filter>& Filters);
     bool FilterApplies(const Filter& filter);
 
@@ -181,6 +260,16 @@ private:
         const Authenticode::PE_Hashs& peHahs,
         Authenticode::AuthenticodeData& data);
 
+    // Fallback when the catalogs could not be checked with WinVerifyTrust: the catalog named by $CI.CATALOGHINT
+    HRESULT
+    VerifySignatureWithCatalogHint(const Authenticode::PE_Hashs& peHashes, Authenticode::AuthenticodeData& data);
+
+    HRESULT WriteColumn(
+        const ColumnNameDef& column,
+        ColumnWriter writer,
+        Intentions localIntentions,
+        ITableOutput& output);
+
     static const WCHAR* g_pszExecutableFileExtensions[];
     static const WCHAR* g_pszScriptFileExtensions[];
     static const WCHAR* g_pszArchiveFileExtensions[];
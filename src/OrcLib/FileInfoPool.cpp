@@ -0,0 +1,489 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileInfoPool.h"
+
+#include "ByteStream.h"
+#include "MemoryStream.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+const std::vector<Filter> kNoFilters;
+
+// FileInfo over the in memory copy of the data of a submitted row: it only evaluates data columns
+class PooledFileInfo : public FileInfo
+{
+public:
+    PooledFileInfo(
+        const std::wstring& strComputerName,
+        Intentions localIntentions,
+        const std::wstring& strFullName,
+        std::shared_ptr<ByteStream> stream,
+        std::optional<HashCache::Key> hashCacheKey,
+        std::optional<CBinaryBuffer> catalogHint,
+        Authenticode& verifier)
+        : FileInfo(
+            strComputerName,
+            nullptr,
+            localIntentions,
+            kNoFilters,
+            strFullName.c_str(),
+            static_cast<DWORD>(strFullName.size()),
+            verifier)
+        , m_Stream(std::move(stream))
+        , m_HashCacheKey(std::move(hashCacheKey))
+        , m_CatalogHint(std::move(catalogHint))
+    {
+    }
+
+    bool IsDirectory() override { return false; }
+    std::shared_ptr<ByteStream> GetFileStream() override { return m_Stream; }
+
+    const std::unique_ptr<DataDetails>& GetDetails() override
+    {
+        if (m_Details == nullptr)
+            m_Details.reset(new DataDetails());
+        return m_Details;
+    }
+
+    bool ExceedsFileThreshold(DWORD nFileSizeHigh, DWORD nFileSizeLow) override
+    {
+        ULARGE_INTEGER threshold;
+        threshold.HighPart = nFileSizeHigh;
+        threshold.LowPart = nFileSizeLow;
+        return m_Stream->GetSize() > threshold.QuadPart;
+    }
+
+protected:
+    HRESULT Open() override { return E_NOTIMPL; }
+
+    std::optional<HashCache::Key> GetHashCacheKey() const override { return m_HashCacheKey; }
+    std::optional<CBinaryBuffer> GetCatalogHint() override { return m_CatalogHint; }
+
+    // Values of the record, written by the submitting thread
+    HRESULT WriteShortName(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteAttributes(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteSizeInBytes(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteRecordInUse(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteCreationDate(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteLastModificationDate(ITableOutput&) override { return E_NOTIMPL; }
+    HRESULT WriteLastAccessDate(ITableOutput&) override { return E_NOTIMPL; }
+
+private:
+    std::shared_ptr<ByteStream> m_Stream;
+    std::unique_ptr<DataDetails> m_Details;
+    std::optional<HashCache::Key> m_HashCacheKey;
+    std::optional<CBinaryBuffer> m_CatalogHint;
+};
+
+Intentions AuthenticodeIntentions()
+{
+    return Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER
+        | Intentions::FILEINFO_AUTHENTICODE_SIGNER_THUMBPRINT | Intentions::FILEINFO_AUTHENTICODE_CA
+        | Intentions::FILEINFO_AUTHENTICODE_CA_THUMBPRINT;
+}
+
+HRESULT ReadData(ByteStream& stream, CBinaryBuffer& data)
+{
+    HRESULT hr = E_FAIL;
+
+    if (FAILED(hr = stream.SetFilePointer(0LL, FILE_BEGIN, NULL)))
+        return hr;
+
+    size_t cbData = 0;
+    while (cbData < data.GetCount())
+    {
+        ULONGLONG ullRead = 0LL;
+        if (FAILED(hr = stream.Read(data.GetData() + cbData, data.GetCount() - cbData, &ullRead)))
+            return hr;
+
+        if (ullRead == 0)
+            break;
+
+        cbData += static_cast<size_t>(ullRead);
+    }
+
+    // The stream can be shorter than its announced size
+    data.SetCount(cbData);
+    return S_OK;
+}
+
+// Names of a record share the data of its attributes: same record and attribute, and same version of the data
+bool IsSameData(const HashCache::Key& key, const HashCache::Key& other)
+{
+    return key.VolumeSerialNumber == other.VolumeSerialNumber && key.FRN == other.FRN
+        && key.DataInstance == other.DataInstance && key.DataSize == other.DataSize
+        && key.LastModificationTime == other.LastModificationTime;
+}
+
+}  // namespace
+
+Intentions FileInfoPool::DataIntentions()
+{
+    return Intentions::FILEINFO_MD5 | Intentions::FILEINFO_SHA1 | Intentions::FILEINFO_SHA256
+        | Intentions::FILEINFO_FIRST_BYTES | Intentions::FILEINFO_SSDEEP | Intentions::FILEINFO_TLSH
+        | Intentions::FILEINFO_VERSION | Intentions::FILEINFO_COMPANY | Intentions::FILEINFO_PRODUCT
+        | Intentions::FILEINFO_ORIGINALNAME | Intentions::FILEINFO_PLATFORM | Intentions::FILEINFO_TIMESTAMP
+        | Intentions::FILEINFO_SUBSYSTEM | Intentions::FILEINFO_FILETYPE | Intentions::FILEINFO_FILEOS
+        | Intentions::FILEINFO_PE_MD5 | Intentions::FILEINFO_PE_SHA1 | Intentions::FILEINFO_PE_SHA256
+        | Intentions::FILEINFO_SECURITY_DIRECTORY | Intentions::FILEINFO_SECURITY_DIRECTORY_SIZE
+        | Intentions::FILEINFO_SECURITY_DIRECTORY_SIGNATURE_SIZE | Intentions::FILEINFO_SIGNED_HASH
+        | Intentions::FILEINFO_BLAKE3 | AuthenticodeIntentions();
+}
+
+FileInfoPool::FileInfoPool(
+    const TableOutput::Schema& schema,
+    const ColumnNameDef columnNames[],
+    DWORD dwWorkers,
+    ULONGLONG ullMaxFileSize,
+    ULONGLONG ullMaxPendingBytes)
+    : m_Schema(schema)
+    , m_ColumnNames(columnNames)
+    , m_ullMaxFileSize(ullMaxFileSize)
+    , m_ullMaxPendingBytes(ullMaxPendingBytes)
+{
+    size_t columns = 0;
+    for (auto pCurCol = m_ColumnNames; pCurCol->dwIntention != Intentions::FILEINFO_NONE; pCurCol++)
+    {
+        columns++;
+    }
+
+    if (!m_Schema || m_Schema.size() != columns)
+    {
+        Log::Warn("Schema does not match the file information columns, data columns are evaluated by the walker");
+        return;
+    }
+
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        auto worker = std::make_unique<Worker>();
+
+        // Authenticode and its cache are not thread safe: each worker uses its own verifier
+        worker->Verifier.SetCache(std::make_shared<AuthenticodeCache>());
+
+        if (FAILED(worker->Row.SetSchema(m_Schema, 1)) || FAILED(worker->Rows.SetSchema(m_Schema)))
+            break;
+
+        m_Workers.push_back(std::move(worker));
+    }
+
+    for (const auto& worker : m_Workers)
+    {
+        worker->Thread = std::thread([this, pWorker = worker.get()]() { Work(*pWorker); });
+    }
+
+    Log::Debug(
+        "File information pool started (workers: {}, max file size: {} bytes, pending: {} bytes)",
+        m_Workers.size(),
+        m_ullMaxFileSize,
+        m_ullMaxPendingBytes);
+}
+
+FileInfoPool::~FileInfoPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+
+    m_JobReady.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker->Thread.join();
+    }
+
+    Log::Debug(
+        "File information pool stopped (rows: {}, shared data rows: {}, throttled submissions: {}, dropped jobs: {})",
+        m_ullSubmittedRows,
+        m_ullSharedRows,
+        m_ullThrottled,
+        m_Jobs.size() + m_OpenJobs.size());
+}
+
+std::unique_ptr<TableOutput::RecordBatch> FileInfoPool::AcquireRecord()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (!m_FreeRecords.empty())
+        {
+            auto record = std::move(m_FreeRecords.back());
+            m_FreeRecords.pop_back();
+            return record;
+        }
+    }
+
+    return std::make_unique<TableOutput::RecordBatch>(m_Schema, 1);
+}
+
+std::unique_ptr<TableOutput::RecordBatch> FileInfoPool::WriteRecord(FileInfo& fileInfo, Intentions localIntentions)
+{
+    auto record = AcquireRecord();
+    for (auto pCurCol = m_ColumnNames; pCurCol->dwIntention != Intentions::FILEINFO_NONE; pCurCol++)
+    {
+        if (HasFlag(DataIntentions(), pCurCol->dwIntention))
+            record->WriteNothing();
+        else
+            fileInfo.WriteColumn(*pCurCol, localIntentions, *record);
+    }
+    record->WriteEndOfLine();
+    return record;
+}
+
+HRESULT FileInfoPool::Submit(FileInfo& fileInfo)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_Workers.empty())
+        return S_FALSE;
+
+    const auto localIntentions = fileInfo.FilterIntentions(fileInfo.m_Filters);
+    if (!HasAnyFlag(localIntentions, DataIntentions()) || fileInfo.IsDirectory())
+        return S_FALSE;
+
+    // Another name of a data attribute already submitted: the row is evaluated with the same data
+    const auto hashCacheKey = fileInfo.GetHashCacheKey();
+    if (hashCacheKey)
+    {
+        for (const auto& job : m_OpenJobs)
+        {
+            if (job->LocalIntentions == (localIntentions & DataIntentions())
+                && IsSameData(*job->HashCacheKey, *hashCacheKey))
+            {
+                job->Records.push_back(WriteRecord(fileInfo, localIntentions));
+                m_ullSharedRows++;
+                return S_OK;
+            }
+        }
+
+        if (!m_OpenJobs.empty()
+            && (m_OpenJobs.front()->HashCacheKey->FRN != hashCacheKey->FRN
+                || m_OpenJobs.front()->HashCacheKey->VolumeSerialNumber != hashCacheKey->VolumeSerialNumber))
+        {
+            QueueOpenJobs();
+        }
+    }
+    else
+    {
+        QueueOpenJobs();
+    }
+
+    auto stream = fileInfo.GetFileStream();
+    if (stream == nullptr)
+        return S_FALSE;
+
+    const auto ullSize = stream->GetSize();
+    if (ullSize == 0 || ullSize > m_ullMaxFileSize)
+        return S_FALSE;
+
+    auto job = std::make_unique<Job>();
+    if (!job->Data.SetCount(static_cast<size_t>(ullSize)))
+        return S_FALSE;
+
+    if (FAILED(hr = ReadData(*stream, job->Data)) || job->Data.GetCount() == 0)
+    {
+        Log::Debug(
+            L"Failed to read data of '{}', columns are evaluated in place [{}]",
+            fileInfo.m_szFullName,
+            SystemError(hr));
+        return S_FALSE;
+    }
+
+    job->strComputerName = fileInfo.m_strComputerName;
+    job->strFullName.assign(fileInfo.m_szFullName, fileInfo.m_dwFullNameLen);
+    job->LocalIntentions = localIntentions & DataIntentions();
+    job->HashCacheKey = hashCacheKey;
+
+    if (HasAnyFlag(localIntentions, AuthenticodeIntentions()))
+        job->CatalogHint = fileInfo.GetCatalogHint();
+
+    job->Records.push_back(WriteRecord(fileInfo, localIntentions));
+
+    // Other names of the record may follow
+    if (job->HashCacheKey)
+        m_OpenJobs.push_back(std::move(job));
+    else
+        Queue(std::move(job));
+
+    return S_OK;
+}
+
+void FileInfoPool::QueueOpenJobs()
+{
+    for (auto& job : m_OpenJobs)
+    {
+        Queue(std::move(job));
+    }
+
+    m_OpenJobs.clear();
+}
+
+void FileInfoPool::Queue(std::unique_ptr<Job> job)
+{
+    const ULONGLONG cbBytes = job->Data.GetCount();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    const auto hasRoom = [this, cbBytes]() {
+        return m_ullPendingBytes == 0 || m_ullPendingBytes + cbBytes <= m_ullMaxPendingBytes;
+    };
+
+    if (!hasRoom())
+    {
+        m_ullThrottled++;
+        m_JobDone.wait(lock, hasRoom);
+    }
+
+    m_ullSubmittedRows += job->Records.size();
+    m_Jobs.push_back(std::move(job));
+    m_ullPendingBytes += cbBytes;
+
+    lock.unlock();
+    m_JobReady.notify_one();
+}
+
+HRESULT FileInfoPool::Collect(ITableOutput& output, bool bWait)
+{
+    HRESULT hr = S_OK;
+
+    if (bWait)
+    {
+        QueueOpenJobs();
+
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_JobDone.wait(lock, [this]() { return m_Jobs.empty() && m_ullRunningJobs == 0; });
+    }
+
+    for (const auto& worker : m_Workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->Mutex);
+        if (worker->Rows.empty())
+            continue;
+
+        if (auto hrRows = worker->Rows.WriteTo(output); FAILED(hrRows))
+            hr = hrRows;
+
+        worker->Rows.Clear();
+    }
+
+    return hr;
+}
+
+void FileInfoPool::Work(Worker& worker)
+{
+    for (;;)
+    {
+        std::unique_ptr<Job> job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobReady.wait(lock, [this]() { return m_bStop || !m_Jobs.empty(); });
+
+            if (m_bStop)
+            {
+                return;
+            }
+
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+            m_ullRunningJobs++;
+        }
+
+        if (auto hr = WriteRows(worker, *job); FAILED(hr))
+        {
+            Log::Debug(L"Failed to write file information of '{}' [{}]", job->strFullName, SystemError(hr));
+        }
+
+        const ULONGLONG cbBytes = job->Data.GetCount();
+
+        // Release the data before making room for the next submissions
+        job->Data.RemoveAll();
+        for (auto& record : job->Records)
+        {
+            record->Clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ullPendingBytes -= cbBytes;
+            m_ullRunningJobs--;
+            for (auto& record : job->Records)
+            {
+                m_FreeRecords.push_back(std::move(record));
+            }
+        }
+
+        m_JobDone.notify_all();
+    }
+}
+
+HRESULT FileInfoPool::WriteRows(Worker& worker, Job& job)
+{
+    HRESULT hr = E_FAIL;
+
+    auto stream = std::make_shared<MemoryStream>();
+    if (FAILED(hr = stream->OpenForReadOnly(job.Data.GetData(), job.Data.GetCount())))
+        return hr;
+
+    // The details of the data are evaluated with the first row and reused by the rows of the other names
+    PooledFileInfo fileInfo(
+        job.strComputerName,
+        job.LocalIntentions,
+        job.strFullName,
+        std::move(stream),
+        std::move(job.HashCacheKey),
+        std::move(job.CatalogHint),
+        worker.Verifier);
+
+    hr = S_OK;
+
+    for (const auto& record : job.Records)
+    {
+        try
+        {
+            DWORD dwColumn = 0;
+            for (auto pCurCol = m_ColumnNames; pCurCol->dwIntention != Intentions::FILEINFO_NONE;
+                 pCurCol++, dwColumn++)
+            {
+                if (HasFlag(DataIntentions(), pCurCol->dwIntention))
+                    fileInfo.WriteColumn(*pCurCol, job.LocalIntentions, worker.Row);
+                else
+                    (*record)[dwColumn].WriteTo(worker.Row, 0);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            Log::Error("File information evaluation failed with an exception: {}", e.what());
+            worker.Row.AbandonRow();
+            hr = E_FAIL;
+        }
+
+        if (auto hrLine = worker.Row.WriteEndOfLine(); FAILED(hrLine))
+        {
+            worker.Row.Clear();
+            hr = hrLine;
+            continue;
+        }
+
+        // The row is evaluated without the lock: Collect only waits for this copy
+        {
+            std::lock_guard<std::mutex> lock(worker.Mutex);
+            if (auto hrRow = worker.Row.WriteTo(worker.Rows); FAILED(hrRow))
+                hr = hrRow;
+        }
+
+        worker.Row.Clear();
+    }
+
+    return hr;
+}
@@ -0,0 +1,134 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "FileInfo.h"
+#include "TableOutputBatch.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Evaluate the data columns of FileInfo rows (hashes, first bytes, PE details, version information, authenticode) on
+// worker threads.
+//
+// Rows are submitted by the thread owning the volume reader: it writes the other columns of the row and reads the data
+// into memory. A worker then evaluates the data columns from this copy, with its own authenticode verifier, and appends
+// the complete row to its own row batch. Collect writes the rows of all the batches to the output, in completion order.
+// Submitting blocks while the data of the queued rows exceeds the pending size.
+//
+// The rows of the names of a record are submitted one after the other: rows of the same data attribute (same hash cache
+// key and columns) are grouped in a single job, its data is read and evaluated once for all of them. A job is queued
+// when a row of another record is submitted or when Collect waits.
+class FileInfoPool
+{
+public:
+    // Columns which need the data of the file
+    static Intentions DataIntentions();
+
+    // 'schema' is the output schema of the rows of 'columnNames', a schema of another size leaves the pool without workers
+    FileInfoPool(
+        const TableOutput::Schema& schema,
+        const ColumnNameDef columnNames[],
+        DWORD dwWorkers,
+        ULONGLONG ullMaxFileSize,
+        ULONGLONG ullMaxPendingBytes);
+    ~FileInfoPool();
+
+    FileInfoPool(const FileInfoPool&) = delete;
+    FileInfoPool& operator=(const FileInfoPool&) = delete;
+
+    DWORD Workers() const { return static_cast<DWORD>(m_Workers.size()); }
+
+    // S_FALSE when the row is not for the pool (no data column, no data, data larger than the maximum file size...) and
+    // must be written by the caller, 'fileInfo' is not used once this returns
+    HRESULT Submit(FileInfo& fileInfo);
+
+    // Write the rows completed since last call to 'output', 'bWait' waits for all the submitted rows
+    HRESULT Collect(ITableOutput& output, bool bWait = false);
+
+    ULONGLONG SubmittedRows() const { return m_ullSubmittedRows; }
+
+    // Rows evaluated with the data of a previous row of the same data attribute
+    ULONGLONG SharedRows() const { return m_ullSharedRows; }
+
+private:
+    struct Job
+    {
+        std::wstring strComputerName;
+        std::wstring strFullName;
+        Intentions LocalIntentions = Intentions::FILEINFO_NONE;
+
+        CBinaryBuffer Data;
+        std::optional<HashCache::Key> HashCacheKey;
+        std::optional<CBinaryBuffer> CatalogHint;
+
+        // Values of the other columns of each row of the data, written by the submitting thread
+        std::vector<std::unique_ptr<TableOutput::RecordBatch>> Records;
+    };
+
+    struct Worker
+    {
+        Authenticode Verifier;
+
+        // Row being evaluated, then appended to the rows waiting for Collect
+        TableOutput::RecordBatch Row;
+
+        std::mutex Mutex;
+        TableOutput::RecordBatch Rows;
+
+        std::thread Thread;
+    };
+
+    void Work(Worker& worker);
+    HRESULT WriteRows(Worker& worker, Job& job);
+
+    std::unique_ptr<TableOutput::RecordBatch> AcquireRecord();
+    std::unique_ptr<TableOutput::RecordBatch> WriteRecord(FileInfo& fileInfo, Intentions localIntentions);
+
+    // Queue the jobs waiting for other rows of their record
+    void QueueOpenJobs();
+    void Queue(std::unique_ptr<Job> job);
+
+    const TableOutput::Schema m_Schema;
+    const ColumnNameDef* m_ColumnNames;
+    const ULONGLONG m_ullMaxFileSize;
+    const ULONGLONG m_ullMaxPendingBytes;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobReady;
+    std::condition_variable m_JobDone;
+
+    std::deque<std::unique_ptr<Job>> m_Jobs;
+
+    // Jobs of the last submitted record, only used by the submitting thread
+    std::vector<std::unique_ptr<Job>> m_OpenJobs;
+    std::vector<std::unique_ptr<TableOutput::RecordBatch>> m_FreeRecords;
+    ULONGLONG m_ullPendingBytes = 0LL;
+    ULONGLONG m_ullRunningJobs = 0LL;
+    bool m_bStop = false;
+
+    ULONGLONG m_ullSubmittedRows = 0LL;
+    ULONGLONG m_ullSharedRows = 0LL;
+    ULONGLONG m_ullThrottled = 0LL;
+
+    std::vector<std::unique_ptr<Worker>> m_Workers;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
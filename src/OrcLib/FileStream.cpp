@@ -14,8 +14,17 @@
 
 #include "Kernel32Extension.h"
 
+#include <algorithm>
+
 using namespace Orc;
 
+struct FileStream::AsyncRequest
+{
+    OVERLAPPED Overlapped;
+    FileStream* pStream;
+    Completion completion;
+};
+
 STDMETHODIMP Orc::FileStream::Clone(std::shared_ptr<ByteStream>& clone)
 {
     auto new_stream = std::make_shared<Orc::FileStream>();
@@ -41,12 +50,25 @@ STDMETHODIMP Orc::FileStream::Clone(std::shared_ptr<ByteStream>& clone)
 */
 HRESULT FileStream::Close()
 {
+    WaitForAsync();
+
     HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hAsyncRead = INVALID_HANDLE_VALUE;
+    HANDLE hAsyncWrite = INVALID_HANDLE_VALUE;
     {
         ScopedLock sl(m_cs);
         std::swap(m_hFile, hFile);
+        std::swap(m_hAsyncRead, hAsyncRead);
+        std::swap(m_hAsyncWrite, hAsyncWrite);
+        m_bAsyncReadFailed = false;
+        m_bAsyncWriteFailed = false;
     }
 
+    if (hAsyncRead != INVALID_HANDLE_VALUE)
+        CloseHandle(hAsyncRead);
+    if (hAsyncWrite != INVALID_HANDLE_VALUE)
+        CloseHandle(hAsyncWrite);
+
     if (hFile != INVALID_HANDLE_VALUE)
     {
         CloseHandle(hFile);
@@ -299,6 +321,190 @@ FileStream::Write_(__in_bcount(cbBytes) const PVOID pBuffer, __in ULONGLONG cbBy
     return S_OK;
 }
 
+STDMETHODIMP FileStream::CanReadAsync()
+{
+    ScopedLock sl(m_cs);
+
+    if (m_hFile == INVALID_HANDLE_VALUE || GetFileType(m_hFile) != FILE_TYPE_DISK)
+        return S_FALSE;
+
+    return GetAsyncHandle(false) != INVALID_HANDLE_VALUE ? S_OK : S_FALSE;
+}
+
+HANDLE FileStream::GetAsyncHandle(bool bWrite)
+{
+    auto& hAsync = bWrite ? m_hAsyncWrite : m_hAsyncRead;
+    auto& bFailed = bWrite ? m_bAsyncWriteFailed : m_bAsyncReadFailed;
+
+    if (hAsync != INVALID_HANDLE_VALUE || bFailed)
+        return hAsync;
+
+    bFailed = true;
+
+    const auto pk32 = ExtensionLibrary::GetLibrary<Kernel32Extension>();
+    if (pk32 == nullptr)
+        return INVALID_HANDLE_VALUE;
+
+    HANDLE hFile = pk32->ReOpenFile(
+        m_hFile,
+        bWrite ? GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        FILE_FLAG_OVERLAPPED);
+    if (hFile == INVALID_HANDLE_VALUE)
+    {
+        Log::Debug(L"Failed to reopen '{}' for overlapped I/O [{}]", m_strPath, LastWin32Error());
+        return INVALID_HANDLE_VALUE;
+    }
+
+    if (!BindIoCompletionCallback(hFile, OnAsyncCompletion, 0L))
+    {
+        Log::Debug(L"Failed BindIoCompletionCallback for '{}' [{}]", m_strPath, LastWin32Error());
+        CloseHandle(hFile);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    bFailed = false;
+    hAsync = hFile;
+    return hAsync;
+}
+
+VOID CALLBACK FileStream::OnAsyncCompletion(DWORD dwErrorCode, DWORD dwBytes, LPOVERLAPPED pOverlapped)
+{
+    std::unique_ptr<AsyncRequest> request(CONTAINING_RECORD(pOverlapped, AsyncRequest, Overlapped));
+
+    // A read past the end of the file is not an error, it transfers nothing
+    const HRESULT hr = dwErrorCode == ERROR_SUCCESS || dwErrorCode == ERROR_HANDLE_EOF
+        ? S_OK
+        : HRESULT_FROM_WIN32(dwErrorCode);
+    if (FAILED(hr))
+        Log::Error(L"Failed overlapped I/O on '{}' [{}]", request->pStream->m_strPath, SystemError(hr));
+
+    request->completion(hr, SUCCEEDED(hr) ? dwBytes : 0LL);
+
+    auto pStream = request->pStream;
+    request.reset();
+
+    std::lock_guard<std::mutex> lock(pStream->m_asyncMutex);
+    if (--pStream->m_ulAsyncPending == 0)
+        pStream->m_asyncIdle.notify_all();
+}
+
+HRESULT FileStream::StartAsync(bool bWrite, PVOID pBuffer, ULONGLONG cbBytes, Completion& completion)
+{
+    if (cbBytes > MAXDWORD)
+        return E_INVALIDARG;
+
+    ScopedLock sl(m_cs);
+
+    const auto hAsync = GetAsyncHandle(bWrite);
+    if (hAsync == INVALID_HANDLE_VALUE)
+        return S_FALSE;
+
+    LARGE_INTEGER liPosition = {0};
+    if (!SetFilePointerEx(m_hFile, liPosition, &liPosition, FILE_CURRENT))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed SetFilePointerEx [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (!bWrite)
+    {
+        const auto ullSize = GetSize();
+        if (ullSize == ULONG64(-1))
+            return E_FAIL;
+
+        cbBytes = static_cast<ULONGLONG>(liPosition.QuadPart) < ullSize
+            ? std::min<ULONGLONG>(cbBytes, ullSize - liPosition.QuadPart)
+            : 0LL;
+    }
+
+    if (cbBytes == 0)
+    {
+        completion(S_OK, 0LL);
+        return S_OK;
+    }
+
+    auto request = std::make_unique<AsyncRequest>();
+    ZeroMemory(&request->Overlapped, sizeof(OVERLAPPED));
+    request->Overlapped.Offset = liPosition.LowPart;
+    request->Overlapped.OffsetHigh = liPosition.HighPart;
+    request->pStream = this;
+    request->completion = std::move(completion);
+
+    // The next operation starts after this one
+    LARGE_INTEGER liDistance = {0};
+    liDistance.QuadPart = cbBytes;
+    if (!SetFilePointerEx(m_hFile, liDistance, NULL, FILE_CURRENT))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed SetFilePointerEx [{}]", SystemError(hr));
+        completion = std::move(request->completion);
+        return hr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_ulAsyncPending++;
+    }
+
+    const auto pOverlapped = &request->Overlapped;
+    const BOOL bDone = bWrite ? WriteFile(hAsync, pBuffer, static_cast<DWORD>(cbBytes), NULL, pOverlapped)
+                              : ReadFile(hAsync, pBuffer, static_cast<DWORD>(cbBytes), NULL, pOverlapped);
+    const DWORD dwError = bDone ? ERROR_SUCCESS : GetLastError();
+
+    if (dwError == ERROR_SUCCESS || dwError == ERROR_IO_PENDING)
+    {
+        // Completion port now owns the request, even when the operation completed synchronously
+        request.release();
+        return S_OK;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        if (--m_ulAsyncPending == 0)
+            m_asyncIdle.notify_all();
+    }
+
+    // Restore the position of the operation which did not start
+    SetFilePointerEx(m_hFile, liPosition, NULL, FILE_BEGIN);
+
+    if (dwError == ERROR_HANDLE_EOF)
+    {
+        request->completion(S_OK, 0LL);
+        return S_OK;
+    }
+
+    const auto hr = HRESULT_FROM_WIN32(dwError);
+    Log::Error(L"Failed to start overlapped I/O on '{}' [{}]", m_strPath, SystemError(hr));
+    completion = std::move(request->completion);
+    return hr;
+}
+
+HRESULT FileStream::ReadAsync_(PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    auto hr = StartAsync(false, pBuffer, cbBytes, completion);
+    if (hr == S_FALSE)
+        return ByteStream::ReadAsync_(pBuffer, cbBytes, std::move(completion));
+
+    return hr;
+}
+
+HRESULT FileStream::WriteAsync_(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion)
+{
+    auto hr = StartAsync(true, pBuffer, cbBytes, completion);
+    if (hr == S_FALSE)
+        return ByteStream::WriteAsync_(pBuffer, cbBytes, std::move(completion));
+
+    return hr;
+}
+
+void FileStream::WaitForAsync()
+{
+    std::unique_lock<std::mutex> lock(m_asyncMutex);
+    m_asyncIdle.wait(lock, [this]() { return m_ulAsyncPending == 0; });
+}
+
 /*
     CFileStream:SetFilePointer
 
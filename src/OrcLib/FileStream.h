@@ -10,7 +10,9 @@
 
 #include "OrcLib.h"
 
+#include <condition_variable>
 #include <filesystem>
+#include <mutex>
 
 #include "ByteStream.h"
 #include "CriticalSection.h"
@@ -40,6 +42,7 @@ public:
     STDMETHOD(CanRead)() { return S_OK; };
     STDMETHOD(CanWrite)() { return S_OK; };
     STDMETHOD(CanSeek)() { return S_OK; };
+    STDMETHOD(CanReadAsync)();
 
     HRESULT OpenFile(
         __in PCWSTR pwzPath,
@@ -100,9 +103,33 @@ public:
     STDMETHOD(Close)();
 
 protected:
+    // Overlapped operations go through handles reopened from m_hFile and bound to the system thread pool, the position
+    // of m_hFile is moved when they are started
+    HRESULT ReadAsync_(PVOID pBuffer, ULONGLONG cbBytes, Completion completion) override;
+    HRESULT WriteAsync_(const PVOID pBuffer, ULONGLONG cbBytes, Completion completion) override;
+
     HANDLE m_hFile = INVALID_HANDLE_VALUE;
     std::wstring m_strPath;
     CriticalSection m_cs;
+
+private:
+    struct AsyncRequest;
+
+    static VOID CALLBACK OnAsyncCompletion(DWORD dwErrorCode, DWORD dwBytes, LPOVERLAPPED pOverlapped);
+
+    // Overlapped handle for reads or writes, opened on first use (INVALID_HANDLE_VALUE if it cannot be)
+    HANDLE GetAsyncHandle(bool bWrite);
+    HRESULT StartAsync(bool bWrite, PVOID pBuffer, ULONGLONG cbBytes, Completion& completion);
+    void WaitForAsync();
+
+    HANDLE m_hAsyncRead = INVALID_HANDLE_VALUE;
+    HANDLE m_hAsyncWrite = INVALID_HANDLE_VALUE;
+    bool m_bAsyncReadFailed = false;
+    bool m_bAsyncWriteFailed = false;
+
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncIdle;
+    ULONG m_ulAsyncPending = 0L;
 };
 
 }  // namespace Orc
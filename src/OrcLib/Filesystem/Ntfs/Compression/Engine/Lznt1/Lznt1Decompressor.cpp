@@ -0,0 +1,203 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2021 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "Lznt1Decompressor.h"
+
+#include <cstring>
+
+#include <intrin.h>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kChunkSize = 4096;
+constexpr uint16_t kChunkSizeMask = 0x0FFF;
+constexpr uint16_t kChunkCompressed = 0x8000;
+constexpr size_t kMinMatchLength = 3;
+
+inline uint16_t ReadLE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// Offset and length of a back reference share 16 bits: the more data already decoded in the chunk the more bits
+// for the offset (4 bits up to 16 bytes, then one more for each doubling)
+inline unsigned GetLengthBits(size_t position)
+{
+    unsigned long index = 0;
+    if (!_BitScanReverse(&index, static_cast<unsigned long>(position - 1)) || index < 4)
+    {
+        return 12;
+    }
+
+    return 12 - (index - 3);
+}
+
+inline void Copy8(uint8_t* dst, const uint8_t* src)
+{
+    uint64_t value;
+    std::memcpy(&value, src, sizeof(value));
+    std::memcpy(dst, &value, sizeof(value));
+}
+
+// 'dst' may overlap the source of the match: this is how LZNT1 encodes runs
+inline void CopyMatch(uint8_t* dst, size_t offset, size_t length, const uint8_t* dstLimit)
+{
+    const uint8_t* src = dst - offset;
+
+    // With 8 bytes or more between them every load reads bytes already written, the last store can go past 'length'
+    const size_t wideLength = (length + 7) & ~static_cast<size_t>(7);
+    if (offset >= sizeof(uint64_t) && static_cast<size_t>(dstLimit - dst) >= wideLength)
+    {
+        for (size_t i = 0; i < length; i += sizeof(uint64_t))
+        {
+            Copy8(dst + i, src + i);
+        }
+        return;
+    }
+
+    if (offset == 1)
+    {
+        std::memset(dst, *src, length);
+        return;
+    }
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        dst[i] = src[i];
+    }
+}
+
+// Decode a compressed chunk at 'chunkStart', returns the end of the decoded data
+uint8_t* DecompressChunk(BufferView chunk, uint8_t* chunkStart, const uint8_t* chunkLimit, std::error_code& ec)
+{
+    const uint8_t* src = chunk.data();
+    const uint8_t* const srcEnd = src + chunk.size();
+    uint8_t* dst = chunkStart;
+
+    while (src < srcEnd)
+    {
+        uint8_t flags = *src++;
+        for (int bit = 0; bit < 8 && src < srcEnd; ++bit, flags >>= 1)
+        {
+            if ((flags & 1) == 0)
+            {
+                if (dst >= chunkLimit)
+                {
+                    ec = std::make_error_code(std::errc::no_buffer_space);
+                    return dst;
+                }
+
+                *dst++ = *src++;
+                continue;
+            }
+
+            if (srcEnd - src < 2)
+            {
+                ec = std::make_error_code(std::errc::bad_message);
+                return dst;
+            }
+
+            const uint16_t token = ReadLE16(src);
+            src += 2;
+
+            const size_t position = dst - chunkStart;
+            if (position == 0)
+            {
+                ec = std::make_error_code(std::errc::bad_message);
+                return dst;
+            }
+
+            const unsigned lengthBits = GetLengthBits(position);
+            const size_t offset = (token >> lengthBits) + 1;
+            const size_t length = (token & ((1U << lengthBits) - 1)) + kMinMatchLength;
+            if (offset > position || length > static_cast<size_t>(chunkLimit - dst))
+            {
+                ec = std::make_error_code(std::errc::bad_message);
+                return dst;
+            }
+
+            CopyMatch(dst, offset, length, chunkLimit);
+            dst += length;
+        }
+    }
+
+    return dst;
+}
+
+}  // namespace
+
+namespace Orc {
+
+size_t Lznt1Decompress(BufferView input, gsl::span<uint8_t> output, std::error_code& ec)
+{
+    uint8_t* const out = output.data();
+    size_t in = 0;
+    size_t decoded = 0;
+    size_t chunkBase = 0;
+
+    while (input.size() - in >= sizeof(uint16_t))
+    {
+        const uint16_t header = ReadLE16(input.data() + in);
+        if (header == 0)
+        {
+            break;
+        }
+
+        const size_t chunkSize = (header & kChunkSizeMask) + 1;
+        if (chunkSize > input.size() - in - sizeof(uint16_t))
+        {
+            Log::Debug("Truncated LZNT1 chunk (offset: {}, size: {})", in, chunkSize);
+            ec = std::make_error_code(std::errc::bad_message);
+            return decoded;
+        }
+
+        if (chunkBase >= output.size())
+        {
+            Log::Debug("LZNT1 output buffer is too small (size: {})", output.size());
+            ec = std::make_error_code(std::errc::no_buffer_space);
+            return decoded;
+        }
+
+        // Every chunk but the last one decodes to a complete 4096 bytes chunk
+        std::memset(out + decoded, 0, chunkBase - decoded);
+
+        const auto chunk = input.subspan(in + sizeof(uint16_t), chunkSize);
+        const auto chunkLimit = out + std::min(chunkBase + kChunkSize, output.size());
+        if (header & kChunkCompressed)
+        {
+            decoded = DecompressChunk(chunk, out + chunkBase, chunkLimit, ec) - out;
+            if (ec)
+            {
+                Log::Debug("Invalid LZNT1 chunk (offset: {}, decoded: {}) [{}]", in, decoded, ec);
+                return decoded;
+            }
+        }
+        else
+        {
+            if (chunkSize > static_cast<size_t>(chunkLimit - (out + chunkBase)))
+            {
+                ec = std::make_error_code(std::errc::no_buffer_space);
+                return decoded;
+            }
+
+            std::memcpy(out + chunkBase, chunk.data(), chunkSize);
+            decoded = chunkBase + chunkSize;
+        }
+
+        in += sizeof(uint16_t) + chunkSize;
+        chunkBase += kChunkSize;
+    }
+
+    return decoded;
+}
+
+}  // namespace Orc
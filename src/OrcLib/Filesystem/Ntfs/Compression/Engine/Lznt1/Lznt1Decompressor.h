@@ -0,0 +1,36 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2021 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <system_error>
+
+#include "Utils/BufferView.h"
+
+namespace Orc {
+
+//
+// LZNT1 decoder (NTFS compression units, COMPRESSION_FORMAT_LZNT1)
+//
+// 'input' is a sequence of chunks each decoding to 4096 bytes but the last one. A chunk decoding to less is zero padded
+// like RtlDecompressBuffer does. Decodes straight into 'output' without any allocation and returns the size of the
+// decoded data: the bytes of 'output' past it are unspecified (back references are copied 8 bytes at a time and can
+// write up to 7 bytes past their end).
+//
+size_t Lznt1Decompress(BufferView input, gsl::span<uint8_t> output, std::error_code& ec);
+
+class Lznt1DecompressorConcept
+{
+public:
+    size_t Decompress(BufferView input, gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        return Lznt1Decompress(input, output, ec);
+    }
+};
+
+}  // namespace Orc
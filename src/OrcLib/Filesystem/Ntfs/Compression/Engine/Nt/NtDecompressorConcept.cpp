@@ -11,6 +11,7 @@
 #include "NtDecompressorConcept.h"
 
 #include "Filesystem/Ntfs/Compression/Engine/Nt/NtApi.h"
+#include "Filesystem/Ntfs/Compression/Engine/Lznt1/Lznt1Decompressor.h"
 #include "Log/Log.h"
 #include "Utils/BufferView.h"
 
@@ -96,7 +97,11 @@ size_t NtDecompressorConcept::Decompress(BufferView input, gsl::span<uint8_t> ou
     ULONG processed = 0;
     switch (m_ntAlgorithm)
     {
-        case NtAlgorithm::kLznt1:
+        case NtAlgorithm::kLznt1: {
+            // Faster than RtlDecompressBuffer which decodes byte per byte
+            processed = static_cast<ULONG>(Lznt1Decompress(input, output, ec));
+            break;
+        }
         case NtAlgorithm::kXpress: {
             RtlDecompressBuffer(
                 std::underlying_type_t<NtAlgorithm>(m_ntAlgorithm),
@@ -9,10 +9,15 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
 
 #include <fmt/format.h>
 
 #include "Filesystem/Ntfs/Compression/WofChunks.h"
+#include "WofChunkCache.h"
 #include "Stream/SeekDirection.h"
 #include "Stream/StreamUtils.h"
 #include "Utils/MetaPtr.h"
@@ -25,6 +30,7 @@ class WofStreamConcept
 {
 public:
     using ChunkBufferT = fmt::basic_memory_buffer<uint8_t, WofChunks::kDefaultChunkSize>;
+    using DecompressorFactoryT = std::function<DecompressorT(std::error_code& ec)>;
 
     // Required by ByteStream interface
     WofStreamConcept()
@@ -173,7 +179,62 @@ public:
 
     const uint64_t UncompressedSize() const { return m_chunks.UncompressedSize(); }
 
+    // Decompress the 'chunkCount' chunks following the one being read on the thread pool, each with its own
+    // decompressor from 'factory'. Raw chunks are still read from the calling thread as the input stream is not
+    // shared. A 'chunkCount' lower than 2 restores the synchronous decompression.
+    void EnableReadAhead(size_t chunkCount, const DecompressorFactoryT& factory, std::error_code& ec)
+    {
+        m_readAhead.clear();
+        if (chunkCount < 2)
+        {
+            return;
+        }
+
+        decltype(m_readAhead) slots;
+        for (size_t i = 0; i < chunkCount; ++i)
+        {
+            auto slot = std::make_unique<ReadAheadChunk>(factory(ec));
+            if (ec)
+            {
+                Log::Debug("Failed to create read ahead decompressor [{}]", ec);
+                return;
+            }
+
+            slot->output.resize(m_chunks.ChunkSize());
+            slots.push_back(std::move(slot));
+        }
+
+        m_readAhead = std::move(slots);
+    }
+
+    // Share the decompressed chunks of this stream with the other streams of the same file ('fileId' from
+    // WofChunkCache::GetFileId)
+    void SetChunkCache(WofChunkCache& cache, uint64_t fileId)
+    {
+        m_chunkCache = &cache;
+        m_cacheFileId = fileId;
+    }
+
 private:
+    // Chunk 'i' is decoded in slot 'i % m_readAhead.size()': the chunks in flight always fit in the window
+    struct ReadAheadChunk
+    {
+        explicit ReadAheadChunk(DecompressorT decompressor)
+            : decompressor(std::move(decompressor))
+            , chunkIndex(0)
+        {
+        }
+
+        MetaPtr<DecompressorT> decompressor;
+        uint64_t chunkIndex;
+        ChunkBufferT input;
+        ChunkBufferT output;
+        std::error_code ec;
+
+        // Declared last so it is destroyed first, waiting for the worker still using the buffers above
+        std::future<size_t> pending;
+    };
+
     void BuildChunkTable(gsl::span<WofChunks::ChunkLocation>& table, std::error_code& ec)
     {
         // A stack buffer of 8192 bytes it should be able to hold 16MB of compressed data
@@ -262,6 +323,33 @@ private:
         // BEWARE: 'output' must be big enough to store the complete decompressed chunk
         assert(output.size() >= m_chunks.ChunkSize());
 
+        if (m_chunkCache == nullptr)
+        {
+            return DecodeCompleteChunk(chunkIndex, output, ec);
+        }
+
+        DWORD dwCached = 0;
+        if (m_chunkCache->Lookup(m_cacheFileId, chunkIndex, output.data(), dwCached))
+        {
+            return dwCached;
+        }
+
+        const auto processed = DecodeCompleteChunk(chunkIndex, output, ec);
+        if (!ec)
+        {
+            m_chunkCache->Insert(m_cacheFileId, chunkIndex, output.data(), static_cast<DWORD>(processed));
+        }
+
+        return processed;
+    }
+
+    size_t DecodeCompleteChunk(uint64_t chunkIndex, gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        if (!m_readAhead.empty())
+        {
+            return ReadAheadCompleteChunk(chunkIndex, output, ec);
+        }
+
         ReadRawChunk(chunkIndex, m_inputBuffer, ec);
         if (ec)
         {
@@ -275,31 +363,115 @@ private:
             return 0;
         }
 
-        size_t outputSize;
+        const size_t outputSize = GetChunkOutputSize(chunkIndex);
+        m_decompressor->Decompress(m_inputBuffer, output.subspan(0, outputSize), ec);
+        if (ec)
+        {
+            Log::Debug(
+                "Failed to decompress chunk {}/{} (algorithm: {}, size: {}, buffer size: {}, output size: {}) [{}]",
+                chunkIndex,
+                m_chunks.ChunkCount(),
+                ToString(m_chunks.Algorithm()),
+                m_chunks.ChunkSize(),
+                m_inputBuffer.size(),
+                outputSize,
+                ec);
+            return 0;
+        }
+
+        return outputSize;
+    }
+
+    size_t GetChunkOutputSize(uint64_t chunkIndex) const
+    {
         if (chunkIndex == m_chunks.ChunkCount() - 1)
         {
-            outputSize = m_chunks.GetLastChunkSize();
+            return m_chunks.GetLastChunkSize();
         }
-        else
+
+        return m_chunks.ChunkSize();
+    }
+
+    // Read the raw chunk and queue its decompression in its read ahead slot
+    void ScheduleChunk(uint64_t chunkIndex, std::error_code& ec)
+    {
+        auto& slot = *m_readAhead[chunkIndex % m_readAhead.size()];
+        if (slot.pending.valid())
         {
-            outputSize = std::min(output.size(), static_cast<size_t>(m_chunks.ChunkSize()));
+            // Chunk which was not consumed (the stream was seeked)
+            slot.pending.wait();
+            slot.pending = {};
         }
 
-        m_decompressor->Decompress(m_inputBuffer, output.subspan(0, outputSize), ec);
+        ReadRawChunk(chunkIndex, slot.input, ec);
         if (ec)
         {
+            Log::Debug("Failed to read chunk {}/{} [{}]", chunkIndex, m_chunks.ChunkCount(), ec);
+            return;
+        }
+
+        const auto outputSize = GetChunkOutputSize(chunkIndex);
+        slot.chunkIndex = chunkIndex;
+        slot.ec.clear();
+        slot.pending = std::async(std::launch::async, [&slot, outputSize]() {
+            slot.decompressor->Decompress(slot.input, gsl::span<uint8_t>(slot.output.data(), outputSize), slot.ec);
+            return outputSize;
+        });
+    }
+
+    size_t ReadAheadCompleteChunk(uint64_t chunkIndex, gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        auto& slot = *m_readAhead[chunkIndex % m_readAhead.size()];
+        if (!slot.pending.valid() || slot.chunkIndex != chunkIndex)
+        {
+            ScheduleChunk(chunkIndex, ec);
+            if (ec)
+            {
+                return 0;
+            }
+        }
+
+        // Keep the window full while this chunk is still being decompressed
+        const auto windowEnd = std::min<uint64_t>(chunkIndex + m_readAhead.size(), m_chunks.ChunkCount());
+        for (uint64_t i = chunkIndex + 1; i < windowEnd; ++i)
+        {
+            const auto& next = *m_readAhead[i % m_readAhead.size()];
+            if (next.pending.valid() && next.chunkIndex == i)
+            {
+                continue;
+            }
+
+            if (m_chunkCache && m_chunkCache->Contains(m_cacheFileId, i))
+            {
+                continue;
+            }
+
+            // Not an error yet: the chunk will be read again when the consumer reaches it
+            std::error_code readAheadEc;
+            ScheduleChunk(i, readAheadEc);
+            if (readAheadEc)
+            {
+                break;
+            }
+        }
+
+        const auto outputSize = slot.pending.get();
+        if (slot.ec)
+        {
+            ec = slot.ec;
             Log::Debug(
                 "Failed to decompress chunk {}/{} (algorithm: {}, size: {}, buffer size: {}, output size: {}) [{}]",
                 chunkIndex,
                 m_chunks.ChunkCount(),
                 ToString(m_chunks.Algorithm()),
                 m_chunks.ChunkSize(),
-                m_inputBuffer.size(),
+                slot.input.size(),
                 outputSize,
                 ec);
             return 0;
         }
 
+        std::copy_n(std::cbegin(slot.output), outputSize, std::begin(output));
         return outputSize;
     }
 
@@ -313,6 +485,9 @@ private:
 
     fmt::basic_memory_buffer<WofChunks::ChunkLocation, 8192> m_locations;
     ChunkBufferT m_inputBuffer;
+    std::vector<std::unique_ptr<ReadAheadChunk>> m_readAhead;
+    WofChunkCache* m_chunkCache = nullptr;
+    uint64_t m_cacheFileId = 0;
 };
 
 }  // namespace Ntfs
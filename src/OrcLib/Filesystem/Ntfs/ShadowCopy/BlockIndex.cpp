@@ -0,0 +1,174 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2022 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+
+#include "BlockIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Filesystem/Ntfs/ShadowCopy/DiffAreaTableEntry.h"
+#include "Filesystem/Ntfs/ShadowCopy/Snapshot.h"
+#include "Text/Fmt/GUID.h"
+
+using namespace Orc::Ntfs::ShadowCopy;
+using namespace Orc::Ntfs;
+using namespace Orc;
+
+namespace {
+
+const uint64_t kBlockSize = DiffAreaTableEntry::kDataSize;
+
+void BuildBitmap(const Snapshot& snapshot, bool newest, std::vector<uint8_t>& bitmap)
+{
+    if (!snapshot.PreviousBitmap().empty() && snapshot.Bitmap().size() != snapshot.PreviousBitmap().size())
+    {
+        // This should not be handled as an error. The bits over bitmap size should be seen as set.
+        Log::Debug(
+            "VSS has inconsitent bitmap size (snapshot: {}, bitmap size: {}, previous bitmap size: {})",
+            snapshot.Information().ShadowCopyId(),
+            snapshot.Bitmap().size(),
+            snapshot.PreviousBitmap().size());
+    }
+
+    if (snapshot.PreviousBitmap().empty())
+    {
+        bitmap = snapshot.Bitmap();
+    }
+    else
+    {
+        bitmap.resize(std::max(snapshot.Bitmap().size(), snapshot.PreviousBitmap().size()));
+        std::fill(std::begin(bitmap), std::end(bitmap), 0xFF);
+
+        for (size_t i = 0; i < snapshot.Bitmap().size() && i < snapshot.PreviousBitmap().size(); ++i)
+        {
+            bitmap[i] = snapshot.Bitmap()[i] & snapshot.PreviousBitmap()[i];
+        }
+    }
+
+    if (newest)
+    {
+        // The last snapshot's bitmap must unset bits for unresolved forwarders
+        for (const auto& [offset, forwarder] : snapshot.Forwarders())
+        {
+            const auto blockIndex = offset >> 14;
+            const auto bitmapIndex = blockIndex / 8;
+            const auto bitIndex = 1 << blockIndex % 8;
+
+            if (bitmapIndex < bitmap.size())
+            {
+                bitmap[bitmapIndex] = bitmap[bitmapIndex] & ~bitIndex;
+            }
+        }
+    }
+}
+
+}  // namespace
+
+namespace Orc {
+namespace Ntfs {
+namespace ShadowCopy {
+
+void BlockIndex::Build(const Snapshot& snapshot, bool newest, BlockIndex& index)
+{
+    ::BuildBitmap(snapshot, newest, index.m_bitmap);
+
+    index.m_overlays.clear();
+    index.m_overlays.reserve(snapshot.Overlays().size());
+    for (const auto& [block, overlay] : snapshot.Overlays())
+    {
+        index.m_overlays.push_back({block, overlay.offset, overlay.bitmap});
+    }
+
+    std::sort(std::begin(index.m_overlays), std::end(index.m_overlays), [](const auto& lhs, const auto& rhs) {
+        return lhs.block < rhs.block;
+    });
+
+    std::vector<CopyOnWriteInterval> copyOnWrites;
+    copyOnWrites.reserve(snapshot.CopyOnWrites().size());
+    for (const auto& [block, cow] : snapshot.CopyOnWrites())
+    {
+        copyOnWrites.push_back({block, cow.offset, 1, cow.forward});
+    }
+
+    std::sort(std::begin(copyOnWrites), std::end(copyOnWrites), [](const auto& lhs, const auto& rhs) {
+        return lhs.block < rhs.block;
+    });
+
+    // Merge the blocks whose data follows the data of the previous block
+    index.m_copyOnWrites.clear();
+    for (const auto& cow : copyOnWrites)
+    {
+        if (!index.m_copyOnWrites.empty())
+        {
+            auto& last = index.m_copyOnWrites.back();
+            const uint64_t length = last.count * kBlockSize;
+
+            if (last.forward == cow.forward && last.block + length == cow.block && last.offset + length == cow.offset
+                && last.count < std::numeric_limits<uint32_t>::max())
+            {
+                ++last.count;
+                continue;
+            }
+        }
+
+        index.m_copyOnWrites.push_back(cow);
+    }
+
+    index.m_copyOnWrites.shrink_to_fit();
+
+    Log::Debug(
+        "VSS: indexed snapshot {} (copy-on-write: {}, intervals: {}, overlay: {})",
+        snapshot.Information().ShadowCopyId(),
+        copyOnWrites.size(),
+        index.m_copyOnWrites.size(),
+        index.m_overlays.size());
+}
+
+std::optional<BlockIndex::Overlay> BlockIndex::FindOverlay(BlockOffset offset) const
+{
+    auto it = std::lower_bound(
+        std::cbegin(m_overlays), std::cend(m_overlays), offset, [](const OverlayEntry& entry, BlockOffset offset) {
+            return entry.block < offset;
+        });
+
+    if (it == std::cend(m_overlays) || it->block != offset)
+    {
+        return {};
+    }
+
+    return Overlay {it->offset, it->bitmap};
+}
+
+std::optional<BlockIndex::CopyOnWrite> BlockIndex::FindCopyOnWrite(BlockOffset offset) const
+{
+    // Find the last interval starting at or before 'offset'
+    auto it = std::upper_bound(
+        std::cbegin(m_copyOnWrites),
+        std::cend(m_copyOnWrites),
+        offset,
+        [](BlockOffset offset, const CopyOnWriteInterval& interval) { return offset < interval.block; });
+
+    if (it == std::cbegin(m_copyOnWrites))
+    {
+        return {};
+    }
+
+    --it;
+
+    const auto delta = offset - it->block;
+    if (delta >= it->count * kBlockSize || delta % kBlockSize)
+    {
+        return {};
+    }
+
+    return CopyOnWrite {it->offset + delta, it->forward};
+}
+
+}  // namespace ShadowCopy
+}  // namespace Ntfs
+}  // namespace Orc
@@ -0,0 +1,99 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2022 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+#pragma once
+
+#include <optional>
+#include <vector>
+
+namespace Orc {
+namespace Ntfs {
+namespace ShadowCopy {
+
+class Snapshot;
+
+//
+// Sorted and compact index of the diff area entries of one snapshot, immutable once built.
+//
+// Copy-on-write entries of consecutive blocks whose data is stored consecutively in the diff area are merged in a
+// single interval: the store is usually filled sequentially so a few intervals replace millions of hash map nodes.
+// Lookups are binary searches.
+//
+class BlockIndex final
+{
+public:
+    using BlockOffset = uint64_t;
+
+    struct Overlay
+    {
+        BlockOffset offset;
+        uint32_t bitmap;
+    };
+
+    struct CopyOnWrite
+    {
+        BlockOffset offset;  // Data offset or, for a forwarder, the block offset where to continue the lookup
+        bool forward;
+    };
+
+    // 'newest' must be set for the most recent snapshot of the volume, its unresolved forwarders must unset bitmap bits
+    static void Build(const Snapshot& snapshot, bool newest, BlockIndex& index);
+
+    std::optional<Overlay> FindOverlay(BlockOffset offset) const;
+    std::optional<CopyOnWrite> FindCopyOnWrite(BlockOffset offset) const;
+
+    // Combination of the snapshot's bitmap and previous bitmap, bits set for blocks without data to be read
+    const std::vector<uint8_t>& Bitmap() const { return m_bitmap; }
+
+    size_t OverlayCount() const { return m_overlays.size(); }
+    size_t CopyOnWriteIntervalCount() const { return m_copyOnWrites.size(); }
+
+    template <typename Callback>
+    void ForEachOverlay(Callback callback) const
+    {
+        for (const auto& overlay : m_overlays)
+        {
+            callback(overlay.block, Overlay {overlay.offset, overlay.bitmap});
+        }
+    }
+
+    // Callback is called with the first block offset, the block count and the copy-on-write of the first block
+    template <typename Callback>
+    void ForEachCopyOnWriteInterval(Callback callback) const
+    {
+        for (const auto& interval : m_copyOnWrites)
+        {
+            callback(interval.block, interval.count, CopyOnWrite {interval.offset, interval.forward});
+        }
+    }
+
+private:
+#pragma pack(push, 1)
+    struct OverlayEntry
+    {
+        BlockOffset block;
+        BlockOffset offset;
+        uint32_t bitmap;
+    };
+
+    struct CopyOnWriteInterval
+    {
+        BlockOffset block;
+        BlockOffset offset;
+        uint32_t count;
+        bool forward;
+    };
+#pragma pack(pop)
+
+    std::vector<OverlayEntry> m_overlays;
+    std::vector<CopyOnWriteInterval> m_copyOnWrites;
+    std::vector<uint8_t> m_bitmap;
+};
+
+}  // namespace ShadowCopy
+}  // namespace Ntfs
+}  // namespace Orc
@@ -192,11 +192,7 @@ void Dump(const std::string& path, const ShadowCopy& vss)
     document.SetObject();
     rapidjson::Value blockArray(rapidjson::Type::kArrayType);
 
-    std::vector<std::pair<ShadowCopy::BlockOffset, ShadowCopy::Block>> blocks;
-    std::copy(std::cbegin(vss.Blocks()), std::cend(vss.Blocks()), std::back_inserter(blocks));
-    std::sort(
-        std::begin(blocks), std::end(blocks), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
-
+    const auto blocks = vss.Blocks();
     for (const auto& [offset, block] : blocks)
     {
         rapidjson::Value jsonBlock(rapidjson::Type::kObjectType);
@@ -13,7 +13,6 @@
 #include "Filesystem/Ntfs/ShadowCopy/DiffAreaTable.h"
 #include "Filesystem/Ntfs/ShadowCopy/DiffAreaLocationTable.h"
 #include "Filesystem/Ntfs/ShadowCopy/DiffAreaBitmap.h"
-#include "Filesystem/Ntfs/ShadowCopy/Snapshot.h"
 #include "Stream/StreamUtils.h"
 #include "Text/Fmt/ByteQuantity.h"
 #include "Text/Fmt/FILETIME.h"
@@ -52,6 +51,75 @@ public:
 
 using Chunks = std::array<Chunk, 32>;
 
+// Overlay and copy-on-write data are both read from the diff area store
+bool IsStoreChunk(const Chunk& chunk)
+{
+    return chunk.type == Chunk::Type::kCopyOnWrite || chunk.type == Chunk::Type::kOverlay;
+}
+
+// Adjacent chunks read with a single IO: the store chunks are read together whatever their type
+bool CanMerge(const Chunk& pending, const Chunk& chunk)
+{
+    if (pending.endOffset != chunk.offset)
+    {
+        return false;
+    }
+
+    return pending.type == chunk.type || (IsStoreChunk(pending) && IsStoreChunk(chunk));
+}
+
+// Store runs larger than this are read directly: they are sequential data, not blocks shared by the snapshots
+constexpr size_t kMaxCachedStoreRun = 16 * DiffAreaTableEntry::kDataSize;
+
+// Read the store chunk at 'offset' through the cache: its blocks are read whole with a single IO unless all of them are
+// cached, and they are all cached then
+size_t ReadStoreChunkAt(
+    StreamReader& stream,
+    VolumeBlockCache& cache,
+    uint64_t offset,
+    gsl::span<uint8_t> output,
+    std::error_code& ec)
+{
+    const uint64_t kBlockSize = DiffAreaTableEntry::kDataSize;
+
+    const auto first = offset & ~(kBlockSize - 1);
+    const auto end = (offset + output.size() + kBlockSize - 1) & ~(kBlockSize - 1);
+    const auto offsetInBlocks = static_cast<size_t>(offset - first);
+
+    std::vector<uint8_t> blocks(static_cast<size_t>(end - first));
+
+    bool cached = true;
+    for (uint64_t block = first; cached && block < end; block += kBlockSize)
+    {
+        DWORD dwValidBytes = 0;
+        cached = cache.Lookup(block, blocks.data() + (block - first), dwValidBytes) && dwValidBytes == kBlockSize;
+    }
+
+    size_t available = blocks.size();
+    if (!cached)
+    {
+        available = Stream::ReadChunkAt(stream, first, blocks, ec);
+        if (ec)
+        {
+            return 0;
+        }
+
+        for (uint64_t block = first; block + kBlockSize <= first + available; block += kBlockSize)
+        {
+            cache.Insert(block, blocks.data() + (block - first), static_cast<DWORD>(kBlockSize));
+        }
+    }
+
+    if (available <= offsetInBlocks)
+    {
+        return 0;
+    }
+
+    const auto processed = std::min(output.size(), available - offsetInBlocks);
+    std::copy_n(blocks.data() + offsetInBlocks, processed, output.data());
+    return processed;
+}
+
 class ReadParameters final
 {
 public:
@@ -178,9 +246,11 @@ void BitmapToChunks(Chunk::Type type, uint32_t bitmap, uint64_t offset, Chunks&
 
 void GetChunksToRead(
     const Orc::Ntfs::ShadowCopy::ShadowCopy& shadowCopy,
+    StreamReader& stream,
     uint64_t blockOffset,
     uint32_t readBitmap,
-    Chunks& chunks)
+    Chunks& chunks,
+    std::error_code& ec)
 {
     uint32_t overlayBitmap;
     uint32_t cowBitmap;
@@ -189,7 +259,11 @@ void GetChunksToRead(
 
     std::optional<Orc::Ntfs::ShadowCopy::ShadowCopy::Block::Overlay> overlay;
     std::optional<Orc::Ntfs::ShadowCopy::ShadowCopy::Block::CopyOnWrite> cow;
-    shadowCopy.GetBlockDescriptors(blockOffset, overlay, cow);
+    shadowCopy.GetBlockDescriptors(stream, blockOffset, overlay, cow, ec);
+    if (ec)
+    {
+        return;
+    }
 
     if (overlay)
     {
@@ -248,9 +322,11 @@ void GetChunksToRead(
 
 void GetChunksToRead(
     const Orc::Ntfs::ShadowCopy::ShadowCopy& shadowCopy,
+    StreamReader& stream,
     const ReadParameters& blocks,
     size_t blockIndex,
-    Chunks& chunks)
+    Chunks& chunks,
+    std::error_code& ec)
 {
     auto blockBitmap = blocks.GetReadBitmap(blockIndex);
     if (!blockBitmap)
@@ -259,7 +335,7 @@ void GetChunksToRead(
     }
 
     const auto offset = blocks.GetBlockOffset(blockIndex);
-    GetChunksToRead(shadowCopy, offset, blockBitmap, chunks);
+    GetChunksToRead(shadowCopy, stream, offset, blockBitmap, chunks, ec);
 }
 
 }  // namespace
@@ -332,120 +408,98 @@ void GetShadowCopiesInformation(
         });
 }
 
-void ShadowCopy::Initialize(gsl::span<const Snapshot> snapshots, ShadowCopy& shadowCopy, std::error_code& ec)
+void ShadowCopy::Open(SnapshotChain::Ptr chain, const GUID& shadowCopyId, ShadowCopy& shadowCopy, std::error_code& ec)
 {
-    const auto& activeSnapshot = snapshots[0];
-
-    shadowCopy.Information() = ShadowCopyInformation(activeSnapshot.Information());
-
-    if (!activeSnapshot.PreviousBitmap().empty() && activeSnapshot.Bitmap().size() != activeSnapshot.PreviousBitmap().size())
+    if (chain->Size() == 0)
     {
-        // This should not be handled as an error. The bits over bitmap size should be seen as set.
-        Log::Debug(
-            "VSS has inconsitent bitmap size (snapshot: {}, bitmap size: {}, previous bitmap size: {})",
-            activeSnapshot.Information().ShadowCopyId(),
-            activeSnapshot.Bitmap().size(),
-            activeSnapshot.PreviousBitmap().size());
+        Log::Debug("No snapshot found");
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return;
     }
 
-    if (activeSnapshot.PreviousBitmap().empty())
+    const auto position = chain->Find(shadowCopyId);
+    if (!position)
     {
-        shadowCopy.m_bitmap.resize(activeSnapshot.Bitmap().size());
-        std::copy(
-            std::cbegin(activeSnapshot.Bitmap()), std::cend(activeSnapshot.Bitmap()), std::begin(shadowCopy.m_bitmap));
+        Log::Debug("Failed to find shadow copy in snapshots index (id: {})", shadowCopyId);
+        ec = std::make_error_code(std::errc::no_such_file_or_directory);
+        return;
     }
-    else
-    {
-        shadowCopy.m_bitmap.resize(std::max(activeSnapshot.Bitmap().size(), activeSnapshot.PreviousBitmap().size()));
-        std::fill(std::begin(shadowCopy.m_bitmap), std::end(shadowCopy.m_bitmap), 0xFF);
 
-        for (size_t i = 0; i < activeSnapshot.Bitmap().size() && i < activeSnapshot.PreviousBitmap().size(); ++i)
-        {
-            shadowCopy.m_bitmap[i] = activeSnapshot.Bitmap()[i] & activeSnapshot.PreviousBitmap()[i];
-        }
-    }
+    shadowCopy.m_information = ShadowCopyInformation(chain->Information(*position));
+    shadowCopy.m_position = *position;
+    shadowCopy.m_chain = std::move(chain);
+}
 
-    if (snapshots.size() == 1)
+void ShadowCopy::Load(StreamReader& stream, std::error_code& ec)
+{
+    struct Interval
     {
-        // The last snapshot's bitmap must unset bits for unresolved forwarders
-        for (const auto& [offset, forwarder] : activeSnapshot.Forwarders())
-        {
-            const auto blockIndex = offset >> 14;
-            const auto bitmapIndex = blockIndex / 8;
-            const auto bitIndex = 1 << blockIndex % 8;
-
-            shadowCopy.m_bitmap[bitmapIndex] = shadowCopy.m_bitmap[bitmapIndex] & ~bitIndex;
-        }
-    }
+        BlockOffset offset;
+        BlockOffset end;
+    };
 
-    uint64_t copyOnWriteCount = 0;
-    for (size_t i = 0; i < snapshots.size(); ++i)
+    std::vector<Interval> intervals;
+    for (size_t i = m_position; i < m_chain->Size(); ++i)
     {
-        for (const auto [offset, cow] : snapshots[i].CopyOnWrites())
+        const auto index = m_chain->Index(stream, i, ec);
+        if (!index)
         {
-            auto it = shadowCopy.m_blocks.find(offset);
-            if (it == std::cend(shadowCopy.m_blocks))
-            {
-                shadowCopy.m_blocks.emplace(
-                    offset, Block {std::optional<Block::Overlay> {}, Block::CopyOnWrite {cow.offset}});
-                ++copyOnWriteCount;
-            }
-            else if (!it->second.m_copyOnWrite.has_value())
-            {
-                it->second.m_copyOnWrite = Block::CopyOnWrite {cow.offset};
-                ++copyOnWriteCount;
-            }
+            Log::Debug("Failed to parse a vss snapshot from {} [{}]", m_information.ShadowCopyId(), ec);
+            return;
         }
+
+        index->ForEachCopyOnWriteInterval([&](BlockOffset offset, uint32_t count, const BlockIndex::CopyOnWrite&) {
+            intervals.push_back({offset, offset + count * kShadowCopyBlockSize});
+        });
     }
 
-    shadowCopy.Information().SetCopyOnWriteCount(copyOnWriteCount);
+    // Count the distinct blocks with a copy-on-write, the newer snapshots being shadowed by the older ones
+    std::sort(std::begin(intervals), std::end(intervals), [](const auto& lhs, const auto& rhs) {
+        return lhs.offset < rhs.offset;
+    });
 
-    uint64_t overlayCount = 0;
-    for (const auto& [offset, overlay] : activeSnapshot.Overlays())
+    uint64_t copyOnWriteCount = 0;
+    BlockOffset covered = 0;
+    for (const auto& interval : intervals)
     {
-        auto it = shadowCopy.m_blocks.find(offset);
-        if (it == std::cend(shadowCopy.m_blocks))
+        const auto start = std::max(interval.offset, covered);
+        if (interval.end > start)
         {
-            shadowCopy.m_blocks.emplace(
-                offset, Block {Block::Overlay {overlay.offset, overlay.bitmap}, std::optional<Block::CopyOnWrite> {}});
-            ++overlayCount;
-        }
-        else
-        {
-            it->second.m_overlay = Block::Overlay {overlay.offset, overlay.bitmap};
-            ++overlayCount;
+            copyOnWriteCount += (interval.end - start) / kShadowCopyBlockSize;
+            covered = interval.end;
         }
     }
 
-    shadowCopy.Information().SetOverlayCount(overlayCount);
+    m_information.SetCopyOnWriteCount(copyOnWriteCount);
+    m_information.SetOverlayCount(m_chain->IndexIfReady(m_position)->OverlayCount());
 }
 
 void ShadowCopy::Parse(StreamReader& stream, std::vector<ShadowCopy>& shadowCopies, std::error_code& ec)
 {
-    std::vector<Snapshot> snapshots;
-    Snapshot::Parse(stream, snapshots, ec);
+    auto chain = SnapshotChain::Open(stream, ec);
     if (ec)
     {
         Log::Debug("Failed to parse vss snapshots [{}]", ec);
         return;
     }
 
-    if (snapshots.empty())
+    if (chain->Size() == 0)
     {
         Log::Debug("No snapshots found [{}]", ec);
         return;
     }
 
-    // Resolve forwarders from the older snapshot to the most recent one and store them as cow
-    Snapshot::ResolveForwarders(snapshots);
-
-    for (size_t i = 0; i < snapshots.size(); ++i)
+    for (size_t i = 0; i < chain->Size(); ++i)
     {
         ShadowCopy shadowCopy;
-        Initialize(gsl::span<const Snapshot>(&snapshots[i], snapshots.size() - i), shadowCopy, ec);
+        shadowCopy.m_information = ShadowCopyInformation(chain->Information(i));
+        shadowCopy.m_position = i;
+        shadowCopy.m_chain = chain;
+
+        shadowCopy.Load(stream, ec);
         if (ec)
         {
-            Log::Debug("Failed to parse shadow copy {}", snapshots[0].Information().ShadowCopyId());
+            Log::Debug("Failed to parse shadow copy {}", chain->Information(i).ShadowCopyId());
             return;
         }
 
@@ -455,64 +509,23 @@ void ShadowCopy::Parse(StreamReader& stream, std::vector<ShadowCopy>& shadowCopi
 
 void ShadowCopy::Parse(StreamReader& stream, const GUID& shadowCopyId, ShadowCopy& shadowCopy, std::error_code& ec)
 {
-    SnapshotsIndex snapshotsIndex;
-    SnapshotsIndex::Parse(stream, snapshotsIndex, ec);
+    auto chain = SnapshotChain::Open(stream, ec);
     if (ec)
     {
         Log::Debug("Failed to read snapshots index while searching for {} [{}]", shadowCopyId, ec);
         return;
     }
 
-    if (snapshotsIndex.Items().empty())
-    {
-        Log::Debug("No snapshot found");
-        return;
-    }
-
-    std::vector<SnapshotInformation> snapshotsSelection;
-    std::optional<size_t> activeSnapshotPosition;
-
-    for (int i = snapshotsIndex.Items().size() - 1; i >= 0; --i)
-    {
-        if (snapshotsIndex.Items()[i].ShadowCopyId() == shadowCopyId)
-        {
-            activeSnapshotPosition = i;
-            break;
-        }
-    }
-
-    if (!activeSnapshotPosition)
+    Open(std::move(chain), shadowCopyId, shadowCopy, ec);
+    if (ec)
     {
-        Log::Debug("Failed to find shadow copy in snapshots index (id: {})", shadowCopyId);
-        ec = std::make_error_code(std::errc::no_such_file_or_directory);
         return;
     }
 
-    std::copy(
-        std::cbegin(snapshotsIndex.Items()) + *activeSnapshotPosition,
-        std::cend(snapshotsIndex.Items()),
-        std::back_inserter(snapshotsSelection));
-
-    std::vector<Snapshot> snapshots;
-    snapshots.resize(snapshotsSelection.size());
-
-    for (size_t i = 0; i < snapshots.size(); ++i)
-    {
-        Snapshot::Parse(stream, snapshotsSelection[i], snapshots[i], ec);
-        if (ec)
-        {
-            Log::Debug("Failed to parse a vss snapshot from {} [{}]", shadowCopyId, ec);
-            return;
-        }
-    }
-
-    // Resolve forwarders from the older snapshot to the most recent one and store them as cow
-    Snapshot::ResolveForwarders(snapshots);
-
-    Initialize(snapshots, shadowCopy, ec);
+    shadowCopy.Load(stream, ec);
     if (ec)
     {
-        Log::Debug("Failed to parse shadow copy {}", snapshots[0].Information().ShadowCopyId());
+        Log::Debug("Failed to parse shadow copy {}", shadowCopyId);
         return;
     }
 }
@@ -532,7 +545,9 @@ size_t ShadowCopy::ReadAt(StreamReader& stream, uint64_t offset, BufferSpan outp
     bool firstRead = true;
     size_t totalRead = 0;
 
-    auto fnReadChunk = [offset, &firstRead, &totalRead](
+    auto& storeCache = m_chain->StoreCache();
+
+    auto fnReadChunk = [offset, &firstRead, &totalRead, &storeCache](
                            StreamReader& stream, Chunk& chunk, gsl::span<uint8_t> output, std::error_code& ec) {
         if (firstRead)
         {
@@ -554,6 +569,14 @@ size_t ShadowCopy::ReadAt(StreamReader& stream, uint64_t offset, BufferSpan outp
             std::fill(std::begin(buffer), std::end(buffer), 0x00);
             processed = buffer.size();
         }
+        else if (IsStoreChunk(chunk) && buffer.size() <= kMaxCachedStoreRun)
+        {
+            processed = ReadStoreChunkAt(stream, storeCache, chunk.offset, buffer, ec);
+            if (ec)
+            {
+                return;
+            }
+        }
         else
         {
             processed = Stream::ReadChunkAt(stream, chunk.offset, buffer, ec);
@@ -570,7 +593,13 @@ size_t ShadowCopy::ReadAt(StreamReader& stream, uint64_t offset, BufferSpan outp
     for (size_t i = 0; i < readParameters.BlockCount(); ++i)
     {
         Chunks chunks;
-        GetChunksToRead(*this, readParameters.GetBlockOffset(i), readParameters.GetReadBitmap(i), chunks);
+        GetChunksToRead(*this, stream, readParameters.GetBlockOffset(i), readParameters.GetReadBitmap(i), chunks, ec);
+        if (ec)
+        {
+            Log::Debug(
+                "Failed to resolve shadow copy block (offset: {:#x}) [{}]", readParameters.GetBlockOffset(i), ec);
+            return totalRead;
+        }
 
         for (const auto& chunk : chunks)
         {
@@ -582,7 +611,7 @@ size_t ShadowCopy::ReadAt(StreamReader& stream, uint64_t offset, BufferSpan outp
             // Merge chunks to limit IO
             if (pendingChunkToRead.length)
             {
-                if (pendingChunkToRead.endOffset == chunk.offset && pendingChunkToRead.type == chunk.type)
+                if (CanMerge(pendingChunkToRead, chunk))
                 {
                     pendingChunkToRead.length += chunk.length;
                     pendingChunkToRead.endOffset = chunk.endOffset;
@@ -605,18 +634,120 @@ size_t ShadowCopy::ReadAt(StreamReader& stream, uint64_t offset, BufferSpan outp
 }
 
 void ShadowCopy::GetBlockDescriptors(
+    StreamReader& stream,
     BlockOffset offset,
     std::optional<Block::Overlay>& overlay,
-    std::optional<Block::CopyOnWrite>& copyOnWrite) const
+    std::optional<Block::CopyOnWrite>& copyOnWrite,
+    std::error_code& ec) const
 {
-    auto it = m_blocks.find(offset);
-    if (it == std::cend(m_blocks))
+    // Overlays only come from the active snapshot
+    const auto index = m_chain->Index(stream, m_position, ec);
+    if (!index)
     {
         return;
     }
 
-    overlay = it->second.m_overlay;
-    copyOnWrite = it->second.m_copyOnWrite;
+    if (auto activeOverlay = index->FindOverlay(offset))
+    {
+        overlay = Block::Overlay {activeOverlay->offset, activeOverlay->bitmap};
+    }
+
+    auto cow = m_chain->FindCopyOnWrite(stream, m_position, offset, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    if (cow)
+    {
+        copyOnWrite = Block::CopyOnWrite {cow->offset};
+    }
+}
+
+bool ShadowCopy::IsBlockUnchanged(StreamReader& stream, BlockOffset offset, std::error_code& ec) const
+{
+    std::optional<Block::Overlay> overlay;
+    std::optional<Block::CopyOnWrite> copyOnWrite;
+    GetBlockDescriptors(stream, offset & ~(kShadowCopyBlockSize - 1), overlay, copyOnWrite, ec);
+    if (ec || overlay || copyOnWrite)
+    {
+        return false;
+    }
+
+    // A set bit would be read as zeroes
+    const auto blockIndex = offset >> 14;
+    const auto bitmapIndex = blockIndex / 8;
+    const auto bitIndex = 1 << blockIndex % 8;
+
+    const auto& bitmap = Bitmap();
+    return bitmapIndex < bitmap.size() && !(bitmap[bitmapIndex] & bitIndex);
+}
+
+const std::vector<uint8_t>& ShadowCopy::Bitmap() const
+{
+    static const std::vector<uint8_t> kEmptyBitmap;
+
+    const auto index = m_chain ? m_chain->IndexIfReady(m_position) : nullptr;
+    if (!index)
+    {
+        return kEmptyBitmap;
+    }
+
+    return index->Bitmap();
+}
+
+std::vector<std::pair<ShadowCopy::BlockOffset, ShadowCopy::Block>> ShadowCopy::Blocks() const
+{
+    std::vector<std::pair<BlockOffset, Block>> blocks;
+    if (!m_chain)
+    {
+        return blocks;
+    }
+
+    std::vector<BlockOffset> offsets;
+    for (size_t i = m_position; i < m_chain->Size(); ++i)
+    {
+        const auto index = m_chain->IndexIfReady(i);
+        if (!index)
+        {
+            continue;
+        }
+
+        index->ForEachCopyOnWriteInterval([&](BlockOffset offset, uint32_t count, const BlockIndex::CopyOnWrite&) {
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                offsets.push_back(offset + j * kShadowCopyBlockSize);
+            }
+        });
+
+        if (i == m_position)
+        {
+            index->ForEachOverlay([&](BlockOffset offset, const BlockIndex::Overlay&) { offsets.push_back(offset); });
+        }
+    }
+
+    std::sort(std::begin(offsets), std::end(offsets));
+    offsets.erase(std::unique(std::begin(offsets), std::end(offsets)), std::end(offsets));
+
+    const auto activeIndex = m_chain->IndexIfReady(m_position);
+    for (const auto offset : offsets)
+    {
+        Block block;
+
+        if (auto overlay = activeIndex->FindOverlay(offset))
+        {
+            block.m_overlay = Block::Overlay {overlay->offset, overlay->bitmap};
+        }
+
+        if (auto cow = m_chain->FindCopyOnWrite(m_position, offset))
+        {
+            block.m_copyOnWrite = Block::CopyOnWrite {cow->offset};
+        }
+
+        blocks.emplace_back(offset, std::move(block));
+    }
+
+    return blocks;
 }
 
 }  // namespace ShadowCopy
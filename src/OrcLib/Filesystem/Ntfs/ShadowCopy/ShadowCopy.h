@@ -10,13 +10,12 @@
 #include "Stream/StreamReader.h"
 #include "Utils/BufferSpan.h"
 #include "Filesystem/Ntfs/ShadowCopy/ShadowCopyInformation.h"
+#include "Filesystem/Ntfs/ShadowCopy/SnapshotChain.h"
 
 namespace Orc {
 namespace Ntfs {
 namespace ShadowCopy {
 
-class Snapshot;
-
 bool HasSnapshotsIndex(StreamReader& stream, std::error_code& ec);
 
 void GetShadowCopiesInformation(
@@ -50,29 +49,38 @@ public:
 
     static void Parse(StreamReader& stream, std::vector<ShadowCopy>& shadowCopies, std::error_code& ec);
 
+    // Lazy alternative to 'Parse': the diff areas of the snapshots are parsed by the reads needing them. The chain can
+    // be shared between the shadow copies of the same volume.
+    static void Open(SnapshotChain::Ptr chain, const GUID& shadowCopyGuid, ShadowCopy& shadowCopy, std::error_code& ec);
+
+    // Parse the diff areas of all the snapshots of the shadow copy and update the counters of 'Information()'
+    void Load(StreamReader& stream, std::error_code& ec);
+
     size_t ReadAt(StreamReader& stream, uint64_t offset, BufferSpan output, std::error_code& ec) const;
 
     void GetBlockDescriptors(
+        StreamReader& stream,
         BlockOffset offset,
         std::optional<Block::Overlay>& overlay,
-        std::optional<Block::CopyOnWrite>& copyOnWrite) const;
+        std::optional<Block::CopyOnWrite>& copyOnWrite,
+        std::error_code& ec) const;
 
-    const std::vector<uint8_t>& Bitmap() const { return m_bitmap; }
+    // True if the block is read from the current volume: its data is the same in the shadow copy and on the volume
+    bool IsBlockUnchanged(StreamReader& stream, BlockOffset offset, std::error_code& ec) const;
+
+    // Empty until the active snapshot is indexed
+    const std::vector<uint8_t>& Bitmap() const;
 
     ShadowCopyInformation& Information() { return m_information; }
     const ShadowCopyInformation& Information() const { return m_information; }
 
-    const std::unordered_map<BlockOffset, Block>& Blocks() const { return m_blocks; }
-
-private:
-    // Initialize a shadow copy instance using the first snapshot id as shadow copy id. The next snapshots being newer
-    // and ordered to the newest.
-    static void Initialize(gsl::span<const Snapshot> snapshots, ShadowCopy& shadowCopy, std::error_code& ec);
+    // Sorted copy of the resolved blocks, for diagnostic as it is built from the indexes of the loaded snapshots
+    std::vector<std::pair<BlockOffset, Block>> Blocks() const;
 
 private:
     ShadowCopyInformation m_information;
-    std::vector<uint8_t> m_bitmap;
-    std::unordered_map<BlockOffset, Block> m_blocks;
+    SnapshotChain::Ptr m_chain;
+    size_t m_position = 0;  // Position of the active snapshot in the chain
 };
 
 }  // namespace ShadowCopy
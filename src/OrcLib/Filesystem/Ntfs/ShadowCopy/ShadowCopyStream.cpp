@@ -9,6 +9,8 @@
 
 #include "ShadowCopyStream.h"
 
+#include "Filesystem/Ntfs/ShadowCopy/DiffAreaTableEntry.h"
+
 namespace Orc {
 namespace Ntfs {
 namespace ShadowCopy {
@@ -17,7 +19,28 @@ ShadowCopyStream::ShadowCopyStream(StreamReader::Ptr stream, const GUID& shadowC
     : m_pos(0)
     , m_stream(std::move(stream))
 {
-    ShadowCopy::Parse(*m_stream, shadowCopyId, m_shadowCopy, ec);
+    auto chain = SnapshotChain::Open(*m_stream, ec);
+    if (ec)
+    {
+        return;
+    }
+
+    ShadowCopy::Open(std::move(chain), shadowCopyId, m_shadowCopy, ec);
+    if (ec)
+    {
+        return;
+    }
+}
+
+ShadowCopyStream::ShadowCopyStream(
+    StreamReader::Ptr stream,
+    SnapshotChain::Ptr chain,
+    const GUID& shadowCopyId,
+    std::error_code& ec)
+    : m_pos(0)
+    , m_stream(std::move(stream))
+{
+    ShadowCopy::Open(std::move(chain), shadowCopyId, m_shadowCopy, ec);
     if (ec)
     {
         return;
@@ -37,6 +60,22 @@ size_t ShadowCopyStream::Read(gsl::span<uint8_t> output, std::error_code& ec)
     return processed;
 }
 
+bool ShadowCopyStream::IsUnchanged(uint64_t offset, uint64_t length, std::error_code& ec)
+{
+    const uint64_t kBlockSize = DiffAreaTableEntry::kDataSize;
+
+    const auto end = offset + length;
+    for (uint64_t block = offset & ~(kBlockSize - 1); block < end; block += kBlockSize)
+    {
+        if (!m_shadowCopy.IsBlockUnchanged(*m_stream, block, ec))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 uint64_t ShadowCopyStream::Seek(SeekDirection direction, int64_t value, std::error_code& ec)
 {
     // TODO: check max with shadowcopy data
@@ -19,13 +19,20 @@ class ShadowCopyStream final : public StreamReader
 public:
     using Ptr = std::shared_ptr<ShadowCopyStream>;
 
+    // Only the snapshots index is parsed here, the diff areas are parsed by the reads needing them
     ShadowCopyStream(StreamReader::Ptr stream, const GUID& shadowCopyId, std::error_code& ec);
 
+    // Share the snapshots already parsed by the streams of the other shadow copies of the volume
+    ShadowCopyStream(StreamReader::Ptr stream, SnapshotChain::Ptr chain, const GUID& shadowCopyId, std::error_code& ec);
+
     size_t Read(gsl::span<uint8_t> output, std::error_code& ec) override;
     uint64_t Seek(SeekDirection direction, int64_t value, std::error_code& ec) override;
 
     const ShadowCopy& ShadowCopy() const { return m_shadowCopy; }
 
+    // True if every block of the range is read from the current volume
+    bool IsUnchanged(uint64_t offset, uint64_t length, std::error_code& ec);
+
 private:
     uint64_t m_pos;
     StreamReader::Ptr m_stream;
@@ -0,0 +1,181 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2022 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+
+#include "SnapshotChain.h"
+
+#include "Filesystem/Ntfs/ShadowCopy/DiffAreaTableEntry.h"
+#include "Filesystem/Ntfs/ShadowCopy/Snapshot.h"
+#include "Filesystem/Ntfs/ShadowCopy/SnapshotsIndex.h"
+#include "Text/Fmt/GUID.h"
+
+namespace Orc {
+namespace Ntfs {
+namespace ShadowCopy {
+
+SnapshotChain::SnapshotChain()
+    : m_storeCache(static_cast<ULONG>(DiffAreaTableEntry::kDataSize), kStoreCacheBytes)
+{
+}
+
+SnapshotChain::Ptr SnapshotChain::Open(StreamReader& stream, std::error_code& ec)
+{
+    SnapshotsIndex snapshotsIndex;
+    SnapshotsIndex::Parse(stream, snapshotsIndex, ec);
+    if (ec)
+    {
+        Log::Debug("Failed to read snapshots index [{}]", ec);
+        return {};
+    }
+
+    auto chain = std::shared_ptr<SnapshotChain>(new SnapshotChain());
+    chain->m_informations = snapshotsIndex.Items();
+    for (size_t i = 0; i < chain->m_informations.size(); ++i)
+    {
+        chain->m_slots.push_back(std::make_unique<Slot>());
+    }
+
+    return chain;
+}
+
+std::optional<size_t> SnapshotChain::Find(const GUID& shadowCopyId) const
+{
+    for (size_t i = m_informations.size(); i > 0; --i)
+    {
+        if (m_informations[i - 1].ShadowCopyId() == shadowCopyId)
+        {
+            return i - 1;
+        }
+    }
+
+    return {};
+}
+
+const BlockIndex* SnapshotChain::Index(StreamReader& stream, size_t position, std::error_code& ec)
+{
+    auto& slot = *m_slots[position];
+    if (slot.ready.load(std::memory_order_acquire))
+    {
+        return &slot.index;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (slot.ready.load(std::memory_order_relaxed))
+    {
+        return &slot.index;
+    }
+
+    Snapshot snapshot;
+    Snapshot::Parse(stream, m_informations[position], snapshot, ec);
+    if (ec)
+    {
+        Log::Debug("Failed to parse vss snapshot: {} [{}]", m_informations[position].ShadowCopyId(), ec);
+        return nullptr;
+    }
+
+    BlockIndex::Build(snapshot, position == m_informations.size() - 1, slot.index);
+    slot.ready.store(true, std::memory_order_release);
+    return &slot.index;
+}
+
+const BlockIndex* SnapshotChain::IndexIfReady(size_t position) const
+{
+    const auto& slot = *m_slots[position];
+    if (!slot.ready.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    return &slot.index;
+}
+
+template <typename GetIndex>
+std::optional<BlockIndex::CopyOnWrite>
+SnapshotChain::ResolveCopyOnWrite(size_t position, BlockIndex::BlockOffset offset, GetIndex getIndex) const
+{
+    for (size_t i = position; i < m_informations.size(); ++i)
+    {
+        const auto index = getIndex(i);
+        if (!index)
+        {
+            continue;
+        }
+
+        auto cow = index->FindCopyOnWrite(offset);
+        if (!cow)
+        {
+            continue;
+        }
+
+        if (!cow->forward)
+        {
+            return cow;
+        }
+
+        // Follow the forwarders through the newer snapshots, an unresolved one is returned as is
+        uint64_t offsetToFind = cow->offset;
+        for (size_t j = i + 1; j < m_informations.size(); ++j)
+        {
+            const auto newerIndex = getIndex(j);
+            if (!newerIndex)
+            {
+                continue;
+            }
+
+            auto newerCow = newerIndex->FindCopyOnWrite(offsetToFind);
+            if (!newerCow)
+            {
+                continue;
+            }
+
+            cow = newerCow;
+            if (!cow->forward)
+            {
+                break;
+            }
+
+            offsetToFind = cow->offset;
+        }
+
+        if (cow->forward)
+        {
+            Log::Trace(
+                "Unresolved VSS forwarder (shadow copy: {}, offset: {:#x})",
+                m_informations[position].ShadowCopyId(),
+                offset);
+        }
+
+        return cow;
+    }
+
+    return {};
+}
+
+std::optional<BlockIndex::CopyOnWrite> SnapshotChain::FindCopyOnWrite(
+    StreamReader& stream,
+    size_t position,
+    BlockIndex::BlockOffset offset,
+    std::error_code& ec)
+{
+    auto cow = ResolveCopyOnWrite(position, offset, [&](size_t i) { return ec ? nullptr : Index(stream, i, ec); });
+    if (ec)
+    {
+        return {};
+    }
+
+    return cow;
+}
+
+std::optional<BlockIndex::CopyOnWrite>
+SnapshotChain::FindCopyOnWrite(size_t position, BlockIndex::BlockOffset offset) const
+{
+    return ResolveCopyOnWrite(position, offset, [this](size_t i) { return IndexIfReady(i); });
+}
+
+}  // namespace ShadowCopy
+}  // namespace Ntfs
+}  // namespace Orc
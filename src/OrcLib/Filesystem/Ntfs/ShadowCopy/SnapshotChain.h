@@ -0,0 +1,88 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2022 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "Stream/StreamReader.h"
+#include "VolumeBlockCache.h"
+#include "Filesystem/Ntfs/ShadowCopy/BlockIndex.h"
+#include "Filesystem/Ntfs/ShadowCopy/SnapshotInformation.h"
+
+namespace Orc {
+namespace Ntfs {
+namespace ShadowCopy {
+
+//
+// Snapshots of a volume ordered to the newest. A shadow copy is made of a snapshot and all the newer ones: the chain is
+// shared by all the shadow copies of a volume so each snapshot's diff area is parsed and indexed once, on first use.
+//
+// Thread safe: indexes are immutable once built, building them is serialized.
+//
+// The chain also caches the diff area blocks recently read by its shadow copies: an older shadow copy reads the
+// copy-on-write blocks of all the newer snapshots, which the shadow copies of these snapshots read as well.
+//
+class SnapshotChain final
+{
+public:
+    using Ptr = std::shared_ptr<SnapshotChain>;
+
+    // Only parse the snapshots index, diff areas are parsed by 'Index'
+    static Ptr Open(StreamReader& stream, std::error_code& ec);
+
+    size_t Size() const { return m_informations.size(); }
+
+    const SnapshotInformation& Information(size_t position) const { return m_informations[position]; }
+
+    std::optional<size_t> Find(const GUID& shadowCopyId) const;
+
+    // Parse and index the diff area of the snapshot on first call, 'stream' is the volume holding the snapshots
+    const BlockIndex* Index(StreamReader& stream, size_t position, std::error_code& ec);
+
+    // Index of the snapshot if already built
+    const BlockIndex* IndexIfReady(size_t position) const;
+
+    // Resolve the copy-on-write for 'offset' for the shadow copy starting at 'position': use the first snapshot with a
+    // copy-on-write entry and follow its forwarders through the newer snapshots
+    std::optional<BlockIndex::CopyOnWrite>
+    FindCopyOnWrite(StreamReader& stream, size_t position, BlockIndex::BlockOffset offset, std::error_code& ec);
+
+    // Same as above without parsing: the snapshots not indexed yet are ignored
+    std::optional<BlockIndex::CopyOnWrite> FindCopyOnWrite(size_t position, BlockIndex::BlockOffset offset) const;
+
+    // Diff area blocks (copy-on-write and overlay data) by volume offset, shared by the shadow copies of the chain
+    VolumeBlockCache& StoreCache() { return m_storeCache; }
+
+private:
+    struct Slot
+    {
+        std::atomic<bool> ready {false};
+        BlockIndex index;
+    };
+
+    static constexpr size_t kStoreCacheBytes = 16 * 1024 * 1024;
+
+    SnapshotChain();
+
+    template <typename GetIndex>
+    std::optional<BlockIndex::CopyOnWrite>
+    ResolveCopyOnWrite(size_t position, BlockIndex::BlockOffset offset, GetIndex getIndex) const;
+
+    std::vector<SnapshotInformation> m_informations;
+    std::vector<std::unique_ptr<Slot>> m_slots;
+    std::mutex m_mutex;
+    VolumeBlockCache m_storeCache;
+};
+
+}  // namespace ShadowCopy
+}  // namespace Ntfs
+}  // namespace Orc
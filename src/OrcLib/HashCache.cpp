@@ -0,0 +1,297 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "HashCache.h"
+
+#include "Log/Log.h"
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcHashCacheEnv = L"DFIR-ORC_HASH_CACHE";
+constexpr DWORD HashCacheMagic = 0x33435248;  // 'HRC3', entries with a BLAKE3 slot
+constexpr DWORD HashCacheMaxProbes = 16;
+constexpr size_t HashCacheMaxHashSize = 32;
+
+constexpr auto HashCount = static_cast<size_t>(HashCache::Hash::Count);
+
+class SectionLock
+{
+public:
+    SectionLock(HANDLE hMutex)
+        : m_hMutex(hMutex)
+    {
+        // An abandoned mutex is acquired: a child process died holding it, entries are still consistent enough for
+        // a cache as each hash is written before its flag
+        const auto dwWait = WaitForSingleObject(m_hMutex, INFINITE);
+        m_bLocked = dwWait == WAIT_OBJECT_0 || dwWait == WAIT_ABANDONED;
+    }
+
+    ~SectionLock()
+    {
+        if (m_bLocked)
+            ReleaseMutex(m_hMutex);
+    }
+
+    bool IsLocked() const { return m_bLocked; }
+
+private:
+    HANDLE m_hMutex;
+    bool m_bLocked = false;
+};
+
+bool IsSameKey(const HashCache::Key& left, const HashCache::Key& right)
+{
+    return left.VolumeSerialNumber == right.VolumeSerialNumber && left.FRN == right.FRN
+        && left.DataSize == right.DataSize && left.LastModificationTime == right.LastModificationTime
+        && left.DataInstance == right.DataInstance;
+}
+
+ULONGLONG KeyHash(const HashCache::Key& key)
+{
+    // FNV-1a over the key fields
+    ULONGLONG hash = 0xcbf29ce484222325ULL;
+    const auto mix = [&hash](ULONGLONG value) {
+        for (int i = 0; i < 8; i++)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    mix(key.VolumeSerialNumber);
+    mix(key.FRN);
+    mix(key.DataSize);
+    mix(static_cast<ULONGLONG>(key.LastModificationTime));
+    mix(key.DataInstance);
+    return hash;
+}
+
+std::wstring MutexName(const std::wstring& strSection)
+{
+    return strSection + L"_MUTEX";
+}
+
+}  // namespace
+
+struct HashCache::Header
+{
+    DWORD Magic;
+    DWORD Capacity;
+};
+
+struct HashCache::Entry
+{
+    Key key;
+    DWORD InUse;
+    DWORD Available;  // one bit by hash
+    BYTE Sizes[HashCount];
+    BYTE Values[HashCount][HashCacheMaxHashSize];
+};
+
+HashCache& HashCache::Instance()
+{
+    static HashCache instance;
+    return instance;
+}
+
+HashCache::HashCache()
+{
+    const auto section = GetSection();
+    if (!section)
+        return;
+
+    HRESULT hr = Map(*section);
+    if (FAILED(hr))
+    {
+        Log::Warn(L"Failed to open hash cache '{}', hashes are not shared [{}]", *section, SystemError(hr));
+    }
+}
+
+HashCache::~HashCache()
+{
+    if (m_pHeader != nullptr)
+        UnmapViewOfFile(m_pHeader);
+    if (m_hSection != NULL)
+        CloseHandle(m_hSection);
+    if (m_hMutex != NULL)
+        CloseHandle(m_hMutex);
+}
+
+std::optional<std::wstring> HashCache::GetSection()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcHashCacheEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strSection(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcHashCacheEnv, strSection.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strSection.resize(nbChars);
+    return strSection;
+}
+
+HRESULT HashCache::Create(DWORD dwEntries)
+{
+    if (IsEnabled())
+    {
+        Log::Debug(L"Hash cache is inherited from a parent process");
+        return S_FALSE;
+    }
+
+    if (dwEntries == 0)
+        return E_INVALIDARG;
+
+    const auto strSection = fmt::format(L"Local\\DFIR-ORC_HASH_CACHE_{}", GetCurrentProcessId());
+
+    ULARGE_INTEGER size;
+    size.QuadPart = sizeof(Header) + static_cast<ULONGLONG>(dwEntries) * sizeof(Entry);
+
+    // The section is only referenced by this handle and the children's: it lives until the end of the run
+    m_hSection = CreateFileMappingW(
+        INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, size.HighPart, size.LowPart, strSection.c_str());
+    if (m_hSection == NULL)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to create hash cache section '{}' [{}]", strSection, SystemError(hr));
+        return hr;
+    }
+
+    m_hMutex = CreateMutexW(NULL, FALSE, MutexName(strSection).c_str());
+    if (m_hMutex == NULL)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to create hash cache mutex '{}' [{}]", strSection, SystemError(hr));
+        return hr;
+    }
+
+    m_pHeader = reinterpret_cast<Header*>(MapViewOfFile(m_hSection, FILE_MAP_READ | FILE_MAP_WRITE, 0L, 0L, 0));
+    if (m_pHeader == nullptr)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to map hash cache section '{}' [{}]", strSection, SystemError(hr));
+        return hr;
+    }
+
+    // Pagefile backed sections are zero initialized: entries are all free
+    m_pHeader->Capacity = dwEntries;
+    m_pHeader->Magic = HashCacheMagic;
+    m_pEntries = reinterpret_cast<Entry*>(m_pHeader + 1);
+
+    if (!SetEnvironmentVariableW(OrcHashCacheEnv, strSection.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcHashCacheEnv, strSection, SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Hashes are shared through '{}' ({} entries)", strSection, dwEntries);
+    return S_OK;
+}
+
+HRESULT HashCache::Map(const std::wstring& strSection)
+{
+    m_hSection = OpenFileMappingW(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, strSection.c_str());
+    if (m_hSection == NULL)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    m_hMutex = OpenMutexW(SYNCHRONIZE | MUTEX_MODIFY_STATE, FALSE, MutexName(strSection).c_str());
+    if (m_hMutex == NULL)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    auto pHeader = reinterpret_cast<Header*>(MapViewOfFile(m_hSection, FILE_MAP_READ | FILE_MAP_WRITE, 0L, 0L, 0));
+    if (pHeader == nullptr)
+        return HRESULT_FROM_WIN32(GetLastError());
+
+    MEMORY_BASIC_INFORMATION info;
+    if (VirtualQuery(pHeader, &info, sizeof(info)) == 0 || pHeader->Magic != HashCacheMagic || pHeader->Capacity == 0
+        || sizeof(Header) + static_cast<ULONGLONG>(pHeader->Capacity) * sizeof(Entry) > info.RegionSize)
+    {
+        UnmapViewOfFile(pHeader);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    m_pHeader = pHeader;
+    m_pEntries = reinterpret_cast<Entry*>(m_pHeader + 1);
+    return S_OK;
+}
+
+HashCache::Entry* HashCache::Find(const Key& key, bool bInsert)
+{
+    const auto dwCapacity = m_pHeader->Capacity;
+    const auto dwHome = static_cast<DWORD>(KeyHash(key) % dwCapacity);
+
+    Entry* pFree = nullptr;
+    for (DWORD i = 0; i < HashCacheMaxProbes && i < dwCapacity; i++)
+    {
+        auto& entry = m_pEntries[(dwHome + i) % dwCapacity];
+        if (!entry.InUse)
+        {
+            if (pFree == nullptr)
+                pFree = &entry;
+            continue;
+        }
+
+        if (IsSameKey(entry.key, key))
+            return &entry;
+    }
+
+    if (!bInsert)
+        return nullptr;
+
+    auto pEntry = pFree ? pFree : &m_pEntries[dwHome];
+    ZeroMemory(pEntry, sizeof(Entry));
+    pEntry->key = key;
+    pEntry->InUse = TRUE;
+    return pEntry;
+}
+
+bool HashCache::Lookup(const Key& key, Hash hash, CBinaryBuffer& value)
+{
+    if (!IsEnabled() || hash >= Hash::Count)
+        return false;
+
+    SectionLock lock(m_hMutex);
+    if (!lock.IsLocked())
+        return false;
+
+    const auto pEntry = Find(key, false);
+    const auto index = static_cast<size_t>(hash);
+    if (pEntry == nullptr || !(pEntry->Available & (1 << index)))
+        return false;
+
+    return SUCCEEDED(value.SetData(pEntry->Values[index], pEntry->Sizes[index]));
+}
+
+void HashCache::Store(const Key& key, Hash hash, const CBinaryBuffer& value)
+{
+    if (!IsEnabled() || hash >= Hash::Count || value.GetCount() == 0 || value.GetCount() > HashCacheMaxHashSize)
+        return;
+
+    SectionLock lock(m_hMutex);
+    if (!lock.IsLocked())
+        return;
+
+    const auto pEntry = Find(key, true);
+    const auto index = static_cast<size_t>(hash);
+
+    CopyMemory(pEntry->Values[index], value.GetData(), value.GetCount());
+    pEntry->Sizes[index] = static_cast<BYTE>(value.GetCount());
+    pEntry->Available |= (1 << index);
+}
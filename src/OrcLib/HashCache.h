@@ -0,0 +1,91 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "BinaryBuffer.h"
+
+#include <optional>
+#include <string>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Hashes of file data computed during a run, shared by this process and its child processes.
+//
+// Entries are keyed by the file's data stream identity and version: volume serial number, file reference number, data
+// attribute instance, data size and $STANDARD_INFORMATION last modification time. A file hashed by a tool is not read
+// again by the next ones while none of those changed.
+//
+// The table lives in a pagefile backed section created by the run's root process (inherited %DFIR-ORC_HASH_CACHE%):
+// it has a fixed capacity, a full probe sequence recycles its first slot. Accesses are serialized by a named mutex.
+//
+// The cache is disabled unless a section is created.
+class HashCache
+{
+public:
+    struct Key
+    {
+        ULONGLONG VolumeSerialNumber;
+        ULONGLONG FRN;
+        ULONGLONG DataSize;
+        LONGLONG LastModificationTime;
+        USHORT DataInstance;
+    };
+
+    enum class Hash : UCHAR
+    {
+        MD5 = 0,
+        SHA1,
+        SHA256,
+        PeMD5,
+        PeSHA1,
+        PeSHA256,
+        BLAKE3,
+        Count
+    };
+
+    static HashCache& Instance();
+
+    // Create a section of 'dwEntries' entries for this process and the processes it creates. Returns S_FALSE if a
+    // parent process already created one.
+    HRESULT Create(DWORD dwEntries);
+
+    bool IsEnabled() const { return m_pHeader != nullptr; }
+
+    bool Lookup(const Key& key, Hash hash, CBinaryBuffer& value);
+    void Store(const Key& key, Hash hash, const CBinaryBuffer& value);
+
+private:
+    struct Header;
+    struct Entry;
+
+    HashCache();
+    ~HashCache();
+
+    HashCache(const HashCache&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+
+    static std::optional<std::wstring> GetSection();
+
+    HRESULT Map(const std::wstring& strSection);
+
+    // Slot holding 'key' or, when 'bInsert', the slot to use for it
+    Entry* Find(const Key& key, bool bInsert);
+
+    HANDLE m_hSection = NULL;
+    HANDLE m_hMutex = NULL;
+    Header* m_pHeader = nullptr;
+    Entry* m_pEntries = nullptr;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,243 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "HashList.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+
+using namespace Orc;
+
+namespace {
+
+constexpr std::string_view kSeparators = " \t,;";
+
+std::optional<BYTE> HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return static_cast<BYTE>(c - '0');
+    if (c >= 'a' && c <= 'f')
+        return static_cast<BYTE>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F')
+        return static_cast<BYTE>(c - 'A' + 10);
+    return std::nullopt;
+}
+
+bool HexToBytes(std::string_view hex, BYTE* pBytes)
+{
+    for (size_t i = 0; i < hex.size() / 2; i++)
+    {
+        const auto high = HexDigit(hex[2 * i]);
+        const auto low = HexDigit(hex[2 * i + 1]);
+        if (!high || !low)
+            return false;
+
+        pBytes[i] = static_cast<BYTE>((*high << 4) | *low);
+    }
+    return true;
+}
+
+std::string_view NextToken(std::string_view& line)
+{
+    const auto start = line.find_first_not_of(kSeparators);
+    if (start == std::string_view::npos)
+    {
+        line = {};
+        return {};
+    }
+
+    const auto end = line.find_first_of(kSeparators, start);
+    const auto token = line.substr(start, end - start);
+    line = end == std::string_view::npos ? std::string_view() : line.substr(end);
+    return token;
+}
+
+}  // namespace
+
+template <size_t Length>
+void HashList::Table<Length>::Add(const BYTE* pHash)
+{
+    Entry entry;
+    std::copy_n(pHash, Length, std::begin(entry));
+    m_Entries.push_back(entry);
+}
+
+template <size_t Length>
+void HashList::Table<Length>::Seal()
+{
+    std::sort(std::begin(m_Entries), std::end(m_Entries));
+    m_Entries.erase(std::unique(std::begin(m_Entries), std::end(m_Entries)), std::end(m_Entries));
+    m_Entries.shrink_to_fit();
+
+    m_Buckets.clear();
+    if (m_Entries.empty())
+        return;
+
+    m_Buckets.resize(kBuckets + 1);
+
+    size_t entry = 0;
+    for (size_t bucket = 0; bucket < kBuckets; bucket++)
+    {
+        m_Buckets[bucket] = static_cast<uint32_t>(entry);
+        while (entry < m_Entries.size() && Bucket(m_Entries[entry].data()) == bucket)
+            entry++;
+    }
+    m_Buckets[kBuckets] = static_cast<uint32_t>(m_Entries.size());
+}
+
+template <size_t Length>
+bool HashList::Table<Length>::Contains(const BYTE* pHash) const
+{
+    if (m_Buckets.empty())
+        return false;
+
+    Entry entry;
+    std::copy_n(pHash, Length, std::begin(entry));
+
+    const auto bucket = Bucket(pHash);
+    return std::binary_search(
+        std::cbegin(m_Entries) + m_Buckets[bucket], std::cbegin(m_Entries) + m_Buckets[bucket + 1], entry);
+}
+
+HRESULT HashList::LoadFile(const std::wstring& strPath)
+{
+    std::ifstream ifs(std::filesystem::path(strPath), std::ios_base::binary);
+    if (!ifs)
+    {
+        Log::Error(L"Failed to open hash list '{}'", strPath);
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    std::ostringstream content;
+    content << ifs.rdbuf();
+    if (ifs.bad())
+    {
+        Log::Error(L"Failed to read hash list '{}'", strPath);
+        return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+    }
+
+    if (auto hr = Parse(content.str()); FAILED(hr))
+        return hr;
+
+    if (m_InvalidLines)
+        Log::Warn(L"Hash list '{}': {} invalid line(s) ignored", strPath, m_InvalidLines);
+
+    Log::Debug(L"Hash list '{}': {} hashes, size filter: {}", strPath, Count(), m_Sizes.empty() ? L"no" : L"yes");
+    return S_OK;
+}
+
+HRESULT HashList::Parse(std::string_view text)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        auto end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+
+        auto line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        const auto hash = NextToken(line);
+        if (hash.empty() || hash.front() == '#')
+            continue;
+
+        if (hash.size() != 2 * BYTES_IN_MD5_HASH && hash.size() != 2 * BYTES_IN_SHA1_HASH
+            && hash.size() != 2 * BYTES_IN_SHA256_HASH)
+        {
+            m_InvalidLines++;
+            continue;
+        }
+
+        BYTE bytes[BYTES_IN_SHA256_HASH];
+        if (!HexToBytes(hash, bytes))
+        {
+            m_InvalidLines++;
+            continue;
+        }
+
+        if (hash.size() == 2 * BYTES_IN_MD5_HASH)
+            m_MD5.Add(bytes);
+        else if (hash.size() == 2 * BYTES_IN_SHA1_HASH)
+            m_SHA1.Add(bytes);
+        else
+            m_SHA256.Add(bytes);
+
+        // Anything else than a size after the hash (a file name, a comment...) is ignored
+        const auto size = NextToken(line);
+        ULONGLONG ullSize = 0LL;
+        const auto [ptr, ec] = std::from_chars(size.data(), size.data() + size.size(), ullSize);
+        if (size.empty() || ec != std::errc() || ptr != size.data() + size.size())
+            m_bAllSized = false;
+        else if (m_bAllSized)
+            m_Sizes.push_back(ullSize);
+    }
+
+    m_MD5.Seal();
+    m_SHA1.Seal();
+    m_SHA256.Seal();
+
+    if (m_bAllSized)
+    {
+        std::sort(std::begin(m_Sizes), std::end(m_Sizes));
+        m_Sizes.erase(std::unique(std::begin(m_Sizes), std::end(m_Sizes)), std::end(m_Sizes));
+        m_Sizes.shrink_to_fit();
+    }
+    else
+    {
+        m_Sizes = {};
+    }
+
+    return S_OK;
+}
+
+CryptoHashStreamAlgorithm HashList::Algorithms() const
+{
+    auto algs = CryptoHashStreamAlgorithm::Undefined;
+    if (m_MD5.Count())
+        algs |= CryptoHashStreamAlgorithm::MD5;
+    if (m_SHA1.Count())
+        algs |= CryptoHashStreamAlgorithm::SHA1;
+    if (m_SHA256.Count())
+        algs |= CryptoHashStreamAlgorithm::SHA256;
+    return algs;
+}
+
+bool HashList::RejectsSize(ULONGLONG ullSize) const
+{
+    if (m_Sizes.empty())
+        return false;
+
+    return !std::binary_search(std::cbegin(m_Sizes), std::cend(m_Sizes), ullSize);
+}
+
+bool HashList::Contains(CryptoHashStreamAlgorithm alg, BufferView hash) const
+{
+    switch (alg)
+    {
+        case CryptoHashStreamAlgorithm::MD5:
+            return hash.size() == BYTES_IN_MD5_HASH && m_MD5.Contains(hash.data());
+        case CryptoHashStreamAlgorithm::SHA1:
+            return hash.size() == BYTES_IN_SHA1_HASH && m_SHA1.Contains(hash.data());
+        case CryptoHashStreamAlgorithm::SHA256:
+            return hash.size() == BYTES_IN_SHA256_HASH && m_SHA256.Contains(hash.data());
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,89 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "BinaryBuffer.h"
+#include "CryptoHashStreamAlgorithm.h"
+#include "CryptoUtilities.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// HashList: immutable set of md5, sha1 and sha256 hashes, typically loaded from an IOC feed.
+//
+// The list is a text file with one entry per line: an hexadecimal hash, whose length gives its algorithm, optionally
+// followed by the size of the file (separated by spaces, tabs, commas or semicolons). Empty lines and lines starting
+// with '#' are ignored, invalid lines are counted and skipped.
+//
+// Hashes are kept sorted in one flat array per algorithm, indexed by their first two bytes: a lookup is a small binary
+// search in a bucket of a few entries. When every entry provides a size, the sizes are kept as well so that a data
+// stream whose size is unknown to the list is rejected before being hashed.
+//
+class HashList
+{
+public:
+    HRESULT LoadFile(const std::wstring& strPath);
+    HRESULT Parse(std::string_view text);
+
+    size_t Count() const { return m_MD5.Count() + m_SHA1.Count() + m_SHA256.Count(); }
+    size_t InvalidLines() const { return m_InvalidLines; }
+
+    CryptoHashStreamAlgorithm Algorithms() const;
+
+    // 'true' when the list cannot contain a stream of this size
+    bool RejectsSize(ULONGLONG ullSize) const;
+
+    bool Contains(CryptoHashStreamAlgorithm alg, BufferView hash) const;
+
+private:
+    template <size_t Length>
+    class Table
+    {
+    public:
+        using Entry = std::array<BYTE, Length>;
+
+        void Add(const BYTE* pHash);
+        void Seal();
+
+        size_t Count() const { return m_Entries.size(); }
+        bool Contains(const BYTE* pHash) const;
+
+    private:
+        static constexpr size_t kBuckets = 1 << 16;
+
+        static size_t Bucket(const BYTE* pHash) { return (static_cast<size_t>(pHash[0]) << 8) | pHash[1]; }
+
+        std::vector<Entry> m_Entries;
+
+        // Entries of bucket 'i' are in [m_Buckets[i], m_Buckets[i + 1])
+        std::vector<uint32_t> m_Buckets;
+    };
+
+    Table<BYTES_IN_MD5_HASH> m_MD5;
+    Table<BYTES_IN_SHA1_HASH> m_SHA1;
+    Table<BYTES_IN_SHA256_HASH> m_SHA256;
+
+    // Sorted sizes of the entries, only used when all of them have a size
+    std::vector<ULONGLONG> m_Sizes;
+    bool m_bAllSized = true;
+
+    size_t m_InvalidLines = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
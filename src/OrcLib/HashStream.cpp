@@ -8,6 +8,10 @@
 #include "stdafx.h"
 #include "HashStream.h"
 
+#include "Telemetry.h"
+
+#include <algorithm>
+
 using namespace Orc;
 
 HRESULT HashStream::Read_(
@@ -40,6 +44,9 @@ HRESULT HashStream::Read_(
 
     if (cbBytesRead > 0)
     {
+        Telemetry::Scope telemetry(Telemetry::Phase::Hash);
+        telemetry.AddBytes(cbBytesRead);
+
         if (FAILED(hr = HashData((LPBYTE)pReadBuffer, (DWORD)cbBytesRead)))
             return hr;
     }
@@ -65,8 +72,13 @@ HRESULT HashStream::Write_(
         return E_INVALIDARG;
     }
 
-    if (FAILED(hr = HashData((LPBYTE)pWriteBuffer, (DWORD)cbBytesToWrite)))
-        return hr;
+    {
+        Telemetry::Scope telemetry(Telemetry::Phase::Hash);
+        telemetry.AddBytes(cbBytesToWrite);
+
+        if (FAILED(hr = HashData((LPBYTE)pWriteBuffer, (DWORD)cbBytesToWrite)))
+            return hr;
+    }
 
     if (m_pChainedStream != nullptr && m_bWriteOnly)
     {
@@ -86,6 +98,86 @@ HRESULT HashStream::Write_(
     return S_OK;
 }
 
+HRESULT HashStream::ReadV_(gsl::span<const BufferSpan> buffers, PULONGLONG pcbBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    *pcbBytesRead = 0;
+
+    if (m_bWriteOnly)
+        return E_NOTIMPL;
+    if (m_pChainedStream == nullptr)
+        return E_POINTER;
+    if (m_pChainedStream->CanRead() != S_OK)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_ACCESS);
+
+    ULONGLONG cbBytesRead = 0L;
+    if (FAILED(hr = m_pChainedStream->ReadV(buffers, &cbBytesRead)))
+        return hr;
+
+    if (cbBytesRead > 0)
+    {
+        Telemetry::Scope telemetry(Telemetry::Phase::Hash);
+        telemetry.AddBytes(cbBytesRead);
+
+        ULONGLONG cbToHash = cbBytesRead;
+        for (const auto& buffer : buffers)
+        {
+            if (cbToHash == 0)
+                break;
+
+            const auto cbBuffer = std::min<ULONGLONG>(buffer.size(), cbToHash);
+            if (FAILED(hr = HashData(buffer.data(), static_cast<DWORD>(cbBuffer))))
+                return hr;
+
+            cbToHash -= cbBuffer;
+        }
+    }
+
+    *pcbBytesRead = cbBytesRead;
+    return S_OK;
+}
+
+HRESULT HashStream::WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten)
+{
+    HRESULT hr = E_FAIL;
+
+    *pcbBytesWritten = 0;
+
+    ULONGLONG cbBytesToWrite = 0LL;
+    for (const auto& buffer : buffers)
+    {
+        if (buffer.size() > MAXDWORD)
+        {
+            Log::Error("HashStream: Too many bytes to hash");
+            return E_INVALIDARG;
+        }
+        cbBytesToWrite += buffer.size();
+    }
+
+    {
+        Telemetry::Scope telemetry(Telemetry::Phase::Hash);
+        telemetry.AddBytes(cbBytesToWrite);
+
+        for (const auto& buffer : buffers)
+        {
+            if (FAILED(hr = HashData(const_cast<LPBYTE>(buffer.data()), static_cast<DWORD>(buffer.size()))))
+                return hr;
+        }
+    }
+
+    if (m_pChainedStream != nullptr && m_bWriteOnly)
+    {
+        if (m_pChainedStream->CanWrite() != S_OK)
+            return HRESULT_FROM_WIN32(ERROR_INVALID_ACCESS);
+
+        return m_pChainedStream->WriteV(buffers, pcbBytesWritten);
+    }
+
+    *pcbBytesWritten = cbBytesToWrite;
+    return S_OK;
+}
+
 HRESULT
 HashStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer)
 {
@@ -89,6 +89,11 @@ public:
     STDMETHOD(Close)();
 
     virtual ~HashStream();
+
+protected:
+    // Buffers are hashed in turn and passed along to the chained stream as they are
+    HRESULT ReadV_(gsl::span<const BufferSpan> buffers, PULONGLONG pcbBytesRead) override;
+    HRESULT WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten) override;
 };
 
 }  // namespace Orc
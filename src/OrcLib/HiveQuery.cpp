@@ -11,11 +11,133 @@
 
 #include <sstream>
 
+#include "CryptoHashStream.h"
+#include "DevNullStream.h"
 #include "FileStream.h"
+#include "RegistryWalker.h"
 #include "VolumeReader.h"
 
 namespace Orc {
 
+namespace {
+
+// Base block fields updated each time the hive is written
+struct BaseBlockIdentity
+{
+    DWORD dwPrimarySequence = 0L;
+    DWORD dwSecondarySequence = 0L;
+    FILETIME LastModificationDate = {0};
+    DWORD dwDataBlockSize = 0L;
+    ULONGLONG ullSize = 0LL;
+
+    bool operator==(const BaseBlockIdentity& other) const
+    {
+        return dwPrimarySequence == other.dwPrimarySequence && dwSecondarySequence == other.dwSecondarySequence
+            && CompareFileTime(&LastModificationDate, &other.LastModificationDate) == 0
+            && dwDataBlockSize == other.dwDataBlockSize && ullSize == other.ullSize;
+    }
+};
+
+std::optional<BaseBlockIdentity> ReadBaseBlockIdentity(ByteStream& stream)
+{
+    RegistryFile header;
+    ULONGLONG ullRead = 0LL;
+
+    HRESULT hr = stream.SetFilePointer(0LL, FILE_BEGIN, nullptr);
+    if (SUCCEEDED(hr))
+    {
+        hr = stream.Read(&header, sizeof(header), &ullRead);
+    }
+
+    stream.SetFilePointer(0LL, FILE_BEGIN, nullptr);
+
+    if (FAILED(hr) || ullRead != sizeof(header) || strncmp(header.Signature, "regf", 4))
+    {
+        return std::nullopt;
+    }
+
+    BaseBlockIdentity identity;
+    identity.dwPrimarySequence = header.Reserved1;
+    identity.dwSecondarySequence = header.Reserved2;
+    identity.LastModificationDate = header.LastModificationDate;
+    identity.dwDataBlockSize = header.DataBlockSize;
+    identity.ullSize = stream.GetSize();
+    return identity;
+}
+
+std::optional<CBinaryBuffer> HashHive(const std::shared_ptr<ByteStream>& stream)
+{
+    CryptoHashStream hashStream;
+    if (FAILED(stream->SetFilePointer(0LL, FILE_BEGIN, nullptr))
+        || FAILED(hashStream.OpenToRead(CryptoHashStream::Algorithm::SHA256, stream)))
+    {
+        return std::nullopt;
+    }
+
+    ULONGLONG ullCopied = 0LL;
+    DevNullStream devNull;
+    HRESULT hr = hashStream.CopyTo(devNull, &ullCopied);
+
+    stream->SetFilePointer(0LL, FILE_BEGIN, nullptr);
+
+    CBinaryBuffer sha256;
+    if (FAILED(hr) || FAILED(hr = hashStream.GetSHA256(sha256)))
+    {
+        Log::Debug("Failed to hash hive [{}]", SystemError(hr));
+        return std::nullopt;
+    }
+
+    return sha256;
+}
+
+}  // namespace
+
+std::vector<std::optional<size_t>> HiveQuery::FindIdenticalHives(const std::vector<Hive>& hives)
+{
+    std::vector<std::optional<size_t>> sameAs(hives.size());
+    std::vector<std::optional<BaseBlockIdentity>> identities(hives.size());
+    std::vector<std::optional<CBinaryBuffer>> hashes(hives.size());
+    std::vector<bool> hashed(hives.size(), false);
+
+    const auto getHash = [&](size_t index) -> const std::optional<CBinaryBuffer>& {
+        if (!hashed[index])
+        {
+            hashes[index] = HashHive(hives[index].Stream);
+            hashed[index] = true;
+        }
+        return hashes[index];
+    };
+
+    for (size_t i = 0; i < hives.size(); ++i)
+    {
+        if (!hives[i].Stream)
+            continue;
+
+        identities[i] = ReadBaseBlockIdentity(*hives[i].Stream);
+        if (!identities[i])
+            continue;
+
+        // Only hives with the same base block are read in full to be compared
+        for (size_t j = 0; j < i; ++j)
+        {
+            if (sameAs[j] || !identities[j] || !(*identities[i] == *identities[j]))
+                continue;
+
+            const auto& hash = getHash(i);
+            if (!hash)
+                break;
+
+            if (const auto& other = getHash(j); other && *other == *hash)
+            {
+                sameAs[i] = j;
+                break;
+            }
+        }
+    }
+
+    return sameAs;
+}
+
 HRESULT HiveQuery::BuildStreamList()
 {
     HRESULT hr = m_HivesFind.Find(
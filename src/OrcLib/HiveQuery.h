@@ -10,6 +10,7 @@
 #include "Hive.h"
 #include "RegFind.h"
 
+#include <optional>
 #include <vector>
 #include <unordered_map>
 #include <string>
@@ -49,6 +50,10 @@ public:
     // Open hives for searching
     HRESULT BuildStreamList();
 
+    // For each hive, index of the first previous hive with the same content (like a hive unchanged between shadow
+    // copies). Hives are compared by their base block sequence numbers, timestamp and size, then by their SHA256
+    static std::vector<std::optional<size_t>> FindIdenticalHives(const std::vector<Hive>& hives);
+
     std::vector<std::wstring> m_HivesFileList;
 
     typedef std::unordered_multimap<std::shared_ptr<FileFind::SearchTerm>, std::shared_ptr<SearchQuery>>
@@ -0,0 +1,313 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "HostProfile.h"
+
+#include "MemoryAccounting.h"
+#include "TaskPool.h"
+#include "TemporaryPlacement.h"
+
+#include "Utils/Guard.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcHostProfileEnv = L"DFIR-ORC_HOST_PROFILE";
+
+// The read probe stops after this many bytes or this duration, whichever comes first
+constexpr DWORD kProbeChunkSize = 1024 * 1024L;
+constexpr ULONGLONG kProbeSize = 64 * 1024 * 1024ULL;
+constexpr auto kProbeDuration = std::chrono::milliseconds(250);
+
+// Memory each worker thread needs for its buffers: hosts short of memory get fewer workers than processors
+constexpr ULONGLONG kMemoryPerThread = 256 * 1024 * 1024ULL;
+
+constexpr DWORD kReadChunkSize = 1024 * 1024L;
+constexpr ULONGLONG kFastThroughput = 1024 * 1024 * 1024ULL;  // NVMe class disks
+
+// Each cache gets this share of the physical memory, within bounds
+constexpr ULONGLONG kCacheShare = 16LL;
+constexpr ULONGLONG kMinCacheSize = 64 * 1024 * 1024ULL;
+constexpr ULONGLONG kMaxCacheSize = 1024 * 1024 * 1024ULL;
+
+// Parquet's default row group size, scaled with the memory
+constexpr DWORD kRowGroupSize = 10000L;
+constexpr ULONGLONG kSmallMemory = 4 * 1024 * 1024 * 1024ULL;
+constexpr ULONGLONG kLargeMemory = 16 * 1024 * 1024 * 1024ULL;
+
+HostProfile GetConfiguredProfile()
+{
+    WCHAR szValue[128] = {0};
+    const auto nbChars = GetEnvironmentVariableW(OrcHostProfileEnv, szValue, ARRAYSIZE(szValue));
+    if (nbChars == 0 || nbChars >= ARRAYSIZE(szValue))
+    {
+        return {};
+    }
+
+    auto profile = HostProfile::FromString(szValue);
+    if (!profile)
+    {
+        Log::Warn(L"Invalid host profile %%{}%%: '{}'", OrcHostProfileEnv, szValue);
+        return {};
+    }
+
+    return *profile;
+}
+
+std::optional<ULONGLONG> ParseValue(std::wstring_view value)
+{
+    if (value.empty() || value.size() > 19)
+        return {};
+
+    ULONGLONG ullValue = 0LL;
+    for (const auto c : value)
+    {
+        if (c < L'0' || c > L'9')
+            return {};
+
+        ullValue = ullValue * 10ULL + (c - L'0');
+    }
+
+    return ullValue;
+}
+
+// Sequential unbuffered reads from the start of the volume mounted on 'root', in bytes per second (0 if it failed)
+ULONGLONG ProbeThroughput(const std::wstring& root)
+{
+    // "C:\" -> "\\.\C:"
+    std::wstring device = L"\\\\.\\" + root;
+    if (!device.empty() && device.back() == L'\\')
+        device.pop_back();
+
+    Guard::FileHandle hVolume(CreateFileW(
+        device.c_str(),
+        FILE_READ_DATA,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN,
+        NULL));
+    if (!hVolume.IsValid())
+    {
+        Log::Debug(L"Failed to open volume '{}' for the read probe [{}]", device, LastWin32Error());
+        return 0LL;
+    }
+
+    // Unbuffered reads need a sector aligned buffer
+    const auto pBuffer = VirtualAlloc(NULL, kProbeChunkSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (pBuffer == NULL)
+        return 0LL;
+
+    Guard::Scope onExit([pBuffer]() { VirtualFree(pBuffer, 0L, MEM_RELEASE); });
+
+    ULONGLONG ullBytes = 0LL;
+    const auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    while (ullBytes < kProbeSize && elapsed < kProbeDuration)
+    {
+        DWORD dwRead = 0L;
+        if (!ReadFile(*hVolume, pBuffer, kProbeChunkSize, &dwRead, NULL))
+        {
+            Log::Debug(L"Failed to read volume '{}' at offset {} [{}]", device, ullBytes, LastWin32Error());
+            return 0LL;
+        }
+
+        if (dwRead == 0L)
+            break;
+
+        ullBytes += dwRead;
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    if (us <= 0)
+        return 0LL;
+
+    return static_cast<ULONGLONG>(static_cast<double>(ullBytes) * 1000000.0 / us);
+}
+
+}  // namespace
+
+HostProfile& HostProfile::Instance()
+{
+    static HostProfile instance(GetConfiguredProfile());
+    return instance;
+}
+
+HostProfile::Measures HostProfile::Measure(const std::vector<std::wstring>& volumes)
+{
+    Measures measures;
+    measures.Processors = TaskPool::Instance().Processors();
+
+    MEMORYSTATUSEX status = {0};
+    status.dwLength = sizeof(status);
+    if (GlobalMemoryStatusEx(&status))
+        measures.PhysicalMemory = status.ullTotalPhys;
+    else
+        Log::Debug(L"Failed GlobalMemoryStatusEx [{}]", LastWin32Error());
+
+    if (!volumes.empty())
+    {
+        measures.bSeekPenalty =
+            std::any_of(std::cbegin(volumes), std::cend(volumes), &TemporaryPlacement::IncursSeekPenalty);
+        measures.ProbeThroughput = ::ProbeThroughput(volumes.front());
+    }
+
+    Log::Debug(
+        L"Host measures: {} processors, {} bytes of memory, {} disks, read probe: {} bytes/s",
+        measures.Processors,
+        measures.PhysicalMemory,
+        measures.bSeekPenalty ? L"rotational" : L"solid state",
+        measures.ProbeThroughput);
+
+    return measures;
+}
+
+HostProfile HostProfile::Derive(const Measures& measures)
+{
+    HostProfile profile;
+    profile.m_Measures = measures;
+
+    ULONGLONG ullThreads = std::max(measures.Processors, 1UL);
+    if (measures.PhysicalMemory > 0)
+        ullThreads = std::min(ullThreads, std::max(measures.PhysicalMemory / kMemoryPerThread, 1ULL));
+    profile.m_dwThreads = static_cast<DWORD>(ullThreads);
+
+    // Queued reads make a rotational disk seek: few of them. Solid state disks serve deeper queues, the fastest ones
+    // need the deepest to reach their throughput.
+    DWORD dwQueueDepth = 2L;
+    if (!measures.bSeekPenalty)
+        dwQueueDepth = measures.ProbeThroughput >= kFastThroughput ? 16L : 8L;
+    profile.m_ReadProfile = VolumeReadProfile(kReadChunkSize, dwQueueDepth);
+
+    // Unknown memory is handled as a small host
+    const auto ullMemory = measures.PhysicalMemory > 0 ? measures.PhysicalMemory : kSmallMemory - 1;
+    profile.m_ullCacheSize = std::clamp(ullMemory / kCacheShare, kMinCacheSize, kMaxCacheSize);
+
+    if (ullMemory >= kLargeMemory)
+        profile.m_dwRowGroupSize = kRowGroupSize * 5;
+    else if (ullMemory < kSmallMemory)
+        profile.m_dwRowGroupSize = kRowGroupSize / 2;
+    else
+        profile.m_dwRowGroupSize = kRowGroupSize;
+
+    return profile;
+}
+
+HRESULT HostProfile::Configure()
+{
+    const auto strValue = ToString();
+    if (!SetEnvironmentVariableW(OrcHostProfileEnv, strValue.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcHostProfileEnv, strValue, SystemError(hr));
+        return hr;
+    }
+
+    Instance() = *this;
+
+    auto& readProfile = VolumeReadProfile::Instance();
+    if (!readProfile.IsDefault())
+    {
+        Log::Debug(L"Volume read profile is configured ({}), host profile's is not used", readProfile.ToString());
+    }
+    else if (auto hr = readProfile.Configure(m_ReadProfile); FAILED(hr))
+    {
+        return hr;
+    }
+
+    bool bHasSoftLimit = false;
+    for (UCHAR i = 0; i < static_cast<UCHAR>(MemoryAccounting::Tag::Count); i++)
+        bHasSoftLimit |= MemoryAccounting::GetSoftLimit(static_cast<MemoryAccounting::Tag>(i)) > 0;
+
+    if (bHasSoftLimit)
+    {
+        Log::Debug(L"Memory soft limits are configured, host profile's cache size is not used");
+    }
+    else
+    {
+        const auto strLimits = fmt::format(
+            L"{}:{},{}:{}",
+            MemoryAccounting::ToString(MemoryAccounting::Tag::MFTWalk),
+            m_ullCacheSize,
+            MemoryAccounting::ToString(MemoryAccounting::Tag::TableWrite),
+            m_ullCacheSize);
+        if (auto hr = MemoryAccounting::ConfigureSoftLimits(strLimits); FAILED(hr))
+            return hr;
+    }
+
+    Log::Info(L"Host profile: {}", strValue);
+    return S_OK;
+}
+
+std::wstring HostProfile::ToString() const
+{
+    return fmt::format(
+        L"threads:{},read:{},cache:{},row_group:{}",
+        m_dwThreads,
+        m_ReadProfile.ToString(),
+        m_ullCacheSize,
+        m_dwRowGroupSize);
+}
+
+std::optional<HostProfile> HostProfile::FromString(std::wstring_view profile)
+{
+    HostProfile result;
+    bool bHasRead = false;
+
+    while (!profile.empty())
+    {
+        const auto end = profile.find(L',');
+        const auto item = profile.substr(0, end);
+        profile = end == std::wstring_view::npos ? std::wstring_view() : profile.substr(end + 1);
+
+        const auto separator = item.find(L':');
+        if (separator == std::wstring_view::npos)
+            return {};
+
+        const auto key = item.substr(0, separator);
+        const auto value = item.substr(separator + 1);
+
+        if (key == L"read")
+        {
+            const auto readProfile = VolumeReadProfile::FromString(value);
+            if (!readProfile)
+                return {};
+
+            result.m_ReadProfile = *readProfile;
+            bHasRead = true;
+            continue;
+        }
+
+        const auto number = ParseValue(value);
+        if (!number || *number == 0LL)
+            return {};
+
+        if (key == L"threads" && *number <= MAXDWORD)
+            result.m_dwThreads = static_cast<DWORD>(*number);
+        else if (key == L"cache")
+            result.m_ullCacheSize = *number;
+        else if (key == L"row_group" && *number <= MAXDWORD)
+            result.m_dwRowGroupSize = static_cast<DWORD>(*number);
+        else
+            return {};
+    }
+
+    if (result.m_dwThreads == 0L || !bHasRead || result.m_ullCacheSize == 0LL || result.m_dwRowGroupSize == 0L)
+        return {};
+
+    return result;
+}
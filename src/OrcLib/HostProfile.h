@@ -0,0 +1,80 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "VolumeReadProfile.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Defaults of the performance settings of the tools, tuned for the host: worker threads, volume read profile, memory
+// soft limits of the caches and row group size of the table outputs.
+//
+// WolfLauncher calibrates the profile once at startup (/calibrate) from the processors available to the process, the
+// physical memory, the seek penalty of the disks of the target volumes and a short read probe of the first of them.
+// Commands inherit it through %DFIR-ORC_HOST_PROFILE%. Explicit settings always win: the read profile and the memory
+// soft limits are only set when none is configured, a row group size given for an output is kept.
+class HostProfile
+{
+public:
+    // What the calibration found on the host, zero when unknown
+    struct Measures
+    {
+        ULONG Processors = 0L;
+        ULONGLONG PhysicalMemory = 0LL;
+        bool bSeekPenalty = true;  // any disk of the target volumes, unknown disks are treated as rotational
+        ULONGLONG ProbeThroughput = 0LL;  // bytes per second of the read probe
+    };
+
+    static HostProfile& Instance();
+
+    HostProfile() = default;
+
+    // Measure the host, 'volumes' are the roots of the volumes read by the commands ("C:\")
+    static Measures Measure(const std::vector<std::wstring>& volumes);
+
+    // Profile of a host measured as 'measures'
+    static HostProfile Derive(const Measures& measures);
+
+    // Use this profile in this process and as default for the processes it creates
+    HRESULT Configure();
+
+    bool IsDefault() const { return m_dwThreads == 0L; }
+
+    const Measures& GetMeasures() const { return m_Measures; }
+
+    DWORD Threads() const { return m_dwThreads; }
+    const VolumeReadProfile& ReadProfile() const { return m_ReadProfile; }
+    ULONGLONG CacheSize() const { return m_ullCacheSize; }
+    DWORD RowGroupSize() const { return m_dwRowGroupSize; }
+
+    // "threads:<Count>,read:<ChunkSize>:<QueueDepth>,cache:<Bytes>,row_group:<Rows>"
+    std::wstring ToString() const;
+    static std::optional<HostProfile> FromString(std::wstring_view profile);
+
+private:
+    Measures m_Measures;
+
+    DWORD m_dwThreads = 0L;
+    VolumeReadProfile m_ReadProfile;
+    ULONGLONG m_ullCacheSize = 0LL;  // soft limit of each cache charged to MemoryAccounting
+    DWORD m_dwRowGroupSize = 0L;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -23,6 +23,9 @@ public:
 
     virtual ULONG64 GetMftOffset() PURE;
 
+    // Restrict EnumMFTRecord to the records in use according to $MFT:$BITMAP
+    virtual HRESULT SkipUnusedRecords() PURE;
+
     virtual HRESULT EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack) PURE;
     virtual HRESULT FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUtils::EnumMFTRecordCall pCallBack) PURE;
 
@@ -10,11 +10,15 @@
 
 #include <regex>
 
+#include <boost/scope_exit.hpp>
+
 #include "ImageReader.h"
 
+#include "IoTrace.h"
 #include "ParameterCheck.h"
 
 #include "PartitionTable.h"
+#include "Telemetry.h"
 
 using namespace std;
 
@@ -147,9 +151,59 @@ HRESULT ImageReader::LoadDiskProperties(void)
     if (SUCCEEDED(hr))
         m_bReadyForEnumeration = true;
 
+    // Once the boot sector is parsed, reads are copied from the mapping of the image
+    if (FAILED(hr = m_MappedView.Open(m_Extents[0].GetHandle())))
+    {
+        Log::Debug(L"Image '{}' is not mapped, it will be read [{}]", strImageFile, SystemError(hr));
+    }
+
     return S_OK;
 }
 
+HRESULT ImageReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    if (!m_MappedView.IsOpen())
+        return CompleteVolumeReader::Read(offset, data, ullBytesToRead, ullBytesRead);
+
+    concurrency::critical_section::scoped_lock sl(m_csMapping);
+
+    ullBytesRead = 0LL;
+    IoTrace::Instance().RecordRead(m_szLocation, offset, ullBytesToRead);
+    Telemetry::Scope telemetry(Telemetry::Phase::VolumeRead);
+    BOOST_SCOPE_EXIT(&telemetry, &ullBytesRead) { telemetry.AddBytes(ullBytesRead); }
+    BOOST_SCOPE_EXIT_END;
+
+    const auto& extent = m_Extents[0];
+    if (offset >= extent.m_Length)
+        return S_OK;
+
+    ullBytesToRead = std::min(ullBytesToRead, extent.m_Length - offset);
+
+    if (data.OwnsBuffer() && !data.SetCount(static_cast<size_t>(ullBytesToRead)))
+        return E_OUTOFMEMORY;
+
+    // Neither alignment nor bounce buffer: the image is copied straight from the mapping into the caller's buffer
+    size_t cbRead = 0;
+    if (FAILED(
+            hr = m_MappedView.Read(
+                extent.m_Start + offset,
+                data.GetData(),
+                std::min(data.GetCount(), static_cast<size_t>(ullBytesToRead)),
+                cbRead)))
+    {
+        Log::Error(L"Failed to read image '{}' at offset {} [{}]", m_szImageReader, offset, SystemError(hr));
+        return hr;
+    }
+
+    ullBytesRead = cbRead;
+    data.SetCount(static_cast<size_t>(ullBytesRead));
+
+    // Keep the position consistent with the sequential reads
+    return Seek(offset + ullBytesRead);
+}
+
 std::shared_ptr<VolumeReader> ImageReader::DuplicateReader()
 {
     return std::make_shared<ImageReader>(m_szImageReader);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "CompleteVolumeReader.h"
+#include "MappedFileView.h"
 
 #pragma managed(push, off)
 
@@ -18,6 +19,10 @@ class ImageReader : public CompleteVolumeReader
 private:
     WCHAR m_szImageReader[ORC_MAX_PATH];
 
+    // Images are read through a mapping when possible, reads are serialized as each one may move the mapped window
+    MappedFileView m_MappedView;
+    concurrency::critical_section m_csMapping;
+
 protected:
     virtual std::shared_ptr<VolumeReader> DuplicateReader();
 
@@ -31,6 +36,12 @@ public:
     virtual HRESULT LoadDiskProperties(void);
     virtual HANDLE GetDevice() { return INVALID_HANDLE_VALUE; }
 
+    bool IsMapped() const { return m_MappedView.IsOpen(); }
+
+    using VolumeReader::Read;
+
+    HRESULT Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
+
     ~ImageReader(void);
 };
 
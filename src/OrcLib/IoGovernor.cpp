@@ -0,0 +1,153 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "IoGovernor.h"
+
+#include "Kernel32Extension.h"
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <string>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcIoGovernorEnv = L"DFIR-ORC_IO_GOVERNOR";
+
+// Weight of the last read in the smoothed latency
+constexpr double kLatencyWeight = 1.0 / 8.0;
+
+// FILE_INFO_BY_HANDLE_CLASS and FILE_IO_PRIORITY_HINT_INFO are not declared when targeting Windows XP
+constexpr DWORD kFileIoPriorityHintInfo = 12L;
+constexpr DWORD kIoPriorityHintLow = 1L;
+
+struct IoPriorityHintInfo
+{
+    DWORD PriorityHint;
+};
+
+std::chrono::milliseconds GetConfiguredLatency()
+{
+    WCHAR szValue[16] = {0};
+    const auto nbChars = GetEnvironmentVariableW(OrcIoGovernorEnv, szValue, ARRAYSIZE(szValue));
+    if (nbChars == 0 || nbChars >= ARRAYSIZE(szValue))
+    {
+        return std::chrono::milliseconds::zero();
+    }
+
+    return std::chrono::milliseconds(wcstoul(szValue, nullptr, 10));
+}
+
+}  // namespace
+
+IoGovernor& IoGovernor::Instance()
+{
+    static IoGovernor instance(GetConfiguredLatency());
+    return instance;
+}
+
+IoGovernor::IoGovernor(std::chrono::milliseconds maxLatency)
+    : m_MaxLatency(std::max(maxLatency, std::chrono::milliseconds::zero()))
+{
+}
+
+HRESULT IoGovernor::Configure(std::chrono::milliseconds maxLatency)
+{
+    if (maxLatency.count() <= 0)
+        return E_INVALIDARG;
+
+    m_MaxLatency = maxLatency;
+
+    const auto strValue = std::to_wstring(maxLatency.count());
+    if (!SetEnvironmentVariableW(OrcIoGovernorEnv, strValue.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcIoGovernorEnv, strValue, SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Volume reads are throttled above {} msecs of latency", maxLatency.count());
+    return S_OK;
+}
+
+HRESULT IoGovernor::SetLowPriority(HANDLE hFile) const
+{
+    if (!IsEnabled())
+        return S_FALSE;
+
+    const auto k32 = ExtensionLibrary::GetLibrary<Kernel32Extension>();
+    if (k32 == nullptr)
+        return E_NOTIMPL;
+
+    IoPriorityHintInfo info = {kIoPriorityHintLow};
+    if (auto hr = k32->SetFileInformationByHandle(hFile, kFileIoPriorityHintInfo, &info, sizeof(info)); FAILED(hr))
+    {
+        Log::Debug(L"Failed to set low I/O priority hint [{}]", SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+void IoGovernor::Throttle(ULONGLONG ullBytes)
+{
+    const auto dwDelay = m_dwDelay.load(std::memory_order_relaxed);
+    if (dwDelay == 0)
+        return;
+
+    Telemetry::Scope telemetry(Telemetry::Phase::IoThrottle);
+    telemetry.AddBytes(ullBytes);
+    Sleep(dwDelay);
+}
+
+void IoGovernor::Record(ULONGLONG ullBytes, std::chrono::microseconds duration)
+{
+    if (!IsEnabled())
+        return;
+
+    // Transfer time of large reads is not latency
+    double dLatency = static_cast<double>(duration.count());
+    if (ullBytes > kReferenceSize)
+        dLatency = dLatency * kReferenceSize / ullBytes;
+
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    m_dLatency = m_dLatency == 0.0 ? dLatency : m_dLatency + (dLatency - m_dLatency) * kLatencyWeight;
+
+    if (++m_ulReads < kReadsPerWindow)
+        return;
+
+    m_ulReads = 0L;
+
+    const auto dMaxLatency =
+        static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(m_MaxLatency).count());
+    const auto dwDelay = m_dwDelay.load(std::memory_order_relaxed);
+
+    if (m_dLatency > dMaxLatency)
+    {
+        const auto dwNewDelay = static_cast<DWORD>(
+            std::clamp<ULONGLONG>(dwDelay * 2ULL, kMinDelay.count(), static_cast<ULONGLONG>(kMaxDelay.count())));
+        if (dwNewDelay != dwDelay)
+        {
+            m_ulBackoffs++;
+            m_dwDelay.store(dwNewDelay, std::memory_order_relaxed);
+            Log::Trace(L"Read latency is {} usecs: delaying reads by {} msecs", m_dLatency, dwNewDelay);
+        }
+    }
+    else if (dwDelay > 0 && m_dLatency < dMaxLatency / 2)
+    {
+        const DWORD dwNewDelay = dwDelay / 2 < kMinDelay.count() ? 0L : dwDelay / 2;
+        m_ulRecoveries++;
+        m_dwDelay.store(dwNewDelay, std::memory_order_relaxed);
+        Log::Trace(L"Read latency is {} usecs: delaying reads by {} msecs", m_dLatency, dwNewDelay);
+    }
+}
@@ -0,0 +1,85 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <atomic>
+#include <chrono>
+
+#include <concrt.h>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Throttling of the volume reads on a live host, so that a collection does not push the disk latency seen by the
+// services running there.
+//
+// Read latencies are smoothed over the last reads (reads larger than the reference size count for the time of their
+// first reference size bytes). Every window of reads, a latency above the limit doubles the delay inserted before each
+// read, a latency under half the limit (the host is idle again) halves it. Handles opened while throttling get a low
+// I/O priority hint so the storage stack serves other I/Os first. Delays are accounted in the IoThrottle telemetry
+// phase.
+//
+// The process governor is disabled unless configured, its configuration is inherited by the processes it creates
+// through %DFIR-ORC_IO_GOVERNOR% (maximum latency in milliseconds).
+class IoGovernor
+{
+public:
+    static constexpr std::chrono::milliseconds kDefaultMaxLatency = std::chrono::milliseconds(20);
+    static constexpr std::chrono::milliseconds kMinDelay = std::chrono::milliseconds(1);
+    static constexpr std::chrono::milliseconds kMaxDelay = std::chrono::milliseconds(500);
+    static constexpr ULONG kReferenceSize = 256 * 1024L;
+    static constexpr ULONG kReadsPerWindow = 8L;
+
+    // Overlapped reads kept in flight on a throttled handle
+    static constexpr DWORD kMaxQueueDepth = 2L;
+
+    static IoGovernor& Instance();
+
+    // A zero latency disables throttling
+    IoGovernor(std::chrono::milliseconds maxLatency = std::chrono::milliseconds::zero());
+
+    IoGovernor(const IoGovernor&) = delete;
+    IoGovernor& operator=(const IoGovernor&) = delete;
+
+    // Throttle the reads of this process and of the processes it creates
+    HRESULT Configure(std::chrono::milliseconds maxLatency);
+
+    bool IsEnabled() const { return m_MaxLatency.count() > 0; }
+    std::chrono::milliseconds MaxLatency() const { return m_MaxLatency; }
+    std::chrono::milliseconds Delay() const { return std::chrono::milliseconds(m_dwDelay.load()); }
+
+    // Give 'hFile' a low I/O priority hint, S_FALSE when throttling is disabled
+    HRESULT SetLowPriority(HANDLE hFile) const;
+
+    // Wait the current delay, if any, before a read of 'ullBytes'
+    void Throttle(ULONGLONG ullBytes);
+
+    // Account for a read of 'ullBytes' which took 'duration'
+    void Record(ULONGLONG ullBytes, std::chrono::microseconds duration);
+
+    ULONG Backoffs() const { return m_ulBackoffs; }
+    ULONG Recoveries() const { return m_ulRecoveries; }
+
+private:
+    std::chrono::milliseconds m_MaxLatency;
+    std::atomic<DWORD> m_dwDelay {0L};
+
+    concurrency::critical_section m_cs;
+    double m_dLatency = 0.0;  // smoothed, in microseconds
+    ULONG m_ulReads = 0L;
+
+    ULONG m_ulBackoffs = 0L;
+    ULONG m_ulRecoveries = 0L;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
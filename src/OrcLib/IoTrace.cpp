@@ -0,0 +1,285 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "IoTrace.h"
+
+#include "Telemetry.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcIoTraceEnv = L"DFIR-ORC_IO_TRACE";
+
+constexpr DWORD kTraceMagic = 0x54524F49;  // 'IORT'
+constexpr WORD kTraceVersion = 1;
+
+// Entries are written by chunks of this size
+constexpr size_t kFlushSize = 1024 * 1024;
+
+struct Header
+{
+    DWORD Magic = kTraceMagic;
+    WORD Version = kTraceVersion;
+    WORD EntrySize = sizeof(IoTrace::Entry);
+    DWORD ProcessId = 0L;
+    DWORD Reserved = 0L;
+    FILETIME Start = {0};
+};
+static_assert(sizeof(Header) == 24);
+
+void AppendBytes(std::vector<BYTE>& buffer, const void* pData, size_t cbData)
+{
+    const auto pBytes = reinterpret_cast<const BYTE*>(pData);
+    buffer.insert(std::end(buffer), pBytes, pBytes + cbData);
+}
+
+}  // namespace
+
+IoTrace& IoTrace::Instance()
+{
+    static IoTrace instance;
+    [[maybe_unused]] static const bool bInitialized = []() {
+        const auto directory = GetDirectory();
+        if (directory)
+        {
+            const auto path = std::filesystem::path(*directory) / fmt::format(L"{}.iotrace", GetCurrentProcessId());
+            instance.Open(path);
+        }
+
+        return true;
+    }();
+
+    return instance;
+}
+
+IoTrace::~IoTrace()
+{
+    Close();
+}
+
+HRESULT IoTrace::Open(const std::filesystem::path& path)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Guard::FileHandle hFile(CreateFileW(
+        path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL));
+    if (!hFile.IsValid())
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to create I/O trace '{}' [{}]", path.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Header header;
+    header.ProcessId = GetCurrentProcessId();
+    GetSystemTimeAsFileTime(&header.Start);
+
+    // Reopened: the previous trace is completed first
+    FlushLocked();
+    if (m_hFile.IsValid())
+        CloseHandle(m_hFile.release());
+
+    m_hFile = std::move(hFile);
+    m_start = std::chrono::steady_clock::now();
+    m_locations.clear();
+    m_buffer.clear();
+    m_buffer.reserve(kFlushSize + sizeof(Entry));
+    AppendBytes(m_buffer, &header, sizeof(header));
+
+    m_bEnabled.store(true, std::memory_order_relaxed);
+    Log::Debug(L"Volume reads are traced to '{}'", path.wstring());
+    return S_OK;
+}
+
+HRESULT IoTrace::Close()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_hFile.IsValid())
+        return S_FALSE;
+
+    m_bEnabled.store(false, std::memory_order_relaxed);
+
+    const auto hr = FlushLocked();
+    CloseHandle(m_hFile.release());
+    return hr;
+}
+
+void IoTrace::Append(const WCHAR* szLocation, ULONGLONG ullOffset, ULONGLONG ullLength)
+{
+    Entry entry;
+    entry.Offset = ullOffset;
+    entry.Length = static_cast<DWORD>(std::min<ULONGLONG>(ullLength, MAXDWORD));
+    entry.ThreadId = GetCurrentThreadId();
+    entry.Subsystem = static_cast<UCHAR>(Telemetry::CurrentPhase());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!m_hFile.IsValid())
+        return;
+
+    entry.Timestamp = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start)
+                          .count();
+
+    const std::wstring_view location(szLocation != nullptr ? szLocation : L"");
+    auto it = m_locations.find(std::wstring(location));
+    if (it == std::end(m_locations))
+    {
+        if (m_locations.size() > MAXWORD)
+            return;
+
+        it = m_locations.emplace(location, static_cast<WORD>(m_locations.size())).first;
+
+        Entry locationEntry;
+        locationEntry.Type = EntryType::Location;
+        locationEntry.Location = it->second;
+        locationEntry.Length = static_cast<DWORD>(location.size() * sizeof(WCHAR));
+        AppendBytes(m_buffer, &locationEntry, sizeof(locationEntry));
+        AppendBytes(m_buffer, location.data(), locationEntry.Length);
+    }
+
+    entry.Location = it->second;
+    AppendBytes(m_buffer, &entry, sizeof(entry));
+
+    if (m_buffer.size() >= kFlushSize)
+        FlushLocked();
+}
+
+HRESULT IoTrace::Flush()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return FlushLocked();
+}
+
+HRESULT IoTrace::FlushLocked()
+{
+    if (!m_hFile.IsValid() || m_buffer.empty())
+        return S_OK;
+
+    DWORD dwWritten = 0L;
+    if (!WriteFile(*m_hFile, m_buffer.data(), static_cast<DWORD>(m_buffer.size()), &dwWritten, NULL))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to write I/O trace, tracing is stopped [{}]", SystemError(hr));
+        m_bEnabled.store(false, std::memory_order_relaxed);
+        CloseHandle(m_hFile.release());
+        return hr;
+    }
+
+    m_buffer.clear();
+    return S_OK;
+}
+
+HRESULT IoTrace::ConfigureDirectory(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid I/O trace directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create I/O trace directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcIoTraceEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcIoTraceEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+std::optional<std::wstring> IoTrace::GetDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcIoTraceEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcIoTraceEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+HRESULT IoTrace::Load(const std::filesystem::path& path, Trace& trace)
+{
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+    {
+        Log::Error(L"Failed to open I/O trace '{}'", path.wstring());
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    Header header;
+    if (!input.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != kTraceMagic
+        || header.Version != kTraceVersion || header.EntrySize != sizeof(Entry))
+    {
+        Log::Error(L"Invalid I/O trace '{}'", path.wstring());
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    trace.Locations.clear();
+    trace.Reads.clear();
+
+    Entry entry;
+    while (input.read(reinterpret_cast<char*>(&entry), sizeof(entry)))
+    {
+        if (entry.Type == EntryType::Read)
+        {
+            if (entry.Location >= trace.Locations.size())
+            {
+                Log::Error(L"Invalid I/O trace '{}': read of an unknown location", path.wstring());
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+
+            trace.Reads.push_back(entry);
+            continue;
+        }
+
+        if (entry.Type != EntryType::Location || entry.Location != trace.Locations.size()
+            || entry.Length % sizeof(WCHAR) != 0)
+        {
+            Log::Error(L"Invalid I/O trace '{}': unexpected entry", path.wstring());
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        std::wstring location(entry.Length / sizeof(WCHAR), L'\0');
+        if (!input.read(reinterpret_cast<char*>(location.data()), entry.Length))
+            break;
+
+        trace.Locations.push_back(std::move(location));
+    }
+
+    return S_OK;
+}
@@ -0,0 +1,108 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "Utils/Guard.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// IoTrace: records the volume reads of the process to a compact binary trace, to study the access patterns of the
+// tools and to replay them against a device or an image ('NTFSUtil /replay').
+//
+// When %DFIR-ORC_IO_TRACE% designates a directory (/io_trace, inherited by child processes), each process writes its
+// reads to '<directory>\<pid>.iotrace'. Readers record the reads they are asked for, before their block cache and
+// read-ahead: a replay goes through them as the traced run did.
+//
+class IoTrace
+{
+public:
+    enum class EntryType : UCHAR
+    {
+        Read = 0,
+        Location  // followed by the location name, 'Length' bytes of UTF-16
+    };
+
+    struct Entry
+    {
+        ULONGLONG Offset = 0LL;
+        ULONGLONG Timestamp = 0LL;  // microseconds since the trace start
+        DWORD Length = 0L;
+        DWORD ThreadId = 0L;
+        WORD Location = 0;  // index of the location name
+        EntryType Type = EntryType::Read;
+        UCHAR Subsystem = 0;  // Telemetry::Phase of the caller
+        DWORD Reserved = 0L;
+    };
+    static_assert(sizeof(Entry) == 32);
+
+    // Reads of a trace, in the order they were issued
+    struct Trace
+    {
+        std::vector<std::wstring> Locations;
+        std::vector<Entry> Reads;
+    };
+
+    static IoTrace& Instance();
+
+    IoTrace() = default;
+    ~IoTrace();
+
+    IoTrace(const IoTrace&) = delete;
+    IoTrace& operator=(const IoTrace&) = delete;
+
+    // Start recording to 'path', which is overwritten
+    HRESULT Open(const std::filesystem::path& path);
+    HRESULT Close();
+
+    bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+    void RecordRead(const WCHAR* szLocation, ULONGLONG ullOffset, ULONGLONG ullLength)
+    {
+        if (IsEnabled())
+            Append(szLocation, ullOffset, ullLength);
+    }
+
+    HRESULT Flush();
+
+    static HRESULT ConfigureDirectory(const std::wstring& strDirectory);
+    static std::optional<std::wstring> GetDirectory();
+
+    // Read a trace, a truncated last entry (process killed while writing) is ignored
+    static HRESULT Load(const std::filesystem::path& path, Trace& trace);
+
+private:
+    void Append(const WCHAR* szLocation, ULONGLONG ullOffset, ULONGLONG ullLength);
+    HRESULT FlushLocked();
+
+    std::atomic<bool> m_bEnabled = false;
+
+    std::mutex m_mutex;
+    Guard::FileHandle m_hFile;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<BYTE> m_buffer;
+    std::unordered_map<std::wstring, WORD> m_locations;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -67,10 +67,50 @@ template <class _RapidWriter, typename _Ch>
 template <typename... Args>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamed_(LPCWSTR szName, Args&&... args)
 {
-    rapidWriter.Key(szName);
+    WriteKey(szName);
     return Write(std::forward<Args>(args)...);
 }
 
+template <class _RapidWriter, typename _Ch>
+void Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteKey(LPCWSTR szName)
+{
+    std::basic_string_view<_Ch> key;
+    auto hr = m_keys.Get(szName, key, [](std::wstring_view name, std::basic_string<_Ch>& encoded) {
+        StringOutput<_Ch> output(encoded);
+        encoded.push_back('"');
+        Text::AppendJsonEscaped(name, output);
+        encoded.push_back('"');
+        return S_OK;
+    });
+    if (FAILED(hr))
+        throw Orc::Exception(Severity::Continue, hr, std::wstring_view(L"Failed to encode JSON key"));
+
+    // rapidjson writes the separator and indentation, the key is already encoded
+    rapidWriter.RawValue(L"", 0, rapidjson::kStringType);
+    m_Stream.Append(key);
+}
+
+template <class _RapidWriter, typename _Ch>
+void Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteString(std::wstring_view str)
+{
+    rapidWriter.RawValue(L"", 0, rapidjson::kStringType);
+    m_Stream.AppendString(str);
+}
+
+template <class _RapidWriter, typename _Ch>
+HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Flush()
+{
+    try
+    {
+        m_Stream.Flush();
+    }
+    catch (Orc::Exception& e)
+    {
+        return e.ErrorCode().value();
+    }
+    return S_OK;
+}
+
 template <class _RapidWriter, typename _Ch>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Close()
 {
@@ -84,7 +124,7 @@ template <class _RapidWriter, typename _Ch>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::BeginElement(LPCWSTR szElement)
 {
     if (szElement)
-        rapidWriter.Key(szElement);
+        WriteKey(szElement);
     rapidWriter.StartObject();
     return S_OK;
 }
@@ -100,7 +140,7 @@ template <class _RapidWriter, typename _Ch>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::BeginCollection(LPCWSTR szCollection)
 {
     if (szCollection)
-        rapidWriter.Key(szCollection);
+        WriteKey(szCollection);
     rapidWriter.StartArray();
     return S_OK;
 }
@@ -122,7 +162,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteFormated_(
 
     std::wstring_view result_string = buffer.empty() ? L""sv : std::wstring_view(buffer.get(), buffer.size());
 
-    rapidWriter.String(result_string.data(), result_string.size());
+    WriteString(result_string);
     return S_OK;
 }
 
@@ -138,7 +178,7 @@ Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteFormated_(std::stri
     if (FAILED(hr))
         return hr;
 
-    rapidWriter.String(wstr.data(), wstr.size());
+    WriteString(wstr);
     return S_OK;
 }
 
@@ -148,7 +188,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamedFormat
     std::wstring_view szFormat,
     fmt::wformat_args args)
 {
-    rapidWriter.Key(szName);
+    WriteKey(szName);
     WriteFormated_(szFormat, args);
     return S_OK;
 }
@@ -159,7 +199,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamedFormat
     std::string_view szFormat,
     fmt::format_args args)
 {
-    rapidWriter.Key(szName);
+    WriteKey(szName);
     WriteFormated_(szFormat, args);
     return S_OK;
 }
@@ -167,7 +207,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamedFormat
 template <class _RapidWriter, typename _Ch>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(LPCWSTR szValue)
 {
-    rapidWriter.String(szValue);
+    WriteString(szValue);
     return S_OK;
 }
 
@@ -180,7 +220,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamed(LPCWS
 template <class _RapidWriter, typename _Ch>
 HRESULT Writer<_RapidWriter, _Ch>::Write(const std::wstring_view str)
 {
-    rapidWriter.String(str.data(), str.length());
+    WriteString(str);
     return S_OK;
 }
 
@@ -193,7 +233,7 @@ HRESULT Writer<_RapidWriter, _Ch>::WriteNamed(LPCWSTR szName, const std::wstring
 template <class _RapidWriter, typename _Ch>
 HRESULT Writer<_RapidWriter, _Ch>::Write(const std::wstring& str)
 {
-    rapidWriter.String(str.data(), str.length());
+    WriteString(str);
     return S_OK;
 }
 
@@ -209,7 +249,7 @@ HRESULT Writer<_RapidWriter, _Ch>::Write(std::string_view str)
     if (auto [hr, wstr] = Orc::AnsiToWide(str); FAILED(hr))
         return hr;
     else
-        rapidWriter.String(wstr.data(), wstr.length());
+        WriteString(wstr);
     return S_OK;
 }
 
@@ -229,7 +269,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(uint32_t d
     {
         StructuredOutput::Writer::_Buffer buffer;
         WriteBuffer(buffer, dwValue, bInHex);
-        rapidWriter.String(buffer.get());
+        WriteString(buffer.get());
     }
     else
         rapidWriter.Uint(dwValue);
@@ -244,7 +284,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(int32_t ui
     {
         StructuredOutput::Writer::_Buffer buffer;
         WriteBuffer(buffer, uiValue, bInHex);
-        rapidWriter.String(buffer.get());
+        WriteString(buffer.get());
     }
     else
         rapidWriter.Int(uiValue);
@@ -272,7 +312,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(uint64_t u
     {
         StructuredOutput::Writer::_Buffer buffer;
         WriteBuffer(buffer, ullValue, bInHex);
-        rapidWriter.String(buffer.get());
+        WriteString(buffer.get());
     }
     else
         rapidWriter.Uint64(ullValue);
@@ -287,7 +327,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(int64_t ll
     {
         StructuredOutput::Writer::_Buffer buffer;
         WriteBuffer(buffer, llValue, bInHex);
-        rapidWriter.String(buffer.get());
+        WriteString(buffer.get());
     }
     else
         rapidWriter.Int64(llValue);
@@ -315,7 +355,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(LARGE_INTE
     {
         StructuredOutput::Writer::_Buffer buffer;
         WriteBuffer(buffer, ullValue, bInHex);
-        rapidWriter.String(buffer.get());
+        WriteString(buffer.get());
     }
     else
         rapidWriter.Int64(ullValue.QuadPart);
@@ -334,7 +374,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteAttributes(
 {
     StructuredOutput::Writer::_Buffer buffer;
     WriteAttributesBuffer(buffer, dwFileAttributes);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
@@ -342,7 +382,7 @@ template <class _RapidWriter, typename _Ch>
 HRESULT
 Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamedAttributes(LPCWSTR szName, DWORD dwFileAttributes)
 {
-    rapidWriter.Key(szName);
+    WriteKey(szName);
     return WriteAttributes(dwFileAttributes);
 }
 
@@ -351,14 +391,14 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteFileTime(UL
 {
     StructuredOutput::Writer::_Buffer buffer;
     WriteFileTimeBuffer(buffer, fileTime);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
 template <class _RapidWriter, typename _Ch>
 HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::WriteNamedFileTime(LPCWSTR szName, ULONGLONG fileTime)
 {
-    rapidWriter.Key(szName);
+    WriteKey(szName);
     return WriteFileTime(fileTime);
 }
 
@@ -367,7 +407,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(FILETIME f
 {
     StructuredOutput::Writer::_Buffer buffer;
     WriteBuffer(buffer, fileTime);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
@@ -382,7 +422,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(const WCHA
 {
     StructuredOutput::Writer::_Buffer buffer;
     WriteBuffer(buffer, szArray, dwCharCount);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
@@ -400,13 +440,13 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(const BYTE
 {
     if (dwLen == 0)
     {
-        rapidWriter.String(L"");
+        WriteString(L"");
         return S_OK;
     }
 
     StructuredOutput::Writer::_Buffer buffer;
     WriteBuffer(buffer, pBytes, dwLen, b0xPrefix);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
@@ -467,7 +507,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(DWORD dwEn
     if (szValue == NULL)
         szValue = L"IllegalEnumValue";
 
-    rapidWriter.String(szValue);
+    WriteString(szValue);
     return S_OK;
 }
 
@@ -488,7 +528,7 @@ HRESULT Orc::StructuredOutput::JSON::Writer<_RapidWriter, _Ch>::Write(
 {
     StructuredOutput::Writer::_Buffer buffer;
     WriteBuffer(buffer, dwFlags, FlagValues, cSeparator);
-    rapidWriter.String(buffer.get());
+    WriteString(buffer.get());
     return S_OK;
 }
 
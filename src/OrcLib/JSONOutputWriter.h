@@ -13,6 +13,8 @@
 
 #include "OutputSpec.h"
 #include "ByteStream.h"
+#include "StructuredOutputBuffer.h"
+#include "Text/Escape.h"
 
 namespace Orc {
 
@@ -20,6 +22,13 @@ class ByteStream;
 
 namespace StructuredOutput::JSON {
 
+//
+// Stream: output of rapidjson's writers, in a pooled OutputBuffer.
+//
+// Keys and string values do not go through rapidjson's character by character transcoding: the writer lets rapidjson
+// write the separators and indentation with an empty raw value, then appends the string escaped by the Text/Escape.h
+// kernels (keys are escaped once and cached).
+//
 template <typename _Ch>
 class Stream
 {
@@ -27,53 +36,48 @@ public:
     using Ch = _Ch;
 
     Stream(std::shared_ptr<ByteStream> a_stream)
-        : m_stream(std::move(a_stream))
+        : m_buffer(std::move(a_stream))
     {
     }
     Stream(Stream&& rhs) noexcept = default;
 
     //! Write a character.
-    void Put(_Ch c)
+    void Put(_Ch c) { Check(m_buffer.Put(c)); }
+
+    //! Write already encoded characters.
+    void Append(std::basic_string_view<_Ch> str) { Check(m_buffer.Append(str)); }
+
+    //! Write a quoted and escaped string.
+    void AppendString(std::wstring_view str)
     {
-        if (m_buffer.full())
-        {
-            Flush();
-            if (!m_buffer.empty())
-                throw Orc::Exception(
-                    Severity::Continue, E_OUTOFMEMORY, std::wstring_view(L"Failed to flush JSON's stream buffer"));
-        }
-        m_buffer.push_back(c);
+        Check(m_buffer.Put('"'));
+        Check(Text::AppendJsonEscaped(str, m_buffer));
+        Check(m_buffer.Put('"'));
     }
 
     //! Flush the buffer.
-    void Flush()
-    {
-        if (m_buffer.empty())
-            return;
-
-        auto BytesWritten = 0ULL;
-        if (auto hr = m_stream->Write(m_buffer.get(), m_buffer.elt_size() * m_buffer.size(), &BytesWritten); FAILED(hr))
-            throw Orc::Exception(Severity::Continue, hr, std::wstring_view(L"Failed to write JSON's buffer to stream"));
-        if (BytesWritten != m_buffer.elt_size() * m_buffer.size())
-            throw Orc::Exception(
-                Severity::Continue,
-                E_NOT_VALID_STATE,
-                std::wstring_view(L"Failed to write JSON's entire buffer to stream"));
-
-        m_buffer.clear();
-    }
+    void Flush() { Check(m_buffer.Flush()); }
 
     void Close()
     {
         Flush();
-        m_stream->Close();
+        m_buffer.GetStream()->Close();
     }
 
-    ~Stream() { Close(); }
+    ~Stream()
+    {
+        if (m_buffer.GetStream())
+            Close();
+    }
 
 private:
-    std::shared_ptr<ByteStream> m_stream;
-    Buffer<_Ch, 1024> m_buffer;
+    static void Check(HRESULT hr)
+    {
+        if (FAILED(hr))
+            throw Orc::Exception(Severity::Continue, hr, std::wstring_view(L"Failed to write JSON's buffer to stream"));
+    }
+
+    OutputBuffer<_Ch> m_buffer;
 };
 
 template <class _RapidWriter, typename _Ch>
@@ -82,11 +86,13 @@ class Writer : public StructuredOutput::Writer
 private:
     Stream<_Ch> m_Stream;
     _RapidWriter rapidWriter;
+    NameCache<_Ch> m_keys;
 
 public:
     Writer(std::shared_ptr<ByteStream> stream, std::unique_ptr<Options>&& options);
     Writer(const Writer&) = delete;
 
+    virtual HRESULT Flush() override final;
     virtual HRESULT Close() override final;
 
     virtual HRESULT BeginElement(LPCWSTR szElement) override final;
@@ -176,6 +182,9 @@ private:
     template <typename... Args>
     HRESULT WriteNamed_(LPCWSTR szName, Args&&... args);
 
+    void WriteKey(LPCWSTR szName);
+    void WriteString(std::wstring_view str);
+
 protected:
     virtual HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
     virtual HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
@@ -398,6 +398,60 @@ bool JobObject::IsBreakAwayAllowed()
     }
 }
 
+DWORD JobObject::GetProcessorLimit() const
+{
+    const auto countBits = [](DWORD_PTR mask) {
+        DWORD dwCount = 0L;
+        for (; mask; mask &= mask - 1)
+            dwCount++;
+        return dwCount;
+    };
+
+    DWORD dwProcessors = 0L, dwSystemProcessors = 0L;
+    DWORD_PTR processAffinity = 0, systemAffinity = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processAffinity, &systemAffinity))
+    {
+        dwProcessors = countBits(processAffinity);
+        dwSystemProcessors = countBits(systemAffinity);
+    }
+    else
+    {
+        Log::Debug("Failed GetProcessAffinityMask [{}]", LastWin32Error());
+
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        dwProcessors = dwSystemProcessors = info.dwNumberOfProcessors;
+    }
+
+    if (!IsValid())
+        return std::max(dwProcessors, 1UL);
+
+    // Rate is expressed in 1/100th of percent of all the system processors
+    JOBOBJECT_CPU_RATE_CONTROL_INFORMATION CpuRate;
+    ZeroMemory(&CpuRate, sizeof(JOBOBJECT_CPU_RATE_CONTROL_INFORMATION));
+
+    DWORD dwReturnedBytes = 0L;
+    if (!QueryInformationJobObject(
+            m_hJob,
+            JobObjectCpuRateControlInformation,
+            &CpuRate,
+            sizeof(JOBOBJECT_CPU_RATE_CONTROL_INFORMATION),
+            &dwReturnedBytes))
+    {
+        Log::Debug("Failed to query job cpu rate control [{}]", LastWin32Error());
+    }
+    else if (
+        (CpuRate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_ENABLE)
+        && (CpuRate.ControlFlags & JOB_OBJECT_CPU_RATE_CONTROL_HARD_CAP))
+    {
+        const auto dwCapped = (dwSystemProcessors * CpuRate.CpuRate + 9999) / 10000;
+        Log::Debug("Job cpu rate is capped to {}% ({} processors)", CpuRate.CpuRate / 100, dwCapped);
+        dwProcessors = std::min(dwProcessors, dwCapped);
+    }
+
+    return std::max(dwProcessors, 1UL);
+}
+
 HRESULT JobObject::AllowBreakAway(bool bPreserveJob)
 {
     HRESULT hr = E_FAIL;
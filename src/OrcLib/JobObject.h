@@ -93,6 +93,9 @@ public:
 
     bool IsBreakAwayAllowed();
 
+    // Number of processors the current process can keep busy: its affinity and the job hard capped cpu rate
+    DWORD GetProcessorLimit() const;
+
     HRESULT AllowBreakAway(bool bPreserveJob = false);
     HRESULT BlockBreakAway(bool bPreserveJob = false);
 
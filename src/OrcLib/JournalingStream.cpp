@@ -13,6 +13,7 @@
 #include "ByteStream.h"
 #include "PipeStream.h"
 #include "BinaryBuffer.h"
+#include "Archive/7z/Header7z.h"
 
 #include <boost/scope_exit.hpp>
 
@@ -21,7 +22,7 @@ using namespace Orc;
 struct JRNL_HEADER
 {
     CHAR Signature[4];
-    DWORD Version = 0x0002;
+    DWORD Version = 0x0003;
     JRNL_HEADER()
     {
         Signature[0] = 'J';
@@ -103,7 +104,128 @@ struct CLOSE_HEADER
     };
 };
 
-STDMETHODIMP JournalingStream::Open(const std::shared_ptr<ByteStream>& pChainedStream)
+// Version 2 journals are a sequence of operation records, version 3 journals are a sequence of frames each holding
+// records of consecutive operations
+constexpr DWORD kRecordsJournalVersion = 0x0002;
+constexpr DWORD kFramesJournalVersion = 0x0003;
+
+constexpr DWORD kWriteSignature = 0x54495257;  // 'WRIT'
+constexpr DWORD kSeekSignature = 0x4b454553;  // 'SEEK'
+constexpr DWORD kCloseSignature = 0x534f4c43;  // 'CLOS'
+constexpr DWORD kFrameSignature = 0x4d415246;  // 'FRAM'
+
+struct FRAME_HEADER
+{
+    OP_HEADER OpHeader;
+    DWORD dwCrc32 = 0L;  // Of the frame's records
+    ULONGLONG ullLength = 0LL;
+
+    FRAME_HEADER()
+    {
+        OpHeader.Signature[0] = 'F';
+        OpHeader.Signature[1] = 'R';
+        OpHeader.Signature[2] = 'A';
+        OpHeader.Signature[3] = 'M';
+    };
+};
+
+namespace {
+
+HRESULT ReadAll(ByteStream& stream, BYTE* pBuffer, ULONGLONG cbBytes, ULONGLONG& ullBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    ullBytesRead = 0LL;
+    while (ullBytesRead < cbBytes)
+    {
+        ULONGLONG ullChunk = 0LL;
+        if (FAILED(hr = stream.Read(pBuffer + ullBytesRead, cbBytes - ullBytesRead, &ullChunk)))
+            return hr;
+
+        if (ullChunk == 0)
+            break;
+
+        ullBytesRead += ullChunk;
+    }
+
+    return S_OK;
+}
+
+// Replay the records of a frame which passed its CRC check
+HRESULT ReplayFrameRecords(const BYTE* pRecords, size_t cbRecords, ByteStream& toStream)
+{
+    HRESULT hr = E_FAIL;
+
+    size_t offset = 0;
+    while (offset < cbRecords)
+    {
+        if (cbRecords - offset < sizeof(OPERATION_HEADER))
+        {
+            Log::Error("Truncated operation header in journal frame (offset: {})", offset);
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        OPERATION_HEADER OpHeader;
+        CopyMemory(&OpHeader, pRecords + offset, sizeof(OPERATION_HEADER));
+        offset += sizeof(OPERATION_HEADER);
+
+        const DWORD dwOperationSig = *((DWORD*)&OpHeader.OpHeader.Signature);
+        switch (dwOperationSig)
+        {
+            case kWriteSignature: {
+                const WRITE_HEADER* pWriteHeader = (WRITE_HEADER*)&OpHeader;
+                if (pWriteHeader->ullLength > cbRecords - offset)
+                {
+                    Log::Error("Truncated write operation in journal frame (offset: {})", offset);
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+                }
+
+                ULONGLONG ullBytesWritten = 0LL;
+                if (FAILED(hr = toStream.Write((PVOID)(pRecords + offset), pWriteHeader->ullLength, &ullBytesWritten)))
+                {
+                    Log::Error(L"Failed to write data to ToStream [{}]", SystemError(hr));
+                    return hr;
+                }
+
+                offset += static_cast<size_t>(pWriteHeader->ullLength);
+            }
+            break;
+            case kSeekSignature: {
+                const SEEK_HEADER* pSeekHeader = (SEEK_HEADER*)&OpHeader;
+
+                ULONG64 ullCurPos = 0LL;
+                if (FAILED(
+                        hr = toStream.SetFilePointer(
+                            pSeekHeader->llDistanteToMove, pSeekHeader->dwMoveMethod, &ullCurPos)))
+                {
+                    Log::Error(L"Seek operation failed [{}]", SystemError(hr));
+                    return hr;
+                }
+            }
+            break;
+            case kCloseSignature: {
+                if (FAILED(hr = toStream.Close()))
+                {
+                    Log::Error(L"Close operation failed [{}]", SystemError(hr));
+                    return hr;
+                }
+            }
+            break;
+            default:
+                Log::Error("Invalid operation code {} in journal frame", OpHeader.OpHeader.Signature);
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+    }
+
+    return S_OK;
+}
+
+}  // namespace
+
+STDMETHODIMP JournalingStream::Open(
+    const std::shared_ptr<ByteStream>& pChainedStream,
+    DWORD dwFrameSize,
+    std::chrono::milliseconds frameAge)
 {
     HRESULT hr = E_FAIL;
     if (!pChainedStream)
@@ -115,6 +237,13 @@ STDMETHODIMP JournalingStream::Open(const std::shared_ptr<ByteStream>& pChainedS
         return E_INVALIDARG;
     }
 
+    if (!m_Frame.SetCount(std::max<size_t>(dwFrameSize, sizeof(FRAME_HEADER) + sizeof(OPERATION_HEADER))))
+        return E_OUTOFMEMORY;
+
+    m_cbFrame = 0;
+    m_LastWriteRecord = SIZE_MAX;
+    m_FrameAge = frameAge;
+
     m_pChainedStream = pChainedStream;
 
     JRNL_HEADER Header;
@@ -153,40 +282,118 @@ STDMETHODIMP JournalingStream::Write_(
     if (!m_pChainedStream)
         return E_POINTER;
 
-    CBinaryBuffer buffer;
+    if (pcbBytesWritten)
+        *pcbBytesWritten = 0LL;
 
-    if (!buffer.SetCount((size_t)(cbBytesToWrite + sizeof(WRITE_HEADER))))
-        return E_OUTOFMEMORY;
+    if (m_LastWriteRecord != SIZE_MAX && sizeof(FRAME_HEADER) + m_cbFrame + cbBytesToWrite <= m_Frame.GetCount())
+    {
+        // Follows the frame's last write: extend its record
+        reinterpret_cast<WRITE_HEADER*>(m_Frame.GetData() + m_LastWriteRecord)->ullLength += cbBytesToWrite;
+        CopyMemory(
+            m_Frame.GetData() + sizeof(FRAME_HEADER) + m_cbFrame, pWriteBuffer, static_cast<size_t>(cbBytesToWrite));
+        m_cbFrame += static_cast<size_t>(cbBytesToWrite);
+    }
+    else
+    {
+        WRITE_HEADER WriteHeader;
+        WriteHeader.ullLength = cbBytesToWrite;
 
-    auto& WriteHeader = buffer.Get<WRITE_HEADER>(0);
+        if (FAILED(hr = AppendRecord(&WriteHeader, sizeof(WRITE_HEADER), pWriteBuffer, (size_t)cbBytesToWrite)))
+            return hr;
+    }
 
-    static const WRITE_HEADER default_write_header;
-    WriteHeader = default_write_header;
-    WriteHeader.ullLength = cbBytesToWrite;
+    if (pcbBytesWritten)
+        *pcbBytesWritten = cbBytesToWrite;
 
-    CopyMemory((BYTE*)buffer.GetData() + sizeof(WRITE_HEADER), pWriteBuffer, (size_t)cbBytesToWrite);
+    m_ullCurrentPosition += cbBytesToWrite;
+    if (m_ullCurrentPosition > m_ullStreamSize)
+        m_ullStreamSize = m_ullCurrentPosition;
 
-    ULONGLONG ullBytesWritten = 0LL;
-    if (FAILED(hr = m_pChainedStream->Write(buffer.GetData(), cbBytesToWrite + sizeof(WRITE_HEADER), &ullBytesWritten)))
+    return FlushFrameIfOld();
+}
+
+HRESULT JournalingStream::AppendRecord(const void* pRecord, size_t cbRecord, const void* pData, size_t cbData)
+{
+    HRESULT hr = E_FAIL;
+
+    if (sizeof(FRAME_HEADER) + m_cbFrame + cbRecord + cbData > m_Frame.GetCount())
     {
-        Log::Error(L"Failed to write to journal's chained stream [{}]", SystemError(hr));
-        return hr;
+        if (FAILED(hr = FlushFrame()))
+            return hr;
     }
 
-    if (pcbBytesWritten)
+    if (sizeof(FRAME_HEADER) + cbRecord + cbData > m_Frame.GetCount())
     {
-        if (ullBytesWritten > sizeof(WRITE_HEADER))
-        {
-            *pcbBytesWritten = ullBytesWritten - sizeof(WRITE_HEADER);
-            m_ullCurrentPosition += ullBytesWritten - sizeof(WRITE_HEADER);
-            if (m_ullCurrentPosition > m_ullStreamSize)
-                m_ullStreamSize = m_ullCurrentPosition;
-        }
-        else
+        // Larger than a frame: written as a frame of its own, without going through the frame buffer
+        FRAME_HEADER FrameHeader;
+        FrameHeader.ullLength = cbRecord + cbData;
+        FrameHeader.dwCrc32 = Archive::Crc32(static_cast<const uint8_t*>(pRecord), cbRecord);
+        FrameHeader.dwCrc32 = Archive::Crc32(static_cast<const uint8_t*>(pData), cbData, FrameHeader.dwCrc32);
+
+        ULONGLONG ullBytesWritten = 0LL;
+        if (FAILED(hr = m_pChainedStream->Write(&FrameHeader, sizeof(FRAME_HEADER), &ullBytesWritten))
+            || FAILED(hr = m_pChainedStream->Write((PVOID)pRecord, cbRecord, &ullBytesWritten))
+            || FAILED(hr = m_pChainedStream->Write((PVOID)pData, cbData, &ullBytesWritten)))
         {
-            *pcbBytesWritten = 0LL;
+            Log::Error(L"Failed to write to journal's chained stream [{}]", SystemError(hr));
+            return hr;
         }
+
+        m_LastWriteRecord = SIZE_MAX;
+        return S_OK;
     }
+
+    if (m_cbFrame == 0)
+        m_FrameStart = std::chrono::steady_clock::now();
+
+    // Records are stored after room left for the frame header
+    const auto recordOffset = sizeof(FRAME_HEADER) + m_cbFrame;
+    CopyMemory(m_Frame.GetData() + recordOffset, pRecord, cbRecord);
+    if (cbData)
+        CopyMemory(m_Frame.GetData() + recordOffset + cbRecord, pData, cbData);
+
+    m_cbFrame += cbRecord + cbData;
+    m_LastWriteRecord =
+        *((DWORD*)static_cast<const OP_HEADER*>(pRecord)->Signature) == kWriteSignature ? recordOffset : SIZE_MAX;
+    return S_OK;
+}
+
+HRESULT JournalingStream::FlushFrameIfOld()
+{
+    if (m_cbFrame == 0 || std::chrono::steady_clock::now() - m_FrameStart < m_FrameAge)
+        return S_OK;
+
+    return FlushFrame();
+}
+
+HRESULT JournalingStream::FlushFrame()
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_cbFrame == 0)
+        return S_OK;
+
+    auto& FrameHeader = m_Frame.Get<FRAME_HEADER>(0);
+    FrameHeader = FRAME_HEADER();
+    FrameHeader.ullLength = m_cbFrame;
+    FrameHeader.dwCrc32 = Archive::Crc32(m_Frame.GetData() + sizeof(FRAME_HEADER), m_cbFrame);
+
+    const auto cbFrame = sizeof(FRAME_HEADER) + m_cbFrame;
+    m_cbFrame = 0;
+    m_LastWriteRecord = SIZE_MAX;
+
+    ULONGLONG ullBytesWritten = 0LL;
+    if (FAILED(hr = m_pChainedStream->Write(m_Frame.GetData(), cbFrame, &ullBytesWritten)))
+    {
+        Log::Error(L"Failed to write journal frame to chained stream [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (ullBytesWritten != cbFrame)
+    {
+        Log::Warn("Did not write the complete journal frame");
+    }
+
     return S_OK;
 }
 
@@ -203,16 +410,8 @@ JournalingStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMove
     header.dwMoveMethod = (OP_MOVE_METHOD)dwMoveMethod;
     header.llDistanteToMove = DistanceToMove;
 
-    ULONGLONG ullBytesWritten = 0LL;
-    if (FAILED(hr = m_pChainedStream->Write(&header, sizeof(SEEK_HEADER), &ullBytesWritten)))
-    {
-        Log::Error(L"Failed to write to journal's chained stream [{}]", SystemError(hr));
+    if (FAILED(hr = AppendRecord(&header, sizeof(SEEK_HEADER))))
         return hr;
-    }
-    if (ullBytesWritten != sizeof(SEEK_HEADER))
-    {
-        Log::Warn("Did not write the complete journaled seek operation");
-    }
 
     switch (dwMoveMethod)
     {
@@ -235,7 +434,7 @@ JournalingStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMove
         *pCurrPointer = m_ullCurrentPosition;
     }
 
-    return S_OK;
+    return FlushFrameIfOld();
 }
 
 STDMETHODIMP_(ULONG64) JournalingStream::GetSize()
@@ -253,13 +452,14 @@ STDMETHODIMP JournalingStream::Close()
 {
     HRESULT hr = E_FAIL;
 
+    if (!m_pChainedStream)
+        return E_POINTER;
+
     CLOSE_HEADER Header;
 
-    ULONGLONG ullBytesWritten = 0LL;
-    hr = m_pChainedStream->Write(&Header, sizeof(CLOSE_HEADER), &ullBytesWritten);
-    if (FAILED(hr))
+    if (FAILED(hr = AppendRecord(&Header, sizeof(CLOSE_HEADER))) || FAILED(hr = FlushFrame()))
     {
-        Log::Error(L"Failed to write journal header to chained stream [{}]", SystemError(hr));
+        Log::Error(L"Failed to write journal close operation to chained stream [{}]", SystemError(hr));
         return hr;
     }
     if (FAILED(hr = m_pChainedStream->Close()))
@@ -350,7 +550,7 @@ HRESULT JournalingStream::IsStreamJournalized(const std::shared_ptr<ByteStream>&
             JRNL_HEADER default_jrnl_header;
 
             if (!memcmp(jrnl_header.Signature, &default_jrnl_header.Signature, sizeof(default_jrnl_header.Signature))
-                && jrnl_header.Version == default_jrnl_header.Version)
+                && (jrnl_header.Version == kRecordsJournalVersion || jrnl_header.Version == kFramesJournalVersion))
             {
                 return S_OK;
             }
@@ -387,6 +587,54 @@ HRESULT JournalingStream::ReplayJournalStream(
         return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
     }
 
+    if (jrnl_header.Version == kFramesJournalVersion)
+    {
+        // Frames are replayed up to the first truncated or corrupted one: its operations, and the following ones, were
+        // not completely written to the journal
+        CBinaryBuffer buffer;
+        for (;;)
+        {
+            FRAME_HEADER FrameHeader;
+            if (FAILED(hr = ReadAll(*pFromStream, (BYTE*)&FrameHeader, sizeof(FRAME_HEADER), ullBytesRead)))
+            {
+                Log::Error(L"Failed to read frame header from FromStream [{}]", SystemError(hr));
+                return hr;
+            }
+
+            if (ullBytesRead == 0)
+                break;
+
+            if (ullBytesRead != sizeof(FRAME_HEADER) || *((DWORD*)&FrameHeader.OpHeader.Signature) != kFrameSignature)
+            {
+                Log::Warn("Journal is truncated or corrupted, replay stops at its last complete frame");
+                break;
+            }
+
+            if (!buffer.SetCount(static_cast<size_t>(FrameHeader.ullLength)))
+                return E_OUTOFMEMORY;
+
+            if (FAILED(hr = ReadAll(*pFromStream, buffer.GetData(), FrameHeader.ullLength, ullBytesRead)))
+            {
+                Log::Error(L"Failed to read frame from FromStream [{}]", SystemError(hr));
+                return hr;
+            }
+
+            if (ullBytesRead != FrameHeader.ullLength
+                || Archive::Crc32(buffer.GetData(), static_cast<size_t>(FrameHeader.ullLength)) != FrameHeader.dwCrc32)
+            {
+                Log::Warn("Journal is truncated or corrupted, replay stops at its last complete frame");
+                break;
+            }
+
+            if (FAILED(hr = ReplayFrameRecords(buffer.GetData(), buffer.GetCount(), *pToStream)))
+                return hr;
+        }
+
+        pFromStream->Close();
+        pToStream->Close();
+        return S_OK;
+    }
+
     OPERATION_HEADER OpHeader, default_oper_header;
     ullBytesRead = 0LL;
 
@@ -405,7 +653,7 @@ HRESULT JournalingStream::ReplayJournalStream(
         const DWORD dwOperationSig = *((DWORD*)&OpHeader.OpHeader.Signature);
         switch (dwOperationSig)
         {
-            case 0x54495257:
+            case kWriteSignature:
 
             {
                 WRITE_HEADER* pWriteHeader = (WRITE_HEADER*)&OpHeader;
@@ -438,7 +686,7 @@ HRESULT JournalingStream::ReplayJournalStream(
             }
 
             break;
-            case 0x4b454553: {
+            case kSeekSignature: {
                 SEEK_HEADER* pSeekHeader = (SEEK_HEADER*)&OpHeader;
 
                 ULONG64 ullCurPos = 0LL;
@@ -451,7 +699,7 @@ HRESULT JournalingStream::ReplayJournalStream(
                 }
             }
             break;
-            case 0x534f4c43: {
+            case kCloseSignature: {
                 if (FAILED(hr = pToStream->Close()))
                 {
                     Log::Error(L"Close operation failed [{}]", SystemError(hr));
@@ -8,18 +8,43 @@
 #pragma once
 
 #include "ChainingStream.h"
+#include "BinaryBuffer.h"
+
+#include <chrono>
 
 #pragma managed(push, off)
 
 namespace Orc {
 
+//
+// JournalingStream: records the writes and seeks made to a stream so that the stream can be rebuilt later by
+// ReplayJournalStream, the journal itself being written sequentially to the chained stream.
+//
+// Operations are coalesced in frames written to the chained stream once full or once their oldest operation is older
+// than the frame age (checked by the following operation). Consecutive writes share a single write record. Each frame
+// carries the CRC32 of its records: a replay stops at the first truncated or corrupted frame.
+//
 class JournalingStream : public ChainingStream
 {
+public:
+    static constexpr DWORD kDefaultFrameSize = 1024 * 1024;
+    static constexpr std::chrono::milliseconds kDefaultFrameAge = std::chrono::seconds(1);
+
 private:
     ULONGLONG m_ullCurrentPosition = 0LL;
     ULONGLONG m_ullStreamSize = 0LL;
     bool bClosed = false;
 
+    CBinaryBuffer m_Frame;
+    size_t m_cbFrame = 0;
+    size_t m_LastWriteRecord = SIZE_MAX;  // Offset in the frame of the write record new writes are appended to
+    std::chrono::steady_clock::time_point m_FrameStart;
+    std::chrono::milliseconds m_FrameAge = kDefaultFrameAge;
+
+    HRESULT AppendRecord(const void* pRecord, size_t cbRecord, const void* pData = nullptr, size_t cbData = 0);
+    HRESULT FlushFrameIfOld();
+    HRESULT FlushFrame();
+
 public:
     JournalingStream()
         : ChainingStream() {};
@@ -40,7 +65,10 @@ public:
     //
     // CByteStream implementation
     //
-    STDMETHOD(Open)(const std::shared_ptr<ByteStream>& pChainedStream);
+    STDMETHOD(Open)
+    (const std::shared_ptr<ByteStream>& pChainedStream,
+     DWORD dwFrameSize = kDefaultFrameSize,
+     std::chrono::milliseconds frameAge = kDefaultFrameAge);
 
     STDMETHOD(Read_)
     (__out_bcount_part(cbBytes, *pcbBytesRead) PVOID pReadBuffer,
@@ -0,0 +1,510 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "JsonLinesFileWriter.h"
+
+#include "BinaryBuffer.h"
+#include "ByteStream.h"
+#include "FileStream.h"
+#include "OrcException.h"
+#include "Robustness.h"
+#include "WideAnsi.h"
+#include "Text/Escape.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+using namespace Orc::TableOutput::JSONL;
+
+using namespace std::string_view_literals;
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Enable the use of std::make_shared with Writer protected constructor
+struct WriterT : public Orc::TableOutput::JSONL::Writer
+{
+    template <typename... Args>
+    inline WriterT(Args&&... args)
+        : Writer(std::forward<Args>(args)...)
+    {
+    }
+};
+
+// " hh:mm:ss.mmm" at the end of the Text::FormatFileTime timestamps
+constexpr size_t kTimeOfDayLength = 13;
+
+}  // namespace
+
+class Orc::TableOutput::JSONL::WriterTermination : public TerminationHandler
+{
+public:
+    WriterTermination(const std::wstring& strDescr, std::weak_ptr<Writer> pW)
+        : TerminationHandler(strDescr, ROBUSTNESS_CSV)
+        , m_pWriter(std::move(pW)) {};
+
+    HRESULT operator()();
+
+private:
+    std::weak_ptr<Writer> m_pWriter;
+};
+
+HRESULT Orc::TableOutput::JSONL::WriterTermination::operator()()
+{
+    if (auto pWriter = m_pWriter.lock(); pWriter)
+    {
+        pWriter->Flush();
+    }
+    return S_OK;
+}
+
+std::shared_ptr<Orc::TableOutput::JSONL::Writer>
+Orc::TableOutput::JSONL::Writer::MakeNew(std::unique_ptr<TableOutput::Options>&& options)
+{
+    auto jsonlOptions = dynamic_unique_ptr_cast<JSONL::Options>(std::move(options));
+    if (!jsonlOptions)
+        jsonlOptions = std::make_unique<JSONL::Options>();
+
+    auto retval = std::make_shared<::WriterT>(std::move(jsonlOptions));
+
+    std::wstring strDescr = L"Termination for JSONL::Writer";
+    retval->m_pTermination = std::make_shared<WriterTermination>(strDescr, retval);
+    Robustness::AddTerminationHandler(retval->m_pTermination);
+    return retval;
+}
+
+Orc::TableOutput::JSONL::Writer::Writer(std::unique_ptr<Options>&& options)
+    : m_Options(std::move(options))
+{
+}
+
+Orc::TableOutput::JSONL::Writer::~Writer()
+{
+    if (m_pTermination)
+        Close();
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteToFile(const fs::path& path)
+{
+    return WriteToFile(path.c_str());
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteToFile(const WCHAR* szFileName)
+{
+    if (szFileName == NULL)
+        return E_POINTER;
+
+    auto pFileStream = std::make_shared<FileStream>();
+
+    if (auto hr = pFileStream->WriteTo(szFileName); FAILED(hr))
+        return hr;
+
+    return WriteToStream(pFileStream, true);
+}
+
+STDMETHODIMP
+Orc::TableOutput::JSONL::Writer::WriteToStream(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream)
+{
+    ScopedLock sl(m_cs);
+
+    if (m_page)
+    {
+        if (auto hr = m_page->Flush(); FAILED(hr))
+            Log::Error(L"Failed to write pending rows of JSON Lines file [{}]", SystemError(hr));
+    }
+
+    if (m_pByteStream != nullptr && m_bCloseStream)
+    {
+        m_pByteStream->Close();
+    }
+
+    m_pByteStream = pStream;
+    m_bCloseStream = bCloseStream;
+    m_page = std::make_unique<Page>(pStream, m_Options->dwBufferSize);
+    m_dwColumnCounter = 0L;
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::SetSchema(const Schema& columns)
+{
+    if (!columns)
+        return E_INVALIDARG;
+
+    m_Schema = columns;
+
+    m_keys.clear();
+    m_keys.reserve(m_Schema.size());
+
+    for (const auto& column : m_Schema)
+    {
+        std::string key(m_keys.empty() ? "{\"" : ",\"");
+        StructuredOutput::StringOutput<char> output(key);
+        Text::AppendJsonEscaped(column->ColumnName, output);
+        key.append("\":");
+
+        m_keys.push_back(std::move(key));
+    }
+
+    m_dwColumnCounter = 0L;
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::Flush()
+{
+    ScopedLock sl(m_cs);
+
+    if (m_page == nullptr)
+        return S_OK;
+
+    return m_page->Flush();
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::Close()
+{
+    ScopedLock sl(m_cs);
+
+    if (m_pTermination)
+    {
+        Robustness::RemoveTerminationHandler(m_pTermination);
+        m_pTermination = nullptr;
+    }
+
+    if (m_pByteStream == nullptr)
+        return S_OK;
+
+    auto hr = m_page->Flush();
+    if (FAILED(hr))
+        Log::Error(L"Failed to write pending rows of JSON Lines file [{}]", SystemError(hr));
+
+    if (m_bCloseStream)
+        m_pByteStream->Close();
+
+    m_page.reset();
+    m_pByteStream = nullptr;
+    return hr;
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteKey()
+{
+    if (m_page == nullptr)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+
+    if (m_dwColumnCounter >= m_keys.size())
+    {
+        auto counter = m_dwColumnCounter;
+        m_dwColumnCounter = 0L;
+        throw Orc::Exception(
+            Severity::Fatal,
+            L"Too many columns written to JSON Lines (got {}, max is {})"sv,
+            counter + 1,
+            m_keys.size());
+    }
+
+    return m_page->Append(m_keys[m_dwColumnCounter]);
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteValue(std::string_view value, bool bQuoted)
+{
+    if (auto hr = WriteKey(); FAILED(hr))
+        return hr;
+
+    if (bQuoted)
+    {
+        if (auto hr = m_page->Put('"'); FAILED(hr))
+            return hr;
+    }
+
+    if (auto hr = m_page->Append(value); FAILED(hr))
+        return hr;
+
+    if (bQuoted)
+    {
+        if (auto hr = m_page->Put('"'); FAILED(hr))
+            return hr;
+    }
+
+    m_dwColumnCounter++;
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteText(std::wstring_view text)
+{
+    if (text.empty())
+        return WriteNothing();
+
+    if (auto hr = WriteKey(); FAILED(hr))
+        return hr;
+
+    if (auto hr = m_page->Put('"'); FAILED(hr))
+        return hr;
+
+    if (auto hr = Text::AppendJsonEscaped(text, *m_page); FAILED(hr))
+        return hr;
+
+    if (auto hr = m_page->Put('"'); FAILED(hr))
+        return hr;
+
+    m_dwColumnCounter++;
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteAnsiText(std::string_view text)
+{
+    if (text.empty())
+        return WriteNothing();
+
+    auto [hr, wstr] = AnsiToWide(text);
+    if (FAILED(hr))
+    {
+        AbandonColumn();
+        return hr;
+    }
+
+    return WriteText(wstr);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteNothing()
+{
+    return WriteValue("null"sv, false);
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args)
+{
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return WriteText(std::wstring_view(buffer.get(), buffer.size()));
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteFormated_(std::string_view szFormat, fmt::format_args args)
+{
+    Buffer<CHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return WriteAnsiText(std::string_view(buffer.get(), buffer.size()));
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteAttributes(DWORD dwFileAttributes)
+{
+    const char attributes[] = {
+        dwFileAttributes & FILE_ATTRIBUTE_ARCHIVE ? 'A' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_COMPRESSED ? 'C' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? 'D' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_ENCRYPTED ? 'E' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_HIDDEN ? 'H' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_NORMAL ? 'N' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_OFFLINE ? 'O' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_READONLY ? 'R' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ? 'L' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE ? 'P' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_SYSTEM ? 'S' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_TEMPORARY ? 'T' : '.',
+        dwFileAttributes & FILE_ATTRIBUTE_VIRTUAL ? 'V' : '.'};
+
+    return WriteValue(std::string_view(attributes, sizeof(attributes)), true);
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteFileTime(FILETIME fileTime)
+{
+    char buffer[Text::kMaxFileTimeLength + 1];
+
+    auto end = Text::FormatFileTime(fileTime, buffer);
+    if (end == nullptr)
+        return WriteNothing();
+
+    // "YYYY-MM-DD hh:mm:ss.mmm" to "YYYY-MM-DDThh:mm:ss.mmmZ"
+    *(end - kTimeOfDayLength) = 'T';
+    *end++ = 'Z';
+
+    return WriteValue(std::string_view(buffer, end - buffer), true);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteFileTime(LONGLONG fileTime)
+{
+    return WriteFileTime(*((FILETIME*)(&fileTime)));
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteTimeStamp(time_t time)
+{
+    tm tmStamp;
+    if (gmtime_s(&tmStamp, &time))
+    {
+        return E_INVALIDARG;
+    }
+    return WriteTimeStamp(tmStamp);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteTimeStamp(tm tmStamp)
+{
+    fmt::memory_buffer buffer;
+    fmt::format_to(
+        std::back_inserter(buffer),
+        "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.000Z",
+        tmStamp.tm_year + 1900,
+        tmStamp.tm_mon + 1,
+        tmStamp.tm_mday,
+        tmStamp.tm_hour,
+        tmStamp.tm_min,
+        tmStamp.tm_sec);
+
+    return WriteValue(std::string_view(buffer.data(), buffer.size()), true);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteBytes(const BYTE pBytes[], DWORD dwLen)
+{
+    if (dwLen == 0)
+        return WriteNothing();
+
+    m_hex.resize(dwLen * 2);
+    Text::FormatHexBytes(pBytes, dwLen, m_hex.data());
+
+    return WriteValue(m_hex, true);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteBytes(const CBinaryBuffer& buffer)
+{
+    if (buffer.empty())
+        return WriteNothing();
+
+    return WriteBytes(buffer.GetData(), (DWORD)buffer.GetCount());
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteBool(bool bBoolean)
+{
+    return WriteValue(bBoolean ? "true"sv : "false"sv, false);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteEnum(DWORD dwEnum)
+{
+    const auto& column = GetCurrentColumn();
+
+    if (column.EnumValues.has_value())
+    {
+        const auto& values = column.EnumValues.value();
+        auto it = std::find_if(
+            std::cbegin(values), std::cend(values), [dwEnum](const auto& value) { return dwEnum == value.Index; });
+        if (it != std::cend(values))
+            return WriteText(it->strValue);
+    }
+
+    return WriteNumber(dwEnum);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteEnum(DWORD dwEnum, const WCHAR* EnumValues[])
+{
+    for (DWORD i = 0; EnumValues[i] != NULL && i <= dwEnum; i++)
+    {
+        if (i == dwEnum)
+            return WriteText(EnumValues[i]);
+    }
+
+    return WriteFormated(L"IllegalEnumValue#{}"sv, dwEnum);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteFlags(DWORD dwFlags)
+{
+    const auto& column = GetCurrentColumn();
+
+    if (!column.FlagsValues.has_value())
+        return WriteNumber(dwFlags);
+
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    for (const auto& value : column.FlagsValues.value())
+    {
+        if (!(dwFlags & value.dwFlag))
+            continue;
+
+        if (!buffer.empty())
+            buffer.push_back(L'|');
+        fmt::format_to(std::back_inserter(buffer), L"{}", value.strFlag);
+    }
+
+    return WriteText(std::wstring_view(buffer.get(), buffer.size()));
+}
+
+STDMETHODIMP
+Orc::TableOutput::JSONL::Writer::WriteFlags(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator)
+{
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    for (int idx = 0; FlagValues[idx].dwFlag != 0xFFFFFFFF; idx++)
+    {
+        if (!(dwFlags & FlagValues[idx].dwFlag))
+            continue;
+
+        if (!buffer.empty())
+            buffer.push_back(cSeparator);
+        fmt::format_to(std::back_inserter(buffer), L"{}", FlagValues[idx].szShortDescr);
+    }
+
+    if (buffer.empty())
+        return WriteNumber(dwFlags);
+
+    return WriteText(std::wstring_view(buffer.get(), buffer.size()));
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteExactFlags(DWORD dwFlags)
+{
+    const auto& column = GetCurrentColumn();
+
+    if (column.FlagsValues.has_value())
+    {
+        for (const auto& value : column.FlagsValues.value())
+        {
+            if (dwFlags == value.dwFlag)
+                return WriteText(value.strFlag);
+        }
+    }
+
+    return WriteNumber(dwFlags);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteExactFlags(DWORD dwFlags, const FlagsDefinition FlagValues[])
+{
+    for (int idx = 0; FlagValues[idx].dwFlag != 0xFFFFFFFF; idx++)
+    {
+        if (dwFlags == FlagValues[idx].dwFlag && FlagValues[idx].szShortDescr != nullptr)
+            return WriteText(FlagValues[idx].szShortDescr);
+    }
+
+    return WriteNumber(dwFlags);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::WriteGUID(const GUID& guid)
+{
+    char buffer[Text::kGuidLength];
+    const auto end = Text::FormatGuid(guid, buffer);
+
+    return WriteValue(std::string_view(buffer, end - buffer), true);
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::AbandonRow()
+{
+    return E_NOTIMPL;
+}
+
+STDMETHODIMP Orc::TableOutput::JSONL::Writer::AbandonColumn()
+{
+    return WriteNothing();
+}
+
+HRESULT Orc::TableOutput::JSONL::Writer::WriteEndOfLine()
+{
+    if (m_page == nullptr)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+
+    auto counter = m_dwColumnCounter;
+    m_dwColumnCounter = 0L;
+    if (counter < m_keys.size())
+        throw Orc::Exception(
+            Severity::Fatal, L"Too few columns written to JSON Lines (got {}, max is {})"sv, counter, m_keys.size());
+
+    return m_page->Append(m_keys.empty() ? "{}\n"sv : "}\n"sv);
+}
@@ -0,0 +1,183 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutputWriter.h"
+#include "StructuredOutputBuffer.h"
+#include "CriticalSection.h"
+#include "Text/FastFormat.h"
+
+#include <string>
+#include <vector>
+
+#pragma managed(push, off)
+
+//
+// JSONL: table file with one JSON object per row and one row per line (JSON Lines, also known as NDJSON), in UTF-8.
+//
+// Keys are the column names: they are escaped once when the schema is set, together with the separator before them.
+// Values are typed from the method writing them: integers and sizes are numbers, booleans are true or false, empty
+// values are null and everything else is a string. Timestamps are ISO 8601 UTC strings ("2019-01-01T12:34:56.789Z").
+// The 'Format' of the columns is not used.
+//
+// Rows are formatted to a page (a block of the BufferPool) which is written to the stream whenever it is full: memory
+// does not grow with the table and an archive output compresses the rows as they come.
+//
+namespace Orc::TableOutput::JSONL {
+
+class WriterTermination;
+
+class Writer : public ::Orc::TableOutput::IStreamWriter
+{
+public:
+    static std::shared_ptr<Writer> MakeNew(std::unique_ptr<TableOutput::Options>&& options);
+
+    Writer(const Writer&) = delete;
+
+    virtual ~Writer();
+
+    STDMETHOD(WriteToFile)(const std::filesystem::path& path) override final;
+    STDMETHOD(WriteToFile)(const WCHAR* szFileName) override final;
+    STDMETHOD(WriteToStream)(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream = true) override final;
+
+    std::shared_ptr<ByteStream> GetStream() const override final { return m_pByteStream; }
+
+    STDMETHOD(SetSchema)(const Schema& columns) override final;
+
+    STDMETHOD(Flush)() override final;
+    STDMETHOD(Close)() override final;
+
+    virtual DWORD GetCurrentColumnID() override final { return m_dwColumnCounter; }
+    virtual const Column& GetCurrentColumn() override final
+    {
+        if (m_Schema)
+            return m_Schema[m_dwColumnCounter];
+        else
+            throw "No Schema define for columns";
+    }
+
+    STDMETHOD(WriteNothing)() override final;
+
+    STDMETHOD(WriteString)(const std::wstring& strString) override final { return WriteText(strString); }
+    STDMETHOD(WriteString)(std::wstring_view strString) override final { return WriteText(strString); }
+    STDMETHOD(WriteString)(const WCHAR* szString) override final { return WriteText(szString); }
+    STDMETHOD(WriteCharArray)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return WriteText(std::wstring_view(szArray, dwCharCount));
+    }
+
+    STDMETHOD(WriteString)(const std::string& strString) override final { return WriteAnsiText(strString); }
+    STDMETHOD(WriteString)(std::string_view strString) override final { return WriteAnsiText(strString); }
+    STDMETHOD(WriteString)(const CHAR* szString) override final { return WriteAnsiText(szString); }
+    STDMETHOD(WriteCharArray)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return WriteAnsiText(std::string_view(szArray, dwCharCount));
+    }
+
+    STDMETHOD(WriteAttributes)(DWORD dwAttibutes) override final;
+
+    STDMETHOD(WriteFileTime)(FILETIME fileTime) override final;
+    STDMETHOD(WriteFileTime)(LONGLONG fileTime) override final;
+    STDMETHOD(WriteTimeStamp)(time_t tmStamp) override final;
+    STDMETHOD(WriteTimeStamp)(tm tmStamp) override final;
+
+    STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final { return WriteNumber(fileSize.QuadPart); }
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return WriteNumber(fileSize); }
+    STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final
+    {
+        return WriteNumber((static_cast<ULONGLONG>(nFileSizeHigh) << 32) | nFileSizeLow);
+    }
+
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return WriteNumber(dwInteger); }
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return WriteNumber(dw64Integer); }
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return WriteNumber(dw64Integer); }
+
+    STDMETHOD(WriteBytes)(const BYTE pBytes[], DWORD dwLen) override final;
+    STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final;
+
+    STDMETHOD(WriteBool)(bool bBoolean) override final;
+
+    STDMETHOD(WriteEnum)(DWORD dwEnum) override final;
+    STDMETHOD(WriteEnum)(DWORD dwEnum, const WCHAR* EnumValues[]) override final;
+
+    STDMETHOD(WriteFlags)(DWORD dwFlags) override final;
+    STDMETHOD(WriteFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator) override final;
+
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags) override final;
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[]) override final;
+
+    STDMETHOD(WriteGUID)(const GUID& guid) override final;
+
+    STDMETHOD(WriteXML)(const WCHAR* szString) override final { return WriteText(szString); }
+    STDMETHOD(WriteXML)(const CHAR* szString) override final { return WriteAnsiText(szString); }
+    STDMETHOD(WriteXML)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return WriteText(std::wstring_view(szArray, dwCharCount));
+    }
+    STDMETHOD(WriteXML)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return WriteAnsiText(std::string_view(szArray, dwCharCount));
+    }
+
+    STDMETHOD(AbandonRow)() override final;
+    STDMETHOD(AbandonColumn)() override final;
+
+    virtual HRESULT WriteEndOfLine() override final;
+
+protected:
+    Writer(std::unique_ptr<Options>&& options);
+
+    HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
+    HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
+
+    using Page = StructuredOutput::OutputBuffer<char>;
+
+    // Key of the current column, after the opening brace or the separator
+    HRESULT WriteKey();
+
+    // Value known not to need any escaping (numbers, literals, hexadecimal, guids and timestamps)
+    HRESULT WriteValue(std::string_view value, bool bQuoted);
+
+    HRESULT WriteText(std::wstring_view text);
+    HRESULT WriteAnsiText(std::string_view text);
+
+    template <typename T>
+    HRESULT WriteNumber(T value)
+    {
+        using integer_type = std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>;
+
+        char buffer[Text::kMaxDecimalLength];
+        const auto end = Text::FormatDecimal(static_cast<integer_type>(value), buffer);
+        return WriteValue(std::string_view(buffer, end - buffer), false);
+    }
+
+    std::unique_ptr<Options> m_Options;
+    std::shared_ptr<WriterTermination> m_pTermination;
+
+    Schema m_Schema;
+
+    // '{"name":' for the first column, ',"name":' for the next ones
+    std::vector<std::string> m_keys;
+
+    std::shared_ptr<ByteStream> m_pByteStream;
+    bool m_bCloseStream = true;
+    std::unique_ptr<Page> m_page;
+    CriticalSection m_cs;
+
+    DWORD m_dwColumnCounter = 0L;
+
+    // Hexadecimal text of binary values
+    std::string m_hex;
+};
+
+}  // namespace Orc::TableOutput::JSONL
+
+#pragma managed(pop)
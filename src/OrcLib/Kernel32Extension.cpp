@@ -29,6 +29,7 @@ HRESULT Kernel32Extension::Initialize()
         Try(m_EnumResourceNamesExW, "EnumResourceNamesExW");
         Try(m_EnumResourceNamesW, "EnumResourceNamesW");
         Try(m_ReOpenFile, "ReOpenFile");
+        Try(m_SetFileInformationByHandle, "SetFileInformationByHandle");
         m_bInitialized = true;
     }
     return S_OK;
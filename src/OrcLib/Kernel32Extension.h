@@ -96,6 +96,21 @@ public:
             return m_ReOpenFile(hOriginalFile, dwDesiredAccess, dwShareMode, dwFlags);
     }
 
+    HRESULT SetFileInformationByHandle(
+        _In_ HANDLE hFile,
+        _In_ DWORD dwFileInformationClass,
+        _In_ LPVOID lpFileInformation,
+        _In_ DWORD dwBufferSize)
+    {
+        if (FAILED(Initialize()))
+            return E_FAIL;
+        if (m_SetFileInformationByHandle == nullptr)
+            return E_NOTIMPL;
+        if (!m_SetFileInformationByHandle(hFile, dwFileInformationClass, lpFileInformation, dwBufferSize))
+            return HRESULT_FROM_WIN32(GetLastError());
+        return S_OK;
+    }
+
     STDMETHOD(Initialize)();
 
 private:
@@ -127,6 +142,13 @@ private:
 
     HANDLE(WINAPI* m_ReOpenFile)
     (_In_ HANDLE hOriginalFile, _In_ DWORD dwDesiredAccess, _In_ DWORD dwShareMode, _In_ DWORD dwFlags) = nullptr;
+
+    // The information class is a FILE_INFO_BY_HANDLE_CLASS, not declared when targeting Windows XP
+    BOOL(WINAPI* m_SetFileInformationByHandle)
+    (_In_ HANDLE hFile,
+     _In_ DWORD FileInformationClass,
+     _In_ LPVOID lpFileInformation,
+     _In_ DWORD dwBufferSize) = nullptr;
 };
 
 }  // namespace Orc
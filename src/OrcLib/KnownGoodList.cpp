@@ -0,0 +1,333 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "KnownGoodList.h"
+
+#include "ByteStream.h"
+#include "CryptoHashStream.h"
+#include "Text/Iconv.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+
+using namespace Orc;
+
+namespace {
+
+constexpr std::string_view kSeparators = "\t,;";
+constexpr std::string_view kBlanks = " ";
+
+constexpr size_t kBloomBitsPerEntry = 16;
+constexpr size_t kBloomHashes = 4;
+
+std::optional<BYTE> HexDigit(char c)
+{
+    if (c >= '0' && c <= '9')
+        return static_cast<BYTE>(c - '0');
+    if (c >= 'a' && c <= 'f')
+        return static_cast<BYTE>(c - 'a' + 10);
+    if (c >= 'A' && c <= 'F')
+        return static_cast<BYTE>(c - 'A' + 10);
+    return std::nullopt;
+}
+
+bool HexToBytes(std::string_view hex, BYTE* pBytes)
+{
+    for (size_t i = 0; i < hex.size() / 2; i++)
+    {
+        const auto high = HexDigit(hex[2 * i]);
+        const auto low = HexDigit(hex[2 * i + 1]);
+        if (!high || !low)
+            return false;
+
+        pBytes[i] = static_cast<BYTE>((*high << 4) | *low);
+    }
+    return true;
+}
+
+std::string_view Trim(std::string_view field)
+{
+    const auto start = field.find_first_not_of(kBlanks);
+    if (start == std::string_view::npos)
+        return {};
+
+    const auto end = field.find_last_not_of(kBlanks);
+    return field.substr(start, end - start + 1);
+}
+
+// Fields are separated by a single separator: names may contain blanks
+std::string_view NextField(std::string_view& line)
+{
+    const auto end = line.find_first_of(kSeparators);
+    const auto field = Trim(line.substr(0, end));
+    line = end == std::string_view::npos ? std::string_view() : line.substr(end + 1);
+    return field;
+}
+
+ULONGLONG Mix(ULONGLONG value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+}  // namespace
+
+ULONGLONG KnownGoodList::HashName(std::wstring_view name)
+{
+    // FNV-1a of the upper case name
+    ULONGLONG ullHash = 0xcbf29ce484222325ULL;
+    for (const auto c : name)
+    {
+        const auto upper = static_cast<ULONGLONG>(std::towupper(c));
+        ullHash ^= upper & 0xFF;
+        ullHash *= 0x100000001b3ULL;
+        ullHash ^= upper >> 8;
+        ullHash *= 0x100000001b3ULL;
+    }
+    return ullHash;
+}
+
+HRESULT KnownGoodList::LoadFile(const std::wstring& strPath)
+{
+    std::ifstream ifs(std::filesystem::path(strPath), std::ios_base::binary);
+    if (!ifs)
+    {
+        Log::Error(L"Failed to open known good list '{}'", strPath);
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    std::ostringstream content;
+    content << ifs.rdbuf();
+    if (ifs.bad())
+    {
+        Log::Error(L"Failed to read known good list '{}'", strPath);
+        return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+    }
+
+    if (auto hr = Parse(content.str()); FAILED(hr))
+        return hr;
+
+    if (m_InvalidLines)
+        Log::Warn(L"Known good list '{}': {} invalid line(s) ignored", strPath, m_InvalidLines);
+
+    Log::Debug(L"Known good list '{}': {} files", strPath, Count());
+    return S_OK;
+}
+
+HRESULT KnownGoodList::Parse(std::string_view text)
+{
+    size_t start = 0;
+    while (start < text.size())
+    {
+        auto end = text.find('\n', start);
+        if (end == std::string_view::npos)
+            end = text.size();
+
+        auto line = text.substr(start, end - start);
+        start = end + 1;
+
+        if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+        if (Trim(line).empty() || Trim(line).front() == '#')
+            continue;
+
+        const auto size = NextField(line);
+        const auto name = NextField(line);
+        const auto head = NextField(line);
+
+        Entry entry;
+        const auto [ptr, ec] = std::from_chars(size.data(), size.data() + size.size(), entry.Size);
+        if (size.empty() || ec != std::errc() || ptr != size.data() + size.size() || name.empty())
+        {
+            m_InvalidLines++;
+            continue;
+        }
+
+        std::error_code utf16Error;
+        const auto utf16Name = ToUtf16(name, utf16Error);
+        if (utf16Error)
+        {
+            m_InvalidLines++;
+            continue;
+        }
+        entry.NameHash = HashName(utf16Name);
+
+        if (!head.empty())
+        {
+            if (head.size() != 2 * BYTES_IN_SHA1_HASH || !HexToBytes(head, entry.Head.data()))
+            {
+                m_InvalidLines++;
+                continue;
+            }
+            entry.bHasHead = true;
+        }
+
+        m_Entries.push_back(entry);
+    }
+
+    std::sort(std::begin(m_Entries), std::end(m_Entries));
+    m_Entries.erase(std::unique(std::begin(m_Entries), std::end(m_Entries)), std::end(m_Entries));
+    m_Entries.shrink_to_fit();
+
+    m_Bloom.clear();
+    if (m_Entries.empty())
+        return S_OK;
+
+    size_t bits = 64;
+    while (bits < m_Entries.size() * kBloomBitsPerEntry)
+        bits <<= 1;
+    m_Bloom.resize(bits / 64, 0LL);
+
+    for (const auto& entry : m_Entries)
+    {
+        const auto h1 = Mix(entry.Size ^ Mix(entry.NameHash));
+        const auto h2 = Mix(h1) | 1;
+        for (size_t i = 0; i < kBloomHashes; i++)
+        {
+            const auto bit = static_cast<size_t>((h1 + i * h2) & (bits - 1));
+            m_Bloom[bit / 64] |= 1ULL << (bit % 64);
+        }
+    }
+
+    return S_OK;
+}
+
+bool KnownGoodList::MayContain(ULONGLONG ullSize, ULONGLONG ullNameHash) const
+{
+    if (m_Bloom.empty())
+        return false;
+
+    const auto bits = m_Bloom.size() * 64;
+    const auto h1 = Mix(ullSize ^ Mix(ullNameHash));
+    const auto h2 = Mix(h1) | 1;
+    for (size_t i = 0; i < kBloomHashes; i++)
+    {
+        const auto bit = static_cast<size_t>((h1 + i * h2) & (bits - 1));
+        if (!(m_Bloom[bit / 64] & (1ULL << (bit % 64))))
+            return false;
+    }
+    return true;
+}
+
+std::pair<std::vector<KnownGoodList::Entry>::const_iterator, std::vector<KnownGoodList::Entry>::const_iterator>
+KnownGoodList::EqualRange(ULONGLONG ullSize, ULONGLONG ullNameHash) const
+{
+    Entry key;
+    key.Size = ullSize;
+    key.NameHash = ullNameHash;
+
+    return std::equal_range(
+        std::cbegin(m_Entries), std::cend(m_Entries), key, [](const Entry& lhs, const Entry& rhs) {
+            if (lhs.Size != rhs.Size)
+                return lhs.Size < rhs.Size;
+            return lhs.NameHash < rhs.NameHash;
+        });
+}
+
+KnownGoodList::Lookup KnownGoodList::Find(ULONGLONG ullSize, std::wstring_view name) const
+{
+    const auto ullNameHash = HashName(name);
+    if (!MayContain(ullSize, ullNameHash))
+        return Lookup::Unknown;
+
+    const auto [first, last] = EqualRange(ullSize, ullNameHash);
+    if (first == last)
+        return Lookup::Unknown;
+
+    // Entries without a head hash are sorted first
+    return first->bHasHead ? Lookup::NeedsHeadHash : Lookup::KnownGood;
+}
+
+bool KnownGoodList::ContainsHead(ULONGLONG ullSize, std::wstring_view name, BufferView headHash) const
+{
+    if (headHash.size() != BYTES_IN_SHA1_HASH)
+        return false;
+
+    const auto ullNameHash = HashName(name);
+    if (!MayContain(ullSize, ullNameHash))
+        return false;
+
+    const auto [first, last] = EqualRange(ullSize, ullNameHash);
+    return std::any_of(first, last, [&headHash](const Entry& entry) {
+        return !entry.bHasHead || std::equal(std::cbegin(entry.Head), std::cend(entry.Head), headHash.data());
+    });
+}
+
+bool KnownGoodList::Contains(std::wstring_view name, ByteStream& stream) const
+{
+    const auto ullSize = stream.GetSize();
+
+    switch (Find(ullSize, name))
+    {
+        case Lookup::Unknown:
+            return false;
+        case Lookup::KnownGood:
+            return true;
+        case Lookup::NeedsHeadHash:
+            break;
+    }
+
+    CBinaryBuffer headHash;
+    if (auto hr = HashHead(stream, headHash); FAILED(hr))
+    {
+        Log::Debug(L"Failed to hash the head of '{}' [{}]", name, SystemError(hr));
+        return false;
+    }
+
+    return ContainsHead(ullSize, name, headHash);
+}
+
+HRESULT KnownGoodList::HashHead(ByteStream& stream, CBinaryBuffer& headHash)
+{
+    auto hashstream = std::make_shared<CryptoHashStream>();
+    HRESULT hr = hashstream->OpenToWrite(CryptoHashStream::Algorithm::SHA1, nullptr);
+    if (FAILED(hr))
+        return hr;
+
+    if (FAILED(hr = stream.SetFilePointer(0, FILE_BEGIN, nullptr)))
+        return hr;
+
+    BYTE buffer[kHeadSize];
+    ULONGLONG ullTotal = 0LL;
+    while (ullTotal < kHeadSize)
+    {
+        ULONGLONG ullRead = 0LL;
+        if (FAILED(hr = stream.Read(buffer + ullTotal, kHeadSize - ullTotal, &ullRead)))
+            break;
+
+        if (ullRead == 0)
+            break;
+
+        ullTotal += ullRead;
+    }
+
+    HRESULT hrRewind = stream.SetFilePointer(0, FILE_BEGIN, nullptr);
+    if (FAILED(hr))
+        return hr;
+    if (FAILED(hrRewind))
+        return hrRewind;
+
+    ULONGLONG ullWritten = 0LL;
+    if (ullTotal > 0 && FAILED(hr = hashstream->Write(buffer, ullTotal, &ullWritten)))
+        return hr;
+
+    return hashstream->GetHash(CryptoHashStream::Algorithm::SHA1, headHash);
+}
@@ -0,0 +1,109 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "BinaryBuffer.h"
+#include "CryptoUtilities.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class ByteStream;
+
+//
+// KnownGoodList: immutable set of files known to be good (stock operating system or vendor files), typically reduced
+// from an NSRL-style reference set, whose content does not need to be hashed, verified or scanned.
+//
+// The list is a text file with one entry per line: the size of the file, its name and optionally the SHA1 of its first
+// 4KB (all of it for smaller files), separated by tabs, commas or semicolons. Names are case insensitive and may
+// contain spaces. Empty lines and lines starting with '#' are ignored, invalid lines are counted and skipped.
+//
+// A lookup costs a few bit tests for almost all the files unknown to the list: a bloom filter on the size and the name
+// rejects them before the binary search in the entries sorted by size and name hash. An entry with a head hash matches
+// only the files whose first 4KB have this hash, which is one more read.
+//
+class KnownGoodList
+{
+public:
+    static constexpr size_t kHeadSize = 4096;
+
+    enum class Lookup
+    {
+        Unknown,
+        KnownGood,
+        NeedsHeadHash  // entries with this size and name all have a head hash
+    };
+
+    HRESULT LoadFile(const std::wstring& strPath);
+    HRESULT Parse(std::string_view text);
+
+    size_t Count() const { return m_Entries.size(); }
+    size_t InvalidLines() const { return m_InvalidLines; }
+
+    Lookup Find(ULONGLONG ullSize, std::wstring_view name) const;
+
+    // 'headHash' is the SHA1 of the first kHeadSize bytes of the file
+    bool ContainsHead(ULONGLONG ullSize, std::wstring_view name, BufferView headHash) const;
+
+    // Lookup of a data stream, reading its head when needed: the stream is rewound
+    bool Contains(std::wstring_view name, ByteStream& stream) const;
+
+    static HRESULT HashHead(ByteStream& stream, CBinaryBuffer& headHash);
+
+private:
+    struct Entry
+    {
+        ULONGLONG Size = 0LL;
+        ULONGLONG NameHash = 0LL;
+        bool bHasHead = false;
+        std::array<BYTE, BYTES_IN_SHA1_HASH> Head = {};
+
+        bool operator<(const Entry& other) const
+        {
+            if (Size != other.Size)
+                return Size < other.Size;
+            if (NameHash != other.NameHash)
+                return NameHash < other.NameHash;
+            if (bHasHead != other.bHasHead)
+                return bHasHead < other.bHasHead;
+            return Head < other.Head;
+        }
+
+        bool operator==(const Entry& other) const
+        {
+            return Size == other.Size && NameHash == other.NameHash && bHasHead == other.bHasHead
+                && Head == other.Head;
+        }
+    };
+
+    static ULONGLONG HashName(std::wstring_view name);
+
+    std::pair<std::vector<Entry>::const_iterator, std::vector<Entry>::const_iterator>
+    EqualRange(ULONGLONG ullSize, ULONGLONG ullNameHash) const;
+
+    bool MayContain(ULONGLONG ullSize, ULONGLONG ullNameHash) const;
+
+    std::vector<Entry> m_Entries;
+
+    // Bloom filter on (size, name hash), a power of two number of bits
+    std::vector<ULONGLONG> m_Bloom;
+
+    size_t m_InvalidLines = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
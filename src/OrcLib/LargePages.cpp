@@ -0,0 +1,140 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "LargePages.h"
+
+#include <atomic>
+#include <vector>
+
+#include "Privilege.h"
+#include "SystemDetails.h"
+#include "Utils/Guard.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+bool TokenHoldsPrivilege(const WCHAR* szPrivilege)
+{
+    Guard::Handle hToken;
+    if (!OpenProcessToken(GetCurrentProcess(), TOKEN_QUERY, hToken.data()))
+    {
+        Log::Debug(L"Failed to open process token [{}]", LastWin32Error());
+        return false;
+    }
+
+    LUID luid;
+    if (!LookupPrivilegeValueW(NULL, szPrivilege, &luid))
+    {
+        Log::Debug(L"Failed to lookup privilege '{}' [{}]", szPrivilege, LastWin32Error());
+        return false;
+    }
+
+    DWORD dwLength = 0L;
+    if (!GetTokenInformation(*hToken, TokenPrivileges, NULL, 0L, &dwLength)
+        && GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+    {
+        Log::Debug(L"Failed to get token privileges [{}]", LastWin32Error());
+        return false;
+    }
+
+    std::vector<BYTE> buffer(dwLength);
+    if (!GetTokenInformation(*hToken, TokenPrivileges, buffer.data(), dwLength, &dwLength))
+    {
+        Log::Debug(L"Failed to get token privileges [{}]", LastWin32Error());
+        return false;
+    }
+
+    const auto pPrivileges = reinterpret_cast<const TOKEN_PRIVILEGES*>(buffer.data());
+    for (DWORD i = 0; i < pPrivileges->PrivilegeCount; i++)
+    {
+        const auto& privilege = pPrivileges->Privileges[i].Luid;
+        if (privilege.LowPart == luid.LowPart && privilege.HighPart == luid.HighPart)
+            return true;
+    }
+
+    return false;
+}
+
+size_t EnableLargePages()
+{
+    DWORD dwLargePageSize = 0L;
+    if (FAILED(SystemDetails::GetLargePageSize(dwLargePageSize)) || dwLargePageSize == 0L)
+    {
+        Log::Debug(L"Large pages are not supported");
+        return 0;
+    }
+
+    // SetPrivilege logs an error when the privilege is not held, which is the common case
+    if (!TokenHoldsPrivilege(SE_LOCK_MEMORY_NAME))
+    {
+        Log::Debug(L"Large pages are not used: '{}' is not held", SE_LOCK_MEMORY_NAME);
+        return 0;
+    }
+
+    if (auto hr = SetPrivilege(SE_LOCK_MEMORY_NAME, TRUE); FAILED(hr))
+    {
+        Log::Debug(L"Large pages are not used: failed to enable '{}' [{}]", SE_LOCK_MEMORY_NAME, SystemError(hr));
+        return 0;
+    }
+
+    Log::Debug(L"Large pages of {} bytes are available", dwLargePageSize);
+    return dwLargePageSize;
+}
+
+}  // namespace
+
+size_t LargePages::Minimum()
+{
+    static const size_t cbLargePage = EnableLargePages();
+    return cbLargePage;
+}
+
+size_t LargePages::PreferredSize(size_t cbSize)
+{
+    const auto cbLargePage = Minimum();
+    if (cbLargePage == 0 || cbSize < cbLargePage / 2)
+        return cbSize;
+
+    return ((cbSize + cbLargePage - 1) / cbLargePage) * cbLargePage;
+}
+
+void* LargePages::Allocate(size_t cbSize, size_t& cbAllocated)
+{
+    cbAllocated = 0;
+
+    const auto cbLargePage = Minimum();
+    if (cbLargePage == 0 || cbSize < cbLargePage)
+        return nullptr;
+
+    const auto cbRounded = ((cbSize + cbLargePage - 1) / cbLargePage) * cbLargePage;
+    auto pBuffer = VirtualAlloc(NULL, cbRounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (pBuffer == nullptr)
+    {
+        // Physical memory is too fragmented for contiguous large pages, this is logged once
+        static std::atomic_bool bLogged = false;
+        if (!bLogged.exchange(true))
+            Log::Debug(L"Failed to allocate {} bytes of large pages [{}]", cbRounded, LastWin32Error());
+
+        return nullptr;
+    }
+
+    cbAllocated = cbRounded;
+    return pBuffer;
+}
+
+void LargePages::Free(void* pBuffer)
+{
+    if (pBuffer != nullptr && !VirtualFree(pBuffer, 0L, MEM_RELEASE))
+    {
+        Log::Warn(L"Failed to release large page buffer [{}]", LastWin32Error());
+    }
+}
@@ -0,0 +1,120 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <new>
+#include <type_traits>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// LargePages: allocation of long-lived, fixed size buffers with large pages (2 MiB on x64) to save TLB misses when
+// they are walked (volume read buffers, yara block buffer).
+//
+// Large pages require SeLockMemoryPrivilege, which is enabled on first use when the token holds it (it is not granted
+// to administrators by default). They are never paged out and must be committed at once, so they do not suit buffers
+// that grow: those keep reserving and committing regular pages. When large pages cannot be used, Allocate returns
+// nullptr and callers fall back to their regular allocation.
+//
+class LargePages
+{
+public:
+    // Large page size, or 0 if this process cannot allocate large pages
+    static size_t Minimum();
+
+    // Size to request for a buffer of at least 'cbSize' bytes: rounded up to whole large pages when large pages are
+    // available and the buffer is at least half a large page, so that the rounding wastes less than it saves
+    static size_t PreferredSize(size_t cbSize);
+
+    // Commit 'cbSize' bytes, rounded up to whole large pages into 'cbAllocated'. Returns nullptr if 'cbSize' is less
+    // than Minimum() or the allocation failed (fragmented physical memory). Release with Free
+    static void* Allocate(size_t cbSize, size_t& cbAllocated);
+    static void Free(void* pBuffer);
+
+    // Allocator for std containers: when enabled, allocations of at least one large page use large pages, or regular
+    // committed pages if they are not available, other allocations use operator new.
+    template <typename T>
+    class Allocator
+    {
+    public:
+        using value_type = T;
+        using propagate_on_container_copy_assignment = std::true_type;
+        using propagate_on_container_move_assignment = std::true_type;
+        using propagate_on_container_swap = std::true_type;
+
+        Allocator() noexcept = default;
+        explicit Allocator(bool bLargePages) noexcept
+            : m_bLargePages(bLargePages)
+        {
+        }
+
+        template <typename U>
+        Allocator(const Allocator<U>& other) noexcept
+            : m_bLargePages(other.UsesLargePages())
+        {
+        }
+
+        T* allocate(size_t n)
+        {
+            const auto cbSize = n * sizeof(T);
+            if (!IsVirtual(cbSize))
+                return static_cast<T*>(::operator new(cbSize));
+
+            size_t cbAllocated = 0;
+            auto pBuffer = LargePages::Allocate(cbSize, cbAllocated);
+            if (pBuffer == nullptr)
+                pBuffer = VirtualAlloc(NULL, cbSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (pBuffer == nullptr)
+                throw std::bad_alloc();
+
+            return static_cast<T*>(pBuffer);
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if (IsVirtual(n * sizeof(T)))
+                LargePages::Free(p);
+            else
+                ::operator delete(p);
+        }
+
+        bool UsesLargePages() const noexcept { return m_bLargePages; }
+
+        template <typename U>
+        bool operator==(const Allocator<U>& other) const noexcept
+        {
+            return m_bLargePages == other.UsesLargePages();
+        }
+
+        template <typename U>
+        bool operator!=(const Allocator<U>& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+    private:
+        bool IsVirtual(size_t cbSize) const noexcept
+        {
+            if (!m_bLargePages)
+                return false;
+
+            const auto cbLargePage = LargePages::Minimum();
+            return cbLargePage > 0 && cbSize >= cbLargePage;
+        }
+
+        bool m_bLargePages = false;
+    };
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -335,6 +335,30 @@ void EnumerateShadows(
     }
 }
 
+// '\\?\Volume{GUID}' name of a mounted volume, from its location or from one of its mount points
+std::optional<std::wstring> GetVolumeGuidName(const std::wstring& location, const std::vector<std::wstring>& paths)
+{
+    constexpr std::wstring_view kVolumeGuidPrefix = L"\\\\?\\Volume{";
+
+    if (location.size() > kVolumeGuidPrefix.size()
+        && _wcsnicmp(location.c_str(), kVolumeGuidPrefix.data(), kVolumeGuidPrefix.size()) == 0)
+    {
+        return std::wstring(location.c_str(), location.find_last_not_of(L'\\') + 1);
+    }
+
+    for (const auto& path : paths)
+    {
+        WCHAR szVolumeName[MAX_PATH];
+        if (GetVolumeNameForVolumeMountPointW(path.c_str(), szVolumeName, ARRAYSIZE(szVolumeName)))
+        {
+            std::wstring volumeName(szVolumeName);
+            return volumeName.substr(0, volumeName.find_last_not_of(L'\\') + 1);
+        }
+    }
+
+    return std::nullopt;
+}
+
 }  // namespace
 
 namespace Orc {
@@ -479,8 +503,23 @@ void Location::EnumerateShadowCopiesWithMicrosoftParser(
         return;
     }
 
+    // Snapshots are matched with their original volume by name when possible: they are opened by their first read
+    const auto volumeGuidName = ::GetVolumeGuidName(m_Location, m_Paths);
+
     for (auto& shadow : everyShadows)
     {
+        if (volumeGuidName)
+        {
+            std::wstring_view originalVolumeName(shadow.VolumeName);
+            originalVolumeName = originalVolumeName.substr(0, originalVolumeName.find_last_not_of(L'\\') + 1);
+
+            if (originalVolumeName.size() != volumeGuidName->size()
+                || _wcsnicmp(originalVolumeName.data(), volumeGuidName->c_str(), volumeGuidName->size()) != 0)
+            {
+                continue;
+            }
+        }
+
         auto loc = std::make_shared<Location>(L"", Location::Type::Snapshot);
         loc->SetShadowCopyParser(m_shadowCopyParserType);
         loc->SetShadow(shadow);
@@ -491,15 +530,28 @@ void Location::EnumerateShadowCopiesWithMicrosoftParser(
             continue;
         }
 
-        hr = reader->LoadDiskProperties();
-        if (FAILED(hr))
+        if (SerialNumber() == 0)
         {
             continue;
         }
 
-        if (SerialNumber() == 0 || SerialNumber() != reader->VolumeSerialNumber())
+        auto snapshotReader = std::dynamic_pointer_cast<SnapshotVolumeReader>(reader);
+        if (volumeGuidName && snapshotReader)
         {
-            continue;
+            snapshotReader->SetVolumeProperties(SerialNumber(), GetFSType());
+        }
+        else
+        {
+            hr = reader->LoadDiskProperties();
+            if (FAILED(hr))
+            {
+                continue;
+            }
+
+            if (SerialNumber() != reader->VolumeSerialNumber())
+            {
+                continue;
+            }
         }
 
         shadow.parentVolume = reader;
@@ -0,0 +1,359 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "LocationCache.h"
+
+#include "Text/Guid.h"
+#include "Text/Iconv.h"
+
+#include "Log/Log.h"
+
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcLocationCacheEnv = L"DFIR-ORC_LOCATION_CACHE";
+
+constexpr auto kMountedVolumesFile = L"volumes.tsv";
+constexpr auto kPhysicalDrivesFile = L"drives.tsv";
+constexpr auto kShadowsFile = L"shadows.tsv";
+
+using Record = std::vector<std::wstring>;
+
+// Format: one tab separated record per line, the first field gives the kind of record
+std::optional<std::vector<Record>> ReadRecords(LPCWSTR szName)
+{
+    const auto directory = LocationCache::GetDirectory();
+    if (!directory)
+        return std::nullopt;
+
+    const auto path = std::filesystem::path(*directory) / szName;
+
+    std::ifstream ifs(path, std::ios_base::binary);
+    if (!ifs)
+        return std::nullopt;
+
+    std::vector<Record> records;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        Record record;
+
+        size_t start = 0;
+        for (;;)
+        {
+            const auto end = line.find('\t', start);
+
+            std::error_code ec;
+            record.push_back(ToUtf16(std::string_view(line).substr(start, end - start), ec));
+            if (ec)
+            {
+                Log::Debug(L"Invalid record in location cache file '{}' [{}]", path.wstring(), ec);
+                return std::nullopt;
+            }
+
+            if (end == std::string::npos)
+                break;
+
+            start = end + 1;
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
+
+HRESULT WriteRecords(LPCWSTR szName, const std::vector<Record>& records)
+{
+    const auto directory = LocationCache::GetDirectory();
+    if (!directory)
+        return S_FALSE;
+
+    const auto path = std::filesystem::path(*directory) / szName;
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec))
+        return S_FALSE;
+
+    const auto tempPath = std::filesystem::path(*directory) / fmt::format(L"{}.{}.tmp", szName, GetCurrentProcessId());
+
+    {
+        std::ofstream ofs(tempPath, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            Log::Debug(L"Failed to create location cache file '{}'", tempPath.wstring());
+            return E_FAIL;
+        }
+
+        for (const auto& record : records)
+        {
+            for (size_t i = 0; i < record.size(); i++)
+            {
+                if (record[i].find_first_of(L"\t\r\n") != std::wstring::npos)
+                {
+                    Log::Debug(L"Cannot save '{}' to location cache file '{}'", record[i], path.wstring());
+                    ofs.close();
+                    std::filesystem::remove(tempPath, ec);
+                    return E_INVALIDARG;
+                }
+
+                if (i > 0)
+                    ofs << '\t';
+
+                ofs << ToUtf8(record[i], ec);
+            }
+
+            ofs << '\n';
+        }
+
+        ofs.close();
+        if (ofs.fail())
+        {
+            Log::Debug(L"Failed to write location cache file '{}'", tempPath.wstring());
+            std::filesystem::remove(tempPath, ec);
+            return E_FAIL;
+        }
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_WRITE_THROUGH))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        std::filesystem::remove(tempPath, ec);
+
+        // Another process saved it first
+        if (hr == HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS) || hr == HRESULT_FROM_WIN32(ERROR_FILE_EXISTS))
+            return S_FALSE;
+
+        Log::Debug(L"Failed to rename location cache file '{}' [{}]", tempPath.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+std::optional<ULONGLONG> ToULongLong(const std::wstring& value)
+{
+    try
+    {
+        size_t pos = 0;
+        const auto result = std::stoull(value, &pos);
+        if (pos != value.size())
+            return std::nullopt;
+
+        return result;
+    }
+    catch (const std::exception&)
+    {
+        return std::nullopt;
+    }
+}
+
+}  // namespace
+
+HRESULT LocationCache::ConfigureDirectory(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid location cache directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create location cache directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcLocationCacheEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcLocationCacheEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"Enumerated locations are cached in '{}'", directory.wstring());
+    return S_OK;
+}
+
+std::optional<std::wstring> LocationCache::GetDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcLocationCacheEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcLocationCacheEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+std::optional<LocationCache::MountedVolumes> LocationCache::LoadMountedVolumes()
+{
+    const auto records = ReadRecords(kMountedVolumesFile);
+    if (!records)
+        return std::nullopt;
+
+    // Records: 'V' <volume name> <device name>, followed by the 'P' <path> and 'E' <disk> <start> <length> of the volume
+    MountedVolumes volumes;
+    for (const auto& record : *records)
+    {
+        if (record.size() == 3 && record[0] == L"V")
+        {
+            MountedVolume volume;
+            volume.VolumeName = record[1];
+            volume.DeviceName = record[2];
+            volumes.push_back(std::move(volume));
+        }
+        else if (record.size() == 2 && record[0] == L"P" && !volumes.empty())
+        {
+            volumes.back().Paths.push_back(record[1]);
+        }
+        else if (record.size() == 4 && record[0] == L"E" && !volumes.empty())
+        {
+            const auto start = ToULongLong(record[2]);
+            const auto length = ToULongLong(record[3]);
+            if (!start || !length)
+                return std::nullopt;
+
+            volumes.back().Extents.push_back({record[1], *start, *length});
+        }
+        else
+        {
+            Log::Debug("Invalid mounted volume record in location cache");
+            return std::nullopt;
+        }
+    }
+
+    Log::Debug(L"Loaded {} mounted volumes from location cache", volumes.size());
+    return volumes;
+}
+
+std::optional<LocationCache::PhysicalDrives> LocationCache::LoadPhysicalDrives()
+{
+    const auto records = ReadRecords(kPhysicalDrivesFile);
+    if (!records)
+        return std::nullopt;
+
+    // Records: 'D' <physical drive>
+    PhysicalDrives drives;
+    for (const auto& record : *records)
+    {
+        if (record.size() != 2 || record[0] != L"D")
+        {
+            Log::Debug("Invalid physical drive record in location cache");
+            return std::nullopt;
+        }
+
+        drives.push_back(record[1]);
+    }
+
+    Log::Debug(L"Loaded {} physical drives from location cache", drives.size());
+    return drives;
+}
+
+std::optional<LocationCache::Shadows> LocationCache::LoadShadows()
+{
+    const auto records = ReadRecords(kShadowsFile);
+    if (!records)
+        return std::nullopt;
+
+    // Records: 'S' <original volume name> <snapshot device object> <attributes> <creation time> <snapshot id>
+    Shadows shadows;
+    for (const auto& record : *records)
+    {
+        if (record.size() != 6 || record[0] != L"S")
+        {
+            Log::Debug("Invalid shadow copy record in location cache");
+            return std::nullopt;
+        }
+
+        const auto attributes = ToULongLong(record[3]);
+        const auto creationTime = ToULongLong(record[4]);
+
+        GUID guid;
+        std::error_code ec;
+        ToGuid(record[5], guid, ec);
+
+        if (!attributes || !creationTime || ec)
+        {
+            Log::Debug("Invalid shadow copy record in location cache");
+            return std::nullopt;
+        }
+
+        shadows.emplace_back(
+            record[1].c_str(),
+            record[2].c_str(),
+            static_cast<VSS_VOLUME_SNAPSHOT_ATTRIBUTES>(*attributes),
+            static_cast<VSS_TIMESTAMP>(*creationTime),
+            guid);
+    }
+
+    Log::Debug(L"Loaded {} shadow copies from location cache", shadows.size());
+    return shadows;
+}
+
+HRESULT LocationCache::SaveMountedVolumes(const MountedVolumes& volumes)
+{
+    std::vector<Record> records;
+    for (const auto& volume : volumes)
+    {
+        records.push_back({L"V", volume.VolumeName, volume.DeviceName});
+
+        for (const auto& path : volume.Paths)
+            records.push_back({L"P", path});
+
+        for (const auto& extent : volume.Extents)
+            records.push_back({L"E", extent.Disk, std::to_wstring(extent.Start), std::to_wstring(extent.Length)});
+    }
+
+    return WriteRecords(kMountedVolumesFile, records);
+}
+
+HRESULT LocationCache::SavePhysicalDrives(const PhysicalDrives& drives)
+{
+    std::vector<Record> records;
+    for (const auto& drive : drives)
+        records.push_back({L"D", drive});
+
+    return WriteRecords(kPhysicalDrivesFile, records);
+}
+
+HRESULT LocationCache::SaveShadows(const Shadows& shadows)
+{
+    std::vector<Record> records;
+    for (const auto& shadow : shadows)
+    {
+        records.push_back(
+            {L"S",
+             shadow.VolumeName,
+             shadow.DeviceInstance,
+             std::to_wstring(static_cast<ULONG>(shadow.Attributes)),
+             std::to_wstring(static_cast<ULONGLONG>(shadow.CreationTime)),
+             ToStringW(shadow.guid)});
+    }
+
+    return WriteRecords(kShadowsFile, records);
+}
@@ -0,0 +1,75 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "VolumeShadowCopies.h"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// LocationCache: results of the system queries behind LocationSet's enumeration, shared by this process and its child
+// processes.
+//
+// When %DFIR-ORC_LOCATION_CACHE% designates a directory (WolfLauncher sets it for its commands), the mounted volumes,
+// the physical drives and the shadow copies listed by the volume shadow copy service are read from it instead of
+// querying the system again. The first process to query one of them saves the result: files are written to a temporary
+// name and renamed so concurrent processes never load a partial one. Existing files are never overwritten.
+//
+// Shadow copies found by the internal parser depend on each volume's catalog and are not cached.
+//
+class LocationCache
+{
+public:
+    class Extent
+    {
+    public:
+        std::wstring Disk;
+        ULONGLONG Start = 0LL;
+        ULONGLONG Length = 0LL;
+    };
+
+    class MountedVolume
+    {
+    public:
+        // '\\?\Volume{GUID}', without the trailing backslash
+        std::wstring VolumeName;
+        // '\Device\HarddiskVolumeN' as returned by QueryDosDevice
+        std::wstring DeviceName;
+        std::vector<std::wstring> Paths;
+        std::vector<Extent> Extents;
+    };
+
+    using MountedVolumes = std::vector<MountedVolume>;
+    using PhysicalDrives = std::vector<std::wstring>;
+    using Shadows = std::vector<VolumeShadowCopies::Shadow>;
+
+    static HRESULT ConfigureDirectory(const std::wstring& strDirectory);
+    static std::optional<std::wstring> GetDirectory();
+
+    // Each loader returns std::nullopt when the cache is disabled or nothing was saved yet
+    static std::optional<MountedVolumes> LoadMountedVolumes();
+    static std::optional<PhysicalDrives> LoadPhysicalDrives();
+    static std::optional<Shadows> LoadShadows();
+
+    // Each saver returns S_FALSE when the cache is disabled or already holds the entry
+    static HRESULT SaveMountedVolumes(const MountedVolumes& volumes);
+    static HRESULT SavePhysicalDrives(const PhysicalDrives& drives);
+    static HRESULT SaveShadows(const Shadows& shadows);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -13,6 +13,9 @@
 #include <sstream>
 #include <locale>
 #include <codecvt>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/scope_exit.hpp>
@@ -42,6 +45,7 @@
 #include "NtfsDataStructures.h"
 #include "ProfileList.h"
 #include "Text/Guid.h"
+#include "Text/Iconv.h"
 #include "Stream/VolumeStreamReader.h"
 
 using namespace std;
@@ -1177,6 +1181,122 @@ HRESULT LocationSet::AddLocationsFromArgcArgv(int argc, LPCWSTR argv[])
     return S_OK;
 }
 
+HRESULT LocationSet::ParseLocationsFromBatch(const std::wstring& strBatch, std::vector<std::wstring>& locations)
+{
+    std::error_code ec;
+    const std::filesystem::path batch(strBatch);
+
+    if (std::filesystem::is_directory(batch, ec))
+    {
+        std::vector<std::wstring> files;
+        for (const auto& entry : std::filesystem::directory_iterator(batch, ec))
+        {
+            if (entry.is_regular_file(ec))
+                files.push_back(entry.path().wstring());
+        }
+
+        if (ec)
+        {
+            Log::Error(L"Failed to list batch directory '{}' [{}]", strBatch, ec);
+            return HRESULT_FROM_WIN32(ec.value());
+        }
+
+        // Inputs are processed in the same order whatever the directory enumeration order
+        std::sort(std::begin(files), std::end(files));
+        locations.insert(std::end(locations), std::begin(files), std::end(files));
+        return S_OK;
+    }
+
+    std::ifstream ifs(batch, std::ios_base::binary);
+    if (!ifs)
+    {
+        Log::Error(L"Failed to open batch manifest '{}'", strBatch);
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    std::string line;
+    bool bFirstLine = true;
+    while (std::getline(ifs, line))
+    {
+        if (bFirstLine && line.compare(0, 3, "\xEF\xBB\xBF") == 0)
+            line.erase(0, 3);
+        bFirstLine = false;
+
+        boost::algorithm::trim(line);
+        if (line.empty() || line.front() == '#')
+            continue;
+
+        auto location = ToUtf16(line, ec);
+        if (ec)
+        {
+            Log::Warn(L"Invalid line in batch manifest '{}' [{}]", strBatch, ec);
+            ec.clear();
+            continue;
+        }
+
+        const std::filesystem::path path(location);
+        if (!path.has_root_name() && !path.has_root_directory())
+            location = (batch.parent_path() / path).wstring();
+
+        locations.push_back(std::move(location));
+    }
+
+    return S_OK;
+}
+
+HRESULT LocationSet::AddLocationsFromBatch(const std::wstring& strBatch, std::vector<std::wstring>& locations)
+{
+    HRESULT hr = E_FAIL;
+
+    if (FAILED(hr = EnumerateLocations()))
+        return hr;
+
+    std::vector<std::wstring> batchLocations;
+    if (FAILED(hr = ParseLocationsFromBatch(strBatch, batchLocations)))
+        return hr;
+
+    if (batchLocations.empty())
+    {
+        Log::Warn(L"Batch '{}' has no input", strBatch);
+        return S_OK;
+    }
+
+    Log::Debug("Disable location set previously as a batch overrides the value");
+    for (auto& location : m_Locations)
+    {
+        location.second->SetParse(false);
+    }
+
+    // Collected artifacts often share their file name (e.g. '$MFT'): identifiers are made unique so that each input
+    // has its own output
+    std::unordered_set<std::wstring> identifiers;
+    size_t added = 0;
+    for (const auto& location : batchLocations)
+    {
+        std::vector<std::shared_ptr<Location>> addedLocs;
+        if (FAILED(hr = AddLocations(location.c_str(), addedLocs)))
+        {
+            Log::Error(L"Failed to add batch input '{}' [{}]", location, SystemError(hr));
+            continue;
+        }
+
+        for (const auto& loc : addedLocs)
+        {
+            const std::wstring identifier = loc->GetIdentifier();
+            for (size_t i = 1; !identifiers.insert(loc->GetIdentifier()).second; i++)
+            {
+                loc->m_Identifier = fmt::format(L"{}_{}", identifier, i);
+            }
+        }
+
+        locations.push_back(location);
+        added++;
+    }
+
+    Log::Info(L"Batch '{}': {} input(s)", strBatch, added);
+    return S_OK;
+}
+
 HRESULT LocationSet::AddKnownLocations(const ConfigItem& item)
 {
     HRESULT hr = E_FAIL;
@@ -1258,12 +1378,35 @@ HRESULT LocationSet::AddKnownLocations()
 
 HRESULT LocationSet::PopulateMountedVolumes()
 {
-    wregex r(REGEX_MOUNTED_HARDDISKVOLUME, regex_constants::icase);
-
     if (m_bMountedVolumesPopulated)
         return S_OK;
 
     Log::Trace("Populating mounted volumes");
+    HRESULT hr = S_OK;
+
+    auto volumes = LocationCache::LoadMountedVolumes();
+    if (!volumes)
+    {
+        volumes.emplace();
+        if (SUCCEEDED(hr = QueryMountedVolumes(*volumes)))
+        {
+            LocationCache::SaveMountedVolumes(*volumes);
+        }
+    }
+
+    for (const auto& volume : *volumes)
+    {
+        AddMountedVolume(volume);
+    }
+
+    if (S_OK == hr)
+        m_bMountedVolumesPopulated = true;
+
+    return hr;
+}
+
+HRESULT LocationSet::QueryMountedVolumes(LocationCache::MountedVolumes& volumes)
+{
     HRESULT hr = E_FAIL;
 
     //
@@ -1472,19 +1615,17 @@ HRESULT LocationSet::PopulateMountedVolumes()
                 // if no disk extent were found, do no continue with this volume
                 if (pExtents->NumberOfDiskExtents)
                 {
-                    vector<CDiskExtent> diskextents;
+                    LocationCache::MountedVolume mountedVolume;
 
                     for (UINT i = 0; i < pExtents->NumberOfDiskExtents; i++)
                     {
                         WCHAR szPhysDrive[ORC_MAX_PATH];
                         swprintf_s(szPhysDrive, L"\\\\.\\PhysicalDrive%d", pExtents->Extents[i].DiskNumber);
 
-                        CDiskExtent ext(szPhysDrive);
-
-                        ext.m_Length = pExtents->Extents[i].ExtentLength.QuadPart;
-                        ext.m_Start = pExtents->Extents[i].StartingOffset.QuadPart;
-
-                        diskextents.push_back(std::move(ext));
+                        mountedVolume.Extents.push_back(
+                            {szPhysDrive,
+                             static_cast<ULONGLONG>(pExtents->Extents[i].StartingOffset.QuadPart),
+                             static_cast<ULONGLONG>(pExtents->Extents[i].ExtentLength.QuadPart)});
                     }
 
                     if (pExtents != &Extents)
@@ -1493,56 +1634,13 @@ HRESULT LocationSet::PopulateMountedVolumes()
                     }
 
                     szVolumeName[Index] = L'\0';
-                    shared_ptr<Location> loc = make_shared<Location>(szVolumeName, Location::Type::MountedVolume);
+                    mountedVolume.VolumeName = szVolumeName;
                     szVolumeName[Index] = L'\\';
 
-                    loc->m_Paths = std::move(paths);
-                    loc->m_Type = Location::Type::MountedVolume;
-                    loc->m_Extents = std::move(diskextents);
-                    loc->SetParse(false);
-                    loc->SetShadowCopyParser(m_shadowCopyParserType);
-
-                    std::shared_ptr<Location> addedLoc;
-                    if (FAILED(hr = AddLocation(loc, addedLoc, false)))
-                    {
-                        Log::Warn(L"Failed to add Location '{}' [{}]", loc->GetLocation(), SystemError(hr));
-                        continue;
-                    }
-
-                    for (auto& item : loc->m_Paths)
-                    {
-                        HRESULT hr2 = E_FAIL;
-                        std::shared_ptr<Location> addedPath;
-                        if (FAILED(hr2 = AddLocation(item, loc, addedPath, false)))
-                        {
-                            Log::Warn(L"Failed to add Location '{}' [{}]", loc->GetLocation(), SystemError(hr2));
-                            continue;
-                        }
-                    }
-
-                    wstring device_location = L"\\\\.\\HarddiskVolume";
+                    mountedVolume.DeviceName = szDeviceName;
+                    mountedVolume.Paths = std::move(paths);
 
-                    std::wcmatch m;
-                    if (std::regex_match(szDeviceName, m, r))
-                    {
-                        if (m[REGEX_MOUNTED_HARDDISKVOLUME_ID].matched)
-                        {
-                            device_location += m[REGEX_MOUNTED_HARDDISKVOLUME_ID];
-                        }
-                    }
-
-                    shared_ptr<Location> dev_loc =
-                        make_shared<Location>(device_location, Location::Type::MountedVolume);
-                    dev_loc->m_Paths = loc->m_Paths;
-                    dev_loc->m_Type = Location::Type::MountedVolume;
-                    dev_loc->m_Extents = loc->m_Extents;
-                    dev_loc->SetShadowCopyParser(loc->m_shadowCopyParserType);
-
-                    if (FAILED(hr = AddLocation(dev_loc, addedLoc, false)))
-                    {
-                        Log::Warn(L"Failed to add Location '{}' [{}]", dev_loc->GetLocation(), SystemError(hr));
-                        continue;
-                    }
+                    volumes.push_back(std::move(mountedVolume));
                 }
             }
         } while (false);
@@ -1566,12 +1664,77 @@ HRESULT LocationSet::PopulateMountedVolumes()
     FindVolumeClose(hFindHandle);
     hFindHandle = INVALID_HANDLE_VALUE;
 
-    if (S_OK == hr)
-        m_bMountedVolumesPopulated = true;
-
     return hr;
 }
 
+HRESULT LocationSet::AddMountedVolume(const LocationCache::MountedVolume& volume)
+{
+    HRESULT hr = E_FAIL;
+    wregex r(REGEX_MOUNTED_HARDDISKVOLUME, regex_constants::icase);
+
+    vector<CDiskExtent> diskextents;
+    for (const auto& extent : volume.Extents)
+    {
+        CDiskExtent ext(extent.Disk);
+
+        ext.m_Length = extent.Length;
+        ext.m_Start = extent.Start;
+
+        diskextents.push_back(std::move(ext));
+    }
+
+    shared_ptr<Location> loc = make_shared<Location>(volume.VolumeName, Location::Type::MountedVolume);
+
+    loc->m_Paths = volume.Paths;
+    loc->m_Type = Location::Type::MountedVolume;
+    loc->m_Extents = std::move(diskextents);
+    loc->SetParse(false);
+    loc->SetShadowCopyParser(m_shadowCopyParserType);
+
+    std::shared_ptr<Location> addedLoc;
+    if (FAILED(hr = AddLocation(loc, addedLoc, false)))
+    {
+        Log::Warn(L"Failed to add Location '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    for (auto& item : loc->m_Paths)
+    {
+        HRESULT hr2 = E_FAIL;
+        std::shared_ptr<Location> addedPath;
+        if (FAILED(hr2 = AddLocation(item, loc, addedPath, false)))
+        {
+            Log::Warn(L"Failed to add Location '{}' [{}]", loc->GetLocation(), SystemError(hr2));
+            continue;
+        }
+    }
+
+    wstring device_location = L"\\\\.\\HarddiskVolume";
+
+    std::wsmatch m;
+    if (std::regex_match(volume.DeviceName, m, r))
+    {
+        if (m[REGEX_MOUNTED_HARDDISKVOLUME_ID].matched)
+        {
+            device_location += m[REGEX_MOUNTED_HARDDISKVOLUME_ID];
+        }
+    }
+
+    shared_ptr<Location> dev_loc = make_shared<Location>(device_location, Location::Type::MountedVolume);
+    dev_loc->m_Paths = loc->m_Paths;
+    dev_loc->m_Type = Location::Type::MountedVolume;
+    dev_loc->m_Extents = loc->m_Extents;
+    dev_loc->SetShadowCopyParser(loc->m_shadowCopyParserType);
+
+    if (FAILED(hr = AddLocation(dev_loc, addedLoc, false)))
+    {
+        Log::Warn(L"Failed to add Location '{}' [{}]", dev_loc->GetLocation(), SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
 HRESULT LocationSet::PopulatePhysicalDrives()
 {
     if (m_bPhysicalDrivesPopulated)
@@ -1579,22 +1742,29 @@ HRESULT LocationSet::PopulatePhysicalDrives()
 
     Log::Trace(L"Populating physical drives");
     HRESULT hr = E_FAIL;
-    WMI wmi;
 
-    if (FAILED(hr = wmi.Initialize()))
+    auto output = LocationCache::LoadPhysicalDrives();
+    if (!output)
     {
-        Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
-        return hr;
-    }
+        WMI wmi;
 
-    vector<wstring> output;
-    if (FAILED(hr = wmi.WMIEnumPhysicalMedia(output)))
-    {
-        Log::Error(L"Failed to enum physical media via WMI [{}]", SystemError(hr));
-        return hr;
+        if (FAILED(hr = wmi.Initialize()))
+        {
+            Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
+            return hr;
+        }
+
+        output.emplace();
+        if (FAILED(hr = wmi.WMIEnumPhysicalMedia(*output)))
+        {
+            Log::Error(L"Failed to enum physical media via WMI [{}]", SystemError(hr));
+            return hr;
+        }
+
+        LocationCache::SavePhysicalDrives(*output);
     }
 
-    for (auto& drive : output)
+    for (auto& drive : *output)
     {
         std::vector<std::shared_ptr<Location>> addedLocs;
 
@@ -10,6 +10,7 @@
 #include "OrcLib.h"
 #include "CaseInsensitive.h"
 #include "Location.h"
+#include "LocationCache.h"
 
 #include <map>
 #include <unordered_map>
@@ -74,6 +75,8 @@ private:
     Location::Type DeduceLocationType(const WCHAR* szLocation);
 
     HRESULT PopulateMountedVolumes();
+    HRESULT QueryMountedVolumes(LocationCache::MountedVolumes& volumes);
+    HRESULT AddMountedVolume(const LocationCache::MountedVolume& volume);
     HRESULT PopulatePhysicalDrives();
     HRESULT PopulateSystemObjects(bool bInterfacesOnly);
 
@@ -170,6 +173,12 @@ public:
 
     HRESULT AddLocationsFromConfigItem(const ConfigItem& config);
     HRESULT AddLocationsFromArgcArgv(int argc, LPCWSTR argv[]);
+
+    // Batch of offline inputs: either a directory (each of its files) or a manifest (one location per line, '#' starts
+    // a comment line, relative paths are relative to the manifest). A batch replaces the locations set previously and
+    // each input gets a distinct identifier, hence its own output.
+    static HRESULT ParseLocationsFromBatch(const std::wstring& strBatch, std::vector<std::wstring>& locations);
+    HRESULT AddLocationsFromBatch(const std::wstring& strBatch, std::vector<std::wstring>& locations);
     HRESULT AddKnownLocations(const ConfigItem& item);
     HRESULT AddKnownLocations();
 
@@ -0,0 +1,340 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "Log/AsyncSink.h"
+
+#include <iostream>
+#include <map>
+
+#include <spdlog/fmt/fmt.h>
+#include <spdlog/pattern_formatter.h>
+
+using namespace Orc::Log;
+using namespace Orc;
+
+namespace {
+
+// The flusher wakes up on its own from time to time, a missed notification only delays messages
+constexpr auto kIdleTimeout = std::chrono::milliseconds(50);
+
+uint64_t RoundUpToPowerOfTwo(uint64_t value)
+{
+    uint64_t result = 2;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+
+    return result;
+}
+
+}  // namespace
+
+namespace Orc {
+namespace Log {
+
+AsyncSink::AsyncSink(std::shared_ptr<spdlog::sinks::sink> sink)
+    : m_sink(std::move(sink))
+    , m_mask(0)
+    , m_policy(OverflowPolicy::Block)
+    , m_enqueuePos(0)
+    , m_dequeuePos(0)
+    , m_processed(0)
+    , m_dropped(0)
+    , m_reportedDropped(0)
+    , m_started(false)
+    , m_stopping(false)
+    , m_producers(0)
+    , m_idle(false)
+{
+    // Filtering happens on this sink, the wrapped one gets everything it is given
+    m_sink->set_level(spdlog::level::trace);
+}
+
+AsyncSink::~AsyncSink()
+{
+    Stop();
+}
+
+void AsyncSink::Start(OverflowPolicy policy, size_t capacity)
+{
+    if (m_started)
+    {
+        return;
+    }
+
+    const auto slotCount = RoundUpToPowerOfTwo(capacity);
+    m_slots = std::make_unique<Slot[]>(slotCount);
+    for (uint64_t i = 0; i < slotCount; ++i)
+    {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_mask = slotCount - 1;
+    m_policy = policy;
+    m_enqueuePos = 0;
+    m_dequeuePos = 0;
+    m_processed = 0;
+    m_dropped = 0;
+    m_reportedDropped = 0;
+    m_stopping = false;
+
+    m_thread = std::thread([this]() { Run(); });
+    m_started = true;
+}
+
+void AsyncSink::Stop()
+{
+    if (!m_started.exchange(false))
+    {
+        return;
+    }
+
+    // Messages being queued by threads which saw the sink started must reach the ring before the flusher leaves
+    while (m_producers != 0)
+    {
+        std::this_thread::yield();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_stopping = true;
+        m_wake.notify_one();
+    }
+
+    m_thread.join();
+    m_slots.reset();
+
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink->flush();
+}
+
+void AsyncSink::log(const spdlog::details::log_msg& msg)
+{
+    ++m_producers;
+
+    if (!m_started)
+    {
+        --m_producers;
+        WriteInline(msg);
+        return;
+    }
+
+    while (!TryEnqueue(msg))
+    {
+        if (m_policy == OverflowPolicy::Drop)
+        {
+            ++m_dropped;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_wakeMutex);
+            m_wake.notify_one();
+        }
+
+        std::this_thread::yield();
+    }
+
+    --m_producers;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_idle)
+    {
+        std::lock_guard<std::mutex> lock(m_wakeMutex);
+        m_wake.notify_one();
+    }
+}
+
+void AsyncSink::flush()
+{
+    if (m_started && std::this_thread::get_id() != m_thread.get_id())
+    {
+        Drain(m_enqueuePos.load(std::memory_order_acquire));
+    }
+
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink->flush();
+}
+
+void AsyncSink::set_pattern(const std::string& pattern)
+{
+    set_formatter(std::make_unique<spdlog::pattern_formatter>(pattern));
+}
+
+void AsyncSink::set_formatter(std::unique_ptr<spdlog::formatter> formatter)
+{
+    // Queued messages were logged with the previous formatter
+    if (m_started)
+    {
+        Drain(m_enqueuePos.load(std::memory_order_acquire));
+    }
+
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink->set_formatter(std::move(formatter));
+}
+
+bool AsyncSink::TryEnqueue(const spdlog::details::log_msg& msg)
+{
+    // Bounded MPSC ring: a slot is free for position 'pos' when its sequence is 'pos', ready to be read when it is
+    // 'pos + 1' and recycled by the reader for the next lap with 'pos + capacity'
+    auto pos = m_enqueuePos.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        auto& slot = m_slots[pos & m_mask];
+        const auto sequence = slot.sequence.load(std::memory_order_acquire);
+        const auto diff = static_cast<int64_t>(sequence - pos);
+        if (diff == 0)
+        {
+            if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                slot.msg = spdlog::details::log_msg_buffer(msg);
+                slot.sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = m_enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AsyncSink::Drain(uint64_t target)
+{
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    m_wake.notify_one();
+
+    while (m_processed.load(std::memory_order_acquire) < target)
+    {
+        m_progress.wait_for(lock, kIdleTimeout);
+    }
+}
+
+void AsyncSink::Run()
+{
+    const auto isReady = [this]() {
+        return m_slots[m_dequeuePos & m_mask].sequence.load(std::memory_order_acquire) == m_dequeuePos + 1;
+    };
+
+    for (;;)
+    {
+        if (isReady())
+        {
+            std::lock_guard<std::mutex> lock(m_sinkMutex);
+
+            do
+            {
+                auto& slot = m_slots[m_dequeuePos & m_mask];
+
+                try
+                {
+                    m_sink->log(slot.msg);
+                }
+                catch (const std::exception& e)
+                {
+                    // Logging from here could wait on this very thread
+                    std::cerr << "Failed to write log message: " << e.what() << std::endl;
+                }
+
+                slot.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+                ++m_dequeuePos;
+            } while (isReady());
+
+            ReportDropped();
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_wakeMutex);
+            m_processed.store(m_dequeuePos, std::memory_order_release);
+            m_progress.notify_all();
+
+            if (isReady())
+            {
+                continue;
+            }
+
+            // Producers stopped queueing once 'm_stopping' is set, what was claimed is published
+            if (m_stopping && m_dequeuePos == m_enqueuePos.load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            m_idle = true;
+            m_wake.wait_for(lock, kIdleTimeout, [&]() { return m_stopping || isReady(); });
+            m_idle = false;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    ReportDropped();
+}
+
+void AsyncSink::ReportDropped()
+{
+    const auto dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped == m_reportedDropped)
+    {
+        return;
+    }
+
+    const auto payload = fmt::format("Log queue is full, {} message(s) dropped", dropped - m_reportedDropped);
+    m_reportedDropped = dropped;
+
+    try
+    {
+        m_sink->log(spdlog::details::log_msg(spdlog::string_view_t(), spdlog::level::warn, payload));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Failed to write log message: " << e.what() << std::endl;
+    }
+}
+
+void AsyncSink::WriteInline(const spdlog::details::log_msg& msg)
+{
+    std::lock_guard<std::mutex> lock(m_sinkMutex);
+    m_sink->log(msg);
+}
+
+std::wstring_view ToString(AsyncSink::OverflowPolicy policy)
+{
+    switch (policy)
+    {
+        case AsyncSink::OverflowPolicy::Block:
+            return kOverflowPolicyBlock;
+        case AsyncSink::OverflowPolicy::Drop:
+            return kOverflowPolicyDrop;
+        default:
+            return L"unknown";
+    }
+}
+
+Orc::Result<AsyncSink::OverflowPolicy> ToOverflowPolicy(const std::wstring& policy)
+{
+    const std::map<std::wstring_view, AsyncSink::OverflowPolicy> map = {
+        {kOverflowPolicyBlock, AsyncSink::OverflowPolicy::Block},
+        {kOverflowPolicyDrop, AsyncSink::OverflowPolicy::Drop}};
+
+    auto it = map.find(policy);
+    if (it == std::cend(map))
+    {
+        return std::make_error_code(std::errc::invalid_argument);
+    }
+
+    return it->second;
+}
+
+}  // namespace Log
+}  // namespace Orc
@@ -0,0 +1,103 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <spdlog/details/log_msg_buffer.h>
+#include <spdlog/sinks/sink.h>
+
+#include "Utils/Result.h"
+
+namespace Orc {
+namespace Log {
+
+constexpr std::wstring_view kOverflowPolicyBlock = L"block";
+constexpr std::wstring_view kOverflowPolicyDrop = L"drop";
+
+//
+// AsyncSink: moves formatting and writing of log messages to a background thread.
+//
+// Logging threads only copy the message into a bounded ring, claiming a slot is lock-free. The flusher thread applies
+// the pattern and writes to the wrapped sink. When the ring is full messages are either dropped (and reported by the
+// flusher) or the logging thread waits for a free slot.
+//
+// flush() is synchronous: it returns once every message queued before the call reached the wrapped sink, so
+// spdlog's 'flush_on' keeps its guarantees. Until Start() is called, or after Stop(), messages are written inline.
+//
+class AsyncSink final : public spdlog::sinks::sink
+{
+public:
+    enum class OverflowPolicy
+    {
+        Block,
+        Drop
+    };
+
+    static constexpr size_t kDefaultCapacity = 8192;
+
+    explicit AsyncSink(std::shared_ptr<spdlog::sinks::sink> sink);
+    ~AsyncSink() override;
+
+    void Start(OverflowPolicy policy, size_t capacity = kDefaultCapacity);
+    void Stop();
+
+    bool IsStarted() const { return m_started; }
+    uint64_t DroppedCount() const { return m_dropped; }
+
+    void log(const spdlog::details::log_msg& msg) override;
+    void flush() override;
+    void set_pattern(const std::string& pattern) override;
+    void set_formatter(std::unique_ptr<spdlog::formatter> formatter) override;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence;
+        spdlog::details::log_msg_buffer msg;
+    };
+
+    bool TryEnqueue(const spdlog::details::log_msg& msg);
+    void Drain(uint64_t target);
+    void Run();
+    void ReportDropped();
+    void WriteInline(const spdlog::details::log_msg& msg);
+
+    std::shared_ptr<spdlog::sinks::sink> m_sink;
+    std::mutex m_sinkMutex;
+
+    std::unique_ptr<Slot[]> m_slots;
+    uint64_t m_mask;
+    OverflowPolicy m_policy;
+    std::atomic<uint64_t> m_enqueuePos;
+    uint64_t m_dequeuePos;
+    std::atomic<uint64_t> m_processed;
+    std::atomic<uint64_t> m_dropped;
+    uint64_t m_reportedDropped;
+
+    std::atomic<bool> m_started;
+    std::atomic<bool> m_stopping;
+    std::atomic<uint32_t> m_producers;
+    std::atomic<bool> m_idle;
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_progress;
+    std::thread m_thread;
+};
+
+std::wstring_view ToString(AsyncSink::OverflowPolicy policy);
+Orc::Result<AsyncSink::OverflowPolicy> ToOverflowPolicy(const std::wstring& policy);
+
+}  // namespace Log
+}  // namespace Orc
@@ -58,12 +58,21 @@ public:
             return;
         }
 
+        // Arguments are only formatted when some facility keeps the message
+        bool formatted = false;
         fmt::basic_memory_buffer<CharT> msg;
         for (auto it = first; it != last; ++it)
         {
             const SpdlogLogger::Ptr& logger = *it;
-            if (msg.size() == 0)
+            if (!logger->ShouldLog(level))
             {
+                continue;
+            }
+
+            if (!formatted)
+            {
+                formatted = true;
+
                 try
                 {
                     if constexpr (std::is_same_v<CharT, char>)
@@ -78,6 +87,8 @@ public:
                 catch (const fmt::format_error&)
                 {
                     assert(0 && "Failed to format log message");
+                    formatted = false;
+                    msg.clear();
                     logger->Log(timepoint, level, "Failed to format log message");
                     logger->Log(timepoint, level, arg0);
                     continue;
@@ -88,6 +99,11 @@ public:
         }
 
 #ifdef _DEBUG
+        if (!formatted)
+        {
+            return;
+        }
+
         msg.push_back('\n');
         msg.push_back('\0');
 
@@ -126,9 +142,6 @@ public:
     template <typename... Args>
     void Trace(Args&&... args)
     {
-        // FIXME: find a way to only enable trace when requested to limit cpu usage
-        return;
-
         Log(std::cbegin(m_defaultFacilities),
             std::cend(m_defaultFacilities),
             Level::Trace,
@@ -22,6 +22,7 @@ SpdlogLogger::SpdlogLogger(const std::string& name)
           std::make_unique<spdlog::pattern_formatter>(kDefaultLogPattern, spdlog::pattern_time_type::utc))
     , m_backtraceTrigger(Level::Off)
     , m_backtraceLevel(Level::Debug)
+    , m_backtraceEnabled(false)
 {
     m_logger->flush_on(spdlog::level::err);
 }
@@ -45,11 +46,13 @@ void SpdlogLogger::SetLevel(Log::Level level)
 void SpdlogLogger::EnableBacktrace(size_t messageCount)
 {
     m_logger->enable_backtrace(messageCount);
+    m_backtraceEnabled = true;
 }
 
 void SpdlogLogger::DisableBacktrace()
 {
     m_logger->disable_backtrace();
+    m_backtraceEnabled = false;
 }
 
 void SpdlogLogger::DumpBacktrace()
@@ -53,6 +53,30 @@ public:
 
     const std::vector<SpdlogSink::Ptr>& Sinks();
 
+    // Whether a message of this level would reach a sink or the backtrace, so formatting it can be skipped otherwise
+    inline bool ShouldLog(Log::Level level) const
+    {
+        if (m_backtraceEnabled && level >= m_backtraceLevel)
+        {
+            return true;
+        }
+
+        if (!m_logger->should_log(static_cast<spdlog::level::level_enum>(level)))
+        {
+            return false;
+        }
+
+        for (const auto& sink : m_sinks)
+        {
+            if (level >= sink->Level())
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     inline void Log(const std::chrono::system_clock::time_point& timepoint, Log::Level level, fmt::string_view msg)
     {
         if (level >= m_backtraceTrigger && m_backtraceTrigger != Level::Off)
@@ -130,6 +154,7 @@ private:
     std::unique_ptr<spdlog::formatter> m_backtraceFormatter;
     Log::Level m_backtraceTrigger;
     Log::Level m_backtraceLevel;
+    bool m_backtraceEnabled;
 };
 
 }  // namespace Log
@@ -10,11 +10,16 @@
 #include "MFTOffline.h"
 
 #include "OfflineMFTReader.h"
+#include "MFTRecord.h"
 
 #include "Log/Log.h"
 
 using namespace Orc;
 
+// Records fetched by FetchMFTRecord are read together when they are at most this far apart in the MFT file
+constexpr auto FETCH_MAX_GAP = 64 * 1024ULL;
+constexpr auto FETCH_MAX_RUN_LENGTH = 1024 * 1024ULL;
+
 MFTOffline::MFTOffline(std::shared_ptr<OfflineMFTReader>& volReader)
     : m_pVolReader(volReader)
 {
@@ -31,6 +36,50 @@ HRESULT MFTOffline::Initialize()
     return S_OK;
 }
 
+HRESULT MFTOffline::SkipUnusedRecords()
+{
+    HRESULT hr = E_FAIL;
+
+    m_InUseRecords.clear();
+
+    ULONGLONG ullBytesRead = 0LL;
+    CBinaryBuffer record;
+    if (FAILED(hr = m_pFetchReader->Read(0LL, record, m_pVolReader->GetBytesPerFRS(), ullBytesRead)))
+    {
+        Log::Error(L"Failed to read $MFT record in MFT file [{}]", SystemError(hr));
+        return hr;
+    }
+
+    MFTRecord mftRecord;
+    if (FAILED(
+            hr = mftRecord.ParseRecord(
+                m_pVolReader,
+                reinterpret_cast<FILE_RECORD_SEGMENT_HEADER*>(record.GetData()),
+                record.GetCount(),
+                NULL)))
+    {
+        Log::Error(L"Failed to parse $MFT record in MFT file [{}]", SystemError(hr));
+        return hr;
+    }
+
+    // Only the MFT is available: a non resident bitmap lives in clusters which were not copied along
+    auto bitmapAttribute = mftRecord.GetBitmapAttribute(L"");
+    if (!bitmapAttribute || !bitmapAttribute->IsResident())
+    {
+        Log::Debug(L"No resident $MFT:$BITMAP in MFT file, all records are enumerated");
+        return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+    }
+
+    if (FAILED(hr = bitmapAttribute->LoadBitField(m_pVolReader)))
+    {
+        Log::Error(L"Failed to read $MFT:$BITMAP, all records are enumerated [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_InUseRecords = bitmapAttribute->Bits();
+    return S_OK;
+}
+
 HRESULT MFTOffline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
 {
     HRESULT hr = E_FAIL;
@@ -43,8 +92,14 @@ HRESULT MFTOffline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
 
     GetFileSizeEx(m_pVolReader->GetHandle(), &End);
 
-    if (INVALID_SET_FILE_POINTER
-        == SetFilePointer(m_pVolReader->GetHandle(), Start.LowPart, &Start.HighPart, FILE_BEGIN))
+    const ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
+
+    // A mapped MFT file hands out records pointing into the mapping, they are only read otherwise
+    const bool bMapped = m_pVolReader->IsMapped();
+
+    if (!bMapped
+        && INVALID_SET_FILE_POINTER
+            == SetFilePointer(m_pVolReader->GetHandle(), Start.LowPart, &Start.HighPart, FILE_BEGIN))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
         Log::Error(L"Could not seek to offset {} in MFT file [{}]", Start.LowPart, SystemError(hr));
@@ -52,33 +107,72 @@ HRESULT MFTOffline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
     }
 
     CBinaryBuffer buffer;
-    if (!buffer.SetCount(m_pVolReader->GetBytesPerFRS()))
-        return E_OUTOFMEMORY;
+    if (!bMapped)
+    {
+        if (!buffer.SetCount(ulBytesPerFRS))
+            return E_OUTOFMEMORY;
 
-    ZeroMemory(buffer.GetData(), m_pVolReader->GetBytesPerFRS());
+        ZeroMemory(buffer.GetData(), ulBytesPerFRS);
+    }
 
     ULONGLONG ullCurrentIndex = 0;
     ULONGLONG ullCurrentMftIndex = 0;
-    ULONGLONG ullLastIndex = (End.QuadPart - Start.QuadPart) / m_pVolReader->GetBytesPerFRS();
+    ULONGLONG ullLastIndex = (End.QuadPart - Start.QuadPart) / ulBytesPerFRS;
 
     while (ullCurrentIndex < ullLastIndex)
     {
-        DWORD dwBytesRead = 0;
-
-        if (!ReadFile(m_pVolReader->GetHandle(), buffer.GetData(), m_pVolReader->GetBytesPerFRS(), &dwBytesRead, NULL))
+        if (!MFTUtils::IsRecordInUse(m_InUseRecords, ullCurrentMftIndex))
         {
-            hr = HRESULT_FROM_WIN32(GetLastError());
-            Log::Error("Could not read in MFT file [{}]", SystemError(hr));
-            return hr;
+            const auto span =
+                MFTUtils::GetInUseRecordSpan(m_InUseRecords, ullCurrentMftIndex, ullLastIndex, 1LL, 1LL);
+            if (span.Count == 0)
+                break;
+
+            LARGE_INTEGER Offset;
+            Offset.QuadPart = span.First * ulBytesPerFRS;
+
+            if (!bMapped
+                && INVALID_SET_FILE_POINTER
+                    == SetFilePointer(m_pVolReader->GetHandle(), Offset.LowPart, &Offset.HighPart, FILE_BEGIN))
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+                Log::Error(L"Could not seek to offset {} in MFT file [{}]", Offset.QuadPart, SystemError(hr));
+                return hr;
+            }
+
+            ullCurrentIndex += span.First - ullCurrentMftIndex;
+            ullCurrentMftIndex = span.First;
         }
 
-        if (dwBytesRead != m_pVolReader->GetBytesPerFRS())
+        BYTE* pRecord = nullptr;
+        if (bMapped)
         {
-            Log::Debug("Reached end of offline MFT [{}]", SystemError(hr));
-            return S_OK;
+            if (FAILED(hr = m_pVolReader->View(ullCurrentIndex * ulBytesPerFRS, ulBytesPerFRS, pRecord)))
+            {
+                Log::Error(L"Could not map record {} of MFT file [{}]", ullCurrentMftIndex, SystemError(hr));
+                return hr;
+            }
         }
+        else
+        {
+            DWORD dwBytesRead = 0;
+            if (!ReadFile(m_pVolReader->GetHandle(), buffer.GetData(), ulBytesPerFRS, &dwBytesRead, NULL))
+            {
+                hr = HRESULT_FROM_WIN32(GetLastError());
+                Log::Error("Could not read in MFT file [{}]", SystemError(hr));
+                return hr;
+            }
 
-        PFILE_RECORD_SEGMENT_HEADER pHeader = (PFILE_RECORD_SEGMENT_HEADER)buffer.GetData();
+            if (dwBytesRead != ulBytesPerFRS)
+            {
+                Log::Debug("Reached end of offline MFT [{}]", SystemError(hr));
+                return S_OK;
+            }
+
+            pRecord = buffer.GetData();
+        }
+
+        PFILE_RECORD_SEGMENT_HEADER pHeader = (PFILE_RECORD_SEGMENT_HEADER)pRecord;
 
         if ((pHeader->MultiSectorHeader.Signature[0] != 'F') || (pHeader->MultiSectorHeader.Signature[1] != 'I')
             || (pHeader->MultiSectorHeader.Signature[2] != 'L') || (pHeader->MultiSectorHeader.Signature[3] != 'E'))
@@ -89,10 +183,14 @@ HRESULT MFTOffline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
                 pHeader->MultiSectorHeader.Signature[1],
                 pHeader->MultiSectorHeader.Signature[2],
                 pHeader->MultiSectorHeader.Signature[3]);
+            ullCurrentIndex++;
+            ullCurrentMftIndex++;
             continue;
         }
 
-        if (FAILED(hr = pCallBack(ullCurrentMftIndex, buffer)))
+        // Callbacks fix the record up in their own copy, a write through the mapping would only change a private page
+        CBinaryBuffer record(pRecord, ulBytesPerFRS);
+        if (FAILED(hr = pCallBack(ullCurrentMftIndex, record)))
         {
             if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
             {
@@ -126,49 +224,22 @@ HRESULT MFTOffline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTU
             return leftRFN.SegmentNumberLowPart < rigthRFN.SegmentNumberLowPart;
         });
 
-    ULONGLONG ullCurrentIndex = 0;
-    // go through each extent of mft and search for the files
-
-    ULONGLONG ullCorrection = 0LL;
-
     ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
 
-    CBinaryBuffer localReadBuffer(true);
-
-    if (!localReadBuffer.CheckCount(ulBytesPerFRS))
-        return E_OUTOFMEMORY;
-
+    // The offline MFT is a plain copy of $MFT, a segment lives at segment number * bytes per FRS
+    std::vector<ULONGLONG> offsets;
+    offsets.reserve(frn.size());
     for (const auto& idx : frn)
     {
-        LARGE_INTEGER Index;
-
+        ULARGE_INTEGER Index;
         Index.LowPart = idx.SegmentNumberLowPart;
         Index.HighPart = idx.SegmentNumberHighPart;
+        offsets.push_back(Index.QuadPart * ulBytesPerFRS);
+    }
 
-        Index.QuadPart *= ulBytesPerFRS;
-
-        if (INVALID_SET_FILE_POINTER
-            == SetFilePointer(m_pFetchReader->GetHandle(), Index.LowPart, &Index.HighPart, FILE_BEGIN))
-        {
-            hr = HRESULT_FROM_WIN32(GetLastError());
-            Log::Error(L"Could not seek to offset {} in MFT file [{}]", Index.QuadPart, SystemError(hr));
-            continue;
-        }
-
-        DWORD dwBytesRead = 0LL;
-        if (!ReadFile(
-                m_pFetchReader->GetHandle(),
-                localReadBuffer.GetData(),
-                m_pFetchReader->GetBytesPerFRS(),
-                &dwBytesRead,
-                NULL))
-        {
-            hr = HRESULT_FROM_WIN32(GetLastError());
-            Log::Error(L"Could not read {} bytes in MFT file [{}]", m_pFetchReader->GetBytesPerFRS(), SystemError(hr));
-            continue;
-        }
-
-        PFILE_RECORD_SEGMENT_HEADER pHeader = (PFILE_RECORD_SEGMENT_HEADER)localReadBuffer.GetData();
+    auto fetched = [&](size_t i, CBinaryBuffer& record) -> HRESULT {
+        const auto& idx = frn[i];
+        PFILE_RECORD_SEGMENT_HEADER pHeader = (PFILE_RECORD_SEGMENT_HEADER)record.GetData();
 
         if ((pHeader->MultiSectorHeader.Signature[0] != 'F') || (pHeader->MultiSectorHeader.Signature[1] != 'I')
             || (pHeader->MultiSectorHeader.Signature[2] != 'L') || (pHeader->MultiSectorHeader.Signature[3] != 'E'))
@@ -179,7 +250,7 @@ HRESULT MFTOffline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTU
                 pHeader->MultiSectorHeader.Signature[1],
                 pHeader->MultiSectorHeader.Signature[2],
                 pHeader->MultiSectorHeader.Signature[3]);
-            continue;
+            return S_OK;
         }
 
         MFT_SEGMENT_REFERENCE read_record_frn = {0};
@@ -193,7 +264,7 @@ HRESULT MFTOffline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTU
                 L"Skipping... {} does not match the expected {}",
                 NtfsSegmentNumber(&read_record_frn),
                 NtfsSegmentNumber(&idx));
-            continue;
+            return S_OK;
         }
         if (read_record_frn.SequenceNumber != idx.SequenceNumber)
         {
@@ -201,11 +272,12 @@ HRESULT MFTOffline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTU
                 L"Skipping... Sequence numbed {} does not match the expected {}",
                 read_record_frn.SequenceNumber,
                 idx.SequenceNumber);
-            continue;
+            return S_OK;
         }
 
-        MFTUtils::SafeMFTSegmentNumber safeFRN = (ULONGLONG)Index.QuadPart;
-        if (FAILED(hr = pCallBack(safeFRN, localReadBuffer)))
+        HRESULT hr = E_FAIL;
+        MFTUtils::SafeMFTSegmentNumber safeFRN = NtfsSegmentNumber(&idx);
+        if (FAILED(hr = pCallBack(safeFRN, record)))
         {
             if (hr == E_OUTOFMEMORY)
             {
@@ -219,6 +291,76 @@ HRESULT MFTOffline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTU
             }
             Log::Debug("WARNING: Add Record Callback failed");
         }
+        return S_OK;
+    };
+
+    // A mapped MFT file needs no read: each record is handed out where it lies in the mapping
+    if (m_pFetchReader->IsMapped())
+    {
+        for (size_t i = 0; i < offsets.size(); i++)
+        {
+            BYTE* pRecord = nullptr;
+            if (FAILED(hr = m_pFetchReader->View(offsets[i], ulBytesPerFRS, pRecord)))
+            {
+                Log::Debug(L"Could not map record at offset {} in MFT file [{}]", offsets[i], SystemError(hr));
+                continue;
+            }
+
+            CBinaryBuffer record(pRecord, ulBytesPerFRS);
+            if (FAILED(hr = fetched(i, record)))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+    const auto runs = MFTUtils::GetSegmentRuns(offsets, ulBytesPerFRS, FETCH_MAX_GAP, FETCH_MAX_RUN_LENGTH);
+
+    CBinaryBuffer runBuffer(true);
+    CBinaryBuffer localReadBuffer(true);
+
+    if (!localReadBuffer.CheckCount(ulBytesPerFRS))
+        return E_OUTOFMEMORY;
+
+    for (const auto& run : runs)
+    {
+        if (!runBuffer.CheckCount(static_cast<size_t>(run.ullLength)))
+            return E_OUTOFMEMORY;
+
+        LARGE_INTEGER Offset;
+        Offset.QuadPart = run.ullOffset;
+
+        if (INVALID_SET_FILE_POINTER
+            == SetFilePointer(m_pFetchReader->GetHandle(), Offset.LowPart, &Offset.HighPart, FILE_BEGIN))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Could not seek to offset {} in MFT file [{}]", run.ullOffset, SystemError(hr));
+            continue;
+        }
+
+        DWORD dwBytesRead = 0LL;
+        if (!ReadFile(
+                m_pFetchReader->GetHandle(),
+                runBuffer.GetData(),
+                static_cast<DWORD>(run.ullLength),
+                &dwBytesRead,
+                NULL))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Could not read {} bytes in MFT file [{}]", run.ullLength, SystemError(hr));
+            continue;
+        }
+
+        for (size_t i = run.First; i < run.First + run.Count; i++)
+        {
+            if (offsets[i] - run.ullOffset + ulBytesPerFRS > dwBytesRead)
+                continue;
+
+            CopyMemory(localReadBuffer.GetData(), runBuffer.GetData() + (offsets[i] - run.ullOffset), ulBytesPerFRS);
+
+            if (FAILED(hr = fetched(i, localReadBuffer)))
+                return hr;
+        }
     }
 
     return S_OK;
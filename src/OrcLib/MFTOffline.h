@@ -27,6 +27,8 @@ public:
 
     virtual ULONG64 GetMftOffset() { return 0LL; }
 
+    virtual HRESULT SkipUnusedRecords();
+
     virtual HRESULT EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack);
     virtual HRESULT FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUtils::EnumMFTRecordCall pCallBack);
     virtual ULONG GetMFTRecordCount() const;
@@ -37,6 +39,7 @@ private:
     std::shared_ptr<OfflineMFTReader> m_pFetchReader;
 
     MFTUtils::SafeMFTSegmentNumber m_RootUSN;
+    MFTUtils::InUseRecords m_InUseRecords;  // empty unless SkipUnusedRecords succeeded
 };
 }  // namespace Orc
 
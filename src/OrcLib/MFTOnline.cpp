@@ -9,17 +9,68 @@
 
 #include "MFTOnline.h"
 
+#include <chrono>
+
 #include <boost/algorithm/string/join.hpp>
 
 #include "VolumeReader.h"
+#include "VolumeReadProfile.h"
+#include "AdaptiveReadSize.h"
+#include "LargePages.h"
+#include "Trace.h"
 
 #include "Log/Log.h"
+#include "Utils/Guard.h"
 #include "MFTRecord.h"
 
 using namespace Orc;
 
+// Records read by the first read of an enumeration, the next reads are sized from the measured throughput
 static const auto DEFAULT_FRS_PER_READ = 64;
 
+// Unused records between two records in use are read along rather than skipped when there are fewer than this
+constexpr auto MIN_SKIPPED_FRS = 16ULL;
+
+// Records fetched by FetchMFTRecord are read together when they are at most this far apart on the volume
+constexpr auto FETCH_MAX_GAP = 64 * 1024ULL;
+constexpr auto FETCH_MAX_RUN_LENGTH = 1024 * 1024ULL;
+
+namespace {
+
+constexpr ULONG kPageSize = 0x1000;
+
+// Reads are whole records and whole pages (unbuffered reads are sector aligned as well), within the largest transfer
+// accepted by the device
+AdaptiveReadSize CreateReadSize(const VolumeReader& volume)
+{
+    const ULONG ulBytesPerFRS = volume.GetBytesPerFRS();
+    const ULONG ulUnit = std::max({ulBytesPerFRS, volume.GetBytesPerSector(), kPageSize});
+
+    ULONG ulMaxSize = AdaptiveReadSize::kDefaultMaxSize;
+    if (volume.GetMaxTransferLength() > 0)
+        ulMaxSize = std::min(ulMaxSize, volume.GetMaxTransferLength());
+
+    return AdaptiveReadSize(
+        ulUnit, ulBytesPerFRS * DEFAULT_FRS_PER_READ, AdaptiveReadSize::kDefaultMinSize, ulMaxSize);
+}
+
+std::chrono::microseconds ElapsedSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+}
+
+void LogReadSize(const AdaptiveReadSize& readSize)
+{
+    Log::Debug(
+        L"MFT read size: {} bytes ({} increases, {} decreases, max: {})",
+        readSize.Size(),
+        readSize.Increases(),
+        readSize.Decreases(),
+        readSize.MaxSize());
+}
+
+}  // namespace
+
 MFTOnline::MFTOnline(std::shared_ptr<VolumeReader> volReader)
     : m_pVolReader(std::move(volReader))
 {
@@ -318,6 +369,147 @@ ULONG MFTOnline::GetMFTRecordCount() const
     return li.LowPart;
 }
 
+HRESULT MFTOnline::SkipUnusedRecords()
+{
+    HRESULT hr = E_FAIL;
+
+    m_InUseRecords.clear();
+
+    ULONGLONG ullBytesRead = 0LL;
+    CBinaryBuffer record;
+    if (FAILED(hr = m_pVolReader->Read(m_MftOffset, record, m_pVolReader->GetBytesPerFRS(), ullBytesRead)))
+    {
+        Log::Error(L"Failed to read $MFT record [{}]", SystemError(hr));
+        return hr;
+    }
+
+    MFTRecord mftRecord;
+    if (FAILED(
+            hr = mftRecord.ParseRecord(
+                m_pVolReader,
+                reinterpret_cast<FILE_RECORD_SEGMENT_HEADER*>(record.GetData()),
+                record.GetCount(),
+                NULL)))
+    {
+        Log::Error(L"Failed to parse $MFT record [{}]", SystemError(hr));
+        return hr;
+    }
+
+    auto bitmapAttribute = mftRecord.GetBitmapAttribute(L"");
+    if (!bitmapAttribute)
+    {
+        Log::Debug(L"No $MFT:$BITMAP in $MFT base record, all records are enumerated");
+        return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+    }
+
+    if (FAILED(hr = bitmapAttribute->LoadBitField(m_pVolReader)))
+    {
+        Log::Error(L"Failed to read $MFT:$BITMAP, all records are enumerated [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_InUseRecords = bitmapAttribute->Bits();
+
+    Log::Debug(L"$MFT:$BITMAP: {} records in use out of {}", m_InUseRecords.count(), GetMFTRecordCount());
+    return S_OK;
+}
+
+HRESULT MFTOnline::EnumInUseMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
+{
+    HRESULT hr = E_FAIL;
+
+    ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
+
+    auto readSize = ::CreateReadSize(*m_pVolReader);
+    auto readSizeGuard = Guard::CreateScopeGuard([&readSize]() { ::LogReadSize(readSize); });
+
+    // Page aligned buffer, large enough for the largest read, backed by large pages when available
+    CBinaryBuffer localReadBuffer(true);
+
+    if (!localReadBuffer.ReserveLargePages(LargePages::PreferredSize(readSize.MaxSize())))
+        return E_OUTOFMEMORY;
+
+    if (!localReadBuffer.CheckCount(readSize.MaxSize()))
+        return E_OUTOFMEMORY;
+
+    const auto& readProfile = VolumeReadProfile::Instance();
+    m_pVolReader->EnableReadAhead(readProfile.QueueDepth(), readProfile.ChunkSize());
+    auto readAheadGuard = Guard::CreateScopeGuard([this]() { m_pVolReader->DisableReadAhead(); });
+
+    // Segment number of the first record of the current extent
+    ULONGLONG ullExtentFRN = 0LL;
+
+    for (const auto& NRAE : m_MFT0Info.ExtentsVector)
+    {
+        const ULONGLONG ullFRSCountInExtent = NRAE.DataSize / ulBytesPerFRS;
+        const ULONGLONG ullExtentEnd = ullExtentFRN + ullFRSCountInExtent;
+
+        ULONGLONG ullNextFRN = ullExtentFRN;
+        while (!NRAE.bZero && ullNextFRN < ullExtentEnd)
+        {
+            // Reads begin and end with records in use, long runs of unused records are not read at all
+            const auto span = MFTUtils::GetInUseRecordSpan(
+                m_InUseRecords, ullNextFRN, ullExtentEnd, readSize.Size() / ulBytesPerFRS, MIN_SKIPPED_FRS);
+            if (span.Count == 0)
+                break;
+
+            const ULONGLONG ullPosition = NRAE.DiskOffset + (span.First - ullExtentFRN) * ulBytesPerFRS;
+            const ULONGLONG ullBytesToRead = span.Count * ulBytesPerFRS;
+
+            ULONGLONG ullBytesRead = 0LL;
+            const auto start = std::chrono::steady_clock::now();
+            if (FAILED(hr = m_pVolReader->Read(ullPosition, localReadBuffer, ullBytesToRead, ullBytesRead)))
+            {
+                Log::Error(
+                    L"Failed to read {} bytes from at position {} [{}]", ullBytesToRead, ullPosition, SystemError(hr));
+                return hr;
+            }
+            readSize.Record(ullBytesRead, ::ElapsedSince(start));
+
+            if (ullBytesRead != ullBytesToRead)
+            {
+                Log::Warn(L"Failed to read only complete records {} at position {}", ullPosition, ullBytesToRead);
+            }
+
+            const auto chunk = Trace::MFTChunkStart(span.First, ullBytesRead / ulBytesPerFRS);
+            auto chunkGuard = Guard::CreateScopeGuard([&chunk]() { Trace::MFTChunkStop(chunk); });
+
+            for (ULONGLONG i = 0; i < ullBytesRead / ulBytesPerFRS; i++)
+            {
+                MFTUtils::SafeMFTSegmentNumber ullFRN = span.First + i;
+                if (!MFTUtils::IsRecordInUse(m_InUseRecords, ullFRN))
+                    continue;
+
+                CBinaryBuffer tempFRS(localReadBuffer.GetData() + i * ulBytesPerFRS, ulBytesPerFRS);
+
+                if (FAILED(hr = pCallBack(ullFRN, tempFRS)))
+                {
+                    if (hr == E_OUTOFMEMORY)
+                    {
+                        Log::Error("Add Record Callback failed, not enough memory to continue [{}]", SystemError(hr));
+                        return hr;
+                    }
+                    else if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+                    {
+                        Log::Debug("Add Record Callback asks for enumeration to stop [{}]", SystemError(hr));
+                        return hr;
+                    }
+                    Log::Warn("Add Record Callback failed [{}]", SystemError(hr));
+                }
+            }
+
+            if (ullBytesRead < ulBytesPerFRS)
+                break;
+
+            ullNextFRN = span.First + ullBytesRead / ulBytesPerFRS;
+        }
+
+        ullExtentFRN = ullExtentEnd;
+    }
+
+    return S_OK;
+}
+
 HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
 {
     HRESULT hr = E_FAIL;
@@ -325,17 +517,32 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
     if (pCallBack == nullptr)
         return E_POINTER;
 
+    if (!m_InUseRecords.empty())
+        return EnumInUseMFTRecord(pCallBack);
+
     ULONGLONG ullCurrentIndex = 0LL;
     // go through each extent of mft and search for the files
     ULONGLONG ullCurrentFRNIndex = 0LL;
 
     ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
 
+    auto readSize = ::CreateReadSize(*m_pVolReader);
+    auto readSizeGuard = Guard::CreateScopeGuard([&readSize]() { ::LogReadSize(readSize); });
+
+    // Page aligned buffer, large enough for the largest read, backed by large pages when available
     CBinaryBuffer localReadBuffer(true);
 
-    if (!localReadBuffer.CheckCount(ulBytesPerFRS * DEFAULT_FRS_PER_READ))
+    if (!localReadBuffer.ReserveLargePages(LargePages::PreferredSize(readSize.MaxSize())))
+        return E_OUTOFMEMORY;
+
+    if (!localReadBuffer.CheckCount(readSize.MaxSize()))
         return E_OUTOFMEMORY;
 
+    // $MFT extents are read sequentially, keep some reads in flight
+    const auto& readProfile = VolumeReadProfile::Instance();
+    m_pVolReader->EnableReadAhead(readProfile.QueueDepth(), readProfile.ChunkSize());
+    auto readAheadGuard = Guard::CreateScopeGuard([this]() { m_pVolReader->DisableReadAhead(); });
+
     ULONGLONG position = 0LL;
 
     for (auto& NRAE : m_MFT0Info.ExtentsVector)
@@ -347,12 +554,12 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
         ULONGLONG end = NRAE.DiskOffset + NRAE.DataSize;
         ULONGLONG extent_position = NRAE.DiskOffset;
 
-        ULONGLONG ullFRSCountInExtent = NRAE.DataSize / ulBytesPerFRS;
-        ULONGLONG ullFRSLeftToRead = ullFRSCountInExtent;
-
         while (extent_position < end)
         {
-            ULONGLONG ullFRSToRead = std::min<ULONGLONG>(ullFRSLeftToRead, DEFAULT_FRS_PER_READ);
+            const ULONGLONG ullFRSLeftToRead = (end - extent_position) / ulBytesPerFRS;
+            const ULONGLONG ullFRSToRead = std::min<ULONGLONG>(ullFRSLeftToRead, readSize.Size() / ulBytesPerFRS);
+            if (ullFRSToRead == 0)
+                break;
 
             LARGE_INTEGER liBytesToRead;
             liBytesToRead.QuadPart = ulBytesPerFRS * ullFRSToRead;
@@ -364,6 +571,7 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
                 return E_OUTOFMEMORY;
 
             ULONGLONG ullBytesRead = 0LL;
+            const auto start = std::chrono::steady_clock::now();
             if (FAILED(
                     hr = m_pVolReader->Read(
                         extent_position, localReadBuffer, ulBytesPerFRS * ullFRSToRead, ullBytesRead)))
@@ -375,6 +583,7 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
                     SystemError(hr));
                 return hr;
             }
+            readSize.Record(ullBytesRead, ::ElapsedSince(start));
 
             if (ullBytesRead % ulBytesPerFRS > 0)
             {
@@ -384,6 +593,9 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
                     ulBytesPerFRS * ullFRSToRead);
             }
 
+            const auto chunk = Trace::MFTChunkStart(ullCurrentFRNIndex, ullBytesRead / ulBytesPerFRS);
+            auto chunkGuard = Guard::CreateScopeGuard([&chunk]() { Trace::MFTChunkStop(chunk); });
+
             for (unsigned int i = 0; i < (ullBytesRead / ulBytesPerFRS); i++)
             {
                 if (ullCurrentIndex * ulBytesPerFRS != position + (i * ulBytesPerFRS))
@@ -411,6 +623,9 @@ HRESULT MFTOnline::EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack)
                 ullCurrentFRNIndex++;
                 ullCurrentIndex++;
             }
+            if (ullBytesRead < ulBytesPerFRS)
+                break;
+
             extent_position += ullBytesRead;
             position += ullBytesRead;
         }
@@ -448,44 +663,71 @@ HRESULT MFTOnline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUt
         return left.SegmentNumberLowPart < rigth.SegmentNumberLowPart;
     });
 
-    // go through each extent of mft and search for the files
-
     ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
 
+    // Volume offset of each requested segment, going through the extents of mft once
+    std::vector<ULONGLONG> offsets(frn.size(), ULLONG_MAX);
+    {
+        size_t frnIdx = 0;
+        ULONGLONG ullCurrentIndex = 0;
+
+        for (const auto& NRAE : m_MFT0Info.ExtentsVector)
+        {
+            if (frnIdx >= frn.size())
+                break;
+
+            if (NRAE.bZero)
+                continue;
+
+            const ULONGLONG ullEnd = ullCurrentIndex + NRAE.DataSize;
+
+            for (; frnIdx < frn.size(); frnIdx++)
+            {
+                ULARGE_INTEGER current;
+                current.HighPart = frn[frnIdx].SegmentNumberHighPart;
+                current.LowPart = frn[frnIdx].SegmentNumberLowPart;
+
+                const ULONGLONG ullFileOffset = current.QuadPart * ulBytesPerFRS;
+                if (ullFileOffset >= ullEnd)
+                    break;
+
+                if (ullFileOffset >= ullCurrentIndex)
+                    offsets[frnIdx] = NRAE.DiskOffset + (ullFileOffset - ullCurrentIndex);
+            }
+
+            ullCurrentIndex = ullEnd;
+        }
+    }
+
+    // Segments close to each other on the volume are read at once
+    const auto runs = MFTUtils::GetSegmentRuns(offsets, ulBytesPerFRS, FETCH_MAX_GAP, FETCH_MAX_RUN_LENGTH);
+
+    Log::Debug(L"Fetching {} records with {} reads", frn.size(), runs.size());
+
+    CBinaryBuffer runBuffer(true);
     CBinaryBuffer localReadBuffer(true);
 
     if (!localReadBuffer.CheckCount(ulBytesPerFRS))
         return E_OUTOFMEMORY;
 
-    UINT frnIdx = 0;
-    ULONGLONG ullCurrentIndex = 0;
-
-    for (const auto& NRAE : m_MFT0Info.ExtentsVector)
+    for (const auto& run : runs)
     {
-        ULONGLONG ullEnd = ullCurrentIndex + NRAE.DataSize;
+        if (!runBuffer.CheckCount(static_cast<size_t>(run.ullLength)))
+            return E_OUTOFMEMORY;
 
-        if (NRAE.bZero)
+        ULONGLONG ullBytesRead = 0LL;
+        if (FAILED(hr = m_pFetchReader->Read(run.ullOffset, runBuffer, run.ullLength, ullBytesRead)))
+        {
+            Log::Error(L"Failed to read {} bytes from at position {} [{}]", run.ullLength, run.ullOffset, SystemError(hr));
             continue;
+        }
 
-        ULARGE_INTEGER current;
-        current.HighPart = frn[frnIdx].SegmentNumberHighPart;
-        current.LowPart = frn[frnIdx].SegmentNumberLowPart;
-
-        while (ullCurrentIndex <= (current.QuadPart * ulBytesPerFRS) && (current.QuadPart * ulBytesPerFRS) < ullEnd)
+        for (size_t i = run.First; i < run.First + run.Count; i++)
         {
-            // this segment contains the first FRN
-            ULONGLONG ullVolumeOffset = NRAE.DiskOffset + ((current.QuadPart * ulBytesPerFRS) - ullCurrentIndex);
+            if (offsets[i] == ULLONG_MAX || offsets[i] - run.ullOffset + ulBytesPerFRS > ullBytesRead)
+                continue;
 
-            ULONGLONG ullBytesRead = 0LL;
-            if (FAILED(hr = m_pFetchReader->Read(ullVolumeOffset, localReadBuffer, ulBytesPerFRS, ullBytesRead)))
-            {
-                Log::Error(
-                    L"Failed to read {} bytes from at position {} [{}]",
-                    ullVolumeOffset,
-                    ulBytesPerFRS,
-                    SystemError(hr));
-                break;
-            }
+            CopyMemory(localReadBuffer.GetData(), runBuffer.GetData() + (offsets[i] - run.ullOffset), ulBytesPerFRS);
 
             PFILE_RECORD_SEGMENT_HEADER pHeader = (PFILE_RECORD_SEGMENT_HEADER)localReadBuffer.GetData();
 
@@ -498,11 +740,7 @@ HRESULT MFTOnline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUt
                     pHeader->MultiSectorHeader.Signature[1],
                     pHeader->MultiSectorHeader.Signature[2],
                     pHeader->MultiSectorHeader.Signature[3]);
-                frnIdx++;
-                if (frnIdx >= frn.size())
-                    break;
-                current.HighPart = frn[frnIdx].SegmentNumberHighPart;
-                current.LowPart = frn[frnIdx].SegmentNumberLowPart;
+                continue;
             }
 
             MFT_SEGMENT_REFERENCE read_record_frn = {0};
@@ -510,39 +748,34 @@ HRESULT MFTOnline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUt
             read_record_frn.SegmentNumberLowPart = pHeader->SegmentNumberLowPart;
             read_record_frn.SequenceNumber = pHeader->SequenceNumber;
 
-            if (NtfsSegmentNumber(&read_record_frn) != NtfsSegmentNumber(&frn[frnIdx]))
+            if (NtfsSegmentNumber(&read_record_frn) != NtfsSegmentNumber(&frn[i]))
             {
                 Log::Debug(
                     L"Skipping... {} does not match the expected {}",
                     NtfsSegmentNumber(&read_record_frn),
-                    NtfsSegmentNumber(&frn[frnIdx]));
-                frnIdx++;
-                if (frnIdx >= frn.size())
-                    break;
-                current.HighPart = frn[frnIdx].SegmentNumberHighPart;
-                current.LowPart = frn[frnIdx].SegmentNumberLowPart;
+                    NtfsSegmentNumber(&frn[i]));
                 continue;
             }
-            if (read_record_frn.SequenceNumber != frn[frnIdx].SequenceNumber)
+            if (read_record_frn.SequenceNumber != frn[i].SequenceNumber)
             {
                 Log::Debug(
                     L"Skipping... Sequence numbed {} does not match the expected {}",
                     read_record_frn.SequenceNumber,
-                    frn[frnIdx].SequenceNumber);
-                frnIdx++;
-                if (frnIdx >= frn.size())
-                    break;
-                current.HighPart = frn[frnIdx].SegmentNumberHighPart;
-                current.LowPart = frn[frnIdx].SegmentNumberLowPart;
+                    frn[i].SequenceNumber);
                 continue;
             }
 
-            if (FAILED(hr = pCallBack(current.QuadPart, localReadBuffer)))
+            ULARGE_INTEGER current;
+            current.HighPart = frn[i].SegmentNumberHighPart;
+            current.LowPart = frn[i].SegmentNumberLowPart;
+
+            MFTUtils::SafeMFTSegmentNumber ullRecordIndex = current.QuadPart;
+            if (FAILED(hr = pCallBack(ullRecordIndex, localReadBuffer)))
             {
                 if (hr == E_OUTOFMEMORY)
                 {
                     Log::Error("Add Record Callback failed, not enough memory to continue");
-                    break;
+                    return hr;
                 }
                 else if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
                 {
@@ -553,21 +786,17 @@ HRESULT MFTOnline::FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUt
                 Log::Error("Add Record Callback failed [{}]", SystemError(hr));
                 return hr;
             }
-            frnIdx++;
-            if (frnIdx >= frn.size())
-                break;
-            current.HighPart = frn[frnIdx].SegmentNumberHighPart;
-            current.LowPart = frn[frnIdx].SegmentNumberLowPart;
         }
-        // this segment must be skipped
-        ullCurrentIndex = ullEnd;
-        if (frnIdx >= frn.size())
-            break;
     }
-    if (frnIdx >= frn.size())
+
+    // Only the segments beyond the extents of mft are left in the request
+    size_t left = 0;
+    for (size_t i = 0; i < frn.size(); i++)
     {
-        frn.clear();
+        if (offsets[i] == ULLONG_MAX)
+            frn[left++] = frn[i];
     }
+    frn.resize(left);
 
     return S_OK;
 }
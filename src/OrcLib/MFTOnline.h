@@ -28,6 +28,8 @@ public:
 
     virtual ULONG64 GetMftOffset() { return m_MftOffset; }
 
+    virtual HRESULT SkipUnusedRecords();
+
     virtual HRESULT EnumMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack);
     virtual HRESULT FetchMFTRecord(std::vector<MFT_SEGMENT_REFERENCE>& frn, MFTUtils::EnumMFTRecordCall pCallBack);
     virtual ULONG GetMFTRecordCount() const;
@@ -49,8 +51,11 @@ private:
     HRESULT
     FetchMFTRecord(MFT_SEGMENT_REFERENCE& frn, MFTUtils::EnumMFTRecordCall pCallBack, bool& hasFoundRecord);
 
+    HRESULT EnumInUseMFTRecord(MFTUtils::EnumMFTRecordCall pCallBack);
+
     ULONG64 m_MftOffset;
     MFTUtils::NonResidentDataAttrInfo m_MFT0Info;
+    MFTUtils::InUseRecords m_InUseRecords;  // empty unless SkipUnusedRecords succeeded
 
     MFTUtils::SafeMFTSegmentNumber m_RootUSN;
 };
@@ -37,6 +37,13 @@ HRESULT MFTRecord::ParseRecord(
     if (m_pBaseFileRecord == nullptr && pBaseRecord != nullptr)
         m_pBaseFileRecord = pBaseRecord;
 
+    if (m_pBaseFileRecord != nullptr && m_pBaseFileRecord->IsParsed())
+    {
+        // child attributes are merged into the base record attribute list which must be built first
+        if (FAILED(hr = m_pBaseFileRecord->DecodeAttributes()))
+            return hr;
+    }
+
     if (m_pBaseFileRecord != nullptr && !m_pBaseFileRecord->IsParsed())
     {
         if (FAILED(
@@ -93,9 +100,159 @@ HRESULT MFTRecord::ParseRecord(
         return S_FALSE;
     }
 
+    m_dwRecordLength = dwRecordLen;
+
     PATTRIBUTE_RECORD_HEADER pFirstAttr = (PATTRIBUTE_RECORD_HEADER)((LPBYTE)pRecord + pRecord->FirstAttributeOffset);
     DWORD dwAllAttrLength = dwRecordLen - pRecord->FirstAttributeOffset;
 
+    if (m_bDeferAttributes && IsBaseRecord() && m_pBaseFileRecord == nullptr
+        && ParseAttributeHeaders(pFirstAttr, dwAllAttrLength))
+    {
+        m_bAttributesDeferred = true;
+        m_bParsed = true;
+        return S_OK;
+    }
+
+    if (FAILED(hr = ParseAttributes(VolReader, pFirstAttr, dwAllAttrLength)))
+        return hr;
+
+    m_bParsed = true;
+    return S_OK;
+}
+
+bool MFTRecord::ParseAttributeHeaders(PATTRIBUTE_RECORD_HEADER pFirstAttr, DWORD dwAllAttrLength)
+{
+    PSTANDARD_INFORMATION pStandardInformation = nullptr;
+    std::vector<PFILE_NAME> fileNames;
+    bool bIsDirectory = false;
+    bool bHasNamedDataAttr = false;
+    bool bHasExtendedAttr = false;
+    bool bHasReparsePoint = false;
+    bool bIsJunction = false;
+    bool bIsSymLink = false;
+    bool bIsOverlayFile = false;
+
+    auto isI30 = [](PATTRIBUTE_RECORD_HEADER pAttribute) {
+        return pAttribute->NameLength
+            && 0
+            == wcsncmp(
+                   (PWSTR)((LPBYTE)pAttribute + pAttribute->NameOffset),
+                   L"$I30",
+                   std::max<UCHAR>(pAttribute->NameLength, 4));
+    };
+
+    PATTRIBUTE_RECORD_HEADER pCurAttr = pFirstAttr;
+    DWORD dwAttrLeftToParse = dwAllAttrLength;
+
+    while (dwAttrLeftToParse >= sizeof(ATTRIBUTE_RECORD_HEADER))
+    {
+        switch (pCurAttr->TypeCode)
+        {
+            case $ATTRIBUTE_LIST:
+                // attributes spread over child records: the full parse links them
+                return false;
+            case $STANDARD_INFORMATION:
+                if (pStandardInformation != nullptr || pCurAttr->FormCode != RESIDENT_FORM)
+                    return false;  // let the full parse report it
+                pStandardInformation = (PSTANDARD_INFORMATION)((LPBYTE)pCurAttr + pCurAttr->Form.Resident.ValueOffset);
+                break;
+            case $FILE_NAME:
+                if (pCurAttr->FormCode != RESIDENT_FORM)
+                    return false;
+                fileNames.push_back((PFILE_NAME)((LPBYTE)pCurAttr + pCurAttr->Form.Resident.ValueOffset));
+                break;
+            case $DATA:
+                if (pCurAttr->NameLength > 0)
+                    bHasNamedDataAttr = true;
+                break;
+            case $INDEX_ROOT:
+            case $INDEX_ALLOCATION:
+                if (isI30(pCurAttr))
+                    bIsDirectory = true;
+                break;
+            case $REPARSE_POINT: {
+                bHasReparsePoint = true;
+
+                auto flags = ReparsePointAttribute::GetReparsePointType(pCurAttr);
+                if (ReparsePointAttribute::IsJunction(flags))
+                    bIsJunction = true;
+                else if (ReparsePointAttribute::IsSymbolicLink(flags))
+                    bIsSymLink = true;
+                else if (ReparsePointAttribute::IsWindowsOverlayFile(flags))
+                    bIsOverlayFile = true;
+            }
+            break;
+            case $EA:
+                bHasExtendedAttr = true;
+                break;
+            default:
+                break;
+        }
+
+        if (pCurAttr->TypeCode == $END)
+            break;
+
+        pCurAttr = (PATTRIBUTE_RECORD_HEADER)((LPBYTE)pCurAttr + pCurAttr->RecordLength);
+        if ((LPBYTE)pCurAttr > ((LPBYTE)pFirstAttr + dwAllAttrLength))
+            break;
+
+        if (pCurAttr->TypeCode == $END)
+            break;
+
+        if (pCurAttr->RecordLength == 0)
+            break;
+
+        dwAttrLeftToParse -= pCurAttr->RecordLength;
+    }
+
+    m_pStandardInformation = pStandardInformation;
+    m_FileNames = std::move(fileNames);
+    m_bIsDirectory = bIsDirectory;
+    m_bHasNamedDataAttr = bHasNamedDataAttr;
+    m_bHasExtendedAttr = bHasExtendedAttr;
+    m_bHasReparsePoint = bHasReparsePoint;
+    m_bIsJunction = bIsJunction;
+    m_bIsSymLink = bIsSymLink;
+    m_bIsOverlayFile = bIsOverlayFile;
+
+    if (m_pAttributeList == nullptr)
+        m_pAttributeList = make_shared<AttributeList>();
+
+    return true;
+}
+
+HRESULT MFTRecord::DecodeAttributes() const
+{
+    if (!m_bAttributesDeferred)
+        return S_OK;
+
+    // Logically const: builds the attribute objects the header pass did not
+    auto pThis = const_cast<MFTRecord*>(this);
+
+    PATTRIBUTE_RECORD_HEADER pFirstAttr =
+        (PATTRIBUTE_RECORD_HEADER)((LPBYTE)m_pRecord + m_pRecord->FirstAttributeOffset);
+
+    // No $ATTRIBUTE_LIST in deferred records: the volume reader is not needed
+    HRESULT hr = pThis->ParseAttributes({}, pFirstAttr, m_dwRecordLength - m_pRecord->FirstAttributeOffset);
+    pThis->m_bAttributesDeferred = false;
+
+    if (FAILED(hr))
+    {
+        Log::Debug(
+            L"Failed to decode attributes (frn: {:#x}) [{}]",
+            NtfsFullSegmentNumber(&m_FileReferenceNumber),
+            SystemError(hr));
+    }
+    return hr;
+}
+
+HRESULT MFTRecord::ParseAttributes(
+    const std::shared_ptr<VolumeReader>& VolReader,
+    PATTRIBUTE_RECORD_HEADER pFirstAttr,
+    DWORD dwAllAttrLength)
+{
+    HRESULT hr = E_FAIL;
+
     //
     // Go through each attribute
     //
@@ -221,7 +378,6 @@ HRESULT MFTRecord::ParseRecord(
         dwAttrLeftToParse -= pCurAttr->RecordLength;
     }
 
-    m_bParsed = true;
     return S_OK;
 }
 
@@ -270,6 +426,11 @@ HRESULT MFTRecord::ParseAttribute(
     {
         case $STANDARD_INFORMATION: {
             Log::Trace(L"Add $STANDARD_INFORMATION");
+            if (m_bAttributesDeferred)
+            {
+                pNewAttr = make_shared<MftRecordAttribute>(pAttribute, this);
+                break;
+            }
             if (m_pStandardInformation != NULL)
             {
                 Log::Error("Failed to parse $STANDARD_INFORMATION: more than one $StandardInformation attribute");
@@ -348,6 +509,11 @@ HRESULT MFTRecord::ParseAttribute(
                 Log::Error("Failed to parse $FILE_NAME, attribute must be resident");
                 return E_FAIL;
             }
+            if (m_bAttributesDeferred)
+            {
+                pNewAttr = make_shared<MftRecordAttribute>(pAttribute, this);
+                break;
+            }
             if (m_pBaseFileRecord != NULL)
             {
                 m_pBaseFileRecord->m_FileNames.push_back(
@@ -546,6 +712,8 @@ HRESULT MFTRecord::ParseAttribute(
 
 const std::shared_ptr<DataAttribute> MFTRecord::GetDataAttribute(LPCWSTR szAttrName) const
 {
+    DecodeAttributes();
+
     std::shared_ptr<DataAttribute> retval;
     auto cbName = wcslen(szAttrName);
     auto attr_it = std::find_if(
@@ -562,6 +730,8 @@ const std::shared_ptr<DataAttribute> MFTRecord::GetDataAttribute(LPCWSTR szAttrN
 
 const std::shared_ptr<IndexAllocationAttribute> MFTRecord::GetIndexAllocationAttribute(LPCWSTR szAttrName) const
 {
+    DecodeAttributes();
+
     std::shared_ptr<IndexAllocationAttribute> retval;
     auto cbName = wcslen(szAttrName);
     auto attr_it = std::find_if(
@@ -578,6 +748,8 @@ const std::shared_ptr<IndexAllocationAttribute> MFTRecord::GetIndexAllocationAtt
 }
 const std::shared_ptr<IndexRootAttribute> MFTRecord::GetIndexRootAttribute(LPCWSTR szAttrName) const
 {
+    DecodeAttributes();
+
     std::shared_ptr<IndexRootAttribute> retval;
     auto cbName = wcslen(szAttrName);
     auto attr_it = std::find_if(
@@ -595,6 +767,8 @@ const std::shared_ptr<IndexRootAttribute> MFTRecord::GetIndexRootAttribute(LPCWS
 
 const std::shared_ptr<BitmapAttribute> MFTRecord::GetBitmapAttribute(LPCWSTR szAttrName) const
 {
+    DecodeAttributes();
+
     std::shared_ptr<BitmapAttribute> retval;
     auto cbName = wcslen(szAttrName);
     auto attr_it = std::find_if(
@@ -617,6 +791,8 @@ HRESULT MFTRecord::GetIndexAttributes(
     std::shared_ptr<IndexAllocationAttribute>& pIndexAllocationAttr,
     std::shared_ptr<BitmapAttribute>& pBitmapAttr) const
 {
+    DecodeAttributes();
+
     HRESULT hr = E_FAIL;
 
     pIndexRootAttr = nullptr;
@@ -660,6 +836,8 @@ HRESULT MFTRecord::GetIndexAttributes(
 
 USHORT MFTRecord::GetAttributeIndex(const std::shared_ptr<MftRecordAttribute>& one_attr) const
 {
+    DecodeAttributes();
+
     const auto& attrs = m_pAttributeList->m_AttList;
 
     if (one_attr == nullptr)
@@ -690,6 +868,8 @@ USHORT MFTRecord::GetAttributeIndex(const std::shared_ptr<MftRecordAttribute>& o
 
 USHORT MFTRecord::GetFileNameIndex(const PFILE_NAME pFileName) const
 {
+    DecodeAttributes();
+
     const auto& attrs = m_pAttributeList->m_AttList;
 
     USHORT usInstanceIdx = 0L;
@@ -862,6 +1042,10 @@ HRESULT MFTRecord::ReadData(
 
     ULONGLONG ullBytesRead = 0ULL;
 
+    // Extents are appended one by one: allocate once for all of them
+    if (AllData.OwnsBuffer() && !AllData.Reserve(AllData.GetCount() + static_cast<size_t>(ullBytesToRead)))
+        return E_OUTOFMEMORY;
+
     hr = EnumData(
         VolReader,
         pAttr,
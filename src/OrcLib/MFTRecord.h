@@ -85,13 +85,21 @@ public:
     }
 
     const std::vector<PFILE_NAME>& GetFileNames() const { return m_FileNames; };
-    const std::vector<AttributeListEntry>& GetAttributeList() const { return m_pAttributeList->m_AttList; };
+    const std::vector<AttributeListEntry>& GetAttributeList() const
+    {
+        DecodeAttributes();
+        return m_pAttributeList->m_AttList;
+    };
 
     USHORT GetAttributeIndex(const std::shared_ptr<MftRecordAttribute>& attr) const;
     USHORT GetFileNameIndex(const PFILE_NAME pFileName) const;
     USHORT GetDataIndex(const std::shared_ptr<DataAttribute>& pDataAttr) const;
 
-    const std::vector<std::shared_ptr<DataAttribute>>& GetDataAttributes() const { return m_DataAttrList; };
+    const std::vector<std::shared_ptr<DataAttribute>>& GetDataAttributes() const
+    {
+        DecodeAttributes();
+        return m_DataAttrList;
+    };
     const std::shared_ptr<DataAttribute> GetDataAttribute(LPCWSTR szAttrName) const;
 
     const std::shared_ptr<IndexAllocationAttribute> GetIndexAllocationAttribute(LPCWSTR szAttrName) const;
@@ -129,6 +137,11 @@ public:
         CBinaryBuffer& Data,
         ULONGLONG* pullBytesRead);
 
+    // Records parsed with deferred attributes only hold $STANDARD_INFORMATION, the $FILE_NAME and the record flags until
+    // an accessor of the attributes builds them
+    bool HasDeferredAttributes() const { return m_bAttributesDeferred; }
+    HRESULT DecodeAttributes() const;
+
     HRESULT CleanCachedData();
     HRESULT CleanAttributeList();
 
@@ -146,6 +159,8 @@ public:
         m_bIsMultiSectorFixed = false;
         m_bHasNamedDataAttr = false;
         m_bHasExtendedAttr = false;
+        m_bDeferAttributes = false;
+        m_bAttributesDeferred = false;
         m_pBaseFileRecord = NULL;
     }
 
@@ -162,6 +177,10 @@ private:
     bool m_bIsSymLink = false;
     bool m_bIsJunction = false;
     bool m_bIsOverlayFile = false;
+    bool m_bDeferAttributes = false;
+    bool m_bAttributesDeferred = false;
+
+    DWORD m_dwRecordLength = 0L;
 
     FILE_REFERENCE m_FileReferenceNumber;
 
@@ -192,6 +211,14 @@ private:
         DWORD dwRecordLen,
         MFTRecord* pBaseRecord);
 
+    // Header pass of a base record: false if the record needs the full parse ($ATTRIBUTE_LIST, invalid attributes)
+    bool ParseAttributeHeaders(PATTRIBUTE_RECORD_HEADER pFirstAttr, DWORD dwAllAttrLength);
+
+    HRESULT ParseAttributes(
+        const std::shared_ptr<VolumeReader>& VolReader,
+        PATTRIBUTE_RECORD_HEADER pFirstAttr,
+        DWORD dwAllAttrLength);
+
     MFTRecord(const MFTRecord&) = delete;
     MFTRecord(const MFTRecord&&) noexcept = delete;
     MFTRecord& operator=(MFTRecord const&) = delete;
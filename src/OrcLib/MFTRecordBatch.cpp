@@ -0,0 +1,253 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTRecordBatch.h"
+
+#include "NtfsDataStructures.h"
+#include "SimdDispatch.h"
+
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_FRS_SIMD
+#endif
+
+using namespace Orc;
+
+namespace {
+
+using Status = MFTRecordBatch::Status;
+
+constexpr DWORD kFileSignature = 0x454C4946;  // 'FILE'
+
+// The update sequence array must fit in the first sector of the smallest sector size
+constexpr ULONG kMaxArrayEnd = 510;
+
+// Records are gathered by groups of 8, the offsets of their fields must fit in an int
+constexpr ULONG kMaxGatheredFRS = 64 * 1024;
+
+// Statuses of the records are computed on the stack by chunks of this number of records
+constexpr ULONG kChunk = 64;
+
+constexpr size_t kArrayOffset = offsetof(MULTI_SECTOR_HEADER, UpdateSequenceArrayOffset);
+constexpr size_t kFlagsOffset = offsetof(FILE_RECORD_SEGMENT_HEADER, Flags);
+
+template <typename T>
+T Load(const BYTE* pData)
+{
+    T value;
+    memcpy(&value, pData, sizeof(T));
+    return value;
+}
+
+bool IsValidGeometry(ULONG ulBytesPerFRS, ULONG ulBytesPerSector)
+{
+    return ulBytesPerSector >= sizeof(DWORD) && ulBytesPerFRS >= ulBytesPerSector
+        && ulBytesPerFRS >= sizeof(FILE_RECORD_SEGMENT_HEADER)
+        && (ulBytesPerFRS / ulBytesPerSector) * sizeof(WORD) <= kMaxArrayEnd;
+}
+
+// Same checks as MFTUtils::MultiSectorFixup
+Status ValidateOne(const BYTE* pFRS, ULONG ulBytesPerFRS, ULONG ulBytesPerSector)
+{
+    if (Load<DWORD>(pFRS) != kFileSignature)
+        return Status::NoSignature;
+
+    if (!IsValidGeometry(ulBytesPerFRS, ulBytesPerSector))
+        return Status::Corrupted;
+
+    const ULONG ulSectors = ulBytesPerFRS / ulBytesPerSector;
+    const auto wArrayOffset = Load<WORD>(pFRS + kArrayOffset);
+    if (wArrayOffset + ulSectors * sizeof(WORD) > kMaxArrayEnd)
+        return Status::Corrupted;
+
+    const auto wSequenceNumber = Load<WORD>(pFRS + wArrayOffset);
+    for (ULONG i = 0; i < ulSectors; i++)
+    {
+        if (Load<WORD>(pFRS + (i + 1) * ulBytesPerSector - sizeof(WORD)) != wSequenceNumber)
+            return Status::Corrupted;
+    }
+
+    return (Load<WORD>(pFRS + kFlagsOffset) & FILE_RECORD_SEGMENT_IN_USE) ? Status::InUse : Status::Free;
+}
+
+using ValidateFn = void (*)(const BYTE* pRecords, ULONG ulCount, ULONG ulBytesPerFRS, ULONG ulBytesPerSector, Status*);
+
+void ValidateScalar(const BYTE* pRecords, ULONG ulCount, ULONG ulBytesPerFRS, ULONG ulBytesPerSector, Status* pStatus)
+{
+    for (ULONG i = 0; i < ulCount; i++)
+        pStatus[i] = ValidateOne(pRecords + static_cast<size_t>(i) * ulBytesPerFRS, ulBytesPerFRS, ulBytesPerSector);
+}
+
+#ifdef ORC_FRS_SIMD
+
+void ValidateAVX2(const BYTE* pRecords, ULONG ulCount, ULONG ulBytesPerFRS, ULONG ulBytesPerSector, Status* pStatus)
+{
+    ULONG i = 0;
+
+    if (IsValidGeometry(ulBytesPerFRS, ulBytesPerSector) && ulBytesPerFRS <= kMaxGatheredFRS)
+    {
+        const ULONG ulSectors = ulBytesPerFRS / ulBytesPerSector;
+
+        // Lane j reads the fields of the record j of the group
+        const auto lanes = _mm256_mullo_epi32(
+            _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(ulBytesPerFRS)));
+        const auto signature = _mm256_set1_epi32(static_cast<int>(kFileSignature));
+        const auto arrayOffset = _mm256_set1_epi32(static_cast<int>(kArrayOffset));
+        const auto flagsDword = _mm256_set1_epi32(static_cast<int>(kFlagsOffset - sizeof(WORD)));
+        const auto lowWord = _mm256_set1_epi32(0xFFFF);
+        const auto arrayLimit = _mm256_set1_epi32(static_cast<int>(kMaxArrayEnd - ulSectors * sizeof(WORD) + 1));
+        const auto inUseFlag = _mm256_set1_epi32(FILE_RECORD_SEGMENT_IN_USE);
+
+        for (; i + 8 <= ulCount; i += 8)
+        {
+            const auto base = reinterpret_cast<const int*>(pRecords + static_cast<size_t>(i) * ulBytesPerFRS);
+
+            const auto isFile = _mm256_cmpeq_epi32(_mm256_i32gather_epi32(base, lanes, 1), signature);
+            if (_mm256_testz_si256(isFile, isFile))
+            {
+                std::fill_n(pStatus + i, 8, Status::NoSignature);
+                continue;
+            }
+
+            const auto arrayOffsets =
+                _mm256_and_si256(_mm256_i32gather_epi32(base, _mm256_add_epi32(lanes, arrayOffset), 1), lowWord);
+            const auto inBounds = _mm256_and_si256(isFile, _mm256_cmpgt_epi32(arrayLimit, arrayOffsets));
+
+            // Out of bounds offsets are masked out of the gather: they could point past the batch
+            const auto sequenceNumbers = _mm256_and_si256(
+                _mm256_mask_i32gather_epi32(
+                    _mm256_setzero_si256(), base, _mm256_add_epi32(lanes, arrayOffsets), inBounds, 1),
+                lowWord);
+
+            auto matching = inBounds;
+            for (ULONG j = 0; j < ulSectors; j++)
+            {
+                // The last word of the sector is the high word of its last dword
+                const auto sectorEnd = _mm256_set1_epi32(static_cast<int>((j + 1) * ulBytesPerSector - sizeof(DWORD)));
+                const auto tails =
+                    _mm256_srli_epi32(_mm256_i32gather_epi32(base, _mm256_add_epi32(lanes, sectorEnd), 1), 16);
+                matching = _mm256_and_si256(matching, _mm256_cmpeq_epi32(tails, sequenceNumbers));
+            }
+
+            // Flags is the high word of the dword before it
+            const auto flags =
+                _mm256_srli_epi32(_mm256_i32gather_epi32(base, _mm256_add_epi32(lanes, flagsDword), 1), 16);
+            const auto inUse = _mm256_cmpeq_epi32(_mm256_and_si256(flags, inUseFlag), inUseFlag);
+
+            const auto isFileMask = _mm256_movemask_ps(_mm256_castsi256_ps(isFile));
+            const auto matchingMask = _mm256_movemask_ps(_mm256_castsi256_ps(matching));
+            const auto inUseMask = _mm256_movemask_ps(_mm256_castsi256_ps(inUse));
+
+            for (ULONG j = 0; j < 8; j++)
+            {
+                if (!(isFileMask & (1 << j)))
+                    pStatus[i + j] = Status::NoSignature;
+                else if (!(matchingMask & (1 << j)))
+                    pStatus[i + j] = Status::Corrupted;
+                else
+                    pStatus[i + j] = (inUseMask & (1 << j)) ? Status::InUse : Status::Free;
+            }
+        }
+    }
+
+    ValidateScalar(
+        pRecords + static_cast<size_t>(i) * ulBytesPerFRS, ulCount - i, ulBytesPerFRS, ulBytesPerSector, pStatus + i);
+}
+
+#endif  // ORC_FRS_SIMD
+
+ValidateFn Kernel()
+{
+    static const SimdDispatch::Kernel<ValidateFn> kernel(
+        L"mft_record_batch",
+        {
+#ifdef ORC_FRS_SIMD
+            {SimdDispatch::Level::AVX2, ValidateAVX2},
+#endif
+            {SimdDispatch::Level::Scalar, ValidateScalar}});
+
+    return kernel.Get();
+}
+
+// Record validated by ValidateOne: the update sequence array is in bounds and matches
+void ApplyFixup(BYTE* pFRS, ULONG ulBytesPerFRS, ULONG ulBytesPerSector)
+{
+    const ULONG ulSectors = ulBytesPerFRS / ulBytesPerSector;
+    const BYTE* pArray = pFRS + Load<WORD>(pFRS + kArrayOffset) + sizeof(WORD);
+
+    for (ULONG i = 0; i < ulSectors; i++)
+        memcpy(pFRS + (i + 1) * ulBytesPerSector - sizeof(WORD), pArray + i * sizeof(WORD), sizeof(WORD));
+}
+
+}  // namespace
+
+void MFTRecordBatch::Validate(
+    const BYTE* pRecords,
+    ULONG ulCount,
+    ULONG ulBytesPerFRS,
+    ULONG ulBytesPerSector,
+    std::vector<Status>& status)
+{
+    status.resize(ulCount);
+    if (ulCount > 0)
+        Kernel()(pRecords, ulCount, ulBytesPerFRS, ulBytesPerSector, status.data());
+}
+
+void MFTRecordBatch::Fixup(
+    BYTE* pRecords,
+    ULONG ulCount,
+    ULONG ulBytesPerFRS,
+    ULONG ulBytesPerSector,
+    bool bKeepFree,
+    std::vector<Record>& records,
+    Statistics& statistics)
+{
+    const auto validate = Kernel();
+
+    records.clear();
+
+    Status status[kChunk];
+    for (ULONG ulFirst = 0; ulFirst < ulCount; ulFirst += kChunk)
+    {
+        const auto ulChunk = std::min(kChunk, ulCount - ulFirst);
+        validate(
+            pRecords + static_cast<size_t>(ulFirst) * ulBytesPerFRS, ulChunk, ulBytesPerFRS, ulBytesPerSector, status);
+
+        for (ULONG i = 0; i < ulChunk; i++)
+        {
+            const auto ulIndex = ulFirst + i;
+            const auto pFRS = pRecords + static_cast<size_t>(ulIndex) * ulBytesPerFRS;
+
+            switch (status[i])
+            {
+                case Status::NoSignature:
+                    statistics.NoSignature++;
+                    break;
+                case Status::Corrupted:
+                    statistics.Corrupted++;
+                    records.push_back({ulIndex, false});
+                    break;
+                case Status::Free:
+                    statistics.Free++;
+                    if (!bKeepFree)
+                        break;
+                    ApplyFixup(pFRS, ulBytesPerFRS, ulBytesPerSector);
+                    records.push_back({ulIndex, true});
+                    break;
+                case Status::InUse:
+                    statistics.InUse++;
+                    ApplyFixup(pFRS, ulBytesPerFRS, ulBytesPerSector);
+                    records.push_back({ulIndex, true});
+                    break;
+            }
+        }
+    }
+}
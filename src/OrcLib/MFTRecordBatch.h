@@ -0,0 +1,73 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// MFTRecordBatch: validates and fixes up in place the file record segments of a contiguous buffer (a batch of records
+// read from the MFT) before any of them is parsed.
+//
+// Records are checked 8 at a time (AVX2 gathers): "FILE" signature, update sequence array in the first sector, update
+// sequence number at the end of each sector and in use flag. Only the records passing the checks are fixed up, and
+// only the ones worth parsing are listed: empty slots and records without signature are dropped, free records are kept
+// on demand (resurrection). Records whose fixup fails are listed unfixed for the parser to report them.
+//
+class MFTRecordBatch
+{
+public:
+    enum class Status : UCHAR
+    {
+        NoSignature,  // not a file record segment ('BAAD', zeroed slot)
+        Corrupted,  // update sequence array out of bounds or not matching
+        Free,  // fixed up, not in use
+        InUse  // fixed up
+    };
+
+    struct Record
+    {
+        ULONG Index;  // in the batch
+        bool bFixed;
+    };
+
+    struct Statistics
+    {
+        ULONGLONG NoSignature = 0LL;
+        ULONGLONG Corrupted = 0LL;
+        ULONGLONG Free = 0LL;
+        ULONGLONG InUse = 0LL;
+    };
+
+    // Status of the records as they are, nothing is modified: 'status' gets one entry per record
+    static void Validate(
+        const BYTE* pRecords,
+        ULONG ulCount,
+        ULONG ulBytesPerFRS,
+        ULONG ulBytesPerSector,
+        std::vector<Status>& status);
+
+    // Validate then fix up the valid records of the batch: 'records' gets the ones to parse, in order
+    static void Fixup(
+        BYTE* pRecords,
+        ULONG ulCount,
+        ULONG ulBytesPerFRS,
+        ULONG ulBytesPerSector,
+        bool bKeepFree,
+        std::vector<Record>& records,
+        Statistics& statistics);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -18,6 +18,7 @@
 
 #include "MountedVolumeReader.h"
 #include "SnapshotVolumeReader.h"
+#include "ShadowCopyVolumeReader.h"
 
 #include "Buffer.h"
 
@@ -31,7 +32,7 @@ typedef NTSTATUS(__stdcall* pvfNtOpenFile)(PHANDLE, ACCESS_MASK, POBJECT_ATTRIBU
 typedef NTSTATUS(__stdcall* pvfNtQueryInformationFile)(HANDLE, PIO_STATUS_BLOCK, PVOID, ULONG, FILE_INFORMATION_CLASS);
 
 MFTRecordFileInfo::MFTRecordFileInfo(
-    std::wstring strComputerName,
+    std::wstring_view strComputerName,
     const std::shared_ptr<VolumeReader>& pVolReader,
     Intentions dwDefaultIntentions,
     const std::vector<Filter>& filters,
@@ -39,9 +40,10 @@ MFTRecordFileInfo::MFTRecordFileInfo(
     MFTRecord* pRecord,
     const PFILE_NAME pFileName,
     const std::shared_ptr<DataAttribute>& pDataAttr,
-    Authenticode& verifytrust)
+    Authenticode& verifytrust,
+    SecurityDescriptorTable* pSecurityDescriptors)
     : NtfsFileInfo(
-        std::move(strComputerName),
+        strComputerName,
         pVolReader,
         dwDefaultIntentions,
         filters,
@@ -52,6 +54,7 @@ MFTRecordFileInfo::MFTRecordFileInfo(
     m_pMFTRecord = pRecord;
     m_pFileName = pFileName;
     m_pDataAttr = pDataAttr;
+    m_pSecurityDescriptors = pSecurityDescriptors;
 }
 
 HRESULT MFTRecordFileInfo::Open()
@@ -577,6 +580,42 @@ HRESULT MFTRecordFileInfo::WriteSnapshotID(ITableOutput& output)
         return output.WriteGUID(GUID_NULL);
 }
 
+std::optional<HashCache::Key> MFTRecordFileInfo::GetHashCacheKey() const
+{
+    if (m_pMFTRecord == nullptr || m_pDataAttr == nullptr || m_pMFTRecord->GetStandardInformation() == nullptr)
+        return std::nullopt;
+
+    // Deleted records can be reused while their data is read
+    if (!m_pMFTRecord->IsRecordInUse())
+        return std::nullopt;
+
+    // Snapshots share the volume serial number: only streams still identical to the live volume share its entries
+    if (std::dynamic_pointer_cast<SnapshotVolumeReader>(m_pVolReader))
+    {
+        const auto pShadowReader = std::dynamic_pointer_cast<ShadowCopyVolumeReader>(m_pVolReader);
+        if (pShadowReader == nullptr || !m_pDataAttr->IsNonResident())
+            return std::nullopt;
+
+        const auto pNonResidentInfo = m_pDataAttr->GetNonResidentInformation(m_pVolReader);
+        if (pNonResidentInfo == nullptr || !pShadowReader->IsUnchanged(pNonResidentInfo->ExtentsVector))
+            return std::nullopt;
+    }
+
+    const auto pHeader = m_pDataAttr->Header();
+
+    HashCache::Key key;
+    key.VolumeSerialNumber = m_pVolReader->VolumeSerialNumber();
+    key.FRN = m_pMFTRecord->GetSafeMFTSegmentNumber();
+    key.DataInstance = pHeader->Instance;
+    key.DataSize = pHeader->FormCode == RESIDENT_FORM ? pHeader->Form.Resident.ValueLength
+                                                      : pHeader->Form.Nonresident.FileSize;
+
+    const auto& lastModification = m_pMFTRecord->GetStandardInformation()->LastModificationTime;
+    key.LastModificationTime =
+        (static_cast<LONGLONG>(lastModification.dwHighDateTime) << 32) | lastModification.dwLowDateTime;
+    return key;
+}
+
 HRESULT MFTRecordFileInfo::WriteRecordInUse(ITableOutput& output)
 {
     return output.WriteBool(m_pMFTRecord->m_pRecord->Flags & FILE_RECORD_SEGMENT_IN_USE);
@@ -658,6 +697,32 @@ HRESULT MFTRecordFileInfo::WriteOwnerId(ITableOutput& output)
     return output.WriteInteger(m_pMFTRecord->m_pStandardInformation->OwnerId);
 }
 
+HRESULT MFTRecordFileInfo::WriteOwnerSid(ITableOutput& output)
+{
+    if (m_pSecurityDescriptors == nullptr || !m_pSecurityDescriptors->IsLoaded())
+        return FileInfo::WriteOwnerSid(output);
+
+    if (m_pMFTRecord == NULL)
+    {
+        output.AbandonColumn();
+        return E_POINTER;
+    }
+    if (m_pMFTRecord->m_pStandardInformation == NULL)
+    {
+        output.AbandonColumn();
+        return E_POINTER;
+    }
+
+    const auto pOwnerSid = m_pSecurityDescriptors->OwnerSid(m_pMFTRecord->m_pStandardInformation->SecurityId);
+    if (pOwnerSid == nullptr)
+    {
+        output.AbandonColumn();
+        return HRESULT_FROM_WIN32(ERROR_NOT_FOUND);
+    }
+
+    return output.WriteString(*pOwnerSid);
+}
+
 HRESULT MFTRecordFileInfo::WriteExtendedAttributes(ITableOutput& output)
 {
     HRESULT hr = E_FAIL;
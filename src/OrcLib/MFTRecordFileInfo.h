@@ -14,6 +14,7 @@
 
 #include "MftRecordAttribute.h"
 #include "MftRecord.h"
+#include "SecurityDescriptorTable.h"
 
 #pragma managed(push, off)
 
@@ -47,6 +48,7 @@ public:
     virtual HRESULT WriteLastAccessDate(ITableOutput& output);
 
     virtual HRESULT WriteOwnerId(ITableOutput& output);
+    virtual HRESULT WriteOwnerSid(ITableOutput& output);
 
     virtual HRESULT WriteUSN(ITableOutput& output);
     virtual HRESULT WriteFRN(ITableOutput& output);
@@ -78,7 +80,7 @@ public:
     virtual HRESULT WriteSnapshotID(ITableOutput& output);
 
     MFTRecordFileInfo(
-        std::wstring strComputerName,
+        std::wstring_view strComputerName,
         const std::shared_ptr<VolumeReader>& pVolReader,
         Intentions dwDefaultIntentions,
         const std::vector<Filter>& filters,
@@ -86,7 +88,8 @@ public:
         MFTRecord* pRecord,
         const PFILE_NAME pFileName,
         const std::shared_ptr<DataAttribute>& pDataAttr,
-        Authenticode& verifytrust);
+        Authenticode& verifytrust,
+        SecurityDescriptorTable* pSecurityDescriptors = nullptr);
     virtual ~MFTRecordFileInfo(void);
 
     const MFTRecord* MftRecord() const { return m_pMFTRecord; }
@@ -95,9 +98,12 @@ private:
     MFTRecord* m_pMFTRecord = nullptr;
     PFILE_NAME m_pFileName = nullptr;
     std::shared_ptr<DataAttribute> m_pDataAttr;
+    SecurityDescriptorTable* m_pSecurityDescriptors = nullptr;
 
     virtual HRESULT Open();
 
+    virtual std::optional<HashCache::Key> GetHashCacheKey() const;
+
     virtual ULONGLONG GetFileReferenceNumber()
     {
         if (m_pMFTRecord == nullptr)
@@ -0,0 +1,266 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "MFTUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <map>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Associative container indexed by MFT segment number. Segment numbers are mostly dense and bounded by the MFT
+// record count: values are stored in pages of a directly indexed array allocated on first use, so a lookup is an
+// index computation instead of a hash and a node traversal. Segment numbers too large to be genuine (corrupted
+// headers or references) are kept in a small ordered overflow map. Iteration is done by increasing segment number.
+//
+// The interface mimics the subset of std::unordered_map used by MFTWalker: iterators dereference to a proxy
+// exposing 'first' (the segment number) and 'second' (a reference to the value). PageBits should be lowered for
+// sparse tables (e.g. directories only) to limit the memory used by partially filled pages.
+template <typename T, size_t PageBits = 12>
+class MFTSegmentTable
+{
+public:
+    using key_type = MFTUtils::SafeMFTSegmentNumber;
+    using mapped_type = T;
+
+    static constexpr size_t kPageBits = PageBits;
+    static constexpr size_t kPageSize = 1 << kPageBits;
+    static constexpr key_type kMaxDirectKey = 1LLU << 32;
+
+private:
+    struct Page
+    {
+        Page()
+            : Values()
+        {
+        }
+
+        std::array<T, kPageSize> Values;
+        std::bitset<kPageSize> Present;
+    };
+
+    using Overflow = std::map<key_type, T>;
+
+public:
+    template <bool IsConst>
+    class Iterator
+    {
+        friend class MFTSegmentTable;
+
+        using Table = std::conditional_t<IsConst, const MFTSegmentTable, MFTSegmentTable>;
+        using OverflowIterator =
+            std::conditional_t<IsConst, typename Overflow::const_iterator, typename Overflow::iterator>;
+
+    public:
+        struct Entry
+        {
+            const key_type first;
+            std::conditional_t<IsConst, const T&, T&> second;
+        };
+
+        struct pointer
+        {
+            Entry entry;
+            Entry* operator->() { return &entry; }
+        };
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Entry;
+        using difference_type = std::ptrdiff_t;
+        using reference = Entry;
+
+        Iterator() = default;
+
+        Entry operator*() const
+        {
+            if (m_bOverflow)
+                return Entry {m_Overflow->first, m_Overflow->second};
+            return Entry {
+                m_Key,
+                m_pTable->m_Pages[static_cast<size_t>(m_Key >> kPageBits)]
+                    ->Values[static_cast<size_t>(m_Key & (kPageSize - 1))]};
+        }
+
+        pointer operator->() const { return pointer {**this}; }
+
+        Iterator& operator++()
+        {
+            if (m_bOverflow)
+                ++m_Overflow;
+            else
+                *this = m_pTable->template NextFrom<IsConst>(m_Key + 1);
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            auto retval = *this;
+            ++(*this);
+            return retval;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            if (m_bOverflow != other.m_bOverflow)
+                return false;
+            if (m_bOverflow)
+                return m_Overflow == other.m_Overflow;
+            return m_Key == other.m_Key;
+        }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        Iterator(Table* pTable, key_type key)
+            : m_pTable(pTable)
+            , m_Key(key)
+        {
+        }
+
+        Iterator(Table* pTable, OverflowIterator it)
+            : m_pTable(pTable)
+            , m_bOverflow(true)
+            , m_Overflow(it)
+        {
+        }
+
+        Table* m_pTable = nullptr;
+        key_type m_Key = 0LL;
+        bool m_bOverflow = false;
+        OverflowIterator m_Overflow;
+    };
+
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    MFTSegmentTable() = default;
+    MFTSegmentTable(const MFTSegmentTable&) = delete;
+    MFTSegmentTable& operator=(const MFTSegmentTable&) = delete;
+
+    // Size the page directory for segment numbers up to ullRecordCount (pages are still allocated on demand)
+    void reserve(key_type ullRecordCount)
+    {
+        const auto pages = static_cast<size_t>(std::min(ullRecordCount, kMaxDirectKey) >> kPageBits) + 1;
+        if (m_Pages.size() < pages)
+            m_Pages.resize(pages);
+    }
+
+    size_t size() const { return m_Count; }
+    bool empty() const { return m_Count == 0; }
+
+    iterator begin() { return NextFrom<false>(0LL); }
+    iterator end() { return iterator(this, m_Overflow.end()); }
+    const_iterator begin() const { return NextFrom<true>(0LL); }
+    const_iterator end() const { return const_iterator(this, m_Overflow.cend()); }
+
+    iterator find(key_type key)
+    {
+        if (key >= kMaxDirectKey)
+            return iterator(this, m_Overflow.find(key));
+
+        return Contains(key) ? iterator(this, key) : end();
+    }
+
+    const_iterator find(key_type key) const
+    {
+        if (key >= kMaxDirectKey)
+            return const_iterator(this, m_Overflow.find(key));
+
+        return Contains(key) ? const_iterator(this, key) : end();
+    }
+
+    std::pair<iterator, bool> insert(std::pair<key_type, T>&& value)
+    {
+        if (auto it = find(value.first); it != end())
+            return {it, false};
+
+        if (value.first >= kMaxDirectKey)
+        {
+            m_Count++;
+            return {iterator(this, m_Overflow.emplace(value.first, std::move(value.second)).first), true};
+        }
+
+        auto& page = GetPage(value.first);
+        const auto slot = static_cast<size_t>(value.first & (kPageSize - 1));
+        page.Values[slot] = std::move(value.second);
+        page.Present.set(slot);
+        m_Count++;
+        return {iterator(this, value.first), true};
+    }
+
+    T& operator[](key_type key)
+    {
+        if (auto it = find(key); it != end())
+            return it->second;
+
+        return insert({key, T()}).first->second;
+    }
+
+    void clear()
+    {
+        m_Pages.clear();
+        m_Overflow.clear();
+        m_Count = 0;
+    }
+
+private:
+    bool Contains(key_type key) const
+    {
+        const auto page = static_cast<size_t>(key >> kPageBits);
+        return page < m_Pages.size() && m_Pages[page] != nullptr && m_Pages[page]->Present[key & (kPageSize - 1)];
+    }
+
+    Page& GetPage(key_type key)
+    {
+        const auto page = static_cast<size_t>(key >> kPageBits);
+        if (page >= m_Pages.size())
+            m_Pages.resize(page + 1);
+        if (m_Pages[page] == nullptr)
+            m_Pages[page] = std::make_unique<Page>();
+        return *m_Pages[page];
+    }
+
+    template <bool IsConst>
+    auto NextFrom(key_type key) const
+    {
+        using Table = std::conditional_t<IsConst, const MFTSegmentTable, MFTSegmentTable>;
+        const auto pTable = const_cast<Table*>(this);
+
+        for (auto page = static_cast<size_t>(key >> kPageBits); page < m_Pages.size(); page++)
+        {
+            if (m_Pages[page] == nullptr || m_Pages[page]->Present.none())
+                continue;
+
+            const auto& present = m_Pages[page]->Present;
+            for (auto slot = (page == (key >> kPageBits)) ? static_cast<size_t>(key & (kPageSize - 1)) : 0;
+                 slot < kPageSize;
+                 slot++)
+            {
+                if (present[slot])
+                    return Iterator<IsConst>(pTable, (static_cast<key_type>(page) << kPageBits) | slot);
+            }
+        }
+
+        return Iterator<IsConst>(pTable, pTable->m_Overflow.begin());
+    }
+
+    std::vector<std::unique_ptr<Page>> m_Pages;
+    Overflow m_Overflow;
+    size_t m_Count = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -11,6 +11,7 @@
 #include "MFTUtils.h"
 
 #include "VolumeReader.h"
+#include "CaseInsensitive.h"
 
 #include "Log/Log.h"
 
@@ -322,6 +323,98 @@ HRESULT MFTUtils::GetDataSegmentsToRead(
     return S_OK;
 }
 
+bool MFTUtils::IsRecordInUse(const InUseRecords& inUse, ULONGLONG ullRecord)
+{
+    return ullRecord >= inUse.size() || inUse.test(static_cast<size_t>(ullRecord));
+}
+
+MFTUtils::RecordSpan MFTUtils::GetInUseRecordSpan(
+    const InUseRecords& inUse,
+    ULONGLONG ullFirst,
+    ULONGLONG ullEnd,
+    ULONGLONG ullMaxRecords,
+    ULONGLONG ullMinSkippedRecords)
+{
+    auto ullStart = ullFirst;
+    if (!IsRecordInUse(inUse, ullStart))
+    {
+        const auto next = inUse.find_next(static_cast<size_t>(ullStart));
+        ullStart = next == InUseRecords::npos ? inUse.size() : next;
+    }
+
+    if (ullStart >= ullEnd || ullMaxRecords == 0)
+        return {ullEnd, 0LL};
+
+    auto ullLast = ullStart;
+    const auto ullLimit = std::min(ullEnd, ullStart + ullMaxRecords);
+    for (auto ullRecord = ullStart + 1; ullRecord < ullLimit; ullRecord++)
+    {
+        if (IsRecordInUse(inUse, ullRecord))
+            ullLast = ullRecord;
+        else if (ullRecord - ullLast >= ullMinSkippedRecords)
+            break;
+    }
+
+    return {ullStart, ullLast - ullStart + 1};
+}
+
+int MFTUtils::CollateFileNames(std::wstring_view lhs, std::wstring_view rhs)
+{
+    const auto length = std::min(lhs.size(), rhs.size());
+    for (size_t i = 0; i < length; i++)
+    {
+        const auto left = foldCaseInsensitive(lhs[i]);
+        const auto right = foldCaseInsensitive(rhs[i]);
+        if (left != right)
+            return left < right ? -1 : 1;
+    }
+
+    if (lhs.size() == rhs.size())
+        return 0;
+    return lhs.size() < rhs.size() ? -1 : 1;
+}
+
+std::vector<MFTUtils::SegmentRun> MFTUtils::GetSegmentRuns(
+    const std::vector<ULONGLONG>& offsets,
+    ULONG ulBytesPerFRS,
+    ULONGLONG ullMaxGap,
+    ULONGLONG ullMaxRunLength)
+{
+    std::vector<SegmentRun> runs;
+
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        const auto ullOffset = offsets[i];
+        if (ullOffset == ULLONG_MAX)
+            continue;
+
+        if (!runs.empty())
+        {
+            auto& run = runs.back();
+            const auto ullRunEnd = run.ullOffset + run.ullLength;
+
+            // Same segment requested twice: it is already in the run
+            if (ullOffset >= run.ullOffset && ullOffset + ulBytesPerFRS <= ullRunEnd)
+            {
+                run.Count = i - run.First + 1;
+                continue;
+            }
+
+            if (ullOffset >= ullRunEnd && ullOffset - ullRunEnd <= ullMaxGap
+                && ullOffset + ulBytesPerFRS - run.ullOffset <= ullMaxRunLength)
+            {
+                run.ullLength = ullOffset + ulBytesPerFRS - run.ullOffset;
+                run.Count = i - run.First + 1;
+                continue;
+            }
+        }
+
+        runs.push_back({ullOffset, ulBytesPerFRS, i, 1});
+    }
+
+    return runs;
+}
+
 HRESULT MFTUtils::MultiSectorFixup(PFILE_RECORD_SEGMENT_HEADER pFRS, const std::shared_ptr<VolumeReader>& pVolReader)
 {
     HRESULT hr = E_FAIL;
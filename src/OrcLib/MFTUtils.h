@@ -9,6 +9,9 @@
 
 #include <vector>
 #include <functional>
+#include <string_view>
+
+#include <boost/dynamic_bitset.hpp>
 
 #include "OrcLib.h"
 
@@ -91,6 +94,53 @@ public:
 
     typedef std::function<HRESULT(SafeMFTSegmentNumber& ulRecordIndex, CBinaryBuffer& Data)> EnumMFTRecordCall;
 
+    // Single read covering 'Count' requested segments, starting with the request at index 'First'
+    class SegmentRun
+    {
+    public:
+        ULONGLONG ullOffset;
+        ULONGLONG ullLength;
+        size_t First;
+        size_t Count;
+    };
+
+    // Groups requested segments, by order of request, into runs of at most ullMaxRunLength bytes: a segment joins the
+    // current run when it follows it on disk within ullMaxGap bytes. Segments with an offset of ULLONG_MAX are not read,
+    // consumers skip them between First and First + Count.
+    static std::vector<SegmentRun> GetSegmentRuns(
+        const std::vector<ULONGLONG>& offsets,
+        ULONG ulBytesPerFRS,
+        ULONGLONG ullMaxGap,
+        ULONGLONG ullMaxRunLength);
+
+    // Records of $MFT in use according to $MFT:$BITMAP, records beyond the end of the bitmap are considered in use
+    using InUseRecords = boost::dynamic_bitset<size_t>;
+
+    // Records [First, First + Count) to read in a single pass
+    class RecordSpan
+    {
+    public:
+        ULONGLONG First;
+        ULONGLONG Count;
+    };
+
+    static bool IsRecordInUse(const InUseRecords& inUse, ULONGLONG ullRecord);
+
+    // Next span of records in [ullFirst, ullEnd) to read: it starts at the first record in use, spans at most
+    // ullMaxRecords records and ends at the last record in use before a run of at least ullMinSkippedRecords unused
+    // records. Count is 0 when no record in use is left.
+    static RecordSpan GetInUseRecordSpan(
+        const InUseRecords& inUse,
+        ULONGLONG ullFirst,
+        ULONGLONG ullEnd,
+        ULONGLONG ullMaxRecords,
+        ULONGLONG ullMinSkippedRecords);
+
+    // Order of the names in a $I30 index (COLLATION_FILE_NAME): code units are compared once upper cased, then the
+    // shorter name comes first. Returns a negative value, zero or a positive value as lhs is before, equal to or after
+    // rhs.
+    static int CollateFileNames(std::wstring_view lhs, std::wstring_view rhs);
+
     static HRESULT GetAttributeNRExtents(
         PATTRIBUTE_RECORD_HEADER pRecord,
         NonResidentDataAttrInfo& FSRAttribInfo,
@@ -0,0 +1,310 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTWalkCheckpoint.h"
+
+#include "FileStream.h"
+#include "Text/Fmt/std_filesystem.h"
+
+#include <bitset>
+
+using namespace Orc;
+
+namespace {
+
+constexpr DWORD kCheckpointMagic = 0x50434D4F;  // 'OMCP'
+constexpr DWORD kCheckpointVersion = 1L;
+
+// Records of the largest MFT (2^32 records) take 512MB: larger sets are invalid
+constexpr ULONGLONG kMaxBitWords = (1ULL << 32) / 64;
+
+class CheckpointWriter
+{
+public:
+    template <typename T>
+    void Write(const T& value)
+    {
+        const auto pValue = reinterpret_cast<const BYTE*>(&value);
+        m_data.insert(std::end(m_data), pValue, pValue + sizeof(T));
+    }
+
+    void Write(const std::wstring& str)
+    {
+        Write(static_cast<WORD>(str.size()));
+        const auto pStr = reinterpret_cast<const BYTE*>(str.data());
+        m_data.insert(std::end(m_data), pStr, pStr + str.size() * sizeof(WCHAR));
+    }
+
+    void Write(const std::vector<ULONGLONG>& words)
+    {
+        Write(static_cast<ULONGLONG>(words.size()));
+        const auto pWords = reinterpret_cast<const BYTE*>(words.data());
+        m_data.insert(std::end(m_data), pWords, pWords + words.size() * sizeof(ULONGLONG));
+    }
+
+    std::vector<BYTE>& Data() { return m_data; }
+
+private:
+    std::vector<BYTE> m_data;
+};
+
+class CheckpointReader
+{
+public:
+    CheckpointReader(const std::vector<BYTE>& data)
+        : m_data(data)
+    {
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        if (m_data.size() - m_offset < sizeof(T))
+            return false;
+
+        memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool Read(std::wstring& str)
+    {
+        WORD wLength = 0;
+        if (!Read(wLength) || m_data.size() - m_offset < wLength * sizeof(WCHAR))
+            return false;
+
+        str.assign(reinterpret_cast<const WCHAR*>(m_data.data() + m_offset), wLength);
+        m_offset += wLength * sizeof(WCHAR);
+        return true;
+    }
+
+    bool Read(std::vector<ULONGLONG>& words)
+    {
+        ULONGLONG ullCount = 0LL;
+        if (!Read(ullCount) || ullCount > kMaxBitWords || (m_data.size() - m_offset) / sizeof(ULONGLONG) < ullCount)
+            return false;
+
+        words.resize(static_cast<size_t>(ullCount));
+        memcpy(words.data(), m_data.data() + m_offset, words.size() * sizeof(ULONGLONG));
+        m_offset += words.size() * sizeof(ULONGLONG);
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_data.size(); }
+
+private:
+    const std::vector<BYTE>& m_data;
+    size_t m_offset = 0;
+};
+
+}  // namespace
+
+void MFTWalkCheckpoint::RecordSet::Insert(ULONGLONG ullRecord)
+{
+    const auto index = static_cast<size_t>(ullRecord / 64);
+    if (index >= m_bits.size())
+        m_bits.resize(index + 1, 0LL);
+
+    m_bits[index] |= 1ULL << (ullRecord % 64);
+}
+
+ULONGLONG MFTWalkCheckpoint::RecordSet::Count() const
+{
+    ULONGLONG ullCount = 0LL;
+    for (const auto bits : m_bits)
+        ullCount += std::bitset<64>(bits).count();
+
+    return ullCount;
+}
+
+HRESULT MFTWalkCheckpoint::Load(const std::filesystem::path& path)
+{
+    HRESULT hr = E_FAIL;
+
+    m_locations.clear();
+    m_outputs.clear();
+
+    FileStream stream;
+    if (FAILED(hr = stream.ReadFrom(path.c_str())))
+    {
+        if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) || hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND))
+        {
+            Log::Debug(L"No MFT walk checkpoint in '{}'", path);
+            return S_FALSE;
+        }
+
+        Log::Error(L"Failed to open MFT walk checkpoint '{}' [{}]", path, SystemError(hr));
+        return hr;
+    }
+
+    std::vector<BYTE> data;
+    try
+    {
+        data.resize(static_cast<size_t>(stream.GetSize()));
+    }
+    catch (const std::bad_alloc&)
+    {
+        Log::Error(L"Failed to allocate {} bytes to read MFT walk checkpoint '{}'", stream.GetSize(), path);
+        return E_OUTOFMEMORY;
+    }
+
+    ULONGLONG ullRead = 0LL;
+    if (FAILED(hr = stream.Read(data.data(), data.size(), &ullRead)) || ullRead != data.size())
+    {
+        Log::Error(L"Failed to read MFT walk checkpoint '{}' [{}]", path, SystemError(hr));
+        return FAILED(hr) ? hr : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    CheckpointReader reader(data);
+
+    DWORD dwMagic = 0L, dwVersion = 0L, dwLocations = 0L;
+    if (!reader.Read(dwMagic) || dwMagic != kCheckpointMagic || !reader.Read(dwVersion)
+        || dwVersion != kCheckpointVersion || !reader.Read(dwLocations))
+    {
+        Log::Error(L"Invalid MFT walk checkpoint '{}' (unknown format)", path);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    std::map<std::wstring, Location> locations;
+    for (DWORD i = 0; i < dwLocations; i++)
+    {
+        std::wstring strLocation;
+        BYTE bComplete = 0;
+        std::vector<ULONGLONG> bits;
+
+        if (!reader.Read(strLocation) || !reader.Read(bComplete) || !reader.Read(bits))
+        {
+            Log::Error(L"Invalid MFT walk checkpoint '{}' (truncated location)", path);
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        Location location;
+        location.bComplete = bComplete != 0;
+        location.Records.SetBits(std::move(bits));
+        locations.emplace(std::move(strLocation), std::move(location));
+    }
+
+    DWORD dwOutputs = 0L;
+    if (!reader.Read(dwOutputs))
+    {
+        Log::Error(L"Invalid MFT walk checkpoint '{}' (missing outputs)", path);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    std::map<std::wstring, ULONGLONG> outputs;
+    for (DWORD i = 0; i < dwOutputs; i++)
+    {
+        std::wstring strPath;
+        ULONGLONG ullSize = 0LL;
+
+        if (!reader.Read(strPath) || !reader.Read(ullSize))
+        {
+            Log::Error(L"Invalid MFT walk checkpoint '{}' (truncated output)", path);
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        outputs.emplace(std::move(strPath), ullSize);
+    }
+
+    if (!reader.AtEnd())
+    {
+        Log::Error(L"Invalid MFT walk checkpoint '{}' (trailing data)", path);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    m_locations = std::move(locations);
+    m_outputs = std::move(outputs);
+    return S_OK;
+}
+
+HRESULT MFTWalkCheckpoint::Save(const std::filesystem::path& path) const
+{
+    HRESULT hr = E_FAIL;
+
+    CheckpointWriter writer;
+    writer.Write(kCheckpointMagic);
+    writer.Write(kCheckpointVersion);
+    writer.Write(static_cast<DWORD>(m_locations.size()));
+
+    for (const auto& [strLocation, location] : m_locations)
+    {
+        writer.Write(strLocation);
+        writer.Write(static_cast<BYTE>(location.bComplete ? 1 : 0));
+        writer.Write(location.Records.Bits());
+    }
+
+    writer.Write(static_cast<DWORD>(m_outputs.size()));
+    for (const auto& [strPath, ullSize] : m_outputs)
+    {
+        writer.Write(strPath);
+        writer.Write(ullSize);
+    }
+
+    // Written aside then moved over the previous checkpoint: a command killed meanwhile leaves the previous one usable
+    auto tempPath = path;
+    tempPath += L".tmp";
+
+    {
+        FileStream stream;
+        if (FAILED(hr = stream.WriteTo(tempPath.c_str())))
+        {
+            Log::Error(L"Failed to create MFT walk checkpoint '{}' [{}]", tempPath, SystemError(hr));
+            return hr;
+        }
+
+        ULONGLONG ullWritten = 0LL;
+        auto& data = writer.Data();
+        if (FAILED(hr = stream.Write(data.data(), data.size(), &ullWritten)))
+        {
+            Log::Error(L"Failed to write MFT walk checkpoint '{}' [{}]", tempPath, SystemError(hr));
+            stream.Close();
+            DeleteFile(tempPath.c_str());
+            return hr;
+        }
+        stream.Close();
+    }
+
+    if (!MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to replace MFT walk checkpoint '{}' [{}]", path, SystemError(hr));
+        DeleteFile(tempPath.c_str());
+        return hr;
+    }
+
+    return S_OK;
+}
+
+const MFTWalkCheckpoint::Location* MFTWalkCheckpoint::Find(const std::wstring& strLocation) const
+{
+    auto it = m_locations.find(strLocation);
+    if (it == std::end(m_locations))
+        return nullptr;
+
+    return &it->second;
+}
+
+void MFTWalkCheckpoint::Set(const std::wstring& strLocation, const Location& location)
+{
+    m_locations.insert_or_assign(strLocation, location);
+}
+
+const ULONGLONG* MFTWalkCheckpoint::FindOutput(const std::wstring& strPath) const
+{
+    auto it = m_outputs.find(strPath);
+    if (it == std::end(m_outputs))
+        return nullptr;
+
+    return &it->second;
+}
+
+void MFTWalkCheckpoint::SetOutput(const std::wstring& strPath, ULONGLONG ullSize)
+{
+    m_outputs.insert_or_assign(strPath, ullSize);
+}
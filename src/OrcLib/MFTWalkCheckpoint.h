@@ -0,0 +1,83 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// MFTWalkCheckpoint: progress of the MFT walks of a command, saved periodically so that a command killed before its
+// end (timeout) resumes the walks where they stopped when it is run again.
+//
+// For each location (by identifier) it keeps whether its walk completed and, while in progress, the set of MFT records
+// whose rows were all written. Output files get the number of bytes they held when the checkpoint was saved: the rows
+// written after it belong to records which are walked again.
+//
+class MFTWalkCheckpoint
+{
+public:
+    // Set of MFT record numbers, one bit per record
+    class RecordSet
+    {
+    public:
+        bool Contains(ULONGLONG ullRecord) const
+        {
+            const auto index = static_cast<size_t>(ullRecord / 64);
+            return index < m_bits.size() && (m_bits[index] & (1ULL << (ullRecord % 64)));
+        }
+
+        void Insert(ULONGLONG ullRecord);
+
+        ULONGLONG Count() const;
+        bool IsEmpty() const { return m_bits.empty(); }
+
+        const std::vector<ULONGLONG>& Bits() const { return m_bits; }
+        void SetBits(std::vector<ULONGLONG>&& bits) { m_bits = std::move(bits); }
+
+    private:
+        std::vector<ULONGLONG> m_bits;
+    };
+
+    struct Location
+    {
+        bool bComplete = false;
+        RecordSet Records;
+    };
+
+    // A missing file is not an error: the checkpoint is then empty (S_FALSE)
+    HRESULT Load(const std::filesystem::path& path);
+    HRESULT Save(const std::filesystem::path& path) const;
+
+    const Location* Find(const std::wstring& strLocation) const;
+    void Set(const std::wstring& strLocation, const Location& location);
+
+    const std::map<std::wstring, Location>& Locations() const { return m_locations; }
+
+    // Bytes of an output file when the checkpoint was saved
+    const ULONGLONG* FindOutput(const std::wstring& strPath) const;
+    void SetOutput(const std::wstring& strPath, ULONGLONG ullSize);
+    void ClearOutputs() { m_outputs.clear(); }
+
+    const std::map<std::wstring, ULONGLONG>& Outputs() const { return m_outputs; }
+
+private:
+    std::map<std::wstring, Location> m_locations;
+    std::map<std::wstring, ULONGLONG> m_outputs;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
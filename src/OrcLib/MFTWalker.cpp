@@ -16,8 +16,19 @@
 
 #include "MFTOnline.h"
 #include "MFTOffline.h"
+#include "MFTRecordBatch.h"
+#include "ShadowCopyVolumeReader.h"
+
+#include "Filesystem/Ntfs/ShadowCopy/DiffAreaTableEntry.h"
 
 #include "OrcException.h"
+#include "BlockingQueue.h"
+#include "TaskPool.h"
+#include "Telemetry.h"
+#include "MemoryAccounting.h"
+
+#include <atomic>
+#include <thread>
 
 #include <boost/scope_exit.hpp>
 
@@ -30,6 +41,9 @@ using namespace Orc;
 
 namespace {
 
+// Records of the metadata files ($MFT, $LogFile, $Secure...) and the reserved ones
+constexpr auto kFirstUserRecord = 16ULL;
+
 // Check if an unused record can be considered as "resident" which means that most of its data is stored in only one
 // record. An unused "resident" record should be still worth analysis.
 bool IsRecordInUseOrResident(const MFTRecord& record)
@@ -72,6 +86,325 @@ bool IsRecordInUseOrResident(const MFTRecord& record)
     return true;
 }
 
+// Number of FRS grouped in one batch handed over to pipeline workers
+constexpr auto PIPELINE_FRS_PER_BATCH = 64;
+// Number of batches in flight for each pipeline worker
+constexpr auto PIPELINE_BATCHES_PER_WORKER = 4;
+
+struct FRSBatch
+{
+    ULONGLONG ullSequence = 0LL;
+    std::vector<MFTUtils::SafeMFTSegmentNumber> Indexes;
+    // Records worth parsing, validated and fixed up by a pipeline worker
+    std::vector<MFTRecordBatch::Record> Records;
+    std::vector<BYTE> Data;
+};
+
+// Same checks as MFTUtils::MultiSectorFixup but silent: failing records are left untouched for the walking thread
+// which will report them while parsing
+bool CanFixupInPlace(PFILE_RECORD_SEGMENT_HEADER pFRS, ULONG ulBytesPerSector, ULONG ulBytesPerFRS)
+{
+    const PMULTI_SECTOR_HEADER pHeader = &pFRS->MultiSectorHeader;
+    if (strncmp((PCHAR)pHeader->Signature, "FILE", 4))
+        return false;
+
+    if (ulBytesPerSector < sizeof(WORD) || ulBytesPerFRS < ulBytesPerSector)
+        return false;
+
+    const WORD numfix = (WORD)(ulBytesPerFRS / ulBytesPerSector);
+    if (pHeader->UpdateSequenceArrayOffset + numfix * 2 > 510)
+        return false;
+
+    const WORD* fixuparray = (WORD*)((BYTE*)pHeader + pHeader->UpdateSequenceArrayOffset);
+    const WORD fixupsig = fixuparray[0];
+
+    const BYTE* dest = (BYTE*)pHeader + ulBytesPerSector - 2;
+    for (WORD i = 0; i < numfix; i++)
+    {
+        if (*((WORD*)dest) != fixupsig)
+            return false;
+        dest += ulBytesPerSector;
+    }
+
+    return true;
+}
+
+// $INDEX_ALLOCATION of a directory is read by windows of this size, adjacent clusters with a single volume read
+constexpr auto I30_PREFETCH_WINDOW = 1024 * 1024ULL;
+// Below this number of index blocks, the thread pool costs more than it saves
+constexpr size_t I30_PARALLEL_MIN_BLOCKS = 8;
+// Deepest $I30 B+tree descended by a path lookup, deeper ones are considered corrupted
+constexpr auto I30_MAX_DEPTH = 32;
+
+// Deepest parent chain followed to build a directory path, deeper ones are corrupted or loop
+constexpr size_t DIRECTORY_MAX_DEPTH = 1024;
+// Records left for the final walk of resurrected records are handed over to the workers by ranges of this size
+constexpr size_t RESURRECT_RECORDS_PER_RANGE = 4096;
+// Below this number of ranges, the thread pool costs more than it saves
+constexpr size_t RESURRECT_PARALLEL_MIN_RANGES = 2;
+
+struct I30Entry
+{
+    PINDEX_ENTRY pEntry;
+    PFILE_NAME pFileName;
+    bool bCarved;
+};
+
+struct I30Block
+{
+    HRESULT hr = S_OK;
+    std::vector<I30Entry> Entries;
+};
+
+// Reads [ullOffset, ullOffset + ullBytes) of the $INDEX_ALLOCATION into window: segments are sorted by disk offset and
+// the contiguous ones are read at once. Sparse segments are left zeroed.
+HRESULT ReadIndexAllocation(
+    const std::shared_ptr<VolumeReader>& volReader,
+    const std::shared_ptr<IndexAllocationAttribute>& pIA,
+    ULONGLONG ullOffset,
+    ULONGLONG ullBytes,
+    std::vector<BYTE>& window)
+{
+    HRESULT hr = E_FAIL;
+
+    std::vector<MFTUtils::DataSegment> segments;
+    if (FAILED(hr = pIA->GetNonResidentSegmentsToRead(volReader, ullOffset, ullBytes, ullBytes, segments)))
+        return hr;
+
+    segments.erase(
+        std::remove_if(
+            std::begin(segments),
+            std::end(segments),
+            [](const MFTUtils::DataSegment& segment) { return segment.bUnallocated || segment.ullSize == 0; }),
+        std::end(segments));
+
+    std::sort(std::begin(segments), std::end(segments), [](const auto& left, const auto& right) {
+        return left.ullDiskBasedOffset < right.ullDiskBasedOffset;
+    });
+
+    CBinaryBuffer buffer;
+
+    auto it = std::cbegin(segments);
+    while (it != std::cend(segments))
+    {
+        const auto ullReadStart = it->ullDiskBasedOffset;
+        auto last = it + 1;
+        ULONGLONG ullReadSize = it->ullSize;
+        while (last != std::cend(segments) && last->ullDiskBasedOffset == ullReadStart + ullReadSize
+               && ullReadSize + last->ullSize <= I30_PREFETCH_WINDOW)
+        {
+            ullReadSize += last->ullSize;
+            ++last;
+        }
+
+        ULONGLONG ullBytesRead = 0LL;
+        if (FAILED(hr = volReader->Read(ullReadStart, buffer, ullReadSize, ullBytesRead)))
+            return hr;
+
+        for (; it != last; ++it)
+        {
+            const auto ullInRead = it->ullDiskBasedOffset - ullReadStart;
+            if (it->ullFileBasedOffset < ullOffset || ullInRead >= ullBytesRead)
+                continue;
+
+            const auto ullInWindow = it->ullFileBasedOffset - ullOffset;
+            if (ullInWindow >= window.size())
+                continue;
+
+            const auto toCopy = static_cast<size_t>(
+                std::min({it->ullSize, ullBytesRead - ullInRead, window.size() - ullInWindow}));
+            memcpy_s(
+                window.data() + ullInWindow,
+                window.size() - static_cast<size_t>(ullInWindow),
+                buffer.GetData() + ullInRead,
+                toCopy);
+        }
+    }
+
+    return S_OK;
+}
+
+// Entries whose parent is ullDirectory found in the slack of an index block, from pFrom
+void CarveIndexBlock(
+    LPBYTE pFrom,
+    LPBYTE pEnd,
+    MFTUtils::SafeMFTSegmentNumber ullDirectory,
+    std::vector<I30Entry>& entries)
+{
+    for (LPBYTE pFirstFreeByte = pFrom; pFirstFreeByte + sizeof(FILE_NAME) < pEnd; pFirstFreeByte++)
+    {
+        PFILE_NAME pCarvedFileName = (PFILE_NAME)pFirstFreeByte;
+
+        if (NtfsFullSegmentNumber(&pCarvedFileName->ParentDirectory) == ullDirectory)
+        {
+            PINDEX_ENTRY pEntry = (PINDEX_ENTRY)((LPBYTE)pCarvedFileName - sizeof(INDEX_ENTRY));
+            entries.push_back({pEntry, pCarvedFileName, true});
+        }
+    }
+}
+
+// Fixes up one INDX block in place and lists its entries, then the ones carved from its slack. Blocks not in use are
+// only carved.
+HRESULT ParseIndexBlock(
+    LPBYTE pBlock,
+    ULONG ulSizePerIndex,
+    bool bInUse,
+    MFTUtils::SafeMFTSegmentNumber ullDirectory,
+    const std::shared_ptr<VolumeReader>& volReader,
+    std::vector<I30Entry>& entries)
+{
+    HRESULT hr = E_FAIL;
+
+    PINDEX_ALLOCATION_BUFFER pIABuff = (PINDEX_ALLOCATION_BUFFER)pBlock;
+    const LPBYTE pEnd = pBlock + ulSizePerIndex;
+
+    if (FAILED(hr = MFTUtils::MultiSectorFixup(pIABuff, ulSizePerIndex, volReader)))
+    {
+        if (!bInUse)
+        {
+            Log::Debug("Failed to fixup carved $INDEX_ALLOCATION [{}]", SystemError(hr));
+            return S_OK;
+        }
+
+        if (HRESULT_FROM_NT(NTE_BAD_SIGNATURE) == hr)
+            return S_OK;
+
+        return hr;
+    }
+
+    if (!bInUse)
+    {
+        CarveIndexBlock(pBlock, pEnd, ullDirectory, entries);
+        return S_OK;
+    }
+
+    PINDEX_HEADER pHeader = &(pIABuff->IndexHeader);
+    PINDEX_ENTRY pEntry = (PINDEX_ENTRY)NtfsFirstIndexEntry(pHeader);
+    while (!(pEntry->Flags & INDEX_ENTRY_END))
+    {
+        PFILE_NAME pFileName = (PFILE_NAME)((PBYTE)pEntry + sizeof(INDEX_ENTRY));
+        entries.push_back({pEntry, pFileName, false});
+
+        pEntry = NtfsNextIndexEntry(pEntry);
+    }
+
+    CarveIndexBlock(((LPBYTE)NtfsFirstIndexEntry(pHeader)) + pHeader->FirstFreeByte, pEnd, ullDirectory, entries);
+    return S_OK;
+}
+
+// Header of a resident attribute, up to its value offset
+constexpr ULONG RESIDENT_ATTRIBUTE_HEADER_LENGTH = 0x18;
+
+// Reference of the record in a segment (some volumes upgraded from 2000 do not store the segment number)
+MFT_SEGMENT_REFERENCE SegmentReference(const PFILE_RECORD_SEGMENT_HEADER pHeader, ULONGLONG ullRecordIndex)
+{
+    MFT_SEGMENT_REFERENCE reference;
+
+    if (pHeader->MultiSectorHeader.UpdateSequenceArrayOffset == 0x2A && pHeader->FirstAttributeOffset == 0x30)
+    {
+        ULARGE_INTEGER FRN {0};
+        FRN.QuadPart = ullRecordIndex;
+        reference.SegmentNumberLowPart = FRN.LowPart;
+        reference.SegmentNumberHighPart = static_cast<USHORT>(FRN.HighPart);
+    }
+    else
+    {
+        reference.SegmentNumberHighPart = pHeader->SegmentNumberHighPart;
+        reference.SegmentNumberLowPart = pHeader->SegmentNumberLowPart;
+    }
+
+    reference.SequenceNumber = pHeader->SequenceNumber;
+    return reference;
+}
+
+// Calls 'callback' with the attribute headers of a fixed up record segment, as long as they are within the segment
+template <typename AttributeCallback>
+void ForEachAttribute(const PFILE_RECORD_SEGMENT_HEADER pFRS, ULONG ulBytesPerFRS, AttributeCallback callback)
+{
+    const BYTE* pEnd = reinterpret_cast<const BYTE*>(pFRS) + ulBytesPerFRS;
+    const BYTE* pCurrent = reinterpret_cast<const BYTE*>(pFRS) + pFRS->FirstAttributeOffset;
+
+    while (pCurrent + sizeof(ATTRIBUTE_TYPE_CODE) + sizeof(ULONG) <= pEnd)
+    {
+        const auto pAttr = reinterpret_cast<const ATTRIBUTE_RECORD_HEADER*>(pCurrent);
+        if (pAttr->TypeCode == $END || pAttr->RecordLength < RESIDENT_ATTRIBUTE_HEADER_LENGTH
+            || pAttr->RecordLength > static_cast<size_t>(pEnd - pCurrent))
+            break;
+
+        callback(pAttr);
+        pCurrent += pAttr->RecordLength;
+    }
+}
+
+// Value of a resident attribute, nullptr if the value is not within the attribute
+const BYTE* ResidentValue(const ATTRIBUTE_RECORD_HEADER* pAttr, ULONG& cbValue)
+{
+    if (pAttr->FormCode != RESIDENT_FORM)
+        return nullptr;
+
+    const auto& resident = pAttr->Form.Resident;
+    if (resident.ValueOffset < RESIDENT_ATTRIBUTE_HEADER_LENGTH
+        || static_cast<ULONGLONG>(resident.ValueOffset) + resident.ValueLength > pAttr->RecordLength)
+        return nullptr;
+
+    cbValue = resident.ValueLength;
+    return reinterpret_cast<const BYTE*>(pAttr) + resident.ValueOffset;
+}
+
+// $FILE_NAME value whose name fits in the attribute, nullptr otherwise
+PFILE_NAME FileNameValue(const ATTRIBUTE_RECORD_HEADER* pAttr)
+{
+    ULONG cbValue = 0;
+    const BYTE* pValue = ResidentValue(pAttr, cbValue);
+    if (pValue == nullptr || cbValue < offsetof(FILE_NAME, FileName))
+        return nullptr;
+
+    const auto pFileName = reinterpret_cast<PFILE_NAME>(const_cast<BYTE*>(pValue));
+    if (offsetof(FILE_NAME, FileName) + pFileName->FileNameLength * sizeof(WCHAR) > cbValue)
+        return nullptr;
+
+    return pFileName;
+}
+
+// Same preference as MFTRecord::GetMain_PFILE_NAME: win32 or posix name, then win32 and dos name, then the last one
+PFILE_NAME MainFileName(const std::vector<PFILE_NAME>& names)
+{
+    PFILE_NAME pLeastPreferedFileName = nullptr;
+
+    for (const auto pFileName : names)
+    {
+        if (pFileName->Flags == FILE_NAME_WIN32 || pFileName->Flags == FILE_NAME_POSIX)
+            return pFileName;
+
+        if (pFileName->Flags & FILE_NAME_WIN32)
+            pLeastPreferedFileName = pFileName;
+    }
+
+    if (pLeastPreferedFileName != nullptr)
+        return pLeastPreferedFileName;
+
+    return names.empty() ? nullptr : names.back();
+}
+
+// Record with a name accepted by a name scan, its names are stored in 'FileNames', each aligned on 8 bytes
+struct NameScanCandidate
+{
+    MFT_SEGMENT_REFERENCE FileReferenceNumber {0};
+    bool bBaseScanned = false;
+    bool bInUse = false;
+    std::optional<STANDARD_INFORMATION> StandardInformation;
+    std::vector<BYTE> FileNames;
+};
+
+void AddCandidateFileName(NameScanCandidate& candidate, const PFILE_NAME pFileName)
+{
+    const size_t cbFileName = offsetof(FILE_NAME, FileName) + pFileName->FileNameLength * sizeof(WCHAR);
+    const size_t offset = (candidate.FileNames.size() + 7) & ~static_cast<size_t>(7);
+
+    candidate.FileNames.resize(offset + cbFileName);
+    memcpy_s(candidate.FileNames.data() + offset, cbFileName, pFileName, cbFileName);
+}
+
 }  // namespace
 
 // Number of items in the VirtualStore
@@ -116,12 +449,50 @@ HRESULT MFTWalker::Initialize(const shared_ptr<Location>& loc, ResurrectRecordsM
     }
     else
     {
-        m_pMFT = std::make_unique<MFTOnline>(m_pVolReader);
+        auto pEnumReader = m_pVolReader;
+
+        if (m_dwPipelineWorkers > 0)
+        {
+            // The reader thread needs its own reader not to compete with the walking thread's random reads
+            pEnumReader = m_pVolReader->ReOpen(
+                FILE_READ_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_SEQUENTIAL_SCAN);
+
+            if (pEnumReader == nullptr || pEnumReader == m_pVolReader)
+            {
+                Log::Debug(
+                    L"Failed to duplicate reader for location '{}', pipelined walk is disabled", loc->GetLocation());
+                m_dwPipelineWorkers = 0L;
+                pEnumReader = m_pVolReader;
+            }
+        }
+
+        m_pMFT = std::make_unique<MFTOnline>(pEnumReader);
     }
 
     if (FAILED(m_pMFT->Initialize()))
         return hr;
 
+    if (m_resurrectRecordMode == ResurrectRecordsMode::kNo)
+    {
+        // Records not in use would be ignored anyway, they are not even read
+        if (FAILED(hr = m_pMFT->SkipUnusedRecords()))
+        {
+            Log::Debug(L"Failed to load in use records for location '{}' [{}]", loc->GetLocation(), SystemError(hr));
+        }
+    }
+
+    if (m_bSkipUnchangedShadowRecords)
+    {
+        if (FAILED(hr = LoadUnchangedRecords()))
+        {
+            Log::Debug(
+                L"Failed to compare shadow copy '{}' with its volume, all records are walked [{}]",
+                loc->GetLocation(),
+                SystemError(hr));
+            m_UnchangedRecords.clear();
+        }
+    }
+
     if (!loc->GetSubDirs().empty())
     {
         auto& SpecificLocations = loc->GetSubDirs();
@@ -160,9 +531,128 @@ HRESULT MFTWalker::Initialize(const shared_ptr<Location>& loc, ResurrectRecordsM
     {
         return hr;
     }
+    m_SegmentStore.SetAccountingTag(MemoryAccounting::Tag::MFTWalk);
+    return S_OK;
+}
+
+HRESULT MFTWalker::LoadUnchangedRecords()
+{
+    m_UnchangedRecords.clear();
+
+    auto pShadowReader = std::dynamic_pointer_cast<ShadowCopyVolumeReader>(m_pVolReader);
+    auto pMFTOnline = dynamic_cast<MFTOnline*>(m_pMFT.get());
+    if (pShadowReader == nullptr || pMFTOnline == nullptr)
+    {
+        Log::Debug("Skipping unchanged records requires a shadow copy parsed with the internal parser");
+        return S_OK;
+    }
+
+    const ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
+    if (ulBytesPerFRS == 0)
+        return E_INVALIDARG;
+
+    const ULONGLONG ullBlockSize = Ntfs::ShadowCopy::DiffAreaTableEntry::kDataSize;
+
+    m_UnchangedRecords.reserve(m_pMFT->GetMFTRecordCount());
+
+    // Segment numbers follow the non zero extents like in MFTOnline::EnumMFTRecord
+    ULONGLONG ullUnchanged = 0LL;
+    for (const auto& extent : pMFTOnline->GetMftInfo().ExtentsVector)
+    {
+        if (extent.bZero)
+            continue;
+
+        std::optional<ULONGLONG> lastBlock;
+        bool bLastBlockUnchanged = false;
+
+        for (ULONGLONG ullOffset = 0LL; ullOffset + ulBytesPerFRS <= extent.DataSize; ullOffset += ulBytesPerFRS)
+        {
+            const ULONGLONG ullDiskOffset = extent.DiskOffset + ullOffset;
+            const ULONGLONG ullBlock = ullDiskOffset & ~(ullBlockSize - 1);
+
+            bool bUnchanged = false;
+            if (ullBlock == ((ullDiskOffset + ulBytesPerFRS - 1) & ~(ullBlockSize - 1)))
+            {
+                // Most records fit in a single block: compare it once for all its records
+                if (!lastBlock || *lastBlock != ullBlock)
+                {
+                    lastBlock = ullBlock;
+                    bLastBlockUnchanged = pShadowReader->IsUnchanged(ullBlock, ullBlockSize);
+                }
+
+                bUnchanged = bLastBlockUnchanged;
+            }
+            else
+            {
+                bUnchanged = pShadowReader->IsUnchanged(ullDiskOffset, ulBytesPerFRS);
+            }
+
+            m_UnchangedRecords.push_back(bUnchanged);
+            ullUnchanged += bUnchanged ? 1 : 0;
+        }
+    }
+
+    Log::Debug(
+        L"Shadow copy MFT -> Records: {}, Unchanged from the volume: {}", m_UnchangedRecords.size(), ullUnchanged);
+
+    if (ullUnchanged == 0)
+    {
+        m_UnchangedRecords.clear();
+    }
+
     return S_OK;
 }
 
+bool MFTWalker::IsUnchangedSegment(MFTUtils::SafeMFTSegmentNumber ullSegmentNumber) const
+{
+    const auto ullSegment = ullSegmentNumber & 0x0000FFFFFFFFFFFF;
+    return ullSegment < m_UnchangedRecords.size() && m_UnchangedRecords[ullSegment];
+}
+
+bool MFTWalker::IsUnchangedRecord(const MFTRecord* pRecord) const
+{
+    if (m_UnchangedRecords.empty())
+        return false;
+
+    // The metadata files are always walked: their content is not only in their records
+    const auto ullSegment = NtfsSegmentNumber(&pRecord->m_FileReferenceNumber);
+    if (ullSegment < kFirstUserRecord || !IsUnchangedSegment(ullSegment))
+        return false;
+
+    for (const auto& [ullChild, pChild] : pRecord->GetChildRecords())
+    {
+        if (!IsUnchangedSegment(ullChild))
+            return false;
+    }
+
+    return true;
+}
+
+bool MFTWalker::CanSkipUnchangedRecord(MFTUtils::SafeMFTSegmentNumber ullRecordIndex, const CBinaryBuffer& Data) const
+{
+    if (m_UnchangedRecords.empty() || ullRecordIndex < kFirstUserRecord || !IsUnchangedSegment(ullRecordIndex))
+        return false;
+
+    const auto pHeader = reinterpret_cast<const FILE_RECORD_SEGMENT_HEADER*>(Data.GetData());
+    if (Data.GetCount() < sizeof(FILE_RECORD_SEGMENT_HEADER))
+        return false;
+
+    // Directories are still needed to build the names of the changed records
+    if (pHeader->Flags & FILE_FILE_NAME_INDEX_PRESENT)
+        return false;
+
+    // Child of an already walked record: it will be needed to complete it
+    const auto ullBase = NtfsFullSegmentNumber(&pHeader->BaseFileRecordSegment);
+    if (ullBase != 0)
+    {
+        const auto it = m_MFTMap.find(ullBase);
+        if (it != std::cend(m_MFTMap) && it->second != nullptr)
+            return false;
+    }
+
+    return true;
+}
+
 HRESULT MFTWalker::ExtendNameBuffer(WCHAR** pCurrent)
 {
     WCHAR* pNewBuf = NULL;
@@ -326,6 +816,56 @@ bool MFTWalker::IsInLocation(PFILE_NAME pFileName)
     }
 }
 
+std::optional<std::wstring_view> MFTWalker::GetDirectoryPath(MFTUtils::SafeMFTSegmentNumber ullDirectory)
+{
+    // Paths are only memoized once the parent chain reaches the root: a missing parent could still be added later
+    std::vector<MFTFileNameWrapper*> chain;
+    std::wstring_view basePath;
+
+    for (auto current = ullDirectory;;)
+    {
+        if (current == m_pMFT->GetUSNRoot())
+        {
+            basePath = L"\\";
+            break;
+        }
+
+        auto it = m_DirectoryNames.find(current);
+        if (it == end(m_DirectoryNames) || it->second.FileName() == nullptr)
+            return std::nullopt;
+
+        if (it->second.m_FullPath.has_value())
+        {
+            basePath = *it->second.m_FullPath;
+            break;
+        }
+
+        if (chain.size() >= DIRECTORY_MAX_DEPTH)
+        {
+            Log::Debug(L"Directory {:#x} parent chain is too deep or has a loop", ullDirectory);
+            return std::nullopt;
+        }
+
+        chain.push_back(&it->second);
+        current = NtfsFullSegmentNumber(&(it->second.FileName()->ParentDirectory));
+    }
+
+    for (auto it = std::rbegin(chain); it != std::rend(chain); ++it)
+    {
+        const auto pName = (*it)->FileName();
+
+        if (pName->FileNameLength == 1 && *pName->FileName == L'.')
+            (*it)->m_FullPath = basePath;
+        else
+            (*it)->m_FullPath = m_DirectoryPaths.Intern(
+                basePath, std::wstring_view(pName->FileName, pName->FileNameLength), L'\\');
+
+        basePath = *(*it)->m_FullPath;
+    }
+
+    return basePath;
+}
+
 const WCHAR* MFTWalker::GetFullNameAndIfInLocation(
     PFILE_NAME pFileName,
     const std::shared_ptr<DataAttribute>& pDataAttr,
@@ -388,49 +928,63 @@ const WCHAR* MFTWalker::GetFullNameAndIfInLocation(
     auto pParentPair = m_DirectoryNames.find(NtfsFullSegmentNumber(&(pFileName->ParentDirectory)));
     auto pDirectParent = pParentPair;
 
-    while (pParentPair != end(m_DirectoryNames))
+    if (pParentPair != end(m_DirectoryNames) && pParentPair->second.m_OrphanPath.has_value())
     {
-        PFILE_NAME pParentName = pParentPair->second.FileName();
-
-        if (pParentName == NULL)
+        // Final walk: the chain up to the missing ancestor was resolved by ResolveFinalWalkNames
+        m_currentFileName.append(*pParentPair->second.m_OrphanPath);
+    }
+    else if (auto parentPath = GetDirectoryPath(ulLastSegmentNumber))
+    {
+        // Parent chain was already resolved up to the root: reuse the memoized directory path
+        m_currentFileName.append(*parentPath);
+        ulLastSegmentNumber = m_pMFT->GetUSNRoot();
+    }
+    else
+    {
+        while (pParentPair != end(m_DirectoryNames))
         {
-            Log::Debug(
-                L"Could not determine main parent file name for '{}'",
-                std::wstring_view(pFileName->FileName, pFileName->FileNameLength));
-            break;
+            PFILE_NAME pParentName = pParentPair->second.FileName();
+
+            if (pParentName == NULL)
+            {
+                Log::Debug(
+                    L"Could not determine main parent file name for '{}'",
+                    std::wstring_view(pFileName->FileName, pFileName->FileNameLength));
+                break;
+            }
+
+            if (!(pParentName->FileNameLength == 1 && *pParentName->FileName == L'.'))
+            {
+                m_currentFileNameElements.emplace_back(pParentName->FileName, pParentName->FileNameLength);
+            }
+
+            ulLastSegmentNumber = NtfsFullSegmentNumber(&(pParentName->ParentDirectory));
+            pParentPair = m_DirectoryNames.find(NtfsFullSegmentNumber(&(pParentName->ParentDirectory)));
+
+            if (ulLastSegmentNumber == m_pMFT->GetUSNRoot())
+            {
+                break;
+            }
         }
 
-        if (!(pParentName->FileNameLength == 1 && *pParentName->FileName == L'.'))
+        std::optional<std::wstring> unknownParentDirectory;  // ensure lifetime to be able to store as wstring_view
+        if (ulLastSegmentNumber != m_pMFT->GetUSNRoot())
         {
-            m_currentFileNameElements.emplace_back(pParentName->FileName, pParentName->FileNameLength);
+            // Parent folder was _not_ found, inserting "place holder"
+            unknownParentDirectory = std::wstring();
+            fmt::format_to(std::back_inserter(*unknownParentDirectory), L"__{:016X}__", ulLastSegmentNumber);
+            m_currentFileNameElements.emplace_back(*unknownParentDirectory);
         }
 
-        ulLastSegmentNumber = NtfsFullSegmentNumber(&(pParentName->ParentDirectory));
-        pParentPair = m_DirectoryNames.find(NtfsFullSegmentNumber(&(pParentName->ParentDirectory)));
+        m_currentFileName.push_back(L'\\');
 
-        if (ulLastSegmentNumber == m_pMFT->GetUSNRoot())
+        for (auto it = std::rbegin(m_currentFileNameElements); it != std::rend(m_currentFileNameElements); ++it)
         {
-            break;
+            m_currentFileName.append(*it);
+            m_currentFileName.push_back(L'\\');
         }
     }
 
-    std::optional<std::wstring> unknownParentDirectory;  // ensure lifetime to be able to store as wstring_view
-    if (ulLastSegmentNumber != m_pMFT->GetUSNRoot())
-    {
-        // Parent folder was _not_ found, inserting "place holder"
-        unknownParentDirectory = std::wstring();
-        fmt::format_to(std::back_inserter(*unknownParentDirectory), L"__{:016X}__", ulLastSegmentNumber);
-        m_currentFileNameElements.emplace_back(*unknownParentDirectory);
-    }
-
-    m_currentFileName.push_back(L'\\');
-
-    for (auto it = std::rbegin(m_currentFileNameElements); it != std::rend(m_currentFileNameElements); ++it)
-    {
-        m_currentFileName.append(*it);
-        m_currentFileName.push_back(L'\\');
-    }
-
     m_currentFileName.append(fileName);
 
     if (streamName)
@@ -647,41 +1201,6 @@ bool MFTWalker::IsRecordComplete(
     return bIsComplete;
 }
 
-HRESULT MFTWalker::SetCallbacks(const Callbacks& pCallbacks)
-{
-    m_pCallbackCall = [](MFTWalker* pThis, MFTRecord* pRecord, bool& bFreeRecord) {
-        return pThis->SimpleCallCallbackForRecord(pRecord, bFreeRecord);
-    };
-
-    m_Callbacks = pCallbacks;
-
-    if (m_Callbacks.ElementCallback == nullptr)
-    {
-        m_Callbacks.ElementCallback = [](const std::shared_ptr<VolumeReader>&, MFTRecord*) {};
-    }
-
-    if (m_Callbacks.AttributeCallback != nullptr || m_Callbacks.DataCallback != nullptr
-        || m_Callbacks.FileNameAndDataCallback != nullptr || m_Callbacks.DirectoryCallback != nullptr
-        || m_Callbacks.FileNameCallback != nullptr)
-    {
-        m_pCallbackCall = [](MFTWalker* pThis, MFTRecord* pRecord, bool& bFreeRecord) {
-            return pThis->FullCallCallbackForRecord(pRecord, bFreeRecord);
-        };
-    }
-
-    if (m_Callbacks.KeepAliveCallback == nullptr)
-    {
-        m_Callbacks.KeepAliveCallback = [](const std::shared_ptr<VolumeReader>&, MFTRecord*) -> bool { return false; };
-    }
-
-    if (m_Callbacks.ProgressCallback == nullptr)
-    {
-        m_Callbacks.ProgressCallback = [](const ULONG) -> HRESULT { return S_OK; };
-    }
-
-    return S_OK;
-}
-
 HRESULT MFTWalker::ParseI30AndCallback(MFTRecord* pRecord)
 {
     HRESULT hr = E_FAIL;
@@ -709,14 +1228,13 @@ HRESULT MFTWalker::ParseI30AndCallback(MFTRecord* pRecord)
         {
             PFILE_NAME pFileName = (PFILE_NAME)((PBYTE)entry + sizeof(INDEX_ENTRY));
 
-            if (m_Callbacks.I30Callback)
-                m_Callbacks.I30Callback(m_pVolReader, pRecord, entry, pFileName, false);
+            m_pDispatch->CallForI30Entry(pRecord, entry, pFileName, false);
 
             entry = NtfsNextIndexEntry(entry);
         }
     }
 
-    if (pIA != nullptr && m_Callbacks.I30Callback != nullptr)
+    if (pIA != nullptr && m_pDispatch->Wants(Hook::I30Entry))
     {
         ULONGLONG ToRead = 0ULL;
         if (FAILED(hr = pIA->DataSize(m_pVolReader, ToRead)))
@@ -725,97 +1243,81 @@ HRESULT MFTWalker::ParseI30AndCallback(MFTRecord* pRecord)
             return hr;
         }
 
-        UINT i = 0L;
+        const auto ullDirectory = pRecord->GetSafeMFTSegmentNumber();
+        const ULONG ulSizePerIndex = pIR != nullptr ? pIR->SizePerIndex() : 0L;
+        if (ulSizePerIndex == 0L || !pIA->IsNonResident())
+        {
+            Log::Error(L"Invalid $INDEX_ALLOCATION for record {:#x}", ullDirectory);
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
 
-        if (FAILED(
-                hr = pRecord->EnumData(
-                    m_pVolReader,
-                    pIA,
-                    0ULL,
-                    ToRead,
-                    pIR->SizePerIndex(),
-                    [this, pBM, pIR, &hr, pRecord, &i](ULONGLONG ullBufferStartOffset, CBinaryBuffer& Data) -> HRESULT {
-                        DBG_UNREFERENCED_PARAMETER(ullBufferStartOffset);
-                        PINDEX_ALLOCATION_BUFFER pIABuff = (PINDEX_ALLOCATION_BUFFER)Data.GetData();
+        const ULONGLONG ullWindowSize = std::max<ULONGLONG>(1ULL, I30_PREFETCH_WINDOW / ulSizePerIndex) * ulSizePerIndex;
 
-                        if ((*pBM)[i])
-                        {
-                            if (FAILED(hr = MFTUtils::MultiSectorFixup(pIABuff, pIR->SizePerIndex(), m_pVolReader)))
-                            {
-                                if (HRESULT_FROM_NT(NTE_BAD_SIGNATURE) != hr)
-                                {
-                                    Log::Error(L"Failed to fixup $INDEX_ALLOCATION header");
-                                    return hr;
-                                }
-                            }
-                            else
-                            {
-                                PINDEX_HEADER pHeader = &(pIABuff->IndexHeader);
-                                PINDEX_ENTRY pEntry = (PINDEX_ENTRY)NtfsFirstIndexEntry(pHeader);
-                                while (!(pEntry->Flags & INDEX_ENTRY_END))
-                                {
-                                    PFILE_NAME pFileName = (PFILE_NAME)((PBYTE)pEntry + sizeof(INDEX_ENTRY));
+        std::vector<BYTE> window;
+        std::vector<I30Block> blocks;
+        ULONGLONG ullFirstBlock = 0ULL;
 
-                                    m_Callbacks.I30Callback(m_pVolReader, pRecord, pEntry, pFileName, false);
+        for (ULONGLONG ullOffset = 0ULL; ullOffset < ToRead; ullOffset += ullWindowSize)
+        {
+            const ULONGLONG ullBytes = std::min(ullWindowSize, ToRead - ullOffset);
+            const size_t blockCount = static_cast<size_t>((ullBytes + ulSizePerIndex - 1) / ulSizePerIndex);
 
-                                    pEntry = NtfsNextIndexEntry(pEntry);
-                                }
+            window.assign(blockCount * ulSizePerIndex, 0);
+            if (FAILED(hr = ReadIndexAllocation(m_pVolReader, pIA, ullOffset, ullBytes, window)))
+            {
+                Log::Error(L"Failed to read from $INDEX_ALLOCATION [{}]", SystemError(hr));
+                return hr;
+            }
 
-                                LPBYTE pFirstFreeByte =
-                                    (((LPBYTE)NtfsFirstIndexEntry(pHeader)) + pHeader->FirstFreeByte);
+            blocks.clear();
+            blocks.resize(blockCount);
 
-                                while (pFirstFreeByte + sizeof(FILE_NAME) < Data.GetData() + Data.GetCount())
-                                {
-                                    PFILE_NAME pCarvedFileName = (PFILE_NAME)pFirstFreeByte;
+            auto parseBlock = [&](size_t j) {
+                const auto ullIndex = ullFirstBlock + j;
+                const bool bInUse = pBM == nullptr
+                    || (ullIndex < pBM->Bits().size()
+                        && (*pBM)[static_cast<BitmapAttribute::block_type>(ullIndex)]);
 
-                                    if (NtfsFullSegmentNumber(&pCarvedFileName->ParentDirectory)
-                                        == pRecord->GetSafeMFTSegmentNumber())
-                                    {
-                                        PINDEX_ENTRY pEntry =
-                                            (PINDEX_ENTRY)((LPBYTE)pCarvedFileName - sizeof(INDEX_ENTRY));
-                                        m_Callbacks.I30Callback(m_pVolReader, pRecord, pEntry, pCarvedFileName, true);
-                                    }
-                                    pFirstFreeByte++;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            Log::Debug(
-                                L"Index {} of $INDEX_ALLOCATION is not in use (FRN: {:#x}) only carving...",
-                                i,
-                                NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()));
+                if (!bInUse)
+                {
+                    Log::Debug(
+                        L"Index {} of $INDEX_ALLOCATION is not in use (FRN: {:#x}) only carving...",
+                        ullIndex,
+                        NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()));
+                }
 
-                            if (FAILED(hr = MFTUtils::MultiSectorFixup(pIABuff, pIR->SizePerIndex(), m_pVolReader)))
-                            {
-                                Log::Debug("Failed to fixup carved $INDEX_ALLOCATION [{}]", SystemError(hr));
-                                return S_OK;
-                            }
-                            else
-                            {
-                                LPBYTE pFirstFreeByte = (LPBYTE)pIABuff;
+                blocks[j].hr = ParseIndexBlock(
+                    window.data() + j * ulSizePerIndex,
+                    ulSizePerIndex,
+                    bInUse,
+                    ullDirectory,
+                    m_pVolReader,
+                    blocks[j].Entries);
+            };
 
-                                while (pFirstFreeByte + sizeof(FILE_NAME) < Data.GetData() + Data.GetCount())
-                                {
-                                    PFILE_NAME pCarvedFileName = (PFILE_NAME)pFirstFreeByte;
+            // Fixups and entry parsing only touch the block they work on, callbacks stay on the walking thread
+            if (blockCount >= I30_PARALLEL_MIN_BLOCKS)
+                TaskPool::ParallelFor(TaskPool::Subsystem::Walk, size_t(0), blockCount, parseBlock);
+            else
+            {
+                for (size_t j = 0; j < blockCount; j++)
+                    parseBlock(j);
+            }
 
-                                    if (NtfsFullSegmentNumber(&pCarvedFileName->ParentDirectory)
-                                        == pRecord->GetSafeMFTSegmentNumber())
-                                    {
-                                        PINDEX_ENTRY pEntry =
-                                            (PINDEX_ENTRY)((LPBYTE)pCarvedFileName - sizeof(INDEX_ENTRY));
-                                        m_Callbacks.I30Callback(m_pVolReader, pRecord, pEntry, pCarvedFileName, true);
-                                    }
-                                    pFirstFreeByte++;
-                                }
-                            }
-                        }
-                        i++;
-                        return S_OK;
-                    })))
-        {
-            Log::Error(L"Failed to read from $INDEX_ALLOCATION [{}]", SystemError(hr));
-            return hr;
+            // All the entries of the directory are delivered in block order, as the sequential parsing did
+            for (const auto& block : blocks)
+            {
+                if (FAILED(block.hr))
+                {
+                    Log::Error(L"Failed to fixup $INDEX_ALLOCATION header [{}]", SystemError(block.hr));
+                    return block.hr;
+                }
+
+                for (const auto& entry : block.Entries)
+                    m_pDispatch->CallForI30Entry(pRecord, entry.pEntry, entry.pFileName, entry.bCarved);
+            }
+
+            ullFirstBlock += blockCount;
         }
     }
     return S_OK;
@@ -869,13 +1371,20 @@ HRESULT MFTWalker::Parse$SecureAndCallback(MFTRecord* pRecord)
         return hr;
     }
 
+    // SecurityId and offset in $SDS of the entries of $SII
+    std::vector<std::pair<ULONG, ULONGLONG>> securityIds;
+
     if (pIR != nullptr)
     {
         PINDEX_ENTRY entry = pIR->FirstIndexEntry();
 
         while (!(entry->Flags & INDEX_ENTRY_END))
         {
-            // PBYTE pFileName = (PBYTE) ((PBYTE) entry + sizeof(INDEX_ENTRY));
+            if (m_pSecurityDescriptors != nullptr)
+            {
+                const auto pEntry = (PSECURITY_DESCRIPTOR_INDEX_ENTRY)entry;
+                securityIds.emplace_back(pEntry->SecId_Key, pEntry->SecurityDescriptorOffset);
+            }
 
             entry = NtfsNextIndexEntry(entry);
         }
@@ -898,7 +1407,7 @@ HRESULT MFTWalker::Parse$SecureAndCallback(MFTRecord* pRecord)
                     0ULL,
                     ToRead,
                     pIR->SizePerIndex(),
-                    [this, pBM, pIR, &hr, pRecord, &i, &SDS](
+                    [this, pBM, pIR, &hr, pRecord, &i, &SDS, &securityIds](
                         ULONGLONG ullBufferStartOffset, CBinaryBuffer& Data) -> HRESULT {
                         DBG_UNREFERENCED_PARAMETER(ullBufferStartOffset);
                         PINDEX_ALLOCATION_BUFFER pIABuff = (PINDEX_ALLOCATION_BUFFER)Data.GetData();
@@ -920,8 +1429,11 @@ HRESULT MFTWalker::Parse$SecureAndCallback(MFTRecord* pRecord)
                                     PSECURITY_DESCRIPTOR_ENTRY pSDSEntry =
                                         (PSECURITY_DESCRIPTOR_ENTRY)&SDS.Get<BYTE>(pEntry->SecurityDescriptorOffset);
 
-                                    if (m_Callbacks.SecDescCallback != nullptr)
-                                        m_Callbacks.SecDescCallback(m_pVolReader, pSDSEntry);
+                                    if (m_pDispatch->Wants(Hook::SecurityDescriptor))
+                                        m_pDispatch->CallForSecurityDescriptor(pSDSEntry);
+
+                                    if (m_pSecurityDescriptors != nullptr)
+                                        securityIds.emplace_back(pEntry->SecId_Key, pEntry->SecurityDescriptorOffset);
 
                                     pEntry = NtfsNextSecDescIndexEntry(pEntry);
                                 }
@@ -934,168 +1446,49 @@ HRESULT MFTWalker::Parse$SecureAndCallback(MFTRecord* pRecord)
             return hr;
         }
     }
-    return S_OK;
-}
-
-HRESULT MFTWalker::SimpleCallCallbackForRecord(MFTRecord* pRecord, bool& bFreeRecord)
-{
-    if (NtfsSegmentNumber(&pRecord->m_pRecord->BaseFileRecordSegment) > 0)
-        return S_OK;  // we don't call the callbacks on child records...
-
-    HRESULT hr = S_OK;
 
-    if (!pRecord->HasCallbackBeenCalled())
+    if (m_pSecurityDescriptors != nullptr)
     {
-        m_dwWalkedItems++;
-
-        m_Callbacks.ElementCallback(m_pVolReader, pRecord);
-
-        if (m_Callbacks.I30Callback && pRecord->IsDirectory())
-        {
-            HRESULT hr = E_FAIL;
-            if (FAILED(hr = ParseI30AndCallback(pRecord)))
-            {
-                Log::Error(
-                    L"Failed to parse $I30 for record {:#x} [{}]",
-                    NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()),
-                    SystemError(hr));
-            }
-        }
-
-        bFreeRecord = !m_Callbacks.KeepAliveCallback(m_pVolReader, pRecord);
-
-        hr = m_Callbacks.ProgressCallback((DWORD)((m_dwWalkedItems * 100) / m_ulMFTRecordCount));
+        m_pSecurityDescriptors->Load(std::move(SDS));
+        for (const auto& [ulSecurityId, ullOffset] : securityIds)
+            m_pSecurityDescriptors->Add(ulSecurityId, ullOffset);
 
-        pRecord->CallbackCalled();
+        Log::Debug(L"Loaded {} security descriptors from $Secure", m_pSecurityDescriptors->size());
     }
-
-    pRecord->CleanCachedData();
-    return hr;
+    return S_OK;
 }
 
-HRESULT MFTWalker::FullCallCallbackForRecord(MFTRecord* pRecord, bool& bFreeRecord)
+void MFTWalker::ParseI30AndLog(MFTRecord* pRecord)
 {
-    if (NtfsSegmentNumber(&pRecord->m_pRecord->BaseFileRecordSegment) > 0)
-        return S_OK;  // we don't call the callbacks on child records...
-
-    HRESULT hr = S_OK;
-
-    if (!pRecord->HasCallbackBeenCalled())
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = ParseI30AndCallback(pRecord)))
     {
-        m_dwWalkedItems++;
-
-        if (m_Callbacks.ElementCallback)
-            m_Callbacks.ElementCallback(m_pVolReader, pRecord);
-
-        if (m_Callbacks.AttributeCallback)
-        {
-            for (const auto& iter : pRecord->GetAttributeList())
-            {
-                if (m_Callbacks.AttributeCallback)
-                    m_Callbacks.AttributeCallback(m_pVolReader, pRecord, iter);
-            }
-        }
-
-        if (pRecord->m_FileNames.empty() && m_Callbacks.DataCallback)
-        {
-            if (!pRecord->GetDataAttributes().empty())
-            {
-                // This record has Data attributes (but no $FILENAME).
-                for (const auto& iter2 : pRecord->m_DataAttrList)
-                {
-                    shared_ptr<DataAttribute> pDataAttr = iter2;
-                    bool bInSpecificLocation = false;
-                    const WCHAR* pFullName = GetFullNameAndIfInLocation(NULL, pDataAttr, NULL, &bInSpecificLocation);
-                    if (pFullName && bInSpecificLocation)
-                    {
-                        m_Callbacks.DataCallback(m_pVolReader, pRecord, pDataAttr);
-                    }
-                }
-            }
-        }
-        else if (
-            m_Callbacks.FileNameCallback || m_Callbacks.DirectoryCallback || m_Callbacks.FileNameAndDataCallback
-            || m_Callbacks.DataCallback)
-        {
-            // "standard" case
-            for (const auto& name : pRecord->m_FileNames)
-            {
-                bool bInSpecificLocation = false;
-                const WCHAR* pFullName = GetFullNameAndIfInLocation(name, NULL, NULL, &bInSpecificLocation);
-
-                if (m_Callbacks.FileNameCallback && bInSpecificLocation)
-                    m_Callbacks.FileNameCallback(m_pVolReader, pRecord, name);
-
-                if (bInSpecificLocation
-                    && (m_Callbacks.FileNameAndDataCallback || m_Callbacks.DirectoryCallback || m_Callbacks.I30Callback)
-                    && pRecord->IsDirectory())
-                {
-                    if (m_Callbacks.DirectoryCallback)
-                        m_Callbacks.DirectoryCallback(
-                            m_pVolReader, pRecord, name, pRecord->GetIndexAllocationAttribute(L"$I30"));
-
-                    // This record is a directory and has Data attributes (i.e. ADS).
-                    if (m_Callbacks.FileNameAndDataCallback)
-                    {
-                        for (const auto& data : pRecord->m_DataAttrList)
-                        {
-                            if (pFullName && m_Callbacks.FileNameAndDataCallback)
-                                m_Callbacks.FileNameAndDataCallback(m_pVolReader, pRecord, name, data);
-                        }
-                    }
-
-                    if (m_Callbacks.I30Callback)
-                    {
-                        HRESULT hr = E_FAIL;
-                        if (FAILED(hr = ParseI30AndCallback(pRecord)))
-                        {
-                            Log::Error(
-                                "Failed to parse $I30 for record 0x{} [{}]",
-                                NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()),
-                                SystemError(hr));
-                        }
-                    }
-                }
-                else if (bInSpecificLocation && pRecord->m_DataAttrList.size() && m_Callbacks.FileNameAndDataCallback)
-                {
-                    // This record has Data attributes.
-                    for (const auto& data : pRecord->m_DataAttrList)
-                    {
-                        if (pFullName && m_Callbacks.FileNameAndDataCallback)
-                            m_Callbacks.FileNameAndDataCallback(m_pVolReader, pRecord, name, data);
-                    }
-                }
-            }
-            if (pRecord->m_DataAttrList.size() && m_Callbacks.DataCallback)
-            {
-                // This record has Data attributes.
-                for (auto data_iter = pRecord->m_DataAttrList.begin(); data_iter != pRecord->m_DataAttrList.end();
-                     ++data_iter)
-                {
-                    if (m_Callbacks.DataCallback)
-                        m_Callbacks.DataCallback(m_pVolReader, pRecord, *data_iter);
-                }
-            }
-        }
-
-        bFreeRecord = !m_Callbacks.KeepAliveCallback(m_pVolReader, pRecord);
-
-        hr = m_Callbacks.ProgressCallback((DWORD)((m_dwWalkedItems * 100) / m_ulMFTRecordCount));
-
-        pRecord->CallbackCalled();
+        Log::Error(
+            L"Failed to parse $I30 for record {:#x} [{}]",
+            NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()),
+            SystemError(hr));
     }
-
-    pRecord->CleanCachedData();
-
-    return hr;
 }
 
 HRESULT MFTWalker::WalkRecords(bool bIsFinalWalk)
 {
     HRESULT hr = E_FAIL;
 
+    Telemetry::Scope telemetry(Telemetry::Phase::MFTWalk);
+    telemetry.AddBytes(m_MFTMap.size() * m_pVolReader->GetBytesPerFRS());
+
     Log::Debug("Loading MFT done, now walking what is left in the map");
 
+    if (bIsFinalWalk && m_resurrectRecordMode != ResurrectRecordsMode::kNo)
+    {
+        if (FAILED(hr = ResolveFinalWalkNames()))
+        {
+            Log::Debug(
+                "Failed to resolve names before the final walk, they are resolved while walking [{}]",
+                SystemError(hr));
+        }
+    }
+
     for (auto iter = begin(m_MFTMap); iter != end(m_MFTMap); ++iter)
     {
         MFTUtils::SafeMFTSegmentNumber RefNumber = iter->first;
@@ -1158,7 +1551,7 @@ HRESULT MFTWalker::WalkRecords(bool bIsFinalWalk)
         {
             Log::Trace("Calling callback for record {}", RefNumber);
 
-            if (m_Callbacks.SecDescCallback != nullptr
+            if ((m_pDispatch->Wants(Hook::SecurityDescriptor) || m_pSecurityDescriptors != nullptr)
                 && NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()) == $SECURE_FILE_REFERENCE_NUMBER)
             {
                 if (FAILED(hr = Parse$SecureAndCallback(pRecord)))
@@ -1166,7 +1559,7 @@ HRESULT MFTWalker::WalkRecords(bool bIsFinalWalk)
                     Log::Trace("Failed to parse $Secure {} [{}]", RefNumber, SystemError(hr));
                 }
             }
-            if (FAILED(hr = m_pCallbackCall(this, pRecord, bFreeRecord)))
+            if (FAILED(hr = m_pDispatch->CallForRecord(pRecord, bFreeRecord)))
             {
                 if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
                 {
@@ -1198,6 +1591,182 @@ HRESULT MFTWalker::WalkRecords(bool bIsFinalWalk)
     return S_OK;
 }
 
+bool MFTWalker::BuildDirectoryPath(MFTUtils::SafeMFTSegmentNumber ullDirectory, std::wstring& path, bool& bRooted) const
+{
+    // Read only counterpart of GetDirectoryPath which workers may call concurrently: nothing is memoized here
+    std::vector<PFILE_NAME> chain;
+
+    path.clear();
+    bRooted = false;
+
+    for (auto current = ullDirectory;;)
+    {
+        if (current == m_pMFT->GetUSNRoot())
+        {
+            path = L"\\";
+            bRooted = true;
+            break;
+        }
+
+        const auto it = m_DirectoryNames.find(current);
+        if (it == end(m_DirectoryNames) || it->second.FileName() == nullptr)
+        {
+            // Same place holder as GetFullNameAndIfInLocation for the first missing ancestor
+            fmt::format_to(std::back_inserter(path), L"\\__{:016X}__\\", current);
+            break;
+        }
+
+        if (it->second.m_FullPath.has_value())
+        {
+            path = *it->second.m_FullPath;
+            bRooted = true;
+            break;
+        }
+
+        if (chain.size() >= DIRECTORY_MAX_DEPTH)
+            return false;
+
+        chain.push_back(it->second.FileName());
+        current = NtfsFullSegmentNumber(&(chain.back()->ParentDirectory));
+    }
+
+    for (auto it = std::crbegin(chain); it != std::crend(chain); ++it)
+    {
+        const auto pName = *it;
+        if (pName->FileNameLength == 1 && *pName->FileName == L'.')
+            continue;
+
+        path.append(pName->FileName, pName->FileNameLength);
+        path.push_back(L'\\');
+    }
+
+    return true;
+}
+
+HRESULT MFTWalker::ResolveFinalWalkNames()
+{
+    struct ResolvedPath
+    {
+        MFTUtils::SafeMFTSegmentNumber ullDirectory;
+        std::wstring Path;
+        bool bRooted;
+    };
+
+    auto forEachRange = [](size_t rangeCount, const auto& fn) {
+        if (rangeCount >= RESURRECT_PARALLEL_MIN_RANGES)
+            TaskPool::ParallelFor(TaskPool::Subsystem::Walk, size_t(0), rangeCount, fn);
+        else
+        {
+            for (size_t i = 0; i < rangeCount; i++)
+                fn(i);
+        }
+    };
+
+    try
+    {
+        // Base records left by the intermediate walks, by increasing segment number: mostly deleted and orphaned ones
+        std::vector<MFTRecord*> records;
+        records.reserve(m_MFTMap.size());
+        for (auto iter = begin(m_MFTMap); iter != end(m_MFTMap); ++iter)
+        {
+            MFTRecord* pRecord = iter->second;
+            if (pRecord != nullptr && pRecord->m_pRecord != nullptr && pRecord->IsParsed()
+                && NtfsSegmentNumber(&pRecord->m_pRecord->BaseFileRecordSegment) == 0
+                && !pRecord->HasCallbackBeenCalled())
+                records.push_back(pRecord);
+        }
+
+        if (records.empty())
+            return S_OK;
+
+        // Classification: completeness is computed once, the parents of the names are the directories to resolve.
+        // Both tables are only read until every worker is done.
+        const auto recordRanges = (records.size() + RESURRECT_RECORDS_PER_RANGE - 1) / RESURRECT_RECORDS_PER_RANGE;
+        std::vector<std::vector<MFTUtils::SafeMFTSegmentNumber>> parents(recordRanges);
+
+        forEachRange(recordRanges, [&](size_t range) {
+            std::vector<MFT_SEGMENT_REFERENCE> missingRecords;
+            const auto last = std::min(records.size(), (range + 1) * RESURRECT_RECORDS_PER_RANGE);
+
+            for (size_t i = range * RESURRECT_RECORDS_PER_RANGE; i < last; i++)
+            {
+                IsRecordComplete(records[i], missingRecords, false, false);
+                missingRecords.clear();
+
+                for (const auto pFileName : records[i]->GetFileNames())
+                    parents[range].push_back(NtfsFullSegmentNumber(&pFileName->ParentDirectory));
+            }
+
+            std::sort(std::begin(parents[range]), std::end(parents[range]));
+            parents[range].erase(
+                std::unique(std::begin(parents[range]), std::end(parents[range])), std::end(parents[range]));
+        });
+
+        std::vector<MFTUtils::SafeMFTSegmentNumber> directories;
+        for (auto& range : parents)
+        {
+            directories.insert(std::end(directories), std::cbegin(range), std::cend(range));
+            range = {};
+        }
+        std::sort(std::begin(directories), std::end(directories));
+        directories.erase(std::unique(std::begin(directories), std::end(directories)), std::end(directories));
+
+        // Parent chains are followed concurrently, paths are interned afterwards on this thread
+        const auto directoryRanges =
+            (directories.size() + RESURRECT_RECORDS_PER_RANGE - 1) / RESURRECT_RECORDS_PER_RANGE;
+        std::vector<std::vector<ResolvedPath>> resolved(directoryRanges);
+
+        forEachRange(directoryRanges, [&](size_t range) {
+            const auto last = std::min(directories.size(), (range + 1) * RESURRECT_RECORDS_PER_RANGE);
+
+            for (size_t i = range * RESURRECT_RECORDS_PER_RANGE; i < last; i++)
+            {
+                const auto it = std::as_const(m_DirectoryNames).find(directories[i]);
+                if (it == std::cend(m_DirectoryNames) || it->second.m_FullPath.has_value()
+                    || it->second.m_OrphanPath.has_value())
+                    continue;
+
+                ResolvedPath path {directories[i], {}, false};
+                if (BuildDirectoryPath(directories[i], path.Path, path.bRooted))
+                    resolved[range].push_back(std::move(path));
+            }
+        });
+
+        ULONG ulRooted = 0L, ulOrphans = 0L;
+        for (const auto& range : resolved)
+        {
+            for (const auto& path : range)
+            {
+                auto it = m_DirectoryNames.find(path.ullDirectory);
+                const auto interned = m_DirectoryPaths.Intern(std::wstring_view(path.Path));
+
+                if (path.bRooted)
+                {
+                    it->second.m_FullPath = interned;
+                    ulRooted++;
+                }
+                else
+                {
+                    it->second.m_OrphanPath = interned;
+                    ulOrphans++;
+                }
+            }
+        }
+
+        Log::Debug(
+            L"Final walk: {} records left, {} directory paths resolved ({} orphaned)",
+            records.size(),
+            ulRooted + ulOrphans,
+            ulOrphans);
+    }
+    catch (const std::bad_alloc&)
+    {
+        return E_OUTOFMEMORY;
+    }
+
+    return S_OK;
+}
+
 HRESULT MFTWalker::DeleteRecord(MFTRecord* pRecord)
 {
     _ASSERT(pRecord != nullptr);
@@ -1269,8 +1838,11 @@ HRESULT MFTWalker::AddDirectoryName(MFTRecord* pRecord)
     return S_OK;
 }
 
-HRESULT
-MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data, MFTRecord*& pAddedRecord)
+HRESULT MFTWalker::AddRecord(
+    MFTUtils::SafeMFTSegmentNumber& ullRecordIndex,
+    CBinaryBuffer& Data,
+    MFTRecord*& pAddedRecord,
+    bool bIsMultiSectorFixed)
 {
     HRESULT hr = E_FAIL;
 
@@ -1293,24 +1865,13 @@ MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuff
             return S_OK;
         }
 
-        MFT_SEGMENT_REFERENCE SafeReference;
-
         if (pHeader->MultiSectorHeader.UpdateSequenceArrayOffset == 0x2A && pHeader->FirstAttributeOffset == 0x30)
         {
             Log::Debug("Weird case of NTFS from 2K upgraded to XP");
-            ULARGE_INTEGER FRN {0};
-            FRN.QuadPart = ullRecordIndex;
-            SafeReference.SegmentNumberLowPart = FRN.LowPart;
-            SafeReference.SegmentNumberHighPart = static_cast<USHORT>(FRN.HighPart);
-            SafeReference.SequenceNumber = pHeader->SequenceNumber;
-        }
-        else
-        {
-            SafeReference.SegmentNumberHighPart = pHeader->SegmentNumberHighPart;
-            SafeReference.SegmentNumberLowPart = pHeader->SegmentNumberLowPart;
-            SafeReference.SequenceNumber = pHeader->SequenceNumber;
         }
 
+        MFT_SEGMENT_REFERENCE SafeReference = ::SegmentReference(pHeader, ullRecordIndex);
+
         MFTUtils::SafeMFTSegmentNumber SafeFRN = NtfsFullSegmentNumber(&SafeReference);
 
         const auto pIter = m_MFTMap.find(SafeFRN);
@@ -1324,9 +1885,16 @@ MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuff
         MFTRecord* pRecord = nullptr;
         if (pIter == end(m_MFTMap))
         {
-            if (m_SegmentStore.AllocatedCells() >= m_CellStoreLastWalk + m_CellStoreThreshold)
+            // Over the soft limit, complete records are walked and released as soon as about a slab worth of cells
+            // were allocated since the last walk
+            const auto cells = m_SegmentStore.AllocatedCells();
+            const auto cellsSinceLastWalk = cells > m_CellStoreLastWalk ? cells - m_CellStoreLastWalk : 0;
+            if (cellsSinceLastWalk >= m_CellStoreThreshold
+                || (cellsSinceLastWalk >= m_CellStoreThreshold / 16
+                    && MemoryAccounting::IsOverSoftLimit(MemoryAccounting::Tag::MFTWalk)))
             {
                 WalkRecords(false);
+                m_SegmentStore.ReleaseEmptySlabs();
                 m_CellStoreLastWalk = m_SegmentStore.AllocatedCells();
             }
 
@@ -1341,6 +1909,7 @@ MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuff
             {
                 // We walk through FILES for our already recorded nodes with hope this will free some space
                 WalkRecords(false);
+                m_SegmentStore.ReleaseEmptySlabs();
                 pBuf = m_SegmentStore.GetNewCell();
                 pRecord = new (pBuf) MFTRecord;
                 if (pRecord == NULL)
@@ -1359,6 +1928,8 @@ MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuff
                 m_pVolReader->GetBytesPerFRS());
 
             pRecord->m_FileReferenceNumber = SafeReference;
+            pRecord->m_bIsMultiSectorFixed = bIsMultiSectorFixed;
+            pRecord->m_bDeferAttributes = m_bDeferAttributes;
         }
         else
         {
@@ -1552,16 +2123,25 @@ MFTWalker::AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuff
     return S_OK;
 }
 
-HRESULT MFTWalker::AddRecordCallback(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data)
+HRESULT MFTWalker::AddRecordCallback(
+    MFTUtils::SafeMFTSegmentNumber& ullRecordIndex,
+    CBinaryBuffer& Data,
+    bool bIsMultiSectorFixed)
 {
     HRESULT hr = E_FAIL;
 
     try
     {
+        if (CanSkipUnchangedRecord(ullRecordIndex, Data))
+        {
+            // Same record on the live volume, not needed to build any name: not even parsed
+            m_ullSkippedUnchangedRecords++;
+            return S_OK;
+        }
 
         MFTRecord* pRecord = nullptr;
 
-        if (FAILED(hr = AddRecord(ullRecordIndex, Data, pRecord)))
+        if (FAILED(hr = AddRecord(ullRecordIndex, Data, pRecord, bIsMultiSectorFixed)))
         {
             Log::Error("Failed to add record {} [{}]", ullRecordIndex, SystemError(hr));
             return hr;
@@ -1696,7 +2276,7 @@ HRESULT MFTWalker::AddRecordCallback(MFTUtils::SafeMFTSegmentNumber& ullRecordIn
                 return S_OK;
             }
 
-            if (m_Callbacks.SecDescCallback != nullptr
+            if ((m_pDispatch->Wants(Hook::SecurityDescriptor) || m_pSecurityDescriptors != nullptr)
                 && NtfsFullSegmentNumber(&pRecord->GetFileReferenceNumber()) == $SECURE_FILE_REFERENCE_NUMBER)
             {
                 if (FAILED(hr = Parse$SecureAndCallback(pRecord)))
@@ -1710,7 +2290,7 @@ HRESULT MFTWalker::AddRecordCallback(MFTUtils::SafeMFTSegmentNumber& ullRecordIn
 
             bool bFreeRecord = false;
 
-            if (FAILED(hr = m_pCallbackCall(this, pRecord, bFreeRecord)))
+            if (FAILED(hr = m_pDispatch->CallForRecord(pRecord, bFreeRecord)))
             {
                 if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
                 {
@@ -1750,29 +2330,779 @@ HRESULT MFTWalker::AddRecordCallback(MFTUtils::SafeMFTSegmentNumber& ullRecordIn
     return S_OK;
 }
 
+HRESULT MFTWalker::EnumMFTRecordPipelined()
+{
+    const ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
+    const ULONG ulBytesPerSector = m_pVolReader->GetBytesPerSector();
+    const size_t batchCount = m_dwPipelineWorkers * PIPELINE_BATCHES_PER_WORKER;
+
+    Log::Debug(
+        L"Pipelined MFT walk: {} workers, {} batches of {} records{}",
+        m_dwPipelineWorkers,
+        batchCount,
+        PIPELINE_FRS_PER_BATCH,
+        m_bPipelineOutOfOrder ? L" (out of order)" : L"");
+
+    // Batches are recycled through the free queue which bounds the memory used by the pipeline
+    BlockingQueue<std::unique_ptr<FRSBatch>> freeBatches(batchCount);
+    BlockingQueue<std::unique_ptr<FRSBatch>> toFix(batchCount);
+    BlockingQueue<std::unique_ptr<FRSBatch>> fixed(batchCount);
+
+    try
+    {
+        for (size_t i = 0; i < batchCount; i++)
+        {
+            auto batch = std::make_unique<FRSBatch>();
+            batch->Indexes.reserve(PIPELINE_FRS_PER_BATCH);
+            batch->Records.reserve(PIPELINE_FRS_PER_BATCH);
+            batch->Data.resize(static_cast<size_t>(ulBytesPerFRS) * PIPELINE_FRS_PER_BATCH);
+            freeBatches.Push(std::move(batch));
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        Log::Error("Failed to allocate MFT pipeline batches");
+        return E_OUTOFMEMORY;
+    }
+
+    std::atomic<bool> bStop = false;
+    HRESULT hrEnum = S_OK;
+
+    std::thread reader([&]() {
+        try
+        {
+            std::unique_ptr<FRSBatch> batch;
+            ULONGLONG ullSequence = 0LL;
+
+            auto flush = [&]() -> bool {
+                if (batch == nullptr || batch->Indexes.empty())
+                    return true;
+
+                batch->ullSequence = ullSequence++;
+                return toFix.Push(std::move(batch));
+            };
+
+            hrEnum = m_pMFT->EnumMFTRecord(
+                [&](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
+                    if (bStop)
+                        return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+
+                    if (batch == nullptr)
+                    {
+                        auto next = freeBatches.Pop();
+                        if (!next.has_value())
+                            return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+
+                        batch = std::move(*next);
+                        batch->Indexes.clear();
+                    }
+
+                    memcpy_s(
+                        batch->Data.data() + batch->Indexes.size() * ulBytesPerFRS,
+                        ulBytesPerFRS,
+                        Data.GetData(),
+                        std::min<size_t>(Data.GetCount(), ulBytesPerFRS));
+                    batch->Indexes.push_back(ullRecordIndex);
+
+                    if (batch->Indexes.size() == PIPELINE_FRS_PER_BATCH && !flush())
+                        return HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+
+                    return S_OK;
+                });
+
+            flush();
+        }
+        catch (const std::exception& e)
+        {
+            Log::Error("MFT pipeline reader threw exception '{}'", e.what());
+            hrEnum = E_FAIL;
+        }
+        catch (...)
+        {
+            Log::Error("MFT pipeline reader threw an exception");
+            hrEnum = E_FAIL;
+        }
+
+        toFix.Close();
+    });
+
+    std::atomic<DWORD> dwRunningWorkers = m_dwPipelineWorkers;
+    std::atomic<ULONGLONG> ullFixedRecords = 0LL;
+    std::atomic<ULONGLONG> ullSkippedRecords = 0LL;
+
+    // Free records are only parsed to be resurrected
+    const bool bKeepFree = m_resurrectRecordMode != ResurrectRecordsMode::kNo;
+
+    std::vector<std::thread> workers;
+
+    for (DWORD i = 0; i < m_dwPipelineWorkers; i++)
+    {
+        workers.emplace_back([&]() {
+            while (auto batch = toFix.Pop())
+            {
+                auto& frsBatch = **batch;
+
+                MFTRecordBatch::Statistics statistics;
+                MFTRecordBatch::Fixup(
+                    frsBatch.Data.data(),
+                    static_cast<ULONG>(frsBatch.Indexes.size()),
+                    ulBytesPerFRS,
+                    ulBytesPerSector,
+                    bKeepFree,
+                    frsBatch.Records,
+                    statistics);
+
+                ullFixedRecords += statistics.InUse + (bKeepFree ? statistics.Free : 0LL);
+                ullSkippedRecords += statistics.NoSignature + (bKeepFree ? 0LL : statistics.Free);
+
+                if (!fixed.Push(std::move(*batch)))
+                    break;
+            }
+
+            if (--dwRunningWorkers == 0)
+                fixed.Close();
+        });
+    }
+
+    HRESULT hr = S_OK;
+
+    auto stop = [&]() {
+        bStop = true;
+        freeBatches.Close();
+        toFix.Close();
+    };
+
+    auto processBatch = [&](std::unique_ptr<FRSBatch>& batch) {
+        for (size_t i = 0; i < batch->Records.size() && !bStop; i++)
+        {
+            const auto& record = batch->Records[i];
+            CBinaryBuffer frs(batch->Data.data() + static_cast<size_t>(record.Index) * ulBytesPerFRS, ulBytesPerFRS);
+
+            if (FAILED(hr = AddRecordCallback(batch->Indexes[record.Index], frs, record.bFixed)))
+            {
+                if (hr == E_OUTOFMEMORY)
+                {
+                    Log::Error("Add Record Callback failed, not enough memory to continue [{}]", SystemError(hr));
+                    stop();
+                }
+                else if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+                {
+                    Log::Debug("Add Record Callback asks for enumeration to stop [{}]", SystemError(hr));
+                    stop();
+                }
+                else
+                {
+                    Log::Warn("Add Record Callback failed [{}]", SystemError(hr));
+                    hr = S_OK;
+                }
+            }
+        }
+
+        m_ullPipelineBatches++;
+        freeBatches.Push(std::move(batch));
+    };
+
+    try
+    {
+        // Batches are delivered by sequence number unless out of order delivery was requested
+        std::map<ULONGLONG, std::unique_ptr<FRSBatch>> pending;
+        ULONGLONG ullNextSequence = 0LL;
+
+        while (auto batch = fixed.Pop())
+        {
+            if (bStop)
+                continue;  // draining
+
+            if (m_bPipelineOutOfOrder)
+            {
+                processBatch(*batch);
+                continue;
+            }
+
+            const auto ullSequence = (*batch)->ullSequence;
+            pending.emplace(ullSequence, std::move(*batch));
+
+            for (auto it = pending.find(ullNextSequence); it != std::end(pending) && !bStop;
+                 it = pending.find(ullNextSequence))
+            {
+                processBatch(it->second);
+                pending.erase(it);
+                ullNextSequence++;
+            }
+        }
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("MFT pipeline threw exception '{}'", e.what());
+        hr = E_FAIL;
+        stop();
+        while (fixed.Pop())
+            ;
+    }
+
+    reader.join();
+    for (auto& worker : workers)
+        worker.join();
+
+    m_ullPipelineFixedRecords += ullFixedRecords;
+    m_ullPipelineSkippedRecords += ullSkippedRecords;
+
+    if (FAILED(hr))
+        return hr;
+
+    return hrEnum;
+}
+
+namespace {
+
+// Calls the callbacks which are set, with the shared pointers they expect
+class CallbacksVisitor
+{
+public:
+    CallbacksVisitor(const MFTWalker::Callbacks& callbacks, const std::shared_ptr<VolumeReader>& volreader)
+        : m_Callbacks(callbacks)
+        , m_pVolReader(volreader)
+    {
+    }
+
+    bool Enabled(MFTWalker::Hook hook) const
+    {
+        switch (hook)
+        {
+            case MFTWalker::Hook::Element:
+                return m_Callbacks.ElementCallback != nullptr;
+            case MFTWalker::Hook::FileName:
+                return m_Callbacks.FileNameCallback != nullptr;
+            case MFTWalker::Hook::Attribute:
+                return m_Callbacks.AttributeCallback != nullptr;
+            case MFTWalker::Hook::Data:
+                return m_Callbacks.DataCallback != nullptr;
+            case MFTWalker::Hook::FileNameAndData:
+                return m_Callbacks.FileNameAndDataCallback != nullptr;
+            case MFTWalker::Hook::Directory:
+                return m_Callbacks.DirectoryCallback != nullptr;
+            case MFTWalker::Hook::I30Entry:
+                return m_Callbacks.I30Callback != nullptr;
+            case MFTWalker::Hook::SecurityDescriptor:
+                return m_Callbacks.SecDescCallback != nullptr;
+            case MFTWalker::Hook::Progress:
+                return m_Callbacks.ProgressCallback != nullptr;
+            case MFTWalker::Hook::KeepAlive:
+                return m_Callbacks.KeepAliveCallback != nullptr;
+        }
+        return false;
+    }
+
+    void OnElement(VolumeReader&, MFTRecord& record) { m_Callbacks.ElementCallback(m_pVolReader, &record); }
+
+    void OnFileName(VolumeReader&, MFTRecord& record, const PFILE_NAME pFileName)
+    {
+        m_Callbacks.FileNameCallback(m_pVolReader, &record, pFileName);
+    }
+
+    void OnAttribute(VolumeReader&, MFTRecord& record, const AttributeListEntry& attr)
+    {
+        m_Callbacks.AttributeCallback(m_pVolReader, &record, attr);
+    }
+
+    void OnData(VolumeReader&, MFTRecord& record, DataAttribute& data)
+    {
+        m_Callbacks.DataCallback(
+            m_pVolReader, &record, std::static_pointer_cast<DataAttribute>(data.shared_from_this()));
+    }
+
+    void OnFileNameAndData(VolumeReader&, MFTRecord& record, const PFILE_NAME pFileName, DataAttribute& data)
+    {
+        m_Callbacks.FileNameAndDataCallback(
+            m_pVolReader, &record, pFileName, std::static_pointer_cast<DataAttribute>(data.shared_from_this()));
+    }
+
+    void OnDirectory(VolumeReader&, MFTRecord& record, const PFILE_NAME pFileName, IndexAllocationAttribute* pI30)
+    {
+        std::shared_ptr<IndexAllocationAttribute> pAttr;
+        if (pI30 != nullptr)
+            pAttr = std::static_pointer_cast<IndexAllocationAttribute>(pI30->shared_from_this());
+
+        m_Callbacks.DirectoryCallback(m_pVolReader, &record, pFileName, pAttr);
+    }
+
+    void OnI30Entry(
+        VolumeReader&,
+        MFTRecord& record,
+        const PINDEX_ENTRY pEntry,
+        const PFILE_NAME pFileName,
+        bool bCarvedEntry)
+    {
+        m_Callbacks.I30Callback(m_pVolReader, &record, pEntry, pFileName, bCarvedEntry);
+    }
+
+    void OnSecurityDescriptor(VolumeReader&, const PSECURITY_DESCRIPTOR_ENTRY& pEntry)
+    {
+        m_Callbacks.SecDescCallback(m_pVolReader, pEntry);
+    }
+
+    HRESULT OnProgress(ULONG ulProgress) { return m_Callbacks.ProgressCallback(ulProgress); }
+
+    bool KeepAlive(VolumeReader&, MFTRecord& record) { return m_Callbacks.KeepAliveCallback(m_pVolReader, &record); }
+
+private:
+    const MFTWalker::Callbacks& m_Callbacks;
+    const std::shared_ptr<VolumeReader>& m_pVolReader;
+};
+
+}  // namespace
+
 HRESULT MFTWalker::Walk(const Callbacks& Callbacks)
+{
+    CallbacksVisitor visitor(Callbacks, m_pVolReader);
+    return Walk(visitor);
+}
+
+HRESULT MFTWalker::WalkWith(RecordDispatch& dispatch)
 {
     HRESULT hr = E_FAIL;
 
-    if (FAILED(hr = SetCallbacks(Callbacks)))
-        return hr;
+    m_pDispatch = &dispatch;
+
+    // Element and I30 hooks get records whose attributes are built on first access (FileFind name terms usually never
+    // access them), the other hooks walk the attributes of every record
+    m_bDeferAttributes = (dispatch.m_dwHooks & Detail::kRecordContentHooks) == 0;
 
     m_ulMFTRecordCount = GetMFTRecordCount();
 
     if (m_ulMFTRecordCount > 0)
     {
-        hr = m_pMFT->EnumMFTRecord(
-            [this](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
-                return AddRecordCallback(ullRecordIndex, Data);
+        m_MFTMap.reserve(m_ulMFTRecordCount);
+        m_DirectoryNames.reserve(m_ulMFTRecordCount);
+
+        if (m_dwPipelineWorkers > 0)
+        {
+            hr = EnumMFTRecordPipelined();
+        }
+        else
+        {
+            hr = m_pMFT->EnumMFTRecord(
+                [this](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
+                    return AddRecordCallback(ullRecordIndex, Data);
+                });
+        }
+    }
+
+    // ERROR_NO_MORE_FILES: no more enumeration nor walking...
+    if (hr != HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+        hr = WalkRecords(true);
+
+    m_pDispatch = nullptr;
+    return hr;
+}
+
+HRESULT MFTWalker::ScanNames(const NameScanCallbacks& callbacks)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_pMFT == nullptr || callbacks.NameFilterCallback == nullptr || callbacks.NameMatchCallback == nullptr)
+        return E_INVALIDARG;
+
+    ProgressCall progress = callbacks.ProgressCallback;
+    if (progress == nullptr)
+        progress = [](const ULONG) -> HRESULT { return S_OK; };
+
+    const ULONG ulBytesPerFRS = m_pVolReader->GetBytesPerFRS();
+    const ULONG ulBytesPerSector = m_pVolReader->GetBytesPerSector();
+
+    m_ulMFTRecordCount = GetMFTRecordCount();
+    if (m_ulMFTRecordCount == 0)
+        return S_OK;
+
+    m_DirectoryNames.reserve(m_ulMFTRecordCount);
+
+    // Buffers are reused from one segment to the next: only accepted names are copied
+    std::vector<BYTE> frs(ulBytesPerFRS);
+    std::vector<PFILE_NAME> names;
+    names.reserve(16);
+
+    std::unordered_map<MFTUtils::SafeMFTSegmentNumber, NameScanCandidate> candidates;
+    ULONG ulScanned = 0L;
+
+    auto scanSegment = [&](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
+        if ((++ulScanned & 0xFFF) == 0)
+        {
+            if (FAILED(hr = progress((ULONG)((ulScanned * 100ULL) / m_ulMFTRecordCount))))
+                return hr;
+        }
+
+        if (Data.GetCount() < ulBytesPerFRS)
+            return S_OK;
+
+        memcpy_s(frs.data(), ulBytesPerFRS, Data.GetData(), ulBytesPerFRS);
+
+        const auto pFRS = reinterpret_cast<PFILE_RECORD_SEGMENT_HEADER>(frs.data());
+        if (!CanFixupInPlace(pFRS, ulBytesPerSector, ulBytesPerFRS)
+            || FAILED(MFTUtils::MultiSectorFixup(pFRS, m_pVolReader)) || pFRS->FirstAttributeOffset >= ulBytesPerFRS)
+            return S_OK;
+
+        const bool bInUse = (pFRS->Flags & FILE_RECORD_SEGMENT_IN_USE) != 0;
+        if (!bInUse && m_resurrectRecordMode == ResurrectRecordsMode::kNo)
+            return S_OK;
+
+        const bool bIsBase = NtfsSegmentNumber(&pFRS->BaseFileRecordSegment) == 0;
+        const auto reference = ::SegmentReference(pFRS, ullRecordIndex);
+        const MFTUtils::SafeMFTSegmentNumber ullBase =
+            bIsBase ? NtfsSegmentNumber(&reference) : NtfsSegmentNumber(&pFRS->BaseFileRecordSegment);
+
+        const BYTE* pSI = nullptr;
+        ULONG cbSI = 0L;
+        bool bOnlyResident = true;
+        names.clear();
+
+        ::ForEachAttribute(pFRS, ulBytesPerFRS, [&](const ATTRIBUTE_RECORD_HEADER* pAttr) {
+            if (pAttr->FormCode != RESIDENT_FORM || pAttr->TypeCode == $ATTRIBUTE_LIST)
+            {
+                bOnlyResident = false;
+                return;
+            }
+
+            if (pAttr->TypeCode == $STANDARD_INFORMATION)
+            {
+                pSI = ::ResidentValue(pAttr, cbSI);
+            }
+            else if (pAttr->TypeCode == $FILE_NAME)
+            {
+                if (auto pFileName = ::FileNameValue(pAttr))
+                    names.push_back(pFileName);
+            }
+        });
+
+        if (!bInUse && m_resurrectRecordMode == ResurrectRecordsMode::kResident && (!bIsBase || !bOnlyResident))
+            return S_OK;
+
+        if (bIsBase && (pFRS->Flags & FILE_FILE_NAME_INDEX_PRESENT) && !names.empty())
+        {
+            const auto ullDirectory = NtfsFullSegmentNumber(&reference);
+            if (m_DirectoryNames.find(ullDirectory) == end(m_DirectoryNames))
+                m_DirectoryNames.insert(pair<MFTUtils::SafeMFTSegmentNumber, MFTFileNameWrapper>(
+                    ullDirectory, MFTFileNameWrapper(::MainFileName(names))));
+        }
+
+        auto it = candidates.find(ullBase);
+        if (it == end(candidates))
+        {
+            // Records left out of the walk of a shadow copy are not reported either
+            if (!m_UnchangedRecords.empty() && ullBase >= kFirstUserRecord && IsUnchangedSegment(ullBase))
+                return S_OK;
+
+            const auto accepted = std::any_of(std::cbegin(names), std::cend(names), [&](const PFILE_NAME pFileName) {
+                return callbacks.NameFilterCallback(pFileName);
             });
+            if (!accepted)
+                return S_OK;
+
+            it = candidates.emplace(ullBase, NameScanCandidate()).first;
+            it->second.FileReferenceNumber = bIsBase ? reference : pFRS->BaseFileRecordSegment;
+            it->second.bInUse = bInUse;
+        }
+
+        auto& candidate = it->second;
+        if (bIsBase)
+        {
+            candidate.FileReferenceNumber = reference;
+            candidate.bInUse = bInUse;
+            candidate.bBaseScanned = true;
+
+            if (pSI != nullptr)
+            {
+                STANDARD_INFORMATION si {};
+                memcpy_s(&si, sizeof(STANDARD_INFORMATION), pSI, std::min<size_t>(cbSI, sizeof(STANDARD_INFORMATION)));
+                candidate.StandardInformation = si;
+            }
+        }
+
+        for (const auto pFileName : names)
+            ::AddCandidateFileName(candidate, pFileName);
+
+        return S_OK;
+    };
+
+    hr = m_pMFT->EnumMFTRecord(scanSegment);
+    if (FAILED(hr))
+        return hr;
+
+    // Names accepted in an extension record whose base record was scanned before: the base record is read again for
+    // its $STANDARD_INFORMATION and its other names
+    std::vector<MFT_SEGMENT_REFERENCE> bases;
+    for (const auto& [ullSegment, candidate] : candidates)
+    {
+        if (!candidate.bBaseScanned)
+            bases.push_back(candidate.FileReferenceNumber);
     }
 
-    if (hr == HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES))
+    if (!bases.empty())
+    {
+        if (FAILED(hr = m_pMFT->FetchMFTRecord(bases, scanSegment)))
+        {
+            Log::Debug(L"Failed to fetch {} base records of the name scan [{}]", bases.size(), SystemError(hr));
+        }
+    }
+
+    Log::Debug(
+        L"Name scan: {} segments, {} directories, {} records with an accepted name",
+        ulScanned,
+        m_DirectoryNames.size(),
+        candidates.size());
+
+    // Directory names are complete: accepted records are reported in segment order, with their full names available
+    std::vector<MFTUtils::SafeMFTSegmentNumber> segments;
+    segments.reserve(candidates.size());
+    for (const auto& [ullSegment, candidate] : candidates)
+        segments.push_back(ullSegment);
+
+    std::sort(std::begin(segments), std::end(segments));
+
+    NameScanRecord record;
+    for (const auto ullSegment : segments)
     {
-        return hr;  // no more enumeration nor walking...
+        const auto& candidate = candidates[ullSegment];
+
+        record.FileReferenceNumber = candidate.FileReferenceNumber;
+        record.bInUse = candidate.bInUse;
+        record.StandardInformation = candidate.StandardInformation;
+        record.FileNames.clear();
+
+        for (size_t offset = 0; offset < candidate.FileNames.size();)
+        {
+            const auto pFileName = reinterpret_cast<PFILE_NAME>(const_cast<BYTE*>(candidate.FileNames.data() + offset));
+            record.FileNames.push_back(pFileName);
+
+            offset += offsetof(FILE_NAME, FileName) + pFileName->FileNameLength * sizeof(WCHAR);
+            offset = (offset + 7) & ~static_cast<size_t>(7);
+        }
+
+        callbacks.NameMatchCallback(m_pVolReader, record);
+
+        if (FAILED(hr = progress(100)))
+            return hr;
     }
 
-    return WalkRecords(true);
+    return S_OK;
+}
+
+HRESULT MFTWalker::FetchLookupRecord(const MFT_SEGMENT_REFERENCE& reference, MFTRecord*& pRecord)
+{
+    HRESULT hr = E_FAIL;
+
+    pRecord = nullptr;
+
+    const auto it = m_MFTMap.find(NtfsFullSegmentNumber(&reference));
+    if (it != end(m_MFTMap))
+    {
+        pRecord = it->second;
+        return pRecord != nullptr ? S_OK : HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    std::vector<MFT_SEGMENT_REFERENCE> references {reference};
+    hr = m_pMFT->FetchMFTRecord(
+        references, [this, &pRecord](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
+            return AddRecord(ullRecordIndex, Data, pRecord);
+        });
+    if (FAILED(hr))
+        return hr;
+
+    // Index entries of a deleted file may remain, the segment may also be reused by another file since
+    if (pRecord == nullptr || !pRecord->IsRecordInUse() || !pRecord->IsBaseRecord()
+        || pRecord->GetFileReferenceNumber().SequenceNumber != reference.SequenceNumber)
+    {
+        pRecord = nullptr;
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    // Attributes moved to extension records, like the $INDEX_ALLOCATION of a large directory
+    std::vector<MFT_SEGMENT_REFERENCE> missingRecords;
+    if (AreAttributesComplete(pRecord, missingRecords))
+        return S_OK;
+
+    std::vector<MFT_SEGMENT_REFERENCE> extensions;
+    for (const auto& missing : missingRecords)
+    {
+        const auto ullMissing = NtfsFullSegmentNumber(&missing);
+        if (m_MFTMap.find(ullMissing) != end(m_MFTMap))
+            continue;
+
+        if (std::none_of(std::cbegin(extensions), std::cend(extensions), [ullMissing](const auto& extension) {
+                return NtfsFullSegmentNumber(&extension) == ullMissing;
+            }))
+            extensions.push_back(missing);
+    }
+
+    if (!extensions.empty())
+    {
+        MFTRecord* pExtension = nullptr;
+        hr = m_pMFT->FetchMFTRecord(
+            extensions,
+            [this, &pExtension](MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data) -> HRESULT {
+                return AddRecord(ullRecordIndex, Data, pExtension);
+            });
+        if (FAILED(hr))
+            return hr;
+    }
+
+    return UpdateAttributeList(pRecord);
+}
+
+HRESULT MFTWalker::LookupDirectoryEntry(MFTRecord* pDirectory, std::wstring_view name, MFT_SEGMENT_REFERENCE& reference)
+{
+    HRESULT hr = E_FAIL;
+
+    std::shared_ptr<IndexAllocationAttribute> pIA;
+    std::shared_ptr<IndexRootAttribute> pIR;
+    std::shared_ptr<BitmapAttribute> pBM;
+
+    if (FAILED(hr = pDirectory->GetIndexAttributes(m_pVolReader, L"$I30", pIR, pIA, pBM)))
+        return hr;
+
+    if (pIR == nullptr)
+        return HRESULT_FROM_WIN32(ERROR_DIRECTORY);
+
+    // Sub node blocks are numbered in clusters, or in 512 bytes units when an index block is smaller than a cluster
+    const ULONG ulSizePerIndex = pIR->SizePerIndex();
+    const ULONG ulBytesPerCluster = m_pVolReader->GetBytesPerCluster();
+    const ULONG ulBytesPerVcn = ulSizePerIndex >= ulBytesPerCluster ? ulBytesPerCluster : DEFAULT_INDEX_BLOCK_SIZE;
+
+    std::vector<BYTE> block;
+    PINDEX_ENTRY pEntry = pIR->FirstIndexEntry();
+    LPBYTE pEnd = pIR->FirstFreeByte();
+
+    for (int depth = 0; depth < I30_MAX_DEPTH; depth++)
+    {
+        // Entries are sorted: the name is either in this node or in the sub node of the first entry after it
+        LONGLONG llSubNode = -1LL;
+        while ((LPBYTE)pEntry + sizeof(INDEX_ENTRY) <= pEnd)
+        {
+            if (pEntry->Length < sizeof(INDEX_ENTRY) || (LPBYTE)pEntry + pEntry->Length > pEnd)
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+            if (!(pEntry->Flags & INDEX_ENTRY_END))
+            {
+                const auto pFileName = (PFILE_NAME)((PBYTE)pEntry + sizeof(INDEX_ENTRY));
+                if (sizeof(INDEX_ENTRY) + offsetof(FILE_NAME, FileName) + pFileName->FileNameLength * sizeof(WCHAR)
+                    > pEntry->Length)
+                    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+                const auto collation = MFTUtils::CollateFileNames(
+                    name, std::wstring_view(pFileName->FileName, pFileName->FileNameLength));
+                if (collation == 0)
+                {
+                    reference = pEntry->FileReference;
+                    return S_OK;
+                }
+
+                if (collation > 0)
+                {
+                    pEntry = NtfsNextIndexEntry(pEntry);
+                    continue;
+                }
+            }
+
+            if (pEntry->Flags & INDEX_ENTRY_NODE)
+                llSubNode = NtfsIndexEntryBlock(pEntry);
+            break;
+        }
+
+        if (llSubNode < 0)
+            return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+        if (pIA == nullptr || !pIA->IsNonResident() || ulSizePerIndex == 0L)
+        {
+            Log::Debug(L"Invalid $INDEX_ALLOCATION for record {:#x}", pDirectory->GetSafeMFTSegmentNumber());
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        block.assign(ulSizePerIndex, 0);
+        if (FAILED(hr = ReadIndexAllocation(m_pVolReader, pIA, llSubNode * ulBytesPerVcn, ulSizePerIndex, block)))
+            return hr;
+
+        const auto pIABuff = (PINDEX_ALLOCATION_BUFFER)block.data();
+        if (FAILED(hr = MFTUtils::MultiSectorFixup(pIABuff, ulSizePerIndex, m_pVolReader)))
+            return hr;
+
+        const auto pHeader = &pIABuff->IndexHeader;
+        pEntry = NtfsFirstIndexEntry(pHeader);
+        pEnd = std::min((LPBYTE)pHeader + pHeader->FirstFreeByte, block.data() + block.size());
+    }
+
+    return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+}
+
+HRESULT MFTWalker::LookupPaths(const std::vector<std::wstring>& paths, const NameScanCallbacks& callbacks)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_pMFT == nullptr || callbacks.NameMatchCallback == nullptr)
+        return E_INVALIDARG;
+
+    ProgressCall progress = callbacks.ProgressCallback;
+    if (progress == nullptr)
+        progress = [](const ULONG) -> HRESULT { return S_OK; };
+
+    const auto ullRoot = m_pMFT->GetUSNRoot();
+    const auto root = *reinterpret_cast<const MFT_SEGMENT_REFERENCE*>(&ullRoot);
+
+    MFTRecord* pRoot = nullptr;
+    if (FAILED(hr = FetchLookupRecord(root, pRoot)))
+    {
+        Log::Debug(L"Failed to read the root directory record for path lookup [{}]", SystemError(hr));
+        return hr;
+    }
+
+    std::unordered_set<MFTUtils::SafeMFTSegmentNumber> reported;
+    NameScanRecord record;
+    ULONG ulFound = 0L;
+
+    for (size_t i = 0; i < paths.size(); i++)
+    {
+        std::wstring_view path(paths[i]);
+
+        MFTRecord* pRecord = pRoot;
+        hr = S_OK;
+
+        while (SUCCEEDED(hr) && !path.empty())
+        {
+            const auto pos = path.find(L'\\');
+            const auto name = path.substr(0, pos);
+            path = pos == std::wstring_view::npos ? std::wstring_view() : path.substr(pos + 1);
+
+            if (name.empty())
+                continue;
+
+            MFT_SEGMENT_REFERENCE reference;
+            if (FAILED(hr = LookupDirectoryEntry(pRecord, name, reference)))
+                break;
+
+            hr = FetchLookupRecord(reference, pRecord);
+        }
+
+        if (FAILED(hr))
+        {
+            Log::Debug(L"Path '{}' not found by lookup [{}]", paths[i], SystemError(hr));
+        }
+        else if (pRecord != pRoot && reported.insert(pRecord->GetSafeMFTSegmentNumber()).second)
+        {
+            record.FileReferenceNumber = pRecord->GetFileReferenceNumber();
+            record.bInUse = true;
+            record.StandardInformation.reset();
+            if (pRecord->GetStandardInformation() != nullptr)
+                record.StandardInformation = *pRecord->GetStandardInformation();
+            record.FileNames = pRecord->GetFileNames();
+
+            callbacks.NameMatchCallback(m_pVolReader, record);
+            ulFound++;
+        }
+
+        if (FAILED(hr = progress((ULONG)(((i + 1) * 100ULL) / paths.size()))))
+            return hr;
+    }
+
+    Log::Debug(L"Path lookup: {} paths, {} records found, {} records read", paths.size(), ulFound, m_MFTMap.size());
+    return S_OK;
 }
 
 ULONG MFTWalker::GetMFTRecordCount() const
@@ -1801,23 +3131,24 @@ HRESULT MFTWalker::Statistics(const WCHAR* szMsg)
     DWORD dwIncompleteCount = 0;
     DWORD dwAvailableEntries = 0;
 
-    std::for_each(begin(m_MFTMap), end(m_MFTMap), [&](const pair<MFTUtils::SafeMFTSegmentNumber, MFTRecord*>& pair) {
-        if (pair.second != nullptr)
+    for (const auto& [segmentNumber, pRecord] : m_MFTMap)
+    {
+        if (pRecord != nullptr)
         {
-            dwDirCount += pair.second->IsDirectory() ? 1 : 0;
-            dwNotParsedCount += !pair.second->IsParsed() ? 1 : 0;
-            dwIncompleteCount += !pair.second->m_bIsComplete ? 1 : 0;
+            dwDirCount += pRecord->IsDirectory() ? 1 : 0;
+            dwNotParsedCount += !pRecord->IsParsed() ? 1 : 0;
+            dwIncompleteCount += !pRecord->m_bIsComplete ? 1 : 0;
             dwAvailableEntries++;
 
-            if (!(pair.second->m_pRecord->Flags & FILE_RECORD_SEGMENT_IN_USE))
+            if (!(pRecord->m_pRecord->Flags & FILE_RECORD_SEGMENT_IN_USE))
             {
-                dwDeletedDirCount += pair.second->IsDirectory() ? 1 : 0;
-                dwDeletedNotParsedCount += !pair.second->IsParsed() ? 1 : 0;
-                dwDeletedIncompleteCount += !pair.second->m_bIsComplete ? 1 : 0;
+                dwDeletedDirCount += pRecord->IsDirectory() ? 1 : 0;
+                dwDeletedNotParsedCount += !pRecord->IsParsed() ? 1 : 0;
+                dwDeletedIncompleteCount += !pRecord->m_bIsComplete ? 1 : 0;
                 dwDeletedAvailableEntries++;
             }
         }
-    });
+    }
     if (m_resurrectRecordMode == ResurrectRecordsMode::kYes || m_resurrectRecordMode == ResurrectRecordsMode::kResident)
     {
         Log::Trace(
@@ -1835,9 +3166,32 @@ HRESULT MFTWalker::Statistics(const WCHAR* szMsg)
         dwNotParsedCount,
         dwIncompleteCount);
 
+    if (m_dwPipelineWorkers > 0)
+    {
+        Log::Debug(
+            L"Pipeline -> Workers: {}, Batches: {}, Records fixed by workers: {}, skipped: {}",
+            m_dwPipelineWorkers,
+            m_ullPipelineBatches,
+            m_ullPipelineFixedRecords,
+            m_ullPipelineSkippedRecords);
+    }
+
+    if (!m_UnchangedRecords.empty())
+    {
+        Log::Debug(L"Shadow copy -> Unchanged records skipped: {}", m_ullSkippedUnchangedRecords);
+    }
+
+    Log::Debug(
+        L"Segment store -> Peak records: {}, Peak bytes: {}, Slabs: {}",
+        m_SegmentStore.PeakAllocatedCells(),
+        m_SegmentStore.PeakCommittedBytes(),
+        m_SegmentStore.SlabCount());
+
+    Log::Debug(L"Directory paths -> Pool bytes: {}", m_DirectoryPaths.Bytes());
+
     if (m_SegmentStore.AllocatedCells() > 0)
     {
-        Log::Warn("Heap still maintains {} entries", m_SegmentStore.AllocatedCells());
+        Log::Warn("Segment store still maintains {} entries", m_SegmentStore.AllocatedCells());
     }
 
 #ifdef _DEBUG
@@ -1856,10 +3210,14 @@ HRESULT MFTWalker::Statistics(const WCHAR* szMsg)
 
 MFTWalker::~MFTWalker()
 {
-    for_each(begin(m_MFTMap), end(m_MFTMap), [](const pair<MFTUtils::SafeMFTSegmentNumber, MFTRecord*>& pair) {
-        if (pair.second != nullptr)  //&& !IsBadReadPtr(pair.second, sizeof(MFTRecord*)))
+    for (const auto& [segmentNumber, pRecord] : m_MFTMap)
+    {
+        if (pRecord != nullptr)
         {
-            pair.second->~MFTRecord();
+            pRecord->~MFTRecord();
         }
-    });
+    }
+
+    // Records were destroyed, the cells are released at once
+    m_SegmentStore.Reset();
 }
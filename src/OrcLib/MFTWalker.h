@@ -11,7 +11,9 @@
 
 #include "VolumeReader.h"
 
-#include "HeapStorage.h"
+#include "SlabStorage.h"
+#include "MFTSegmentTable.h"
+#include "Utils/StringPool.h"
 
 #include "Location.h"
 
@@ -21,7 +23,10 @@
 
 #include "CaseInsensitive.h"
 #include "ResurrectRecordsMode.h"
+#include "SecurityDescriptorTable.h"
 
+#include <optional>
+#include <type_traits>
 #include <unordered_set>
 #include <set>
 #include <map>
@@ -95,6 +100,63 @@ public:
             , KeepAliveCallback(nullptr) {};
     };
 
+    // Hooks of a walk visitor. The visitor given to Walk(Visitor&) implements any of these members, hooks it does not
+    // implement are not compiled in the walk:
+    //
+    //  void OnElement(VolumeReader& volreader, MFTRecord& record);
+    //  void OnFileName(VolumeReader& volreader, MFTRecord& record, const PFILE_NAME pFileName);
+    //  void OnAttribute(VolumeReader& volreader, MFTRecord& record, const AttributeListEntry& attr);
+    //  void OnData(VolumeReader& volreader, MFTRecord& record, DataAttribute& data);
+    //  void OnFileNameAndData(
+    //      VolumeReader& volreader, MFTRecord& record, const PFILE_NAME pFileName, DataAttribute& data);
+    //  void OnDirectory(
+    //      VolumeReader& volreader, MFTRecord& record, const PFILE_NAME pFileName, IndexAllocationAttribute* pI30);
+    //  void OnI30Entry(
+    //      VolumeReader& volreader,
+    //      MFTRecord& record,
+    //      const PINDEX_ENTRY pEntry,
+    //      const PFILE_NAME pFileName,
+    //      bool bCarvedEntry);
+    //  void OnSecurityDescriptor(VolumeReader& volreader, const PSECURITY_DESCRIPTOR_ENTRY& pEntry);
+    //  HRESULT OnProgress(ULONG ulProgress);
+    //  bool KeepAlive(VolumeReader& volreader, MFTRecord& record);
+    //
+    // Optionally, 'bool Enabled(Hook hook) const' turns implemented hooks off for the whole walk.
+    enum class Hook : DWORD
+    {
+        Element = 1,
+        FileName = 1 << 1,
+        Attribute = 1 << 2,
+        Data = 1 << 3,
+        FileNameAndData = 1 << 4,
+        Directory = 1 << 5,
+        I30Entry = 1 << 6,
+        SecurityDescriptor = 1 << 7,
+        Progress = 1 << 8,
+        KeepAlive = 1 << 9
+    };
+
+    // Record with a name accepted by a name scan, its file names are only valid during the callback
+    struct NameScanRecord
+    {
+        MFT_SEGMENT_REFERENCE FileReferenceNumber;
+        bool bInUse = false;
+        std::optional<STANDARD_INFORMATION> StandardInformation;
+        std::vector<PFILE_NAME> FileNames;
+    };
+
+    using NameFilterCall = std::function<bool(const PFILE_NAME pFileName)>;
+    using NameMatchCall =
+        std::function<void(const std::shared_ptr<VolumeReader>& volreader, const NameScanRecord& record)>;
+
+    class NameScanCallbacks
+    {
+    public:
+        NameFilterCall NameFilterCallback;  // Called with each $FILE_NAME as the MFT is read: full names are unknown
+        NameMatchCall NameMatchCallback;  // Called once the MFT is read for the records with an accepted name
+        ProgressCall ProgressCallback;
+    };
+
     using FullNameBuilder =
         std::function<const WCHAR*(const PFILE_NAME pFileName, const std::shared_ptr<DataAttribute>& pDataAttr)>;
     using InLocationBuilder = std::function<bool(const PFILE_NAME pFileName)>;
@@ -106,6 +168,26 @@ public:
         m_currentFileNameElements.reserve(64);
     }
 
+    // Pipelined walk: a reader thread streams MFT segments while dwWorkers threads apply the multi sector fixups.
+    // Record parsing and callbacks remain on the walking thread. Must be called before Initialize.
+    void SetPipeline(DWORD dwWorkers, bool bOutOfOrder = false)
+    {
+        m_dwPipelineWorkers = dwWorkers;
+        m_bPipelineOutOfOrder = bOutOfOrder;
+    }
+
+    // Shadow copy locations (internal parser) only: records whose MFT blocks are the same as on the live volume are not
+    // emitted, they are expected from the walk of the live volume. They are only parsed when needed to build names or
+    // to complete a changed record. Must be called before Initialize.
+    void SetSkipUnchangedShadowRecords(bool bSkip) { m_bSkipUnchangedShadowRecords = bSkip; }
+
+    // Security descriptors of $Secure are loaded into this table when the walk reaches it, for owner lookups by
+    // SecurityId. Must be called before Walk.
+    void SetSecurityDescriptorTable(std::shared_ptr<SecurityDescriptorTable> table)
+    {
+        m_pSecurityDescriptors = std::move(table);
+    }
+
     HRESULT Initialize(const std::shared_ptr<Location>& loc, ResurrectRecordsMode mode = ResurrectRecordsMode::kYes);
 
     FullNameBuilder GetFullNameBuilder()
@@ -120,26 +202,53 @@ public:
         return [this](PFILE_NAME pFileName) -> bool { return IsInLocation(pFileName); };
     }
 
+    // Callbacks are called through an adapter visitor
     HRESULT Walk(const Callbacks& pCallbacks);
 
+    // The walk is instantiated for 'visitor': one indirect call per record, its hooks are called directly with
+    // references to the volume reader and the attributes
+    template <typename Visitor, typename = std::enable_if_t<!std::is_same_v<std::decay_t<Visitor>, Callbacks>>>
+    HRESULT Walk(Visitor& visitor)
+    {
+        VisitorDispatch<Visitor> dispatch(*this, visitor);
+        return WalkWith(dispatch);
+    }
+
+    // Name only walk: $FILE_NAME attributes are read in place from the MFT segments, without building records nor
+    // their attributes. Directory names are kept for the full name and location builders. Names stored in an extension
+    // record are only seen when the scan reaches that record.
+    HRESULT ScanNames(const NameScanCallbacks& callbacks);
+
+    // Path lookup: each path is resolved from the root directory by descending the $I30 indexes of its directories,
+    // only the records on the way are read. Records found are reported to NameMatchCallback as by a name scan, paths
+    // which do not resolve to a record in use are not reported.
+    HRESULT LookupPaths(const std::vector<std::wstring>& paths, const NameScanCallbacks& callbacks);
+
     ULONG GetMFTRecordCount() const;
     HRESULT Statistics(const WCHAR* szMsg);
 
     ~MFTWalker();
 
 private:
-    HeapStorage m_SegmentStore;
+    SlabStorage m_SegmentStore;
     size_t m_CellStoreLastWalk = 0L;
     size_t m_CellStoreThreshold = 50 * 1024;
 
-    std::unordered_map<MFTUtils::SafeMFTSegmentNumber, MFTRecord*> m_MFTMap;
+    MFTSegmentTable<MFTRecord*> m_MFTMap;
 
     class MFTFileNameWrapper
     {
     public:
         PFILE_NAME m_pFileName;
         boost::logic::tribool m_InLocation;
+        std::optional<std::wstring_view> m_FullPath;  // memoized path ending with '\\', stored in m_DirectoryPaths
+        std::optional<std::wstring_view> m_OrphanPath;  // final walk only: same, from a "__FRN__" missing ancestor
 
+        MFTFileNameWrapper()
+            : m_pFileName(nullptr)
+            , m_InLocation(boost::indeterminate)
+        {
+        }
         MFTFileNameWrapper(const MFTFileNameWrapper& pFileName)
             : m_InLocation(boost::indeterminate)
         {
@@ -153,13 +262,30 @@ private:
             m_pFileName = Other.m_pFileName;
             Other.m_pFileName = nullptr;
             m_InLocation = Other.m_InLocation;
+            m_FullPath = Other.m_FullPath;
+            m_OrphanPath = Other.m_OrphanPath;
+        }
+        MFTFileNameWrapper& operator=(MFTFileNameWrapper&& Other) noexcept
+        {
+            if (this != &Other)
+            {
+                free(m_pFileName);
+                m_pFileName = Other.m_pFileName;
+                Other.m_pFileName = nullptr;
+                m_InLocation = Other.m_InLocation;
+                m_FullPath = Other.m_FullPath;
+                m_OrphanPath = Other.m_OrphanPath;
+            }
+            return *this;
         }
         ~MFTFileNameWrapper() { free(m_pFileName); };
 
         PFILE_NAME FileName() const { return m_pFileName; };
     };
 
-    std::unordered_map<MFTUtils::SafeMFTSegmentNumber, MFTFileNameWrapper> m_DirectoryNames;
+    // Only directories are stored: smaller pages for this sparser table
+    MFTSegmentTable<MFTFileNameWrapper, 6> m_DirectoryNames;
+    WStringPool m_DirectoryPaths;
     std::unordered_set<std::wstring, CaseInsensitiveUnordered> m_Locations;
 
     ResurrectRecordsMode m_resurrectRecordMode = ResurrectRecordsMode::kNo;
@@ -171,17 +297,65 @@ private:
 
     std::unique_ptr<IMFT> m_pMFT;
 
-    // Internal call callbacks
-    typedef std::function<HRESULT(MFTWalker* pThis, MFTRecord* pRecord, bool& bFreeRecord)> CallCallbackCall;
-    CallCallbackCall m_pCallbackCall;
-    Callbacks m_Callbacks;
+    DWORD m_dwPipelineWorkers = 0L;
+    bool m_bPipelineOutOfOrder = false;
+    ULONGLONG m_ullPipelineBatches = 0LL;
+    ULONGLONG m_ullPipelineFixedRecords = 0LL;
+    ULONGLONG m_ullPipelineSkippedRecords = 0LL;  // empty slots and free records (not resurrected)
 
-    HRESULT SetCallbacks(const Callbacks& pCallbacks);
-    HRESULT FullCallCallbackForRecord(MFTRecord* pRecord, bool& bFreeRecord);
-    HRESULT SimpleCallCallbackForRecord(MFTRecord* pRecord, bool& bFreeRecord);
+    HRESULT EnumMFTRecordPipelined();
+
+    std::shared_ptr<SecurityDescriptorTable> m_pSecurityDescriptors;
+
+    // Records are parsed by a header pass, attribute objects are built when accessed
+    bool m_bDeferAttributes = false;
+
+    bool m_bSkipUnchangedShadowRecords = false;
+    std::vector<bool> m_UnchangedRecords;  // By segment number, empty if no record can be skipped
+    ULONGLONG m_ullSkippedUnchangedRecords = 0LL;
+
+    HRESULT LoadUnchangedRecords();
+    bool IsUnchangedSegment(MFTUtils::SafeMFTSegmentNumber ullSegmentNumber) const;
+    bool IsUnchangedRecord(const MFTRecord* pRecord) const;
+    bool CanSkipUnchangedRecord(MFTUtils::SafeMFTSegmentNumber ullRecordIndex, const CBinaryBuffer& Data) const;
+
+    // Visitor of the current walk, behind the only virtual calls of the walk
+    class RecordDispatch
+    {
+    public:
+        virtual ~RecordDispatch() = default;
+
+        virtual HRESULT CallForRecord(MFTRecord* pRecord, bool& bFreeRecord) = 0;
+        virtual void CallForI30Entry(
+            MFTRecord* pRecord,
+            const PINDEX_ENTRY pEntry,
+            const PFILE_NAME pFileName,
+            bool bCarvedEntry) = 0;
+        virtual void CallForSecurityDescriptor(const PSECURITY_DESCRIPTOR_ENTRY& pEntry) = 0;
+
+        bool Wants(Hook hook) const { return (m_dwHooks & static_cast<DWORD>(hook)) != 0; }
+
+        DWORD m_dwHooks = 0L;  // hooks implemented and enabled
+    };
+
+    template <typename Visitor>
+    class VisitorDispatch;
+
+    RecordDispatch* m_pDispatch = nullptr;
+
+    HRESULT WalkWith(RecordDispatch& dispatch);
+
+    template <typename Visitor>
+    HRESULT CallVisitorForRecord(Visitor& visitor, DWORD dwHooks, MFTRecord* pRecord, bool& bFreeRecord);
 
     HRESULT WalkRecords(bool bIsFinalWalk);
 
+    // Before the final walk of resurrected records: the records left are classified and the parent chains of their
+    // names resolved by a worker pool, each worker taking a range of segment numbers. Directory names are complete at
+    // this point, chains which do not reach the root are memoized as well.
+    HRESULT ResolveFinalWalkNames();
+    bool BuildDirectoryPath(MFTUtils::SafeMFTSegmentNumber ullDirectory, std::wstring& path, bool& bRooted) const;
+
     DWORD m_dwWalkedItems = 0L;
 
     WCHAR* m_pFullNameBuffer = nullptr;
@@ -205,15 +379,29 @@ private:
 
     HRESULT AddDirectoryName(MFTRecord* pRecord);
 
-    HRESULT AddRecord(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data, MFTRecord*& pRecord);
-    HRESULT AddRecordCallback(MFTUtils::SafeMFTSegmentNumber& ullRecordIndex, CBinaryBuffer& Data);
+    HRESULT AddRecord(
+        MFTUtils::SafeMFTSegmentNumber& ullRecordIndex,
+        CBinaryBuffer& Data,
+        MFTRecord*& pRecord,
+        bool bIsMultiSectorFixed = false);
+    HRESULT AddRecordCallback(
+        MFTUtils::SafeMFTSegmentNumber& ullRecordIndex,
+        CBinaryBuffer& Data,
+        bool bIsMultiSectorFixed = false);
+
+    // Path lookup: base record 'reference' in use and its extension records are added to the map
+    HRESULT FetchLookupRecord(const MFT_SEGMENT_REFERENCE& reference, MFTRecord*& pRecord);
+    HRESULT LookupDirectoryEntry(MFTRecord* pDirectory, std::wstring_view name, MFT_SEGMENT_REFERENCE& reference);
 
     HRESULT ParseI30AndCallback(MFTRecord* pRecord);
+    void ParseI30AndLog(MFTRecord* pRecord);
 
     HRESULT Parse$SecureAndCallback(MFTRecord* pRecord);
 
     bool IsInLocation(PFILE_NAME pFileName);
 
+    std::optional<std::wstring_view> GetDirectoryPath(MFTUtils::SafeMFTSegmentNumber ullDirectory);
+
     const WCHAR* GetFullNameAndIfInLocation(
         PFILE_NAME pFileName,
         const std::shared_ptr<DataAttribute>& pDataAttr,
@@ -221,6 +409,299 @@ private:
         bool* pbInSpecificLocation);
 };
 
+namespace Detail {
+
+template <typename Visitor, template <typename> class Hook, typename = void>
+struct HasWalkHook : std::false_type
+{
+};
+
+template <typename Visitor, template <typename> class Hook>
+struct HasWalkHook<Visitor, Hook, std::void_t<Hook<Visitor>>> : std::true_type
+{
+};
+
+template <typename Visitor, template <typename> class Hook>
+constexpr bool has_walk_hook_v = HasWalkHook<Visitor, Hook>::value;
+
+template <typename V>
+using OnElementHook = decltype(std::declval<V&>().OnElement(std::declval<VolumeReader&>(), std::declval<MFTRecord&>()));
+
+template <typename V>
+using OnFileNameHook = decltype(std::declval<V&>().OnFileName(
+    std::declval<VolumeReader&>(), std::declval<MFTRecord&>(), std::declval<PFILE_NAME>()));
+
+template <typename V>
+using OnAttributeHook = decltype(std::declval<V&>().OnAttribute(
+    std::declval<VolumeReader&>(), std::declval<MFTRecord&>(), std::declval<const AttributeListEntry&>()));
+
+template <typename V>
+using OnDataHook = decltype(std::declval<V&>().OnData(
+    std::declval<VolumeReader&>(), std::declval<MFTRecord&>(), std::declval<DataAttribute&>()));
+
+template <typename V>
+using OnFileNameAndDataHook = decltype(std::declval<V&>().OnFileNameAndData(
+    std::declval<VolumeReader&>(),
+    std::declval<MFTRecord&>(),
+    std::declval<PFILE_NAME>(),
+    std::declval<DataAttribute&>()));
+
+template <typename V>
+using OnDirectoryHook = decltype(std::declval<V&>().OnDirectory(
+    std::declval<VolumeReader&>(),
+    std::declval<MFTRecord&>(),
+    std::declval<PFILE_NAME>(),
+    std::declval<IndexAllocationAttribute*>()));
+
+template <typename V>
+using OnI30EntryHook = decltype(std::declval<V&>().OnI30Entry(
+    std::declval<VolumeReader&>(),
+    std::declval<MFTRecord&>(),
+    std::declval<PINDEX_ENTRY>(),
+    std::declval<PFILE_NAME>(),
+    std::declval<bool>()));
+
+template <typename V>
+using OnSecurityDescriptorHook = decltype(std::declval<V&>().OnSecurityDescriptor(
+    std::declval<VolumeReader&>(), std::declval<const PSECURITY_DESCRIPTOR_ENTRY&>()));
+
+template <typename V>
+using OnProgressHook = decltype(std::declval<V&>().OnProgress(std::declval<ULONG>()));
+
+template <typename V>
+using KeepAliveHook = decltype(std::declval<V&>().KeepAlive(std::declval<VolumeReader&>(), std::declval<MFTRecord&>()));
+
+template <typename V>
+using EnabledHook = decltype(std::declval<const V&>().Enabled(std::declval<MFTWalker::Hook>()));
+
+template <typename Visitor>
+DWORD WalkHooks(const Visitor& visitor)
+{
+    DWORD dwHooks = 0L;
+
+    const auto add = [&visitor, &dwHooks](bool bImplemented, MFTWalker::Hook hook) {
+        if (!bImplemented)
+            return;
+
+        if constexpr (has_walk_hook_v<Visitor, EnabledHook>)
+        {
+            if (!visitor.Enabled(hook))
+                return;
+        }
+
+        dwHooks |= static_cast<DWORD>(hook);
+    };
+
+    add(has_walk_hook_v<Visitor, OnElementHook>, MFTWalker::Hook::Element);
+    add(has_walk_hook_v<Visitor, OnFileNameHook>, MFTWalker::Hook::FileName);
+    add(has_walk_hook_v<Visitor, OnAttributeHook>, MFTWalker::Hook::Attribute);
+    add(has_walk_hook_v<Visitor, OnDataHook>, MFTWalker::Hook::Data);
+    add(has_walk_hook_v<Visitor, OnFileNameAndDataHook>, MFTWalker::Hook::FileNameAndData);
+    add(has_walk_hook_v<Visitor, OnDirectoryHook>, MFTWalker::Hook::Directory);
+    add(has_walk_hook_v<Visitor, OnI30EntryHook>, MFTWalker::Hook::I30Entry);
+    add(has_walk_hook_v<Visitor, OnSecurityDescriptorHook>, MFTWalker::Hook::SecurityDescriptor);
+    add(has_walk_hook_v<Visitor, OnProgressHook>, MFTWalker::Hook::Progress);
+    add(has_walk_hook_v<Visitor, KeepAliveHook>, MFTWalker::Hook::KeepAlive);
+
+    return dwHooks;
+}
+
+// Hooks which need the attributes and the names of each record
+constexpr DWORD kRecordContentHooks = static_cast<DWORD>(MFTWalker::Hook::FileName)
+    | static_cast<DWORD>(MFTWalker::Hook::Attribute) | static_cast<DWORD>(MFTWalker::Hook::Data)
+    | static_cast<DWORD>(MFTWalker::Hook::FileNameAndData) | static_cast<DWORD>(MFTWalker::Hook::Directory);
+
+}  // namespace Detail
+
+template <typename Visitor>
+class MFTWalker::VisitorDispatch final : public MFTWalker::RecordDispatch
+{
+public:
+    VisitorDispatch(MFTWalker& walker, Visitor& visitor)
+        : m_walker(walker)
+        , m_visitor(visitor)
+    {
+        m_dwHooks = Detail::WalkHooks(visitor);
+    }
+
+    HRESULT CallForRecord(MFTRecord* pRecord, bool& bFreeRecord) override final
+    {
+        return m_walker.CallVisitorForRecord(m_visitor, m_dwHooks, pRecord, bFreeRecord);
+    }
+
+    void CallForI30Entry(MFTRecord* pRecord, const PINDEX_ENTRY pEntry, const PFILE_NAME pFileName, bool bCarvedEntry)
+        override final
+    {
+        if constexpr (Detail::has_walk_hook_v<Visitor, Detail::OnI30EntryHook>)
+            m_visitor.OnI30Entry(*m_walker.m_pVolReader, *pRecord, pEntry, pFileName, bCarvedEntry);
+    }
+
+    void CallForSecurityDescriptor(const PSECURITY_DESCRIPTOR_ENTRY& pEntry) override final
+    {
+        if constexpr (Detail::has_walk_hook_v<Visitor, Detail::OnSecurityDescriptorHook>)
+            m_visitor.OnSecurityDescriptor(*m_walker.m_pVolReader, pEntry);
+    }
+
+private:
+    MFTWalker& m_walker;
+    Visitor& m_visitor;
+};
+
+template <typename Visitor>
+HRESULT MFTWalker::CallVisitorForRecord(Visitor& visitor, DWORD dwHooks, MFTRecord* pRecord, bool& bFreeRecord)
+{
+    using namespace Detail;
+
+    if (NtfsSegmentNumber(&pRecord->m_pRecord->BaseFileRecordSegment) > 0)
+        return S_OK;  // we don't call the callbacks on child records...
+
+    HRESULT hr = S_OK;
+
+    if (!pRecord->HasCallbackBeenCalled() && IsUnchangedRecord(pRecord))
+    {
+        // Emitted by the walk of the live volume
+        m_ullSkippedUnchangedRecords++;
+        pRecord->CallbackCalled();
+        bFreeRecord = true;
+    }
+
+    if (pRecord->HasCallbackBeenCalled())
+    {
+        pRecord->CleanCachedData();
+        return hr;
+    }
+
+    m_dwWalkedItems++;
+
+    const auto wants = [dwHooks](Hook hook) { return (dwHooks & static_cast<DWORD>(hook)) != 0; };
+    auto& volreader = *m_pVolReader;
+    auto& record = *pRecord;
+
+    if constexpr (has_walk_hook_v<Visitor, OnElementHook>)
+    {
+        if (wants(Hook::Element))
+            visitor.OnElement(volreader, record);
+    }
+
+    if (!(dwHooks & kRecordContentHooks))
+    {
+        if (wants(Hook::I30Entry) && pRecord->IsDirectory())
+            ParseI30AndLog(pRecord);
+    }
+    else
+    {
+        if constexpr (has_walk_hook_v<Visitor, OnAttributeHook>)
+        {
+            if (wants(Hook::Attribute))
+            {
+                for (const auto& attr : pRecord->GetAttributeList())
+                    visitor.OnAttribute(volreader, record, attr);
+            }
+        }
+
+        if (pRecord->m_FileNames.empty())
+        {
+            if constexpr (has_walk_hook_v<Visitor, OnDataHook>)
+            {
+                // This record has Data attributes (but no $FILENAME).
+                if (wants(Hook::Data))
+                {
+                    for (const auto& pDataAttr : pRecord->m_DataAttrList)
+                    {
+                        bool bInSpecificLocation = false;
+                        const WCHAR* pFullName =
+                            GetFullNameAndIfInLocation(NULL, pDataAttr, NULL, &bInSpecificLocation);
+                        if (pFullName && bInSpecificLocation)
+                            visitor.OnData(volreader, record, *pDataAttr);
+                    }
+                }
+            }
+        }
+        else if (
+            wants(Hook::FileName) || wants(Hook::Directory) || wants(Hook::FileNameAndData) || wants(Hook::Data))
+        {
+            // "standard" case
+            for (const auto& name : pRecord->m_FileNames)
+            {
+                bool bInSpecificLocation = false;
+                const WCHAR* pFullName = GetFullNameAndIfInLocation(name, NULL, NULL, &bInSpecificLocation);
+
+                if constexpr (has_walk_hook_v<Visitor, OnFileNameHook>)
+                {
+                    if (wants(Hook::FileName) && bInSpecificLocation)
+                        visitor.OnFileName(volreader, record, name);
+                }
+
+                if (bInSpecificLocation
+                    && (wants(Hook::FileNameAndData) || wants(Hook::Directory) || wants(Hook::I30Entry))
+                    && pRecord->IsDirectory())
+                {
+                    if constexpr (has_walk_hook_v<Visitor, OnDirectoryHook>)
+                    {
+                        if (wants(Hook::Directory))
+                        {
+                            const auto pI30 = pRecord->GetIndexAllocationAttribute(L"$I30");
+                            visitor.OnDirectory(volreader, record, name, pI30.get());
+                        }
+                    }
+
+                    // This record is a directory and has Data attributes (i.e. ADS).
+                    if constexpr (has_walk_hook_v<Visitor, OnFileNameAndDataHook>)
+                    {
+                        if (pFullName && wants(Hook::FileNameAndData))
+                        {
+                            for (const auto& data : pRecord->m_DataAttrList)
+                                visitor.OnFileNameAndData(volreader, record, name, *data);
+                        }
+                    }
+
+                    if (wants(Hook::I30Entry))
+                        ParseI30AndLog(pRecord);
+                }
+                else if (bInSpecificLocation && pRecord->m_DataAttrList.size())
+                {
+                    // This record has Data attributes.
+                    if constexpr (has_walk_hook_v<Visitor, OnFileNameAndDataHook>)
+                    {
+                        if (pFullName && wants(Hook::FileNameAndData))
+                        {
+                            for (const auto& data : pRecord->m_DataAttrList)
+                                visitor.OnFileNameAndData(volreader, record, name, *data);
+                        }
+                    }
+                }
+            }
+
+            if constexpr (has_walk_hook_v<Visitor, OnDataHook>)
+            {
+                // This record has Data attributes.
+                if (wants(Hook::Data))
+                {
+                    for (const auto& data : pRecord->m_DataAttrList)
+                        visitor.OnData(volreader, record, *data);
+                }
+            }
+        }
+    }
+
+    bFreeRecord = true;
+    if constexpr (has_walk_hook_v<Visitor, KeepAliveHook>)
+    {
+        if (wants(Hook::KeepAlive))
+            bFreeRecord = !visitor.KeepAlive(volreader, record);
+    }
+
+    if constexpr (has_walk_hook_v<Visitor, OnProgressHook>)
+    {
+        if (wants(Hook::Progress))
+            hr = visitor.OnProgress((DWORD)((m_dwWalkedItems * 100) / m_ulMFTRecordCount));
+    }
+
+    pRecord->CallbackCalled();
+    pRecord->CleanCachedData();
+    return hr;
+}
+
 }  // namespace Orc
 
 #pragma managed(pop)
@@ -0,0 +1,191 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MappedFileView.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+// No object with a destructor may live in a function using __try
+bool CopyFromView(BYTE* pDest, const BYTE* pSource, size_t cbBytes)
+{
+    __try
+    {
+        CopyMemory(pDest, pSource, cbBytes);
+        return true;
+    }
+    __except (
+        GetExceptionCode() == EXCEPTION_IN_PAGE_ERROR ? EXCEPTION_EXECUTE_HANDLER : EXCEPTION_CONTINUE_SEARCH)
+    {
+        return false;
+    }
+}
+
+}  // namespace
+
+MappedFileView::MappedFileView(ULONGLONG ullWindowSize)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    m_dwGranularity = info.dwAllocationGranularity;
+
+    // Windows start on a granularity boundary, their size is a multiple of it
+    m_ullWindowSize = std::max<ULONGLONG>(ullWindowSize, m_dwGranularity);
+    m_ullWindowSize = ((m_ullWindowSize + m_dwGranularity - 1) / m_dwGranularity) * m_dwGranularity;
+}
+
+HRESULT MappedFileView::Open(HANDLE hFile)
+{
+    HRESULT hr = E_FAIL;
+
+    Close();
+
+    LARGE_INTEGER liFileSize = {0};
+    if (!GetFileSizeEx(hFile, &liFileSize))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Debug(L"Failed to get size of file to map [{}]", SystemError(hr));
+        return hr;
+    }
+
+    // An empty file cannot be mapped
+    if (liFileSize.QuadPart == 0)
+        return HRESULT_FROM_WIN32(ERROR_FILE_INVALID);
+
+    m_hMapping = CreateFileMapping(hFile, NULL, PAGE_WRITECOPY, 0L, 0L, NULL);
+    if (m_hMapping == NULL)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Debug(L"Failed CreateFileMapping [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_ullFileSize = liFileSize.QuadPart;
+    return S_OK;
+}
+
+void MappedFileView::Close()
+{
+    if (m_pView != nullptr)
+    {
+        UnmapViewOfFile(m_pView);
+        m_pView = nullptr;
+    }
+    m_ullViewOffset = 0LL;
+    m_cbView = 0;
+
+    if (m_hMapping != NULL)
+    {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+    m_ullFileSize = 0LL;
+}
+
+HRESULT MappedFileView::MapWindow(ULONGLONG ullOffset, size_t cbBytes)
+{
+    HRESULT hr = E_FAIL;
+
+    const ULONGLONG ullStart = (ullOffset / m_dwGranularity) * m_dwGranularity;
+    const ULONGLONG ullLength =
+        std::min(std::max(m_ullWindowSize, ullOffset + cbBytes - ullStart), m_ullFileSize - ullStart);
+
+    if (ullLength > static_cast<ULONGLONG>(SIZE_MAX))
+        return E_OUTOFMEMORY;
+
+    if (m_pView != nullptr)
+    {
+        UnmapViewOfFile(m_pView);
+        m_pView = nullptr;
+        m_cbView = 0;
+    }
+
+    ULARGE_INTEGER uliStart;
+    uliStart.QuadPart = ullStart;
+
+    m_pView = static_cast<BYTE*>(MapViewOfFile(
+        m_hMapping, FILE_MAP_COPY, uliStart.HighPart, uliStart.LowPart, static_cast<size_t>(ullLength)));
+    if (m_pView == nullptr)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed MapViewOfFile at offset {} ({} bytes) [{}]", ullStart, ullLength, SystemError(hr));
+        return hr;
+    }
+
+    m_ullViewOffset = ullStart;
+    m_cbView = static_cast<size_t>(ullLength);
+    return S_OK;
+}
+
+HRESULT MappedFileView::View(ULONGLONG ullOffset, size_t cbBytes, BYTE*& pData)
+{
+    HRESULT hr = E_FAIL;
+
+    pData = nullptr;
+
+    if (m_hMapping == NULL)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_HANDLE);
+
+    if (ullOffset > m_ullFileSize || cbBytes > m_ullFileSize - ullOffset)
+        return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+    if (m_pView == nullptr || ullOffset < m_ullViewOffset || ullOffset + cbBytes > m_ullViewOffset + m_cbView)
+    {
+        if (FAILED(hr = MapWindow(ullOffset, cbBytes)))
+            return hr;
+    }
+
+    pData = m_pView + (ullOffset - m_ullViewOffset);
+    return S_OK;
+}
+
+HRESULT MappedFileView::Read(ULONGLONG ullOffset, BYTE* pBuffer, size_t cbBytes, size_t& cbRead)
+{
+    HRESULT hr = E_FAIL;
+
+    cbRead = 0;
+
+    if (m_hMapping == NULL)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_HANDLE);
+
+    if (ullOffset >= m_ullFileSize)
+        return S_OK;
+
+    const auto cbAvailable = static_cast<size_t>(std::min<ULONGLONG>(cbBytes, m_ullFileSize - ullOffset));
+
+    while (cbRead < cbAvailable)
+    {
+        // Large reads are copied one window at a time
+        const auto cbChunk = static_cast<size_t>(std::min<ULONGLONG>(cbAvailable - cbRead, m_ullWindowSize));
+
+        BYTE* pData = nullptr;
+        if (FAILED(hr = View(ullOffset + cbRead, cbChunk, pData)))
+            return hr;
+
+        if (!CopyFromView(pBuffer + cbRead, pData, cbChunk))
+        {
+            Log::Error(L"Failed to read mapped file at offset {}: in page error", ullOffset + cbRead);
+            return HRESULT_FROM_WIN32(ERROR_READ_FAULT);
+        }
+
+        cbRead += cbChunk;
+    }
+
+    return S_OK;
+}
+
+MappedFileView::~MappedFileView()
+{
+    Close();
+}
@@ -0,0 +1,60 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Read only access to a file through a copy on write mapping. The file is mapped one window at a time so that files
+// larger than the address space can be read. Pages written through a view (e.g. an in place MultiSectorFixup) become
+// private copies: the file itself is never modified.
+class MappedFileView
+{
+public:
+    static constexpr ULONGLONG kDefaultWindowSize =
+        sizeof(void*) == 8 ? 1024 * 1024 * 1024ULL : 64 * 1024 * 1024ULL;
+
+    MappedFileView(ULONGLONG ullWindowSize = kDefaultWindowSize);
+    MappedFileView(const MappedFileView&) = delete;
+    MappedFileView& operator=(const MappedFileView&) = delete;
+
+    HRESULT Open(HANDLE hFile);
+    void Close();
+
+    bool IsOpen() const { return m_hMapping != NULL; }
+    ULONGLONG FileSize() const { return m_ullFileSize; }
+    ULONGLONG WindowSize() const { return m_ullWindowSize; }
+
+    // Point 'pData' to the 'cbBytes' bytes at 'ullOffset', the pointer is valid until the next call to View or Read
+    HRESULT View(ULONGLONG ullOffset, size_t cbBytes, BYTE*& pData);
+
+    // Copy up to 'cbBytes' bytes at 'ullOffset' (fewer at the end of the file), an I/O error on a mapped page fails
+    // with ERROR_READ_FAULT instead of raising an exception
+    HRESULT Read(ULONGLONG ullOffset, BYTE* pBuffer, size_t cbBytes, size_t& cbRead);
+
+    ~MappedFileView();
+
+private:
+    HRESULT MapWindow(ULONGLONG ullOffset, size_t cbBytes);
+
+    HANDLE m_hMapping = NULL;
+    BYTE* m_pView = nullptr;
+    ULONGLONG m_ullViewOffset = 0LL;
+    size_t m_cbView = 0;
+
+    ULONGLONG m_ullFileSize = 0LL;
+    ULONGLONG m_ullWindowSize;
+    DWORD m_dwGranularity;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,423 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MemoryAccounting.h"
+
+#include "ParameterCheck.h"
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+
+#include <boost/algorithm/string.hpp>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcMemoryLimitsEnv = L"DFIR-ORC_MEMORY_LIMITS";
+constexpr auto TagCount = static_cast<size_t>(MemoryAccounting::Tag::Count);
+
+// Tags are charged from many threads: each one has its own cache line
+struct alignas(64) Counter
+{
+    std::atomic<ULONGLONG> Current {0LL};
+    std::atomic<ULONGLONG> Peak {0LL};
+    std::atomic<ULONGLONG> SoftLimit {0LL};
+    std::atomic<ULONGLONG> OverSoftLimit {0LL};
+};
+
+HRESULT ParseSoftLimits(const std::wstring& strLimits, std::array<std::optional<ULONGLONG>, TagCount>& limits)
+{
+    std::vector<std::wstring> items;
+    boost::split(items, strLimits, boost::is_any_of(L","));
+
+    for (auto& item : items)
+    {
+        boost::trim(item);
+        if (item.empty())
+            continue;
+
+        const auto separator = item.find(L':');
+        if (separator == std::wstring::npos)
+        {
+            Log::Error(L"Invalid memory soft limit '{}' (expected '<tag>:<size>')", item);
+            return E_INVALIDARG;
+        }
+
+        const auto tag = MemoryAccounting::FromString(std::wstring_view(item).substr(0, separator));
+        if (!tag)
+        {
+            Log::Error(L"Invalid memory soft limit '{}': unknown tag", item);
+            return E_INVALIDARG;
+        }
+
+        LARGE_INTEGER size;
+        if (auto hr = GetFileSizeFromArg(item.c_str() + separator + 1, size); FAILED(hr))
+        {
+            Log::Error(L"Invalid memory soft limit '{}' [{}]", item, SystemError(hr));
+            return hr;
+        }
+
+        limits[static_cast<size_t>(*tag)] = static_cast<ULONGLONG>(size.QuadPart);
+    }
+
+    return S_OK;
+}
+
+class Counters
+{
+public:
+    static Counters& Instance()
+    {
+        static Counters instance;
+        return instance;
+    }
+
+    Counter& operator[](MemoryAccounting::Tag tag) { return m_counters[static_cast<size_t>(tag)]; }
+
+private:
+    // Soft limits configured by a parent process
+    Counters()
+    {
+        WCHAR szValue[ORC_MAX_PATH] = {0};
+        const auto nbChars = GetEnvironmentVariableW(OrcMemoryLimitsEnv, szValue, ARRAYSIZE(szValue));
+        if (nbChars == 0 || nbChars >= ARRAYSIZE(szValue))
+            return;
+
+        std::array<std::optional<ULONGLONG>, TagCount> limits;
+        if (FAILED(ParseSoftLimits(szValue, limits)))
+            return;
+
+        for (size_t i = 0; i < TagCount; i++)
+        {
+            if (limits[i])
+                m_counters[i].SoftLimit = *limits[i];
+        }
+    }
+
+    Counter m_counters[TagCount];
+};
+
+class CountingResource : public std::pmr::memory_resource
+{
+public:
+    CountingResource(MemoryAccounting::Tag tag)
+        : m_tag(tag)
+    {
+    }
+
+private:
+    void* do_allocate(size_t cbBytes, size_t alignment) override
+    {
+        auto pData = std::pmr::new_delete_resource()->allocate(cbBytes, alignment);
+        MemoryAccounting::Charge(m_tag, cbBytes);
+        return pData;
+    }
+
+    void do_deallocate(void* pData, size_t cbBytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(pData, cbBytes, alignment);
+        MemoryAccounting::Release(m_tag, cbBytes);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+    MemoryAccounting::Tag m_tag;
+};
+
+std::filesystem::path StatisticsPath(const std::wstring& strDirectory, DWORD dwPid)
+{
+    return std::filesystem::path(strDirectory) / fmt::format(L"{}.memory.tsv", dwPid);
+}
+
+}  // namespace
+
+MemoryAccounting::Allocation::Allocation(Allocation&& other) noexcept
+    : m_tag(other.m_tag)
+    , m_ullBytes(other.m_ullBytes)
+{
+    other.m_ullBytes = 0LL;
+}
+
+MemoryAccounting::Allocation& MemoryAccounting::Allocation::operator=(Allocation&& other) noexcept
+{
+    if (this != &other)
+    {
+        Set(0LL);
+        m_tag = other.m_tag;
+        m_ullBytes = other.m_ullBytes;
+        other.m_ullBytes = 0LL;
+    }
+    return *this;
+}
+
+bool MemoryAccounting::Allocation::Set(ULONGLONG ullBytes)
+{
+    if (ullBytes == m_ullBytes)
+        return !IsOverSoftLimit(m_tag);
+
+    bool bWithinLimit = true;
+    if (ullBytes > m_ullBytes)
+        bWithinLimit = Charge(m_tag, ullBytes - m_ullBytes);
+    else
+    {
+        Release(m_tag, m_ullBytes - ullBytes);
+        bWithinLimit = !IsOverSoftLimit(m_tag);
+    }
+
+    m_ullBytes = ullBytes;
+    return bWithinLimit;
+}
+
+bool MemoryAccounting::Charge(Tag tag, ULONGLONG ullBytes)
+{
+    if (tag >= Tag::Count)
+        return true;
+
+    auto& counter = Counters::Instance()[tag];
+    const auto ullCurrent = counter.Current.fetch_add(ullBytes, std::memory_order_relaxed) + ullBytes;
+
+    auto ullPeak = counter.Peak.load(std::memory_order_relaxed);
+    while (ullCurrent > ullPeak && !counter.Peak.compare_exchange_weak(ullPeak, ullCurrent, std::memory_order_relaxed))
+    {
+    }
+
+    const auto ullLimit = counter.SoftLimit.load(std::memory_order_relaxed);
+    if (ullLimit == 0 || ullCurrent <= ullLimit)
+        return true;
+
+    counter.OverSoftLimit.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void MemoryAccounting::Release(Tag tag, ULONGLONG ullBytes)
+{
+    if (tag >= Tag::Count)
+        return;
+
+    Counters::Instance()[tag].Current.fetch_sub(ullBytes, std::memory_order_relaxed);
+}
+
+bool MemoryAccounting::IsOverSoftLimit(Tag tag)
+{
+    if (tag >= Tag::Count)
+        return false;
+
+    auto& counter = Counters::Instance()[tag];
+    const auto ullLimit = counter.SoftLimit.load(std::memory_order_relaxed);
+    return ullLimit != 0 && counter.Current.load(std::memory_order_relaxed) > ullLimit;
+}
+
+ULONGLONG MemoryAccounting::GetSoftLimit(Tag tag)
+{
+    if (tag >= Tag::Count)
+        return 0LL;
+
+    return Counters::Instance()[tag].SoftLimit.load(std::memory_order_relaxed);
+}
+
+void MemoryAccounting::SetSoftLimit(Tag tag, ULONGLONG ullBytes)
+{
+    if (tag >= Tag::Count)
+        return;
+
+    Counters::Instance()[tag].SoftLimit.store(ullBytes, std::memory_order_relaxed);
+}
+
+HRESULT MemoryAccounting::ConfigureSoftLimits(const std::wstring& strLimits)
+{
+    std::array<std::optional<ULONGLONG>, TagCount> limits;
+    if (auto hr = ParseSoftLimits(strLimits, limits); FAILED(hr))
+        return hr;
+
+    std::vector<std::wstring> values;
+    for (size_t i = 0; i < TagCount; i++)
+    {
+        if (!limits[i])
+            continue;
+
+        SetSoftLimit(static_cast<Tag>(i), *limits[i]);
+        values.push_back(fmt::format(L"{}:{}", ToString(static_cast<Tag>(i)), *limits[i]));
+        Log::Info(L"Memory soft limit of '{}': {} bytes", ToString(static_cast<Tag>(i)), *limits[i]);
+    }
+
+    const auto strValue = boost::join(values, L",");
+    if (!SetEnvironmentVariableW(OrcMemoryLimitsEnv, strValue.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcMemoryLimitsEnv, strValue, SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+std::pmr::memory_resource* MemoryAccounting::GetResource(Tag tag)
+{
+    static CountingResource resources[TagCount] = {
+        CountingResource(Tag::MFTWalk),
+        CountingResource(Tag::FileFind),
+        CountingResource(Tag::TableWrite),
+        CountingResource(Tag::TemporaryStream),
+        CountingResource(Tag::Yara)};
+    static_assert(ARRAYSIZE(resources) == TagCount);
+
+    if (tag >= Tag::Count)
+        return std::pmr::new_delete_resource();
+
+    return &resources[static_cast<size_t>(tag)];
+}
+
+MemoryAccounting::Statistics MemoryAccounting::GetStatistics()
+{
+    auto& counters = Counters::Instance();
+
+    Statistics statistics;
+    for (size_t i = 0; i < TagCount; i++)
+    {
+        const auto& counter = counters[static_cast<Tag>(i)];
+        statistics[i].Current = counter.Current.load(std::memory_order_relaxed);
+        statistics[i].Peak = counter.Peak.load(std::memory_order_relaxed);
+        statistics[i].SoftLimit = counter.SoftLimit.load(std::memory_order_relaxed);
+        statistics[i].OverSoftLimit = counter.OverSoftLimit.load(std::memory_order_relaxed);
+    }
+
+    return statistics;
+}
+
+std::wstring_view MemoryAccounting::ToString(Tag tag)
+{
+    switch (tag)
+    {
+        case Tag::MFTWalk:
+            return L"mft_walk";
+        case Tag::FileFind:
+            return L"file_find";
+        case Tag::TableWrite:
+            return L"table_write";
+        case Tag::TemporaryStream:
+            return L"temporary_stream";
+        case Tag::Yara:
+            return L"yara";
+        default:
+            return L"unknown";
+    }
+}
+
+std::optional<MemoryAccounting::Tag> MemoryAccounting::FromString(std::wstring_view tag)
+{
+    for (size_t i = 0; i < TagCount; i++)
+    {
+        if (boost::iequals(tag, ToString(static_cast<Tag>(i))))
+            return static_cast<Tag>(i);
+    }
+
+    return std::nullopt;
+}
+
+void MemoryAccounting::LogStatistics()
+{
+    const auto statistics = GetStatistics();
+    for (size_t i = 0; i < TagCount; i++)
+    {
+        const auto& usage = statistics[i];
+        if (usage.Peak == 0)
+            continue;
+
+        Log::Debug(
+            L"MemoryAccounting: '{}' current: {} bytes, peak: {} bytes, soft limit: {} bytes (exceeded {} time(s))",
+            ToString(static_cast<Tag>(i)),
+            usage.Current,
+            usage.Peak,
+            usage.SoftLimit,
+            usage.OverSoftLimit);
+    }
+}
+
+HRESULT MemoryAccounting::Save()
+{
+    const auto directory = Telemetry::GetDirectory();
+    if (!directory || Telemetry::IsCollector())
+        return S_FALSE;
+
+    const auto path = StatisticsPath(*directory, GetCurrentProcessId());
+
+    // Format: one tab separated line per tag: <tag> <current> <peak> <soft limit> <over soft limit>
+    std::ofstream ofs(path, std::ios_base::binary | std::ios_base::trunc);
+    if (!ofs)
+    {
+        Log::Warn(L"Failed to create memory statistics file '{}'", path.wstring());
+        return E_FAIL;
+    }
+
+    const auto statistics = GetStatistics();
+    for (size_t i = 0; i < TagCount; i++)
+    {
+        ofs << i << '\t' << statistics[i].Current << '\t' << statistics[i].Peak << '\t' << statistics[i].SoftLimit
+            << '\t' << statistics[i].OverSoftLimit << '\n';
+    }
+
+    ofs.close();
+    if (ofs.fail())
+    {
+        Log::Warn(L"Failed to write memory statistics file '{}'", path.wstring());
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+std::optional<MemoryAccounting::Statistics> MemoryAccounting::Load(DWORD dwPid)
+{
+    const auto directory = Telemetry::GetDirectory();
+    if (!directory)
+        return std::nullopt;
+
+    const auto path = StatisticsPath(*directory, dwPid);
+
+    Statistics statistics;
+    bool bFound = false;
+
+    {
+        std::ifstream ifs(path, std::ios_base::binary);
+        if (!ifs)
+            return std::nullopt;
+
+        size_t index = 0;
+        Usage usage;
+        while (ifs >> index >> usage.Current >> usage.Peak >> usage.SoftLimit >> usage.OverSoftLimit)
+        {
+            if (index >= TagCount)
+                continue;
+
+            statistics[index] = usage;
+            bFound = true;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (ec)
+    {
+        Log::Debug(L"Failed to remove memory statistics file '{}' [{}]", path.wstring(), ec);
+    }
+
+    if (!bFound)
+        return std::nullopt;
+
+    return statistics;
+}
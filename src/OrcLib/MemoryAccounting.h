@@ -0,0 +1,117 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// MemoryAccounting: process wide current and peak bytes held by the memory hungry subsystems of the tools.
+//
+// Subsystems charge their large allocations (slabs, page buffers, queued scan buffers, pooled objects) to their tag,
+// either explicitly or through an Allocation member or a counting memory resource for polymorphic allocators. Small
+// allocations are not tracked: this is a budget view, not a heap profiler.
+//
+// A tag may have a soft limit: charges are never refused, subsystems which can spill or flush check IsOverSoftLimit
+// (MFT walk: records are walked and released earlier, table writers: pages are flushed earlier, temporary streams:
+// spilled to disk, yara: queued buffers are throttled, file find: matches are not pooled).
+//
+// Soft limits are inherited by child processes through %DFIR-ORC_MEMORY_LIMITS%, statistics are saved next to the
+// Telemetry ones ('<directory>\<pid>.memory.tsv') so the parent process can report them with the command outcome.
+//
+class MemoryAccounting
+{
+public:
+    enum class Tag : UCHAR
+    {
+        MFTWalk = 0,
+        FileFind,
+        TableWrite,
+        TemporaryStream,
+        Yara,
+        Count
+    };
+
+    struct Usage
+    {
+        ULONGLONG Current = 0LL;
+        ULONGLONG Peak = 0LL;
+        ULONGLONG SoftLimit = 0LL;  // 0 for none
+        ULONGLONG OverSoftLimit = 0LL;  // charges which went over the soft limit
+    };
+
+    using Statistics = std::array<Usage, static_cast<size_t>(Tag::Count)>;
+
+    // Bytes held by their owner, charged to 'tag' until released or destroyed
+    class Allocation
+    {
+    public:
+        Allocation(Tag tag)
+            : m_tag(tag)
+        {
+        }
+        ~Allocation() { Set(0LL); }
+
+        Allocation(const Allocation&) = delete;
+        Allocation& operator=(const Allocation&) = delete;
+
+        Allocation(Allocation&& other) noexcept;
+        Allocation& operator=(Allocation&& other) noexcept;
+
+        // Account for 'ullBytes' held now, returns false when the tag is over its soft limit
+        bool Set(ULONGLONG ullBytes);
+
+        ULONGLONG Bytes() const { return m_ullBytes; }
+
+    private:
+        Tag m_tag;
+        ULONGLONG m_ullBytes = 0LL;
+    };
+
+    // Charge 'ullBytes' more to 'tag', returns false when the tag is over its soft limit
+    static bool Charge(Tag tag, ULONGLONG ullBytes);
+    static void Release(Tag tag, ULONGLONG ullBytes);
+
+    static bool IsOverSoftLimit(Tag tag);
+    static ULONGLONG GetSoftLimit(Tag tag);
+    static void SetSoftLimit(Tag tag, ULONGLONG ullBytes);
+
+    // Set the soft limits of 'strLimits' ('<tag>:<size>' separated by ',', ex: 'mft_walk:512MB,yara:128MB') for this
+    // process and its children
+    static HRESULT ConfigureSoftLimits(const std::wstring& strLimits);
+
+    // Memory resource charging its allocations to 'tag', for std::pmr containers
+    static std::pmr::memory_resource* GetResource(Tag tag);
+
+    static Statistics GetStatistics();
+
+    static std::wstring_view ToString(Tag tag);
+    static std::optional<Tag> FromString(std::wstring_view tag);
+
+    static void LogStatistics();
+
+    // Write this process statistics to the telemetry directory, if any and not configured by this process (S_FALSE
+    // otherwise)
+    static HRESULT Save();
+
+    // Read and remove the statistics saved by process 'dwPid'
+    static std::optional<Statistics> Load(DWORD dwPid);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
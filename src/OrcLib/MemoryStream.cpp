@@ -26,9 +26,13 @@ static const size_t MEMORY_STREAM_MIN_ALLOC = 4096;
 // The maximum byte size after which the buffer STOP growing exponentialy
 static const size_t MEMORY_STREAM_EXPONENTIAL_THRESHOLD = ((1024 * 1024 * 32) + 1);
 
-// The amount to grow the buffer after exponential growth is stopped.
+// The minimum amount to grow the buffer after exponential growth is stopped, it then grows by half its size so that
+// large streams are not copied over and over when the buffer must be relocated.
 static const size_t MEMORY_STREAM_THRESHOLD_INCREMENT = (1024 * 1024 * 16);
 
+// Commits past the exponential threshold are rounded to the allocation granularity
+static const size_t MEMORY_STREAM_COMMIT_GRANULARITY = (64 * 1024);
+
 static const size_t MEMORY_STREAM_RESERVE_MAX = (1024 * 1024 * 200);
 
 STDMETHODIMP Orc::MemoryStream::Clone(std::shared_ptr<ByteStream>& clone)
@@ -200,6 +204,7 @@ HRESULT MemoryStream::SetBufferSize(size_t dwCommitSize, size_t dwReserveSize)
 {
     HRESULT hr = E_FAIL;
     PBYTE pNewBuffer = NULL;
+    size_t dwNewReservedBytes = 0;
 
     if (dwCommitSize > dwReserveSize)
         dwReserveSize = dwCommitSize;
@@ -215,7 +220,7 @@ HRESULT MemoryStream::SetBufferSize(size_t dwCommitSize, size_t dwReserveSize)
                 Log::Debug("Could not reserve {} bytes", dwReserveSize);
             }
             else
-                m_cbReservedBytes = dwReserveSize;
+                m_cbReservedBytes = std::min(MEMORY_STREAM_RESERVE_MAX, dwReserveSize);
         }
     }
 
@@ -225,10 +230,28 @@ HRESULT MemoryStream::SetBufferSize(size_t dwCommitSize, size_t dwReserveSize)
         pNewBuffer = (PBYTE)VirtualAlloc(
             m_pBuffer, dwCommitSize, m_pBuffer == NULL ? (MEM_COMMIT | MEM_RESERVE) : MEM_COMMIT, PAGE_READWRITE);
 
+        if (!pNewBuffer && m_pBuffer != nullptr)
+        {
+            // if that fails, relocate into a reservation with room for the next commits to stay where they are
+            const size_t dwNewReserveSize = std::max(dwReserveSize, dwCommitSize + dwCommitSize / 2);
+            pNewBuffer = (PBYTE)VirtualAlloc(NULL, dwNewReserveSize, MEM_RESERVE, PAGE_READWRITE);
+            if (pNewBuffer)
+            {
+                if (VirtualAlloc(pNewBuffer, dwCommitSize, MEM_COMMIT, PAGE_READWRITE))
+                    dwNewReservedBytes = dwNewReserveSize;
+                else
+                {
+                    VirtualFree(pNewBuffer, 0L, MEM_RELEASE);
+                    pNewBuffer = NULL;
+                }
+            }
+        }
+
         if (!pNewBuffer)
         {
             // if that fails, ask any location
             pNewBuffer = (PBYTE)VirtualAlloc(NULL, dwCommitSize, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+            dwNewReservedBytes = dwCommitSize;
         }
 
         if (!pNewBuffer)
@@ -266,6 +289,8 @@ HRESULT MemoryStream::SetBufferSize(size_t dwCommitSize, size_t dwReserveSize)
         CopyMemory(pNewBuffer, m_pBuffer, std::min(m_cbBuffer, dwCommitSize));
         VirtualFree(m_pBuffer, 0L, MEM_RELEASE);
     }
+    if (m_pBuffer != pNewBuffer && pNewBuffer != nullptr)
+        m_cbReservedBytes = std::max(dwNewReservedBytes, dwCommitSize);
     m_pBuffer = pNewBuffer;
     m_cbBufferCommitSize = dwCommitSize;
     return S_OK;
@@ -332,8 +357,19 @@ HRESULT MemoryStream::Write_(
         }
         else
         {
-            // Threshold was reached, start growing the buffer linearly.
-            dwAllocSize = static_cast<size_t>(cbBytesToWrite) + m_dwCurrFilePointer + MEMORY_STREAM_THRESHOLD_INCREMENT;
+            // Threshold was reached, keep growing the buffer geometrically but by a smaller factor
+            const size_t dwRequired = static_cast<size_t>(cbBytesToWrite) + m_dwCurrFilePointer;
+            const size_t dwIncrement = std::max(m_cbBufferCommitSize / 2, MEMORY_STREAM_THRESHOLD_INCREMENT);
+            dwAllocSize = std::max(dwRequired, m_cbBufferCommitSize + dwIncrement);
+
+            const size_t dwGranularity = MEMORY_STREAM_COMMIT_GRANULARITY;
+            const size_t dwRounded = ((dwAllocSize + dwGranularity - 1) / dwGranularity) * dwGranularity;
+            if (dwRounded < dwRequired)
+            {
+                Log::Error("Alloc size overflowed while rounding up");
+                return E_OUTOFMEMORY;
+            }
+            dwAllocSize = dwRounded;
         }
 
         if (FAILED(hr = SetBufferSize(dwAllocSize, m_cbReservedBytes)))
@@ -464,7 +500,9 @@ void Orc::MemoryStream::GrabBuffer(CBinaryBuffer& buffer)
     buffer.RemoveAll();
     std::swap(m_pBuffer, buffer.m_pData);
     std::swap(m_cbBuffer, buffer.m_size);
+    buffer.m_capacity = buffer.m_size;
     buffer.m_bVirtualAlloc = true;
+    buffer.m_bPooled = false;
     buffer.m_bOwnMemory = true;
     buffer.m_bJunk = false;
 }
@@ -20,6 +20,7 @@
 #include "NTFSStream.h"
 #include "UncompressNTFSStream.h"
 #include "UncompressWofStream.h"
+#include "WofChunkCache.h"
 #include "Filesystem/Ntfs/Attribute/ReparsePoint/WofReparsePoint.h"
 #include "SystemDetails.h"
 #include "Log/Log.h"
@@ -603,20 +604,12 @@ HRESULT MftRecordAttribute::GetHashInformation(
         needed |= CryptoHashStream::Algorithm::SHA1;
     if (HasFlag(required, CryptoHashStream::Algorithm::SHA256) && m_Details->SHA256().empty())
         needed |= CryptoHashStream::Algorithm::SHA256;
+    if (HasFlag(required, CryptoHashStream::Algorithm::BLAKE3) && m_Details->BLAKE3().empty())
+        needed |= CryptoHashStream::Algorithm::BLAKE3;
 
     if (needed == CryptoHashStream::Algorithm::Undefined)
         return S_OK;
 
-    auto stream = GetDataStream(pVolReader);
-    if (!stream)
-        return E_FAIL;
-
-    if (FAILED(hr = stream->SetFilePointer(0LL, SEEK_SET, nullptr)))
-    {
-        Log::Debug("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-        return hr;
-    }
-
     shared_ptr<CryptoHashStream> pHashStream = make_shared<CryptoHashStream>();
     if (!pHashStream)
         return E_OUTOFMEMORY;
@@ -625,13 +618,32 @@ HRESULT MftRecordAttribute::GetHashInformation(
         return hr;
 
     ULONGLONG ullWritten = 0LL;
-    if (FAILED(hr = stream->CopyTo(pHashStream, &ullWritten)))
-        return hr;
-
-    if (FAILED(hr = stream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+    if (const auto resident = GetResidentData())
     {
-        Log::Debug("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
-        return hr;
+        // Resident data is hashed in place, without opening a data stream
+        if (FAILED(hr = pHashStream->Write(const_cast<uint8_t*>(resident->data()), resident->size(), &ullWritten)))
+            return hr;
+    }
+    else
+    {
+        auto stream = GetDataStream(pVolReader);
+        if (!stream)
+            return E_FAIL;
+
+        if (FAILED(hr = stream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+        {
+            Log::Debug("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+            return hr;
+        }
+
+        if (FAILED(hr = stream->CopyTo(pHashStream, &ullWritten)))
+            return hr;
+
+        if (FAILED(hr = stream->SetFilePointer(0LL, SEEK_SET, nullptr)))
+        {
+            Log::Debug("Failed to seek pointer to 0 for data attribute [{}]", SystemError(hr));
+            return hr;
+        }
     }
 
     if (HasFlag(needed, CryptoHashStream::Algorithm::MD5))
@@ -655,6 +667,13 @@ HRESULT MftRecordAttribute::GetHashInformation(
             return hr;
         m_Details->SetSHA256(std::move(sha256));
     }
+    if (HasFlag(needed, CryptoHashStream::Algorithm::BLAKE3))
+    {
+        CBinaryBuffer blake3;
+        if (FAILED(hr = pHashStream->GetBLAKE3(blake3)))
+            return hr;
+        m_Details->SetBLAKE3(std::move(blake3));
+    }
 
     return S_OK;
 }
@@ -716,7 +735,7 @@ HRESULT BitmapAttribute::LoadBitField(const std::shared_ptr<VolumeReader>& volre
         std::shared_ptr<MftRecordAttribute> attr = shared_from_this();
 
         CBinaryBuffer pData;
-        pData.SetCount(static_cast<size_t>(ullBytesToRead));
+        pData.Reserve(static_cast<size_t>(ullBytesToRead));
         if (FAILED(hr = m_pHostRecord->ReadData(volreader, attr, 0, ullBytesToRead, pData, &ullBytesRead)))
             return hr;
 
@@ -931,8 +950,15 @@ HRESULT WOFReparseAttribute::GetStreams(
         rawStream = stream;
     }
 
+    std::optional<uint64_t> cacheFileId;
+    if (auto& cache = WofChunkCache::Instance(); cache.IsEnabled() && pVolReader)
+    {
+        cacheFileId = cache.GetFileId(pVolReader->GetLocation(), baseRecord->GetSafeMFTSegmentNumber());
+    }
+
     auto wofStream = make_shared<UncompressWofStream>();
-    HRESULT hr = wofStream->Open(rawStream, m_algorithm, dataAttribute->Header()->Form.Nonresident.FileSize);
+    HRESULT hr =
+        wofStream->Open(rawStream, m_algorithm, dataAttribute->Header()->Form.Nonresident.FileSize, cacheFileId);
     if (FAILED(hr))
     {
         Log::Debug("Failed to open wof stream [{}]", SystemError(hr));
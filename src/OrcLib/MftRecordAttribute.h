@@ -17,7 +17,9 @@
 #include "MFTUtils.h"
 #include "CryptoHashStream.h"
 #include "Filesystem/Ntfs/Compression/WofAlgorithm.h"
+#include "Utils/BufferView.h"
 
+#include <optional>
 #include <vector>
 #include <boost/dynamic_bitset/dynamic_bitset.hpp>
 
@@ -116,6 +118,17 @@ public:
 
     MFTUtils::NonResidentDataAttrInfo* GetNonResidentInformation(const std::shared_ptr<VolumeReader>& pVolReader);
 
+    // Value of a resident attribute, read in place from the record: valid as long as the record, unset if non resident
+    std::optional<BufferView> GetResidentData() const
+    {
+        if (m_pHeader == nullptr || m_pHeader->FormCode != RESIDENT_FORM)
+            return std::nullopt;
+
+        return BufferView(
+            reinterpret_cast<const uint8_t*>(m_pHeader) + m_pHeader->Form.Resident.ValueOffset,
+            m_pHeader->Form.Resident.ValueLength);
+    }
+
     bool IsContinuation() const
     {
         if (m_pHeader->FormCode == RESIDENT_FORM)
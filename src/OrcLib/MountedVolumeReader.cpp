@@ -184,6 +184,40 @@ HRESULT MountedVolumeReader::GetDiskExtents()
         {
             Extent.m_PhysicalSectorSize = Extent.m_LogicalSectorSize = DiskGeometryEx.Geometry.BytesPerSector;
         }
+        // Largest read the adapter accepts at once, also bounded by its scatter gather list (a buffer not aligned on a
+        // page boundary needs one more page)
+        STORAGE_PROPERTY_QUERY AdapterQuery;
+        AdapterQuery.QueryType = PropertyStandardQuery;
+        AdapterQuery.PropertyId = StorageAdapterProperty;
+
+        STORAGE_ADAPTER_DESCRIPTOR sad;
+        ZeroMemory(&sad, sizeof(STORAGE_ADAPTER_DESCRIPTOR));
+        DWORD dwAdapterBytes = 0L;
+        if (DeviceIoControl(
+                Extent.m_hFile,
+                IOCTL_STORAGE_QUERY_PROPERTY,
+                &AdapterQuery,
+                sizeof(STORAGE_PROPERTY_QUERY),
+                &sad,
+                sizeof(STORAGE_ADAPTER_DESCRIPTOR),
+                &dwAdapterBytes,
+                NULL))
+        {
+            constexpr ULONG kPageSize = 0x1000;
+
+            Extent.m_MaxTransferLength = sad.MaximumTransferLength;
+            if (sad.MaximumPhysicalPages > 1 && sad.MaximumPhysicalPages - 1 < MAXULONG / kPageSize)
+                Extent.m_MaxTransferLength =
+                    std::min<ULONG>(Extent.m_MaxTransferLength, (sad.MaximumPhysicalPages - 1) * kPageSize);
+        }
+        else
+        {
+            Log::Debug(
+                L"Failed to retrieve the maximum transfer length of '{}' [{}]",
+                Extent.GetName(),
+                SystemError(HRESULT_FROM_WIN32(GetLastError())));
+        }
+
         Extent.m_Start = 0;
         Extent.m_Length = DiskLength.Length.QuadPart;
 
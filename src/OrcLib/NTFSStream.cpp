@@ -105,48 +105,94 @@ HRESULT NTFSStream::Read_(
     if (cbBytes == 0LL)
         return S_OK;
 
-    if (m_CurrentSegmentIndex >= m_DataSegments.size())
-        return S_OK;
-
-    if (m_CurrentSegmentOffset
-        >= (m_bAllocatedData ? m_DataSegments[m_CurrentSegmentIndex].ullAllocatedSize
-                             : m_DataSegments[m_CurrentSegmentIndex].ullSize))
+    // Reads are only split at the largest transfer of the device, kept a multiple of the sector size
+    ULONGLONG ullMaxTransfer = MAXDWORD;
+    if (const auto ulSector = m_pVolReader->GetBytesPerSector(); ulSector > 0)
     {
-        m_CurrentSegmentIndex++;  // We have reached the end of the segment, moving to the next
-        m_CurrentSegmentOffset = 0LL;
+        const auto ulMaxTransfer = m_pVolReader->GetMaxTransferLength();
+        ullMaxTransfer = (ulMaxTransfer >= ulSector ? ulMaxTransfer : MAXDWORD) / ulSector * ulSector;
     }
 
-    if (m_CurrentSegmentIndex >= m_DataSegments.size())
-        return S_OK;
+    ULONGLONG ullTotalRead = 0LL;
+    while (ullTotalRead < cbBytes && m_CurrentSegmentIndex < m_DataSegments.size())
+    {
+        if (m_CurrentSegmentOffset >= SegmentLength(m_CurrentSegmentIndex))
+        {
+            m_CurrentSegmentIndex++;  // We have reached the end of the segment, moving to the next
+            m_CurrentSegmentOffset = 0LL;
+            continue;
+        }
+
+        // Following segments of the same kind make a single extent: physically contiguous runs are read at once,
+        // sparse and invalid runs are zeroed without I/O
+        const auto& segment = m_DataSegments[m_CurrentSegmentIndex];
+        const bool bZero = segment.bUnallocated || !segment.bValidData;
+
+        ULONGLONG ullExtentLength = SegmentLength(m_CurrentSegmentIndex) - m_CurrentSegmentOffset;
+        for (auto i = m_CurrentSegmentIndex + 1; i < m_DataSegments.size() && ullExtentLength < cbBytes - ullTotalRead;
+             ++i)
+        {
+            const auto& next = m_DataSegments[i];
+            if ((next.bUnallocated || !next.bValidData) != bZero)
+                break;
+
+            if (!bZero
+                && m_DataSegments[i - 1].ullDiskBasedOffset + SegmentLength(i - 1) != next.ullDiskBasedOffset)
+                break;
+
+            ullExtentLength += SegmentLength(i);
+        }
+
+        const auto pData = static_cast<PBYTE>(pReadBuffer) + ullTotalRead;
+        ULONGLONG ullToRead = std::min(cbBytes - ullTotalRead, ullExtentLength);
+        ULONGLONG ullBytesRead = 0LL;
+
+        if (bZero)
+        {
+            ZeroMemory(pData, static_cast<size_t>(ullToRead));
+            ullBytesRead = ullToRead;
+        }
+        else
+        {
+            // Straight into the caller's buffer, the reader only bounces it when it is not aligned
+            ullToRead = std::min(ullToRead, ullMaxTransfer);
+            CBinaryBuffer buffer(pData, static_cast<size_t>(ullToRead));
+
+            hr = m_pVolReader->Read(
+                segment.ullDiskBasedOffset + m_CurrentSegmentOffset, buffer, ullToRead, ullBytesRead);
+            if (FAILED(hr))
+            {
+                // What was read is returned, the next read reports the failure
+                if (ullTotalRead > 0LL)
+                    break;
+                return hr;
+            }
+        }
 
-    ULONGLONG ullToRead = std::min(
-        cbBytes,
-        (m_bAllocatedData ? m_DataSegments[m_CurrentSegmentIndex].ullAllocatedSize
-                          : m_DataSegments[m_CurrentSegmentIndex].ullSize)
-            - m_CurrentSegmentOffset);
+        ullTotalRead += ullBytesRead;
+        m_CurrentPosition += ullBytesRead;
 
-    CBinaryBuffer buffer((PBYTE)pReadBuffer, static_cast<size_t>(cbBytes));
-    ULONGLONG ullBytesRead = 0LL;
+        for (auto ullRemaining = ullBytesRead; ullRemaining > 0LL && m_CurrentSegmentIndex < m_DataSegments.size();)
+        {
+            const auto ullInSegment =
+                std::min(ullRemaining, SegmentLength(m_CurrentSegmentIndex) - m_CurrentSegmentOffset);
 
-    if (m_DataSegments[m_CurrentSegmentIndex].bUnallocated || !m_DataSegments[m_CurrentSegmentIndex].bValidData)
-    {
-        ZeroMemory(buffer.GetData(), static_cast<size_t>(ullToRead));
-        ullBytesRead = ullToRead;
-    }
-    else
-    {
-        if (FAILED(
-                hr = m_pVolReader->Read(
-                    m_DataSegments[m_CurrentSegmentIndex].ullDiskBasedOffset + m_CurrentSegmentOffset,
-                    buffer,
-                    ullToRead,
-                    ullBytesRead)))
-            return hr;
+            m_CurrentSegmentOffset += ullInSegment;
+            ullRemaining -= ullInSegment;
+
+            if (ullRemaining > 0LL)
+            {
+                m_CurrentSegmentIndex++;
+                m_CurrentSegmentOffset = 0LL;
+            }
+        }
+
+        if (ullBytesRead < ullToRead)
+            break;
     }
-    m_CurrentSegmentOffset += ullBytesRead;
-    m_CurrentPosition += ullBytesRead;
+
     if (pullBytesRead != nullptr)
-        *pullBytesRead = ullBytesRead;
+        *pullBytesRead = ullTotalRead;
     return S_OK;
 }
 
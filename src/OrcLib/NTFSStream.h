@@ -69,6 +69,11 @@ public:
     STDMETHOD(Close)();
 
 protected:
+    ULONGLONG SegmentLength(std::vector<MFTUtils::DataSegment>::size_type index) const
+    {
+        return m_bAllocatedData ? m_DataSegments[index].ullAllocatedSize : m_DataSegments[index].ullSize;
+    }
+
     std::shared_ptr<VolumeReader> m_pVolReader;
     std::vector<MFTUtils::DataSegment> m_DataSegments;
 
@@ -26,14 +26,14 @@
 using namespace Orc;
 
 NtfsFileInfo::NtfsFileInfo(
-    std::wstring strComputerName,
+    std::wstring_view strComputerName,
     const std::shared_ptr<VolumeReader>& pVolReader,
     Intentions DefaultIntentions,
     const std::vector<Filter>& Filters,
     LPCWSTR szFullName,
     DWORD dwLen,
     Authenticode& codeVerifyTrust)
-    : FileInfo(std::move(strComputerName), pVolReader, DefaultIntentions, Filters, szFullName, dwLen, codeVerifyTrust)
+    : FileInfo(strComputerName, pVolReader, DefaultIntentions, Filters, szFullName, dwLen, codeVerifyTrust)
 {
 }
 
@@ -47,117 +47,93 @@ HRESULT NtfsFileInfo::OpenHash()
     return FileInfo::OpenHash();
 }
 
+FileInfo::ColumnPlan NtfsFileInfo::CompileColumnPlan(const ColumnNameDef columnNames[])
+{
+    return FileInfo::CompileColumnPlan(columnNames, &NtfsFileInfo::GetColumnWriter);
+}
+
 HRESULT NtfsFileInfo::HandleIntentions(const Intentions& intention, ITableOutput& output)
 {
-    HRESULT hr = FileInfo::HandleIntentions(intention, output);
+    const auto writer = GetColumnWriter(intention);
+    if (writer == nullptr)
+        return E_FAIL;
+
+    return (this->*writer)(output);
+}
+
+FileInfo::ColumnWriter NtfsFileInfo::GetColumnWriter(Intentions intention)
+{
+    if (const auto writer = FileInfo::GetColumnWriter(intention))
+        return writer;
 
-    if (E_FAIL == hr)
+    switch (intention)
     {
-        switch (intention)
-        {
-            case Intentions::FILEINFO_LASTATTRCHGDATE:
-                hr = WriteLastAttrChangeDate(output);
-                break;
-
-            case Intentions::FILEINFO_FN_CREATIONDATE:
-                hr = WriteFileNameCreationDate(output);
-                break;
-
-            case Intentions::FILEINFO_FN_LASTMODDATE:
-                hr = WriteFileNameLastModificationDate(output);
-                break;
-
-            case Intentions::FILEINFO_FN_LASTACCDATE:
-                hr = WriteFileNameLastAccessDate(output);
-                break;
-
-            case Intentions::FILEINFO_FN_LASTATTRMODDATE:
-                hr = WriteFileNameLastAttrModificationDate(output);
-                break;
-
-            case Intentions::FILEINFO_USN:
-                hr = WriteUSN(output);
-                break;
-
-            case Intentions::FILEINFO_FRN:
-                hr = WriteFRN(output);
-                break;
-
-            case Intentions::FILEINFO_PARENTFRN:
-                hr = WriteParentFRN(output);
-                break;
-
-            case Intentions::FILEINFO_EXTENDED_ATTRIBUTE:
-                hr = WriteExtendedAttributes(output);
-                break;
-
-            case Intentions::FILEINFO_ADS:
-                hr = WriteADS(output);
-                break;
-
-            case Intentions::FILEINFO_OWNERID:
-                hr = WriteOwnerId(output);
-                break;
-
-            case Intentions::FILEINFO_OWNERSID:
-                hr = WriteOwnerSid(output);
-                break;
-
-            case Intentions::FILEINFO_OWNER:
-                hr = WriteOwner(output);
-                break;
-
-            case Intentions::FILEINFO_FILENAMEID:
-                hr = WriteFilenameID(output);
-                break;
-
-            case Intentions::FILEINFO_DATAID:
-                hr = WriteDataID(output);
-                break;
-
-            case Intentions::FILEINFO_FILENAMEFLAGS:
-                hr = WriteFilenameFlags(output);
-                break;
-
-            case Intentions::FILEINFO_SEC_DESCR_ID:
-                hr = WriteSecDescrID(output);
-                break;
-
-            case Intentions::FILEINFO_EA_SIZE:
-                hr = WriteEASize(output);
-                break;
-
-            case Intentions::FILEINFO_FILENAME_IDX:
-                hr = WriteFilenameIndex(output);
-                break;
-
-            case Intentions::FILEINFO_DATA_IDX:
-                hr = WriteDataIndex(output);
-                break;
-
-            case Intentions::FILEINFO_SNAPSHOTID:
-                hr = WriteSnapshotID(output);
-                break;
-
-            case Intentions::FILEINFO_SSDEEP:
-                hr = WriteSSDeep(output);
-                break;
-
-            case Intentions::FILEINFO_TLSH:
-                hr = output.WriteNothing();
-                break;
-
-            case Intentions::FILEINFO_SIGNED_HASH:
-                hr = WriteSignedHash(output);
-                break;
-
-            default:
-                return E_FAIL;
-                break;
-        }
-    }
+        case Intentions::FILEINFO_LASTATTRCHGDATE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteLastAttrChangeDate);
+
+        case Intentions::FILEINFO_FN_CREATIONDATE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFileNameCreationDate);
+
+        case Intentions::FILEINFO_FN_LASTMODDATE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFileNameLastModificationDate);
+
+        case Intentions::FILEINFO_FN_LASTACCDATE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFileNameLastAccessDate);
+
+        case Intentions::FILEINFO_FN_LASTATTRMODDATE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFileNameLastAttrModificationDate);
+
+        case Intentions::FILEINFO_USN:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteUSN);
+
+        case Intentions::FILEINFO_FRN:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFRN);
+
+        case Intentions::FILEINFO_PARENTFRN:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteParentFRN);
 
-    return hr;
+        case Intentions::FILEINFO_EXTENDED_ATTRIBUTE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteExtendedAttributes);
+
+        case Intentions::FILEINFO_ADS:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteADS);
+
+        case Intentions::FILEINFO_OWNERID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteOwnerId);
+
+        case Intentions::FILEINFO_OWNERSID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteOwnerSid);
+
+        case Intentions::FILEINFO_OWNER:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteOwner);
+
+        case Intentions::FILEINFO_FILENAMEID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFilenameID);
+
+        case Intentions::FILEINFO_DATAID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteDataID);
+
+        case Intentions::FILEINFO_FILENAMEFLAGS:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFilenameFlags);
+
+        case Intentions::FILEINFO_SEC_DESCR_ID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteSecDescrID);
+
+        case Intentions::FILEINFO_EA_SIZE:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteEASize);
+
+        case Intentions::FILEINFO_FILENAME_IDX:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteFilenameIndex);
+
+        case Intentions::FILEINFO_DATA_IDX:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteDataIndex);
+
+        case Intentions::FILEINFO_SNAPSHOTID:
+            return static_cast<ColumnWriter>(&NtfsFileInfo::WriteSnapshotID);
+
+        default:
+            return nullptr;
+    }
 }
 
 HRESULT NtfsFileInfo::WriteLastAttrChangeDate(ITableOutput& output)
@@ -18,7 +18,7 @@ class NtfsFileInfo : public FileInfo
 {
 public:
     NtfsFileInfo(
-        std::wstring strComputerName,
+        std::wstring_view strComputerName,
         const std::shared_ptr<VolumeReader>& pVolReader,
         Intentions dwDefaultIntentions,
         const std::vector<Filter>& filters,
@@ -30,6 +30,9 @@ public:
     virtual HRESULT OpenHash();
     virtual HRESULT HandleIntentions(const Intentions& intention, ITableOutput& output);
 
+    // Column plan resolving the ntfs specific columns as well
+    static ColumnPlan CompileColumnPlan(const ColumnNameDef columnNames[]);
+
     // abstract methods
     virtual bool IsDirectory() = 0;
     virtual std::shared_ptr<ByteStream> GetFileStream() = 0;
@@ -60,6 +63,9 @@ public:
 
     static const ColumnNameDef g_NtfsColumnNames[];
     static const ColumnNameDef g_NtfsAliasNames[];
+
+protected:
+    static ColumnWriter GetColumnWriter(Intentions intention);
 };
 
 }  // namespace Orc
@@ -143,6 +143,13 @@ const ColumnNameDef NtfsFileInfo::g_NtfsColumnNames[] = {
      L"The size of the signature inside the security directory",
      0L},
 
+    {Intentions::FILEINFO_BLAKE3, L"BLAKE3", L"BLAKE3 ", 0L},
+
+    {Intentions::FILEINFO_KNOWNGOOD,
+     L"KnownGood",
+     L"The file is in the known good list: its content was neither hashed nor verified",
+     0L},
+
     {Intentions::FILEINFO_NONE, NULL, NULL, 0L}};
 
 const ColumnNameDef NtfsFileInfo::g_NtfsAliasNames[] = {
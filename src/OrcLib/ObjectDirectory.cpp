@@ -7,7 +7,9 @@
 //
 #include "stdafx.h"
 
+#include <iterator>
 #include <optional>
+#include <vector>
 
 #include "ObjectDirectory.h"
 
@@ -15,6 +17,7 @@
 #include "BinaryBuffer.h"
 
 #include "SystemDetails.h"
+#include "TaskPool.h"
 
 #include "StructuredOutputWriter.h"
 #include "TableOutputWriter.h"
@@ -201,6 +204,15 @@ HRESULT ObjectDirectory::ParseObjectDirectory(
     if (!ObjInformation.SetCount(dwPageSize * 4))
         return E_OUTOFMEMORY;
 
+    // Sub directories are parsed in parallel once this one is enumerated, their objects are inserted where a sequential
+    // walk would have appended them
+    struct SubDirectory
+    {
+        size_t Position;
+        std::wstring Path;
+    };
+    std::vector<SubDirectory> subDirectories;
+
     ULONG Context = 0L, returnedLength = 0L;
     while (SUCCEEDED(
         hr = pNtDll->NtQueryDirectoryObject(
@@ -300,14 +312,7 @@ HRESULT ObjectDirectory::ParseObjectDirectory(
                 case Directory: {
                     if (bRecursive)
                     {
-                        if (FAILED(hr = ParseObjectDirectory(path, objects, bRecursive)))
-                        {
-                            Log::Warn(
-                                L"Failed to recursively parse directory '{}' (subdir '{}') [{}]",
-                                aObjDir,
-                                path,
-                                SystemError(hr));
-                        }
+                        subDirectories.push_back({objects.size(), path});
                     }
 
                     objects.emplace_back(
@@ -333,6 +338,41 @@ HRESULT ObjectDirectory::ParseObjectDirectory(
         }
     }
 
+    if (subDirectories.empty())
+        return S_OK;
+
+    std::vector<std::vector<ObjectInstance>> subObjects(subDirectories.size());
+    TaskPool::ParallelFor(TaskPool::Subsystem::Walk, size_t(0), subDirectories.size(), [&](size_t i) {
+        if (auto hrSubDir = ParseObjectDirectory(subDirectories[i].Path, subObjects[i], bRecursive); FAILED(hrSubDir))
+        {
+            Log::Warn(
+                L"Failed to recursively parse directory '{}' (subdir '{}') [{}]",
+                aObjDir,
+                subDirectories[i].Path,
+                SystemError(hrSubDir));
+        }
+    });
+
+    size_t nbObjects = objects.size();
+    for (const auto& subDirObjects : subObjects)
+        nbObjects += subDirObjects.size();
+
+    std::vector<ObjectInstance> merged;
+    merged.reserve(nbObjects);
+
+    size_t next = 0;
+    for (size_t i = 0; i < subDirectories.size(); i++)
+    {
+        for (; next < subDirectories[i].Position; next++)
+            merged.push_back(std::move(objects[next]));
+
+        std::move(std::begin(subObjects[i]), std::end(subObjects[i]), std::back_inserter(merged));
+    }
+
+    for (; next < objects.size(); next++)
+        merged.push_back(std::move(objects[next]));
+
+    objects = std::move(merged);
     return S_OK;
 }
 
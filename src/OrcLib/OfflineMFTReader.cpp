@@ -65,6 +65,11 @@ HRESULT OfflineMFTReader::LoadDiskProperties()
         return hr;
     }
 
+    if (FAILED(hr = m_MappedView.Open(m_hMFT)))
+    {
+        Log::Debug(L"Offline MFT file '{}' is not mapped, it will be read [{}]", m_szMFTFileName, SystemError(hr));
+    }
+
     return S_OK;
 }
 
@@ -81,12 +86,53 @@ uint64_t OfflineMFTReader::Position() const
 
 HRESULT OfflineMFTReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
 {
-    DBG_UNREFERENCED_PARAMETER(offset);
-    DBG_UNREFERENCED_PARAMETER(data);
-    DBG_UNREFERENCED_PARAMETER(ullBytesToRead);
-    DBG_UNREFERENCED_PARAMETER(ullBytesRead);
+    HRESULT hr = E_FAIL;
 
-    return HRESULT_FROM_WIN32(ERROR_INVALID_OPERATION);
+    ullBytesRead = 0LL;
+
+    if (ullBytesToRead > MAXDWORD)
+        return E_INVALIDARG;
+
+    if (data.OwnsBuffer() && !data.SetCount(static_cast<size_t>(ullBytesToRead)))
+        return E_OUTOFMEMORY;
+
+    const auto cbToRead = std::min(data.GetCount(), static_cast<size_t>(ullBytesToRead));
+
+    if (m_MappedView.IsOpen())
+    {
+        size_t cbRead = 0;
+        if (FAILED(hr = m_MappedView.Read(offset, data.GetData(), cbToRead, cbRead)))
+            return hr;
+
+        ullBytesRead = cbRead;
+    }
+    else
+    {
+        ULARGE_INTEGER liOffset;
+        liOffset.QuadPart = offset;
+
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = liOffset.LowPart;
+        overlapped.OffsetHigh = liOffset.HighPart;
+
+        DWORD dwBytesRead = 0L;
+        if (!ReadFile(m_hMFT, data.GetData(), static_cast<DWORD>(cbToRead), &dwBytesRead, &overlapped))
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            if (hr != HRESULT_FROM_WIN32(ERROR_HANDLE_EOF))
+            {
+                Log::Error(L"Could not read at offset {} in MFT file [{}]", offset, SystemError(hr));
+                return hr;
+            }
+        }
+
+        ullBytesRead = dwBytesRead;
+    }
+
+    if (data.OwnsBuffer())
+        data.SetCount(static_cast<size_t>(ullBytesRead));
+
+    return S_OK;
 }
 
 HRESULT OfflineMFTReader::Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
@@ -112,6 +158,10 @@ std::shared_ptr<VolumeReader> OfflineMFTReader::DuplicateReader()
     DuplicateHandle(
         GetCurrentProcess(), m_hMFT, GetCurrentProcess(), &retval->m_hMFT, 0L, FALSE, DUPLICATE_SAME_ACCESS);
 
+    // The duplicate maps its own windows so that both readers can be used independently
+    if (m_MappedView.IsOpen() && retval->m_hMFT != INVALID_HANDLE_VALUE)
+        retval->m_MappedView.Open(retval->m_hMFT);
+
     return retval;
 }
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "VolumeReader.h"
+#include "MappedFileView.h"
 
 #pragma managed(push, off)
 
@@ -19,6 +20,7 @@ private:
     WCHAR m_szMFTFileName[ORC_MAX_PATH];
     WCHAR m_cOriginalName;
     HANDLE m_hMFT;
+    MappedFileView m_MappedView;
 
 protected:
     virtual std::shared_ptr<VolumeReader> DuplicateReader();
@@ -35,6 +37,10 @@ public:
     const WCHAR* ShortVolumeName() { return L"\\"; }
     HANDLE GetHandle() { return m_hMFT; }
 
+    // The MFT file is mapped when possible: records can then be accessed in place instead of read
+    bool IsMapped() const { return m_MappedView.IsOpen(); }
+    HRESULT View(ULONGLONG offset, size_t cbBytes, BYTE*& pData) { return m_MappedView.View(offset, cbBytes, pData); }
+
     HRESULT LoadDiskProperties(void);
     HANDLE GetDevice() { return INVALID_HANDLE_VALUE; }
 
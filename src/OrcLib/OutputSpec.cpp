@@ -112,7 +112,7 @@ bool OutputSpec::IsFile() const
     return HasAnyFlag(
         Type,
         Kind::File | Kind::TableFile | Kind::StructuredFile | Kind::Archive | Kind::CSV | Kind::TSV | Kind::Parquet
-            | Kind::ORC | Kind::XML | Kind::JSON);
+            | Kind::ORC | Kind::Columnar | Kind::JSONL | Kind::XML | Kind::JSON);
 }
 
 // the same but without archive
@@ -121,12 +121,13 @@ bool OutputSpec::IsRegularFile() const
     return HasAnyFlag(
         Type,
         Kind::File | Kind::TableFile | Kind::StructuredFile | Kind::CSV | Kind::TSV | Kind::Parquet | Kind::ORC
-            | Kind::XML | Kind::JSON);
+            | Kind::Columnar | Kind::JSONL | Kind::XML | Kind::JSON);
 }
 
 bool OutputSpec::IsTableFile() const
 {
-    return HasAnyFlag(Type, Kind::TableFile | Kind::CSV | Kind::TSV | Kind::Parquet | Kind::ORC);
+    return HasAnyFlag(
+        Type, Kind::TableFile | Kind::CSV | Kind::TSV | Kind::Parquet | Kind::ORC | Kind::Columnar | Kind::JSONL);
 }
 
 bool OutputSpec::IsStructuredFile() const
@@ -231,6 +232,20 @@ HRESULT OutputSpec::Configure(
             ArchiveFormat = ArchiveFormat::Unknown;
             return Orc::GetOutputFile(outPath.c_str(), Path, true);
         }
+        else if (equalCaseInsensitive(extension.c_str(), L".col"sv))
+        {
+            Type = static_cast<OutputSpec::Kind>(OutputSpec::Kind::TableFile | OutputSpec::Kind::Columnar);
+            ArchiveFormat = ArchiveFormat::Unknown;
+            return Orc::GetOutputFile(outPath.c_str(), Path, true);
+        }
+        else if (
+            equalCaseInsensitive(extension.c_str(), L".jsonl"sv)
+            || equalCaseInsensitive(extension.c_str(), L".ndjson"sv))
+        {
+            Type = static_cast<OutputSpec::Kind>(OutputSpec::Kind::TableFile | OutputSpec::Kind::JSONL);
+            ArchiveFormat = ArchiveFormat::Unknown;
+            return Orc::GetOutputFile(outPath.c_str(), Path, true);
+        }
     }
     if (HasFlag(supported, OutputSpec::Kind::StructuredFile))
     {
@@ -344,6 +359,127 @@ OutputSpec::Configure(OutputSpec::Kind supported, const ConfigItem& item, std::o
     {
         Password = item.SubItems[CONFIG_OUTPUT_PASSWORD];
     }
+
+    if (::HasValue(item, CONFIG_OUTPUT_BUFFERS))
+    {
+        DWORD dwBuffers = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item.SubItems[CONFIG_OUTPUT_BUFFERS].c_str(), dwBuffers)))
+        {
+            Log::Error(L"Invalid buffer count for output in config file: {}", item.SubItems[CONFIG_OUTPUT_BUFFERS]);
+            return E_INVALIDARG;
+        }
+        WriteBuffers = dwBuffers;
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_ROWGROUP))
+    {
+        DWORD dwRows = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item.SubItems[CONFIG_OUTPUT_ROWGROUP].c_str(), dwRows)) || dwRows == 0L)
+        {
+            Log::Error(L"Invalid row group size for output in config file: {}", item.SubItems[CONFIG_OUTPUT_ROWGROUP]);
+            return E_INVALIDARG;
+        }
+        RowGroupSize = dwRows;
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_ENCODERS))
+    {
+        DWORD dwThreads = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item.SubItems[CONFIG_OUTPUT_ENCODERS].c_str(), dwThreads)))
+        {
+            Log::Error(L"Invalid encoder count for output in config file: {}", item.SubItems[CONFIG_OUTPUT_ENCODERS]);
+            return E_INVALIDARG;
+        }
+        EncoderThreads = dwThreads;
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_MEMORY))
+    {
+        LARGE_INTEGER size = {0};
+        if (FAILED(hr = GetFileSizeFromArg(item.SubItems[CONFIG_OUTPUT_MEMORY].c_str(), size)) || size.QuadPart <= 0)
+        {
+            Log::Error(L"Invalid memory limit for output in config file: {}", item.SubItems[CONFIG_OUTPUT_MEMORY]);
+            return E_INVALIDARG;
+        }
+        MemoryLimit = static_cast<ULONGLONG>(size.QuadPart);
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_SHARDROWS))
+    {
+        LARGE_INTEGER rows = {0};
+        if (FAILED(hr = GetIntegerFromArg(item.SubItems[CONFIG_OUTPUT_SHARDROWS].c_str(), rows)) || rows.QuadPart <= 0)
+        {
+            Log::Error(L"Invalid shard rows for output in config file: {}", item.SubItems[CONFIG_OUTPUT_SHARDROWS]);
+            return E_INVALIDARG;
+        }
+        ShardRows = static_cast<ULONGLONG>(rows.QuadPart);
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_SHARDSIZE))
+    {
+        LARGE_INTEGER size = {0};
+        if (FAILED(hr = GetFileSizeFromArg(item.SubItems[CONFIG_OUTPUT_SHARDSIZE].c_str(), size)) || size.QuadPart <= 0)
+        {
+            Log::Error(L"Invalid shard size for output in config file: {}", item.SubItems[CONFIG_OUTPUT_SHARDSIZE]);
+            return E_INVALIDARG;
+        }
+        ShardSize = static_cast<ULONGLONG>(size.QuadPart);
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_ROWINDEX))
+    {
+        DWORD dwStride = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item.SubItems[CONFIG_OUTPUT_ROWINDEX].c_str(), dwStride)))
+        {
+            Log::Error(
+                L"Invalid row index stride for output in config file: {}", item.SubItems[CONFIG_OUTPUT_ROWINDEX]);
+            return E_INVALIDARG;
+        }
+        RowIndexStride = dwStride;
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_STRIPESIZE))
+    {
+        LARGE_INTEGER size = {0};
+        if (FAILED(hr = GetFileSizeFromArg(item.SubItems[CONFIG_OUTPUT_STRIPESIZE].c_str(), size))
+            || size.QuadPart <= 0)
+        {
+            Log::Error(L"Invalid stripe size for output in config file: {}", item.SubItems[CONFIG_OUTPUT_STRIPESIZE]);
+            return E_INVALIDARG;
+        }
+        StripeSize = static_cast<ULONGLONG>(size.QuadPart);
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_TABLEFORMAT))
+    {
+        if (equalCaseInsensitive(item.SubItems[CONFIG_OUTPUT_TABLEFORMAT].c_str(), L"csv"sv))
+        {
+            TableFormat = OutputSpec::Kind::CSV;
+        }
+        else if (equalCaseInsensitive(item.SubItems[CONFIG_OUTPUT_TABLEFORMAT].c_str(), L"jsonl"sv))
+        {
+            TableFormat = OutputSpec::Kind::JSONL;
+        }
+        else
+        {
+            Log::Error(
+                L"Invalid table format for output in config file: {}", item.SubItems[CONFIG_OUTPUT_TABLEFORMAT]);
+            return E_INVALIDARG;
+        }
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_SORTKEYS))
+    {
+        boost::split(SortKeys, (const std::wstring&)item.SubItems[CONFIG_OUTPUT_SORTKEYS], boost::is_any_of(L",;"));
+        SortKeys.erase(std::remove(std::begin(SortKeys), std::end(SortKeys), L""), std::end(SortKeys));
+    }
+
+    if (::HasValue(item, CONFIG_OUTPUT_BLOOMFILTERS))
+    {
+        boost::split(
+            BloomFilters, (const std::wstring&)item.SubItems[CONFIG_OUTPUT_BLOOMFILTERS], boost::is_any_of(L",;"));
+        BloomFilters.erase(std::remove(std::begin(BloomFilters), std::end(BloomFilters), L""), std::end(BloomFilters));
+    }
     return S_OK;
 }
 
@@ -571,6 +707,28 @@ HRESULT OutputSpec::Upload::Configure(const ConfigItem& item)
             boost::split(
                 FilterExclude, (const std::wstring&)item.SubItems[CONFIG_UPLOAD_FILTER_INC], boost::is_any_of(L",;"));
         }
+
+        if (::HasValue(item, CONFIG_UPLOAD_PARTSIZE))
+        {
+            LARGE_INTEGER size = {0};
+            HRESULT hr = GetFileSizeFromArg(item[CONFIG_UPLOAD_PARTSIZE].c_str(), size);
+            if (FAILED(hr))
+            {
+                Log::Error(
+                    L"Invalid upload part size '{}' [{}]", item.SubItems[CONFIG_UPLOAD_PARTSIZE], SystemError(hr));
+                return hr;
+            }
+
+            // Uploaded file sizes are checked as 32 bits values
+            if (size.QuadPart == 0 || size.QuadPart >= MAXDWORD)
+            {
+                Log::Error(
+                    L"Invalid upload part size '{}' (expected below 4GB)", item.SubItems[CONFIG_UPLOAD_PARTSIZE]);
+                return E_INVALIDARG;
+            }
+
+            PartSize = size.QuadPart;
+        }
     }
     return S_OK;
 }
@@ -10,6 +10,7 @@
 
 #include <string>
 #include <filesystem>
+#include <optional>
 
 #include "OrcLib.h"
 #include "ArchiveFormat.h"
@@ -57,6 +58,9 @@ public:
         std::vector<std::wstring> FilterInclude;
         std::vector<std::wstring> FilterExclude;
 
+        // Files larger than this are uploaded as parts along with a manifest of their hashes
+        std::optional<ULONGLONG> PartSize;
+
         Upload()
             : Method(UploadMethod::NoUpload)
             , Operation(UploadOperation::NoOp) {};
@@ -86,6 +90,28 @@ public:
     std::wstring Compression;
     std::wstring Password;
 
+    // Output buffers of table writers, more than one lets a background thread write them (CSV only)
+    DWORD WriteBuffers = 0L;
+
+    // Rows per row group (Parquet only) and background threads encoding them (Parquet, ORC)
+    std::optional<DWORD> RowGroupSize;
+    DWORD EncoderThreads = 0L;
+    // Columns sorting the rows of each row group (Parquet only) and columns with a bloom filter (Parquet, ORC)
+    std::vector<std::wstring> SortKeys;
+    std::vector<std::wstring> BloomFilters;
+
+    // Memory the writer can use for its buffers, rows per index entry and bytes per stripe (ORC only)
+    std::optional<ULONGLONG> MemoryLimit;
+    std::optional<DWORD> RowIndexStride;
+    std::optional<ULONGLONG> StripeSize;
+
+    // Table outputs are split in parts of at most ShardRows rows or about ShardSize bytes
+    std::optional<ULONGLONG> ShardRows;
+    std::optional<ULONGLONG> ShardSize;
+
+    // Format of the table files written to directory and archive outputs: CSV or JSONL
+    Kind TableFormat = Kind::CSV;
+
     std::shared_ptr<Upload> UploadOutput;
 
 public:
@@ -105,6 +131,10 @@ public:
     bool IsTableFile() const;
     bool IsStructuredFile() const;
     bool IsArchive() const;
+    bool IsSharded() const { return ShardRows.has_value() || ShardSize.has_value(); }
+
+    // Extension of the table files written to directory and archive outputs
+    LPCWSTR TableExtension() const { return TableFormat == Kind::JSONL ? L".jsonl" : L".csv"; }
 
     static bool IsPattern(const std::wstring& pattern);
 
@@ -81,6 +81,8 @@ std::wstring ToString(OutputSpecTypes::Kind kind)
     {
         case Orc::OutputSpecTypes::Kind::Archive:
             return L"archive";
+        case Orc::OutputSpecTypes::Kind::Columnar:
+            return L"columnar";
         case Orc::OutputSpecTypes::Kind::CSV:
             return L"csv";
         case Orc::OutputSpecTypes::Kind::Directory:
@@ -89,6 +91,8 @@ std::wstring ToString(OutputSpecTypes::Kind kind)
             return L"file";
         case Orc::OutputSpecTypes::Kind::JSON:
             return L"json";
+        case Orc::OutputSpecTypes::Kind::JSONL:
+            return L"jsonl";
         case Orc::OutputSpecTypes::Kind::None:
             return L"none";
         case Orc::OutputSpecTypes::Kind::ORC:
@@ -67,7 +67,9 @@ enum class Kind
     Parquet = 1 << 8,
     XML = 1 << 9,
     JSON = 1 << 10,
-    ORC = 1 << 11
+    ORC = 1 << 11,
+    Columnar = 1 << 12,
+    JSONL = 1 << 13
 };
 
 enum Disposition
@@ -0,0 +1,387 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "OverlappedReadAhead.h"
+
+#include "DiskExtent.h"
+#include "IoGovernor.h"
+#include "Kernel32Extension.h"
+
+#include "Log/Log.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+namespace {
+
+// Number of consecutive sequential reads before the read-ahead window is doubled
+constexpr auto READ_AHEAD_GROWTH_STREAK = 4L;
+
+// Number of unrelated reads tolerated before the pending window is abandoned
+constexpr auto READ_AHEAD_MAX_MISSES = 16L;
+
+}  // namespace
+
+OverlappedReadAhead::Slot::Slot(DWORD dwCapacity)
+    : Event(CreateEventW(NULL, TRUE, FALSE, NULL))
+{
+    ZeroMemory(&Overlapped, sizeof(OVERLAPPED));
+    pBuffer = (LPBYTE)VirtualAlloc(NULL, dwCapacity, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+}
+
+OverlappedReadAhead::Slot::~Slot()
+{
+    if (pBuffer != nullptr)
+    {
+        VirtualFree(pBuffer, 0L, MEM_RELEASE);
+        pBuffer = nullptr;
+    }
+}
+
+std::unique_ptr<OverlappedReadAhead> OverlappedReadAhead::Create(
+    const CDiskExtent& extent,
+    ULONG ulSectorSize,
+    DWORD dwQueueDepth,
+    DWORD dwChunkSize)
+{
+    const auto k32 = ExtensionLibrary::GetLibrary<Kernel32Extension>();
+    if (k32 == nullptr)
+        return nullptr;
+
+    if (extent.GetHandle() == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    Guard::FileHandle hFile(k32->ReOpenFile(
+        extent.GetHandle(),
+        FILE_READ_DATA,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        FILE_FLAG_OVERLAPPED | FILE_FLAG_SEQUENTIAL_SCAN));
+
+    if (!hFile.IsValid())
+    {
+        Log::Debug(L"Failed to reopen '{}' for overlapped read-ahead [{}]", extent.GetName(), LastWin32Error());
+        return nullptr;
+    }
+
+    // A throttled host only gets a couple of low priority reads in flight
+    const auto& governor = IoGovernor::Instance();
+    if (governor.IsEnabled())
+    {
+        governor.SetLowPriority(hFile.value());
+        dwQueueDepth = std::min<DWORD>(dwQueueDepth ? dwQueueDepth : kDefaultQueueDepth, IoGovernor::kMaxQueueDepth);
+    }
+
+    if (ulSectorSize == 0L)
+        ulSectorSize = extent.GetLogicalSectorSize() ? extent.GetLogicalSectorSize() : 512L;
+
+    if (dwChunkSize == 0L)
+        dwChunkSize = kDefaultChunkSize;
+
+    // Larger reads would be split by the storage stack
+    if (extent.GetMaxTransferLength() >= ulSectorSize)
+        dwChunkSize = std::min<DWORD>(dwChunkSize, extent.GetMaxTransferLength() / ulSectorSize * ulSectorSize);
+
+    // Chunks must keep the overlapped reads aligned on sectors
+    dwChunkSize = ((dwChunkSize + ulSectorSize - 1) / ulSectorSize) * ulSectorSize;
+
+    dwQueueDepth = std::clamp<DWORD>(dwQueueDepth ? dwQueueDepth : kDefaultQueueDepth, 1L, kMaxQueueDepth);
+
+    return std::unique_ptr<OverlappedReadAhead>(new OverlappedReadAhead(
+        std::move(hFile), extent.GetStartOffset(), extent.GetLength(), ulSectorSize, dwQueueDepth, dwChunkSize));
+}
+
+OverlappedReadAhead::OverlappedReadAhead(
+    Guard::FileHandle&& hFile,
+    ULONGLONG ullStart,
+    ULONGLONG ullLength,
+    ULONG ulSectorSize,
+    DWORD dwQueueDepth,
+    DWORD dwChunkSize)
+    : m_hFile(std::move(hFile))
+    , m_ullStart(ullStart)
+    , m_ullLength(ullLength)
+    , m_ulSectorSize(ulSectorSize)
+    , m_dwMaxDepth(dwQueueDepth)
+    , m_dwChunkSize(dwChunkSize)
+{
+}
+
+OverlappedReadAhead::~OverlappedReadAhead()
+{
+    Reset();
+
+    Log::Debug(
+        L"Read-ahead statistics: issued: {}, served: {} bytes, wasted: {} bytes, restarts: {}, peak depth: {}",
+        m_Stats.ullIssued,
+        m_Stats.ullServedBytes,
+        m_Stats.ullWastedBytes,
+        m_Stats.ullRestarts,
+        m_Stats.dwPeakDepth);
+}
+
+HRESULT OverlappedReadAhead::Issue(ULONGLONG ullOffset)
+{
+    std::unique_ptr<Slot> slot;
+    if (!m_FreeSlots.empty())
+    {
+        slot = std::move(m_FreeSlots.back());
+        m_FreeSlots.pop_back();
+    }
+    else
+    {
+        slot = std::make_unique<Slot>(m_dwChunkSize);
+        if (slot->pBuffer == nullptr || !slot->Event.IsValid())
+            return E_OUTOFMEMORY;
+    }
+
+    ULONGLONG ullSize = std::min<ULONGLONG>(m_dwChunkSize, m_ullLength - ullOffset);
+    ullSize = ((ullSize + m_ulSectorSize - 1) / m_ulSectorSize) * m_ulSectorSize;
+
+    IoGovernor::Instance().Throttle(ullSize);
+
+    HANDLE hEvent = slot->Event.value();
+    ResetEvent(hEvent);
+
+    ZeroMemory(&slot->Overlapped, sizeof(OVERLAPPED));
+    ULARGE_INTEGER liOffset;
+    liOffset.QuadPart = m_ullStart + ullOffset;
+    slot->Overlapped.Offset = liOffset.LowPart;
+    slot->Overlapped.OffsetHigh = liOffset.HighPart;
+    slot->Overlapped.hEvent = hEvent;
+
+    slot->ullOffset = ullOffset;
+    slot->dwSize = static_cast<DWORD>(ullSize);
+    slot->dwBytesRead = 0L;
+    slot->bPending = true;
+    slot->Issued = std::chrono::steady_clock::now();
+
+    if (!ReadFile(m_hFile.value(), slot->pBuffer, slot->dwSize, NULL, &slot->Overlapped))
+    {
+        const auto lastError = GetLastError();
+        if (lastError == ERROR_HANDLE_EOF)
+        {
+            slot->bPending = false;
+        }
+        else if (lastError != ERROR_IO_PENDING)
+        {
+            slot->bPending = false;
+            m_FreeSlots.push_back(std::move(slot));
+            Log::Debug(L"Failed to issue read-ahead at offset {} [{}]", ullOffset, Win32Error(lastError));
+            return HRESULT_FROM_WIN32(lastError);
+        }
+    }
+
+    m_Stats.ullIssued++;
+    m_Slots.push_back(std::move(slot));
+    m_Stats.dwPeakDepth = std::max<DWORD>(m_Stats.dwPeakDepth, static_cast<DWORD>(m_Slots.size()));
+    return S_OK;
+}
+
+HRESULT OverlappedReadAhead::Complete(Slot& slot)
+{
+    if (!slot.bPending)
+        return S_OK;
+
+    slot.bPending = false;
+
+    // The completion time of a read already done is unknown, only reads still in flight are timed
+    const bool bInFlight = !HasOverlappedIoCompleted(&slot.Overlapped);
+
+    DWORD dwBytesRead = 0L;
+    if (!GetOverlappedResult(m_hFile.value(), &slot.Overlapped, &dwBytesRead, TRUE))
+    {
+        const auto lastError = GetLastError();
+        if (lastError != ERROR_HANDLE_EOF)
+        {
+            Log::Debug(L"Read-ahead at offset {} failed [{}]", slot.ullOffset, Win32Error(lastError));
+            return HRESULT_FROM_WIN32(lastError);
+        }
+    }
+
+    slot.dwBytesRead = dwBytesRead;
+
+    if (bInFlight)
+    {
+        IoGovernor::Instance().Record(
+            dwBytesRead,
+            std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - slot.Issued));
+    }
+    return S_OK;
+}
+
+void OverlappedReadAhead::Cancel(Slot& slot)
+{
+    if (!slot.bPending)
+        return;
+
+    const auto k32 = ExtensionLibrary::GetLibrary<Kernel32Extension>();
+    if (k32 != nullptr)
+        k32->CancelIoEx(m_hFile.value(), &slot.Overlapped);
+
+    // Buffer cannot be reused until the cancelled read is actually done
+    DWORD dwBytesRead = 0L;
+    GetOverlappedResult(m_hFile.value(), &slot.Overlapped, &dwBytesRead, TRUE);
+    slot.bPending = false;
+}
+
+void OverlappedReadAhead::Release(std::unique_ptr<Slot>& slot)
+{
+    Cancel(*slot);
+    m_FreeSlots.push_back(std::move(slot));
+}
+
+HRESULT OverlappedReadAhead::Fill()
+{
+    HRESULT hr = S_OK;
+
+    while (m_Slots.size() < m_dwDepth && m_ullNextIssue < m_ullLength)
+    {
+        if (FAILED(hr = Issue(m_ullNextIssue)))
+            return hr;
+
+        m_ullNextIssue += m_dwChunkSize;
+    }
+
+    return S_OK;
+}
+
+void OverlappedReadAhead::Reset()
+{
+    for (auto& slot : m_Slots)
+    {
+        m_Stats.ullWastedBytes += slot->dwSize;
+        Release(slot);
+    }
+
+    m_Slots.clear();
+    m_dwDepth = 0L;
+    m_dwStreak = 0L;
+    m_dwMisses = 0L;
+}
+
+HRESULT OverlappedReadAhead::Read(ULONGLONG ullOffset, LPBYTE pBuffer, DWORD dwCount, DWORD& dwBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    dwBytesRead = 0L;
+
+    if (dwCount == 0L || ullOffset >= m_ullLength || ullOffset % m_ulSectorSize)
+        return S_FALSE;
+
+    bool bSequential = m_dwStreak > 0 && ullOffset == m_ullStreamNext;
+    if (!bSequential && !m_Slots.empty())
+    {
+        // A read inside the current window is still part of the stream (i.e. a short re-read)
+        bSequential = ullOffset >= m_Slots.front()->ullOffset && ullOffset < m_ullNextIssue;
+    }
+
+    if (!bSequential)
+    {
+        if (!m_Slots.empty())
+        {
+            // Unrelated read (i.e. a random attribute read interleaved with a sequential scan): keep the window
+            if (++m_dwMisses < READ_AHEAD_MAX_MISSES)
+                return S_FALSE;
+
+            Reset();
+        }
+
+        m_ullStreamNext = ullOffset + dwCount;
+        m_dwStreak = 1L;
+        return S_FALSE;
+    }
+
+    m_dwMisses = 0L;
+    m_dwStreak++;
+    m_ullStreamNext = ullOffset + dwCount;
+
+    // Adaptive window: start with a couple of reads and double it while the stream stays sequential
+    if (m_dwDepth == 0L)
+    {
+        m_dwDepth = std::min<DWORD>(2L, m_dwMaxDepth);
+        m_ullNextIssue = ullOffset;
+    }
+    else if (m_dwDepth < m_dwMaxDepth && (m_dwStreak % READ_AHEAD_GROWTH_STREAK) == 0)
+    {
+        m_dwDepth = std::min<DWORD>(m_dwDepth * 2, m_dwMaxDepth);
+    }
+
+    // Drop chunks the stream has moved past
+    while (!m_Slots.empty() && m_Slots.front()->ullOffset + m_Slots.front()->dwSize <= ullOffset)
+    {
+        m_Stats.ullWastedBytes += m_Slots.front()->dwSize;
+        Release(m_Slots.front());
+        m_Slots.pop_front();
+    }
+
+    if (m_Slots.empty() || ullOffset < m_Slots.front()->ullOffset)
+    {
+        if (!m_Slots.empty())
+        {
+            const auto dwDepth = m_dwDepth;
+            const auto dwStreak = m_dwStreak;
+            Reset();
+            m_dwDepth = dwDepth;
+            m_dwStreak = dwStreak;
+        }
+
+        if (m_ullNextIssue != ullOffset)
+            m_Stats.ullRestarts++;
+
+        m_ullNextIssue = ullOffset - (ullOffset % m_ulSectorSize);
+    }
+
+    if (FAILED(hr = Fill()) && m_Slots.empty())
+    {
+        Reset();
+        return S_FALSE;
+    }
+
+    DWORD dwCopied = 0L;
+    while (dwCopied < dwCount && !m_Slots.empty())
+    {
+        const ULONGLONG ullCurrent = ullOffset + dwCopied;
+        auto& slot = m_Slots.front();
+
+        if (ullCurrent < slot->ullOffset)
+            break;
+
+        if (FAILED(hr = Complete(*slot)))
+        {
+            Reset();
+            if (dwCopied == 0L)
+                return S_FALSE;  // let the caller retry synchronously and report the error
+            break;
+        }
+
+        const ULONGLONG ullInSlot = ullCurrent - slot->ullOffset;
+        if (ullInSlot >= slot->dwBytesRead)
+            break;  // short read: end of the device
+
+        const DWORD dwChunk = std::min<DWORD>(static_cast<DWORD>(slot->dwBytesRead - ullInSlot), dwCount - dwCopied);
+        CopyMemory(pBuffer + dwCopied, slot->pBuffer + ullInSlot, dwChunk);
+        dwCopied += dwChunk;
+
+        if (ullInSlot + dwChunk >= slot->dwSize)
+        {
+            Release(slot);
+            m_Slots.pop_front();
+            Fill();
+        }
+    }
+
+    if (dwCopied == 0L)
+        return S_FALSE;
+
+    m_Stats.ullServedBytes += dwCopied;
+    dwBytesRead = dwCopied;
+    return S_OK;
+}
@@ -0,0 +1,110 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "Utils/Guard.h"
+
+#include <chrono>
+#include <deque>
+#include <memory>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class CDiskExtent;
+
+// Sequential read-ahead engine: once consecutive reads are detected, up to 'queue depth' overlapped reads are kept
+// in flight ahead of the reader. The engine uses its own overlapped handle reopened from the extent's handle so that
+// synchronous reads on the original handle are not affected. Not thread safe: callers serialize access.
+class OverlappedReadAhead
+{
+public:
+    static constexpr DWORD kDefaultQueueDepth = 8L;
+    static constexpr DWORD kMaxQueueDepth = 32L;
+    static constexpr DWORD kDefaultChunkSize = 512 * 1024L;
+
+    struct Statistics
+    {
+        ULONGLONG ullIssued = 0LL;
+        ULONGLONG ullServedBytes = 0LL;
+        ULONGLONG ullWastedBytes = 0LL;
+        ULONGLONG ullRestarts = 0LL;
+        DWORD dwPeakDepth = 0L;
+    };
+
+    // Returns nullptr when the extent's handle cannot be reopened for overlapped I/O
+    static std::unique_ptr<OverlappedReadAhead>
+    Create(const CDiskExtent& extent, ULONG ulSectorSize, DWORD dwQueueDepth, DWORD dwChunkSize = 0L);
+
+    ~OverlappedReadAhead();
+
+    // Offset is relative to the extent start and must be sector aligned. Returns S_FALSE when the read is not part
+    // of the sequential stream and should be done synchronously by the caller.
+    HRESULT Read(ULONGLONG ullOffset, LPBYTE pBuffer, DWORD dwCount, DWORD& dwBytesRead);
+
+    // Abandon all pending reads (to be called when the position of the synchronous handle changes drastically)
+    void Reset();
+
+    const Statistics& GetStatistics() const { return m_Stats; }
+
+private:
+    struct Slot
+    {
+        Slot(DWORD dwCapacity);
+        ~Slot();
+
+        OVERLAPPED Overlapped;
+        Guard::Handle Event;
+        ULONGLONG ullOffset = 0LL;
+        DWORD dwSize = 0L;
+        DWORD dwBytesRead = 0L;
+        LPBYTE pBuffer = nullptr;
+        bool bPending = false;
+        std::chrono::steady_clock::time_point Issued;
+    };
+
+    OverlappedReadAhead(
+        Guard::FileHandle&& hFile,
+        ULONGLONG ullStart,
+        ULONGLONG ullLength,
+        ULONG ulSectorSize,
+        DWORD dwQueueDepth,
+        DWORD dwChunkSize);
+
+    HRESULT Issue(ULONGLONG ullOffset);
+    HRESULT Complete(Slot& slot);
+    void Cancel(Slot& slot);
+    void Release(std::unique_ptr<Slot>& slot);
+    HRESULT Fill();
+
+    Guard::FileHandle m_hFile;
+    ULONGLONG m_ullStart = 0LL;
+    ULONGLONG m_ullLength = 0LL;
+    ULONG m_ulSectorSize = 0L;
+    DWORD m_dwMaxDepth = 0L;
+    DWORD m_dwChunkSize = 0L;
+
+    // Sequential detection: reads are considered sequential when they start where the previous one ended
+    ULONGLONG m_ullStreamNext = 0LL;
+    DWORD m_dwStreak = 0L;
+    DWORD m_dwMisses = 0L;
+    DWORD m_dwDepth = 0L;
+    ULONGLONG m_ullNextIssue = 0LL;
+
+    std::deque<std::unique_ptr<Slot>> m_Slots;
+    std::vector<std::unique_ptr<Slot>> m_FreeSlots;
+
+    Statistics m_Stats;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -12,10 +12,8 @@
 
 #include "SystemDetails.h"
 
-#include "CryptoHashStream.h"
-#include "FuzzyHashStream.h"
-#include "MemoryStream.h"
 #include "CacheStream.h"
+#include "FileDataPass.h"
 
 #include "FileFormat/PeParser.h"
 
@@ -25,6 +23,13 @@
 
 using namespace Orc;
 
+namespace {
+
+// Enough for the headers, the section table and usually the resource directory
+constexpr size_t kPeViewSize = 64 * 1024;
+
+}  // namespace
+
 PEInfo::PEInfo(FileInfo& fileInfo)
     : m_FileInfo(fileInfo)
 {
@@ -32,6 +37,25 @@ PEInfo::PEInfo(FileInfo& fileInfo)
 
 PEInfo::~PEInfo() {}
 
+std::shared_ptr<ByteStream> PEInfo::GetStream()
+{
+    auto stream = m_FileInfo.GetDetails()->GetDataStream();
+    if (stream == nullptr)
+    {
+        m_Stream.reset();
+        m_DataStream.reset();
+        return nullptr;
+    }
+
+    if (stream != m_DataStream)
+    {
+        m_DataStream = stream;
+        m_Stream = std::make_shared<CacheStream>(std::move(stream), kPeViewSize);
+    }
+
+    return m_Stream;
+}
+
 bool PEInfo::HasFileVersionInfo()
 {
     if (m_FileInfo.IsDirectory())
@@ -151,7 +175,9 @@ HRESULT PEInfo::OpenPEInformation()
 
     ULONGLONG ullBytesRead = 0L;
 
-    std::shared_ptr<ByteStream> stream = m_FileInfo.GetDetails()->GetDataStream();
+    std::shared_ptr<ByteStream> stream = GetStream();
+    if (stream == nullptr)
+        return E_POINTER;
     if (FAILED(hr = stream->SetFilePointer(0LL, FILE_BEGIN, NULL)))
         return hr;
     if (FAILED(hr = stream->Read(buf.GetData(), buf.GetCount(), &ullBytesRead)))
@@ -301,14 +327,12 @@ HRESULT PEInfo::OpenVersionInformation()
     CBinaryBuffer rsrcBuf;
     if (!rsrcBuf.SetCount(1024))
         return E_OUTOFMEMORY;
-    std::shared_ptr<ByteStream> directStream = m_FileInfo.GetDetails()->GetDataStream();
-    if (!directStream)
+    std::shared_ptr<ByteStream> stream = GetStream();
+    if (!stream)
     {
         return E_POINTER;
     }
 
-    auto stream = std::make_shared<CacheStream>(directStream, 4096);
-
     ULONGLONG ullBytesRead;
     size_t rsrc_rsrc_offset = 0;
 
@@ -500,7 +524,9 @@ HRESULT PEInfo::OpenSecurityDirectory()
             return E_OUTOFMEMORY;
     }
 
-    std::shared_ptr<ByteStream> stream = m_FileInfo.GetDetails()->GetDataStream();
+    std::shared_ptr<ByteStream> stream = GetStream();
+    if (stream == nullptr)
+        return E_POINTER;
 
     if (secdir_pe_offset > stream->GetSize())
     {
@@ -529,170 +555,9 @@ HRESULT PEInfo::OpenSecurityDirectory()
     return S_OK;
 }
 
-HRESULT PEInfo::OpenAllHash(Intentions localIntentions)
-{
-    HRESULT hr = E_FAIL;
-
-    DWORD dwMajor = 0L, dwMinor = 0L;
-    SystemDetails::GetOSVersion(dwMajor, dwMinor);
-
-    const auto& details = m_FileInfo.GetDetails();
-
-    if (details->PeHashAvailable() && details->HashAvailable())
-        return S_OK;
-
-    CryptoHashStream::Algorithm algs = CryptoHashStream::Algorithm::Undefined;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_MD5))
-        algs |= CryptoHashStream::Algorithm::MD5;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA1))
-        algs |= CryptoHashStream::Algorithm::SHA1;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SHA256))
-        algs |= CryptoHashStream::Algorithm::SHA256;
-
-    CryptoHashStream::Algorithm pe_algs = CryptoHashStream::Algorithm::Undefined;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_MD5))
-        pe_algs |= CryptoHashStream::Algorithm::MD5;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA1))
-        pe_algs |= CryptoHashStream::Algorithm::SHA1;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA256))
-        pe_algs |= CryptoHashStream::Algorithm::SHA256;
-
-    FuzzyHashStream::Algorithm fuzzy_algs = FuzzyHashStream::Algorithm::Undefined;
-
-#ifdef ORC_BUILD_SSDEEP
-    if (HasFlag(localIntentions, Intentions::FILEINFO_SSDEEP))
-        fuzzy_algs = fuzzy_algs | FuzzyHashStream::Algorithm::SSDeep;
-#endif
-
-    if (HasAnyFlag(
-            localIntentions, Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
-    {
-        pe_algs |=
-            CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1 | CryptoHashStream::Algorithm::SHA256;
-    }
-
-    auto stream = m_FileInfo.GetDetails()->GetDataStream();
-    if (stream == nullptr)
-        return E_POINTER;
-
-    stream->SetFilePointer(0L, FILE_BEGIN, NULL);
-
-    // Load data in a memory stream
-
-    auto memstream = std::make_shared<MemoryStream>();
-    if (memstream == nullptr)
-        return E_OUTOFMEMORY;
-
-    if (FAILED(hr = memstream->OpenForReadWrite(stream->GetSize())))
-        return hr;
-
-    ULONGLONG ullWritten = 0LL;
-    if (FAILED(hr = stream->CopyTo(*memstream, &ullWritten)))
-        return hr;
-
-    // Crypto hash
-    auto pData = memstream->GetBuffer();
-    {
-        auto hashstream = std::make_shared<CryptoHashStream>();
-        hashstream->OpenToWrite(algs, nullptr);
-
-        ULONGLONG ullHashed = 0LL;
-        hashstream->Write(pData.GetData(), ullWritten, &ullHashed);
-
-        if (HasFlag(algs, CryptoHashStream::Algorithm::MD5))
-        {
-            hr = hashstream->GetHash(CryptoHashStream::Algorithm::MD5, m_FileInfo.GetDetails()->MD5());
-            if (FAILED(hr) && hr != MK_E_UNAVAILABLE)
-            {
-                return hr;
-            }
-        }
-
-        if (HasFlag(algs, CryptoHashStream::Algorithm::SHA1))
-        {
-            hr = hashstream->GetHash(CryptoHashStream::Algorithm::SHA1, m_FileInfo.GetDetails()->SHA1());
-            if (FAILED(hr) && hr != MK_E_UNAVAILABLE)
-            {
-                return hr;
-            }
-        }
-
-        if (HasFlag(algs, CryptoHashStream::Algorithm::SHA256))
-        {
-            hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, m_FileInfo.GetDetails()->SHA256());
-            if (FAILED(hr) && hr != MK_E_UNAVAILABLE)
-            {
-                return hr;
-            }
-        }
-    }
-
-    // Fuzzy hash
-    {
-        auto hashstream = std::make_shared<FuzzyHashStream>();
-        hashstream->OpenToWrite(fuzzy_algs, nullptr);
-
-        ULONGLONG ullHashed = 0LL;
-        hashstream->Write(pData.GetData(), ullWritten, &ullHashed);
-
-        if (HasFlag(fuzzy_algs, FuzzyHashStream::Algorithm::SSDeep))
-        {
-            hr = hashstream->GetHash(FuzzyHashStream::Algorithm::SSDeep, m_FileInfo.GetDetails()->SSDeep());
-            if (FAILED(hr) && hr != MK_E_UNAVAILABLE)
-            {
-                return hr;
-            }
-        }
-    }
-
-    // Pe Hash
-    {
-        std::error_code ec;
-        PeParser pe(memstream, ec);
-        if (ec)
-        {
-            Log::Debug(L"Failed to parse pe hash '{}' [{}]", m_FileInfo.m_szFullName, ec);
-            return ec.value();
-        }
-
-        PeParser::PeHash hashes;
-        pe.GetAuthenticodeHash(pe_algs, hashes, ec);
-        if (ec)
-        {
-            Log::Error(L"Failed to compute pe hash '{}' [{}]", m_FileInfo.m_szFullName, ec);
-            return ec.value();
-        }
-
-        if (HasFlag(pe_algs, CryptoHashStream::Algorithm::MD5))
-        {
-            auto& bb = m_FileInfo.GetDetails()->PeMD5();
-            bb.SetCount(hashes.md5->size());
-            std::copy(std::cbegin(*hashes.md5), std::cend(*hashes.md5), std::begin(bb));
-        }
-
-        if (HasFlag(pe_algs, CryptoHashStream::Algorithm::SHA1) && hashes.sha1.has_value())
-        {
-            auto& bb = m_FileInfo.GetDetails()->PeSHA1();
-            bb.SetCount(hashes.sha1->size());
-            std::copy(std::cbegin(*hashes.sha1), std::cend(*hashes.sha1), std::begin(bb));
-        }
-
-        if (HasFlag(pe_algs, CryptoHashStream::Algorithm::SHA256) && hashes.sha256.has_value())
-        {
-            auto& bb = m_FileInfo.GetDetails()->PeSHA256();
-            bb.SetCount(hashes.sha256->size());
-            std::copy(std::cbegin(*hashes.sha256), std::cend(*hashes.sha256), std::begin(bb));
-        }
-    }
-
-    return S_OK;
-}
-
-HRESULT PEInfo::OpenPeHash(Intentions localIntentions)
+HRESULT PEInfo::AddPeHash(FileDataPass& pass, CryptoHashStreamAlgorithm algs)
 {
     HRESULT hr = E_FAIL;
-    if (m_FileInfo.GetDetails()->PeHashAvailable())
-        return S_OK;
 
     if (FAILED(hr = CheckPEInformation()))
         return hr;
@@ -701,63 +566,25 @@ HRESULT PEInfo::OpenPeHash(Intentions localIntentions)
         return HRESULT_FROM_WIN32(ERROR_INVALID_DATATYPE);
     }
 
-    DWORD dwMajor = 0L, dwMinor = 0L;
-    SystemDetails::GetOSVersion(dwMajor, dwMinor);
-
-    CryptoHashStream::Algorithm algs = CryptoHashStream::Algorithm::Undefined;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_MD5))
-        algs |= CryptoHashStream::Algorithm::MD5;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA1))
-        algs |= CryptoHashStream::Algorithm::SHA1;
-    if (HasFlag(localIntentions, Intentions::FILEINFO_PE_SHA256))
-        algs |= CryptoHashStream::Algorithm::SHA256;
-    if (HasAnyFlag(
-            localIntentions, Intentions::FILEINFO_AUTHENTICODE_STATUS | Intentions::FILEINFO_AUTHENTICODE_SIGNER))
-    {
-        algs |=
-            CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1 | CryptoHashStream::Algorithm::SHA256;
-    }
-
-    auto stream = m_FileInfo.GetDetails()->GetDataStream();
+    auto stream = GetStream();
     if (stream == nullptr)
         return E_POINTER;
 
     std::error_code ec;
-    PeParser pe(std::make_shared<CacheStream>(std::move(stream)), ec);
+    PeParser pe(std::move(stream), ec);
     if (ec)
     {
         Log::Error(L"Failed to parse PE '{}' [{}]", m_FileInfo.m_szFullName, ec);
         return ec.value();
     }
 
-    PeParser::PeHash hashes;
-    pe.GetAuthenticodeHash(algs, hashes, ec);
+    PeParser::PeChunks chunks;
+    pe.GetHashedChunks(chunks, ec);
     if (ec)
     {
-        Log::Error(L"Failed to compute PE hashes '{}' [{}]", m_FileInfo.m_szFullName, ec);
+        Log::Error(L"Failed to compute PE hashed chunks '{}' [{}]", m_FileInfo.m_szFullName, ec);
         return ec.value();
     }
 
-    if (HasFlag(algs, CryptoHashStream::Algorithm::MD5))
-    {
-        auto& bb = m_FileInfo.GetDetails()->PeMD5();
-        bb.SetCount(hashes.md5->size());
-        std::copy(std::cbegin(*hashes.md5), std::cend(*hashes.md5), std::begin(bb));
-    }
-
-    if (HasFlag(algs, CryptoHashStream::Algorithm::SHA1) && hashes.sha1.has_value())
-    {
-        auto& bb = m_FileInfo.GetDetails()->PeSHA1();
-        bb.SetCount(hashes.sha1->size());
-        std::copy(std::cbegin(*hashes.sha1), std::cend(*hashes.sha1), std::begin(bb));
-    }
-
-    if (HasFlag(algs, CryptoHashStream::Algorithm::SHA256) && hashes.sha256.has_value())
-    {
-        auto& bb = m_FileInfo.GetDetails()->PeSHA256();
-        bb.SetCount(hashes.sha256->size());
-        std::copy(std::cbegin(*hashes.sha256), std::cend(*hashes.sha256), std::begin(bb));
-    }
-
-    return S_OK;
+    return pass.AddPeHash(algs, chunks);
 }
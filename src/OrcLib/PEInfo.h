@@ -10,12 +10,18 @@
 #include "OrcLib.h"
 #include "DataDetails.h"
 #include "FSUtils.h"
+#include "CryptoHashStreamAlgorithm.h"
+
+#include <memory>
 
 #pragma managed(push, off)
 
 namespace Orc {
 
 class FileInfo;
+class ByteStream;
+class CacheStream;
+class FileDataPass;
 
 class PEInfo
 {
@@ -42,11 +48,19 @@ public:
     HRESULT CheckSecurityDirectory();
     HRESULT OpenSecurityDirectory();
 
-    HRESULT OpenPeHash(Intentions localIntentions);
-    HRESULT OpenAllHash(Intentions localIntentions);
+    // Add the authenticode hashes of 'algs' to the data pass of the file
+    HRESULT AddPeHash(FileDataPass& pass, CryptoHashStreamAlgorithm algs);
+
+    // Data stream seen through a window shared by the header, version and security directory parsers and the data
+    // pass: the first pages holding the headers are read once for all of them
+    std::shared_ptr<ByteStream> GetStream();
 
 private:
+
     FileInfo& m_FileInfo;
+
+    std::shared_ptr<ByteStream> m_DataStream;
+    std::shared_ptr<CacheStream> m_Stream;
 };
 }  // namespace Orc
 
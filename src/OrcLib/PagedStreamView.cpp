@@ -0,0 +1,211 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "PagedStreamView.h"
+
+#include "ByteStream.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+std::mutex PagedStreamView::s_lock;
+std::vector<PagedStreamView*> PagedStreamView::s_views;
+PVOID PagedStreamView::s_hHandler = nullptr;
+
+HRESULT PagedStreamView::Open(ByteStream& stream, size_t cbChunk)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_pBase != nullptr)
+    {
+        Log::Error("Paged stream view is already open");
+        return E_UNEXPECTED;
+    }
+
+    if ((hr = stream.IsOpen()) != S_OK)
+    {
+        Log::Error("Paged stream view source stream is closed");
+        return hr;
+    }
+
+    const ULONG64 ullSize = stream.GetSize();
+    if (ullSize == 0LL)
+    {
+        Log::Error("Paged stream view source stream is empty");
+        return E_INVALIDARG;
+    }
+    if (ullSize > static_cast<ULONG64>(SIZE_MAX))
+    {
+        Log::Error("Paged stream view source stream is too large for the address space ({} bytes)", ullSize);
+        return E_OUTOFMEMORY;
+    }
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+
+    // Chunks are committed as a whole: round them to the page size
+    cbChunk = std::max<size_t>(cbChunk, si.dwPageSize);
+    cbChunk = (cbChunk + si.dwPageSize - 1) / si.dwPageSize * si.dwPageSize;
+
+    auto pBase = (BYTE*)VirtualAlloc(NULL, static_cast<size_t>(ullSize), MEM_RESERVE, PAGE_READWRITE);
+    if (pBase == nullptr)
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error("Failed to reserve {} bytes for paged stream view [{}]", ullSize, SystemError(hr));
+        return hr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_pBase = pBase;
+        m_ullSize = ullSize;
+        m_cbReserved = static_cast<size_t>(ullSize);
+        m_cbChunk = cbChunk;
+        m_pStream = &stream;
+        m_committed.assign((m_cbReserved + m_cbChunk - 1) / m_cbChunk, false);
+        m_hrLastError = S_OK;
+    }
+
+    std::lock_guard<std::mutex> lock(s_lock);
+    if (s_views.empty())
+    {
+        s_hHandler = AddVectoredExceptionHandler(1L, OnException);
+        if (s_hHandler == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error("Failed to register paged stream view exception handler [{}]", SystemError(hr));
+            VirtualFree(m_pBase, 0, MEM_RELEASE);
+            m_pBase = nullptr;
+            m_pStream = nullptr;
+            return hr;
+        }
+    }
+    s_views.push_back(this);
+    return S_OK;
+}
+
+void PagedStreamView::Close()
+{
+    if (m_pBase == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        s_views.erase(std::remove(std::begin(s_views), std::end(s_views), this), std::end(s_views));
+        if (s_views.empty() && s_hHandler != nullptr)
+        {
+            RemoveVectoredExceptionHandler(s_hHandler);
+            s_hHandler = nullptr;
+        }
+    }
+
+    // Wait for a chunk being paged in by another thread
+    std::lock_guard<std::mutex> lock(m_lock);
+    VirtualFree(m_pBase, 0, MEM_RELEASE);
+    m_pBase = nullptr;
+    m_ullSize = 0LL;
+    m_cbReserved = 0;
+    m_pStream = nullptr;
+    m_committed.clear();
+}
+
+bool PagedStreamView::Contains(ULONG_PTR address) const
+{
+    const auto base = reinterpret_cast<ULONG_PTR>(m_pBase);
+    return address >= base && address < base + m_cbReserved;
+}
+
+void PagedStreamView::PageIn(ULONG_PTR address)
+{
+    const size_t index = (address - reinterpret_cast<ULONG_PTR>(m_pBase)) / m_cbChunk;
+    if (m_committed[index])
+    {
+        // Another thread paged this chunk in while we were waiting for the lock
+        return;
+    }
+
+    const size_t offset = index * m_cbChunk;
+    const size_t cbLength = std::min(m_cbChunk, m_cbReserved - offset);
+
+    BYTE* pChunk = m_pBase + offset;
+    if (VirtualAlloc(pChunk, cbLength, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+    {
+        return;
+    }
+    m_committed[index] = true;
+
+    HRESULT hr = m_pStream->SetFilePointer(offset, FILE_BEGIN, nullptr);
+    if (SUCCEEDED(hr))
+    {
+        ULONGLONG ullRead = 0LL;
+        while (ullRead < cbLength)
+        {
+            ULONGLONG ullChunkRead = 0LL;
+            hr = m_pStream->Read(pChunk + ullRead, cbLength - ullRead, &ullChunkRead);
+            if (FAILED(hr) || ullChunkRead == 0LL)
+            {
+                break;
+            }
+            ullRead += ullChunkRead;
+        }
+
+        if (ullRead < cbLength && SUCCEEDED(hr))
+        {
+            hr = HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+        }
+    }
+
+    if (FAILED(hr) && SUCCEEDED(m_hrLastError))
+    {
+        m_hrLastError = hr;
+    }
+
+    DWORD dwOldProtect = 0L;
+    VirtualProtect(pChunk, cbLength, PAGE_READONLY, &dwOldProtect);
+}
+
+LONG CALLBACK PagedStreamView::OnException(PEXCEPTION_POINTERS pExceptionInfo)
+{
+    const auto pRecord = pExceptionInfo->ExceptionRecord;
+    if (pRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION || pRecord->NumberParameters < 2)
+    {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    // The view is read only: writes and executes are genuine violations
+    if (pRecord->ExceptionInformation[0] != 0)
+    {
+        return EXCEPTION_CONTINUE_SEARCH;
+    }
+
+    const ULONG_PTR address = pRecord->ExceptionInformation[1];
+
+    std::unique_lock<std::mutex> viewLock;
+    PagedStreamView* pView = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(s_lock);
+        auto it = std::find_if(
+            std::begin(s_views), std::end(s_views), [address](const auto view) { return view->Contains(address); });
+        if (it == std::end(s_views))
+        {
+            return EXCEPTION_CONTINUE_SEARCH;
+        }
+
+        pView = *it;
+        viewLock = std::unique_lock<std::mutex>(pView->m_lock);
+    }
+
+    pView->PageIn(address);
+
+    const size_t index = (address - reinterpret_cast<ULONG_PTR>(pView->m_pBase)) / pView->m_cbChunk;
+    return pView->m_committed[index] ? EXCEPTION_CONTINUE_EXECUTION : EXCEPTION_CONTINUE_SEARCH;
+}
@@ -0,0 +1,75 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <mutex>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class ByteStream;
+
+//
+// PagedStreamView: read only, contiguous view of a ByteStream whose content is read on first access.
+//
+// The whole stream size is reserved in the address space but only the chunks actually touched are committed and read
+// from the stream (from a vectored exception handler catching the access violation). This lets parsers which expect a
+// flat buffer (like RegistryHive) walk streams which cannot be memory mapped (NTFS data streams read from a volume)
+// without reading them entirely.
+//
+// The stream must outlive the view and must not be used by someone else while the view is open. Pointers into the view
+// must not be handed to kernel calls (faults are only handled for user mode accesses).
+//
+class PagedStreamView
+{
+public:
+    static constexpr size_t kDefaultChunkSize = 256 * 1024;
+
+    PagedStreamView() = default;
+    PagedStreamView(const PagedStreamView&) = delete;
+    PagedStreamView& operator=(const PagedStreamView&) = delete;
+
+    HRESULT Open(ByteStream& stream, size_t cbChunk = kDefaultChunkSize);
+    void Close();
+
+    BYTE* Data() const { return m_pBase; }
+    ULONG64 Size() const { return m_ullSize; }
+
+    // First error met reading a chunk (the faulting access then reads zeroes)
+    HRESULT LastError() const { return m_hrLastError; }
+
+    ~PagedStreamView() { Close(); }
+
+private:
+    static LONG CALLBACK OnException(PEXCEPTION_POINTERS pExceptionInfo);
+
+    bool Contains(ULONG_PTR address) const;
+    void PageIn(ULONG_PTR address);
+
+    BYTE* m_pBase = nullptr;
+    ULONG64 m_ullSize = 0LL;
+    size_t m_cbReserved = 0;
+    size_t m_cbChunk = kDefaultChunkSize;
+    ByteStream* m_pStream = nullptr;
+
+    std::mutex m_lock;
+    std::vector<bool> m_committed;
+    HRESULT m_hrLastError = S_OK;
+
+    static std::mutex s_lock;
+    static std::vector<PagedStreamView*> s_views;
+    static PVOID s_hHandler;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -11,24 +11,43 @@
 
 #include "CryptoUtilities.h"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+
 #include <boost/scope_exit.hpp>
 
 using namespace Orc;
 
 constexpr auto ENCRYPT_ALGORITHM = CALG_AES_256;
 
-HRESULT PasswordEncryptedStream::GetKeyMaterial(const std::wstring& pwd)
+namespace {
+
+using KeyBytes = std::array<BYTE, AesExtensionsCipher::kKeySize>;
+
+// CryptImportKey/CryptExportKey layout of a raw key
+struct PlainTextKeyBlob
+{
+    BLOBHEADER Header;
+    DWORD dwKeySize;
+    BYTE Key[AesExtensionsCipher::kKeySize];
+};
+
+HRESULT DeriveKey(const std::wstring& pwd, KeyBytes& key)
 {
     HRESULT hr = E_FAIL;
 
-    if (FAILED(hr = CryptoUtilities::AcquireContext(m_hCryptProv)))
+    HCRYPTPROV hCryptProv = NULL;
+    if (FAILED(hr = CryptoUtilities::AcquireContext(hCryptProv)))
     {
         Log::Error("Failed to CryptAcquireContext [{}]", SystemError(hr));
         return hr;
     }
+    BOOST_SCOPE_EXIT(hCryptProv) { CryptReleaseContext(hCryptProv, 0L); }
+    BOOST_SCOPE_EXIT_END;
 
     HCRYPTHASH hHash = NULL;
-    if (!CryptCreateHash(m_hCryptProv, CALG_SHA1, 0, 0, &hHash))
+    if (!CryptCreateHash(hCryptProv, CALG_SHA1, 0, 0, &hHash))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
         Log::Error("Failed CryptCreateHash [{}]", SystemError(hr));
@@ -44,12 +63,102 @@ HRESULT PasswordEncryptedStream::GetKeyMaterial(const std::wstring& pwd)
         return hr;
     }
 
-    if (!CryptDeriveKey(m_hCryptProv, ENCRYPT_ALGORITHM, hHash, 0L, &m_hKey))
+    HCRYPTKEY hKey = NULL;
+    if (!CryptDeriveKey(hCryptProv, ENCRYPT_ALGORITHM, hHash, CRYPT_EXPORTABLE, &hKey))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
         Log::Error(L"Failed CryptDeriveKey [{}]", SystemError(hr));
         return hr;
     }
+    BOOST_SCOPE_EXIT(hKey) { CryptDestroyKey(hKey); }
+    BOOST_SCOPE_EXIT_END;
+
+    PlainTextKeyBlob blob;
+    DWORD dwBlobLen = sizeof(blob);
+    if (!CryptExportKey(hKey, NULL, PLAINTEXTKEYBLOB, 0L, reinterpret_cast<BYTE*>(&blob), &dwBlobLen))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed CryptExportKey [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (dwBlobLen != sizeof(blob) || blob.dwKeySize != key.size())
+    {
+        Log::Error(L"Unexpected derived key size ({} bytes)", blob.dwKeySize);
+        return NTE_BAD_KEY;
+    }
+
+    std::copy(std::cbegin(blob.Key), std::cend(blob.Key), std::begin(key));
+    SecureZeroMemory(&blob, sizeof(blob));
+    return S_OK;
+}
+
+// The key derivation (a provider, a hash and a derived key) is done once per password for the process
+HRESULT GetDerivedKey(const std::wstring& pwd, KeyBytes& key)
+{
+    static std::mutex mutex;
+    static std::map<std::wstring, KeyBytes> keys;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (auto it = keys.find(pwd); it != std::cend(keys))
+    {
+        key = it->second;
+        return S_OK;
+    }
+
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = DeriveKey(pwd, key)))
+        return hr;
+
+    keys.emplace(pwd, key);
+    return S_OK;
+}
+
+}  // namespace
+
+HRESULT PasswordEncryptedStream::GetKeyMaterial(const std::wstring& pwd)
+{
+    HRESULT hr = E_FAIL;
+
+    KeyBytes key;
+    if (FAILED(hr = GetDerivedKey(pwd, key)))
+        return hr;
+    BOOST_SCOPE_EXIT(&key) { SecureZeroMemory(key.data(), key.size()); }
+    BOOST_SCOPE_EXIT_END;
+
+    if (AesExtensionsCipher::IsSupported())
+    {
+        m_pCipher = std::make_unique<AesExtensionsCipher>(key);
+        ZeroMemory(m_Iv, sizeof(m_Iv));
+
+        // KP_BLOCKLEN value (in bits) of the provider key, for the same buffering
+        m_dwBlockLen = AesExtensionsCipher::kBlockSize * 8;
+        return S_OK;
+    }
+
+    if (FAILED(hr = CryptoUtilities::AcquireContext(m_hCryptProv)))
+    {
+        Log::Error("Failed to CryptAcquireContext [{}]", SystemError(hr));
+        return hr;
+    }
+
+    PlainTextKeyBlob blob;
+    blob.Header.bType = PLAINTEXTKEYBLOB;
+    blob.Header.bVersion = CUR_BLOB_VERSION;
+    blob.Header.reserved = 0;
+    blob.Header.aiKeyAlg = ENCRYPT_ALGORITHM;
+    blob.dwKeySize = static_cast<DWORD>(key.size());
+    std::copy(std::cbegin(key), std::cend(key), std::begin(blob.Key));
+    BOOST_SCOPE_EXIT(&blob) { SecureZeroMemory(&blob, sizeof(blob)); }
+    BOOST_SCOPE_EXIT_END;
+
+    if (!CryptImportKey(m_hCryptProv, reinterpret_cast<const BYTE*>(&blob), sizeof(blob), NULL, 0L, &m_hKey))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed CryptImportKey [{}]", SystemError(hr));
+        return hr;
+    }
 
     DWORD dwDataLen = sizeof(DWORD);
     if (!CryptGetKeyParam(m_hKey, KP_BLOCKLEN, (BYTE*)&m_dwBlockLen, &dwDataLen, 0L))
@@ -92,7 +201,7 @@ PasswordEncryptedStream::OpenToDecrypt(const std::wstring& pwd, const std::share
 HRESULT PasswordEncryptedStream::EncryptData(CBinaryBuffer& pData, BOOL bFinal, DWORD& dwEncryptedBytes)
 {
     HRESULT hr = E_FAIL;
-    if (m_hCryptProv == NULL || m_hKey == NULL)
+    if (m_pCipher == nullptr && (m_hCryptProv == NULL || m_hKey == NULL))
     {
         Log::Error("EncryptData: No key to encrypt with");
         return E_UNEXPECTED;
@@ -119,6 +228,24 @@ HRESULT PasswordEncryptedStream::EncryptData(CBinaryBuffer& pData, BOOL bFinal,
         }
     }
 
+    if (m_pCipher != nullptr)
+    {
+        if (bFinal)
+        {
+            // PKCS#5 padding, a whole block when the data is aligned (as CryptEncrypt)
+            const auto cbPadding = static_cast<BYTE>(
+                AesExtensionsCipher::kBlockSize - dwEncryptedBytes % AesExtensionsCipher::kBlockSize);
+            dwDataLen += cbPadding;
+            if (!pData.CheckCount(dwDataLen))
+                return E_OUTOFMEMORY;
+            FillMemory(pData.GetData() + dwEncryptedBytes, cbPadding, cbPadding);
+        }
+
+        m_pCipher->EncryptCbc(pData.GetData(), dwDataLen, m_Iv);
+        dwEncryptedBytes = dwDataLen;
+        return S_OK;
+    }
+
     if (!CryptEncrypt(m_hKey, NULL, bFinal, 0L, pData.GetData(), &dwDataLen, (DWORD)pData.GetCount()))
     {
         if (GetLastError() == ERROR_MORE_DATA)
@@ -150,7 +277,7 @@ HRESULT PasswordEncryptedStream::EncryptData(CBinaryBuffer& pData, BOOL bFinal,
 HRESULT PasswordEncryptedStream::DecryptData(CBinaryBuffer& pData, BOOL bFinal, DWORD& dwDecryptedBytes)
 {
     HRESULT hr = E_FAIL;
-    if (m_hCryptProv == NULL || m_hKey == NULL)
+    if (m_pCipher == nullptr && (m_hCryptProv == NULL || m_hKey == NULL))
     {
         Log::Error("DecryptData: No key to decrypt with");
         return E_UNEXPECTED;
@@ -166,6 +293,33 @@ HRESULT PasswordEncryptedStream::DecryptData(CBinaryBuffer& pData, BOOL bFinal,
 
     dwDecryptedBytes = 0L;
 
+    if (m_pCipher != nullptr)
+    {
+        if (dwToDecrypt % AesExtensionsCipher::kBlockSize != 0)
+        {
+            Log::Error("Failed to decrypt data ({} bytes are not whole cipher blocks)", dwToDecrypt);
+            return NTE_BAD_DATA;
+        }
+
+        m_pCipher->DecryptCbc(pData.GetData(), dwToDecrypt, m_Iv);
+
+        if (bFinal)
+        {
+            const BYTE* pLast = pData.GetData() + dwToDecrypt;
+            const BYTE cbPadding = *(pLast - 1);
+            if (cbPadding == 0 || cbPadding > AesExtensionsCipher::kBlockSize
+                || std::any_of(pLast - cbPadding, pLast, [cbPadding](BYTE b) { return b != cbPadding; }))
+            {
+                Log::Error("Failed to decrypt data (invalid padding)");
+                return NTE_BAD_DATA;
+            }
+            dwToDecrypt -= cbPadding;
+        }
+
+        dwDecryptedBytes = dwToDecrypt;
+        return S_OK;
+    }
+
     if (!CryptDecrypt(m_hKey, NULL, bFinal, 0L, pData.GetData(), &dwToDecrypt))
     {
         hr = HRESULT_FROM_WIN32(GetLastError());
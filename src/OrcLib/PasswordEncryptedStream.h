@@ -9,6 +9,9 @@
 
 #include "ChainingStream.h"
 #include "BinaryBuffer.h"
+#include "AesExtensionsCipher.h"
+
+#include <memory>
 
 #include <boost/logic/tribool.hpp>
 
@@ -16,12 +19,22 @@
 
 namespace Orc {
 
+//
+// PasswordEncryptedStream: AES-256 in CBC mode (zero IV, PKCS#5 padding) with the key derived by CryptDeriveKey from
+// the SHA1 hash of the password.
+//
+// Derived keys are cached by password for the streams opened later. When the processor has the AES instructions, the
+// data is processed by AesExtensionsCipher instead of the CryptoAPI provider, with the same output.
+//
 class PasswordEncryptedStream : public ChainingStream
 {
 private:
     HCRYPTPROV m_hCryptProv = NULL;
     HCRYPTKEY m_hKey = NULL;
     DWORD m_dwBlockLen = 0L;
+
+    std::unique_ptr<AesExtensionsCipher> m_pCipher;
+    BYTE m_Iv[AesExtensionsCipher::kBlockSize] = {0};
     boost::logic::tribool m_bEncrypting;
 
     CBinaryBuffer m_Buffer;
@@ -0,0 +1,289 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "ProcessMemoryScanner.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "MemoryAccounting.h"
+#include "Privilege.h"
+#include "TaskPool.h"
+#include "Utils/Guard.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+bool IsReadable(const MEMORY_BASIC_INFORMATION& mbi)
+{
+    if (mbi.State != MEM_COMMIT || mbi.Protect == 0)
+        return false;
+
+    return (mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD)) == 0;
+}
+
+}  // namespace
+
+ProcessMemoryScanner::ProcessMemoryScanner(YaraScanner& scanner, DWORD dwWorkers)
+    : m_Scanner(scanner)
+    , m_ulBlockSize(scanner.Config().blockSize())
+    , m_ulOverlapSize(std::min(scanner.Config().overlapSize(), scanner.Config().blockSize() / 2))
+{
+    if (dwWorkers == 0)
+        dwWorkers = TaskPool::Instance().Processors();
+
+    // Scanners are created here as creating them compiles the rules on first call, which is not thread safe
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        auto pScanner = m_Scanner.CreateScanner();
+        if (!pScanner)
+        {
+            Log::Error("Failed to create yara scanner for process memory worker #{}", i);
+            break;
+        }
+
+        m_Scanners.push_back(std::move(pScanner));
+    }
+}
+
+HRESULT ProcessMemoryScanner::Scan(const ProcessVector& processes, std::vector<Match>& matches)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_Scanners.empty())
+    {
+        Log::Error("No yara scanner to scan process memory");
+        return E_FAIL;
+    }
+
+    ProcessVector targets = processes;
+    if (targets.empty())
+    {
+        RunningProcesses running;
+        if (FAILED(hr = running.EnumerateProcesses()))
+        {
+            Log::Error("Failed to enumerate running processes [{}]", SystemError(hr));
+            return hr;
+        }
+
+        running.GetProcesses(targets);
+    }
+
+    // The rules loaded in our own memory would match
+    const auto dwCurrentPid = GetCurrentProcessId();
+    targets.erase(
+        std::remove_if(
+            std::begin(targets),
+            std::end(targets),
+            [dwCurrentPid](const ProcessInfo& process) { return process.m_Pid == dwCurrentPid; }),
+        std::end(targets));
+
+    if (targets.empty())
+        return S_OK;
+
+    // Processes of the other users and services cannot be read without the debug privilege
+    if (FAILED(hr = SetPrivilege(SE_DEBUG_NAME, TRUE)))
+        Log::Debug("Failed to enable debug privilege, some processes will not be scanned [{}]", SystemError(hr));
+
+    m_NextProcess = 0;
+    m_Matches.clear();
+    m_Statistics = Statistics();
+
+    const auto dwWorkers = static_cast<DWORD>(std::min<size_t>(m_Scanners.size(), targets.size()));
+
+    std::vector<YaraScanner::MemoryBlockBuffer> buffers;
+    buffers.reserve(dwWorkers);
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        auto& buffer = buffers.emplace_back(LargePages::Allocator<uint8_t>(true));
+        buffer.reserve(LargePages::PreferredSize(m_ulBlockSize));
+        buffer.resize(m_ulBlockSize);
+    }
+
+    const ULONGLONG cbBuffers = static_cast<ULONGLONG>(dwWorkers) * m_ulBlockSize;
+    MemoryAccounting::Charge(MemoryAccounting::Tag::Yara, cbBuffers);
+
+    Log::Debug(
+        "Scanning memory of {} processes (workers: {}, block: {} bytes, overlap: {} bytes)",
+        targets.size(),
+        dwWorkers,
+        m_ulBlockSize,
+        m_ulOverlapSize);
+
+    std::vector<std::thread> workers;
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        workers.emplace_back([this, pScanner = m_Scanners[i].get(), &buffer = buffers[i], &targets]() {
+            Work(pScanner, buffer, targets);
+        });
+    }
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    MemoryAccounting::Release(MemoryAccounting::Tag::Yara, cbBuffers);
+
+    // Rules which exceeded their budget in the workers' scans are only disabled from the owning thread
+    m_Scanner.DisableRulesOverBudget();
+
+    std::sort(std::begin(m_Matches), std::end(m_Matches), [](const Match& lhs, const Match& rhs) {
+        if (lhs.Pid != rhs.Pid)
+            return lhs.Pid < rhs.Pid;
+        return lhs.BaseAddress < rhs.BaseAddress;
+    });
+
+    matches = std::move(m_Matches);
+    m_Matches.clear();
+
+    Log::Debug(
+        "Process memory scan complete (processes: {}, denied: {}, regions: {}, scanned: {} bytes, unreadable: {} "
+        "bytes, matches: {})",
+        m_Statistics.Processes,
+        m_Statistics.Denied,
+        m_Statistics.Regions,
+        m_Statistics.ScannedBytes,
+        m_Statistics.UnreadableBytes,
+        matches.size());
+
+    return S_OK;
+}
+
+void ProcessMemoryScanner::Work(
+    YR_SCANNER* pScanner,
+    YaraScanner::MemoryBlockBuffer& buffer,
+    const ProcessVector& processes)
+{
+    Statistics statistics;
+
+    for (;;)
+    {
+        const size_t index = m_NextProcess++;
+        if (index >= processes.size())
+            break;
+
+        try
+        {
+            ScanProcess(pScanner, buffer, processes[index], statistics);
+        }
+        catch (const std::exception& e)
+        {
+            Log::Error("Process memory scan failed with an exception (pid: {}): {}", processes[index].m_Pid, e.what());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Statistics.Processes += statistics.Processes;
+    m_Statistics.Denied += statistics.Denied;
+    m_Statistics.Regions += statistics.Regions;
+    m_Statistics.ScannedBytes += statistics.ScannedBytes;
+    m_Statistics.UnreadableBytes += statistics.UnreadableBytes;
+}
+
+void ProcessMemoryScanner::ScanProcess(
+    YR_SCANNER* pScanner,
+    YaraScanner::MemoryBlockBuffer& buffer,
+    const ProcessInfo& process,
+    Statistics& statistics)
+{
+    Guard::Handle hProcess(OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, process.m_Pid));
+    if (!hProcess.IsValid())
+    {
+        Log::Debug("Failed to open process (pid: {}) [{}]", process.m_Pid, LastWin32Error());
+        statistics.Denied++;
+        return;
+    }
+
+    statistics.Processes++;
+
+    const SIZE_T cbStep = m_ulBlockSize - m_ulOverlapSize;
+
+    std::vector<Match> matches;
+    MEMORY_BASIC_INFORMATION mbi;
+    ULONG_PTR address = 0;
+
+    while (VirtualQueryEx(*hProcess, reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi)) == sizeof(mbi))
+    {
+        const auto base = reinterpret_cast<ULONG_PTR>(mbi.BaseAddress);
+        if (base + mbi.RegionSize <= address)
+            break;  // the last region wraps around the address space
+
+        address = base + mbi.RegionSize;
+
+        if (!::IsReadable(mbi))
+            continue;
+
+        statistics.Regions++;
+
+        MatchingRuleCollection matchingRules;
+        for (SIZE_T offset = 0; offset < mbi.RegionSize; offset += cbStep)
+        {
+            const SIZE_T cbToRead = std::min<SIZE_T>(m_ulBlockSize, mbi.RegionSize - offset);
+
+            // Pages can be decommitted or protected meanwhile: a partial copy is still scanned
+            SIZE_T cbRead = 0;
+            if (!ReadProcessMemory(
+                    *hProcess, reinterpret_cast<LPCVOID>(base + offset), buffer.data(), cbToRead, &cbRead)
+                && cbRead == 0)
+            {
+                Log::Trace(
+                    "Failed to read process memory (pid: {}, address: {:#x}) [{}]",
+                    process.m_Pid,
+                    base + offset,
+                    LastWin32Error());
+                statistics.UnreadableBytes += std::min<SIZE_T>(cbToRead, cbStep);
+            }
+            else
+            {
+                statistics.ScannedBytes += cbRead;
+
+                HRESULT hr = m_Scanner.Scan(pScanner, buffer.data(), cbRead, matchingRules);
+                if (FAILED(hr))
+                {
+                    Log::Debug(
+                        "Failed to scan process memory (pid: {}, address: {:#x}) [{}]",
+                        process.m_Pid,
+                        base + offset,
+                        SystemError(hr));
+                }
+            }
+
+            if (offset + cbToRead >= mbi.RegionSize)
+                break;
+        }
+
+        if (matchingRules.empty())
+            continue;
+
+        // A rule matching the overlap of two blocks is reported by both
+        std::sort(std::begin(matchingRules), std::end(matchingRules));
+        matchingRules.erase(std::unique(std::begin(matchingRules), std::end(matchingRules)), std::end(matchingRules));
+
+        Match match;
+        match.Pid = process.m_Pid;
+        match.Image = process.strModule ? *process.strModule : std::wstring();
+        match.BaseAddress = base;
+        match.RegionSize = mbi.RegionSize;
+        match.Protect = mbi.Protect;
+        match.Type = mbi.Type;
+        match.MatchingRules = std::move(matchingRules);
+        matches.push_back(std::move(match));
+    }
+
+    if (matches.empty())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    std::move(std::begin(matches), std::end(matches), std::back_inserter(m_Matches));
+}
@@ -0,0 +1,93 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "YaraScanner.h"
+#include "RunningProcesses.h"
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Scan the committed memory of running processes with the compiled rules of a YaraScanner.
+//
+// Processes are scanned in parallel by a bounded number of worker threads, each with its own YR_SCANNER and its own
+// block buffer reused for every region it reads: the compiled rules are shared. Regions are read with
+// ReadProcessMemory in blocks of the configured block size which overlap by the configured overlap size, like the
+// streams scanned in blocks. The worker buffers are charged to the 'yara' memory tag.
+class ProcessMemoryScanner
+{
+public:
+    // Rules matching a memory region
+    struct Match
+    {
+        DWORD Pid = 0L;
+        std::wstring Image;
+        ULONGLONG BaseAddress = 0LL;
+        ULONGLONG RegionSize = 0LL;
+        DWORD Protect = 0L;
+        DWORD Type = 0L;  // MEM_IMAGE, MEM_MAPPED or MEM_PRIVATE
+        MatchingRuleCollection MatchingRules;
+    };
+
+    struct Statistics
+    {
+        ULONGLONG Processes = 0LL;
+        ULONGLONG Denied = 0LL;  // processes which could not be opened
+        ULONGLONG Regions = 0LL;
+        ULONGLONG ScannedBytes = 0LL;
+        ULONGLONG UnreadableBytes = 0LL;  // committed bytes ReadProcessMemory failed to read
+    };
+
+    // Rules of 'scanner' must be complete, 'scanner' must outlive the instance. 0 worker uses one worker per
+    // processor available to the TaskPool.
+    ProcessMemoryScanner(YaraScanner& scanner, DWORD dwWorkers = 0L);
+
+    ProcessMemoryScanner(const ProcessMemoryScanner&) = delete;
+    ProcessMemoryScanner& operator=(const ProcessMemoryScanner&) = delete;
+
+    // Number of workers which could create their scanner
+    DWORD Workers() const { return static_cast<DWORD>(m_Scanners.size()); }
+
+    // Scan the memory of 'processes', or of all the running processes when empty, except the current one. Matches are
+    // returned ordered by process and address.
+    HRESULT Scan(const ProcessVector& processes, std::vector<Match>& matches);
+
+    const Statistics& GetStatistics() const { return m_Statistics; }
+
+private:
+    void Work(YR_SCANNER* pScanner, YaraScanner::MemoryBlockBuffer& buffer, const ProcessVector& processes);
+    void ScanProcess(
+        YR_SCANNER* pScanner,
+        YaraScanner::MemoryBlockBuffer& buffer,
+        const ProcessInfo& process,
+        Statistics& statistics);
+
+    YaraScanner& m_Scanner;
+    const ULONG m_ulBlockSize;
+    const ULONG m_ulOverlapSize;
+
+    std::vector<YaraScanner::ScannerPtr> m_Scanners;
+
+    std::atomic<size_t> m_NextProcess {0};
+
+    std::mutex m_Mutex;
+    std::vector<Match> m_Matches;
+    Statistics m_Statistics;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
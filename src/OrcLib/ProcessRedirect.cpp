@@ -26,6 +26,9 @@ using namespace Orc;
 
 static const NTSTATUS STATUS_PIPE_BROKEN = 0xC000014BL;
 
+// Data an output file pipe buffers while the parent is not reading
+static const DWORD FILE_PIPE_BUFFER_SIZE = 1024 * 1024;
+
 ProcessRedirect::ProcessRedirect(ProcessInOut selection)
     : m_Status(Initialized)
     , m_Select(selection)
@@ -179,6 +182,32 @@ HRESULT ProcessRedirect::CreatePipe(const WCHAR* szUniqueSuffix)
     if (m_Select & StdInput && (m_Select & StdOutput || m_Select & StdError))
         return E_INVALIDARG;
 
+    if (m_Select & OutputFile)
+    {
+        if (m_Select != OutputFile)
+            return E_INVALIDARG;
+
+        wcscpy_s(szPipeName, L"\\.\pipe\DFIR-ORC_file_");
+        wcscat_s(szPipeName, szUniqueSuffix);
+
+        // The child opens the pipe by name: a single, non inheritable instance which cannot be hijacked
+        if ((m_ReadHandle = CreateNamedPipe(
+                 szPipeName,
+                 PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+                 PIPE_TYPE_BYTE | PIPE_READMODE_BYTE,
+                 1,
+                 BUFFER_SIZE,
+                 FILE_PIPE_BUFFER_SIZE,
+                 0,
+                 NULL))
+            == INVALID_HANDLE_VALUE)
+            return HRESULT_FROM_WIN32(GetLastError());
+
+        m_strPipeName = szPipeName;
+        SetStatus(PipeCreated);
+        return S_OK;
+    }
+
     // you need this for the client to inherit the handles	SECURITY_ATTRIBUTES sa;
     SECURITY_ATTRIBUTES sa;
     // Set up the security attributes struct.
@@ -350,16 +379,42 @@ HRESULT ProcessRedirect::ChildConnected()
     if (!BindIoCompletionCallback(m_ReadHandle, ProcessRedirect::FileIOCompletionRoutine, 0L))
         return HRESULT_FROM_WIN32(GetLastError());
 
+    if (m_Select & OutputFile)
+    {
+        // Reading starts from the completion of the connection when the child has not opened the pipe yet
+        if (!ConnectNamedPipe(m_ReadHandle, &m_ASyncIO.OL))
+        {
+            switch (GetLastError())
+            {
+                case ERROR_IO_PENDING:
+                    return S_OK;
+                case ERROR_PIPE_CONNECTED:
+                case ERROR_NO_DATA:  // the child already wrote and closed its output
+                    break;
+                default:
+                    return HRESULT_FROM_WIN32(GetLastError());
+            }
+        }
+    }
+
     // Child is connected, start reading
     if (!(m_Select & StdInput))
     {
         DWORD dwBytesRead = 0L;
         if (!ReadFile(m_ReadHandle, m_ASyncIO.Buffer, BUFFER_SIZE, &dwBytesRead, &m_ASyncIO.OL))
         {
-            if (GetLastError() != ERROR_IO_PENDING)
-                return HRESULT_FROM_WIN32(GetLastError());
-            else
-                SetStatus(PendingIO);
+            switch (GetLastError())
+            {
+                case ERROR_IO_PENDING:
+                    SetStatus(PendingIO);
+                    break;
+                case ERROR_BROKEN_PIPE:
+                    SetStatus(Complete);
+                    Close();
+                    break;
+                default:
+                    return HRESULT_FROM_WIN32(GetLastError());
+            }
         }
         else
         {
@@ -39,7 +39,8 @@ public:
     {
         StdInput = 0x1 << 0,
         StdOutput = 0x1 << 1,
-        StdError = 0x1 << 2
+        StdError = 0x1 << 2,
+        OutputFile = 0x1 << 3  // named pipe the child opens as its output file
     };
 
     enum RedirectStatus
@@ -68,6 +69,9 @@ public:
 
     std::shared_ptr<ByteStream> GetStream() const { return m_pBS; };
 
+    // Path of the pipe the child opens, for OutputFile redirections
+    const std::wstring& PipeName() const { return m_strPipeName; };
+
     HRESULT Close();
     ~ProcessRedirect();
 
@@ -76,6 +80,7 @@ private:
     HANDLE m_WriteHandle = INVALID_HANDLE_VALUE;
     HANDLE m_DuplicateHandle = INVALID_HANDLE_VALUE;
     ProcessInOut m_Select = ProcessInOut::StdOutput;
+    std::wstring m_strPipeName;
 
     std::shared_ptr<ByteStream> m_pBS;
     bool m_bCloseStream = true;
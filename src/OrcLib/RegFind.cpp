@@ -588,12 +588,14 @@ HRESULT RegFind::AddRegFindFromConfig(const std::vector<ConfigItem>& items)
         if (term != nullptr)
         {
             HRESULT hr = E_FAIL;
-            if (FAILED(hr = AddSearchTerm(term)))
+            if (FAILED(hr = AddTerm(term)))
             {
                 Log::Error(L"Failed to add registry search term [{}]", SystemError(hr));
             }
         }
     }
+
+    CompileContainsTerms();
     return S_OK;
 }
 
@@ -671,7 +673,7 @@ HRESULT RegFind::AddRegFindFromTemplate(const std::vector<ConfigItem>& items)
             if (term != nullptr)
             {
                 term->SetTermName(item[CONFIG_TEMPLATE_NAME]);
-                if (FAILED(hr = AddSearchTerm(term)))
+                if (FAILED(hr = AddTerm(term)))
                 {
                     Log::Error(L"Failed to add registry search term [{}]", SystemError(hr));
                 }
@@ -679,6 +681,7 @@ HRESULT RegFind::AddRegFindFromTemplate(const std::vector<ConfigItem>& items)
         }
     }
 
+    CompileContainsTerms();
     return S_OK;
 }
 
@@ -931,8 +934,78 @@ std::string RegFind::SearchTerm::GetDescription() const
     return stream.str();
 }
 
+namespace {
+
+// Call 'function' with each key name of 'path', separators are ignored
+template <typename Function>
+bool ForEachKeyName(std::string_view path, Function&& function)
+{
+    while (!path.empty())
+    {
+        const auto pos = path.find('\\');
+        const auto name = path.substr(0, pos);
+        if (!name.empty() && !function(name))
+            return false;
+
+        if (pos == std::string_view::npos)
+            break;
+
+        path.remove_prefix(pos + 1);
+    }
+
+    return true;
+}
+
+}  // namespace
+
+void RegFind::KeyPathTrie::Add(std::string_view path)
+{
+    size_t node = 0;
+    ForEachKeyName(path, [this, &node](std::string_view name) {
+        auto [it, inserted] = m_Nodes[node].Children.try_emplace(std::string(name), m_Nodes.size());
+        node = it->second;
+        if (inserted)
+            m_Nodes.emplace_back();
+        return true;
+    });
+}
+
+bool RegFind::KeyPathTrie::IsOnPath(std::string_view path) const
+{
+    size_t node = 0;
+    return ForEachKeyName(path, [this, &node](std::string_view name) {
+        const auto& children = m_Nodes[node].Children;
+        auto it = children.find(std::string(name));
+        if (it == children.cend())
+            return false;
+
+        node = it->second;
+        return true;
+    });
+}
+
 HRESULT RegFind::AddSearchTerm(const std::shared_ptr<RegFind::SearchTerm>& pMatch)
 {
+    if (auto hr = AddTerm(pMatch); FAILED(hr))
+        return hr;
+
+    if (pMatch->m_criteriaRequired & SearchTerm::Criteria::DATA_CONTAINS)
+        CompileContainsTerms();
+
+    return S_OK;
+}
+
+HRESULT RegFind::AddTerm(const std::shared_ptr<RegFind::SearchTerm>& pMatch)
+{
+    if (pMatch->m_criteriaRequired & SearchTerm::Criteria::KEY_PATH)
+    {
+        m_KeyPaths.Add(pMatch->m_strPathName);
+    }
+    else
+    {
+        m_bFullWalk = true;
+    }
+
     bool bExact = false;
     if ((pMatch->m_criteriaRequired & SearchTerm::Criteria::KEY_NAME)
         && !((pMatch->m_criteriaRequired & SearchTerm::Criteria::VALUE_NAME)))
@@ -960,6 +1033,87 @@ HRESULT RegFind::AddSearchTerm(const std::shared_ptr<RegFind::SearchTerm>& pMatc
     return S_OK;
 }
 
+void RegFind::CompileContainsTerms()
+{
+    auto matcher = std::make_shared<ContentPatternMatcher>();
+
+    const auto addTerm = [&matcher](const std::shared_ptr<SearchTerm>& term) {
+        term->m_ContainsPattern.reset();
+        term->m_WContainsPattern.reset();
+        if (!(term->m_criteriaRequired & SearchTerm::Criteria::DATA_CONTAINS))
+            return;
+
+        const auto& ansi = term->m_DataContentContains;
+        const auto& wide = term->m_WDataContentContains;
+        term->m_ContainsPattern =
+            matcher->Add(std::string_view(reinterpret_cast<const char*>(ansi.GetData()), ansi.GetCount()));
+        term->m_WContainsPattern =
+            matcher->Add(std::string_view(reinterpret_cast<const char*>(wide.GetData()), wide.GetCount()));
+    };
+
+    for (const auto& [name, term] : m_ExactKeyNameSpecs)
+        addTerm(term);
+    for (const auto& [path, term] : m_ExactKeyPathSpecs)
+        addTerm(term);
+    for (const auto& [name, term] : m_ExactValueNameSpecs)
+        addTerm(term);
+    for (const auto& term : m_Specs)
+        addTerm(term);
+
+    if (matcher->empty())
+    {
+        m_ContainsMatcher.reset();
+        return;
+    }
+
+    matcher->Compile();
+    m_ContainsMatcher = std::move(matcher);
+
+    Log::Debug(L"Compiled {} registry data strings", m_ContainsMatcher->size());
+}
+
+bool RegFind::IsContainsCandidate(
+    const std::shared_ptr<SearchTerm>& aTerm,
+    const RegistryValue* const RegValue,
+    std::optional<ContentPatternMatcher::Scan>& scan) const
+{
+    if (!(aTerm->m_criteriaRequired & SearchTerm::Criteria::DATA_CONTAINS) || m_ContainsMatcher == nullptr)
+        return true;
+
+    // Same choice of string as DatasContains
+    std::optional<size_t> pattern;
+    switch (RegValue->GetType())
+    {
+        case ValueType::RegDWORD:
+        case ValueType::RegDWORDBE:
+        case ValueType::RegQWORD:
+            return false;
+        case ValueType::RegSZ:
+        case ValueType::ExpandSZ:
+        case ValueType::RegMultiSZ:
+            pattern = aTerm->m_WContainsPattern;
+            break;
+        default:
+            pattern = aTerm->m_ContainsPattern;
+            break;
+    }
+
+    if (!pattern)
+        return true;
+
+    if (!scan)
+    {
+        const BYTE* pDatas = nullptr;
+        const size_t DatasSize = RegValue->GetDatas(&pDatas);
+
+        scan.emplace(*m_ContainsMatcher);
+        if (pDatas != nullptr)
+            scan->Feed(pDatas, DatasSize);
+    }
+
+    return scan->Found(*pattern);
+}
+
 // Name specs: Only depend on KeyName
 RegFind::SearchTerm::Criteria
 RegFind::ExactKeyName(const std::shared_ptr<SearchTerm>& aTerm, const RegistryKey* const Regkey) const
@@ -984,14 +1138,14 @@ RegFind::RegexKeyName(const std::shared_ptr<SearchTerm>& aTerm, const RegistryKe
     if (Regkey == nullptr)
         return RegFind::SearchTerm::Criteria::NONE;
 
-    if (Regkey->GetShortKeyName().empty() || aTerm->m_regexKeyName._Empty())
+    if (Regkey->GetShortKeyName().empty() || aTerm->m_regexKeyName.empty())
     {
         return SearchTerm::Criteria::NONE;
     }
 
     if (aTerm->m_criteriaRequired & SearchTerm::Criteria::KEY_NAME_REGEX)
     {
-        if (std::regex_match(Regkey->GetShortKeyName().c_str(), aTerm->m_regexKeyName))
+        if (aTerm->m_regexKeyName.Match(Regkey->GetShortKeyName().c_str()))
             return SearchTerm::Criteria::KEY_NAME_REGEX;
     }
 
@@ -1045,14 +1199,14 @@ RegFind::RegexKeyPath(const std::shared_ptr<SearchTerm>& aTerm, const RegistryKe
     if (Regkey == nullptr)
         return RegFind::SearchTerm::Criteria::NONE;
 
-    if (Regkey->GetKeyName().empty() || aTerm->m_regexPathName._Empty())
+    if (Regkey->GetKeyName().empty() || aTerm->m_regexPathName.empty())
     {
         return SearchTerm::Criteria::NONE;
     }
 
     if (aTerm->m_criteriaRequired & SearchTerm::Criteria::KEY_PATH_REGEX)
     {
-        if (std::regex_match(Regkey->GetKeyName().c_str(), aTerm->m_regexPathName))
+        if (aTerm->m_regexPathName.Match(Regkey->GetKeyName().c_str()))
             return SearchTerm::Criteria::KEY_PATH_REGEX;
     }
 
@@ -1092,7 +1246,7 @@ RegFind::ExactValueName(const std::shared_ptr<SearchTerm>& aTerm, const Registry
 
     if (aTerm->m_criteriaRequired & SearchTerm::Criteria::VALUE_NAME)
     {
-        if (boost::iequals(aTerm->m_strValueName, RegValue->GetValueName()))
+        if (boost::iequals(aTerm->m_strValueName, RegValue->GetValueNameView()))
         {
             return SearchTerm::Criteria::VALUE_NAME;
         }
@@ -1110,10 +1264,10 @@ RegFind::RegexValueName(const std::shared_ptr<SearchTerm>& aTerm, const Registry
     if (aTerm->m_criteriaRequired & SearchTerm::Criteria::VALUE_NAME_REGEX)
     {
         // check regex for emptiness but do not check value name: default value has an empty name!
-        if (aTerm->m_regexValueName._Empty())
+        if (aTerm->m_regexValueName.empty())
             return SearchTerm::Criteria::NONE;
 
-        if (std::regex_match(RegValue->GetValueName().c_str(), aTerm->m_regexValueName))
+        if (aTerm->m_regexValueName.Match(RegValue->GetValueNameView()))
             return SearchTerm::Criteria::VALUE_NAME_REGEX;
     }
     return SearchTerm::Criteria::NONE;
@@ -1278,10 +1432,8 @@ RegFind::RegexDatas(const std::shared_ptr<SearchTerm>& aTerm, const RegistryValu
                 {
                     CurrentStrSize = wcslen((WCHAR*)(pDatas + i));
 
-                    if (std::regex_match(
-                            (WCHAR*)(pDatas + i),
-                            (WCHAR*)(pDatas + i + CurrentStrSize * sizeof(WCHAR)),
-                            aTerm->m_wregexDataContentPattern))
+                    if (aTerm->m_wregexDataContentPattern.Match(
+                            (WCHAR*)(pDatas + i), (WCHAR*)(pDatas + i + CurrentStrSize * sizeof(WCHAR))))
                     {
                         matchedCriteria = static_cast<SearchTerm::Criteria>(
                             SearchTerm::Criteria::DATA_CONTENT_REGEX | matchedCriteria);
@@ -1293,20 +1445,19 @@ RegFind::RegexDatas(const std::shared_ptr<SearchTerm>& aTerm, const RegistryValu
             case ValueType::RegSZ:
             case ValueType::ExpandSZ:
 
-                if (std::regex_match(
-                        (WCHAR*)pDatas, ((WCHAR*)pDatas) + wcslen((WCHAR*)pDatas), aTerm->m_wregexDataContentPattern))
+                if (aTerm->m_wregexDataContentPattern.Match((WCHAR*)pDatas, ((WCHAR*)pDatas) + wcslen((WCHAR*)pDatas)))
                     matchedCriteria =
                         static_cast<SearchTerm::Criteria>(SearchTerm::Criteria::DATA_CONTENT_REGEX | matchedCriteria);
 
                 break;
             case ValueType::RegBin:
 
-                if (std::regex_match(pDatas, pDatas + DatasSize, aTerm->m_regexDataContentPattern))
+                if (aTerm->m_regexDataContentPattern.Match((LPCSTR)pDatas, (LPCSTR)(pDatas + DatasSize)))
                     matchedCriteria =
                         static_cast<SearchTerm::Criteria>(SearchTerm::Criteria::DATA_CONTENT_REGEX | matchedCriteria);
 
                 // also check with unicode pattern
-                if (std::regex_match((WCHAR*)pDatas, (WCHAR*)(pDatas + DatasSize), aTerm->m_wregexDataContentPattern))
+                if (aTerm->m_wregexDataContentPattern.Match((WCHAR*)pDatas, (WCHAR*)(pDatas + DatasSize)))
                     matchedCriteria =
                         static_cast<SearchTerm::Criteria>(SearchTerm::Criteria::DATA_CONTENT_REGEX | matchedCriteria);
                 break;
@@ -1589,7 +1740,8 @@ RegFind::SearchTerm::Criteria RegFind::LookupSpec(
     return RegFind::SearchTerm::Criteria::NONE;
 }
 
-const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const RegistryKey* const RegKey)
+const std::vector<std::shared_ptr<RegFind::Match>>
+RegFind::FindMatch(const RegistryKey* const RegKey, MatchesMap& matches) const
 {
     std::vector<std::shared_ptr<RegFind::Match>> MatchVector;
     std::shared_ptr<RegFind::Match> retval;
@@ -1607,9 +1759,9 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
             }
 
             // check if term already matched
-            auto term = m_Matches.find(it->second);
+            auto term = matches.find(it->second);
             retval = std::make_shared<RegFind::Match>(it->second);
-            if (term != m_Matches.end())
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_NAME, retval, RegKey);
                 if (matched != SearchTerm::Criteria::NONE)
@@ -1628,7 +1780,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 if (matched != SearchTerm::Criteria::NONE)
                 {
                     // Add into the global match vector
-                    m_Matches.insert(MatchesMap::value_type(it->second, retval));
+                    matches.insert(MatchesMap::value_type(it->second, retval));
                     // Add into this specific key match vector (used by callback)
                     MatchVector.push_back(retval);
                 }
@@ -1649,9 +1801,9 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 continue;
             }
             // check if term already matched
-            auto term = m_Matches.find(it->second);
+            auto term = matches.find(it->second);
             retval = std::make_shared<RegFind::Match>(it->second);
-            if (term != m_Matches.end())
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_PATH, retval, RegKey);
                 if (matched != SearchTerm::Criteria::NONE)
@@ -1670,7 +1822,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 if (matched != SearchTerm::Criteria::NONE)
                 {
                     // Add into the global match vector
-                    m_Matches.insert(MatchesMap::value_type(it->second, retval));
+                    matches.insert(MatchesMap::value_type(it->second, retval));
                     // Add into this specific key match vector (used by callback)
                     MatchVector.push_back(retval);
                 }
@@ -1684,9 +1836,9 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
         if (!(*term_it)->DependsOnValueOrData())
         {
             // check if term already matched
-            auto term = m_Matches.find(*term_it);
+            auto term = matches.find(*term_it);
             std::shared_ptr<RegFind::Match> retval = std::make_shared<RegFind::Match>(*term_it);
-            if (term != m_Matches.end())
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(*term_it, SearchTerm::Criteria::NONE, retval, RegKey);
                 if (matched == (*term_it)->m_criteriaRequired)
@@ -1705,7 +1857,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 if (matched == (*term_it)->m_criteriaRequired)
                 {
                     // Add into the global match vector
-                    m_Matches.insert(MatchesMap::value_type(*term_it, retval));
+                    matches.insert(MatchesMap::value_type(*term_it, retval));
                     // Add into this specific key match vector (used by callback)
                     MatchVector.push_back(retval);
                 }
@@ -1716,28 +1868,32 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
     return MatchVector;
 }
 
-const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const RegistryValue* const RegValue)
+const std::vector<std::shared_ptr<RegFind::Match>>
+RegFind::FindMatch(const RegistryValue* const RegValue, MatchesMap& matches) const
 {
     std::shared_ptr<RegFind::Match> retval;
     const RegistryKey* const pKey = RegValue->GetParentKey();
     std::shared_ptr<RegFind::Match> pRetval;
     std::vector<std::shared_ptr<RegFind::Match>> MatchVector;
 
+    // The value data is scanned for all the DATA_CONTAINS strings at once, the first time a term needs it
+    std::optional<ContentPatternMatcher::Scan> scan;
+
     if (!m_ExactKeyNameSpecs.empty())
     {
         const std::string& name = pKey->GetShortKeyName();
         auto it = m_ExactKeyNameSpecs.find(name);
         while (it != m_ExactKeyNameSpecs.end())
         {
-            if (!it->second->DependsOnValueOrData())
+            if (!it->second->DependsOnValueOrData() || !IsContainsCandidate(it->second, RegValue, scan))
             {
                 it++;
                 continue;
             }
 
             // check if term already matched
-            auto term = m_Matches.find(it->second);
-            if (term != m_Matches.end())
+            auto term = matches.find(it->second);
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_NAME, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
@@ -1755,7 +1911,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_NAME, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
                 {
-                    m_Matches.insert(MatchesMap::value_type(it->second, retval));
+                    matches.insert(MatchesMap::value_type(it->second, retval));
                     MatchVector.push_back(retval);
                 }
             }
@@ -1769,14 +1925,14 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
         auto it = m_ExactKeyPathSpecs.find(name);
         while (it != m_ExactKeyPathSpecs.end())
         {
-            if (!it->second->DependsOnValueOrData())
+            if (!it->second->DependsOnValueOrData() || !IsContainsCandidate(it->second, RegValue, scan))
             {
                 it = next(it);
                 continue;
             }
             // check if term already matched
-            auto term = m_Matches.find(it->second);
-            if (term != m_Matches.end())
+            auto term = matches.find(it->second);
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_PATH, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
@@ -1794,7 +1950,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::KEY_PATH, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
                 {
-                    m_Matches.insert(MatchesMap::value_type(it->second, retval));
+                    matches.insert(MatchesMap::value_type(it->second, retval));
                     MatchVector.push_back(retval);
                 }
             }
@@ -1802,21 +1958,20 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
         }
     }
 
-    std::string name = RegValue->GetValueName();
     if (!m_ExactValueNameSpecs.empty())
     {
-        auto it = m_ExactValueNameSpecs.find(name);
+        auto it = m_ExactValueNameSpecs.find(RegValue->GetValueName());
         while (it != m_ExactValueNameSpecs.end())
         {
-            if (!it->second->DependsOnValueOrData())
+            if (!it->second->DependsOnValueOrData() || !IsContainsCandidate(it->second, RegValue, scan))
             {
                 it++;
                 continue;
             }
 
             // check if term already matched
-            auto term = m_Matches.find(it->second);
-            if (term != m_Matches.end())
+            auto term = matches.find(it->second);
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::VALUE_NAME, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
@@ -1834,7 +1989,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 auto matched = LookupSpec(it->second, SearchTerm::Criteria::VALUE_NAME, retval, RegValue);
                 if (matched != SearchTerm::Criteria::NONE)
                 {
-                    m_Matches.insert(MatchesMap::value_type(it->second, retval));
+                    matches.insert(MatchesMap::value_type(it->second, retval));
                     MatchVector.push_back(retval);
                 }
             }
@@ -1844,7 +1999,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
 
     for (auto term_it = begin(m_Specs); term_it != end(m_Specs); ++term_it)
     {
-        if (!(*term_it)->DependsOnValueOrData())
+        if (!(*term_it)->DependsOnValueOrData() || !IsContainsCandidate(*term_it, RegValue, scan))
         {
             continue;
         }
@@ -1852,8 +2007,8 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
         else
         {
             // check if term already matched
-            auto term = m_Matches.find(*term_it);
-            if (term != m_Matches.end())
+            auto term = matches.find(*term_it);
+            if (term != matches.end())
             {
                 auto matched = LookupSpec(*term_it, SearchTerm::Criteria::NONE, retval, RegValue);
                 if (matched == (*term_it)->m_criteriaRequired)
@@ -1871,7 +2026,7 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
                 auto matched = LookupSpec(*term_it, SearchTerm::Criteria::NONE, retval, RegValue);
                 if (matched == (*term_it)->m_criteriaRequired)
                 {
-                    m_Matches.insert(MatchesMap::value_type(*term_it, retval));
+                    matches.insert(MatchesMap::value_type(*term_it, retval));
                     MatchVector.push_back(retval);
                 }
             }
@@ -1880,41 +2035,108 @@ const std::vector<std::shared_ptr<RegFind::Match>> RegFind::FindMatch(const Regi
     return MatchVector;
 }
 
+void RegFind::MergeMatches(std::vector<MatchesMap>& slotMatches, MatchesMap& matches)
+{
+    for (auto& slot : slotMatches)
+    {
+        for (auto& [term, match] : slot)
+        {
+            auto it = matches.find(term);
+            if (it == matches.end())
+            {
+                matches.insert(MatchesMap::value_type(term, match));
+                continue;
+            }
+
+            auto& keys = it->second->MatchingKeys;
+            keys.insert(
+                keys.end(),
+                std::make_move_iterator(match->MatchingKeys.begin()),
+                std::make_move_iterator(match->MatchingKeys.end()));
+
+            auto& values = it->second->MatchingValues;
+            values.insert(
+                values.end(),
+                std::make_move_iterator(match->MatchingValues.begin()),
+                std::make_move_iterator(match->MatchingValues.end()));
+        }
+        slot.clear();
+    }
+}
+
 HRESULT RegFind::Find(
     const std::shared_ptr<ByteStream>& location,
     FoundKeyMatchCallback aKeyCallback,
     FoundValueMatchCallback aValueCallback)
 {
-
     ClearMatches();
 
+    return Find(location, m_Matches, std::move(aKeyCallback), std::move(aValueCallback));
+}
+
+HRESULT RegFind::Find(
+    const std::shared_ptr<ByteStream>& location,
+    MatchesMap& matches,
+    FoundKeyMatchCallback aKeyCallback,
+    FoundValueMatchCallback aValueCallback) const
+{
     HRESULT hr = S_OK;
 
     if (location != nullptr)
     {
         RegistryHive Hive;
-        hr = Hive.LoadHive(*location);
+        hr = Hive.LoadHive(*location, m_HiveLoadMode);
         if (hr != S_OK)
         {
             Log::Error(L"Failed RegFind::Find: cannot load hive [{}]", SystemError(hr));
             return hr;
         }
 
-        std::function<void(const RegistryKey* const)> CallbackOnKey = [this,
-                                                                       aKeyCallback](const RegistryKey* const RegKey) {
-            std::vector<std::shared_ptr<RegFind::Match>> result = FindMatch(RegKey);
-            if ((aKeyCallback != nullptr) && (!result.empty()))
-                aKeyCallback(result);
-        };
+        std::function<void(const RegistryKey* const)> CallbackOnKey =
+            [this, &matches, aKeyCallback](const RegistryKey* const RegKey) {
+                std::vector<std::shared_ptr<RegFind::Match>> result = FindMatch(RegKey, matches);
+                if ((aKeyCallback != nullptr) && (!result.empty()))
+                    aKeyCallback(result);
+            };
 
         std::function<void(const RegistryValue* const)> CallBackOnValue =
-            [this, aValueCallback](const RegistryValue* const RegValue) {
-                std::vector<std::shared_ptr<RegFind::Match>> result = FindMatch(RegValue);
+            [this, &matches, aValueCallback](const RegistryValue* const RegValue) {
+                std::vector<std::shared_ptr<RegFind::Match>> result = FindMatch(RegValue, matches);
                 if ((aValueCallback != nullptr) && (!result.empty()))
                     aValueCallback(result);
             };
 
-        if (FAILED(hr = Hive.Walk(CallbackOnKey, CallBackOnValue)))
+        std::function<bool(const RegistryKey* const)> SubKeyFilter;
+        if (IsWalkPruned())
+        {
+            SubKeyFilter = [this](const RegistryKey* const RegKey) {
+                return m_KeyPaths.IsOnPath(RegKey->GetKeyName());
+            };
+        }
+
+        if (m_dwWalkSplitDepth > 0L && aKeyCallback == nullptr && aValueCallback == nullptr)
+        {
+            // Each slot of the walk collects its own matches, merged in walk order once the walk is done
+            std::vector<MatchesMap> slotMatches;
+            hr = Hive.WalkSplit(
+                m_dwWalkSplitDepth,
+                [&slotMatches](size_t slots) { slotMatches.resize(slots); },
+                [this, &slotMatches](size_t slot, const RegistryKey* const RegKey) {
+                    FindMatch(RegKey, slotMatches[slot]);
+                },
+                [this, &slotMatches](size_t slot, const RegistryValue* const RegValue) {
+                    FindMatch(RegValue, slotMatches[slot]);
+                },
+                SubKeyFilter);
+            if (FAILED(hr))
+            {
+                Log::Error(L"Failed RegFind::Find: cannot walk hive [{}]", SystemError(hr));
+                return hr;
+            }
+
+            MergeMatches(slotMatches, matches);
+        }
+        else if (FAILED(hr = Hive.Walk(CallbackOnKey, CallBackOnValue, SubKeyFilter)))
         {
             Log::Error(L"Failed RegFind::Find: cannot walk hive [{}]", SystemError(hr));
             return hr;
@@ -10,9 +10,11 @@
 #include "OrcLib.h"
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include <iterator>
+#include <optional>
 #include <regex>
 
 #include <boost/algorithm/searching/boyer_moore.hpp>
@@ -20,8 +22,10 @@
 #include "RegistryWalker.h"
 #include "ByteStream.h"
 #include "CaseInsensitive.h"
+#include "ContentPatternMatcher.h"
 #include "FileFind.h"
 #include "Text/Tree.h"
+#include "Utils/Regex.h"
 
 #pragma managed(push, off)
 
@@ -81,13 +85,13 @@ public:
         std::wstring m_TermClassName;  // Name of the template from wich this term is issued
 
         std::string m_strKeyName;  // Name of the key
-        std::regex m_regexKeyName;  // regex Name of the key
+        Regex m_regexKeyName;  // regex Name of the key
 
         std::string m_strPathName;  // Name of the key path
-        std::regex m_regexPathName;  // regex path of the key
+        Regex m_regexPathName;  // regex path of the key
 
         std::string m_strValueName;  // Value of the key
-        std::regex m_regexValueName;  // regex Value of the key
+        Regex m_regexValueName;  // regex Value of the key
 
         ValueType m_ValueType;
 
@@ -100,8 +104,12 @@ public:
         CBinaryBuffer m_DataContentContains;
         CBinaryBuffer m_WDataContentContains;
 
-        std::regex m_regexDataContentPattern;
-        std::wregex m_wregexDataContentPattern;
+        // Identifiers of m_DataContentContains and m_WDataContentContains in the matcher of the RegFind
+        std::optional<size_t> m_ContainsPattern;
+        std::optional<size_t> m_WContainsPattern;
+
+        Regex m_regexDataContentPattern;
+        WRegex m_wregexDataContentPattern;
         std::string m_strRegexDataContentPattern;
 
         SearchTerm()
@@ -132,6 +140,8 @@ public:
             std::swap(m_WDataContent, other.m_WDataContent);
             std::swap(m_DataContentContains, other.m_DataContentContains);
             std::swap(m_WDataContentContains, other.m_WDataContentContains);
+            m_ContainsPattern = other.m_ContainsPattern;
+            m_WContainsPattern = other.m_WContainsPattern;
 
             m_ValueType = other.m_ValueType;
             std::swap(m_TermClassName, other.m_TermClassName);
@@ -331,6 +341,31 @@ public:
     typedef std::function<void(const std::vector<std::shared_ptr<Match>>& aMatch)> FoundKeyMatchCallback;
     typedef std::function<void(const std::vector<std::shared_ptr<Match>>& aMatch)> FoundValueMatchCallback;
 
+    // Prefix tree of key paths (case insensitive, by key name): when every search term requires an exact key path,
+    // hive walks only descend into the keys on the way to these paths
+    class KeyPathTrie
+    {
+    public:
+        KeyPathTrie()
+            : m_Nodes(1) {};
+
+        void Add(std::string_view path);
+
+        // 'path' is one of the added paths or one of their parent keys
+        bool IsOnPath(std::string_view path) const;
+
+        bool empty() const { return m_Nodes.front().Children.empty(); }
+
+    private:
+        struct Node
+        {
+            std::unordered_map<std::string, size_t, CaseInsensitiveUnorderedAnsi, CaseInsensitiveUnorderedAnsi>
+                Children;
+        };
+
+        std::vector<Node> m_Nodes;  // root first, children are indexes in m_Nodes
+    };
+
 private:
     typedef std::unordered_multimap<
         std::string,
@@ -406,6 +441,7 @@ private:
         size_t operator()(const std::shared_ptr<SearchTerm>& s) const { return hashSearchTermUnordered(s); }
     };
 
+public:
     typedef std::unordered_multimap<
         std::shared_ptr<SearchTerm>,
         std::shared_ptr<Match>,
@@ -413,13 +449,34 @@ private:
         SearchTermUnordered>
         MatchesMap;
 
+private:
     TermMap m_ExactKeyNameSpecs;
     TermMap m_ExactKeyPathSpecs;
     TermMap m_ExactValueNameSpecs;
     std::vector<std::shared_ptr<SearchTerm>> m_Specs;
 
+    KeyPathTrie m_KeyPaths;
+    bool m_bFullWalk = false;  // a search term without exact key path can match anywhere in the hive
+
     MatchesMap m_Matches;
 
+    // DATA_CONTAINS strings of all the terms, ANSI and UTF-16, searched in a single pass per value: only the terms
+    // whose string was found in the value go through their exact checks. Never modified once compiled, copies of the
+    // RegFind share it.
+    std::shared_ptr<const ContentPatternMatcher> m_ContainsMatcher;
+
+    HRESULT AddTerm(const std::shared_ptr<SearchTerm>& MatchSpec);
+    void CompileContainsTerms();
+
+    // 'aTerm' could match 'RegValue' according to the strings found by 'scan' (which is fed on the first call)
+    bool IsContainsCandidate(
+        const std::shared_ptr<SearchTerm>& aTerm,
+        const RegistryValue* const RegValue,
+        std::optional<ContentPatternMatcher::Scan>& scan) const;
+
+    RegistryHive::LoadMode m_HiveLoadMode = RegistryHive::LoadMode::Read;
+    DWORD m_dwWalkSplitDepth = 0L;
+
     // Name specs: Only depend on KeyName (aka ShotKeyName)
     SearchTerm::Criteria ExactKeyName(const std::shared_ptr<SearchTerm>& aTerm, const RegistryKey* const Regkey) const;
     SearchTerm::Criteria RegexKeyName(const std::shared_ptr<SearchTerm>& aTerm, const RegistryKey* const Regkey) const;
@@ -483,8 +540,12 @@ private:
         std::shared_ptr<Match>& aMatch,
         const RegistryValue* const RegValue) const;
 
-    const std::vector<std::shared_ptr<Match>> FindMatch(const RegistryKey* const RegKey);
-    const std::vector<std::shared_ptr<Match>> FindMatch(const RegistryValue* const RegValue);
+    const std::vector<std::shared_ptr<Match>> FindMatch(const RegistryKey* const RegKey, MatchesMap& matches) const;
+    const std::vector<std::shared_ptr<Match>>
+    FindMatch(const RegistryValue* const RegValue, MatchesMap& matches) const;
+
+    // Append the matches of each slot of a split walk to 'matches', in slot order
+    static void MergeMatches(std::vector<MatchesMap>& slotMatches, MatchesMap& matches);
 
     static ValueType GetRegistryValueType(LPCWSTR szValueType);
 
@@ -502,6 +563,25 @@ public:
         FoundKeyMatchCallback aKeyCallback,
         FoundValueMatchCallback aValueCallback);
 
+    // Search 'location' collecting its matches into 'matches' instead of Matches(): once the search terms are added,
+    // several hives can be searched at the same time, each with its own 'matches'
+    HRESULT Find(
+        const std::shared_ptr<ByteStream>& location,
+        MatchesMap& matches,
+        FoundKeyMatchCallback aKeyCallback,
+        FoundValueMatchCallback aValueCallback) const;
+
+    RegistryHive::LoadMode HiveLoadMode() const { return m_HiveLoadMode; }
+    void SetHiveLoadMode(RegistryHive::LoadMode mode) { m_HiveLoadMode = mode; }
+
+    // Walk the subtrees below the first 'dwDepth' levels of a hive in parallel (0: single threaded walk). Matches are
+    // listed as a single threaded walk lists them. Only searches without callbacks are split.
+    DWORD WalkSplitDepth() const { return m_dwWalkSplitDepth; }
+    void SetWalkSplitDepth(DWORD dwDepth) { m_dwWalkSplitDepth = dwDepth; }
+
+    // Hive walks are pruned to the exact key paths of the search terms
+    bool IsWalkPruned() const { return !m_bFullWalk && !m_KeyPaths.empty(); }
+
     const MatchesMap& Matches() const { return m_Matches; }
     void ClearMatches() { m_Matches.clear(); }
 
@@ -9,40 +9,107 @@
 
 #include "RegistryWalker.h"
 
+#include "FileStream.h"
+#include "TaskPool.h"
+
 using namespace Orc;
 
+namespace {
+
+// Largest data block of a big data segment
+constexpr DWORD kBigDataSegmentSize = 16344;
+
+// Number of keys between 'pKey' and the root key
+DWORD KeyDepth(const RegistryKey* pKey)
+{
+    DWORD dwDepth = 0L;
+    while ((pKey = pKey->GetParentKey()) != nullptr)
+        dwDepth++;
+    return dwDepth;
+}
+
+void CheckSeenSubKeys(const RegistryKey* const pKey)
+{
+    if (pKey->GetSubKeysCount() != pKey->GetSeenSubKeysCount())
+        Log::Debug(
+            "Key '{}': number of subkeys parsed is different from number of subkeys announced.({} announced, "
+            "{} parsed)",
+            pKey->GetKeyName(),
+            pKey->GetSubKeysCount(),
+            pKey->GetSeenSubKeysCount());
+}
+
+}  // namespace
+
 RegistryValue::RegistryValue(
-    std::string&& ValueName,
+    const RegistryHive& Hive,
+    const ValueHeader* const pHeader,
     const RegistryKey* const ParentKey,
-    ValueType Type,
-    const BYTE* const pDatas,
-    DWORD DatasLen,
-    WORD wFlags,
     bool bDataIsResident)
-    : m_ParentKey(ParentKey)
-    , m_Type(Type)
-    , m_pDatas(pDatas)
-    , m_DatasLen(DatasLen)
-    , m_wFlags(wFlags)
+    : m_Hive(Hive)
+    , m_pHeader(pHeader)
     , m_bDataIsResident(bDataIsResident)
+    , m_ParentKey(ParentKey)
 {
-    m_strValueName = std::move(ValueName);
 }
 
 ValueType RegistryValue::GetType() const
 {
-    return m_Type;
+    return m_pHeader->Type;
+}
+
+WORD RegistryValue::GetFlags() const
+{
+    return m_pHeader->Flag;
+}
+
+std::string_view RegistryValue::GetValueNameView() const
+{
+    return std::string_view(m_pHeader->Name, m_pHeader->NameLength);
 }
 
 const std::string& RegistryValue::GetValueName() const
 {
-    return m_strValueName;
+    if (!m_strValueName)
+        m_strValueName.emplace(GetValueNameView());
+
+    return *m_strValueName;
 }
 
 size_t RegistryValue::GetDatas(const BYTE** const pDatas) const
 {
-    *pDatas = m_pDatas;
-    return m_DatasLen;
+    if (!m_bDataIsResident)
+    {
+        *pDatas = nullptr;
+        return m_pHeader->DataLength;
+    }
+
+    // Check for in place datas
+    if (m_pHeader->DataLength & 0x80000000)
+    {
+        *pDatas = reinterpret_cast<const BYTE*>(&m_pHeader->OffsetToData);
+        return m_pHeader->DataLength ^ 0x80000000;
+    }
+
+    if (m_Hive.IsBigData(m_pHeader))
+    {
+        if (!m_BigData)
+        {
+            m_BigData.emplace();
+            if (auto hr = m_Hive.ReadBigData(m_pHeader, *m_BigData); FAILED(hr))
+            {
+                Log::Debug("Value '{}': failed to read big data [{}]", GetValueNameView(), SystemError(hr));
+                m_BigData->clear();
+            }
+        }
+
+        *pDatas = m_BigData->empty() ? nullptr : m_BigData->data();
+        return m_BigData->size();
+    }
+
+    const auto pDataHeader = reinterpret_cast<const DataHeader*>(m_Hive.FixOffset(m_pHeader->OffsetToData));
+    *pDatas = pDataHeader->Data;
+    return m_pHeader->DataLength;
 }
 
 const RegistryKey* RegistryValue::GetParentKey() const
@@ -227,28 +294,10 @@ bool RegistryHive::IsHiveComplete() const
     return m_bIsComplete;
 }
 
-HRESULT RegistryHive::LoadHive(ByteStream& HiveStream)
+HRESULT RegistryHive::ReadHive(ByteStream& HiveStream)
 {
-
     HRESULT hr = E_FAIL;
-
-    if ((hr = HiveStream.IsOpen()) != S_OK)
-    {
-        Log::Error("Hive stream seems to be closed");
-        return hr;
-    }
-    if ((hr = HiveStream.CanRead()) != S_OK)
-    {
-        Log::Error("Can't read hive stream");
-        return hr;
-    }
-
     ULONG64 ulSize = HiveStream.GetSize();
-    if (ulSize == 0)
-    {
-        Log::Error("Hive size is 0");
-        return E_FAIL;
-    }
 
     m_pHiveBuffer = (BYTE*)malloc((size_t)ulSize);
     if (m_pHiveBuffer == NULL)
@@ -268,27 +317,120 @@ HRESULT RegistryHive::LoadHive(ByteStream& HiveStream)
         if (ulTmp == 0)
         {
             Log::Error("Read error, aborting read operation");
-            free(m_pHiveBuffer);
-            m_pHiveBuffer = nullptr;
-            m_ulHiveBufferSize = 0LL;
+            UnloadHive();
             return hr;
         }
         ulRead += ulTmp;
     }
-    if ((hr = ParseHiveHeader()) != S_OK)
+    return S_OK;
+}
+
+HRESULT RegistryHive::MapHive(ByteStream& HiveStream)
+{
+    HRESULT hr = E_FAIL;
+    ULONG64 ulSize = HiveStream.GetSize();
+
+    if (auto pFileStream = dynamic_cast<FileStream*>(&HiveStream); pFileStream != nullptr)
+    {
+        m_hHiveMapping = CreateFileMapping(pFileStream->GetHandle(), NULL, PAGE_READONLY, 0L, 0L, NULL);
+        if (m_hHiveMapping == NULL)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to create hive mapping for '{}' [{}]", pFileStream->Path(), SystemError(hr));
+            return hr;
+        }
+
+        m_pHiveBuffer = (BYTE*)MapViewOfFile(m_hHiveMapping, FILE_MAP_READ, 0L, 0L, 0L);
+        if (m_pHiveBuffer == nullptr)
+        {
+            hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to map hive '{}' [{}]", pFileStream->Path(), SystemError(hr));
+            UnloadHive();
+            return hr;
+        }
+        m_ulHiveBufferSize = ulSize;
+        return S_OK;
+    }
+
+    auto pView = std::make_unique<PagedStreamView>();
+    if (FAILED(hr = pView->Open(HiveStream)))
+    {
+        Log::Error("Failed to open paged view on hive stream [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_pHiveBuffer = pView->Data();
+    m_ulHiveBufferSize = pView->Size();
+    m_pPagedView = std::move(pView);
+    return S_OK;
+}
+
+void RegistryHive::UnloadHive()
+{
+    if (m_pPagedView)
+    {
+        if (FAILED(m_pPagedView->LastError()))
+        {
+            Log::Error("Failed to read part of the hive [{}]", SystemError(m_pPagedView->LastError()));
+        }
+        m_pPagedView.reset();
+    }
+    else if (m_hHiveMapping != NULL)
+    {
+        if (m_pHiveBuffer != nullptr)
+            UnmapViewOfFile(m_pHiveBuffer);
+        CloseHandle(m_hHiveMapping);
+        m_hHiveMapping = NULL;
+    }
+    else if (m_pHiveBuffer != nullptr)
     {
         free(m_pHiveBuffer);
-        m_pHiveBuffer = nullptr;
-        m_ulHiveBufferSize = 0L;
+    }
+
+    m_pHiveBuffer = nullptr;
+    m_ulHiveBufferSize = 0LL;
+}
+
+HRESULT RegistryHive::LoadHive(ByteStream& HiveStream, LoadMode mode)
+{
+
+    HRESULT hr = E_FAIL;
+
+    if ((hr = HiveStream.IsOpen()) != S_OK)
+    {
+        Log::Error("Hive stream seems to be closed");
+        return hr;
+    }
+    if ((hr = HiveStream.CanRead()) != S_OK)
+    {
+        Log::Error("Can't read hive stream");
+        return hr;
+    }
+
+    ULONG64 ulSize = HiveStream.GetSize();
+    if (ulSize == 0)
+    {
+        Log::Error("Hive size is 0");
+        return E_FAIL;
+    }
+
+    UnloadHive();
+
+    if ((hr = mode == LoadMode::Map ? MapHive(HiveStream) : ReadHive(HiveStream)) != S_OK)
+    {
+        return hr;
+    }
+
+    if ((hr = ParseHiveHeader()) != S_OK)
+    {
+        UnloadHive();
         Log::Error("Error during hive header parsing [{}]", SystemError(hr));
         return hr;
     }
 
     if ((hr = ParseHBinHeader()) != S_OK)
     {
-        free(m_pHiveBuffer);
-        m_pHiveBuffer = nullptr;
-        m_ulHiveBufferSize = 0;
+        UnloadHive();
         Log::Error("Error during hive hbin header parsing [{}]", SystemError(hr));
         return hr;
     }
@@ -564,6 +706,57 @@ HRESULT RegistryHive::CheckDataHeader(const BlockHeader* const pHeader) const
     return S_OK;
 }
 
+bool RegistryHive::IsBigData(const ValueHeader* const pHeader) const
+{
+    if (m_dwMinorVersion < 4 || (pHeader->DataLength & 0x80000000) || pHeader->DataLength <= kBigDataSegmentSize)
+        return false;
+
+    const auto pBigData = reinterpret_cast<const BigDataHeader*>(FixOffset(pHeader->OffsetToData));
+    return !strncmp(pBigData->Signature, "db", 2);
+}
+
+HRESULT RegistryHive::ReadBigData(const ValueHeader* const pHeader, std::vector<BYTE>& data) const
+{
+    HRESULT hr = E_FAIL;
+
+    const auto pBigData = reinterpret_cast<const BigDataHeader*>(FixOffset(pHeader->OffsetToData));
+    if ((hr = CheckDataHeader(&pBigData->Header)) != S_OK)
+        return hr;
+
+    if (!IsOffsetValid(pBigData->OffsetToSegmentList))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    const auto pSegments = reinterpret_cast<const SegmentsArray*>(FixOffset(pBigData->OffsetToSegmentList));
+    if ((hr = CheckDataHeader(&pSegments->Header)) != S_OK)
+        return hr;
+
+    if (sizeof(BlockHeader) + pBigData->NumberOfSegments * sizeof(DWORD) > (size_t)(-(int)pSegments->Header.BlockSize))
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    data.reserve(pHeader->DataLength);
+    for (WORD i = 0; i < pBigData->NumberOfSegments && data.size() < pHeader->DataLength; i++)
+    {
+        if (!IsOffsetValid(pSegments->SegmentOffsets[i]))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        const auto pSegment = reinterpret_cast<const DataHeader*>(FixOffset(pSegments->SegmentOffsets[i]));
+        if ((hr = CheckDataHeader(&pSegment->Header)) != S_OK)
+            return hr;
+
+        const auto dwLength =
+            std::min<DWORD>(kBigDataSegmentSize, pHeader->DataLength - static_cast<DWORD>(data.size()));
+        if (sizeof(BlockHeader) + dwLength > (size_t)(-(int)pSegment->Header.BlockSize))
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+        data.insert(std::end(data), pSegment->Data, pSegment->Data + dwLength);
+    }
+
+    if (data.size() != pHeader->DataLength)
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+    return S_OK;
+}
+
 HRESULT RegistryHive::ParseValues(
     RegistryKey* const pCurrentKey,
     std::function<void(const RegistryValue* const)> RegistryValueCallback)
@@ -605,51 +798,19 @@ HRESULT RegistryHive::ParseValues(
 
         if ((hr = CheckVkHeader(pCurrentValue, &bIsDataResident)) == S_OK)
         {
-            WORD wNameLen, wFlag;
-            ValueType Type;
-            const DataHeader* pDataHeader;
-            DWORD dwDatasLen;
-
-            wNameLen = pCurrentValue->NameLength;
-            std::string Name(pCurrentValue->Name, wNameLen);
-
-            BYTE* pData = nullptr;
-            dwDatasLen = pCurrentValue->DataLength;
-            if (bIsDataResident)
+            // Datas is too large to fit, using an offset: only the block is checked here, the value decodes it
+            if (bIsDataResident && !(pCurrentValue->DataLength & 0x80000000))
             {
-                // Check for in place datas
-                if (pCurrentValue->DataLength & 0x80000000)
-                {
-                    pData = (BYTE*)&(pCurrentValue->OffsetToData);
-                    dwDatasLen = pCurrentValue->DataLength ^ 0x80000000;
-                }
-                // Datas is too large to fit, using an offset
-                else
+                const DataHeader* pDataHeader = (DataHeader*)FixOffset(pCurrentValue->OffsetToData);
+                if ((hr = CheckDataHeader(&pDataHeader->Header)) != S_OK)
                 {
-                    pDataHeader = (DataHeader*)FixOffset(pCurrentValue->OffsetToData);
-                    if ((hr = CheckDataHeader(&pDataHeader->Header)) != S_OK)
-                    {
-                        Log::Debug("Key '{}': Value data header is invalid", pCurrentKey->GetKeyName());
-                        continue;
-                    }
-                    pData = (BYTE*)&(pDataHeader->Data);
-                    if (dwDatasLen != (DWORD)(-(int)pDataHeader->Header.BlockSize))
-                    {
-                        Log::Debug(
-                            "Keys '{}': size mismatch for data inside value '{}'", pCurrentKey->GetKeyName(), Name);
-                    }
+                    Log::Debug("Key '{}': Value data header is invalid", pCurrentKey->GetKeyName());
+                    continue;
                 }
             }
 
-            wFlag = pCurrentValue->Flag;
-            Type = pCurrentValue->Type;
-
-            const RegistryValue* const CurrentRegValue =
-                new RegistryValue(std::move(Name), pCurrentKey, Type, pData, dwDatasLen, wFlag, bIsDataResident);
-
-            RegistryValueCallback(CurrentRegValue);
-
-            delete CurrentRegValue;
+            const RegistryValue CurrentRegValue(*this, pCurrentValue, pCurrentKey, bIsDataResident);
+            RegistryValueCallback(&CurrentRegValue);
         }
         else
         {
@@ -1001,6 +1162,7 @@ HRESULT RegistryHive::ParseHiveHeader()
     }
 
     m_pLastModificationTime = &pRegFile->LastModificationDate;
+    m_dwMinorVersion = pRegFile->Reserved_Always3;  // minor version of the format, big data appeared with 1.4
 
     return S_OK;
 }
@@ -1027,12 +1189,8 @@ HRESULT RegistryHive::ParseHBinHeader()
     return S_OK;
 }
 
-HRESULT RegistryHive::Walk(
-    std::function<void(const RegistryKey* const)> RegistryKeyCallBack,
-    std::function<void(const RegistryValue* const)> RegistryValueCallback)
+HRESULT RegistryHive::NewRootKey(RegistryKey** ppRootKey) const
 {
-    HRESULT hr = E_FAIL;
-
     bool bSubkeyListIsResident;
     bool bValueListIsResident;
     bool bSkHeaderIsResident;
@@ -1078,7 +1236,7 @@ HRESULT RegistryHive::Walk(
     std::string ShortName(pRegKey->Name, pRegKey->NameLength);
 
     // Build rootkey
-    RegistryKey* const RootKeyRegistryKey = new RegistryKey(
+    *ppRootKey = new RegistryKey(
         std::move(Name),
         std::move(ShortName),
         std::move(ClassName),
@@ -1093,25 +1251,72 @@ HRESULT RegistryHive::Walk(
         bSkHeaderIsResident,
         bHasClassName);
 
-    std::vector<RegistryKey*> CurrentKeySet;
-    CurrentKeySet.push_back(RootKeyRegistryKey);
+    return S_OK;
+}
+
+void RegistryHive::ParseSubKeys(
+    RegistryKey* const pKey,
+    std::vector<RegistryKey*>& KeySet,
+    const std::function<bool(const RegistryKey* const)>& SubKeyFilter)
+{
+    const auto firstSubKey = KeySet.size();
+    if (ParseNks(pKey, KeySet) != S_OK)
+    {
+        Log::Debug("Error during parsing of '{}' subkeys", pKey->GetKeyName());
+    }
+
+    if (!SubKeyFilter)
+        return;
+
+    // Filtered out subkeys are accounted as seen, their subtree is never parsed
+    auto kept = KeySet.begin() + firstSubKey;
+    for (auto it = kept; it != KeySet.end(); ++it)
+    {
+        if (SubKeyFilter(*it))
+        {
+            *kept++ = *it;
+            continue;
+        }
+
+        pKey->IncrementSubKeysSeenCount();
+        delete *it;
+    }
+    KeySet.erase(kept, KeySet.end());
+}
+
+void RegistryHive::TreatKey(
+    RegistryKey* const pKey,
+    const std::function<void(const RegistryKey* const)>& RegistryKeyCallBack,
+    const std::function<void(const RegistryValue* const)>& RegistryValueCallback)
+{
+    if (ParseValues(pKey, RegistryValueCallback) != S_OK)
+    {
+        Log::Debug("Error during parsing of '{}' values", pKey->GetKeyName());
+    }
+    // Set key as treated!
+
+    pKey->SetAsTreated();
+    // call key callback
+    RegistryKeyCallBack(pKey);
+}
+
+HRESULT RegistryHive::WalkKeys(
+    std::vector<RegistryKey*>& KeySet,
+    const RegistryKey* const pSubtreeRoot,
+    const std::function<void(const RegistryKey* const)>& RegistryKeyCallBack,
+    const std::function<void(const RegistryValue* const)>& RegistryValueCallback,
+    const std::function<bool(const RegistryKey* const)>& SubKeyFilter)
+{
     RegistryKey* CurrentKey;
-    while (!CurrentKeySet.empty())
+    while (!KeySet.empty())
     {
-        CurrentKey = CurrentKeySet.back();
+        CurrentKey = KeySet.back();
 
         // check if this key as already been treated
         if (CurrentKey->GetKeyStatus())
         {
-            CurrentKeySet.pop_back();
-            if (CurrentKey->GetSubKeysCount() != CurrentKey->GetSeenSubKeysCount())
-                Log::Debug(
-                    "Key '{}': number of subkeys parsed is different from number of subkeys announced.({} announced, "
-                    "{} parsed)",
-                    CurrentKey->GetKeyName(),
-                    CurrentKey->GetSubKeysCount(),
-                    CurrentKey->GetSeenSubKeysCount());
-
+            KeySet.pop_back();
+            CheckSeenSubKeys(CurrentKey);
             delete CurrentKey;
             continue;
         }
@@ -1119,22 +1324,112 @@ HRESULT RegistryHive::Walk(
         RegistryKey* const pParentKey = CurrentKey->GetAlterableParentKey();
 
         // Increment counter of treated subkeys
+        if (pParentKey != nullptr && CurrentKey != pSubtreeRoot)
+            pParentKey->IncrementSubKeysSeenCount();
+
+        ParseSubKeys(CurrentKey, KeySet, SubKeyFilter);
+        TreatKey(CurrentKey, RegistryKeyCallBack, RegistryValueCallback);
+    }
+    return S_OK;
+}
+
+HRESULT RegistryHive::Walk(
+    std::function<void(const RegistryKey* const)> RegistryKeyCallBack,
+    std::function<void(const RegistryValue* const)> RegistryValueCallback,
+    std::function<bool(const RegistryKey* const)> SubKeyFilter)
+{
+    HRESULT hr = E_FAIL;
+
+    RegistryKey* RootKeyRegistryKey = nullptr;
+    if ((hr = NewRootKey(&RootKeyRegistryKey)) != S_OK)
+        return hr;
+
+    std::vector<RegistryKey*> CurrentKeySet;
+    CurrentKeySet.push_back(RootKeyRegistryKey);
+    return WalkKeys(CurrentKeySet, nullptr, RegistryKeyCallBack, RegistryValueCallback, SubKeyFilter);
+}
+
+HRESULT RegistryHive::WalkSplit(
+    DWORD dwSplitDepth,
+    std::function<void(size_t)> SlotsCallback,
+    std::function<void(size_t, const RegistryKey* const)> RegistryKeyCallBack,
+    std::function<void(size_t, const RegistryValue* const)> RegistryValueCallback,
+    std::function<bool(const RegistryKey* const)> SubKeyFilter)
+{
+    HRESULT hr = E_FAIL;
+
+    // A paged view brings hbins in on the thread touching them
+    if (dwSplitDepth == 0L || m_pPagedView != nullptr)
+    {
+        SlotsCallback(1);
+        return Walk(
+            [&RegistryKeyCallBack](const RegistryKey* const pKey) { RegistryKeyCallBack(0, pKey); },
+            [&RegistryValueCallback](const RegistryValue* const pValue) { RegistryValueCallback(0, pValue); },
+            SubKeyFilter);
+    }
+
+    RegistryKey* RootKeyRegistryKey = nullptr;
+    if ((hr = NewRootKey(&RootKeyRegistryKey)) != S_OK)
+        return hr;
+
+    // Keys above the split are parsed here in the order Walk reaches them, and are deleted once all the slots are
+    // walked: their subkeys keep a pointer to them. Keys at the split are accounted here too, their task only walks
+    // their subtree.
+    struct Slot
+    {
+        RegistryKey* Key;
+        bool bSubtree;
+    };
+    std::vector<Slot> slots;
+
+    std::vector<RegistryKey*> CurrentKeySet;
+    CurrentKeySet.push_back(RootKeyRegistryKey);
+    while (!CurrentKeySet.empty())
+    {
+        RegistryKey* const CurrentKey = CurrentKeySet.back();
+        CurrentKeySet.pop_back();
+
+        RegistryKey* const pParentKey = CurrentKey->GetAlterableParentKey();
         if (pParentKey != nullptr)
             pParentKey->IncrementSubKeysSeenCount();
 
-        if ((hr = ParseNks(CurrentKey, CurrentKeySet)) != S_OK)
+        if (KeyDepth(CurrentKey) == dwSplitDepth)
         {
-            Log::Debug("Error during parsing of '{}' subkeys", CurrentKey->GetKeyName());
+            slots.push_back({CurrentKey, true});
+            continue;
         }
-        if ((hr = ParseValues(CurrentKey, RegistryValueCallback)) != S_OK)
+
+        ParseSubKeys(CurrentKey, CurrentKeySet, SubKeyFilter);
+        slots.push_back({CurrentKey, false});
+    }
+
+    Log::Debug(L"Hive '{}': walking {} slots split at depth {}", m_strHiveName, slots.size(), dwSplitDepth);
+    SlotsCallback(slots.size());
+
+    TaskPool::ParallelFor(TaskPool::Subsystem::Walk, size_t(0), slots.size(), [&](size_t i) {
+        const std::function<void(const RegistryKey* const)> keyCallback =
+            [&RegistryKeyCallBack, i](const RegistryKey* const pKey) { RegistryKeyCallBack(i, pKey); };
+        const std::function<void(const RegistryValue* const)> valueCallback =
+            [&RegistryValueCallback, i](const RegistryValue* const pValue) { RegistryValueCallback(i, pValue); };
+
+        if (!slots[i].bSubtree)
         {
-            Log::Debug("Error during parsing of '{}' values", CurrentKey->GetKeyName());
+            TreatKey(slots[i].Key, keyCallback, valueCallback);
+            return;
         }
-        // Set key as treated!
 
-        CurrentKey->SetAsTreated();
-        // call key callback
-        RegistryKeyCallBack(CurrentKey);
+        std::vector<RegistryKey*> SubtreeKeySet;
+        SubtreeKeySet.push_back(slots[i].Key);
+        WalkKeys(SubtreeKeySet, slots[i].Key, keyCallback, valueCallback, SubKeyFilter);
+    });
+
+    for (auto it = slots.rbegin(); it != slots.rend(); ++it)
+    {
+        if (it->bSubtree)
+            continue;
+
+        CheckSeenSubKeys(it->Key);
+        delete it->Key;
     }
     return S_OK;
 }
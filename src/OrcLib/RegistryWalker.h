@@ -12,8 +12,12 @@
 #include <string>
 #include <functional>
 #include <algorithm>
+#include <memory>
+#include <optional>
+#include <string_view>
 
 #include "ByteStream.h"
+#include "PagedStreamView.h"
 
 #pragma managed(push, off)
 
@@ -171,6 +175,26 @@ struct ValueHeader
     CHAR Name[1];  // 0x0014	????	Name
 };
 
+// The "db"-record (hives 1.4 and later)
+//=================
+// Data of more than 16344 bytes is split in segments: the value points to this record, which points to the list of
+// the offsets of the segments. Each segment is a data block of up to 16344 bytes.
+
+struct BigDataHeader
+{
+    BlockHeader Header;
+    // Offset	Size	Contents
+    char Signature[2];  // 0x0000	Word	ID: ASCII-"db" = 0x6264
+    WORD NumberOfSegments;  // 0x0002	Word	number of segments
+    DWORD OffsetToSegmentList;  // 0x0004	D-Word	Offset of the list of segment offsets
+};
+
+struct SegmentsArray
+{
+    BlockHeader Header;
+    DWORD SegmentOffsets[1];
+};
+
 // Hash-Record
 //===========
 // Keep in mind, that the value at 0x0004 is used for checking the
@@ -236,30 +260,39 @@ struct SKHeader
 #pragma pack(pop)
 
 class RegistryKey;
+class RegistryHive;
 
+// View of a vk record in the hive buffer, only valid during the value callback: the name is copied to a string and
+// the segments of big data are reassembled the first time they are asked for, values rejected on their key or type
+// cost no allocation
 class RegistryValue
 {
 private:
-    const BYTE* const m_pDatas;
-    DWORD m_DatasLen;
+    const RegistryHive& m_Hive;
+    const ValueHeader* const m_pHeader;
     bool m_bDataIsResident;
 
-    ValueType m_Type;
-    WORD m_wFlags;
-    std::string m_strValueName;
     const RegistryKey* const m_ParentKey;
 
+    mutable std::optional<std::string> m_strValueName;
+    mutable std::optional<std::vector<BYTE>> m_BigData;
+
 public:
     RegistryValue(
-        std::string&& ValueName,
+        const RegistryHive& Hive,
+        const ValueHeader* const pHeader,
         const RegistryKey* const ParentKey,
-        ValueType Type,
-        const BYTE* const Datas,
-        DWORD DatasLen,
-        WORD Flags,
         bool bDataIsResident);
+
+    RegistryValue(const RegistryValue&) = delete;
+
     ValueType GetType() const;
+    WORD GetFlags() const;
+
+    // Name in the hive buffer, without any copy
+    std::string_view GetValueNameView() const;
     const std::string& GetValueName() const;
+
     size_t GetDatas(const BYTE** const pDatas) const;
     const RegistryKey* GetParentKey() const;
     bool IsDataResident() const;
@@ -267,13 +300,27 @@ public:
 
 class RegistryHive
 {
+    friend class RegistryValue;
+
+public:
+    // How LoadHive makes the hive content available to the parser
+    enum class LoadMode
+    {
+        Read,  // the whole hive is read in memory before parsing
+        Map  // file streams are memory mapped, other streams are paged in as the parser touches their hbins
+    };
+
 private:
     BYTE* m_pHiveBuffer;
     ULONG64 m_ulHiveBufferSize;
 
+    HANDLE m_hHiveMapping = NULL;
+    std::unique_ptr<PagedStreamView> m_pPagedView;
+
     FILETIME* m_pLastModificationTime;
     DWORD m_dwRootKeyOffset;
     DWORD m_dwDataBlockSize;
+    DWORD m_dwMinorVersion = 0L;
     bool m_bIsComplete;
 
     std::wstring m_strHiveName;
@@ -290,6 +337,29 @@ private:
 
     HRESULT
     ParseValues(RegistryKey* const pRegistryKey, std::function<void(const RegistryValue* const)> RegistryValueCallback);
+
+    HRESULT NewRootKey(RegistryKey** ppRootKey) const;
+
+    // Push the subkeys of 'pKey' kept by 'SubKeyFilter' on 'KeySet'
+    void ParseSubKeys(
+        RegistryKey* const pKey,
+        std::vector<RegistryKey*>& KeySet,
+        const std::function<bool(const RegistryKey* const)>& SubKeyFilter);
+
+    // Parse the values of 'pKey' then call the key callback
+    void TreatKey(
+        RegistryKey* const pKey,
+        const std::function<void(const RegistryKey* const)>& RegistryKeyCallBack,
+        const std::function<void(const RegistryValue* const)>& RegistryValueCallback);
+
+    // Depth first walk of the keys of 'KeySet' and their subkeys: 'pSubtreeRoot' was already accounted by its parent
+    HRESULT WalkKeys(
+        std::vector<RegistryKey*>& KeySet,
+        const RegistryKey* const pSubtreeRoot,
+        const std::function<void(const RegistryKey* const)>& RegistryKeyCallBack,
+        const std::function<void(const RegistryValue* const)>& RegistryValueCallback,
+        const std::function<bool(const RegistryKey* const)>& SubKeyFilter);
+
     HRESULT ParseNks(RegistryKey* const ParentKey, std::vector<RegistryKey*>& CurrentKeySet);
     HRESULT ParseLfLh(
         LF_LH_Header* const plfLhHeader,
@@ -320,31 +390,50 @@ private:
 
     HRESULT CheckDataHeader(const BlockHeader* const pHeader) const;
 
+    // From hives 1.4, data larger than a segment is stored in a "db" record and reassembled in 'data'
+    bool IsBigData(const ValueHeader* const pHeader) const;
+    HRESULT ReadBigData(const ValueHeader* const pHeader, std::vector<BYTE>& data) const;
+
     void SetHiveIsNotComplete();
 
+    HRESULT ReadHive(ByteStream& HiveStream);
+    HRESULT MapHive(ByteStream& HiveStream);
+    void UnloadHive();
+
 public:
     RegistryHive(const std::wstring& HiveName);
     RegistryHive();
 
-    HRESULT LoadHive(ByteStream& HiveStream);
+    // With LoadMode::Map, HiveStream must outlive the hive when it is not a file stream (it backs the paged view)
+    HRESULT LoadHive(ByteStream& HiveStream, LoadMode mode = LoadMode::Read);
+
+    // Subkeys for which 'SubKeyFilter' returns false are skipped with their whole subtree
     HRESULT Walk(
         std::function<void(const RegistryKey* const)> RegistryKeyCallBack,
-        std::function<void(const RegistryValue* const)> RegistryValueCallback);
+        std::function<void(const RegistryValue* const)> RegistryValueCallback,
+        std::function<bool(const RegistryKey* const)> SubKeyFilter = nullptr);
+
+    // Walk with the subtrees below the first 'dwSplitDepth' levels walked by parallel tasks of the TaskPool: the hive
+    // buffer is only read once loaded. Each key above the split and each subtree at the split is a slot, numbered in
+    // the order Walk reaches them. 'SlotsCallback' gets the number of slots before any other callback, the callbacks
+    // of a slot are called by one task at a time and different slots run concurrently. Hives paged in as they are
+    // parsed (LoadMode::Map on a stream which is not a file) are walked by the calling thread in a single slot.
+    HRESULT WalkSplit(
+        DWORD dwSplitDepth,
+        std::function<void(size_t)> SlotsCallback,
+        std::function<void(size_t, const RegistryKey* const)> RegistryKeyCallBack,
+        std::function<void(size_t, const RegistryValue* const)> RegistryValueCallback,
+        std::function<bool(const RegistryKey* const)> SubKeyFilter = nullptr);
+
     bool IsHiveComplete() const;
 
-    ~RegistryHive()
-    {
-        if (m_pHiveBuffer != nullptr)
-            free(m_pHiveBuffer);
-    };
+    ~RegistryHive() { UnloadHive(); };
 };
 
 class RegistryKey
 {
 
-    friend HRESULT RegistryHive::Walk(
-        std::function<void(const RegistryKey* const)> RegistryKeyCallBack,
-        std::function<void(const RegistryValue* const)> RegistryValueCallback);
+    friend class RegistryHive;
 
 private:
     RegistryKey* GetAlterableParentKey();
@@ -0,0 +1,229 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutputBatch.h"
+#include "StructuredOutput.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#include "Log/Log.h"
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+/// <summary>
+///     Hands the items of parallel producers over to a single threaded sink in a deterministic order.
+///
+///     Producers take a sequence number with NextSequence() in the order the output must have (usually when the work
+///     is scheduled), then Push() the item, or Skip() the number when there is nothing to write. Items are kept in a
+///     buffer until all the previous ones were written: the thread pushing the awaited item writes it along with the
+///     following ready ones, the sink is never called concurrently.
+///
+///     The buffer is bounded by the window: a producer pushing an item 'window' numbers or more ahead of the next one
+///     to be written waits for the sink to catch up. The producer of the awaited item must not wait for the producers
+///     of the later ones, each number taken must be pushed or skipped.
+///
+///     Mode::Unordered writes the items as soon as they are pushed, which is the fastest when the order does not
+///     matter: sequence numbers are then ignored.
+/// </summary>
+template <typename T>
+class ReorderBuffer
+{
+public:
+    static constexpr size_t kDefaultWindow = 1024;
+
+    enum class Mode
+    {
+        Ordered,
+        Unordered
+    };
+
+    using Sink = std::function<HRESULT(T&& item)>;
+
+    struct Statistics
+    {
+        ULONGLONG Written = 0LL;
+        ULONGLONG Skipped = 0LL;
+        size_t PeakPending = 0;
+        ULONGLONG Waits = 0LL;  // pushes which waited for the window
+    };
+
+    ReorderBuffer(Sink sink, size_t window = kDefaultWindow, Mode mode = Mode::Ordered)
+        : m_sink(std::move(sink))
+        , m_window(window ? window : kDefaultWindow)
+        , m_mode(mode)
+    {
+    }
+
+    ReorderBuffer(const ReorderBuffer&) = delete;
+    ReorderBuffer& operator=(const ReorderBuffer&) = delete;
+
+    Mode GetMode() const { return m_mode; }
+    size_t Window() const { return m_window; }
+
+    uint64_t NextSequence() { return m_sequence.fetch_add(1, std::memory_order_relaxed); }
+
+    HRESULT Push(uint64_t sequence, T&& item) { return Insert(sequence, std::optional<T>(std::move(item))); }
+    HRESULT Skip(uint64_t sequence) { return Insert(sequence, std::nullopt); }
+
+    // Write the items left once the producers are done: the numbers never pushed nor skipped are ignored
+    HRESULT Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_drained.wait(lock, [this]() { return !m_bDraining; });
+
+        if (!m_pending.empty())
+        {
+            Log::Warn(
+                "Reorder buffer flushed with {} items pending (first missing sequence number: {})",
+                m_pending.size(),
+                m_next);
+        }
+
+        while (!m_pending.empty())
+        {
+            auto node = m_pending.extract(std::begin(m_pending));
+            m_next = node.key() + 1;
+            Write(node.mapped());
+        }
+
+        m_canPush.notify_all();
+        return m_hr;
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+private:
+    HRESULT Insert(uint64_t sequence, std::optional<T>&& item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (m_mode == Mode::Unordered)
+        {
+            Write(item);
+            return m_hr;
+        }
+
+        if (sequence < m_next)
+        {
+            Log::Error("Sequence number {} was already written (next: {})", sequence, m_next);
+            return E_INVALIDARG;
+        }
+
+        if (sequence - m_next >= m_window)
+        {
+            m_stats.Waits++;
+            m_canPush.wait(lock, [this, sequence]() { return sequence - m_next < m_window; });
+        }
+
+        m_pending.emplace(sequence, std::move(item));
+        m_stats.PeakPending = std::max(m_stats.PeakPending, m_pending.size());
+
+        // Another thread is writing and will find this item if it is next
+        if (m_bDraining || sequence != m_next)
+            return m_hr;
+
+        m_bDraining = true;
+        while (!m_pending.empty() && std::begin(m_pending)->first == m_next)
+        {
+            auto node = m_pending.extract(std::begin(m_pending));
+
+            // Producers keep on pushing while the sink writes
+            lock.unlock();
+            const HRESULT hr = node.mapped() ? m_sink(std::move(*node.mapped())) : S_OK;
+            lock.lock();
+
+            Account(node.mapped().has_value(), hr);
+            m_next++;
+            m_canPush.notify_all();
+        }
+
+        m_bDraining = false;
+        m_drained.notify_all();
+        return m_hr;
+    }
+
+    // Called with m_mutex held
+    void Write(std::optional<T>& item)
+    {
+        Account(item.has_value(), item ? m_sink(std::move(*item)) : S_OK);
+    }
+
+    void Account(bool bWritten, HRESULT hr)
+    {
+        if (bWritten)
+            m_stats.Written++;
+        else
+            m_stats.Skipped++;
+
+        if (FAILED(hr) && SUCCEEDED(m_hr))
+            m_hr = hr;
+    }
+
+    const Sink m_sink;
+    const size_t m_window;
+    const Mode m_mode;
+
+    std::atomic<uint64_t> m_sequence {0};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_canPush;
+    std::condition_variable m_drained;
+    std::map<uint64_t, std::optional<T>> m_pending;
+    uint64_t m_next = 0;
+    bool m_bDraining = false;
+    HRESULT m_hr = S_OK;  // first failure of the sink
+
+    Statistics m_stats;
+};
+
+namespace TableOutput {
+
+// Rows of a table reordered before its writer: each sequence number is a batch of rows with the writer's schema, so
+// that a producer writes a whole record (or none) through the RecordBatch IOutput interface
+using RowReorderBuffer = ReorderBuffer<RecordBatch>;
+
+inline RowReorderBuffer::Sink ReorderBufferSink(std::shared_ptr<IWriter> writer)
+{
+    return [writer = std::move(writer)](RecordBatch&& batch) { return writer->WriteBatch(batch); };
+}
+
+}  // namespace TableOutput
+
+namespace StructuredOutput {
+
+// Elements of a structured output reordered before its writer: producers push the writes of their elements
+using ElementWrites = std::function<HRESULT(IOutput& output)>;
+using ElementReorderBuffer = ReorderBuffer<ElementWrites>;
+
+inline ElementReorderBuffer::Sink ReorderBufferSink(std::shared_ptr<IOutput> output)
+{
+    return [output = std::move(output)](ElementWrites&& writes) { return writes(*output); };
+}
+
+}  // namespace StructuredOutput
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,320 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// The indices written by the producers and by the consumer live on different cache lines so that they do not bounce
+// between cores at each item
+constexpr size_t kRingQueueCacheLine = 64;
+
+namespace Detail {
+
+inline size_t RingQueueCapacity(size_t capacity)
+{
+    size_t rounded = 2;
+    while (rounded < capacity)
+        rounded <<= 1;
+    return rounded;
+}
+
+}  // namespace Detail
+
+/// <summary>
+///     Lets the consumer of a lock-free queue sleep while it is empty, without any lock on the fast path.
+///
+///     The consumer checks the queue, calls PrepareWait, checks the queue again and then either calls Wait with the
+///     key or CancelWait when an item showed up in between. Producers call NotifyOne or NotifyAll once their items are
+///     published: when nobody waits, this only costs a fence and an atomic load.
+/// </summary>
+class EventCount
+{
+public:
+    using Key = uint64_t;
+
+    Key PrepareWait()
+    {
+        m_waiters.fetch_add(1, std::memory_order_seq_cst);
+        return m_epoch.load(std::memory_order_seq_cst);
+    }
+
+    void CancelWait() { m_waiters.fetch_sub(1, std::memory_order_relaxed); }
+
+    void Wait(Key key)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this, key]() { return m_epoch.load(std::memory_order_relaxed) != key; });
+        }
+
+        m_waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void NotifyOne() { Notify(false); }
+    void NotifyAll() { Notify(true); }
+
+private:
+    void Notify(bool bAll)
+    {
+        // Pairs with PrepareWait: either the waiter sees the published items or we see the waiter
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load(std::memory_order_relaxed) == 0)
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_epoch.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        if (bAll)
+            m_wake.notify_all();
+        else
+            m_wake.notify_one();
+    }
+
+    std::atomic<Key> m_epoch = 0;
+    std::atomic<uint32_t> m_waiters = 0;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+};
+
+/// <summary>
+///     A bounded lock-free FIFO queue between one producer thread and one consumer thread.
+///
+///     The capacity is rounded up to a power of two. Each side keeps a copy of the other side's index and only reads
+///     the shared one when its copy says the queue is full (or empty): a steady stream of items costs one release
+///     store per push or pop, or per batch with the batch methods. Items must be default constructible and movable.
+/// </summary>
+template <typename T>
+class SpscRingQueue
+{
+public:
+    explicit SpscRingQueue(size_t capacity)
+        : m_mask(Detail::RingQueueCapacity(capacity) - 1)
+        , m_slots(std::make_unique<T[]>(m_mask + 1))
+    {
+    }
+
+    SpscRingQueue(const SpscRingQueue&) = delete;
+    SpscRingQueue& operator=(const SpscRingQueue&) = delete;
+
+    size_t Capacity() const { return m_mask + 1; }
+
+    bool Empty() const
+    {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+    // Producer side
+    bool TryPush(T&& item) { return TryPushBatch(&item, 1) == 1; }
+
+    // Moves out up to 'count' items, returns how many were queued
+    size_t TryPushBatch(T* items, size_t count)
+    {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+        size_t free = Capacity() - (tail - m_cachedHead);
+        if (free < count)
+        {
+            m_cachedHead = m_head.load(std::memory_order_acquire);
+            free = Capacity() - (tail - m_cachedHead);
+        }
+
+        const size_t pushed = std::min(free, count);
+        for (size_t i = 0; i < pushed; ++i)
+            m_slots[(tail + i) & m_mask] = std::move(items[i]);
+
+        if (pushed > 0)
+            m_tail.store(tail + pushed, std::memory_order_release);
+
+        return pushed;
+    }
+
+    // Consumer side
+    std::optional<T> TryPop()
+    {
+        T item;
+        if (TryPopBatch(&item, 1) == 0)
+            return std::nullopt;
+
+        return std::optional<T>(std::move(item));
+    }
+
+    // Moves up to 'count' items to 'items', returns how many were dequeued
+    size_t TryPopBatch(T* items, size_t count)
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+
+        size_t available = m_cachedTail - head;
+        if (available < count)
+        {
+            m_cachedTail = m_tail.load(std::memory_order_acquire);
+            available = m_cachedTail - head;
+        }
+
+        const size_t popped = std::min(available, count);
+        for (size_t i = 0; i < popped; ++i)
+            items[i] = std::move(m_slots[(head + i) & m_mask]);
+
+        if (popped > 0)
+            m_head.store(head + popped, std::memory_order_release);
+
+        return popped;
+    }
+
+private:
+    const size_t m_mask;
+    std::unique_ptr<T[]> m_slots;
+
+    alignas(kRingQueueCacheLine) std::atomic<size_t> m_tail = 0;
+    size_t m_cachedHead = 0;
+
+    alignas(kRingQueueCacheLine) std::atomic<size_t> m_head = 0;
+    size_t m_cachedTail = 0;
+};
+
+/// <summary>
+///     A bounded lock-free FIFO queue between any number of producer threads and one consumer thread.
+///
+///     Each cell carries a sequence number telling whether it is free for the producer of this round or filled for
+///     the consumer (D. Vyukov's bounded queue). Producers claim cells with a compare and swap on the tail, a batch
+///     claims all its cells at once: items of a batch are consecutive in the queue. Items of one producer are dequeued
+///     in the order they were pushed. Items must be default constructible and movable.
+/// </summary>
+template <typename T>
+class MpscRingQueue
+{
+public:
+    explicit MpscRingQueue(size_t capacity)
+        : m_mask(Detail::RingQueueCapacity(capacity) - 1)
+        , m_cells(std::make_unique<Cell[]>(m_mask + 1))
+    {
+        for (size_t i = 0; i <= m_mask; ++i)
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRingQueue(const MpscRingQueue&) = delete;
+    MpscRingQueue& operator=(const MpscRingQueue&) = delete;
+
+    size_t Capacity() const { return m_mask + 1; }
+
+    bool Empty() const
+    {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        return m_cells[head & m_mask].sequence.load(std::memory_order_acquire) != head + 1;
+    }
+
+    // Producer side, thread safe
+    bool TryPush(T&& item) { return TryPushBatch(&item, 1) == 1; }
+
+    // Moves out up to 'count' items, returns how many were queued
+    size_t TryPushBatch(T* items, size_t count)
+    {
+        if (count == 0)
+            return 0;
+
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            const auto diff = static_cast<intptr_t>(Sequence(tail) - tail);
+            if (diff < 0)
+                return 0;  // full
+
+            if (diff > 0)
+            {
+                // Another producer claimed this cell
+                tail = m_tail.load(std::memory_order_relaxed);
+                continue;
+            }
+
+            // The consumer frees the cells in order: when the last cell of the batch is free, all of them are
+            size_t claimed = std::min(count, Capacity());
+            while (claimed > 1 && Sequence(tail + claimed - 1) != tail + claimed - 1)
+                claimed /= 2;
+
+            if (m_tail.compare_exchange_weak(tail, tail + claimed, std::memory_order_relaxed))
+            {
+                for (size_t i = 0; i < claimed; ++i)
+                {
+                    auto& cell = m_cells[(tail + i) & m_mask];
+                    cell.item = std::move(items[i]);
+                    cell.sequence.store(tail + i + 1, std::memory_order_release);
+                }
+
+                return claimed;
+            }
+        }
+    }
+
+    // Consumer side
+    std::optional<T> TryPop()
+    {
+        T item;
+        if (TryPopBatch(&item, 1) == 0)
+            return std::nullopt;
+
+        return std::optional<T>(std::move(item));
+    }
+
+    // Moves up to 'count' items to 'items', returns how many were dequeued. Stops at the first cell claimed by a
+    // producer which did not fill it yet.
+    size_t TryPopBatch(T* items, size_t count)
+    {
+        size_t head = m_head.load(std::memory_order_relaxed);
+
+        size_t popped = 0;
+        while (popped < count)
+        {
+            auto& cell = m_cells[head & m_mask];
+            if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+                break;
+
+            items[popped++] = std::move(cell.item);
+            cell.sequence.store(head + Capacity(), std::memory_order_release);
+            ++head;
+        }
+
+        if (popped > 0)
+            m_head.store(head, std::memory_order_relaxed);
+
+        return popped;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    size_t Sequence(size_t position) const
+    {
+        return m_cells[position & m_mask].sequence.load(std::memory_order_acquire);
+    }
+
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(kRingQueueCacheLine) std::atomic<size_t> m_tail = 0;
+    alignas(kRingQueueCacheLine) std::atomic<size_t> m_head = 0;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
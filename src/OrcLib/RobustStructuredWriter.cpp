@@ -288,6 +288,11 @@ HRESULT RobustStructuredWriter::WriteComment(LPCWSTR szComment)
     return m_pWriter->WriteComment(strComment.c_str());
 }
 
+HRESULT RobustStructuredWriter::Flush()
+{
+    return m_pWriter->Flush();
+}
+
 HRESULT RobustStructuredWriter::Close()
 {
     return m_pWriter->Close();
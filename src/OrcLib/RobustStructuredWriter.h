@@ -33,6 +33,7 @@ public:
         : StructuredOutputWriter(std::move(pOptions))
         , m_pWriter(pWriter) {};
 
+    virtual HRESULT Flush() override final;
     virtual HRESULT Close() override final;
 
     virtual HRESULT BeginElement(LPCWSTR szElement) override final;
@@ -11,6 +11,7 @@
 
 #include "PSAPIExtension.h"
 #include "Privilege.h"
+#include "TaskPool.h"
 
 #include <psapi.h>
 
@@ -65,20 +66,53 @@ HRESULT RunningCode::EnumerateProcessesModules()
 
     HRESULT hr = S_OK;
 
-    for (unsigned int i = 0; i < (dwProcesses / sizeof(DWORD)); i++)
-    {
+    // Processes are opened and their modules listed in parallel, then merged in the order of the process list
+    const size_t nbProcesses = dwProcesses / sizeof(DWORD);
+    std::vector<std::vector<std::wstring>> modules(nbProcesses);
+
+    TaskPool::ParallelFor(TaskPool::Subsystem::Walk, size_t(0), nbProcesses, [&](size_t i) {
         HRESULT hr2 = E_FAIL;
-        if (FAILED(hr2 = EnumerateModules(pProcesses[i])))
+        if (FAILED(hr2 = EnumerateModules(pProcesses[i], modules[i])))
         {
             Log::Debug("Could not load modules for process: {} [{}]", pProcesses[i], SystemError(hr2));
         }
+    });
+
+    for (size_t i = 0; i < nbProcesses; i++)
+    {
+        for (auto& module : modules[i])
+        {
+            AddModule(MODULETYPE_DLL, std::move(module), pProcesses[i]);
+        }
     }
+
     return hr;
 }
 
+void RunningCode::AddModule(ModuleType type, std::wstring strModule, DWORD dwPID)
+{
+    auto item = m_ModMap.find(strModule);
+
+    if (item != m_ModMap.end())
+    {
+        // this module was already listed
+        item->second.Pids.push_back(dwPID);
+        return;
+    }
+
+    // this module was unknown (yet)
+    ModuleInfo modinfo;
+    modinfo.type = type;
+    modinfo.strModule = std::move(strModule);
+    modinfo.Pids.push_back(dwPID);
+
+    Log::Trace(L"EnumModule: {}", modinfo.strModule);
+    m_ModMap.emplace(modinfo.strModule, std::move(modinfo));
+}
+
 constexpr auto ENUM_MODULES_BASE_COUNT = 1024;
 
-HRESULT RunningCode::EnumerateModules(DWORD dwPID)
+HRESULT RunningCode::EnumerateModules(DWORD dwPID, std::vector<std::wstring>& modules)
 {
     HRESULT hr = E_FAIL;
     HANDLE hProcess = INVALID_HANDLE_VALUE;
@@ -98,6 +132,7 @@ HRESULT RunningCode::EnumerateModules(DWORD dwPID)
     }
 
     DWORD dwModules = ENUM_MODULES_BASE_COUNT;
+    DWORD dwLoadedModules = 0L;
     HMODULE* phModules = nullptr;
 
     BOOST_SCOPE_EXIT(&phModules, &hProcess)
@@ -133,34 +168,21 @@ HRESULT RunningCode::EnumerateModules(DWORD dwPID)
             dwModules = cbNeeded / sizeof(HMODULE);
             _ASSERT(cbNeeded % sizeof(HMODULE) == 0);
         }
+        else
+        {
+            dwLoadedModules = cbNeeded / sizeof(HMODULE);
+        }
     } while (phModules == nullptr);
 
-    for (unsigned int i = 0; i < dwModules; i++)
+    modules.reserve(dwLoadedModules);
+    for (unsigned int i = 0; i < dwLoadedModules; i++)
     {
-        ModuleInfo modinfo;
-        modinfo.type = MODULETYPE_DLL;
-
         WCHAR szFileNameEx[ORC_MAX_PATH];
-        GetModuleFileNameEx(hProcess, phModules[i], szFileNameEx, ORC_MAX_PATH);
-
-        modinfo.strModule = szFileNameEx;
-
-        auto item = m_ModMap.find(modinfo.strModule);
+        if (GetModuleFileNameEx(hProcess, phModules[i], szFileNameEx, ORC_MAX_PATH) == 0)
+            continue;
 
-        if (item != m_ModMap.end())
-        {
-            // this module was already listed
-            item->second.Pids.push_back(dwPID);
-        }
-        else
-        {
-            // this module was unknown (yet)
-            modinfo.Pids.push_back(dwPID);
-            m_ModMap.insert(pair<std::wstring, ModuleInfo>(modinfo.strModule, modinfo));
-            Log::Trace(L"EnumModule: {}", modinfo.strModule);
-        }
+        modules.emplace_back(szFileNameEx);
     }
-    phModules = nullptr;
     return S_OK;
 }
 
@@ -255,27 +277,7 @@ HRESULT RunningCode::SnapEnumProcessesModules()
 
     do
     {
-
-        ModuleInfo modinfo;
-        modinfo.type = MODULETYPE_DLL;
-
-        modinfo.strModule = me32.szExePath;
-
-        auto item = m_ModMap.find(modinfo.strModule);
-
-        if (item != m_ModMap.end())
-        {
-            // this module was already listed
-            item->second.Pids.push_back(me32.th32ProcessID);
-        }
-        else
-        {
-            // this module was unknown (yet)
-            modinfo.Pids.push_back(me32.th32ProcessID);
-            m_ModMap.insert(pair<std::wstring, ModuleInfo>(modinfo.strModule, modinfo));
-            Log::Trace(L"SnapEnumModule '{}'", modinfo.strModule);
-        }
-
+        AddModule(MODULETYPE_DLL, me32.szExePath, me32.th32ProcessID);
     } while (Module32Next(hSnapshot, &me32));
 
     // close snapshot handle
@@ -53,7 +53,9 @@ class RunningCode
 private:
     ModuleMap m_ModMap;
 
-    HRESULT EnumerateModules(DWORD dwPID);
+    // Paths of the modules loaded by process 'dwPID', called for several processes at once
+    HRESULT EnumerateModules(DWORD dwPID, std::vector<std::wstring>& modules);
+    void AddModule(ModuleType type, std::wstring strModule, DWORD dwPID);
     HRESULT EnumerateProcessesModules();
     HRESULT EnumerateDeviceDrivers();
 
@@ -0,0 +1,128 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SecurityDescriptorTable.h"
+
+#include <sddl.h>
+
+#include "Log/Log.h"
+#include "Utils/Result.h"
+
+using namespace Orc;
+
+void SecurityDescriptorTable::Load(CBinaryBuffer&& sds)
+{
+    m_entries.clear();
+    m_sds = std::move(sds);
+}
+
+void SecurityDescriptorTable::Add(ULONG ulSecurityId, ULONGLONG ullOffset)
+{
+    m_entries.try_emplace(ulSecurityId).first->second.ullOffset = ullOffset;
+}
+
+const SECURITY_DESCRIPTOR_ENTRY* SecurityDescriptorTable::Get(const Entry& entry) const
+{
+    const auto ullHeader = offsetof(SECURITY_DESCRIPTOR_ENTRY, SecurityDescriptor);
+
+    if (entry.ullOffset + sizeof(SECURITY_DESCRIPTOR_ENTRY) > m_sds.GetCount())
+        return nullptr;
+
+    auto pEntry = reinterpret_cast<const SECURITY_DESCRIPTOR_ENTRY*>(m_sds.GetData() + entry.ullOffset);
+    if (pEntry->SizeEntry < ullHeader + sizeof(SECURITY_DESCRIPTOR_RELATIVE)
+        || entry.ullOffset + pEntry->SizeEntry > m_sds.GetCount())
+        return nullptr;
+
+    if (!IsValidSecurityDescriptor((PSECURITY_DESCRIPTOR)&pEntry->SecurityDescriptor))
+        return nullptr;
+
+    return pEntry;
+}
+
+const SECURITY_DESCRIPTOR_ENTRY* SecurityDescriptorTable::Get(ULONG ulSecurityId) const
+{
+    auto it = m_entries.find(ulSecurityId);
+    if (it == std::cend(m_entries))
+        return nullptr;
+
+    return Get(it->second);
+}
+
+const std::wstring* SecurityDescriptorTable::OwnerSid(ULONG ulSecurityId)
+{
+    auto it = m_entries.find(ulSecurityId);
+    if (it == std::end(m_entries))
+        return nullptr;
+
+    auto& entry = it->second;
+    if (!entry.OwnerSid.has_value())
+    {
+        entry.OwnerSid.emplace();
+
+        const auto pEntry = Get(entry);
+        if (pEntry == nullptr)
+            return nullptr;
+
+        PSID pSidOwner = nullptr;
+        BOOL bDefaulted = FALSE;
+        if (!GetSecurityDescriptorOwner((PSECURITY_DESCRIPTOR)&pEntry->SecurityDescriptor, &pSidOwner, &bDefaulted)
+            || pSidOwner == nullptr)
+        {
+            Log::Debug("Failed to get owner of security descriptor {} [{}]", ulSecurityId, LastWin32Error());
+            return nullptr;
+        }
+
+        LPWSTR szSid = nullptr;
+        if (!ConvertSidToStringSidW(pSidOwner, &szSid))
+        {
+            Log::Debug("Failed to convert owner SID of security descriptor {} [{}]", ulSecurityId, LastWin32Error());
+            return nullptr;
+        }
+
+        entry.OwnerSid->assign(szSid);
+        LocalFree(szSid);
+    }
+
+    return entry.OwnerSid->empty() ? nullptr : &entry.OwnerSid.value();
+}
+
+const std::wstring* SecurityDescriptorTable::Sddl(ULONG ulSecurityId)
+{
+    auto it = m_entries.find(ulSecurityId);
+    if (it == std::end(m_entries))
+        return nullptr;
+
+    auto& entry = it->second;
+    if (!entry.Sddl.has_value())
+    {
+        entry.Sddl.emplace();
+
+        const auto pEntry = Get(entry);
+        if (pEntry == nullptr)
+            return nullptr;
+
+        const SECURITY_INFORMATION InfoFlags = OWNER_SECURITY_INFORMATION | GROUP_SECURITY_INFORMATION
+            | DACL_SECURITY_INFORMATION | SACL_SECURITY_INFORMATION | LABEL_SECURITY_INFORMATION
+            | PROTECTED_DACL_SECURITY_INFORMATION | PROTECTED_SACL_SECURITY_INFORMATION
+            | UNPROTECTED_DACL_SECURITY_INFORMATION;
+
+        LPWSTR szSDDL = nullptr;
+        if (!ConvertSecurityDescriptorToStringSecurityDescriptorW(
+                (PSECURITY_DESCRIPTOR)&pEntry->SecurityDescriptor, SDDL_REVISION_1, InfoFlags, &szSDDL, NULL))
+        {
+            Log::Debug("Failed to convert security descriptor {} to SDDL [{}]", ulSecurityId, LastWin32Error());
+            return nullptr;
+        }
+
+        entry.Sddl->assign(szSDDL);
+        LocalFree(szSDDL);
+    }
+
+    return entry.Sddl->empty() ? nullptr : &entry.Sddl.value();
+}
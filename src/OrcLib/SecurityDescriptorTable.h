@@ -0,0 +1,65 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "BinaryBuffer.h"
+#include "NtfsDataStructures.h"
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// SecurityDescriptorTable: security descriptors of a volume indexed by their SecurityId, loaded once from the
+// $Secure:$SDS stream by MFTWalker. Owner SID and SDDL strings are rendered on first reference and kept, so that
+// records sharing a descriptor (most of them) cost a lookup.
+//
+// Not thread safe: meant to be used from the walking thread.
+//
+class SecurityDescriptorTable
+{
+public:
+    SecurityDescriptorTable() = default;
+    SecurityDescriptorTable(const SecurityDescriptorTable&) = delete;
+    SecurityDescriptorTable& operator=(const SecurityDescriptorTable&) = delete;
+
+    // Takes ownership of the $SDS stream, entries are added with their offset in it
+    void Load(CBinaryBuffer&& sds);
+    void Add(ULONG ulSecurityId, ULONGLONG ullOffset);
+
+    bool IsLoaded() const { return !m_entries.empty(); }
+    size_t size() const { return m_entries.size(); }
+
+    // nullptr if the id is unknown or its descriptor is invalid
+    const SECURITY_DESCRIPTOR_ENTRY* Get(ULONG ulSecurityId) const;
+
+    // nullptr if the id is unknown or the descriptor cannot be rendered
+    const std::wstring* OwnerSid(ULONG ulSecurityId);
+    const std::wstring* Sddl(ULONG ulSecurityId);
+
+private:
+    struct Entry
+    {
+        ULONGLONG ullOffset = 0LL;
+        std::optional<std::wstring> OwnerSid;
+        std::optional<std::wstring> Sddl;
+    };
+
+    CBinaryBuffer m_sds;
+    std::unordered_map<ULONG, Entry> m_entries;
+
+    const SECURITY_DESCRIPTOR_ENTRY* Get(const Entry& entry) const;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,267 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "ShaExtensionsHash.h"
+
+#include "CpuId.h"
+#include "SimdDispatch.h"
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_SHA_EXTENSIONS
+#endif
+
+using namespace Orc;
+
+namespace {
+
+constexpr uint32_t kSha1Init[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+constexpr uint32_t kSha256Init[8] =
+    {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+#ifdef ORC_SHA_EXTENSIONS
+
+alignas(16) constexpr uint32_t kSha256K[64] = {
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2};
+
+// Four SHA256 rounds: the message schedule for group G is computed from the four previous groups
+template <size_t G>
+inline void Sha256Group(__m128i& state0, __m128i& state1, __m128i (&msg)[4], const BYTE* pBlock, __m128i mask)
+{
+    if constexpr (G < 4)
+    {
+        msg[G] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBlock + 16 * G)), mask);
+    }
+    else
+    {
+        const auto w = _mm_add_epi32(
+            _mm_sha256msg1_epu32(msg[G % 4], msg[(G + 1) % 4]), _mm_alignr_epi8(msg[(G + 3) % 4], msg[(G + 2) % 4], 4));
+        msg[G % 4] = _mm_sha256msg2_epu32(w, msg[(G + 3) % 4]);
+    }
+
+    const auto wk = _mm_add_epi32(msg[G % 4], _mm_load_si128(reinterpret_cast<const __m128i*>(&kSha256K[4 * G])));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, wk);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(wk, 0x0E));
+}
+
+template <size_t... G>
+inline void
+Sha256Rounds(__m128i& state0, __m128i& state1, const BYTE* pBlock, __m128i mask, std::index_sequence<G...>)
+{
+    __m128i msg[4];
+    (Sha256Group<G>(state0, state1, msg, pBlock, mask), ...);
+}
+
+void Sha256Compress(uint32_t state[8], const BYTE* pBlocks, size_t dwBlocks)
+{
+    const auto mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+    // State is kept as ABEF/CDGH, the layout sha256rnds2 works with
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (size_t i = 0; i < dwBlocks; i++, pBlocks += 64)
+    {
+        const auto abef = state0;
+        const auto cdgh = state1;
+
+        Sha256Rounds(state0, state1, pBlocks, mask, std::make_index_sequence<16>());
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+// Four SHA1 rounds: E alternates between e0 and e1, the schedule for the next groups is interleaved
+template <size_t G>
+inline void
+Sha1Group(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i (&msg)[4], const BYTE* pBlock, __m128i mask)
+{
+    if constexpr (G < 4)
+        msg[G] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pBlock + 16 * G)), mask);
+
+    auto& current = (G % 2 == 0) ? e0 : e1;
+    auto& next = (G % 2 == 0) ? e1 : e0;
+
+    if constexpr (G == 0)
+        current = _mm_add_epi32(current, msg[0]);
+    else
+        current = _mm_sha1nexte_epu32(current, msg[G % 4]);
+
+    next = abcd;
+
+    if constexpr (G >= 3 && G <= 18)
+        msg[(G + 1) % 4] = _mm_sha1msg2_epu32(msg[(G + 1) % 4], msg[G % 4]);
+
+    abcd = _mm_sha1rnds4_epu32(abcd, current, G / 5);
+
+    if constexpr (G >= 1 && G <= 16)
+        msg[(G + 3) % 4] = _mm_sha1msg1_epu32(msg[(G + 3) % 4], msg[G % 4]);
+    if constexpr (G >= 2 && G <= 17)
+        msg[(G + 2) % 4] = _mm_xor_si128(msg[(G + 2) % 4], msg[G % 4]);
+}
+
+template <size_t... G>
+inline void Sha1Rounds(
+    __m128i& abcd,
+    __m128i& e0,
+    __m128i& e1,
+    const BYTE* pBlock,
+    __m128i mask,
+    std::index_sequence<G...>)
+{
+    __m128i msg[4];
+    (Sha1Group<G>(abcd, e0, e1, msg, pBlock, mask), ...);
+}
+
+void Sha1Compress(uint32_t state[5], const BYTE* pBlocks, size_t dwBlocks)
+{
+    const auto mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+
+    auto abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1B);
+    auto e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    for (size_t i = 0; i < dwBlocks; i++, pBlocks += 64)
+    {
+        const auto abcdSave = abcd;
+        const auto e0Save = e0;
+        __m128i e1;
+
+        Sha1Rounds(abcd, e0, e1, pBlocks, mask, std::make_index_sequence<20>());
+
+        e0 = _mm_sha1nexte_epu32(e0, e0Save);
+        abcd = _mm_add_epi32(abcd, abcdSave);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+#endif  // ORC_SHA_EXTENSIONS
+
+}  // namespace
+
+bool ShaExtensionsHash::IsSupported()
+{
+#ifdef ORC_SHA_EXTENSIONS
+    static const bool bSupported = []() {
+        const bool bSupported = SimdDispatch::Supported() >= SimdDispatch::Level::SSE41 && CpuId().HasSHA();
+        const auto level = bSupported ? SimdDispatch::Level::SSE41 : SimdDispatch::Level::Scalar;
+        SimdDispatch::Register(L"sha_extensions", level);
+        return bSupported;
+    }();
+    return bSupported;
+#else
+    return false;
+#endif
+}
+
+ShaExtensionsHash::ShaExtensionsHash(Algorithm algorithm)
+    : m_Algorithm(algorithm)
+    , m_State {0}
+    , m_Buffer {0}
+{
+    if (m_Algorithm == Algorithm::SHA1)
+        std::copy(std::cbegin(kSha1Init), std::cend(kSha1Init), m_State);
+    else
+        std::copy(std::cbegin(kSha256Init), std::cend(kSha256Init), m_State);
+}
+
+void ShaExtensionsHash::Compress(const BYTE* pBlocks, size_t dwBlocks)
+{
+#ifdef ORC_SHA_EXTENSIONS
+    if (m_Algorithm == Algorithm::SHA1)
+        Sha1Compress(m_State, pBlocks, dwBlocks);
+    else
+        Sha256Compress(m_State, pBlocks, dwBlocks);
+#else
+    DBG_UNREFERENCED_PARAMETER(pBlocks);
+    DBG_UNREFERENCED_PARAMETER(dwBlocks);
+#endif
+}
+
+void ShaExtensionsHash::Update(const BYTE* pData, size_t cbData)
+{
+    m_ullLength += cbData;
+
+    if (m_cbBuffered > 0)
+    {
+        const auto cbCopy = std::min(sizeof(m_Buffer) - m_cbBuffered, cbData);
+        CopyMemory(m_Buffer + m_cbBuffered, pData, cbCopy);
+        m_cbBuffered += cbCopy;
+        pData += cbCopy;
+        cbData -= cbCopy;
+
+        if (m_cbBuffered < sizeof(m_Buffer))
+            return;
+
+        Compress(m_Buffer, 1);
+        m_cbBuffered = 0;
+    }
+
+    if (cbData >= sizeof(m_Buffer))
+    {
+        const auto dwBlocks = cbData / sizeof(m_Buffer);
+        Compress(pData, dwBlocks);
+        pData += dwBlocks * sizeof(m_Buffer);
+        cbData -= dwBlocks * sizeof(m_Buffer);
+    }
+
+    if (cbData > 0)
+    {
+        CopyMemory(m_Buffer, pData, cbData);
+        m_cbBuffered = cbData;
+    }
+}
+
+void ShaExtensionsHash::Digest(BYTE* pDigest) const
+{
+    ShaExtensionsHash finalHash(*this);
+
+    const ULONGLONG ullBits = m_ullLength * 8;
+
+    BYTE padding[64 + 8] = {0x80};
+    const auto cbPadding = (m_cbBuffered < 56) ? 56 - m_cbBuffered : 120 - m_cbBuffered;
+    for (size_t i = 0; i < 8; i++)
+        padding[cbPadding + i] = static_cast<BYTE>(ullBits >> (56 - 8 * i));
+
+    finalHash.Update(padding, cbPadding + 8);
+    _ASSERT(finalHash.m_cbBuffered == 0);
+
+    for (DWORD i = 0; i < DigestSize() / sizeof(uint32_t); i++)
+    {
+        pDigest[4 * i] = static_cast<BYTE>(finalHash.m_State[i] >> 24);
+        pDigest[4 * i + 1] = static_cast<BYTE>(finalHash.m_State[i] >> 16);
+        pDigest[4 * i + 2] = static_cast<BYTE>(finalHash.m_State[i] >> 8);
+        pDigest[4 * i + 3] = static_cast<BYTE>(finalHash.m_State[i]);
+    }
+}
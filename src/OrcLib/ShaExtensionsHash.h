@@ -0,0 +1,52 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include <cstdint>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// SHA1 and SHA256 computed with the Intel SHA extensions (SHA-NI), several times faster than the CryptoAPI
+// providers. Only usable when IsSupported() returns true (CPUID SHA, SSSE3 and SSE4.1 flags).
+class ShaExtensionsHash
+{
+public:
+    enum class Algorithm
+    {
+        SHA1,
+        SHA256
+    };
+
+    static bool IsSupported();
+
+    explicit ShaExtensionsHash(Algorithm algorithm);
+
+    void Update(const BYTE* pData, size_t cbData);
+
+    // Digest of the data hashed so far: hashing can go on afterwards
+    void Digest(BYTE* pDigest) const;
+    DWORD DigestSize() const { return m_Algorithm == Algorithm::SHA1 ? 20L : 32L; }
+
+private:
+    void Compress(const BYTE* pBlocks, size_t dwBlocks);
+
+    Algorithm m_Algorithm;
+    uint32_t m_State[8];
+    BYTE m_Buffer[64];
+    size_t m_cbBuffered = 0;
+    ULONGLONG m_ullLength = 0LL;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -10,6 +10,39 @@
 #include "BinaryBuffer.h"
 #include "Utils/BufferSpan.h"
 
+#include <map>
+#include <mutex>
+
+namespace {
+
+// The shadow copies of a volume share the same snapshots: parse each one once for all their readers
+Orc::Ntfs::ShadowCopy::SnapshotChain::Ptr
+GetSnapshotChain(const std::wstring& volume, Orc::StreamReader& stream, std::error_code& ec)
+{
+    static std::mutex mutex;
+    static std::map<std::wstring, std::weak_ptr<Orc::Ntfs::ShadowCopy::SnapshotChain>> chains;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto& entry = chains[volume];
+    auto chain = entry.lock();
+    if (chain)
+    {
+        return chain;
+    }
+
+    chain = Orc::Ntfs::ShadowCopy::SnapshotChain::Open(stream, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    entry = chain;
+    return chain;
+}
+
+}  // namespace
+
 namespace Orc {
 
 HRESULT ShadowCopyVolumeReader::LoadDiskProperties()
@@ -22,8 +55,18 @@ HRESULT ShadowCopyVolumeReader::LoadDiskProperties()
     }
 
     std::error_code ec;
+    auto volumeStream = std::make_shared<VolumeStreamReader>(m_Shadow.parentVolume);
+
+    // Only the snapshots index is parsed here: the diff areas will be parsed and indexed by the reads needing them
+    auto chain = ::GetSnapshotChain(m_Shadow.parentVolume->GetLocation(), *volumeStream, ec);
+    if (ec)
+    {
+        Log::Debug("Failed to read snapshots index [{}]", ec);
+        return ToHRESULT(ec);
+    }
+
     m_stream = std::make_unique<Ntfs::ShadowCopy::ShadowCopyStream>(
-        std::make_shared<VolumeStreamReader>(m_Shadow.parentVolume), m_Shadow.guid, ec);
+        std::move(volumeStream), std::move(chain), m_Shadow.guid, ec);
     if (ec)
     {
         m_stream.reset();
@@ -108,6 +151,46 @@ HRESULT ShadowCopyVolumeReader::Read(CBinaryBuffer& buffer, ULONGLONG ullBytesTo
     return S_OK;
 }
 
+bool ShadowCopyVolumeReader::IsUnchanged(ULONGLONG ullOffset, ULONGLONG ullLength)
+{
+    if (m_stream == nullptr)
+    {
+        return false;
+    }
+
+    std::error_code ec;
+    const auto unchanged = m_stream->IsUnchanged(ullOffset, ullLength, ec);
+    if (ec)
+    {
+        Log::Debug("Failed to compare shadow copy range (offset: {:#x}, length: {}) [{}]", ullOffset, ullLength, ec);
+        return false;
+    }
+
+    return unchanged;
+}
+
+bool ShadowCopyVolumeReader::IsUnchanged(const MFTUtils::NonResidentAttributeExtentVector& extents)
+{
+    bool bAllocated = false;
+    for (const auto& extent : extents)
+    {
+        // Sparse extents read as zeroes from both
+        if (extent.bZero)
+        {
+            continue;
+        }
+
+        if (!IsUnchanged(extent.DiskOffset, extent.DiskAlloc))
+        {
+            return false;
+        }
+
+        bAllocated = true;
+    }
+
+    return bAllocated;
+}
+
 std::shared_ptr<VolumeReader> ShadowCopyVolumeReader::ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags)
 {
     m_Shadow.parentVolume = m_Shadow.parentVolume->ReOpen(dwDesiredAccess, dwShareMode, dwFlags);
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "SnapshotVolumeReader.h"
+#include "MFTUtils.h"
 #include "VolumeShadowCopies.h"
 #include "Filesystem/Ntfs/ShadowCopy/ShadowCopyStream.h"
 #include "Stream/VolumeStreamReader.h"
@@ -37,6 +38,16 @@ public:
 
     std::shared_ptr<VolumeReader> ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags) override;
 
+    // Reads go through the parent volume, there is no snapshot device to read ahead from
+    HRESULT EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize = 0L) override { return E_NOTIMPL; }
+
+    // True if the range has the same data in the shadow copy and on the parent volume (false on error)
+    bool IsUnchanged(ULONGLONG ullOffset, ULONGLONG ullLength);
+
+    // True if every allocated extent has the same data in the shadow copy and on the parent volume: a stream with such
+    // extents reads the same from both (false on error or when there is no allocated extent to compare)
+    bool IsUnchanged(const MFTUtils::NonResidentAttributeExtentVector& extents);
+
 private:
     Ntfs::ShadowCopy::ShadowCopyStream::Ptr m_stream;
     std::shared_ptr<VolumeReader> m_volume;
@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SharedMFTWalk.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+HRESULT SharedMFTWalk::Initialize(const std::shared_ptr<Location>& loc, ResurrectRecordsMode mode)
+{
+    return m_Walker.Initialize(loc, mode);
+}
+
+size_t SharedMFTWalk::Subscribe(const MFTWalker::Callbacks& callbacks)
+{
+    m_Subscribers.push_back({callbacks, true});
+    return m_Subscribers.size() - 1;
+}
+
+template <typename Call>
+Call SharedMFTWalk::FanOut(Call MFTWalker::Callbacks::*member)
+{
+    // Keep the walker's fast paths for the callbacks no subscriber uses
+    if (std::none_of(std::cbegin(m_Subscribers), std::cend(m_Subscribers), [member](const Subscriber& subscriber) {
+            return subscriber.Callbacks.*member != nullptr;
+        }))
+    {
+        return nullptr;
+    }
+
+    return [this, member](auto&&... args) {
+        for (auto& subscriber : m_Subscribers)
+        {
+            if (subscriber.bActive && subscriber.Callbacks.*member)
+                (subscriber.Callbacks.*member)(args...);
+        }
+    };
+}
+
+MFTWalker::Callbacks SharedMFTWalk::FanOut()
+{
+    MFTWalker::Callbacks callbacks;
+
+    callbacks.ElementCallback = FanOut(&MFTWalker::Callbacks::ElementCallback);
+    callbacks.FileNameCallback = FanOut(&MFTWalker::Callbacks::FileNameCallback);
+    callbacks.AttributeCallback = FanOut(&MFTWalker::Callbacks::AttributeCallback);
+    callbacks.DataCallback = FanOut(&MFTWalker::Callbacks::DataCallback);
+    callbacks.FileNameAndDataCallback = FanOut(&MFTWalker::Callbacks::FileNameAndDataCallback);
+    callbacks.DirectoryCallback = FanOut(&MFTWalker::Callbacks::DirectoryCallback);
+    callbacks.I30Callback = FanOut(&MFTWalker::Callbacks::I30Callback);
+    callbacks.SecDescCallback = FanOut(&MFTWalker::Callbacks::SecDescCallback);
+
+    if (std::any_of(std::cbegin(m_Subscribers), std::cend(m_Subscribers), [](const Subscriber& subscriber) {
+            return subscriber.Callbacks.KeepAliveCallback != nullptr;
+        }))
+    {
+        // Every subscriber must see the record: a record is kept alive as long as one of them needs it
+        callbacks.KeepAliveCallback = [this](const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
+            bool bKeepAlive = false;
+            for (auto& subscriber : m_Subscribers)
+            {
+                if (subscriber.bActive && subscriber.Callbacks.KeepAliveCallback)
+                    bKeepAlive = subscriber.Callbacks.KeepAliveCallback(volreader, pElt) || bKeepAlive;
+            }
+            return bKeepAlive;
+        };
+    }
+
+    callbacks.ProgressCallback = [this](const ULONG dwProgress) -> HRESULT {
+        bool bAnyActive = false;
+        for (auto& subscriber : m_Subscribers)
+        {
+            if (!subscriber.bActive)
+                continue;
+
+            if (subscriber.Callbacks.ProgressCallback && FAILED(subscriber.Callbacks.ProgressCallback(dwProgress)))
+            {
+                subscriber.bActive = false;
+                continue;
+            }
+
+            bAnyActive = true;
+        }
+
+        return bAnyActive ? S_OK : HRESULT_FROM_WIN32(ERROR_NO_MORE_FILES);
+    };
+
+    return callbacks;
+}
+
+HRESULT SharedMFTWalk::Walk()
+{
+    if (m_Subscribers.empty())
+        return S_OK;
+
+    Log::Debug("Shared MFT walk for {} subscriber(s)", m_Subscribers.size());
+    return m_Walker.Walk(FanOut());
+}
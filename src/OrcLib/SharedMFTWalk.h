@@ -0,0 +1,63 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "MFTWalker.h"
+
+#include <memory>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Walk a location once for several consumers: the MFT is read and parsed once and each record is handed to the
+// callbacks of every subscriber, in subscription order.
+//
+// A subscriber whose ProgressCallback fails stops receiving records (like its own walk would stop), the walk ends
+// once all subscribers are stopped. The walker is shared: the name builders it provides are valid for all subscribers.
+class SharedMFTWalk
+{
+public:
+    SharedMFTWalk() = default;
+
+    SharedMFTWalk(const SharedMFTWalk&) = delete;
+    SharedMFTWalk& operator=(const SharedMFTWalk&) = delete;
+
+    // Walker to configure (pipeline...) before Initialize
+    MFTWalker& Walker() { return m_Walker; }
+
+    HRESULT Initialize(const std::shared_ptr<Location>& loc, ResurrectRecordsMode mode = ResurrectRecordsMode::kYes);
+
+    // Subscribe before Walk, returns the subscriber's index
+    size_t Subscribe(const MFTWalker::Callbacks& callbacks);
+
+    size_t Subscribers() const { return m_Subscribers.size(); }
+
+    // Same return values as MFTWalker::Walk, ERROR_NO_MORE_FILES when all subscribers stopped the walk
+    HRESULT Walk();
+
+private:
+    struct Subscriber
+    {
+        MFTWalker::Callbacks Callbacks;
+        bool bActive = true;
+    };
+
+    MFTWalker::Callbacks FanOut();
+
+    template <typename Call>
+    Call FanOut(Call MFTWalker::Callbacks::*member);
+
+    MFTWalker m_Walker;
+    std::vector<Subscriber> m_Subscribers;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
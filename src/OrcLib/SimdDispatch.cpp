@@ -0,0 +1,210 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SimdDispatch.h"
+
+#include "CpuId.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#include <boost/algorithm/string/predicate.hpp>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_SIMD_DISPATCH_X86
+#endif
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcSimdEnv = L"DFIR-ORC_SIMD";
+constexpr auto LevelCount = static_cast<size_t>(SimdDispatch::Level::Count);
+
+// XCR0: SSE and AVX state, then AVX-512 opmask and upper ZMM registers
+constexpr unsigned long long kXcr0Avx = 0x6;
+constexpr unsigned long long kXcr0Avx512 = 0xE6;
+
+SimdDispatch::Level Detect()
+{
+#ifdef ORC_SIMD_DISPATCH_X86
+    CpuId cpuid;
+    if (!cpuid.HasSSE2())
+        return SimdDispatch::Level::Scalar;
+
+    if (!cpuid.HasSSSE3())
+        return SimdDispatch::Level::SSE2;
+
+    if (!cpuid.HasSSE41())
+        return SimdDispatch::Level::SSSE3;
+
+    if (!cpuid.HasOSXSAVE() || !cpuid.HasAVX() || !cpuid.HasAVX2())
+        return SimdDispatch::Level::SSE41;
+
+    const auto xcr0 = _xgetbv(0);
+    if ((xcr0 & kXcr0Avx) != kXcr0Avx)
+        return SimdDispatch::Level::SSE41;
+
+    if (!cpuid.HasAVX512F() || !cpuid.HasAVX512BW() || !cpuid.HasAVX512VL() || (xcr0 & kXcr0Avx512) != kXcr0Avx512)
+        return SimdDispatch::Level::AVX2;
+
+    return SimdDispatch::Level::AVX512;
+#else
+    return SimdDispatch::Level::Scalar;
+#endif
+}
+
+SimdDispatch::Level DetectedLevel()
+{
+    static const auto level = Detect();
+    return level;
+}
+
+// Cap configured by a parent process, if any
+SimdDispatch::Level ConfiguredMaximum()
+{
+    WCHAR szValue[16] = {0};
+    const auto nbChars = GetEnvironmentVariableW(OrcSimdEnv, szValue, ARRAYSIZE(szValue));
+    if (nbChars == 0 || nbChars >= ARRAYSIZE(szValue))
+        return SimdDispatch::Level::AVX512;
+
+    const auto level = SimdDispatch::FromString(szValue);
+    if (!level)
+    {
+        Log::Warn(L"Invalid %%{}%% value '{}', ignored", OrcSimdEnv, szValue);
+        return SimdDispatch::Level::AVX512;
+    }
+
+    return *level;
+}
+
+std::atomic<SimdDispatch::Level>& Maximum()
+{
+    static std::atomic<SimdDispatch::Level> maximum = ConfiguredMaximum();
+    return maximum;
+}
+
+class Selections
+{
+public:
+    static Selections& Instance()
+    {
+        static Selections instance;
+        return instance;
+    }
+
+    void Add(std::wstring_view name, SimdDispatch::Level level)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_selections.push_back({std::wstring(name), level});
+    }
+
+    std::vector<SimdDispatch::Selection> Get() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_selections;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<SimdDispatch::Selection> m_selections;
+};
+
+}  // namespace
+
+SimdDispatch::Level SimdDispatch::Supported()
+{
+    return std::min(DetectedLevel(), Maximum().load(std::memory_order_relaxed));
+}
+
+HRESULT SimdDispatch::Configure(Level maximum)
+{
+    if (maximum >= Level::Count)
+        return E_INVALIDARG;
+
+    Maximum() = maximum;
+
+    const auto strValue = ToString(maximum);
+    if (!SetEnvironmentVariableW(OrcSimdEnv, std::wstring(strValue).c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcSimdEnv, strValue, SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Vectorized kernels are limited to '{}' (supported: '{}')", strValue, ToString(DetectedLevel()));
+    return S_OK;
+}
+
+void SimdDispatch::Register(std::wstring_view kernel, Level level)
+{
+    Log::Debug(L"SimdDispatch: '{}' uses '{}'", kernel, ToString(level));
+    Selections::Instance().Add(kernel, level);
+}
+
+std::vector<SimdDispatch::Selection> SimdDispatch::GetSelections()
+{
+    return Selections::Instance().Get();
+}
+
+void SimdDispatch::LogSelections()
+{
+    const auto selections = GetSelections();
+    if (selections.empty())
+        return;
+
+    std::wstring strSelections;
+    for (const auto& selection : selections)
+    {
+        if (!strSelections.empty())
+            strSelections += L", ";
+
+        strSelections += selection.Name;
+        strSelections += L':';
+        strSelections += ToString(selection.Selected);
+    }
+
+    Log::Debug(L"SimdDispatch: supported: '{}', kernels: {}", ToString(Supported()), strSelections);
+}
+
+std::wstring_view SimdDispatch::ToString(Level level)
+{
+    switch (level)
+    {
+        case Level::Scalar:
+            return L"scalar";
+        case Level::SSE2:
+            return L"sse2";
+        case Level::SSSE3:
+            return L"ssse3";
+        case Level::SSE41:
+            return L"sse41";
+        case Level::AVX2:
+            return L"avx2";
+        case Level::AVX512:
+            return L"avx512";
+        default:
+            return L"unknown";
+    }
+}
+
+std::optional<SimdDispatch::Level> SimdDispatch::FromString(std::wstring_view level)
+{
+    for (size_t i = 0; i < LevelCount; i++)
+    {
+        if (boost::iequals(level, ToString(static_cast<Level>(i))))
+            return static_cast<Level>(i);
+    }
+
+    return std::nullopt;
+}
@@ -0,0 +1,112 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// SimdDispatch: selects the implementation of the vectorized kernels from the processor features.
+//
+// Levels are detected once from CpuId, and AVX levels also require the operating system to save the extended
+// registers (XCR0): Windows 7 and 2008 R2 without SP1 report AVX2 capable processors but do not. The level may be
+// capped with /simd=<level> or %DFIR-ORC_SIMD% (inherited by child processes), 'scalar' forcing the portable
+// implementations for troubleshooting.
+//
+// A kernel is a function pointer, or a table of them, with one implementation per level. The best supported one is
+// selected when the Kernel is constructed (usually a function local static, resolved on first use) and logged.
+//
+class SimdDispatch
+{
+public:
+    enum class Level : UCHAR
+    {
+        Scalar = 0,
+        SSE2,
+        SSSE3,
+        SSE41,
+        AVX2,
+        AVX512,  // AVX-512 F, BW and VL
+        Count
+    };
+
+    template <typename Fn>
+    class Kernel
+    {
+    public:
+        struct Implementation
+        {
+            Level Required;
+            Fn Function;
+        };
+
+        // A Level::Scalar implementation must be provided (it may be a null function when callers have a fallback)
+        Kernel(std::wstring_view name, std::initializer_list<Implementation> implementations)
+        {
+            const auto supported = Supported();
+
+            bool bFound = false;
+            for (const auto& implementation : implementations)
+            {
+                if (implementation.Required > supported || (bFound && implementation.Required <= m_level))
+                    continue;
+
+                m_function = implementation.Function;
+                m_level = implementation.Required;
+                bFound = true;
+            }
+
+            _ASSERT(bFound);
+            Register(name, m_level);
+        }
+
+        Kernel(const Kernel&) = delete;
+        Kernel& operator=(const Kernel&) = delete;
+
+        const Fn& Get() const { return m_function; }
+        Level Selected() const { return m_level; }
+
+    private:
+        Fn m_function {};
+        Level m_level = Level::Scalar;
+    };
+
+    struct Selection
+    {
+        std::wstring Name;
+        Level Selected;
+    };
+
+    // Highest level supported by the processor and the operating system, capped by the configuration
+    static Level Supported();
+
+    // Cap the level of the kernels selected from now on, for this process and its children
+    static HRESULT Configure(Level maximum);
+
+    // Record the level of a kernel dispatched by its owner (Kernel does it on construction)
+    static void Register(std::wstring_view kernel, Level level);
+
+    static std::vector<Selection> GetSelections();
+    static void LogSelections();
+
+    static std::wstring_view ToString(Level level);
+    static std::optional<Level> FromString(std::wstring_view level);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
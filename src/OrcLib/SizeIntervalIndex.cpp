@@ -0,0 +1,122 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SizeIntervalIndex.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+void SizeIntervalIndex::Add(ULONGLONG ullLow, ULONGLONG ullHigh, size_t id)
+{
+    if (ullLow > ullHigh)
+        return;
+
+    m_Ranges.push_back({ullLow, ullHigh, id});
+}
+
+void SizeIntervalIndex::Compile()
+{
+    m_Nodes.clear();
+    m_ByLow.clear();
+    m_ByHigh.clear();
+
+    m_Nodes.reserve(m_Ranges.size());
+    m_ByLow.reserve(m_Ranges.size());
+    m_ByHigh.reserve(m_Ranges.size());
+
+    m_Root = Build(m_Ranges);
+}
+
+int SizeIntervalIndex::Build(std::vector<Range> ranges)
+{
+    if (ranges.empty())
+        return -1;
+
+    // The median of the lower bounds splits the ranges not containing it evenly enough
+    const auto middle = std::begin(ranges) + ranges.size() / 2;
+    std::nth_element(std::begin(ranges), middle, std::end(ranges), [](const Range& lhs, const Range& rhs) {
+        return lhs.Low < rhs.Low;
+    });
+    const auto ullCenter = middle->Low;
+
+    std::vector<Range> below;
+    std::vector<Range> above;
+    std::vector<Range> containing;
+    for (const auto& range : ranges)
+    {
+        if (range.High < ullCenter)
+            below.push_back(range);
+        else if (range.Low > ullCenter)
+            above.push_back(range);
+        else
+            containing.push_back(range);
+    }
+
+    const auto index = static_cast<int>(m_Nodes.size());
+    m_Nodes.push_back({ullCenter, m_ByLow.size(), containing.size()});
+
+    std::sort(std::begin(containing), std::end(containing), [](const Range& lhs, const Range& rhs) {
+        return lhs.Low < rhs.Low;
+    });
+    m_ByLow.insert(std::end(m_ByLow), std::cbegin(containing), std::cend(containing));
+
+    std::sort(std::begin(containing), std::end(containing), [](const Range& lhs, const Range& rhs) {
+        return lhs.High > rhs.High;
+    });
+    m_ByHigh.insert(std::end(m_ByHigh), std::cbegin(containing), std::cend(containing));
+
+    ranges.clear();
+    containing.clear();
+
+    const auto iBelow = Build(std::move(below));
+    const auto iAbove = Build(std::move(above));
+    m_Nodes[index].Below = iBelow;
+    m_Nodes[index].Above = iAbove;
+    return index;
+}
+
+void SizeIntervalIndex::Match(ULONGLONG ullSize, std::vector<size_t>& matches) const
+{
+    auto index = m_Root;
+    while (index != -1)
+    {
+        const auto& node = m_Nodes[index];
+        const auto first = node.First;
+        const auto last = node.First + node.Count;
+
+        if (ullSize < node.Center)
+        {
+            for (auto i = first; i < last && m_ByLow[i].Low <= ullSize; i++)
+                matches.push_back(m_ByLow[i].Id);
+            index = node.Below;
+        }
+        else if (ullSize > node.Center)
+        {
+            for (auto i = first; i < last && m_ByHigh[i].High >= ullSize; i++)
+                matches.push_back(m_ByHigh[i].Id);
+            index = node.Above;
+        }
+        else
+        {
+            for (auto i = first; i < last; i++)
+                matches.push_back(m_ByLow[i].Id);
+            break;
+        }
+    }
+}
+
+void SizeIntervalIndex::Clear()
+{
+    m_Ranges.clear();
+    m_Nodes.clear();
+    m_ByLow.clear();
+    m_ByHigh.clear();
+    m_Root = -1;
+}
@@ -0,0 +1,73 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Static interval tree over size ranges: resolves a size to the identifiers of the ranges containing it in
+// O(log n + k). Each node keeps the ranges containing its center sorted by lower and by upper bound, the ranges below
+// and above the center go to its children.
+class SizeIntervalIndex
+{
+public:
+    SizeIntervalIndex() = default;
+    SizeIntervalIndex(const SizeIntervalIndex&) = delete;
+    SizeIntervalIndex& operator=(const SizeIntervalIndex&) = delete;
+
+    // Register the range [ullLow, ullHigh] (inclusive) identified by 'id', an empty range is ignored
+    void Add(ULONGLONG ullLow, ULONGLONG ullHigh, size_t id);
+
+    // Build the tree: must be called after the last Add and before Match
+    void Compile();
+
+    // Append the identifiers of the ranges containing 'ullSize' to 'matches'
+    void Match(ULONGLONG ullSize, std::vector<size_t>& matches) const;
+
+    void Clear();
+
+    bool empty() const { return m_Ranges.empty(); }
+    size_t size() const { return m_Ranges.size(); }
+
+private:
+    struct Range
+    {
+        ULONGLONG Low;
+        ULONGLONG High;
+        size_t Id;
+    };
+
+    struct Node
+    {
+        ULONGLONG Center = 0LL;
+
+        // Ranges containing the center in m_ByLow (increasing lower bounds) and m_ByHigh (decreasing upper bounds)
+        size_t First = 0;
+        size_t Count = 0;
+
+        int Below = -1;
+        int Above = -1;
+    };
+
+    int Build(std::vector<Range> ranges);
+
+    std::vector<Range> m_Ranges;
+    std::vector<Node> m_Nodes;
+    std::vector<Range> m_ByLow;
+    std::vector<Range> m_ByHigh;
+    int m_Root = -1;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
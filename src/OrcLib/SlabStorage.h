@@ -0,0 +1,240 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Fixed size cell allocator: cells are carved out of large VirtualAlloc'ed slabs and recycled through per slab free
+// lists. Allocation and release do not take any lock (same contract as HeapStorage with HEAP_NO_SERIALIZE) and a
+// slab is returned to the system as soon as all its cells are released by ReleaseEmptySlabs or Reset. Committed slabs
+// may be charged to a MemoryAccounting tag.
+class SlabStorage
+{
+public:
+    static constexpr size_t kDefaultSlabSize = 4 * 1024 * 1024;
+
+    SlabStorage(const LPCWSTR szDescription)
+        : m_szStoreDescription(szDescription) {};
+
+    SlabStorage(const SlabStorage&) = delete;
+    SlabStorage& operator=(const SlabStorage&) = delete;
+
+    HRESULT InitializeStore(const DWORD dwMaxObjects, const DWORD dwElementSize, size_t cbSlabSize = kDefaultSlabSize)
+    {
+        Reset();
+
+        if (dwElementSize == 0)
+            return E_INVALIDARG;
+
+        // Keep cells 16 bytes aligned, as HeapAlloc does
+        m_dwElementSize = (dwElementSize + 15) & ~15;
+        m_dwMaxObjects = dwMaxObjects;
+        m_dwCellsPerSlab = static_cast<DWORD>(std::max<size_t>(cbSlabSize / m_dwElementSize, 1));
+        m_Initialized = true;
+        return S_OK;
+    }
+
+    size_t AllocatedCells() const { return m_NumberOfAllocatedCells; }
+    size_t PeakAllocatedCells() const { return m_PeakAllocatedCells; }
+    size_t SlabCount() const { return m_Slabs.size(); }
+    size_t CommittedBytes() const { return m_Slabs.size() * SlabBytes(); }
+    size_t PeakCommittedBytes() const { return m_PeakCommittedBytes; }
+
+    // Before any cell is allocated
+    void SetAccountingTag(MemoryAccounting::Tag tag) { m_Accounting = tag; }
+
+    LPVOID GetNewCell()
+    {
+        if (!m_Initialized)
+            throw "Storage is not initialized!!!";
+
+        if (m_dwMaxObjects && m_NumberOfAllocatedCells >= m_dwMaxObjects)
+            return nullptr;
+
+        Slab* pSlab = nullptr;
+        while (!m_Available.empty())
+        {
+            auto it = m_Slabs.find(m_Available.back());
+            if (it != std::end(m_Slabs) && it->second.HasRoom(m_dwCellsPerSlab))
+            {
+                pSlab = &it->second;
+                break;
+            }
+            m_Available.pop_back();
+        }
+
+        if (pSlab == nullptr)
+        {
+            pSlab = NewSlab();
+            if (pSlab == nullptr)
+                return nullptr;
+        }
+
+        DWORD dwIndex = 0L;
+        if (!pSlab->FreeCells.empty())
+        {
+            dwIndex = pSlab->FreeCells.back();
+            pSlab->FreeCells.pop_back();
+        }
+        else
+        {
+            dwIndex = pSlab->dwNextUnused++;
+        }
+
+        pSlab->Busy[dwIndex] = true;
+        pSlab->dwUsed++;
+
+        if (!pSlab->HasRoom(m_dwCellsPerSlab))
+            m_Available.pop_back();
+
+        m_NumberOfAllocatedCells++;
+        m_PeakAllocatedCells = std::max(m_PeakAllocatedCells, m_NumberOfAllocatedCells);
+
+        const auto cell = pSlab->pBase + (static_cast<size_t>(dwIndex) * m_dwElementSize);
+        ZeroMemory(cell, m_dwElementSize);
+        return cell;
+    }
+
+    void FreeCell(LPVOID cell)
+    {
+        if (!m_Initialized)
+            throw "Storage is not initialized!!!";
+
+        if (cell == nullptr)
+            return;
+
+        // Slabs are indexed by their base address: the owner is the last slab starting at or before the cell
+        auto it = m_Slabs.upper_bound(reinterpret_cast<LPBYTE>(cell));
+        _ASSERT(it != std::begin(m_Slabs));
+        if (it == std::begin(m_Slabs))
+            return;
+        --it;
+
+        auto& slab = it->second;
+        const auto dwIndex = static_cast<DWORD>((reinterpret_cast<LPBYTE>(cell) - slab.pBase) / m_dwElementSize);
+        _ASSERT(dwIndex < m_dwCellsPerSlab && slab.Busy[dwIndex]);
+        if (dwIndex >= m_dwCellsPerSlab || !slab.Busy[dwIndex])
+            return;
+
+        if (!slab.HasRoom(m_dwCellsPerSlab))
+            m_Available.push_back(slab.pBase);
+
+        slab.Busy[dwIndex] = false;
+        slab.FreeCells.push_back(dwIndex);
+        slab.dwUsed--;
+        m_NumberOfAllocatedCells--;
+    }
+
+    // Give empty slabs back to the system, keeping one of them for the next allocations
+    void ReleaseEmptySlabs()
+    {
+        bool bKeptOne = false;
+        for (auto it = std::begin(m_Slabs); it != std::end(m_Slabs);)
+        {
+            if (it->second.dwUsed > 0 || !bKeptOne)
+            {
+                bKeptOne |= it->second.dwUsed == 0;
+                ++it;
+                continue;
+            }
+
+            VirtualFree(it->second.pBase, 0L, MEM_RELEASE);
+            MemoryAccounting::Release(m_Accounting, SlabBytes());
+            it = m_Slabs.erase(it);
+        }
+
+        // Stale entries of m_Available are skipped by GetNewCell
+    }
+
+    // Bulk release of every cell: objects living in the cells must have been destroyed by the caller
+    void Reset()
+    {
+        for (auto& [base, slab] : m_Slabs)
+        {
+            VirtualFree(slab.pBase, 0L, MEM_RELEASE);
+            MemoryAccounting::Release(m_Accounting, SlabBytes());
+        }
+        m_Slabs.clear();
+        m_Available.clear();
+        m_NumberOfAllocatedCells = 0L;
+    }
+
+    HRESULT EnumCells(std::function<void(void* lpData)> pCallback)
+    {
+        for (const auto& [base, slab] : m_Slabs)
+        {
+            for (DWORD i = 0; i < slab.dwNextUnused; i++)
+            {
+                if (slab.Busy[i])
+                    pCallback(slab.pBase + (static_cast<size_t>(i) * m_dwElementSize));
+            }
+        }
+        return S_OK;
+    }
+
+    ~SlabStorage() { Reset(); }
+
+private:
+    struct Slab
+    {
+        LPBYTE pBase = nullptr;
+        DWORD dwUsed = 0L;
+        DWORD dwNextUnused = 0L;
+        std::vector<DWORD> FreeCells;
+        std::vector<bool> Busy;
+
+        bool HasRoom(DWORD dwCellsPerSlab) const { return !FreeCells.empty() || dwNextUnused < dwCellsPerSlab; }
+    };
+
+    size_t SlabBytes() const { return static_cast<size_t>(m_dwCellsPerSlab) * m_dwElementSize; }
+
+    Slab* NewSlab()
+    {
+        const auto pBase =
+            reinterpret_cast<LPBYTE>(VirtualAlloc(NULL, SlabBytes(), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+        if (pBase == nullptr)
+            return nullptr;
+
+        auto& slab = m_Slabs[pBase];
+        slab.pBase = pBase;
+        slab.Busy.resize(m_dwCellsPerSlab, false);
+
+        m_Available.push_back(pBase);
+        MemoryAccounting::Charge(m_Accounting, SlabBytes());
+        m_PeakCommittedBytes = std::max(m_PeakCommittedBytes, CommittedBytes());
+        return &slab;
+    }
+
+    DWORD m_dwElementSize = 0L;
+    DWORD m_dwMaxObjects = 0L;
+    DWORD m_dwCellsPerSlab = 0L;
+    size_t m_NumberOfAllocatedCells = 0L;
+    size_t m_PeakAllocatedCells = 0L;
+    size_t m_PeakCommittedBytes = 0L;
+    bool m_Initialized = false;
+    MemoryAccounting::Tag m_Accounting = MemoryAccounting::Tag::Count;  // Count: not accounted
+
+    std::map<LPBYTE, Slab> m_Slabs;
+    std::vector<LPBYTE> m_Available;  // slabs with at least one free cell, the last one is used first
+
+    const LPCWSTR m_szStoreDescription;
+};
+
+}  // namespace Orc
+#pragma managed(pop)
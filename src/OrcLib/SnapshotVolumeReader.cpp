@@ -12,12 +12,24 @@
 
 #include "DiskExtent.h"
 
+#include <list>
 #include <regex>
 
 #include "Log/Log.h"
 
 using namespace Orc;
 
+namespace {
+
+std::mutex g_openSnapshotsLock;
+
+// Readers with an open snapshot device, most recently used first
+std::list<std::weak_ptr<VolumeReader>> g_openSnapshots;
+
+size_t g_maxOpenSnapshots = SnapshotVolumeReader::kDefaultMaxOpenSnapshots;
+
+}  // namespace
+
 std::shared_ptr<VolumeReader> SnapshotVolumeReader::DuplicateReader()
 {
     auto retval = std::make_shared<SnapshotVolumeReader>(m_Shadow);
@@ -31,10 +43,35 @@ SnapshotVolumeReader::SnapshotVolumeReader(const VolumeShadowCopies::Shadow& sha
 {
 }
 
+void SnapshotVolumeReader::SetMaxOpenSnapshots(size_t maxOpenSnapshots)
+{
+    std::lock_guard<std::mutex> lock(g_openSnapshotsLock);
+    g_maxOpenSnapshots = std::max<size_t>(maxOpenSnapshots, 1);
+}
+
+size_t SnapshotVolumeReader::GetMaxOpenSnapshots()
+{
+    std::lock_guard<std::mutex> lock(g_openSnapshotsLock);
+    return g_maxOpenSnapshots;
+}
+
+void SnapshotVolumeReader::SetVolumeProperties(ULONGLONG ullSerialNumber, FSVBR::FSType fsType)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (IsReady())
+        return;
+
+    m_llVolumeSerialNumber = ullSerialNumber;
+    m_fsType = fsType;
+}
+
 HRESULT SnapshotVolumeReader::LoadDiskProperties(void)
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
     if (IsReady())
         return S_OK;
 
@@ -49,15 +86,8 @@ HRESULT SnapshotVolumeReader::LoadDiskProperties(void)
         return E_INVALIDARG;
     }
 
-    CDiskExtent extent(m_Shadow.DeviceInstance.c_str());
-
-    if (FAILED(hr = extent.Open((FILE_SHARE_READ | FILE_SHARE_WRITE), OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN)))
-    {
-        Log::Error(L"Failed to open the drive '{}' [{}]", m_Shadow.DeviceInstance, SystemError(hr));
+    if (FAILED(hr = OpenSnapshot()))
         return hr;
-    }
-
-    m_Extents.push_back(std::move(extent));
 
     if (FAILED(hr = ParseBootSector()))
         return hr;
@@ -75,11 +105,161 @@ HRESULT SnapshotVolumeReader::LoadDiskProperties(void)
     if (SUCCEEDED(hr))
         m_bReadyForEnumeration = true;
 
+    Touch(*this);
+    return S_OK;
+}
+
+HRESULT SnapshotVolumeReader::OpenSnapshot()
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_bOpen)
+        return S_OK;
+
+    CDiskExtent extent(m_Shadow.DeviceInstance.c_str());
+
+    if (FAILED(hr = extent.Open((FILE_SHARE_READ | FILE_SHARE_WRITE), OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN)))
+    {
+        Log::Error(L"Failed to open the drive '{}' [{}]", m_Shadow.DeviceInstance, SystemError(hr));
+        return hr;
+    }
+
+    m_Extents.clear();
+    m_Extents.push_back(std::move(extent));
+    m_bOpen = true;
+
+    if (!IsReady())
+        return S_OK;
+
+    // Reopened after being closed: geometry comes from the boot sector
+    m_Extents[0].m_LogicalSectorSize = m_BytesPerSector;
+    m_Extents[0].m_Start = 0;
+    m_Extents[0].m_Length = m_NumberOfSectors * m_BytesPerSector;
+
+    Log::Debug(L"Reopened snapshot '{}'", m_Shadow.DeviceInstance);
+    return CompleteVolumeReader::Seek(m_ullPosition);
+}
+
+HRESULT SnapshotVolumeReader::EnsureOpen()
+{
+    HRESULT hr = E_FAIL;
+
+    if (!IsReady())
+        return LoadDiskProperties();
+
+    if (FAILED(hr = OpenSnapshot()))
+        return hr;
+
+    Touch(*this);
     return S_OK;
 }
 
+bool SnapshotVolumeReader::TryCloseSnapshot()
+{
+    std::unique_lock<std::recursive_mutex> lock(m_openLock, std::try_to_lock);
+    if (!lock.owns_lock() || !m_bOpen || m_bPinned || !IsReady())
+        return false;
+
+    m_ullPosition = CompleteVolumeReader::Position();
+    m_Extents.clear();
+    m_bOpen = false;
+
+    Log::Debug(L"Closed idle snapshot '{}'", m_Shadow.DeviceInstance);
+    return true;
+}
+
+void SnapshotVolumeReader::Touch(SnapshotVolumeReader& reader)
+{
+    const auto weak = reader.weak_from_this();
+    if (weak.expired())
+        return;
+
+    std::lock_guard<std::mutex> lock(g_openSnapshotsLock);
+
+    auto it = std::find_if(std::begin(g_openSnapshots), std::end(g_openSnapshots), [&reader](const auto& entry) {
+        return entry.lock().get() == &reader;
+    });
+
+    if (it != std::end(g_openSnapshots))
+        g_openSnapshots.splice(std::begin(g_openSnapshots), g_openSnapshots, it);
+    else
+        g_openSnapshots.push_front(weak);
+
+    // Close the least recently used snapshots, skipping the ones being read
+    auto candidate = std::end(g_openSnapshots);
+    while (g_openSnapshots.size() > g_maxOpenSnapshots && candidate != std::next(std::begin(g_openSnapshots)))
+    {
+        --candidate;
+
+        auto snapshot = std::static_pointer_cast<SnapshotVolumeReader>(candidate->lock());
+        if (snapshot == nullptr || snapshot->TryCloseSnapshot())
+            candidate = g_openSnapshots.erase(candidate);
+    }
+}
+
 SnapshotVolumeReader::~SnapshotVolumeReader(void) {}
 
+HRESULT SnapshotVolumeReader::Seek(ULONGLONG offset)
+{
+    HRESULT hr = E_FAIL;
+
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (FAILED(hr = EnsureOpen()))
+        return hr;
+
+    return CompleteVolumeReader::Seek(offset);
+}
+
+uint64_t SnapshotVolumeReader::Position() const
+{
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (!m_bOpen)
+        return m_ullPosition;
+
+    return CompleteVolumeReader::Position();
+}
+
+std::shared_ptr<VolumeReader> SnapshotVolumeReader::ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags)
+{
+    // The duplicate opens its own handle on the snapshot device, within the same limit
+    auto retval = DuplicateReader();
+
+    HRESULT hr = retval->LoadDiskProperties();
+    if (FAILED(hr))
+    {
+        Log::Debug(L"Failed to reopen snapshot '{}' [{}]", m_Shadow.DeviceInstance, SystemError(hr));
+    }
+
+    return retval;
+}
+
+HRESULT SnapshotVolumeReader::EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize)
+{
+    HRESULT hr = E_FAIL;
+
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (FAILED(hr = EnsureOpen()))
+        return hr;
+
+    m_bPinned = true;
+    return CompleteVolumeReader::EnableReadAhead(dwQueueDepth, dwChunkSize);
+}
+
+HRESULT SnapshotVolumeReader::Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (FAILED(hr = EnsureOpen()))
+        return hr;
+
+    return Read(CompleteVolumeReader::Position(), data, ullBytesToRead, ullBytesRead);
+}
+
 HRESULT
 SnapshotVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& buffer, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
 {
@@ -88,6 +268,11 @@ SnapshotVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& buffer, ULONGLONG ul
 
     ullBytesRead = 0;
 
+    std::lock_guard<std::recursive_mutex> lock(m_openLock);
+
+    if (FAILED(hr = EnsureOpen()))
+        return hr;
+
     Log::Trace("VSS: read (offset: {:#016x}, length: {})", offset, ullBytesToRead);
 
     if (!buffer.CheckCount(ullBytesToRead))
@@ -11,18 +11,29 @@
 #include "CompleteVolumeReader.h"
 #include "VolumeShadowCopies.h"
 
+#include <mutex>
+
 #pragma managed(push, off)
 
 namespace Orc {
 
+//
+// The snapshot device is opened by LoadDiskProperties or by the first read. The process keeps at most
+// GetMaxOpenSnapshots() snapshot devices open: the least recently used idle one is closed and reopened by its next read.
+//
 class SnapshotVolumeReader : public CompleteVolumeReader
 {
 protected:
     virtual std::shared_ptr<VolumeReader> DuplicateReader();
 
 public:
+    static constexpr size_t kDefaultMaxOpenSnapshots = 16;
+
     SnapshotVolumeReader(const VolumeShadowCopies::Shadow& Snapshot);
 
+    static void SetMaxOpenSnapshots(size_t maxOpenSnapshots);
+    static size_t GetMaxOpenSnapshots();
+
     void Accept(VolumeReaderVisitor& visitor) const override { return visitor.Visit(*this); }
 
     const WCHAR* ShortVolumeName() { return L"\\"; };
@@ -32,12 +43,41 @@ public:
 
     const GUID& GetSnapshotID() const { return m_Shadow.guid; }
 
+    // Serial number and file system of the original volume, reported until the snapshot is opened
+    void SetVolumeProperties(ULONGLONG ullSerialNumber, FSVBR::FSType fsType);
+
     ~SnapshotVolumeReader(void);
 
+    HRESULT Seek(ULONGLONG offset) override;
     HRESULT Read(ULONGLONG offset, CBinaryBuffer& buffer, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
 
+    uint64_t Position() const override;
+
+    std::shared_ptr<VolumeReader> ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags) override;
+
+    // Read ahead keeps using the device handle: the snapshot is not closed anymore
+    HRESULT EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize = 0L) override;
+
 protected:
+    HRESULT Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
+
     VolumeShadowCopies::Shadow m_Shadow;
+
+private:
+    // Open the snapshot device if it was closed, restoring the position (m_openLock held)
+    HRESULT OpenSnapshot();
+    HRESULT EnsureOpen();
+
+    // Close the snapshot device unless it is in use or pinned
+    bool TryCloseSnapshot();
+
+    // Mark the reader as the most recently used one and close the idle ones above the limit
+    static void Touch(SnapshotVolumeReader& reader);
+
+    mutable std::recursive_mutex m_openLock;
+    bool m_bOpen = false;
+    bool m_bPinned = false;
+    ULONGLONG m_ullPosition = 0LL;
 };
 
 }  // namespace Orc
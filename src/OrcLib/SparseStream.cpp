@@ -10,6 +10,16 @@
 
 #include "SparseStream.h"
 
+namespace {
+
+bool IsZeroed(const BYTE* pBytes, ULONGLONG cbBytes)
+{
+    // memcmp with itself shifted by one byte is vectorized by the CRT
+    return cbBytes == 0 || (pBytes[0] == 0 && memcmp(pBytes, pBytes + 1, static_cast<size_t>(cbBytes - 1)) == 0);
+}
+
+}  // namespace
+
 HRESULT Orc::SparseStream::OpenFile(
     __in PCWSTR pwzPath,
     __in DWORD dwDesiredAccess,
@@ -52,6 +62,106 @@ STDMETHODIMP Orc::SparseStream::SetSize(ULONG64 ullSize)
     return Orc::FileStream::SetSize(ullSize);
 }
 
+STDMETHODIMP Orc::SparseStream::Write_(
+    __in_bcount(cbBytes) const PVOID pBuffer,
+    __in ULONGLONG cbBytes,
+    __out PULONGLONG pcbBytesWritten)
+{
+    const auto pBytes = static_cast<const BYTE*>(pBuffer);
+    const auto chunkLength = [cbBytes](ULONGLONG ullOffset) {
+        return std::min(kSparseChunkSize, cbBytes - ullOffset);
+    };
+    const auto isHole = [pBytes, chunkLength](ULONGLONG ullOffset) {
+        const auto cbChunk = chunkLength(ullOffset);
+        return cbChunk == kSparseChunkSize && IsZeroed(pBytes + ullOffset, cbChunk);
+    };
+
+    *pcbBytesWritten = 0LL;
+
+    ULONGLONG ullOffset = 0LL;
+    while (ullOffset < cbBytes)
+    {
+        // Gather the chunks of the same kind in a single write or skip
+        const bool bHole = isHole(ullOffset);
+        ULONGLONG cbRun = chunkLength(ullOffset);
+        while (ullOffset + cbRun < cbBytes && cbRun < MAXDWORD - kSparseChunkSize && isHole(ullOffset + cbRun) == bHole)
+        {
+            cbRun += chunkLength(ullOffset + cbRun);
+        }
+
+        if (bHole)
+        {
+            if (auto hr = SkipZeroes(cbRun); FAILED(hr))
+                return hr;
+        }
+        else
+        {
+            ULONGLONG cbWritten = 0LL;
+            if (auto hr = FileStream::Write_(const_cast<BYTE*>(pBytes) + ullOffset, cbRun, &cbWritten); FAILED(hr))
+                return hr;
+
+            m_bTrailingHole = false;
+        }
+
+        ullOffset += cbRun;
+        *pcbBytesWritten = ullOffset;
+    }
+
+    return S_OK;
+}
+
+HRESULT Orc::SparseStream::SkipZeroes(ULONGLONG cbBytes)
+{
+    ULONG64 ullPosition = 0LL;
+    if (auto hr = FileStream::SetFilePointer(0LL, FILE_CURRENT, &ullPosition); FAILED(hr))
+        return hr;
+
+    // Previous content must be punched out when overwriting an existing file
+    const auto ullSize = FileStream::GetSize();
+    if (ullPosition < ullSize)
+    {
+        FILE_ZERO_DATA_INFORMATION zero;
+        zero.FileOffset.QuadPart = ullPosition;
+        zero.BeyondFinalZero.QuadPart = std::min(ullPosition + cbBytes, ullSize);
+
+        DWORD dwBytesReturned = 0L;
+        if (!DeviceIoControl(
+                m_hFile, FSCTL_SET_ZERO_DATA, &zero, sizeof(zero), NULL, 0L, &dwBytesReturned, NULL))
+        {
+            auto hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Error(L"Failed to zero range of sparse file '{}' [{}]", m_strPath, SystemError(hr));
+            return hr;
+        }
+    }
+
+    if (auto hr = FileStream::SetFilePointer(cbBytes, FILE_CURRENT, nullptr); FAILED(hr))
+        return hr;
+
+    m_bTrailingHole = ullPosition + cbBytes > ullSize;
+    m_ullSkippedBytes += cbBytes;
+    return S_OK;
+}
+
+STDMETHODIMP Orc::SparseStream::Close()
+{
+    if (m_bTrailingHole && m_hFile != INVALID_HANDLE_VALUE)
+    {
+        // Nothing was written after the last hole: extend the file to its logical size
+        ULONG64 ullPosition = 0LL;
+        if (SUCCEEDED(FileStream::SetFilePointer(0LL, FILE_CURRENT, &ullPosition)) && ullPosition > GetSize())
+        {
+            if (auto hr = FileStream::SetSize(ullPosition); FAILED(hr))
+            {
+                Log::Error(
+                    L"Failed to extend sparse file '{}' to {} bytes [{}]", m_strPath, ullPosition, SystemError(hr));
+            }
+        }
+        m_bTrailingHole = false;
+    }
+
+    return FileStream::Close();
+}
+
 STDMETHODIMP Orc::SparseStream::GetAllocatedRanges(std::vector<FILE_ALLOCATED_RANGE_BUFFER>& ranges)
 {
     FILE_ALLOCATED_RANGE_BUFFER queryrange;  // Range to be examined
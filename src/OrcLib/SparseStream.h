@@ -18,9 +18,14 @@
 
 namespace Orc {
 
+// File stream written as a sparse file: aligned runs of zeroes are not written but left (or punched) as holes, the
+// file is extended on close when it ends with a hole. Readers see the same logical content.
 class SparseStream : public FileStream
 {
 public:
+    // Zero runs shorter than this are written: holes are allocated by the file system in 64KB units
+    static constexpr ULONGLONG kSparseChunkSize = 64 * 1024;
+
     SparseStream()
         : FileStream()
     {
@@ -36,11 +41,23 @@ public:
         __in DWORD dwFlagsAndAttributes,
         __in_opt HANDLE hTemplate);
 
+    STDMETHOD(Write_)
+    (__in_bcount(cbBytes) const PVOID pBuffer, __in ULONGLONG cbBytes, __out PULONGLONG pcbBytesWritten);
+
     STDMETHOD(SetSize)(ULONG64 ullSize);
 
+    STDMETHOD(Close)();
+
     STDMETHOD(GetAllocatedRanges)(std::vector<FILE_ALLOCATED_RANGE_BUFFER>& ranges);
 
+    // Bytes left as holes by Write
+    ULONGLONG SkippedBytes() const { return m_ullSkippedBytes; }
+
 private:
+    HRESULT SkipZeroes(ULONGLONG cbBytes);
+
+    ULONGLONG m_ullSkippedBytes = 0LL;
+    bool m_bTrailingHole = false;
 };
 
 }  // namespace Orc
@@ -0,0 +1,138 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <optional>
+
+#include "ByteStream.h"
+#include "Stream/SeekDirection.h"
+#include "Utils/BufferView.h"
+#include "Utils/MetaPtr.h"
+#include "Utils/Result.h"
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// ByteStream over a stream concept: the boundary between a compile-time pipeline (CountStreamConcept,
+// HashStreamConcept, TeeStreamConcept, TransformStreamConcept, WofStreamConcept...) and the ByteStream consumers.
+// Calls inside the pipeline are resolved at compile time, only the outer one is virtual.
+//
+template <typename StreamT>
+class ConceptByteStream : public ByteStream
+{
+public:
+    // 'size' is returned by GetSize, pipeline stages do not know the size of their data
+    ConceptByteStream(StreamT stream, ULONG64 size)
+        : m_stream(std::move(stream))
+        , m_size(size)
+    {
+    }
+
+    STDMETHOD(IsOpen)() { return m_bOpen ? S_OK : S_FALSE; };
+    STDMETHOD(CanRead)() { return S_OK; };
+    STDMETHOD(CanWrite)() { return S_OK; };
+    STDMETHOD(CanSeek)() { return S_OK; };
+
+    STDMETHOD(SetFilePointer)
+    (__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer)
+    {
+        if (dwMoveMethod > FILE_END)
+            return E_INVALIDARG;
+
+        std::error_code ec;
+        const auto offset = m_stream->Seek(static_cast<SeekDirection>(dwMoveMethod), DistanceToMove, ec);
+        if (ec)
+        {
+            Log::Debug("Failed to seek pipeline [{}]", ec);
+            return GetHResult(ec);
+        }
+
+        if (pCurrPointer)
+            *pCurrPointer = offset;
+
+        return S_OK;
+    }
+
+    STDMETHOD_(ULONG64, GetSize)() { return m_size; }
+    STDMETHOD(SetSize)(ULONG64) { return E_NOTIMPL; }
+
+    STDMETHOD(Close)()
+    {
+        m_bOpen = false;
+        return S_OK;
+    }
+
+    const typename details::MetaPtr<StreamT>::element_type& Pipeline() const { return *m_stream; }
+    typename details::MetaPtr<StreamT>::element_type& Pipeline() { return *m_stream; }
+
+protected:
+    STDMETHOD(Read_)
+    (__out_bcount_part(cbBytesToRead, *pcbBytesRead) PVOID pBuffer,
+     __in ULONGLONG cbBytesToRead,
+     __out_opt PULONGLONG pcbBytesRead)
+    {
+        if (pcbBytesRead)
+            *pcbBytesRead = 0;
+
+        std::error_code ec;
+        const auto processed =
+            m_stream->Read(gsl::span<uint8_t>(reinterpret_cast<uint8_t*>(pBuffer), cbBytesToRead), ec);
+        if (ec)
+        {
+            Log::Debug("Failed to read pipeline [{}]", ec);
+            return GetHResult(ec);
+        }
+
+        if (pcbBytesRead)
+            *pcbBytesRead = processed;
+
+        return S_OK;
+    }
+
+    STDMETHOD(Write_)
+    (__in_bcount(cbBytes) const PVOID pBuffer, __in ULONGLONG cbBytes, __out_opt PULONGLONG pcbBytesWritten)
+    {
+        if (pcbBytesWritten)
+            *pcbBytesWritten = 0;
+
+        std::error_code ec;
+        BufferView input(reinterpret_cast<const uint8_t*>(pBuffer), cbBytes);
+        const auto processed = m_stream->Write(input, ec);
+        if (ec)
+        {
+            Log::Debug("Failed to write pipeline [{}]", ec);
+            return GetHResult(ec);
+        }
+
+        if (pcbBytesWritten)
+            *pcbBytesWritten = processed;
+
+        return S_OK;
+    }
+
+private:
+    static HRESULT GetHResult(const std::error_code& ec)
+    {
+        if (ec.category() != std::system_category())
+            return E_FAIL;
+
+        return Orc::ToHRESULT(ec);
+    }
+
+    MetaPtr<StreamT> m_stream;
+    ULONG64 m_size;
+    bool m_bOpen = true;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,66 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+
+#include <gsl/span>
+
+#include "Stream/SeekDirection.h"
+#include "Utils/BufferView.h"
+#include "Utils/MetaPtr.h"
+
+namespace Orc {
+
+//
+// Pipeline stage counting the bytes read from and written to 'StreamT'
+//
+template <typename StreamT>
+class CountStreamConcept
+{
+public:
+    explicit CountStreamConcept(StreamT stream)
+        : m_stream(std::move(stream))
+        , m_read(0)
+        , m_written(0)
+    {
+    }
+
+    CountStreamConcept(CountStreamConcept&&) = default;
+
+    size_t Read(gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        const auto processed = m_stream->Read(output, ec);
+        m_read += processed;
+        return processed;
+    }
+
+    size_t Write(BufferView input, std::error_code& ec)
+    {
+        const auto processed = m_stream->Write(input, ec);
+        m_written += processed;
+        return processed;
+    }
+
+    uint64_t Seek(SeekDirection direction, int64_t value, std::error_code& ec)
+    {
+        return m_stream->Seek(direction, value, ec);
+    }
+
+    uint64_t BytesRead() const { return m_read; }
+    uint64_t BytesWritten() const { return m_written; }
+
+private:
+    MetaPtr<StreamT> m_stream;
+    uint64_t m_read;
+    uint64_t m_written;
+};
+
+}  // namespace Orc
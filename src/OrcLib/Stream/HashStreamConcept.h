@@ -0,0 +1,97 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+
+#include <gsl/span>
+
+#include "Stream/SeekDirection.h"
+#include "Utils/BufferView.h"
+#include "Utils/MetaPtr.h"
+
+namespace Orc {
+
+//
+// Pipeline stage hashing the bytes read from or written to 'StreamT'
+//
+// HasherT provides 'void Update(const uint8_t* data, size_t size)' and is copyable (ShaExtensionsHash for example).
+// Like HashStream, seeking back to the beginning restarts the hash and any other seek invalidates it.
+//
+template <typename StreamT, typename HasherT>
+class HashStreamConcept
+{
+public:
+    HashStreamConcept(StreamT stream, HasherT hasher)
+        : m_stream(std::move(stream))
+        , m_initial(hasher)
+        , m_hasher(std::move(hasher))
+        , m_valid(true)
+    {
+    }
+
+    HashStreamConcept(HashStreamConcept&&) = default;
+
+    size_t Read(gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        const auto processed = m_stream->Read(output, ec);
+        if (processed)
+        {
+            m_hasher.Update(output.data(), processed);
+        }
+
+        return processed;
+    }
+
+    size_t Write(BufferView input, std::error_code& ec)
+    {
+        const auto processed = m_stream->Write(input, ec);
+        if (processed)
+        {
+            m_hasher.Update(input.data(), processed);
+        }
+
+        return processed;
+    }
+
+    uint64_t Seek(SeekDirection direction, int64_t value, std::error_code& ec)
+    {
+        const auto offset = m_stream->Seek(direction, value, ec);
+        if (ec)
+        {
+            return offset;
+        }
+
+        if (direction == SeekDirection::kBegin && value == 0)
+        {
+            m_hasher = m_initial;
+            m_valid = true;
+        }
+        else if (direction != SeekDirection::kCurrent || value != 0)
+        {
+            m_valid = false;
+        }
+
+        return offset;
+    }
+
+    // The hash covers the whole data only if the stream was processed sequentially from its beginning
+    bool IsValid() const { return m_valid; }
+
+    const HasherT& Hasher() const { return m_hasher; }
+
+private:
+    MetaPtr<StreamT> m_stream;
+    HasherT m_initial;
+    HasherT m_hasher;
+    bool m_valid;
+};
+
+}  // namespace Orc
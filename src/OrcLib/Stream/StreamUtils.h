@@ -32,6 +32,50 @@ size_t Read(InputStreamT& stream, gsl::span<CharT> output, std::error_code& ec)
     return stream.Read(span, ec);
 }
 
+/*!
+ * \brief Read 'stream' into each of 'outputs' in turn, stop on a short read.
+ */
+template <typename InputStreamT>
+size_t ReadV(InputStreamT& stream, gsl::span<const gsl::span<uint8_t>> outputs, std::error_code& ec)
+{
+    size_t processed = 0;
+
+    for (const auto& output : outputs)
+    {
+        const auto lastReadSize = stream.Read(output, ec);
+        processed += lastReadSize;
+
+        if (ec || lastReadSize != output.size())
+        {
+            return processed;
+        }
+    }
+
+    return processed;
+}
+
+/*!
+ * \brief Write each of 'inputs' in turn to 'stream', stop on a short write.
+ */
+template <typename OutputStreamT>
+size_t WriteV(OutputStreamT& stream, gsl::span<const BufferView> inputs, std::error_code& ec)
+{
+    size_t processed = 0;
+
+    for (auto input : inputs)
+    {
+        const auto lastWriteSize = stream.Write(input, ec);
+        processed += lastWriteSize;
+
+        if (ec || lastWriteSize != input.size())
+        {
+            return processed;
+        }
+    }
+
+    return processed;
+}
+
 /*!
  * \brief Read 'stream' until 'output' is completely filled.
  */
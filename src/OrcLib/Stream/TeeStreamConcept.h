@@ -0,0 +1,88 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+
+#include <gsl/span>
+
+#include "Log/Log.h"
+#include "Stream/SeekDirection.h"
+#include "Utils/BufferView.h"
+#include "Utils/MetaPtr.h"
+
+namespace Orc {
+
+//
+// Pipeline stage copying the bytes read from or written to 'StreamT' into 'OutputStreamT'
+//
+// A failure to write a copy fails the operation, the bytes are then still processed by 'StreamT'.
+//
+template <typename StreamT, typename OutputStreamT>
+class TeeStreamConcept
+{
+public:
+    TeeStreamConcept(StreamT stream, OutputStreamT output)
+        : m_stream(std::move(stream))
+        , m_output(std::move(output))
+    {
+    }
+
+    TeeStreamConcept(TeeStreamConcept&&) = default;
+
+    size_t Read(gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        const auto processed = m_stream->Read(output, ec);
+        if (processed)
+        {
+            Copy(BufferView(output.data(), processed), ec);
+        }
+
+        return processed;
+    }
+
+    size_t Write(BufferView input, std::error_code& ec)
+    {
+        const auto processed = m_stream->Write(input, ec);
+        if (processed)
+        {
+            Copy(BufferView(input.data(), processed), ec);
+        }
+
+        return processed;
+    }
+
+    uint64_t Seek(SeekDirection direction, int64_t value, std::error_code& ec)
+    {
+        return m_stream->Seek(direction, value, ec);
+    }
+
+    const OutputStreamT& Output() const { return *m_output; }
+
+private:
+    void Copy(BufferView input, std::error_code& ec)
+    {
+        std::error_code copyEc;
+        const auto processed = m_output->Write(input, copyEc);
+        if (copyEc || processed != input.size())
+        {
+            Log::Debug("Failed to write tee output ({}/{}) [{}]", processed, input.size(), copyEc);
+            if (!ec)
+            {
+                ec = copyEc ? copyEc : std::make_error_code(std::errc::io_error);
+            }
+        }
+    }
+
+    MetaPtr<StreamT> m_stream;
+    MetaPtr<OutputStreamT> m_output;
+};
+
+}  // namespace Orc
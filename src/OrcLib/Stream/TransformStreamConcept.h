@@ -0,0 +1,86 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#include <gsl/span>
+
+#include "Stream/SeekDirection.h"
+#include "Utils/BufferView.h"
+#include "Utils/MetaPtr.h"
+
+namespace Orc {
+
+//
+// Pipeline stage transforming in place the bytes read from or written to 'StreamT'
+//
+// TransformT provides 'void Transform(gsl::span<uint8_t> data, uint64_t offset)' where 'offset' is the position of
+// 'data' in the stream, for transformations which are not size changing: stream ciphers, masks...
+//
+template <typename StreamT, typename TransformT>
+class TransformStreamConcept
+{
+public:
+    TransformStreamConcept(StreamT stream, TransformT transform)
+        : m_stream(std::move(stream))
+        , m_transform(std::move(transform))
+        , m_offset(0)
+    {
+    }
+
+    TransformStreamConcept(TransformStreamConcept&&) = default;
+
+    size_t Read(gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        const auto processed = m_stream->Read(output, ec);
+        if (processed)
+        {
+            m_transform.Transform(output.subspan(0, processed), m_offset);
+            m_offset += processed;
+        }
+
+        return processed;
+    }
+
+    size_t Write(BufferView input, std::error_code& ec)
+    {
+        // Input is read-only, transform a copy
+        m_buffer.assign(std::cbegin(input), std::cend(input));
+        m_transform.Transform(gsl::span<uint8_t>(m_buffer.data(), m_buffer.size()), m_offset);
+
+        BufferView transformed(m_buffer.data(), m_buffer.size());
+        const auto processed = m_stream->Write(transformed, ec);
+        m_offset += processed;
+        return processed;
+    }
+
+    uint64_t Seek(SeekDirection direction, int64_t value, std::error_code& ec)
+    {
+        const auto offset = m_stream->Seek(direction, value, ec);
+        if (!ec)
+        {
+            m_offset = offset;
+        }
+
+        return offset;
+    }
+
+    const TransformT& Transform() const { return m_transform; }
+
+private:
+    MetaPtr<StreamT> m_stream;
+    TransformT m_transform;
+    uint64_t m_offset;
+    std::vector<uint8_t> m_buffer;
+};
+
+}  // namespace Orc
@@ -11,6 +11,12 @@
 
 #include "WideAnsi.h"
 #include "BinaryBuffer.h"
+#include "SimdDispatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_STRINGS_SIMD
+#endif
 
 using namespace std;
 using namespace Orc;
@@ -280,6 +286,188 @@ static bool isAscii[0x100] =
         false,
         false};
 
+namespace {
+
+// First bytes of the supported x86 string pushes (0x66 is printable)
+inline bool IsPushLead(UCHAR c)
+{
+    return c == 0xC6 || c == 0xC7;
+}
+
+struct ScanKernel
+{
+    // Offset of the first byte, at or after 'offset', which may start a string or a string push
+    size_t (*NextCandidate)(const BYTE* pData, size_t offset, size_t cbData);
+
+    // Count of printable ascii characters at 'pData'
+    size_t (*AsciiRun)(const BYTE* pData, size_t cbData);
+
+    // Count of UTF-16LE characters at 'pData' which are printable ascii characters
+    size_t (*Utf16Run)(const BYTE* pData, size_t cbData);
+};
+
+#ifdef ORC_STRINGS_SIMD
+
+// Bit masks of a block of bytes: printable ascii characters, zeroes and string push first bytes
+struct BlockMasks
+{
+    uint32_t printable;
+    uint32_t zero;
+    uint32_t pushLead;
+};
+
+template <bool bAVX2>
+constexpr size_t kBlockSize = bAVX2 ? 32 : 16;
+
+template <bool bAVX2>
+constexpr uint32_t kBlockMask = bAVX2 ? 0xFFFFFFFF : 0x0000FFFF;
+
+template <bool bAVX2>
+BlockMasks Classify(const BYTE* p)
+{
+    if constexpr (bAVX2)
+    {
+        const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+
+        // Signed comparisons: bytes above 0x7F are negative
+        const auto inRange = _mm256_and_si256(
+            _mm256_cmpgt_epi8(bytes, _mm256_set1_epi8(0x1F)), _mm256_cmpgt_epi8(_mm256_set1_epi8(0x7F), bytes));
+        const auto controls = _mm256_or_si256(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x09)), _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x0A))),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(0x0D)));
+        const auto pushLead = _mm256_or_si256(
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(static_cast<char>(0xC6))),
+            _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(static_cast<char>(0xC7))));
+
+        return {
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(inRange, controls))),
+            static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, _mm256_setzero_si256()))),
+            static_cast<uint32_t>(_mm256_movemask_epi8(pushLead))};
+    }
+    else
+    {
+        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+        const auto inRange =
+            _mm_and_si128(_mm_cmpgt_epi8(bytes, _mm_set1_epi8(0x1F)), _mm_cmplt_epi8(bytes, _mm_set1_epi8(0x7F)));
+        const auto controls = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x09)), _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x0A))),
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(0x0D)));
+        const auto pushLead = _mm_or_si128(
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(0xC6))),
+            _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(0xC7))));
+
+        return {
+            static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(inRange, controls))),
+            static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128()))),
+            static_cast<uint32_t>(_mm_movemask_epi8(pushLead))};
+    }
+}
+
+inline size_t FirstBit(uint32_t mask)
+{
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return index;
+}
+
+template <bool bAVX2>
+size_t NextCandidateSimd(const BYTE* pData, size_t offset, size_t cbData)
+{
+    for (; offset + kBlockSize<bAVX2> <= cbData; offset += kBlockSize<bAVX2>)
+    {
+        const auto masks = Classify<bAVX2>(pData + offset);
+        if (const auto candidates = masks.printable | masks.pushLead)
+            return offset + FirstBit(candidates);
+    }
+
+    while (offset < cbData && !isAscii[pData[offset]] && !IsPushLead(pData[offset]))
+        offset++;
+
+    return offset;
+}
+
+template <bool bAVX2>
+size_t AsciiRunSimd(const BYTE* pData, size_t cbData)
+{
+    size_t i = 0;
+    for (; i + kBlockSize<bAVX2> <= cbData; i += kBlockSize<bAVX2>)
+    {
+        if (const auto others = ~Classify<bAVX2>(pData + i).printable & kBlockMask<bAVX2>)
+            return i + FirstBit(others);
+    }
+
+    while (i < cbData && isAscii[pData[i]])
+        i++;
+
+    return i;
+}
+
+template <bool bAVX2>
+size_t Utf16RunSimd(const BYTE* pData, size_t cbData)
+{
+    // Characters start on even bits: printable low byte followed by a zero high byte
+    constexpr uint32_t kCharBits = 0x55555555 & kBlockMask<bAVX2>;
+
+    size_t i = 0;
+    for (; i + kBlockSize<bAVX2> <= cbData; i += kBlockSize<bAVX2>)
+    {
+        const auto masks = Classify<bAVX2>(pData + i);
+        if (const auto others = ~(masks.printable & (masks.zero >> 1)) & kCharBits)
+            return (i + FirstBit(others)) / 2;
+    }
+
+    while (i + 1 < cbData && isAscii[pData[i]] && pData[i + 1] == 0)
+        i += 2;
+
+    return i / 2;
+}
+
+#endif  // ORC_STRINGS_SIMD
+
+size_t NextCandidateScalar(const BYTE* pData, size_t offset, size_t cbData)
+{
+    while (offset < cbData && !isAscii[pData[offset]] && !IsPushLead(pData[offset]))
+        offset++;
+
+    return offset;
+}
+
+size_t AsciiRunScalar(const BYTE* pData, size_t cbData)
+{
+    size_t i = 0;
+    while (i < cbData && isAscii[pData[i]])
+        i++;
+
+    return i;
+}
+
+size_t Utf16RunScalar(const BYTE* pData, size_t cbData)
+{
+    size_t i = 0;
+    while (i + 1 < cbData && isAscii[pData[i]] && pData[i + 1] == 0)
+        i += 2;
+
+    return i / 2;
+}
+
+const ScanKernel& Kernel()
+{
+    static const SimdDispatch::Kernel<ScanKernel> kernel(
+        L"strings_scan",
+        {
+#ifdef ORC_STRINGS_SIMD
+            {SimdDispatch::Level::AVX2, {NextCandidateSimd<true>, AsciiRunSimd<true>, Utf16RunSimd<true>}},
+            {SimdDispatch::Level::SSE2, {NextCandidateSimd<false>, AsciiRunSimd<false>, Utf16RunSimd<false>}},
+#endif
+            {SimdDispatch::Level::Scalar, {NextCandidateScalar, AsciiRunScalar, Utf16RunScalar}}});
+
+    return kernel.Get();
+}
+
+}  // namespace
+
 HRESULT StringsStream::OpenForStrings(const shared_ptr<ByteStream>& pChained, size_t minChars, size_t maxChars)
 {
     if (pChained == NULL)
@@ -554,41 +742,38 @@ size_t StringsStream::extractString(
             // Try to parse as ascii or unicode
             if (isAscii[aBuffer.Get<UCHAR>(offset)])
             {
+                const auto pData = aBuffer.GetData() + offset;
+                const auto cbData = aBuffer.GetCount() - offset;
+
                 // Consider unicode case
                 if (aBuffer.Get<UCHAR>(offset + 1) == 0)  // No null dereference by assumptions
                 {
                     // Parse as unicode
-                    size_t i = 0;
-                    while (offset + i + 1 < aBuffer.GetCount() && i / 2 < m_Strings.GetCount()
-                           && isAscii[aBuffer.Get<UCHAR>(offset + i)] && aBuffer.Get<UCHAR>(offset + i + 1) == 0
-                           && i / 2 + 1 < m_Strings.GetCount())
-                    {
-                        // Copy this character
-                        m_Strings.CheckCount(m_cchExtracted + 1);
-                        m_Strings.Get<UCHAR>(m_cchExtracted) = aBuffer.Get<UCHAR>(offset + i);
-                        i += 2;
-                        m_cchExtracted++;
-                    }
+                    const auto cch = Kernel().Utf16Run(pData, cbData);
+                    if (!m_Strings.CheckCount((m_cchExtracted + cch) * sizeof(UCHAR)))
+                        return 0;
+
+                    // Copy the low bytes of the characters to the output
+                    const auto pOutput = m_Strings.GetData() + m_cchExtracted * sizeof(UCHAR);
+                    for (size_t i = 0; i < cch; i++)
+                        pOutput[i] = pData[i * 2];
+
+                    m_cchExtracted += cch;
                     stringType = TYPE_UNICODE;
-                    return i;
+                    return cch * 2;
                 }
                 else
                 {
                     // Parse as ascii
-                    size_t i = offset;
-                    while (i < aBuffer.GetCount() && isAscii[aBuffer.Get<UCHAR>(i)])
-                        i++;
-
-                    m_Strings.CheckCount((m_cchExtracted + (i - offset)) * sizeof(UCHAR));
+                    const auto cch = Kernel().AsciiRun(pData, cbData);
+                    if (!m_Strings.CheckCount((m_cchExtracted + cch) * sizeof(UCHAR)))
+                        return 0;
 
                     // Copy this string to the output
-                    memcpy(
-                        (LPBYTE)m_Strings.GetData() + (m_cchExtracted * sizeof(UCHAR)),
-                        aBuffer.GetData() + offset,
-                        (i - offset) * sizeof(UCHAR));
-                    m_cchExtracted += i - offset;
+                    memcpy(m_Strings.GetData() + (m_cchExtracted * sizeof(UCHAR)), pData, cch * sizeof(UCHAR));
+                    m_cchExtracted += cch;
                     stringType = TYPE_ASCII;
-                    return i - offset;
+                    return cch;
                 }
             }
     }
@@ -596,25 +781,40 @@ size_t StringsStream::extractString(
     return 0;
 }
 
-HRESULT StringsStream::processBuffer(const CBinaryBuffer& aBuffer, CBinaryBuffer& strings)
+HRESULT StringsStream::processBuffer(const CBinaryBuffer& aBuffer)
 {
     // Process the contents of the specified file, and build the list of strings
-    strings.CheckCount(MAX_STRING_SIZE + 1);
+    const auto& kernel = Kernel();
+    const auto cbBuffer = aBuffer.GetCount();
+
+    // Extracted strings are not longer than the bytes they come from, each followed by a line break: the output cannot
+    // outgrow this and is not reallocated while extracting
+    const auto cbMaxStrings = cbBuffer + 2 * (cbBuffer / std::max<size_t>(m_minChars, 1) + 1) + MAX_STRING_SIZE;
+    if (!m_Strings.CheckCount(cbMaxStrings))
+        return E_OUTOFMEMORY;
+
     m_cchExtracted = 0;
 
     size_t offset = 0;
     ExtractType extractType;
-    while (offset + m_minChars < aBuffer.GetCount())
+    while (offset + m_minChars < cbBuffer)
     {
+        // Skip the bytes which can start neither a string nor a string push
+        offset = kernel.NextCandidate(aBuffer.GetData(), offset, cbBuffer);
+        if (offset + m_minChars >= cbBuffer)
+            break;
+
         // Process this offset
         UTF16Type stringType = TYPE_UNDETERMINED;
         size_t cchPreviouslyExtracted = m_cchExtracted;
         size_t cbProcessed = extractString(aBuffer, offset, extractType, stringType);
 
-        if ((m_cchExtracted - cchPreviouslyExtracted) >= m_minChars)
+        if (cbProcessed > 0 && (m_cchExtracted - cchPreviouslyExtracted) >= m_minChars)
         {
-            // Do something
-            m_Strings.CheckCount(m_cchExtracted + 2);
+            // Longer strings are truncated, their remaining characters are skipped
+            if (m_maxChars > 0 && m_cchExtracted - cchPreviouslyExtracted > m_maxChars)
+                m_cchExtracted = cchPreviouslyExtracted + m_maxChars;
+
             m_Strings.Get<UCHAR>(m_cchExtracted) = '\r';
             m_Strings.Get<UCHAR>(m_cchExtracted + 1) = '\n';
             m_cchExtracted += 2;
@@ -629,7 +829,7 @@ HRESULT StringsStream::processBuffer(const CBinaryBuffer& aBuffer, CBinaryBuffer
         }
     }
 
-    return true;
+    return S_OK;
 }
 
 HRESULT StringsStream::Read_(
@@ -655,9 +855,6 @@ HRESULT StringsStream::Read_(
 
     ULONGLONG cbBytesRead = 0LL;
 
-    CBinaryBuffer buffer;
-    buffer.SetCount(static_cast<size_t>(cbBytes) + m_maxChars);
-
     if (FAILED(hr = m_pChainedStream->Read(pReadBuffer, cbBytes, &cbBytesRead)))
         return hr;
 
@@ -665,8 +862,7 @@ HRESULT StringsStream::Read_(
         return S_OK;
 
     // Extract Strings here...
-    CBinaryBuffer strings;
-    if (FAILED(hr = processBuffer(CBinaryBuffer((LPBYTE)pReadBuffer, static_cast<size_t>(cbBytesRead)), strings)))
+    if (FAILED(hr = processBuffer(CBinaryBuffer((LPBYTE)pReadBuffer, static_cast<size_t>(cbBytesRead)))))
     {
         Log::Error(L"Failed to extract strings from read buffer [{}]", SystemError(hr));
         return hr;
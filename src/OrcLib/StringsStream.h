@@ -38,6 +38,7 @@ public:
     } UTF16Type;
 
 private:
+    // Extracted strings, separated by line breaks: reserved once per read and reused across reads
     CBinaryBuffer m_Strings;
     size_t m_cchExtracted;
 
@@ -47,7 +48,7 @@ private:
     size_t extractImmediate(const CBinaryBuffer& aBuffer, UTF16Type& stringType);
     size_t extractString(const CBinaryBuffer& aBuffer, size_t offset, ExtractType& extractType, UTF16Type& stringType);
 
-    HRESULT processBuffer(const CBinaryBuffer& aBuffer, CBinaryBuffer& strings);
+    HRESULT processBuffer(const CBinaryBuffer& aBuffer);
 
 public:
     StringsStream()
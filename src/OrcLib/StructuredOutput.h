@@ -221,6 +221,8 @@ class IWriter : public IOutput
 public:
     using Ptr = std::shared_ptr<IWriter>;
 
+    // Write what is buffered to the output stream, the document stays open
+    virtual HRESULT Flush() PURE;
     virtual HRESULT Close() PURE;
 };
 
@@ -0,0 +1,289 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "BufferPool.h"
+#include "ByteStream.h"
+#include "Text/Utf16ToUtf8.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#pragma managed(push, off)
+
+namespace Orc::StructuredOutput {
+
+//
+// OutputBuffer: write buffer of the JSON and XML writers, in the encoding of the output (char for UTF-8, WCHAR for
+// UTF-16).
+//
+// The buffer is a block of the BufferPool, large enough for the stream to see a few large writes instead of one per
+// kilobyte. UTF-16 text is appended with AppendText: it is transcoded in bulk when the output is UTF-8.
+//
+template <typename CharT>
+class OutputBuffer
+{
+public:
+    static_assert(sizeof(CharT) == sizeof(char) || sizeof(CharT) == sizeof(WCHAR));
+
+    static constexpr size_t kDefaultSize = 256 * 1024;
+
+    OutputBuffer(std::shared_ptr<ByteStream> stream, size_t cbSize = kDefaultSize)
+        : m_stream(std::move(stream))
+    {
+        m_cbBlock = cbSize;
+        m_pBlock = BufferPool::Instance().Allocate(m_cbBlock);
+        if (m_pBlock == nullptr)
+        {
+            m_cbBlock = BufferPool::kMinBlockSize;
+            m_pBlock = BufferPool::Instance().Allocate(m_cbBlock);
+        }
+
+        m_capacity = m_pBlock ? BufferPool::BlockSize(m_cbBlock) / sizeof(CharT) : 0;
+    }
+
+    OutputBuffer(OutputBuffer&& other) noexcept
+        : m_stream(std::move(other.m_stream))
+        , m_pBlock(std::exchange(other.m_pBlock, nullptr))
+        , m_cbBlock(other.m_cbBlock)
+        , m_capacity(std::exchange(other.m_capacity, 0))
+        , m_size(std::exchange(other.m_size, 0))
+    {
+    }
+
+    OutputBuffer(const OutputBuffer&) = delete;
+    OutputBuffer& operator=(const OutputBuffer&) = delete;
+
+    ~OutputBuffer()
+    {
+        if (m_pBlock)
+            BufferPool::Instance().Free(m_pBlock, m_cbBlock);
+    }
+
+    const std::shared_ptr<ByteStream>& GetStream() const { return m_stream; }
+
+    HRESULT Put(CharT c)
+    {
+        if (m_size == m_capacity)
+        {
+            if (auto hr = Reserve(1); FAILED(hr))
+                return hr;
+        }
+
+        Data()[m_size++] = c;
+        return S_OK;
+    }
+
+    HRESULT Append(std::basic_string_view<CharT> text)
+    {
+        while (!text.empty())
+        {
+            if (m_size == m_capacity)
+            {
+                if (auto hr = Reserve(1); FAILED(hr))
+                    return hr;
+            }
+
+            const auto count = std::min(text.size(), m_capacity - m_size);
+            std::copy_n(text.data(), count, Data() + m_size);
+            m_size += count;
+            text.remove_prefix(count);
+        }
+
+        return S_OK;
+    }
+
+    HRESULT AppendAscii(std::string_view text)
+    {
+        if constexpr (sizeof(CharT) == sizeof(char))
+        {
+            return Append(text);
+        }
+        else
+        {
+            for (const auto c : text)
+            {
+                if (auto hr = Put(static_cast<CharT>(c)); FAILED(hr))
+                    return hr;
+            }
+
+            return S_OK;
+        }
+    }
+
+    HRESULT AppendText(std::wstring_view text)
+    {
+        if constexpr (sizeof(CharT) == sizeof(WCHAR))
+        {
+            return Append(text);
+        }
+        else
+        {
+            while (!text.empty())
+            {
+                auto count = std::min(text.size(), (m_capacity - m_size) / Text::Utf8MaxLength(1));
+
+                // Surrogate pairs are converted together
+                if (count < text.size() && count > 1 && IS_HIGH_SURROGATE(text[count - 1]))
+                    count--;
+
+                if (count < 2 && count < text.size())
+                {
+                    if (auto hr = Reserve(Text::Utf8MaxLength(2)); FAILED(hr))
+                        return hr;
+                    continue;
+                }
+
+                m_size += Text::ConvertUtf16ToUtf8(text.substr(0, count), Data() + m_size);
+                text.remove_prefix(count);
+            }
+
+            return S_OK;
+        }
+    }
+
+    // Write the buffer to the stream, the buffer is emptied even if the write fails
+    HRESULT Flush()
+    {
+        if (m_size == 0)
+            return S_OK;
+
+        const ULONGLONG cbBytes = m_size * sizeof(CharT);
+        m_size = 0;
+
+        ULONGLONG cbWritten = 0LL;
+        if (auto hr = m_stream->Write(m_pBlock, cbBytes, &cbWritten); FAILED(hr))
+            return hr;
+
+        if (cbWritten != cbBytes)
+            return HRESULT_FROM_WIN32(ERROR_WRITE_FAULT);
+
+        return S_OK;
+    }
+
+private:
+    CharT* Data() { return reinterpret_cast<CharT*>(m_pBlock); }
+
+    HRESULT Reserve(size_t count)
+    {
+        if (m_capacity < count)
+            return E_OUTOFMEMORY;
+
+        if (m_capacity - m_size < count)
+            return Flush();
+
+        return S_OK;
+    }
+
+    std::shared_ptr<ByteStream> m_stream;
+    BYTE* m_pBlock = nullptr;
+    size_t m_cbBlock = 0;
+    size_t m_capacity = 0;
+    size_t m_size = 0;
+};
+
+//
+// StringOutput: output of the Text/Escape.h helpers to a string, for values encoded once and reused
+//
+template <typename CharT>
+class StringOutput
+{
+public:
+    StringOutput(std::basic_string<CharT>& str)
+        : m_str(str)
+    {
+    }
+
+    HRESULT AppendAscii(std::string_view text)
+    {
+        m_str.append(text.cbegin(), text.cend());
+        return S_OK;
+    }
+
+    HRESULT AppendText(std::wstring_view text)
+    {
+        if constexpr (sizeof(CharT) == sizeof(WCHAR))
+            m_str.append(text);
+        else
+            Text::AppendUtf16ToUtf8(text, m_str);
+
+        return S_OK;
+    }
+
+private:
+    std::basic_string<CharT>& m_str;
+};
+
+//
+// NameCache: encoded form of the element, attribute and key names, which are nearly always the same few string
+// literals written again for every item.
+//
+// Entries are keyed by the name pointer and compared with the name on lookup: a buffer reused for another name is just
+// a miss. Once kMaxEntries names are cached, other names are encoded on each use.
+//
+template <typename CharT>
+class NameCache
+{
+public:
+    static constexpr size_t kMaxEntries = 4096;
+
+    // 'encode' is called as 'HRESULT encode(std::wstring_view name, std::basic_string<CharT>& encoded)' on misses, the
+    // returned view is valid until the next call to Get
+    template <typename Encode>
+    HRESULT Get(LPCWSTR szName, std::basic_string_view<CharT>& encoded, Encode&& encode)
+    {
+        auto it = m_entries.find(szName);
+        if (it != m_entries.end() && it->second.Name == szName)
+        {
+            encoded = it->second.Encoded;
+            return S_OK;
+        }
+
+        Entry entry;
+        entry.Name = szName;
+        if (auto hr = encode(std::wstring_view(entry.Name), entry.Encoded); FAILED(hr))
+            return hr;
+
+        if (it != m_entries.end())
+        {
+            it->second = std::move(entry);
+            encoded = it->second.Encoded;
+        }
+        else if (m_entries.size() < kMaxEntries)
+        {
+            encoded = m_entries.emplace(szName, std::move(entry)).first->second.Encoded;
+        }
+        else
+        {
+            m_uncached = std::move(entry.Encoded);
+            encoded = m_uncached;
+        }
+
+        return S_OK;
+    }
+
+private:
+    struct Entry
+    {
+        std::wstring Name;
+        std::basic_string<CharT> Encoded;
+    };
+
+    std::unordered_map<LPCWSTR, Entry> m_entries;
+    std::basic_string<CharT> m_uncached;
+};
+
+}  // namespace Orc::StructuredOutput
+
+#pragma managed(pop)
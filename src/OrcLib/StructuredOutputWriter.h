@@ -41,6 +41,8 @@ struct Options : public StructuredOutput::Options
 namespace XML {
 struct Options : public StructuredOutput::Options
 {
+    // Serialize with XmlLite instead of the buffered emitter (see XmlEmitter.h)
+    bool bXmlLite = false;
 };
 }  // namespace XML
 
@@ -11,6 +11,9 @@
 #include "SystemDetails.h"
 
 #include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 #include <WinNls.h>
 #include <WinError.h>
@@ -24,6 +27,7 @@
 #include "WideAnsi.h"
 #include "WMIUtil.h"
 #include "BinaryBuffer.h"
+#include "Text/Iconv.h"
 #include "Utils/Time.h"
 #include "Utils/TypeTraits.h"
 
@@ -52,11 +56,320 @@ struct SystemDetailsBlock
     bool bIsElevated = false;
     DWORD dwLargePageSize = 0L;
     WMI wmi;
+
+    // Serializes the use of 'wmi' by the callers and the prefetch thread, and guards the query results below
+    std::mutex wmiLock;
+    std::optional<std::vector<SystemDetails::CPUInformation>> CPUs;
+    std::optional<std::vector<SystemDetails::PhysicalDrive>> PhysicalDrives;
+    std::optional<std::vector<SystemDetails::MountedVolume>> MountedVolumes;
+    std::optional<std::vector<SystemDetails::QFE>> QFEs;
+    std::thread WMIPrefetch;
+
+    ~SystemDetailsBlock()
+    {
+        if (WMIPrefetch.joinable())
+            WMIPrefetch.join();
+    }
 };
 }  // namespace Orc
 
 std::unique_ptr<SystemDetailsBlock> g_pDetailsBlock;
 
+namespace {
+
+constexpr auto OrcSystemDetailsEnv = L"DFIR-ORC_SYSTEM_DETAILS";
+
+constexpr auto kUserFile = L"user.tsv";
+constexpr auto kCPUsFile = L"cpus.tsv";
+constexpr auto kPhysicalDrivesFile = L"drives.tsv";
+constexpr auto kMountedVolumesFile = L"volumes.tsv";
+constexpr auto kQFEsFile = L"qfes.tsv";
+
+using Record = std::vector<std::wstring>;
+
+// Snapshot files have the format of LocationCache's: one tab separated record per line, written to a temporary name
+// and renamed so that concurrent processes never load a partial one
+std::optional<std::vector<Record>> ReadRecords(LPCWSTR szName)
+{
+    const auto directory = SystemDetails::GetSnapshotDirectory();
+    if (!directory)
+        return std::nullopt;
+
+    const auto path = std::filesystem::path(*directory) / szName;
+
+    std::ifstream ifs(path, std::ios_base::binary);
+    if (!ifs)
+        return std::nullopt;
+
+    std::vector<Record> records;
+    std::string line;
+    while (std::getline(ifs, line))
+    {
+        Record record;
+
+        size_t start = 0;
+        for (;;)
+        {
+            const auto end = line.find('\t', start);
+
+            std::error_code ec;
+            record.push_back(ToUtf16(std::string_view(line).substr(start, end - start), ec));
+            if (ec)
+            {
+                Log::Debug(L"Invalid record in system details snapshot file '{}' [{}]", path.wstring(), ec);
+                return std::nullopt;
+            }
+
+            if (end == std::string::npos)
+                break;
+
+            start = end + 1;
+        }
+
+        records.push_back(std::move(record));
+    }
+
+    return records;
+}
+
+HRESULT WriteRecords(LPCWSTR szName, const std::vector<Record>& records)
+{
+    const auto directory = SystemDetails::GetSnapshotDirectory();
+    if (!directory)
+        return S_FALSE;
+
+    const auto path = std::filesystem::path(*directory) / szName;
+
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec))
+        return S_FALSE;
+
+    const auto tempPath = std::filesystem::path(*directory) / fmt::format(L"{}.{}.tmp", szName, GetCurrentProcessId());
+
+    {
+        std::ofstream ofs(tempPath, std::ios_base::binary | std::ios_base::trunc);
+        if (!ofs)
+        {
+            Log::Debug(L"Failed to create system details snapshot file '{}'", tempPath.wstring());
+            return E_FAIL;
+        }
+
+        for (const auto& record : records)
+        {
+            for (size_t i = 0; i < record.size(); i++)
+            {
+                if (record[i].find_first_of(L"\t\r\n") != std::wstring::npos)
+                {
+                    Log::Debug(L"Cannot save '{}' to system details snapshot file '{}'", record[i], path.wstring());
+                    ofs.close();
+                    std::filesystem::remove(tempPath, ec);
+                    return E_INVALIDARG;
+                }
+
+                if (i > 0)
+                    ofs << '\t';
+
+                ofs << ToUtf8(record[i], ec);
+            }
+
+            ofs << '\n';
+        }
+
+        ofs.close();
+        if (ofs.fail())
+        {
+            Log::Debug(L"Failed to write system details snapshot file '{}'", tempPath.wstring());
+            std::filesystem::remove(tempPath, ec);
+            return E_FAIL;
+        }
+    }
+
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_WRITE_THROUGH))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        std::filesystem::remove(tempPath, ec);
+
+        // Another process saved it first
+        if (hr == HRESULT_FROM_WIN32(ERROR_ALREADY_EXISTS) || hr == HRESULT_FROM_WIN32(ERROR_FILE_EXISTS))
+            return S_FALSE;
+
+        Log::Debug(L"Failed to rename system details snapshot file '{}' [{}]", tempPath.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+template <typename T>
+std::wstring ToField(const T& value)
+{
+    if constexpr (std::is_same_v<T, std::wstring>)
+        return value;
+    else
+        return std::to_wstring(value);
+}
+
+// Optional values are prefixed with '=' so that an empty value differs from a missing one
+template <typename T>
+std::wstring ToField(const std::optional<T>& value)
+{
+    return value ? L"=" + ToField(*value) : std::wstring();
+}
+
+template <typename T>
+bool FromField(const std::wstring& field, T& value)
+{
+    if constexpr (std::is_same_v<T, std::wstring>)
+    {
+        value = field;
+        return true;
+    }
+    else
+    {
+        try
+        {
+            size_t pos = 0;
+            const auto number = std::stoull(field, &pos);
+            if (pos != field.size())
+                return false;
+
+            value = static_cast<T>(number);
+            return true;
+        }
+        catch (const std::exception&)
+        {
+            return false;
+        }
+    }
+}
+
+template <typename T>
+bool FromField(const std::wstring& field, std::optional<T>& value)
+{
+    if (field.empty())
+    {
+        value.reset();
+        return true;
+    }
+
+    T result;
+    if (field[0] != L'=' || !FromField(field.substr(1), result))
+        return false;
+
+    value = std::move(result);
+    return true;
+}
+
+Record ToRecord(const SystemDetails::CPUInformation& cpu)
+{
+    return {ToField(cpu.Cores), ToField(cpu.EnabledCores), ToField(cpu.LogicalProcessors), cpu.Name, cpu.Description};
+}
+
+bool FromRecord(const Record& record, SystemDetails::CPUInformation& cpu)
+{
+    return record.size() == 5 && FromField(record[0], cpu.Cores) && FromField(record[1], cpu.EnabledCores)
+        && FromField(record[2], cpu.LogicalProcessors) && FromField(record[3], cpu.Name)
+        && FromField(record[4], cpu.Description);
+}
+
+Record ToRecord(const SystemDetails::PhysicalDrive& drive)
+{
+    return {
+        drive.Path,
+        ToField(drive.Size),
+        ToField(drive.SerialNumber),
+        drive.MediaType,
+        ToField(drive.Status),
+        ToField(drive.Availability),
+        ToField(drive.ConfigManagerErrorCode)};
+}
+
+bool FromRecord(const Record& record, SystemDetails::PhysicalDrive& drive)
+{
+    return record.size() == 7 && FromField(record[0], drive.Path) && FromField(record[1], drive.Size)
+        && FromField(record[2], drive.SerialNumber) && FromField(record[3], drive.MediaType)
+        && FromField(record[4], drive.Status) && FromField(record[5], drive.Availability)
+        && FromField(record[6], drive.ConfigManagerErrorCode);
+}
+
+Record ToRecord(const SystemDetails::MountedVolume& volume)
+{
+    return {
+        volume.Path,
+        volume.FileSystem,
+        volume.Label,
+        volume.DeviceId,
+        ToField(volume.Type),
+        ToField(volume.Size),
+        ToField(volume.FreeSpace),
+        ToField(volume.SerialNumber),
+        ToField(volume.bBoot),
+        ToField(volume.bSystem),
+        ToField(volume.ErrorDesciption),
+        ToField(volume.ErrorCode)};
+}
+
+bool FromRecord(const Record& record, SystemDetails::MountedVolume& volume)
+{
+    return record.size() == 12 && FromField(record[0], volume.Path) && FromField(record[1], volume.FileSystem)
+        && FromField(record[2], volume.Label) && FromField(record[3], volume.DeviceId)
+        && FromField(record[4], volume.Type) && FromField(record[5], volume.Size)
+        && FromField(record[6], volume.FreeSpace) && FromField(record[7], volume.SerialNumber)
+        && FromField(record[8], volume.bBoot) && FromField(record[9], volume.bSystem)
+        && FromField(record[10], volume.ErrorDesciption) && FromField(record[11], volume.ErrorCode);
+}
+
+Record ToRecord(const SystemDetails::QFE& qfe)
+{
+    return {qfe.HotFixId, qfe.Description, qfe.URL, qfe.InstallDate};
+}
+
+bool FromRecord(const Record& record, SystemDetails::QFE& qfe)
+{
+    return record.size() == 4 && FromField(record[0], qfe.HotFixId) && FromField(record[1], qfe.Description)
+        && FromField(record[2], qfe.URL) && FromField(record[3], qfe.InstallDate);
+}
+
+// Results of a WMI query this process did not run yet are loaded from the snapshot saved by another process
+template <typename T>
+const std::optional<std::vector<T>>& LoadWMIResults(std::optional<std::vector<T>>& results, LPCWSTR szName)
+{
+    if (results)
+        return results;
+
+    const auto records = ReadRecords(szName);
+    if (!records)
+        return results;
+
+    std::vector<T> values(records->size());
+    for (size_t i = 0; i < records->size(); i++)
+    {
+        if (!FromRecord((*records)[i], values[i]))
+        {
+            Log::Debug(L"Invalid record in system details snapshot file '{}'", szName);
+            return results;
+        }
+    }
+
+    results = std::move(values);
+    return results;
+}
+
+template <typename T>
+void SaveWMIResults(std::optional<std::vector<T>>& results, LPCWSTR szName, const std::vector<T>& values)
+{
+    results = values;
+
+    std::vector<Record> records;
+    records.reserve(values.size());
+    for (const auto& value : values)
+        records.push_back(ToRecord(value));
+
+    WriteRecords(szName, records);
+}
+
+}  // namespace
+
 constexpr auto BUFSIZE = 256;
 
 using PGNSI = void(WINAPI*)(LPSYSTEM_INFO);
@@ -355,6 +668,10 @@ Result<std::vector<Orc::SystemDetails::CPUInformation>> Orc::SystemDetails::GetC
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+    if (const auto& cpus = LoadWMIResults(g_pDetailsBlock->CPUs, kCPUsFile))
+        return *cpus;
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -402,6 +719,7 @@ Result<std::vector<Orc::SystemDetails::CPUInformation>> Orc::SystemDetails::GetC
         retval.push_back(std::move(cpu));
     }
 
+    SaveWMIResults(g_pDetailsBlock->CPUs, kCPUsFile, retval);
     return retval;
 }
 
@@ -432,7 +750,7 @@ HRESULT SystemDetails::GetLargePageSize(DWORD& dwPageSize)
     if (FAILED(hr = LoadSystemDetails()))
         return hr;
 
-    dwPageSize = 0L;
+    dwPageSize = g_pDetailsBlock->dwLargePageSize;
     return S_OK;
 }
 
@@ -707,6 +1025,8 @@ Result<DWORD> Orc::SystemDetails::GetParentProcessId()
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -748,6 +1068,8 @@ Result<std::wstring> Orc::SystemDetails::GetCmdLine(DWORD dwPid)
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -874,6 +1196,10 @@ Result<std::vector<Orc::SystemDetails::PhysicalDrive>> Orc::SystemDetails::GetPh
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+    if (const auto& drives = LoadWMIResults(g_pDetailsBlock->PhysicalDrives, kPhysicalDrivesFile))
+        return *drives;
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -933,6 +1259,7 @@ Result<std::vector<Orc::SystemDetails::PhysicalDrive>> Orc::SystemDetails::GetPh
         retval.push_back(std::move(drive));
     }
 
+    SaveWMIResults(g_pDetailsBlock->PhysicalDrives, kPhysicalDrivesFile, retval);
     return retval;
 }
 
@@ -941,6 +1268,10 @@ Result<std::vector<Orc::SystemDetails::MountedVolume>> Orc::SystemDetails::GetMo
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+    if (const auto& volumes = LoadWMIResults(g_pDetailsBlock->MountedVolumes, kMountedVolumesFile))
+        return *volumes;
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -953,7 +1284,7 @@ Result<std::vector<Orc::SystemDetails::MountedVolume>> Orc::SystemDetails::GetMo
         L"Name,FileSystem,Label,DeviceID,DriveType,Capacity,FreeSpace,SerialNumber,BootVolume,SystemVolume,"
         L"LastErrorCode,ErrorDescription FROM Win32_Volume");
     if (result.has_error())
-        result.error();
+        return result.error();
 
     const auto& pEnum = result.value();
 
@@ -1040,6 +1371,7 @@ Result<std::vector<Orc::SystemDetails::MountedVolume>> Orc::SystemDetails::GetMo
         retval.push_back(std::move(volume));
     }
 
+    SaveWMIResults(g_pDetailsBlock->MountedVolumes, kMountedVolumesFile, retval);
     return retval;
 }
 
@@ -1048,6 +1380,10 @@ Result<std::vector<Orc::SystemDetails::QFE>> Orc::SystemDetails::GetOsQFEs()
     if (auto hr = LoadSystemDetails(); FAILED(hr))
         return SystemError(hr);
 
+    std::lock_guard<std::mutex> lock(g_pDetailsBlock->wmiLock);
+    if (const auto& qfes = LoadWMIResults(g_pDetailsBlock->QFEs, kQFEsFile))
+        return *qfes;
+
     if (auto hr = g_pDetailsBlock->wmi.Initialize())
     {
         Log::Error(L"Failed to initialize WMI [{}]", SystemError(hr));
@@ -1089,6 +1425,7 @@ Result<std::vector<Orc::SystemDetails::QFE>> Orc::SystemDetails::GetOsQFEs()
 
         retval.push_back(std::move(qfe));
     }
+    SaveWMIResults(g_pDetailsBlock->QFEs, kQFEsFile, retval);
     return retval;
 }
 
@@ -1640,17 +1977,6 @@ HRESULT SystemDetails::LoadSystemDetails()
 
         if (GetTokenInformation(hToken, TokenUser, userBuf.GetP<TOKEN_USER>(), dwLength, &dwLength))
         {
-            DWORD dwUserNameLen = 0L;
-            DWORD dwDomainNameLen = 0L;
-            SID_NAME_USE sidType = SidTypeInvalid;
-
-            if (!LookupAccountSidW(
-                    NULL, userBuf.Get<TOKEN_USER>(0).User.Sid, NULL, &dwUserNameLen, NULL, &dwDomainNameLen, &sidType))
-            {
-                if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
-                    return HRESULT_FROM_WIN32(GetLastError());
-            }
-
             LPWSTR szSID = nullptr;
             if (!ConvertSidToStringSidW(userBuf.Get<TOKEN_USER>(0).User.Sid, &szSID))
             {
@@ -1659,29 +1985,56 @@ HRESULT SystemDetails::LoadSystemDetails()
             g_pDetailsBlock->strUserSID = szSID;
             LocalFree(szSID);
 
-            CBinaryBuffer nameBuf, domainBuf;
+            // Looking the account up can query a domain controller: reuse the name resolved by the parent process
+            if (const auto user = ReadRecords(kUserFile);
+                user && user->size() == 1 && (*user)[0].size() == 2 && (*user)[0][0] == g_pDetailsBlock->strUserSID)
+            {
+                g_pDetailsBlock->strUserName = (*user)[0][1];
+            }
+            else
+            {
+                DWORD dwUserNameLen = 0L;
+                DWORD dwDomainNameLen = 0L;
+                SID_NAME_USE sidType = SidTypeInvalid;
+
+                if (!LookupAccountSidW(
+                        NULL,
+                        userBuf.Get<TOKEN_USER>(0).User.Sid,
+                        NULL,
+                        &dwUserNameLen,
+                        NULL,
+                        &dwDomainNameLen,
+                        &sidType))
+                {
+                    if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+                        return HRESULT_FROM_WIN32(GetLastError());
+                }
+
+                CBinaryBuffer nameBuf, domainBuf;
 
-            nameBuf.SetCount(msl::utilities::SafeInt<USHORT>(dwUserNameLen) * sizeof(WCHAR));
-            domainBuf.SetCount(dwDomainNameLen * sizeof(WCHAR));
+                nameBuf.SetCount(msl::utilities::SafeInt<USHORT>(dwUserNameLen) * sizeof(WCHAR));
+                domainBuf.SetCount(dwDomainNameLen * sizeof(WCHAR));
 
-            if (LookupAccountSidW(
-                    NULL,
-                    userBuf.Get<TOKEN_USER>(0).User.Sid,
-                    nameBuf.GetP<WCHAR>(),
-                    &dwUserNameLen,
-                    domainBuf.GetP<WCHAR>(),
-                    &dwDomainNameLen,
-                    &sidType))
-            {
+                if (LookupAccountSidW(
+                        NULL,
+                        userBuf.Get<TOKEN_USER>(0).User.Sid,
+                        nameBuf.GetP<WCHAR>(),
+                        &dwUserNameLen,
+                        domainBuf.GetP<WCHAR>(),
+                        &dwDomainNameLen,
+                        &sidType))
+                {
 
-                std::wstring strUser;
-                strUser.reserve(dwUserNameLen + dwDomainNameLen + 1);
+                    std::wstring strUser;
+                    strUser.reserve(dwUserNameLen + dwDomainNameLen + 1);
 
-                strUser.assign(domainBuf.GetP<WCHAR>());
-                strUser.append(L"\\");
-                strUser.append(nameBuf.GetP<WCHAR>());
+                    strUser.assign(domainBuf.GetP<WCHAR>());
+                    strUser.append(L"\\");
+                    strUser.append(nameBuf.GetP<WCHAR>());
 
-                std::swap(g_pDetailsBlock->strUserName, strUser);
+                    std::swap(g_pDetailsBlock->strUserName, strUser);
+                    WriteRecords(kUserFile, {{g_pDetailsBlock->strUserSID, g_pDetailsBlock->strUserName}});
+                }
             }
         }
 
@@ -1706,6 +2059,95 @@ HRESULT SystemDetails::LoadSystemDetails()
     return S_OK;
 }
 
+HRESULT SystemDetails::ConfigureSnapshot(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid system details snapshot directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create system details snapshot directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcSystemDetailsEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcSystemDetailsEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"System details are shared in '{}'", directory.wstring());
+
+    // The user name was resolved before the snapshot was configured
+    if (SUCCEEDED(LoadSystemDetails()) && !g_pDetailsBlock->strUserName.empty())
+    {
+        WriteRecords(kUserFile, {{g_pDetailsBlock->strUserSID, g_pDetailsBlock->strUserName}});
+    }
+
+    return S_OK;
+}
+
+std::optional<std::wstring> SystemDetails::GetSnapshotDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcSystemDetailsEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcSystemDetailsEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+void SystemDetails::PrefetchWMI()
+{
+    if (FAILED(LoadSystemDetails()) || g_pDetailsBlock->WMIPrefetch.joinable())
+        return;
+
+    g_pDetailsBlock->WMIPrefetch = std::thread([]() {
+        if (auto hr = CoInitializeEx(NULL, COINIT_MULTITHREADED); FAILED(hr))
+        {
+            Log::Debug(L"Failed to initialize COM to prefetch WMI queries [{}]", SystemError(hr));
+            return;
+        }
+
+        try
+        {
+            if (auto cpus = GetCPUInfo(); cpus.has_error())
+                Log::Debug(L"Failed to prefetch CPU information [{}]", cpus.error());
+
+            if (auto drives = GetPhysicalDrives(); drives.has_error())
+                Log::Debug(L"Failed to prefetch physical drives [{}]", drives.error());
+
+            if (auto volumes = GetMountedVolumes(); volumes.has_error())
+                Log::Debug(L"Failed to prefetch mounted volumes [{}]", volumes.error());
+
+            if (auto qfes = GetOsQFEs(); qfes.has_error())
+                Log::Debug(L"Failed to prefetch QFEs [{}]", qfes.error());
+        }
+        catch (const std::exception& e)
+        {
+            Log::Debug("Failed to prefetch WMI queries: {}", e.what());
+        }
+
+        CoUninitialize();
+    });
+}
+
 HRESULT SystemDetails::GetCurrentWorkingDirectory(std::filesystem::path& cwd)
 {
     WCHAR path[ORC_MAX_PATH];
@@ -41,6 +41,15 @@ private:
     static HRESULT LoadSystemDetails();
 
 public:
+    // Share the current user name and the WMI query results with child processes: they are saved in 'strDirectory',
+    // which %DFIR-ORC_SYSTEM_DETAILS% designates to the processes started afterwards
+    static HRESULT ConfigureSnapshot(const std::wstring& strDirectory);
+    static std::optional<std::wstring> GetSnapshotDirectory();
+
+    // Run the WMI queries of GetCPUInfo, GetPhysicalDrives, GetMountedVolumes and GetOsQFEs on a background thread.
+    // Callers wait for a query in progress instead of running it again
+    static void PrefetchWMI();
+
     static HRESULT SetSystemType(std::wstring strSystemType);
     static HRESULT GetSystemType(std::wstring& strSystemType);
     static HRESULT GetSystemType(BYTE& systemType);
@@ -113,6 +113,7 @@ public:
         std::swap(dwMaxLen, other.dwMaxLen);
         std::swap(dwLen, other.dwLen);
         std::swap(bAllowsNullValues, other.bAllowsNullValues);
+        std::swap(bDictionary, other.bDictionary);
         std::swap(EnumValues, other.EnumValues);
         std::swap(FlagsValues, other.FlagsValues);
     }
@@ -131,6 +132,9 @@ public:
     std::optional<DWORD> dwLen;
     bool bAllowsNullValues = true;
 
+    // Few distinct values (computer name, volume, extension...): writers keep them in a StringDictionary
+    bool bDictionary = false;
+
     std::optional<std::vector<EnumValue>> EnumValues;
     std::optional<std::vector<FlagValue>> FlagsValues;
 };
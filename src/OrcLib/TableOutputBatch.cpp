@@ -0,0 +1,879 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "TableOutputBatch.h"
+
+#include "BinaryBuffer.h"
+#include "Buffer.h"
+#include "OrcException.h"
+#include "Robustness.h"
+#include "Text/Utf16ToUtf8.h"
+#include "WideAnsi.h"
+
+#include <limits>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+using namespace Orc::TableOutput;
+
+namespace {
+
+// Enable the use of std::make_shared with BatchWriter protected constructor
+struct BatchWriterT : public Orc::TableOutput::BatchWriter
+{
+    template <typename... Args>
+    inline BatchWriterT(Args&&... args)
+        : BatchWriter(std::forward<Args>(args)...)
+    {
+    }
+};
+
+// 100-nanoseconds intervals between 1601 and 1970
+constexpr LONGLONG kUnixEpochAsFileTime = 116444736000000000LL;
+
+[[noreturn]] void ThrowInvalidValue(const Column& column, std::wstring_view strValueType)
+{
+    throw Orc::Exception(
+        Severity::Fatal, E_INVALIDARG, L"Not a valid {} value for column '{}'", strValueType, column.ColumnName);
+}
+
+}  // namespace
+
+class Orc::TableOutput::BatchWriterTermination : public TerminationHandler
+{
+public:
+    BatchWriterTermination(const std::wstring& strDescr, std::weak_ptr<BatchWriter> pW)
+        : TerminationHandler(strDescr, ROBUSTNESS_CSV)
+        , m_pWriter(std::move(pW)) {};
+
+    HRESULT operator()();
+
+private:
+    std::weak_ptr<BatchWriter> m_pWriter;
+};
+
+HRESULT Orc::TableOutput::BatchWriterTermination::operator()()
+{
+    if (auto pWriter = m_pWriter.lock(); pWriter)
+    {
+        pWriter->Flush();
+    }
+    return S_OK;
+}
+
+Orc::TableOutput::BatchColumn::BatchColumn(const Column& definition)
+    : m_definition(&definition)
+{
+    switch (definition.Type)
+    {
+        case Nothing:
+            m_storage = Storage::Null;
+            break;
+        case UTF8Type:
+        case BinaryType:
+            m_storage = Storage::Bytes;
+            break;
+        case UTF16Type:
+        case XMLType:
+            m_storage = Storage::WideChars;
+            break;
+        case GUIDType:
+            m_storage = Storage::FixedBytes;
+            m_fixedWidth = sizeof(GUID);
+            break;
+        case FixedBinaryType:
+            m_storage = Storage::FixedBytes;
+            m_fixedWidth = definition.dwLen.value_or(0);
+            break;
+        default:
+            m_storage = Storage::Integer;
+            break;
+    }
+
+    Clear();
+}
+
+std::string_view Orc::TableOutput::BatchColumn::BytesAt(size_t row) const
+{
+    if (m_storage == Storage::FixedBytes)
+        return std::string_view(reinterpret_cast<const char*>(m_bytes.data()) + row * m_fixedWidth, m_fixedWidth);
+
+    return std::string_view(
+        reinterpret_cast<const char*>(m_bytes.data()) + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+}
+
+std::wstring_view Orc::TableOutput::BatchColumn::WideCharsAt(size_t row) const
+{
+    return std::wstring_view(m_wideChars.data() + m_offsets[row], m_offsets[row + 1] - m_offsets[row]);
+}
+
+void Orc::TableOutput::BatchColumn::Reserve(size_t rows)
+{
+    m_valid.reserve(rows);
+
+    switch (m_storage)
+    {
+        case Storage::Integer:
+            m_integers.reserve(rows);
+            break;
+        case Storage::Bytes:
+        case Storage::WideChars:
+            m_offsets.reserve(rows + 1);
+            break;
+        case Storage::FixedBytes:
+            m_bytes.reserve(rows * m_fixedWidth);
+            break;
+        default:
+            break;
+    }
+}
+
+void Orc::TableOutput::BatchColumn::Clear()
+{
+    m_valid.clear();
+    m_integers.clear();
+    m_bytes.clear();
+    m_wideChars.clear();
+    m_offsets.clear();
+    m_nullCount = 0;
+
+    if (m_storage == Storage::Bytes || m_storage == Storage::WideChars)
+        m_offsets.push_back(0);
+}
+
+void Orc::TableOutput::BatchColumn::AppendValid()
+{
+    m_valid.push_back(1);
+}
+
+void Orc::TableOutput::BatchColumn::AppendOffset()
+{
+    const auto offset = m_storage == Storage::WideChars ? m_wideChars.size() : m_bytes.size();
+    if (offset > (std::numeric_limits<uint32_t>::max)())
+    {
+        throw Orc::Exception(
+            Severity::Fatal, E_OUTOFMEMORY, L"Too much data in batch for column '{}'", m_definition->ColumnName);
+    }
+
+    m_offsets.push_back(static_cast<uint32_t>(offset));
+}
+
+void Orc::TableOutput::BatchColumn::AppendNull()
+{
+    switch (m_storage)
+    {
+        case Storage::Integer:
+            m_integers.push_back(0LL);
+            break;
+        case Storage::Bytes:
+        case Storage::WideChars:
+            AppendOffset();
+            break;
+        case Storage::FixedBytes:
+            m_bytes.resize(m_bytes.size() + m_fixedWidth, 0);
+            break;
+        default:
+            break;
+    }
+
+    m_valid.push_back(0);
+    m_nullCount++;
+}
+
+void Orc::TableOutput::BatchColumn::AppendNulls(size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+        AppendNull();
+}
+
+void Orc::TableOutput::BatchColumn::AppendInteger(LONGLONG value)
+{
+    switch (m_storage)
+    {
+        case Storage::Null:
+            AppendNull();
+            return;
+        case Storage::Integer:
+            m_integers.push_back(value);
+            break;
+        case Storage::WideChars:
+            fmt::format_to(std::back_inserter(m_wideChars), L"{}", value);
+            AppendOffset();
+            break;
+        case Storage::Bytes:
+            if (m_definition->Type != UTF8Type)
+                ThrowInvalidValue(*m_definition, L"integer");
+            fmt::format_to(std::back_inserter(m_bytes), "{}", value);
+            AppendOffset();
+            break;
+        default:
+            ThrowInvalidValue(*m_definition, L"integer");
+    }
+
+    AppendValid();
+}
+
+void Orc::TableOutput::BatchColumn::AppendIntegers(const int64_t* values, size_t count)
+{
+    if (m_storage != Storage::Integer)
+    {
+        for (size_t i = 0; i < count; i++)
+            AppendInteger(static_cast<LONGLONG>(values[i]));
+        return;
+    }
+
+    m_integers.insert(std::end(m_integers), values, values + count);
+    m_valid.resize(m_valid.size() + count, 1);
+}
+
+void Orc::TableOutput::BatchColumn::AppendString(std::wstring_view value)
+{
+    switch (m_storage)
+    {
+        case Storage::Null:
+            AppendNull();
+            return;
+        case Storage::WideChars:
+            m_wideChars.insert(std::end(m_wideChars), std::cbegin(value), std::cend(value));
+            AppendOffset();
+            break;
+        case Storage::Bytes: {
+            if (m_definition->Type != UTF8Type)
+                ThrowInvalidValue(*m_definition, L"Unicode string");
+
+            const auto offset = m_bytes.size();
+            m_bytes.resize(offset + Text::Utf8MaxLength(value.size()));
+
+            const auto cbUtf8 = Text::ConvertUtf16ToUtf8(value, reinterpret_cast<char*>(m_bytes.data() + offset));
+            m_bytes.resize(offset + cbUtf8);
+            AppendOffset();
+            break;
+        }
+        default:
+            ThrowInvalidValue(*m_definition, L"Unicode string");
+    }
+
+    AppendValid();
+}
+
+void Orc::TableOutput::BatchColumn::AppendString(std::string_view value)
+{
+    switch (m_storage)
+    {
+        case Storage::Null:
+            AppendNull();
+            return;
+        case Storage::Bytes:
+            m_bytes.insert(std::end(m_bytes), std::cbegin(value), std::cend(value));
+            AppendOffset();
+            break;
+        case Storage::WideChars: {
+            std::wstring wide;
+            if (FAILED(AnsiToWide(value, wide)))
+            {
+                Log::Debug(L"utf8 to Unicode conversion failed");
+                AppendNull();
+                return;
+            }
+
+            m_wideChars.insert(std::end(m_wideChars), std::cbegin(wide), std::cend(wide));
+            AppendOffset();
+            break;
+        }
+        default:
+            ThrowInvalidValue(*m_definition, L"ANSI string");
+    }
+
+    AppendValid();
+}
+
+void Orc::TableOutput::BatchColumn::AppendBytes(const BYTE* pBytes, size_t cbBytes)
+{
+    switch (m_storage)
+    {
+        case Storage::Null:
+            AppendNull();
+            return;
+        case Storage::Bytes:
+            m_bytes.insert(std::end(m_bytes), pBytes, pBytes + cbBytes);
+            AppendOffset();
+            break;
+        case Storage::FixedBytes:
+            if (cbBytes != m_fixedWidth)
+                ThrowInvalidValue(*m_definition, L"fixed size binary");
+            m_bytes.insert(std::end(m_bytes), pBytes, pBytes + cbBytes);
+            break;
+        default:
+            ThrowInvalidValue(*m_definition, L"binary");
+    }
+
+    AppendValid();
+}
+
+void Orc::TableOutput::BatchColumn::SetRendering(Rendering rendering, const WCHAR** enumNames)
+{
+    m_rendering = rendering;
+    m_enumNames = enumNames;
+}
+
+void Orc::TableOutput::BatchColumn::SetRendering(Rendering rendering, const FlagsDefinition* flags, WCHAR cSeparator)
+{
+    m_rendering = rendering;
+    m_flags = flags;
+    m_flagsSeparator = cSeparator;
+}
+
+HRESULT Orc::TableOutput::BatchColumn::WriteTo(IOutput& output, size_t row) const
+{
+    if (!IsValid(row))
+        return output.WriteNothing();
+
+    switch (m_storage)
+    {
+        case Storage::Integer: {
+            const auto value = m_integers[row];
+
+            switch (m_rendering)
+            {
+                case Rendering::EnumNames:
+                    return output.WriteEnum(static_cast<DWORD>(value), m_enumNames);
+                case Rendering::Flags:
+                    if (m_flags)
+                        return output.WriteFlags(static_cast<DWORD>(value), m_flags, m_flagsSeparator);
+                    return output.WriteFlags(static_cast<DWORD>(value));
+                case Rendering::ExactFlags:
+                    if (m_flags)
+                        return output.WriteExactFlags(static_cast<DWORD>(value), m_flags);
+                    return output.WriteExactFlags(static_cast<DWORD>(value));
+                default:
+                    break;
+            }
+
+            switch (Type())
+            {
+                case BoolType:
+                    return output.WriteBool(value != 0);
+                case TimeStampType:
+                    return output.WriteFileTime(static_cast<LONGLONG>(value));
+                case EnumType:
+                    return output.WriteEnum(static_cast<DWORD>(value));
+                case FlagsType:
+                    return output.WriteFlags(static_cast<DWORD>(value));
+                case Int8Type:
+                case Int16Type:
+                case Int32Type:
+                case Int64Type:
+                    return output.WriteInteger(static_cast<LONGLONG>(value));
+                default:
+                    return output.WriteInteger(static_cast<ULONGLONG>(value));
+            }
+        }
+        case Storage::Bytes: {
+            const auto value = BytesAt(row);
+            if (Type() == BinaryType)
+                return output.WriteBytes(reinterpret_cast<const BYTE*>(value.data()), static_cast<DWORD>(value.size()));
+            return output.WriteCharArray(value.data(), static_cast<DWORD>(value.size()));
+        }
+        case Storage::WideChars: {
+            const auto value = WideCharsAt(row);
+            if (Type() == XMLType)
+                return output.WriteXML(value.data(), static_cast<DWORD>(value.size()));
+            return output.WriteCharArray(value.data(), static_cast<DWORD>(value.size()));
+        }
+        case Storage::FixedBytes: {
+            const auto value = m_bytes.data() + row * m_fixedWidth;
+            if (Type() == GUIDType)
+            {
+                GUID guid;
+                CopyMemory(&guid, value, sizeof(GUID));
+                return output.WriteGUID(guid);
+            }
+            return output.WriteBytes(value, static_cast<DWORD>(m_fixedWidth));
+        }
+        default:
+            return output.WriteNothing();
+    }
+}
+
+Orc::TableOutput::RecordBatch::RecordBatch(const Schema& schema, size_t rowCapacity)
+{
+    SetSchema(schema, rowCapacity);
+}
+
+HRESULT Orc::TableOutput::RecordBatch::SetSchema(const Schema& schema, size_t rowCapacity)
+{
+    if (!schema)
+        return E_INVALIDARG;
+
+    m_Schema = schema;
+
+    m_columns.clear();
+    m_columns.reserve(m_Schema.size());
+    for (const auto& column : m_Schema)
+    {
+        m_columns.emplace_back(*column);
+    }
+
+    m_dwColumnCounter = 0L;
+    m_dwRows = 0L;
+
+    Reserve(rowCapacity);
+    return S_OK;
+}
+
+void Orc::TableOutput::RecordBatch::Reserve(size_t rows)
+{
+    for (auto& column : m_columns)
+        column.Reserve(rows);
+}
+
+void Orc::TableOutput::RecordBatch::Clear()
+{
+    for (auto& column : m_columns)
+        column.Clear();
+
+    m_dwColumnCounter = 0L;
+    m_dwRows = 0L;
+}
+
+HRESULT Orc::TableOutput::RecordBatch::WriteTo(IOutput& output) const
+{
+    HRESULT hr = S_OK;
+
+    for (size_t row = 0; row < m_dwRows; row++)
+    {
+        for (const auto& column : m_columns)
+        {
+            if (auto hrColumn = column.WriteTo(output, row); FAILED(hrColumn))
+            {
+                Log::Debug(
+                    L"Failed to write column '{}' of batch row {} [{}]",
+                    column.Definition().ColumnName,
+                    row,
+                    SystemError(hrColumn));
+                hr = hrColumn;
+            }
+        }
+
+        if (auto hrLine = output.WriteEndOfLine(); FAILED(hrLine))
+            return hrLine;
+    }
+
+    return hr;
+}
+
+BatchColumn& Orc::TableOutput::RecordBatch::CurrentColumn()
+{
+    if (m_dwColumnCounter >= m_columns.size())
+    {
+        auto counter = m_dwColumnCounter;
+        m_dwColumnCounter = 0L;
+        throw Orc::Exception(
+            Severity::Fatal, L"Too many columns written to batch (got {}, max is {})", counter + 1, m_columns.size());
+    }
+    return m_columns[m_dwColumnCounter];
+}
+
+HRESULT Orc::TableOutput::RecordBatch::NextColumn()
+{
+    m_dwColumnCounter++;
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteNothing()
+{
+    CurrentColumn().AppendNull();
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(const std::wstring& strString)
+{
+    return WriteString(std::wstring_view(strString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(std::wstring_view strString)
+{
+    CurrentColumn().AppendString(strString);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(const WCHAR* szString)
+{
+    return WriteString(std::wstring_view(szString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteCharArray(const WCHAR* szArray, DWORD dwCharCount)
+{
+    return WriteString(std::wstring_view(szArray, dwCharCount));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(const std::string& strString)
+{
+    return WriteString(std::string_view(strString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(std::string_view strString)
+{
+    CurrentColumn().AppendString(strString);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteString(const CHAR* szString)
+{
+    return WriteString(std::string_view(szString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteCharArray(const CHAR* szArray, DWORD dwCharCount)
+{
+    return WriteString(std::string_view(szArray, dwCharCount));
+}
+
+HRESULT Orc::TableOutput::RecordBatch::WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return WriteString(buffer.size() > 0 ? std::wstring_view(buffer.get(), buffer.size()) : L""sv);
+}
+
+HRESULT Orc::TableOutput::RecordBatch::WriteFormated_(std::string_view szFormat, fmt::format_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<CHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return WriteString(buffer.size() > 0 ? std::string_view(buffer.get(), buffer.size()) : ""sv);
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteAttributes(DWORD dwFileAttributes)
+{
+    const WCHAR attributes[] = {
+        dwFileAttributes & FILE_ATTRIBUTE_ARCHIVE ? L'A' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_COMPRESSED ? L'C' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY ? L'D' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_ENCRYPTED ? L'E' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_HIDDEN ? L'H' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_NORMAL ? L'N' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_OFFLINE ? L'O' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_READONLY ? L'R' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT ? L'L' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_SPARSE_FILE ? L'P' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_SYSTEM ? L'S' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_TEMPORARY ? L'T' : L'.',
+        dwFileAttributes & FILE_ATTRIBUTE_VIRTUAL ? L'V' : L'.'};
+
+    return WriteString(std::wstring_view(attributes, _countof(attributes)));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFileTime(FILETIME fileTime)
+{
+    ULARGE_INTEGER uli;
+    uli.LowPart = fileTime.dwLowDateTime;
+    uli.HighPart = fileTime.dwHighDateTime;
+
+    CurrentColumn().AppendInteger(uli.QuadPart);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFileTime(LONGLONG fileTime)
+{
+    CurrentColumn().AppendInteger(fileTime);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteTimeStamp(time_t tmStamp)
+{
+    // Timestamps are kept as FILETIME (100-nanoseconds since 1601)
+    CurrentColumn().AppendInteger(static_cast<LONGLONG>(tmStamp) * 10000000LL + kUnixEpochAsFileTime);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteTimeStamp(tm tmStamp)
+{
+    const auto time = _mkgmtime(&tmStamp);
+    if (time == -1)
+        return E_INVALIDARG;
+
+    return WriteTimeStamp(time);
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFileSize(LARGE_INTEGER fileSize)
+{
+    CurrentColumn().AppendInteger(fileSize.QuadPart);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFileSize(ULONGLONG fileSize)
+{
+    CurrentColumn().AppendInteger(fileSize);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFileSize(DWORD nFileSizeHigh, DWORD nFileSizeLow)
+{
+    ULARGE_INTEGER fileSize;
+    fileSize.HighPart = nFileSizeHigh;
+    fileSize.LowPart = nFileSizeLow;
+
+    return WriteFileSize(fileSize.QuadPart);
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteInteger(DWORD dwInteger)
+{
+    CurrentColumn().AppendInteger(static_cast<ULONGLONG>(dwInteger));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteInteger(LONGLONG dw64Integer)
+{
+    CurrentColumn().AppendInteger(dw64Integer);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteInteger(ULONGLONG dw64Integer)
+{
+    CurrentColumn().AppendInteger(dw64Integer);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteBytes(const BYTE pBytes[], DWORD dwLen)
+{
+    CurrentColumn().AppendBytes(pBytes, dwLen);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteBytes(const CBinaryBuffer& Buffer)
+{
+    return WriteBytes(Buffer.GetData(), static_cast<DWORD>(Buffer.GetCount()));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteBool(bool bBoolean)
+{
+    CurrentColumn().AppendInteger(bBoolean ? 1LL : 0LL);
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteEnum(DWORD dwEnum)
+{
+    CurrentColumn().AppendInteger(static_cast<ULONGLONG>(dwEnum));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteEnum(DWORD dwEnum, const WCHAR* EnumValues[])
+{
+    auto& column = CurrentColumn();
+    column.SetRendering(BatchColumn::Rendering::EnumNames, EnumValues);
+    column.AppendInteger(static_cast<ULONGLONG>(dwEnum));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFlags(DWORD dwFlags)
+{
+    auto& column = CurrentColumn();
+    column.SetRendering(BatchColumn::Rendering::Flags, nullptr);
+    column.AppendInteger(static_cast<ULONGLONG>(dwFlags));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteFlags(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator)
+{
+    auto& column = CurrentColumn();
+    column.SetRendering(BatchColumn::Rendering::Flags, FlagValues, cSeparator);
+    column.AppendInteger(static_cast<ULONGLONG>(dwFlags));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteExactFlags(DWORD dwFlags)
+{
+    auto& column = CurrentColumn();
+    column.SetRendering(BatchColumn::Rendering::ExactFlags, nullptr);
+    column.AppendInteger(static_cast<ULONGLONG>(dwFlags));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteExactFlags(DWORD dwFlags, const FlagsDefinition FlagValues[])
+{
+    auto& column = CurrentColumn();
+    column.SetRendering(BatchColumn::Rendering::ExactFlags, FlagValues);
+    column.AppendInteger(static_cast<ULONGLONG>(dwFlags));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteGUID(const GUID& guid)
+{
+    CurrentColumn().AppendBytes(reinterpret_cast<const BYTE*>(&guid), sizeof(GUID));
+    return NextColumn();
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteXML(const WCHAR* szString)
+{
+    return WriteString(std::wstring_view(szString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteXML(const CHAR* szString)
+{
+    return WriteString(std::string_view(szString));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteXML(const WCHAR* szArray, DWORD dwCharCount)
+{
+    return WriteString(std::wstring_view(szArray, dwCharCount));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::WriteXML(const CHAR* szArray, DWORD dwCharCount)
+{
+    return WriteString(std::string_view(szArray, dwCharCount));
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::AbandonRow()
+{
+    for (auto i = m_dwColumnCounter; i < m_columns.size(); i++)
+    {
+        m_columns[i].AppendNull();
+    }
+    m_dwColumnCounter = static_cast<DWORD>(m_columns.size());
+    return S_OK;
+}
+
+STDMETHODIMP Orc::TableOutput::RecordBatch::AbandonColumn()
+{
+    return WriteNothing();
+}
+
+HRESULT Orc::TableOutput::RecordBatch::WriteEndOfLine()
+{
+    if (m_dwColumnCounter != m_columns.size())
+    {
+        auto counter = m_dwColumnCounter;
+        m_dwColumnCounter = 0L;
+        throw Orc::Exception(
+            Severity::Fatal,
+            L"Invalid number of columns written to batch (got {}, expected {})",
+            counter,
+            m_columns.size());
+    }
+
+    m_dwColumnCounter = 0L;
+    m_dwRows++;
+    return S_OK;
+}
+
+std::shared_ptr<BatchWriter>
+Orc::TableOutput::BatchWriter::MakeNew(std::shared_ptr<IStreamWriter> writer, size_t batchRows)
+{
+    if (!writer)
+        return nullptr;
+
+    auto retval = std::make_shared<::BatchWriterT>(std::move(writer), batchRows);
+
+    std::wstring strDescr = L"Termination for BatchWriter";
+    retval->m_pTermination = std::make_shared<BatchWriterTermination>(strDescr, retval);
+    Robustness::AddTerminationHandler(retval->m_pTermination);
+    return retval;
+}
+
+Orc::TableOutput::BatchWriter::BatchWriter(std::shared_ptr<IStreamWriter> writer, size_t batchRows)
+    : m_writer(std::move(writer))
+    , m_batchRows(batchRows ? batchRows : kDefaultBatchRows)
+{
+}
+
+Orc::TableOutput::BatchWriter::~BatchWriter()
+{
+    if (m_pTermination)
+        Close();
+}
+
+STDMETHODIMP Orc::TableOutput::BatchWriter::SetSchema(const Schema& columns)
+{
+    if (auto hr = m_writer->SetSchema(columns); FAILED(hr))
+        return hr;
+
+    return m_batch.SetSchema(columns, m_batchRows);
+}
+
+HRESULT Orc::TableOutput::BatchWriter::FlushBatch()
+{
+    if (m_batch.empty())
+        return S_OK;
+
+    auto hr = m_writer->WriteBatch(m_batch);
+    m_batch.Clear();
+    return hr;
+}
+
+STDMETHODIMP Orc::TableOutput::BatchWriter::WriteBatch(const RecordBatch& batch)
+{
+    if (auto hr = FlushBatch(); FAILED(hr))
+        return hr;
+
+    return m_writer->WriteBatch(batch);
+}
+
+STDMETHODIMP Orc::TableOutput::BatchWriter::Flush()
+{
+    if (auto hr = FlushBatch(); FAILED(hr))
+    {
+        Log::Error(L"Failed to write pending batch [{}]", SystemError(hr));
+        return hr;
+    }
+
+    return m_writer->Flush();
+}
+
+STDMETHODIMP Orc::TableOutput::BatchWriter::Close()
+{
+    if (auto hr = FlushBatch(); FAILED(hr))
+        Log::Error(L"Failed to write pending batch [{}]", SystemError(hr));
+
+    auto hr = m_writer->Close();
+
+    if (m_pTermination)
+    {
+        Robustness::RemoveTerminationHandler(m_pTermination);
+        m_pTermination = nullptr;
+    }
+    return hr;
+}
+
+HRESULT Orc::TableOutput::BatchWriter::WriteEndOfLine()
+{
+    if (auto hr = m_batch.WriteEndOfLine(); FAILED(hr))
+        return hr;
+
+    if (m_batch.RowCount() >= m_batchRows)
+        return FlushBatch();
+
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::BatchWriter::WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return m_batch.WriteString(buffer.size() > 0 ? std::wstring_view(buffer.get(), buffer.size()) : L""sv);
+}
+
+HRESULT Orc::TableOutput::BatchWriter::WriteFormated_(std::string_view szFormat, fmt::format_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<CHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return m_batch.WriteString(buffer.size() > 0 ? std::string_view(buffer.get(), buffer.size()) : ""sv);
+}
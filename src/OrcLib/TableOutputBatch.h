@@ -0,0 +1,349 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutputWriter.h"
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+namespace TableOutput {
+
+//
+// BatchColumn: values of one column of a RecordBatch, stored contiguously.
+//
+// Integers, booleans, enums, flags and timestamps (as FILETIME) are kept as 64 bits values. Variable length values are
+// kept in one buffer with 'size() + 1' row offsets (Arrow layout): UTF8 and binary values as bytes, UTF16 and XML values
+// as WCHARs. GUID and fixed size binary values use exactly their width for each row, zeroed for null values.
+//
+class BatchColumn
+{
+public:
+    enum class Storage
+    {
+        Null,
+        Integer,
+        Bytes,
+        FixedBytes,
+        WideChars
+    };
+
+    // How enums and flags were written, replayed for row writers that render them as text (CSV)
+    enum class Rendering
+    {
+        Default,
+        EnumNames,
+        Flags,
+        ExactFlags
+    };
+
+    BatchColumn(const Column& definition);
+
+    const Column& Definition() const { return *m_definition; }
+    ColumnType Type() const { return m_definition->Type; }
+    Storage GetStorage() const { return m_storage; }
+
+    size_t size() const { return m_valid.size(); }
+    size_t NullCount() const { return m_nullCount; }
+
+    // One byte per row, zero for null values
+    const uint8_t* Validity() const { return m_valid.data(); }
+    bool IsValid(size_t row) const { return m_valid[row] != 0; }
+
+    const int64_t* Integers() const { return m_integers.data(); }
+
+    const uint32_t* Offsets() const { return m_offsets.data(); }
+    const uint8_t* Bytes() const { return m_bytes.data(); }
+    const WCHAR* WideChars() const { return m_wideChars.data(); }
+    size_t FixedWidth() const { return m_fixedWidth; }
+
+    std::string_view BytesAt(size_t row) const;
+    std::wstring_view WideCharsAt(size_t row) const;
+
+    void Reserve(size_t rows);
+    void Clear();
+
+    void AppendNull();
+    void AppendNulls(size_t count);
+
+    void AppendInteger(LONGLONG value);
+    void AppendInteger(ULONGLONG value) { AppendInteger(static_cast<LONGLONG>(value)); }
+    void AppendIntegers(const int64_t* values, size_t count);
+
+    void AppendString(std::string_view value);
+    void AppendString(std::wstring_view value);
+    void AppendBytes(const BYTE* pBytes, size_t cbBytes);
+
+    void SetRendering(Rendering rendering, const WCHAR** enumNames);
+    void SetRendering(Rendering rendering, const FlagsDefinition* flags, WCHAR cSeparator = L'|');
+
+    // Write the value of 'row' with the matching IOutput method
+    HRESULT WriteTo(IOutput& output, size_t row) const;
+
+private:
+    void AppendValid();
+    void AppendOffset();
+
+    const Column* m_definition;
+    Storage m_storage;
+    size_t m_fixedWidth = 0;
+    size_t m_nullCount = 0;
+
+    std::vector<uint8_t> m_valid;
+    std::vector<int64_t> m_integers;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint8_t> m_bytes;
+    std::vector<WCHAR> m_wideChars;
+
+    Rendering m_rendering = Rendering::Default;
+    const WCHAR** m_enumNames = nullptr;
+    const FlagsDefinition* m_flags = nullptr;
+    WCHAR m_flagsSeparator = L'|';
+};
+
+//
+// RecordBatch: column major block of rows sharing a schema.
+//
+// Columns can be filled directly with the BatchColumn typed appends, or row by row through the IOutput interface so
+// that existing producers (FileInfo::WriteFileInformation...) fill a batch without any change. IWriter::WriteBatch()
+// then hands the whole batch to the writer: Parquet and ORC write each column chunk at once, CSV replays the rows.
+//
+class RecordBatch : public IOutput
+{
+public:
+    RecordBatch() = default;
+    RecordBatch(const Schema& schema, size_t rowCapacity = 0);
+
+    HRESULT SetSchema(const Schema& schema, size_t rowCapacity = 0);
+    const Schema& GetSchema() const { return m_Schema; }
+
+    size_t ColumnCount() const { return m_columns.size(); }
+    size_t RowCount() const { return m_dwRows; }
+    bool empty() const { return m_dwRows == 0; }
+
+    BatchColumn& operator[](size_t colId) { return m_columns.at(colId); }
+    const BatchColumn& operator[](size_t colId) const { return m_columns.at(colId); }
+
+    void Reserve(size_t rows);
+    void Clear();
+
+    // Row at a time replay, for writers without a columnar path
+    HRESULT WriteTo(IOutput& output) const;
+
+    virtual DWORD GetCurrentColumnID() override final { return m_dwColumnCounter; }
+    virtual const Column& GetCurrentColumn() override final { return m_Schema[m_dwColumnCounter]; }
+
+    STDMETHOD(WriteNothing)() override final;
+
+    STDMETHOD(WriteString)(const std::wstring& strString) override final;
+    STDMETHOD(WriteString)(std::wstring_view strString) override final;
+    STDMETHOD(WriteString)(const WCHAR* szString) override final;
+    STDMETHOD(WriteCharArray)(const WCHAR* szArray, DWORD dwCharCount) override final;
+
+    STDMETHOD(WriteString)(const std::string& strString) override final;
+    STDMETHOD(WriteString)(std::string_view strString) override final;
+    STDMETHOD(WriteString)(const CHAR* szString) override final;
+    STDMETHOD(WriteCharArray)(const CHAR* szArray, DWORD dwCharCount) override final;
+
+    STDMETHOD(WriteAttributes)(DWORD dwAttibutes) override final;
+
+    STDMETHOD(WriteFileTime)(FILETIME fileTime) override final;
+    STDMETHOD(WriteFileTime)(LONGLONG fileTime) override final;
+    STDMETHOD(WriteTimeStamp)(time_t tmStamp) override final;
+    STDMETHOD(WriteTimeStamp)(tm tmStamp) override final;
+
+    STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final;
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final;
+    STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final;
+
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final;
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final;
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final;
+
+    STDMETHOD(WriteBytes)(const BYTE pBytes[], DWORD dwLen) override final;
+    STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final;
+
+    STDMETHOD(WriteBool)(bool bBoolean) override final;
+
+    STDMETHOD(WriteEnum)(DWORD dwEnum) override final;
+    STDMETHOD(WriteEnum)(DWORD dwEnum, const WCHAR* EnumValues[]) override final;
+
+    STDMETHOD(WriteFlags)(DWORD dwFlags) override final;
+    STDMETHOD(WriteFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator) override final;
+
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags) override final;
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[]) override final;
+
+    STDMETHOD(WriteGUID)(const GUID& guid) override final;
+
+    STDMETHOD(WriteXML)(const WCHAR* szString) override final;
+    STDMETHOD(WriteXML)(const CHAR* szString) override final;
+    STDMETHOD(WriteXML)(const WCHAR* szArray, DWORD dwCharCount) override final;
+    STDMETHOD(WriteXML)(const CHAR* szArray, DWORD dwCharCount) override final;
+
+    STDMETHOD(AbandonRow)() override final;
+    STDMETHOD(AbandonColumn)() override final;
+
+    virtual HRESULT WriteEndOfLine() override final;
+
+protected:
+    HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
+    HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
+
+private:
+    BatchColumn& CurrentColumn();
+    HRESULT NextColumn();
+
+    Schema m_Schema;
+    std::vector<BatchColumn> m_columns;
+
+    DWORD m_dwColumnCounter = 0L;
+    size_t m_dwRows = 0L;
+};
+
+class BatchWriterTermination;
+
+//
+// BatchWriter: accumulates the rows written to a stream writer in a RecordBatch and hands them over with WriteBatch()
+// every 'batchRows' rows, instead of calling the writer for each value.
+//
+class BatchWriter : public IStreamWriter
+{
+public:
+    static constexpr size_t kDefaultBatchRows = 10000;
+
+    static std::shared_ptr<BatchWriter>
+    MakeNew(std::shared_ptr<IStreamWriter> writer, size_t batchRows = kDefaultBatchRows);
+
+    BatchWriter(const BatchWriter&) = delete;
+
+    virtual ~BatchWriter();
+
+    const std::shared_ptr<IStreamWriter>& GetWriter() const { return m_writer; }
+
+    STDMETHOD(WriteToFile)(const std::filesystem::path& path) override final { return m_writer->WriteToFile(path); }
+    STDMETHOD(WriteToFile)(const WCHAR* szFileName) override final { return m_writer->WriteToFile(szFileName); }
+    STDMETHOD(WriteToStream)(const std::shared_ptr<ByteStream>& pStream, bool bCloseStream = true) override final
+    {
+        return m_writer->WriteToStream(pStream, bCloseStream);
+    }
+
+    std::shared_ptr<ByteStream> GetStream() const override final { return m_writer->GetStream(); }
+
+    STDMETHOD(SetSchema)(const Schema& columns) override final;
+    STDMETHOD(WriteBatch)(const RecordBatch& batch) override final;
+
+    STDMETHOD(Flush)() override final;
+    STDMETHOD(Close)() override final;
+
+    virtual DWORD GetCurrentColumnID() override final { return m_batch.GetCurrentColumnID(); }
+    virtual const Column& GetCurrentColumn() override final { return m_batch.GetCurrentColumn(); }
+
+    STDMETHOD(WriteNothing)() override final { return m_batch.WriteNothing(); }
+
+    STDMETHOD(WriteString)(const std::wstring& strString) override final { return m_batch.WriteString(strString); }
+    STDMETHOD(WriteString)(std::wstring_view strString) override final { return m_batch.WriteString(strString); }
+    STDMETHOD(WriteString)(const WCHAR* szString) override final { return m_batch.WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_batch.WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteString)(const std::string& strString) override final { return m_batch.WriteString(strString); }
+    STDMETHOD(WriteString)(std::string_view strString) override final { return m_batch.WriteString(strString); }
+    STDMETHOD(WriteString)(const CHAR* szString) override final { return m_batch.WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_batch.WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteAttributes)(DWORD dwAttibutes) override final { return m_batch.WriteAttributes(dwAttibutes); }
+
+    STDMETHOD(WriteFileTime)(FILETIME fileTime) override final { return m_batch.WriteFileTime(fileTime); }
+    STDMETHOD(WriteFileTime)(LONGLONG fileTime) override final { return m_batch.WriteFileTime(fileTime); }
+    STDMETHOD(WriteTimeStamp)(time_t tmStamp) override final { return m_batch.WriteTimeStamp(tmStamp); }
+    STDMETHOD(WriteTimeStamp)(tm tmStamp) override final { return m_batch.WriteTimeStamp(tmStamp); }
+
+    STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final { return m_batch.WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return m_batch.WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final
+    {
+        return m_batch.WriteFileSize(nFileSizeHigh, nFileSizeLow);
+    }
+
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return m_batch.WriteInteger(dwInteger); }
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return m_batch.WriteInteger(dw64Integer); }
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return m_batch.WriteInteger(dw64Integer); }
+
+    STDMETHOD(WriteBytes)(const BYTE pBytes[], DWORD dwLen) override final { return m_batch.WriteBytes(pBytes, dwLen); }
+    STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final { return m_batch.WriteBytes(Buffer); }
+
+    STDMETHOD(WriteBool)(bool bBoolean) override final { return m_batch.WriteBool(bBoolean); }
+
+    STDMETHOD(WriteEnum)(DWORD dwEnum) override final { return m_batch.WriteEnum(dwEnum); }
+    STDMETHOD(WriteEnum)(DWORD dwEnum, const WCHAR* EnumValues[]) override final
+    {
+        return m_batch.WriteEnum(dwEnum, EnumValues);
+    }
+
+    STDMETHOD(WriteFlags)(DWORD dwFlags) override final { return m_batch.WriteFlags(dwFlags); }
+    STDMETHOD(WriteFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator) override final
+    {
+        return m_batch.WriteFlags(dwFlags, FlagValues, cSeparator);
+    }
+
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags) override final { return m_batch.WriteExactFlags(dwFlags); }
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[]) override final
+    {
+        return m_batch.WriteExactFlags(dwFlags, FlagValues);
+    }
+
+    STDMETHOD(WriteGUID)(const GUID& guid) override final { return m_batch.WriteGUID(guid); }
+
+    STDMETHOD(WriteXML)(const WCHAR* szString) override final { return m_batch.WriteXML(szString); }
+    STDMETHOD(WriteXML)(const CHAR* szString) override final { return m_batch.WriteXML(szString); }
+    STDMETHOD(WriteXML)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_batch.WriteXML(szArray, dwCharCount);
+    }
+    STDMETHOD(WriteXML)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return m_batch.WriteXML(szArray, dwCharCount);
+    }
+
+    STDMETHOD(AbandonRow)() override final { return m_batch.AbandonRow(); }
+    STDMETHOD(AbandonColumn)() override final { return m_batch.AbandonColumn(); }
+
+    virtual HRESULT WriteEndOfLine() override final;
+
+protected:
+    BatchWriter(std::shared_ptr<IStreamWriter> writer, size_t batchRows);
+
+    HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
+    HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
+
+    HRESULT FlushBatch();
+
+    std::shared_ptr<IStreamWriter> m_writer;
+    std::shared_ptr<BatchWriterTermination> m_pTermination;
+
+    size_t m_batchRows;
+    RecordBatch m_batch;
+};
+
+}  // namespace TableOutput
+}  // namespace Orc
+
+#pragma managed(pop)
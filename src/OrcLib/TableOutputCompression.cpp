@@ -0,0 +1,202 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TableOutputCompression.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cwctype>
+#include <mutex>
+#include <string>
+
+#include <fmt/format.h>
+
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr auto kDefault = L"default"sv;
+constexpr auto kNone = L"none"sv;
+constexpr auto kGzip = L"gzip"sv;
+constexpr auto kSnappy = L"snappy"sv;
+constexpr auto kLz4 = L"lz4"sv;
+constexpr auto kZstd = L"zstd"sv;
+constexpr auto kAuto = L"auto"sv;
+
+constexpr size_t kSampleSize = 1024 * 1024;
+
+// Below this, zstd would slow down writers more than the smaller output saves on the way to disk or network
+constexpr double kAutoZstdThroughput = 250.0 * 1024 * 1024;
+
+// Rows looking like what is collected: paths, hashes, sizes and dates, repeating as much as real tables do
+std::string MakeSample()
+{
+    constexpr std::array folders = {
+        "C:\\Windows\\System32\\"sv,
+        "C:\\Windows\\SysWOW64\\"sv,
+        "C:\\Program Files\\Common Files\\"sv,
+        "C:\\Users\\Public\\Documents\\"sv,
+        "C:\\ProgramData\\Microsoft\\Windows\\"sv};
+    constexpr std::array extensions = {".dll"sv, ".exe"sv, ".sys"sv, ".log"sv, ".dat"sv};
+
+    uint32_t seed = 0x2545F491;
+    const auto next = [&seed]() {
+        seed = seed * 1664525 + 1013904223;
+        return seed >> 8;
+    };
+
+    std::string sample;
+    sample.reserve(kSampleSize + 512);
+
+    while (sample.size() < kSampleSize)
+    {
+        fmt::format_to(
+            std::back_inserter(sample),
+            "{}{:x}{},{},{:08x}{:08x}{:08x}{:08x},20{:02}-{:02}-{:02} {:02}:{:02}:{:02}\r\n",
+            folders[next() % folders.size()],
+            next() % 4096,
+            extensions[next() % extensions.size()],
+            next() % 1000000,
+            next(),
+            next(),
+            next(),
+            next(),
+            next() % 24,
+            next() % 12 + 1,
+            next() % 28 + 1,
+            next() % 24,
+            next() % 60,
+            next() % 60);
+    }
+
+    sample.resize(kSampleSize);
+    return sample;
+}
+
+}  // namespace
+
+namespace Orc::TableOutput {
+
+CompressionOptions ToCompressionOptions(std::wstring_view compression, std::error_code& ec)
+{
+    CompressionOptions options;
+    if (compression.empty())
+    {
+        return options;
+    }
+
+    std::wstring codec;
+    std::transform(std::cbegin(compression), std::cend(compression), std::back_inserter(codec), [](wchar_t c) {
+        return static_cast<wchar_t>(std::towlower(c));
+    });
+
+    if (auto separator = codec.find(L':'); separator != std::wstring::npos)
+    {
+        try
+        {
+            size_t parsed = 0;
+            options.Level = std::stoi(codec.substr(separator + 1), &parsed);
+            if (parsed != codec.size() - separator - 1)
+            {
+                ec = std::make_error_code(std::errc::invalid_argument);
+                return {};
+            }
+        }
+        catch (const std::exception&)
+        {
+            ec = std::make_error_code(std::errc::invalid_argument);
+            return {};
+        }
+
+        codec.resize(separator);
+    }
+
+    constexpr std::array codecs = {
+        std::pair(kDefault, Compression::kDefault),
+        std::pair(kNone, Compression::kNone),
+        std::pair(kGzip, Compression::kGzip),
+        std::pair(kSnappy, Compression::kSnappy),
+        std::pair(kLz4, Compression::kLz4),
+        std::pair(kZstd, Compression::kZstd),
+        std::pair(kAuto, Compression::kAuto)};
+
+    auto it = std::find_if(std::cbegin(codecs), std::cend(codecs), [&codec](const auto& c) { return codec == c.first; });
+    if (it == std::cend(codecs))
+    {
+        ec = std::make_error_code(std::errc::invalid_argument);
+        return {};
+    }
+
+    options.Codec = it->second;
+    return options;
+}
+
+std::wstring_view ToWString(Compression codec)
+{
+    switch (codec)
+    {
+        case Compression::kDefault:
+            return kDefault;
+        case Compression::kNone:
+            return kNone;
+        case Compression::kGzip:
+            return kGzip;
+        case Compression::kSnappy:
+            return kSnappy;
+        case Compression::kLz4:
+            return kLz4;
+        case Compression::kZstd:
+            return kZstd;
+        case Compression::kAuto:
+            return kAuto;
+        default:
+            return L"<invalid>"sv;
+    }
+}
+
+Compression ResolveAutoCompression(const SampleCompressor& zstd)
+{
+    static std::once_flag once;
+    static Compression resolved = Compression::kLz4;
+
+    std::call_once(once, [&zstd]() {
+        const auto sample = MakeSample();
+
+        // Best of a few runs, the first one also pays for the codec initialization
+        auto best = std::chrono::steady_clock::duration::max();
+        size_t compressed = 0;
+        for (int i = 0; i < 3; i++)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            compressed = zstd(sample);
+            best = std::min(best, std::chrono::steady_clock::now() - start);
+
+            if (compressed == 0)
+            {
+                Log::Debug(L"Failed to measure zstd throughput, using lz4");
+                return;
+            }
+        }
+
+        const auto seconds = std::max(std::chrono::duration<double>(best).count(), 1e-6);
+        const auto throughput = sample.size() / seconds;
+
+        resolved = throughput >= kAutoZstdThroughput ? Compression::kZstd : Compression::kLz4;
+        Log::Debug(
+            L"Automatic table compression: zstd at {:.0f} MB/s (ratio: {:.2f}), using {}",
+            throughput / (1024 * 1024),
+            static_cast<double>(sample.size()) / compressed,
+            ToWString(resolved));
+    });
+
+    return resolved;
+}
+
+}  // namespace Orc::TableOutput
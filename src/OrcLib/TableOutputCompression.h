@@ -0,0 +1,51 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <system_error>
+
+namespace Orc::TableOutput {
+
+// Codecs of the columnar outputs (Parquet, ORC), set with the 'compression' attribute of the output
+enum class Compression
+{
+    kDefault = 0,
+    kNone,
+    kGzip,
+    kSnappy,
+    kLz4,
+    kZstd,
+    kAuto
+};
+
+struct CompressionOptions
+{
+    Compression Codec = Compression::kDefault;
+    // Codec specific level given as 'codec:level', e.g. 'zstd:3'
+    std::optional<int> Level;
+};
+
+// Parse 'none', 'gzip', 'snappy', 'lz4', 'zstd[:level]' or 'auto'
+CompressionOptions ToCompressionOptions(std::wstring_view compression, std::error_code& ec);
+
+std::wstring_view ToWString(Compression codec);
+
+// Level used for zstd when it is selected by 'auto'
+constexpr int kAutoZstdLevel = 1;
+
+// Compress 'input' and return the compressed size, 0 on failure
+using SampleCompressor = std::function<size_t(std::string_view input)>;
+
+// Resolve 'auto' by timing zstd on a sample of table like data: zstd when it compresses faster than the output of a
+// collection usually is, lz4 otherwise. The measure is done once per process.
+Compression ResolveAutoCompression(const SampleCompressor& zstd);
+
+}  // namespace Orc::TableOutput
@@ -0,0 +1,40 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "TableOutputDictionary.h"
+
+using namespace Orc::TableOutput;
+
+std::optional<uint32_t> StringDictionary::Find(std::string_view value) const
+{
+    if (auto it = m_index.find(value); it != std::cend(m_index))
+        return it->second;
+
+    return std::nullopt;
+}
+
+std::pair<uint32_t, bool> StringDictionary::Insert(std::string_view value)
+{
+    if (auto it = m_index.find(value); it != std::cend(m_index))
+        return {it->second, false};
+
+    const auto index = static_cast<uint32_t>(m_entries.size());
+    const auto& entry = m_entries.emplace_back(value);
+    m_index.emplace(std::string_view(entry), index);
+    m_bytes += entry.size();
+    return {index, true};
+}
+
+void StringDictionary::Clear()
+{
+    m_index.clear();
+    m_entries.clear();
+    m_bytes = 0;
+}
@@ -0,0 +1,72 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+#pragma managed(push, off)
+
+namespace Orc::TableOutput {
+
+//
+// StringDictionary: distinct values of a column, in insertion order, for the writers of the columns declared with
+// 'dictionary="yes"' in the schema. Values are kept as bytes, the writer decides what they hold (UTF-8, UTF-16 or the
+// raw bytes of a value) and what is attached to each index.
+//
+// The dictionary does not refuse values once it is full: writers check IsFull() and stop adding to it.
+//
+class StringDictionary
+{
+public:
+    static constexpr size_t kDefaultMaxEntries = 1 << 20;
+    static constexpr size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+    StringDictionary(size_t maxEntries = kDefaultMaxEntries, size_t maxBytes = kDefaultMaxBytes)
+        : m_maxEntries(maxEntries)
+        , m_maxBytes(maxBytes)
+    {
+    }
+
+    // Keys of the index are views on the entries
+    StringDictionary(const StringDictionary&) = delete;
+    StringDictionary& operator=(const StringDictionary&) = delete;
+    StringDictionary(StringDictionary&&) = default;
+    StringDictionary& operator=(StringDictionary&&) = default;
+
+    std::optional<uint32_t> Find(std::string_view value) const;
+
+    // Index of 'value' and whether it was added by this call
+    std::pair<uint32_t, bool> Insert(std::string_view value);
+
+    std::string_view operator[](uint32_t index) const { return m_entries[index]; }
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    size_t Bytes() const { return m_bytes; }
+
+    bool IsFull() const { return m_entries.size() >= m_maxEntries || m_bytes >= m_maxBytes; }
+
+    void Clear();
+
+private:
+    std::deque<std::string> m_entries;
+    std::unordered_map<std::string_view, uint32_t> m_index;
+    size_t m_bytes = 0;
+
+    size_t m_maxEntries;
+    size_t m_maxBytes;
+};
+
+}  // namespace Orc::TableOutput
+
+#pragma managed(pop)
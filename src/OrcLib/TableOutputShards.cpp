@@ -0,0 +1,186 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TableOutputShards.h"
+
+#include "Buffer.h"
+#include "ByteStream.h"
+#include "OrcException.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+using namespace Orc::TableOutput;
+
+namespace {
+
+// Enable the use of std::make_shared with ShardedWriter protected constructor
+struct ShardedWriterT : public Orc::TableOutput::ShardedWriter
+{
+    template <typename... Args>
+    inline ShardedWriterT(Args&&... args)
+        : ShardedWriter(std::forward<Args>(args)...)
+    {
+    }
+};
+
+// Querying the size of the part stream may be a system call: it is only checked every few rows
+constexpr ULONGLONG kSizeCheckRows = 256LL;
+
+}  // namespace
+
+std::shared_ptr<ShardedWriter> ShardedWriter::MakeNew(
+    PartFactory factory,
+    PartClosed onClosed,
+    std::optional<ULONGLONG> maxRows,
+    std::optional<ULONGLONG> maxBytes)
+{
+    if (!factory)
+        return nullptr;
+
+    auto retval = std::make_shared<::ShardedWriterT>(std::move(factory), std::move(onClosed), maxRows, maxBytes);
+
+    retval->m_part = retval->m_factory(1L);
+    if (retval->m_part == nullptr)
+    {
+        Log::Error("Failed to create the first part of a sharded output");
+        return nullptr;
+    }
+
+    retval->m_dwPart = 1L;
+    return retval;
+}
+
+std::wstring ShardedWriter::PartName(std::wstring_view stem, std::wstring_view extension, DWORD dwPart)
+{
+    return fmt::format(L"{}_part{:06}{}", stem, dwPart, extension);
+}
+
+ShardedWriter::ShardedWriter(
+    PartFactory factory,
+    PartClosed onClosed,
+    std::optional<ULONGLONG> maxRows,
+    std::optional<ULONGLONG> maxBytes)
+    : m_factory(std::move(factory))
+    , m_onClosed(std::move(onClosed))
+    , m_maxRows(maxRows)
+    , m_maxBytes(maxBytes)
+{
+}
+
+IWriter& ShardedWriter::Part()
+{
+    if (m_bRotate && m_part != nullptr)
+    {
+        m_bRotate = false;
+        m_ullPartRows = 0LL;
+
+        // The full part is kept as long as the next one cannot be created
+        auto next = m_factory(m_dwPart + 1);
+        if (next == nullptr)
+        {
+            Log::Warn("Failed to create part {} of a sharded output, part {} keeps growing", m_dwPart + 1, m_dwPart);
+        }
+        else
+        {
+            if (m_schema)
+                next->SetSchema(m_schema);
+
+            if (auto hr = ClosePart(); FAILED(hr))
+                Log::Error(L"Failed to close part {} of a sharded output [{}]", m_dwPart, SystemError(hr));
+
+            m_part = std::move(next);
+            m_dwPart++;
+        }
+    }
+
+    if (m_part == nullptr)
+        throw Orc::Exception(Severity::Continue, E_NOT_VALID_STATE, L"Sharded output is closed");
+
+    return *m_part;
+}
+
+HRESULT ShardedWriter::ClosePart()
+{
+    auto part = std::move(m_part);
+    m_part = nullptr;
+
+    auto hr = part->Close();
+
+    if (m_onClosed)
+        m_onClosed(m_dwPart, part);
+
+    return hr;
+}
+
+STDMETHODIMP ShardedWriter::SetSchema(const Schema& columns)
+{
+    m_schema = columns;
+    return Part().SetSchema(columns);
+}
+
+STDMETHODIMP ShardedWriter::Flush()
+{
+    if (m_part == nullptr)
+        return S_OK;
+
+    return m_part->Flush();
+}
+
+STDMETHODIMP ShardedWriter::Close()
+{
+    m_bRotate = false;
+
+    if (m_part == nullptr)
+        return S_OK;
+
+    return ClosePart();
+}
+
+HRESULT ShardedWriter::WriteEndOfLine()
+{
+    if (auto hr = Part().WriteEndOfLine(); FAILED(hr))
+        return hr;
+
+    m_ullPartRows++;
+
+    if (m_maxRows && m_ullPartRows >= *m_maxRows)
+    {
+        m_bRotate = true;
+    }
+    else if (m_maxBytes && m_ullPartRows % kSizeCheckRows == 0)
+    {
+        // Rows still buffered by the writer are not counted: parts exceed the size by at most one buffer
+        auto pStreamWriter = std::dynamic_pointer_cast<IStreamWriter>(m_part);
+        if (pStreamWriter && pStreamWriter->GetStream() && pStreamWriter->GetStream()->GetSize() >= *m_maxBytes)
+            m_bRotate = true;
+    }
+
+    return S_OK;
+}
+
+HRESULT ShardedWriter::WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<WCHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return Part().WriteString(buffer.size() > 0 ? std::wstring_view(buffer.get(), buffer.size()) : L""sv);
+}
+
+HRESULT ShardedWriter::WriteFormated_(std::string_view szFormat, fmt::format_args args)
+{
+    using namespace std::string_view_literals;
+
+    Buffer<CHAR, ORC_MAX_PATH> buffer;
+    fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
+
+    return Part().WriteString(buffer.size() > 0 ? std::string_view(buffer.get(), buffer.size()) : ""sv);
+}
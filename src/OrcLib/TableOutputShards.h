@@ -0,0 +1,172 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "TableOutputWriter.h"
+
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+namespace TableOutput {
+
+//
+// ShardedWriter: split a table in parts of at most 'maxRows' rows or about 'maxBytes' bytes.
+//
+// Each part is a writer of its own made by the factory, which usually sets the schema (a schema given to SetSchema is
+// set on each part). Rows are never split: a part is closed after the row which reaches a limit, the next one is only
+// created when a value is written to it so that no empty part is left behind. Closed parts are handed to 'onClosed',
+// e.g. to be compressed while the next ones are being written.
+//
+class ShardedWriter : public IWriter
+{
+public:
+    using PartFactory = std::function<std::shared_ptr<IWriter>(DWORD dwPart)>;
+    using PartClosed = std::function<void(DWORD dwPart, const std::shared_ptr<IWriter>& part)>;
+
+    // Parts are numbered from 1, part 1 is created right away
+    static std::shared_ptr<ShardedWriter> MakeNew(
+        PartFactory factory,
+        PartClosed onClosed,
+        std::optional<ULONGLONG> maxRows,
+        std::optional<ULONGLONG> maxBytes);
+
+    // 'stem_part000001.ext': the part names of a table sort in order and are matched by 'stem_part*.ext'
+    static std::wstring PartName(std::wstring_view stem, std::wstring_view extension, DWORD dwPart);
+
+    ShardedWriter(const ShardedWriter&) = delete;
+    virtual ~ShardedWriter() = default;
+
+    DWORD Parts() const { return m_dwPart; }
+
+    STDMETHOD(SetSchema)(const Schema& columns) override final;
+
+    STDMETHOD(Flush)() override final;
+    STDMETHOD(Close)() override final;
+
+    virtual DWORD GetCurrentColumnID() override final { return Part().GetCurrentColumnID(); }
+    virtual const Column& GetCurrentColumn() override final { return Part().GetCurrentColumn(); }
+
+    STDMETHOD(WriteNothing)() override final { return Part().WriteNothing(); }
+
+    STDMETHOD(WriteString)(const std::wstring& strString) override final { return Part().WriteString(strString); }
+    STDMETHOD(WriteString)(std::wstring_view strString) override final { return Part().WriteString(strString); }
+    STDMETHOD(WriteString)(const WCHAR* szString) override final { return Part().WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return Part().WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteString)(const std::string& strString) override final { return Part().WriteString(strString); }
+    STDMETHOD(WriteString)(std::string_view strString) override final { return Part().WriteString(strString); }
+    STDMETHOD(WriteString)(const CHAR* szString) override final { return Part().WriteString(szString); }
+    STDMETHOD(WriteCharArray)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return Part().WriteCharArray(szArray, dwCharCount);
+    }
+
+    STDMETHOD(WriteAttributes)(DWORD dwAttibutes) override final { return Part().WriteAttributes(dwAttibutes); }
+
+    STDMETHOD(WriteFileTime)(FILETIME fileTime) override final { return Part().WriteFileTime(fileTime); }
+    STDMETHOD(WriteFileTime)(LONGLONG fileTime) override final { return Part().WriteFileTime(fileTime); }
+    STDMETHOD(WriteTimeStamp)(time_t tmStamp) override final { return Part().WriteTimeStamp(tmStamp); }
+    STDMETHOD(WriteTimeStamp)(tm tmStamp) override final { return Part().WriteTimeStamp(tmStamp); }
+
+    STDMETHOD(WriteFileSize)(LARGE_INTEGER fileSize) override final { return Part().WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(ULONGLONG fileSize) override final { return Part().WriteFileSize(fileSize); }
+    STDMETHOD(WriteFileSize)(DWORD nFileSizeHigh, DWORD nFileSizeLow) override final
+    {
+        return Part().WriteFileSize(nFileSizeHigh, nFileSizeLow);
+    }
+
+    STDMETHOD(WriteInteger)(DWORD dwInteger) override final { return Part().WriteInteger(dwInteger); }
+    STDMETHOD(WriteInteger)(LONGLONG dw64Integer) override final { return Part().WriteInteger(dw64Integer); }
+    STDMETHOD(WriteInteger)(ULONGLONG dw64Integer) override final { return Part().WriteInteger(dw64Integer); }
+
+    STDMETHOD(WriteBytes)(const BYTE pBytes[], DWORD dwLen) override final { return Part().WriteBytes(pBytes, dwLen); }
+    STDMETHOD(WriteBytes)(const CBinaryBuffer& Buffer) override final { return Part().WriteBytes(Buffer); }
+
+    STDMETHOD(WriteBool)(bool bBoolean) override final { return Part().WriteBool(bBoolean); }
+
+    STDMETHOD(WriteEnum)(DWORD dwEnum) override final { return Part().WriteEnum(dwEnum); }
+    STDMETHOD(WriteEnum)(DWORD dwEnum, const WCHAR* EnumValues[]) override final
+    {
+        return Part().WriteEnum(dwEnum, EnumValues);
+    }
+
+    STDMETHOD(WriteFlags)(DWORD dwFlags) override final { return Part().WriteFlags(dwFlags); }
+    STDMETHOD(WriteFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[], WCHAR cSeparator) override final
+    {
+        return Part().WriteFlags(dwFlags, FlagValues, cSeparator);
+    }
+
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags) override final { return Part().WriteExactFlags(dwFlags); }
+    STDMETHOD(WriteExactFlags)(DWORD dwFlags, const FlagsDefinition FlagValues[]) override final
+    {
+        return Part().WriteExactFlags(dwFlags, FlagValues);
+    }
+
+    STDMETHOD(WriteGUID)(const GUID& guid) override final { return Part().WriteGUID(guid); }
+
+    STDMETHOD(WriteXML)(const WCHAR* szString) override final { return Part().WriteXML(szString); }
+    STDMETHOD(WriteXML)(const CHAR* szString) override final { return Part().WriteXML(szString); }
+    STDMETHOD(WriteXML)(const WCHAR* szArray, DWORD dwCharCount) override final
+    {
+        return Part().WriteXML(szArray, dwCharCount);
+    }
+    STDMETHOD(WriteXML)(const CHAR* szArray, DWORD dwCharCount) override final
+    {
+        return Part().WriteXML(szArray, dwCharCount);
+    }
+
+    STDMETHOD(AbandonRow)() override final { return Part().AbandonRow(); }
+    STDMETHOD(AbandonColumn)() override final { return Part().AbandonColumn(); }
+
+    virtual HRESULT WriteEndOfLine() override final;
+
+protected:
+    ShardedWriter(
+        PartFactory factory,
+        PartClosed onClosed,
+        std::optional<ULONGLONG> maxRows,
+        std::optional<ULONGLONG> maxBytes);
+
+    HRESULT WriteFormated_(std::wstring_view szFormat, fmt::wformat_args args) override final;
+    HRESULT WriteFormated_(std::string_view szFormat, fmt::format_args args) override final;
+
+private:
+    // Current part, the next one is opened first if the previous row reached a limit
+    IWriter& Part();
+
+    HRESULT ClosePart();
+
+    PartFactory m_factory;
+    PartClosed m_onClosed;
+    std::optional<ULONGLONG> m_maxRows;
+    std::optional<ULONGLONG> m_maxBytes;
+
+    Schema m_schema;
+    std::shared_ptr<IWriter> m_part;
+    DWORD m_dwPart = 0L;
+    ULONGLONG m_ullPartRows = 0LL;
+    bool m_bRotate = false;
+};
+
+}  // namespace TableOutput
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -17,9 +17,12 @@
 
 #include "TableOutput.h"
 #include "TableOutputWriter.h"
+#include "TableOutputBatch.h"
 #include "ParquetOutputWriter.h"
 #include "ApacheOrcOutputWriter.h"
 #include "CsvFileWriter.h"
+#include "ColumnarFileWriter.h"
+#include "JsonLinesFileWriter.h"
 
 #include "CaseInsensitive.h"
 
@@ -36,6 +39,23 @@ using namespace boost;
 using namespace Orc;
 using namespace Orc::TableOutput;
 
+namespace {
+
+CompressionOptions GetCompressionOptions(const OutputSpec& out)
+{
+    std::error_code ec;
+    auto options = ToCompressionOptions(out.Compression, ec);
+    if (ec)
+    {
+        Log::Warn(L"Invalid table compression '{}', using the default one [{}]", out.Compression, ec);
+        return {};
+    }
+
+    return options;
+}
+
+}  // namespace
+
 std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(const OutputSpec& out)
 {
     HRESULT hr = E_FAIL;
@@ -57,6 +77,7 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(const OutputSpec& out)
             options->bBOM = true;
             options->Delimiter = out.szSeparator;
             options->StringDelimiter = out.szQuote;
+            options->dwWriteBuffers = out.WriteBuffers;
 
             auto retval = CSV::Writer::MakeNew(std::move(options));
 
@@ -85,16 +106,24 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(const OutputSpec& out)
         }
         case OutputSpec::Kind::Parquet:
         case OutputSpec::Kind::TableFile | OutputSpec::Kind::Parquet: {
-            auto options = std::make_unique<TableOutput::Options>();
+            auto options = std::make_unique<TableOutput::Parquet::Options>();
+            options->RowGroupSize = out.RowGroupSize;
+            options->dwEncoderThreads = out.EncoderThreads;
+            options->SortKeys = out.SortKeys;
+            options->BloomFilters = out.BloomFilters;
+            options->Compression = GetCompressionOptions(out);
 
-            auto pWriter = GetParquetWriter(std::move(options));
+            auto pParquetWriter = GetParquetWriter(std::move(options));
 
-            if (!pWriter)
+            if (!pParquetWriter)
             {
                 Log::Error(L"Parquet File format is not available");
                 return nullptr;
             }
 
+            // Rows are accumulated and written by column chunks
+            auto pWriter = BatchWriter::MakeNew(std::move(pParquetWriter));
+
             if (out.Schema)
             {
                 if (FAILED(hr = pWriter->SetSchema(out.Schema)))
@@ -113,16 +142,25 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(const OutputSpec& out)
         }
         case OutputSpec::Kind::ORC:
         case OutputSpec::Kind::TableFile | OutputSpec::Kind::ORC: {
-            auto options = std::make_unique<TableOutput::Options>();
+            auto options = std::make_unique<TableOutput::ApacheOrc::Options>();
+            options->MemoryLimit = out.MemoryLimit;
+            options->Compression = GetCompressionOptions(out);
+            options->RowIndexStride = out.RowIndexStride;
+            options->StripeSize = out.StripeSize;
+            options->BloomFilters = out.BloomFilters;
+            options->dwEncoderThreads = out.EncoderThreads;
 
-            auto pWriter = GetApacheOrcWriter(std::move(options));
+            auto pOrcWriter = GetApacheOrcWriter(std::move(options));
 
-            if (!pWriter)
+            if (!pOrcWriter)
             {
                 Log::Error(L"Parquet File format is not available");
                 return nullptr;
             }
 
+            // Rows are accumulated and written by column chunks
+            auto pWriter = BatchWriter::MakeNew(std::move(pOrcWriter));
+
             if (out.Schema)
             {
                 if (FAILED(hr = pWriter->SetSchema(out.Schema)))
@@ -139,6 +177,50 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(const OutputSpec& out)
             }
             return pWriter;
         }
+        case OutputSpec::Kind::Columnar:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::Columnar: {
+            auto options = std::make_unique<TableOutput::Columnar::Options>();
+            if (out.RowGroupSize.has_value())
+                options->dwBlockRows = out.RowGroupSize.value();
+
+            auto retval = Columnar::Writer::MakeNew(std::move(options));
+
+            if (out.Schema)
+            {
+                if (FAILED(hr = retval->SetSchema(out.Schema)))
+                {
+                    Log::Error(L"Could not set schema to columnar file: '{}' [{}]", out.Path, SystemError(hr));
+                    return nullptr;
+                }
+            }
+
+            if (FAILED(hr = retval->WriteToFile(out.Path)))
+            {
+                Log::Error(L"Could not create specified file: '{}' [{}]", out.Path, SystemError(hr));
+                return nullptr;
+            }
+            return retval;
+        }
+        case OutputSpec::Kind::JSONL:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::JSONL: {
+            auto retval = JSONL::Writer::MakeNew(std::make_unique<TableOutput::JSONL::Options>());
+
+            if (FAILED(hr = retval->WriteToFile(out.Path)))
+            {
+                Log::Error(L"Could not create specified file: '{}' [{}]", out.Path, SystemError(hr));
+                return nullptr;
+            }
+
+            if (out.Schema)
+            {
+                if (FAILED(hr = retval->SetSchema(out.Schema)))
+                {
+                    Log::Error(L"Could not set schema to JSON Lines file: '{}' [{}]", out.Path, SystemError(hr));
+                    return nullptr;
+                }
+            }
+            return retval;
+        }
 
         default:
             Log::Error("Invalid type of output to create SecDescrWriter");
@@ -164,6 +246,10 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(LPCWSTR szFileName, const O
         case OutputSpec::Kind::TableFile | OutputSpec::Kind::TSV:
         case OutputSpec::Kind::TableFile | OutputSpec::Kind::Parquet:
         case OutputSpec::Kind::TableFile | OutputSpec::Kind::ORC:
+        case OutputSpec::Kind::Columnar:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::Columnar:
+        case OutputSpec::Kind::JSONL:
+        case OutputSpec::Kind::TableFile | OutputSpec::Kind::JSONL:
         case OutputSpec::Kind::Directory: {
             std::wstring strFilePath = out.Path + L"\\" + szFileName;
 
@@ -192,10 +278,12 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(LPCWSTR szFileName, const O
             return nullptr;
     }
 
-    auto options = std::make_unique<TableOutput::CSV::Options>();
-    options->Encoding = out.OutputEncoding;
-
-    auto retval = TableOutput::CSV::Writer::MakeNew(std::move(options));
+    auto retval = GetStreamWriter(out);
+    if (retval == nullptr)
+    {
+        Log::Error(L"Could not create writer for output '{}'", szFileName);
+        return nullptr;
+    }
 
     if (FAILED(hr = retval->WriteToStream(pStream)))
     {
@@ -219,6 +307,20 @@ std::shared_ptr<IWriter> Orc::TableOutput::GetWriter(LPCWSTR szFileName, const O
     return retval;
 }
 
+std::shared_ptr<IStreamWriter> Orc::TableOutput::GetStreamWriter(const OutputSpec& out)
+{
+    if (out.TableFormat == OutputSpec::Kind::JSONL)
+    {
+        return JSONL::Writer::MakeNew(std::make_unique<TableOutput::JSONL::Options>());
+    }
+
+    auto options = std::make_unique<TableOutput::CSV::Options>();
+    options->Encoding = out.OutputEncoding;
+    options->dwWriteBuffers = out.WriteBuffers;
+
+    return GetCSVWriter(std::move(options));
+}
+
 std::shared_ptr<IStreamWriter> Orc::TableOutput::GetCSVWriter(std::unique_ptr<Options> options)
 {
     auto retval = Orc::TableOutput::CSV::Writer::MakeNew(std::move(options));
@@ -251,6 +353,11 @@ std::shared_ptr<IStreamWriter> Orc::TableOutput::GetApacheOrcWriter(std::unique_
     return extension->StreamTableFactory(std::move(options));
 }
 
+STDMETHODIMP Orc::TableOutput::IWriter::WriteBatch(const RecordBatch& batch)
+{
+    return batch.WriteTo(*this);
+}
+
 TableOutput::Schema Orc::TableOutput::GetColumnsFromConfig(const LPCWSTR szTableName, const ConfigItem& item)
 {
     HRESULT hr = E_FAIL;
@@ -374,6 +481,13 @@ TableOutput::Schema Orc::TableOutput::GetColumnsFromConfig(const LPCWSTR szTable
             {
                 aCol->Format = format;
             }
+            if (const auto& dictionary = column.SubItems[CONFIG_SCHEMA_COLUMN_DICTIONARY])
+            {
+                if (equalCaseInsensitive((const std::wstring&)dictionary, YES, YES.size()))
+                    aCol->bDictionary = true;
+                else if (equalCaseInsensitive((const std::wstring&)dictionary, NO, NO.size()))
+                    aCol->bDictionary = false;
+            }
 
             try
             {
@@ -15,6 +15,7 @@
 #include <ObjIdl.h>
 
 #include "TableOutput.h"
+#include "TableOutputCompression.h"
 #include "OutputSpec.h"
 
 #pragma managed(push, off)
@@ -47,12 +48,17 @@ public:
 
 class IConnectWriter;
 class IStreamWriter;
+class RecordBatch;
+class BatchColumn;
 
 class IWriter : public IOutput
 {
 public:
     STDMETHOD(SetSchema)(const Schema& columns) PURE;
 
+    // Write all the rows of a batch, replaying them row by row unless the writer has a columnar path
+    STDMETHOD(WriteBatch)(const RecordBatch& batch);
+
     STDMETHOD(Flush)() PURE;
     STDMETHOD(Close)() PURE;
 };
@@ -66,6 +72,8 @@ struct Options : Orc::TableOutput::Options
 {
     OutputSpec::Encoding Encoding = OutputSpec::Encoding::UTF8;
     DWORD dwBufferSize = WRITE_BUFFER;
+    // Number of pages of 'dwBufferSize', more than one enables a background thread writing the full pages
+    DWORD dwWriteBuffers = 0L;
     bool bBOM = true;
     std::wstring Delimiter = L","s;
     std::wstring StringDelimiter = L"\""s;
@@ -74,10 +82,43 @@ struct Options : Orc::TableOutput::Options
 };
 }  // namespace CSV
 
+namespace Columnar {
+
+constexpr DWORD kDefaultBlockRows = 16384L;
+
+struct Options : Orc::TableOutput::Options
+{
+    // Rows per block, each block has its own min/max values and dictionary additions
+    DWORD dwBlockRows = kDefaultBlockRows;
+};
+}  // namespace Columnar
+
+namespace JSONL {
+
+struct Options : Orc::TableOutput::Options
+{
+    // Bytes of the page rows are formatted to, written to the stream whenever it is full
+    DWORD dwBufferSize = CSV::WRITE_BUFFER;
+};
+}  // namespace JSONL
+
 namespace Parquet {
+
+constexpr DWORD kDefaultRowGroupSize = 10000L;
+
 struct Options : Orc::TableOutput::Options
 {
     std::optional<DWORD> BatchSize;
+    std::optional<DWORD> RowGroupSize;
+    // Threads building the column chunks of full row groups while rows are still being written, 0 to build them on
+    // the calling thread
+    DWORD dwEncoderThreads = 0L;
+    CompressionOptions Compression;
+    // Rows of each row group are sorted by these columns (ascending, nulls last) so that the min/max statistics of the
+    // row groups and pages are selective
+    std::vector<std::wstring> SortKeys;
+    // Columns with a bloom filter in each row group, for point lookups (hashes, names)
+    std::vector<std::wstring> BloomFilters;
 };
 }  // namespace Parquet
 
@@ -92,12 +133,25 @@ struct Options : Orc::TableOutput::Options
 {
     std::optional<DWORD> BatchSize;
     std::optional<std::pair<std::wstring, std::vector<BYTE>>> TimeZone;
+    // Ceiling of the memory used by the writer and its batch, which is written early to stay below it
+    std::optional<ULONGLONG> MemoryLimit;
+    CompressionOptions Compression;
+    // Rows per row index entry (0 disables the index) and bytes of the stripes, orc defaults otherwise
+    std::optional<DWORD> RowIndexStride;
+    std::optional<ULONGLONG> StripeSize;
+    // Columns with a bloom filter in each row index entry, for point lookups (hashes, names)
+    std::vector<std::wstring> BloomFilters;
+    // More than 0 to add full batches to the orc writer on a background thread while the next one is filled
+    DWORD dwEncoderThreads = 0L;
 };
 }  // namespace ApacheOrc
 
 [[nodiscard]] std::shared_ptr<IWriter> GetWriter(const OutputSpec& out);
 [[nodiscard]] std::shared_ptr<IWriter> GetWriter(LPCWSTR szFileName, const OutputSpec& out);
 
+// Writer of the table files of directory and archive outputs: CSV, or JSON Lines when 'TableFormat' says so
+[[nodiscard]] std::shared_ptr<IStreamWriter> GetStreamWriter(const OutputSpec& out);
+
 [[nodiscard]] std::shared_ptr<IStreamWriter> GetCSVWriter(std::unique_ptr<Options> options);
 [[nodiscard]] std::shared_ptr<IStreamWriter> GetParquetWriter(std::unique_ptr<Options> options);
 [[nodiscard]] std::shared_ptr<IStreamWriter> GetApacheOrcWriter(std::unique_ptr<Options> options);
@@ -0,0 +1,142 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TaskPool.h"
+
+#include "CpuInfo.h"
+#include "HostProfile.h"
+#include "JobObject.h"
+
+#include <algorithm>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+int ContextPriority(TaskPool::Priority priority)
+{
+    switch (priority)
+    {
+        case TaskPool::Priority::Background:
+            return THREAD_PRIORITY_BELOW_NORMAL;
+        case TaskPool::Priority::Normal:
+        default:
+            return THREAD_PRIORITY_NORMAL;
+    }
+}
+
+}  // namespace
+
+TaskPool::Scope::Scope(Subsystem subsystem)
+{
+    auto pScheduler = TaskPool::Instance().GetScheduler(subsystem);
+    if (pScheduler == nullptr)
+        return;
+
+    // A chore of the subsystem already runs on its scheduler, which cannot be attached twice in a row
+    if (concurrency::CurrentScheduler::Id() == pScheduler->Id())
+        return;
+
+    pScheduler->Attach();
+    m_bAttached = true;
+}
+
+TaskPool::Scope::~Scope()
+{
+    if (m_bAttached)
+        concurrency::CurrentScheduler::Detach();
+}
+
+TaskPool& TaskPool::Instance()
+{
+    static TaskPool instance;
+    return instance;
+}
+
+TaskPool::TaskPool()
+{
+    // Affinity and job CPU rate cap
+    m_ulProcessors = JobObject::GetJobObject().GetProcessorLimit();
+
+    const CpuInfo cpu;
+    if (auto cores = cpu.LogicalCores(); cores && *cores > 0)
+        m_ulProcessors = std::min<ULONG>(m_ulProcessors, *cores);
+
+    // Hosts short of memory run fewer workers than processors
+    if (const auto dwThreads = HostProfile::Instance().Threads(); dwThreads > 0)
+        m_ulProcessors = std::min<ULONG>(m_ulProcessors, dwThreads);
+
+    m_ulProcessors = std::max(m_ulProcessors, 1UL);
+}
+
+TaskPool::Priority TaskPool::GetPriority(Subsystem subsystem)
+{
+    switch (subsystem)
+    {
+        case Subsystem::Archive:
+            return Priority::Background;
+        default:
+            return Priority::Normal;
+    }
+}
+
+std::string_view TaskPool::ToString(Subsystem subsystem)
+{
+    switch (subsystem)
+    {
+        case Subsystem::Walk:
+            return "walk";
+        case Subsystem::Table:
+            return "table";
+        case Subsystem::Hash:
+            return "hash";
+        case Subsystem::Archive:
+            return "archive";
+        default:
+            return "unknown";
+    }
+}
+
+concurrency::Scheduler* TaskPool::GetScheduler(Subsystem subsystem)
+{
+    if (subsystem >= Subsystem::Count)
+        return nullptr;
+
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    auto& pScheduler = m_Schedulers[static_cast<size_t>(subsystem)];
+    if (pScheduler != nullptr)
+        return pScheduler;
+
+    const auto priority = ContextPriority(GetPriority(subsystem));
+
+    try
+    {
+        // Schedulers are never released: their workers may still run chores while the process exits
+        pScheduler = concurrency::Scheduler::Create(concurrency::SchedulerPolicy(
+            3,
+            concurrency::MinConcurrency,
+            1,
+            concurrency::MaxConcurrency,
+            m_ulProcessors,
+            concurrency::ContextPriority,
+            priority));
+    }
+    catch (const std::exception& e)
+    {
+        Log::Warn(
+            "Failed to create {} scheduler, using the default one [exception: {}]", ToString(subsystem), e.what());
+        return nullptr;
+    }
+
+    Log::Debug("Created {} scheduler (processors: {}, priority: {})", ToString(subsystem), m_ulProcessors, priority);
+    return pScheduler;
+}
@@ -0,0 +1,100 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <string_view>
+
+#include <concrt.h>
+#include <ppl.h>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// TaskPool: process wide schedulers for the parallel work of the tools.
+//
+// Each subsystem runs its chores on its own concurrency runtime scheduler instead of the default one. Schedulers
+// steal work between their workers, group them by NUMA node and favor running a chore on the node it was scheduled
+// from. The resource manager shares the processors between the schedulers of the process: subsystems running at the
+// same time split the processors instead of each of them starting a thread per processor.
+//
+// Schedulers are limited to the processors available to the process: logical cores (CpuInfo), affinity and the hard
+// CPU rate cap of the job the process runs in (JobRestrictions' CpuRateControl), and to the threads of the host profile
+// (HostProfile). Each subsystem has a priority class applied to its workers: background work does not delay the walks
+// the collection waits for.
+//
+class TaskPool
+{
+public:
+    enum class Subsystem : UCHAR
+    {
+        Walk = 0,  // MFT, FAT and registry hive walks
+        Table,  // table parsing
+        Hash,  // file hashing
+        Archive,  // compression, encryption and extraction
+        Count
+    };
+
+    enum class Priority : UCHAR
+    {
+        Normal = 0,
+        Background
+    };
+
+    // Run the chores created by the current thread on the scheduler of 'subsystem' for the lifetime of the instance
+    class Scope
+    {
+    public:
+        Scope(Subsystem subsystem);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        bool m_bAttached = false;
+    };
+
+    static TaskPool& Instance();
+
+    // Processors the schedulers may use
+    ULONG Processors() const { return m_ulProcessors; }
+
+    static Priority GetPriority(Subsystem subsystem);
+    static std::string_view ToString(Subsystem subsystem);
+
+    // Scheduler of 'subsystem', created on first use (nullptr if it cannot be created)
+    concurrency::Scheduler* GetScheduler(Subsystem subsystem);
+
+    // Call 'function(i)' for each i in [first, last) on the scheduler of 'subsystem', return when all calls are done
+    template <typename Index, typename Function>
+    static void ParallelFor(Subsystem subsystem, Index first, Index last, const Function& function)
+    {
+        Scope scope(subsystem);
+        concurrency::parallel_for(first, last, function);
+    }
+
+private:
+    TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    ULONG m_ulProcessors;
+
+    concurrency::critical_section m_cs;
+    std::array<concurrency::Scheduler*, static_cast<size_t>(Subsystem::Count)> m_Schedulers = {};
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -8,6 +8,8 @@
 #include "stdafx.h"
 #include "TeeStream.h"
 
+#include "TaskPool.h"
+
 using namespace Orc;
 
 HRESULT TeeStream::Close()
@@ -24,12 +26,44 @@ HRESULT TeeStream::Close()
     return hr;
 }
 
-HRESULT TeeStream::Open(std::vector<std::shared_ptr<ByteStream>>&& Streams)
+HRESULT TeeStream::Open(std::vector<std::shared_ptr<ByteStream>>&& Streams, bool bConcurrent)
 {
     std::swap(m_Streams, Streams);
+    m_bConcurrent = bConcurrent;
     return S_OK;
 }
 
+template <typename WriteFunction>
+HRESULT TeeStream::ForEachStream(ULONGLONG cbBytes, const WriteFunction& write)
+{
+    if (!m_bConcurrent || m_Streams.size() < 2 || cbBytes < kMinConcurrentWrite)
+    {
+        HRESULT hr = S_OK;
+        for (const auto& stream : m_Streams)
+        {
+            auto stream_hr = E_FAIL;
+            if (stream && FAILED(stream_hr = write(*stream)))
+                hr = stream_hr;
+        }
+        return hr;
+    }
+
+    // Outputs are archives, their copies and their hashes
+    std::vector<HRESULT> results(m_Streams.size(), S_OK);
+    TaskPool::ParallelFor(TaskPool::Subsystem::Archive, size_t(0), m_Streams.size(), [&](size_t i) {
+        if (m_Streams[i])
+            results[i] = write(*m_Streams[i]);
+    });
+
+    HRESULT hr = S_OK;
+    for (const auto stream_hr : results)
+    {
+        if (FAILED(stream_hr))
+            hr = stream_hr;
+    }
+    return hr;
+}
+
 HRESULT TeeStream::Read_(
     __out_bcount_part(cbBytesToRead, *pcbBytesRead) PVOID pBuffer,
     __in ULONGLONG cbBytesToRead,
@@ -53,20 +87,32 @@ TeeStream::Write_(
     if (cbBytes > MAXDWORD)
         return E_INVALIDARG;
 
-    HRESULT hr = S_OK;
-
-    for (const auto& stream : m_Streams)
-    {
-        auto stream_hr = E_FAIL;
-        if (stream && FAILED(stream_hr = stream->Write(pBuffer, cbBytes, pcbBytesWritten)))
-            hr = stream_hr;
-    }
+    // Every output sees the same buffer
+    HRESULT hr = ForEachStream(cbBytes, [pBuffer, cbBytes](ByteStream& stream) {
+        ULONGLONG cbWritten = 0LL;
+        return stream.Write(pBuffer, cbBytes, &cbWritten);
+    });
 
     if (pcbBytesWritten)
         *pcbBytesWritten = cbBytes;
     return hr;
 }
 
+HRESULT TeeStream::WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten)
+{
+    ULONGLONG cbBytes = 0LL;
+    for (const auto& buffer : buffers)
+        cbBytes += buffer.size();
+
+    HRESULT hr = ForEachStream(cbBytes, [buffers](ByteStream& stream) {
+        ULONGLONG cbWritten = 0LL;
+        return stream.WriteV(buffers, &cbWritten);
+    });
+
+    *pcbBytesWritten = cbBytes;
+    return hr;
+}
+
 HRESULT
 TeeStream::SetFilePointer(__in LONGLONG lDistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pqwCurrPointer)
 {
@@ -16,6 +16,16 @@ class TeeStream : public ByteStream
 {
 protected:
     std::vector<std::shared_ptr<ByteStream>> m_Streams;
+    bool m_bConcurrent = false;
+
+    // Outputs do not write concurrently smaller chunks
+    static constexpr ULONGLONG kMinConcurrentWrite = 64 * 1024LL;
+
+    // Call 'write' for each output (concurrently when they are independent), return the last failure
+    template <typename WriteFunction>
+    HRESULT ForEachStream(ULONGLONG cbBytes, const WriteFunction& write);
+
+    HRESULT WriteV_(gsl::span<const BufferView> buffers, PULONGLONG pcbBytesWritten) override;
 
 public:
     TeeStream()
@@ -53,7 +63,8 @@ public:
     //
     // CByteStream implementation
     //
-    STDMETHOD(Open)(std::vector<std::shared_ptr<ByteStream>>&& Streams);
+    // 'bConcurrent' when the outputs do not share any stream: they then all write the same buffer at the same time
+    STDMETHOD(Open)(std::vector<std::shared_ptr<ByteStream>>&& Streams, bool bConcurrent = false);
 
     STDMETHOD(Read_)
     (__out_bcount_part(cbBytes, *pcbBytesRead) PVOID pReadBuffer,
@@ -0,0 +1,353 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Telemetry.h"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcTelemetryEnv = L"DFIR-ORC_TELEMETRY";
+constexpr auto PhaseCount = static_cast<size_t>(Telemetry::Phase::Count);
+
+// The process collecting its children statistics does not save its own
+bool g_bCollector = false;
+
+thread_local Telemetry::Phase g_currentPhase = Telemetry::Phase::Count;
+
+struct Slot
+{
+    std::atomic<ULONGLONG> Operations {0LL};
+    std::atomic<ULONGLONG> Bytes {0LL};
+    std::atomic<ULONGLONG> Ticks {0LL};
+};
+
+struct alignas(64) ThreadCounters
+{
+    ThreadCounters();
+    ~ThreadCounters();
+
+    // Only the owning thread writes its slots: plain load/store pairs avoid any interlocked instruction, readers
+    // may just miss the latest operations
+    void Add(Telemetry::Phase phase, ULONGLONG ullBytes, ULONGLONG ullTicks)
+    {
+        auto& slot = Slots[static_cast<size_t>(phase)];
+        slot.Operations.store(slot.Operations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        slot.Bytes.store(slot.Bytes.load(std::memory_order_relaxed) + ullBytes, std::memory_order_relaxed);
+        slot.Ticks.store(slot.Ticks.load(std::memory_order_relaxed) + ullTicks, std::memory_order_relaxed);
+    }
+
+    Slot Slots[PhaseCount];
+};
+
+struct Totals
+{
+    ULONGLONG Operations[PhaseCount] = {};
+    ULONGLONG Bytes[PhaseCount] = {};
+    ULONGLONG Ticks[PhaseCount] = {};
+
+    void Add(const ThreadCounters& counters)
+    {
+        for (size_t i = 0; i < PhaseCount; i++)
+        {
+            Operations[i] += counters.Slots[i].Operations.load(std::memory_order_relaxed);
+            Bytes[i] += counters.Slots[i].Bytes.load(std::memory_order_relaxed);
+            Ticks[i] += counters.Slots[i].Ticks.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+class Registry
+{
+public:
+    static Registry& Instance()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    void Register(const ThreadCounters* pCounters)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_live.push_back(pCounters);
+    }
+
+    void Retire(const ThreadCounters* pCounters)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retired.Add(*pCounters);
+        m_live.erase(std::remove(std::begin(m_live), std::end(m_live), pCounters), std::end(m_live));
+    }
+
+    Totals Sum() const
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        Totals totals = m_retired;
+        for (const auto pCounters : m_live)
+        {
+            totals.Add(*pCounters);
+        }
+
+        return totals;
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<const ThreadCounters*> m_live;
+    Totals m_retired;
+};
+
+ThreadCounters::ThreadCounters()
+{
+    Registry::Instance().Register(this);
+}
+
+ThreadCounters::~ThreadCounters()
+{
+    Registry::Instance().Retire(this);
+}
+
+ThreadCounters& CurrentThreadCounters()
+{
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+LONGLONG PerformanceFrequency()
+{
+    static const LONGLONG frequency = []() {
+        LARGE_INTEGER li;
+        QueryPerformanceFrequency(&li);
+        return li.QuadPart;
+    }();
+
+    return frequency;
+}
+
+std::filesystem::path StatisticsPath(const std::wstring& strDirectory, DWORD dwPid)
+{
+    return std::filesystem::path(strDirectory) / fmt::format(L"{}.tsv", dwPid);
+}
+
+}  // namespace
+
+Telemetry::Scope::Scope(Phase phase)
+    : m_phase(phase)
+    , m_previous(g_currentPhase)
+{
+    g_currentPhase = phase;
+    QueryPerformanceCounter(&m_start);
+}
+
+Telemetry::Scope::~Scope()
+{
+    LARGE_INTEGER end;
+    QueryPerformanceCounter(&end);
+    Record(m_phase, m_ullBytes, end.QuadPart - m_start.QuadPart);
+    g_currentPhase = m_previous;
+}
+
+void Telemetry::Record(Phase phase, ULONGLONG ullBytes, ULONGLONG ullTicks)
+{
+    if (phase >= Phase::Count)
+        return;
+
+    CurrentThreadCounters().Add(phase, ullBytes, ullTicks);
+}
+
+Telemetry::Phase Telemetry::CurrentPhase()
+{
+    return g_currentPhase;
+}
+
+Telemetry::Statistics Telemetry::GetStatistics()
+{
+    const auto totals = Registry::Instance().Sum();
+    const auto frequency = static_cast<ULONGLONG>(PerformanceFrequency());
+
+    Statistics statistics;
+    for (size_t i = 0; i < PhaseCount; i++)
+    {
+        statistics[i].Operations = totals.Operations[i];
+        statistics[i].Bytes = totals.Bytes[i];
+
+        // Split the conversion to avoid overflowing with long runs and high frequencies
+        const auto ticks = totals.Ticks[i];
+        const auto us = (ticks / frequency) * 1000000ULL + ((ticks % frequency) * 1000000ULL) / frequency;
+        statistics[i].Duration = std::chrono::microseconds(static_cast<LONGLONG>(us));
+    }
+
+    return statistics;
+}
+
+std::wstring_view Telemetry::ToString(Phase phase)
+{
+    switch (phase)
+    {
+        case Phase::VolumeRead:
+            return L"volume_read";
+        case Phase::MFTWalk:
+            return L"mft_walk";
+        case Phase::Hash:
+            return L"hash";
+        case Phase::YaraScan:
+            return L"yara_scan";
+        case Phase::TableWrite:
+            return L"table_write";
+        case Phase::ArchiveFlush:
+            return L"archive_flush";
+        case Phase::IoThrottle:
+            return L"io_throttle";
+        default:
+            return L"unknown";
+    }
+}
+
+HRESULT Telemetry::ConfigureDirectory(const std::wstring& strDirectory)
+{
+    std::error_code ec;
+    const auto directory = std::filesystem::absolute(strDirectory, ec);
+    if (ec)
+    {
+        Log::Error(L"Invalid telemetry directory '{}' [{}]", strDirectory, ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        Log::Error(L"Failed to create telemetry directory '{}' [{}]", directory.wstring(), ec);
+        return HRESULT_FROM_WIN32(ec.value());
+    }
+
+    if (!SetEnvironmentVariableW(OrcTelemetryEnv, directory.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcTelemetryEnv, directory.wstring(), SystemError(hr));
+        return hr;
+    }
+
+    g_bCollector = true;
+    Log::Debug(L"Command statistics are collected in '{}'", directory.wstring());
+    return S_OK;
+}
+
+std::optional<std::wstring> Telemetry::GetDirectory()
+{
+    DWORD nbChars = GetEnvironmentVariableW(OrcTelemetryEnv, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring strDirectory(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(OrcTelemetryEnv, strDirectory.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    strDirectory.resize(nbChars);
+    return strDirectory;
+}
+
+bool Telemetry::IsCollector()
+{
+    return g_bCollector;
+}
+
+HRESULT Telemetry::Save()
+{
+    const auto directory = GetDirectory();
+    if (!directory || g_bCollector)
+        return S_FALSE;
+
+    const auto path = StatisticsPath(*directory, GetCurrentProcessId());
+
+    // Format: one tab separated line per phase: <phase> <operations> <bytes> <microseconds>
+    std::ofstream ofs(path, std::ios_base::binary | std::ios_base::trunc);
+    if (!ofs)
+    {
+        Log::Warn(L"Failed to create statistics file '{}'", path.wstring());
+        return E_FAIL;
+    }
+
+    const auto statistics = GetStatistics();
+    for (size_t i = 0; i < PhaseCount; i++)
+    {
+        ofs << i << '\t' << statistics[i].Operations << '\t' << statistics[i].Bytes << '\t'
+            << statistics[i].Duration.count() << '\n';
+    }
+
+    ofs.close();
+    if (ofs.fail())
+    {
+        Log::Warn(L"Failed to write statistics file '{}'", path.wstring());
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+std::optional<Telemetry::Statistics> Telemetry::Load(DWORD dwPid)
+{
+    const auto directory = GetDirectory();
+    if (!directory)
+        return std::nullopt;
+
+    const auto path = StatisticsPath(*directory, dwPid);
+
+    Statistics statistics;
+    bool bFound = false;
+
+    {
+        std::ifstream ifs(path, std::ios_base::binary);
+        if (!ifs)
+            return std::nullopt;
+
+        size_t index = 0;
+        ULONGLONG ullOperations = 0LL, ullBytes = 0LL;
+        LONGLONG llDuration = 0LL;
+        while (ifs >> index >> ullOperations >> ullBytes >> llDuration)
+        {
+            if (index >= PhaseCount)
+                continue;
+
+            statistics[index].Operations = ullOperations;
+            statistics[index].Bytes = ullBytes;
+            statistics[index].Duration = std::chrono::microseconds(llDuration);
+            bFound = true;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+    if (ec)
+    {
+        Log::Debug(L"Failed to remove statistics file '{}' [{}]", path.wstring(), ec);
+    }
+
+    if (!bFound)
+        return std::nullopt;
+
+    return statistics;
+}
@@ -0,0 +1,101 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// Telemetry: process wide operation, byte and time counters for the main phases of the tools.
+//
+// Each thread accumulates into its own counters, recording does not take any lock nor share a cache line with other
+// threads. Counters of exited threads are folded into the process totals. Phases may nest (a MFT walk reads the
+// volume): their durations overlap.
+//
+// When %DFIR-ORC_TELEMETRY% designates a directory (WolfLauncher sets it for its commands), Save writes the process
+// counters to '<directory>\<pid>.tsv' so the parent process can report them with the command outcome.
+//
+class Telemetry
+{
+public:
+    enum class Phase : UCHAR
+    {
+        VolumeRead = 0,
+        MFTWalk,
+        Hash,
+        YaraScan,
+        TableWrite,
+        ArchiveFlush,
+        IoThrottle,
+        Count
+    };
+
+    struct Counters
+    {
+        ULONGLONG Operations = 0LL;
+        ULONGLONG Bytes = 0LL;
+        std::chrono::microseconds Duration = std::chrono::microseconds::zero();
+    };
+
+    using Statistics = std::array<Counters, static_cast<size_t>(Phase::Count)>;
+
+    // Time the lifetime of the instance as one operation of 'phase', which is the thread's current phase meanwhile
+    class Scope
+    {
+    public:
+        Scope(Phase phase);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        void AddBytes(ULONGLONG ullBytes) { m_ullBytes += ullBytes; }
+
+    private:
+        Phase m_phase;
+        Phase m_previous;
+        LARGE_INTEGER m_start;
+        ULONGLONG m_ullBytes = 0LL;
+    };
+
+    static void Record(Phase phase, ULONGLONG ullBytes, ULONGLONG ullTicks);
+
+    // Innermost phase timed by a Scope of the calling thread, Phase::Count outside of any
+    static Phase CurrentPhase();
+
+    // Current totals of the process, including exited threads
+    static Statistics GetStatistics();
+
+    static std::wstring_view ToString(Phase phase);
+
+    static HRESULT ConfigureDirectory(const std::wstring& strDirectory);
+    static std::optional<std::wstring> GetDirectory();
+
+    // This process configured the telemetry directory to collect its children statistics
+    static bool IsCollector();
+
+    // Write this process statistics to the telemetry directory, if any and not configured by this process (S_FALSE
+    // otherwise)
+    static HRESULT Save();
+
+    // Read and remove the statistics saved by process 'dwPid'
+    static std::optional<Statistics> Load(DWORD dwPid);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,197 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TemporaryMemoryBudget.h"
+
+#include "TemporaryStream.h"
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace Orc;
+
+TemporaryMemoryBudget& TemporaryMemoryBudget::Instance()
+{
+    static TemporaryMemoryBudget budget;
+    return budget;
+}
+
+ULONGLONG TemporaryMemoryBudget::GetLimit() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_ullLimit;
+}
+
+void TemporaryMemoryBudget::SetLimit(ULONGLONG ullLimit)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_ullLimit = ullLimit;
+}
+
+TemporaryMemoryBudget::SpillPolicy TemporaryMemoryBudget::GetSpillPolicy() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_policy;
+}
+
+void TemporaryMemoryBudget::SetSpillPolicy(SpillPolicy policy)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    m_policy = policy;
+}
+
+bool TemporaryMemoryBudget::Acquire(TemporaryStream& stream, ULONGLONG ullTotal)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto it = m_streams.find(&stream);
+    if (it == std::end(m_streams))
+    {
+        Entry entry;
+        entry.strTag = stream.GetBudgetTag();
+        entry.ullSequence = m_ullSequence++;
+        it = m_streams.emplace(&stream, std::move(entry)).first;
+    }
+
+    auto& entry = it->second;
+    if (ullTotal <= entry.ullUsage)
+        return true;
+
+    // The soft limit of the temporary streams' memory tag lowers the budget
+    auto ullLimit = m_ullLimit;
+    if (const auto ullSoftLimit = MemoryAccounting::GetSoftLimit(MemoryAccounting::Tag::TemporaryStream))
+        ullLimit = ullLimit == kUnlimited ? ullSoftLimit : std::min(ullLimit, ullSoftLimit);
+
+    const auto ullDelta = ullTotal - entry.ullUsage;
+    if (ullLimit != kUnlimited)
+    {
+        if (ullDelta > ullLimit)
+            return false;
+
+        if (m_ullUsage + ullDelta > ullLimit)
+            SpillUntil(stream, ullLimit - ullDelta);
+
+        if (m_ullUsage + ullDelta > ullLimit)
+        {
+            Log::Debug(
+                L"TemporaryMemoryBudget: {} bytes requested for '{}' exceed the budget (usage: {}, limit: {})",
+                ullDelta,
+                entry.strTag,
+                m_ullUsage,
+                ullLimit);
+            return false;
+        }
+    }
+
+    entry.ullUsage = ullTotal;
+    m_ullUsage += ullDelta;
+    MemoryAccounting::Charge(MemoryAccounting::Tag::TemporaryStream, ullDelta);
+    m_ullPeakUsage = std::max(m_ullPeakUsage, m_ullUsage);
+
+    auto& tag = m_tags[entry.strTag];
+    tag.ullUsage += ullDelta;
+    tag.statistics.PeakUsage = std::max(tag.statistics.PeakUsage, tag.ullUsage);
+    return true;
+}
+
+void TemporaryMemoryBudget::Release(TemporaryStream& stream, bool bSpilled)
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto it = m_streams.find(&stream);
+    if (it == std::end(m_streams))
+        return;
+
+    Remove(it, bSpilled);
+}
+
+void TemporaryMemoryBudget::Remove(std::unordered_map<TemporaryStream*, Entry>::iterator it, bool bSpilled)
+{
+    const auto& entry = it->second;
+
+    auto& tag = m_tags[entry.strTag];
+    tag.ullUsage -= entry.ullUsage;
+    if (bSpilled)
+        tag.statistics.SpillCount++;
+
+    m_ullUsage -= entry.ullUsage;
+    MemoryAccounting::Release(MemoryAccounting::Tag::TemporaryStream, entry.ullUsage);
+    m_streams.erase(it);
+}
+
+void TemporaryMemoryBudget::SpillUntil(const TemporaryStream& requester, ULONGLONG ullTarget)
+{
+    std::vector<std::unordered_map<TemporaryStream*, Entry>::iterator> candidates;
+    for (auto it = std::begin(m_streams); it != std::end(m_streams); ++it)
+    {
+        if (it->first != &requester && it->second.ullUsage > 0)
+            candidates.push_back(it);
+    }
+
+    if (m_policy == SpillPolicy::LargestFirst)
+    {
+        std::sort(std::begin(candidates), std::end(candidates), [](const auto& lhs, const auto& rhs) {
+            return lhs->second.ullUsage > rhs->second.ullUsage;
+        });
+    }
+    else
+    {
+        std::sort(std::begin(candidates), std::end(candidates), [](const auto& lhs, const auto& rhs) {
+            return lhs->second.ullSequence < rhs->second.ullSequence;
+        });
+    }
+
+    for (const auto& it : candidates)
+    {
+        if (m_ullUsage <= ullTarget)
+            break;
+
+        // Busy streams are skipped: their owner may be waiting for this lock
+        if (!it->first->TrySpill())
+            continue;
+
+        Log::Debug(L"TemporaryMemoryBudget: spilled {} bytes of '{}'", it->second.ullUsage, it->second.strTag);
+        Remove(it, true);
+    }
+}
+
+ULONGLONG TemporaryMemoryBudget::GetUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_ullUsage;
+}
+
+ULONGLONG TemporaryMemoryBudget::GetPeakUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+    return m_ullPeakUsage;
+}
+
+std::map<std::wstring, TemporaryMemoryBudget::Statistics> TemporaryMemoryBudget::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    std::map<std::wstring, Statistics> statistics;
+    for (const auto& [tag, usage] : m_tags)
+        statistics.emplace(tag, usage.statistics);
+
+    return statistics;
+}
+
+std::optional<TemporaryMemoryBudget::Statistics> TemporaryMemoryBudget::GetStatistics(const std::wstring& tag) const
+{
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    auto it = m_tags.find(tag);
+    if (it == std::cend(m_tags))
+        return std::nullopt;
+
+    return it->second.statistics;
+}
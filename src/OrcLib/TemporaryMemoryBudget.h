@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class TemporaryStream;
+
+//
+// TemporaryMemoryBudget: process wide amount of memory the TemporaryStream instances can use before spilling to disk.
+//
+// Each stream still has its own memory threshold. When the budget would be exceeded, other streams are spilled to their
+// temporary file (largest or oldest first) and, if this is not enough, the requesting stream spills itself. Streams
+// busy in another thread are never waited for, they are just skipped. The memory used is charged to the
+// MemoryAccounting 'temporary_stream' tag, whose soft limit (if any) lowers the budget.
+//
+class TemporaryMemoryBudget
+{
+public:
+    static constexpr ULONGLONG kUnlimited = 0LL;
+
+    enum class SpillPolicy
+    {
+        LargestFirst,
+        OldestFirst
+    };
+
+    struct Statistics
+    {
+        ULONGLONG PeakUsage = 0LL;
+        ULONGLONG SpillCount = 0LL;
+    };
+
+    static TemporaryMemoryBudget& Instance();
+
+    ULONGLONG GetLimit() const;
+    void SetLimit(ULONGLONG ullLimit);
+
+    SpillPolicy GetSpillPolicy() const;
+    void SetSpillPolicy(SpillPolicy policy);
+
+    // 'stream' is about to use 'ullTotal' bytes of memory: account for the growth, spilling other streams if needed.
+    // Returns false when the budget cannot be honored: the caller is then expected to spill 'stream'.
+    bool Acquire(TemporaryStream& stream, ULONGLONG ullTotal);
+
+    // 'stream' does not hold any memory anymore: spilled to its file, closed or destroyed
+    void Release(TemporaryStream& stream, bool bSpilled = false);
+
+    ULONGLONG GetUsage() const;
+    ULONGLONG GetPeakUsage() const;
+
+    // Statistics by stream tag (the keyword of the command for redirected outputs)
+    std::map<std::wstring, Statistics> GetStatistics() const;
+    std::optional<Statistics> GetStatistics(const std::wstring& tag) const;
+
+private:
+    struct Entry
+    {
+        std::wstring strTag;
+        ULONGLONG ullUsage = 0LL;
+        ULONGLONG ullSequence = 0LL;
+    };
+
+    struct TagUsage
+    {
+        ULONGLONG ullUsage = 0LL;
+        Statistics statistics;
+    };
+
+    TemporaryMemoryBudget() = default;
+
+    void SpillUntil(const TemporaryStream& requester, ULONGLONG ullTarget);
+    void Remove(std::unordered_map<TemporaryStream*, Entry>::iterator it, bool bSpilled);
+
+    mutable std::mutex m_lock;
+
+    ULONGLONG m_ullLimit = kUnlimited;
+    SpillPolicy m_policy = SpillPolicy::LargestFirst;
+
+    ULONGLONG m_ullUsage = 0LL;
+    ULONGLONG m_ullPeakUsage = 0LL;
+    ULONGLONG m_ullSequence = 0LL;
+
+    std::unordered_map<TemporaryStream*, Entry> m_streams;
+    std::map<std::wstring, TagUsage> m_tags;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,268 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TemporaryPlacement.h"
+
+#include <winioctl.h>
+
+#include <algorithm>
+#include <optional>
+#include <set>
+
+#include "Utils/Guard.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+struct Candidate
+{
+    std::wstring Root;  // "D:\"
+    TemporaryPlacement::Kind Kind = TemporaryPlacement::Kind::OtherDisk;
+    bool bSeekPenalty = true;
+    ULONGLONG ullFreeSpace = 0LL;
+};
+
+// "C:\Windows\Temp" -> "C:\"
+std::optional<std::wstring> GetVolumeRoot(const std::wstring& path)
+{
+    WCHAR szVolume[ORC_MAX_PATH];
+    if (!GetVolumePathNameW(path.c_str(), szVolume, ORC_MAX_PATH))
+    {
+        Log::Debug(L"Failed GetVolumePathName for '{}' [{}]", path, LastWin32Error());
+        return std::nullopt;
+    }
+
+    return std::wstring(szVolume);
+}
+
+Guard::FileHandle OpenDevice(const std::wstring& device)
+{
+    // No access right is needed for the storage and volume queries
+    return Guard::FileHandle(CreateFileW(
+        device.c_str(), 0L, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL));
+}
+
+// Physical disks holding the volume mounted on 'root', empty when unknown (RAM disks have none)
+std::set<DWORD> GetVolumeDisks(const std::wstring& root)
+{
+    std::set<DWORD> disks;
+
+    // "C:\" -> "\\.\C:"
+    std::wstring device = L"\\\\.\\" + root;
+    if (!device.empty() && device.back() == L'\\')
+        device.pop_back();
+
+    auto hVolume = OpenDevice(device);
+    if (!hVolume.IsValid())
+    {
+        Log::Debug(L"Failed to open volume '{}' [{}]", device, LastWin32Error());
+        return disks;
+    }
+
+    // Spanned volumes have more than one extent
+    std::vector<BYTE> buffer(sizeof(VOLUME_DISK_EXTENTS) + 31 * sizeof(DISK_EXTENT));
+    DWORD dwBytes = 0L;
+    if (!DeviceIoControl(
+            *hVolume,
+            IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS,
+            NULL,
+            0L,
+            buffer.data(),
+            static_cast<DWORD>(buffer.size()),
+            &dwBytes,
+            NULL))
+    {
+        Log::Debug(L"Failed IOCTL_VOLUME_GET_VOLUME_DISK_EXTENTS for '{}' [{}]", device, LastWin32Error());
+        return disks;
+    }
+
+    const auto pExtents = reinterpret_cast<const VOLUME_DISK_EXTENTS*>(buffer.data());
+    for (DWORD i = 0; i < pExtents->NumberOfDiskExtents; ++i)
+        disks.insert(pExtents->Extents[i].DiskNumber);
+
+    return disks;
+}
+
+// Rotational disks incur a seek penalty, solid state ones do not. Unknown is treated as rotational.
+bool HasSeekPenalty(DWORD dwDisk)
+{
+    auto hDisk = OpenDevice(fmt::format(L"\\\\.\\PhysicalDrive{}", dwDisk));
+    if (!hDisk.IsValid())
+        return true;
+
+    STORAGE_PROPERTY_QUERY query = {};
+    query.PropertyId = StorageDeviceSeekPenaltyProperty;
+    query.QueryType = PropertyStandardQuery;
+
+    DEVICE_SEEK_PENALTY_DESCRIPTOR descriptor = {};
+    DWORD dwBytes = 0L;
+    if (!DeviceIoControl(
+            *hDisk,
+            IOCTL_STORAGE_QUERY_PROPERTY,
+            &query,
+            sizeof(query),
+            &descriptor,
+            sizeof(descriptor),
+            &dwBytes,
+            NULL)
+        || dwBytes < sizeof(descriptor))
+    {
+        return true;
+    }
+
+    return descriptor.IncursSeekPenalty != FALSE;
+}
+
+std::vector<std::wstring> GetLogicalDriveRoots()
+{
+    std::vector<std::wstring> roots;
+
+    WCHAR szDrives[4 * 26 + 1];
+    const auto dwLength = GetLogicalDriveStringsW(static_cast<DWORD>(std::size(szDrives)), szDrives);
+    if (dwLength == 0 || dwLength > std::size(szDrives))
+    {
+        Log::Debug(L"Failed GetLogicalDriveStrings [{}]", LastWin32Error());
+        return roots;
+    }
+
+    for (auto szDrive = szDrives; *szDrive != L'\0'; szDrive += wcslen(szDrive) + 1)
+        roots.emplace_back(szDrive);
+
+    return roots;
+}
+
+}  // namespace
+
+std::wstring_view Orc::ToString(TemporaryPlacement::Kind kind)
+{
+    switch (kind)
+    {
+        case TemporaryPlacement::Kind::Default:
+            return L"default";
+        case TemporaryPlacement::Kind::Memory:
+            return L"memory";
+        case TemporaryPlacement::Kind::OtherDisk:
+            return L"other disk";
+    }
+
+    return L"unknown";
+}
+
+bool TemporaryPlacement::IncursSeekPenalty(const std::wstring& path)
+{
+    const auto root = ::GetVolumeRoot(path);
+    if (!root)
+        return true;
+
+    const auto disks = ::GetVolumeDisks(*root);
+    return disks.empty() || std::any_of(std::cbegin(disks), std::cend(disks), &::HasSeekPenalty);
+}
+
+TemporaryPlacement TemporaryPlacement::Choose(
+    const std::vector<std::wstring>& targets,
+    const std::filesystem::path& defaultPath,
+    ULONGLONG ullMinFreeSpace)
+{
+    TemporaryPlacement placement;
+    placement.Path = defaultPath;
+
+    std::set<std::wstring> targetRoots;
+    std::set<DWORD> targetDisks;
+    for (const auto& target : targets)
+    {
+        const auto root = ::GetVolumeRoot(target);
+        if (!root || !targetRoots.insert(*root).second)
+            continue;
+
+        const auto disks = ::GetVolumeDisks(*root);
+        targetDisks.insert(std::cbegin(disks), std::cend(disks));
+    }
+
+    if (targetDisks.empty())
+    {
+        placement.Reason = L"the disks of the collected volumes are unknown";
+        return placement;
+    }
+
+    std::vector<Candidate> candidates;
+    for (const auto& root : ::GetLogicalDriveRoots())
+    {
+        if (targetRoots.find(root) != std::cend(targetRoots))
+            continue;
+
+        Candidate candidate;
+        candidate.Root = root;
+
+        const auto type = GetDriveTypeW(root.c_str());
+        if (type == DRIVE_RAMDISK)
+            candidate.Kind = Kind::Memory;
+        else if (type != DRIVE_FIXED)
+            continue;
+
+        DWORD dwFlags = 0L;
+        if (!GetVolumeInformationW(root.c_str(), NULL, 0L, NULL, NULL, &dwFlags, NULL, 0L)
+            || (dwFlags & FILE_READ_ONLY_VOLUME))
+            continue;
+
+        ULARGE_INTEGER freeSpace;
+        if (!GetDiskFreeSpaceExW(root.c_str(), &freeSpace, NULL, NULL) || freeSpace.QuadPart < ullMinFreeSpace)
+            continue;
+        candidate.ullFreeSpace = freeSpace.QuadPart;
+
+        if (candidate.Kind == Kind::OtherDisk)
+        {
+            const auto disks = ::GetVolumeDisks(root);
+
+            // A volume whose disks are unknown could share one with the targets
+            if (disks.empty())
+                continue;
+
+            if (std::any_of(std::cbegin(disks), std::cend(disks), [&targetDisks](DWORD dwDisk) {
+                    return targetDisks.find(dwDisk) != std::cend(targetDisks);
+                }))
+                continue;
+
+            candidate.bSeekPenalty = std::any_of(std::cbegin(disks), std::cend(disks), &::HasSeekPenalty);
+        }
+        else
+        {
+            candidate.bSeekPenalty = false;
+        }
+
+        candidates.push_back(std::move(candidate));
+    }
+
+    const auto best = std::min_element(
+        std::cbegin(candidates), std::cend(candidates), [](const Candidate& lhs, const Candidate& rhs) {
+            if (lhs.Kind != rhs.Kind)
+                return lhs.Kind == Kind::Memory;
+            if (lhs.bSeekPenalty != rhs.bSeekPenalty)
+                return !lhs.bSeekPenalty;
+            return lhs.ullFreeSpace > rhs.ullFreeSpace;
+        });
+
+    if (best == std::cend(candidates))
+    {
+        placement.Reason = L"no writable volume with enough free space on another disk";
+        return placement;
+    }
+
+    placement.Placement = best->Kind;
+    placement.Path = std::filesystem::path(best->Root) / kDirectoryName;
+    placement.Reason = fmt::format(
+        L"{} volume '{}' with {} free bytes",
+        best->Kind == Kind::Memory ? L"RAM disk" : (best->bSeekPenalty ? L"rotational" : L"solid state"),
+        best->Root,
+        best->ullFreeSpace);
+
+    return placement;
+}
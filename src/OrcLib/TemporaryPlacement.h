@@ -0,0 +1,60 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// TemporaryPlacement: where the temporary files of a run are written so that they do not compete with the raw reads
+// of the volumes being collected.
+//
+// Candidates are the writable RAM disks and fixed volumes with enough free space that are on none of the physical disks
+// of the collected volumes. A RAM disk comes first, then a volume on a disk without seek penalty (solid state), then
+// the one with the most free space. Without a candidate, the default directory is kept.
+//
+struct TemporaryPlacement
+{
+    enum class Kind
+    {
+        Default,
+        Memory,  // RAM disk
+        OtherDisk
+    };
+
+    Kind Placement = Kind::Default;
+    std::filesystem::path Path;
+
+    // Human readable explanation of the choice, for the log
+    std::wstring Reason;
+
+    static constexpr auto kDirectoryName = L"DFIR-OrcTempDir";
+
+    // 'targets' are paths on the volumes being collected, 'defaultPath' the configured temporary directory
+    static TemporaryPlacement Choose(
+        const std::vector<std::wstring>& targets,
+        const std::filesystem::path& defaultPath,
+        ULONGLONG ullMinFreeSpace);
+
+    // A disk of the volume holding 'path' incurs a seek penalty (rotational), or its disks are unknown
+    static bool IncursSeekPenalty(const std::wstring& path);
+};
+
+std::wstring_view ToString(TemporaryPlacement::Kind kind);
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -14,6 +14,7 @@
 #include "MemoryStream.h"
 #include "FileStream.h"
 #include "Temporary.h"
+#include "TemporaryMemoryBudget.h"
 
 using namespace std;
 using namespace Orc;
@@ -22,6 +23,8 @@ namespace fs = std::filesystem;
 
 STDMETHODIMP TemporaryStream::CanRead()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->CanRead();
     if (m_pFileStream)
@@ -31,6 +34,8 @@ STDMETHODIMP TemporaryStream::CanRead()
 
 STDMETHODIMP TemporaryStream::CanWrite()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->CanWrite();
     if (m_pFileStream)
@@ -40,6 +45,8 @@ STDMETHODIMP TemporaryStream::CanWrite()
 
 STDMETHODIMP TemporaryStream::CanSeek()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->CanSeek();
     if (m_pFileStream)
@@ -61,6 +68,8 @@ STDMETHODIMP TemporaryStream::Open(
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     m_bReleaseOnClose = bReleaseOnClose;
 
     if (strTempDir.empty())
@@ -84,6 +93,9 @@ STDMETHODIMP TemporaryStream::Open(
     std::replace(begin(m_strIdentifier), end(m_strIdentifier), L'\"', L'_');
     std::replace(begin(m_strIdentifier), end(m_strIdentifier), L':', L'_');
 
+    if (m_strBudgetTag.empty())
+        m_strBudgetTag = m_strIdentifier;
+
     // if dwMemThreshold > 0 we initialise a memory stream, otherwise we start a file stream
     if (dwMemThreshold > 0)
     {
@@ -118,6 +130,8 @@ STDMETHODIMP TemporaryStream::Read_(
     __in ULONGLONG cbBytes,
     __out_opt PULONGLONG pcbBytesRead)
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->Read(pBuffer, cbBytes, pcbBytesRead);
     if (m_pFileStream)
@@ -151,14 +165,14 @@ HRESULT TemporaryStream::MoveToFileStream(const std::shared_ptr<ByteStream>& aSt
     ULONGLONG ullCurPos = 0LL;
     if (aStream != nullptr)
     {
+        // Keep the current position: the stream may be spilled between two reads
+        if (FAILED(hr = aStream->SetFilePointer(0LL, FILE_CURRENT, &ullCurPos)))
+            return hr;
 
         ULONGLONG ullBytes = 0LL;
         if (FAILED(hr = aStream->CopyTo(m_pFileStream, &ullBytes)))
             return hr;
 
-        if (FAILED(hr = aStream->SetFilePointer(0LL, FILE_CURRENT, &ullCurPos)))
-            return hr;
-
         aStream->Close();
     }
 
@@ -170,6 +184,29 @@ HRESULT TemporaryStream::MoveToFileStream(const std::shared_ptr<ByteStream>& aSt
     return S_OK;
 }
 
+HRESULT TemporaryStream::SpillToFileStream()
+{
+    HRESULT hr = MoveToFileStream(m_pMemStream);
+    TemporaryMemoryBudget::Instance().Release(*this, SUCCEEDED(hr));
+    return hr;
+}
+
+bool TemporaryStream::TrySpill()
+{
+    std::unique_lock<std::mutex> lock(m_lock, std::try_to_lock);
+    if (!lock.owns_lock() || m_pMemStream == nullptr)
+        return false;
+
+    HRESULT hr = MoveToFileStream(m_pMemStream);
+    if (FAILED(hr))
+    {
+        Log::Debug("Failed to spill temporary stream to a file stream [{}]", SystemError(hr));
+        return false;
+    }
+
+    return true;
+}
+
 STDMETHODIMP TemporaryStream::Write_(
     __in_bcount(cbBytes) const PVOID pBuffer,
     __in ULONGLONG cbBytes,
@@ -177,6 +214,8 @@ STDMETHODIMP TemporaryStream::Write_(
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pFileStream)
         return m_pFileStream->Write(pBuffer, cbBytes, pcbBytesWritten);
 
@@ -185,9 +224,10 @@ STDMETHODIMP TemporaryStream::Write_(
 
     ULONGLONG ullMemStreamSize = m_pMemStream->GetSize();
 
-    if ((ullMemStreamSize + cbBytes) > m_dwMemThreshold)
+    if ((ullMemStreamSize + cbBytes) > m_dwMemThreshold
+        || !TemporaryMemoryBudget::Instance().Acquire(*this, ullMemStreamSize + cbBytes))
     {
-        if (FAILED(hr = MoveToFileStream(m_pMemStream)))
+        if (FAILED(hr = SpillToFileStream()))
             return hr;
 
         m_pMemStream = nullptr;
@@ -206,6 +246,8 @@ STDMETHODIMP TemporaryStream::Write_(
 STDMETHODIMP
 TemporaryStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer)
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->SetFilePointer(DistanceToMove, dwMoveMethod, pCurrPointer);
     if (m_pFileStream)
@@ -216,6 +258,8 @@ TemporaryStream::SetFilePointer(__in LONGLONG DistanceToMove, __in DWORD dwMoveM
 
 ULONG64 TemporaryStream::GetSize()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return m_pMemStream->GetSize();
     if (m_pFileStream)
@@ -227,6 +271,17 @@ STDMETHODIMP TemporaryStream::SetSize(ULONG64 ullSize)
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
+    if (m_pMemStream && ullSize > m_pMemStream->GetSize())
+    {
+        if (ullSize > m_dwMemThreshold || !TemporaryMemoryBudget::Instance().Acquire(*this, ullSize))
+        {
+            if (FAILED(hr = SpillToFileStream()))
+                return hr;
+        }
+    }
+
     if (m_pMemStream)
         if (FAILED(hr = m_pMemStream->SetSize(ullSize)))
             return hr;
@@ -242,6 +297,8 @@ STDMETHODIMP Orc::TemporaryStream::Clone(std::shared_ptr<ByteStream>& clone)
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     auto new_stream = std::make_shared<TemporaryStream>();
 
     if (m_pMemStream)
@@ -265,6 +322,7 @@ STDMETHODIMP Orc::TemporaryStream::Clone(std::shared_ptr<ByteStream>& clone)
     new_stream->m_strFileName = m_strFileName;
     new_stream->m_strIdentifier = m_strIdentifier;
     new_stream->m_strTemp = m_strTemp;
+    new_stream->m_strBudgetTag = m_strBudgetTag;
 
     clone = new_stream;
     return S_OK;
@@ -274,6 +332,8 @@ STDMETHODIMP TemporaryStream::Close()
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (!m_bReleaseOnClose)
         return S_OK;
 
@@ -282,6 +342,7 @@ STDMETHODIMP TemporaryStream::Close()
         if (FAILED(hr = m_pMemStream->Close()))
             return hr;
         m_pMemStream = nullptr;
+        TemporaryMemoryBudget::Instance().Release(*this);
     }
     if (m_pFileStream)
     {
@@ -296,6 +357,8 @@ STDMETHODIMP TemporaryStream::MoveTo(LPCWSTR lpszNewFileName)
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
     {
         FileStream fileStream;
@@ -312,6 +375,7 @@ STDMETHODIMP TemporaryStream::MoveTo(LPCWSTR lpszNewFileName)
         }
         m_pMemStream->Close();
         m_pMemStream = nullptr;
+        TemporaryMemoryBudget::Instance().Release(*this);
     }
     else if (m_pFileStream)
     {
@@ -333,6 +397,8 @@ STDMETHODIMP TemporaryStream::MoveTo(const std::shared_ptr<ByteStream> pStream)
 {
     HRESULT hr = E_FAIL;
 
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
     {
         ULONGLONG ullWritten = 0LL;
@@ -342,6 +408,7 @@ STDMETHODIMP TemporaryStream::MoveTo(const std::shared_ptr<ByteStream> pStream)
         }
         m_pMemStream->Close();
         m_pMemStream = nullptr;
+        TemporaryMemoryBudget::Instance().Release(*this);
     }
     if (m_pFileStream)
     {
@@ -368,6 +435,8 @@ STDMETHODIMP TemporaryStream::MoveTo(const std::shared_ptr<ByteStream> pStream)
 
 STDMETHODIMP TemporaryStream::IsMemoryStream()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pMemStream)
         return S_OK;
     return S_FALSE;
@@ -375,6 +444,8 @@ STDMETHODIMP TemporaryStream::IsMemoryStream()
 
 STDMETHODIMP TemporaryStream::IsFileStream()
 {
+    std::lock_guard<std::mutex> lock(m_lock);
+
     if (m_pFileStream)
         return S_OK;
     return S_FALSE;
@@ -384,6 +455,9 @@ TemporaryStream::~TemporaryStream(void)
 {
     HRESULT hr = E_FAIL;
 
+    // Must be done first so that the budget does not try to spill this stream anymore
+    TemporaryMemoryBudget::Instance().Release(*this);
+
     m_pMemStream = nullptr;
 
     if (m_pFileStream)
@@ -11,6 +11,7 @@
 
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
 
 #pragma managed(push, off)
@@ -34,7 +35,14 @@ private:
 
     bool m_bReleaseOnClose = true;
 
+    // Tag used to account memory usage in TemporaryMemoryBudget, default to the identifier
+    std::wstring m_strBudgetTag;
+
+    // Memory and file streams may be swapped by TemporaryMemoryBudget from another thread
+    mutable std::mutex m_lock;
+
     HRESULT MoveToFileStream(const std::shared_ptr<ByteStream>& aStream);
+    HRESULT SpillToFileStream();
 
 public:
     TemporaryStream()
@@ -88,6 +96,12 @@ public:
     const auto& GetFileStream() const { return m_pFileStream; }
     const auto& GetMemoryStream() const { return m_pMemStream; }
 
+    const std::wstring& GetBudgetTag() const { return m_strBudgetTag; }
+    void SetBudgetTag(const std::wstring& tag) { m_strBudgetTag = tag; }
+
+    // Move the content to the file stream unless the stream is in use, return true if memory was released
+    bool TrySpill();
+
     ~TemporaryStream(void);
 };
 
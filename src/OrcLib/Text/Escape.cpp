@@ -0,0 +1,226 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "Text/Escape.h"
+
+#include "SimdDispatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_ESCAPE_SIMD
+#endif
+
+using namespace Orc;
+
+namespace {
+
+using FindFn = size_t (*)(const WCHAR* p, size_t cch);
+
+struct Kernels
+{
+    FindFn FindJson;
+    FindFn FindXml;
+};
+
+inline bool NeedsJsonEscape(WCHAR c)
+{
+    return c < 0x20 || c == L'"' || c == L'\\';
+}
+
+inline bool NeedsXmlEscape(WCHAR c)
+{
+    return c < 0x20 || c == L'"' || c == L'&' || c == L'<' || c == L'>' || (c & 0xF800) == 0xD800 || c >= 0xFFFE;
+}
+
+size_t FindJsonScalar(const WCHAR* p, size_t cch)
+{
+    size_t i = 0;
+    while (i < cch && !NeedsJsonEscape(p[i]))
+        i++;
+
+    return i;
+}
+
+size_t FindXmlScalar(const WCHAR* p, size_t cch)
+{
+    size_t i = 0;
+    while (i < cch && !NeedsXmlEscape(p[i]))
+        i++;
+
+    return i;
+}
+
+#ifdef ORC_ESCAPE_SIMD
+
+template <bool bAVX2>
+constexpr size_t kBlockSize = bAVX2 ? 16 : 8;
+
+inline size_t FirstChar(uint32_t mask)
+{
+    // Two mask bits per character
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return index / 2;
+}
+
+// Comparisons are unsigned: '<= 0x1F' is a saturated substraction giving zero, '>= 0xFFFE' a saturated addition giving
+// 0xFFFF
+template <bool bAVX2>
+uint32_t JsonMask(const WCHAR* p)
+{
+    if constexpr (bAVX2)
+    {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto controls =
+            _mm256_cmpeq_epi16(_mm256_subs_epu16(chars, _mm256_set1_epi16(0x1F)), _mm256_setzero_si256());
+        const auto specials = _mm256_or_si256(
+            _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'"')), _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'\\')));
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(controls, specials)));
+    }
+    else
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto controls = _mm_cmpeq_epi16(_mm_subs_epu16(chars, _mm_set1_epi16(0x1F)), _mm_setzero_si128());
+        const auto specials =
+            _mm_or_si128(_mm_cmpeq_epi16(chars, _mm_set1_epi16(L'"')), _mm_cmpeq_epi16(chars, _mm_set1_epi16(L'\\')));
+
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(controls, specials)));
+    }
+}
+
+template <bool bAVX2>
+uint32_t XmlMask(const WCHAR* p)
+{
+    if constexpr (bAVX2)
+    {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const auto controls =
+            _mm256_cmpeq_epi16(_mm256_subs_epu16(chars, _mm256_set1_epi16(0x1F)), _mm256_setzero_si256());
+        const auto quotes = _mm256_or_si256(
+            _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'"')), _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'&')));
+        const auto brackets = _mm256_or_si256(
+            _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'<')), _mm256_cmpeq_epi16(chars, _mm256_set1_epi16(L'>')));
+        const auto markup = _mm256_or_si256(quotes, brackets);
+        const auto surrogates = _mm256_cmpeq_epi16(
+            _mm256_and_si256(chars, _mm256_set1_epi16(static_cast<short>(0xF800))),
+            _mm256_set1_epi16(static_cast<short>(0xD800)));
+        const auto nonChars =
+            _mm256_cmpeq_epi16(_mm256_adds_epu16(chars, _mm256_set1_epi16(1)), _mm256_set1_epi16(-1));
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_or_si256(controls, markup), _mm256_or_si256(surrogates, nonChars))));
+    }
+    else
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const auto controls = _mm_cmpeq_epi16(_mm_subs_epu16(chars, _mm_set1_epi16(0x1F)), _mm_setzero_si128());
+        const auto markup = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi16(chars, _mm_set1_epi16(L'"')), _mm_cmpeq_epi16(chars, _mm_set1_epi16(L'&'))),
+            _mm_or_si128(_mm_cmpeq_epi16(chars, _mm_set1_epi16(L'<')), _mm_cmpeq_epi16(chars, _mm_set1_epi16(L'>'))));
+        const auto surrogates = _mm_cmpeq_epi16(
+            _mm_and_si128(chars, _mm_set1_epi16(static_cast<short>(0xF800))),
+            _mm_set1_epi16(static_cast<short>(0xD800)));
+        const auto nonChars = _mm_cmpeq_epi16(_mm_adds_epu16(chars, _mm_set1_epi16(1)), _mm_set1_epi16(-1));
+
+        return static_cast<uint32_t>(
+            _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(controls, markup), _mm_or_si128(surrogates, nonChars))));
+    }
+}
+
+template <bool bAVX2>
+size_t FindJsonSimd(const WCHAR* p, size_t cch)
+{
+    size_t i = 0;
+    for (; i + kBlockSize<bAVX2> <= cch; i += kBlockSize<bAVX2>)
+    {
+        if (const auto mask = JsonMask<bAVX2>(p + i))
+            return i + FirstChar(mask);
+    }
+
+    return i + FindJsonScalar(p + i, cch - i);
+}
+
+template <bool bAVX2>
+size_t FindXmlSimd(const WCHAR* p, size_t cch)
+{
+    size_t i = 0;
+    for (; i + kBlockSize<bAVX2> <= cch; i += kBlockSize<bAVX2>)
+    {
+        if (const auto mask = XmlMask<bAVX2>(p + i))
+            return i + FirstChar(mask);
+    }
+
+    return i + FindXmlScalar(p + i, cch - i);
+}
+
+#endif  // ORC_ESCAPE_SIMD
+
+const Kernels& GetKernels()
+{
+    static const SimdDispatch::Kernel<Kernels> kernels(
+        L"escape",
+        {
+#ifdef ORC_ESCAPE_SIMD
+            {SimdDispatch::Level::AVX2, {FindJsonSimd<true>, FindXmlSimd<true>}},
+            {SimdDispatch::Level::SSE2, {FindJsonSimd<false>, FindXmlSimd<false>}},
+#endif
+            {SimdDispatch::Level::Scalar, {FindJsonScalar, FindXmlScalar}}});
+
+    return kernels.Get();
+}
+
+}  // namespace
+
+namespace Orc::Text {
+
+size_t FindJsonEscape(std::wstring_view text)
+{
+    return GetKernels().FindJson(text.data(), text.size());
+}
+
+size_t FindXmlEscape(std::wstring_view text)
+{
+    return GetKernels().FindXml(text.data(), text.size());
+}
+
+std::string_view JsonEscapeSequence(WCHAR c, char (&buffer)[6])
+{
+    using namespace std::string_view_literals;
+
+    switch (c)
+    {
+        case L'"':
+            return "\\\""sv;
+        case L'\\':
+            return "\\\\"sv;
+        case L'\b':
+            return "\\b"sv;
+        case L'\f':
+            return "\\f"sv;
+        case L'\n':
+            return "\\n"sv;
+        case L'\r':
+            return "\\r"sv;
+        case L'\t':
+            return "\\t"sv;
+    }
+
+    constexpr char kHexDigits[] = "0123456789ABCDEF";
+    buffer[0] = '\\';
+    buffer[1] = 'u';
+    buffer[2] = kHexDigits[(c >> 12) & 0xF];
+    buffer[3] = kHexDigits[(c >> 8) & 0xF];
+    buffer[4] = kHexDigits[(c >> 4) & 0xF];
+    buffer[5] = kHexDigits[c & 0xF];
+    return std::string_view(buffer, sizeof(buffer));
+}
+
+}  // namespace Orc::Text
@@ -0,0 +1,123 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <windows.h>
+
+#include <cstddef>
+#include <string_view>
+
+//
+// Escaping of UTF-16 text for the JSON and XML structured output writers.
+//
+// Values are nearly always plain text: the Find* kernels look for the first character needing attention 16 (AVX2) or
+// 8 (SSE2) characters at a time, and the Append* helpers copy the clean runs in bulk to the output and only escape what
+// the kernels stopped on.
+//
+// 'Output' is any type providing 'HRESULT AppendText(std::wstring_view)' (UTF-16 text, transcoded as needed) and
+// 'HRESULT AppendAscii(std::string_view)', like StructuredOutput::OutputBuffer.
+//
+namespace Orc::Text {
+
+// Index of the first character JSON strings cannot hold as is (control characters, '"' and '\\'), text.size() if none
+size_t FindJsonEscape(std::wstring_view text);
+
+// Index of the first character XML text or attribute values cannot hold as is: markup ('"', '&', '<', '>'), control
+// characters (tabulation, line feed and carriage return included), surrogates, U+FFFE and U+FFFF. text.size() if none
+size_t FindXmlEscape(std::wstring_view text);
+
+// Escape sequence of a character stopping FindJsonEscape, as rapidjson writes it
+std::string_view JsonEscapeSequence(WCHAR c, char (&buffer)[6]);
+
+template <typename Output>
+HRESULT AppendJsonEscaped(std::wstring_view text, Output& output)
+{
+    char buffer[6];
+
+    for (;;)
+    {
+        const auto clean = FindJsonEscape(text);
+        if (clean)
+        {
+            if (auto hr = output.AppendText(text.substr(0, clean)); FAILED(hr))
+                return hr;
+        }
+
+        if (clean == text.size())
+            return S_OK;
+
+        if (auto hr = output.AppendAscii(JsonEscapeSequence(text[clean], buffer)); FAILED(hr))
+            return hr;
+
+        text.remove_prefix(clean + 1);
+    }
+}
+
+// Appends 'text' with its markup characters as entities ('"', '\t', '\n' and '\r' too in attribute values). Characters
+// not allowed in XML are not checked here: callers validate text against the xml_*_table tables (see Unicode.h).
+template <typename Output>
+HRESULT AppendXmlEscaped(std::wstring_view text, bool bAttribute, Output& output)
+{
+    using namespace std::string_view_literals;
+
+    for (;;)
+    {
+        auto clean = FindXmlEscape(text);
+        std::string_view entity;
+
+        // Surrogates and other characters stopping the kernel but without entity are part of the clean run
+        while (clean < text.size())
+        {
+            switch (text[clean])
+            {
+                case L'&':
+                    entity = "&amp;"sv;
+                    break;
+                case L'<':
+                    entity = "&lt;"sv;
+                    break;
+                case L'>':
+                    entity = "&gt;"sv;
+                    break;
+                case L'"':
+                    entity = bAttribute ? "&quot;"sv : ""sv;
+                    break;
+                case L'\t':
+                    entity = bAttribute ? "&#x9;"sv : ""sv;
+                    break;
+                case L'\n':
+                    entity = bAttribute ? "&#xA;"sv : ""sv;
+                    break;
+                case L'\r':
+                    entity = bAttribute ? "&#xD;"sv : ""sv;
+                    break;
+            }
+
+            if (!entity.empty())
+                break;
+
+            clean += 1 + FindXmlEscape(text.substr(clean + 1));
+        }
+
+        if (clean)
+        {
+            if (auto hr = output.AppendText(text.substr(0, clean)); FAILED(hr))
+                return hr;
+        }
+
+        if (clean == text.size())
+            return S_OK;
+
+        if (auto hr = output.AppendAscii(entity); FAILED(hr))
+            return hr;
+
+        text.remove_prefix(clean + 1);
+    }
+}
+
+}  // namespace Orc::Text
@@ -0,0 +1,98 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Text/FastFormat.h"
+
+namespace {
+
+constexpr uint64_t kTicksPerMillisecond = 10000ULL;
+constexpr uint64_t kTicksPerDay = 24ULL * 3600ULL * 1000ULL * kTicksPerMillisecond;
+
+// Days between 1601-01-01 (FILETIME origin) and 0000-03-01 (origin of the civil calendar computation below)
+constexpr uint64_t kDaysFromCivilOrigin = 584694ULL;
+
+struct DatePrefix
+{
+    uint64_t ullDay = ~0ULL;
+    char szPrefix[Orc::Text::kMaxFileTimeLength] = {0};  // "YYYY-MM-DD "
+    size_t length = 0;
+};
+
+thread_local DatePrefix g_lastDate;
+
+// Proleptic gregorian date of a day count (see H. Hinnant's 'civil_from_days'), no need for FileTimeToSystemTime
+void FormatDatePrefix(uint64_t ullDay, DatePrefix& date)
+{
+    const uint64_t days = ullDay + kDaysFromCivilOrigin;
+    const uint64_t era = days / 146097;
+    const uint64_t dayOfEra = days - era * 146097;
+    const uint64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const uint64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const uint64_t shiftedMonth = (5 * dayOfYear + 2) / 153;
+
+    const unsigned day = static_cast<unsigned>(dayOfYear - (153 * shiftedMonth + 2) / 5 + 1);
+    const unsigned month = static_cast<unsigned>(shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9);
+    const uint64_t year = yearOfEra + era * 400 + (month <= 2);
+
+    char* out = date.szPrefix;
+    out = Orc::Text::FormatDecimal(year, 4, out);
+    *out++ = '-';
+    out = Orc::Text::FormatTwoDigits(month, out);
+    *out++ = '-';
+    out = Orc::Text::FormatTwoDigits(day, out);
+    *out++ = ' ';
+
+    date.length = out - date.szPrefix;
+    date.ullDay = ullDay;
+}
+
+}  // namespace
+
+namespace Orc::Text {
+
+template <typename CharT>
+CharT* FormatFileTime(const FILETIME& fileTime, CharT* out)
+{
+    const uint64_t ullTicks = (static_cast<uint64_t>(fileTime.dwHighDateTime) << 32) | fileTime.dwLowDateTime;
+    if (ullTicks > 0x7FFFFFFFFFFFFFFFULL)
+    {
+        return nullptr;
+    }
+
+    const uint64_t ullDay = ullTicks / kTicksPerDay;
+    auto& date = g_lastDate;
+    if (date.ullDay != ullDay)
+    {
+        FormatDatePrefix(ullDay, date);
+    }
+
+    for (size_t i = 0; i < date.length; ++i)
+    {
+        *out++ = static_cast<CharT>(date.szPrefix[i]);
+    }
+
+    const auto dwMilliseconds = static_cast<unsigned>((ullTicks % kTicksPerDay) / kTicksPerMillisecond);
+    const auto dwSeconds = dwMilliseconds / 1000;
+
+    out = FormatTwoDigits(dwSeconds / 3600, out);
+    *out++ = static_cast<CharT>(':');
+    out = FormatTwoDigits((dwSeconds / 60) % 60, out);
+    *out++ = static_cast<CharT>(':');
+    out = FormatTwoDigits(dwSeconds % 60, out);
+    *out++ = static_cast<CharT>('.');
+
+    const auto dwFraction = dwMilliseconds % 1000;
+    *out++ = static_cast<CharT>('0' + dwFraction / 100);
+    return FormatTwoDigits(dwFraction % 100, out);
+}
+
+template char* FormatFileTime<char>(const FILETIME& fileTime, char* out);
+template wchar_t* FormatFileTime<wchar_t>(const FILETIME& fileTime, wchar_t* out);
+
+}  // namespace Orc::Text
@@ -0,0 +1,246 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <windows.h>
+#include <intrin.h>
+
+#include <cstdint>
+#include <cstddef>
+
+//
+// Formatting kernels for the hottest table output cells (timestamps, hashes, integers, guids).
+//
+// Each kernel writes into a caller provided buffer (which must hold the documented maximum length), does not null
+// terminate it and returns the end of the written characters. Output matches what the previous printf/fmt based code
+// produced: uppercase hexadecimal, "YYYY-MM-DD hh:mm:ss.mmm" timestamps and "{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}"
+// guids (as StringFromGUID2 does).
+//
+namespace Orc::Text {
+
+constexpr size_t kMaxDecimalLength = 20;  // 18446744073709551615 (signed values fit too: -9223372036854775808)
+constexpr size_t kMaxHexIntegerLength = 16;
+constexpr size_t kFileTimeLength = 23;  // 2019-01-01 12:34:56.789
+constexpr size_t kMaxFileTimeLength = 24;  // years up to 30827
+constexpr size_t kGuidLength = 38;
+
+namespace Details {
+
+struct HexPairTable
+{
+    char table[256][2] = {};
+
+    constexpr HexPairTable()
+    {
+        constexpr char hex[] = "0123456789ABCDEF";
+        for (int i = 0; i < 256; ++i)
+        {
+            table[i][0] = hex[i >> 4];
+            table[i][1] = hex[i & 0x0F];
+        }
+    }
+};
+
+struct DecimalPairTable
+{
+    char table[100][2] = {};
+
+    constexpr DecimalPairTable()
+    {
+        for (int i = 0; i < 100; ++i)
+        {
+            table[i][0] = static_cast<char>('0' + i / 10);
+            table[i][1] = static_cast<char>('0' + i % 10);
+        }
+    }
+};
+
+inline constexpr HexPairTable kHexPairs;
+inline constexpr DecimalPairTable kDecimalPairs;
+
+inline constexpr uint64_t kPowersOfTen[] = {
+    1ULL,
+    10ULL,
+    100ULL,
+    1000ULL,
+    10000ULL,
+    100000ULL,
+    1000000ULL,
+    10000000ULL,
+    100000000ULL,
+    1000000000ULL,
+    10000000000ULL,
+    100000000000ULL,
+    1000000000000ULL,
+    10000000000000ULL,
+    100000000000000ULL,
+    1000000000000000ULL,
+    10000000000000000ULL,
+    100000000000000000ULL,
+    1000000000000000000ULL,
+    10000000000000000000ULL};
+
+inline int BitWidth(uint64_t value)
+{
+    unsigned long index = 0;
+#if defined(_M_X64) || defined(_M_ARM64)
+    return _BitScanReverse64(&index, value | 1) ? static_cast<int>(index) + 1 : 1;
+#else
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+        return static_cast<int>(index) + 33;
+    _BitScanReverse(&index, static_cast<unsigned long>(value) | 1);
+    return static_cast<int>(index) + 1;
+#endif
+}
+
+// Number of decimal digits without a loop: log10 is approximated from the bit width then corrected with one compare
+inline int DecimalDigitCount(uint64_t value)
+{
+    const int approx = (BitWidth(value) * 1233) >> 12;
+    return approx + ((value | 1) >= kPowersOfTen[approx]);
+}
+
+template <typename CharT>
+inline void WriteDecimalDigits(uint64_t value, CharT* end)
+{
+    while (value >= 100)
+    {
+        const auto pair = kDecimalPairs.table[value % 100];
+        value /= 100;
+        *--end = static_cast<CharT>(pair[1]);
+        *--end = static_cast<CharT>(pair[0]);
+    }
+
+    if (value >= 10)
+    {
+        const auto pair = kDecimalPairs.table[value];
+        *--end = static_cast<CharT>(pair[1]);
+        *--end = static_cast<CharT>(pair[0]);
+    }
+    else
+    {
+        *--end = static_cast<CharT>('0' + value);
+    }
+}
+
+}  // namespace Details
+
+// Two digits, zero padded ('value' must be lower than 100)
+template <typename CharT>
+inline CharT* FormatTwoDigits(unsigned value, CharT* out)
+{
+    const auto pair = Details::kDecimalPairs.table[value];
+    *out++ = static_cast<CharT>(pair[0]);
+    *out++ = static_cast<CharT>(pair[1]);
+    return out;
+}
+
+// Unsigned decimal (as "%I64u" or "{}"), integers of other types must be cast to pick the signed or unsigned overload
+template <typename CharT>
+inline CharT* FormatDecimal(uint64_t value, CharT* out)
+{
+    const auto digits = Details::DecimalDigitCount(value);
+    Details::WriteDecimalDigits(value, out + digits);
+    return out + digits;
+}
+
+// Signed decimal (as "%I64d" or "{}")
+template <typename CharT>
+inline CharT* FormatDecimal(int64_t value, CharT* out)
+{
+    // Unsigned negation keeps INT64_MIN well defined
+    const uint64_t magnitude = value < 0 ? 0ULL - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    *out = static_cast<CharT>('-');
+    out += value < 0;
+    return FormatDecimal(magnitude, out);
+}
+
+// Unsigned decimal zero padded to at least 'width' digits (as "%04u")
+template <typename CharT>
+inline CharT* FormatDecimal(uint64_t value, int width, CharT* out)
+{
+    const auto digits = Details::DecimalDigitCount(value);
+    for (int i = digits; i < width; ++i)
+    {
+        *out++ = static_cast<CharT>('0');
+    }
+    return FormatDecimal(value, out);
+}
+
+// Uppercase hexadecimal without leading zeros (as "%I64X" or "0x%I64X"), 'out' must hold kMaxHexIntegerLength + 2
+template <typename CharT>
+inline CharT* FormatHexInteger(uint64_t value, CharT* out, bool b0xPrefix = false)
+{
+    if (b0xPrefix)
+    {
+        *out++ = static_cast<CharT>('0');
+        *out++ = static_cast<CharT>('x');
+    }
+
+    const auto digits = (Details::BitWidth(value) + 3) >> 2;
+
+    CharT* end = out + digits;
+    CharT* cur = end;
+    for (int i = 0; i < digits; ++i)
+    {
+        *--cur = static_cast<CharT>("0123456789ABCDEF"[value & 0x0F]);
+        value >>= 4;
+    }
+    return end;
+}
+
+// Uppercase hexadecimal dump of 'bytes' (as "{:02X}" with a Buffer<BYTE>), 'out' must hold 2 * 'length' characters
+template <typename CharT>
+inline CharT* FormatHexBytes(const uint8_t* bytes, size_t length, CharT* out)
+{
+    for (size_t i = 0; i < length; ++i)
+    {
+        const auto pair = Details::kHexPairs.table[bytes[i]];
+        *out++ = static_cast<CharT>(pair[0]);
+        *out++ = static_cast<CharT>(pair[1]);
+    }
+    return out;
+}
+
+// As StringFromGUID2 without the terminating null: "{XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}"
+template <typename CharT>
+inline CharT* FormatGuid(const GUID& guid, CharT* out)
+{
+    const uint8_t data1[] = {
+        static_cast<uint8_t>(guid.Data1 >> 24),
+        static_cast<uint8_t>(guid.Data1 >> 16),
+        static_cast<uint8_t>(guid.Data1 >> 8),
+        static_cast<uint8_t>(guid.Data1)};
+    const uint8_t data2[] = {static_cast<uint8_t>(guid.Data2 >> 8), static_cast<uint8_t>(guid.Data2)};
+    const uint8_t data3[] = {static_cast<uint8_t>(guid.Data3 >> 8), static_cast<uint8_t>(guid.Data3)};
+
+    *out++ = static_cast<CharT>('{');
+    out = FormatHexBytes(data1, sizeof(data1), out);
+    *out++ = static_cast<CharT>('-');
+    out = FormatHexBytes(data2, sizeof(data2), out);
+    *out++ = static_cast<CharT>('-');
+    out = FormatHexBytes(data3, sizeof(data3), out);
+    *out++ = static_cast<CharT>('-');
+    out = FormatHexBytes(guid.Data4, 2, out);
+    *out++ = static_cast<CharT>('-');
+    out = FormatHexBytes(guid.Data4 + 2, sizeof(guid.Data4) - 2, out);
+    *out++ = static_cast<CharT>('}');
+    return out;
+}
+
+//
+// "YYYY-MM-DD hh:mm:ss.mmm" (UTC, milliseconds truncated like FileTimeToSystemTime), 'out' must hold
+// kMaxFileTimeLength characters. Returns nullptr when FileTimeToSystemTime would fail (above 0x7FFFFFFFFFFFFFFF).
+//
+// Consecutive timestamps of a table are very often on the same day: the date prefix of the last formatted day is
+// cached per thread and only the time of day is computed for them.
+//
+template <typename CharT>
+CharT* FormatFileTime(const FILETIME& fileTime, CharT* out);
+
+}  // namespace Orc::Text
@@ -7,6 +7,7 @@
 //
 
 #include "Text/Iconv.h"
+#include "Text/Utf16ToUtf8.h"
 
 #include <Windows.h>
 #include <assert.h>
@@ -17,48 +18,9 @@ namespace Orc {
 
 std::string ToUtf8(std::wstring_view utf16, std::error_code& ec)
 {
-    if (utf16.size() == 0)
-    {
-        return {};
-    }
-
-    //
-    // From MSDN:
-    //
-    // If this parameter is -1, the function processes the entire input string,
-    // including the terminating null character. Therefore, the resulting
-    // character string has a terminating null character, and the length
-    // returned by the function includes this character.
-    //
-    const auto requiredSize =
-        WideCharToMultiByte(CP_UTF8, 0, utf16.data(), static_cast<int>(utf16.size()), NULL, 0, NULL, NULL);
-
-    if (requiredSize == 0)
-    {
-        ec.assign(GetLastError(), std::system_category());
-        return {};
-    }
-
+    // Cannot fail: unpaired surrogates are replaced like WideCharToMultiByte does
     std::string utf8;
-    utf8.resize(requiredSize);
-
-    const auto converted = WideCharToMultiByte(
-        CP_UTF8,
-        0,
-        utf16.data(),
-        static_cast<int>(utf16.size()),
-        utf8.data(),
-        static_cast<int>(utf8.size()),
-        NULL,
-        NULL);
-
-    if (converted == 0)
-    {
-        ec.assign(GetLastError(), std::system_category());
-        return {};
-    }
-
-    assert(converted == requiredSize);
+    Text::AppendUtf16ToUtf8(utf16, utf8);
     return utf8;
 }
 
@@ -0,0 +1,284 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "Text/Utf16ToUtf8.h"
+
+#include "SimdDispatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_UTF8_SIMD
+#endif
+
+using namespace Orc;
+
+namespace {
+
+using ConvertFn = char* (*)(const WCHAR* p, const WCHAR* end, char* out);
+
+inline char* ConvertCodePoint(const WCHAR*& p, const WCHAR* end, char* out)
+{
+    uint32_t c = *p++;
+
+    if (c < 0x80)
+    {
+        *out++ = static_cast<char>(c);
+        return out;
+    }
+
+    if (c < 0x800)
+    {
+        out[0] = static_cast<char>(0xC0 | (c >> 6));
+        out[1] = static_cast<char>(0x80 | (c & 0x3F));
+        return out + 2;
+    }
+
+    if (c >= 0xD800 && c <= 0xDFFF)
+    {
+        if (c <= 0xDBFF && p < end && *p >= 0xDC00 && *p <= 0xDFFF)
+        {
+            c = 0x10000 + ((c - 0xD800) << 10) + (*p++ - 0xDC00);
+            out[0] = static_cast<char>(0xF0 | (c >> 18));
+            out[1] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            out[2] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            out[3] = static_cast<char>(0x80 | (c & 0x3F));
+            return out + 4;
+        }
+
+        // What WideCharToMultiByte does without WC_ERR_INVALID_CHARS
+        c = 0xFFFD;
+    }
+
+    out[0] = static_cast<char>(0xE0 | (c >> 12));
+    out[1] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (c & 0x3F));
+    return out + 3;
+}
+
+char* ConvertScalar(const WCHAR* p, const WCHAR* end, char* out)
+{
+    while (p < end)
+    {
+        out = ConvertCodePoint(p, end, out);
+    }
+
+    return out;
+}
+
+#ifdef ORC_UTF8_SIMD
+
+// For each combination of ASCII characters among 8 (bit i set when character i is ASCII), the pshufb control keeping
+// the lead byte of every character and the trail byte of non ASCII ones
+struct TwoBytesShuffleTable
+{
+    uint8_t shuffle[256][16] = {};
+    uint8_t length[256] = {};
+
+    constexpr TwoBytesShuffleTable()
+    {
+        for (int mask = 0; mask < 256; ++mask)
+        {
+            int length = 0;
+            for (int i = 0; i < 8; ++i)
+            {
+                shuffle[mask][length++] = static_cast<uint8_t>(2 * i);
+                if ((mask & (1 << i)) == 0)
+                {
+                    shuffle[mask][length++] = static_cast<uint8_t>(2 * i + 1);
+                }
+            }
+
+            this->length[mask] = static_cast<uint8_t>(length);
+            for (int i = length; i < 16; ++i)
+            {
+                shuffle[mask][i] = 0x80;
+            }
+        }
+    }
+};
+
+constexpr TwoBytesShuffleTable kTwoBytesShuffle;
+
+inline bool AllZero(__m128i value)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(value, _mm_setzero_si128())) == 0xFFFF;
+}
+
+// 8 characters below U+0800, writes 16 bytes of which 8 to 16 are used
+inline char* ConvertTwoBytes(__m128i chars, char* out)
+{
+    const auto isAscii = _mm_cmpeq_epi16(_mm_and_si128(chars, _mm_set1_epi16(static_cast<short>(0xFF80))), _mm_setzero_si128());
+
+    // 110xxxxx lead byte in the low byte, 10xxxxxx trail byte in the high one
+    const auto lead = _mm_or_si128(_mm_srli_epi16(chars, 6), _mm_set1_epi16(0x00C0));
+    const auto trail = _mm_or_si128(
+        _mm_slli_epi16(_mm_and_si128(chars, _mm_set1_epi16(0x003F)), 8), _mm_set1_epi16(static_cast<short>(0x8000)));
+
+    const auto bytes = _mm_or_si128(_mm_and_si128(isAscii, chars), _mm_andnot_si128(isAscii, _mm_or_si128(lead, trail)));
+    const auto mask = _mm_movemask_epi8(_mm_packs_epi16(isAscii, _mm_setzero_si128()));
+
+    const auto shuffle = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kTwoBytesShuffle.shuffle[mask]));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(bytes, shuffle));
+    return out + kTwoBytesShuffle.length[mask];
+}
+
+// Vector stores may write past the converted bytes but never past what Utf8MaxLength() reserved: at least 8
+// characters, so 24 bytes, remain whenever a block is converted
+template <bool bAVX2, bool bSSSE3>
+char* ConvertSimd(const WCHAR* p, const WCHAR* end, char* out)
+{
+    const auto asciiMask = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const auto twoBytesMask = _mm_set1_epi16(static_cast<short>(0xF800));
+
+    while (end - p >= 8)
+    {
+        if constexpr (bAVX2)
+        {
+            if (end - p >= 32)
+            {
+                const auto lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                const auto hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16));
+                if (_mm256_testz_si256(_mm256_or_si256(lo, hi), _mm256_set1_epi16(static_cast<short>(0xFF80))))
+                {
+                    // packus works per 128 bits lane, qwords have to be put back in order
+                    const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), packed);
+                    p += 32;
+                    out += 32;
+                    continue;
+                }
+            }
+        }
+
+        const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+
+        if (end - p >= 16)
+        {
+            const auto hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+            if (AllZero(_mm_and_si128(_mm_or_si128(lo, hi), asciiMask)))
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, hi));
+                p += 16;
+                out += 16;
+                continue;
+            }
+        }
+
+        if (AllZero(_mm_and_si128(lo, asciiMask)))
+        {
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(lo, lo));
+            p += 8;
+            out += 8;
+            continue;
+        }
+
+        if constexpr (bSSSE3)
+        {
+            if (AllZero(_mm_and_si128(lo, twoBytesMask)))
+            {
+                out = ConvertTwoBytes(lo, out);
+                p += 8;
+                continue;
+            }
+        }
+
+        // A surrogate pair straddling the block is converted as a whole
+        const auto blockEnd = p + 8;
+        while (p < blockEnd)
+        {
+            out = ConvertCodePoint(p, end, out);
+        }
+    }
+
+    return ConvertScalar(p, end, out);
+}
+
+#endif  // ORC_UTF8_SIMD
+
+ConvertFn Kernel()
+{
+    static const SimdDispatch::Kernel<ConvertFn> kernel(
+        L"utf16_to_utf8",
+        {
+#ifdef ORC_UTF8_SIMD
+            {SimdDispatch::Level::AVX2, ConvertSimd<true, true>},
+            {SimdDispatch::Level::SSSE3, ConvertSimd<false, true>},
+            {SimdDispatch::Level::SSE2, ConvertSimd<false, false>},
+#endif
+            {SimdDispatch::Level::Scalar, ConvertScalar}});
+
+    return kernel.Get();
+}
+
+}  // namespace
+
+namespace Orc::Text {
+
+bool IsAscii(std::wstring_view utf16)
+{
+    auto p = utf16.data();
+    const auto end = p + utf16.size();
+
+#ifdef ORC_UTF8_SIMD
+    auto accumulator = _mm_setzero_si128();
+    for (; end - p >= 8; p += 8)
+    {
+        accumulator = _mm_or_si128(accumulator, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+    }
+
+    if (!AllZero(_mm_and_si128(accumulator, _mm_set1_epi16(static_cast<short>(0xFF80)))))
+    {
+        return false;
+    }
+#endif
+
+    WCHAR bits = 0;
+    for (; p < end; ++p)
+    {
+        bits |= *p;
+    }
+
+    return (bits & 0xFF80) == 0;
+}
+
+size_t ConvertUtf16ToUtf8(std::wstring_view utf16, char* pUtf8)
+{
+    return Kernel()(utf16.data(), utf16.data() + utf16.size(), pUtf8) - pUtf8;
+}
+
+void AppendUtf16ToUtf8(std::wstring_view utf16, std::string& utf8)
+{
+    const auto offset = utf8.size();
+    utf8.resize(offset + Utf8MaxLength(utf16.size()));
+    utf8.resize(offset + ConvertUtf16ToUtf8(utf16, utf8.data() + offset));
+}
+
+size_t ConvertUtf16ToUtf8(
+    const WCHAR* pChars,
+    const uint32_t* pOffsets,
+    size_t count,
+    char* pUtf8,
+    size_t* pUtf8Offsets)
+{
+    const auto convert = Kernel();
+
+    auto out = pUtf8;
+    pUtf8Offsets[0] = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        out = convert(pChars + pOffsets[i], pChars + pOffsets[i + 1], out);
+        pUtf8Offsets[i + 1] = out - pUtf8;
+    }
+
+    return out - pUtf8;
+}
+
+}  // namespace Orc::Text
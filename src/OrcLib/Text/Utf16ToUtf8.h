@@ -0,0 +1,50 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <windows.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//
+// UTF-16 to UTF-8 transcoding for the table output paths.
+//
+// Runs of ASCII characters are converted 32 (AVX2) or 16 (SSE2) characters at a time, runs of characters below U+0800
+// (latin, greek, cyrillic, hebrew, arabic...) 8 at a time with SSSE3. Everything else goes through the scalar code.
+// Output is identical to WideCharToMultiByte(CP_UTF8, 0, ...): unpaired surrogates are replaced with U+FFFD.
+//
+// Destination buffers must hold Utf8MaxLength() bytes, the conversion cannot fail.
+//
+namespace Orc::Text {
+
+constexpr size_t Utf8MaxLength(size_t cchUtf16)
+{
+    return cchUtf16 * 3;
+}
+
+bool IsAscii(std::wstring_view utf16);
+
+// Returns the number of bytes written to 'pUtf8', which is not null terminated
+size_t ConvertUtf16ToUtf8(std::wstring_view utf16, char* pUtf8);
+
+void AppendUtf16ToUtf8(std::wstring_view utf16, std::string& utf8);
+
+// Converts the 'count' strings stored back to back in 'pChars' (string i is [pOffsets[i], pOffsets[i + 1]), as
+// TableOutput::BatchColumn lays them out). 'pUtf8' must hold Utf8MaxLength(pOffsets[count] - pOffsets[0]) bytes and
+// 'pUtf8Offsets' 'count + 1' entries, the same layout is used for the output. Returns the number of bytes written.
+size_t ConvertUtf16ToUtf8(
+    const WCHAR* pChars,
+    const uint32_t* pOffsets,
+    size_t count,
+    char* pUtf8,
+    size_t* pUtf8Offsets);
+
+}  // namespace Orc::Text
@@ -0,0 +1,249 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Trace.h"
+
+#include <algorithm>
+
+// {7f71eddb-8cba-5d78-8a7d-b1854faa3fa4}
+TRACELOGGING_DEFINE_PROVIDER(
+    g_hOrcTraceProvider,
+    "ANSSI.DFIR-ORC",
+    (0x7f71eddb, 0x8cba, 0x5d78, 0x8a, 0x7d, 0xb1, 0x85, 0x4f, 0xaa, 0x3f, 0xa4));
+
+using namespace Orc;
+
+namespace {
+
+// Events written before the registration or after the unregistration are dropped
+struct ProviderRegistration
+{
+    ProviderRegistration() { TraceLoggingRegister(g_hOrcTraceProvider); }
+    ~ProviderRegistration() { TraceLoggingUnregister(g_hOrcTraceProvider); }
+};
+
+ProviderRegistration g_registration;
+
+USHORT CountedLength(std::wstring_view value)
+{
+    return static_cast<USHORT>(std::min<size_t>(value.size(), USHRT_MAX));
+}
+
+}  // namespace
+
+Trace::Activity Trace::NewActivity()
+{
+    Activity activity;
+    activity.m_bEnabled = true;
+    EventActivityIdControl(EVENT_ACTIVITY_CTRL_CREATE_ID, &activity.m_id);
+    return activity;
+}
+
+Trace::Activity Trace::WriteVolumeReadStart(ULONGLONG ullOffset, ULONGLONG ullLength)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "VolumeRead",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Volume),
+        TraceLoggingUInt64(ullOffset, "Offset"),
+        TraceLoggingUInt64(ullLength, "Length"));
+    return activity;
+}
+
+void Trace::WriteVolumeReadStop(const Activity& activity, ULONGLONG ullBytesRead)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "VolumeRead",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Volume),
+        TraceLoggingUInt64(ullBytesRead, "BytesRead"));
+}
+
+Trace::Activity Trace::WriteMFTChunkStart(ULONGLONG ullFirstFRN, ULONGLONG ullRecords)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "MFTChunk",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(MFT),
+        TraceLoggingUInt64(ullFirstFRN, "FirstFRN"),
+        TraceLoggingUInt64(ullRecords, "Records"));
+    return activity;
+}
+
+void Trace::WriteMFTChunkStop(const Activity& activity)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "MFTChunk",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(MFT));
+}
+
+Trace::Activity Trace::WriteFileFindTermStart(ULONGLONG ullFRN, std::wstring_view description)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "FileFindTerm",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(FileFind),
+        TraceLoggingUInt64(ullFRN, "FRN"),
+        TraceLoggingCountedWideString(description.data(), CountedLength(description), "Term"));
+    return activity;
+}
+
+void Trace::WriteFileFindTermStop(const Activity& activity)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "FileFindTerm",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(FileFind));
+}
+
+Trace::Activity Trace::WriteFileScanStart(const char* szKind, ULONGLONG ullBytes)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "FileScan",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Scan),
+        TraceLoggingString(szKind, "Kind"),
+        TraceLoggingUInt64(ullBytes, "Bytes"));
+    return activity;
+}
+
+void Trace::WriteFileScanStop(const Activity& activity, HRESULT hr)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "FileScan",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Scan),
+        TraceLoggingHResult(hr, "Result"));
+}
+
+Trace::Activity Trace::WriteTableFlushStart(const char* szFormat, ULONGLONG ullRows, ULONGLONG ullBytes)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "TableFlush",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Table),
+        TraceLoggingString(szFormat, "Format"),
+        TraceLoggingUInt64(ullRows, "Rows"),
+        TraceLoggingUInt64(ullBytes, "Bytes"));
+    return activity;
+}
+
+void Trace::WriteTableFlushStop(const Activity& activity, HRESULT hr)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "TableFlush",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Table),
+        TraceLoggingHResult(hr, "Result"));
+}
+
+Trace::Activity Trace::WriteArchiveItemStart(std::wstring_view name, ULONGLONG ullSize)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "ArchiveItem",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Archive),
+        TraceLoggingCountedWideString(name.data(), CountedLength(name), "Name"),
+        TraceLoggingUInt64(ullSize, "Size"));
+    return activity;
+}
+
+void Trace::WriteArchiveItemStop(const Activity& activity, HRESULT hr)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "ArchiveItem",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Archive),
+        TraceLoggingHResult(hr, "Result"));
+}
+
+Trace::Activity Trace::WriteUploadPartStart(std::wstring_view name, ULONGLONG ullPart, ULONGLONG ullBytes)
+{
+    auto activity = NewActivity();
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "UploadPart",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_START),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Upload),
+        TraceLoggingCountedWideString(name.data(), CountedLength(name), "Name"),
+        TraceLoggingUInt64(ullPart, "Part"),
+        TraceLoggingUInt64(ullBytes, "Bytes"));
+    return activity;
+}
+
+void Trace::WriteUploadPartStop(const Activity& activity, HRESULT hr)
+{
+    TraceLoggingWriteActivity(
+        g_hOrcTraceProvider,
+        "UploadPart",
+        activity.Id(),
+        nullptr,
+        TraceLoggingOpcode(WINEVENT_OPCODE_STOP),
+        TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),
+        TraceLoggingKeyword(Upload),
+        TraceLoggingHResult(hr, "Result"));
+}
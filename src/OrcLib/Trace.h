@@ -0,0 +1,166 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <string_view>
+
+#include <winmeta.h>
+#include <TraceLoggingProvider.h>
+
+#pragma managed(push, off)
+
+TRACELOGGING_DECLARE_PROVIDER(g_hOrcTraceProvider);
+
+namespace Orc {
+
+//
+// Trace: ETW events of the hot spans, written with TraceLogging by the 'ANSSI.DFIR-ORC' provider
+// ({7f71eddb-8cba-5d78-8a7d-b1854faa3fa4}, derived from the name so that 'tracelog -guid *ANSSI.DFIR-ORC' finds it).
+//
+// A span is a Start and a Stop event with the same activity id: WPA shows them as regions with their duration. When
+// no session enabled the provider (or the keyword of a span), a span only costs the test of the provider state and
+// its payload is not evaluated.
+//
+class Trace
+{
+public:
+    enum Keyword : ULONGLONG
+    {
+        Volume = 0x1,
+        MFT = 0x2,
+        FileFind = 0x4,
+        Scan = 0x8,
+        Table = 0x10,
+        Archive = 0x20,
+        Upload = 0x40,
+    };
+
+    // Activity id of a span, empty when its keyword was not enabled as it started
+    class Activity
+    {
+    public:
+        explicit operator bool() const { return m_bEnabled; }
+        const GUID* Id() const { return &m_id; }
+
+    private:
+        friend class Trace;
+
+        bool m_bEnabled = false;
+        GUID m_id = {0};
+    };
+
+    static bool IsEnabled(Keyword keyword)
+    {
+        return TraceLoggingProviderEnabled(g_hOrcTraceProvider, WINEVENT_LEVEL_VERBOSE, keyword);
+    }
+
+    static Activity VolumeReadStart(ULONGLONG ullOffset, ULONGLONG ullLength)
+    {
+        return IsEnabled(Volume) ? WriteVolumeReadStart(ullOffset, ullLength) : Activity();
+    }
+    static void VolumeReadStop(const Activity& activity, ULONGLONG ullBytesRead)
+    {
+        if (activity)
+            WriteVolumeReadStop(activity, ullBytesRead);
+    }
+
+    // A chunk of consecutive records read from the $MFT and handed to the walker
+    static Activity MFTChunkStart(ULONGLONG ullFirstFRN, ULONGLONG ullRecords)
+    {
+        return IsEnabled(MFT) ? WriteMFTChunkStart(ullFirstFRN, ullRecords) : Activity();
+    }
+    static void MFTChunkStop(const Activity& activity)
+    {
+        if (activity)
+            WriteMFTChunkStop(activity);
+    }
+
+    // The evaluation of one search term against a record, the description is built by the caller only when enabled
+    static Activity FileFindTermStart(ULONGLONG ullFRN, std::wstring_view description)
+    {
+        return IsEnabled(FileFind) ? WriteFileFindTermStart(ullFRN, description) : Activity();
+    }
+    static void FileFindTermStop(const Activity& activity)
+    {
+        if (activity)
+            WriteFileFindTermStop(activity);
+    }
+
+    // Hashing ('Hash') or scanning ('Yara') the data of a file
+    static Activity FileScanStart(const char* szKind, ULONGLONG ullBytes)
+    {
+        return IsEnabled(Scan) ? WriteFileScanStart(szKind, ullBytes) : Activity();
+    }
+    static void FileScanStop(const Activity& activity, HRESULT hr)
+    {
+        if (activity)
+            WriteFileScanStop(activity, hr);
+    }
+
+    // Rows ('CSV', 'Parquet', 'ORC') written out by a table writer, 0 when only the bytes are known
+    static Activity TableFlushStart(const char* szFormat, ULONGLONG ullRows, ULONGLONG ullBytes)
+    {
+        return IsEnabled(Table) ? WriteTableFlushStart(szFormat, ullRows, ullBytes) : Activity();
+    }
+    static void TableFlushStop(const Activity& activity, HRESULT hr)
+    {
+        if (activity)
+            WriteTableFlushStop(activity, hr);
+    }
+
+    // From the compressor asking for the item data to the item result
+    static Activity ArchiveItemStart(std::wstring_view name, ULONGLONG ullSize)
+    {
+        return IsEnabled(Archive) ? WriteArchiveItemStart(name, ullSize) : Activity();
+    }
+    static void ArchiveItemStop(const Activity& activity, HRESULT hr)
+    {
+        if (activity)
+            WriteArchiveItemStop(activity, hr);
+    }
+
+    static Activity UploadPartStart(std::wstring_view name, ULONGLONG ullPart, ULONGLONG ullBytes)
+    {
+        return IsEnabled(Upload) ? WriteUploadPartStart(name, ullPart, ullBytes) : Activity();
+    }
+    static void UploadPartStop(const Activity& activity, HRESULT hr)
+    {
+        if (activity)
+            WriteUploadPartStop(activity, hr);
+    }
+
+private:
+    static Activity NewActivity();
+
+    static Activity WriteVolumeReadStart(ULONGLONG ullOffset, ULONGLONG ullLength);
+    static void WriteVolumeReadStop(const Activity& activity, ULONGLONG ullBytesRead);
+
+    static Activity WriteMFTChunkStart(ULONGLONG ullFirstFRN, ULONGLONG ullRecords);
+    static void WriteMFTChunkStop(const Activity& activity);
+
+    static Activity WriteFileFindTermStart(ULONGLONG ullFRN, std::wstring_view description);
+    static void WriteFileFindTermStop(const Activity& activity);
+
+    static Activity WriteFileScanStart(const char* szKind, ULONGLONG ullBytes);
+    static void WriteFileScanStop(const Activity& activity, HRESULT hr);
+
+    static Activity WriteTableFlushStart(const char* szFormat, ULONGLONG ullRows, ULONGLONG ullBytes);
+    static void WriteTableFlushStop(const Activity& activity, HRESULT hr);
+
+    static Activity WriteArchiveItemStart(std::wstring_view name, ULONGLONG ullSize);
+    static void WriteArchiveItemStop(const Activity& activity, HRESULT hr);
+
+    static Activity WriteUploadPartStart(std::wstring_view name, ULONGLONG ullPart, ULONGLONG ullBytes);
+    static void WriteUploadPartStop(const Activity& activity, HRESULT hr);
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,268 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "USNJournalCursor.h"
+
+#include "FileStream.h"
+#include "Text/Fmt/std_filesystem.h"
+
+#include <vector>
+
+using namespace Orc;
+
+namespace {
+
+constexpr DWORD kCursorMagic = 0x4E53554F;  // 'OUSN'
+constexpr DWORD kCursorVersion = 1L;
+
+class CursorWriter
+{
+public:
+    template <typename T>
+    void Write(const T& value)
+    {
+        const auto pValue = reinterpret_cast<const BYTE*>(&value);
+        m_data.insert(std::end(m_data), pValue, pValue + sizeof(T));
+    }
+
+    void Write(const std::wstring& str)
+    {
+        Write(static_cast<WORD>(str.size()));
+        const auto pStr = reinterpret_cast<const BYTE*>(str.data());
+        m_data.insert(std::end(m_data), pStr, pStr + str.size() * sizeof(WCHAR));
+    }
+
+    std::vector<BYTE>& Data() { return m_data; }
+
+private:
+    std::vector<BYTE> m_data;
+};
+
+class CursorReader
+{
+public:
+    CursorReader(const std::vector<BYTE>& data)
+        : m_data(data)
+    {
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        if (m_data.size() - m_offset < sizeof(T))
+            return false;
+
+        memcpy(&value, m_data.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool Read(std::wstring& str)
+    {
+        WORD wLength = 0;
+        if (!Read(wLength) || m_data.size() - m_offset < wLength * sizeof(WCHAR))
+            return false;
+
+        str.assign(reinterpret_cast<const WCHAR*>(m_data.data() + m_offset), wLength);
+        m_offset += wLength * sizeof(WCHAR);
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_data.size(); }
+
+private:
+    const std::vector<BYTE>& m_data;
+    size_t m_offset = 0;
+};
+
+}  // namespace
+
+bool USNJournalCursor::Volume::IsValidFor(const USN_JOURNAL_DATA& journal) const
+{
+    return JournalID == journal.UsnJournalID && NextUsn >= journal.LowestValidUsn && NextUsn <= journal.NextUsn;
+}
+
+void USNJournalCursor::Volume::SetDirectories(const std::map<DWORDLONG, USN_RECORD*>& usnMap)
+{
+    Directories.clear();
+    Directories.reserve(usnMap.size());
+
+    for (const auto& [frn, pRecord] : usnMap)
+    {
+        if (!(pRecord->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            continue;
+
+        Directories.emplace(
+            frn,
+            Directory {
+                pRecord->ParentFileReferenceNumber,
+                std::wstring(pRecord->FileName, pRecord->FileNameLength / sizeof(WCHAR))});
+    }
+}
+
+HRESULT USNJournalCursor::Load(const std::filesystem::path& path)
+{
+    HRESULT hr = E_FAIL;
+
+    m_volumes.clear();
+
+    FileStream stream;
+    if (FAILED(hr = stream.ReadFrom(path.c_str())))
+    {
+        if (hr == HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND) || hr == HRESULT_FROM_WIN32(ERROR_PATH_NOT_FOUND))
+        {
+            Log::Debug(L"No USN journal cursor in '{}'", path);
+            return S_FALSE;
+        }
+
+        Log::Error(L"Failed to open USN journal cursor '{}' [{}]", path, SystemError(hr));
+        return hr;
+    }
+
+    std::vector<BYTE> data;
+    try
+    {
+        data.resize(static_cast<size_t>(stream.GetSize()));
+    }
+    catch (const std::bad_alloc&)
+    {
+        Log::Error(L"Failed to allocate {} bytes to read USN journal cursor '{}'", stream.GetSize(), path);
+        return E_OUTOFMEMORY;
+    }
+
+    ULONGLONG ullRead = 0LL;
+    if (FAILED(hr = stream.Read(data.data(), data.size(), &ullRead)) || ullRead != data.size())
+    {
+        Log::Error(L"Failed to read USN journal cursor '{}' [{}]", path, SystemError(hr));
+        return FAILED(hr) ? hr : HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+    }
+
+    CursorReader reader(data);
+
+    DWORD dwMagic = 0L, dwVersion = 0L, dwVolumes = 0L;
+    if (!reader.Read(dwMagic) || dwMagic != kCursorMagic || !reader.Read(dwVersion) || dwVersion != kCursorVersion
+        || !reader.Read(dwVolumes))
+    {
+        Log::Error(L"Invalid USN journal cursor '{}' (unknown format)", path);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    std::map<ULONGLONG, Volume> volumes;
+    for (DWORD i = 0; i < dwVolumes; i++)
+    {
+        ULONGLONG ullSerial = 0LL;
+        Volume volume;
+        DWORD dwDirectories = 0L;
+
+        if (!reader.Read(ullSerial) || !reader.Read(volume.JournalID) || !reader.Read(volume.NextUsn)
+            || !reader.Read(dwDirectories))
+        {
+            Log::Error(L"Invalid USN journal cursor '{}' (truncated volume header)", path);
+            return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+        }
+
+        for (DWORD j = 0; j < dwDirectories; j++)
+        {
+            DWORDLONG frn = 0LL;
+            Directory directory;
+
+            if (!reader.Read(frn) || !reader.Read(directory.ParentFRN) || !reader.Read(directory.Name))
+            {
+                Log::Error(L"Invalid USN journal cursor '{}' (truncated directory)", path);
+                return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+            }
+
+            volume.Directories.emplace(frn, std::move(directory));
+        }
+
+        volumes.emplace(ullSerial, std::move(volume));
+    }
+
+    if (!reader.AtEnd())
+    {
+        Log::Error(L"Invalid USN journal cursor '{}' (trailing data)", path);
+        return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+    }
+
+    m_volumes = std::move(volumes);
+    return S_OK;
+}
+
+HRESULT USNJournalCursor::Save(const std::filesystem::path& path) const
+{
+    HRESULT hr = E_FAIL;
+
+    CursorWriter writer;
+    writer.Write(kCursorMagic);
+    writer.Write(kCursorVersion);
+    writer.Write(static_cast<DWORD>(m_volumes.size()));
+
+    for (const auto& [ullSerial, volume] : m_volumes)
+    {
+        writer.Write(ullSerial);
+        writer.Write(volume.JournalID);
+        writer.Write(volume.NextUsn);
+        writer.Write(static_cast<DWORD>(volume.Directories.size()));
+
+        for (const auto& [frn, directory] : volume.Directories)
+        {
+            writer.Write(frn);
+            writer.Write(directory.ParentFRN);
+            writer.Write(directory.Name);
+        }
+    }
+
+    // Written aside then moved over the previous cursor: an interrupted run leaves the previous cursor usable
+    auto tempPath = path;
+    tempPath += L".tmp";
+
+    {
+        FileStream stream;
+        if (FAILED(hr = stream.WriteTo(tempPath.c_str())))
+        {
+            Log::Error(L"Failed to create USN journal cursor '{}' [{}]", tempPath, SystemError(hr));
+            return hr;
+        }
+
+        ULONGLONG ullWritten = 0LL;
+        auto& data = writer.Data();
+        if (FAILED(hr = stream.Write(data.data(), data.size(), &ullWritten)))
+        {
+            Log::Error(L"Failed to write USN journal cursor '{}' [{}]", tempPath, SystemError(hr));
+            stream.Close();
+            DeleteFile(tempPath.c_str());
+            return hr;
+        }
+        stream.Close();
+    }
+
+    if (!MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to replace USN journal cursor '{}' [{}]", path, SystemError(hr));
+        DeleteFile(tempPath.c_str());
+        return hr;
+    }
+
+    return S_OK;
+}
+
+const USNJournalCursor::Volume* USNJournalCursor::Find(ULONGLONG ullVolumeSerial) const
+{
+    auto it = m_volumes.find(ullVolumeSerial);
+    if (it == std::end(m_volumes))
+        return nullptr;
+
+    return &it->second;
+}
+
+void USNJournalCursor::Set(ULONGLONG ullVolumeSerial, Volume&& volume)
+{
+    m_volumes.insert_or_assign(ullVolumeSerial, std::move(volume));
+}
@@ -0,0 +1,67 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <winioctl.h>
+
+#include <filesystem>
+#include <map>
+#include <string>
+#include <unordered_map>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// USNJournalCursor: where a previous collection stopped reading the USN journal of each volume.
+//
+// For each volume (by serial number) it keeps the journal identifier, the USN of the next record to read and a snapshot
+// of the directories (FRN to parent FRN and name) needed to resolve the full names of the new records without walking
+// the MFT again.
+//
+class USNJournalCursor
+{
+public:
+    struct Directory
+    {
+        DWORDLONG ParentFRN = 0LL;
+        std::wstring Name;
+    };
+
+    struct Volume
+    {
+        DWORDLONG JournalID = 0LL;
+        USN NextUsn = 0LL;
+        std::unordered_map<DWORDLONG, Directory> Directories;
+
+        // The journal can be read from NextUsn: same journal instance and the records were not purged since
+        bool IsValidFor(const USN_JOURNAL_DATA& journal) const;
+
+        // Directories of a walker's USN map (USNJournalWalkerBase::GetUSNMap, once the records were walked)
+        void SetDirectories(const std::map<DWORDLONG, USN_RECORD*>& usnMap);
+    };
+
+    // A missing file is not an error: the cursor is then empty (S_FALSE)
+    HRESULT Load(const std::filesystem::path& path);
+    HRESULT Save(const std::filesystem::path& path) const;
+
+    const Volume* Find(ULONGLONG ullVolumeSerial) const;
+    void Set(ULONGLONG ullVolumeSerial, Volume&& volume);
+
+    const std::map<ULONGLONG, Volume>& Volumes() const { return m_volumes; }
+
+private:
+    std::map<ULONGLONG, Volume> m_volumes;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -11,13 +11,16 @@
 #include <Winternl.h>
 #include <WinIoCtl.h>
 
+#include <algorithm>
 #include <map>
+#include <thread>
 #include <vector>
 
 #include "USNJournalWalkerBase.h"
 #include "USNJournalWalker.h"
 
 #include "MountedVolumeReader.h"
+#include "BlockingQueue.h"
 
 #include <boost/scope_exit.hpp>
 
@@ -41,6 +44,51 @@ struct READ_USN_DATA_OUTPUT_DATA
 // Buffer size for DeviceIOControl
 constexpr auto USN_BUFFER_SIZE = (0x10000);
 
+// Largest buffer given to a single device call by the pipelined walk
+constexpr auto USN_PIPELINE_MAX_BUFFER_SIZE = (0x4000000);
+
+// Resolved records handed to the output thread at once, and number of such batches
+constexpr auto USN_PIPELINE_RECORDS_PER_BATCH = (4096);
+constexpr auto USN_PIPELINE_BATCHES = (4);
+
+namespace {
+
+struct JournalBuffer
+{
+    std::vector<BYTE> Data;
+    DWORD dwBytes = 0L;
+};
+
+// Copies of the resolved records and of their full names, waiting for the output thread
+struct RecordBatch
+{
+    std::vector<BYTE> Records;
+    std::vector<WCHAR> Names;
+    std::vector<std::pair<size_t, size_t>> Entries;
+
+    void Add(const WCHAR* szFullName, const USN_RECORD* pElt)
+    {
+        // Records keep the 8 bytes alignment they have in the journal
+        const size_t recordOffset = Records.size();
+        Records.resize(recordOffset + ((pElt->RecordLength + 7) & ~7));
+        memcpy(Records.data() + recordOffset, pElt, pElt->RecordLength);
+
+        const size_t nameOffset = Names.size();
+        Names.insert(std::end(Names), szFullName, szFullName + wcslen(szFullName) + 1);
+
+        Entries.emplace_back(recordOffset, nameOffset);
+    }
+
+    void Clear()
+    {
+        Records.clear();
+        Names.clear();
+        Entries.clear();
+    }
+};
+
+}  // namespace
+
 USNJournalWalker::USNJournalWalker(void)
 {
     m_dwVolumeSerialNumber = 0;
@@ -173,13 +221,13 @@ HRESULT USNJournalWalker::Initialize(const std::shared_ptr<Location>& loc)
     return S_OK;
 }
 
-HRESULT USNJournalWalker::WalkRecords(const Callbacks& pCallbacks, bool bWalkDirs)
+HRESULT USNJournalWalker::WalkRecords(const RecordSink& sink, bool bWalkDirs)
 {
-    if (pCallbacks.RecordCallback != NULL)
+    if (sink)
     {
         // Walk through the files
         auto iter = m_USNMap.begin();
-        do
+        while (iter != m_USNMap.end())
         {
             USN_RECORD* pValue = iter->second;
 
@@ -194,7 +242,7 @@ HRESULT USNJournalWalker::WalkRecords(const Callbacks& pCallbacks, bool bWalkDir
 
             if (pFullName && bInSpecificLocation)
             {
-                pCallbacks.RecordCallback(m_VolReader, pFullName, pValue);
+                sink(pFullName, pValue);
                 m_dwWalkedItems++;
             }
 
@@ -207,91 +255,359 @@ HRESULT USNJournalWalker::WalkRecords(const Callbacks& pCallbacks, bool bWalkDir
             {
                 ++iter;
             }
-        } while (iter != m_USNMap.end());
+        }
     }
     return S_OK;
 }
 
-HRESULT USNJournalWalker::EnumJournal(const IUSNJournalWalker::Callbacks& pCallbacks)
+HRESULT USNJournalWalker::EnumRecords(BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink)
 {
-    MFT_ENUM_DATA InBuffer = {0, 0, MAXLONGLONG};
-    DWORD numBytesReturned = 0;
+    auto pOutBuffer = reinterpret_cast<ENUM_USN_DATA_OUTPUT_DATA*>(pBuffer);
+    USN_RECORD* nextUSNRecord = pOutBuffer->usnRecord;
+
+    // parse all of the entries we just got
+    while ((__int64)nextUSNRecord < (__int64)((PUCHAR)pOutBuffer + dwBytes))
+    {
+        LPBYTE pElt = (LPBYTE)m_RecordStore.GetNewCell();
+
+        if (pElt == NULL)
+        {
+            // We walk through FILES for our alerady recorded nodes with hope this will free some space
+            WalkRecords(sink, false);
+            pElt = (LPBYTE)m_RecordStore.GetNewCell();
+            if (pElt == NULL)
+            {
+                /// We are still unable to move forward...
+                return E_OUTOFMEMORY;
+            }
+        }
+
+        memset(pElt, 0, m_dwRecordMaxSize);
+        memcpy_s(pElt, m_dwRecordMaxSize, nextUSNRecord, nextUSNRecord->RecordLength);
+
+        _ASSERT(m_USNMap.find(nextUSNRecord->FileReferenceNumber) == m_USNMap.end());
+        m_USNMap.insert(std::pair<DWORDLONG, USN_RECORD*>(nextUSNRecord->FileReferenceNumber, (USN_RECORD*)pElt));
+
+        nextUSNRecord = (USN_RECORD*)((BYTE*)nextUSNRecord + nextUSNRecord->RecordLength);
+    }
+    return S_OK;
+}
+
+HRESULT USNJournalWalker::ReadRecords(BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink)
+{
+    auto pOutBuffer = reinterpret_cast<READ_USN_DATA_OUTPUT_DATA*>(pBuffer);
+    USN_RECORD* nextUSNRecord = pOutBuffer->usnRecord;
+
+    // parse all of the entries we just got
+    while ((__int64)nextUSNRecord < (__int64)((PUCHAR)pOutBuffer + dwBytes))
+    {
+
+        // Parsing entries...
+        bool bInSpecificLocation = false;
+        WCHAR* pFullName = GetFullNameAndIfInLocation(nextUSNRecord, NULL, &bInSpecificLocation);
+
+        if (pFullName && bInSpecificLocation)
+        {
+            if (sink)
+                sink(pFullName, nextUSNRecord);
+
+            if (!(nextUSNRecord->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                m_USNMap.erase(nextUSNRecord->FileReferenceNumber);
+            }
+            m_dwWalkedItems++;
+        }
+
+        if (m_bTrackDirectories)
+        {
+            HRESULT hr = E_FAIL;
+            if (FAILED(hr = TrackDirectory(nextUSNRecord)))
+                return hr;
+        }
+
+        nextUSNRecord = (USN_RECORD*)((BYTE*)nextUSNRecord + nextUSNRecord->RecordLength);
+    }
+    return S_OK;
+}
+
+HRESULT USNJournalWalker::TrackDirectory(const USN_RECORD* pRecord)
+{
+    if (!(pRecord->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        return S_OK;
+
+    // The journal is more recent than the name scan
+    m_ScannedDirectories.erase(pRecord->FileReferenceNumber);
+
+    auto it = m_USNMap.find(pRecord->FileReferenceNumber);
+
+    if (pRecord->Reason & USN_REASON_FILE_DELETE)
+    {
+        if (it != m_USNMap.end())
+        {
+            m_RecordStore.FreeCell(it->second);
+            m_USNMap.erase(it);
+        }
+        return S_OK;
+    }
+
+    // Created or renamed (or just modified) directory: its latest name and parent are kept
+    LPBYTE pElt = it != m_USNMap.end() ? (LPBYTE)it->second : (LPBYTE)m_RecordStore.GetNewCell();
+    if (pElt == NULL)
+    {
+        Log::Error("Failed to allocate USN record to track directory {:#x}", pRecord->FileReferenceNumber);
+        return E_OUTOFMEMORY;
+    }
 
-    ENUM_USN_DATA_OUTPUT_DATA* pOutBuffer = (ENUM_USN_DATA_OUTPUT_DATA*)HeapAlloc(GetProcessHeap(), 0, USN_BUFFER_SIZE);
+    memset(pElt, 0, m_dwRecordMaxSize);
+    memcpy_s(pElt, m_dwRecordMaxSize, pRecord, pRecord->RecordLength);
+
+    if (it == m_USNMap.end())
+    {
+        m_USNMap.insert(std::pair<DWORDLONG, USN_RECORD*>(pRecord->FileReferenceNumber, (USN_RECORD*)pElt));
+    }
+    return S_OK;
+}
+
+HRESULT USNJournalWalker::WalkSerial(
+    const Callbacks& pCallbacks,
+    const JournalRequest& request,
+    const JournalParser& parse,
+    bool bWalkRecords)
+{
+    HRESULT hr = E_FAIL;
+
+    BYTE* pOutBuffer = (BYTE*)HeapAlloc(GetProcessHeap(), 0, USN_BUFFER_SIZE);
     if (pOutBuffer == nullptr)
         return E_OUTOFMEMORY;
 
     BOOST_SCOPE_EXIT(&pOutBuffer) { HeapFree(GetProcessHeap(), 0, pOutBuffer); }
     BOOST_SCOPE_EXIT_END;
 
+    RecordSink sink;
+    if (pCallbacks.RecordCallback != NULL)
+    {
+        sink = [this, &pCallbacks](WCHAR* szFullName, USN_RECORD* pElt) {
+            pCallbacks.RecordCallback(m_VolReader, szFullName, pElt);
+        };
+    }
+
+    DWORD numBytesReturned = 0;
+    while ((hr = request(pOutBuffer, USN_BUFFER_SIZE, numBytesReturned)) == S_OK)
+    {
+        if (FAILED(hr = parse(pOutBuffer, numBytesReturned, sink)))
+            return hr;
+    }
+
+    if (FAILED(hr))
+        return hr;
+
+    return bWalkRecords ? WalkRecords(sink, true) : S_OK;
+}
+
+HRESULT USNJournalWalker::WalkPipelined(
+    const Callbacks& pCallbacks,
+    const JournalRequest& request,
+    const JournalParser& parse,
+    bool bWalkRecords)
+{
+    const DWORD dwBufferSize = std::clamp<DWORD>(m_dwPipelineBufferSize, USN_BUFFER_SIZE, USN_PIPELINE_MAX_BUFFER_SIZE);
+    const size_t readsAhead = m_dwPipelineReadsAhead;
+
+    Log::Debug(L"Pipelined USN journal walk: {} buffers of {} bytes", readsAhead, dwBufferSize);
+
+    // Buffers and batches are recycled through the free queues which bound the memory used by the pipeline
+    BlockingQueue<std::unique_ptr<JournalBuffer>> freeBuffers(readsAhead);
+    BlockingQueue<std::unique_ptr<JournalBuffer>> filled(readsAhead);
+    BlockingQueue<std::unique_ptr<RecordBatch>> freeBatches(USN_PIPELINE_BATCHES);
+    BlockingQueue<std::unique_ptr<RecordBatch>> resolved(USN_PIPELINE_BATCHES);
+
+    try
+    {
+        for (size_t i = 0; i < readsAhead; i++)
+        {
+            auto buffer = std::make_unique<JournalBuffer>();
+            buffer->Data.resize(dwBufferSize);
+            freeBuffers.Push(std::move(buffer));
+        }
+
+        for (size_t i = 0; i < USN_PIPELINE_BATCHES; i++)
+        {
+            auto batch = std::make_unique<RecordBatch>();
+            batch->Entries.reserve(USN_PIPELINE_RECORDS_PER_BATCH);
+            freeBatches.Push(std::move(batch));
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        Log::Error("Failed to allocate USN journal pipeline buffers");
+        return E_OUTOFMEMORY;
+    }
+
+    HRESULT hrRead = S_OK;
+    std::thread reader([&]() {
+        while (auto buffer = freeBuffers.Pop())
+        {
+            auto& journalBuffer = **buffer;
+            hrRead = request(journalBuffer.Data.data(), dwBufferSize, journalBuffer.dwBytes);
+            if (hrRead != S_OK)
+                break;
+
+            if (!filled.Push(std::move(*buffer)))
+                break;
+        }
+
+        if (hrRead == S_FALSE)
+            hrRead = S_OK;
+
+        filled.Close();
+    });
+
+    std::thread output([&]() {
+        // The callback gets a reader it may modify, as with the serial walk
+        auto volReader = m_VolReader;
+
+        while (auto batch = resolved.Pop())
+        {
+            auto& recordBatch = **batch;
+
+            for (const auto& [recordOffset, nameOffset] : recordBatch.Entries)
+            {
+                try
+                {
+                    pCallbacks.RecordCallback(
+                        volReader,
+                        recordBatch.Names.data() + nameOffset,
+                        reinterpret_cast<USN_RECORD*>(recordBatch.Records.data() + recordOffset));
+                }
+                catch (const std::exception& e)
+                {
+                    Log::Error("USN record callback threw exception '{}'", e.what());
+                }
+                catch (...)
+                {
+                    Log::Error("USN record callback threw an exception");
+                }
+            }
+
+            recordBatch.Clear();
+            freeBatches.Push(std::move(*batch));
+        }
+    });
+
+    std::unique_ptr<RecordBatch> batch;
+
+    // Records and names are copied as the journal buffer and the name buffer are reused before the output thread
+    // is done with them
+    const RecordSink sink = [&](WCHAR* szFullName, USN_RECORD* pElt) {
+        if (batch == nullptr)
+        {
+            batch = std::move(*freeBatches.Pop());
+        }
+
+        batch->Add(szFullName, pElt);
+
+        if (batch->Entries.size() >= USN_PIPELINE_RECORDS_PER_BATCH)
+        {
+            resolved.Push(std::move(batch));
+        }
+    };
+
+    HRESULT hr = S_OK;
+    try
+    {
+        while (auto buffer = filled.Pop())
+        {
+            if (FAILED(hr = parse((*buffer)->Data.data(), (*buffer)->dwBytes, sink)))
+                break;
+
+            freeBuffers.Push(std::move(*buffer));
+        }
+
+        // Stops the reader as well when parsing failed
+        freeBuffers.Close();
+        filled.Close();
+        reader.join();
+
+        if (SUCCEEDED(hr) && SUCCEEDED(hrRead) && bWalkRecords)
+        {
+            hr = WalkRecords(sink, true);
+        }
+    }
+    catch (const std::bad_alloc&)
+    {
+        Log::Error("Failed to allocate USN journal pipeline batch");
+        hr = E_OUTOFMEMORY;
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("USN journal pipeline threw exception '{}'", e.what());
+        hr = E_FAIL;
+    }
+
+    if (reader.joinable())
+    {
+        freeBuffers.Close();
+        filled.Close();
+        reader.join();
+    }
+
+    if (batch != nullptr && !batch->Entries.empty())
+    {
+        resolved.Push(std::move(batch));
+    }
+    resolved.Close();
+    output.join();
+
+    if (FAILED(hrRead))
+        return hrRead;
+
+    return hr;
+}
+
+HRESULT USNJournalWalker::EnumJournal(const IUSNJournalWalker::Callbacks& pCallbacks)
+{
+    MFT_ENUM_DATA InBuffer = {0, 0, MAXLONGLONG};
+
     std::shared_ptr<MountedVolumeReader> mountedVolReader = dynamic_pointer_cast<MountedVolumeReader>(m_VolReader);
 
     if (mountedVolReader == nullptr)
         return E_INVALIDARG;
 
-    bool bDone = false;
-    while (bDone == false)
-    {
+    const auto request = [&InBuffer, &mountedVolReader](BYTE* pBuffer, DWORD cbBuffer, DWORD& dwBytes) -> HRESULT {
         // walk the USN Journal
         if (!DeviceIoControl(
                 mountedVolReader->GetDevice(),
                 FSCTL_ENUM_USN_DATA,
                 &InBuffer,
                 sizeof(InBuffer),
-                pOutBuffer,
-                USN_BUFFER_SIZE,
-                &numBytesReturned,
+                pBuffer,
+                cbBuffer,
+                &dwBytes,
                 NULL))
         {
             DWORD dwErr = GetLastError();
             if (dwErr == ERROR_HANDLE_EOF)
-                bDone = true;
-            else
-            {
-                return HRESULT_FROM_WIN32(GetLastError());
-            }
-        }
-        else
-        {
-            USN_RECORD* nextUSNRecord = pOutBuffer->usnRecord;
-
-            // parse all of the entries we just got
-            while ((__int64)nextUSNRecord < (__int64)((PUCHAR)pOutBuffer + numBytesReturned))
-            {
-                LPBYTE pElt = (LPBYTE)m_RecordStore.GetNewCell();
+                return S_FALSE;
 
-                if (pElt == NULL)
-                {
-                    // We walk through FILES for our alerady recorded nodes with hope this will free some space
-                    WalkRecords(pCallbacks, false);
-                    pElt = (LPBYTE)m_RecordStore.GetNewCell();
-                    if (pElt == NULL)
-                    {
-                        /// We are still unable to move forward...
-                        return E_OUTOFMEMORY;
-                    }
-                }
+            return HRESULT_FROM_WIN32(dwErr);
+        }
 
-                memset(pElt, 0, m_dwRecordMaxSize);
-                memcpy_s(pElt, m_dwRecordMaxSize, nextUSNRecord, nextUSNRecord->RecordLength);
+        InBuffer.StartFileReferenceNumber = reinterpret_cast<ENUM_USN_DATA_OUTPUT_DATA*>(pBuffer)->usn;
+        return S_OK;
+    };
 
-                _ASSERT(m_USNMap.find(nextUSNRecord->FileReferenceNumber) == m_USNMap.end());
-                m_USNMap.insert(
-                    std::pair<DWORDLONG, USN_RECORD*>(nextUSNRecord->FileReferenceNumber, (USN_RECORD*)pElt));
+    const auto parse = [this](BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink) {
+        return EnumRecords(pBuffer, dwBytes, sink);
+    };
 
-                nextUSNRecord = (USN_RECORD*)((BYTE*)nextUSNRecord + nextUSNRecord->RecordLength);
-            }
-            InBuffer.StartFileReferenceNumber = pOutBuffer->usn;
-        }
-    }
+    if (m_dwPipelineBufferSize > 0 && pCallbacks.RecordCallback != NULL)
+        return WalkPipelined(pCallbacks, request, parse, true);
 
-    return WalkRecords(pCallbacks, true);
+    return WalkSerial(pCallbacks, request, parse, true);
 }
 
-HRESULT USNJournalWalker::ReadJournal(const IUSNJournalWalker::Callbacks& pCallbacks)
+HRESULT USNJournalWalker::QueryJournal(USN_JOURNAL_DATA& journal) const
 {
-    HRESULT hr = E_FAIL;
-    USN_JOURNAL_DATA JournalData = {0};
     DWORD dwBytes = 0LU;
 
     std::shared_ptr<MountedVolumeReader> mountedVolReader = dynamic_pointer_cast<MountedVolumeReader>(m_VolReader);
@@ -306,78 +622,72 @@ HRESULT USNJournalWalker::ReadJournal(const IUSNJournalWalker::Callbacks& pCallb
             FSCTL_QUERY_USN_JOURNAL,
             NULL,
             0,
-            &JournalData,
-            sizeof(JournalData),
+            &journal,
+            sizeof(journal),
             &dwBytes,
             NULL))
     {
         return HRESULT_FROM_WIN32(GetLastError());
     }
+    return S_OK;
+}
 
-    READ_USN_JOURNAL_DATA InBuffer = {0, 0xFFFFFFFF, FALSE, 0, 0, JournalData.UsnJournalID};
-    DWORD numBytesReturned = 0;
-    READ_USN_DATA_OUTPUT_DATA* pOutBuffer = (READ_USN_DATA_OUTPUT_DATA*)HeapAlloc(GetProcessHeap(), 0, USN_BUFFER_SIZE);
-    if (pOutBuffer == nullptr)
-        return E_OUTOFMEMORY;
+HRESULT USNJournalWalker::ReadJournal(const IUSNJournalWalker::Callbacks& pCallbacks)
+{
+    HRESULT hr = E_FAIL;
+    USN_JOURNAL_DATA JournalData = {0};
 
-    BOOST_SCOPE_EXIT(&pOutBuffer) { HeapFree(GetProcessHeap(), 0, pOutBuffer); }
-    BOOST_SCOPE_EXIT_END
+    std::shared_ptr<MountedVolumeReader> mountedVolReader = dynamic_pointer_cast<MountedVolumeReader>(m_VolReader);
 
-    bool bDone = false;
-    while (bDone == false)
+    if (mountedVolReader == nullptr)
     {
+        return E_INVALIDARG;
+    }
+
+    if (FAILED(hr = QueryJournal(JournalData)))
+    {
+        return hr;
+    }
+
+    READ_USN_JOURNAL_DATA InBuffer = {m_StartUsn, 0xFFFFFFFF, FALSE, 0, 0, JournalData.UsnJournalID};
+
+    const auto request = [&InBuffer, &mountedVolReader](BYTE* pBuffer, DWORD cbBuffer, DWORD& dwBytes) -> HRESULT {
         // walk the USN Journal
         if (!DeviceIoControl(
                 mountedVolReader->GetDevice(),
                 FSCTL_READ_USN_JOURNAL,
                 &InBuffer,
                 sizeof(InBuffer),
-                pOutBuffer,
-                USN_BUFFER_SIZE,
-                &numBytesReturned,
+                pBuffer,
+                cbBuffer,
+                &dwBytes,
                 NULL))
         {
             DWORD dwErr = GetLastError();
             if (dwErr == ERROR_HANDLE_EOF)
-                bDone = true;
-            else
-                return HRESULT_FROM_WIN32(GetLastError());
-        }
-        else
-        {
-            if (numBytesReturned <= 8)
-                bDone = true;
-            else
-            {
-                USN_RECORD* nextUSNRecord = pOutBuffer->usnRecord;
+                return S_FALSE;
 
-                // parse all of the entries we just got
-                while ((__int64)nextUSNRecord < (__int64)((PUCHAR)pOutBuffer + numBytesReturned))
-                {
+            return HRESULT_FROM_WIN32(dwErr);
+        }
 
-                    // Parsing entries...
-                    bool bInSpecificLocation = false;
-                    WCHAR* pFullName = GetFullNameAndIfInLocation(nextUSNRecord, NULL, &bInSpecificLocation);
+        if (dwBytes <= 8)
+            return S_FALSE;
 
-                    if (pFullName && bInSpecificLocation)
-                    {
-                        pCallbacks.RecordCallback(m_VolReader, pFullName, nextUSNRecord);
+        InBuffer.StartUsn = reinterpret_cast<READ_USN_DATA_OUTPUT_DATA*>(pBuffer)->usn;
+        return S_OK;
+    };
 
-                        if (!(nextUSNRecord->FileAttributes & FILE_ATTRIBUTE_DIRECTORY))
-                        {
-                            m_USNMap.erase(nextUSNRecord->FileReferenceNumber);
-                        }
-                        m_dwWalkedItems++;
-                    }
+    const auto parse = [this](BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink) {
+        return ReadRecords(pBuffer, dwBytes, sink);
+    };
 
-                    nextUSNRecord = (USN_RECORD*)((BYTE*)nextUSNRecord + nextUSNRecord->RecordLength);
-                }
+    if (m_dwPipelineBufferSize > 0 && pCallbacks.RecordCallback != NULL)
+        hr = WalkPipelined(pCallbacks, request, parse, false);
+    else
+        hr = WalkSerial(pCallbacks, request, parse, false);
 
-                InBuffer.StartUsn = pOutBuffer->usn;
-            }
-        }
-    }
-    return S_OK;
+    m_NextUsn = InBuffer.StartUsn;
+    return hr;
 }
 
 USNJournalWalker::~USNJournalWalker(void) {}
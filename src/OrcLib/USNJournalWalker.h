@@ -13,11 +13,17 @@
 #include "IUSNJournalWalker.h"
 #include "USNJournalWalkerBase.h"
 
+#include <functional>
+#include <string>
+
 #pragma managed(push, off)
 
 namespace Orc {
 class MountedVolumeReader;
 
+// Buffers filled ahead of the record parsing by the pipelined walk
+constexpr auto USN_PIPELINE_READS_AHEAD = (4);
+
 class USNJournalWalker
     : public USNJournalWalkerBase
     , public IUSNJournalWalker
@@ -33,8 +39,58 @@ public:
     virtual HRESULT EnumJournal(const IUSNJournalWalker::Callbacks& pCallbacks);
     virtual HRESULT ReadJournal(const IUSNJournalWalker::Callbacks& pCallbacks);
 
+    // Pipelined walk: a reader thread issues the journal requests with 'dwBufferSize' bytes buffers, keeping up to
+    // 'dwReadsAhead' of them filled ahead of the record parsing and name resolution, and an output thread calls the
+    // record callback with batches of resolved records. A 0 buffer size keeps the serial walk.
+    void SetPipeline(DWORD dwBufferSize, DWORD dwReadsAhead = USN_PIPELINE_READS_AHEAD)
+    {
+        m_dwPipelineBufferSize = dwBufferSize;
+        m_dwPipelineReadsAhead = dwReadsAhead ? dwReadsAhead : USN_PIPELINE_READS_AHEAD;
+    }
+
+    HRESULT QueryJournal(USN_JOURNAL_DATA& journal) const;
+
+    // Incremental walk: ReadJournal starts at 'startUsn' and keeps the USN map up to date with the directories created,
+    // renamed or deleted by the records it reads. The map is seeded with AddDirectory instead of EnumJournal.
+    void SetIncremental(USN startUsn)
+    {
+        m_StartUsn = startUsn;
+        m_bTrackDirectories = true;
+    }
+
+    // USN of the record following the last one returned by ReadJournal
+    USN GetNextUsn() const { return m_NextUsn; }
+
 private:
-    HRESULT WalkRecords(const Callbacks& pCallbacks, bool bWalkDirs = true);
+    using RecordSink = std::function<void(WCHAR* szFullName, USN_RECORD* pElt)>;
+
+    // Fills 'pBuffer' with the next records, returns S_FALSE once the whole journal was returned
+    using JournalRequest = std::function<HRESULT(BYTE* pBuffer, DWORD cbBuffer, DWORD& dwBytesReturned)>;
+    using JournalParser = std::function<HRESULT(BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink)>;
+
+    USN m_StartUsn = 0LL;
+    USN m_NextUsn = 0LL;
+    bool m_bTrackDirectories = false;
+
+    DWORD m_dwPipelineBufferSize = 0L;
+    DWORD m_dwPipelineReadsAhead = USN_PIPELINE_READS_AHEAD;
+
+    HRESULT WalkRecords(const RecordSink& sink, bool bWalkDirs = true);
+
+    HRESULT EnumRecords(BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink);
+    HRESULT ReadRecords(BYTE* pBuffer, DWORD dwBytes, const RecordSink& sink);
+    HRESULT TrackDirectory(const USN_RECORD* pRecord);
+
+    HRESULT WalkSerial(
+        const Callbacks& pCallbacks,
+        const JournalRequest& request,
+        const JournalParser& parse,
+        bool bWalkRecords);
+    HRESULT WalkPipelined(
+        const Callbacks& pCallbacks,
+        const JournalRequest& request,
+        const JournalParser& parse,
+        bool bWalkRecords);
 };  // USNJournalWalker
 }  // namespace Orc
 
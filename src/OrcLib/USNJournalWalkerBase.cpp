@@ -9,6 +9,9 @@
 
 #include "USNJournalWalkerBase.h"
 #include "MountedVolumeReader.h"
+#include "MFTWalker.h"
+
+#include "Log/Log.h"
 
 using namespace Orc;
 
@@ -33,9 +36,126 @@ USNJournalWalkerBase::~USNJournalWalkerBase()
 
 const USNJournalWalkerBase::USN_MAP& USNJournalWalkerBase::GetUSNMap()
 {
+    for (const auto& [frn, directory] : m_ScannedDirectories)
+    {
+        if (m_USNMap.find(frn) == m_USNMap.end())
+            AddDirectory(frn, directory.ParentFRN, directory.Name);
+    }
+    m_ScannedDirectories.clear();
+
     return m_USNMap;
 }
 
+HRESULT USNJournalWalkerBase::AddDirectory(DWORDLONG frn, DWORDLONG parentFrn, const std::wstring& name)
+{
+    const DWORD dwNameLength = static_cast<DWORD>(name.size() * sizeof(WCHAR));
+    const DWORD dwRecordLength = FIELD_OFFSET(USN_RECORD, FileName) + dwNameLength;
+
+    if (dwRecordLength > m_dwRecordMaxSize)
+    {
+        Log::Error(L"Directory name is too long for a USN record: '{}'", name);
+        return E_INVALIDARG;
+    }
+
+    auto it = m_USNMap.find(frn);
+    USN_RECORD* pElt = it != m_USNMap.end() ? it->second : (USN_RECORD*)m_RecordStore.GetNewCell();
+    if (pElt == NULL)
+        return E_OUTOFMEMORY;
+
+    memset(pElt, 0, m_dwRecordMaxSize);
+    pElt->RecordLength = dwRecordLength;
+    pElt->MajorVersion = 2;
+    pElt->FileReferenceNumber = frn;
+    pElt->ParentFileReferenceNumber = parentFrn;
+    pElt->FileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+    pElt->FileNameLength = static_cast<WORD>(dwNameLength);
+    pElt->FileNameOffset = FIELD_OFFSET(USN_RECORD, FileName);
+    memcpy_s(pElt->FileName, m_dwRecordMaxSize - FIELD_OFFSET(USN_RECORD, FileName), name.data(), dwNameLength);
+
+    if (it == m_USNMap.end())
+    {
+        m_USNMap.insert(std::pair<DWORDLONG, USN_RECORD*>(frn, pElt));
+    }
+    return S_OK;
+}
+
+HRESULT USNJournalWalkerBase::ScanDirectories(const std::shared_ptr<Location>& loc)
+{
+    HRESULT hr = E_FAIL;
+
+    // $FILE_NAME copy of the attributes of a record with a $I30 index
+    constexpr ULONG kFileNameIndexPresent = 0x10000000;
+
+    MFTWalker walk;
+    if (FAILED(hr = walk.Initialize(loc, ResurrectRecordsMode::kNo)))
+    {
+        Log::Error(L"Failed during MFT walk initialisation [{}]", SystemError(hr));
+        return hr;
+    }
+
+    MFTWalker::NameScanCallbacks callbacks;
+    callbacks.NameFilterCallback = [](const PFILE_NAME pFileName) -> bool {
+        return (pFileName->Info.Reserved18.FileAttributes & kFileNameIndexPresent)
+            && pFileName->Flags != FILE_NAME_DOS83;
+    };
+    callbacks.NameMatchCallback = [this](
+                                      const std::shared_ptr<VolumeReader>& volreader,
+                                      const MFTWalker::NameScanRecord& record) {
+        if (!record.bInUse || record.FileNames.empty())
+            return;
+
+        const auto frn = *reinterpret_cast<const DWORDLONG*>(&record.FileReferenceNumber);
+
+        // Win32 or posix name first, the dos names were filtered out
+        PFILE_NAME pFileName = record.FileNames.front();
+        for (const auto pName : record.FileNames)
+        {
+            if (pName->Flags == FILE_NAME_WIN32 || pName->Flags == FILE_NAME_POSIX)
+            {
+                pFileName = pName;
+                break;
+            }
+        }
+
+        const auto parentFrn = *reinterpret_cast<const DWORDLONG*>(&pFileName->ParentDirectory);
+
+        // the root folder is not added, as with EnumJournal
+        if (frn == m_dwlRootUSN || frn == parentFrn)
+            return;
+
+        m_ScannedDirectories.insert_or_assign(
+            frn, ScannedDirectory {parentFrn, std::wstring(pFileName->FileName, pFileName->FileNameLength)});
+    };
+
+    if (FAILED(hr = walk.ScanNames(callbacks)))
+    {
+        Log::Error(L"Failed during MFT name scan [{}]", SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"MFT name scan of '{}': {} directories", loc->GetLocation(), m_ScannedDirectories.size());
+    return S_OK;
+}
+
+USNJournalWalkerBase::USN_MAP::iterator USNJournalWalkerBase::FindDirectory(DWORDLONG frn)
+{
+    auto it = m_USNMap.find(frn);
+    if (it != m_USNMap.end() || m_ScannedDirectories.empty())
+        return it;
+
+    auto scanned = m_ScannedDirectories.find(frn);
+    if (scanned == m_ScannedDirectories.end())
+        return it;
+
+    const ScannedDirectory directory = std::move(scanned->second);
+    m_ScannedDirectories.erase(scanned);
+
+    if (FAILED(AddDirectory(frn, directory.ParentFRN, directory.Name)))
+        return m_USNMap.end();
+
+    return m_USNMap.find(frn);
+}
+
 HRESULT USNJournalWalkerBase::ExtendNameBuffer(WCHAR** pCurrent)
 {
     WCHAR* pNewBuf = NULL;
@@ -106,7 +226,7 @@ WCHAR* USNJournalWalkerBase::GetFullNameAndIfInLocation(USN_RECORD* pElt, DWORD*
 #endif
 
     DWORD dwCount = 0;
-    auto pParentPair = m_USNMap.find(pElt->ParentFileReferenceNumber);
+    auto pParentPair = FindDirectory(pElt->ParentFileReferenceNumber);
 
     DWORDLONG dwlLastParentRefNumber = 0;
 
@@ -171,7 +291,7 @@ WCHAR* USNJournalWalkerBase::GetFullNameAndIfInLocation(USN_RECORD* pElt, DWORD*
             memcpy_s(pCurrent, dwCount, pParentPair->second->FileName, pParentPair->second->FileNameLength);
         }
         dwlLastParentRefNumber = pParentPair->second->ParentFileReferenceNumber;
-        pParentPair = m_USNMap.find(pParentPair->second->ParentFileReferenceNumber);
+        pParentPair = FindDirectory(pParentPair->second->ParentFileReferenceNumber);
 
         if (pbInSpecificLocation)
             if (!*pbInSpecificLocation)
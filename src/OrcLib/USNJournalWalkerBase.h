@@ -16,6 +16,8 @@
 #include "Windows.h"
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 #include <unordered_set>
 
 #pragma managed(push, off)
@@ -71,14 +73,32 @@ public:
     using PUSN_RECORD_V3 = USN_RECORD_V3*;
 
     using USN_MAP = std::map<DWORDLONG, USN_RECORD*>;
+
+    // Every known directory, including the scanned ones not yet needed by a record
     const USN_MAP& GetUSNMap();
 
+    HRESULT AddDirectory(DWORDLONG frn, DWORDLONG parentFrn, const std::wstring& name);
+
+    // Seeds the directories with a name only scan of the MFT of 'loc' instead of EnumJournal: the scanned directories
+    // are only copied into the USN map when the full name of a record goes through them
+    HRESULT ScanDirectories(const std::shared_ptr<Location>& loc);
+
     HRESULT ExtendNameBuffer(WCHAR** pCurrent);
     WCHAR* GetFullNameAndIfInLocation(USN_RECORD* pElt, DWORD* pdwLen, bool* pbInSpecificLocation);
 
 protected:
+    struct ScannedDirectory
+    {
+        DWORDLONG ParentFRN;
+        std::wstring Name;
+    };
+
+    // m_USNMap entry of a directory, moved from the scanned directories when it is first needed
+    USN_MAP::iterator FindDirectory(DWORDLONG frn);
+
     HeapStorage m_RecordStore;
     USN_MAP m_USNMap;
+    std::unordered_map<DWORDLONG, ScannedDirectory> m_ScannedDirectories;
 
     std::unordered_set<DWORDLONG> m_LocationsRefNum;
 
@@ -12,6 +12,8 @@
 #include "MountedVolumeReader.h"
 
 #include "MFTWalker.h"
+#include "UsnRecordScanner.h"
+#include "VolumeReadProfile.h"
 
 #include <cmath>
 
@@ -23,6 +25,10 @@ static const auto ROOT_USN = 0x0005000000000005LL;
 
 DWORD USNJournalWalkerOffline::m_BufferSize = 0x10000;
 
+// Volume carving reads, each one overlapping the next one by more than a record
+static const auto CARVE_READ_SIZE = 0x400000;
+static const auto CARVE_OVERLAP = 0x1000;
+
 USNJournalWalkerOffline::USNJournalWalkerOffline()
     : m_location()
 {
@@ -183,6 +189,12 @@ HRESULT USNJournalWalkerOffline::ReadJournal(const IUSNJournalWalker::Callbacks&
         }
         BOOST_SCOPE_EXIT_END;
 
+        // $J is read sequentially, keep some reads in flight
+        const auto& readProfile = VolumeReadProfile::Instance();
+        m_VolReader->EnableReadAhead(readProfile.QueueDepth(), readProfile.ChunkSize());
+        BOOST_SCOPE_EXIT(this_) { this_->m_VolReader->DisableReadAhead(); }
+        BOOST_SCOPE_EXIT_END;
+
         if (S_OK == m_USNJournal->CanRead())
         {
             ULONG64 size = m_USNJournal->GetSize();
@@ -264,6 +276,106 @@ HRESULT USNJournalWalkerOffline::ReadJournal(const IUSNJournalWalker::Callbacks&
     return hr;
 }
 
+HRESULT USNJournalWalkerOffline::CarveVolume(const IUSNJournalWalker::Callbacks& pCallbacks)
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_VolReader == nullptr)
+        return E_POINTER;
+
+    const auto ullVolumeSize = m_VolReader->GetVolumeSize();
+    if (ullVolumeSize == 0)
+    {
+        Log::Error(L"Failed to carve USN records: unknown size of volume '{}'", m_VolReader->GetLocation());
+        return E_FAIL;
+    }
+
+    CBinaryBuffer buffer;
+    if (!buffer.SetCount(CARVE_READ_SIZE))
+        return E_OUTOFMEMORY;
+
+    // V3 records are reported as V2 ones, NTFS file references fit in 64 bits
+    CBinaryBuffer converted;
+    if (!converted.SetCount(UsnRecordScanner::kMaxRecordLength))
+        return E_OUTOFMEMORY;
+
+    const auto& readProfile = VolumeReadProfile::Instance();
+    m_VolReader->EnableReadAhead(readProfile.QueueDepth(), readProfile.ChunkSize());
+    BOOST_SCOPE_EXIT(this_) { this_->m_VolReader->DisableReadAhead(); }
+    BOOST_SCOPE_EXIT_END;
+
+    const UsnRecordScanner scanner;
+    std::vector<size_t> offsets;
+    ULONG ulCarved = 0L;
+
+    ULONGLONG ullOffset = 0LL;
+    while (ullOffset < ullVolumeSize)
+    {
+        const auto ullToRead = std::min<ULONGLONG>(CARVE_READ_SIZE, ullVolumeSize - ullOffset);
+        ULONGLONG ullRead = 0LL;
+        if (FAILED(hr = m_VolReader->Read(ullOffset, buffer, ullToRead, ullRead)))
+        {
+            Log::Error(
+                L"Failed to read volume at offset {} while carving USN records [{}]", ullOffset, SystemError(hr));
+            return hr;
+        }
+
+        if (ullRead == 0)
+            break;
+
+        const bool bLastRead = ullRead < ullToRead || ullOffset + ullRead >= ullVolumeSize;
+        const auto cbScan = static_cast<size_t>(bLastRead ? ullRead : ullRead - CARVE_OVERLAP);
+
+        offsets.clear();
+        scanner.Scan(buffer.GetData(), static_cast<size_t>(ullRead), offsets, cbScan);
+
+        for (const auto offset : offsets)
+        {
+            auto pRecord = reinterpret_cast<USN_RECORD*>(buffer.GetData() + offset);
+            if (pRecord->MajorVersion == 3)
+            {
+                const auto pV3 = reinterpret_cast<PUSN_RECORD_V3>(pRecord);
+                const auto pV2 = reinterpret_cast<PUSN_RECORD_V2>(converted.GetData());
+
+                pV2->MajorVersion = 2;
+                pV2->MinorVersion = 0;
+                memcpy(&pV2->FileReferenceNumber, pV3->FileReferenceNumber, sizeof(DWORDLONG));
+                memcpy(&pV2->ParentFileReferenceNumber, pV3->ParentFileReferenceNumber, sizeof(DWORDLONG));
+                pV2->Usn = pV3->Usn;
+                pV2->TimeStamp = pV3->TimeStamp;
+                pV2->Reason = pV3->Reason;
+                pV2->SourceInfo = pV3->SourceInfo;
+                pV2->SecurityId = pV3->SecurityId;
+                pV2->FileAttributes = pV3->FileAttributes;
+                pV2->FileNameLength = pV3->FileNameLength;
+                pV2->FileNameOffset = static_cast<WORD>(offsetof(USN_RECORD_V2, FileName));
+                pV2->RecordLength = pV2->FileNameOffset + pV2->FileNameLength;
+                memcpy(pV2->FileName, pV3->FileName, pV3->FileNameLength);
+
+                pRecord = reinterpret_cast<USN_RECORD*>(pV2);
+            }
+
+            bool bInSpecificLocation = false;
+            WCHAR* pFullName = GetFullNameAndIfInLocation(pRecord, NULL, &bInSpecificLocation);
+
+            if (pFullName && bInSpecificLocation)
+            {
+                pCallbacks.RecordCallback(m_VolReader, pFullName, pRecord);
+                m_dwWalkedItems++;
+                ulCarved++;
+            }
+        }
+
+        if (bLastRead)
+            break;
+
+        ullOffset += cbScan;
+    }
+
+    Log::Info(L"Carved {} USN records from volume '{}'", ulCarved, m_VolReader->GetLocation());
+    return S_OK;
+}
+
 void USNJournalWalkerOffline::FillUSNRecord(USN_RECORD& record, MFTRecord* pElt, const PFILE_NAME pFileName)
 {
     DWORD fileNameLength = (DWORD)pFileName->FileNameLength * sizeof(WCHAR);
@@ -301,15 +413,13 @@ HRESULT USNJournalWalkerOffline::FindNextUSNRecord(
     shouldReadAnotherChunk = false;
     shouldStop = false;
 
-    // ensure we are not in a gap between 2 records
+    // ensure we are not in a gap between 2 records (sparse parts of $J are whole zeroed pages)
     ULONG offset = 0;
     if (*(DWORD*)(pCurrentChunkPosition) == 0)
     {
-        while ((__int64)pCurrentChunkPosition + offset < (__int64)pEndChunkPosition
-               && (*(pCurrentChunkPosition + offset) == 0))
-        {
-            ++offset;
-        }
+        offset = static_cast<ULONG>(
+            UsnRecordScanner::ZeroPrefix(
+                pCurrentChunkPosition, static_cast<size_t>(pEndChunkPosition - pCurrentChunkPosition)));
     }
 
     // I add 8 here in to ensure that we have at least 8 bytes to check that it's a valid record
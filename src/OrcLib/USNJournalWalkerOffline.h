@@ -37,6 +37,10 @@ public:
     virtual HRESULT EnumJournal(const IUSNJournalWalker::Callbacks& pCallbacks);
     virtual HRESULT ReadJournal(const IUSNJournalWalker::Callbacks& pCallbacks);
 
+    // Carve the USN records found anywhere on the volume (unallocated clusters, remains of older journals, the
+    // journal itself), in volume order. EnumJournal resolves their names when their parents still exist.
+    HRESULT CarveVolume(const IUSNJournalWalker::Callbacks& pCallbacks);
+
     // static functions
     static void FillUSNRecord(USN_RECORD& record, MFTRecord* pElt, const PFILE_NAME pFileName);
 
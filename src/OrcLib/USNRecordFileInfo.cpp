@@ -12,6 +12,7 @@
 #include "TableOutput.h"
 
 #include "NtDllExtension.h"
+#include "FileDirectory.h"
 
 #include "FileStream.h"
 
@@ -185,6 +186,25 @@ HRESULT USNRecordFileInfo::OpenFileInformation()
 {
     HRESULT hr = E_FAIL;
 
+    if (m_pDirectoryCache != nullptr && m_pUSNRecord != nullptr)
+    {
+        if (auto entry =
+                m_pDirectoryCache->Find(m_pUSNRecord->ParentFileReferenceNumber, m_pUSNRecord->FileReferenceNumber))
+        {
+            ZeroMemory(&m_fiInfo, sizeof(m_fiInfo));
+            m_fiInfo.dwFileAttributes = entry->FileAttributes;
+            m_fiInfo.ftCreationTime = {entry->CreationTime.LowPart, static_cast<DWORD>(entry->CreationTime.HighPart)};
+            m_fiInfo.ftLastAccessTime = {
+                entry->LastAccessTime.LowPart, static_cast<DWORD>(entry->LastAccessTime.HighPart)};
+            m_fiInfo.ftLastWriteTime = {
+                entry->LastWriteTime.LowPart, static_cast<DWORD>(entry->LastWriteTime.HighPart)};
+            m_fiInfo.nFileSizeHigh = static_cast<DWORD>(entry->EndOfFile.HighPart);
+            m_fiInfo.nFileSizeLow = entry->EndOfFile.LowPart;
+            m_bFileInformationAvailable = true;
+            return S_OK;
+        }
+    }
+
     if (FAILED(hr = CheckFileHandle()))
         return hr;
     if (!m_bFileInformationAvailable)
@@ -318,6 +338,18 @@ HRESULT USNRecordFileInfo::OpenFileFind()
 {
     HANDLE hFind = INVALID_HANDLE_VALUE;
 
+    if (!m_bFileFindAvailable && m_pDirectoryCache != nullptr && m_pUSNRecord != nullptr)
+    {
+        if (auto entry =
+                m_pDirectoryCache->Find(m_pUSNRecord->ParentFileReferenceNumber, m_pUSNRecord->FileReferenceNumber))
+        {
+            ZeroMemory(&m_FileFindData, sizeof(m_FileFindData));
+            wcsncpy_s(m_FileFindData.cAlternateFileName, entry->ShortName.c_str(), _TRUNCATE);
+            m_bFileFindAvailable = true;
+            return S_OK;
+        }
+    }
+
     if (!m_bFileFindAvailable)
         if ((hFind = FindFirstFile(m_szFullName, &m_FileFindData)) == INVALID_HANDLE_VALUE)
             return HRESULT_FROM_WIN32(GetLastError());
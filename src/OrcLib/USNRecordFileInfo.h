@@ -16,6 +16,8 @@
 
 namespace Orc {
 
+class FileIdDirectoryCache;
+
 struct FILE_STREAM_INFORMATION
 {
     ULONG NextEntryOffset;
@@ -36,6 +38,10 @@ public:
 
     HRESULT OpenFileInformation();
 
+    // Times, sizes, attributes and short names are then taken from the enumeration of the parent directory, the file
+    // itself is only opened when other columns need it or when it was not found in its parent
+    void SetDirectoryCache(FileIdDirectoryCache* pCache) { m_pDirectoryCache = pCache; }
+
     virtual bool IsDirectory();
     virtual const std::unique_ptr<DataDetails>& GetDetails()
     {
@@ -100,6 +106,8 @@ private:
 
     std::unique_ptr<DataDetails> m_Details;
 
+    FileIdDirectoryCache* m_pDirectoryCache = nullptr;
+
     inline HRESULT CheckFileFind()
     {
         if (m_bFileFindAvailable)
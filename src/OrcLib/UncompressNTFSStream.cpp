@@ -11,15 +11,19 @@
 
 #include "UncompressNTFSStream.h"
 
-#include "NTFSCompression.h"
+#include "Filesystem/Ntfs/Compression/Engine/Lznt1/Lznt1Decompressor.h"
 #include "VolumeReader.h"
 #include "Utils/Round.h"
 #include "Utils/BufferSpan.h"
 #include "Stream/StreamUtils.h"
 #include "Stream/VolumeStreamReader.h"
 
+#include <future>
+
 using namespace Orc;
 
+std::atomic<DWORD> UncompressNTFSStream::s_dwDecompressThreads = 0L;
+
 UncompressNTFSStream::UncompressNTFSStream()
     : NTFSStream()
     , m_volume(nullptr)
@@ -158,12 +162,37 @@ HRESULT UncompressNTFSStream::OpenAllocatedDataStream(
     return hr;
 }
 
+void UncompressNTFSStream::UncompressUnit(size_t unitIndex, const CBinaryBuffer& unit, LPBYTE pOutput) const
+{
+    const bool bCompressed = m_IsBlockCompressed.empty() || static_cast<bool>(m_IsBlockCompressed[unitIndex]);
+    if (!bCompressed)
+    {
+        CopyMemory(pOutput, unit.GetData(), m_dwCompressionUnit);
+        return;
+    }
+
+    // compression unit is compressed: proceed with decompression
+    std::error_code ec;
+    const auto input = BufferView(unit.GetData(), std::min<size_t>(unit.GetCount(), m_dwCompressionUnit));
+    const auto decoded = Lznt1Decompress(input, BufferSpan(pOutput, m_dwCompressionUnit), ec);
+    if (ec)
+    {
+        // If decompression failed and CUs not compressed information is not available, we assume the CU was not
+        // compressed
+        Log::Warn(L"Failed to uncompress {} bytes from compressed unit, copying as raw data [{}]", input.size(), ec);
+        CopyMemory(pOutput, unit.GetData(), m_dwCompressionUnit);
+        return;
+    }
+
+    // The end of the unit past the compressed data is sparse
+    ZeroMemory(pOutput + decoded, m_dwCompressionUnit - decoded);
+}
+
 HRESULT UncompressNTFSStream::ReadCompressionUnit(
     DWORD dwNbCU,
     CBinaryBuffer& uncompressedData,
     __out_opt PULONGLONG pcbBytesRead)
 {
-    std::error_code ec;
     HRESULT hr = E_FAIL;
 
     if (pcbBytesRead)
@@ -176,87 +205,55 @@ HRESULT UncompressNTFSStream::ReadCompressionUnit(
         return hr;
     }
 
-    size_t uncomp_processed = 0;
-
-    CBinaryBuffer buffer(true);
+    // Raw units are read in order from the volume, they are then independent and can be decompressed concurrently
+    std::vector<CBinaryBuffer> units;
+    units.reserve(dwNbCU);
     for (size_t i = 0; i < dwNbCU; ++i)
     {
+        auto& buffer = units.emplace_back(true);
         hr = ReadRaw(buffer, m_dwCompressionUnit);
         if (FAILED(hr))
         {
             Log::Error(L"Failed to read {} bytes from chained stream [{}]", buffer.GetCount(), SystemError(hr));
             return hr;
         }
+    }
 
-        ULONGLONG ullRead = buffer.GetCount();
-
-        size_t unitIndex = ((size_t)m_ullPosition / m_dwCompressionUnit) + i;
+    const size_t firstUnit = (size_t)m_ullPosition / m_dwCompressionUnit;
+    const auto uncompress = [&](size_t i) {
+        UncompressUnit(firstUnit + i, units[i], uncompressedData.GetData() + i * m_dwCompressionUnit);
+    };
 
-        if (!m_IsBlockCompressed.empty())
+    const size_t workerCount = std::min<size_t>(s_dwDecompressThreads, dwNbCU);
+    if (workerCount < 2)
+    {
+        for (size_t i = 0; i < dwNbCU; ++i)
         {
-            if (m_IsBlockCompressed[unitIndex])
-            {
-                // compression unit is compressed: proceed with decompression
-                NTFS_COMP_INFO info;
-                info.buf_size_b = m_dwCompressionUnit;
-                info.comp_buf = (char*)buffer.GetData();
-                info.comp_len = m_dwCompressionUnit;
-                info.uncomp_buf = (char*)uncompressedData.GetData() + uncomp_processed;
-                info.uncomp_idx = 0L;
-
-                if (FAILED(hr = ntfs_uncompress_compunit(&info)))
-                {
-                    Log::Warn(
-                        L"Failed to uncompress {} bytes from compressed unit, copying as raw data [{}]",
-                        info.comp_len,
-                        SystemError(hr));
-                    CopyMemory(
-                        (LPBYTE)uncompressedData.GetData() + uncomp_processed, buffer.GetData(), m_dwCompressionUnit);
-                    uncomp_processed += m_dwCompressionUnit;
-                }
-                else
+            uncompress(i);
+        }
+    }
+    else
+    {
+        std::atomic<size_t> next {0};
+        std::vector<std::future<void>> workers;
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            workers.push_back(std::async(std::launch::async, [&]() {
+                for (size_t unit = next++; unit < dwNbCU; unit = next++)
                 {
-                    uncomp_processed += info.comp_len;
+                    uncompress(unit);
                 }
-            }
-            else
-            {
-                CopyMemory(
-                    (LPBYTE)uncompressedData.GetData() + uncomp_processed, buffer.GetData(), m_dwCompressionUnit);
-                uncomp_processed += m_dwCompressionUnit;
-            }
+            }));
         }
-        else
+
+        for (auto& worker : workers)
         {
-            // compression unit is compressed: proceed with decompression
-            NTFS_COMP_INFO info;
-            info.buf_size_b = m_dwCompressionUnit;
-            info.comp_buf = (char*)buffer.GetData();
-            info.comp_len = m_dwCompressionUnit;
-            info.uncomp_buf = (char*)uncompressedData.GetCount() + uncomp_processed;
-            info.uncomp_idx = 0L;
-
-            if (FAILED(hr = ntfs_uncompress_compunit(&info)))
-            {
-                // If decompression failed and CUs not compressed information is not available, we assume the CU was
-                // not compressed
-                Log::Warn(
-                    "Failed to uncompress {} bytes from compressed unit, copying as raw/uncompressed data [{}]",
-                    info.comp_len,
-                    SystemError(hr));
-                CopyMemory(
-                    (LPBYTE)uncompressedData.GetData() + uncomp_processed, buffer.GetData(), m_dwCompressionUnit);
-                uncomp_processed += m_dwCompressionUnit;
-            }
-            else
-            {
-                uncomp_processed += info.comp_len;
-            }
+            worker.get();
         }
     }
 
     if (pcbBytesRead)
-        *pcbBytesRead = uncomp_processed;
+        *pcbBytesRead = static_cast<ULONGLONG>(dwNbCU) * m_dwCompressionUnit;
     return S_OK;
 }
 
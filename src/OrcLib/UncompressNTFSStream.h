@@ -12,6 +12,8 @@
 
 #include "NTFSStream.h"
 
+#include <atomic>
+
 #include "boost/logic/tribool.hpp"
 
 #pragma managed(push, off)
@@ -40,8 +42,15 @@ public:
     STDMETHOD(SetFilePointer)
     (__in LONGLONG DistanceToMove, __in DWORD dwMoveMethod, __out_opt PULONG64 pCurrPointer);
 
+    // Number of compression units of a read decompressed concurrently on the thread pool (0: by the reading thread)
+    static void SetDecompressThreads(DWORD dwThreads) { s_dwDecompressThreads = dwThreads; }
+    static DWORD DecompressThreads() { return s_dwDecompressThreads; }
+
 private:
     HRESULT ReadRaw(CBinaryBuffer& buffer, size_t length);
+    void UncompressUnit(size_t unitIndex, const CBinaryBuffer& unit, LPBYTE pOutput) const;
+
+    static std::atomic<DWORD> s_dwDecompressThreads;
 
 private:
     std::unique_ptr<Stream::VolumeStreamReader> m_volume;
@@ -18,14 +18,18 @@
 #include "ByteStream.h"
 #include "Utils/BufferView.h"
 #include "VolumeReader.h"
+#include "WofChunkCache.h"
 
 using namespace Orc::Ntfs;
 using namespace Orc;
 
 namespace {
 
-std::unique_ptr<UncompressWofStream::WofStreamT>
-CreateWofStream(const std::shared_ptr<ByteStream>& rawStream, WofAlgorithm algorithm, uint64_t uncompressedSize)
+std::unique_ptr<UncompressWofStream::WofStreamT> CreateWofStream(
+    const std::shared_ptr<ByteStream>& rawStream,
+    WofAlgorithm algorithm,
+    uint64_t uncompressedSize,
+    std::optional<uint64_t> cacheFileId)
 {
     std::error_code ec;
 
@@ -50,6 +54,24 @@ CreateWofStream(const std::shared_ptr<ByteStream>& rawStream, WofAlgorithm algor
         return nullptr;
     }
 
+    if (const auto dwReadAhead = UncompressWofStream::ReadAhead(); dwReadAhead > 1)
+    {
+        wofStream->EnableReadAhead(
+            dwReadAhead,
+            [algorithm](std::error_code& ec) { return std::make_unique<NtDecompressorConcept>(algorithm, ec); },
+            ec);
+        if (ec)
+        {
+            // Not fatal: chunks are then decompressed by the reading thread
+            Log::Debug("Failed to enable wof stream read ahead [{}]", ec);
+        }
+    }
+
+    if (cacheFileId && WofChunkCache::Instance().IsEnabled())
+    {
+        wofStream->SetChunkCache(WofChunkCache::Instance(), *cacheFileId);
+    }
+
     return wofStream;
 }
 
@@ -57,6 +79,8 @@ CreateWofStream(const std::shared_ptr<ByteStream>& rawStream, WofAlgorithm algor
 
 namespace Orc {
 
+std::atomic<DWORD> UncompressWofStream::s_dwReadAhead = 0L;
+
 UncompressWofStream::UncompressWofStream()
     : ChainingStream()
     , m_buffer()
@@ -110,7 +134,8 @@ HRESULT UncompressWofStream::Open(const std::shared_ptr<ByteStream>& pChained)
 HRESULT UncompressWofStream::Open(
     const std::shared_ptr<ByteStream>& rawStream,
     WofAlgorithm algorithm,
-    uint64_t uncompressedSize)
+    uint64_t uncompressedSize,
+    std::optional<uint64_t> cacheFileId)
 {
     HRESULT hr = Open(rawStream);
     if (FAILED(hr))
@@ -118,7 +143,7 @@ HRESULT UncompressWofStream::Open(
         return hr;
     }
 
-    m_wofStream = CreateWofStream(rawStream, algorithm, uncompressedSize);
+    m_wofStream = CreateWofStream(rawStream, algorithm, uncompressedSize, cacheFileId);
     if (!m_wofStream)
     {
         return E_FAIL;
@@ -127,6 +152,7 @@ HRESULT UncompressWofStream::Open(
     m_rawStream = rawStream;
     m_algorithm = algorithm;
     m_uncompressedSize = uncompressedSize;
+    m_cacheFileId = cacheFileId;
     return S_OK;
 }
 
@@ -143,7 +169,7 @@ HRESULT UncompressWofStream::Read_(
 
     if (!m_wofStream)
     {
-        m_wofStream = CreateWofStream(m_rawStream, m_algorithm, m_uncompressedSize);
+        m_wofStream = CreateWofStream(m_rawStream, m_algorithm, m_uncompressedSize, m_cacheFileId);
         if (!m_wofStream)
         {
             return E_FAIL;
@@ -189,7 +215,7 @@ HRESULT UncompressWofStream::SetFilePointer(
 
     if (!m_wofStream)
     {
-        m_wofStream = CreateWofStream(m_rawStream, m_algorithm, m_uncompressedSize);
+        m_wofStream = CreateWofStream(m_rawStream, m_algorithm, m_uncompressedSize, m_cacheFileId);
         if (!m_wofStream)
         {
             return E_FAIL;
@@ -12,6 +12,9 @@
 
 #include "ChainingStream.h"
 
+#include <atomic>
+#include <optional>
+
 #include <boost/logic/tribool.hpp>
 
 #include "Stream/BufferStreamConcept.h"
@@ -48,8 +51,12 @@ public:
     //
     STDMETHOD(Open)(const std::shared_ptr<ByteStream>& pChainedStream);
 
+    // 'cacheFileId' (from WofChunkCache::GetFileId) shares the decompressed chunks through WofChunkCache
     STDMETHOD(Open)
-    (const std::shared_ptr<ByteStream>& rawStream, Ntfs::WofAlgorithm algorithm, uint64_t uncompressedSize);
+    (const std::shared_ptr<ByteStream>& rawStream,
+     Ntfs::WofAlgorithm algorithm,
+     uint64_t uncompressedSize,
+     std::optional<uint64_t> cacheFileId = std::nullopt);
 
     STDMETHOD(Read_)
     (__out_bcount_part(cbBytes, *pcbBytesRead) PVOID pReadBuffer,
@@ -71,12 +78,19 @@ public:
 
     HRESULT ShrinkContext();
 
+    // Number of chunks decompressed ahead on the thread pool by the streams opened afterwards (0: synchronous)
+    static void SetReadAhead(DWORD dwChunks) { s_dwReadAhead = dwChunks; }
+    static DWORD ReadAhead() { return s_dwReadAhead; }
+
 private:
+    static std::atomic<DWORD> s_dwReadAhead;
+
     BufferStreamConcept<std::vector<uint8_t>> m_buffer;
     std::unique_ptr<WofStreamT> m_wofStream;
     std::shared_ptr<ByteStream> m_rawStream;
     Ntfs::WofAlgorithm m_algorithm;
     uint64_t m_uncompressedSize;
+    std::optional<uint64_t> m_cacheFileId;
 };
 
 }  // namespace Orc
@@ -10,89 +10,200 @@
 
 #include "Unicode.h"
 
-#include <sstream>
+#include "SimdDispatch.h"
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_UNICODE_SIMD
+#endif
 
 using namespace std;
 
 using namespace Orc;
 
-bool Orc::IsUnicodeValid(const IsUnicodeValidTable table[], WCHAR wCode)
+namespace {
+
+// Count of leading code units of 'p' in 'ranges', whole blocks only
+using FastRunFn = size_t (*)(const IsUnicodeValidTable::Range* ranges, size_t count, const WCHAR* p, size_t cch);
+
+#ifdef ORC_UNICODE_SIMD
+
+template <bool bAVX2>
+constexpr size_t kBlockSize = bAVX2 ? 16 : 8;
+
+template <bool bAVX2>
+constexpr uint32_t kBlockMask = bAVX2 ? 0xFFFFFFFF : 0x0000FFFF;
+
+// 'c' is in [First, Last] when the saturated substraction of (Last - First) from (c - First) gives zero
+template <bool bAVX2>
+uint32_t InRangesMask(const IsUnicodeValidTable::Range* ranges, size_t count, const WCHAR* p)
 {
-    return table[wCode].bIsValid;
+    if constexpr (bAVX2)
+    {
+        const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto inRanges = _mm256_setzero_si256();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto offset = _mm256_sub_epi16(chars, _mm256_set1_epi16(static_cast<short>(ranges[i].First)));
+            const auto span = _mm256_set1_epi16(static_cast<short>(ranges[i].Last - ranges[i].First));
+            inRanges = _mm256_or_si256(
+                inRanges, _mm256_cmpeq_epi16(_mm256_subs_epu16(offset, span), _mm256_setzero_si256()));
+        }
+
+        return static_cast<uint32_t>(_mm256_movemask_epi8(inRanges));
+    }
+    else
+    {
+        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto inRanges = _mm_setzero_si128();
+        for (size_t i = 0; i < count; ++i)
+        {
+            const auto offset = _mm_sub_epi16(chars, _mm_set1_epi16(static_cast<short>(ranges[i].First)));
+            const auto span = _mm_set1_epi16(static_cast<short>(ranges[i].Last - ranges[i].First));
+            inRanges = _mm_or_si128(inRanges, _mm_cmpeq_epi16(_mm_subs_epu16(offset, span), _mm_setzero_si128()));
+        }
+
+        return static_cast<uint32_t>(_mm_movemask_epi8(inRanges));
+    }
 }
 
-bool Orc::IsUnicodeStringValid(const IsUnicodeValidTable table[], LPCWSTR szString, size_t dwLen)
+template <bool bAVX2>
+size_t FastRunSimd(const IsUnicodeValidTable::Range* ranges, size_t count, const WCHAR* p, size_t cch)
 {
-    const WCHAR* pCur = szString;
-    size_t CurIndex = 0L;
-    while (pCur && CurIndex < dwLen)
+    size_t i = 0;
+    for (; i + kBlockSize<bAVX2> <= cch; i += kBlockSize<bAVX2>)
     {
-        if (!table[*pCur].bIsValid)
-            return false;
-        pCur++;
-        CurIndex++;
+        if (const auto others = ~InRangesMask<bAVX2>(ranges, count, p + i) & kBlockMask<bAVX2>)
+        {
+            // Two mask bits per code unit
+            unsigned long index = 0;
+            _BitScanForward(&index, others);
+            return i + index / 2;
+        }
     }
-    return true;
+
+    return i;
 }
 
-HRESULT Orc::ReplaceInvalidChars(
-    const IsUnicodeValidTable table[],
-    LPCWSTR szString,
-    size_t dwLen,
-    std::wstring& dst,
-    const WCHAR cReplacement)
+#endif  // ORC_UNICODE_SIMD
+
+// Without SIMD, every code unit is looked up in the bit set
+FastRunFn FastRunKernel()
 {
-    const WCHAR* pCur = szString;
-    size_t CurIndex = 0L;
+    static const SimdDispatch::Kernel<FastRunFn> kernel(
+        L"unicode_fast_run",
+        {
+#ifdef ORC_UNICODE_SIMD
+            {SimdDispatch::Level::AVX2, FastRunSimd<true>},
+            {SimdDispatch::Level::SSE2, FastRunSimd<false>},
+#endif
+            {SimdDispatch::Level::Scalar, nullptr}});
 
-    wstringstream stream(ios_base::out);
+    return kernel.Get();
+}
 
-    stream << hex << uppercase;
+}  // namespace
 
-    while (pCur && CurIndex < dwLen)
+Orc::IsUnicodeValidTable::IsUnicodeValidTable(const Range* pRanges, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
     {
-        if (!table[*pCur].bIsValid)
+        for (uint32_t c = pRanges[i].First; c <= pRanges[i].Last; ++c)
         {
-            stream << cReplacement;
+            m_bits[c / 64] |= 1ULL << (c % 64);
         }
-        else
+    }
+
+    m_fastRangeCount = std::min(count, kMaxFastRanges);
+    std::copy_n(pRanges, m_fastRangeCount, m_fastRanges);
+}
+
+size_t Orc::IsUnicodeValidTable::FindInvalid(std::wstring_view text) const
+{
+    const auto fastRun = FastRunKernel();
+    const auto p = text.data();
+    const auto cch = text.size();
+
+    size_t i = 0;
+    while (i < cch)
+    {
+        if (fastRun)
         {
-            stream << *pCur;
+            i += fastRun(m_fastRanges, m_fastRangeCount, p + i, cch - i);
+            if (i == cch)
+                break;
         }
-        pCur++;
-        CurIndex++;
+
+        if (!IsValid(p[i]))
+            return i;
+
+        i++;
     }
 
-    dst = std::move(stream.str());
-    return S_OK;
+    return cch;
 }
 
-HRESULT Orc::SanitizeString(const IsUnicodeValidTable table[], LPCWSTR szString, size_t dwLen, std::wstring& dst)
+bool Orc::IsUnicodeStringValid(const IsUnicodeValidTable& table, LPCWSTR szString, size_t dwLen)
 {
-    const WCHAR* pCur = szString;
-    size_t CurIndex = 0L;
+    if (szString == nullptr)
+        return true;
 
-    wstringstream stream(ios_base::out);
+    return table.FindInvalid(std::wstring_view(szString, dwLen)) == dwLen;
+}
 
-    stream << hex << uppercase;
+HRESULT Orc::ReplaceInvalidChars(
+    const IsUnicodeValidTable& table,
+    LPCWSTR szString,
+    size_t dwLen,
+    std::wstring& dst,
+    const WCHAR cReplacement)
+{
+    std::wstring result;
 
-    while (pCur && CurIndex < dwLen)
+    if (szString)
     {
-        if (!table[*pCur].bIsValid)
+        std::wstring_view text(szString, dwLen);
+        result.reserve(dwLen);
+
+        for (;;)
         {
-            stream << L"#x";
-            stream.width(4);
-            stream.fill(L'0');
-            stream << (unsigned short)*pCur << ";";
+            const auto valid = table.FindInvalid(text);
+            result.append(text.substr(0, valid));
+
+            if (valid == text.size())
+                break;
+
+            result.push_back(cReplacement);
+            text.remove_prefix(valid + 1);
         }
-        else
+    }
+
+    dst = std::move(result);
+    return S_OK;
+}
+
+HRESULT Orc::SanitizeString(const IsUnicodeValidTable& table, LPCWSTR szString, size_t dwLen, std::wstring& dst)
+{
+    std::wstring result;
+
+    if (szString)
+    {
+        std::wstring_view text(szString, dwLen);
+        result.reserve(dwLen);
+
+        for (;;)
         {
-            stream << *pCur;
+            const auto valid = table.FindInvalid(text);
+            result.append(text.substr(0, valid));
+
+            if (valid == text.size())
+                break;
+
+            fmt::format_to(std::back_inserter(result), L"#x{:04X};", static_cast<unsigned short>(text[valid]));
+            text.remove_prefix(valid + 1);
         }
-        pCur++;
-        CurIndex++;
     }
 
-    dst = std::move(stream.str());
+    dst = std::move(result);
     return S_OK;
 }
@@ -7,38 +7,80 @@
 //
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <string_view>
+
 #pragma managed(push, off)
 
 namespace Orc {
 
-struct IsUnicodeValidTable
+//
+// IsUnicodeValidTable: UTF-16 code units allowed in a given context of an XML document.
+//
+// Tables are defined by their sorted ranges of allowed code units and stored as a bit set (8 KiB each). Strings are
+// checked 8 (SSE2) or 16 (AVX2) code units at a time against the first kMaxFastRanges ranges, which hold ASCII and
+// most text, the bit set is only looked up for the code units outside of them.
+//
+class IsUnicodeValidTable
 {
-    bool bIsValid;
+public:
+    struct Range
+    {
+        WCHAR First;
+        WCHAR Last;
+    };
+
+    static constexpr size_t kMaxFastRanges = 8;
+
+    IsUnicodeValidTable(const Range* pRanges, size_t count);
+
+    template <size_t N>
+    IsUnicodeValidTable(const Range (&ranges)[N])
+        : IsUnicodeValidTable(ranges, N)
+    {
+    }
+
+    IsUnicodeValidTable(const IsUnicodeValidTable&) = delete;
+    IsUnicodeValidTable& operator=(const IsUnicodeValidTable&) = delete;
+
+    bool IsValid(WCHAR wCode) const { return (m_bits[wCode / 64] >> (wCode % 64)) & 1; }
+
+    // Index of the first code unit of 'text' which is not allowed, text.size() if there is none
+    size_t FindInvalid(std::wstring_view text) const;
+
+private:
+    uint64_t m_bits[65536 / 64] = {};
+    Range m_fastRanges[kMaxFastRanges] = {};
+    size_t m_fastRangeCount = 0;
 };
 
-extern const IsUnicodeValidTable xml_element_table[65536];
-extern const IsUnicodeValidTable xml_attr_value_table[65536];
-extern const IsUnicodeValidTable xml_string_table[65536];
-extern const IsUnicodeValidTable xml_comment_table[65536];
+extern const IsUnicodeValidTable xml_element_table;
+extern const IsUnicodeValidTable xml_attr_value_table;
+extern const IsUnicodeValidTable xml_string_table;
+extern const IsUnicodeValidTable xml_comment_table;
 
-bool IsUnicodeValid(const IsUnicodeValidTable table[], WCHAR wCode);
+inline bool IsUnicodeValid(const IsUnicodeValidTable& table, WCHAR wCode)
+{
+    return table.IsValid(wCode);
+}
 
-bool IsUnicodeStringValid(const IsUnicodeValidTable table[], LPCWSTR szString, size_t dwLen);
+bool IsUnicodeStringValid(const IsUnicodeValidTable& table, LPCWSTR szString, size_t dwLen);
 
-inline bool IsUnicodeStringValid(IsUnicodeValidTable table[], const std::wstring& str)
+inline bool IsUnicodeStringValid(const IsUnicodeValidTable& table, const std::wstring& str)
 {
     return IsUnicodeStringValid(table, str.c_str(), str.size());
 }
 
 HRESULT ReplaceInvalidChars(
-    const IsUnicodeValidTable table[],
+    const IsUnicodeValidTable& table,
     LPCWSTR szString,
     size_t dwLen,
     std::wstring& dst,
     const WCHAR cReplacement = L'_');
 
 inline HRESULT ReplaceInvalidChars(
-    const IsUnicodeValidTable table[],
+    const IsUnicodeValidTable& table,
     LPCWSTR szString,
     std::wstring& dst,
     const WCHAR cReplacement = L'_')
@@ -47,7 +89,7 @@ inline HRESULT ReplaceInvalidChars(
 }
 
 inline HRESULT ReplaceInvalidChars(
-    const IsUnicodeValidTable table[],
+    const IsUnicodeValidTable& table,
     std::wstring_view sv,
     std::wstring& dst,
     const WCHAR cReplacement = L'_')
@@ -56,7 +98,7 @@ inline HRESULT ReplaceInvalidChars(
 }
 
 inline HRESULT ReplaceInvalidChars(
-    IsUnicodeValidTable table[],
+    const IsUnicodeValidTable& table,
     const std::wstring& str,
     std::wstring& dst,
     const WCHAR cReplacement = L'_')
@@ -64,17 +106,17 @@ inline HRESULT ReplaceInvalidChars(
     return ReplaceInvalidChars(table, str.c_str(), str.size(), dst, cReplacement);
 }
 
-HRESULT SanitizeString(const IsUnicodeValidTable table[], LPCWSTR szString, size_t dwLen, std::wstring& dst);
+HRESULT SanitizeString(const IsUnicodeValidTable& table, LPCWSTR szString, size_t dwLen, std::wstring& dst);
 
-inline HRESULT SanitizeString(const IsUnicodeValidTable table[], LPCWSTR szString, std::wstring& dst)
+inline HRESULT SanitizeString(const IsUnicodeValidTable& table, LPCWSTR szString, std::wstring& dst)
 {
     return SanitizeString(table, szString, wcslen(szString), dst);
 }
-inline HRESULT SanitizeString(const IsUnicodeValidTable table[], const std::wstring& str, std::wstring& dst)
+inline HRESULT SanitizeString(const IsUnicodeValidTable& table, const std::wstring& str, std::wstring& dst)
 {
     return SanitizeString(table, str.c_str(), (DWORD)str.size(), dst);
 }
-inline HRESULT SanitizeString(const IsUnicodeValidTable table[], std::wstring_view str, std::wstring& dst)
+inline HRESULT SanitizeString(const IsUnicodeValidTable& table, std::wstring_view str, std::wstring& dst)
 {
     return SanitizeString(table, str.data(), (DWORD)str.size(), dst);
 }
@@ -11,6 +11,17 @@
 
 #include "Robustness.h"
 
+#include "CryptoHashStream.h"
+#include "FileStream.h"
+#include "Text/Iconv.h"
+#include "Trace.h"
+#include "Utils/Guard.h"
+
+#include <filesystem>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
 using namespace Orc;
 
 void UploadAgent::run()
@@ -30,7 +41,19 @@ void UploadAgent::run()
 
                 UploadNotification::Notification notification;
 
-                hr = UploadFile(request->LocalName(), request->RemoteName(), request->GetDeleteWhenDone(), request);
+                std::error_code ec;
+                const auto ullFileSize = std::filesystem::file_size(request->LocalName(), ec);
+
+                if (!ec && m_config.PartSize && ullFileSize > *m_config.PartSize)
+                {
+                    hr = UploadParts(
+                        request->LocalName(), request->RemoteName(), request->GetDeleteWhenDone(), request);
+                }
+                else
+                {
+                    hr = UploadFile(request->LocalName(), request->RemoteName(), request->GetDeleteWhenDone(), request);
+                }
+
                 if (FAILED(hr))
                 {
                     notification = UploadNotification::MakeFailureNotification(
@@ -46,9 +69,9 @@ void UploadAgent::run()
                     notification = UploadNotification::MakeSuccessNotification(
                         request, UploadNotification::FileAddition, request->LocalName(), request->RemoteName());
 
-                    if (notification)
+                    if (notification && !ec)
                     {
-                        notification->SetFileSize(request->LocalName());
+                        notification->SetFileSize(ullFileSize);
                     }
                 }
 
@@ -252,6 +275,151 @@ void UploadAgent::run()
     return;
 }
 
+HRESULT UploadAgent::UploadParts(
+    const std::wstring& strLocalName,
+    const std::wstring& strRemoteName,
+    bool bDeleteWhenCopied,
+    const std::shared_ptr<const UploadMessage>& request)
+{
+    HRESULT hr = E_FAIL;
+
+    const ULONGLONG ullPartSize = *m_config.PartSize;
+
+    auto input = std::make_shared<FileStream>();
+    if (FAILED(hr = input->ReadFrom(strLocalName.c_str())))
+    {
+        Log::Error(L"Failed to open '{}' to upload it in parts [{}]", strLocalName, SystemError(hr));
+        return hr;
+    }
+
+    const ULONGLONG ullSize = input->GetSize();
+    const ULONGLONG ullParts = (ullSize + ullPartSize - 1) / ullPartSize;
+
+    std::wstring manifest = L"Part,Size,SHA256\r\n";
+    std::vector<BYTE> buffer(static_cast<size_t>(std::min(ullPartSize, 1024ULL * 1024ULL)));
+
+    for (ULONGLONG ullPart = 0; ullPart < ullParts; ullPart++)
+    {
+        const auto strPartName = fmt::format(L"{}.part{:04}", strRemoteName, ullPart);
+        const auto strLocalPart = fmt::format(L"{}.part{:04}", strLocalName, ullPart);
+        const ULONGLONG ullPartBytes = std::min(ullPartSize, ullSize - ullPart * ullPartSize);
+
+        const auto activity = Trace::UploadPartStart(strPartName, ullPart, ullPartBytes);
+        auto activityGuard = Guard::CreateScopeGuard([&activity, &hr]() { Trace::UploadPartStop(activity, hr); });
+
+        // A part of the expected size uploaded by an interrupted run is only hashed for the manifest
+        std::optional<DWORD> remoteSize;
+        const bool bUploaded = CheckFileUpload(strPartName, remoteSize) == S_OK && remoteSize
+            && static_cast<ULONGLONG>(*remoteSize) == ullPartBytes;
+
+        std::shared_ptr<FileStream> output;
+        if (!bUploaded)
+        {
+            output = std::make_shared<FileStream>();
+            if (FAILED(hr = output->WriteTo(strLocalPart.c_str())))
+            {
+                Log::Error(L"Failed to create upload part '{}' [{}]", strLocalPart, SystemError(hr));
+                return hr;
+            }
+        }
+
+        auto hashstream = std::make_shared<CryptoHashStream>();
+        if (FAILED(hr = hashstream->OpenToWrite(CryptoHashStream::Algorithm::SHA256, output)))
+        {
+            return hr;
+        }
+
+        ULONGLONG ullRemaining = ullPartBytes;
+        while (ullRemaining > 0)
+        {
+            ULONGLONG ullRead = 0LL;
+            if (FAILED(hr = input->Read(buffer.data(), std::min<ULONGLONG>(buffer.size(), ullRemaining), &ullRead)))
+            {
+                Log::Error(L"Failed to read '{}' for upload part {} [{}]", strLocalName, ullPart, SystemError(hr));
+                return hr;
+            }
+
+            if (ullRead == 0)
+            {
+                Log::Error(L"Unexpected end of '{}' for upload part {}", strLocalName, ullPart);
+                return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+            }
+
+            ULONGLONG ullWritten = 0LL;
+            if (FAILED(hr = hashstream->Write(buffer.data(), ullRead, &ullWritten)))
+            {
+                Log::Error(L"Failed to write upload part '{}' [{}]", strLocalPart, SystemError(hr));
+                return hr;
+            }
+
+            ullRemaining -= ullRead;
+        }
+
+        std::wstring strHash;
+        if (FAILED(hr = hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, strHash)))
+        {
+            return hr;
+        }
+
+        manifest += fmt::format(L"{},{},{}\r\n", strPartName, ullPartBytes, strHash);
+
+        if (bUploaded)
+        {
+            Log::Debug(L"Upload part '{}' is already uploaded", strPartName);
+            continue;
+        }
+
+        hashstream->Close();
+        output->Close();
+
+        // Parts are temporary copies: always deleted once uploaded
+        if (FAILED(hr = UploadFile(strLocalPart, strPartName, true, request)))
+        {
+            Log::Error(L"Failed to upload part '{}' [{}]", strLocalPart, SystemError(hr));
+            return hr;
+        }
+    }
+
+    input->Close();
+
+    const auto strLocalManifest = strLocalName + L".parts";
+    const auto strRemoteManifest = strRemoteName + L".parts";
+    {
+        const auto utf8 = ToUtf8(manifest);
+
+        FileStream stream;
+        if (FAILED(hr = stream.WriteTo(strLocalManifest.c_str())))
+        {
+            Log::Error(L"Failed to create upload manifest '{}' [{}]", strLocalManifest, SystemError(hr));
+            return hr;
+        }
+
+        ULONGLONG ullWritten = 0LL;
+        if (FAILED(hr = stream.Write((const PVOID)utf8.data(), utf8.size(), &ullWritten)))
+        {
+            Log::Error(L"Failed to write upload manifest '{}' [{}]", strLocalManifest, SystemError(hr));
+            return hr;
+        }
+
+        stream.Close();
+    }
+
+    if (FAILED(hr = UploadFile(strLocalManifest, strRemoteManifest, true, request)))
+    {
+        Log::Error(L"Failed to upload manifest '{}' [{}]", strLocalManifest, SystemError(hr));
+        return hr;
+    }
+
+    if (bDeleteWhenCopied && !DeleteFile(strLocalName.c_str()))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Warn(L"Failed to delete '{}' after splitting it in upload parts [{}]", strLocalName, SystemError(hr));
+    }
+
+    Log::Info(L"Uploading '{}' in {} parts of {} bytes", strRemoteName, ullParts, ullPartSize);
+    return S_OK;
+}
+
 #include "CopyFileAgent.h"
 #include "BITSAgent.h"
 
@@ -83,6 +83,15 @@ protected:
         bool bDeleteWhenCopied,
         const std::shared_ptr<const UploadMessage>& request) PURE;
 
+    // Split 'strLocalName' in parts of 'PartSize' bytes hashed while written, each part is uploaded as soon as written.
+    // A manifest '<remote>.parts' lists the parts with their SHA256 for the receiver to check and concatenate them.
+    // Parts already uploaded with the expected size are not uploaded again.
+    HRESULT UploadParts(
+        const std::wstring& strLocalName,
+        const std::wstring& strRemoteName,
+        bool bDeleteWhenCopied,
+        const std::shared_ptr<const UploadMessage>& request);
+
     virtual HRESULT IsComplete(bool bReadyToExit, bool& hasFailure) PURE;
 
     virtual HRESULT Cancel() PURE;
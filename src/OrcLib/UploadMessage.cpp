@@ -82,6 +82,14 @@ UploadMessage::Message UploadMessage::MakeCompleteRequest()
     return message;
 }
 
+ULONGLONG UploadMessage::Weigh(const Message& message)
+{
+    if (message == nullptr || message->GetStream() == nullptr)
+        return 0LL;
+
+    return message->GetStream()->GetSize();
+}
+
 UploadMessage::Message UploadMessage::MakeCancellationRequest()
 {
     auto message = std::make_shared<::UploadMessageT>(UploadMessage::Cancel);
@@ -15,6 +15,7 @@
 
 #include "Archive.h"
 #include "BoundedBuffer.h"
+#include "BoundedMessageBuffer.h"
 #include "ByteStream.h"
 
 #pragma managed(push, off)
@@ -51,6 +52,10 @@ public:
     using ITarget = Concurrency::ITarget<Message>;
     using ISource = Concurrency::ISource<Message>;
 
+    // Messages weigh the size of their stream: the buffer caps the streams waiting for the upload agent
+    using BoundedMessageBuffer = Orc::BoundedMessageBuffer<Message>;
+    static ULONGLONG Weigh(const Message& message);
+
 public:
     static Message MakeUploadFileRequest(
         const std::wstring& szRemoteName,
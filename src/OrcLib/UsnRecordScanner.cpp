@@ -0,0 +1,251 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "UsnRecordScanner.h"
+
+#include "SimdDispatch.h"
+
+#include <algorithm>
+
+#if defined(_M_IX86) || defined(_M_X64)
+#    include <immintrin.h>
+#    define ORC_USN_SIMD
+#endif
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kBlockSize = 64;
+constexpr size_t kSlotsPerBlock = kBlockSize / UsnRecordScanner::kAlignment;
+
+constexpr DWORD kVersion2 = 0x00000002;  // MajorVersion 2, MinorVersion 0
+constexpr DWORD kVersion3 = 0x00000003;
+
+// 2000-01-01 00:00:00
+constexpr LONGLONG kMinTimeStamp = 0x01BF53EB256D4000LL;
+constexpr LONGLONG kOneDay = 24LL * 60 * 60 * 10000000;
+
+// Offsets of the fields validated, in USN_RECORD_V2 and USN_RECORD_V3
+struct Layout
+{
+    size_t TimeStamp;
+    size_t Reason;
+    size_t FileNameLength;
+    size_t FileNameOffset;
+    WORD HeaderSize;
+};
+
+constexpr Layout kLayoutV2 = {0x20, 0x28, 0x38, 0x3A, 0x3C};
+constexpr Layout kLayoutV3 = {0x30, 0x38, 0x48, 0x4A, 0x4C};
+
+template <typename T>
+T Load(const BYTE* pData)
+{
+    T value;
+    memcpy(&value, pData, sizeof(T));
+    return value;
+}
+
+// Bit i is set when slot i (8 bytes) of a 64 bytes block holds a record version
+using CandidateFn = uint32_t (*)(const BYTE* p);
+
+uint32_t CandidatesScalar(const BYTE* p)
+{
+    uint32_t mask = 0L;
+    for (size_t i = 0; i < kSlotsPerBlock; i++)
+    {
+        const auto dwVersion = Load<DWORD>(p + i * UsnRecordScanner::kAlignment + sizeof(DWORD));
+        if (dwVersion == kVersion2 || dwVersion == kVersion3)
+            mask |= 1 << i;
+    }
+    return mask;
+}
+
+#ifdef ORC_USN_SIMD
+
+template <bool bAVX2>
+uint32_t CandidatesSimd(const BYTE* p)
+{
+    // The version is the second dword of a slot: keep the odd bits of the dword masks
+    if constexpr (bAVX2)
+    {
+        const auto v2 = _mm256_set1_epi32(kVersion2);
+        const auto v3 = _mm256_set1_epi32(kVersion3);
+
+        uint32_t mask = 0L;
+        for (size_t i = 0; i < 2; i++)
+        {
+            const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i * 32));
+            const auto match = _mm256_or_si256(_mm256_cmpeq_epi32(bytes, v2), _mm256_cmpeq_epi32(bytes, v3));
+            const auto dwords = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(match)));
+            const auto slots =
+                ((dwords >> 1) & 0x1) | ((dwords >> 2) & 0x2) | ((dwords >> 3) & 0x4) | ((dwords >> 4) & 0x8);
+            mask |= slots << (i * 4);
+        }
+        return mask;
+    }
+    else
+    {
+        const auto v2 = _mm_set1_epi32(kVersion2);
+        const auto v3 = _mm_set1_epi32(kVersion3);
+
+        uint32_t mask = 0L;
+        for (size_t i = 0; i < 4; i++)
+        {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+            const auto match = _mm_or_si128(_mm_cmpeq_epi32(bytes, v2), _mm_cmpeq_epi32(bytes, v3));
+            const auto dwords = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(match)));
+            mask |= (((dwords >> 1) & 0x1) | ((dwords >> 2) & 0x2)) << (i * 2);
+        }
+        return mask;
+    }
+}
+
+#endif  // ORC_USN_SIMD
+
+CandidateFn Kernel()
+{
+    static const SimdDispatch::Kernel<CandidateFn> kernel(
+        L"usn_record_scan",
+        {
+#ifdef ORC_USN_SIMD
+            {SimdDispatch::Level::AVX2, CandidatesSimd<true>},
+            {SimdDispatch::Level::SSE2, CandidatesSimd<false>},
+#endif
+            {SimdDispatch::Level::Scalar, CandidatesScalar}});
+
+    return kernel.Get();
+}
+
+inline size_t FirstBit(uint32_t mask)
+{
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return index;
+}
+
+}  // namespace
+
+UsnRecordScanner::UsnRecordScanner()
+    : m_llMinTimeStamp(kMinTimeStamp)
+{
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    m_llMaxTimeStamp = ((static_cast<LONGLONG>(now.dwHighDateTime) << 32) | now.dwLowDateTime) + kOneDay;
+}
+
+UsnRecordScanner::UsnRecordScanner(LONGLONG llMinTimeStamp, LONGLONG llMaxTimeStamp)
+    : m_llMinTimeStamp(llMinTimeStamp)
+    , m_llMaxTimeStamp(llMaxTimeStamp)
+{
+}
+
+size_t UsnRecordScanner::ZeroPrefix(const BYTE* pData, size_t cbData)
+{
+    size_t offset = 0;
+
+#ifdef ORC_USN_SIMD
+    static const bool bSSE2 = SimdDispatch::Supported() >= SimdDispatch::Level::SSE2;
+    if (bSSE2)
+    {
+        const auto zero = _mm_setzero_si128();
+        for (; offset + 16 <= cbData; offset += 16)
+        {
+            const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pData + offset));
+            const auto zeros = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)));
+            if (zeros != 0xFFFF)
+                return offset + FirstBit(~zeros);
+        }
+    }
+#endif
+
+    while (offset < cbData && pData[offset] == 0)
+        ++offset;
+
+    return offset;
+}
+
+bool UsnRecordScanner::IsValid(const BYTE* pData, size_t cbData) const
+{
+    if (cbData < kMinRecordLength)
+        return false;
+
+    const auto dwLength = Load<DWORD>(pData);
+    if (dwLength < kMinRecordLength || dwLength > kMaxRecordLength || dwLength % kAlignment || dwLength > cbData)
+        return false;
+
+    const auto dwVersion = Load<DWORD>(pData + sizeof(DWORD));
+    if (dwVersion != kVersion2 && dwVersion != kVersion3)
+        return false;
+
+    const auto& layout = dwVersion == kVersion2 ? kLayoutV2 : kLayoutV3;
+
+    const auto wNameOffset = Load<WORD>(pData + layout.FileNameOffset);
+    const auto wNameLength = Load<WORD>(pData + layout.FileNameLength);
+    if (wNameOffset != layout.HeaderSize || wNameLength == 0 || wNameLength % sizeof(WCHAR))
+        return false;
+
+    // The record is its header and name, padded to the alignment
+    if (((wNameOffset + wNameLength + kAlignment - 1) & ~(kAlignment - 1)) != dwLength)
+        return false;
+
+    if (Load<DWORD>(pData + layout.Reason) == 0)
+        return false;
+
+    const auto llTimeStamp = Load<LONGLONG>(pData + layout.TimeStamp);
+    return llTimeStamp >= m_llMinTimeStamp && llTimeStamp <= m_llMaxTimeStamp;
+}
+
+void UsnRecordScanner::Scan(const BYTE* pData, size_t cbData, std::vector<size_t>& offsets, size_t cbScan) const
+{
+    cbScan = std::min(cbScan, cbData);
+
+    const auto kernel = Kernel();
+
+    std::vector<size_t> candidates;
+    candidates.reserve(kBatchSize + kSlotsPerBlock);
+
+    // Candidates inside a record found valid are not records
+    size_t next = 0;
+    const auto validate = [&]() {
+        for (const auto candidate : candidates)
+        {
+            if (candidate < next || !IsValid(pData + candidate, cbData - candidate))
+                continue;
+
+            offsets.push_back(candidate);
+            next = candidate + Load<DWORD>(pData + candidate);
+        }
+        candidates.clear();
+    };
+
+    size_t offset = 0;
+    for (; offset + kBlockSize <= cbData && offset < cbScan; offset += kBlockSize)
+    {
+        for (auto mask = kernel(pData + offset); mask != 0; mask &= mask - 1)
+        {
+            const auto candidate = offset + FirstBit(mask) * kAlignment;
+            if (candidate < cbScan)
+                candidates.push_back(candidate);
+        }
+
+        if (candidates.size() >= kBatchSize)
+            validate();
+    }
+
+    for (; offset + kAlignment <= cbData && offset < cbScan; offset += kAlignment)
+    {
+        const auto dwVersion = Load<DWORD>(pData + offset + sizeof(DWORD));
+        if (dwVersion == kVersion2 || dwVersion == kVersion3)
+            candidates.push_back(offset);
+    }
+
+    validate();
+}
@@ -0,0 +1,62 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <limits>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+//
+// UsnRecordScanner: finds USN_RECORD_V2 and USN_RECORD_V3 headers in raw data (sparse parts of $J, unallocated
+// clusters).
+//
+// Records are 8 bytes aligned: each 64 bytes block is compared at once (AVX2 or SSE2) for the version of its 8 slots
+// (MajorVersion 2 or 3, MinorVersion 0), zeroed blocks yield no candidate and cost a compare. Candidates are collected
+// in batches then validated: record length, file name offset and length, timestamp range. A valid record is not
+// searched for further candidates.
+//
+class UsnRecordScanner
+{
+public:
+    static constexpr size_t kAlignment = 8;
+    static constexpr size_t kBatchSize = 64;
+
+    static constexpr DWORD kMinRecordLength = 0x40;  // USN_RECORD_V2 header and one character, aligned
+    static constexpr DWORD kMaxRecordLength = 0x250;  // USN_RECORD_V3 header and 255 characters, aligned
+
+    // Timestamps from 2000-01-01 to one day from now
+    UsnRecordScanner();
+    UsnRecordScanner(LONGLONG llMinTimeStamp, LONGLONG llMaxTimeStamp);
+
+    // Number of leading zero bytes of [pData, pData + cbData)
+    static size_t ZeroPrefix(const BYTE* pData, size_t cbData);
+
+    // Is there a plausible record at 'pData', 'cbData' bytes being available
+    bool IsValid(const BYTE* pData, size_t cbData) const;
+
+    // Append the offsets of the records starting in the 'cbScan' first bytes of [pData, pData + cbData), records
+    // must end in it. 'pData' must be aligned as the records are (a cluster, a journal offset)
+    void Scan(
+        const BYTE* pData,
+        size_t cbData,
+        std::vector<size_t>& offsets,
+        size_t cbScan = std::numeric_limits<size_t>::max()) const;
+
+private:
+    LONGLONG m_llMinTimeStamp;
+    LONGLONG m_llMaxTimeStamp;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
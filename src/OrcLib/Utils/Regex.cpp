@@ -0,0 +1,947 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "Regex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cwctype>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Orc::Detail {
+
+template <typename CharT>
+struct RegexProgram
+{
+    enum class Op : uint8_t
+    {
+        Char,
+        Any,
+        Class,
+        Split,
+        Jump,
+        LineBegin,
+        LineEnd,
+        WordBoundary,
+        NotWordBoundary,
+        Match
+    };
+
+    struct Instruction
+    {
+        Op op;
+        CharT c;
+        uint32_t x;
+        uint32_t y;
+    };
+
+    enum Type : uint8_t
+    {
+        Digit = 1 << 0,
+        Word = 1 << 1,
+        Space = 1 << 2
+    };
+
+    struct CharClass
+    {
+        bool bNegated = false;
+        uint8_t Types = 0;  // \d, \w, \s
+        uint8_t NegatedTypes = 0;  // \D, \W, \S
+        std::vector<std::pair<uint32_t, uint32_t>> Ranges;
+    };
+
+    std::vector<Instruction> Instructions;
+    std::vector<CharClass> Classes;
+    bool bIcase = false;
+
+    std::basic_string<CharT> Required;  // folded literal every match contains
+    bool bLiteral = false;  // the whole pattern is 'Required'
+
+    std::optional<std::basic_regex<CharT>> Fallback;
+};
+
+}  // namespace Orc::Detail
+
+using namespace Orc;
+using namespace Orc::Detail;
+
+namespace {
+
+// Same folding as std::regex_traits::translate_nocase in the "C" locale
+char Lower(char c)
+{
+    return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+wchar_t Lower(wchar_t c)
+{
+    return static_cast<wchar_t>(std::towlower(c));
+}
+char Upper(char c)
+{
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+}
+wchar_t Upper(wchar_t c)
+{
+    return static_cast<wchar_t>(std::towupper(c));
+}
+bool IsSpace(char c)
+{
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+bool IsSpace(wchar_t c)
+{
+    return std::iswspace(c) != 0;
+}
+
+template <typename CharT>
+uint32_t Unsigned(CharT c)
+{
+    return static_cast<std::make_unsigned_t<CharT>>(c);
+}
+
+template <typename CharT>
+bool IsDigit(CharT c)
+{
+    return c >= CharT('0') && c <= CharT('9');
+}
+
+template <typename CharT>
+bool IsWord(CharT c)
+{
+    return IsDigit(c) || (c >= CharT('a') && c <= CharT('z')) || (c >= CharT('A') && c <= CharT('Z'))
+        || c == CharT('_');
+}
+
+// Thrown when the pattern uses a construct the linear engine does not implement (or is invalid): the pattern is
+// then given to std::basic_regex which either supports it or reports the error.
+struct Unsupported
+{
+};
+
+constexpr uint32_t kInfinite = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t kMaxRepeat = 1000;
+constexpr size_t kMaxInstructions = 64 * 1024;
+
+template <typename CharT>
+class Compiler
+{
+    using Program = RegexProgram<CharT>;
+    using Op = typename Program::Op;
+
+    struct Node
+    {
+        enum class Kind
+        {
+            Literal,
+            Any,
+            Class,
+            Concat,
+            Alternate,
+            Repeat,
+            LineBegin,
+            LineEnd,
+            WordBoundary,
+            NotWordBoundary
+        };
+
+        Kind kind;
+        CharT c = CharT(0);
+        uint32_t cls = 0;
+        uint32_t min = 0;
+        uint32_t max = 0;
+        std::vector<Node> children;
+
+        bool IsAssertion() const
+        {
+            return kind == Kind::LineBegin || kind == Kind::LineEnd || kind == Kind::WordBoundary
+                || kind == Kind::NotWordBoundary;
+        }
+    };
+
+    using Kind = typename Node::Kind;
+
+public:
+    Compiler(std::basic_string_view<CharT> pattern, Program& program)
+        : m_Pattern(pattern)
+        , m_Program(program)
+    {
+    }
+
+    void Compile()
+    {
+        auto root = ParseAlternate();
+        if (m_Pos != m_Pattern.size())
+            throw Unsupported();
+
+        Emit(root);
+        Push({Op::Match, CharT(0), 0, 0});
+
+        std::basic_string<CharT> run;
+        CollectRequired(root, run, m_Program.Required);
+        Flush(run, m_Program.Required);
+
+        m_Program.bLiteral = IsLiteral(root);
+    }
+
+private:
+    bool AtEnd() const { return m_Pos >= m_Pattern.size(); }
+    CharT Peek(size_t offset = 0) const
+    {
+        if (m_Pos + offset >= m_Pattern.size())
+            throw Unsupported();
+        return m_Pattern[m_Pos + offset];
+    }
+    CharT Next()
+    {
+        auto c = Peek();
+        m_Pos++;
+        return c;
+    }
+    bool Accept(CharT c)
+    {
+        if (!AtEnd() && m_Pattern[m_Pos] == c)
+        {
+            m_Pos++;
+            return true;
+        }
+        return false;
+    }
+
+    CharT Fold(CharT c) const { return m_Program.bIcase ? Lower(c) : c; }
+
+    Node ParseAlternate()
+    {
+        auto first = ParseConcat();
+        if (AtEnd() || Peek() != CharT('|'))
+            return first;
+
+        Node alternate {Kind::Alternate};
+        alternate.children.push_back(std::move(first));
+        while (Accept(CharT('|')))
+            alternate.children.push_back(ParseConcat());
+        return alternate;
+    }
+
+    Node ParseConcat()
+    {
+        Node concat {Kind::Concat};
+        while (!AtEnd() && Peek() != CharT('|') && Peek() != CharT(')'))
+            concat.children.push_back(ParseRepeat());
+        return concat;
+    }
+
+    uint32_t ParseNumber()
+    {
+        if (AtEnd() || !IsDigit(Peek()))
+            throw Unsupported();
+
+        uint32_t value = 0;
+        while (!AtEnd() && IsDigit(Peek()))
+        {
+            value = value * 10 + (Next() - CharT('0'));
+            if (value > kMaxRepeat)
+                throw Unsupported();
+        }
+        return value;
+    }
+
+    Node ParseRepeat()
+    {
+        auto atom = ParseAtom();
+        if (AtEnd())
+            return atom;
+
+        uint32_t min = 0, max = 0;
+        switch (Peek())
+        {
+            case CharT('*'):
+                min = 0;
+                max = kInfinite;
+                break;
+            case CharT('+'):
+                min = 1;
+                max = kInfinite;
+                break;
+            case CharT('?'):
+                min = 0;
+                max = 1;
+                break;
+            case CharT('{'):
+                m_Pos++;
+                min = max = ParseNumber();
+                if (Accept(CharT(',')))
+                    max = Peek() == CharT('}') ? kInfinite : ParseNumber();
+                if (Peek() != CharT('}') || max < min)
+                    throw Unsupported();
+                break;
+            default:
+                return atom;
+        }
+        m_Pos++;
+
+        // Lazy and greedy quantifiers accept the same inputs
+        Accept(CharT('?'));
+
+        if (atom.IsAssertion())
+            throw Unsupported();
+
+        Node repeat {Kind::Repeat};
+        repeat.min = min;
+        repeat.max = max;
+        repeat.children.push_back(std::move(atom));
+        return repeat;
+    }
+
+    Node ParseAtom()
+    {
+        const auto c = Next();
+        switch (c)
+        {
+            case CharT('('): {
+                if (Accept(CharT('?')))
+                {
+                    // Only non capturing groups, no lookarounds
+                    if (!Accept(CharT(':')))
+                        throw Unsupported();
+                }
+                auto group = ParseAlternate();
+                if (!Accept(CharT(')')))
+                    throw Unsupported();
+                return group;
+            }
+            case CharT('['):
+                return ParseClass();
+            case CharT('.'):
+                return Node {Kind::Any};
+            case CharT('^'):
+                return Node {Kind::LineBegin};
+            case CharT('$'):
+                return Node {Kind::LineEnd};
+            case CharT('\\'):
+                return ParseEscape();
+            case CharT('*'):
+            case CharT('+'):
+            case CharT('?'):
+            case CharT('{'):
+            case CharT('}'):
+            case CharT(']'):
+            case CharT(')'):
+                throw Unsupported();
+            default: {
+                Node literal {Kind::Literal};
+                literal.c = Fold(c);
+                return literal;
+            }
+        }
+    }
+
+    uint32_t ParseHex(size_t digits)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < digits; i++)
+        {
+            const auto c = Next();
+            value <<= 4;
+            if (IsDigit(c))
+                value |= c - CharT('0');
+            else if (c >= CharT('a') && c <= CharT('f'))
+                value |= c - CharT('a') + 10;
+            else if (c >= CharT('A') && c <= CharT('F'))
+                value |= c - CharT('A') + 10;
+            else
+                throw Unsupported();
+        }
+
+        if (value > Unsigned(std::numeric_limits<std::make_unsigned_t<CharT>>::max()))
+            throw Unsupported();
+        return value;
+    }
+
+    // Returns a character, or sets 'type'/'negatedType' for \d \w \s and their complements
+    std::optional<CharT> ParseEscapedChar(uint8_t& type, uint8_t& negatedType, bool bInClass)
+    {
+        const auto c = Next();
+        switch (c)
+        {
+            case CharT('d'):
+                type = Program::Digit;
+                return std::nullopt;
+            case CharT('w'):
+                type = Program::Word;
+                return std::nullopt;
+            case CharT('s'):
+                type = Program::Space;
+                return std::nullopt;
+            case CharT('D'):
+                negatedType = Program::Digit;
+                return std::nullopt;
+            case CharT('W'):
+                negatedType = Program::Word;
+                return std::nullopt;
+            case CharT('S'):
+                negatedType = Program::Space;
+                return std::nullopt;
+            case CharT('t'):
+                return CharT('\t');
+            case CharT('n'):
+                return CharT('\n');
+            case CharT('r'):
+                return CharT('\r');
+            case CharT('v'):
+                return CharT('\v');
+            case CharT('f'):
+                return CharT('\f');
+            case CharT('b'):
+                if (bInClass)
+                    return CharT('\b');
+                throw Unsupported();
+            case CharT('0'):
+                if (!AtEnd() && IsDigit(Peek()))
+                    throw Unsupported();
+                return CharT(0);
+            case CharT('x'):
+                return static_cast<CharT>(ParseHex(2));
+            case CharT('u'):
+                return static_cast<CharT>(ParseHex(4));
+            default:
+                // Identity escapes of punctuation only: letters and digits are back references or unknown escapes
+                if (IsWord(c))
+                    throw Unsupported();
+                return c;
+        }
+    }
+
+    Node ParseEscape()
+    {
+        if (Accept(CharT('b')))
+            return Node {Kind::WordBoundary};
+        if (Accept(CharT('B')))
+            return Node {Kind::NotWordBoundary};
+
+        uint8_t type = 0, negatedType = 0;
+        if (auto c = ParseEscapedChar(type, negatedType, false))
+        {
+            Node literal {Kind::Literal};
+            literal.c = Fold(*c);
+            return literal;
+        }
+
+        typename Program::CharClass cls;
+        cls.Types = type;
+        cls.NegatedTypes = negatedType;
+        return AddClass(std::move(cls));
+    }
+
+    Node AddClass(typename Program::CharClass&& cls)
+    {
+        Node node {Kind::Class};
+        node.cls = static_cast<uint32_t>(m_Program.Classes.size());
+        m_Program.Classes.push_back(std::move(cls));
+        return node;
+    }
+
+    Node ParseClass()
+    {
+        typename Program::CharClass cls;
+        cls.bNegated = Accept(CharT('^'));
+
+        // Empty classes and POSIX classes are left to std::basic_regex
+        if (Peek() == CharT(']'))
+            throw Unsupported();
+
+        while (!Accept(CharT(']')))
+        {
+            if (Peek() == CharT('[')
+                && (Peek(1) == CharT(':') || Peek(1) == CharT('=') || Peek(1) == CharT('.')))
+                throw Unsupported();
+
+            uint32_t low = 0;
+            if (Accept(CharT('\\')))
+            {
+                uint8_t type = 0, negatedType = 0;
+                auto c = ParseEscapedChar(type, negatedType, true);
+                if (!c)
+                {
+                    cls.Types |= type;
+                    cls.NegatedTypes |= negatedType;
+                    continue;
+                }
+                low = Unsigned(*c);
+            }
+            else
+                low = Unsigned(Next());
+
+            uint32_t high = low;
+            if (Peek() == CharT('-') && Peek(1) != CharT(']'))
+            {
+                m_Pos++;
+                if (Accept(CharT('\\')))
+                {
+                    uint8_t type = 0, negatedType = 0;
+                    auto c = ParseEscapedChar(type, negatedType, true);
+                    if (!c)
+                        throw Unsupported();
+                    high = Unsigned(*c);
+                }
+                else
+                    high = Unsigned(Next());
+
+                if (high < low)
+                    throw Unsupported();
+            }
+
+            cls.Ranges.emplace_back(low, high);
+        }
+
+        return AddClass(std::move(cls));
+    }
+
+    uint32_t Push(typename Program::Instruction instruction)
+    {
+        if (m_Program.Instructions.size() >= kMaxInstructions)
+            throw Unsupported();
+
+        m_Program.Instructions.push_back(instruction);
+        return static_cast<uint32_t>(m_Program.Instructions.size() - 1);
+    }
+
+    uint32_t Here() const { return static_cast<uint32_t>(m_Program.Instructions.size()); }
+
+    void Emit(const Node& node)
+    {
+        auto& instructions = m_Program.Instructions;
+
+        switch (node.kind)
+        {
+            case Kind::Literal:
+                Push({Op::Char, node.c, 0, 0});
+                break;
+            case Kind::Any:
+                Push({Op::Any, CharT(0), 0, 0});
+                break;
+            case Kind::Class:
+                Push({Op::Class, CharT(0), node.cls, 0});
+                break;
+            case Kind::LineBegin:
+                Push({Op::LineBegin, CharT(0), 0, 0});
+                break;
+            case Kind::LineEnd:
+                Push({Op::LineEnd, CharT(0), 0, 0});
+                break;
+            case Kind::WordBoundary:
+                Push({Op::WordBoundary, CharT(0), 0, 0});
+                break;
+            case Kind::NotWordBoundary:
+                Push({Op::NotWordBoundary, CharT(0), 0, 0});
+                break;
+            case Kind::Concat:
+                for (const auto& child : node.children)
+                    Emit(child);
+                break;
+            case Kind::Alternate: {
+                std::vector<uint32_t> jumps;
+                for (size_t i = 0; i < node.children.size(); i++)
+                {
+                    if (i + 1 == node.children.size())
+                    {
+                        Emit(node.children[i]);
+                        break;
+                    }
+
+                    const auto split = Push({Op::Split, CharT(0), 0, 0});
+                    instructions[split].x = Here();
+                    Emit(node.children[i]);
+                    jumps.push_back(Push({Op::Jump, CharT(0), 0, 0}));
+                    instructions[split].y = Here();
+                }
+                for (const auto jump : jumps)
+                    instructions[jump].x = Here();
+                break;
+            }
+            case Kind::Repeat: {
+                const auto& child = node.children.front();
+                for (uint32_t i = 0; i < node.min; i++)
+                    Emit(child);
+
+                if (node.max == kInfinite)
+                {
+                    const auto loop = Push({Op::Split, CharT(0), 0, 0});
+                    instructions[loop].x = Here();
+                    Emit(child);
+                    Push({Op::Jump, CharT(0), loop, 0});
+                    instructions[loop].y = Here();
+                }
+                else
+                {
+                    std::vector<uint32_t> splits;
+                    for (uint32_t i = node.min; i < node.max; i++)
+                    {
+                        const auto split = Push({Op::Split, CharT(0), 0, 0});
+                        instructions[split].x = Here();
+                        splits.push_back(split);
+                        Emit(child);
+                    }
+                    for (const auto split : splits)
+                        instructions[split].y = Here();
+                }
+                break;
+            }
+        }
+    }
+
+    static void Flush(std::basic_string<CharT>& run, std::basic_string<CharT>& best)
+    {
+        if (run.size() > best.size())
+            best = run;
+        run.clear();
+    }
+
+    // Longest sequence of literals that every match must contain
+    static void CollectRequired(const Node& node, std::basic_string<CharT>& run, std::basic_string<CharT>& best)
+    {
+        switch (node.kind)
+        {
+            case Kind::Literal:
+                run.push_back(node.c);
+                break;
+            case Kind::Concat:
+                for (const auto& child : node.children)
+                    CollectRequired(child, run, best);
+                break;
+            case Kind::Repeat:
+                Flush(run, best);
+                if (node.min > 0)
+                {
+                    CollectRequired(node.children.front(), run, best);
+                    Flush(run, best);
+                }
+                break;
+            default:
+                Flush(run, best);
+                break;
+        }
+    }
+
+    static bool IsLiteral(const Node& node)
+    {
+        if (node.kind == Kind::Literal)
+            return true;
+        if (node.kind != Kind::Concat)
+            return false;
+        return std::all_of(std::cbegin(node.children), std::cend(node.children), [](const Node& child) {
+            return IsLiteral(child);
+        });
+    }
+
+    std::basic_string_view<CharT> m_Pattern;
+    size_t m_Pos = 0;
+    Program& m_Program;
+};
+
+// Per thread work lists of the VM: no allocation once they have grown to the size of the largest program
+struct RegexScratch
+{
+    std::vector<uint32_t> Marks;
+    std::vector<uint32_t> Current;
+    std::vector<uint32_t> Next;
+    std::vector<uint32_t> Stack;
+    uint32_t Generation = 0;
+
+    void Prepare(size_t instructions)
+    {
+        if (Marks.size() < instructions)
+            Marks.resize(instructions, 0);
+    }
+
+    void NewGeneration()
+    {
+        if (++Generation == 0)
+        {
+            std::fill(std::begin(Marks), std::end(Marks), 0);
+            Generation = 1;
+        }
+    }
+};
+
+template <typename CharT>
+class Machine
+{
+    using Program = RegexProgram<CharT>;
+    using Op = typename Program::Op;
+
+public:
+    Machine(const Program& program, const CharT* first, const CharT* last)
+        : m_Program(program)
+        , m_First(first)
+        , m_Length(static_cast<size_t>(last - first))
+    {
+    }
+
+    bool Run(bool bSearch)
+    {
+        const auto& required = m_Program.Required;
+        if (!required.empty() && !ContainsRequired())
+            return false;
+
+        if (m_Program.bLiteral)
+        {
+            if (bSearch)
+                return true;  // the literal was found
+
+            return m_Length == required.size()
+                && std::equal(m_First, m_First + m_Length, std::cbegin(required), [this](CharT c, CharT r) {
+                       return Fold(c) == r;
+                   });
+        }
+
+        static thread_local RegexScratch scratch;
+        auto& instructions = m_Program.Instructions;
+
+        scratch.Prepare(instructions.size());
+        scratch.Current.clear();
+        scratch.NewGeneration();
+        AddThread(scratch, scratch.Current, 0, 0);
+
+        for (size_t pos = 0;; pos++)
+        {
+            for (const auto pc : scratch.Current)
+            {
+                if (instructions[pc].op == Op::Match && (bSearch || pos == m_Length))
+                    return true;
+            }
+
+            if (pos == m_Length)
+                return false;
+
+            const auto c = m_First[pos];
+            const auto folded = Fold(c);
+
+            scratch.Next.clear();
+            scratch.NewGeneration();
+
+            for (const auto pc : scratch.Current)
+            {
+                const auto& instruction = instructions[pc];
+                bool bStep = false;
+                switch (instruction.op)
+                {
+                    case Op::Char:
+                        bStep = instruction.c == folded;
+                        break;
+                    case Op::Any:
+                        bStep = c != CharT('\n') && c != CharT('\r');
+                        break;
+                    case Op::Class:
+                        bStep = InClass(m_Program.Classes[instruction.x], c);
+                        break;
+                    default:
+                        break;
+                }
+                if (bStep)
+                    AddThread(scratch, scratch.Next, pc + 1, pos + 1);
+            }
+
+            // Searching is matching from every position, all attempts run in lockstep
+            if (bSearch)
+                AddThread(scratch, scratch.Next, 0, pos + 1);
+
+            std::swap(scratch.Current, scratch.Next);
+            if (scratch.Current.empty() && !bSearch)
+                return false;
+        }
+    }
+
+private:
+    CharT Fold(CharT c) const { return m_Program.bIcase ? Lower(c) : c; }
+
+    bool ContainsRequired() const
+    {
+        const auto& required = m_Program.Required;
+        const auto last = m_First + m_Length;
+        return std::search(
+                   m_First,
+                   last,
+                   std::cbegin(required),
+                   std::cend(required),
+                   [this](CharT c, CharT r) { return Fold(c) == r; })
+            != last;
+    }
+
+    static bool HasType(uint8_t types, CharT c)
+    {
+        return ((types & Program::Digit) && IsDigit(c)) || ((types & Program::Word) && IsWord(c))
+            || ((types & Program::Space) && IsSpace(c));
+    }
+
+    static bool HasNegatedType(uint8_t types, CharT c)
+    {
+        return ((types & Program::Digit) && !IsDigit(c)) || ((types & Program::Word) && !IsWord(c))
+            || ((types & Program::Space) && !IsSpace(c));
+    }
+
+    static bool InRanges(const typename Program::CharClass& cls, uint32_t c)
+    {
+        return std::any_of(std::cbegin(cls.Ranges), std::cend(cls.Ranges), [c](const auto& range) {
+            return c >= range.first && c <= range.second;
+        });
+    }
+
+    bool InClass(const typename Program::CharClass& cls, CharT c) const
+    {
+        bool bIn = HasType(cls.Types, c) || HasNegatedType(cls.NegatedTypes, c) || InRanges(cls, Unsigned(c));
+        if (!bIn && m_Program.bIcase)
+            bIn = InRanges(cls, Unsigned(Lower(c))) || InRanges(cls, Unsigned(Upper(c)));
+        return bIn != cls.bNegated;
+    }
+
+    bool IsWordBoundary(size_t pos) const
+    {
+        const bool bBefore = pos > 0 && IsWord(m_First[pos - 1]);
+        const bool bAfter = pos < m_Length && IsWord(m_First[pos]);
+        return bBefore != bAfter;
+    }
+
+    // Follow the epsilon transitions from 'pc' and queue the consuming instructions reached
+    void AddThread(RegexScratch& scratch, std::vector<uint32_t>& list, uint32_t pc, size_t pos) const
+    {
+        auto& stack = scratch.Stack;
+        stack.clear();
+        stack.push_back(pc);
+
+        while (!stack.empty())
+        {
+            const auto current = stack.back();
+            stack.pop_back();
+
+            if (scratch.Marks[current] == scratch.Generation)
+                continue;
+            scratch.Marks[current] = scratch.Generation;
+
+            const auto& instruction = m_Program.Instructions[current];
+            switch (instruction.op)
+            {
+                case Op::Jump:
+                    stack.push_back(instruction.x);
+                    break;
+                case Op::Split:
+                    stack.push_back(instruction.y);
+                    stack.push_back(instruction.x);
+                    break;
+                case Op::LineBegin:
+                    if (pos == 0)
+                        stack.push_back(current + 1);
+                    break;
+                case Op::LineEnd:
+                    if (pos == m_Length)
+                        stack.push_back(current + 1);
+                    break;
+                case Op::WordBoundary:
+                    if (IsWordBoundary(pos))
+                        stack.push_back(current + 1);
+                    break;
+                case Op::NotWordBoundary:
+                    if (!IsWordBoundary(pos))
+                        stack.push_back(current + 1);
+                    break;
+                default:
+                    list.push_back(current);
+                    break;
+            }
+        }
+    }
+
+    const Program& m_Program;
+    const CharT* m_First;
+    const size_t m_Length;
+};
+
+bool HasFlag(std::regex_constants::syntax_option_type flags, std::regex_constants::syntax_option_type flag)
+{
+    return (flags & flag) == flag;
+}
+
+}  // namespace
+
+namespace Orc {
+
+template <typename CharT>
+BasicRegex<CharT>& BasicRegex<CharT>::assign(string_view_type pattern, flag_type flags)
+{
+    using namespace std::regex_constants;
+
+    auto program = std::make_shared<Detail::RegexProgram<CharT>>();
+    program->bIcase = HasFlag(flags, icase);
+
+    bool bLinear = !HasFlag(flags, basic) && !HasFlag(flags, extended) && !HasFlag(flags, awk)
+        && !HasFlag(flags, grep) && !HasFlag(flags, egrep) && !HasFlag(flags, collate);
+
+    if (bLinear)
+    {
+        try
+        {
+            Compiler<CharT>(pattern, *program).Compile();
+        }
+        catch (const Unsupported&)
+        {
+            bLinear = false;
+        }
+    }
+
+    if (!bLinear)
+    {
+        program->Instructions.clear();
+        program->Classes.clear();
+        program->Required.clear();
+        program->bLiteral = false;
+
+        // Throws std::regex_error for invalid patterns
+        program->Fallback.emplace(pattern.data(), pattern.size(), flags);
+    }
+
+    m_Program = std::move(program);
+    return *this;
+}
+
+template <typename CharT>
+bool BasicRegex<CharT>::IsLinear() const
+{
+    return m_Program != nullptr && !m_Program->Fallback.has_value();
+}
+
+template <typename CharT>
+bool BasicRegex<CharT>::Match(const CharT* first, const CharT* last) const
+{
+    if (m_Program == nullptr)
+        return false;
+
+    if (m_Program->Fallback)
+        return std::regex_match(first, last, *m_Program->Fallback);
+
+    return Machine<CharT>(*m_Program, first, last).Run(false);
+}
+
+template <typename CharT>
+bool BasicRegex<CharT>::Search(const CharT* first, const CharT* last) const
+{
+    if (m_Program == nullptr)
+        return false;
+
+    if (m_Program->Fallback)
+        return std::regex_search(first, last, *m_Program->Fallback);
+
+    return Machine<CharT>(*m_Program, first, last).Run(true);
+}
+
+template class BasicRegex<char>;
+template class BasicRegex<wchar_t>;
+
+}  // namespace Orc
@@ -0,0 +1,72 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+namespace Detail {
+
+template <typename CharT>
+struct RegexProgram;
+
+}  // namespace Detail
+
+// Regular expression with a non backtracking engine: the pattern is compiled into a Thompson NFA which is simulated
+// over the input (Pike VM without captures), so matching is linear in the input length whatever the pattern is. A
+// literal that any match must contain is extracted at compile time and looked up first to reject most inputs cheaply.
+//
+// The ECMAScript subset used by search rules is supported (classes, groups, alternations, greedy and lazy quantifiers,
+// anchors and word boundaries). Patterns relying on anything else (back references, lookarounds, other grammars) are
+// handed to std::basic_regex unchanged. Invalid patterns throw std::regex_error exactly like std::basic_regex does.
+template <typename CharT>
+class BasicRegex
+{
+public:
+    using flag_type = std::regex_constants::syntax_option_type;
+    using string_view_type = std::basic_string_view<CharT>;
+
+    BasicRegex() = default;
+
+    explicit BasicRegex(string_view_type pattern, flag_type flags = std::regex_constants::ECMAScript)
+    {
+        assign(pattern, flags);
+    }
+
+    BasicRegex& assign(string_view_type pattern, flag_type flags = std::regex_constants::ECMAScript);
+
+    bool empty() const { return m_Program == nullptr; }
+
+    // True when the linear engine is used, false when the pattern was handed to std::basic_regex
+    bool IsLinear() const;
+
+    // Whole input must match (std::regex_match)
+    bool Match(const CharT* first, const CharT* last) const;
+    bool Match(string_view_type input) const { return Match(input.data(), input.data() + input.size()); }
+
+    // Any part of the input may match (std::regex_search)
+    bool Search(const CharT* first, const CharT* last) const;
+    bool Search(string_view_type input) const { return Search(input.data(), input.data() + input.size()); }
+
+private:
+    // Compiled programs are immutable: copies share them
+    std::shared_ptr<const Detail::RegexProgram<CharT>> m_Program;
+};
+
+using Regex = BasicRegex<char>;
+using WRegex = BasicRegex<wchar_t>;
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,95 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace Orc {
+
+// Append only arena of strings: returned views remain valid until the pool is destroyed or cleared.
+template <typename CharT>
+class BasicStringPool
+{
+public:
+    static constexpr size_t kDefaultChunkSize = 64 * 1024;
+
+    explicit BasicStringPool(size_t chunkSize = kDefaultChunkSize)
+        : m_chunkSize(chunkSize)
+    {
+    }
+
+    BasicStringPool(const BasicStringPool&) = delete;
+    BasicStringPool& operator=(const BasicStringPool&) = delete;
+
+    // Store the concatenation of the given parts, followed by a null terminator (not included in the view)
+    template <typename... Parts>
+    std::basic_string_view<CharT> Intern(const Parts&... parts)
+    {
+        const size_t length = (0 + ... + Length(parts));
+
+        CharT* pDest = Allocate(length + 1);
+        CharT* pCursor = pDest;
+        ((pCursor = Copy(pCursor, parts)), ...);
+        *pCursor = CharT(0);
+
+        return std::basic_string_view<CharT>(pDest, length);
+    }
+
+    size_t Bytes() const { return m_bytes; }
+
+    void Clear()
+    {
+        m_chunks.clear();
+        m_used = 0;
+        m_capacity = 0;
+        m_bytes = 0;
+    }
+
+private:
+    static size_t Length(std::basic_string_view<CharT> str) { return str.size(); }
+    static size_t Length(CharT) { return 1; }
+
+    static CharT* Copy(CharT* pDest, std::basic_string_view<CharT> str)
+    {
+        return std::copy(std::cbegin(str), std::cend(str), pDest);
+    }
+    static CharT* Copy(CharT* pDest, CharT c)
+    {
+        *pDest = c;
+        return pDest + 1;
+    }
+
+    CharT* Allocate(size_t count)
+    {
+        if (m_chunks.empty() || m_used + count > m_capacity)
+        {
+            m_capacity = std::max(m_chunkSize, count);
+            m_chunks.push_back(std::make_unique<CharT[]>(m_capacity));
+            m_bytes += m_capacity * sizeof(CharT);
+            m_used = 0;
+        }
+
+        CharT* pDest = m_chunks.back().get() + m_used;
+        m_used += count;
+        return pDest;
+    }
+
+    const size_t m_chunkSize;
+    std::vector<std::unique_ptr<CharT[]>> m_chunks;
+    size_t m_used = 0;
+    size_t m_capacity = 0;
+    size_t m_bytes = 0;
+};
+
+using StringPool = BasicStringPool<char>;
+using WStringPool = BasicStringPool<wchar_t>;
+
+}  // namespace Orc
@@ -9,6 +9,11 @@
 
 #include "VHDVolumeReader.h"
 #include "FileStream.h"
+#include "IoTrace.h"
+#include "Telemetry.h"
+#include "VirtualDiskImage.h"
+
+#include <boost/scope_exit.hpp>
 
 #include <intrin.h>
 
@@ -19,45 +24,50 @@ VHDVolumeReader::VHDVolumeReader(const WCHAR* szLocation)
 {
 }
 
-HRESULT VHDVolumeReader::LoadDiskFooter()
+HRESULT VHDVolumeReader::LoadFooter(const WCHAR* szPath, Footer& footer)
 {
     HRESULT hr = E_FAIL;
 
     FileStream stream;
 
-    if (FAILED(hr = stream.ReadFrom(m_szLocation)))
+    if (FAILED(hr = stream.ReadFrom(szPath)))
     {
-        Log::Error(L"Failed to open location '{}' [{}]", m_szLocation, SystemError(hr));
+        Log::Error(L"Failed to open location '{}' [{}]", szPath, SystemError(hr));
         return hr;
     }
     ULONGLONG ullNewPostion = 0LL;
     if (FAILED(hr = stream.SetFilePointer(-(LONGLONG)sizeof(Footer), FILE_END, &ullNewPostion)))
     {
-        Log::Error(L"Failed to move to VHD's footer '{}' [{}]", m_szLocation, SystemError(hr));
+        Log::Error(L"Failed to move to VHD's footer '{}' [{}]", szPath, SystemError(hr));
         return hr;
     }
     ULONGLONG ullRead = 0L;
-    if (FAILED(hr = stream.Read(&m_Footer, sizeof(Footer), &ullRead)))
+    if (FAILED(hr = stream.Read(&footer, sizeof(Footer), &ullRead)))
     {
-        Log::Error(L"Failed to read VHD's footer '{}' [{}]", m_szLocation, SystemError(hr));
+        Log::Error(L"Failed to read VHD's footer '{}' [{}]", szPath, SystemError(hr));
         return hr;
     }
-    m_Footer.Features = _byteswap_ulong(m_Footer.Features);
-    m_Footer.Version = _byteswap_ulong(m_Footer.Version);
-    m_Footer.DataOffset = _byteswap_uint64(m_Footer.DataOffset);
-    m_Footer.TimeStamp = _byteswap_ulong(m_Footer.TimeStamp);
-    m_Footer.CreatorVersion = _byteswap_ulong(m_Footer.CreatorVersion);
-    m_Footer.OriginalSize = _byteswap_uint64(m_Footer.OriginalSize);
-    m_Footer.CurrentSize = _byteswap_uint64(m_Footer.CurrentSize);
-    m_Footer.Geometry.Cylinders = _byteswap_ushort(m_Footer.Geometry.Cylinders);
-    m_Footer.DiskType = static_cast<DiskType>(_byteswap_ulong(m_Footer.DiskType));
-    m_Footer.Checksum = _byteswap_ulong(m_Footer.Checksum);
+    footer.Features = _byteswap_ulong(footer.Features);
+    footer.Version = _byteswap_ulong(footer.Version);
+    footer.DataOffset = _byteswap_uint64(footer.DataOffset);
+    footer.TimeStamp = _byteswap_ulong(footer.TimeStamp);
+    footer.CreatorVersion = _byteswap_ulong(footer.CreatorVersion);
+    footer.OriginalSize = _byteswap_uint64(footer.OriginalSize);
+    footer.CurrentSize = _byteswap_uint64(footer.CurrentSize);
+    footer.Geometry.Cylinders = _byteswap_ushort(footer.Geometry.Cylinders);
+    footer.DiskType = static_cast<DiskType>(_byteswap_ulong(footer.DiskType));
+    footer.Checksum = _byteswap_ulong(footer.Checksum);
 
     stream.Close();
 
     return S_OK;
 }
 
+HRESULT VHDVolumeReader::LoadDiskFooter()
+{
+    return LoadFooter(m_szLocation, m_Footer);
+}
+
 HRESULT VHDVolumeReader::LoadDiskProperties()
 {
     return LoadDiskFooter();
@@ -65,6 +75,12 @@ HRESULT VHDVolumeReader::LoadDiskProperties()
 
 VHDVolumeReader::DiskType VHDVolumeReader::GetDiskType()
 {
+    if (VirtualDiskImage::IsVHDX(m_szLocation))
+    {
+        // VHDX has no footer, its allocation table is read like the one of a dynamic disk
+        return VHDVolumeReader::DynamicHardDisk;
+    }
+
     if (!strncmp(m_Footer.Cookie, "conectix", 8))
     {
         return m_Footer.DiskType;
@@ -87,6 +103,17 @@ std::shared_ptr<VolumeReader> VHDVolumeReader::GetVolumeReader()
             }
             return retval;
         }
+        case DynamicHardDisk:
+        case DifferencingHardDisk: {
+            auto retval = std::make_shared<DynamicVHDVolumeReader>(m_szLocation);
+
+            if (FAILED(hr = retval->LoadDiskProperties()))
+            {
+                Log::Error(L"Failed to load VHD properties [{}]", SystemError(hr));
+                return nullptr;
+            }
+            return retval;
+        }
         default:
             return nullptr;
     }
@@ -143,3 +170,111 @@ HRESULT FixedVHDVolumeReader::LoadDiskProperties()
 
     return S_OK;
 }
+
+std::shared_ptr<VolumeReader> DynamicVHDVolumeReader::DuplicateReader()
+{
+    auto retval = std::make_shared<DynamicVHDVolumeReader>(m_szLocation);
+
+    // The image (and its cached allocation table) is shared: reads are positional
+    retval->m_Footer = m_Footer;
+    retval->m_pImage = m_pImage;
+    retval->m_BytesPerFRS = m_BytesPerFRS;
+    retval->m_BytesPerSector = m_BytesPerSector;
+    retval->m_BytesPerCluster = m_BytesPerCluster;
+    retval->m_NumberOfSectors = m_NumberOfSectors;
+    retval->m_llVolumeSerialNumber = m_llVolumeSerialNumber;
+    retval->m_dwMaxComponentLength = m_dwMaxComponentLength;
+    retval->m_fsType = m_fsType;
+    retval->m_bReadyForEnumeration = m_bReadyForEnumeration;
+
+    return retval;
+}
+
+HRESULT DynamicVHDVolumeReader::LoadDiskProperties()
+{
+    HRESULT hr = E_FAIL;
+
+    if (!VirtualDiskImage::IsVHDX(m_szLocation) && FAILED(hr = LoadDiskFooter()))
+    {
+        Log::Error(L"Failed to load VHD disk footer [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = VirtualDiskImage::Open(m_szLocation, m_pImage)))
+    {
+        Log::Error(L"Failed to open virtual disk '{}' [{}]", m_szLocation, SystemError(hr));
+        return hr;
+    }
+
+    CBinaryBuffer buffer;
+    if (!buffer.SetCount(sizeof(PackedGenBootSector)))
+        return E_OUTOFMEMORY;
+
+    if (FAILED(hr = m_pImage->Read(0LL, buffer.GetData(), buffer.GetCount())))
+    {
+        Log::Error(L"Failed to read the boot sector of '{}' [{}]", m_szLocation, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = VolumeReader::ParseBootSector(buffer)))
+        return hr;
+
+    m_bReadyForEnumeration = true;
+    return S_OK;
+}
+
+HRESULT DynamicVHDVolumeReader::Seek(ULONGLONG offset)
+{
+    m_ullPosition = offset;
+    return S_OK;
+}
+
+uint64_t DynamicVHDVolumeReader::Position() const
+{
+    return m_ullPosition;
+}
+
+HRESULT
+DynamicVHDVolumeReader::Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
+{
+    HRESULT hr = E_FAIL;
+
+    ullBytesRead = 0LL;
+    IoTrace::Instance().RecordRead(m_szLocation, offset, ullBytesToRead);
+    Telemetry::Scope telemetry(Telemetry::Phase::VolumeRead);
+    BOOST_SCOPE_EXIT(&telemetry, &ullBytesRead) { telemetry.AddBytes(ullBytesRead); }
+    BOOST_SCOPE_EXIT_END;
+
+    if (m_pImage == nullptr)
+        return E_POINTER;
+
+    const auto ullVolumeSize = m_NumberOfSectors > 0
+        ? std::min<ULONGLONG>(m_NumberOfSectors * m_BytesPerSector, m_pImage->VirtualSize())
+        : m_pImage->VirtualSize();
+    if (offset >= ullVolumeSize)
+        return S_OK;
+
+    ullBytesToRead = std::min(ullBytesToRead, ullVolumeSize - offset);
+
+    if (data.OwnsBuffer() && !data.SetCount(static_cast<size_t>(ullBytesToRead)))
+        return E_OUTOFMEMORY;
+
+    // No alignment is needed: the image translates any range into coalesced reads of its payload blocks
+    const auto cbRead = std::min(data.GetCount(), static_cast<size_t>(ullBytesToRead));
+    if (FAILED(hr = m_pImage->Read(offset, data.GetData(), cbRead)))
+    {
+        Log::Error(L"Failed to read virtual disk '{}' at offset {} [{}]", m_szLocation, offset, SystemError(hr));
+        return hr;
+    }
+
+    ullBytesRead = cbRead;
+    data.SetCount(cbRead);
+
+    m_ullPosition = offset + ullBytesRead;
+    return S_OK;
+}
+
+HRESULT DynamicVHDVolumeReader::Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead)
+{
+    return Read(m_ullPosition, data, ullBytesToRead, ullBytesRead);
+}
@@ -10,10 +10,14 @@
 #include "OrcLib.h"
 #include "CompleteVolumeReader.h"
 
+#include <atomic>
+
 #pragma managed(push, off)
 
 namespace Orc {
 
+class VirtualDiskImage;
+
 class VHDVolumeReader : public CompleteVolumeReader
 {
 public:
@@ -24,7 +28,7 @@ public:
         Reserved1 = 1,
         FixedHardDisk = 2,
         DynamicHardDisk = 3,
-        DikfferencingHardDisk = 4,
+        DifferencingHardDisk = 4,
         Reserved5 = 5,
         Reserved6 = 6
     } DiskType;
@@ -36,7 +40,7 @@ public:
         DWORD Version;
         ULONGLONG DataOffset;
         DWORD TimeStamp;
-        CHAR CreatorApplication;
+        CHAR CreatorApplication[4];
         DWORD CreatorVersion;
         CHAR CreatorHostOS[4];
         ULONGLONG OriginalSize;
@@ -61,6 +65,9 @@ protected:
 public:
     VHDVolumeReader(const WCHAR* szLocation);
 
+    // Read the footer at the end of 'szPath', multi byte fields are converted from big endian
+    static HRESULT LoadFooter(const WCHAR* szPath, Footer& footer);
+
     void Accept(VolumeReaderVisitor& visitor) const override { return visitor.Visit(*this); }
 
     const WCHAR* ShortVolumeName() { return L"\\"; }
@@ -92,6 +99,31 @@ public:
     virtual std::shared_ptr<VolumeReader> DuplicateReader(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags);
 };
 
+// Dynamic and differencing VHD, and VHDX: offsets are translated through the allocation table the image caches. Reads
+// do not share a file position and are not serialized, read ahead and block cache are not available.
+class DynamicVHDVolumeReader : public VHDVolumeReader
+{
+protected:
+    std::shared_ptr<VirtualDiskImage> m_pImage;
+    std::atomic<ULONGLONG> m_ullPosition = 0LL;
+
+    virtual std::shared_ptr<VolumeReader> DuplicateReader();
+
+public:
+    DynamicVHDVolumeReader(const WCHAR* szLocation)
+        : VHDVolumeReader(szLocation)
+    {
+    }
+
+    virtual HRESULT LoadDiskProperties();
+
+    HRESULT Seek(ULONGLONG offset) override;
+    uint64_t Position() const override;
+
+    HRESULT Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
+    HRESULT Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) override;
+};
+
 }  // namespace Orc
 
 #pragma managed(pop)
@@ -0,0 +1,1032 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "VirtualDiskImage.h"
+#include "VHDVolumeReader.h"
+
+#include <algorithm>
+#include <array>
+#include <filesystem>
+
+#include <intrin.h>
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr ULONGLONG kSectorSize = 512LL;
+
+// Largest single ReadFile, larger runs are read in several calls
+constexpr DWORD kMaxReadSize = 16 * 1024 * 1024L;
+
+#pragma pack(push, 1)
+
+struct VHDParentLocator
+{
+    BYTE PlatformCode[4];
+    DWORD PlatformDataSpace;
+    DWORD PlatformDataLength;
+    DWORD Reserved;
+    ULONGLONG PlatformDataOffset;
+};
+
+struct VHDDynamicHeader
+{
+    CHAR Cookie[8];
+    ULONGLONG DataOffset;
+    ULONGLONG TableOffset;
+    DWORD HeaderVersion;
+    DWORD MaxTableEntries;
+    DWORD BlockSize;
+    DWORD Checksum;
+    UUID ParentUniqueId;
+    DWORD ParentTimeStamp;
+    DWORD Reserved;
+    WCHAR ParentUnicodeName[256];
+    VHDParentLocator ParentLocators[8];
+    BYTE Reserved2[256];
+};
+static_assert(sizeof(VHDDynamicHeader) == 1024);
+
+struct VHDXHeader
+{
+    BYTE Signature[4];
+    DWORD Checksum;
+    ULONGLONG SequenceNumber;
+    GUID FileWriteGuid;
+    GUID DataWriteGuid;
+    GUID LogGuid;
+    WORD LogVersion;
+    WORD Version;
+    DWORD LogLength;
+    ULONGLONG LogOffset;
+};
+
+struct VHDXRegionTableHeader
+{
+    BYTE Signature[4];
+    DWORD Checksum;
+    DWORD EntryCount;
+    DWORD Reserved;
+};
+
+struct VHDXRegionTableEntry
+{
+    GUID Guid;
+    ULONGLONG FileOffset;
+    DWORD Length;
+    DWORD Required;
+};
+
+struct VHDXMetadataTableHeader
+{
+    BYTE Signature[8];
+    WORD Reserved;
+    WORD EntryCount;
+    DWORD Reserved2[5];
+};
+
+struct VHDXMetadataTableEntry
+{
+    GUID ItemId;
+    DWORD Offset;
+    DWORD Length;
+    DWORD Flags;
+    DWORD Reserved;
+};
+
+struct VHDXFileParameters
+{
+    DWORD BlockSize;
+    DWORD Flags;
+};
+
+struct VHDXParentLocatorHeader
+{
+    GUID LocatorType;
+    WORD Reserved;
+    WORD KeyValueCount;
+};
+
+struct VHDXParentLocatorEntry
+{
+    DWORD KeyOffset;
+    DWORD ValueOffset;
+    WORD KeyLength;
+    WORD ValueLength;
+};
+
+#pragma pack(pop)
+
+constexpr ULONGLONG kVHDXHeaderOffsets[] = {64 * 1024LL, 128 * 1024LL};
+constexpr ULONG kVHDXHeaderSize = 4 * 1024L;
+constexpr ULONGLONG kVHDXRegionTableOffsets[] = {192 * 1024LL, 256 * 1024LL};
+constexpr ULONG kVHDXRegionTableSize = 64 * 1024L;
+constexpr ULONG kVHDXMaxTableEntries = 2047L;
+constexpr ULONG kVHDXSectorBitmapBlockSize = 1024 * 1024L;
+constexpr ULONGLONG kVHDXFileOffsetMask = 0xFFFFFFFFFFF00000LL;
+
+constexpr GUID kVHDXBatRegion = {0x2DC27766, 0xF623, 0x4200, {0x9D, 0x64, 0x11, 0x5E, 0x9B, 0xFD, 0x4A, 0x08}};
+constexpr GUID kVHDXMetadataRegion = {0x8B7CA206, 0x4790, 0x4B9A, {0xB8, 0xFE, 0x57, 0x5F, 0x05, 0x0F, 0x88, 0x6E}};
+
+constexpr GUID kVHDXFileParameters = {0xCAA16737, 0xFA36, 0x4D43, {0xB3, 0xB6, 0x33, 0xF0, 0xAA, 0x44, 0xE7, 0x6B}};
+constexpr GUID kVHDXVirtualDiskSize = {0x2FA54224, 0xCD1B, 0x4876, {0xB2, 0x11, 0x5D, 0xBE, 0xD8, 0x3B, 0xF4, 0xB8}};
+constexpr GUID kVHDXLogicalSectorSize = {0x8141BF1D, 0xA96F, 0x4709, {0xBA, 0x47, 0xF2, 0x33, 0xA8, 0xFA, 0xAB, 0x5F}};
+constexpr GUID kVHDXParentLocator = {0xA8D35F2D, 0xB30B, 0x454D, {0xAB, 0xF7, 0xD3, 0xD8, 0x48, 0x34, 0xAB, 0x0C}};
+
+constexpr DWORD kVHDXHasParent = 0x2L;
+
+enum VHDXBlockState : ULONGLONG
+{
+    PayloadBlockNotPresent = 0,
+    PayloadBlockUndefined = 1,
+    PayloadBlockZero = 2,
+    PayloadBlockUnmapped = 3,
+    PayloadBlockFullyPresent = 6,
+    PayloadBlockPartiallyPresent = 7,
+    SectorBitmapBlockPresent = 6
+};
+
+// CRC-32C (Castagnoli) used by the VHDX headers and region tables
+DWORD Crc32c(const BYTE* pData, size_t cbData)
+{
+    static const auto table = []() {
+        std::array<DWORD, 256> table {};
+        for (DWORD i = 0; i < table.size(); i++)
+        {
+            DWORD crc = i;
+            for (int bit = 0; bit < 8; bit++)
+                crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78L : crc >> 1;
+            table[i] = crc;
+        }
+        return table;
+    }();
+
+    DWORD crc = 0xFFFFFFFFL;
+    for (size_t i = 0; i < cbData; i++)
+        crc = table[(crc ^ pData[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFL;
+}
+
+// Checksum of a structure whose checksum field is at offset 4, computed with that field zeroed
+bool IsValidChecksum(const BYTE* pData, size_t cbData)
+{
+    std::vector<BYTE> copy(pData, pData + cbData);
+    ZeroMemory(copy.data() + 4, sizeof(DWORD));
+    return Crc32c(copy.data(), copy.size()) == *reinterpret_cast<const DWORD*>(pData + 4);
+}
+
+// Number of sectors from 'ullFirst' (at most 'ullMax') which share the state of 'ullFirst' in a sector bitmap. VHD
+// bitmaps start with the most significant bit of each byte, VHDX ones with the least significant.
+ULONGLONG SectorRun(const BYTE* pBitmap, ULONGLONG ullFirst, ULONGLONG ullMax, bool bMsbFirst, bool& bPresent)
+{
+    const auto isSet = [pBitmap, bMsbFirst](ULONGLONG ullSector) {
+        const BYTE mask = bMsbFirst ? (0x80 >> (ullSector % 8)) : (0x01 << (ullSector % 8));
+        return (pBitmap[ullSector / 8] & mask) != 0;
+    };
+
+    bPresent = isSet(ullFirst);
+
+    ULONGLONG ullCount = 1;
+    while (ullCount < ullMax)
+    {
+        const auto ullSector = ullFirst + ullCount;
+
+        // Whole bytes in the same state are skipped at once
+        if (ullSector % 8 == 0 && ullMax - ullCount >= 8 && pBitmap[ullSector / 8] == (bPresent ? 0xFF : 0x00))
+        {
+            ullCount += 8;
+            continue;
+        }
+
+        if (isSet(ullSector) != bPresent)
+            break;
+        ullCount++;
+    }
+    return ullCount;
+}
+
+// Run of at most 'ullLength' bytes at 'ullPosition' (relative to the start of a sector bitmap) sharing one state
+ULONGLONG BitmapRun(
+    const BYTE* pBitmap,
+    ULONGLONG ullPosition,
+    ULONGLONG ullLength,
+    ULONGLONG ullSectorSize,
+    bool bMsbFirst,
+    bool& bPresent)
+{
+    const auto ullFirst = ullPosition / ullSectorSize;
+    const auto ullLast = (ullPosition + ullLength - 1) / ullSectorSize;
+
+    const auto ullSectors = SectorRun(pBitmap, ullFirst, ullLast - ullFirst + 1, bMsbFirst, bPresent);
+    return std::min(ullLength, (ullFirst + ullSectors) * ullSectorSize - ullPosition);
+}
+
+std::wstring FromBigEndian(const WCHAR* szName, size_t cchMax)
+{
+    std::wstring retval;
+    for (size_t i = 0; i < cchMax && szName[i] != L'\0'; i++)
+        retval.push_back(static_cast<WCHAR>(_byteswap_ushort(szName[i])));
+    return retval;
+}
+
+class FixedVHDImage : public VirtualDiskImage
+{
+public:
+    FixedVHDImage(const std::wstring& strPath, const VHDVolumeReader::Footer& footer)
+        : VirtualDiskImage(strPath)
+        , m_Footer(footer)
+    {
+    }
+
+protected:
+    HRESULT Load() override
+    {
+        if (m_Footer.CurrentSize > m_ullFileSize)
+        {
+            Log::Error(L"Fixed VHD '{}' is truncated", m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        m_ullVirtualSize = m_Footer.CurrentSize;
+        CopyMemory(&m_Identifier, &m_Footer.UniqueId, sizeof(GUID));
+        return S_OK;
+    }
+
+    HRESULT MapBlock(ULONGLONG ullOffset, ULONGLONG ullLength, Run& run) override
+    {
+        run.Origin = Source::File;
+        run.FileOffset = ullOffset;
+        run.Length = ullLength;
+        return S_OK;
+    }
+
+private:
+    VHDVolumeReader::Footer m_Footer;
+};
+
+// Dynamic and differencing VHD: each payload block is preceded by the bitmap of the sectors it holds
+class DynamicVHDImage : public VirtualDiskImage
+{
+public:
+    DynamicVHDImage(const std::wstring& strPath, const VHDVolumeReader::Footer& footer)
+        : VirtualDiskImage(strPath)
+        , m_Footer(footer)
+    {
+    }
+
+protected:
+    HRESULT Load() override
+    {
+        HRESULT hr = E_FAIL;
+
+        VHDDynamicHeader header;
+        if (FAILED(hr = ReadAt(m_Footer.DataOffset, reinterpret_cast<BYTE*>(&header), sizeof(header))))
+        {
+            Log::Error(L"Failed to read dynamic header of '{}' [{}]", m_strPath, SystemError(hr));
+            return hr;
+        }
+
+        if (strncmp(header.Cookie, "cxsparse", 8))
+        {
+            Log::Error(L"Invalid dynamic header in '{}'", m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        const auto ullTableOffset = _byteswap_uint64(header.TableOffset);
+        const auto dwMaxTableEntries = _byteswap_ulong(header.MaxTableEntries);
+        m_ulBlockSize = _byteswap_ulong(header.BlockSize);
+
+        if (m_ulBlockSize == 0 || m_ulBlockSize % kSectorSize)
+        {
+            Log::Error(L"Invalid block size {} in '{}'", m_ulBlockSize, m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        m_ullVirtualSize = m_Footer.CurrentSize;
+        CopyMemory(&m_Identifier, &m_Footer.UniqueId, sizeof(GUID));
+
+        // One bit per sector, padded to a whole sector
+        const auto ullBitmapBytes = (m_ulBlockSize / kSectorSize + 7) / 8;
+        m_cbBitmap = static_cast<ULONG>(((ullBitmapBytes + kSectorSize - 1) / kSectorSize) * kSectorSize);
+
+        // The whole table is read once: translating an offset never costs an I/O
+        m_BAT.resize(dwMaxTableEntries);
+        if (FAILED(
+                hr = ReadAt(
+                    ullTableOffset, reinterpret_cast<BYTE*>(m_BAT.data()), m_BAT.size() * sizeof(DWORD))))
+        {
+            Log::Error(L"Failed to read block allocation table of '{}' [{}]", m_strPath, SystemError(hr));
+            return hr;
+        }
+        std::transform(std::cbegin(m_BAT), std::cend(m_BAT), std::begin(m_BAT), [](DWORD dwEntry) {
+            return _byteswap_ulong(dwEntry);
+        });
+
+        if (m_Footer.DiskType == VHDVolumeReader::DifferencingHardDisk)
+        {
+            CopyMemory(&m_ParentIdentifier, &header.ParentUniqueId, sizeof(GUID));
+            LoadParentLocators(header);
+        }
+
+        Log::Debug(
+            L"VHD '{}': {} blocks of {} bytes, differencing: {}",
+            m_strPath,
+            m_BAT.size(),
+            m_ulBlockSize,
+            IsDifferencing());
+        return S_OK;
+    }
+
+    HRESULT MapBlock(ULONGLONG ullOffset, ULONGLONG ullLength, Run& run) override
+    {
+        HRESULT hr = E_FAIL;
+
+        const auto ullBlock = ullOffset / m_ulBlockSize;
+        const auto ullInBlock = ullOffset % m_ulBlockSize;
+
+        run.Length = std::min(ullLength, m_ulBlockSize - ullInBlock);
+
+        if (ullBlock >= m_BAT.size() || m_BAT[ullBlock] == kUnusedEntry)
+        {
+            run.Origin = IsDifferencing() ? Source::Parent : Source::Zero;
+            return S_OK;
+        }
+
+        const auto ullBlockOffset = m_BAT[ullBlock] * kSectorSize;
+
+        run.Origin = Source::File;
+        run.FileOffset = ullBlockOffset + m_cbBitmap + ullInBlock;
+
+        // Sectors of a differencing disk not written since it was created are read from the parent
+        if (IsDifferencing())
+        {
+            const BYTE* pBitmap = nullptr;
+            if (FAILED(hr = GetBitmap(ullBlock, ullBlockOffset, m_cbBitmap, pBitmap)))
+                return hr;
+
+            bool bPresent = false;
+            run.Length = BitmapRun(pBitmap, ullInBlock, run.Length, kSectorSize, true, bPresent);
+            if (!bPresent)
+                run.Origin = Source::Parent;
+        }
+        return S_OK;
+    }
+
+private:
+    static constexpr DWORD kUnusedEntry = 0xFFFFFFFFL;
+
+    void LoadParentLocators(const VHDDynamicHeader& header)
+    {
+        // Relative locations first: they remain valid when a whole chain is copied elsewhere
+        for (const auto szCode : {"W2ru", "W2ku"})
+        {
+            for (const auto& locator : header.ParentLocators)
+            {
+                if (memcmp(locator.PlatformCode, szCode, sizeof(locator.PlatformCode)))
+                    continue;
+
+                const auto dwLength = _byteswap_ulong(locator.PlatformDataLength);
+                if (dwLength == 0 || dwLength > ORC_MAX_PATH * sizeof(WCHAR))
+                    continue;
+
+                std::wstring strPath(dwLength / sizeof(WCHAR), L'\0');
+                if (FAILED(ReadAt(
+                        _byteswap_uint64(locator.PlatformDataOffset),
+                        reinterpret_cast<BYTE*>(strPath.data()),
+                        strPath.size() * sizeof(WCHAR))))
+                    continue;
+
+                strPath.resize(wcsnlen(strPath.c_str(), strPath.size()));
+                if (!strPath.empty())
+                    m_ParentPaths.push_back(ResolvePath(strPath));
+            }
+        }
+
+        const auto strName = FromBigEndian(header.ParentUnicodeName, _countof(header.ParentUnicodeName));
+        if (!strName.empty())
+            m_ParentPaths.push_back(ResolvePath(strName));
+    }
+
+    VHDVolumeReader::Footer m_Footer;
+    std::vector<DWORD> m_BAT;  // sector offset of each block, kUnusedEntry when not allocated
+    ULONG m_cbBitmap = 0L;
+};
+
+// VHDX: the allocation table interleaves one sector bitmap entry after each chunk of payload entries
+class VHDXImage : public VirtualDiskImage
+{
+public:
+    VHDXImage(const std::wstring& strPath)
+        : VirtualDiskImage(strPath)
+    {
+    }
+
+protected:
+    HRESULT Load() override
+    {
+        HRESULT hr = E_FAIL;
+
+        if (FAILED(hr = LoadHeader()))
+            return hr;
+
+        VHDXRegionTableEntry batRegion {}, metadataRegion {};
+        if (FAILED(hr = LoadRegionTable(batRegion, metadataRegion)))
+            return hr;
+
+        if (FAILED(hr = LoadMetadata(metadataRegion)))
+            return hr;
+
+        m_ullChunkRatio = ((1LL << 23) * m_ulLogicalSectorSize) / m_ulBlockSize;
+
+        const auto ullPayloadBlocks = (m_ullVirtualSize + m_ulBlockSize - 1) / m_ulBlockSize;
+        const auto ullChunks = (ullPayloadBlocks + m_ullChunkRatio - 1) / m_ullChunkRatio;
+        const auto ullEntries = ullChunks * (m_ullChunkRatio + 1);
+
+        // The whole table is read once: translating an offset never costs an I/O
+        m_BAT.resize(static_cast<size_t>(std::min<ULONGLONG>(ullEntries, batRegion.Length / sizeof(ULONGLONG))));
+        if (FAILED(
+                hr = ReadAt(
+                    batRegion.FileOffset,
+                    reinterpret_cast<BYTE*>(m_BAT.data()),
+                    m_BAT.size() * sizeof(ULONGLONG))))
+        {
+            Log::Error(L"Failed to read block allocation table of '{}' [{}]", m_strPath, SystemError(hr));
+            return hr;
+        }
+
+        Log::Debug(
+            L"VHDX '{}': {} blocks of {} bytes, differencing: {}",
+            m_strPath,
+            ullPayloadBlocks,
+            m_ulBlockSize,
+            IsDifferencing());
+        return S_OK;
+    }
+
+    HRESULT MapBlock(ULONGLONG ullOffset, ULONGLONG ullLength, Run& run) override
+    {
+        HRESULT hr = E_FAIL;
+
+        const auto ullBlock = ullOffset / m_ulBlockSize;
+        const auto ullInBlock = ullOffset % m_ulBlockSize;
+        const auto ullEntry = Entry(ullBlock + ullBlock / m_ullChunkRatio);
+
+        run.Length = std::min(ullLength, m_ulBlockSize - ullInBlock);
+        run.FileOffset = (ullEntry & kVHDXFileOffsetMask) + ullInBlock;
+
+        switch (ullEntry & 0x7)
+        {
+            case PayloadBlockFullyPresent:
+                run.Origin = Source::File;
+                return S_OK;
+            case PayloadBlockPartiallyPresent:
+                break;
+            case PayloadBlockNotPresent:
+            case PayloadBlockUndefined:
+                run.Origin = IsDifferencing() ? Source::Parent : Source::Zero;
+                return S_OK;
+            default:
+                run.Origin = Source::Zero;
+                return S_OK;
+        }
+
+        run.Origin = Source::File;
+        if (!IsDifferencing())
+            return S_OK;
+
+        // Sector bitmap of the chunk, its entry follows the payload entries of the chunk
+        const auto ullChunk = ullBlock / m_ullChunkRatio;
+        const auto ullBitmapEntry = Entry((ullChunk + 1) * (m_ullChunkRatio + 1) - 1);
+        if ((ullBitmapEntry & 0x7) != SectorBitmapBlockPresent)
+        {
+            run.Origin = Source::Parent;
+            return S_OK;
+        }
+
+        const BYTE* pBitmap = nullptr;
+        if (FAILED(
+                hr = GetBitmap(
+                    ullChunk, ullBitmapEntry & kVHDXFileOffsetMask, kVHDXSectorBitmapBlockSize, pBitmap)))
+            return hr;
+
+        bool bPresent = false;
+        const auto ullInChunk = (ullBlock % m_ullChunkRatio) * m_ulBlockSize + ullInBlock;
+        run.Length = BitmapRun(pBitmap, ullInChunk, run.Length, m_ulLogicalSectorSize, false, bPresent);
+        if (!bPresent)
+            run.Origin = Source::Parent;
+        return S_OK;
+    }
+
+private:
+    ULONGLONG Entry(ULONGLONG ullIndex) const { return ullIndex < m_BAT.size() ? m_BAT[ullIndex] : 0LL; }
+
+    HRESULT LoadHeader()
+    {
+        HRESULT hr = E_FAIL;
+
+        // Two copies are kept, the valid one with the highest sequence number is current
+        std::vector<BYTE> buffer(kVHDXHeaderSize);
+        bool bFound = false;
+        VHDXHeader current {};
+
+        for (const auto ullOffset : kVHDXHeaderOffsets)
+        {
+            if (FAILED(hr = ReadAt(ullOffset, buffer.data(), buffer.size())))
+                continue;
+
+            const auto& header = *reinterpret_cast<const VHDXHeader*>(buffer.data());
+            if (memcmp(header.Signature, "head", sizeof(header.Signature))
+                || !IsValidChecksum(buffer.data(), buffer.size()))
+                continue;
+
+            if (!bFound || header.SequenceNumber > current.SequenceNumber)
+            {
+                current = header;
+                bFound = true;
+            }
+        }
+
+        if (!bFound)
+        {
+            Log::Error(L"No valid header in VHDX '{}'", m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        if (!IsEqualGUID(current.LogGuid, GUID_NULL))
+        {
+            Log::Warn(L"VHDX '{}' has a log which is not replayed, the latest writes may be missing", m_strPath);
+        }
+
+        m_Identifier = current.DataWriteGuid;
+        return S_OK;
+    }
+
+    HRESULT LoadRegionTable(VHDXRegionTableEntry& batRegion, VHDXRegionTableEntry& metadataRegion)
+    {
+        HRESULT hr = E_FAIL;
+
+        std::vector<BYTE> buffer(kVHDXRegionTableSize);
+        for (const auto ullOffset : kVHDXRegionTableOffsets)
+        {
+            if (FAILED(hr = ReadAt(ullOffset, buffer.data(), buffer.size())))
+                continue;
+
+            const auto& header = *reinterpret_cast<const VHDXRegionTableHeader*>(buffer.data());
+            if (memcmp(header.Signature, "regi", sizeof(header.Signature)) || header.EntryCount > kVHDXMaxTableEntries
+                || !IsValidChecksum(buffer.data(), buffer.size()))
+                continue;
+
+            const auto pEntries = reinterpret_cast<const VHDXRegionTableEntry*>(buffer.data() + sizeof(header));
+            bool bUnknownRequired = false;
+            for (DWORD i = 0; i < header.EntryCount; i++)
+            {
+                if (IsEqualGUID(pEntries[i].Guid, kVHDXBatRegion))
+                    batRegion = pEntries[i];
+                else if (IsEqualGUID(pEntries[i].Guid, kVHDXMetadataRegion))
+                    metadataRegion = pEntries[i];
+                else if (pEntries[i].Required & 0x1)
+                    bUnknownRequired = true;
+            }
+
+            if (bUnknownRequired)
+            {
+                Log::Error(L"VHDX '{}' requires an unknown region", m_strPath);
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+            }
+
+            if (batRegion.Length == 0 || metadataRegion.Length == 0)
+                break;
+
+            return S_OK;
+        }
+
+        Log::Error(L"No valid region table in VHDX '{}'", m_strPath);
+        return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+    }
+
+    HRESULT LoadMetadata(const VHDXRegionTableEntry& region)
+    {
+        HRESULT hr = E_FAIL;
+
+        std::vector<BYTE> metadata(region.Length);
+        if (metadata.size() < sizeof(VHDXMetadataTableHeader)
+            || FAILED(hr = ReadAt(region.FileOffset, metadata.data(), metadata.size())))
+        {
+            Log::Error(L"Failed to read metadata of VHDX '{}' [{}]", m_strPath, SystemError(hr));
+            return FAILED(hr) ? hr : HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        const auto& header = *reinterpret_cast<const VHDXMetadataTableHeader*>(metadata.data());
+        if (memcmp(header.Signature, "metadata", sizeof(header.Signature)) || header.EntryCount > kVHDXMaxTableEntries
+            || sizeof(header) + header.EntryCount * sizeof(VHDXMetadataTableEntry) > metadata.size())
+        {
+            Log::Error(L"Invalid metadata table in VHDX '{}'", m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        DWORD dwFlags = 0L;
+        const auto pEntries = reinterpret_cast<const VHDXMetadataTableEntry*>(metadata.data() + sizeof(header));
+        for (WORD i = 0; i < header.EntryCount; i++)
+        {
+            const auto& entry = pEntries[i];
+            if (static_cast<ULONGLONG>(entry.Offset) + entry.Length > metadata.size())
+                continue;
+
+            const auto pItem = metadata.data() + entry.Offset;
+            if (IsEqualGUID(entry.ItemId, kVHDXFileParameters) && entry.Length >= sizeof(VHDXFileParameters))
+            {
+                const auto& parameters = *reinterpret_cast<const VHDXFileParameters*>(pItem);
+                m_ulBlockSize = parameters.BlockSize;
+                dwFlags = parameters.Flags;
+            }
+            else if (IsEqualGUID(entry.ItemId, kVHDXVirtualDiskSize) && entry.Length >= sizeof(ULONGLONG))
+            {
+                m_ullVirtualSize = *reinterpret_cast<const ULONGLONG*>(pItem);
+            }
+            else if (IsEqualGUID(entry.ItemId, kVHDXLogicalSectorSize) && entry.Length >= sizeof(DWORD))
+            {
+                m_ulLogicalSectorSize = *reinterpret_cast<const DWORD*>(pItem);
+            }
+            else if (IsEqualGUID(entry.ItemId, kVHDXParentLocator))
+            {
+                LoadParentLocator(pItem, entry.Length);
+            }
+        }
+
+        if (m_ulBlockSize == 0 || (m_ulBlockSize & (m_ulBlockSize - 1))
+            || (m_ulLogicalSectorSize != 512 && m_ulLogicalSectorSize != 4096) || m_ullVirtualSize == 0)
+        {
+            Log::Error(
+                L"Invalid VHDX '{}' (block size: {}, sector size: {}, size: {})",
+                m_strPath,
+                m_ulBlockSize,
+                m_ulLogicalSectorSize,
+                m_ullVirtualSize);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+
+        if ((dwFlags & kVHDXHasParent) && m_ParentPaths.empty())
+        {
+            Log::Error(L"Differencing VHDX '{}' has no parent locator", m_strPath);
+            return HRESULT_FROM_WIN32(ERROR_FILE_CORRUPT);
+        }
+        return S_OK;
+    }
+
+    void LoadParentLocator(const BYTE* pLocator, DWORD cbLocator)
+    {
+        if (cbLocator < sizeof(VHDXParentLocatorHeader))
+            return;
+
+        const auto& header = *reinterpret_cast<const VHDXParentLocatorHeader*>(pLocator);
+        if (sizeof(header) + header.KeyValueCount * sizeof(VHDXParentLocatorEntry) > cbLocator)
+            return;
+
+        const auto value = [pLocator, cbLocator](DWORD dwOffset, WORD cbLength) {
+            if (static_cast<ULONGLONG>(dwOffset) + cbLength > cbLocator)
+                return std::wstring();
+            return std::wstring(reinterpret_cast<const WCHAR*>(pLocator + dwOffset), cbLength / sizeof(WCHAR));
+        };
+
+        std::wstring strRelative, strVolume, strAbsolute;
+        const auto pEntries = reinterpret_cast<const VHDXParentLocatorEntry*>(pLocator + sizeof(header));
+        for (WORD i = 0; i < header.KeyValueCount; i++)
+        {
+            const auto key = value(pEntries[i].KeyOffset, pEntries[i].KeyLength);
+            const auto data = value(pEntries[i].ValueOffset, pEntries[i].ValueLength);
+
+            if (key == L"parent_linkage")
+                IIDFromString(data.c_str(), &m_ParentIdentifier);
+            else if (key == L"relative_path")
+                strRelative = data;
+            else if (key == L"volume_path")
+                strVolume = data;
+            else if (key == L"absolute_win32_path")
+                strAbsolute = data;
+        }
+
+        // Relative location first: it remains valid when a whole chain is copied elsewhere
+        for (const auto& strPath : {strRelative, strVolume, strAbsolute})
+        {
+            if (!strPath.empty())
+                m_ParentPaths.push_back(ResolvePath(strPath));
+        }
+    }
+
+    std::vector<ULONGLONG> m_BAT;
+    ULONG m_ulLogicalSectorSize = 512L;
+    ULONGLONG m_ullChunkRatio = 1LL;
+};
+
+}  // namespace
+
+VirtualDiskImage::VirtualDiskImage(const std::wstring& strPath)
+    : m_strPath(strPath)
+{
+}
+
+bool VirtualDiskImage::IsVHDX(const std::wstring& strPath)
+{
+    HANDLE hFile = CreateFileW(
+        strPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, 0L, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    CHAR signature[8] = {0};
+    DWORD dwRead = 0L;
+    const bool bRead = ReadFile(hFile, signature, sizeof(signature), &dwRead, NULL) && dwRead == sizeof(signature);
+    CloseHandle(hFile);
+
+    return bRead && !strncmp(signature, "vhdxfile", sizeof(signature));
+}
+
+HRESULT VirtualDiskImage::Open(const std::wstring& strPath, std::shared_ptr<VirtualDiskImage>& image)
+{
+    HRESULT hr = E_FAIL;
+
+    std::shared_ptr<VirtualDiskImage> retval;
+    if (IsVHDX(strPath))
+    {
+        retval = std::make_shared<VHDXImage>(strPath);
+    }
+    else
+    {
+        VHDVolumeReader::Footer footer;
+        if (FAILED(hr = VHDVolumeReader::LoadFooter(strPath.c_str(), footer)))
+            return hr;
+
+        if (strncmp(footer.Cookie, "conectix", sizeof(footer.Cookie)))
+        {
+            Log::Error(L"'{}' is neither a VHD nor a VHDX image", strPath);
+            return HRESULT_FROM_WIN32(ERROR_BAD_FORMAT);
+        }
+
+        switch (footer.DiskType)
+        {
+            case VHDVolumeReader::FixedHardDisk:
+                retval = std::make_shared<FixedVHDImage>(strPath, footer);
+                break;
+            case VHDVolumeReader::DynamicHardDisk:
+            case VHDVolumeReader::DifferencingHardDisk:
+                retval = std::make_shared<DynamicVHDImage>(strPath, footer);
+                break;
+            default:
+                Log::Error(L"Unsupported VHD type {} for '{}'", static_cast<DWORD>(footer.DiskType), strPath);
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+    }
+
+    if (FAILED(hr = retval->OpenFile()))
+        return hr;
+
+    if (FAILED(hr = retval->Load()))
+        return hr;
+
+    image = std::move(retval);
+    return S_OK;
+}
+
+HRESULT VirtualDiskImage::OpenFile()
+{
+    m_hFile = CreateFileW(
+        m_strPath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE,
+        NULL,
+        OPEN_EXISTING,
+        FILE_FLAG_RANDOM_ACCESS,
+        NULL);
+    if (m_hFile == INVALID_HANDLE_VALUE)
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to open virtual disk '{}' [{}]", m_strPath, SystemError(hr));
+        return hr;
+    }
+
+    LARGE_INTEGER liSize = {0};
+    if (!GetFileSizeEx(m_hFile, &liSize))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to get size of virtual disk '{}' [{}]", m_strPath, SystemError(hr));
+        return hr;
+    }
+
+    m_ullFileSize = liSize.QuadPart;
+    return S_OK;
+}
+
+HRESULT VirtualDiskImage::ReadAt(ULONGLONG ullFileOffset, BYTE* pBuffer, size_t cbBytes)
+{
+    size_t cbDone = 0;
+    while (cbDone < cbBytes)
+    {
+        // Positional reads: the handle has no shared file pointer to protect
+        OVERLAPPED overlapped = {0};
+        ULARGE_INTEGER uliOffset;
+        uliOffset.QuadPart = ullFileOffset + cbDone;
+        overlapped.Offset = uliOffset.LowPart;
+        overlapped.OffsetHigh = uliOffset.HighPart;
+
+        const auto dwToRead = static_cast<DWORD>(std::min<size_t>(cbBytes - cbDone, kMaxReadSize));
+        DWORD dwRead = 0L;
+        if (!ReadFile(m_hFile, pBuffer + cbDone, dwToRead, &dwRead, &overlapped))
+        {
+            const auto hr = HRESULT_FROM_WIN32(GetLastError());
+            Log::Debug(L"Failed to read '{}' at offset {} [{}]", m_strPath, uliOffset.QuadPart, SystemError(hr));
+            return hr;
+        }
+
+        if (dwRead == 0)
+            return HRESULT_FROM_WIN32(ERROR_HANDLE_EOF);
+
+        cbDone += dwRead;
+    }
+    return S_OK;
+}
+
+HRESULT VirtualDiskImage::GetBitmap(ULONGLONG ullKey, ULONGLONG ullFileOffset, ULONG cbBitmap, const BYTE*& pBitmap)
+{
+    HRESULT hr = E_FAIL;
+
+    concurrency::critical_section::scoped_lock sl(m_csBitmaps);
+
+    auto it = std::lower_bound(
+        std::begin(m_Bitmaps), std::end(m_Bitmaps), ullKey, [](const auto& item, ULONGLONG key) {
+            return item.first < key;
+        });
+
+    if (it == std::end(m_Bitmaps) || it->first != ullKey)
+    {
+        auto bitmap = std::make_unique<BYTE[]>(cbBitmap);
+        if (FAILED(hr = ReadAt(ullFileOffset, bitmap.get(), cbBitmap)))
+        {
+            Log::Error(
+                L"Failed to read sector bitmap of '{}' at offset {} [{}]", m_strPath, ullFileOffset, SystemError(hr));
+            return hr;
+        }
+        it = m_Bitmaps.emplace(it, ullKey, std::move(bitmap));
+    }
+
+    // Bitmaps are never evicted, the pointer remains valid
+    pBitmap = it->second.get();
+    return S_OK;
+}
+
+std::wstring VirtualDiskImage::ResolvePath(const std::wstring& strPath) const
+{
+    std::filesystem::path path(strPath);
+    if (path.is_absolute())
+        return strPath;
+
+    return (std::filesystem::path(m_strPath).parent_path() / path).lexically_normal().wstring();
+}
+
+HRESULT VirtualDiskImage::GetParent(std::shared_ptr<VirtualDiskImage>& parent)
+{
+    HRESULT hr = E_FAIL;
+
+    concurrency::critical_section::scoped_lock sl(m_csParent);
+
+    if (!m_bParentResolved)
+    {
+        m_bParentResolved = true;
+        m_hrParent = HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+
+        for (const auto& strPath : m_ParentPaths)
+        {
+            if (GetFileAttributesW(strPath.c_str()) == INVALID_FILE_ATTRIBUTES)
+                continue;
+
+            std::shared_ptr<VirtualDiskImage> candidate;
+            if (FAILED(hr = Open(strPath, candidate)))
+            {
+                Log::Warn(L"Failed to open parent '{}' of '{}' [{}]", strPath, m_strPath, SystemError(hr));
+                m_hrParent = hr;
+                continue;
+            }
+
+            if (!IsEqualGUID(m_ParentIdentifier, GUID_NULL)
+                && !IsEqualGUID(candidate->m_Identifier, m_ParentIdentifier))
+            {
+                Log::Warn(L"'{}' is not the parent of '{}': identifiers do not match", strPath, m_strPath);
+                continue;
+            }
+
+            Log::Debug(L"Parent of '{}' is '{}'", m_strPath, strPath);
+            m_pParent = std::move(candidate);
+            m_hrParent = S_OK;
+            break;
+        }
+
+        if (FAILED(m_hrParent))
+        {
+            Log::Error(
+                L"Failed to locate the parent of differencing disk '{}' [{}]", m_strPath, SystemError(m_hrParent));
+        }
+    }
+
+    parent = m_pParent;
+    return m_hrParent;
+}
+
+HRESULT VirtualDiskImage::Map(ULONGLONG ullOffset, ULONGLONG ullLength, std::vector<Run>& runs)
+{
+    HRESULT hr = E_FAIL;
+
+    runs.clear();
+
+    if (ullOffset >= m_ullVirtualSize)
+        return S_OK;
+
+    ullLength = std::min(ullLength, m_ullVirtualSize - ullOffset);
+
+    while (ullLength > 0)
+    {
+        Run run;
+        run.VirtualOffset = ullOffset;
+        if (FAILED(hr = MapBlock(ullOffset, ullLength, run)))
+            return hr;
+
+        if (run.Length == 0)
+            return E_UNEXPECTED;
+
+        // Consecutive blocks stored one after the other are read at once, as are absent or zeroed ones
+        if (!runs.empty() && runs.back().Origin == run.Origin
+            && (run.Origin != Source::File || runs.back().FileOffset + runs.back().Length == run.FileOffset))
+        {
+            runs.back().Length += run.Length;
+        }
+        else
+        {
+            runs.push_back(run);
+        }
+
+        ullOffset += run.Length;
+        ullLength -= run.Length;
+    }
+
+    return S_OK;
+}
+
+HRESULT VirtualDiskImage::Read(ULONGLONG ullOffset, BYTE* pBuffer, size_t cbBytes)
+{
+    HRESULT hr = E_FAIL;
+
+    const auto cbInside = ullOffset < m_ullVirtualSize
+        ? static_cast<size_t>(std::min<ULONGLONG>(cbBytes, m_ullVirtualSize - ullOffset))
+        : 0;
+    ZeroMemory(pBuffer + cbInside, cbBytes - cbInside);
+
+    std::vector<Run> runs;
+    if (FAILED(hr = Map(ullOffset, cbInside, runs)))
+        return hr;
+
+    for (const auto& run : runs)
+    {
+        auto pData = pBuffer + (run.VirtualOffset - ullOffset);
+        const auto cbRun = static_cast<size_t>(run.Length);
+
+        switch (run.Origin)
+        {
+            case Source::File:
+                if (FAILED(hr = ReadAt(run.FileOffset, pData, cbRun)))
+                {
+                    Log::Error(L"Failed to read '{}' at offset {} [{}]", m_strPath, run.FileOffset, SystemError(hr));
+                    return hr;
+                }
+                break;
+            case Source::Parent: {
+                std::shared_ptr<VirtualDiskImage> parent;
+                if (FAILED(hr = GetParent(parent)))
+                    return hr;
+
+                if (FAILED(hr = parent->Read(run.VirtualOffset, pData, cbRun)))
+                    return hr;
+                break;
+            }
+            case Source::Zero:
+                ZeroMemory(pData, cbRun);
+                break;
+        }
+    }
+
+    return S_OK;
+}
+
+VirtualDiskImage::~VirtualDiskImage()
+{
+    if (m_hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(m_hFile);
+        m_hFile = INVALID_HANDLE_VALUE;
+    }
+}
@@ -0,0 +1,112 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <concrt.h>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Virtual disk stored in a VHD (fixed, dynamic or differencing) or a VHDX file. The block allocation table is read
+// once and kept in memory, sector bitmaps are cached the first time a block needs one: a read only costs the I/O on
+// the payload itself. Reads are positional so that several readers may share an image.
+class VirtualDiskImage
+{
+public:
+    enum class Source
+    {
+        File,  // payload stored in this file
+        Parent,  // absent from a differencing image, read from its parent
+        Zero  // unallocated or zeroed block
+    };
+
+    struct Run
+    {
+        Source Origin = Source::Zero;
+        ULONGLONG VirtualOffset = 0LL;
+        ULONGLONG FileOffset = 0LL;
+        ULONGLONG Length = 0LL;
+    };
+
+    // Detect the format of 'strPath' and load its allocation table, the parent of a differencing image is only
+    // opened when a read first reaches an absent block
+    static HRESULT Open(const std::wstring& strPath, std::shared_ptr<VirtualDiskImage>& image);
+
+    static bool IsVHDX(const std::wstring& strPath);
+
+    VirtualDiskImage(const VirtualDiskImage&) = delete;
+    VirtualDiskImage& operator=(const VirtualDiskImage&) = delete;
+
+    const std::wstring& Path() const { return m_strPath; }
+    ULONGLONG VirtualSize() const { return m_ullVirtualSize; }
+    ULONG BlockSize() const { return m_ulBlockSize; }
+    bool IsDifferencing() const { return !m_ParentPaths.empty(); }
+
+    // Runs covering [ullOffset, ullOffset + ullLength): adjacent runs from the same source are merged, payload blocks
+    // which follow each other in the file included
+    HRESULT Map(ULONGLONG ullOffset, ULONGLONG ullLength, std::vector<Run>& runs);
+
+    // Read 'cbBytes' at 'ullOffset', bytes beyond the virtual size read as zeroes
+    HRESULT Read(ULONGLONG ullOffset, BYTE* pBuffer, size_t cbBytes);
+
+    virtual ~VirtualDiskImage();
+
+protected:
+    VirtualDiskImage(const std::wstring& strPath);
+
+    HRESULT OpenFile();
+
+    virtual HRESULT Load() PURE;
+
+    // Source of the bytes at 'ullOffset', the run stops at the end of the block or where the source changes
+    virtual HRESULT MapBlock(ULONGLONG ullOffset, ULONGLONG ullLength, Run& run) PURE;
+
+    HRESULT ReadAt(ULONGLONG ullFileOffset, BYTE* pBuffer, size_t cbBytes);
+
+    // Bitmap of 'cbBitmap' bytes at 'ullFileOffset', cached under 'ullKey' until the image is closed
+    HRESULT GetBitmap(ULONGLONG ullKey, ULONGLONG ullFileOffset, ULONG cbBitmap, const BYTE*& pBitmap);
+
+    HRESULT GetParent(std::shared_ptr<VirtualDiskImage>& parent);
+
+    // Resolve a path stored in a parent locator: relative paths are relative to the directory of this image
+    std::wstring ResolvePath(const std::wstring& strPath) const;
+
+    std::wstring m_strPath;
+    HANDLE m_hFile = INVALID_HANDLE_VALUE;
+    ULONGLONG m_ullFileSize = 0LL;
+
+    ULONGLONG m_ullVirtualSize = 0LL;
+    ULONG m_ulBlockSize = 0L;
+
+    // Identifier a child records to link to this image (GUID_NULL when the format has none)
+    GUID m_Identifier = GUID_NULL;
+
+    // Candidate locations of the parent, in order of preference, and the identifier it must have
+    std::vector<std::wstring> m_ParentPaths;
+    GUID m_ParentIdentifier = GUID_NULL;
+
+private:
+    concurrency::critical_section m_csBitmaps;
+    std::vector<std::pair<ULONGLONG, std::unique_ptr<BYTE[]>>> m_Bitmaps;  // sorted by key
+
+    concurrency::critical_section m_csParent;
+    std::shared_ptr<VirtualDiskImage> m_pParent;
+    bool m_bParentResolved = false;
+    HRESULT m_hrParent = E_FAIL;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,128 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "VolumeBlockCache.h"
+
+using namespace Orc;
+
+VolumeBlockCache::VolumeBlockCache(ULONG ulBlockSize, size_t cbMaxBytes)
+    : m_ulBlockSize(ulBlockSize ? ulBlockSize : 4096)
+{
+    const size_t slots = std::max<size_t>(cbMaxBytes / m_ulBlockSize, 1);
+
+    // Slot buffers are allocated on first use: a large limit does not cost anything until blocks are cached
+    m_Slots.resize(slots);
+    m_Index.reserve(slots);
+}
+
+bool VolumeBlockCache::Lookup(ULONGLONG ullBlockOffset, LPBYTE pBuffer, DWORD& dwValidBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    auto it = m_Index.find(ullBlockOffset);
+    if (it == std::end(m_Index))
+    {
+        m_Stats.ullMisses++;
+        return false;
+    }
+
+    auto& slot = m_Slots[it->second];
+    slot.bReferenced = true;
+
+    CopyMemory(pBuffer, slot.Data.get(), slot.dwValidBytes);
+    dwValidBytes = slot.dwValidBytes;
+
+    m_Stats.ullHits++;
+    return true;
+}
+
+size_t VolumeBlockCache::Victim()
+{
+    // Prefer slots that were never used, then sweep clearing reference bits until an unreferenced slot is found
+    for (;;)
+    {
+        auto& slot = m_Slots[m_ClockHand];
+        const auto current = m_ClockHand;
+
+        m_ClockHand = (m_ClockHand + 1) % m_Slots.size();
+
+        if (!slot.bUsed || !slot.bReferenced)
+            return current;
+
+        slot.bReferenced = false;
+    }
+}
+
+void VolumeBlockCache::Insert(ULONGLONG ullBlockOffset, const BYTE* pBuffer, DWORD dwValidBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    dwValidBytes = std::min<DWORD>(dwValidBytes, m_ulBlockSize);
+
+    if (auto it = m_Index.find(ullBlockOffset); it != std::end(m_Index))
+    {
+        // Another reader sharing this cache was faster
+        auto& slot = m_Slots[it->second];
+        CopyMemory(slot.Data.get(), pBuffer, dwValidBytes);
+        slot.dwValidBytes = dwValidBytes;
+        return;
+    }
+
+    const auto index = Victim();
+    auto& slot = m_Slots[index];
+
+    if (slot.bUsed)
+    {
+        m_Index.erase(slot.ullOffset);
+        m_Stats.ullEvictions++;
+    }
+
+    if (slot.Data == nullptr)
+    {
+        slot.Data.reset(new (std::nothrow) BYTE[m_ulBlockSize]);
+        if (slot.Data == nullptr)
+        {
+            slot.bUsed = false;
+            return;
+        }
+
+        m_cbAllocated += m_ulBlockSize;
+        m_Stats.cbPeakBytes = std::max(m_Stats.cbPeakBytes, m_cbAllocated);
+    }
+
+    CopyMemory(slot.Data.get(), pBuffer, dwValidBytes);
+    slot.ullOffset = ullBlockOffset;
+    slot.dwValidBytes = dwValidBytes;
+    slot.bUsed = true;
+    slot.bReferenced = false;
+
+    m_Index[ullBlockOffset] = index;
+    m_Stats.ullInsertions++;
+}
+
+void VolumeBlockCache::Invalidate()
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    for (auto& slot : m_Slots)
+    {
+        slot.bUsed = false;
+        slot.bReferenced = false;
+    }
+
+    m_Index.clear();
+    m_ClockHand = 0;
+}
+
+VolumeBlockCache::Statistics VolumeBlockCache::GetStatistics() const
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+    return m_Stats;
+}
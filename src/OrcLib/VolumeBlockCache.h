@@ -0,0 +1,80 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <concrt.h>
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Fixed size cache of volume blocks (usually one cluster) shared between a volume reader and the readers duplicated
+// from it (ReOpen). Replacement uses the CLOCK algorithm: each hit sets a reference bit, the clock hand clears them
+// until it finds a victim. Access is serialized internally.
+class VolumeBlockCache
+{
+public:
+    static constexpr size_t kDefaultMaxBytes = 64 * 1024 * 1024;
+
+    struct Statistics
+    {
+        ULONGLONG ullHits = 0LL;
+        ULONGLONG ullMisses = 0LL;
+        ULONGLONG ullInsertions = 0LL;
+        ULONGLONG ullEvictions = 0LL;
+        size_t cbPeakBytes = 0;
+    };
+
+    VolumeBlockCache(ULONG ulBlockSize, size_t cbMaxBytes);
+
+    ULONG BlockSize() const { return m_ulBlockSize; }
+    size_t MaxBytes() const { return m_Slots.size() * m_ulBlockSize; }
+
+    // Copy the cached block starting at 'ullBlockOffset' (must be block aligned) into pBuffer (BlockSize() bytes).
+    // dwValidBytes receives the number of valid bytes that were stored for this block.
+    bool Lookup(ULONGLONG ullBlockOffset, LPBYTE pBuffer, DWORD& dwValidBytes);
+
+    // Store a block, dwValidBytes may be less than BlockSize() for the last block of a volume
+    void Insert(ULONGLONG ullBlockOffset, const BYTE* pBuffer, DWORD dwValidBytes);
+
+    void Invalidate();
+
+    Statistics GetStatistics() const;
+
+private:
+    struct Slot
+    {
+        ULONGLONG ullOffset = 0LL;
+        DWORD dwValidBytes = 0L;
+        bool bUsed = false;
+        bool bReferenced = false;
+        std::unique_ptr<BYTE[]> Data;
+    };
+
+    size_t Victim();
+
+    const ULONG m_ulBlockSize;
+
+    mutable concurrency::critical_section m_cs;
+    std::vector<Slot> m_Slots;
+    std::unordered_map<ULONGLONG, size_t> m_Index;
+    size_t m_ClockHand = 0;
+    size_t m_cbAllocated = 0;
+
+    Statistics m_Stats;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,115 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "VolumeReadProfile.h"
+
+#include "OverlappedReadAhead.h"
+
+#include "Log/Log.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto OrcReadProfileEnv = L"DFIR-ORC_READ_PROFILE";
+
+// Chunks are read unbuffered: they must be made of whole sectors
+constexpr DWORD kChunkUnit = 512L;
+constexpr DWORD kMaxChunkSize = 64 * 1024 * 1024L;
+
+VolumeReadProfile GetConfiguredProfile()
+{
+    WCHAR szValue[32] = {0};
+    const auto nbChars = GetEnvironmentVariableW(OrcReadProfileEnv, szValue, ARRAYSIZE(szValue));
+    if (nbChars == 0 || nbChars >= ARRAYSIZE(szValue))
+    {
+        return {};
+    }
+
+    auto profile = VolumeReadProfile::FromString(szValue);
+    if (!profile)
+    {
+        Log::Warn(L"Invalid volume read profile %%{}%%: '{}'", OrcReadProfileEnv, szValue);
+        return {};
+    }
+
+    return *profile;
+}
+
+std::optional<DWORD> ParseValue(std::wstring_view value)
+{
+    if (value.empty() || value.size() > 10)
+        return {};
+
+    DWORD dwValue = 0L;
+    for (const auto c : value)
+    {
+        if (c < L'0' || c > L'9')
+            return {};
+
+        const ULONGLONG ullValue = dwValue * 10ULL + (c - L'0');
+        if (ullValue > MAXDWORD)
+            return {};
+
+        dwValue = static_cast<DWORD>(ullValue);
+    }
+
+    return dwValue;
+}
+
+}  // namespace
+
+VolumeReadProfile& VolumeReadProfile::Instance()
+{
+    static VolumeReadProfile instance(GetConfiguredProfile());
+    return instance;
+}
+
+HRESULT VolumeReadProfile::Configure(const VolumeReadProfile& profile)
+{
+    m_dwChunkSize = profile.m_dwChunkSize;
+    m_dwQueueDepth = profile.m_dwQueueDepth;
+
+    const auto strValue = ToString();
+    if (!SetEnvironmentVariableW(OrcReadProfileEnv, strValue.c_str()))
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to set %%{}%% to '{}' [{}]", OrcReadProfileEnv, strValue, SystemError(hr));
+        return hr;
+    }
+
+    Log::Info(L"Volume reads keep up to {} reads of {} bytes in flight", m_dwQueueDepth, m_dwChunkSize);
+    return S_OK;
+}
+
+std::wstring VolumeReadProfile::ToString() const
+{
+    return std::to_wstring(m_dwChunkSize) + L':' + std::to_wstring(m_dwQueueDepth);
+}
+
+std::optional<VolumeReadProfile> VolumeReadProfile::FromString(std::wstring_view profile)
+{
+    const auto pos = profile.find(L':');
+    if (pos == std::wstring_view::npos)
+        return {};
+
+    const auto chunkSize = ParseValue(profile.substr(0, pos));
+    const auto queueDepth = ParseValue(profile.substr(pos + 1));
+    if (!chunkSize || !queueDepth)
+        return {};
+
+    if (*chunkSize == 0L || *chunkSize % kChunkUnit || *chunkSize > kMaxChunkSize)
+        return {};
+
+    if (*queueDepth == 0L || *queueDepth > OverlappedReadAhead::kMaxQueueDepth)
+        return {};
+
+    return VolumeReadProfile(*chunkSize, *queueDepth);
+}
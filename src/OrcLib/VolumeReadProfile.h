@@ -0,0 +1,57 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#pragma once
+
+#include "OrcLib.h"
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Read-ahead settings of the sequential volume reads of the walkers ($MFT, USN journal): the size of the overlapped
+// reads kept in flight and their number. Zero values are the OverlappedReadAhead defaults.
+//
+// 'NTFSUtil /bench' measures the readers of a host and recommends a profile, which is given to the tools with
+// /read_profile=<ChunkSize>:<QueueDepth> or %DFIR-ORC_READ_PROFILE% (inherited by child processes).
+class VolumeReadProfile
+{
+public:
+    static VolumeReadProfile& Instance();
+
+    VolumeReadProfile() = default;
+    VolumeReadProfile(DWORD dwChunkSize, DWORD dwQueueDepth)
+        : m_dwChunkSize(dwChunkSize)
+        , m_dwQueueDepth(dwQueueDepth)
+    {
+    }
+
+    // Use 'profile' for the reads of this process and of the processes it creates
+    HRESULT Configure(const VolumeReadProfile& profile);
+
+    DWORD ChunkSize() const { return m_dwChunkSize; }
+    DWORD QueueDepth() const { return m_dwQueueDepth; }
+
+    bool IsDefault() const { return m_dwChunkSize == 0L && m_dwQueueDepth == 0L; }
+
+    // "<ChunkSize>:<QueueDepth>", the chunk size in bytes
+    std::wstring ToString() const;
+    static std::optional<VolumeReadProfile> FromString(std::wstring_view profile);
+
+private:
+    DWORD m_dwChunkSize = 0L;
+    DWORD m_dwQueueDepth = 0L;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
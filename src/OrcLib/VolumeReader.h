@@ -53,6 +53,12 @@ public:
     virtual ULONG GetBytesPerCluster() const { return m_BytesPerCluster; }
     virtual ULONG GetBytesPerSector() const { return m_BytesPerSector; }
 
+    // Size of the volume as its boot sector describes it, 0 if unknown
+    ULONGLONG GetVolumeSize() const { return static_cast<ULONGLONG>(m_NumberOfSectors) * m_BytesPerSector; }
+
+    // Largest read the underlying device accepts at once, 0 if unknown
+    virtual ULONG GetMaxTransferLength() const { return 0L; }
+
     virtual HRESULT Seek(ULONGLONG offset) PURE;
     virtual HRESULT Read(ULONGLONG offset, CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) = 0;
     virtual HRESULT Read(CBinaryBuffer& data, ULONGLONG ullBytesToRead, ULONGLONG& ullBytesRead) = 0;
@@ -65,6 +71,13 @@ public:
 
     virtual std::shared_ptr<VolumeReader> ReOpen(DWORD dwDesiredAccess, DWORD dwShareMode, DWORD dwFlags) PURE;
 
+    // Keep up to dwQueueDepth overlapped reads in flight when sequential reads are detected
+    virtual HRESULT EnableReadAhead(DWORD dwQueueDepth, DWORD dwChunkSize = 0L) { return E_NOTIMPL; }
+    virtual void DisableReadAhead() {}
+
+    // Cache of recently read blocks, shared with the readers created by ReOpen
+    virtual HRESULT EnableBlockCache(size_t cbMaxBytes) { return E_NOTIMPL; }
+
     virtual ~VolumeReader() {}
 
 protected:
@@ -11,6 +11,7 @@
 #include "VolumeShadowCopies.h"
 
 #include "Location.h"
+#include "LocationCache.h"
 
 #include "SystemDetails.h"
 
@@ -80,6 +81,14 @@ HRESULT VolumeShadowCopies::EnumerateShadows(std::vector<Shadow>& shadows)
         return S_OK;
     }
 
+    if (auto cached = LocationCache::LoadShadows())
+    {
+        shadows.insert(std::end(shadows), std::begin(*cached), std::end(*cached));
+        return S_OK;
+    }
+
+    const auto firstShadow = shadows.size();
+
     try
     {
         m_vssapi = ExtensionLibrary::GetLibrary<VssAPIExtension>();
@@ -174,6 +183,8 @@ HRESULT VolumeShadowCopies::EnumerateShadows(std::vector<Shadow>& shadows)
         Log::Error("System Exception during snapshot enumeration: {}", e.what());
         return E_FAIL;
     }
+
+    LocationCache::SaveShadows(LocationCache::Shadows(std::cbegin(shadows) + firstShadow, std::cend(shadows)));
     return S_OK;
 }
 
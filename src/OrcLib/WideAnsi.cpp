@@ -10,6 +10,7 @@
 
 #include "WideAnsi.h"
 #include "BinaryBuffer.h"
+#include "Text/Utf16ToUtf8.h"
 
 #include <boost/io/ios_state.hpp>
 
@@ -96,86 +97,13 @@ Orc::WideToAnsi(__in PCWSTR pwszSrc, __out_ecount(cchDest) PSTR pszDest, __in DW
 
 HRESULT Orc::WideToAnsi(__in const std::wstring& src, std::string& dest)
 {
-    boost::io::ios_flags_saver fs(std::cerr);
-    if (src.empty())
-    {
-        dest.clear();
-        return S_OK;
-    }
-
-    int cbNeeded = 0;
-    if (0
-        == (cbNeeded =
-                WideCharToMultiByte(CP_UTF8, 0, src.c_str(), static_cast<int>(src.size()), NULL, 0L, NULL, NULL)))
-    {
-        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-        Log::Error("WideCharToMultiByte failed [{}]", SystemError(hr));
-        return hr;
-    }
-
-    std::vector<CHAR> buffer;
-
-    buffer.reserve(cbNeeded);
-    buffer.resize(cbNeeded);
-    if (0
-        == (cbNeeded = WideCharToMultiByte(
-                CP_UTF8,
-                0,
-                src.c_str(),
-                static_cast<int>(src.size()),
-                buffer.data(),
-                static_cast<int>(buffer.size()),
-                NULL,
-                NULL)))
-    {
-        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-        Log::Error("WideCharToMultiByte failed [{}]", SystemError(hr));
-        return hr;
-    }
-
-    dest.assign(buffer.data(), buffer.size());
-    return S_OK;
+    return WideToAnsi(std::wstring_view(src), dest);
 }
 
 HRESULT Orc::WideToAnsi(__in std::wstring_view src, std::string& dest)
 {
-    boost::io::ios_flags_saver fs(std::cerr);
-    if (src.empty())
-    {
-        dest.clear();
-        return S_OK;
-    }
-
-    int cbNeeded = 0;
-    if (0
-        == (cbNeeded = WideCharToMultiByte(CP_UTF8, 0, src.data(), static_cast<int>(src.size()), NULL, 0L, NULL, NULL)))
-    {
-        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-        Log::Error("WideCharToMultiByte failed [{}]", SystemError(hr));
-        return hr;
-    }
-
-    std::vector<CHAR> buffer;
-
-    buffer.reserve(cbNeeded);
-    buffer.resize(cbNeeded);
-    if (0
-        == (cbNeeded = WideCharToMultiByte(
-                CP_UTF8,
-                0,
-                src.data(),
-                static_cast<int>(src.size()),
-                buffer.data(),
-                static_cast<int>(buffer.size()),
-                NULL,
-                NULL)))
-    {
-        HRESULT hr = HRESULT_FROM_WIN32(GetLastError());
-        Log::Error("WideCharToMultiByte failed [{}]", SystemError(hr));
-        return hr;
-    }
-
-    dest.assign(buffer.data(), buffer.size());
+    dest.clear();
+    Text::AppendUtf16ToUtf8(src, dest);
     return S_OK;
 }
 
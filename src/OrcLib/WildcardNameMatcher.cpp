@@ -0,0 +1,356 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+
+#include "stdafx.h"
+
+#include "WildcardNameMatcher.h"
+
+#include "CaseInsensitive.h"
+
+#include <algorithm>
+#include <deque>
+
+using namespace Orc;
+
+namespace {
+
+constexpr ULONG kNoState = MAXULONG;
+
+WCHAR Fold(WCHAR c)
+{
+    return UpcaseTable()[c];
+}
+
+void Fold(LPWSTR szBuffer, size_t cchLength)
+{
+    const auto& upcase = UpcaseTable();
+    for (size_t i = 0; i < cchLength; i++)
+        szBuffer[i] = upcase[szBuffer[i]];
+}
+
+std::wstring Widen(std::string_view text)
+{
+    std::wstring wide(text.size(), L'\0');
+    std::transform(std::cbegin(text), std::cend(text), std::begin(wide), [](char c) {
+        return static_cast<WCHAR>(static_cast<unsigned char>(c));
+    });
+    return wide;
+}
+
+bool Glob(std::wstring_view spec, std::wstring_view name)
+{
+    // Greedy matching: on mismatch, only the last '*' is retried, which keeps it quadratic at worst
+    size_t s = 0, n = 0;
+    size_t star = std::wstring_view::npos, mark = 0;
+
+    while (n < name.size())
+    {
+        if (s < spec.size() && (spec[s] == L'?' || spec[s] == name[n]))
+        {
+            s++;
+            n++;
+        }
+        else if (s < spec.size() && spec[s] == L'*')
+        {
+            star = s++;
+            mark = n;
+        }
+        else if (star != std::wstring_view::npos)
+        {
+            s = star + 1;
+            n = ++mark;
+        }
+        else
+            return false;
+    }
+
+    while (s < spec.size() && spec[s] == L'*')
+        s++;
+
+    return s == spec.size();
+}
+
+// Specs with several patterns separated by ';' or with a trailing '.' follow rules of PathMatchSpec that are not
+// reproduced
+bool IsSupportedSpec(std::wstring_view spec)
+{
+    return !spec.empty() && spec.find(L';') == std::wstring_view::npos && spec.back() != L'.';
+}
+
+// Upper case copy of 'spec' with consecutive '*' collapsed, "*.*" matches any name like with PathMatchSpec
+std::wstring FoldSpec(std::wstring_view spec)
+{
+    if (spec == L"*.*")
+        return L"*";
+
+    std::wstring folded;
+    folded.reserve(spec.size());
+    for (const auto c : spec)
+    {
+        if (c == L'*' && !folded.empty() && folded.back() == L'*')
+            continue;
+        folded.push_back(c);
+    }
+
+    Fold(folded.data(), folded.size());
+    return folded;
+}
+
+}  // namespace
+
+bool WildcardNameMatcher::Add(std::wstring_view spec, size_t id)
+{
+    if (!IsSupportedSpec(spec))
+        return false;
+
+    Pattern pattern;
+    pattern.Id = id;
+    pattern.Spec = FoldSpec(spec);
+
+    // The longest run of literal characters is what the automaton looks for
+    std::wstring_view fragment;
+    const std::wstring_view folded(pattern.Spec);
+    for (size_t start = 0; start < folded.size();)
+    {
+        const auto end = std::min(folded.find_first_of(L"*?", start), folded.size());
+        if (end - start > fragment.size())
+            fragment = folded.substr(start, end - start);
+        start = end + 1;
+    }
+
+    m_Fragments.emplace_back(fragment);
+    m_Patterns.push_back(std::move(pattern));
+    m_bCompiled = false;
+    return true;
+}
+
+ULONG WildcardNameMatcher::AddState()
+{
+    m_States.emplace_back();
+    return static_cast<ULONG>(m_States.size() - 1);
+}
+
+ULONG WildcardNameMatcher::Transition(ULONG ulState, WCHAR c) const
+{
+    const auto& next = m_States[ulState].Next;
+    auto it = std::lower_bound(
+        std::cbegin(next), std::cend(next), c, [](const auto& item, WCHAR value) { return item.first < value; });
+
+    if (it == std::cend(next) || it->first != c)
+        return kNoState;
+
+    return it->second;
+}
+
+void WildcardNameMatcher::Compile()
+{
+    m_States.clear();
+    m_AlwaysVerify.clear();
+    AddState();
+
+    // Trie of the literal fragments
+    for (ULONG i = 0; i < m_Patterns.size(); i++)
+    {
+        const auto& fragment = m_Fragments[i];
+        if (fragment.empty())
+        {
+            m_AlwaysVerify.push_back(i);
+            continue;
+        }
+
+        ULONG ulState = 0L;
+        for (const auto c : fragment)
+        {
+            auto ulNext = Transition(ulState, c);
+            if (ulNext == kNoState)
+            {
+                ulNext = AddState();
+
+                auto& next = m_States[ulState].Next;
+                auto it = std::lower_bound(std::begin(next), std::end(next), c, [](const auto& item, WCHAR value) {
+                    return item.first < value;
+                });
+                next.emplace(it, c, ulNext);
+            }
+            ulState = ulNext;
+        }
+        m_States[ulState].Outputs.push_back(i);
+    }
+
+    // Breadth first computation of the failure links, outputs are merged so that a match needs no link walking
+    std::deque<ULONG> queue;
+    for (const auto& [c, ulChild] : m_States[0].Next)
+    {
+        m_States[ulChild].Fail = 0L;
+        queue.push_back(ulChild);
+    }
+
+    while (!queue.empty())
+    {
+        const auto ulState = queue.front();
+        queue.pop_front();
+
+        for (size_t i = 0; i < m_States[ulState].Next.size(); i++)
+        {
+            const auto [c, ulChild] = m_States[ulState].Next[i];
+
+            auto ulFail = m_States[ulState].Fail;
+            while (ulFail != 0 && Transition(ulFail, c) == kNoState)
+                ulFail = m_States[ulFail].Fail;
+
+            const auto ulTarget = Transition(ulFail, c);
+            m_States[ulChild].Fail = (ulTarget != kNoState && ulTarget != ulChild) ? ulTarget : 0L;
+
+            const auto& inherited = m_States[m_States[ulChild].Fail].Outputs;
+            m_States[ulChild].Outputs.insert(
+                std::end(m_States[ulChild].Outputs), std::cbegin(inherited), std::cend(inherited));
+
+            queue.push_back(ulChild);
+        }
+    }
+
+    m_bCompiled = true;
+}
+
+void WildcardNameMatcher::Match(std::wstring_view name, std::vector<size_t>& matches) const
+{
+    _ASSERT(m_bCompiled);
+    if (!m_bCompiled || m_Patterns.empty())
+        return;
+
+    // NTFS names are at most 255 characters, longer names (full paths) use the heap
+    WCHAR szStackBuffer[MAX_PATH];
+    std::wstring heapBuffer;
+    LPWSTR szFolded = szStackBuffer;
+    if (name.size() > _countof(szStackBuffer))
+    {
+        heapBuffer.assign(name);
+        szFolded = heapBuffer.data();
+    }
+    else
+        std::copy(std::cbegin(name), std::cend(name), szFolded);
+
+    Fold(szFolded, name.size());
+    const std::wstring_view folded(szFolded, name.size());
+
+    std::vector<ULONG> candidates;
+    ULONG ulState = 0L;
+    for (const auto c : folded)
+    {
+        auto ulNext = Transition(ulState, c);
+        while (ulNext == kNoState && ulState != 0)
+        {
+            ulState = m_States[ulState].Fail;
+            ulNext = Transition(ulState, c);
+        }
+        ulState = ulNext == kNoState ? 0L : ulNext;
+
+        const auto& outputs = m_States[ulState].Outputs;
+        candidates.insert(std::end(candidates), std::cbegin(outputs), std::cend(outputs));
+    }
+
+    candidates.insert(std::end(candidates), std::cbegin(m_AlwaysVerify), std::cend(m_AlwaysVerify));
+    if (candidates.empty())
+        return;
+
+    std::sort(std::begin(candidates), std::end(candidates));
+    candidates.erase(std::unique(std::begin(candidates), std::end(candidates)), std::end(candidates));
+
+    for (const auto index : candidates)
+    {
+        if (Glob(m_Patterns[index].Spec, folded))
+            matches.push_back(m_Patterns[index].Id);
+    }
+}
+
+void WildcardNameMatcher::Clear()
+{
+    m_Patterns.clear();
+    m_Fragments.clear();
+    m_AlwaysVerify.clear();
+    m_States.clear();
+    m_bCompiled = false;
+}
+
+WildcardPattern::WildcardPattern(std::wstring_view spec)
+    : m_Original(spec)
+{
+    if (spec.empty())
+        return;
+
+    if (!IsSupportedSpec(spec))
+    {
+        m_bFallback = true;
+        return;
+    }
+
+    m_Spec = FoldSpec(spec);
+
+    const auto first = m_Spec.find(L'*');
+    m_bStar = first != std::wstring::npos;
+    m_cchPrefix = m_bStar ? first : m_Spec.size();
+    m_cchSuffix = m_bStar ? m_Spec.size() - m_Spec.rfind(L'*') - 1 : 0;
+    m_cchMin = m_Spec.size() - std::count(std::cbegin(m_Spec), std::cend(m_Spec), L'*');
+}
+
+bool WildcardPattern::Match(std::wstring_view name) const
+{
+    if (m_bFallback)
+        return PathMatchSpecW(std::wstring(name).c_str(), m_Original.c_str());
+
+    if (m_Spec.empty() || name.size() < m_cchMin || (!m_bStar && name.size() != m_cchMin))
+        return false;
+
+    const auto matchChar = [](WCHAR spec, WCHAR c) { return spec == L'?' || spec == Fold(c); };
+
+    // Literal prefix and suffix are checked in place before the name is folded for the glob of the middle
+    for (size_t i = 0; i < m_cchPrefix; i++)
+    {
+        if (!matchChar(m_Spec[i], name[i]))
+            return false;
+    }
+
+    for (size_t i = 1; i <= m_cchSuffix; i++)
+    {
+        if (!matchChar(m_Spec[m_Spec.size() - i], name[name.size() - i]))
+            return false;
+    }
+
+    if (!m_bStar)
+        return true;
+
+    const auto spec = std::wstring_view(m_Spec).substr(m_cchPrefix, m_Spec.size() - m_cchPrefix - m_cchSuffix);
+    if (spec == L"*")
+        return true;
+
+    const auto middle = name.substr(m_cchPrefix, name.size() - m_cchPrefix - m_cchSuffix);
+
+    WCHAR szStackBuffer[MAX_PATH];
+    std::wstring heapBuffer;
+    LPWSTR szFolded = szStackBuffer;
+    if (middle.size() > _countof(szStackBuffer))
+    {
+        heapBuffer.assign(middle);
+        szFolded = heapBuffer.data();
+    }
+    else
+        std::copy(std::cbegin(middle), std::cend(middle), szFolded);
+
+    Fold(szFolded, middle.size());
+    return Glob(spec, std::wstring_view(szFolded, middle.size()));
+}
+
+WildcardPattern::WildcardPattern(std::string_view spec)
+    : WildcardPattern(Widen(spec))
+{
+}
+
+bool WildcardPattern::Match(std::string_view name) const
+{
+    return Match(std::wstring_view(Widen(name)));
+}
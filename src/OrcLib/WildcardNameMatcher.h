@@ -0,0 +1,103 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Matches a name against a whole set of PathMatchSpec like specs ('*' and '?' wildcards, case insensitive) in one
+// pass: the longest literal fragment of each spec is looked up with an Aho-Corasick automaton and only the specs
+// whose fragment occurs in the name are verified. Specs without any literal fragment (e.g. "*" or "???") are always
+// verified.
+class WildcardNameMatcher
+{
+public:
+    WildcardNameMatcher() = default;
+    WildcardNameMatcher(const WildcardNameMatcher&) = delete;
+    WildcardNameMatcher& operator=(const WildcardNameMatcher&) = delete;
+
+    // Register a spec identified by 'id'. Returns false if the spec uses a syntax this matcher does not reproduce
+    // exactly (multiple specs separated by ';', trailing '.'): such specs must still be evaluated by the caller.
+    bool Add(std::wstring_view spec, size_t id);
+
+    // Build the automaton: must be called after the last Add and before Match
+    void Compile();
+
+    // Append the identifiers of the specs matching 'name' to 'matches' (each identifier at most once)
+    void Match(std::wstring_view name, std::vector<size_t>& matches) const;
+
+    void Clear();
+
+    bool empty() const { return m_Patterns.empty(); }
+    size_t size() const { return m_Patterns.size(); }
+
+private:
+    struct Pattern
+    {
+        std::wstring Spec;  // upper case, consecutive '*' collapsed
+        size_t Id;
+    };
+
+    struct State
+    {
+        std::vector<std::pair<WCHAR, ULONG>> Next;  // sorted by character
+        ULONG Fail = 0L;
+        std::vector<ULONG> Outputs;  // patterns whose literal fragment ends here (including via fail links)
+    };
+
+    ULONG Transition(ULONG ulState, WCHAR c) const;
+    ULONG AddState();
+
+    std::vector<Pattern> m_Patterns;
+    std::vector<std::wstring> m_Fragments;  // per pattern, empty when the spec is only made of wildcards
+    std::vector<ULONG> m_AlwaysVerify;
+    std::vector<State> m_States;
+    bool m_bCompiled = false;
+};
+
+// A single PathMatchSpec like spec compiled for repeated matching: the literal prefix and suffix of the spec reject
+// most names before the glob of the part between its first and last '*'. Case folding uses a table built once with the
+// same rules as PathMatchSpec. Specs with a syntax this class does not reproduce exactly (multiple specs separated by
+// ';', trailing '.') are still matched with PathMatchSpec.
+class WildcardPattern
+{
+public:
+    WildcardPattern() = default;
+    explicit WildcardPattern(std::wstring_view spec);
+
+    // ANSI specs and names are widened byte per byte (yara rule identifiers are ASCII)
+    explicit WildcardPattern(std::string_view spec);
+
+    bool Match(std::wstring_view name) const;
+    bool Match(std::string_view name) const;
+
+    bool empty() const { return m_Original.empty(); }
+    const std::wstring& Spec() const { return m_Original; }
+
+private:
+    std::wstring m_Original;
+    std::wstring m_Spec;  // upper case, consecutive '*' collapsed
+
+    size_t m_cchPrefix = 0;  // characters before the first '*' (the whole spec without '*')
+    size_t m_cchSuffix = 0;  // characters after the last '*'
+    size_t m_cchMin = 0;  // characters which are not '*'
+    bool m_bStar = false;
+    bool m_bFallback = false;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
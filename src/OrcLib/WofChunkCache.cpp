@@ -0,0 +1,143 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "WofChunkCache.h"
+
+#include <algorithm>
+
+using namespace Orc;
+
+WofChunkCache& WofChunkCache::Instance()
+{
+    static WofChunkCache cache;
+    return cache;
+}
+
+void WofChunkCache::SetMaxBytes(size_t cbMaxBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    m_cbMaxBytes = cbMaxBytes;
+    Evict(m_cbMaxBytes);
+
+    if (m_cbMaxBytes == 0)
+    {
+        m_FileIds.clear();
+    }
+}
+
+size_t WofChunkCache::MaxBytes() const
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+    return m_cbMaxBytes;
+}
+
+ULONGLONG WofChunkCache::GetFileId(const std::wstring& strVolume, ULONGLONG ullFRN)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    const auto id = static_cast<ULONGLONG>(m_FileIds.size());
+    return m_FileIds.try_emplace(std::make_pair(strVolume, ullFRN), id).first->second;
+}
+
+bool WofChunkCache::Contains(ULONGLONG ullFileId, ULONGLONG ullChunk) const
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+    return m_Index.find({ullFileId, ullChunk}) != std::cend(m_Index);
+}
+
+bool WofChunkCache::Lookup(ULONGLONG ullFileId, ULONGLONG ullChunk, LPBYTE pBuffer, DWORD& dwValidBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    auto it = m_Index.find({ullFileId, ullChunk});
+    if (it == std::end(m_Index))
+    {
+        m_Stats.ullMisses++;
+        return false;
+    }
+
+    // Move to the front of the list: the most recently used
+    m_Chunks.splice(std::begin(m_Chunks), m_Chunks, it->second);
+
+    const auto& chunk = *it->second;
+    CopyMemory(pBuffer, chunk.Data.get(), chunk.dwValidBytes);
+    dwValidBytes = chunk.dwValidBytes;
+
+    m_Stats.ullHits++;
+    return true;
+}
+
+void WofChunkCache::Evict(size_t cbMaxBytes)
+{
+    while (m_cbBytes > cbMaxBytes && !m_Chunks.empty())
+    {
+        const auto& victim = m_Chunks.back();
+        m_cbBytes -= victim.dwValidBytes;
+        m_Index.erase(victim.key);
+        m_Chunks.pop_back();
+        m_Stats.ullEvictions++;
+    }
+}
+
+void WofChunkCache::Insert(ULONGLONG ullFileId, ULONGLONG ullChunk, const BYTE* pBuffer, DWORD dwValidBytes)
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+
+    if (dwValidBytes == 0 || dwValidBytes > m_cbMaxBytes)
+    {
+        return;
+    }
+
+    const Key key {ullFileId, ullChunk};
+    if (m_Index.find(key) != std::end(m_Index))
+    {
+        // Another stream of the same file was faster
+        return;
+    }
+
+    Evict(m_cbMaxBytes - dwValidBytes);
+
+    Chunk chunk;
+    chunk.key = key;
+    chunk.dwValidBytes = dwValidBytes;
+    chunk.Data.reset(new (std::nothrow) BYTE[dwValidBytes]);
+    if (chunk.Data == nullptr)
+    {
+        return;
+    }
+
+    CopyMemory(chunk.Data.get(), pBuffer, dwValidBytes);
+
+    m_Chunks.push_front(std::move(chunk));
+    m_Index[key] = std::begin(m_Chunks);
+    m_cbBytes += dwValidBytes;
+
+    m_Stats.ullInsertions++;
+    m_Stats.cbPeakBytes = std::max(m_Stats.cbPeakBytes, m_cbBytes);
+}
+
+WofChunkCache::Statistics WofChunkCache::GetStatistics() const
+{
+    concurrency::critical_section::scoped_lock sl(m_cs);
+    return m_Stats;
+}
+
+void WofChunkCache::LogStatistics() const
+{
+    const auto statistics = GetStatistics();
+
+    Log::Debug(
+        "WofChunkCache: {} hits, {} misses, {} insertions, {} evictions, peak: {} bytes",
+        statistics.ullHits,
+        statistics.ullMisses,
+        statistics.ullInsertions,
+        statistics.ullEvictions,
+        statistics.cbPeakBytes);
+}
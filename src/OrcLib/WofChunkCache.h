@@ -0,0 +1,109 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include <concrt.h>
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Process wide cache of decompressed WOF chunks, keyed by file and chunk index.
+//
+// A WOF compressed file is usually opened several times in a run (FileFind header, contains and yara terms, then the
+// sample collection): each open creates its own UncompressWofStream which finds the chunks decoded by the previous ones
+// here. Least recently used chunks are evicted to stay under the size limit. The cache is disabled (size 0) by default.
+// Access is serialized internally.
+class WofChunkCache
+{
+public:
+    struct Statistics
+    {
+        ULONGLONG ullHits = 0LL;
+        ULONGLONG ullMisses = 0LL;
+        ULONGLONG ullInsertions = 0LL;
+        ULONGLONG ullEvictions = 0LL;
+        size_t cbPeakBytes = 0;
+    };
+
+    static WofChunkCache& Instance();
+
+    // Evicts chunks when shrinking, 0 disables the cache and releases every chunk
+    void SetMaxBytes(size_t cbMaxBytes);
+    size_t MaxBytes() const;
+    bool IsEnabled() const { return MaxBytes() > 0; }
+
+    // Identifier of a file for the methods below: its volume (the reader location, distinct for each snapshot) and its
+    // file reference number (segment and sequence numbers)
+    ULONGLONG GetFileId(const std::wstring& strVolume, ULONGLONG ullFRN);
+
+    bool Contains(ULONGLONG ullFileId, ULONGLONG ullChunk) const;
+
+    // Copy the cached chunk into pBuffer which must hold the chunk size of the file's algorithm
+    bool Lookup(ULONGLONG ullFileId, ULONGLONG ullChunk, LPBYTE pBuffer, DWORD& dwValidBytes);
+
+    void Insert(ULONGLONG ullFileId, ULONGLONG ullChunk, const BYTE* pBuffer, DWORD dwValidBytes);
+
+    Statistics GetStatistics() const;
+    void LogStatistics() const;
+
+private:
+    struct Key
+    {
+        ULONGLONG ullFileId;
+        ULONGLONG ullChunk;
+
+        bool operator==(const Key& other) const
+        {
+            return ullFileId == other.ullFileId && ullChunk == other.ullChunk;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            return std::hash<ULONGLONG>()(key.ullFileId * 0x9E3779B97F4A7C15ULL ^ key.ullChunk);
+        }
+    };
+
+    struct Chunk
+    {
+        Key key;
+        DWORD dwValidBytes = 0L;
+        std::unique_ptr<BYTE[]> Data;
+    };
+
+    using ChunkList = std::list<Chunk>;
+
+    WofChunkCache() = default;
+
+    void Evict(size_t cbMaxBytes);
+
+    mutable concurrency::critical_section m_cs;
+    size_t m_cbMaxBytes = 0;
+    size_t m_cbBytes = 0;
+
+    ChunkList m_Chunks;  // Most recently used first
+    std::unordered_map<Key, ChunkList::iterator, KeyHash> m_Index;
+    std::map<std::pair<std::wstring, ULONGLONG>, ULONGLONG> m_FileIds;
+
+    Statistics m_Stats;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -0,0 +1,387 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "XmlEmitter.h"
+
+#include "ByteStream.h"
+#include "StructuredOutputBuffer.h"
+#include "Text/Escape.h"
+#include "Unicode.h"
+#include "XmlLiteExtension.h"
+
+#include <xmllite.h>
+
+#include <vector>
+
+using namespace std::string_view_literals;
+using namespace Orc;
+using namespace Orc::StructuredOutput;
+using namespace Orc::StructuredOutput::XML;
+
+namespace {
+
+// Check 'text' against 'table', which only holds code units: surrogates are valid when paired
+HRESULT CheckText(std::wstring_view text, const IsUnicodeValidTable& table)
+{
+    for (size_t i = table.FindInvalid(text); i < text.size(); i += 1 + table.FindInvalid(text.substr(i + 1)))
+    {
+        if (IS_HIGH_SURROGATE(text[i]) && i + 1 < text.size() && IS_LOW_SURROGATE(text[i + 1]))
+        {
+            i++;
+            continue;
+        }
+
+        return WC_E_XMLCHARACTER;
+    }
+
+    return S_OK;
+}
+
+template <typename CharT>
+class BufferedEmitter : public Emitter
+{
+public:
+    BufferedEmitter(std::shared_ptr<ByteStream> stream)
+        : m_output(std::move(stream))
+    {
+    }
+
+    ~BufferedEmitter() { m_output.Flush(); }
+
+    HRESULT WriteStartDocument() override
+    {
+        if (!m_bEmpty)
+            return WR_E_INVALIDACTION;
+
+        m_bEmpty = false;
+
+        if constexpr (sizeof(CharT) == sizeof(char))
+        {
+            if (auto hr = m_output.Append("\xEF\xBB\xBF"sv); FAILED(hr))
+                return hr;
+            return m_output.AppendAscii("<?xml version=\"1.0\" encoding=\"utf-8\"?>"sv);
+        }
+        else
+        {
+            if (auto hr = m_output.Put(0xFEFF); FAILED(hr))
+                return hr;
+            return m_output.AppendAscii("<?xml version=\"1.0\" encoding=\"utf-16\"?>"sv);
+        }
+    }
+
+    HRESULT WriteStartElement(LPCWSTR szName) override
+    {
+        std::basic_string_view<CharT> name;
+        if (auto hr = m_names.Get(szName, name, EncodeName); FAILED(hr))
+            return hr;
+
+        if (auto hr = CloseStartTag(); FAILED(hr))
+            return hr;
+
+        bool bMixed = false;
+        if (m_depth > 0)
+        {
+            auto& parent = m_elements[m_depth - 1];
+            parent.bHasChildren = true;
+            bMixed = parent.bMixed;
+        }
+
+        if (!bMixed)
+        {
+            if (auto hr = Indent(m_depth); FAILED(hr))
+                return hr;
+        }
+
+        if (auto hr = m_output.Put('<'); FAILED(hr))
+            return hr;
+        if (auto hr = m_output.Append(name); FAILED(hr))
+            return hr;
+
+        if (m_elements.size() == m_depth)
+            m_elements.emplace_back();
+
+        auto& element = m_elements[m_depth++];
+        element.Name.assign(name);
+        element.bHasChildren = false;
+        element.bMixed = bMixed;
+
+        m_bStartTagOpen = true;
+        return S_OK;
+    }
+
+    HRESULT WriteEndElement() override
+    {
+        if (m_depth == 0)
+            return WR_E_INVALIDACTION;
+
+        const auto& element = m_elements[--m_depth];
+
+        if (m_bStartTagOpen)
+        {
+            m_bStartTagOpen = false;
+            return m_output.AppendAscii(" />"sv);
+        }
+
+        if (element.bHasChildren && !element.bMixed)
+        {
+            if (auto hr = Indent(m_depth); FAILED(hr))
+                return hr;
+        }
+
+        if (auto hr = m_output.AppendAscii("</"sv); FAILED(hr))
+            return hr;
+        if (auto hr = m_output.Append(element.Name); FAILED(hr))
+            return hr;
+        return m_output.Put('>');
+    }
+
+    HRESULT WriteAttributeString(LPCWSTR szName, std::wstring_view value) override
+    {
+        if (!m_bStartTagOpen)
+            return WR_E_INVALIDACTION;
+
+        std::basic_string_view<CharT> name;
+        if (auto hr = m_names.Get(szName, name, EncodeName); FAILED(hr))
+            return hr;
+
+        if (auto hr = CheckText(value, xml_attr_value_table); FAILED(hr))
+            return hr;
+
+        if (auto hr = m_output.Put(' '); FAILED(hr))
+            return hr;
+        if (auto hr = m_output.Append(name); FAILED(hr))
+            return hr;
+        if (auto hr = m_output.AppendAscii("=\""sv); FAILED(hr))
+            return hr;
+        if (auto hr = Text::AppendXmlEscaped(value, true, m_output); FAILED(hr))
+            return hr;
+        return m_output.Put('"');
+    }
+
+    HRESULT WriteString(std::wstring_view text) override
+    {
+        if (m_depth == 0)
+            return WR_E_INVALIDACTION;
+
+        if (auto hr = CheckText(text, xml_string_table); FAILED(hr))
+            return hr;
+
+        if (auto hr = CloseStartTag(); FAILED(hr))
+            return hr;
+
+        m_elements[m_depth - 1].bMixed = true;
+        return Text::AppendXmlEscaped(text, false, m_output);
+    }
+
+    HRESULT WriteComment(std::wstring_view comment) override
+    {
+        if (auto hr = CheckText(comment, xml_comment_table); FAILED(hr))
+            return hr;
+
+        if (comment.find(L"--"sv) != std::wstring_view::npos || (!comment.empty() && comment.back() == L'-'))
+            return WC_E_COMMENT;
+
+        if (auto hr = CloseStartTag(); FAILED(hr))
+            return hr;
+
+        bool bMixed = false;
+        if (m_depth > 0)
+        {
+            auto& parent = m_elements[m_depth - 1];
+            parent.bHasChildren = true;
+            bMixed = parent.bMixed;
+        }
+
+        if (!bMixed)
+        {
+            if (auto hr = Indent(m_depth); FAILED(hr))
+                return hr;
+        }
+
+        if (auto hr = m_output.AppendAscii("<!--"sv); FAILED(hr))
+            return hr;
+        if (auto hr = m_output.AppendText(comment); FAILED(hr))
+            return hr;
+        return m_output.AppendAscii("-->"sv);
+    }
+
+    HRESULT Flush() override { return m_output.Flush(); }
+
+private:
+    struct Element
+    {
+        std::basic_string<CharT> Name;
+        bool bHasChildren = false;
+        bool bMixed = false;
+    };
+
+    static HRESULT EncodeName(std::wstring_view name, std::basic_string<CharT>& encoded)
+    {
+        if (name.empty() || xml_element_table.FindInvalid(name) != name.size())
+            return WC_E_NAMECHARACTER;
+
+        return StringOutput<CharT>(encoded).AppendText(name);
+    }
+
+    HRESULT CloseStartTag()
+    {
+        if (!m_bStartTagOpen)
+            return S_OK;
+
+        m_bStartTagOpen = false;
+        return m_output.Put('>');
+    }
+
+    // Nothing precedes the first node when there is no declaration
+    HRESULT Indent(size_t depth)
+    {
+        if (m_bEmpty)
+        {
+            m_bEmpty = false;
+            return S_OK;
+        }
+
+        if (auto hr = m_output.AppendAscii("\r\n"sv); FAILED(hr))
+            return hr;
+
+        for (size_t i = 0; i < depth; ++i)
+        {
+            if (auto hr = m_output.AppendAscii("  "sv); FAILED(hr))
+                return hr;
+        }
+
+        return S_OK;
+    }
+
+    OutputBuffer<CharT> m_output;
+    NameCache<CharT> m_names;
+
+    // Open elements are m_elements[0, m_depth), entries are kept to reuse their name storage
+    std::vector<Element> m_elements;
+    size_t m_depth = 0;
+
+    bool m_bStartTagOpen = false;
+    bool m_bEmpty = true;
+};
+
+class XmlLiteEmitter : public Emitter
+{
+public:
+    XmlLiteEmitter(std::shared_ptr<XmlLiteExtension> xmllite, CComPtr<IXmlWriter> pWriter)
+        : m_xmllite(std::move(xmllite))
+        , m_pWriter(std::move(pWriter))
+    {
+    }
+
+    HRESULT WriteStartDocument() override { return m_pWriter->WriteStartDocument(XmlStandalone_Omit); }
+
+    HRESULT WriteStartElement(LPCWSTR szName) override { return m_pWriter->WriteStartElement(NULL, szName, NULL); }
+
+    HRESULT WriteEndElement() override { return m_pWriter->WriteEndElement(); }
+
+    HRESULT WriteAttributeString(LPCWSTR szName, std::wstring_view value) override
+    {
+        return m_pWriter->WriteAttributeString(NULL, szName, NULL, Terminated(value));
+    }
+
+    HRESULT WriteString(std::wstring_view text) override { return m_pWriter->WriteString(Terminated(text)); }
+
+    HRESULT WriteComment(std::wstring_view comment) override { return m_pWriter->WriteComment(Terminated(comment)); }
+
+    HRESULT Flush() override { return m_pWriter->Flush(); }
+
+private:
+    LPCWSTR Terminated(std::wstring_view text)
+    {
+        m_value.assign(text);
+        return m_value.c_str();
+    }
+
+    std::shared_ptr<XmlLiteExtension> m_xmllite;
+    CComPtr<IXmlWriter> m_pWriter;
+    std::wstring m_value;
+};
+
+}  // namespace
+
+namespace Orc::StructuredOutput::XML {
+
+std::unique_ptr<Emitter> CreateBufferedEmitter(std::shared_ptr<ByteStream> stream, OutputSpec::Encoding encoding)
+{
+    if (encoding == OutputSpec::Encoding::UTF16)
+        return std::make_unique<BufferedEmitter<WCHAR>>(std::move(stream));
+
+    return std::make_unique<BufferedEmitter<char>>(std::move(stream));
+}
+
+HRESULT CreateXmlLiteEmitter(
+    const std::shared_ptr<ByteStream>& pStream,
+    OutputSpec::Encoding encoding,
+    std::unique_ptr<Emitter>& emitter)
+{
+    HRESULT hr = E_FAIL;
+    CComPtr<IStream> stream;
+
+    if (FAILED(hr = ByteStream::Get_IStream(pStream, &stream)))
+        return hr;
+
+    CComPtr<IXmlWriter> pWriter;
+    CComPtr<IXmlWriterOutput> pWriterOutput;
+
+    auto xmllite = ExtensionLibrary::GetLibrary<XmlLiteExtension>();
+    if (!xmllite)
+    {
+        Log::Error(L"Failed to load xmllite extension library");
+        return E_POINTER;
+    }
+
+    if (FAILED(hr = xmllite->CreateXmlWriter(IID_IXmlWriter, (PVOID*)&pWriter, nullptr)))
+    {
+        XmlLiteExtension::LogError(hr);
+        Log::Error(L"Failed to instantiate Xml writer [{}]", SystemError(hr));
+        return hr;
+    }
+
+    if (encoding == OutputSpec::Encoding::UTF16)
+    {
+        if (FAILED(hr = xmllite->CreateXmlWriterOutputWithEncodingName(stream, nullptr, L"utf-16", &pWriterOutput)))
+        {
+            XmlLiteExtension::LogError(hr);
+            Log::Error(L"Failed to instantiate Xml writer with encoding hint [{}]", SystemError(hr));
+            return hr;
+        }
+        if (FAILED(hr = pWriter->SetOutput(pWriterOutput)))
+        {
+            XmlLiteExtension::LogError(hr);
+            Log::Error(L"Failed to set output stream [{}]", SystemError(hr));
+            return hr;
+        }
+    }
+    else
+    {
+        if (FAILED(hr = pWriter->SetOutput(stream)))
+        {
+            XmlLiteExtension::LogError(hr);
+            Log::Error(L"Failed to set output stream [{}]", SystemError(hr));
+            return hr;
+        }
+    }
+
+    if (FAILED(hr = pWriter->SetProperty(XmlWriterProperty_Indent, TRUE)))
+    {
+        XmlLiteExtension::LogError(hr);
+        Log::Error(L"Failed to set indentation property [{}]", SystemError(hr));
+        return hr;
+    }
+
+    emitter = std::make_unique<XmlLiteEmitter>(std::move(xmllite), std::move(pWriter));
+    return S_OK;
+}
+
+}  // namespace Orc::StructuredOutput::XML
@@ -0,0 +1,64 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "OutputSpec.h"
+
+#include <memory>
+#include <string_view>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+class ByteStream;
+
+namespace StructuredOutput::XML {
+
+//
+// Emitter: XML serialization of XML::Writer.
+//
+// The buffered emitter, used by default, writes into a pooled OutputBuffer: names are validated and encoded once (see
+// NameCache), values are checked and escaped with the Text/Escape.h kernels. Its output is the one of XmlLite with
+// indentation: byte order mark, declaration, CRLF and two spaces per level, " />" for empty elements, no indentation
+// inside mixed content. Characters XmlLite rejects are rejected with the same errors.
+//
+// XmlLite remains available through XML::Options::bXmlLite.
+//
+class Emitter
+{
+public:
+    virtual ~Emitter() = default;
+
+    virtual HRESULT WriteStartDocument() = 0;
+
+    virtual HRESULT WriteStartElement(LPCWSTR szName) = 0;
+    virtual HRESULT WriteEndElement() = 0;
+
+    // Only valid before the content of the current element
+    virtual HRESULT WriteAttributeString(LPCWSTR szName, std::wstring_view value) = 0;
+
+    virtual HRESULT WriteString(std::wstring_view text) = 0;
+    virtual HRESULT WriteComment(std::wstring_view comment) = 0;
+
+    virtual HRESULT Flush() = 0;
+};
+
+std::unique_ptr<Emitter> CreateBufferedEmitter(std::shared_ptr<ByteStream> stream, OutputSpec::Encoding encoding);
+
+HRESULT CreateXmlLiteEmitter(
+    const std::shared_ptr<ByteStream>& stream,
+    OutputSpec::Encoding encoding,
+    std::unique_ptr<Emitter>& emitter);
+
+}  // namespace StructuredOutput::XML
+}  // namespace Orc
+
+#pragma managed(pop)
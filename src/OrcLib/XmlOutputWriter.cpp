@@ -9,8 +9,6 @@
 
 #include "XmlOutputWriter.h"
 
-#include <xmllite.h>
-
 #include "XmlLiteExtension.h"
 #include "OutputSpec.h"
 #include "ByteStream.h"
@@ -24,79 +22,52 @@ using namespace Orc;
 
 Orc::StructuredOutput::XML::Writer::Writer(std::unique_ptr<Orc::StructuredOutput::XML::Options>&& pOptions)
     : StructuredOutput::Writer(std::move(pOptions))
-    , m_pWriter(nullptr)
 {
 }
 
 HRESULT Orc::StructuredOutput::XML::Writer::SetOutput(const std::shared_ptr<ByteStream> pStream)
 {
     HRESULT hr = E_FAIL;
-    CComPtr<IStream> stream;
-
-    if (FAILED(hr = ByteStream::Get_IStream(pStream, &stream)))
-        return hr;
-
-    CComPtr<IXmlWriter> pWriter;
-    CComPtr<IXmlWriterOutput> pWriterOutput;
-
-    m_xmllite = ExtensionLibrary::GetLibrary<XmlLiteExtension>();
-    if (!m_xmllite)
-    {
-        Log::Error(L"Failed to load xmllite extension library");
-        return E_POINTER;
-    }
-
-    if (FAILED(hr = m_xmllite->CreateXmlWriter(IID_IXmlWriter, (PVOID*)&pWriter, nullptr)))
-    {
-        XmlLiteExtension::LogError(hr);
-        Log::Error(L"Failed to instantiate Xml writer [{}]", SystemError(hr));
-        return hr;
-    }
 
     auto options = dynamic_cast<Options*>(m_Options.get());
     auto encoding = options ? options->Encoding : OutputSpec::Encoding::UTF8;
 
-    if (encoding == OutputSpec::Encoding::UTF16)
+    std::unique_ptr<Emitter> emitter;
+    if (options && options->bXmlLite)
     {
-        if (FAILED(hr = m_xmllite->CreateXmlWriterOutputWithEncodingName(stream, nullptr, L"utf-16", &pWriterOutput)))
-        {
-            XmlLiteExtension::LogError(hr);
-            Log::Error(L"Failed to instantiate Xml writer with encoding hint [{}]", SystemError(hr));
+        if (FAILED(hr = CreateXmlLiteEmitter(pStream, encoding, emitter)))
             return hr;
-        }
-        if (FAILED(hr = pWriter->SetOutput(pWriterOutput)))
-        {
-            XmlLiteExtension::LogError(hr);
-            Log::Error(L"Failed to set output stream [{}]", SystemError(hr));
-            return hr;
-        }
     }
     else
     {
-        if (FAILED(hr = pWriter->SetOutput(stream)))
-        {
-            XmlLiteExtension::LogError(hr);
-            Log::Error(L"Failed to set output stream [{}]", SystemError(hr));
-            return hr;
-        }
+        emitter = CreateBufferedEmitter(pStream, encoding);
     }
 
-    if (FAILED(hr = pWriter->SetProperty(XmlWriterProperty_Indent, TRUE)))
+    if (FAILED(hr = emitter->WriteStartDocument()))
     {
         XmlLiteExtension::LogError(hr);
-        Log::Error(L"Failed to set indentation property [{}]", SystemError(hr));
+        Log::Error(L"Failed to write start document [{}]", SystemError(hr));
         return hr;
     }
 
-    if (FAILED(hr = pWriter->WriteStartDocument(XmlStandalone_Omit)))
+    m_pWriter = std::move(emitter);
+
+    return S_OK;
+}
+
+HRESULT Orc::StructuredOutput::XML::Writer::Flush()
+{
+    HRESULT hr = E_FAIL;
+
+    if (m_pWriter == nullptr)
+        return E_POINTER;
+
+    if (FAILED(hr = m_pWriter->Flush()))
     {
         XmlLiteExtension::LogError(hr);
-        Log::Error(L"Failed to write start document [{}]", SystemError(hr));
         return hr;
     }
 
-    m_pWriter = pWriter;
-
     return S_OK;
 }
 
@@ -110,10 +81,10 @@ HRESULT Orc::StructuredOutput::XML::Writer::Close()
     if (FAILED(hr = m_pWriter->Flush()))
     {
         XmlLiteExtension::LogError(hr);
-        m_pWriter.Release();
+        m_pWriter.reset();
         return hr;
     }
-    m_pWriter.Release();
+    m_pWriter.reset();
     return S_OK;
 }
 
@@ -126,7 +97,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::BeginElement(LPCWSTR szElement)
 
     if (szElement)
     {
-        if (FAILED(hr = m_pWriter->WriteStartElement(NULL, szElement, NULL)))
+        if (FAILED(hr = m_pWriter->WriteStartElement(szElement)))
         {
             XmlLiteExtension::LogError(hr);
             return hr;
@@ -135,7 +106,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::BeginElement(LPCWSTR szElement)
     else if (!m_collectionStack.empty())
     {
         // if no element is provided, we use the current collection element name
-        if (FAILED(hr = m_pWriter->WriteStartElement(NULL, m_collectionStack.top().c_str(), NULL)))
+        if (FAILED(hr = m_pWriter->WriteStartElement(m_collectionStack.top().c_str())))
         {
             XmlLiteExtension::LogError(hr);
             return hr;
@@ -225,7 +196,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, LPCWSTR s
     if (m_pWriter == nullptr)
         return E_POINTER;
 
-    if (FAILED(hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, szValue)))
+    if (FAILED(hr = m_pWriter->WriteAttributeString(szName, szValue)))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -321,7 +292,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamedFormated_(
     auto result = fmt::vformat_to(std::back_inserter(buffer), szFormat, args);
     buffer.append(L"\0");
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, buffer.get()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, buffer.get()); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -348,7 +319,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamedFormated_(
     if (FAILED(hr))
         return hr;
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, wstr.c_str()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, wstr.c_str()); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -363,13 +334,9 @@ HRESULT Orc::StructuredOutput::XML::Writer::Write(const std::wstring_view str)
     if (m_pWriter == nullptr)
         return E_POINTER;
 
-    Buffer<WCHAR, ORC_MAX_PATH> buffer;
-    buffer.set(str.data(), str.size() + 1, str.size());
-    buffer.append(L'\0');
-
     if (m_collectionStack.empty())
     {
-        if (auto hr = m_pWriter->WriteString(buffer.get()); FAILED(hr))
+        if (auto hr = m_pWriter->WriteString(str); FAILED(hr))
         {
             XmlLiteExtension::LogError(hr);
             return hr;
@@ -381,7 +348,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::Write(const std::wstring_view str)
         BOOST_SCOPE_EXIT(this_) { this_->EndElement(this_->m_collectionStack.top().c_str()); }
         BOOST_SCOPE_EXIT_END;
 
-        if (auto hr = m_pWriter->WriteString(buffer.get()); FAILED(hr))
+        if (auto hr = m_pWriter->WriteString(str); FAILED(hr))
         {
             XmlLiteExtension::LogError(hr);
             return hr;
@@ -427,11 +394,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, const std
     if (m_pWriter == nullptr)
         return E_POINTER;
 
-    Buffer<WCHAR, ORC_MAX_PATH> buffer;
-    buffer.set(str.data(), str.size() + 1, str.size());
-    buffer.append(L'\0');
-
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, buffer.get()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, str); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -446,7 +409,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, const std
     if (m_pWriter == nullptr)
         return E_POINTER;
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, str.c_str()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, str.c_str()); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -499,7 +462,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, std::stri
     if (FAILED(hr))
         return hr;
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, wstr.c_str()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, wstr.c_str()); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -572,7 +535,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamedFileTime(LPCWSTR szName, U
     if (auto hr = WriteFileTimeBuffer(buffer, fileTime); FAILED(hr))
         return hr;
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, buffer.get()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, buffer.get()); FAILED(hr))
     {
         return hr;
     }
@@ -586,7 +549,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamedAttributes(LPCWSTR szName,
     if (auto hr = WriteAttributesBuffer(buffer, dwFileAttributes); FAILED(hr))
         return hr;
 
-    if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, buffer.get()); FAILED(hr))
+    if (auto hr = m_pWriter->WriteAttributeString(szName, buffer.get()); FAILED(hr))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -624,7 +587,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, bool bBoo
 {
     HRESULT hr = E_FAIL;
 
-    if (FAILED(hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, bBoolean ? L"true" : L"false")))
+    if (FAILED(hr = m_pWriter->WriteAttributeString(szName, bBoolean ? L"true" : L"false")))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -682,7 +645,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, DWORD dwE
     {
         if (i == dwEnum)
         {
-            if (FAILED(hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, EnumValues[i])))
+            if (FAILED(hr = m_pWriter->WriteAttributeString(szName, EnumValues[i])))
             {
                 XmlLiteExtension::LogError(hr);
                 return hr;
@@ -692,7 +655,7 @@ HRESULT Orc::StructuredOutput::XML::Writer::WriteNamed(LPCWSTR szName, DWORD dwE
         i++;
     }
 
-    if (FAILED(hr = m_pWriter->WriteAttributeString(NULL, L"IllegalEnumValue", NULL, EnumValues[i])))
+    if (FAILED(hr = m_pWriter->WriteAttributeString(L"IllegalEnumValue", EnumValues[i])))
     {
         XmlLiteExtension::LogError(hr);
         return hr;
@@ -11,14 +11,13 @@
 
 #include "OutputSpec.h"
 
+#include "XmlEmitter.h"
 #include "XmlLiteExtension.h"
 
 #include <stack>
 
 #pragma managed(push, off)
 
-struct IXmlWriter;
-
 namespace Orc {
 
 class ByteStream;
@@ -28,8 +27,7 @@ namespace StructuredOutput::XML {
 class Writer : public StructuredOutput::Writer
 {
 protected:
-    std::shared_ptr<XmlLiteExtension> m_xmllite;
-    CComPtr<IXmlWriter> m_pWriter;
+    std::unique_ptr<Emitter> m_pWriter;
     std::stack<std::wstring> m_collectionStack;
 
 public:
@@ -38,6 +36,7 @@ public:
 
     HRESULT SetOutput(std::shared_ptr<ByteStream> stream);
 
+    virtual HRESULT Flush() override final;
     virtual HRESULT Close() override final;
 
     virtual HRESULT BeginElement(LPCWSTR szElement) override final;
@@ -184,7 +183,7 @@ private:
         if (auto hr = StructuredOutput::Writer::WriteBuffer(buffer, std::forward<Args>(args)...); FAILED(hr))
             return hr;
 
-        if (auto hr = m_pWriter->WriteAttributeString(NULL, szName, NULL, buffer.empty() ? L"" : buffer.get());
+        if (auto hr = m_pWriter->WriteAttributeString(szName, buffer.empty() ? L"" : buffer.get());
             FAILED(hr))
         {
             XmlLiteExtension::LogError(hr);
@@ -0,0 +1,165 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "YaraScanPool.h"
+
+#include "MemoryAccounting.h"
+
+using namespace Orc;
+
+YaraScanPool::YaraScanPool(YaraScanner& scanner, DWORD dwWorkers, ULONGLONG ullMaxPendingBytes)
+    : m_Scanner(scanner)
+    , m_ullMaxPendingBytes(ullMaxPendingBytes)
+{
+    // Scanners are created here as creating them compiles the rules on first call, which is not thread safe
+    for (DWORD i = 0; i < dwWorkers; i++)
+    {
+        auto pScanner = m_Scanner.CreateScanner();
+        if (!pScanner)
+        {
+            Log::Error("Failed to create yara scanner for worker #{}", i);
+            break;
+        }
+
+        m_Scanners.push_back(std::move(pScanner));
+    }
+
+    for (const auto& pScanner : m_Scanners)
+    {
+        m_Workers.emplace_back([this, pScanner = pScanner.get()]() { Work(pScanner); });
+    }
+
+    Log::Debug("Yara scan pool started (workers: {}, pending: {} bytes)", m_Workers.size(), m_ullMaxPendingBytes);
+}
+
+YaraScanPool::~YaraScanPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bStop = true;
+    }
+
+    m_JobReady.notify_all();
+
+    for (auto& worker : m_Workers)
+    {
+        worker.join();
+    }
+
+    for (const auto& job : m_Jobs)
+    {
+        MemoryAccounting::Release(MemoryAccounting::Tag::Yara, job.Data.size());
+    }
+
+    Log::Debug(
+        "Yara scan pool stopped (jobs: {}, throttled submissions: {}, dropped jobs: {})",
+        m_ullSubmittedJobs,
+        m_ullThrottled,
+        m_Jobs.size());
+}
+
+YaraScanPool::JobId YaraScanPool::Submit(YaraScanner::MemoryBlockBuffer&& buffer)
+{
+    const ULONGLONG cbBytes = buffer.size();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    // Over the yara memory soft limit, buffers are scanned one at a time
+    const auto hasRoom = [this, cbBytes]() {
+        if (m_ullPendingBytes == 0)
+            return true;
+
+        return m_ullPendingBytes + cbBytes <= m_ullMaxPendingBytes
+            && !MemoryAccounting::IsOverSoftLimit(MemoryAccounting::Tag::Yara);
+    };
+
+    if (!hasRoom())
+    {
+        m_ullThrottled++;
+        m_JobDone.wait(lock, hasRoom);
+    }
+
+    const auto id = m_NextId++;
+    m_Jobs.push_back({id, std::move(buffer)});
+    m_ullPendingBytes += cbBytes;
+    m_ullSubmittedJobs++;
+    MemoryAccounting::Charge(MemoryAccounting::Tag::Yara, cbBytes);
+
+    lock.unlock();
+    m_JobReady.notify_one();
+
+    return id;
+}
+
+std::vector<YaraScanPool::Result> YaraScanPool::Collect(bool bWait)
+{
+    // Rules which exceeded their budget in the workers' scans are only disabled from the submitting thread
+    m_Scanner.DisableRulesOverBudget();
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+
+    if (bWait)
+    {
+        m_JobDone.wait(lock, [this]() { return m_Jobs.empty() && m_ullRunningJobs == 0; });
+    }
+
+    std::vector<Result> results;
+    std::swap(results, m_Results);
+    return results;
+}
+
+void YaraScanPool::Work(YR_SCANNER* pScanner)
+{
+    for (;;)
+    {
+        Job job;
+
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_JobReady.wait(lock, [this]() { return m_bStop || !m_Jobs.empty(); });
+
+            if (m_bStop)
+            {
+                return;
+            }
+
+            job = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+            m_ullRunningJobs++;
+        }
+
+        Result result;
+        result.Id = job.Id;
+
+        try
+        {
+            result.hr = m_Scanner.Scan(pScanner, job.Data.data(), job.Data.size(), result.MatchingRules);
+        }
+        catch (const std::exception& e)
+        {
+            Log::Error("Yara scan failed with an exception: {}", e.what());
+            result.hr = E_FAIL;
+        }
+
+        const ULONGLONG cbBytes = job.Data.size();
+
+        // Release the buffer before making room for the next submissions
+        YaraScanner::MemoryBlockBuffer().swap(job.Data);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_ullPendingBytes -= cbBytes;
+            m_ullRunningJobs--;
+            MemoryAccounting::Release(MemoryAccounting::Tag::Yara, cbBytes);
+            m_Results.push_back(std::move(result));
+        }
+
+        m_JobDone.notify_all();
+    }
+}
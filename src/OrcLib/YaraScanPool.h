@@ -0,0 +1,91 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include "OrcLib.h"
+
+#include "YaraScanner.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#pragma managed(push, off)
+
+namespace Orc {
+
+// Scan in memory buffers with the compiled rules of a YaraScanner on worker threads, each with its own YR_SCANNER.
+//
+// Buffers are submitted by a single thread which collects the results later on, in any order. Submitting blocks while
+// the queued and scanned buffers exceed the pending size: the submitting thread is throttled to the scanning pace.
+// These buffers are charged to the 'yara' memory tag, over its soft limit they are scanned one at a time.
+class YaraScanPool
+{
+public:
+    using JobId = ULONGLONG;
+
+    struct Result
+    {
+        JobId Id = 0LL;
+        HRESULT hr = E_FAIL;
+        MatchingRuleCollection MatchingRules;
+    };
+
+    // Rules of 'scanner' must be complete, 'scanner' must outlive the pool
+    YaraScanPool(YaraScanner& scanner, DWORD dwWorkers, ULONGLONG ullMaxPendingBytes);
+    ~YaraScanPool();
+
+    YaraScanPool(const YaraScanPool&) = delete;
+    YaraScanPool& operator=(const YaraScanPool&) = delete;
+
+    // Number of workers which could create their scanner
+    DWORD Workers() const { return static_cast<DWORD>(m_Workers.size()); }
+
+    // Take ownership of 'buffer': a buffer bigger than the pending size waits for all the others to complete
+    JobId Submit(YaraScanner::MemoryBlockBuffer&& buffer);
+
+    // Results of the jobs completed since last call, 'bWait' waits for all the submitted jobs
+    std::vector<Result> Collect(bool bWait = false);
+
+    ULONGLONG SubmittedJobs() const { return m_ullSubmittedJobs; }
+
+private:
+    struct Job
+    {
+        JobId Id;
+        YaraScanner::MemoryBlockBuffer Data;
+    };
+
+    void Work(YR_SCANNER* pScanner);
+
+    YaraScanner& m_Scanner;
+    const ULONGLONG m_ullMaxPendingBytes;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_JobReady;
+    std::condition_variable m_JobDone;
+
+    std::deque<Job> m_Jobs;
+    std::vector<Result> m_Results;
+    ULONGLONG m_ullPendingBytes = 0LL;
+    ULONGLONG m_ullRunningJobs = 0LL;
+    bool m_bStop = false;
+
+    JobId m_NextId = 1LL;
+    ULONGLONG m_ullSubmittedJobs = 0LL;
+    ULONGLONG m_ullThrottled = 0LL;
+
+    std::vector<YaraScanner::ScannerPtr> m_Scanners;
+    std::vector<std::thread> m_Workers;
+};
+
+}  // namespace Orc
+
+#pragma managed(pop)
@@ -9,11 +9,15 @@
 
 #include "EmbeddedResource.h"
 #include "MemoryStream.h"
+#include "BufferStream.h"
 #include "FileStream.h"
 #include "FileMappingStream.h"
+#include "CryptoHashStream.h"
 
 #include "WideAnsi.h"
 #include "ParameterCheck.h"
+#include "Telemetry.h"
+#include "Trace.h"
 
 #include "Configuration/ConfigFile_Common.h"
 
@@ -123,6 +127,71 @@ Result<Orc::YaraConfig> Orc::YaraConfig::Get(const ConfigItem& item)
         }
     }
 
+    if (item[CONFIG_YARA_WORKERS])
+    {
+        DWORD workers = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item[CONFIG_YARA_WORKERS].c_str(), workers)))
+        {
+            auto ec = SystemError(hr);
+            Log::Error(L"Failed to configure workers (count: {}) [{}]", item[CONFIG_YARA_WORKERS].c_str(), ec);
+            return ec;
+        }
+
+        config.SetWorkers(workers);
+    }
+
+    if (item[CONFIG_YARA_PENDING])
+    {
+        LARGE_INTEGER pendingSize = {0L};
+        if (FAILED(hr = GetFileSizeFromArg(item[CONFIG_YARA_PENDING].c_str(), pendingSize))
+            || pendingSize.QuadPart <= 0LL)
+        {
+            Log::Error(L"Invalid pending size (size: {})", item[CONFIG_YARA_PENDING].c_str());
+            return std::errc::invalid_argument;
+        }
+
+        config.SetPendingSize(pendingSize.QuadPart);
+    }
+
+    if (item[CONFIG_YARA_CACHE])
+    {
+        // The cache is only an optimization: rules are compiled as usual without it
+        std::wstring cacheDirectory;
+        if (FAILED(hr = ExpandDirectoryPath(item[CONFIG_YARA_CACHE].c_str(), cacheDirectory)))
+        {
+            Log::Warn(L"Invalid yara cache directory '{}' [{}]", item[CONFIG_YARA_CACHE].c_str(), SystemError(hr));
+        }
+        else
+        {
+            config.SetCacheDirectory(cacheDirectory);
+        }
+    }
+
+    if (item[CONFIG_YARA_PROFILING])
+    {
+        DWORD profiledRules = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item[CONFIG_YARA_PROFILING].c_str(), profiledRules)))
+        {
+            auto ec = SystemError(hr);
+            Log::Error(L"Failed to configure rule profiling (count: {}) [{}]", item[CONFIG_YARA_PROFILING].c_str(), ec);
+            return ec;
+        }
+
+        config.SetProfiledRules(profiledRules);
+    }
+
+    if (item[CONFIG_YARA_RULE_BUDGET])
+    {
+        DWORD budget = 0L;
+        if (FAILED(hr = GetIntegerFromArg(item[CONFIG_YARA_RULE_BUDGET].c_str(), budget)) || budget == 0L)
+        {
+            Log::Error(L"Invalid rule budget (seconds: {})", item[CONFIG_YARA_RULE_BUDGET].c_str());
+            return std::errc::invalid_argument;
+        }
+
+        config.SetRuleBudget(std::chrono::seconds(budget));
+    }
+
     if (item[CONFIG_YARA_SCAN_METHOD])
     {
         if (FAILED(config.SetScanMethod((std::wstring)item[CONFIG_YARA_SCAN_METHOD])))
@@ -193,7 +262,15 @@ HRESULT Orc::YaraScanner::Configure(std::unique_ptr<YaraConfig>& config)
 
         m_config = *config;
 
+        m_blockBuffer.reserve(LargePages::PreferredSize(m_config.blockSize()));
         m_blockBuffer.resize(m_config.blockSize());
+
+#ifndef YR_PROFILING_ENABLED
+        if (m_config.isProfiling())
+        {
+            Log::Warn(L"Yara rule profiling is not available: yara was not built with YR_PROFILING_ENABLED");
+        }
+#endif
     }
     else
     {
@@ -283,6 +360,32 @@ HRESULT Orc::YaraScanner::AddRules(CBinaryBuffer& buffer)
     m_ErrorCount = 0;
     m_WarningCount = 0;
 
+    if (IsCompiledRules(buffer))
+    {
+        if (m_pRules || !m_Sources.empty())
+        {
+            Log::Error("Compiled yara rules cannot be added to other rules");
+            return E_INVALIDARG;
+        }
+
+        auto memstream = std::make_shared<MemoryStream>();
+
+        HRESULT hr = E_FAIL;
+        if (FAILED(hr = memstream->OpenForReadOnly(buffer.GetData(), buffer.GetCount())))
+        {
+            Log::Error("Failed to open compiled yara rules buffer [{}]", SystemError(hr));
+            return hr;
+        }
+
+        return LoadRules(memstream);
+    }
+
+    if (m_bLoadedRules)
+    {
+        Log::Error("Yara rules cannot be added to compiled rules");
+        return E_INVALIDARG;
+    }
+
     // we need to make sure that buffer is null terminated because libyara heavily relies on this
     if (buffer.Get<UCHAR>(buffer.GetCount<UCHAR>() - sizeof(UCHAR)) != '\0')
     {
@@ -298,6 +401,207 @@ HRESULT Orc::YaraScanner::AddRules(CBinaryBuffer& buffer)
         return E_INVALIDARG;
     }
 
+    // Keep the terminating null as a separator between the sources
+    m_Sources.append(buffer.GetP<const char>(), buffer.GetCount<char>());
+    return S_OK;
+}
+
+bool Orc::YaraScanner::IsCompiledRules(const CBinaryBuffer& buffer)
+{
+    // Files saved by yr_rules_save start with this magic
+    constexpr std::string_view kCompiledRulesMagic("YARA", 4);
+
+    return buffer.GetCount() >= kCompiledRulesMagic.size()
+        && std::string_view(buffer.GetP<const char>(), kCompiledRulesMagic.size()) == kCompiledRulesMagic;
+}
+
+HRESULT Orc::YaraScanner::LoadRules(const std::shared_ptr<ByteStream>& stream)
+{
+    YR_STREAM yrStream;
+    yrStream.user_data = stream.get();
+    yrStream.read = YaraScanner::read;
+    yrStream.write = YaraScanner::write;
+
+    YR_RULES* pRules = nullptr;
+    auto ret = m_yara->yr_rules_load_stream(&yrStream, &pRules);
+    if (ret != ERROR_SUCCESS || !pRules)
+    {
+        Log::Error("Failed to load compiled yara rules (code: {})", ret);
+        return E_FAIL;
+    }
+
+    if (m_pRules)
+    {
+        m_profilingScanner.reset();
+        m_yara->yr_rules_destroy(m_pRules);
+    }
+
+    m_pRules = pRules;
+    m_bLoadedRules = true;
+    return S_OK;
+}
+
+HRESULT Orc::YaraScanner::SaveRules(const std::shared_ptr<ByteStream>& stream)
+{
+    YR_RULES* pRules = GetRules();
+    if (!pRules)
+    {
+        Log::Error("No yara rules to save");
+        return E_POINTER;
+    }
+
+    YR_STREAM yrStream;
+    yrStream.user_data = stream.get();
+    yrStream.read = YaraScanner::read;
+    yrStream.write = YaraScanner::write;
+
+    auto ret = m_yara->yr_rules_save_stream(pRules, &yrStream);
+    if (ret != ERROR_SUCCESS)
+    {
+        Log::Error("Failed to save compiled yara rules (code: {})", ret);
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+HRESULT Orc::YaraScanner::GetCachedRulesPath(std::wstring& path)
+{
+    // Compiled rules depend on yara's version and on the architecture
+    const auto key = fmt::format("{}|{}|", YR_VERSION, sizeof(void*) * 8);
+
+    auto hashstream = std::make_shared<CryptoHashStream>();
+
+    HRESULT hr = E_FAIL;
+    if (FAILED(hr = hashstream->OpenToWrite(CryptoHashStream::Algorithm::SHA256, nullptr)))
+    {
+        return hr;
+    }
+
+    ULONGLONG ullWritten = 0LL;
+    if (FAILED(hr = hashstream->Write((const PVOID)key.data(), key.size(), &ullWritten)))
+    {
+        return hr;
+    }
+
+    if (FAILED(hr = hashstream->Write((const PVOID)m_Sources.data(), m_Sources.size(), &ullWritten)))
+    {
+        return hr;
+    }
+
+    std::wstring hash;
+    if (FAILED(hr = hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, hash)))
+    {
+        return hr;
+    }
+
+    path = *m_config.cacheDirectory() + L"\\" + hash + L".yarc";
+    return S_OK;
+}
+
+HRESULT Orc::YaraScanner::LoadCachedRules(const std::wstring& path)
+{
+    HRESULT hr = E_FAIL;
+
+    if (GetFileAttributes(path.c_str()) == INVALID_FILE_ATTRIBUTES)
+    {
+        Log::Debug(L"No cached yara rules '{}'", path);
+        return HRESULT_FROM_WIN32(ERROR_FILE_NOT_FOUND);
+    }
+
+    auto stream = std::make_shared<FileStream>();
+    if (FAILED(hr = stream->ReadFrom(path.c_str())))
+    {
+        Log::Warn(L"Failed to open cached yara rules '{}' [{}]", path, SystemError(hr));
+        return hr;
+    }
+
+    if (FAILED(hr = LoadRules(stream)))
+    {
+        Log::Warn(L"Failed to load cached yara rules '{}' [{}]", path, SystemError(hr));
+        return hr;
+    }
+
+    Log::Debug(L"Loaded cached yara rules '{}'", path);
+    return S_OK;
+}
+
+HRESULT Orc::YaraScanner::SaveCachedRules(const std::wstring& path)
+{
+    HRESULT hr = E_FAIL;
+
+    // Concurrent runs could save the same rules: each one writes its own file and replaces the cached one
+    const auto tempPath = path + L"." + std::to_wstring(GetCurrentProcessId()) + L".tmp";
+
+    {
+        auto stream = std::make_shared<FileStream>();
+        if (FAILED(hr = stream->WriteTo(tempPath.c_str())))
+        {
+            Log::Warn(L"Failed to create cached yara rules '{}' [{}]", tempPath, SystemError(hr));
+            return hr;
+        }
+
+        if (FAILED(hr = SaveRules(stream)))
+        {
+            stream->Close();
+            DeleteFile(tempPath.c_str());
+            return hr;
+        }
+
+        stream->Close();
+    }
+
+    if (!MoveFileEx(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING))
+    {
+        hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Warn(L"Failed to replace cached yara rules '{}' [{}]", path, SystemError(hr));
+        DeleteFile(tempPath.c_str());
+        return hr;
+    }
+
+    Log::Debug(L"Saved compiled yara rules to '{}'", path);
+    return S_OK;
+}
+
+HRESULT Orc::YaraScanner::CompileRules()
+{
+    if (m_pRules)
+        return S_OK;
+
+    if (!m_pCompiler)
+    {
+        Log::Error("No yara compiler to compile rules");
+        return E_POINTER;
+    }
+
+    std::wstring cachePath;
+    if (m_config.cacheDirectory().has_value() && !m_Sources.empty())
+    {
+        HRESULT hr = E_FAIL;
+        if (FAILED(hr = GetCachedRulesPath(cachePath)))
+        {
+            Log::Warn("Failed to compute cached yara rules path [{}]", SystemError(hr));
+            cachePath.clear();
+        }
+        else if (SUCCEEDED(LoadCachedRules(cachePath)))
+        {
+            return S_OK;
+        }
+    }
+
+    auto ret = m_yara->yr_compiler_get_rules(m_pCompiler, &m_pRules);
+    if (ret != ERROR_SUCCESS || !m_pRules)
+    {
+        Log::Error("Failed yr_compiler_get_rules (code: {})", ret);
+        return E_FAIL;
+    }
+
+    if (!cachePath.empty())
+    {
+        // Failures are logged: the compiled rules are used anyway
+        SaveCachedRules(cachePath);
+    }
+
     return S_OK;
 }
 
@@ -341,7 +645,7 @@ YR_RULES* Orc::YaraScanner::GetRules()
     if (m_pRules)
         return m_pRules;
 
-    m_yara->yr_compiler_get_rules(m_pCompiler, &m_pRules);
+    CompileRules();
 
     return m_pRules;
 }
@@ -473,14 +777,31 @@ HRESULT Orc::YaraScanner::Scan(const CBinaryBuffer& buffer, ULONG bytesToScan, M
     if (bytesToScan == 0)
         return S_OK;
 
+    return ScanMemory(buffer.GetP<const uint8_t>(), bytesToScan, matchingRules);
+}
+
+HRESULT Orc::YaraScanner::ScanMemory(const uint8_t* data, size_t size, MatchingRuleCollection& matchingRules)
+{
+    if (size == 0)
+        return S_OK;
+
+    if (m_config.isProfiling())
+    {
+        if (auto scanner = ProfilingScanner())
+            return Scan(scanner, data, size, matchingRules);
+    }
+
     YR_RULES* pRules = GetRules();
 
     auto scan_details = std::make_pair(this, &matchingRules);
 
+    Telemetry::Scope telemetry(Telemetry::Phase::YaraScan);
+    telemetry.AddBytes(size);
+
     switch (m_yara->yr_rules_scan_mem(
         pRules,
-        buffer.GetP<const uint8_t>(),
-        bytesToScan,
+        data,
+        size,
         0,
         scan_callback,
         &scan_details,
@@ -508,6 +829,72 @@ HRESULT Orc::YaraScanner::Scan(const CBinaryBuffer& buffer, ULONG bytesToScan, M
     }
 }
 
+YaraScanner::ScannerPtr Orc::YaraScanner::CreateScanner()
+{
+    YR_RULES* pRules = GetRules();
+    if (!pRules)
+    {
+        Log::Error("No compiled rules to create a scanner");
+        return {};
+    }
+
+    YR_SCANNER* pScanner = nullptr;
+    auto ret = m_yara->yr_scanner_create(pRules, &pScanner);
+    if (ret != ERROR_SUCCESS || !pScanner)
+    {
+        Log::Error("Failed yr_scanner_create (code: {})", ret);
+        return {};
+    }
+
+    m_yara->yr_scanner_set_timeout(pScanner, (int)std::chrono::seconds(m_config.timeOut()).count());
+
+    auto yara = m_yara;
+    return ScannerPtr(pScanner, [yara](YR_SCANNER* scanner) { yara->yr_scanner_destroy(scanner); });
+}
+
+HRESULT Orc::YaraScanner::Scan(
+    YR_SCANNER* scanner,
+    const uint8_t* buffer,
+    size_t bytesToScan,
+    MatchingRuleCollection& matchingRules)
+{
+    if (bytesToScan == 0)
+        return S_OK;
+
+    auto scan_details = std::make_pair(this, &matchingRules);
+    m_yara->yr_scanner_set_callback(scanner, scan_callback, &scan_details);
+
+    Telemetry::Scope telemetry(Telemetry::Phase::YaraScan);
+    telemetry.AddBytes(bytesToScan);
+
+    auto rv = m_yara->yr_scanner_scan_mem(scanner, buffer, bytesToScan);
+
+    if (m_config.isProfiling())
+    {
+        AddProfilingInfo(scanner);
+    }
+
+    switch (rv)
+    {
+        case ERROR_SUCCESS:
+            return S_OK;
+        case ERROR_INSUFFICIENT_MEMORY:
+            return E_OUTOFMEMORY;
+        case ERROR_SCAN_TIMEOUT:
+            Log::Error("Yara scan timeout");
+            return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+        case ERROR_CALLBACK_ERROR:
+            Log::Error("Yara callback return an error");
+            return E_FAIL;
+        case ERROR_TOO_MANY_MATCHES:
+            Log::Error("Too many matches in yara scan");
+            return S_OK;
+        default:
+            Log::Error("Unsupported yara error code [{}]", rv);
+            return E_FAIL;
+    }
+}
+
 HRESULT YaraScanner::ScanBlocks(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules)
 {
     ::YaraMemoryBlockContext context = {*stream, m_blockBuffer};
@@ -577,13 +964,26 @@ HRESULT YaraScanner::ScanBlocks(const std::shared_ptr<ByteStream>& stream, Match
 
     auto scan_details = std::make_pair(this, &matchingRules);
 
-    auto rv = m_yara->yr_rules_scan_mem_blocks(
-        GetRules(),
-        &context.iterator,
-        0,
-        scan_callback,
-        &scan_details,
-        static_cast<int>(std::chrono::seconds(m_config.timeOut()).count()));
+    Telemetry::Scope telemetry(Telemetry::Phase::YaraScan);
+    telemetry.AddBytes(context.streamSize);
+
+    int rv = ERROR_SUCCESS;
+    if (auto scanner = m_config.isProfiling() ? ProfilingScanner() : nullptr)
+    {
+        m_yara->yr_scanner_set_callback(scanner, scan_callback, &scan_details);
+        rv = m_yara->yr_scanner_scan_mem_blocks(scanner, &context.iterator);
+        AddProfilingInfo(scanner);
+    }
+    else
+    {
+        rv = m_yara->yr_rules_scan_mem_blocks(
+            GetRules(),
+            &context.iterator,
+            0,
+            scan_callback,
+            &scan_details,
+            static_cast<int>(std::chrono::seconds(m_config.timeOut()).count()));
+    }
 
     switch (rv)
     {
@@ -611,40 +1011,79 @@ HRESULT YaraScanner::ScanBlocks(const std::shared_ptr<ByteStream>& stream, Match
 
 HRESULT Orc::YaraScanner::Scan(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules)
 {
-    if (m_config.ScanMethod() == YaraScanMethod::Blocks)
+    DisableRulesOverBudget();
+
+    const auto activity = Trace::FileScanStart("Yara", stream->GetSize());
+    const auto hr = ScanStream(stream, matchingRules);
+    Trace::FileScanStop(activity, hr);
+    return hr;
+}
+
+HRESULT Orc::YaraScanner::ScanStream(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules)
+{
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    if (GetStreamData(stream, data, size))
     {
-        return ScanBlocks(stream, matchingRules);
+        return ScanMemory(data, size, matchingRules);
     }
 
-    HRESULT hr = E_FAIL;
-    if (stream->GetSize() < m_config.blockSize())
+    if (stream->GetSize() <= m_config.blockSize())
     {
-        // Simple case, we scan all the file in one bloc
-        auto [hr, memstream] = GetMemoryStream(stream);
-        if (FAILED(hr))
-            return hr;
-        if (!memstream)
-            return E_FAIL;
+        return ScanSmallStream(stream, matchingRules);
+    }
 
-        CBinaryBuffer buffer;
-        memstream->GrabBuffer(buffer);
+    switch (m_config.ScanMethod())
+    {
+        case YaraScanMethod::Blocks:
+            return ScanBlocks(stream, matchingRules);
+        case YaraScanMethod::BlocksLegacy:
+            return Scan(stream, m_config.blockSize(), m_config.overlapSize(), matchingRules);
+        case YaraScanMethod::FileMapping: {
+            ULONG ulBytesScanned = 0;
+            return ScanFileMapping(stream, matchingRules, ulBytesScanned);
+        }
+        default:
+            return E_UNEXPECTED;
+    }
+}
 
-        return Scan(buffer, (ULONG)buffer.GetCount(), matchingRules);
+HRESULT
+Orc::YaraScanner::ScanSmallStream(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules)
+{
+    HRESULT hr = E_FAIL;
+    const auto ullSize = stream->GetSize();
+
+    if (m_blockBuffer.size() < ullSize)
+    {
+        m_blockBuffer.resize(static_cast<size_t>(ullSize));
     }
-    else
+
+    if (FAILED(hr = stream->SetFilePointer(0LL, FILE_BEGIN, nullptr)))
+    {
+        Log::Error("Failed to seek stream for yara scan [{}]", SystemError(hr));
+        return hr;
+    }
+
+    ULONGLONG ullTotalRead = 0LL;
+    while (ullTotalRead < ullSize)
     {
-        switch (m_config.ScanMethod())
+        ULONGLONG ullBytesRead = 0LL;
+        if (FAILED(hr = stream->Read(m_blockBuffer.data() + ullTotalRead, ullSize - ullTotalRead, &ullBytesRead)))
         {
-            case YaraScanMethod::BlocksLegacy:
-                return Scan(stream, m_config.blockSize(), m_config.overlapSize(), matchingRules);
-            case YaraScanMethod::FileMapping: {
-                ULONG ulBytesScanned = 0;
-                return ScanFileMapping(stream, matchingRules, ulBytesScanned);
-            }
-            default:
-                return E_UNEXPECTED;
+            Log::Error("Failed to read {} bytes from stream for yara scan [{}]", ullSize, SystemError(hr));
+            return hr;
         }
+
+        if (ullBytesRead == 0)
+        {
+            break;
+        }
+
+        ullTotalRead += ullBytesRead;
     }
+
+    return ScanMemory(m_blockBuffer.data(), static_cast<size_t>(ullTotalRead), matchingRules);
 }
 
 HRESULT Orc::YaraScanner::ScanFrom(
@@ -854,8 +1293,108 @@ HRESULT Orc::YaraScanner::PrintConfiguration()
     return S_OK;
 }
 
+YR_SCANNER* Orc::YaraScanner::ProfilingScanner()
+{
+    if (!m_profilingScanner)
+    {
+        m_profilingScanner = CreateScanner();
+    }
+
+    return m_profilingScanner.get();
+}
+
+void Orc::YaraScanner::AddProfilingInfo(YR_SCANNER* scanner)
+{
+    auto info = m_yara->yr_scanner_get_profiling_info(scanner);
+    if (info == nullptr)
+    {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_profilingMutex);
+
+        // The array is terminated by an entry without rule
+        for (auto entry = info; entry->rule != nullptr; entry++)
+        {
+            auto& time = m_ruleTimes[entry->rule];
+            time += std::chrono::nanoseconds(entry->cost);
+
+            const auto& budget = m_config.ruleBudget();
+            if (budget && time > *budget && m_disabledRules.insert(entry->rule).second)
+            {
+                m_rulesOverBudget.push_back(entry->rule);
+            }
+        }
+    }
+
+    m_yara->yr_free(info);
+    m_yara->yr_scanner_reset_profiling_info(scanner);
+}
+
+void Orc::YaraScanner::DisableRulesOverBudget()
+{
+    std::vector<YR_RULE*> rules;
+    {
+        std::lock_guard<std::mutex> lock(m_profilingMutex);
+        if (m_rulesOverBudget.empty())
+        {
+            return;
+        }
+
+        std::swap(rules, m_rulesOverBudget);
+    }
+
+    for (auto rule : rules)
+    {
+        Log::Warn(
+            "Disable yara rule '{}' which exceeded its budget of {}",
+            rule->identifier,
+            std::chrono::duration_cast<std::chrono::seconds>(*m_config.ruleBudget()));
+        m_yara->yr_rule_disable(rule);
+    }
+}
+
+std::vector<YaraRuleProfile> Orc::YaraScanner::SlowestRules() const
+{
+    std::vector<YaraRuleProfile> rules;
+
+    {
+        std::lock_guard<std::mutex> lock(m_profilingMutex);
+
+        rules.reserve(m_ruleTimes.size());
+        for (const auto& [rule, time] : m_ruleTimes)
+        {
+            rules.push_back({rule->identifier, time, m_disabledRules.find(rule) != std::cend(m_disabledRules)});
+        }
+    }
+
+    std::sort(std::begin(rules), std::end(rules), [](const auto& left, const auto& right) {
+        return left.Time > right.Time;
+    });
+
+    // Rules disabled by the budget are listed even when they are not among the slowest ones
+    const size_t count = m_config.profiledRules();
+    if (rules.size() > count)
+    {
+        auto last = std::stable_partition(
+            std::begin(rules) + count, std::end(rules), [](const auto& rule) { return rule.Disabled; });
+        rules.erase(last, std::end(rules));
+    }
+
+    return rules;
+}
+
 Orc::YaraScanner::~YaraScanner()
 {
+    m_profilingScanner.reset();
+
+    if (m_pRules)
+    {
+        m_yara->yr_rules_destroy(m_pRules);
+        m_pRules = nullptr;
+    }
+
     if (m_pCompiler)
     {
         m_yara->yr_compiler_destroy(m_pCompiler);
@@ -926,79 +1465,58 @@ size_t Orc::YaraScanner::read(void* ptr, size_t size, size_t count, void* user_d
 
     ULONGLONG cbBytesRead = 0LL;
 
-    if (FAILED(pStream->Read(ptr, size * count, &cbBytesRead)))
+    if (size == 0 || FAILED(pStream->Read(ptr, size * count, &cbBytesRead)))
     {
         return 0;
     }
-    return (size_t)cbBytesRead;
+
+    // Like fread, return the count of complete items
+    return (size_t)(cbBytesRead / size);
 }
 
 size_t Orc::YaraScanner::write(const void* ptr, size_t size, size_t count, void* user_data)
 {
     auto pStream = (ByteStream*)user_data;
 
-    if (!pStream || pStream->IsOpen() != S_OK || pStream->CanRead() != S_OK)
+    if (!pStream || pStream->IsOpen() != S_OK || pStream->CanWrite() != S_OK)
         return 0;
 
     ULONGLONG cbBytesWritten = 0LL;
 
-    if (FAILED(pStream->Write((const PVOID)ptr, size * count, &cbBytesWritten)))
+    if (size == 0 || FAILED(pStream->Write((const PVOID)ptr, size * count, &cbBytesWritten)))
     {
         return 0;
     }
-    return (size_t)cbBytesWritten;
-}
 
-struct YaraStream : YR_STREAM
-{
-    std::shared_ptr<ByteStream> byteStream;
-};
+    // Like fwrite, return the count of complete items
+    return (size_t)(cbBytesWritten / size);
+}
 
-std::pair<HRESULT, std::shared_ptr<MemoryStream>>
-Orc::YaraScanner::GetMemoryStream(const std::shared_ptr<ByteStream>& byteStream)
+bool Orc::YaraScanner::GetStreamData(const std::shared_ptr<ByteStream>& stream, const uint8_t*& data, size_t& size)
 {
-    HRESULT hr = E_FAIL;
-    auto memstream = std::dynamic_pointer_cast<MemoryStream>(byteStream);
-
-    if (!memstream)
+    if (auto memstream = std::dynamic_pointer_cast<MemoryStream>(stream))
     {
-        memstream = std::make_shared<MemoryStream>();
-        if (!memstream)
-        {
-            return std::make_pair(E_OUTOFMEMORY, nullptr);
-        }
-
-        if (FAILED(hr = memstream->OpenForReadWrite(static_cast<DWORD>(byteStream->GetSize()))))
-        {
-            Log::Error(L"Failed to allocate %I64d bytes in memory stream [{}]", byteStream->GetSize(), SystemError(hr));
-            return std::make_pair(hr, nullptr);
-        }
-
-        ULONG64 ullBytesCopied = 0LL;
-        if (FAILED(hr = byteStream->CopyTo(memstream, &ullBytesCopied)))
-        {
-            Log::Error(
-                L"Failed to load stream %I64d bytes into memory stream [{}]", byteStream->GetSize(), SystemError(hr));
-            return std::make_pair(hr, nullptr);
-        }
-
-        if (ullBytesCopied != byteStream->GetSize())
-        {
-            Log::Error(L"Failed to load stream %I64d bytes into memory stream", byteStream->GetSize());
-            return std::make_pair(E_FAIL, nullptr);
-        }
+        const auto buffer = memstream->GetConstBuffer();
+        data = buffer.GetData();
+        size = buffer.GetCount();
+        return data != nullptr;
     }
-    return std::make_pair(S_OK, memstream);
-}
 
-std::unique_ptr<YR_STREAM> Orc::YaraScanner::GetYaraStream(const std::shared_ptr<ByteStream>& byteStream)
-{
-    auto retval = std::unique_ptr<YaraStream>();
+    if (auto fmstream = std::dynamic_pointer_cast<FileMappingStream>(stream))
+    {
+        const auto buffer = fmstream->GetMappedData();
+        data = buffer.GetData();
+        size = buffer.GetCount();
+        return data != nullptr;
+    }
 
-    retval->read = YaraScanner::read;
-    retval->write = YaraScanner::write;
-    retval->byteStream = byteStream;
-    retval->user_data = retval->byteStream.operator->();
+    // Resident $DATA attributes
+    if (auto bufstream = std::dynamic_pointer_cast<BufferStream<ORC_MAX_PATH>>(stream))
+    {
+        data = bufstream->GetData();
+        size = static_cast<size_t>(bufstream->GetSize());
+        return data != nullptr;
+    }
 
-    return retval;
+    return false;
 }
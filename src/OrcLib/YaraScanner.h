@@ -8,9 +8,14 @@
 #pragma once
 
 #include "YaraStaticExtension.h"
+#include "LargePages.h"
 
 #include <chrono>
+#include <functional>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 
 #pragma managed(push, off)
 
@@ -26,6 +31,8 @@ using namespace std::chrono_literals;
 
 class YaraScanner;
 
+// Method used for streams larger than the block size. Streams already in memory are scanned in place and smaller
+// streams are read in a single block, whatever the method.
 enum class YaraScanMethod
 {
     Blocks,
@@ -33,6 +40,14 @@ enum class YaraScanMethod
     FileMapping
 };
 
+// Time spent by a rule over all the scans, from yara's rule profiling
+struct YaraRuleProfile
+{
+    std::string Rule;
+    std::chrono::nanoseconds Time;
+    bool Disabled = false;  // the rule exceeded the rule budget and was not evaluated by the following scans
+};
+
 class YaraConfig
 {
     friend class YaraScanner;
@@ -80,6 +95,51 @@ public:
 
     YaraScanMethod ScanMethod() const { return _scanMethod.value_or(YaraScanMethod::Blocks); }
 
+    // Number of threads scanning the candidate streams of FileFind (0: streams are scanned by the walking thread)
+    HRESULT SetWorkers(DWORD dwWorkers)
+    {
+        _workers.emplace(dwWorkers);
+        return S_OK;
+    }
+    DWORD workers() const { return _workers.value_or(0L); }
+
+    // Maximum size of the streams loaded in memory and waiting for a worker
+    HRESULT SetPendingSize(ULONGLONG pendingSize)
+    {
+        _pendingSize.emplace(pendingSize);
+        return S_OK;
+    }
+    ULONGLONG pendingSize() const
+    {
+        return _pendingSize.value_or(256 * 1024 * 1024);  // Default to 256MB
+    }
+
+    // Directory where compiled rules are saved to and loaded from on later runs, named after the hash of their sources
+    HRESULT SetCacheDirectory(const std::wstring& directory)
+    {
+        _cacheDirectory.emplace(directory);
+        return S_OK;
+    }
+    const std::optional<std::wstring>& cacheDirectory() const { return _cacheDirectory; }
+
+    // Number of the slowest rules reported by the statistics, 0 disables the profiling of the rules
+    HRESULT SetProfiledRules(DWORD dwCount)
+    {
+        _profiledRules.emplace(dwCount);
+        return S_OK;
+    }
+    DWORD profiledRules() const { return _profiledRules.value_or(0L); }
+
+    // Time a rule can spend over all the scans before it is disabled, implies the profiling of the rules
+    HRESULT SetRuleBudget(const TimeOut& budget)
+    {
+        _ruleBudget.emplace(budget);
+        return S_OK;
+    }
+    const std::optional<TimeOut>& ruleBudget() const { return _ruleBudget; }
+
+    bool isProfiling() const { return profiledRules() > 0 || _ruleBudget.has_value(); }
+
     bool isValid() const
     {
         if (!_isValid)
@@ -101,6 +161,9 @@ private:
         if (_timeOut.has_value() && _timeOut.value() > 60min)
             return false;
 
+        if (_pendingSize.has_value() && _pendingSize.value() == 0)
+            return false;
+
         return _isValid = true;
     }
 
@@ -109,22 +172,41 @@ private:
     std::optional<ULONG> _overlapSize;
     std::vector<std::wstring> _Sources;
     std::optional<YaraScanMethod> _scanMethod;
+    std::optional<DWORD> _workers;
+    std::optional<ULONGLONG> _pendingSize;
+    std::optional<std::wstring> _cacheDirectory;
+    std::optional<DWORD> _profiledRules;
+    std::optional<TimeOut> _ruleBudget;
 };
 
 class YaraScanner
 {
 public:
-    using MemoryBlockBuffer = std::vector<uint8_t>;
+    // Only the scanner's own block buffer enables large pages: it is reused for every scanned stream
+    using MemoryBlockBuffer = std::vector<uint8_t, LargePages::Allocator<uint8_t>>;
 
-    YaraScanner() { m_blockBuffer.reserve(1048576); }
+    YaraScanner()
+        : m_blockBuffer(LargePages::Allocator<uint8_t>(true))
+    {
+        m_blockBuffer.reserve(LargePages::PreferredSize(1048576));
+    }
 
     HRESULT Initialize(bool bWithCompiler = true);
     HRESULT Configure(std::unique_ptr<YaraConfig>& config);
+    const YaraConfig& Config() const { return m_config; }
 
     HRESULT AddRules(const std::wstring& yara_content_spec);
     HRESULT AddRules(const std::shared_ptr<ByteStream>& stream);
     HRESULT AddRules(CBinaryBuffer& buffer);
 
+    // Compile the added sources, or load the rules compiled from the same sources from the cache directory
+    HRESULT CompileRules();
+
+    // Save the compiled rules with yara's format, a buffer holding them can be given back to AddRules
+    HRESULT SaveRules(const std::shared_ptr<ByteStream>& stream);
+
+    static bool IsCompiledRules(const CBinaryBuffer& buffer);
+
     HRESULT EnableRule(LPCSTR strRule);
     HRESULT DisableRule(LPCSTR strRule);
 
@@ -140,6 +222,13 @@ public:
 
     HRESULT ScanBlocks(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules);
 
+    // A scanner instance is not thread safe but each thread can use its own one, they share the compiled rules.
+    // Rules must not be added, enabled or disabled while scanners exist, except by DisableRulesOverBudget.
+    using ScannerPtr = std::unique_ptr<YR_SCANNER, std::function<void(YR_SCANNER*)>>;
+    ScannerPtr CreateScanner();
+
+    HRESULT Scan(YR_SCANNER* scanner, const uint8_t* buffer, size_t bytesToScan, MatchingRuleCollection& matchingRules);
+
     HRESULT Scan(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules);
     HRESULT Scan(
         const std::shared_ptr<ByteStream>& stream,
@@ -182,6 +271,13 @@ public:
 
     HRESULT PrintConfiguration();
 
+    // Slowest rules over all the scans when profiling is enabled, at most 'profiledRules' of them (see YaraConfig)
+    std::vector<YaraRuleProfile> SlowestRules() const;
+
+    // Disable the rules which exceeded the rule budget during the scans of the workers, from the thread owning the
+    // scanner. Scan(stream) does it before each scan.
+    void DisableRulesOverBudget();
+
     // takes are of the splitting of rules
     static std::vector<std::string> GetRulesSpec(LPCSTR szRules);
     static std::vector<std::string> GetRulesSpec(LPCWSTR szRules);
@@ -222,20 +318,46 @@ private:
         MatchingRuleCollection& matchingRules,
         ULONG& bytesScanned);
 
-    std::pair<HRESULT, std::shared_ptr<MemoryStream>> GetMemoryStream(const std::shared_ptr<ByteStream>& byteStream);
-    std::unique_ptr<YR_STREAM> GetYaraStream(const std::shared_ptr<ByteStream>& byteStream);
+    HRESULT ScanMemory(const uint8_t* data, size_t size, MatchingRuleCollection& matchingRules);
+
+    // Read the whole stream in the block buffer and scan it as a single block
+    HRESULT ScanSmallStream(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules);
+
+    // Scan with the method which suits the stream (see Scan, which traces the scan)
+    HRESULT ScanStream(const std::shared_ptr<ByteStream>& stream, MatchingRuleCollection& matchingRules);
+
+    // Data of streams already in memory (memory streams, mapped views and resident data), scanned without a copy
+    static bool GetStreamData(const std::shared_ptr<ByteStream>& stream, const uint8_t*& data, size_t& size);
+
+    HRESULT LoadRules(const std::shared_ptr<ByteStream>& stream);
+
+    HRESULT GetCachedRulesPath(std::wstring& path);
+    HRESULT LoadCachedRules(const std::wstring& path);
+    HRESULT SaveCachedRules(const std::wstring& path);
 
     YR_RULES* GetRules();
 
+    // Profiled scans go through a YR_SCANNER: yr_rules_scan_mem does not keep the profiling information
+    YR_SCANNER* ProfilingScanner();
+    void AddProfilingInfo(YR_SCANNER* scanner);
+
     std::shared_ptr<YaraStaticExtension> m_yara;
 
     YaraConfig m_config;
 
     YR_COMPILER* m_pCompiler = nullptr;
     YR_RULES* m_pRules = nullptr;
+    std::string m_Sources;  // sources added to the compiler, only kept to find their compiled rules in cache
+    bool m_bLoadedRules = false;
     ULONG m_ErrorCount = 0;
     ULONG m_WarningCount = 0;
     MemoryBlockBuffer m_blockBuffer;
+
+    ScannerPtr m_profilingScanner;
+    mutable std::mutex m_profilingMutex;  // workers add their scanner's profiling information concurrently
+    std::unordered_map<const YR_RULE*, std::chrono::nanoseconds> m_ruleTimes;
+    std::vector<YR_RULE*> m_rulesOverBudget;  // waiting to be disabled by the thread owning the scanner
+    std::unordered_set<const YR_RULE*> m_disabledRules;
 };
 
 }  // namespace Orc
@@ -30,8 +30,8 @@
 #include "ArchiveUpdateCallback.h"
 #include "ArchiveOpenCallback.h"
 
-#include "CaseInsensitive.h"
 #include "Temporary.h"
+#include "Archive/CompressionLevel.h"
 
 using namespace std;
 using namespace lib7z;
@@ -77,40 +77,16 @@ void StoreFileHashes(OrcArchive::ArchiveItems& items, bool releaseInputStreams)
 ZipCreate::ZipCreate(bool bComputeHash)
     : ArchiveCreate(bComputeHash)
     , m_FormatGUID(CLSID_NULL)
-    , m_CompressionLevel(Fast)
+    , m_CompressionLevel(Archive::CompressionLevel::kFast)
+    , m_CompressionThreads(Archive::kAutoCompressionThreads)
 {
 }
 
-ZipCreate::CompressionLevel ZipCreate::GetCompressionLevel(const std::wstring& strLevel)
-{
-    if (strLevel.empty())
-    {
-        return ZipCreate::CompressionLevel::Fast;
-    }
-
-    if (equalCaseInsensitive(strLevel, L"None"))
-        return ZipCreate::CompressionLevel::None;
-    if (equalCaseInsensitive(strLevel, L"Fastest"))
-        return ZipCreate::CompressionLevel::Fastest;
-    if (equalCaseInsensitive(strLevel, L"Fast"))
-        return ZipCreate::CompressionLevel::Fast;
-    if (equalCaseInsensitive(strLevel, L"Normal"))
-        return ZipCreate::CompressionLevel::Normal;
-    if (equalCaseInsensitive(strLevel, L"Maximum"))
-        return ZipCreate::CompressionLevel::Maximum;
-    if (equalCaseInsensitive(strLevel, L"Ultra"))
-        return ZipCreate::CompressionLevel::Ultra;
-
-    Log::Warn(L"Selecting default compression level (unrecognised parameter was '{}')", strLevel);
-
-    return ZipCreate::CompressionLevel::Fast;
-}
-
-HRESULT ZipCreate::SetCompressionLevel(const CComPtr<IOutArchive>& pArchiver, CompressionLevel level)
+HRESULT ZipCreate::SetCompressionLevel(const CComPtr<IOutArchive>& pArchiver, Archive::CompressionLevel level)
 {
     HRESULT hr = E_FAIL;
 
-    Log::Debug(L"ZipCreate: {}: set compression level to {}", m_ArchiveName, static_cast<size_t>(level));
+    Log::Debug(L"ZipCreate: {}: set compression level to {}", m_ArchiveName, Archive::ToWString(level));
 
     if (!pArchiver)
     {
@@ -118,9 +94,13 @@ HRESULT ZipCreate::SetCompressionLevel(const CComPtr<IOutArchive>& pArchiver, Co
         return E_POINTER;
     }
 
-    const size_t numProps = 1;
-    const wchar_t* names[numProps] = {L"x"};
-    CPropVariant values[numProps] = {static_cast<UInt32>(level)};  // test with
+    // Zip compresses several items concurrently, 7z relies on LZMA2 which splits each solid block between threads
+    const auto threads = Archive::ToCompressionThreads(m_CompressionThreads);
+    Log::Debug(L"ZipCreate: {}: use {} compression threads", m_ArchiveName, threads);
+
+    const size_t numProps = 2;
+    const wchar_t* names[numProps] = {L"x", L"mt"};
+    CPropVariant values[numProps] = {static_cast<UInt32>(Archive::ToLib7zLevel(level)), static_cast<UInt32>(threads)};
 
     CComPtr<ISetProperties> setter;
     if (FAILED(hr = pArchiver->QueryInterface(IID_ISetProperties, reinterpret_cast<void**>(&setter))))
@@ -198,8 +178,20 @@ HRESULT ZipCreate::SetCompressionLevel(__in const std::wstring& level)
         return S_OK;
     }
 
-    Log::Debug(L"Updated internal compression level to {}", level);
-    m_CompressionLevel = GetCompressionLevel(level);
+    std::error_code ec;
+    auto compressionLevel = Archive::ToCompressionLevel(level, ec);
+    if (ec)
+    {
+        Log::Warn(L"Selecting default compression level (unrecognised parameter was '{}')", level);
+        compressionLevel = Archive::CompressionLevel::kDefault;
+    }
+
+    // Unlike Archive7z, the default level of ZipCreate has always been 'Fast'
+    if (compressionLevel == Archive::CompressionLevel::kDefault)
+        compressionLevel = Archive::CompressionLevel::kFast;
+
+    Log::Debug(L"Updated internal compression level to {}", Archive::ToWString(compressionLevel));
+    m_CompressionLevel = compressionLevel;
 
     return S_OK;
 }
@@ -228,9 +220,7 @@ STDMETHODIMP ZipCreate::Internal_FlushQueue(bool bFinal)
         if (FAILED(hr = SetCompressionLevel(pArchiver, m_CompressionLevel)))
         {
             Log::Error(
-                L"Failed to set compression level to {} [{}]",
-                static_cast<size_t>(m_CompressionLevel),
-                SystemError(hr));
+                L"Failed to set compression level to {} [{}]", Archive::ToWString(m_CompressionLevel), SystemError(hr));
             return hr;
         }
 
@@ -11,6 +11,7 @@
 #include "OrcLib.h"
 
 #include "ArchiveCreate.h"
+#include "Archive/CompressionLevel.h"
 
 #include "7zip/IStream.h"
 #include "7zip/Archive/IArchive.h"
@@ -27,27 +28,18 @@ class ZipCreate : public ArchiveCreate
     friend class ArchiveCreate;
 
 public:
-    typedef enum _CL
-    {
-        None = 0,
-        Fastest = 1,
-        Fast = 3,
-        Normal = 5,
-        Maximum = 7,
-        Ultra = 9
-    } CompressionLevel;
-
-public:
-    CompressionLevel GetCompressionLevel(const std::wstring& strLevel);
-
     // ArchiveCompress methods
     STDMETHOD(InitArchive)(__in const std::filesystem::path& path, OrcArchive::ArchiveCallback pCallback = nullptr);
     STDMETHOD(InitArchive)(__in PCWSTR pwzArchivePath, OrcArchive::ArchiveCallback pCallback = nullptr);
     STDMETHOD(InitArchive)
     (__in const std::shared_ptr<ByteStream>& pOutputStream, OrcArchive::ArchiveCallback pCallback = nullptr);
 
+    // Same levels as Archive7z, "default" (or no level) is 'kFast'
     STDMETHOD(SetCompressionLevel)(__in const std::wstring& strLevel);
 
+    // Upper bound for the items compressed concurrently, the job object restrictions still apply
+    void SetCompressionThreads(uint32_t threads) { m_CompressionThreads = threads; }
+
     STDMETHOD(FlushQueue)();
     STDMETHOD(Complete)();
     STDMETHOD(Abort)();
@@ -60,11 +52,12 @@ private:
     std::shared_ptr<ByteStream> m_ArchiveStream;
     std::wstring m_ArchiveName;
     GUID m_FormatGUID;
-    CompressionLevel m_CompressionLevel;
+    Archive::CompressionLevel m_CompressionLevel;
+    uint32_t m_CompressionThreads;
 
     ZipCreate(bool bComputeHash = false);
 
-    STDMETHOD(SetCompressionLevel)(const CComPtr<IOutArchive>& pArchiver, CompressionLevel level);
+    STDMETHOD(SetCompressionLevel)(const CComPtr<IOutArchive>& pArchiver, Archive::CompressionLevel level);
 
     STDMETHOD(Internal_FlushQueue)(bool bFinal);
 };
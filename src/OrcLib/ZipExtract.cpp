@@ -8,7 +8,9 @@
 
 #include "stdafx.h"
 
+#include <algorithm>
 #include <filesystem>
+#include <map>
 
 #include <7zip/7zip.h>
 
@@ -23,6 +25,7 @@
 #include "OutByteStreamWrapper.h"
 #include "InByteStreamWrapper.h"
 #include "ParameterCheck.h"
+#include "TaskPool.h"
 
 #include "ArchiveOpenCallback.h"
 #include "ArchiveExtractCallback.h"
@@ -41,6 +44,83 @@ ZipExtract::ZipExtract(bool bComputeHash)
 
 ZipExtract::~ZipExtract(void) {}
 
+namespace {
+
+// Items outside of any 7z folder (directories, empty files)
+constexpr UInt32 kNoFolder = static_cast<UInt32>(-1);
+
+HRESULT
+OpenArchive(ZipLibrary& zipLib, const std::shared_ptr<ByteStream>& inputStream, CComPtr<IInArchive>& archive)
+{
+    HRESULT hr = E_FAIL;
+
+    if (FAILED(hr = zipLib.CreateObject(&CLSID_CFormat7z, &IID_IInArchive, reinterpret_cast<void**>(&archive))))
+    {
+        Log::Error(L"Failed to create archive reader [{}]", SystemError(hr));
+        return hr;
+    }
+
+    CComQIPtr<IInStream, &IID_IInStream> infile = new InByteStreamWrapper(inputStream);
+    CComPtr<ArchiveOpenCallback> openCallback = new ArchiveOpenCallback();
+
+    if ((hr = archive->Open(infile, 0, openCallback)) != S_OK)
+    {
+        Log::Error(L"Failed when opening archive [{}]", SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+// Group the indexes of the items to extract by 7z folder: folders are decoded independently from each other while the
+// items of a solid folder have to be decoded in sequence
+HRESULT GetFoldersToExtract(
+    IInArchive* archive,
+    const ArchiveExtract::ItemShouldBeExtractedCallback& shouldBeExtracted,
+    std::vector<std::vector<UInt32>>& folders)
+{
+    HRESULT hr = E_FAIL;
+
+    UInt32 itemCount = 0;
+    if (FAILED(hr = archive->GetNumberOfItems(&itemCount)))
+    {
+        Log::Error(L"Failed to get archive item count [{}]", SystemError(hr));
+        return hr;
+    }
+
+    std::map<UInt32, std::vector<UInt32>> byFolder;
+    for (UInt32 index = 0; index < itemCount; index++)
+    {
+        std::wstring strName;
+        if (FAILED(hr = ArchiveExtractCallback::GetItemName(archive, index, strName)))
+        {
+            Log::Error(L"Failed to get name of archive item #{} [{}]", index, SystemError(hr));
+            return hr;
+        }
+
+        if (!shouldBeExtracted(strName))
+            continue;
+
+        UInt32 folder = kNoFolder;
+
+        CPropVariant prop;
+        if (archive->GetProperty(index, kpidBlock, &prop) == S_OK && prop.vt == VT_UI4)
+            folder = prop.ulVal;
+
+        // Indexes are kept sorted, as required by IInArchive::Extract
+        byFolder[folder].push_back(index);
+    }
+
+    for (auto& [folder, indexes] : byFolder)
+    {
+        folders.push_back(std::move(indexes));
+    }
+
+    return S_OK;
+}
+
+}  // namespace
+
 STDMETHODIMP ZipExtract::Extract(
     __in ArchiveExtract::MakeArchiveStream makeArchiveStream,
     __in const ItemShouldBeExtractedCallback pShouldBeExtracted,
@@ -62,39 +142,120 @@ STDMETHODIMP ZipExtract::Extract(
         return E_FAIL;
     }
 
-    CComPtr<IInArchive> archive;
+    std::shared_ptr<ByteStream> InputStream;
 
-    if (FAILED(hr = pZipLib->CreateObject(&CLSID_CFormat7z, &IID_IInArchive, reinterpret_cast<void**>(&archive))))
+    if (FAILED(hr = makeArchiveStream(InputStream)))
     {
-        Log::Error(L"Failed to create archive reader [{}]", SystemError(hr));
+        Log::Error(L"Failed to make archive stream [{}]", SystemError(hr));
         return hr;
     }
 
-    std::shared_ptr<ByteStream> InputStream;
+    CComPtr<IInArchive> archive;
+    if (FAILED(hr = OpenArchive(*pZipLib, InputStream, archive)))
+        return hr;
 
-    if (FAILED(hr = makeArchiveStream(InputStream)))
-    {
-        Log::Error(L"Failed to make archive stream [{}]", SystemError(hr));
+    // Only the folders holding selected items are decoded
+    std::vector<std::vector<UInt32>> folders;
+    if (FAILED(hr = GetFoldersToExtract(archive, pShouldBeExtracted, folders)))
         return hr;
+
+    if (folders.empty())
+        return S_OK;
+
+    // Other folders are decoded in parallel, each from its own archive stream: the archive stream factory has to
+    // return a stream independent of the first one
+    std::vector<std::shared_ptr<ByteStream>> folderStreams(folders.size());
+    folderStreams[0] = InputStream;
+    for (size_t i = 1; i < folders.size(); i++)
+    {
+        std::shared_ptr<ByteStream> stream;
+        if (FAILED(makeArchiveStream(stream)) || stream == nullptr || stream == InputStream)
+        {
+            Log::Debug(L"Archive stream cannot be reopened, folders are extracted sequentially");
+            folderStreams.resize(1);
+            break;
+        }
+
+        folderStreams[i] = std::move(stream);
     }
 
-    CComQIPtr<IInStream, &IID_IInStream> infile = new InByteStreamWrapper(InputStream);
-    CComPtr<ArchiveOpenCallback> openCallback = new ArchiveOpenCallback();
+    if (folderStreams.size() == 1)
+    {
+        std::vector<UInt32> indexes;
+        for (const auto& folder : folders)
+        {
+            indexes.insert(std::cend(indexes), std::cbegin(folder), std::cend(folder));
+        }
+        std::sort(std::begin(indexes), std::end(indexes));
 
-    if ((hr = archive->Open(infile, 0, openCallback)) != S_OK)
+        CComPtr<ArchiveExtractCallback> extractCallback = new ArchiveExtractCallback(
+            archive, pShouldBeExtracted, m_Items, MakeWriteAbleStream, m_Callback, m_bComputeHash, m_Password);
+
+        hr = archive->Extract(indexes.data(), static_cast<UInt32>(indexes.size()), false, extractCallback);
+        if (hr != S_OK)  // returning S_FALSE also indicates error
+        {
+            Log::Error(L"Failed when extracting archive [{}]", SystemError(hr));
+            return hr;
+        }
+
+        return S_OK;
+    }
+
+    // Output streams creation and item callbacks are not expected to be thread safe
+    auto makeWriteAbleStream = [this, &MakeWriteAbleStream](OrcArchive::ArchiveItem& item) {
+        concurrency::critical_section::scoped_lock lock(m_cs);
+        return MakeWriteAbleStream(item);
+    };
+
+    OrcArchive::ArchiveCallback callback;
+    if (m_Callback)
     {
-        Log::Error(L"Failed when opening archive [{}]", SystemError(hr));
-        return hr;
+        callback = [this](const OrcArchive::ArchiveItem& item) {
+            concurrency::critical_section::scoped_lock lock(m_cs);
+            m_Callback(item);
+        };
     }
 
-    CComPtr<ArchiveExtractCallback> extractCallback = new ArchiveExtractCallback(
-        archive, pShouldBeExtracted, m_Items, MakeWriteAbleStream, m_Callback, m_bComputeHash, m_Password);
+    std::vector<OrcArchive::ArchiveItems> folderItems(folders.size());
+    std::vector<HRESULT> folderResults(folders.size(), S_OK);
+
+    TaskPool::ParallelFor(TaskPool::Subsystem::Archive, size_t(0), folders.size(), [&](size_t i) {
+        CComPtr<IInArchive> folderArchive;
+        if (i == 0)
+            folderArchive = archive;
+        else if (FAILED(folderResults[i] = OpenArchive(*pZipLib, folderStreams[i], folderArchive)))
+            return;
+
+        CComPtr<ArchiveExtractCallback> extractCallback = new ArchiveExtractCallback(
+            folderArchive,
+            pShouldBeExtracted,
+            folderItems[i],
+            makeWriteAbleStream,
+            callback,
+            m_bComputeHash,
+            m_Password);
+
+        auto& indexes = folders[i];
+        HRESULT hrFolder =
+            folderArchive->Extract(indexes.data(), static_cast<UInt32>(indexes.size()), false, extractCallback);
+        if (hrFolder != S_OK)  // returning S_FALSE also indicates error
+        {
+            Log::Error(L"Failed when extracting archive folder (item: #{}) [{}]", indexes.front(), SystemError(hrFolder));
+            folderResults[i] = hrFolder == S_FALSE ? E_FAIL : hrFolder;
+        }
+    });
+
+    Log::Debug(L"Extracted {} archive folders in parallel", folders.size());
 
-    hr = archive->Extract(NULL, (UInt32)-1, false, extractCallback);
-    if (hr != S_OK)  // returning S_FALSE also indicates error
+    for (size_t i = 0; i < folders.size(); i++)
     {
-        Log::Error(L"Failed when extracting archive [{}]", SystemError(hr));
-        return hr;
+        std::move(std::begin(folderItems[i]), std::end(folderItems[i]), std::back_inserter(m_Items));
+    }
+
+    for (const auto folderResult : folderResults)
+    {
+        if (FAILED(folderResult))
+            return folderResult;
     }
 
     return S_OK;
@@ -12,6 +12,8 @@
 #include <arrow/api.h>
 #include <arrow/io/api.h>
 #include <arrow/builder.h>
+#include <arrow/compute/api.h>
+#include <arrow/util/compression.h>
 #include <parquet/arrow/reader.h>
 #include <parquet/arrow/writer.h>
 #include <arrow/array.h>
@@ -9,6 +9,7 @@
 
 #include "ParquetWriter.h"
 
+#include "TableOutputBatch.h"
 #include "FileStream.h"
 #include "ParquetStream.h"
 
@@ -16,10 +17,20 @@
 #include "OrcException.h"
 #include "WideAnsi.h"
 #include "Buffer.h"
+#include "BlockingQueue.h"
+#include "Text/Utf16ToUtf8.h"
 #include "Utils/Result.h"
-
+#include "CaseInsensitive.h"
+#include "Trace.h"
+#include "HostProfile.h"
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
 
 #include "ParquetDefinitions.h"
 #include "Utils/Result.h"
@@ -40,6 +51,236 @@ struct WriterT : public Orc::TableOutput::Parquet::Writer
     }
 };
 
+size_t CompressZstdSample(std::string_view input)
+{
+    auto codec = arrow::util::Codec::Create(arrow::Compression::ZSTD, Orc::TableOutput::kAutoZstdLevel);
+    if (!codec.ok())
+        return 0;
+
+    const auto pInput = reinterpret_cast<const uint8_t*>(input.data());
+    std::vector<uint8_t> output((*codec)->MaxCompressedLen(input.size(), pInput));
+
+    auto compressed = (*codec)->Compress(input.size(), pInput, output.size(), output.data());
+    return compressed.ok() ? static_cast<size_t>(*compressed) : 0;
+}
+
+arrow::Compression::type ToArrowCompression(Orc::TableOutput::Compression codec)
+{
+    using Orc::TableOutput::Compression;
+
+    switch (codec)
+    {
+        case Compression::kNone:
+            return arrow::Compression::UNCOMPRESSED;
+        case Compression::kSnappy:
+            return arrow::Compression::SNAPPY;
+        case Compression::kLz4:
+            return arrow::Compression::LZ4;
+        case Compression::kZstd:
+            return arrow::Compression::ZSTD;
+        case Compression::kAuto:
+            return ToArrowCompression(Orc::TableOutput::ResolveAutoCompression(CompressZstdSample));
+        case Compression::kGzip:
+        case Compression::kDefault:
+        default:
+            return arrow::Compression::GZIP;
+    }
+}
+
+// UTF16 columns are a struct of the utf8 conversion and, if the conversion fails, the raw UTF16 bytes
+void AppendUTF16(arrow::StructBuilder& builder, const std::wstring_view& svString)
+{
+    std::shared_ptr<arrow::StringBuilder> utf8_builder;
+    int utf8_id = 0;
+
+    std::shared_ptr<arrow::BinaryBuilder> raw_builder;
+    int raw_id = 0;
+
+    for (auto i = 0; i < builder.num_children(); i++)
+    {
+        const auto& child_builder = builder.child_builder(i);
+        if (!utf8_builder && child_builder->type()->id() == arrow::Type::STRING)
+        {
+            utf8_builder = std::dynamic_pointer_cast<arrow::StringBuilder>(child_builder);
+            utf8_id = i;
+        }
+        else if (!raw_builder && child_builder->type()->id() == arrow::Type::BINARY)
+        {
+            raw_builder = std::dynamic_pointer_cast<arrow::BinaryBuilder>(child_builder);
+            raw_id = i;
+        }
+        else
+        {
+            builder.AppendNull();
+        }
+    }
+
+    if (utf8_builder)
+    {
+        if (auto [hr, utf8] = WideToAnsi(svString); SUCCEEDED(hr))
+        {
+            utf8_builder->Append(utf8);
+            if (raw_builder)
+                raw_builder->AppendNull();
+            builder.Append(true);
+        }
+        else
+        {
+            raw_builder->Append((uint8_t*)svString.data(), svString.size() * sizeof(wchar_t));
+            if (utf8_builder)
+                utf8_builder->AppendNull();
+            builder.Append(true);
+        }
+    }
+}
+
+template <typename T>
+constexpr bool IsIntegerBuilder = std::is_same_v<T, arrow::UInt8Builder> || std::is_same_v<T, arrow::Int8Builder>
+    || std::is_same_v<T, arrow::UInt16Builder> || std::is_same_v<T, arrow::Int16Builder>
+    || std::is_same_v<T, arrow::UInt32Builder> || std::is_same_v<T, arrow::Int32Builder>
+    || std::is_same_v<T, arrow::UInt64Builder> || std::is_same_v<T, arrow::Int64Builder>;
+
+[[noreturn]] void ThrowInvalidBatchColumn(const Orc::TableOutput::BatchColumn& column)
+{
+    throw Orc::Exception(
+        Severity::Fatal,
+        E_INVALIDARG,
+        L"Not a valid arrow builder for batch column '{}'",
+        column.Definition().ColumnName);
+}
+
+// Append a whole batch column to its builder, with one call for fixed width values
+template <typename T, typename ConvertTimeStamp>
+void AppendBatchColumn(T& builder, const Orc::TableOutput::BatchColumn& column, ConvertTimeStamp convert)
+{
+    using Storage = Orc::TableOutput::BatchColumn::Storage;
+
+    const auto rows = static_cast<int64_t>(column.size());
+    const auto validity = column.Validity();
+
+    if constexpr (std::is_same_v<T, arrow::NullBuilder>)
+    {
+        builder.AppendNulls(rows);
+    }
+    else if constexpr (std::is_same_v<T, arrow::BooleanBuilder>)
+    {
+        if (column.GetStorage() != Storage::Integer)
+            ThrowInvalidBatchColumn(column);
+
+        std::vector<uint8_t> values(rows);
+        std::transform(column.Integers(), column.Integers() + rows, std::begin(values), [](int64_t value) {
+            return static_cast<uint8_t>(value != 0);
+        });
+        builder.AppendValues(values.data(), rows, validity);
+    }
+    else if constexpr (std::is_same_v<T, arrow::TimestampBuilder>)
+    {
+        if (column.GetStorage() != Storage::Integer)
+            ThrowInvalidBatchColumn(column);
+
+        std::vector<int64_t> values(rows);
+        std::transform(column.Integers(), column.Integers() + rows, std::begin(values), convert);
+        builder.AppendValues(values.data(), rows, validity);
+    }
+    else if constexpr (IsIntegerBuilder<T>)
+    {
+        if (column.GetStorage() != Storage::Integer)
+            ThrowInvalidBatchColumn(column);
+
+        using value_type = typename T::value_type;
+
+        std::vector<value_type> values(rows);
+        std::transform(column.Integers(), column.Integers() + rows, std::begin(values), [](int64_t value) {
+            return static_cast<value_type>(value);
+        });
+        builder.AppendValues(values.data(), rows, validity);
+    }
+    else if constexpr (std::is_same_v<T, arrow::StringBuilder> || std::is_same_v<T, arrow::BinaryBuilder>)
+    {
+        if (column.GetStorage() == Storage::Bytes)
+        {
+            for (int64_t i = 0; i < rows; i++)
+            {
+                if (!column.IsValid(i))
+                {
+                    builder.AppendNull();
+                    continue;
+                }
+
+                const auto value = column.BytesAt(i);
+                builder.Append(reinterpret_cast<const uint8_t*>(value.data()), static_cast<int32_t>(value.size()));
+            }
+        }
+        else if (column.GetStorage() == Storage::WideChars && std::is_same_v<T, arrow::BinaryBuilder>)
+        {
+            // XML values are kept as raw UTF16, like WriteXML does
+            for (int64_t i = 0; i < rows; i++)
+            {
+                if (!column.IsValid(i))
+                {
+                    builder.AppendNull();
+                    continue;
+                }
+
+                const auto value = column.WideCharsAt(i);
+                builder.Append(
+                    reinterpret_cast<const uint8_t*>(value.data()), static_cast<int32_t>(value.size() * sizeof(WCHAR)));
+            }
+        }
+        else
+            ThrowInvalidBatchColumn(column);
+    }
+    else if constexpr (std::is_same_v<T, arrow::StringDictionary32Builder>)
+    {
+        std::string utf8;
+
+        for (int64_t i = 0; i < rows; i++)
+        {
+            if (!column.IsValid(i))
+            {
+                builder.AppendNull();
+                continue;
+            }
+
+            if (column.GetStorage() == Storage::Bytes)
+            {
+                const auto value = column.BytesAt(i);
+                builder.Append(value.data(), static_cast<int32_t>(value.size()));
+            }
+            else if (column.GetStorage() == Storage::WideChars)
+            {
+                utf8.clear();
+                Text::AppendUtf16ToUtf8(column.WideCharsAt(i), utf8);
+                builder.Append(utf8.data(), static_cast<int32_t>(utf8.size()));
+            }
+            else
+                ThrowInvalidBatchColumn(column);
+        }
+    }
+    else if constexpr (std::is_same_v<T, arrow::FixedSizeBinaryBuilder>)
+    {
+        if (column.GetStorage() != Storage::FixedBytes)
+            ThrowInvalidBatchColumn(column);
+
+        builder.AppendValues(column.Bytes(), rows, validity);
+    }
+    else if constexpr (std::is_same_v<T, arrow::StructBuilder>)
+    {
+        if (column.GetStorage() != Storage::WideChars)
+            ThrowInvalidBatchColumn(column);
+
+        for (int64_t i = 0; i < rows; i++)
+        {
+            if (column.IsValid(i))
+                AppendUTF16(builder, column.WideCharsAt(i));
+            else
+                builder.AppendNull();
+        }
+    }
+    else
+        ThrowInvalidBatchColumn(column);
+}
+
 }  // namespace
 
 class Orc::TableOutput::Parquet::WriterTermination : public TerminationHandler
@@ -80,6 +321,180 @@ Orc::TableOutput::Parquet::Writer::Writer(std::unique_ptr<Options>&& options)
 {
 }
 
+struct Orc::TableOutput::Parquet::Writer::RowGroup
+{
+    std::vector<TableOutput::RecordBatch> batches;
+    DWORD dwRows = 0L;
+
+    Builders builders;
+    std::vector<std::shared_ptr<arrow::Array>> arrays;
+
+    // Set by the encoder thread building the last column chunk
+    std::atomic<size_t> pendingColumns = 0;
+    std::promise<void> encoded;
+
+    std::mutex errorMutex;
+    HRESULT hr = S_OK;
+};
+
+struct Orc::TableOutput::Parquet::Writer::Pipeline
+{
+    // Row groups encoded or waiting to be written, the caller blocks beyond that
+    static constexpr size_t kQueuedRowGroups = 2;
+
+    struct Task
+    {
+        std::shared_ptr<RowGroup> rowGroup;
+        size_t column;
+    };
+
+    explicit Pipeline(size_t columns)
+        : tasks(kQueuedRowGroups * (columns ? columns : 1))
+        , rowGroups(kQueuedRowGroups)
+    {
+    }
+
+    BlockingQueue<Task> tasks;
+    BlockingQueue<std::pair<std::shared_ptr<RowGroup>, std::future<void>>> rowGroups;
+
+    std::vector<std::thread> encoders;
+    std::thread writer;
+
+    std::mutex mutex;
+    std::condition_variable written;
+    ULONGLONG ullSubmitted = 0LL;
+    ULONGLONG ullWritten = 0LL;
+    HRESULT hr = S_OK;
+};
+
+int64_t Orc::TableOutput::Parquet::Writer::BatchTimeStamp(int64_t value)
+{
+    ULARGE_INTEGER uli;
+    uli.QuadPart = static_cast<ULONGLONG>(value);
+
+    FILETIME fileTime;
+    fileTime.dwLowDateTime = uli.LowPart;
+    fileTime.dwHighDateTime = uli.HighPart;
+    return static_cast<int64_t>(ConvertTo(fileTime));
+}
+
+DWORD Orc::TableOutput::Parquet::Writer::RowGroupSize() const
+{
+    if (m_Options && m_Options->RowGroupSize.has_value())
+        return m_Options->RowGroupSize.value();
+
+    if (const auto dwRows = HostProfile::Instance().RowGroupSize(); dwRows > 0)
+        return dwRows;
+
+    return kDefaultRowGroupSize;
+}
+
+void Orc::TableOutput::Parquet::Writer::SetLookupProperties(parquet::WriterProperties::Builder& builder)
+{
+    // Min/max values of each page are also written in the footer so that readers skip pages, not only row groups
+    builder.enable_write_page_index();
+
+    m_sortOptions.reset();
+
+    if (!m_Options)
+        return;
+
+    // Name of the column matching 'strName' and index of its first parquet leaf column: UTF16 columns are a struct of
+    // two leaves (utf8, raw) where lookups use the utf8 one. The same options apply to all the tables of an output,
+    // columns missing from this table are ignored
+    struct LeafColumn
+    {
+        std::string strName;
+        int iLeaf = 0;
+        bool bStruct = false;
+    };
+
+    auto findColumn = [this](const std::wstring& strName) -> std::optional<LeafColumn> {
+        int iLeaf = 0;
+        for (const auto& column : m_Schema)
+        {
+            const bool bStruct = column->Type == UTF16Type && !column->bDictionary;
+
+            if (equalCaseInsensitive(column->ColumnName, strName))
+            {
+                auto [hr, strColumn] = WideToAnsi(column->ColumnName);
+                if (FAILED(hr))
+                    return std::nullopt;
+
+                return LeafColumn {std::move(strColumn), iLeaf, bStruct};
+            }
+
+            iLeaf += bStruct ? 2 : 1;
+        }
+
+        Log::Debug(L"Column '{}' is not part of this parquet table", strName);
+        return std::nullopt;
+    };
+
+    std::vector<arrow::compute::SortKey> sortKeys;
+    std::vector<parquet::SortingColumn> sortingColumns;
+    for (const auto& key : m_Options->SortKeys)
+    {
+        auto column = findColumn(key);
+        if (!column)
+            continue;
+
+        if (column->bStruct)
+            sortKeys.emplace_back(arrow::FieldRef(column->strName, "utf8"), arrow::compute::SortOrder::Ascending);
+        else
+            sortKeys.emplace_back(arrow::FieldRef(column->strName), arrow::compute::SortOrder::Ascending);
+
+        parquet::SortingColumn sorting;
+        sorting.column_idx = column->iLeaf;
+        sorting.descending = false;
+        sorting.nulls_first = false;
+        sortingColumns.push_back(sorting);
+    }
+
+    if (!sortKeys.empty())
+    {
+        m_sortOptions.emplace(std::move(sortKeys), arrow::compute::NullPlacement::AtEnd);
+        builder.set_sorting_columns(std::move(sortingColumns));
+    }
+
+    // A row group holds at most RowGroupSize() distinct values, the filter is sized for 1% of false positives
+    parquet::BloomFilterOptions bloomFilter;
+    bloomFilter.ndv = static_cast<int32_t>(RowGroupSize());
+    bloomFilter.fpp = 0.01;
+
+    for (const auto& name : m_Options->BloomFilters)
+    {
+        auto column = findColumn(name);
+        if (!column)
+            continue;
+
+        builder.enable_bloom_filter(column->bStruct ? column->strName + ".utf8" : column->strName, bloomFilter);
+    }
+}
+
+HRESULT Orc::TableOutput::Parquet::Writer::SortRows(std::shared_ptr<arrow::Table>& table) const
+{
+    if (!m_sortOptions || table->num_rows() < 2)
+        return S_OK;
+
+    auto indices = arrow::compute::SortIndices(arrow::Datum(table), *m_sortOptions);
+    if (!indices.ok())
+    {
+        Log::Error("Failed to sort arrow table '{}'", indices.status().ToString());
+        return E_FAIL;
+    }
+
+    auto sorted = arrow::compute::Take(arrow::Datum(table), arrow::Datum(*indices));
+    if (!sorted.ok())
+    {
+        Log::Error("Failed to reorder arrow table '{}'", sorted.status().ToString());
+        return E_FAIL;
+    }
+
+    table = sorted->table();
+    return S_OK;
+}
+
 Orc::TableOutput::Parquet::Writer::Builders Orc::TableOutput::Parquet::Writer::GetBuilders()
 {
     Builders retval;
@@ -148,7 +563,9 @@ Orc::TableOutput::Parquet::Writer::Builders Orc::TableOutput::Parquet::Writer::G
                 break;
             }
             case arrow::Type::DICTIONARY: {
-                retval.emplace_back(std::make_unique<arrow::StringDictionaryBuilder>(column->type(), pool));
+                // Indexes must have the type of the schema in every row group, not the smallest one that fits
+                const auto& dictionary = static_cast<const arrow::DictionaryType&>(*column->type());
+                retval.emplace_back(std::make_unique<arrow::StringDictionary32Builder>(dictionary.value_type(), pool));
                 break;
             }
             case arrow::Type::LIST: {
@@ -240,8 +657,31 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::SetSchema(const TableOutput::Sch
 
     parquet::WriterProperties::Builder props_builder;
     props_builder.data_pagesize(4096 * 1024);
-    props_builder.max_row_group_length(10000);
-    props_builder.compression(parquet::Compression::GZIP);
+    props_builder.max_row_group_length(RowGroupSize());
+
+    auto compression = arrow::Compression::GZIP;
+    std::optional<int> level;
+    if (m_Options)
+    {
+        compression = ToArrowCompression(m_Options->Compression.Codec);
+        level = m_Options->Compression.Level;
+
+        if (m_Options->Compression.Codec == Compression::kAuto && compression == arrow::Compression::ZSTD)
+            level = kAutoZstdLevel;
+    }
+
+    if (!arrow::util::Codec::IsAvailable(compression))
+    {
+        Log::Warn(L"Parquet codec {} is not available, using gzip", ToWString(m_Options->Compression.Codec));
+        compression = arrow::Compression::GZIP;
+        level.reset();
+    }
+
+    props_builder.compression(compression);
+    if (level.has_value())
+        props_builder.compression_level(level.value());
+
+    SetLookupProperties(props_builder);
 
     m_parquetProps = props_builder.build();
 
@@ -295,6 +735,14 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::SetSchema(const TableOutput::Sch
                 schema_definition.push_back(arrow::field(strName, arrow::timestamp(arrow::TimeUnit::MICRO), true));
                 break;
             case UTF16Type:
+                if (column->bDictionary)
+                {
+                    // Converted to utf8 like the values of the ApacheOrc writer, there is no room for the raw bytes
+                    schema_definition.push_back(
+                        arrow::field(strName, arrow::dictionary(arrow::int32(), arrow::utf8()), true));
+                    break;
+                }
+
                 using namespace std::string_literals;
                 schema_definition.push_back(arrow::field(
                     strName,
@@ -302,7 +750,11 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::SetSchema(const TableOutput::Sch
                     true));
                 break;
             case UTF8Type:
-                schema_definition.push_back(arrow::field(strName, arrow::utf8(), true));
+                if (column->bDictionary)
+                    schema_definition.push_back(
+                        arrow::field(strName, arrow::dictionary(arrow::int32(), arrow::utf8()), true));
+                else
+                    schema_definition.push_back(arrow::field(strName, arrow::utf8(), true));
                 break;
             case BinaryType:
                 schema_definition.push_back(arrow::field(strName, arrow::binary(), true));
@@ -363,6 +815,75 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::SetSchema(const TableOutput::Sch
     return S_OK;
 }
 
+STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteBatch(const TableOutput::RecordBatch& batch)
+{
+    if (batch.ColumnCount() != m_dwColumnNumber)
+    {
+        Log::Error(
+            L"Invalid number of columns in batch written to Parquet (got {}, expected {})",
+            batch.ColumnCount(),
+            m_dwColumnNumber);
+        return E_INVALIDARG;
+    }
+
+    if (m_dwColumnCounter != 0L)
+    {
+        Log::Error(L"Cannot write a batch to Parquet while a row is being written");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+    }
+
+    if (batch.empty())
+        return S_OK;
+
+    if (m_Options && m_Options->dwEncoderThreads > 0)
+    {
+        // Rows written one by one are still in the builders and go first
+        if (m_dwBatchRowCount > 0L)
+        {
+            if (auto hr = Flush(); FAILED(hr))
+                return hr;
+        }
+
+        ScopedLock sl(m_cs);
+
+        if (!m_pendingRowGroup)
+            m_pendingRowGroup = std::make_shared<RowGroup>();
+
+        m_pendingRowGroup->batches.push_back(batch);
+        m_pendingRowGroup->dwRows += static_cast<DWORD>(batch.RowCount());
+        m_dwTotalRowCount += static_cast<DWORD>(batch.RowCount());
+
+        if (m_pendingRowGroup->dwRows >= RowGroupSize())
+            return SubmitRowGroup();
+
+        return S_OK;
+    }
+
+    {
+        ScopedLock sl(m_cs);
+
+        for (DWORD i = 0; i < m_dwColumnNumber; i++)
+        {
+            const auto& column = batch[i];
+            std::visit([&column](auto&& arg) { AppendBatchColumn(*arg, column, BatchTimeStamp); }, m_arrowBuilders[i]);
+        }
+    }
+
+    m_dwBatchRowCount += static_cast<DWORD>(batch.RowCount());
+    m_dwTotalRowCount += static_cast<DWORD>(batch.RowCount());
+
+    if (m_Options && m_Options->BatchSize.has_value())
+    {
+        if (m_dwBatchRowCount >= m_Options->BatchSize.value())
+        {
+            Log::Debug(L"Batch is full --> Flush() ({} rows)", m_dwBatchRowCount);
+            if (auto hr = Flush(); FAILED(hr))
+                return hr;
+        }
+    }
+    return S_OK;
+}
+
 HRESULT Orc::TableOutput::Parquet::Writer::WriteToFile(const fs::path& path)
 {
     return WriteToFile(path.c_str());
@@ -439,6 +960,15 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::Flush()
         return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
     }
 
+    if (auto hr = SubmitRowGroup(); FAILED(hr))
+        return hr;
+
+    if (auto hr = WaitRowGroups(); FAILED(hr))
+        return hr;
+
+    if (m_pipeline && m_dwBatchRowCount == 0L)
+        return S_OK;
+
     std::vector<std::shared_ptr<arrow::Array>> arrays;
     arrays.reserve(m_arrowBuilders.size());
 
@@ -462,7 +992,12 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::Flush()
         return E_FAIL;
     }
 
+    if (auto hr = SortRows(table); FAILED(hr))
+        return hr;
+
+    const auto activity = Trace::TableFlushStart("Parquet", table->num_rows(), 0LL);
     auto status = m_arrowWriter->WriteTable(*table, table->num_rows());
+    Trace::TableFlushStop(activity, status.ok() ? S_OK : E_FAIL);
     if (!status.ok())
     {
         Log::Error("Failed to write arrow table '{}'", status.ToString());
@@ -470,6 +1005,197 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::Flush()
     }
 
     m_arrowBuilders = GetBuilders();
+    m_dwBatchRowCount = 0L;
+
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::Parquet::Writer::SubmitRowGroup()
+{
+    if (!m_pendingRowGroup || m_pendingRowGroup->dwRows == 0L)
+        return S_OK;
+
+    if (!m_arrowWriter)
+    {
+        Log::Debug(L"Orc::TableOutput::Parquet::Writer::SubmitRowGroup: No arrrow writer");
+        return HRESULT_FROM_WIN32(ERROR_INVALID_STATE);
+    }
+
+    if (!m_pipeline)
+    {
+        m_pipeline = std::make_shared<Pipeline>(m_dwColumnNumber);
+
+        for (DWORD i = 0; i < m_Options->dwEncoderThreads; i++)
+        {
+            m_pipeline->encoders.emplace_back([this, pipeline = m_pipeline.get()]() {
+                while (auto task = pipeline->tasks.Pop())
+                {
+                    EncodeColumn(*task->rowGroup, task->column);
+                }
+            });
+        }
+
+        m_pipeline->writer = std::thread([this, pipeline = m_pipeline.get()]() {
+            while (auto item = pipeline->rowGroups.Pop())
+            {
+                auto& [rowGroup, encoded] = *item;
+                encoded.wait();
+
+                HRESULT hr = S_OK;
+                {
+                    std::lock_guard<std::mutex> lock(pipeline->mutex);
+                    hr = pipeline->hr;
+                }
+
+                // Once a row group is lost the following ones are dropped too: the file would have a hole
+                if (SUCCEEDED(hr))
+                    hr = WriteRowGroup(*rowGroup);
+
+                rowGroup.reset();
+
+                {
+                    std::lock_guard<std::mutex> lock(pipeline->mutex);
+                    if (FAILED(hr))
+                        pipeline->hr = hr;
+                    pipeline->ullWritten++;
+                }
+
+                pipeline->written.notify_all();
+            }
+        });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_pipeline->mutex);
+        if (FAILED(m_pipeline->hr))
+            return m_pipeline->hr;
+    }
+
+    auto rowGroup = std::move(m_pendingRowGroup);
+    rowGroup->builders = GetBuilders();
+    rowGroup->arrays.resize(m_dwColumnNumber);
+    rowGroup->pendingColumns = m_dwColumnNumber;
+
+    auto encoded = rowGroup->encoded.get_future();
+    if (m_dwColumnNumber == 0L)
+        rowGroup->encoded.set_value();
+
+    // Blocks while enough row groups are already waiting for the writer thread
+    if (!m_pipeline->rowGroups.Push({rowGroup, std::move(encoded)}))
+        return E_ABORT;
+
+    {
+        std::lock_guard<std::mutex> lock(m_pipeline->mutex);
+        m_pipeline->ullSubmitted++;
+    }
+
+    for (size_t i = 0; i < m_dwColumnNumber; i++)
+    {
+        m_pipeline->tasks.Push({rowGroup, i});
+    }
+
+    return S_OK;
+}
+
+HRESULT Orc::TableOutput::Parquet::Writer::WaitRowGroups()
+{
+    if (!m_pipeline)
+        return S_OK;
+
+    std::unique_lock<std::mutex> lock(m_pipeline->mutex);
+    m_pipeline->written.wait(lock, [this]() { return m_pipeline->ullWritten >= m_pipeline->ullSubmitted; });
+    return m_pipeline->hr;
+}
+
+void Orc::TableOutput::Parquet::Writer::StopPipeline()
+{
+    if (!m_pipeline)
+        return;
+
+    // Both queues are drained before the threads leave
+    m_pipeline->rowGroups.Close();
+    m_pipeline->tasks.Close();
+
+    for (auto& encoder : m_pipeline->encoders)
+    {
+        encoder.join();
+    }
+
+    m_pipeline->writer.join();
+    m_pipeline.reset();
+}
+
+void Orc::TableOutput::Parquet::Writer::EncodeColumn(RowGroup& rowGroup, size_t column)
+{
+    HRESULT hr = S_OK;
+
+    try
+    {
+        std::visit(
+            [&rowGroup, column](auto&& arg) {
+                for (const auto& batch : rowGroup.batches)
+                {
+                    AppendBatchColumn(*arg, batch[column], BatchTimeStamp);
+                }
+
+                std::shared_ptr<arrow::Array> array;
+                if (auto status = arg->Finish(&array); !status.ok())
+                {
+                    Log::Error("Failed to build arrow column chunk '{}'", status.ToString());
+                    throw Orc::Exception(Severity::Continue, E_FAIL);
+                }
+
+                rowGroup.arrays[column] = std::move(array);
+            },
+            rowGroup.builders[column]);
+    }
+    catch (const Orc::Exception& e)
+    {
+        Log::Error(L"Failed to encode parquet column chunk: {}", e.Description);
+        hr = FAILED(ToHRESULT(e.ErrorCode())) ? ToHRESULT(e.ErrorCode()) : E_FAIL;
+    }
+    catch (const std::exception& e)
+    {
+        Log::Error("Failed to encode parquet column chunk: {}", e.what());
+        hr = E_FAIL;
+    }
+
+    if (FAILED(hr))
+    {
+        std::lock_guard<std::mutex> lock(rowGroup.errorMutex);
+        rowGroup.hr = hr;
+    }
+
+    if (--rowGroup.pendingColumns == 0)
+        rowGroup.encoded.set_value();
+}
+
+HRESULT Orc::TableOutput::Parquet::Writer::WriteRowGroup(RowGroup& rowGroup)
+{
+    {
+        std::lock_guard<std::mutex> lock(rowGroup.errorMutex);
+        if (FAILED(rowGroup.hr))
+            return rowGroup.hr;
+    }
+
+    auto table = arrow::Table::Make(m_arrowSchema, rowGroup.arrays);
+    if (!table)
+    {
+        Log::Error(L"Failed to create arrow table (to write a row group)");
+        return E_FAIL;
+    }
+
+    if (auto hr = SortRows(table); FAILED(hr))
+        return hr;
+
+    const auto activity = Trace::TableFlushStart("Parquet", table->num_rows(), 0LL);
+    auto status = m_arrowWriter->WriteTable(*table, table->num_rows());
+    Trace::TableFlushStop(activity, status.ok() ? S_OK : E_FAIL);
+    if (!status.ok())
+    {
+        Log::Error("Failed to write arrow table '{}'", status.ToString());
+        return E_FAIL;
+    }
 
     return S_OK;
 }
@@ -477,7 +1203,10 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::Flush()
 STDMETHODIMP Orc::TableOutput::Parquet::Writer::Close()
 {
 
-    if (auto hr = Flush(); FAILED(hr))
+    auto hr = Flush();
+    StopPipeline();
+
+    if (FAILED(hr))
     {
         Log::Error("Failed to flush arrow table");
         return hr;
@@ -590,52 +1319,17 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteString(const std::wstring&
 STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteString(const std::wstring_view& svString)
 {
     std::visit(
-        [this, svString](auto&& arg) {
+        [svString](auto&& arg) {
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StructBuilder>>)
             {
-                std::shared_ptr<arrow::StringBuilder> utf8_builder;
-                int utf8_id = 0;
-
-                std::shared_ptr<arrow::BinaryBuilder> raw_builder;
-                int raw_id = 0;
-
-                for (auto i = 0; i < arg->num_children(); i++)
-                {
-                    const auto& child_builder = arg->child_builder(i);
-                    if (!utf8_builder && child_builder->type()->id() == arrow::Type::STRING)
-                    {
-                        utf8_builder = std::dynamic_pointer_cast<arrow::StringBuilder>(child_builder);
-                        utf8_id = i;
-                    }
-                    else if (!raw_builder && child_builder->type()->id() == arrow::Type::BINARY)
-                    {
-                        raw_builder = std::dynamic_pointer_cast<arrow::BinaryBuilder>(child_builder);
-                        raw_id = i;
-                    }
-                    else
-                    {
-                        arg->AppendNull();
-                    }
-                }
-
-                if (utf8_builder)
-                {
-                    if (auto [hr, utf8] = WideToAnsi(svString); SUCCEEDED(hr))
-                    {
-                        utf8_builder->Append(utf8);
-                        if (raw_builder)
-                            raw_builder->AppendNull();
-                        arg->Append(true);
-                    }
-                    else
-                    {
-                        raw_builder->Append((uint8_t*)svString.data(), svString.size() * sizeof(wchar_t));
-                        if (utf8_builder)
-                            utf8_builder->AppendNull();
-                        arg->Append(true);
-                    }
-                }
+                AppendUTF16(*arg, svString);
+            }
+            else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringDictionary32Builder>>)
+            {
+                std::string utf8;
+                Text::AppendUtf16ToUtf8(svString, utf8);
+                arg->Append(utf8.data(), static_cast<int32_t>(utf8.size()));
             }
             else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringBuilder>>)
             {
@@ -687,6 +1381,8 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteString(const std::string& s
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringBuilder>>)
                 arg->Append(strString);
+            else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringDictionary32Builder>>)
+                arg->Append(strString.data(), static_cast<int32_t>(strString.size()));
             else
                 throw Orc::Exception(Severity::Fatal, L"Not a valid arrow builder for an ANSI string");
         },
@@ -702,6 +1398,8 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteString(const std::string_vi
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringBuilder>>)
                 arg->Append(strString.data(), strString.size());
+            else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringDictionary32Builder>>)
+                arg->Append(strString.data(), static_cast<int32_t>(strString.size()));
             else
                 throw Orc::Exception(Severity::Fatal, L"Not a valid arrow builder for an ANSI string");
         },
@@ -717,6 +1415,8 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteString(const CHAR* szString
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringBuilder>>)
                 arg->Append(szString, static_cast<uint32_t>(strlen(szString)));
+            else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringDictionary32Builder>>)
+                arg->Append(szString, static_cast<int32_t>(strlen(szString)));
             else
                 throw Orc::Exception(Severity::Fatal, L"Not a valid arrow builder for an ANSI string");
         },
@@ -732,6 +1432,8 @@ STDMETHODIMP Orc::TableOutput::Parquet::Writer::WriteCharArray(const CHAR* szStr
             using T = std::decay_t<decltype(arg)>;
             if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringBuilder>>)
                 arg->Append(szString, static_cast<uint32_t>(dwCharCount));
+            else if constexpr (std::is_same_v<T, std::unique_ptr<arrow::StringDictionary32Builder>>)
+                arg->Append(szString, static_cast<int32_t>(dwCharCount));
             else
                 throw Orc::Exception(Severity::Fatal, L"Not a valid arrow builder for an ANSI string");
         },
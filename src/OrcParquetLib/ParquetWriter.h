@@ -71,7 +71,7 @@ public:
     ITableOutput& GetTableOutput() { return static_cast<ITableOutput&>(*this); }
 
     STDMETHOD(SetSchema)(const TableOutput::Schema& columns) override final;
-    ;
+    STDMETHOD(WriteBatch)(const TableOutput::RecordBatch& batch) override final;
 
     virtual DWORD GetCurrentColumnID() override final { return m_dwColumnCounter; };
 
@@ -163,6 +163,12 @@ protected:
     std::shared_ptr<parquet::WriterProperties> m_parquetProps;
     std::shared_ptr<arrow::Schema> m_arrowSchema;
 
+    // Page indexes, sort keys and bloom filters which let readers skip most of a file when looking up a few rows
+    void SetLookupProperties(parquet::WriterProperties::Builder& builder);
+    HRESULT SortRows(std::shared_ptr<arrow::Table>& table) const;
+
+    std::optional<arrow::compute::SortOptions> m_sortOptions;
+
     std::shared_ptr<ByteStream> m_pByteStream = nullptr;
     bool m_bCloseStream = true;
     std::unique_ptr<parquet::arrow::FileWriter> m_arrowWriter;
@@ -183,7 +189,7 @@ protected:
         std::unique_ptr<arrow::SparseUnionBuilder>,
         std::unique_ptr<arrow::BinaryBuilder>,
         std::unique_ptr<arrow::FixedSizeBinaryBuilder>,
-        std::unique_ptr<arrow::StringDictionaryBuilder>,
+        std::unique_ptr<arrow::StringDictionary32Builder>,
         std::unique_ptr<arrow::StructBuilder>,
         std::unique_ptr<arrow::ArrayBuilder>>;
 
@@ -195,6 +201,24 @@ protected:
 
     HRESULT AddColumnAndCheckNumbers();
 
+    // Pipelined mode: batches are copied into row groups which column chunks are built by the encoder threads while
+    // the caller fills the next batch, a writer thread then writes the row groups in order
+    struct RowGroup;
+    struct Pipeline;
+
+    std::shared_ptr<RowGroup> m_pendingRowGroup;
+    std::shared_ptr<Pipeline> m_pipeline;
+
+    DWORD RowGroupSize() const;
+    HRESULT SubmitRowGroup();
+    HRESULT WaitRowGroups();
+    void StopPipeline();
+
+    void EncodeColumn(RowGroup& rowGroup, size_t column);
+    HRESULT WriteRowGroup(RowGroup& rowGroup);
+
+    static int64_t BatchTimeStamp(int64_t fileTime);
+
     template <arrow::TimeUnit::type timeUnit = arrow::TimeUnit::MICRO>
     static LONGLONG ConvertTo(FILETIME fileTime)
     {
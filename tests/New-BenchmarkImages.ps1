@@ -0,0 +1,130 @@
+# Synthesize the NTFS and FAT32 disk images used by OrcLibBenchmark.
+#
+# Images are fixed VHDs, that is raw disks followed by a footer, so they can be opened as 'ImageFileDisk' locations.
+# This requires an elevated prompt (diskpart).
+#
+# Usage:
+#   .\New-BenchmarkImages.ps1 -Path D:\bench
+#   $env:ORC_BENCHMARK_NTFS_IMAGE = "D:\bench\ntfs.vhd"
+#   $env:ORC_BENCHMARK_FAT_IMAGE = "D:\bench\fat32.vhd"
+#   OrcLibBenchmark.exe --benchmark_out=results.json --benchmark_out_format=json
+
+[cmdletbinding()]
+Param (
+    [Parameter(Mandatory = $True)]
+    [ValidateNotNullOrEmpty()]
+    [System.IO.DirectoryInfo]
+    $Path,
+
+    # Each file takes at least one FRS (1KB), directories add their own records and I30 indexes
+    [int]
+    $NtfsFileCount = 2000000,
+
+    [int]
+    $FatFileCount = 200000,
+
+    [int]
+    $FilesPerDirectory = 1000
+)
+
+$CustomHelper = @'
+    using System.IO;
+
+    public static class CustomHelper
+    {
+        // Small files with varied names and sizes: some stay resident in their FRS, others get clusters
+        public static void Populate(string root, int fileCount, int filesPerDirectory)
+        {
+            byte[] data = new byte[4096];
+            for (int i = 0; i < data.Length; i++)
+            {
+                data[i] = (byte)(i * 31);
+            }
+
+            string directory = null;
+            for (int i = 0; i < fileCount; i++)
+            {
+                if (i % filesPerDirectory == 0)
+                {
+                    directory = Path.Combine(root, string.Format("dir_{0:D6}", i / filesPerDirectory));
+                    Directory.CreateDirectory(directory);
+                }
+
+                string name = string.Format("file_{0:X8}{1}.bin", i, new string('x', i % 24));
+                using (FileStream stream = File.Create(Path.Combine(directory, name)))
+                {
+                    stream.Write(data, 0, (i * 97) % data.Length);
+                }
+            }
+        }
+    }
+'@
+
+Add-Type -TypeDefinition $CustomHelper -Language CSharp
+
+function Invoke-Diskpart([string[]] $Commands)
+{
+    $Script = New-TemporaryFile
+    try
+    {
+        Set-Content -Path $Script -Value $Commands -Encoding ASCII
+        $Output = diskpart.exe /s $Script
+        if ($LASTEXITCODE -ne 0)
+        {
+            throw "diskpart failed: $Output"
+        }
+    }
+    finally
+    {
+        Remove-Item $Script
+    }
+}
+
+function New-BenchmarkImage([string] $Image, [string] $FileSystem, [int] $SizeMB, [int] $FileCount)
+{
+    if (Test-Path $Image)
+    {
+        Remove-Item $Image
+    }
+
+    $Mount = Join-Path $Path ("mount_" + $FileSystem)
+    New-Item -ItemType Directory -Force -Path $Mount | Out-Null
+
+    Write-Host "Create: $Image ($FileSystem, $SizeMB MB)"
+    Invoke-Diskpart @(
+        "create vdisk file=`"$Image`" maximum=$SizeMB type=fixed",
+        "select vdisk file=`"$Image`"",
+        "attach vdisk",
+        "create partition primary",
+        "format fs=$FileSystem quick",
+        "assign mount=`"$Mount`""
+    )
+
+    try
+    {
+        Write-Host "Populate: $Image ($FileCount files)"
+        [CustomHelper]::Populate($Mount, $FileCount, $FilesPerDirectory)
+
+        if ($FileSystem -eq "ntfs")
+        {
+            fsutil.exe usn createjournal m=0x10000000 a=0x1000000 $Mount | Out-Null
+        }
+    }
+    finally
+    {
+        Invoke-Diskpart @(
+            "select vdisk file=`"$Image`"",
+            "detach vdisk"
+        )
+        Remove-Item $Mount
+    }
+}
+
+New-Item -ItemType Directory -Force -Path $Path | Out-Null
+
+# Room for the MFT, the indexes and the file data
+$NtfsSizeMB = [Math]::Max(1024, [int]($NtfsFileCount * 6 / 1024))
+$FatSizeMB = [Math]::Max(1024, [int]($FatFileCount * 6 / 1024))
+
+New-BenchmarkImage -Image (Join-Path $Path "ntfs.vhd") -FileSystem "ntfs" -SizeMB $NtfsSizeMB -FileCount $NtfsFileCount
+New-BenchmarkImage -Image (Join-Path $Path "fat32.vhd") -FileSystem "fat32" -SizeMB $FatSizeMB -FileCount $FatFileCount
@@ -0,0 +1,149 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileContent.h"
+
+#include <cstring>
+#include <random>
+#include <string_view>
+
+#include "Filesystem/Ntfs/Compression/WofChunks.h"
+#include "Filesystem/Ntfs/Compression/Engine/Nt/NtApi.h"
+#include "Filesystem/Ntfs/Compression/Engine/Wimlib/WimlibApi.h"
+
+#include "NtfsRecord.h"
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+std::vector<uint8_t> Orc::ImageGenerator::MakeFileContent(ULONGLONG ullIndex, size_t cbSize)
+{
+    std::mt19937 rng(static_cast<unsigned>(ullIndex));
+    std::vector<uint8_t> data;
+    data.reserve(cbSize + 16);
+
+    const std::string_view words[] = {"NTFS ", "record ", "index ", "journal ", "chunk ", "volume ", "\r\n"};
+    while (data.size() < cbSize)
+    {
+        // Some noise every few words keeps a part of the units incompressible
+        if (rng() % 16 == 0)
+        {
+            for (int i = 0; i < 8; i++)
+                data.push_back(static_cast<uint8_t>(rng()));
+            continue;
+        }
+
+        const auto word = words[rng() % std::size(words)];
+        data.insert(std::end(data), std::cbegin(word), std::cend(word));
+    }
+
+    data.resize(cbSize);
+    return data;
+}
+
+std::vector<std::vector<uint8_t>>
+Orc::ImageGenerator::CompressLznt1Units(const std::vector<uint8_t>& data, std::error_code& ec)
+{
+    constexpr USHORT format = COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_STANDARD;
+
+    ULONG workspaceSize = 0L, fragmentWorkspaceSize = 0L;
+    RtlGetCompressionWorkSpaceSize(format, &workspaceSize, &fragmentWorkspaceSize, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> workspace(workspaceSize);
+    std::vector<uint8_t> unit(kLznt1UnitSize);
+    std::vector<std::vector<uint8_t>> units;
+
+    for (size_t offset = 0; offset < data.size(); offset += kLznt1UnitSize)
+    {
+        const auto cbUnit = std::min(kLznt1UnitSize, data.size() - offset);
+        std::fill(std::begin(unit), std::end(unit), 0);
+        std::memcpy(unit.data(), data.data() + offset, cbUnit);
+
+        std::vector<uint8_t> compressed(kLznt1UnitSize + kLznt1UnitSize / 8);
+        ULONG compressedSize = 0L;
+        RtlCompressBuffer(
+            format,
+            unit.data(),
+            static_cast<ULONG>(unit.size()),
+            compressed.data(),
+            static_cast<ULONG>(compressed.size()),
+            4096,
+            &compressedSize,
+            workspace.data(),
+            ec);
+        if (ec)
+        {
+            return {};
+        }
+
+        if (Align(compressedSize, kBytesPerCluster) < kLznt1UnitSize)
+        {
+            compressed.resize(Align(compressedSize, kBytesPerCluster));
+            std::fill(std::begin(compressed) + compressedSize, std::end(compressed), 0);
+            units.push_back(std::move(compressed));
+        }
+        else
+        {
+            units.push_back(unit);
+        }
+    }
+
+    return units;
+}
+
+std::vector<uint8_t>
+Orc::ImageGenerator::MakeWofStream(const std::vector<uint8_t>& data, Ntfs::WofAlgorithm algorithm, std::error_code& ec)
+{
+    const auto chunkSize = Ntfs::GetWofChunkSize(algorithm);
+    const auto chunkCount = Ntfs::GetWofChunkCount(algorithm, data.size());
+    const auto offsetSize = Ntfs::GetWofChunkOffsetSize(data.size());
+
+    wimlib_compressor* compressor = nullptr;
+    wimlib_create_compressor(WIMLIB_COMPRESSION_TYPE_XPRESS, chunkSize, 0, &compressor, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    // The first chunk starts right after the table, which only holds the end offsets of the chunks but the last one
+    const auto cbTable = (chunkCount - 1) * offsetSize;
+    std::vector<uint8_t> stream(cbTable);
+    std::vector<uint8_t> chunk(chunkSize);
+
+    for (uint64_t i = 0; i < chunkCount; i++)
+    {
+        const auto offset = i * chunkSize;
+        const auto cbChunk = std::min<size_t>(chunkSize, data.size() - offset);
+
+        const auto compressedSize =
+            wimlib_compress(data.data() + offset, cbChunk, chunk.data(), cbChunk - 1, compressor, ec);
+        if (ec || compressedSize == 0)
+        {
+            ec.clear();
+            stream.insert(std::end(stream), data.data() + offset, data.data() + offset + cbChunk);
+        }
+        else
+        {
+            stream.insert(std::end(stream), chunk.data(), chunk.data() + compressedSize);
+        }
+
+        if (i + 1 < chunkCount)
+        {
+            const uint64_t end = stream.size() - cbTable;
+            std::memcpy(stream.data() + i * offsetSize, &end, offsetSize);
+        }
+    }
+
+    wimlib_free_compressor(compressor, ec);
+    return stream;
+}
@@ -0,0 +1,33 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <cstdint>
+#include <system_error>
+#include <vector>
+
+#include "Filesystem/Ntfs/Compression/WofAlgorithm.h"
+
+namespace Orc::ImageGenerator {
+
+// Compression unit of LZNT1 attributes: 16 clusters (CompressionUnit = 4)
+constexpr size_t kLznt1UnitSize = 64 * 1024;
+constexpr UCHAR kLznt1CompressionUnit = 4;
+
+// Text like content, deterministic for a given file index so that compressors have something to work with
+std::vector<uint8_t> MakeFileContent(ULONGLONG ullIndex, size_t cbSize);
+
+// LZNT1 units as NTFS stores them: compressed when it saves at least one cluster, otherwise the raw 64KB unit. The
+// last unit is padded with zeroes.
+std::vector<std::vector<uint8_t>> CompressLznt1Units(const std::vector<uint8_t>& data, std::error_code& ec);
+
+// 'WofCompressedData' stream content: table of chunk end offsets followed by the chunks, each chunk is stored raw
+// when compression does not shrink it
+std::vector<uint8_t> MakeWofStream(const std::vector<uint8_t>& data, Ntfs::WofAlgorithm algorithm, std::error_code& ec);
+
+}  // namespace Orc::ImageGenerator
@@ -0,0 +1,178 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+
+#include "SparseStream.h"
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+ImageWriter::ImageWriter(ULONGLONG ullVolumeOffset, ULONGLONG ullWindowStart, ULONGLONG ullWindowLength)
+    : m_ullVolumeOffset(ullVolumeOffset)
+    , m_ullWindowStart(ullWindowStart)
+    , m_ullWindowLength(ullWindowLength)
+{
+}
+
+ImageWriter::~ImageWriter()
+{
+    if (m_stream)
+    {
+        m_stream->Close();
+    }
+}
+
+HRESULT ImageWriter::Open(const std::wstring& strPath)
+{
+    m_stream = std::make_shared<SparseStream>();
+
+    if (auto hr = m_stream->OpenFile(
+            strPath.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL,
+            NULL);
+        FAILED(hr))
+    {
+        Log::Error(L"Failed to create image '{}' [{}]", strPath, SystemError(hr));
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT ImageWriter::WriteFile(ULONGLONG ullFileOffset, const void* pData, size_t cbData)
+{
+    if (auto hr = m_stream->SetFilePointer(ullFileOffset, FILE_BEGIN, nullptr); FAILED(hr))
+    {
+        Log::Error(L"Failed to seek image to offset {} [{}]", ullFileOffset, SystemError(hr));
+        return hr;
+    }
+
+    ULONGLONG cbWritten = 0LL;
+    if (auto hr = m_stream->Write(const_cast<PVOID>(pData), cbData, &cbWritten); FAILED(hr))
+    {
+        Log::Error(L"Failed to write {} bytes at offset {} [{}]", cbData, ullFileOffset, SystemError(hr));
+        return hr;
+    }
+
+    m_ullBytesWritten += cbWritten;
+    return S_OK;
+}
+
+HRESULT ImageWriter::Flush(Pending& pending)
+{
+    if (pending.Data.empty())
+    {
+        return S_OK;
+    }
+
+    auto hr = WriteFile(pending.Offset, pending.Data.data(), pending.Data.size());
+    pending.Data.clear();
+    return hr;
+}
+
+HRESULT ImageWriter::Write(ULONGLONG ullVolumeOffset, const void* pData, size_t cbData)
+{
+    const auto ullWindowEnd = m_ullWindowLength == kWholeVolume ? kWholeVolume : m_ullWindowStart + m_ullWindowLength;
+    const auto ullStart = std::max(ullVolumeOffset, m_ullWindowStart);
+    const auto ullEnd = std::min(ullVolumeOffset + cbData, ullWindowEnd);
+    if (ullStart >= ullEnd)
+    {
+        return S_OK;
+    }
+
+    const auto ullFileOffset = m_ullVolumeOffset + ullStart - m_ullWindowStart;
+    const auto pBytes = static_cast<const uint8_t*>(pData) + (ullStart - ullVolumeOffset);
+    const auto cbBytes = static_cast<size_t>(ullEnd - ullStart);
+
+    m_ullWrites++;
+
+    for (auto& pending : m_pending)
+    {
+        if (!pending.Data.empty() && pending.Offset + pending.Data.size() == ullFileOffset
+            && pending.Data.size() + cbBytes <= kPendingSize)
+        {
+            pending.Data.insert(std::end(pending.Data), pBytes, pBytes + cbBytes);
+            pending.LastUse = m_ullWrites;
+            return S_OK;
+        }
+    }
+
+    // Gathered writes overlapping this one have to reach the file first
+    for (auto& pending : m_pending)
+    {
+        if (!pending.Data.empty() && pending.Offset < ullFileOffset + cbBytes
+            && ullFileOffset < pending.Offset + pending.Data.size())
+        {
+            if (auto hr = Flush(pending); FAILED(hr))
+                return hr;
+        }
+    }
+
+    if (cbBytes >= kPendingSize)
+    {
+        return WriteFile(ullFileOffset, pBytes, cbBytes);
+    }
+
+    auto& slot = *std::min_element(
+        std::begin(m_pending), std::end(m_pending), [](const Pending& left, const Pending& right) {
+            return left.LastUse < right.LastUse;
+        });
+
+    if (auto hr = Flush(slot); FAILED(hr))
+        return hr;
+
+    slot.Offset = ullFileOffset;
+    slot.Data.reserve(kPendingSize);
+    slot.Data.assign(pBytes, pBytes + cbBytes);
+    slot.LastUse = m_ullWrites;
+    return S_OK;
+}
+
+HRESULT ImageWriter::WriteDisk(ULONGLONG ullDiskOffset, const void* pData, size_t cbData)
+{
+    if (m_ullWindowLength != kWholeVolume)
+    {
+        return S_OK;
+    }
+
+    for (auto& pending : m_pending)
+    {
+        if (auto hr = Flush(pending); FAILED(hr))
+            return hr;
+    }
+
+    return WriteFile(ullDiskOffset, pData, cbData);
+}
+
+HRESULT ImageWriter::Close(ULONGLONG ullDiskSize)
+{
+    for (auto& pending : m_pending)
+    {
+        if (auto hr = Flush(pending); FAILED(hr))
+            return hr;
+    }
+
+    const auto ullSize = m_ullWindowLength == kWholeVolume ? ullDiskSize : m_ullWindowLength;
+    if (auto hr = m_stream->SetSize(ullSize); FAILED(hr))
+    {
+        Log::Error(L"Failed to set image size to {} [{}]", ullSize, SystemError(hr));
+        return hr;
+    }
+
+    auto hr = m_stream->Close();
+    m_stream.reset();
+    return hr;
+}
@@ -0,0 +1,72 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Orc {
+
+class SparseStream;
+
+namespace ImageGenerator {
+
+//
+// ImageWriter: random access writes of volume content to a sparse output file.
+//
+// The output is either a whole disk (writes are shifted by the partition offset) or a window of the volume, like the
+// $MFT extent alone. Writes outside the window are dropped. Consecutive writes are gathered per region, so that
+// records, index buffers and file data which are produced interleaved still reach the file as large writes.
+//
+class ImageWriter
+{
+public:
+    static constexpr ULONGLONG kWholeVolume = ULLONG_MAX;
+
+    ImageWriter(ULONGLONG ullVolumeOffset, ULONGLONG ullWindowStart, ULONGLONG ullWindowLength);
+    ~ImageWriter();
+
+    HRESULT Open(const std::wstring& strPath);
+
+    HRESULT Write(ULONGLONG ullVolumeOffset, const void* pData, size_t cbData);
+
+    // Outside of the volume (partition table, etc.), ignored when writing a window of the volume
+    HRESULT WriteDisk(ULONGLONG ullDiskOffset, const void* pData, size_t cbData);
+
+    HRESULT Close(ULONGLONG ullDiskSize);
+
+    ULONGLONG BytesWritten() const { return m_ullBytesWritten; }
+
+private:
+    static constexpr size_t kPendingBuffers = 4;
+    static constexpr size_t kPendingSize = 4 * 1024 * 1024;
+
+    struct Pending
+    {
+        ULONGLONG Offset = 0LL;
+        std::vector<uint8_t> Data;
+        ULONGLONG LastUse = 0LL;
+    };
+
+    HRESULT Flush(Pending& pending);
+    HRESULT WriteFile(ULONGLONG ullFileOffset, const void* pData, size_t cbData);
+
+    std::shared_ptr<SparseStream> m_stream;
+    ULONGLONG m_ullVolumeOffset;
+    ULONGLONG m_ullWindowStart;
+    ULONGLONG m_ullWindowLength;
+    std::array<Pending, kPendingBuffers> m_pending;
+    ULONGLONG m_ullWrites = 0LL;
+    ULONGLONG m_ullBytesWritten = 0LL;
+};
+
+}  // namespace ImageGenerator
+}  // namespace Orc
@@ -0,0 +1,126 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include <iostream>
+
+#include <CLI/CLI.hpp>
+
+#include "EmbeddedResource.h"
+#include "Robustness.h"
+#include "Text/Iconv.h"
+
+#include "NtfsVolume.h"
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+//
+// NtfsImageGenerator: writes a synthetic NTFS volume with a chosen number of files, directory depth and density of
+// the MFT features OrcLib has to parse ($ATTRIBUTE_LIST, alternate streams, extended attributes, LZNT1 and WOF
+// compressed data, USN journal).
+//
+// The output is either a raw MBR disk image, to be opened as an 'ImageFileDisk' location ('<image>,part=1'), or the
+// $MFT alone as an offline MFT. Both are written as sparse files, a million files image stays a few GB on disk.
+//
+//   NtfsImageGenerator.exe --files 1000000 --depth 3 D:\bench\ntfs.img
+//   NtfsImageGenerator.exe --files 1000000 --mft-only D:\bench\ntfs.mft
+//
+// The content is deterministic for a given set of options, --seed changes the file sizes and timestamps.
+//
+namespace {
+
+int Run(const std::vector<std::string>& args)
+{
+    CLI::App app {"Synthesize NTFS images for OrcLib's tests and benchmarks"};
+
+    std::string output;
+    bool bMftOnly = false;
+    VolumeOptions options;
+
+    app.add_option("output", output, "Output image (or MFT) path")->required();
+    app.add_flag("--mft-only", bMftOnly, "Write the $MFT content only, as an offline MFT");
+    app.add_option("--files", options.FileCount, "Number of files")->capture_default_str();
+    app.add_option("--depth", options.Depth, "Directory levels below the root, files are in the deepest")
+        ->capture_default_str();
+    app.add_option("--files-per-directory", options.FilesPerDirectory, "Files per leaf directory")
+        ->capture_default_str()
+        ->check(CLI::Range(1, 1 << 20));
+    app.add_option("--attribute-list-every", options.AttributeListEvery, "One file in N has an $ATTRIBUTE_LIST")
+        ->capture_default_str();
+    app.add_option("--ads-every", options.AlternateStreamEvery, "One file in N has an alternate data stream")
+        ->capture_default_str();
+    app.add_option("--ea-every", options.ExtendedAttributesEvery, "One file in N has extended attributes")
+        ->capture_default_str();
+    app.add_option("--non-resident-every", options.NonResidentEvery, "One file in N has non resident data")
+        ->capture_default_str();
+    app.add_option("--lznt1-every", options.Lznt1Every, "One file in N is LZNT1 compressed")->capture_default_str();
+    app.add_option("--wof-every", options.WofEvery, "One file in N is WOF compressed")->capture_default_str();
+    app.add_option("--usn-size", options.UsnJournalSize, "USN journal size in bytes, 0 disables it")
+        ->capture_default_str();
+    app.add_option("--seed", options.Seed, "Seed of file sizes and timestamps")->capture_default_str();
+
+    try
+    {
+        std::vector<const char*> argv;
+        for (const auto& arg : args)
+        {
+            argv.push_back(arg.data());
+        }
+
+        app.parse(static_cast<int>(argv.size()), argv.data());
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return app.exit(e);
+    }
+
+    std::error_code ec;
+    const auto path = ToUtf16(output, ec);
+    if (ec)
+    {
+        Log::Critical(L"Invalid output path [{}]", ec);
+        return EXIT_FAILURE;
+    }
+
+    NtfsVolume volume(options);
+    if (auto hr = bMftOnly ? volume.WriteMFT(path) : volume.WriteImage(path); FAILED(hr))
+    {
+        Log::Critical(L"Failed to write '{}' [{}]", path, SystemError(hr));
+        return EXIT_FAILURE;
+    }
+
+    const auto& statistics = volume.Statistics();
+    std::cout << "Records:           " << statistics.Records << std::endl;
+    std::cout << "Directories:       " << statistics.Directories << std::endl;
+    std::cout << "Files:             " << statistics.Files << std::endl;
+    std::cout << "Extension records: " << statistics.ExtensionRecords << std::endl;
+    std::cout << "Index blocks:      " << statistics.IndexBlocks << std::endl;
+    std::cout << "USN records:       " << statistics.UsnRecords << std::endl;
+    std::cout << "Clusters:          " << statistics.Clusters << std::endl;
+    return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int wmain(int argc, const wchar_t* argv[])
+{
+    Orc::EmbeddedResource::SetDefaultHINSTANCE(GetModuleHandleW(NULL));
+
+    // CLI11 parses narrow strings
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; ++i)
+    {
+        args.push_back(Orc::ToUtf8(argv[i]));
+    }
+
+    const auto status = Run(args);
+
+    Orc::Robustness::Terminate();
+    return status;
+}
@@ -0,0 +1,196 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "NtfsIndex.h"
+
+#include <cstring>
+#include <optional>
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+namespace {
+
+constexpr USHORT kBlockUpdateSequenceArrayOffset = 0x28;
+constexpr ULONG kBlockFirstIndexEntry = 0x28;
+constexpr size_t kBlockIndexHeaderOffset = 0x18;
+constexpr size_t kEntryHeaderSize = sizeof(INDEX_ENTRY);
+
+// Entries available in an index buffer, from the index header to the end of the buffer
+constexpr size_t kBlockEntriesSize = kBytesPerIndexBlock - kBlockIndexHeaderOffset - kBlockFirstIndexEntry;
+
+struct LevelEntry
+{
+    const std::vector<uint8_t>* Bytes;
+    std::optional<VCN> SubNode;
+};
+
+size_t EntrySize(const LevelEntry& entry)
+{
+    return entry.Bytes->size() + (entry.SubNode ? sizeof(VCN) : 0);
+}
+
+size_t EndEntrySize(bool bNode)
+{
+    return kEntryHeaderSize + (bNode ? sizeof(VCN) : 0);
+}
+
+// Serialize entries followed by the end entry, sub node pointers are appended to the entries which have one
+std::vector<uint8_t> WriteEntries(const std::vector<LevelEntry>& entries, std::optional<VCN> endSubNode)
+{
+    std::vector<uint8_t> buffer;
+
+    const auto append = [&buffer](const uint8_t* pEntry, size_t cbEntry, std::optional<VCN> subNode, USHORT flags) {
+        const auto offset = buffer.size();
+        buffer.insert(std::end(buffer), pEntry, pEntry + cbEntry);
+        if (subNode)
+            buffer.resize(buffer.size() + sizeof(VCN));
+
+        auto pHeader = reinterpret_cast<PINDEX_ENTRY>(buffer.data() + offset);
+        pHeader->Length = static_cast<USHORT>(buffer.size() - offset);
+        pHeader->Flags = flags | (subNode ? INDEX_ENTRY_NODE : 0);
+        if (subNode)
+            *reinterpret_cast<VCN*>(buffer.data() + buffer.size() - sizeof(VCN)) = *subNode;
+    };
+
+    for (const auto& entry : entries)
+        append(entry.Bytes->data(), entry.Bytes->size(), entry.SubNode, 0);
+
+    const INDEX_ENTRY end {};
+    append(reinterpret_cast<const uint8_t*>(&end), sizeof(end), endSubNode, INDEX_ENTRY_END);
+    return buffer;
+}
+
+std::vector<uint8_t> WriteBlock(VCN vcn, const std::vector<uint8_t>& entries, bool bNode)
+{
+    std::vector<uint8_t> block(kBytesPerIndexBlock, 0);
+
+    auto pBuffer = reinterpret_cast<PINDEX_ALLOCATION_BUFFER>(block.data());
+    std::memcpy(pBuffer->MultiSectorHeader.Signature, "INDX", 4);
+    pBuffer->ThisBlock = vcn;
+    pBuffer->IndexHeader.FirstIndexEntry = kBlockFirstIndexEntry;
+    pBuffer->IndexHeader.FirstFreeByte = static_cast<ULONG>(kBlockFirstIndexEntry + entries.size());
+    pBuffer->IndexHeader.BytesAvailable = static_cast<ULONG>(kBytesPerIndexBlock - kBlockIndexHeaderOffset);
+    pBuffer->IndexHeader.Flags = bNode ? INDEX_NODE : 0;
+
+    std::memcpy(block.data() + kBlockIndexHeaderOffset + kBlockFirstIndexEntry, entries.data(), entries.size());
+
+    ApplyFixups(block.data(), block.size(), kBlockUpdateSequenceArrayOffset);
+    return block;
+}
+
+}  // namespace
+
+std::vector<uint8_t>
+Orc::ImageGenerator::MakeFileNameIndexEntry(ULONGLONG ullFileReference, const void* pFileName, size_t cbFileName)
+{
+    std::vector<uint8_t> entry(Align(kEntryHeaderSize + cbFileName, 8), 0);
+
+    auto pEntry = reinterpret_cast<PINDEX_ENTRY>(entry.data());
+    *reinterpret_cast<ULONGLONG*>(&pEntry->FileReference) = ullFileReference;
+    pEntry->Length = static_cast<USHORT>(entry.size());
+    pEntry->AttributeLength = static_cast<USHORT>(cbFileName);
+
+    std::memcpy(entry.data() + kEntryHeaderSize, pFileName, cbFileName);
+    return entry;
+}
+
+std::vector<uint8_t>
+Orc::ImageGenerator::MakeViewIndexEntry(const void* pKey, size_t cbKey, const void* pData, size_t cbData)
+{
+    const auto cbKeyAligned = Align(cbKey, 4);
+    std::vector<uint8_t> entry(Align(kEntryHeaderSize + cbKeyAligned + cbData, 8), 0);
+
+    auto pEntry = reinterpret_cast<PINDEX_ENTRY>(entry.data());
+    pEntry->DataOffset = static_cast<USHORT>(kEntryHeaderSize + cbKeyAligned);
+    pEntry->DataLength = static_cast<USHORT>(cbData);
+    pEntry->Length = static_cast<USHORT>(entry.size());
+    pEntry->AttributeLength = static_cast<USHORT>(cbKey);
+
+    std::memcpy(entry.data() + kEntryHeaderSize, pKey, cbKey);
+    std::memcpy(entry.data() + pEntry->DataOffset, pData, cbData);
+    return entry;
+}
+
+Index Orc::ImageGenerator::BuildIndex(
+    const std::vector<std::vector<uint8_t>>& entries,
+    ATTRIBUTE_TYPE_CODE indexedAttributeType,
+    ULONG collationRule,
+    size_t cbRootEntries)
+{
+    Index index;
+
+    std::vector<LevelEntry> level;
+    level.reserve(entries.size());
+    for (const auto& entry : entries)
+        level.push_back({&entry, std::nullopt});
+
+    std::optional<VCN> rightmost;
+    const auto levelSize = [&level, &rightmost]() {
+        size_t cbLevel = EndEntrySize(rightmost.has_value());
+        for (const auto& entry : level)
+            cbLevel += EntrySize(entry);
+        return cbLevel;
+    };
+
+    while (levelSize() > cbRootEntries)
+    {
+        const bool bNode = rightmost.has_value();
+        const auto emit = [&index, bNode](const std::vector<LevelEntry>& blockEntries, std::optional<VCN> endSubNode) {
+            const auto vcn = static_cast<VCN>(index.Blocks.size());
+            index.Blocks.push_back(WriteBlock(vcn, WriteEntries(blockEntries, endSubNode), bNode));
+            return vcn;
+        };
+
+        std::vector<LevelEntry> upper, block;
+        size_t cbBlock = EndEntrySize(bNode);
+
+        for (const auto& entry : level)
+        {
+            if (!block.empty() && cbBlock + EntrySize(entry) > kBlockEntriesSize)
+            {
+                // The promoted entry's former sub node holds keys greater than the block's: it becomes its end node
+                upper.push_back({entry.Bytes, emit(block, entry.SubNode)});
+                block.clear();
+                cbBlock = EndEntrySize(bNode);
+                continue;
+            }
+
+            block.push_back(entry);
+            cbBlock += EntrySize(entry);
+        }
+
+        rightmost = emit(block, rightmost);
+        level = std::move(upper);
+    }
+
+    const auto rootEntries = WriteEntries(level, rightmost);
+    index.Root.resize(kIndexRootHeaderSize + rootEntries.size());
+
+    auto pRoot = reinterpret_cast<PINDEX_ROOT>(index.Root.data());
+    pRoot->IndexedAttributeType = indexedAttributeType;
+    *reinterpret_cast<ULONG*>(pRoot->CollationRule) = collationRule;
+    pRoot->BytesPerIndexBuffer = kBytesPerIndexBlock;
+    pRoot->BlocksPerIndexBuffer = static_cast<UCHAR>(kBytesPerIndexBlock / kBytesPerCluster);
+    pRoot->IndexHeader.FirstIndexEntry = sizeof(INDEX_HEADER);
+    pRoot->IndexHeader.FirstFreeByte = static_cast<ULONG>(sizeof(INDEX_HEADER) + rootEntries.size());
+    pRoot->IndexHeader.BytesAvailable = pRoot->IndexHeader.FirstFreeByte;
+    pRoot->IndexHeader.Flags = rightmost ? INDEX_NODE : 0;
+
+    std::memcpy(index.Root.data() + kIndexRootHeaderSize, rootEntries.data(), rootEntries.size());
+    return index;
+}
+
+std::vector<uint8_t> Orc::ImageGenerator::MakeIndexBitmap(ULONGLONG ullBlocks)
+{
+    std::vector<uint8_t> bitmap(Align((ullBlocks + 7) / 8, 8), 0);
+    for (ULONGLONG i = 0; i < ullBlocks; i++)
+        bitmap[i / 8] |= 1 << (i % 8);
+    return bitmap;
+}
@@ -0,0 +1,51 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "NtfsRecord.h"
+
+namespace Orc::ImageGenerator {
+
+constexpr ULONG COLLATION_FILE_NAME = 0x01;
+constexpr ULONG COLLATION_NTOFS_ULONG = 0x10;
+constexpr ULONG COLLATION_NTOFS_SECURITY_HASH = 0x12;
+
+constexpr size_t kIndexRootHeaderSize = sizeof(INDEX_ROOT);
+
+// Entry of an $I30 index, pFileName points to a FILE_NAME value of cbFileName bytes
+std::vector<uint8_t> MakeFileNameIndexEntry(ULONGLONG ullFileReference, const void* pFileName, size_t cbFileName);
+
+// Entry of a view index ($Secure:$SII, $Secure:$SDH...)
+std::vector<uint8_t> MakeViewIndexEntry(const void* pKey, size_t cbKey, const void* pData, size_t cbData);
+
+struct Index
+{
+    // $INDEX_ROOT value
+    std::vector<uint8_t> Root;
+    // $INDEX_ALLOCATION content, one kBytesPerIndexBlock buffer per VCN, fixups applied
+    std::vector<std::vector<uint8_t>> Blocks;
+};
+
+//
+// Build the B-tree of collated entries bottom up: index buffers are filled in order, the first entry which does not
+// fit is promoted to the upper level with the buffer as its sub node. Levels are built until the top one fits in
+// cbRootEntries bytes (end entry included), which becomes the index root.
+//
+Index BuildIndex(
+    const std::vector<std::vector<uint8_t>>& entries,
+    ATTRIBUTE_TYPE_CODE indexedAttributeType,
+    ULONG collationRule,
+    size_t cbRootEntries);
+
+// $BITMAP value of an index allocation made of ullBlocks buffers
+std::vector<uint8_t> MakeIndexBitmap(ULONGLONG ullBlocks);
+
+}  // namespace Orc::ImageGenerator
@@ -0,0 +1,216 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "NtfsRecord.h"
+
+#include <cassert>
+#include <cstring>
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+namespace {
+
+constexpr USHORT kRecordUpdateSequenceArrayOffset = 0x30;
+constexpr USHORT kFirstAttributeOffset = 0x38;
+constexpr size_t kEndMarkerSize = 8;
+constexpr size_t kResidentHeaderSize = 0x18;
+constexpr size_t kNonResidentHeaderSize = 0x40;
+constexpr size_t kCompressedHeaderSize = 0x48;
+constexpr USHORT kUpdateSequenceNumber = 1;
+
+// Smallest number of bytes of the two's complement representation of value
+UCHAR SignedByteCount(LONGLONG value)
+{
+    UCHAR count = 1;
+    while (count < 8)
+    {
+        const auto limit = 1LL << (count * 8 - 1);
+        if (value >= -limit && value < limit)
+            break;
+        count++;
+    }
+    return count;
+}
+
+size_t NonResidentHeaderSize(const NonResidentValue& value)
+{
+    if (value.Flags & (ATTRIBUTE_FLAG_COMPRESSION_MASK | ATTRIBUTE_FLAG_SPARSE) || value.CompressionUnit)
+        return kCompressedHeaderSize;
+    return kNonResidentHeaderSize;
+}
+
+}  // namespace
+
+std::vector<uint8_t> Orc::ImageGenerator::EncodeMappingPairs(const std::vector<Run>& runs)
+{
+    std::vector<uint8_t> pairs;
+    LCN previousLcn = 0LL;
+
+    for (const auto& run : runs)
+    {
+        const auto cbLength = SignedByteCount(static_cast<LONGLONG>(run.Length));
+        const auto delta = run.Lcn == kSparseLcn ? 0LL : run.Lcn - previousLcn;
+        const auto cbDelta = run.Lcn == kSparseLcn ? UCHAR(0) : SignedByteCount(delta);
+
+        pairs.push_back(static_cast<uint8_t>(cbDelta << 4 | cbLength));
+        for (UCHAR i = 0; i < cbLength; i++)
+            pairs.push_back(static_cast<uint8_t>(run.Length >> (i * 8)));
+        for (UCHAR i = 0; i < cbDelta; i++)
+            pairs.push_back(static_cast<uint8_t>(static_cast<ULONGLONG>(delta) >> (i * 8)));
+
+        if (run.Lcn != kSparseLcn)
+            previousLcn = run.Lcn;
+    }
+
+    pairs.push_back(0);
+    return pairs;
+}
+
+void Orc::ImageGenerator::ApplyFixups(uint8_t* pData, size_t cbData, USHORT usUpdateSequenceArrayOffset)
+{
+    auto pHeader = reinterpret_cast<PMULTI_SECTOR_HEADER>(pData);
+    pHeader->UpdateSequenceArrayOffset = usUpdateSequenceArrayOffset;
+    pHeader->UpdateSequenceArraySize = static_cast<USHORT>(cbData / SEQUENCE_NUMBER_STRIDE + 1);
+
+    auto pArray = reinterpret_cast<USHORT*>(pData + usUpdateSequenceArrayOffset);
+    pArray[0] = kUpdateSequenceNumber;
+
+    for (size_t i = 0; i < cbData / SEQUENCE_NUMBER_STRIDE; i++)
+    {
+        auto pLast = reinterpret_cast<USHORT*>(pData + (i + 1) * SEQUENCE_NUMBER_STRIDE - sizeof(USHORT));
+        pArray[i + 1] = *pLast;
+        *pLast = kUpdateSequenceNumber;
+    }
+}
+
+FileRecord::FileRecord(ULONGLONG ullFRN, USHORT usSequence, USHORT usFlags, ULONGLONG ullBaseFileReference)
+    : m_record(kBytesPerFRS, 0)
+    , m_cbUsed(kFirstAttributeOffset)
+{
+    auto pHeader = Header();
+    std::memcpy(pHeader->MultiSectorHeader.Signature, "FILE", 4);
+    pHeader->SequenceNumber = usSequence;
+    pHeader->FirstAttributeOffset = kFirstAttributeOffset;
+    pHeader->Flags = usFlags;
+    pHeader->Reserved3[1] = kBytesPerFRS;
+    *reinterpret_cast<ULONGLONG*>(&pHeader->BaseFileRecordSegment) = ullBaseFileReference;
+    pHeader->SegmentNumberHighPart = static_cast<USHORT>(ullFRN >> 32);
+    pHeader->SegmentNumberLowPart = static_cast<ULONG>(ullFRN);
+}
+
+size_t FileRecord::ResidentSize(std::wstring_view name, size_t cbValue)
+{
+    return Align(Align(kResidentHeaderSize + name.size() * sizeof(WCHAR), 8) + cbValue, 8);
+}
+
+size_t FileRecord::NonResidentSize(std::wstring_view name, const NonResidentValue& value)
+{
+    return Align(
+        Align(NonResidentHeaderSize(value) + name.size() * sizeof(WCHAR), 8) + EncodeMappingPairs(value.Runs).size(),
+        8);
+}
+
+size_t FileRecord::FreeSpace() const
+{
+    return kBytesPerFRS - m_cbUsed - kEndMarkerSize;
+}
+
+PATTRIBUTE_RECORD_HEADER FileRecord::Append(ATTRIBUTE_TYPE_CODE typeCode, std::wstring_view name, size_t cbAttribute)
+{
+    assert(cbAttribute <= FreeSpace());
+
+    auto pAttribute = reinterpret_cast<PATTRIBUTE_RECORD_HEADER>(m_record.data() + m_cbUsed);
+    pAttribute->TypeCode = typeCode;
+    pAttribute->RecordLength = static_cast<ULONG>(cbAttribute);
+    pAttribute->NameLength = static_cast<UCHAR>(name.size());
+    pAttribute->Instance = m_usNextInstance++;
+
+    m_cbUsed += cbAttribute;
+    return pAttribute;
+}
+
+USHORT FileRecord::AddResident(
+    ATTRIBUTE_TYPE_CODE typeCode,
+    std::wstring_view name,
+    const void* pValue,
+    size_t cbValue,
+    UCHAR residentFlags)
+{
+    auto pAttribute = Append(typeCode, name, ResidentSize(name, cbValue));
+    const auto pBase = reinterpret_cast<uint8_t*>(pAttribute);
+
+    pAttribute->FormCode = RESIDENT_FORM;
+    pAttribute->NameOffset = static_cast<USHORT>(kResidentHeaderSize);
+    pAttribute->Form.Resident.ValueLength = static_cast<ULONG>(cbValue);
+    pAttribute->Form.Resident.ValueOffset =
+        static_cast<USHORT>(Align(kResidentHeaderSize + name.size() * sizeof(WCHAR), 8));
+    pAttribute->Form.Resident.Reserved[0] = residentFlags;
+
+    std::memcpy(pBase + pAttribute->NameOffset, name.data(), name.size() * sizeof(WCHAR));
+    if (cbValue)
+        std::memcpy(pBase + pAttribute->Form.Resident.ValueOffset, pValue, cbValue);
+
+    return pAttribute->Instance;
+}
+
+USHORT FileRecord::AddNonResident(ATTRIBUTE_TYPE_CODE typeCode, std::wstring_view name, const NonResidentValue& value)
+{
+    auto pAttribute = Append(typeCode, name, NonResidentSize(name, value));
+    const auto pBase = reinterpret_cast<uint8_t*>(pAttribute);
+    const auto cbHeader = NonResidentHeaderSize(value);
+
+    ULONGLONG ullClusters = 0LL;
+    for (const auto& run : value.Runs)
+        ullClusters += run.Length;
+
+    pAttribute->FormCode = NONRESIDENT_FORM;
+    pAttribute->NameOffset = static_cast<USHORT>(cbHeader);
+    pAttribute->Flags = value.Flags;
+    pAttribute->Form.Nonresident.LowestVcn = value.LowestVcn;
+    pAttribute->Form.Nonresident.HighestVcn = value.LowestVcn + ullClusters - 1;
+    pAttribute->Form.Nonresident.MappingPairsOffset =
+        static_cast<USHORT>(Align(cbHeader + name.size() * sizeof(WCHAR), 8));
+    pAttribute->Form.Nonresident.CompressionUnit = value.CompressionUnit;
+
+    // Only the first extent of an attribute carries the sizes
+    if (value.LowestVcn == 0)
+    {
+        pAttribute->Form.Nonresident.AllocatedLength = value.AllocatedLength;
+        pAttribute->Form.Nonresident.FileSize = value.FileSize;
+        pAttribute->Form.Nonresident.ValidDataLength = value.ValidDataLength;
+        if (cbHeader == kCompressedHeaderSize)
+            pAttribute->Form.Nonresident.TotalAllocated = value.TotalAllocated;
+    }
+
+    std::memcpy(pBase + pAttribute->NameOffset, name.data(), name.size() * sizeof(WCHAR));
+
+    const auto pairs = EncodeMappingPairs(value.Runs);
+    std::memcpy(pBase + pAttribute->Form.Nonresident.MappingPairsOffset, pairs.data(), pairs.size());
+
+    return pAttribute->Instance;
+}
+
+void FileRecord::SetLinkCount(USHORT usLinkCount)
+{
+    Header()->Reserved2 = usLinkCount;
+}
+
+const std::vector<uint8_t>& FileRecord::Close()
+{
+    *reinterpret_cast<ULONG*>(m_record.data() + m_cbUsed) = $END;
+    m_cbUsed += kEndMarkerSize;
+
+    auto pHeader = Header();
+    pHeader->Reserved3[0] = static_cast<ULONG>(m_cbUsed);
+    pHeader->Reserved4 = m_usNextInstance;
+
+    ApplyFixups(m_record.data(), m_record.size(), kRecordUpdateSequenceArrayOffset);
+    return m_record;
+}
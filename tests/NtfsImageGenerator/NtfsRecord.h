@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "NtfsDataStructures.h"
+
+namespace Orc::ImageGenerator {
+
+constexpr ULONG kBytesPerSector = 512;
+constexpr ULONG kBytesPerCluster = 4096;
+constexpr ULONG kBytesPerFRS = 1024;
+constexpr ULONG kBytesPerIndexBlock = 4096;
+
+constexpr LCN kSparseLcn = -1;
+
+constexpr ULONGLONG Align(ULONGLONG value, ULONGLONG alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+constexpr ULONGLONG ToClusters(ULONGLONG bytes)
+{
+    return Align(bytes, kBytesPerCluster) / kBytesPerCluster;
+}
+
+constexpr ULONGLONG MakeFileReference(ULONGLONG ullFRN, USHORT usSequence)
+{
+    return ullFRN | (static_cast<ULONGLONG>(usSequence) << 48);
+}
+
+// Contiguous clusters of a non resident attribute, kSparseLcn for a hole
+struct Run
+{
+    LCN Lcn;
+    ULONGLONG Length;
+};
+
+std::vector<uint8_t> EncodeMappingPairs(const std::vector<Run>& runs);
+
+// Replace the last USHORT of each sector with the update sequence number and save them in the update sequence array
+void ApplyFixups(uint8_t* pData, size_t cbData, USHORT usUpdateSequenceArrayOffset);
+
+struct NonResidentValue
+{
+    std::vector<Run> Runs;
+    VCN LowestVcn = 0LL;
+    ULONGLONG AllocatedLength = 0LL;
+    ULONGLONG FileSize = 0LL;
+    ULONGLONG ValidDataLength = 0LL;
+    // Only stored for compressed or sparse attributes
+    ULONGLONG TotalAllocated = 0LL;
+    USHORT Flags = 0;
+    UCHAR CompressionUnit = 0;
+};
+
+//
+// FileRecord: a FILE record segment built attribute after attribute.
+//
+// Attributes must be added in the order NTFS keeps them (type code, then upcased name), the caller checks the space
+// left with the static size helpers before adding one.
+//
+class FileRecord
+{
+public:
+    FileRecord(ULONGLONG ullFRN, USHORT usSequence, USHORT usFlags, ULONGLONG ullBaseFileReference = 0LL);
+
+    static size_t ResidentSize(std::wstring_view name, size_t cbValue);
+    static size_t NonResidentSize(std::wstring_view name, const NonResidentValue& value);
+
+    size_t FreeSpace() const;
+
+    // Return the instance of the new attribute
+    USHORT AddResident(
+        ATTRIBUTE_TYPE_CODE typeCode,
+        std::wstring_view name,
+        const void* pValue,
+        size_t cbValue,
+        UCHAR residentFlags = 0);
+
+    USHORT AddNonResident(ATTRIBUTE_TYPE_CODE typeCode, std::wstring_view name, const NonResidentValue& value);
+
+    void SetLinkCount(USHORT usLinkCount);
+
+    // Terminate the record and apply the fixups, the record cannot be modified afterwards
+    const std::vector<uint8_t>& Close();
+
+private:
+    PATTRIBUTE_RECORD_HEADER Append(ATTRIBUTE_TYPE_CODE typeCode, std::wstring_view name, size_t cbAttribute);
+    PFILE_RECORD_SEGMENT_HEADER Header() { return reinterpret_cast<PFILE_RECORD_SEGMENT_HEADER>(m_record.data()); }
+
+    std::vector<uint8_t> m_record;
+    size_t m_cbUsed;
+    USHORT m_usNextInstance = 0;
+};
+
+}  // namespace Orc::ImageGenerator
@@ -0,0 +1,1376 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "NtfsVolume.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include <sddl.h>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+#include "DiskStructures.h"
+
+#include "FileContent.h"
+#include "ImageWriter.h"
+
+using namespace std::string_view_literals;
+
+using namespace Orc;
+using namespace Orc::ImageGenerator;
+
+namespace {
+
+constexpr ULONGLONG kPartitionOffset = 1024 * 1024;
+
+constexpr ULONGLONG kMftFRN = 0;
+constexpr ULONGLONG kRootFRN = 5;
+constexpr ULONGLONG kExtendFRN = 11;
+constexpr ULONGLONG kReservedFRNs = 16;
+constexpr ULONGLONG kUsnJournalFRN = 24;
+constexpr ULONGLONG kFirstUserFRN = 32;
+
+constexpr LCN kBootLcn = 0;
+constexpr ULONGLONG kBootSize = 8192;
+constexpr LCN kMftMirrorLcn = 2;
+constexpr ULONGLONG kMftMirrorRecords = 4;
+
+constexpr ULONGLONG kLogFileSize = 2 * 1024 * 1024;
+constexpr ULONGLONG kAttrDefSize = 0xA00;
+constexpr ULONGLONG kUpcaseSize = 0x10000 * sizeof(WCHAR);
+constexpr ULONGLONG kSdsMirrorOffset = 0x40000;
+constexpr ULONG kSecurityId = 0x100;
+
+// Files with an $ATTRIBUTE_LIST keep a small unnamed $DATA and move their named streams to extension records
+constexpr ULONG kListedStreams = 8;
+constexpr size_t kListedStreamSize = 256;
+constexpr size_t kListedDataSize = 64;
+
+// 2020-01-01, then one second per file
+constexpr LONGLONG kBaseTime = 132223104000000000LL;
+constexpr LONGLONG kTimeStep = 10000000LL;
+
+constexpr USHORT kAttributeFlagLznt1 = 0x0001;
+constexpr ULONG kDupFileNameIndexPresent = 0x10000000;
+constexpr ULONG kSystemFileAttributes = FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM;
+
+constexpr auto kZoneIdentifier = "[ZoneTransfer]\r\nZoneId=3\r\n"sv;
+
+#pragma pack(push, 4)
+
+struct VOLUME_INFORMATION
+{
+    LONGLONG Reserved;
+    UCHAR MajorVersion;
+    UCHAR MinorVersion;
+    USHORT Flags;
+};
+
+struct ATTRIBUTE_DEFINITION_COLUMNS
+{
+    WCHAR AttributeName[64];
+    ATTRIBUTE_TYPE_CODE AttributeTypeCode;
+    ULONG DisplayRule;
+    ULONG CollationRule;
+    ULONG Flags;
+    LONGLONG MinimumLength;
+    LONGLONG MaximumLength;
+};
+
+struct SECURITY_DESCRIPTOR_HEADER
+{
+    ULONG Hash;
+    ULONG SecurityId;
+    ULONGLONG Offset;
+    ULONG Length;
+};
+
+struct SECURITY_HASH_KEY
+{
+    ULONG Hash;
+    ULONG SecurityId;
+};
+
+struct USN_JOURNAL_MAX
+{
+    ULONGLONG MaximumSize;
+    ULONGLONG AllocationDelta;
+    ULONGLONG UsnJournalId;
+    LONGLONG LowestValidUsn;
+};
+
+#pragma pack(pop)
+
+static_assert(sizeof(ATTRIBUTE_DEFINITION_COLUMNS) == 160);
+static_assert(sizeof(SECURITY_DESCRIPTOR_HEADER) == 20);
+
+struct AttributeDefinition
+{
+    std::wstring_view Name;
+    ATTRIBUTE_TYPE_CODE TypeCode;
+    ULONG CollationRule;
+    ULONG Flags;
+    LONGLONG MinimumLength;
+    LONGLONG MaximumLength;
+};
+
+const AttributeDefinition kAttributeDefinitions[] = {
+    {L"$STANDARD_INFORMATION", $STANDARD_INFORMATION, 0, 0x40, 0x30, 0x48},
+    {L"$ATTRIBUTE_LIST", $ATTRIBUTE_LIST, 0, 0x80, 0, -1},
+    {L"$FILE_NAME", $FILE_NAME, 1, 0x42, 0x44, 0x242},
+    {L"$OBJECT_ID", $OBJECT_ID, 0, 0x40, 0, 0x100},
+    {L"$SECURITY_DESCRIPTOR", $SECURITY_DESCRIPTOR, 0, 0x80, 0, -1},
+    {L"$VOLUME_NAME", $VOLUME_NAME, 0, 0x40, 2, 0x100},
+    {L"$VOLUME_INFORMATION", $VOLUME_INFORMATION, 0, 0x40, 0xC, 0xC},
+    {L"$DATA", $DATA, 0, 0, 0, -1},
+    {L"$INDEX_ROOT", $INDEX_ROOT, 0, 0x40, 0, -1},
+    {L"$INDEX_ALLOCATION", $INDEX_ALLOCATION, 0, 0, 0, -1},
+    {L"$BITMAP", $BITMAP, 0, 0x80, 0, -1},
+    {L"$REPARSE_POINT", $REPARSE_POINT, 0, 0x80, 0, 0x4000},
+    {L"$EA_INFORMATION", $EA_INFORMATION, 0, 0x40, 8, 8},
+    {L"$EA", $EA, 0, 0, 0, 0x10000},
+    {L"$LOGGED_UTILITY_STREAM", $LOGGED_UTILITY_STREAM, 0, 0x80, 0, 0x10000},
+};
+
+ULONGLONG SplitMix64(ULONGLONG value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+bool IsOneIn(ULONG every, ULONGLONG ullIndex, ULONG slot)
+{
+    return every != 0 && ullIndex % every == slot % every;
+}
+
+std::vector<uint8_t> MakeStandardInformation(ULONG ulFileAttributes, LONGLONG time)
+{
+    std::vector<uint8_t> value(sizeof(STANDARD_INFORMATION), 0);
+    auto pInfo = reinterpret_cast<PSTANDARD_INFORMATION>(value.data());
+
+    FILETIME filetime {static_cast<DWORD>(time), static_cast<DWORD>(time >> 32)};
+    pInfo->CreationTime = filetime;
+    pInfo->LastModificationTime = filetime;
+    pInfo->LastChangeTime = filetime;
+    pInfo->LastAccessTime = filetime;
+    pInfo->FileAttributes = ulFileAttributes;
+    pInfo->SecurityId = kSecurityId;
+    return value;
+}
+
+std::vector<uint8_t> MakeFileNameValue(
+    ULONGLONG ullParentReference,
+    std::wstring_view name,
+    UCHAR nameFlags,
+    LONGLONG time,
+    ULONGLONG ullAllocatedSize,
+    ULONGLONG ullDataSize,
+    ULONG ulFileAttributes,
+    ULONG ulReparseTag)
+{
+    std::vector<uint8_t> value(NtfsFileNameSizeFromLength(name.size() * sizeof(WCHAR)), 0);
+    auto pFileName = reinterpret_cast<PFILE_NAME>(value.data());
+
+    *reinterpret_cast<ULONGLONG*>(&pFileName->ParentDirectory) = ullParentReference;
+    pFileName->Info.CreationTime = time;
+    pFileName->Info.LastModificationTime = time;
+    pFileName->Info.LastChangeTime = time;
+    pFileName->Info.LastAccessTime = time;
+    pFileName->Info.Reserved18.AllocatedSize = ullAllocatedSize;
+    pFileName->Info.Reserved18.DataSize = ullDataSize;
+    pFileName->Info.Reserved18.FileAttributes = ulFileAttributes;
+    pFileName->Info.Reserved18.ReparseTag = ulReparseTag;
+    pFileName->FileNameLength = static_cast<UCHAR>(name.size());
+    pFileName->Flags = nameFlags;
+    std::memcpy(pFileName->FileName, name.data(), name.size() * sizeof(WCHAR));
+    return value;
+}
+
+ULONG FileAttributes(const NtfsVolume::FileSpec& spec)
+{
+    switch (spec.Kind)
+    {
+        case NtfsVolume::DataKind::Lznt1:
+            return FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_COMPRESSED;
+        case NtfsVolume::DataKind::Wof:
+            return FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_SPARSE_FILE | FILE_ATTRIBUTE_REPARSE_POINT;
+        default:
+            return FILE_ATTRIBUTE_ARCHIVE;
+    }
+}
+
+ULONGLONG AllocatedSize(const NtfsVolume::FileSpec& spec)
+{
+    switch (spec.Kind)
+    {
+        case NtfsVolume::DataKind::Resident:
+            return Align(spec.Size, 8);
+        case NtfsVolume::DataKind::Lznt1:
+            return Align(spec.Size, kLznt1UnitSize);
+        default:
+            return Align(spec.Size, kBytesPerCluster);
+    }
+}
+
+// NTFS stores EA names in upper case, the packed size is what FILE_NAME reports
+std::vector<uint8_t> MakeExtendedAttributes(ULONGLONG ullIndex, EA_INFORMATION& information)
+{
+    const std::pair<std::string_view, std::string> eas[] = {
+        {"ORC.GENERATOR"sv, "NtfsImageGenerator"},
+        {"ORC.INDEX"sv, fmt::format("{:016X}", ullIndex)},
+    };
+
+    std::vector<uint8_t> value;
+    information = {};
+
+    for (size_t i = 0; i < std::size(eas); i++)
+    {
+        const auto& [name, data] = eas[i];
+        const auto offset = value.size();
+        const auto cbEntry = offsetof(FILE_FULL_EA_INFORMATION, EaName) + name.size() + 1 + data.size();
+        const auto cbAligned = i + 1 < std::size(eas) ? Align(cbEntry, 4) : cbEntry;
+
+        value.resize(offset + cbAligned, 0);
+        auto pEa = reinterpret_cast<PFILE_FULL_EA_INFORMATION>(value.data() + offset);
+        pEa->NextEntryOffset = i + 1 < std::size(eas) ? static_cast<ULONG>(cbAligned) : 0;
+        pEa->EaNameLength = static_cast<UCHAR>(name.size());
+        pEa->EaValueLength = static_cast<USHORT>(data.size());
+        std::memcpy(pEa->EaName, name.data(), name.size());
+        std::memcpy(pEa->EaName + name.size() + 1, data.data(), data.size());
+
+        information.PackedEaSize += static_cast<USHORT>(5 + name.size() + data.size());
+        information.UnpackedEaSize += static_cast<ULONG>(Align(cbEntry, 4));
+    }
+
+    return value;
+}
+
+std::vector<uint8_t> MakeWofReparsePoint(Ntfs::WofAlgorithm algorithm)
+{
+    // WOF_EXTERNAL_INFO {version 1, provider FILE} followed by FILE_PROVIDER_EXTERNAL_INFO_V1 {version 1, algorithm}
+    const ULONG data[] = {1, 2, 1, static_cast<ULONG>(algorithm)};
+
+    std::vector<uint8_t> value(offsetof(REPARSE_POINT_ATTRIBUTE, Data) + sizeof(data), 0);
+    auto pReparse = reinterpret_cast<PREPARSE_POINT_ATTRIBUTE>(value.data());
+    pReparse->TypeAndFlags = IO_REPARSE_TAG_WOF;
+    pReparse->DataLength = sizeof(data);
+    std::memcpy(pReparse->Data, data, sizeof(data));
+    return value;
+}
+
+std::vector<uint8_t> MakeAttributeListEntry(
+    ATTRIBUTE_TYPE_CODE typeCode,
+    std::wstring_view name,
+    ULONGLONG ullSegmentReference,
+    USHORT usInstance)
+{
+    const auto cbHeader = offsetof(ATTRIBUTE_LIST_ENTRY, AttributeName);
+    std::vector<uint8_t> entry(Align(cbHeader + name.size() * sizeof(WCHAR), 8), 0);
+
+    auto pEntry = reinterpret_cast<PATTRIBUTE_LIST_ENTRY>(entry.data());
+    pEntry->AttributeTypeCode = typeCode;
+    pEntry->RecordLength = static_cast<USHORT>(entry.size());
+    pEntry->AttributeNameLength = static_cast<UCHAR>(name.size());
+    pEntry->AttributeNameOffset = static_cast<UCHAR>(cbHeader);
+    *reinterpret_cast<ULONGLONG*>(&pEntry->SegmentReference) = ullSegmentReference;
+    pEntry->Reserved = usInstance;
+    std::memcpy(pEntry->AttributeName, name.data(), name.size() * sizeof(WCHAR));
+    return entry;
+}
+
+ULONG SecurityDescriptorHash(const std::vector<uint8_t>& descriptor)
+{
+    ULONG hash = 0L;
+    for (size_t i = 0; i + sizeof(ULONG) <= descriptor.size(); i += sizeof(ULONG))
+    {
+        hash = *reinterpret_cast<const ULONG*>(descriptor.data() + i) + ((hash << 3) | (hash >> 29));
+    }
+    return hash;
+}
+
+std::wstring_view IndexEntryName(const std::vector<uint8_t>& entry)
+{
+    const auto pFileName = reinterpret_cast<const FILE_NAME*>(entry.data() + sizeof(INDEX_ENTRY));
+    return {pFileName->FileName, pFileName->FileNameLength};
+}
+
+}  // namespace
+
+struct NtfsVolume::SystemFile
+{
+    ULONGLONG FRN;
+    std::wstring_view Name;
+    ULONGLONG Size;
+    bool bDirectory;
+};
+
+NtfsVolume::NtfsVolume(const VolumeOptions& options)
+    : m_options(options)
+    , m_upcase(0x10000)
+{
+    for (ULONG c = 0; c < m_upcase.size(); c++)
+    {
+        WCHAR lower = static_cast<WCHAR>(c), upper = static_cast<WCHAR>(c);
+        if (c < 0xD800 || c > 0xDFFF)
+        {
+            LCMapStringEx(LOCALE_NAME_INVARIANT, LCMAP_UPPERCASE, &lower, 1, &upper, 1, NULL, NULL, 0);
+        }
+        m_upcase[c] = upper;
+    }
+
+    PSECURITY_DESCRIPTOR pDescriptor = nullptr;
+    ULONG cbDescriptor = 0L;
+    if (ConvertStringSecurityDescriptorToSecurityDescriptorW(
+            L"O:BAG:SYD:(A;OICI;FA;;;SY)(A;OICI;FA;;;BA)(A;OICI;0x1200a9;;;BU)",
+            SDDL_REVISION_1,
+            &pDescriptor,
+            &cbDescriptor))
+    {
+        const auto pBytes = static_cast<const uint8_t*>(pDescriptor);
+        m_securityDescriptor.assign(pBytes, pBytes + cbDescriptor);
+        LocalFree(pDescriptor);
+    }
+}
+
+NtfsVolume::~NtfsVolume() {}
+
+LCN NtfsVolume::Allocate(ULONGLONG ullClusters)
+{
+    const auto lcn = m_nextLcn;
+    m_nextLcn += ullClusters;
+    return lcn;
+}
+
+void NtfsVolume::PlanLayout()
+{
+    const auto ullFiles = m_options.FileCount;
+    const auto ullPerDirectory = std::max<ULONGLONG>(1, m_options.FilesPerDirectory);
+    const auto ulDepth = m_options.Depth;
+
+    // Level 0 is the root, files live in the directories of the last level
+    m_levelCounts.assign(ulDepth + 1, 1);
+    if (ulDepth > 0)
+    {
+        const auto ullLeaves = std::max<ULONGLONG>(1, (ullFiles + ullPerDirectory - 1) / ullPerDirectory);
+
+        m_ullBranching = 1;
+        const auto coversLeaves = [ulDepth, ullLeaves](ULONGLONG ullBranching) {
+            ULONGLONG ullCapacity = 1;
+            for (ULONG i = 0; i < ulDepth && ullCapacity < ullLeaves; i++)
+                ullCapacity *= ullBranching;
+            return ullCapacity >= ullLeaves;
+        };
+        while (!coversLeaves(m_ullBranching))
+            m_ullBranching++;
+
+        m_levelCounts[ulDepth] = ullLeaves;
+        for (ULONG level = ulDepth - 1; level > 0; level--)
+            m_levelCounts[level] = (m_levelCounts[level + 1] + m_ullBranching - 1) / m_ullBranching;
+    }
+
+    m_levelFirstFRN.assign(ulDepth + 1, kRootFRN);
+    auto ullNextFRN = kFirstUserFRN;
+    for (ULONG level = 1; level <= ulDepth; level++)
+    {
+        m_levelFirstFRN[level] = ullNextFRN;
+        ullNextFRN += m_levelCounts[level];
+        m_statistics.Directories += m_levelCounts[level];
+    }
+
+    m_ullFirstFileFRN = ullNextFRN;
+    m_ullFirstExtensionFRN = m_ullFirstFileFRN + ullFiles;
+
+    const auto ullStreamsPerRecord =
+        FileRecord(0, 0, 0).FreeSpace() / FileRecord::ResidentSize(L"stream.00", kListedStreamSize);
+    m_ullExtensionsPerFile = (kListedStreams + ullStreamsPerRecord - 1) / ullStreamsPerRecord;
+
+    const auto ullListedFiles = m_options.AttributeListEvery
+        ? (ullFiles + m_options.AttributeListEvery - 1) / m_options.AttributeListEvery
+        : 0;
+    m_ullRecordCount = Align(m_ullFirstExtensionFRN + ullListedFiles * m_ullExtensionsPerFile, kMftMirrorRecords);
+
+    // Fixed system areas first, the rest of the clusters is allocated as content is written
+    m_nextLcn = 0;
+    Allocate(ToClusters(kBootSize));
+    Allocate(1);
+    m_logFileLcn = Allocate(ToClusters(kLogFileSize));
+    m_attrDefLcn = Allocate(ToClusters(kAttrDefSize));
+    m_upcaseLcn = Allocate(ToClusters(kUpcaseSize));
+
+    m_ullSdsSize = kSdsMirrorOffset + Align(sizeof(SECURITY_DESCRIPTOR_HEADER) + m_securityDescriptor.size(), 16);
+    m_sdsLcn = Allocate(ToClusters(m_ullSdsSize));
+
+    m_mftLcn = Allocate(ToClusters(m_ullRecordCount * kBytesPerFRS));
+    m_mftBitmapLcn = Allocate(ToClusters(Align((m_ullRecordCount + 7) / 8, 8)));
+
+    if (m_options.UsnJournalSize)
+    {
+        m_usnLcn = Allocate(ToClusters(m_options.UsnJournalSize));
+    }
+
+    m_statistics.Records = m_ullRecordCount;
+}
+
+ULONGLONG NtfsVolume::DirectoryReference(ULONG ulLevel, ULONGLONG ullIndex) const
+{
+    if (ulLevel == 0)
+        return $ROOT_FILE_REFERENCE_NUMBER;
+
+    return MakeFileReference(m_levelFirstFRN[ulLevel] + ullIndex, 1);
+}
+
+NtfsVolume::FileSpec NtfsVolume::DescribeFile(ULONGLONG ullIndex) const
+{
+    const auto ullPerDirectory = std::max<ULONGLONG>(1, m_options.FilesPerDirectory);
+    const auto ullHash = SplitMix64(ullIndex ^ (static_cast<ULONGLONG>(m_options.Seed) << 32));
+
+    FileSpec spec {};
+    spec.Index = ullIndex;
+    spec.FRN = m_ullFirstFileFRN + ullIndex;
+    spec.ParentReference = m_options.Depth ? DirectoryReference(m_options.Depth, ullIndex / ullPerDirectory)
+                                           : $ROOT_FILE_REFERENCE_NUMBER;
+    spec.Name = fmt::format(L"f{:09}.dat", ullIndex);
+    spec.Time = kBaseTime + static_cast<LONGLONG>(ullIndex) * kTimeStep;
+    spec.WofAlgorithm = Ntfs::WofAlgorithm::kUnknown;
+
+    if (IsOneIn(m_options.AttributeListEvery, ullIndex, 0))
+    {
+        spec.bAttributeList = true;
+        spec.Kind = DataKind::Resident;
+        spec.Size = kListedDataSize;
+        return spec;
+    }
+
+    spec.bAlternateStream = IsOneIn(m_options.AlternateStreamEvery, ullIndex, 1);
+    spec.bExtendedAttributes = IsOneIn(m_options.ExtendedAttributesEvery, ullIndex, 2);
+
+    if (IsOneIn(m_options.WofEvery, ullIndex, 3))
+    {
+        // LZX is left out: OrcLib does not decompress it
+        const Ntfs::WofAlgorithm algorithms[] = {
+            Ntfs::WofAlgorithm::kXpress4k, Ntfs::WofAlgorithm::kXpress8k, Ntfs::WofAlgorithm::kXpress16k};
+
+        spec.Kind = DataKind::Wof;
+        spec.WofAlgorithm = algorithms[(ullIndex / m_options.WofEvery) % std::size(algorithms)];
+        spec.Size = 16 * 1024 + ullHash % (240 * 1024);
+    }
+    else if (IsOneIn(m_options.Lznt1Every, ullIndex, 4))
+    {
+        spec.Kind = DataKind::Lznt1;
+        spec.Size = 16 * 1024 + ullHash % (240 * 1024);
+    }
+    else if (IsOneIn(m_options.NonResidentEvery, ullIndex, 5))
+    {
+        spec.Kind = DataKind::NonResident;
+        spec.Size = 1024 + ullHash % (256 * 1024);
+    }
+    else
+    {
+        spec.Kind = DataKind::Resident;
+        spec.Size = ullHash % 400;
+    }
+
+    return spec;
+}
+
+std::vector<uint8_t> NtfsVolume::MakeFileName(const FileSpec& spec) const
+{
+    ULONG ulReparseTag = 0L;
+    if (spec.Kind == DataKind::Wof)
+    {
+        ulReparseTag = IO_REPARSE_TAG_WOF;
+    }
+    else if (spec.bExtendedAttributes)
+    {
+        EA_INFORMATION information;
+        MakeExtendedAttributes(spec.Index, information);
+        ulReparseTag = information.PackedEaSize;
+    }
+
+    return MakeFileNameValue(
+        spec.ParentReference,
+        spec.Name,
+        FILE_NAME_WIN32,
+        spec.Time,
+        AllocatedSize(spec),
+        spec.Size,
+        FileAttributes(spec),
+        ulReparseTag);
+}
+
+std::vector<uint8_t> NtfsVolume::MakeDirectoryFileName(ULONG ulLevel, ULONGLONG ullIndex) const
+{
+    const auto ullParent = ulLevel > 1 ? ullIndex / m_ullBranching : 0;
+
+    return MakeFileNameValue(
+        DirectoryReference(ulLevel - 1, ullParent),
+        fmt::format(L"d{:07}", ullIndex),
+        FILE_NAME_WIN32,
+        kBaseTime,
+        0,
+        0,
+        kDupFileNameIndexPresent,
+        0);
+}
+
+std::vector<std::vector<uint8_t>> NtfsVolume::DirectoryEntries(ULONG ulLevel, ULONGLONG ullIndex) const
+{
+    std::vector<std::vector<uint8_t>> entries;
+
+    if (ulLevel < m_options.Depth)
+    {
+        const auto ullFirst = ulLevel == 0 ? 0 : ullIndex * m_ullBranching;
+        const auto ullLast =
+            ulLevel == 0 ? m_levelCounts[1] : std::min(ullFirst + m_ullBranching, m_levelCounts[ulLevel + 1]);
+
+        for (auto ullChild = ullFirst; ullChild < ullLast; ullChild++)
+        {
+            const auto fileName = MakeDirectoryFileName(ulLevel + 1, ullChild);
+            entries.push_back(
+                MakeFileNameIndexEntry(DirectoryReference(ulLevel + 1, ullChild), fileName.data(), fileName.size()));
+        }
+    }
+    else
+    {
+        const auto ullPerDirectory = std::max<ULONGLONG>(1, m_options.FilesPerDirectory);
+        const auto ullFirst = m_options.Depth ? ullIndex * ullPerDirectory : 0;
+        const auto ullLast =
+            m_options.Depth ? std::min(ullFirst + ullPerDirectory, m_options.FileCount) : m_options.FileCount;
+
+        for (auto ullFile = ullFirst; ullFile < ullLast; ullFile++)
+        {
+            const auto spec = DescribeFile(ullFile);
+            const auto fileName = MakeFileName(spec);
+            entries.push_back(MakeFileNameIndexEntry(MakeFileReference(spec.FRN, 1), fileName.data(), fileName.size()));
+        }
+    }
+
+    return entries;
+}
+
+bool NtfsVolume::CollateFileNames(const std::vector<uint8_t>& left, const std::vector<uint8_t>& right) const
+{
+    const auto leftName = IndexEntryName(left);
+    const auto rightName = IndexEntryName(right);
+
+    const auto upcase = [this](WCHAR c) { return m_upcase[c]; };
+    return std::lexicographical_compare(
+        std::cbegin(leftName),
+        std::cend(leftName),
+        std::cbegin(rightName),
+        std::cend(rightName),
+        [&upcase](WCHAR l, WCHAR r) { return upcase(l) < upcase(r); });
+}
+
+HRESULT NtfsVolume::WriteRecord(ULONGLONG ullFRN, FileRecord& record)
+{
+    const auto& bytes = record.Close();
+
+    if (ullFRN < kMftMirrorRecords)
+    {
+        m_mftMirror.resize(kMftMirrorRecords * kBytesPerFRS);
+        std::copy(std::cbegin(bytes), std::cend(bytes), std::begin(m_mftMirror) + ullFRN * kBytesPerFRS);
+    }
+
+    return m_writer->Write(m_mftLcn * kBytesPerCluster + ullFRN * kBytesPerFRS, bytes.data(), bytes.size());
+}
+
+HRESULT NtfsVolume::WriteClusters(LCN lcn, const void* pData, size_t cbData)
+{
+    return m_writer->Write(lcn * kBytesPerCluster, pData, cbData);
+}
+
+HRESULT NtfsVolume::WriteIndex(
+    FileRecord& record,
+    std::wstring_view name,
+    std::vector<std::vector<uint8_t>>& entries,
+    ATTRIBUTE_TYPE_CODE indexedAttributeType,
+    ULONG collationRule)
+{
+    if (collationRule == COLLATION_FILE_NAME)
+    {
+        std::sort(std::begin(entries), std::end(entries), [this](const auto& left, const auto& right) {
+            return CollateFileNames(left, right);
+        });
+    }
+
+    const auto cbRootEntries = record.FreeSpace() - FileRecord::ResidentSize(name, kIndexRootHeaderSize);
+    auto index = BuildIndex(entries, indexedAttributeType, collationRule, cbRootEntries);
+
+    // A large index also needs room for its $INDEX_ALLOCATION and $BITMAP, which depends on the number of buffers
+    ULONGLONG ullBlocks = 0LL;
+    while (index.Blocks.size() > ullBlocks)
+    {
+        ullBlocks = index.Blocks.size();
+
+        NonResidentValue allocation;
+        allocation.Runs = {{1LL << 47, ullBlocks}};
+        const auto cbReserved = FileRecord::NonResidentSize(name, allocation)
+            + FileRecord::ResidentSize(name, MakeIndexBitmap(ullBlocks).size());
+
+        index = BuildIndex(entries, indexedAttributeType, collationRule, cbRootEntries - cbReserved);
+    }
+
+    record.AddResident($INDEX_ROOT, name, index.Root.data(), index.Root.size());
+    if (index.Blocks.empty())
+    {
+        return S_OK;
+    }
+
+    const auto lcn = Allocate(index.Blocks.size());
+    for (size_t i = 0; i < index.Blocks.size(); i++)
+    {
+        if (auto hr = WriteClusters(lcn + i, index.Blocks[i].data(), index.Blocks[i].size()); FAILED(hr))
+            return hr;
+    }
+
+    NonResidentValue allocation;
+    allocation.Runs = {{lcn, index.Blocks.size()}};
+    allocation.AllocatedLength = allocation.FileSize = allocation.ValidDataLength =
+        index.Blocks.size() * kBytesPerIndexBlock;
+    record.AddNonResident($INDEX_ALLOCATION, name, allocation);
+
+    const auto bitmap = MakeIndexBitmap(index.Blocks.size());
+    record.AddResident($BITMAP, name, bitmap.data(), bitmap.size());
+
+    m_statistics.IndexBlocks += index.Blocks.size();
+    return S_OK;
+}
+
+HRESULT NtfsVolume::WriteDirectories()
+{
+    for (ULONG level = 1; level <= m_options.Depth; level++)
+    {
+        for (ULONGLONG ullIndex = 0; ullIndex < m_levelCounts[level]; ullIndex++)
+        {
+            const auto ullFRN = m_levelFirstFRN[level] + ullIndex;
+
+            FileRecord record(ullFRN, 1, FILE_RECORD_SEGMENT_IN_USE | FILE_FILE_NAME_INDEX_PRESENT);
+            record.SetLinkCount(1);
+
+            const auto info = MakeStandardInformation(0, kBaseTime);
+            record.AddResident($STANDARD_INFORMATION, L"", info.data(), info.size());
+
+            const auto fileName = MakeDirectoryFileName(level, ullIndex);
+            record.AddResident($FILE_NAME, L"", fileName.data(), fileName.size(), RESIDENT_FORM_INDEXED);
+
+            auto entries = DirectoryEntries(level, ullIndex);
+            if (auto hr = WriteIndex(record, L"$I30", entries, $FILE_NAME, COLLATION_FILE_NAME); FAILED(hr))
+                return hr;
+
+            if (auto hr = WriteRecord(ullFRN, record); FAILED(hr))
+                return hr;
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT NtfsVolume::WriteFileData(const FileSpec& spec, FileRecord& record, std::vector<uint8_t>& wofStream)
+{
+    const auto content = MakeFileContent(spec.Index, spec.Size);
+
+    switch (spec.Kind)
+    {
+        case DataKind::Resident:
+            record.AddResident($DATA, L"", content.data(), content.size());
+            return S_OK;
+
+        case DataKind::NonResident: {
+            NonResidentValue data;
+            data.Runs = {{Allocate(ToClusters(spec.Size)), ToClusters(spec.Size)}};
+            data.AllocatedLength = ToClusters(spec.Size) * kBytesPerCluster;
+            data.FileSize = data.ValidDataLength = spec.Size;
+
+            if (auto hr = WriteClusters(data.Runs[0].Lcn, content.data(), content.size()); FAILED(hr))
+                return hr;
+
+            record.AddNonResident($DATA, L"", data);
+            return S_OK;
+        }
+
+        case DataKind::Lznt1: {
+            std::error_code ec;
+            const auto units = CompressLznt1Units(content, ec);
+            if (ec)
+            {
+                Log::Error(L"Failed to compress file #{} [{}]", spec.Index, ec);
+                return E_FAIL;
+            }
+
+            constexpr auto kUnitClusters = kLznt1UnitSize / kBytesPerCluster;
+
+            NonResidentValue data;
+            for (const auto& unit : units)
+            {
+                const auto ullClusters = ToClusters(unit.size());
+                const auto lcn = Allocate(ullClusters);
+                if (auto hr = WriteClusters(lcn, unit.data(), unit.size()); FAILED(hr))
+                    return hr;
+
+                data.Runs.push_back({lcn, ullClusters});
+                if (ullClusters < kUnitClusters)
+                    data.Runs.push_back({kSparseLcn, kUnitClusters - ullClusters});
+
+                data.TotalAllocated += ullClusters * kBytesPerCluster;
+            }
+
+            data.AllocatedLength = units.size() * kLznt1UnitSize;
+            data.FileSize = data.ValidDataLength = spec.Size;
+            data.Flags = kAttributeFlagLznt1;
+            data.CompressionUnit = kLznt1CompressionUnit;
+            record.AddNonResident($DATA, L"", data);
+            return S_OK;
+        }
+
+        case DataKind::Wof: {
+            std::error_code ec;
+            wofStream = MakeWofStream(content, spec.WofAlgorithm, ec);
+            if (ec)
+            {
+                Log::Error(L"Failed to compress file #{} [{}]", spec.Index, ec);
+                return E_FAIL;
+            }
+
+            // The unnamed stream is a hole of the logical size, content is in 'WofCompressedData'
+            NonResidentValue data;
+            data.Runs = {{kSparseLcn, ToClusters(spec.Size)}};
+            data.AllocatedLength = ToClusters(spec.Size) * kBytesPerCluster;
+            data.FileSize = data.ValidDataLength = spec.Size;
+            data.Flags = ATTRIBUTE_FLAG_SPARSE;
+            record.AddNonResident($DATA, L"", data);
+            return S_OK;
+        }
+    }
+
+    return E_UNEXPECTED;
+}
+
+HRESULT NtfsVolume::WriteFileWithAttributeList(const FileSpec& spec)
+{
+    const auto ullBaseReference = MakeFileReference(spec.FRN, 1);
+    const auto ullFirstExtension =
+        m_ullFirstExtensionFRN + (spec.Index / m_options.AttributeListEvery) * m_ullExtensionsPerFile;
+    const auto ullStreamsPerRecord = (kListedStreams + m_ullExtensionsPerFile - 1) / m_ullExtensionsPerFile;
+
+    // Base record attributes get their instances in order: $STANDARD_INFORMATION, $ATTRIBUTE_LIST, $FILE_NAME, $DATA
+    std::vector<uint8_t> list;
+    const auto appendEntry = [&list](const std::vector<uint8_t>& entry) {
+        list.insert(std::end(list), std::cbegin(entry), std::cend(entry));
+    };
+
+    appendEntry(MakeAttributeListEntry($STANDARD_INFORMATION, L"", ullBaseReference, 0));
+    appendEntry(MakeAttributeListEntry($FILE_NAME, L"", ullBaseReference, 2));
+    appendEntry(MakeAttributeListEntry($DATA, L"", ullBaseReference, 3));
+
+    for (ULONGLONG ullExtension = 0; ullExtension < m_ullExtensionsPerFile; ullExtension++)
+    {
+        const auto ullFRN = ullFirstExtension + ullExtension;
+        FileRecord extension(ullFRN, 1, FILE_RECORD_SEGMENT_IN_USE, ullBaseReference);
+
+        for (ULONGLONG ullStream = ullExtension * ullStreamsPerRecord;
+             ullStream < std::min<ULONGLONG>(kListedStreams, (ullExtension + 1) * ullStreamsPerRecord);
+             ullStream++)
+        {
+            const auto name = fmt::format(L"stream.{:02}", ullStream);
+            const auto content = MakeFileContent(spec.Index * kListedStreams + ullStream, kListedStreamSize);
+
+            const auto instance = extension.AddResident($DATA, name, content.data(), content.size());
+            appendEntry(MakeAttributeListEntry($DATA, name, MakeFileReference(ullFRN, 1), instance));
+        }
+
+        if (auto hr = WriteRecord(ullFRN, extension); FAILED(hr))
+            return hr;
+
+        m_statistics.ExtensionRecords++;
+    }
+
+    FileRecord record(spec.FRN, 1, FILE_RECORD_SEGMENT_IN_USE);
+    record.SetLinkCount(1);
+
+    const auto info = MakeStandardInformation(FileAttributes(spec), spec.Time);
+    record.AddResident($STANDARD_INFORMATION, L"", info.data(), info.size());
+    record.AddResident($ATTRIBUTE_LIST, L"", list.data(), list.size());
+
+    const auto fileName = MakeFileName(spec);
+    record.AddResident($FILE_NAME, L"", fileName.data(), fileName.size(), RESIDENT_FORM_INDEXED);
+
+    const auto content = MakeFileContent(spec.Index, spec.Size);
+    record.AddResident($DATA, L"", content.data(), content.size());
+
+    return WriteRecord(spec.FRN, record);
+}
+
+HRESULT NtfsVolume::WriteFile(const FileSpec& spec)
+{
+    if (spec.bAttributeList)
+    {
+        return WriteFileWithAttributeList(spec);
+    }
+
+    FileRecord record(spec.FRN, 1, FILE_RECORD_SEGMENT_IN_USE);
+    record.SetLinkCount(1);
+
+    const auto info = MakeStandardInformation(FileAttributes(spec), spec.Time);
+    record.AddResident($STANDARD_INFORMATION, L"", info.data(), info.size());
+
+    const auto fileName = MakeFileName(spec);
+    record.AddResident($FILE_NAME, L"", fileName.data(), fileName.size(), RESIDENT_FORM_INDEXED);
+
+    std::vector<uint8_t> wofStream;
+    if (auto hr = WriteFileData(spec, record, wofStream); FAILED(hr))
+        return hr;
+
+    // Named streams in collation order: 'WofCompressedData' < 'Zone.Identifier'
+    if (spec.Kind == DataKind::Wof)
+    {
+        NonResidentValue data;
+        data.Runs = {{Allocate(ToClusters(wofStream.size())), ToClusters(wofStream.size())}};
+        data.AllocatedLength = ToClusters(wofStream.size()) * kBytesPerCluster;
+        data.FileSize = data.ValidDataLength = wofStream.size();
+
+        if (auto hr = WriteClusters(data.Runs[0].Lcn, wofStream.data(), wofStream.size()); FAILED(hr))
+            return hr;
+
+        record.AddNonResident($DATA, L"WofCompressedData", data);
+    }
+
+    if (spec.bAlternateStream)
+    {
+        record.AddResident($DATA, L"Zone.Identifier", kZoneIdentifier.data(), kZoneIdentifier.size());
+    }
+
+    if (spec.Kind == DataKind::Wof)
+    {
+        const auto reparse = MakeWofReparsePoint(spec.WofAlgorithm);
+        record.AddResident($REPARSE_POINT, L"", reparse.data(), reparse.size());
+    }
+
+    if (spec.bExtendedAttributes)
+    {
+        EA_INFORMATION information;
+        const auto eas = MakeExtendedAttributes(spec.Index, information);
+        record.AddResident($EA_INFORMATION, L"", &information, sizeof(information));
+        record.AddResident($EA, L"", eas.data(), eas.size());
+    }
+
+    return WriteRecord(spec.FRN, record);
+}
+
+HRESULT NtfsVolume::WriteFiles()
+{
+    constexpr ULONGLONG kProgressStep = 1000000;
+
+    for (ULONGLONG ullIndex = 0; ullIndex < m_options.FileCount; ullIndex++)
+    {
+        if (auto hr = WriteFile(DescribeFile(ullIndex)); FAILED(hr))
+            return hr;
+
+        m_statistics.Files++;
+        if (m_statistics.Files % kProgressStep == 0)
+        {
+            Log::Info(L"{} files written", m_statistics.Files);
+        }
+    }
+
+    return S_OK;
+}
+
+HRESULT NtfsVolume::WriteUsnJournal()
+{
+    constexpr size_t kPageSize = 4096;
+    constexpr size_t kChunkSize = 1024 * 1024;
+    constexpr ULONG kReasons[] = {
+        USN_REASON_FILE_CREATE,
+        USN_REASON_FILE_CREATE | USN_REASON_DATA_EXTEND,
+        USN_REASON_FILE_CREATE | USN_REASON_DATA_EXTEND | USN_REASON_CLOSE};
+
+    const auto ullJournalSize = ToClusters(m_options.UsnJournalSize) * kBytesPerCluster;
+
+    // Records are only found past the sparse head of $J, as on a journal which has already wrapped
+    const auto ullFirstUsn = ullJournalSize;
+
+    std::vector<uint8_t> chunk(kChunkSize);
+    ULONGLONG ullRecord = 0LL;
+
+    for (ULONGLONG ullOffset = 0; ullOffset < ullJournalSize; ullOffset += kChunkSize)
+    {
+        const auto cbChunk = static_cast<size_t>(std::min<ULONGLONG>(kChunkSize, ullJournalSize - ullOffset));
+        std::fill(std::begin(chunk), std::end(chunk), 0);
+
+        for (size_t page = 0; page < cbChunk && m_options.FileCount; page += kPageSize)
+        {
+            size_t cbPage = 0;
+            for (;;)
+            {
+                const auto spec = DescribeFile((ullRecord / std::size(kReasons)) % m_options.FileCount);
+                const auto cbRecord =
+                    Align(offsetof(USN_RECORD_V2, FileName) + spec.Name.size() * sizeof(WCHAR), sizeof(LONGLONG));
+
+                if (cbPage + cbRecord > kPageSize)
+                    break;
+
+                auto pRecord = reinterpret_cast<PUSN_RECORD_V2>(chunk.data() + page + cbPage);
+                pRecord->RecordLength = static_cast<DWORD>(cbRecord);
+                pRecord->MajorVersion = 2;
+                pRecord->MinorVersion = 0;
+                pRecord->FileReferenceNumber = MakeFileReference(spec.FRN, 1);
+                pRecord->ParentFileReferenceNumber = spec.ParentReference;
+                pRecord->Usn = ullFirstUsn + ullOffset + page + cbPage;
+                pRecord->TimeStamp.QuadPart = spec.Time + static_cast<LONGLONG>(ullRecord % std::size(kReasons));
+                pRecord->Reason = kReasons[ullRecord % std::size(kReasons)];
+                pRecord->SecurityId = kSecurityId;
+                pRecord->FileAttributes = FileAttributes(spec);
+                pRecord->FileNameLength = static_cast<WORD>(spec.Name.size() * sizeof(WCHAR));
+                pRecord->FileNameOffset = static_cast<WORD>(offsetof(USN_RECORD_V2, FileName));
+                std::memcpy(pRecord->FileName, spec.Name.data(), spec.Name.size() * sizeof(WCHAR));
+
+                cbPage += cbRecord;
+                ullRecord++;
+            }
+        }
+
+        if (auto hr = WriteClusters(m_usnLcn + ullOffset / kBytesPerCluster, chunk.data(), cbChunk); FAILED(hr))
+            return hr;
+    }
+
+    m_statistics.UsnRecords = ullRecord;
+    return S_OK;
+}
+
+HRESULT NtfsVolume::WriteSystemFiles()
+{
+    const auto ullMftSize = m_ullRecordCount * kBytesPerFRS;
+    const auto ullMftBitmapSize = Align((m_ullRecordCount + 7) / 8, 8);
+
+    const auto addHeader = [](FileRecord& record, const SystemFile& file) {
+        record.SetLinkCount(1);
+
+        const auto info = MakeStandardInformation(kSystemFileAttributes, kBaseTime);
+        record.AddResident($STANDARD_INFORMATION, L"", info.data(), info.size());
+
+        const auto fileName = MakeFileNameValue(
+            file.FRN == kUsnJournalFRN ? MakeFileReference(kExtendFRN, kExtendFRN) : $ROOT_FILE_REFERENCE_NUMBER,
+            file.Name,
+            FILE_NAME_WIN32 | FILE_NAME_DOS83,
+            kBaseTime,
+            Align(file.Size, kBytesPerCluster),
+            file.Size,
+            kSystemFileAttributes | (file.bDirectory ? kDupFileNameIndexPresent : 0),
+            0);
+        record.AddResident($FILE_NAME, L"", fileName.data(), fileName.size(), RESIDENT_FORM_INDEXED);
+    };
+
+    const auto sequence = [](ULONGLONG ullFRN) { return static_cast<USHORT>(ullFRN == kMftFRN ? 1 : ullFRN); };
+    const auto nonResident = [](LCN lcn, ULONGLONG ullSize) {
+        NonResidentValue value;
+        if (ullSize)
+            value.Runs = {{lcn, ToClusters(ullSize)}};
+        value.AllocatedLength = ToClusters(ullSize) * kBytesPerCluster;
+        value.FileSize = value.ValidDataLength = ullSize;
+        return value;
+    };
+
+    // $Extend and the root are written first, their indexes allocate clusters
+    if (m_options.UsnJournalSize)
+    {
+        const auto ullJournalSize = ToClusters(m_options.UsnJournalSize) * kBytesPerCluster;
+
+        FileRecord record(kUsnJournalFRN, 1, FILE_RECORD_SEGMENT_IN_USE);
+        addHeader(record, {kUsnJournalFRN, L"$UsnJrnl", 0, false});
+
+        NonResidentValue journal;
+        journal.Runs = {{kSparseLcn, ToClusters(ullJournalSize)}, {m_usnLcn, ToClusters(ullJournalSize)}};
+        journal.AllocatedLength = journal.FileSize = journal.ValidDataLength = 2 * ullJournalSize;
+        journal.TotalAllocated = ullJournalSize;
+        journal.Flags = ATTRIBUTE_FLAG_SPARSE;
+        record.AddNonResident($DATA, L"$J", journal);
+
+        const USN_JOURNAL_MAX max {
+            m_options.UsnJournalSize, m_options.UsnJournalSize / 8, kBaseTime, static_cast<LONGLONG>(ullJournalSize)};
+        record.AddResident($DATA, L"$Max", &max, sizeof(max));
+
+        if (auto hr = WriteRecord(kUsnJournalFRN, record); FAILED(hr))
+            return hr;
+
+        FileRecord extend(kExtendFRN, sequence(kExtendFRN), FILE_RECORD_SEGMENT_IN_USE | FILE_FILE_NAME_INDEX_PRESENT);
+        addHeader(extend, {kExtendFRN, L"$Extend", 0, true});
+
+        const auto fileName = MakeFileNameValue(
+            MakeFileReference(kExtendFRN, kExtendFRN),
+            L"$UsnJrnl",
+            FILE_NAME_WIN32 | FILE_NAME_DOS83,
+            kBaseTime,
+            0,
+            0,
+            kSystemFileAttributes | FILE_ATTRIBUTE_ARCHIVE | FILE_ATTRIBUTE_SPARSE_FILE,
+            0);
+
+        std::vector<std::vector<uint8_t>> entries {
+            MakeFileNameIndexEntry(MakeFileReference(kUsnJournalFRN, 1), fileName.data(), fileName.size())};
+        if (auto hr = WriteIndex(extend, L"$I30", entries, $FILE_NAME, COLLATION_FILE_NAME); FAILED(hr))
+            return hr;
+
+        if (auto hr = WriteRecord(kExtendFRN, extend); FAILED(hr))
+            return hr;
+    }
+    else
+    {
+        FileRecord extend(kExtendFRN, sequence(kExtendFRN), FILE_RECORD_SEGMENT_IN_USE | FILE_FILE_NAME_INDEX_PRESENT);
+        addHeader(extend, {kExtendFRN, L"$Extend", 0, true});
+
+        std::vector<std::vector<uint8_t>> entries;
+        if (auto hr = WriteIndex(extend, L"$I30", entries, $FILE_NAME, COLLATION_FILE_NAME); FAILED(hr))
+            return hr;
+
+        if (auto hr = WriteRecord(kExtendFRN, extend); FAILED(hr))
+            return hr;
+    }
+
+    // $Bitmap size depends on the clusters it takes itself, its spare cluster holds the backup boot sector
+    ULONGLONG ullBitmapClusters = 1;
+    while (ToClusters(Align((m_nextLcn + ullBitmapClusters + 7) / 8, 8)) > ullBitmapClusters)
+        ullBitmapClusters++;
+
+    std::vector<SystemFile> files {
+        {0, L"$MFT", ullMftSize, false},
+        {1, L"$MFTMirr", kMftMirrorRecords * kBytesPerFRS, false},
+        {2, L"$LogFile", kLogFileSize, false},
+        {3, L"$Volume", 0, false},
+        {4, L"$AttrDef", kAttrDefSize, false},
+        {5, L".", 0, true},
+        {6, L"$Bitmap", 0, false},
+        {7, L"$Boot", kBootSize, false},
+        {8, L"$BadClus", 0, false},
+        {9, L"$Secure", 0, false},
+        {10, L"$UpCase", kUpcaseSize, false},
+        {11, L"$Extend", 0, true},
+    };
+
+    // Root index: system files, the root itself and the first level
+    {
+        auto entries = DirectoryEntries(0, 0);
+        for (const auto& file : files)
+        {
+            const auto fileName = MakeFileNameValue(
+                $ROOT_FILE_REFERENCE_NUMBER,
+                file.Name,
+                FILE_NAME_WIN32 | FILE_NAME_DOS83,
+                kBaseTime,
+                Align(file.Size, kBytesPerCluster),
+                file.Size,
+                kSystemFileAttributes | (file.bDirectory ? kDupFileNameIndexPresent : 0),
+                0);
+            entries.push_back(MakeFileNameIndexEntry(
+                MakeFileReference(file.FRN, sequence(file.FRN)), fileName.data(), fileName.size()));
+        }
+
+        FileRecord root(kRootFRN, sequence(kRootFRN), FILE_RECORD_SEGMENT_IN_USE | FILE_FILE_NAME_INDEX_PRESENT);
+        addHeader(root, files[kRootFRN]);
+
+        if (auto hr = WriteIndex(root, L"$I30", entries, $FILE_NAME, COLLATION_FILE_NAME); FAILED(hr))
+            return hr;
+
+        if (auto hr = WriteRecord(kRootFRN, root); FAILED(hr))
+            return hr;
+    }
+
+    const auto bitmapLcn = Allocate(ullBitmapClusters);
+    const auto ullTotalClusters = m_nextLcn;
+    const auto ullBitmapSize = Align((ullTotalClusters + 7) / 8, 8);
+    files[6].Size = ullBitmapSize;
+
+    for (const auto& file : files)
+    {
+        if (file.FRN == kRootFRN || file.FRN == kExtendFRN)
+            continue;
+
+        FileRecord record(file.FRN, sequence(file.FRN), FILE_RECORD_SEGMENT_IN_USE);
+        addHeader(record, file);
+
+        switch (file.FRN)
+        {
+            case 0:
+                record.AddNonResident($DATA, L"", nonResident(m_mftLcn, ullMftSize));
+                record.AddNonResident($BITMAP, L"", nonResident(m_mftBitmapLcn, ullMftBitmapSize));
+                break;
+            case 1:
+                record.AddNonResident($DATA, L"", nonResident(kMftMirrorLcn, file.Size));
+                break;
+            case 2:
+                record.AddNonResident($DATA, L"", nonResident(m_logFileLcn, file.Size));
+                break;
+            case 3: {
+                constexpr auto volumeName = L"ORC-SYNTHETIC"sv;
+                const VOLUME_INFORMATION information {0LL, 3, 1, 0};
+                record.AddResident($VOLUME_NAME, L"", volumeName.data(), volumeName.size() * sizeof(WCHAR));
+                record.AddResident($VOLUME_INFORMATION, L"", &information, sizeof(information));
+                record.AddResident($DATA, L"", nullptr, 0);
+                break;
+            }
+            case 4:
+                record.AddNonResident($DATA, L"", nonResident(m_attrDefLcn, file.Size));
+                break;
+            case 6:
+                record.AddNonResident($DATA, L"", nonResident(bitmapLcn, file.Size));
+                break;
+            case 7:
+                record.AddNonResident($DATA, L"", nonResident(kBootLcn, file.Size));
+                break;
+            case 8: {
+                NonResidentValue bad;
+                bad.Runs = {{kSparseLcn, ullTotalClusters}};
+                bad.AllocatedLength = bad.FileSize = bad.ValidDataLength = ullTotalClusters * kBytesPerCluster;
+                record.AddResident($DATA, L"", nullptr, 0);
+                record.AddNonResident($DATA, L"$Bad", bad);
+                break;
+            }
+            case 9: {
+                record.AddNonResident($DATA, L"$SDS", nonResident(m_sdsLcn, m_ullSdsSize));
+
+                SECURITY_DESCRIPTOR_HEADER header {
+                    SecurityDescriptorHash(m_securityDescriptor),
+                    kSecurityId,
+                    0LL,
+                    static_cast<ULONG>(sizeof(SECURITY_DESCRIPTOR_HEADER) + m_securityDescriptor.size())};
+
+                const SECURITY_HASH_KEY hashKey {header.Hash, header.SecurityId};
+                std::vector<std::vector<uint8_t>> sdh {
+                    MakeViewIndexEntry(&hashKey, sizeof(hashKey), &header, sizeof(header))};
+                // $SDH entries end with "II" padding
+                std::memcpy(sdh[0].data() + sdh[0].size() - 4, "I\0I\0", 4);
+                if (auto hr = WriteIndex(record, L"$SDH", sdh, 0, COLLATION_NTOFS_SECURITY_HASH); FAILED(hr))
+                    return hr;
+
+                std::vector<std::vector<uint8_t>> sii {
+                    MakeViewIndexEntry(&header.SecurityId, sizeof(header.SecurityId), &header, sizeof(header))};
+                if (auto hr = WriteIndex(record, L"$SII", sii, 0, COLLATION_NTOFS_ULONG); FAILED(hr))
+                    return hr;
+
+                std::vector<uint8_t> sds(ToClusters(m_ullSdsSize) * kBytesPerCluster, 0);
+                for (const auto offset : {0ULL, kSdsMirrorOffset})
+                {
+                    std::memcpy(sds.data() + offset, &header, sizeof(header));
+                    std::memcpy(
+                        sds.data() + offset + sizeof(header), m_securityDescriptor.data(), m_securityDescriptor.size());
+                }
+                if (auto hr = WriteClusters(m_sdsLcn, sds.data(), sds.size()); FAILED(hr))
+                    return hr;
+                break;
+            }
+            case 10:
+                record.AddNonResident($DATA, L"", nonResident(m_upcaseLcn, file.Size));
+                break;
+        }
+
+        if (auto hr = WriteRecord(file.FRN, record); FAILED(hr))
+            return hr;
+    }
+
+    // Records which are not used: reserved system records and the tail of the $MFT
+    const auto ullUsedRecords = m_ullFirstExtensionFRN
+        + (m_options.AttributeListEvery
+               ? (m_options.FileCount + m_options.AttributeListEvery - 1) / m_options.AttributeListEvery
+               : 0)
+            * m_ullExtensionsPerFile;
+
+    for (ULONGLONG ullFRN = 12; ullFRN < m_ullRecordCount; ullFRN++)
+    {
+        if (ullFRN == kFirstUserFRN)
+            ullFRN = ullUsedRecords;
+        if (ullFRN >= m_ullRecordCount)
+            break;
+        if (ullFRN == kUsnJournalFRN && m_options.UsnJournalSize)
+            continue;
+
+        FileRecord record(ullFRN, ullFRN < kReservedFRNs ? static_cast<USHORT>(ullFRN) : 0, 0);
+        if (auto hr = WriteRecord(ullFRN, record); FAILED(hr))
+            return hr;
+    }
+
+    if (auto hr = WriteClusters(kMftMirrorLcn, m_mftMirror.data(), m_mftMirror.size()); FAILED(hr))
+        return hr;
+
+    // $MFT:$BITMAP, system records are marked used
+    {
+        std::vector<uint8_t> bitmap(ullMftBitmapSize, 0);
+        const auto setUsed = [&bitmap](ULONGLONG ullFirst, ULONGLONG ullLast) {
+            for (auto i = ullFirst; i < ullLast; i++)
+                bitmap[i / 8] |= 1 << (i % 8);
+        };
+
+        setUsed(0, kReservedFRNs);
+        if (m_options.UsnJournalSize)
+            setUsed(kUsnJournalFRN, kUsnJournalFRN + 1);
+        setUsed(kFirstUserFRN, ullUsedRecords);
+
+        if (auto hr = WriteClusters(m_mftBitmapLcn, bitmap.data(), bitmap.size()); FAILED(hr))
+            return hr;
+    }
+
+    // $Bitmap, every cluster up to the end of the volume is allocated
+    {
+        std::vector<uint8_t> bitmap(ullBitmapSize, 0);
+        std::fill(std::begin(bitmap), std::begin(bitmap) + ullTotalClusters / 8, 0xFF);
+        for (auto i = ullTotalClusters / 8 * 8; i < ullTotalClusters; i++)
+            bitmap[i / 8] |= 1 << (i % 8);
+
+        if (auto hr = WriteClusters(bitmapLcn, bitmap.data(), bitmap.size()); FAILED(hr))
+            return hr;
+    }
+
+    {
+        const std::vector<uint8_t> logFile(kLogFileSize, 0xFF);
+        if (auto hr = WriteClusters(m_logFileLcn, logFile.data(), logFile.size()); FAILED(hr))
+            return hr;
+    }
+
+    {
+        std::vector<ATTRIBUTE_DEFINITION_COLUMNS> definitions(kAttrDefSize / sizeof(ATTRIBUTE_DEFINITION_COLUMNS));
+        for (size_t i = 0; i < std::size(kAttributeDefinitions); i++)
+        {
+            const auto& definition = kAttributeDefinitions[i];
+            std::copy(std::cbegin(definition.Name), std::cend(definition.Name), definitions[i].AttributeName);
+            definitions[i].AttributeTypeCode = definition.TypeCode;
+            definitions[i].CollationRule = definition.CollationRule;
+            definitions[i].Flags = definition.Flags;
+            definitions[i].MinimumLength = definition.MinimumLength;
+            definitions[i].MaximumLength = definition.MaximumLength;
+        }
+
+        if (auto hr = WriteClusters(m_attrDefLcn, definitions.data(), kAttrDefSize); FAILED(hr))
+            return hr;
+    }
+
+    if (auto hr = WriteClusters(m_upcaseLcn, m_upcase.data(), kUpcaseSize); FAILED(hr))
+        return hr;
+
+    m_statistics.Clusters = ullTotalClusters;
+    return WriteBootSectors(ullTotalClusters);
+}
+
+HRESULT NtfsVolume::WriteBootSectors(ULONGLONG ullTotalClusters)
+{
+    constexpr ULONG kSectorsPerCluster = kBytesPerCluster / kBytesPerSector;
+
+    // One spare cluster after the last one, the backup boot sector is the last sector of the partition
+    const auto ullPartitionSectors = (ullTotalClusters + 1) * kSectorsPerCluster;
+
+    PackedBootSector boot {};
+    const UCHAR jump[] = {0xEB, 0x52, 0x90};
+    std::memcpy(boot.Jump, jump, sizeof(jump));
+    std::memcpy(boot.Oem, g_NTFSSignature, sizeof(boot.Oem));
+    boot.PackedBpb.BytesPerSector = kBytesPerSector;
+    boot.PackedBpb.SectorsPerCluster = kSectorsPerCluster;
+    boot.PackedBpb.Media = 0xF8;
+    boot.PackedBpb.SectorsPerTrack = 63;
+    boot.PackedBpb.Heads = 255;
+    boot.PackedBpb.HiddenSectors = static_cast<DWORD>(kPartitionOffset / kBytesPerSector);
+    boot.Unused[0] = 0x80;
+    boot.Unused[2] = 0x80;
+    boot.NumberSectors = ullPartitionSectors - 1;
+    boot.MftStartLcn = m_mftLcn;
+    boot.Mft2StartLcn = kMftMirrorLcn;
+    boot.ClustersPerFileRecordSegment = -10;  // 1 << 10 bytes
+    boot.DefaultClustersPerIndexAllocationBuffer = static_cast<CHAR>(kBytesPerIndexBlock / kBytesPerCluster);
+    boot.SerialNumber = static_cast<LONGLONG>(SplitMix64(m_options.Seed));
+    boot.BootStrap[sizeof(boot.BootStrap) - 2] = 0x55;
+    boot.BootStrap[sizeof(boot.BootStrap) - 1] = 0xAA;
+
+    if (auto hr = m_writer->Write(kBootLcn * kBytesPerCluster, &boot, sizeof(boot)); FAILED(hr))
+        return hr;
+
+    if (auto hr = m_writer->Write((ullPartitionSectors - 1) * kBytesPerSector, &boot, sizeof(boot)); FAILED(hr))
+        return hr;
+
+    MasterBootRecord mbr {};
+    mbr.DiskSignature = static_cast<UINT32>(boot.SerialNumber);
+    mbr.PartitionTable[0].StartTrack = 0xFE;
+    mbr.PartitionTable[0].StartSector = 0xFF;
+    mbr.PartitionTable[0].StartCylinder = 0xFF;
+    mbr.PartitionTable[0].SysFlag = 0x07;
+    mbr.PartitionTable[0].EndTrack = 0xFE;
+    mbr.PartitionTable[0].EndSector = 0xFF;
+    mbr.PartitionTable[0].EndCylinder = 0xFF;
+    mbr.PartitionTable[0].SectorAddress = static_cast<UINT32>(kPartitionOffset / kBytesPerSector);
+    mbr.PartitionTable[0].NumberOfSector = static_cast<UINT32>(ullPartitionSectors);
+    mbr.MBRSignature[0] = 0x55;
+    mbr.MBRSignature[1] = 0xAA;
+
+    return m_writer->WriteDisk(0, &mbr, sizeof(mbr));
+}
+
+HRESULT NtfsVolume::Write(const std::wstring& strPath, bool bMftOnly)
+{
+    if (m_securityDescriptor.empty())
+    {
+        const auto hr = HRESULT_FROM_WIN32(GetLastError());
+        Log::Error(L"Failed to build security descriptor [{}]", SystemError(hr));
+        return hr;
+    }
+
+    m_statistics = {};
+    m_mftMirror.clear();
+    PlanLayout();
+
+    if (bMftOnly)
+    {
+        m_writer = std::make_unique<ImageWriter>(0, m_mftLcn * kBytesPerCluster, m_ullRecordCount * kBytesPerFRS);
+    }
+    else
+    {
+        m_writer = std::make_unique<ImageWriter>(kPartitionOffset, 0, ImageWriter::kWholeVolume);
+    }
+
+    if (auto hr = m_writer->Open(strPath); FAILED(hr))
+        return hr;
+
+    Log::Info(
+        L"Writing {} records: {} directories, {} files (branching: {})",
+        m_ullRecordCount,
+        m_statistics.Directories,
+        m_options.FileCount,
+        m_ullBranching);
+
+    if (auto hr = WriteDirectories(); FAILED(hr))
+        return hr;
+
+    if (auto hr = WriteFiles(); FAILED(hr))
+        return hr;
+
+    if (m_options.UsnJournalSize)
+    {
+        if (auto hr = WriteUsnJournal(); FAILED(hr))
+            return hr;
+    }
+
+    if (auto hr = WriteSystemFiles(); FAILED(hr))
+        return hr;
+
+    const auto ullDiskSize =
+        Align(kPartitionOffset + (m_statistics.Clusters + 1) * kBytesPerCluster, kPartitionOffset);
+    auto hr = m_writer->Close(ullDiskSize);
+    m_writer.reset();
+    return hr;
+}
+
+HRESULT NtfsVolume::WriteImage(const std::wstring& strPath)
+{
+    return Write(strPath, false);
+}
+
+HRESULT NtfsVolume::WriteMFT(const std::wstring& strPath)
+{
+    return Write(strPath, true);
+}
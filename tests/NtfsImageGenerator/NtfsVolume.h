@@ -0,0 +1,161 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "NtfsIndex.h"
+#include "NtfsRecord.h"
+
+#include "Filesystem/Ntfs/Compression/WofAlgorithm.h"
+
+namespace Orc::ImageGenerator {
+
+class ImageWriter;
+
+// Densities are "one file in N", 0 disables the feature
+struct VolumeOptions
+{
+    ULONGLONG FileCount = 100000;
+    ULONG Depth = 2;
+    ULONG FilesPerDirectory = 256;
+    ULONG AttributeListEvery = 1000;
+    ULONG AlternateStreamEvery = 20;
+    ULONG ExtendedAttributesEvery = 50;
+    ULONG NonResidentEvery = 16;
+    ULONG Lznt1Every = 500;
+    ULONG WofEvery = 500;
+    ULONGLONG UsnJournalSize = 32 * 1024 * 1024;
+    ULONG Seed = 0;
+};
+
+struct VolumeStatistics
+{
+    ULONGLONG Records = 0LL;
+    ULONGLONG Directories = 0LL;
+    ULONGLONG Files = 0LL;
+    ULONGLONG ExtensionRecords = 0LL;
+    ULONGLONG IndexBlocks = 0LL;
+    ULONGLONG UsnRecords = 0LL;
+    ULONGLONG Clusters = 0LL;
+};
+
+//
+// NtfsVolume: lays out and writes a synthetic NTFS volume.
+//
+// System files come first in the MFT, then directories in breadth first order, then files grouped by their leaf
+// directory and finally the extension records of the files with an $ATTRIBUTE_LIST. Clusters are allocated as the
+// content is produced, $Bitmap and the boot sectors are written last once the volume size is known.
+//
+class NtfsVolume
+{
+public:
+    enum class DataKind
+    {
+        Resident,
+        NonResident,
+        Lznt1,
+        Wof
+    };
+
+    struct FileSpec
+    {
+        ULONGLONG Index;
+        ULONGLONG FRN;
+        ULONGLONG ParentReference;
+        std::wstring Name;
+        DataKind Kind;
+        Ntfs::WofAlgorithm WofAlgorithm;
+        ULONGLONG Size;
+        bool bAttributeList;
+        bool bAlternateStream;
+        bool bExtendedAttributes;
+        LONGLONG Time;
+    };
+
+    NtfsVolume(const VolumeOptions& options);
+    ~NtfsVolume();
+
+    // Whole MBR disk image, the volume being its only partition
+    HRESULT WriteImage(const std::wstring& strPath);
+
+    // $MFT content only, as an offline MFT
+    HRESULT WriteMFT(const std::wstring& strPath);
+
+    const VolumeStatistics& Statistics() const { return m_statistics; }
+
+private:
+    struct SystemFile;
+
+    HRESULT Write(const std::wstring& strPath, bool bMftOnly);
+
+    void PlanLayout();
+    LCN Allocate(ULONGLONG ullClusters);
+
+    FileSpec DescribeFile(ULONGLONG ullIndex) const;
+    std::vector<uint8_t> MakeFileName(const FileSpec& spec) const;
+    std::vector<uint8_t> MakeDirectoryFileName(ULONG ulLevel, ULONGLONG ullIndex) const;
+    ULONGLONG DirectoryReference(ULONG ulLevel, ULONGLONG ullIndex) const;
+
+    // $I30 entries of a directory, the root is level 0
+    std::vector<std::vector<uint8_t>> DirectoryEntries(ULONG ulLevel, ULONGLONG ullIndex) const;
+    bool CollateFileNames(const std::vector<uint8_t>& left, const std::vector<uint8_t>& right) const;
+
+    HRESULT WriteRecord(ULONGLONG ullFRN, FileRecord& record);
+    HRESULT WriteClusters(LCN lcn, const void* pData, size_t cbData);
+    HRESULT WriteIndex(
+        FileRecord& record,
+        std::wstring_view name,
+        std::vector<std::vector<uint8_t>>& entries,
+        ATTRIBUTE_TYPE_CODE indexedAttributeType,
+        ULONG collationRule);
+
+    HRESULT WriteDirectories();
+    HRESULT WriteFiles();
+    HRESULT WriteFile(const FileSpec& spec);
+    HRESULT WriteFileWithAttributeList(const FileSpec& spec);
+    HRESULT WriteFileData(const FileSpec& spec, FileRecord& record, std::vector<uint8_t>& wofStream);
+    HRESULT WriteUsnJournal();
+    HRESULT WriteSystemFiles();
+    HRESULT WriteBootSectors(ULONGLONG ullTotalClusters);
+
+    VolumeOptions m_options;
+    VolumeStatistics m_statistics;
+    std::unique_ptr<ImageWriter> m_writer;
+    std::vector<WCHAR> m_upcase;
+    std::vector<uint8_t> m_securityDescriptor;
+
+    // Directory tree
+    ULONGLONG m_ullBranching = 1LL;
+    std::vector<ULONGLONG> m_levelCounts;
+    std::vector<ULONGLONG> m_levelFirstFRN;
+
+    ULONGLONG m_ullFirstFileFRN = 0LL;
+    ULONGLONG m_ullFirstExtensionFRN = 0LL;
+    ULONGLONG m_ullExtensionsPerFile = 0LL;
+    ULONGLONG m_ullRecordCount = 0LL;
+
+    // Cluster layout
+    LCN m_nextLcn = 0LL;
+    LCN m_logFileLcn = 0LL;
+    LCN m_attrDefLcn = 0LL;
+    LCN m_upcaseLcn = 0LL;
+    LCN m_sdsLcn = 0LL;
+    LCN m_mftLcn = 0LL;
+    LCN m_mftBitmapLcn = 0LL;
+    LCN m_usnLcn = 0LL;
+    ULONGLONG m_ullSdsSize = 0LL;
+
+    // Records 0 to 3, copied to $MFTMirr
+    std::vector<uint8_t> m_mftMirror;
+};
+
+}  // namespace Orc::ImageGenerator
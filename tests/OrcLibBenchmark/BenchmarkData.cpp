@@ -0,0 +1,84 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+
+#include <random>
+#include <string_view>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+#include "Location.h"
+#include "VolumeReader.h"
+
+using namespace Orc;
+
+std::vector<uint8_t> Benchmark::MakeMixedData(size_t size, unsigned seed)
+{
+    constexpr size_t kSegment = 64 * 1024;
+
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data;
+    data.reserve(size + kSegment);
+
+    const std::string_view words[] = {"NTFS ", "record ", "index ", "journal ", "chunk ", "volume ", "\r\n"};
+    while (data.size() < size)
+    {
+        const auto segmentEnd = data.size() + kSegment;
+
+        while (data.size() < segmentEnd - kSegment / 2)
+        {
+            const auto word = words[rng() % std::size(words)];
+            data.insert(std::end(data), std::cbegin(word), std::cend(word));
+        }
+
+        data.insert(std::end(data), kSegment / 8, static_cast<uint8_t>(rng()));
+
+        while (data.size() < segmentEnd)
+        {
+            data.push_back(static_cast<uint8_t>(rng()));
+        }
+    }
+
+    data.resize(size);
+    return data;
+}
+
+std::optional<std::wstring> Benchmark::GetImagePath(const wchar_t* szVariable)
+{
+    DWORD nbChars = GetEnvironmentVariableW(szVariable, NULL, 0L);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    std::wstring path(nbChars, L'\0');
+    nbChars = GetEnvironmentVariableW(szVariable, path.data(), nbChars);
+    if (nbChars == 0)
+    {
+        return std::nullopt;
+    }
+
+    path.resize(nbChars);
+    return path;
+}
+
+std::shared_ptr<Location> Benchmark::MakeImageLocation(const std::wstring& image)
+{
+    auto location = std::make_shared<Location>(fmt::format(L"{},part=1", image), Location::Type::ImageFileDisk);
+
+    auto reader = location->GetReader();
+    if (!reader || FAILED(reader->LoadDiskProperties()))
+    {
+        return nullptr;
+    }
+
+    return location;
+}
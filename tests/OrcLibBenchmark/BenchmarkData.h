@@ -0,0 +1,32 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Orc {
+
+class Location;
+
+namespace Benchmark {
+
+// Text like repetitions, runs of a single byte and random bytes, so that compressors and scanners see a mix
+std::vector<uint8_t> MakeMixedData(size_t size, unsigned seed);
+
+// Image path from an environment variable, if set
+std::optional<std::wstring> GetImagePath(const wchar_t* szVariable);
+
+// Location of the first partition of a raw disk image (or a fixed VHD)
+std::shared_ptr<Location> MakeImageLocation(const std::wstring& image);
+
+}  // namespace Benchmark
+}  // namespace Orc
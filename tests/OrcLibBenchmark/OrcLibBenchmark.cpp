@@ -0,0 +1,37 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "EmbeddedResource.h"
+#include "Robustness.h"
+
+//
+// OrcLibBenchmark: throughput of OrcLib's hot paths, reported as records/s and bytes/s.
+//
+// Stream benchmarks run over synthesized buffers. Filesystem walks run over the images designated by
+// %ORC_BENCHMARK_NTFS_IMAGE% and %ORC_BENCHMARK_FAT_IMAGE% (see tests\New-BenchmarkImages.ps1), they are skipped
+// when the variables are not set.
+//
+// Use '--benchmark_out=<file> --benchmark_out_format=json' to keep the results for comparison over time.
+//
+int main(int argc, char** argv)
+{
+    Orc::EmbeddedResource::SetDefaultHINSTANCE(GetModuleHandleW(NULL));
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+
+    Orc::Robustness::Terminate();
+    return 0;
+}
@@ -0,0 +1,173 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+
+#include "Filesystem/Ntfs/Compression/Engine/Lznt1/Lznt1Decompressor.h"
+#include "Filesystem/Ntfs/Compression/Engine/Nt/NtApi.h"
+#include "Filesystem/Ntfs/Compression/Engine/Wimlib/WimlibApi.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kDataSize = 16 * 1024 * 1024;
+
+struct CompressedChunk
+{
+    std::vector<uint8_t> Data;
+    size_t UncompressedSize;
+};
+
+// NTFS compresses by units of 16 clusters: 64KB with 4KB clusters
+std::vector<CompressedChunk> CompressLznt1(const std::vector<uint8_t>& data)
+{
+    constexpr size_t kUnitSize = 64 * 1024;
+    constexpr USHORT format = COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_STANDARD;
+
+    std::error_code ec;
+    ULONG workspaceSize = 0L, fragmentWorkspaceSize = 0L;
+    RtlGetCompressionWorkSpaceSize(format, &workspaceSize, &fragmentWorkspaceSize, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::vector<uint8_t> workspace(workspaceSize);
+    std::vector<CompressedChunk> units;
+
+    for (size_t offset = 0; offset < data.size(); offset += kUnitSize)
+    {
+        CompressedChunk unit {std::vector<uint8_t>(kUnitSize + kUnitSize / 8), kUnitSize};
+
+        ULONG compressedSize = 0L;
+        RtlCompressBuffer(
+            format,
+            const_cast<PUCHAR>(data.data() + offset),
+            static_cast<ULONG>(kUnitSize),
+            unit.Data.data(),
+            static_cast<ULONG>(unit.Data.size()),
+            4096,
+            &compressedSize,
+            workspace.data(),
+            ec);
+        if (ec)
+        {
+            return {};
+        }
+
+        unit.Data.resize(compressedSize);
+        units.push_back(std::move(unit));
+    }
+
+    return units;
+}
+
+// WOF compresses each chunk independently, chunks which do not shrink are stored as is
+std::vector<CompressedChunk>
+CompressWof(const std::vector<uint8_t>& data, wimlib_compression_type type, size_t chunkSize)
+{
+    std::error_code ec;
+    wimlib_compressor* compressor = nullptr;
+    wimlib_create_compressor(type, chunkSize, 0, &compressor, ec);
+    if (ec)
+    {
+        return {};
+    }
+
+    std::vector<CompressedChunk> chunks;
+    for (size_t offset = 0; offset < data.size(); offset += chunkSize)
+    {
+        CompressedChunk chunk {std::vector<uint8_t>(chunkSize), chunkSize};
+
+        const auto compressedSize =
+            wimlib_compress(data.data() + offset, chunkSize, chunk.Data.data(), chunk.Data.size() - 1, compressor, ec);
+        if (ec || compressedSize == 0)
+        {
+            ec.clear();
+            continue;
+        }
+
+        chunk.Data.resize(compressedSize);
+        chunks.push_back(std::move(chunk));
+    }
+
+    wimlib_free_compressor(compressor, ec);
+    return chunks;
+}
+
+void Lznt1Decompression(benchmark::State& state)
+{
+    static const auto units = CompressLznt1(Benchmark::MakeMixedData(kDataSize, 2));
+    if (units.empty())
+    {
+        state.SkipWithError("Failed to compress LZNT1 units");
+        return;
+    }
+
+    std::vector<uint8_t> output(64 * 1024);
+    size_t cbDecompressed = 0;
+
+    for (auto _ : state)
+    {
+        for (const auto& unit : units)
+        {
+            std::error_code ec;
+            cbDecompressed += Lznt1Decompress(unit.Data, output, ec);
+            benchmark::DoNotOptimize(output.data());
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(cbDecompressed));
+    state.counters["units"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * units.size()), benchmark::Counter::kIsRate);
+}
+
+void WofDecompression(benchmark::State& state, wimlib_compression_type type, size_t chunkSize)
+{
+    const auto chunks = CompressWof(Benchmark::MakeMixedData(kDataSize, 3), type, chunkSize);
+    if (chunks.empty())
+    {
+        state.SkipWithError("Failed to compress WOF chunks");
+        return;
+    }
+
+    std::error_code ec;
+    wimlib_decompressor* decompressor = nullptr;
+    wimlib_create_decompressor(type, chunkSize, &decompressor, ec);
+    if (ec)
+    {
+        state.SkipWithError("Failed to create wimlib decompressor");
+        return;
+    }
+
+    std::vector<uint8_t> output(chunkSize);
+    for (auto _ : state)
+    {
+        for (const auto& chunk : chunks)
+        {
+            wimlib_decompress(
+                chunk.Data.data(), chunk.Data.size(), output.data(), chunk.UncompressedSize, decompressor, ec);
+            benchmark::DoNotOptimize(output.data());
+        }
+    }
+
+    wimlib_free_decompressor(decompressor, ec);
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * chunks.size() * chunkSize));
+    state.counters["chunks"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * chunks.size()), benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(Lznt1Decompression)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(WofDecompression, Xpress4K, WIMLIB_COMPRESSION_TYPE_XPRESS, 4096)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(WofDecompression, Xpress16K, WIMLIB_COMPRESSION_TYPE_XPRESS, 16384)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(WofDecompression, Lzx, WIMLIB_COMPRESSION_TYPE_LZX, 32768)->Unit(benchmark::kMillisecond);
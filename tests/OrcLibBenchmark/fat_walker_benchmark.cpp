@@ -0,0 +1,61 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+#include "FatWalker.h"
+#include "Location.h"
+#include "VolumeReader.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto kFatImageEnv = L"ORC_BENCHMARK_FAT_IMAGE";
+
+void FatWalk(benchmark::State& state)
+{
+    const auto image = Benchmark::GetImagePath(kFatImageEnv);
+    if (!image)
+    {
+        state.SkipWithError("%ORC_BENCHMARK_FAT_IMAGE% is not set");
+        return;
+    }
+
+    const auto location = Benchmark::MakeImageLocation(*image);
+    if (!location)
+    {
+        state.SkipWithError("Failed to open FAT image");
+        return;
+    }
+
+    ULONGLONG ullEntries = 0LL;
+    for (auto _ : state)
+    {
+        FatWalker::Callbacks callbacks;
+        callbacks.m_FileEntryCall = [&ullEntries](
+                                        const std::shared_ptr<VolumeReader>& volreader,
+                                        const WCHAR* szFullName,
+                                        const std::shared_ptr<FatFileEntry>& fileEntry) { ullEntries++; };
+
+        FatWalker walker;
+        if (FAILED(walker.Init(location, false)) || FAILED(walker.Process(callbacks)))
+        {
+            state.SkipWithError("Failed to walk FAT image");
+            return;
+        }
+    }
+
+    // Each directory entry is 32 bytes, long file names take more: this is a lower bound
+    state.SetBytesProcessed(static_cast<int64_t>(ullEntries * 32));
+    state.counters["records"] = benchmark::Counter(static_cast<double>(ullEntries), benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(FatWalk)->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,54 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+#include "CryptoHashStream.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kDataSize = 64 * 1024 * 1024;
+constexpr size_t kWriteSize = 1024 * 1024;
+
+void HashStream(benchmark::State& state, CryptoHashStream::Algorithm algorithms)
+{
+    static const auto data = Benchmark::MakeMixedData(kDataSize, 1);
+
+    for (auto _ : state)
+    {
+        auto stream = std::make_shared<CryptoHashStream>();
+        if (FAILED(stream->OpenToWrite(algorithms, nullptr)))
+        {
+            state.SkipWithError("Failed to open hash stream");
+            return;
+        }
+
+        for (size_t offset = 0; offset < data.size(); offset += kWriteSize)
+        {
+            ULONGLONG ullWritten = 0LL;
+            stream->Write(const_cast<uint8_t*>(data.data() + offset), kWriteSize, &ullWritten);
+        }
+
+        stream->Close();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(HashStream, MD5, CryptoHashStream::Algorithm::MD5)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(HashStream, SHA1, CryptoHashStream::Algorithm::SHA1)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(HashStream, SHA256, CryptoHashStream::Algorithm::SHA256)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(
+    HashStream,
+    All,
+    CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1 | CryptoHashStream::Algorithm::SHA256)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,110 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+#include "Location.h"
+#include "MFTWalker.h"
+#include "VolumeReader.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr auto kNtfsImageEnv = L"ORC_BENCHMARK_NTFS_IMAGE";
+
+enum class WalkMode
+{
+    Records,
+    I30,
+    Visitor  // same as Records, with a visitor instead of callbacks
+};
+
+struct RecordCounter
+{
+    ULONGLONG& ullRecords;
+    ULONGLONG& ullBytesPerFRS;
+
+    void OnElement(VolumeReader& volreader, MFTRecord& record)
+    {
+        ullBytesPerFRS = volreader.GetBytesPerFRS();
+        ullRecords++;
+    }
+};
+
+void MFTWalk(benchmark::State& state, WalkMode mode)
+{
+    const auto image = Benchmark::GetImagePath(kNtfsImageEnv);
+    if (!image)
+    {
+        state.SkipWithError("%ORC_BENCHMARK_NTFS_IMAGE% is not set");
+        return;
+    }
+
+    const auto location = Benchmark::MakeImageLocation(*image);
+    if (!location)
+    {
+        state.SkipWithError("Failed to open NTFS image");
+        return;
+    }
+
+    const auto dwWorkers = static_cast<DWORD>(state.range(0));
+    ULONGLONG ullRecords = 0LL, ullEntries = 0LL, ullBytesPerFRS = 0LL;
+
+    for (auto _ : state)
+    {
+        MFTWalker walker;
+        MFTWalker::Callbacks callbacks;
+
+        callbacks.ElementCallback = [&ullRecords, &ullBytesPerFRS](
+                                        const std::shared_ptr<VolumeReader>& volreader, MFTRecord* pElt) {
+            ullBytesPerFRS = volreader->GetBytesPerFRS();
+            ullRecords++;
+        };
+
+        if (mode == WalkMode::I30)
+        {
+            callbacks.I30Callback = [&ullEntries](
+                                        const std::shared_ptr<VolumeReader>& volreader,
+                                        MFTRecord* pElt,
+                                        const PINDEX_ENTRY pEntry,
+                                        const PFILE_NAME pFileName,
+                                        bool bCarvedEntry) { ullEntries++; };
+        }
+
+        walker.SetPipeline(dwWorkers, false);
+
+        if (FAILED(walker.Initialize(location, ResurrectRecordsMode::kNo)))
+        {
+            state.SkipWithError("Failed to walk NTFS image");
+            return;
+        }
+
+        RecordCounter counter {ullRecords, ullBytesPerFRS};
+        if (FAILED(mode == WalkMode::Visitor ? walker.Walk(counter) : walker.Walk(callbacks)))
+        {
+            state.SkipWithError("Failed to walk NTFS image");
+            return;
+        }
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(ullRecords * ullBytesPerFRS));
+    state.counters["records"] = benchmark::Counter(static_cast<double>(ullRecords), benchmark::Counter::kIsRate);
+    if (mode == WalkMode::I30)
+    {
+        state.counters["i30_entries"] =
+            benchmark::Counter(static_cast<double>(ullEntries), benchmark::Counter::kIsRate);
+    }
+}
+
+}  // namespace
+
+// Argument: number of parsing workers, 0 parses records on the reading thread
+BENCHMARK_CAPTURE(MFTWalk, Records, WalkMode::Records)->Arg(0)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(MFTWalk, I30, WalkMode::I30)->Arg(0)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(MFTWalk, Visitor, WalkMode::Visitor)->Arg(0)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
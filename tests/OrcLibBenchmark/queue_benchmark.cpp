@@ -0,0 +1,149 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include <thread>
+
+#include <agents.h>
+
+#include "BlockingQueue.h"
+#include "RingQueue.h"
+
+using namespace Orc;
+
+namespace {
+
+// Items handed over per iteration from the producers to a single consumer, like records from a walker to a worker
+constexpr size_t kItems = 1024 * 1024;
+constexpr size_t kCapacity = 4096;
+constexpr size_t kBatch = 64;
+
+template <typename Produce, typename Consume>
+void RunProducers(benchmark::State& state, size_t producers, Produce produce, Consume consume)
+{
+    for (auto _ : state)
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < producers; ++i)
+            threads.emplace_back([&produce, count = kItems / producers]() { produce(count); });
+
+        consume(kItems - kItems % producers);
+
+        for (auto& thread : threads)
+            thread.join();
+    }
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * kItems));
+}
+
+void UnboundedBuffer(benchmark::State& state)
+{
+    Concurrency::unbounded_buffer<size_t> buffer;
+
+    RunProducers(
+        state,
+        static_cast<size_t>(state.range(0)),
+        [&](size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                Concurrency::send(buffer, i);
+        },
+        [&](size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                benchmark::DoNotOptimize(Concurrency::receive(buffer));
+        });
+}
+
+void Blocking(benchmark::State& state)
+{
+    BlockingQueue<size_t> queue(kCapacity);
+
+    RunProducers(
+        state,
+        static_cast<size_t>(state.range(0)),
+        [&](size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                queue.Push(size_t(i));
+        },
+        [&](size_t count) {
+            for (size_t i = 0; i < count; ++i)
+                benchmark::DoNotOptimize(queue.Pop());
+        });
+}
+
+template <typename Queue>
+void Ring(benchmark::State& state, size_t producers, size_t batch)
+{
+    Queue queue(kCapacity);
+    EventCount notEmpty;
+    EventCount notFull;
+
+    RunProducers(
+        state,
+        producers,
+        [&](size_t count) {
+            std::vector<size_t> items(batch);
+            for (size_t i = 0; i < count; i += batch)
+            {
+                const auto n = std::min(batch, count - i);
+                for (size_t pushed = 0; pushed < n;)
+                {
+                    const auto queued = queue.TryPushBatch(items.data() + pushed, n - pushed);
+                    if (queued == 0)
+                    {
+                        const auto key = notFull.PrepareWait();
+                        if (queue.TryPushBatch(items.data() + pushed, 1) == 0)
+                        {
+                            notFull.Wait(key);
+                            continue;
+                        }
+                        notFull.CancelWait();
+                        pushed++;
+                    }
+                    pushed += queued;
+                }
+                notEmpty.NotifyOne();
+            }
+        },
+        [&](size_t count) {
+            std::vector<size_t> items(batch);
+            for (size_t popped = 0; popped < count;)
+            {
+                const auto dequeued = queue.TryPopBatch(items.data(), items.size());
+                if (dequeued == 0)
+                {
+                    const auto key = notEmpty.PrepareWait();
+                    if (queue.Empty())
+                        notEmpty.Wait(key);
+                    else
+                        notEmpty.CancelWait();
+                    continue;
+                }
+
+                benchmark::DoNotOptimize(items.data());
+                popped += dequeued;
+                notFull.NotifyAll();
+            }
+        });
+}
+
+void Spsc(benchmark::State& state)
+{
+    Ring<SpscRingQueue<size_t>>(state, 1, static_cast<size_t>(state.range(0)));
+}
+
+void Mpsc(benchmark::State& state)
+{
+    Ring<MpscRingQueue<size_t>>(state, static_cast<size_t>(state.range(0)), static_cast<size_t>(state.range(1)));
+}
+
+}  // namespace
+
+BENCHMARK(UnboundedBuffer)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(Blocking)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(Spsc)->Arg(1)->Arg(kBatch)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(Mpsc)->Args({1, 1})->Args({4, 1})->Args({4, kBatch})->Unit(benchmark::kMillisecond)->UseRealTime();
@@ -0,0 +1,119 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include <functional>
+
+#include "TableOutputWriter.h"
+#include "DevNullStream.h"
+
+using namespace Orc;
+using namespace Orc::TableOutput;
+
+namespace {
+
+// Discards the output but keeps its size
+class CountingStream : public DevNullStream
+{
+public:
+    STDMETHOD(Write_)
+    (__in_bcount(cbBytesToWrite) const PVOID pWriteBuffer,
+     __in ULONGLONG cbBytesToWrite,
+     __out_opt PULONGLONG pcbBytesWritten) override
+    {
+        m_ullWritten += cbBytesToWrite;
+        if (pcbBytesWritten)
+            *pcbBytesWritten = cbBytesToWrite;
+        return S_OK;
+    }
+
+    ULONGLONG Written() const { return m_ullWritten; }
+
+private:
+    ULONGLONG m_ullWritten = 0LL;
+};
+
+// Columns of a typical NTFSInfo row
+Schema MakeSchema()
+{
+    return Schema {
+        {ColumnType::UInt64Type, L"FRN"},
+        {ColumnType::UInt64Type, L"ParentFRN"},
+        {ColumnType::UTF16Type, L"FullName"},
+        {ColumnType::UInt64Type, L"SizeInBytes"},
+        {ColumnType::UInt32Type, L"Attributes"},
+        {ColumnType::TimeStampType, L"CreationDate"},
+        {ColumnType::TimeStampType, L"LastModificationDate"},
+        {ColumnType::BinaryType, L"SHA1"}};
+}
+
+void WriteTable(benchmark::State& state, const std::function<std::shared_ptr<IStreamWriter>()>& factory)
+{
+    const auto rowCount = static_cast<ULONGLONG>(state.range(0));
+    const BYTE sha1[20] = {0x80, 0x07, 0x18, 0x6A, 0xB2, 0xB7, 0x1C, 0x48, 0x2E, 0xA2,
+                           0xC4, 0xBC, 0x43, 0x04, 0xB2, 0x4B, 0xDC, 0x68, 0x34, 0xEC};
+
+    ULONGLONG ullWritten = 0LL;
+    for (auto _ : state)
+    {
+        auto writer = factory();
+        if (!writer)
+        {
+            state.SkipWithError("Table format is not available");
+            return;
+        }
+
+        auto stream = std::make_shared<CountingStream>();
+        if (FAILED(writer->WriteToStream(stream, false)) || FAILED(writer->SetSchema(MakeSchema())))
+        {
+            state.SkipWithError("Failed to initialize table writer");
+            return;
+        }
+
+        for (ULONGLONG i = 0; i < rowCount; i++)
+        {
+            writer->WriteInteger(0x0001000000000000ULL | i);
+            writer->WriteInteger(0x0005000000000005ULL);
+            writer->WriteFormated(L"\\Windows\\System32\\DriverStore\\FileRepository\\file_{:08X}.dll", i);
+            writer->WriteFileSize(i * 512);
+            writer->WriteInteger(static_cast<DWORD>(FILE_ATTRIBUTE_ARCHIVE));
+            writer->WriteFileTime(static_cast<LONGLONG>(0x01D5A0B0C0D0E0F0LL + i));
+            writer->WriteFileTime(static_cast<LONGLONG>(0x01D5A0B0C0D0E0F0LL + i * 2));
+            writer->WriteBytes(sha1, sizeof(sha1));
+            writer->WriteEndOfLine();
+        }
+
+        writer->Close();
+        ullWritten += stream->Written();
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(ullWritten));
+    state.counters["records"] =
+        benchmark::Counter(static_cast<double>(state.iterations() * rowCount), benchmark::Counter::kIsRate);
+}
+
+std::shared_ptr<IStreamWriter> MakeCSVWriter()
+{
+    return GetCSVWriter(std::make_unique<CSV::Options>());
+}
+
+std::shared_ptr<IStreamWriter> MakeParquetWriter()
+{
+    return GetParquetWriter(std::make_unique<Parquet::Options>());
+}
+
+std::shared_ptr<IStreamWriter> MakeApacheOrcWriter()
+{
+    return GetApacheOrcWriter(std::make_unique<ApacheOrc::Options>());
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(WriteTable, CSV, MakeCSVWriter)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(WriteTable, Parquet, MakeParquetWriter)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(WriteTable, ApacheOrc, MakeApacheOrcWriter)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
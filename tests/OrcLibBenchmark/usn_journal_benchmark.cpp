@@ -0,0 +1,106 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "USNJournalWalkerOffline.h"
+
+#include <random>
+
+#include <fmt/format.h>
+#include <fmt/xchar.h>
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kPageSize = 4096;
+
+// Synthesize a $J stream: version 2 records packed in pages, the end of each page left as a gap of zeros
+std::vector<uint8_t> MakeJournal(size_t recordCount)
+{
+    std::mt19937 rng(5);
+    std::vector<uint8_t> journal;
+    journal.reserve(recordCount * 128);
+
+    for (size_t i = 0; i < recordCount; i++)
+    {
+        const auto name = fmt::format(L"file_{:08X}{}", i, std::wstring(rng() % 24, L'x'));
+        const auto cbName = name.size() * sizeof(WCHAR);
+        const auto cbRecord = (offsetof(USN_RECORD_V2, FileName) + cbName + 7) & ~size_t(7);
+
+        if (journal.size() / kPageSize != (journal.size() + cbRecord - 1) / kPageSize)
+        {
+            journal.resize((journal.size() / kPageSize + 1) * kPageSize, 0);
+        }
+
+        const auto offset = journal.size();
+        journal.resize(offset + cbRecord, 0);
+
+        auto record = reinterpret_cast<USN_RECORD_V2*>(journal.data() + offset);
+        record->RecordLength = static_cast<DWORD>(cbRecord);
+        record->MajorVersion = 2;
+        record->MinorVersion = 0;
+        record->FileReferenceNumber = 0x0001000000000000ULL | (i + 64);
+        record->ParentFileReferenceNumber = 0x0005000000000005ULL;
+        record->Usn = static_cast<USN>(offset);
+        record->TimeStamp.QuadPart = 0x01D5A0B0C0D0E0F0LL + i;
+        record->Reason = USN_REASON_DATA_EXTEND | USN_REASON_CLOSE;
+        record->FileAttributes = FILE_ATTRIBUTE_ARCHIVE;
+        record->FileNameLength = static_cast<WORD>(cbName);
+        record->FileNameOffset = static_cast<WORD>(offsetof(USN_RECORD_V2, FileName));
+        memcpy(record->FileName, name.data(), cbName);
+    }
+
+    return journal;
+}
+
+void USNJournalParse(benchmark::State& state)
+{
+    const auto recordCount = static_cast<size_t>(state.range(0));
+    auto journal = MakeJournal(recordCount);
+    const auto cbJournal = journal.size();
+
+    // FindNextUSNRecord peeks at the next DWORD before checking bounds
+    journal.resize(cbJournal + 16, 0);
+
+    size_t parsed = 0;
+    for (auto _ : state)
+    {
+        BYTE* pCurrent = journal.data();
+        BYTE* pEnd = journal.data() + cbJournal;
+        USN_RECORD* pRecord = nullptr;
+        ULONG64 adjustmentOffset = 0;
+        bool shouldReadAnotherChunk = false, shouldStop = false;
+
+        while (S_OK
+               == USNJournalWalkerOffline::FindNextUSNRecord(
+                   pCurrent, pEnd, (BYTE**)&pRecord, shouldReadAnotherChunk, adjustmentOffset, shouldStop))
+        {
+            const std::wstring_view name(
+                reinterpret_cast<const WCHAR*>(reinterpret_cast<const BYTE*>(pRecord) + pRecord->FileNameOffset),
+                pRecord->FileNameLength / sizeof(WCHAR));
+            benchmark::DoNotOptimize(name.data());
+
+            pCurrent = reinterpret_cast<BYTE*>(pRecord) + pRecord->RecordLength;
+            parsed++;
+        }
+    }
+
+    if (parsed != state.iterations() * recordCount)
+    {
+        state.SkipWithError("Unexpected number of parsed records");
+        return;
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * cbJournal));
+    state.counters["records"] = benchmark::Counter(static_cast<double>(parsed), benchmark::Counter::kIsRate);
+}
+
+}  // namespace
+
+BENCHMARK(USNJournalParse)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,90 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "BenchmarkData.h"
+#include "YaraScanner.h"
+
+using namespace Orc;
+
+namespace {
+
+constexpr size_t kDataSize = 16 * 1024 * 1024;
+
+// Plain strings, a hexadecimal pattern with jumps and a regular expression: the usual shapes of collection rules
+constexpr auto kRules = R"(
+    rule plain_strings
+    {
+        strings:
+            $a = "mimikatz" nocase
+            $b = "sekurlsa::logonpasswords" wide ascii
+            $c = "Invoke-Expression" nocase wide ascii
+        condition:
+            any of them
+    }
+
+    rule hex_pattern
+    {
+        strings:
+            $h = { 4D 5A 90 00 [4-16] 50 45 00 00 }
+        condition:
+            $h
+    }
+
+    rule regular_expression
+    {
+        strings:
+            $r = /https?:\/\/[a-z0-9.\-]{4,32}\/[a-z]{8}\.php/
+        condition:
+            $r
+    }
+)";
+
+void YaraScan(benchmark::State& state)
+{
+    YaraScanner scanner;
+    if (FAILED(scanner.Initialize()))
+    {
+        state.SkipWithError("Failed to initialize yara");
+        return;
+    }
+
+    auto config = std::make_unique<YaraConfig>();
+    if (FAILED(scanner.Configure(config)))
+    {
+        state.SkipWithError("Failed to configure yara");
+        return;
+    }
+
+    {
+        CBinaryBuffer rules;
+        rules.SetData((LPBYTE)kRules, strlen(kRules));
+        if (FAILED(scanner.AddRules(rules)))
+        {
+            state.SkipWithError("Failed to compile yara rules");
+            return;
+        }
+    }
+
+    const auto data = Benchmark::MakeMixedData(kDataSize, 4);
+    CBinaryBuffer buffer;
+    buffer.SetData(data.data(), data.size());
+
+    for (auto _ : state)
+    {
+        MatchingRuleCollection matchingRules;
+        scanner.Scan(buffer, matchingRules);
+        benchmark::DoNotOptimize(matchingRules.size());
+    }
+
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * data.size()));
+}
+
+}  // namespace
+
+BENCHMARK(YaraScan)->Unit(benchmark::kMillisecond);
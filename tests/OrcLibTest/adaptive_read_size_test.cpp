@@ -0,0 +1,77 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "AdaptiveReadSize.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(AdaptiveReadSizeTest)
+{
+private:
+    UnitTestHelper helper;
+
+    // Simulated device: fixed cost of each read, then its transfer rate
+    static void Run(AdaptiveReadSize& readSize, ULONGLONG ullCostUs, ULONGLONG ullBytesPerUs, ULONG ulReads)
+    {
+        for (ULONG i = 0; i < ulReads; i++)
+        {
+            const auto duration = std::chrono::microseconds(ullCostUs + readSize.Size() / ullBytesPerUs);
+            readSize.Record(readSize.Size(), duration);
+        }
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(AdaptiveReadSizeBounds)
+    {
+        AdaptiveReadSize readSize(4096, 1000, 3000, 10000);
+        Assert::AreEqual(4096UL, readSize.MinSize());
+        Assert::AreEqual(8192UL, readSize.MaxSize());
+        Assert::AreEqual(4096UL, readSize.Size());
+
+        AdaptiveReadSize tiny(4096, 64 * 1024, 16 * 1024, 1024);
+        Assert::AreEqual(16UL * 1024, tiny.MaxSize());
+        Assert::AreEqual(16UL * 1024, tiny.Size());
+    }
+
+    TEST_METHOD(AdaptiveReadSizeGrowsOnFastDevice)
+    {
+        // Per read cost dominates small reads: the size grows up to where doubling it no longer pays
+        AdaptiveReadSize readSize(4096, 64 * 1024, 16 * 1024, 8 * 1024 * 1024);
+        Run(readSize, 100, 1000, 200);
+
+        Assert::IsTrue(readSize.Size() >= 1024 * 1024);
+        Assert::AreEqual(0UL, readSize.Decreases());
+    }
+
+    TEST_METHOD(AdaptiveReadSizeHonorsMaxSize)
+    {
+        AdaptiveReadSize readSize(4096, 64 * 1024, 16 * 1024, 256 * 1024);
+        Run(readSize, 100, 1000, 200);
+
+        Assert::AreEqual(256UL * 1024, readSize.Size());
+    }
+
+    TEST_METHOD(AdaptiveReadSizeShrinksOnSlowReads)
+    {
+        // 10 bytes per microsecond: reads above 450 KiB take longer than the 50 ms latency limit
+        AdaptiveReadSize readSize(4096, 4 * 1024 * 1024, 16 * 1024, 8 * 1024 * 1024);
+        Run(readSize, 5000, 10, 64);
+
+        Assert::IsTrue(readSize.Size() <= 512 * 1024);
+        Assert::IsTrue(readSize.Decreases() > 0);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,149 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2020 ANSSI. All Rights Reserved.
+//
+// Author(s): fabienfl (ANSSI)
+//
+#include "stdafx.h"
+
+#include <map>
+
+#include "Archive/Appender.h"
+#include "Archive/7z/Archive7z.h"
+#include "Archive/7z/Header7z.h"
+#include "FileStream.h"
+#include "MemoryStream.h"
+#include "Temporary.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(ArchiveAppenderTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::shared_ptr<MemoryStream> MakeStream(size_t size, BYTE seed)
+    {
+        std::vector<BYTE> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<BYTE>(seed + i * 31 + (i >> 7));
+        }
+
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(S_OK == stream->OpenForReadWrite(static_cast<DWORD>(std::max<size_t>(size, 1))));
+
+        ULONGLONG ullWritten = 0LL;
+        if (size)
+        {
+            Assert::IsTrue(S_OK == stream->Write(data.data(), data.size(), &ullWritten));
+        }
+
+        Assert::IsTrue(S_OK == stream->SetFilePointer(0, FILE_BEGIN, nullptr));
+        return stream;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(Header7zRoundTrip)
+    {
+        // Hand made archive: one 'Copy' folder with two sub streams and an empty file, plain header
+        const uint8_t header[] = {0x01, 0x04, 0x06, 0x00, 0x01, 0x09, 0x05, 0x00, 0x07, 0x0B, 0x01, 0x00, 0x01,
+                                  0x01, 0x00, 0x0C, 0x05, 0x00, 0x08, 0x0D, 0x02, 0x09, 0x02, 0x00, 0x00, 0x05,
+                                  0x03, 0x0E, 0x01, 0x20, 0x11, 0x0D, 0x00, 'a',  0x00, 0x00, 0x00, 'b',  0x00,
+                                  0x00, 0x00, 'c',  0x00, 0x00, 0x00, 0x00, 0x00};
+
+        std::error_code ec;
+        auto parsed = Archive::Header7z::Parse(header, sizeof(header), ec);
+        Assert::IsFalse((bool)ec);
+        Assert::IsTrue(parsed.NumberOfFiles() == 3);
+        Assert::IsTrue(parsed.PackSize() == 5);
+
+        const auto serialized = parsed.Serialize();
+        auto reparsed = Archive::Header7z::Parse(serialized.data(), serialized.size(), ec);
+        Assert::IsFalse((bool)ec);
+        Assert::IsTrue(reparsed.Serialize() == serialized);
+
+        // Encoded headers are not supported
+        const uint8_t encoded[] = {0x17, 0x06, 0x00, 0x01, 0x09, 0x05, 0x00, 0x00};
+        Archive::Header7z::Parse(encoded, sizeof(encoded), ec);
+        Assert::IsTrue((bool)ec);
+    }
+
+    TEST_METHOD(AppenderIncrementalFlush)
+    {
+        WCHAR szTempDir[ORC_MAX_PATH];
+        Assert::IsTrue(SUCCEEDED(UtilGetTempDirPath(szTempDir, ORC_MAX_PATH)));
+
+        std::wstring outputPath;
+        Assert::IsTrue(SUCCEEDED(UtilGetUniquePath(szTempDir, L"appender_test.7z", outputPath)));
+
+        std::map<std::wstring, std::shared_ptr<MemoryStream>> expected;
+
+        {
+            std::error_code ec;
+            Archive::Archive7z archiver(Archive::Format::k7z, Archive::CompressionLevel::kFast, L"");
+            auto appender =
+                Archive::Appender<Archive::Archive7z>::Create(std::move(archiver), outputPath, 1024 * 1024, ec);
+            Assert::IsFalse((bool)ec);
+
+            // Every flush appends the new items to the archive written by the previous one
+            for (BYTE i = 0; i < 4; ++i)
+            {
+                const auto name = fmt::format(L"item{}", static_cast<int>(i));
+                const auto stream = MakeStream(i == 2 ? 0 : 100000 * (i + 1), i);
+                expected[name] = MakeStream(i == 2 ? 0 : 100000 * (i + 1), i);
+
+                appender->Add(std::make_unique<Archive::Item>(stream, name));
+                appender->Flush(ec);
+                Assert::IsFalse((bool)ec);
+            }
+
+            appender->Close(ec);
+            Assert::IsFalse((bool)ec);
+        }
+
+        std::map<std::wstring, std::shared_ptr<ByteStream>> extracted;
+        HRESULT hr = helper.ExtractArchive(
+            ArchiveFormat::SevenZip,
+            [&outputPath](std::shared_ptr<ByteStream>& stream) -> HRESULT {
+                auto fs = std::make_shared<FileStream>();
+                HRESULT hr = fs->ReadFrom(outputPath.c_str());
+                stream = fs;
+                return hr;
+            },
+            [](const std::wstring&) { return true; },
+            [](OrcArchive::ArchiveItem& item) -> std::shared_ptr<ByteStream> {
+                auto stream = std::make_shared<MemoryStream>();
+                stream->OpenForReadWrite();
+                return stream;
+            },
+            [&extracted](const OrcArchive::ArchiveItem& item) { extracted[item.NameInArchive] = item.Stream; });
+
+        DeleteFile(outputPath.c_str());
+        Assert::IsTrue(SUCCEEDED(hr));
+        Assert::IsTrue(expected.size() == extracted.size());
+
+        for (const auto& [name, stream] : expected)
+        {
+            auto it = extracted.find(name);
+            Assert::IsTrue(it != std::cend(extracted));
+
+            auto memstream = std::dynamic_pointer_cast<MemoryStream>(it->second);
+            Assert::IsTrue(memstream != nullptr);
+
+            const auto expectedBuffer = stream->GetConstBuffer();
+            const auto extractedBuffer = memstream->GetConstBuffer();
+            Assert::IsTrue(stream->GetSize() == memstream->GetSize());
+            Assert::IsTrue(!memcmp(expectedBuffer.GetData(), extractedBuffer.GetData(), (size_t)stream->GetSize()));
+        }
+    }
+};
+}  // namespace Orc::Test
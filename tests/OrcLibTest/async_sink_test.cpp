@@ -0,0 +1,137 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Log/AsyncSink.h"
+
+#include <array>
+#include <mutex>
+#include <thread>
+
+#include <spdlog/logger.h>
+#include <spdlog/sinks/base_sink.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+// Keeps payloads, 'gate' lets a test hold the flusher
+class CollectSink final : public spdlog::sinks::base_sink<std::mutex>
+{
+public:
+    std::vector<std::string> lines;
+    std::mutex gate;
+
+protected:
+    void sink_it_(const spdlog::details::log_msg& msg) override
+    {
+        std::lock_guard<std::mutex> lock(gate);
+        lines.emplace_back(msg.payload.data(), msg.payload.size());
+    }
+
+    void flush_() override {}
+};
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(AsyncSinkTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(FlushDeliversEveryMessageInOrder)
+    {
+        auto collect = std::make_shared<CollectSink>();
+        auto async = std::make_shared<Log::AsyncSink>(collect);
+        spdlog::logger logger("async", async);
+
+        async->Start(Log::AsyncSink::OverflowPolicy::Block, 16);
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++)
+        {
+            threads.emplace_back([&logger, i]() {
+                for (int j = 0; j < 1000; j++)
+                {
+                    logger.info("{} {}", i, j);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        logger.flush();
+        Assert::AreEqual(size_t(4000), collect->lines.size());
+
+        std::array<int, 4> next = {};
+        for (const auto& line : collect->lines)
+        {
+            int thread = 0, index = 0;
+            Assert::AreEqual(2, sscanf_s(line.c_str(), "%d %d", &thread, &index));
+            Assert::AreEqual(next[thread]++, index);
+        }
+
+        async->Stop();
+    }
+
+    TEST_METHOD(DropPolicyReportsDroppedMessages)
+    {
+        auto collect = std::make_shared<CollectSink>();
+        auto async = std::make_shared<Log::AsyncSink>(collect);
+        spdlog::logger logger("async", async);
+
+        async->Start(Log::AsyncSink::OverflowPolicy::Drop, 8);
+
+        {
+            std::lock_guard<std::mutex> lock(collect->gate);
+            for (int i = 0; i < 100; i++)
+            {
+                logger.info("message {}", i);
+            }
+        }
+
+        async->Stop();
+
+        const auto delivered = std::count_if(std::cbegin(collect->lines), std::cend(collect->lines), [](auto& line) {
+            return line.rfind("message", 0) == 0;
+        });
+
+        Assert::IsTrue(async->DroppedCount() > 0);
+        Assert::AreEqual(uint64_t(100), delivered + async->DroppedCount());
+        Assert::IsTrue(collect->lines.back().find("dropped") != std::string::npos);
+    }
+
+    TEST_METHOD(WritesInlineWhenStopped)
+    {
+        auto collect = std::make_shared<CollectSink>();
+        auto async = std::make_shared<Log::AsyncSink>(collect);
+        spdlog::logger logger("async", async);
+
+        logger.info("before");
+        Assert::AreEqual(size_t(1), collect->lines.size());
+
+        async->Start(Log::AsyncSink::OverflowPolicy::Block);
+        logger.info("queued");
+        async->Stop();
+
+        logger.info("after");
+        Assert::AreEqual(size_t(3), collect->lines.size());
+        Assert::AreEqual(std::string("after"), collect->lines.back());
+    }
+};
+}  // namespace Orc::Test
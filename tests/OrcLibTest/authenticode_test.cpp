@@ -9,6 +9,9 @@
 
 #include "FileStream.h"
 #include "Authenticode.h"
+#include "AuthenticodePool.h"
+
+#include <vector>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Orc;
@@ -39,5 +42,35 @@ public:
             Assert::IsTrue(SUCCEEDED(authenticode.Verify(szFile, fstream, data)));
         }
     }
+
+    TEST_METHOD(AuthenticodePoolTest)
+    {
+        AuthenticodePool pool(2);
+        Assert::IsTrue(pool.Workers() == 2);
+
+        // Without hashes nor security directory, no catalog can hold the file
+        const CBinaryBuffer secdir;
+        const Authenticode::PE_Hashs hashs;
+
+        std::vector<AuthenticodePool::Ticket> tickets;
+        for (int i = 0; i < 100; i++)
+        {
+            auto ticket = pool.Submit(L"notsigned.exe", secdir, hashs);
+            Assert::IsTrue(ticket != nullptr);
+            tickets.push_back(std::move(ticket));
+        }
+
+        // Tickets are collected in any order, some of them not at all
+        for (size_t i = tickets.size(); i > tickets.size() / 2; i--)
+        {
+            Authenticode::AuthenticodeData data;
+            Assert::AreEqual(S_OK, pool.Collect(tickets[i - 1], data));
+            Assert::IsTrue(data.AuthStatus == Authenticode::AUTHENTICODE_NOT_SIGNED);
+            Assert::IsFalse(data.isSigned);
+        }
+
+        AuthenticodePool none(0);
+        Assert::IsTrue(none.Submit(L"notsigned.exe", secdir, hashs) == nullptr);
+    }
 };
 }  // namespace Orc::Test
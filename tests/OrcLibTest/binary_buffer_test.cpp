@@ -10,6 +10,8 @@
 #include <CppUnitTest.h>
 
 #include "BinaryBuffer.h"
+#include "BufferPool.h"
+#include "CryptoUtilities.h"
 #include "fmt/core.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
@@ -186,6 +188,80 @@ public:
             LogLine();
         }
     }
+
+    TEST_METHOD(BinaryBufferPoolTest)
+    {
+        auto& pool = BufferPool::Instance();
+
+        // A released block is handed back to the next buffer of the same size class
+        {
+            CBinaryBuffer buffer(true);
+            Assert::IsTrue(buffer.SetCount(64 * 1024));
+            buffer[0] = 0xAA;
+        }
+
+        const auto before = pool.GetStatistics();
+        {
+            CBinaryBuffer buffer(true);
+            Assert::IsTrue(buffer.SetCount(60 * 1024));
+            Assert::IsTrue(buffer.GetCapacity() == BufferPool::BlockSize(60 * 1024));
+
+            // Shrinking and growing back within the capacity keeps the same block
+            const BYTE* pointer = buffer.GetData();
+            Assert::IsTrue(buffer.SetCount(512));
+            Assert::IsTrue(buffer.SetCount(64 * 1024));
+            Assert::IsTrue(buffer.GetData() == pointer);
+        }
+        const auto after = pool.GetStatistics();
+        Assert::IsTrue(after.Hits > before.Hits);
+
+        // Reserve allocates without changing the count
+        {
+            CBinaryBuffer buffer;
+            Assert::IsTrue(buffer.Reserve(1000));
+            Assert::IsTrue(buffer.GetCount() == 0);
+            Assert::IsTrue(buffer.GetCapacity() >= 1000);
+
+            const BYTE* pointer = buffer.GetData();
+            Assert::IsTrue(buffer.SetCount(1000));
+            Assert::IsTrue(buffer.GetData() == pointer);
+        }
+    }
+
+    TEST_METHOD(BinaryBufferInlineTest)
+    {
+        // Digests are stored inline
+        CBinaryBuffer buffer;
+        Assert::IsTrue(buffer.SetCount(BYTES_IN_SHA1_HASH));
+        Assert::IsTrue(buffer.GetCapacity() == CBinaryBuffer::kInlineCapacity);
+        for (size_t i = 0; i < buffer.GetCount(); i++)
+            buffer[i] = static_cast<BYTE>(i);
+
+        // Moves and copies keep their own inline storage
+        CBinaryBuffer moved(std::move(buffer));
+        Assert::IsTrue(buffer.GetCount() == 0);
+        Assert::IsTrue(moved.GetCount() == BYTES_IN_SHA1_HASH);
+        Assert::IsTrue(moved[19] == 19);
+
+        CBinaryBuffer copy(moved);
+        Assert::IsTrue(copy.GetData() != moved.GetData());
+        Assert::IsTrue(copy == moved);
+
+        CBinaryBuffer assigned;
+        assigned = copy;
+        copy[0] = 0xFF;
+        Assert::IsTrue(assigned == moved);
+
+        // Growing past the inline storage keeps the content
+        Assert::IsTrue(moved.SetCount(100));
+        Assert::IsTrue(moved.GetCapacity() >= 100);
+        Assert::IsTrue(moved[19] == 19);
+
+        // Views at API boundaries
+        BufferView view = assigned;
+        Assert::IsTrue(view.size() == BYTES_IN_SHA1_HASH);
+        Assert::IsTrue(view.data() == assigned.GetData());
+    }
 };
 
 }  // namespace Orc::Test
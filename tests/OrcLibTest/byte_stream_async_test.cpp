@@ -0,0 +1,143 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileStream.h"
+#include "MemoryStream.h"
+
+#include <concrt.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(ByteStreamAsyncTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::vector<BYTE> Pattern(size_t size)
+    {
+        std::vector<BYTE> bytes(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            bytes[i] = static_cast<BYTE>(i % 251);
+        }
+        return bytes;
+    }
+
+    static std::shared_ptr<FileStream> CreateTempFile(const std::vector<BYTE>& bytes)
+    {
+        auto stream = std::make_shared<FileStream>();
+        Assert::AreEqual(
+            S_OK,
+            stream->CreateNew(
+                L".tmp", FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_DELETE_ON_CLOSE, nullptr));
+
+        ULONGLONG cbWritten = 0LL;
+        Assert::AreEqual(S_OK, stream->Write((const PVOID)bytes.data(), bytes.size(), &cbWritten));
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbWritten);
+
+        Assert::AreEqual(S_OK, stream->SetFilePointer(0LL, FILE_BEGIN, nullptr));
+        return stream;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(ByteStreamAsyncFileRead)
+    {
+        const auto bytes = Pattern(1024 * 1024 + 17);
+        auto stream = CreateTempFile(bytes);
+        Assert::AreEqual(S_OK, stream->CanReadAsync());
+
+        // Both reads are outstanding at the same time, each one at the position it was started from
+        const size_t half = bytes.size() / 2;
+        std::vector<BYTE> read(bytes.size() + 4096);
+        concurrency::event first, second;
+        ULONGLONG cbFirst = 0LL, cbSecond = 0LL;
+        HRESULT hrFirst = E_FAIL, hrSecond = E_FAIL;
+
+        Assert::AreEqual(S_OK, stream->ReadAsync(read.data(), half, [&](HRESULT hr, ULONGLONG cbRead) {
+            hrFirst = hr;
+            cbFirst = cbRead;
+            first.set();
+        }));
+        Assert::AreEqual(
+            S_OK, stream->ReadAsync(read.data() + half, read.size() - half, [&](HRESULT hr, ULONGLONG cbRead) {
+                hrSecond = hr;
+                cbSecond = cbRead;
+                second.set();
+            }));
+
+        first.wait();
+        second.wait();
+
+        Assert::AreEqual(S_OK, hrFirst);
+        Assert::AreEqual(S_OK, hrSecond);
+        Assert::AreEqual(static_cast<ULONGLONG>(half), cbFirst);
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size() - half), cbSecond);
+        Assert::IsTrue(std::equal(std::cbegin(bytes), std::cend(bytes), std::cbegin(read)));
+        Assert::AreEqual(static_cast<uint64_t>(bytes.size()), stream->TotalRead());
+
+        // At the end of the file
+        concurrency::event eof;
+        ULONGLONG cbEof = 1LL;
+        Assert::AreEqual(S_OK, stream->ReadAsync(read.data(), read.size(), [&](HRESULT hr, ULONGLONG cbRead) {
+            cbEof = cbRead;
+            eof.set();
+        }));
+        eof.wait();
+        Assert::AreEqual(0ULL, cbEof);
+    }
+
+    TEST_METHOD(ByteStreamAsyncCopyTo)
+    {
+        const auto bytes = Pattern(3 * 1024 * 1024 + 5);
+        auto stream = CreateTempFile(bytes);
+
+        auto output = std::make_shared<MemoryStream>();
+        Assert::AreEqual(S_OK, output->OpenForReadWrite());
+
+        ULONGLONG cbCopied = 0LL;
+        Assert::AreEqual(S_OK, stream->CopyTo(*output, 64 * 1024, &cbCopied));
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbCopied);
+
+        Assert::AreEqual(S_OK, output->SetFilePointer(0LL, FILE_BEGIN, nullptr));
+        std::vector<BYTE> copied(bytes.size());
+        ULONGLONG cbRead = 0LL;
+        Assert::AreEqual(S_OK, output->Read(copied.data(), copied.size(), &cbRead));
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbRead);
+        Assert::IsTrue(bytes == copied);
+    }
+
+    TEST_METHOD(ByteStreamAsyncAdapter)
+    {
+        // Streams without native overlapped I/O complete on the calling thread
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::AreEqual(S_OK, stream->OpenForReadWrite());
+        Assert::AreEqual(S_FALSE, stream->CanReadAsync());
+
+        const auto bytes = Pattern(4096);
+        bool bCompleted = false;
+        Assert::AreEqual(
+            S_OK, stream->WriteAsync((const PVOID)bytes.data(), bytes.size(), [&](HRESULT hr, ULONGLONG cbWritten) {
+                Assert::AreEqual(S_OK, hr);
+                Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbWritten);
+                bCompleted = true;
+            }));
+        Assert::IsTrue(bCompleted);
+        Assert::AreEqual(static_cast<uint64_t>(bytes.size()), stream->TotalWritten());
+
+        Assert::AreEqual(E_INVALIDARG, stream->ReadAsync((PVOID)bytes.data(), bytes.size(), nullptr));
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,73 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "CaseInsensitive.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(CaseInsensitiveTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(CaseInsensitiveAgainstCompareStringOrdinal)
+    {
+        const std::vector<std::wstring> names = {
+            L"",
+            L"$MFT",
+            L"$mft",
+            L"ntuser.dat",
+            L"NTUSER.DAT",
+            L"NtUser.Dat",
+            L"ntuser.dau",
+            L"ntuser.da",
+            L"@[`{",
+            L"`{@[",
+            L"Résumé.docx",
+            L"RÉSUMÉ.DOCX",
+            L"RESUME.DOCX",
+            L"Δελτα.txt",
+            L"ΔΕΛΤΑ.TXT"};
+
+        for (const auto& lhs : names)
+        {
+            for (const auto& rhs : names)
+            {
+                const bool bExpected = CompareStringOrdinal(
+                                           lhs.c_str(),
+                                           static_cast<int>(lhs.size()),
+                                           rhs.c_str(),
+                                           static_cast<int>(rhs.size()),
+                                           TRUE)
+                    == CSTR_EQUAL;
+
+                Assert::AreEqual(bExpected, equalCaseInsensitive(lhs, rhs), (lhs + L" / " + rhs).c_str());
+
+                if (bExpected)
+                    Assert::AreEqual(hashCaseInsensitive(lhs), hashCaseInsensitive(rhs), (lhs + L" / " + rhs).c_str());
+            }
+        }
+    }
+
+    TEST_METHOD(CaseInsensitivePrefix)
+    {
+        Assert::IsTrue(equalCaseInsensitive(L"\\Windows\\System32", L"\\WINDOWS\\system", 15));
+        Assert::IsFalse(equalCaseInsensitive(L"\\Windows\\System32", L"\\WINDOWS\\syst", 15));
+        Assert::IsFalse(equalCaseInsensitive(L"\\Windows\\System32", L"\\WINDOWS\\sistem", 15));
+    }
+};
+}  // namespace Orc::Test
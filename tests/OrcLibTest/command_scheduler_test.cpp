@@ -0,0 +1,91 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "CommandScheduler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(CommandSchedulerTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(CommandSchedulerResources)
+    {
+        CommandScheduler<int> scheduler;
+        scheduler.SetCapacity(L"cpu", 2);
+
+        scheduler.Push(L"NTFSInfo", 1, {{L"io:C:", L"cpu"}, {}});
+        scheduler.Push(L"GetThis", 2, {{L"io:C:"}, {}});
+        scheduler.Push(L"FastFind", 3, {{L"io:D:", L"cpu"}, {}});
+        scheduler.Push(L"RegInfo", 4, {{L"cpu"}, {}});
+        scheduler.Push(L"Listdlls", 5, {});
+
+        // GetThis waits for the volume, RegInfo for a processor
+        Assert::AreEqual(1, scheduler.PopRunnable(false).value());
+        Assert::AreEqual(3, scheduler.PopRunnable(false).value());
+        Assert::AreEqual(5, scheduler.PopRunnable(false).value());
+        Assert::IsFalse(scheduler.PopRunnable(false).has_value());
+
+        scheduler.Complete(L"NTFSInfo");
+        Assert::AreEqual(2, scheduler.PopRunnable(false).value());
+        Assert::AreEqual(4, scheduler.PopRunnable(false).value());
+        Assert::IsTrue(scheduler.Empty());
+        Assert::AreEqual((size_t)4, scheduler.Running());
+    }
+
+    TEST_METHOD(CommandSchedulerDependencies)
+    {
+        CommandScheduler<int> scheduler;
+
+        scheduler.Push(L"GetThis", 1, {{}, {L"NTFSInfo"}});
+        scheduler.Push(L"Hash", 2, {{}, {L"GetThis", L"Unknown"}});
+
+        // NTFSInfo could still be queued
+        Assert::IsFalse(scheduler.PopRunnable(false).has_value());
+        Assert::IsFalse(scheduler.IsStalled(false));
+
+        scheduler.Push(L"NTFSInfo", 3, {});
+        Assert::AreEqual(3, scheduler.PopRunnable(false).value());
+        Assert::IsFalse(scheduler.PopRunnable(true).has_value());
+
+        scheduler.Complete(L"NTFSInfo");
+        Assert::AreEqual(1, scheduler.PopRunnable(false).value());
+        scheduler.Complete(L"GetThis");
+
+        // Unknown dependency is only ignored once no more commands are expected
+        Assert::IsFalse(scheduler.PopRunnable(false).has_value());
+        Assert::AreEqual(2, scheduler.PopRunnable(true).value());
+    }
+
+    TEST_METHOD(CommandSchedulerCycle)
+    {
+        CommandScheduler<int> scheduler;
+
+        scheduler.Push(L"A", 1, {{}, {L"B"}});
+        scheduler.Push(L"B", 2, {{}, {L"A"}});
+
+        Assert::IsFalse(scheduler.PopRunnable(true).has_value());
+        Assert::IsTrue(scheduler.IsStalled(true));
+
+        auto canceled = scheduler.Clear();
+        Assert::AreEqual((size_t)2, canceled.size());
+        Assert::IsTrue(canceled[0].first == L"A");
+        Assert::IsTrue(scheduler.Empty());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,65 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ContentPatternMatcher.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(ContentPatternMatcherTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(ContentPatternMatcherAgainstFind)
+    {
+        using namespace std::string_literals;
+
+        const std::vector<std::string> patterns = {
+            "MZ"s, "This program"s, "program cannot"s, "\x00\x01\x00"s, "gram"s, "absent"s, "aaab"s};
+
+        ContentPatternMatcher matcher;
+        std::vector<size_t> ids;
+        for (const auto& pattern : patterns)
+            ids.push_back(matcher.Add(pattern));
+
+        // Identical strings share their identifier
+        Assert::AreEqual(ids[0], matcher.Add("MZ"));
+        Assert::AreEqual(patterns.size(), matcher.size());
+
+        matcher.Compile();
+
+        const auto content = "MZ\x90\x00 This program cannot be run in DOS mode \x00\x01\x00 aaaab"s;
+
+        // Fed with blocks of every size, matches across the blocks must be found
+        for (size_t cbBlock = 1; cbBlock <= content.size(); cbBlock++)
+        {
+            ContentPatternMatcher::Scan scan(matcher);
+            for (size_t offset = 0; offset < content.size(); offset += cbBlock)
+            {
+                scan.Feed(
+                    reinterpret_cast<const BYTE*>(content.data()) + offset,
+                    std::min(cbBlock, content.size() - offset));
+            }
+
+            for (size_t i = 0; i < patterns.size(); i++)
+                Assert::AreEqual(content.find(patterns[i]) != std::string::npos, scan.Found(ids[i]));
+
+            Assert::IsFalse(scan.AllFound());
+        }
+    }
+};
+}  // namespace Orc::Test
@@ -8,6 +8,7 @@
 #include "stdafx.h"
 
 #include "CryptoUtilities.h"
+#include "AesExtensionsCipher.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Orc;
@@ -39,5 +40,63 @@ public:
             Assert::IsTrue(hProv != NULL);
         }
     }
+
+    TEST_METHOD(AesExtensionsCipherTest)
+    {
+        if (!AesExtensionsCipher::IsSupported())
+        {
+            Logger::WriteMessage(L"AES instructions are not available on this processor, test skipped");
+            return;
+        }
+
+        // NIST SP 800-38A, F.2.5 and F.2.6 (CBC-AES256)
+        const std::array<BYTE, AesExtensionsCipher::kKeySize> key = {
+            0x60, 0x3d, 0xeb, 0x10, 0x15, 0xca, 0x71, 0xbe, 0x2b, 0x73, 0xae, 0xf0, 0x85, 0x7d, 0x77, 0x81,
+            0x1f, 0x35, 0x2c, 0x07, 0x3b, 0x61, 0x08, 0xd7, 0x2d, 0x98, 0x10, 0xa3, 0x09, 0x14, 0xdf, 0xf4};
+        const BYTE iv[AesExtensionsCipher::kBlockSize] = {
+            0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f};
+        const BYTE plain[64] = {
+            0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+            0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+            0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+            0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10};
+        const BYTE cipher[64] = {
+            0xf5, 0x8c, 0x4c, 0x04, 0xd6, 0xe5, 0xf1, 0xba, 0x77, 0x9e, 0xab, 0xfb, 0x5f, 0x7b, 0xfb, 0xd6,
+            0x9c, 0xfc, 0x4e, 0x96, 0x7e, 0xdb, 0x80, 0x8d, 0x67, 0x9f, 0x77, 0x7b, 0xc6, 0x70, 0x2c, 0x7d,
+            0x39, 0xf2, 0x33, 0x69, 0xa9, 0xd9, 0xba, 0xcf, 0xa5, 0x30, 0xe2, 0x63, 0x04, 0x23, 0x14, 0x61,
+            0xb2, 0xeb, 0x05, 0xe2, 0xc3, 0x9b, 0xe9, 0xfc, 0xda, 0x6c, 0x19, 0x07, 0x8c, 0x6a, 0x9d, 0x1b};
+
+        AesExtensionsCipher aes(key);
+
+        // Chaining from one call to the next
+        BYTE data[64];
+        BYTE chain[AesExtensionsCipher::kBlockSize];
+        std::copy(std::cbegin(plain), std::cend(plain), data);
+        std::copy(std::cbegin(iv), std::cend(iv), chain);
+        aes.EncryptCbc(data, 16, chain);
+        aes.EncryptCbc(data + 16, 48, chain);
+        Assert::IsTrue(std::equal(std::cbegin(cipher), std::cend(cipher), data));
+
+        std::copy(std::cbegin(iv), std::cend(iv), chain);
+        aes.DecryptCbc(data, sizeof(data), chain);
+        Assert::IsTrue(std::equal(std::cbegin(plain), std::cend(plain), data));
+
+        // Decryption of several blocks at once, then of the remaining ones
+        std::vector<BYTE> buffer(37 * AesExtensionsCipher::kBlockSize);
+        for (size_t i = 0; i < buffer.size(); i++)
+            buffer[i] = static_cast<BYTE>(i * 7 + 3);
+        const auto expected = buffer;
+
+        std::copy(std::cbegin(iv), std::cend(iv), chain);
+        aes.EncryptCbc(buffer.data(), buffer.size(), chain);
+
+        std::copy(std::cbegin(iv), std::cend(iv), chain);
+        aes.DecryptCbc(buffer.data(), 9 * AesExtensionsCipher::kBlockSize, chain);
+        aes.DecryptCbc(
+            buffer.data() + 9 * AesExtensionsCipher::kBlockSize,
+            buffer.size() - 9 * AesExtensionsCipher::kBlockSize,
+            chain);
+        Assert::IsTrue(buffer == expected);
+    }
 };
 }  // namespace Orc::Test
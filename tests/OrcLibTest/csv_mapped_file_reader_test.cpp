@@ -0,0 +1,163 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "CsvMappedFileReader.h"
+#include "Temporary.h"
+
+#include <fstream>
+#include <mutex>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+using Rows = std::map<ULONGLONG, std::vector<std::string>>;
+
+std::wstring WriteTempFile(const std::string& content)
+{
+    WCHAR szTempDir[ORC_MAX_PATH];
+    Assert::IsTrue(SUCCEEDED(UtilGetTempDirPath(szTempDir, ORC_MAX_PATH)));
+
+    std::wstring path;
+    Assert::IsTrue(SUCCEEDED(UtilGetUniquePath(szTempDir, L"mapped_reader_test.csv", path)));
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(content.data(), content.size());
+    return path;
+}
+
+// Rows by line number, fields unquoted
+Rows Parse(const TableOutput::CSV::MappedFileReader& reader, bool bParallel, size_t cbChunk = 64)
+{
+    Rows rows;
+    std::mutex lock;
+
+    auto onRow = [&](const TableOutput::CSV::MappedFileReader::Row& row) -> HRESULT {
+        std::vector<std::string> fields;
+        for (const auto& field : row.Fields)
+        {
+            std::string storage;
+            fields.emplace_back(reader.Unquote(field, storage));
+        }
+
+        std::lock_guard<std::mutex> guard(lock);
+        Assert::IsTrue(rows.emplace(row.ullLineNumber, std::move(fields)).second);
+        return S_OK;
+    };
+
+    HRESULT hr = bParallel ? reader.ParseRowsParallel(onRow, cbChunk) : reader.ParseRows(onRow);
+    Assert::IsTrue(SUCCEEDED(hr));
+    return rows;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(CsvMappedFileReaderTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(QuotedFields)
+    {
+        const auto path = WriteTempFile(
+            "\xEF\xBB\xBF"
+            "Name,Size,Comment\r\n"
+            "\"a.txt\",12,\"say \"\"hi\"\"\"\r\n"
+            "\r\n"
+            "b.txt,,\"x,y\"\r\n"
+            "c.txt,3,\n");
+
+        TableOutput::CSV::MappedFileReader reader;
+        Assert::IsTrue(SUCCEEDED(reader.OpenFile(path.c_str())));
+
+        const auto& names = reader.GetColumnNames();
+        Assert::AreEqual(size_t(3), names.size());
+        Assert::IsTrue(names[0] == "Name");
+        Assert::IsTrue(names[2] == "Comment");
+
+        const Rows expected = {
+            {2, {"a.txt", "12", "say \"hi\""}}, {4, {"b.txt", "", "x,y"}}, {5, {"c.txt", "3", ""}}};
+
+        Assert::IsTrue(Parse(reader, false) == expected);
+        Assert::IsTrue(Parse(reader, true, 16) == expected);
+
+        reader.Close();
+        DeleteFile(path.c_str());
+    }
+
+    TEST_METHOD(MultiLineFields)
+    {
+        // The quoted line feed forces the parallel parse back to a sequential one
+        const auto path = WriteTempFile("A,B\n1,\"line\nnext\"\n2,x\n");
+
+        TableOutput::CSV::MappedFileReader reader;
+        Assert::IsTrue(SUCCEEDED(reader.OpenFile(path.c_str())));
+
+        const Rows expected = {{2, {"1", "line\nnext"}}, {4, {"2", "x"}}};
+
+        Assert::IsTrue(Parse(reader, false) == expected);
+        Assert::IsTrue(Parse(reader, true, 8) == expected);
+
+        reader.Close();
+        DeleteFile(path.c_str());
+    }
+
+    TEST_METHOD(ParallelMatchesSequential)
+    {
+        // Long enough for several SIMD blocks per chunk and rows crossing block boundaries
+        std::string content = "Id,Path,Value\n";
+        for (int i = 0; i < 5000; ++i)
+        {
+            content += fmt::format("{},\"C:\\dir{}\\file, {}.bin\",{}\n", i, i % 7, i, i * 31);
+        }
+
+        const auto path = WriteTempFile(content);
+
+        TableOutput::CSV::MappedFileReader reader;
+        Assert::IsTrue(SUCCEEDED(reader.OpenFile(path.c_str())));
+
+        const auto sequential = Parse(reader, false);
+        Assert::AreEqual(size_t(5000), sequential.size());
+        Assert::IsTrue(sequential.at(5001)[1] == "C:\\dir3\\file, 4999.bin");
+
+        Assert::IsTrue(Parse(reader, true, 4096) == sequential);
+        Assert::IsTrue(Parse(reader, true, 100) == sequential);
+
+        reader.Close();
+        DeleteFile(path.c_str());
+    }
+
+    TEST_METHOD(StopFromCallback)
+    {
+        const auto path = WriteTempFile("A\n1\n2\n3\n");
+
+        TableOutput::CSV::MappedFileReader reader;
+        Assert::IsTrue(SUCCEEDED(reader.OpenFile(path.c_str())));
+
+        ULONGLONG ullRows = 0LL;
+        HRESULT hr = reader.ParseRows([&ullRows](const auto& row) -> HRESULT {
+            ullRows++;
+            return row.Fields[0] == "2" ? S_FALSE : S_OK;
+        });
+
+        Assert::AreEqual(S_FALSE, hr);
+        Assert::AreEqual(2ULL, ullRows);
+
+        reader.Close();
+        DeleteFile(path.c_str());
+    }
+};
+}  // namespace Orc::Test
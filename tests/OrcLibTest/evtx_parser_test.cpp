@@ -0,0 +1,307 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileFormat/EvtxParser.h"
+#include "MemoryStream.h"
+
+#include <map>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+// Writes a chunk whose records instantiate a single template:
+//
+// <Event>
+//   <System>
+//     <Provider Name="%0"/>
+//     <EventID>%1</EventID>
+//     <Channel>Security</Channel>
+//     <Security UserID="%3"/>
+//   </System>
+//   <EventData><Data Name="TargetUserName">%2</Data></EventData>
+// </Event>
+class ChunkBuilder
+{
+public:
+    ChunkBuilder()
+        : m_chunk(EvtxParser::kChunkSize)
+        , m_offset(EvtxParser::kChunkHeaderSize)
+    {
+        memcpy(m_chunk.data(), "ElfChnk\0", 8);
+    }
+
+    void AddRecord(
+        ULONGLONG ullRecordId,
+        std::wstring_view provider,
+        WORD wEventId,
+        std::wstring_view userName,
+        const std::vector<BYTE>& sid)
+    {
+        const auto start = m_offset;
+        Dword(0x00002a2a);
+        Dword(0);
+        Qword(ullRecordId);
+        Qword(0x01D4A0B3C0000000ULL);
+
+        Fragment();
+        Byte(0x0C);
+        Byte(0x01);
+        Dword(1);
+        if (m_dwTemplateOffset == 0)
+        {
+            m_dwTemplateOffset = static_cast<DWORD>(m_offset + sizeof(DWORD));
+            Dword(m_dwTemplateOffset);
+            Template();
+        }
+        else
+            Dword(m_dwTemplateOffset);
+
+        const std::vector<std::pair<BYTE, std::vector<BYTE>>> values = {
+            {0x01, Utf16(provider)},
+            {0x06, Bytes(wEventId)},
+            {0x01, Utf16(userName)},
+            {static_cast<BYTE>(sid.empty() ? 0x00 : 0x13), sid}};
+
+        Dword(static_cast<DWORD>(values.size()));
+        for (const auto& [type, data] : values)
+        {
+            Word(static_cast<WORD>(data.size()));
+            Byte(type);
+            Byte(0);
+        }
+        for (const auto& value : values)
+            Append(value.second);
+        Byte(0x00);
+
+        const auto size = static_cast<DWORD>(m_offset - start + sizeof(DWORD));
+        Dword(size);
+        memcpy(m_chunk.data() + start + 4, &size, sizeof(size));
+
+        const auto freeSpace = static_cast<DWORD>(m_offset);
+        memcpy(m_chunk.data() + 0x30, &freeSpace, sizeof(freeSpace));
+    }
+
+    const std::vector<BYTE>& Chunk() const { return m_chunk; }
+
+private:
+    template <typename T>
+    static std::vector<BYTE> Bytes(T value)
+    {
+        std::vector<BYTE> bytes(sizeof(T));
+        memcpy(bytes.data(), &value, sizeof(T));
+        return bytes;
+    }
+
+    static std::vector<BYTE> Utf16(std::wstring_view text)
+    {
+        return std::vector<BYTE>(
+            reinterpret_cast<const BYTE*>(text.data()), reinterpret_cast<const BYTE*>(text.data() + text.size()));
+    }
+
+    void Append(const std::vector<BYTE>& bytes)
+    {
+        memcpy(m_chunk.data() + m_offset, bytes.data(), bytes.size());
+        m_offset += bytes.size();
+    }
+
+    void Byte(BYTE value) { Append(Bytes(value)); }
+    void Word(WORD value) { Append(Bytes(value)); }
+    void Dword(DWORD value) { Append(Bytes(value)); }
+    void Qword(ULONGLONG value) { Append(Bytes(value)); }
+
+    void Fragment()
+    {
+        Byte(0x0F);
+        Byte(0x01);
+        Byte(0x01);
+        Byte(0x00);
+    }
+
+    // Names are written inline after the attribute list size at their first use
+    void Name(std::wstring_view name, bool bAttributes)
+    {
+        auto it = m_names.find(std::wstring(name));
+        const bool bInline = it == std::end(m_names);
+        const auto dwOffset =
+            bInline ? static_cast<DWORD>(m_offset + sizeof(DWORD) * (bAttributes ? 2 : 1)) : it->second;
+
+        Dword(dwOffset);
+        if (bAttributes)
+            Dword(0);
+
+        if (bInline)
+        {
+            m_names.emplace(name, dwOffset);
+            Dword(0);
+            Word(0);
+            Word(static_cast<WORD>(name.size()));
+            Append(Utf16(name));
+            Word(0);
+        }
+    }
+
+    void Open(std::wstring_view name, bool bAttributes = false)
+    {
+        Byte(bAttributes ? 0x41 : 0x01);
+        Word(0xFFFF);
+        Dword(0);
+        Name(name, bAttributes);
+    }
+
+    void Attribute(std::wstring_view name)
+    {
+        Byte(0x06);
+        Name(name, false);
+    }
+
+    void Text(std::wstring_view text)
+    {
+        Byte(0x05);
+        Byte(0x01);
+        Word(static_cast<WORD>(text.size()));
+        Append(Utf16(text));
+    }
+
+    void Substitution(WORD wIndex, BYTE type)
+    {
+        Byte(0x0E);
+        Word(wIndex);
+        Byte(type);
+    }
+
+    void Template()
+    {
+        Dword(0);
+        Append(std::vector<BYTE>(sizeof(GUID)));
+        const auto sizeOffset = m_offset;
+        Dword(0);
+
+        const auto start = m_offset;
+        Fragment();
+        Open(L"Event");
+        Byte(0x02);
+        Open(L"System");
+        Byte(0x02);
+        Open(L"Provider", true);
+        Attribute(L"Name");
+        Substitution(0, 0x01);
+        Byte(0x03);
+        Open(L"EventID");
+        Byte(0x02);
+        Substitution(1, 0x06);
+        Byte(0x04);
+        Open(L"Channel");
+        Byte(0x02);
+        Text(L"Security");
+        Byte(0x04);
+        Open(L"Security", true);
+        Attribute(L"UserID");
+        Substitution(3, 0x13);
+        Byte(0x03);
+        Byte(0x04);
+        Open(L"EventData");
+        Byte(0x02);
+        Open(L"Data", true);
+        Attribute(L"Name");
+        Text(L"TargetUserName");
+        Byte(0x02);
+        Substitution(2, 0x01);
+        Byte(0x04);
+        Byte(0x04);
+        Byte(0x04);
+        Byte(0x00);
+
+        const auto size = static_cast<DWORD>(m_offset - start);
+        memcpy(m_chunk.data() + sizeOffset, &size, sizeof(size));
+    }
+
+    std::vector<BYTE> m_chunk;
+    size_t m_offset;
+    DWORD m_dwTemplateOffset = 0L;
+    std::map<std::wstring, DWORD> m_names;
+};
+
+const std::vector<BYTE> kLocalSystem = {0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x05, 0x12, 0x00, 0x00, 0x00};
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(EvtxParserTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(EvtxParserChunk)
+    {
+        ChunkBuilder builder;
+        builder.AddRecord(1, L"Microsoft-Windows-Security-Auditing", 4624, L"alice", kLocalSystem);
+        builder.AddRecord(2, L"Microsoft-Windows-Security-Auditing", 4625, L"bob", {});
+
+        std::vector<EvtxParser::Record> records;
+        ULONG ulCorrupted = 0L;
+        const auto& chunk = builder.Chunk();
+        Assert::AreEqual(S_OK, EvtxParser::ParseChunk(chunk.data(), chunk.size(), records, ulCorrupted));
+        Assert::AreEqual(0UL, ulCorrupted);
+        Assert::AreEqual(size_t(2), records.size());
+
+        Assert::AreEqual(1ULL, records[0].ullRecordId);
+        Assert::AreEqual(4624UL, records[0].dwEventId);
+        Assert::AreEqual(std::wstring(L"Microsoft-Windows-Security-Auditing"), records[0].Provider);
+        Assert::AreEqual(std::wstring(L"Security"), records[0].Channel);
+        Assert::AreEqual(std::wstring(L"S-1-5-18"), records[0].UserId);
+        Assert::AreEqual(size_t(1), records[0].Data.size());
+        Assert::AreEqual(std::wstring(L"TargetUserName"), records[0].Data[0].first);
+        Assert::AreEqual(std::wstring(L"alice"), records[0].Data[0].second);
+
+        // Second record refers to the cached template, its optional substitution is null
+        Assert::AreEqual(2ULL, records[1].ullRecordId);
+        Assert::AreEqual(4625UL, records[1].dwEventId);
+        Assert::IsTrue(records[1].UserId.empty());
+        Assert::AreEqual(std::wstring(L"bob"), records[1].Data[0].second);
+    }
+
+    TEST_METHOD(EvtxParserStream)
+    {
+        ChunkBuilder first;
+        first.AddRecord(1, L"Provider", 1, L"alice", kLocalSystem);
+        ChunkBuilder second;
+        second.AddRecord(2, L"Provider", 2, L"bob", kLocalSystem);
+
+        std::vector<BYTE> file(EvtxParser::kFileHeaderSize);
+        memcpy(file.data(), "ElfFile\0", 8);
+        for (const auto& chunk : {first.Chunk(), std::vector<BYTE>(EvtxParser::kChunkSize), second.Chunk()})
+            file.insert(std::end(file), std::begin(chunk), std::end(chunk));
+
+        MemoryStream stream;
+        Assert::AreEqual(S_OK, stream.OpenForReadOnly(file.data(), file.size()));
+
+        // A single chunk per batch: records are still reported in file order
+        EvtxParser parser(1L);
+        std::vector<ULONGLONG> ids;
+        Assert::AreEqual(S_OK, parser.Parse(stream, [&ids](const EvtxParser::Record& record) -> HRESULT {
+            ids.push_back(record.ullRecordId);
+            return S_OK;
+        }));
+
+        Assert::AreEqual(size_t(2), ids.size());
+        Assert::AreEqual(1ULL, ids[0]);
+        Assert::AreEqual(2ULL, ids[1]);
+        Assert::AreEqual(2UL, parser.Chunks());
+        Assert::AreEqual(0UL, parser.CorruptedRecords());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,107 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ExternalSort.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+struct Record
+{
+    ULONGLONG Key;
+    DWORD Index;
+
+    bool operator<(const Record& other) const { return Key < other.Key; }
+};
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(ExternalSortTest)
+{
+private:
+    UnitTestHelper helper;
+
+    template <typename Sort>
+    static std::vector<Record> Sorted(Sort& sort)
+    {
+        std::vector<Record> records;
+        Assert::AreEqual(S_OK, sort.Merge([&records](const Record& record) { records.push_back(record); }));
+        return records;
+    }
+
+    static void CheckOrder(const std::vector<Record>& records)
+    {
+        for (size_t i = 1; i < records.size(); i++)
+        {
+            Assert::IsTrue(records[i - 1].Key <= records[i].Key);
+
+            // Equal keys keep the order they were added in
+            if (records[i - 1].Key == records[i].Key)
+                Assert::IsTrue(records[i - 1].Index < records[i].Index);
+        }
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(InMemory)
+    {
+        ExternalSort<Record> sort(1024 * 1024);
+
+        const DWORD count = 1000;
+        for (DWORD i = 0; i < count; i++)
+            Assert::AreEqual(S_OK, sort.Add({(count - i) % 17, i}));
+
+        Assert::IsTrue(sort.Runs() == 0);
+        Assert::IsTrue(sort.Count() == count);
+
+        auto records = Sorted(sort);
+        Assert::IsTrue(records.size() == count);
+        CheckOrder(records);
+
+        Assert::IsTrue(sort.Count() == 0);
+    }
+
+    TEST_METHOD(Runs)
+    {
+        // The smallest budget: runs of ExternalSort::kMinRecords records
+        ExternalSort<Record> sort(0);
+
+        const DWORD count = static_cast<DWORD>(ExternalSort<Record>::kMinRecords * 5 + 123);
+        ULONGLONG key = 88172645463325252ULL;
+        for (DWORD i = 0; i < count; i++)
+        {
+            key ^= key << 13;
+            key ^= key >> 7;
+            key ^= key << 17;
+            Assert::AreEqual(S_OK, sort.Add({key % 1000, i}));
+        }
+
+        Assert::IsTrue(sort.Runs() == 5);
+
+        auto records = Sorted(sort);
+        Assert::IsTrue(records.size() == count);
+        CheckOrder(records);
+
+        std::vector<bool> seen(count, false);
+        for (const auto& record : records)
+        {
+            Assert::IsFalse(seen[record.Index]);
+            seen[record.Index] = true;
+        }
+    }
+};
+}  // namespace Orc::Test
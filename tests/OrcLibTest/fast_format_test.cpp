@@ -0,0 +1,125 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Text/FastFormat.h"
+
+#include <limits>
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(FastFormatTest)
+{
+private:
+    UnitTestHelper helper;
+
+    template <typename Kernel>
+    static std::wstring Format(Kernel kernel)
+    {
+        WCHAR szBuffer[64];
+        const auto end = kernel(szBuffer);
+        Assert::IsTrue(end != nullptr);
+        return std::wstring(szBuffer, end - szBuffer);
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(FastFormatDecimal)
+    {
+        const uint64_t values[] = {
+            0ULL,
+            9ULL,
+            10ULL,
+            99ULL,
+            100ULL,
+            4294967295ULL,
+            9999999999999999999ULL,
+            (std::numeric_limits<uint64_t>::max)()};
+
+        for (const auto value : values)
+        {
+            Assert::AreEqual(
+                fmt::format(L"{}", value), Format([value](auto out) { return Text::FormatDecimal(value, out); }));
+        }
+
+        const int64_t signedValues[] = {
+            -1LL, -42LL, (std::numeric_limits<int64_t>::min)(), (std::numeric_limits<int64_t>::max)()};
+        for (const auto value : signedValues)
+        {
+            Assert::AreEqual(
+                fmt::format(L"{}", value), Format([value](auto out) { return Text::FormatDecimal(value, out); }));
+        }
+
+        char szBuffer[Text::kMaxDecimalLength];
+        const auto end = Text::FormatDecimal(uint64_t(1601), szBuffer);
+        Assert::IsTrue(std::string_view(szBuffer, end - szBuffer) == "1601"sv);
+    }
+
+    TEST_METHOD(FastFormatHex)
+    {
+        Assert::AreEqual(L"0"s, Format([](auto out) { return Text::FormatHexInteger(0ULL, out); }));
+        Assert::AreEqual(L"0x1F"s, Format([](auto out) { return Text::FormatHexInteger(0x1FULL, out, true); }));
+        Assert::AreEqual(
+            L"FFFFFFFFFFFFFFFF"s,
+            Format([](auto out) { return Text::FormatHexInteger((std::numeric_limits<uint64_t>::max)(), out); }));
+
+        const BYTE bytes[] = {0x00, 0x0A, 0xAB, 0xFF};
+        Assert::AreEqual(
+            L"000AABFF"s, Format([&bytes](auto out) { return Text::FormatHexBytes(bytes, sizeof(bytes), out); }));
+
+        const GUID guid = {0x3808876B, 0xC176, 0x4E48, {0xB7, 0xAE, 0x04, 0x04, 0x6E, 0x6C, 0xC7, 0x52}};
+        WCHAR szCLSID[MAX_GUID_STRLEN];
+        Assert::IsTrue(StringFromGUID2(guid, szCLSID, MAX_GUID_STRLEN) != 0);
+        Assert::AreEqual(std::wstring(szCLSID), Format([&guid](auto out) { return Text::FormatGuid(guid, out); }));
+    }
+
+    TEST_METHOD(FastFormatFileTime)
+    {
+        // Same day twice (cached date prefix), next day, then the first representable and last representable values
+        const ULONGLONG values[] = {
+            132514560001234567ULL,
+            132514595999999999ULL,
+            132515424000000000ULL,
+            0ULL,
+            0x7FFFFFFFFFFFFFFFULL};
+
+        for (const auto value : values)
+        {
+            const FILETIME ft = {static_cast<DWORD>(value), static_cast<DWORD>(value >> 32)};
+
+            SYSTEMTIME st;
+            Assert::IsTrue(FileTimeToSystemTime(&ft, &st) != FALSE);
+
+            const auto expected = fmt::format(
+                L"{:04}-{:02}-{:02} {:02}:{:02}:{:02}.{:03}",
+                st.wYear,
+                st.wMonth,
+                st.wDay,
+                st.wHour,
+                st.wMinute,
+                st.wSecond,
+                st.wMilliseconds);
+
+            Assert::AreEqual(expected, Format([&ft](auto out) { return Text::FormatFileTime(ft, out); }));
+        }
+
+        WCHAR szBuffer[Text::kMaxFileTimeLength];
+        const FILETIME invalid = {0xFFFFFFFF, 0xFFFFFFFF};
+        Assert::IsTrue(Text::FormatFileTime(invalid, szBuffer) == nullptr);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,171 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileDataPass.h"
+#include "CryptoHashStream.h"
+#include "FuzzyHashStream.h"
+#include "MemoryStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(FileDataPassTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::vector<BYTE> MakeData(size_t size)
+    {
+        std::vector<BYTE> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<BYTE>(i * 31 + (i >> 7));
+        }
+        return data;
+    }
+
+    static std::shared_ptr<MemoryStream> MakeStream(std::vector<BYTE>& data)
+    {
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(S_OK == stream->OpenForReadWrite(static_cast<DWORD>(data.size())));
+
+        ULONGLONG ullWritten = 0LL;
+        Assert::IsTrue(S_OK == stream->Write(data.data(), data.size(), &ullWritten));
+        Assert::IsTrue(S_OK == stream->SetFilePointer(0, FILE_BEGIN, nullptr));
+        return stream;
+    }
+
+    static CBinaryBuffer Hash(CryptoHashStream& hashstream, CryptoHashStreamAlgorithm alg)
+    {
+        CBinaryBuffer hash;
+        Assert::IsTrue(S_OK == hashstream.GetHash(alg, hash));
+        return hash;
+    }
+
+    static void AreEqual(const CBinaryBuffer& expected, const CBinaryBuffer& actual)
+    {
+        Assert::AreEqual(expected.GetCount(), actual.GetCount());
+        Assert::IsTrue(!memcmp(expected.GetData(), actual.GetData(), expected.GetCount()));
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(SingleReadFeedsAllConsumers)
+    {
+        using Algorithm = CryptoHashStreamAlgorithm;
+
+        // Larger than a read block, with chunks crossing block boundaries and a size that needs padding
+        auto data = MakeData(2 * 1024 * 1024 + 517);
+        auto stream = MakeStream(data);
+
+        const PeParser::PeChunks chunks = {
+            {{0, 216}, {220, 32}, {260, 1024 * 1024}, {1024 * 1024 + 300, 1024 * 1024 + 100}}};
+
+        FileDataPass pass;
+        pass.AddFirstBytes(16);
+        Assert::IsTrue(S_OK == pass.AddCryptoHash(Algorithm::MD5 | Algorithm::SHA256));
+        Assert::IsTrue(S_OK == pass.AddPeHash(Algorithm::SHA1, chunks));
+
+        Assert::IsTrue(S_OK == pass.Run(*stream));
+        Assert::AreEqual(static_cast<ULONGLONG>(data.size()), pass.BytesRead());
+        Assert::AreEqual(static_cast<ULONGLONG>(data.size()), stream->TotalRead());
+
+        Assert::AreEqual(static_cast<size_t>(16), pass.FirstBytes().GetCount());
+        Assert::IsTrue(!memcmp(data.data(), pass.FirstBytes().GetData(), 16));
+
+        CryptoHashStream expected;
+        Assert::IsTrue(S_OK == expected.OpenToWrite(Algorithm::MD5 | Algorithm::SHA256, nullptr));
+        ULONGLONG ullWritten = 0LL;
+        Assert::IsTrue(S_OK == expected.Write(data.data(), data.size(), &ullWritten));
+
+        AreEqual(Hash(expected, Algorithm::MD5), Hash(*pass.CryptoHash(), Algorithm::MD5));
+        AreEqual(Hash(expected, Algorithm::SHA256), Hash(*pass.CryptoHash(), Algorithm::SHA256));
+
+        CryptoHashStream expectedPe;
+        Assert::IsTrue(S_OK == expectedPe.OpenToWrite(Algorithm::SHA1, nullptr));
+        for (const auto& chunk : chunks)
+        {
+            Assert::IsTrue(S_OK == expectedPe.Write(data.data() + chunk.offset, chunk.length, &ullWritten));
+        }
+
+        BYTE padding[8] = {0};
+        Assert::IsTrue(S_OK == expectedPe.Write(padding, 8 - data.size() % 8, &ullWritten));
+
+        AreEqual(Hash(expectedPe, Algorithm::SHA1), Hash(*pass.PeHash(), Algorithm::SHA1));
+    }
+
+#ifdef ORC_BUILD_SSDEEP
+    TEST_METHOD(FuzzyHashAlongsideOtherHashes)
+    {
+        using Algorithm = CryptoHashStreamAlgorithm;
+
+        // Blocks large enough for the fuzzy hash to run next to the others, the digests must not change
+        auto data = MakeData(3 * 1024 * 1024 + 4097);
+        auto stream = MakeStream(data);
+
+        const PeParser::PeChunks chunks = {{{0, 216}, {220, 32}, {260, 2 * 1024 * 1024}}};
+
+        FileDataPass pass;
+        Assert::IsTrue(S_OK == pass.AddCryptoHash(Algorithm::SHA1));
+        Assert::IsTrue(S_OK == pass.AddFuzzyHash(FuzzyHashStreamAlgorithm::SSDeep));
+        Assert::IsTrue(S_OK == pass.AddPeHash(Algorithm::SHA256, chunks));
+        Assert::IsTrue(S_OK == pass.Run(*stream));
+
+        ULONGLONG ullWritten = 0LL;
+        FuzzyHashStream expectedFuzzy;
+        Assert::IsTrue(S_OK == expectedFuzzy.OpenToWrite(FuzzyHashStreamAlgorithm::SSDeep, nullptr));
+        Assert::IsTrue(S_OK == expectedFuzzy.Write(data.data(), data.size(), &ullWritten));
+
+        std::wstring expected, actual;
+        Assert::IsTrue(S_OK == expectedFuzzy.GetHash(FuzzyHashStreamAlgorithm::SSDeep, expected));
+        Assert::IsTrue(S_OK == pass.FuzzyHash()->GetHash(FuzzyHashStreamAlgorithm::SSDeep, actual));
+        Assert::AreEqual(expected, actual);
+
+        CryptoHashStream expectedCrypto;
+        Assert::IsTrue(S_OK == expectedCrypto.OpenToWrite(Algorithm::SHA1, nullptr));
+        Assert::IsTrue(S_OK == expectedCrypto.Write(data.data(), data.size(), &ullWritten));
+        AreEqual(Hash(expectedCrypto, Algorithm::SHA1), Hash(*pass.CryptoHash(), Algorithm::SHA1));
+
+        CryptoHashStream expectedPe;
+        Assert::IsTrue(S_OK == expectedPe.OpenToWrite(Algorithm::SHA256, nullptr));
+        for (const auto& chunk : chunks)
+        {
+            Assert::IsTrue(S_OK == expectedPe.Write(data.data() + chunk.offset, chunk.length, &ullWritten));
+        }
+
+        BYTE padding[8] = {0};
+        if (const auto alignment = data.size() % 8)
+            Assert::IsTrue(S_OK == expectedPe.Write(padding, 8 - alignment, &ullWritten));
+
+        AreEqual(Hash(expectedPe, Algorithm::SHA256), Hash(*pass.PeHash(), Algorithm::SHA256));
+    }
+#endif  // ORC_BUILD_SSDEEP
+
+    TEST_METHOD(PeChunksOutOfStreamAreDropped)
+    {
+        auto data = MakeData(4096);
+        auto stream = MakeStream(data);
+
+        const PeParser::PeChunks chunks = {{{0, 216}, {220, 32}, {260, 1000}, {1260, 4000}}};
+
+        FileDataPass pass;
+        Assert::IsTrue(S_OK == pass.AddCryptoHash(CryptoHashStreamAlgorithm::MD5));
+        Assert::IsTrue(S_OK == pass.AddPeHash(CryptoHashStreamAlgorithm::MD5, chunks));
+
+        Assert::IsTrue(S_OK == pass.Run(*stream));
+        Assert::IsTrue(pass.CryptoHash() != nullptr);
+        Assert::IsTrue(pass.PeHash() == nullptr);
+    }
+};
+}  // namespace Orc::Test
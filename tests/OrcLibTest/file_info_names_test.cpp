@@ -0,0 +1,104 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "FileInfo.h"
+
+#include <crtdbg.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+// Allocations of the calling thread, counted by the debug heap (always 0 in release builds)
+size_t g_allocations = 0;
+DWORD g_countedThreadId = 0L;
+
+int __cdecl CountAllocations(int allocType, void*, size_t, int, long, const unsigned char*, int)
+{
+    if (allocType != _HOOK_FREE && GetCurrentThreadId() == g_countedThreadId)
+        g_allocations++;
+    return TRUE;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(FileInfoNamesTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static constexpr const WCHAR* kNames[] = {
+        L"\\Windows\\System32\\notepad.exe",
+        L"\\Windows\\System32\\",
+        L"\\pagefile.sys",
+        L"\\",
+        L"\\Users\\Public\\.profile",
+        L"\\Users\\Public\\archive.tar.gz",
+        L"\\Users\\Public\\README",
+        L"\\ProgramData\\ver.1.2\\file",
+        L"\\Users\\desktop.ini:Zone.Identifier",
+        L"C:\\Windows\\win.ini",
+        L"C:win.ini",
+        L"D:/dir/file.txt",
+        L"file.txt"};
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(SplitsLikeWSplitPath)
+    {
+        for (const auto szName : kNames)
+        {
+            WCHAR drive[_MAX_DRIVE];
+            WCHAR dir[_MAX_DIR];
+            WCHAR fname[_MAX_FNAME];
+            WCHAR ext[_MAX_EXT];
+            Assert::AreEqual(
+                0,
+                static_cast<int>(
+                    _wsplitpath_s(szName, drive, _MAX_DRIVE, dir, _MAX_DIR, fname, _MAX_FNAME, ext, _MAX_EXT)));
+
+            std::wstring parent = std::wstring(drive) + dir;
+            if (!parent.empty() && parent.back() == L'\\')
+                parent.pop_back();
+
+            Assert::AreEqual(std::wstring(fname) + ext, std::wstring(FileInfo::FileNameOf(szName)), szName);
+            Assert::AreEqual(parent, std::wstring(FileInfo::ParentNameOf(szName)), szName);
+            Assert::AreEqual(std::wstring(ext), std::wstring(FileInfo::ExtensionOf(szName)), szName);
+        }
+    }
+
+    TEST_METHOD(NoAllocation)
+    {
+        size_t length = 0;
+
+        g_allocations = 0;
+        g_countedThreadId = GetCurrentThreadId();
+        const auto previousHook = _CrtSetAllocHook(CountAllocations);
+
+        for (size_t i = 0; i < 100000; ++i)
+        {
+            const std::wstring_view name = kNames[i % std::size(kNames)];
+            length += FileInfo::FileNameOf(name).size() + FileInfo::ParentNameOf(name).size()
+                + FileInfo::ExtensionOf(name).size();
+        }
+
+        _CrtSetAllocHook(previousHook);
+        g_countedThreadId = 0L;
+
+        Assert::IsTrue(length > 0);
+        Assert::AreEqual(static_cast<size_t>(0), g_allocations);
+    }
+};
+}  // namespace Orc::Test
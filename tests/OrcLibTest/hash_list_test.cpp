@@ -0,0 +1,85 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "HashList.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(HashListTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static CBinaryBuffer FromHex(std::string_view hex)
+    {
+        CBinaryBuffer buffer;
+        Assert::IsTrue(buffer.SetCount(hex.size() / 2));
+        for (size_t i = 0; i < buffer.GetCount(); ++i)
+        {
+            buffer.Get<BYTE>(i) = static_cast<BYTE>(std::stoul(std::string(hex.substr(2 * i, 2)), nullptr, 16));
+        }
+        return buffer;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(LookupByAlgorithm)
+    {
+        using Algorithm = CryptoHashStreamAlgorithm;
+
+        HashList list;
+        Assert::IsTrue(S_OK
+                       == list.Parse("# feed\r\n"
+                                     "d41d8cd98f00b204e9800998ecf8427e\r\n"
+                                     "\r\n"
+                                     "DA39A3EE5E6B4B0D3255BFEF95601890AFD80709, malware.exe\r\n"
+                                     "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855\r\n"
+                                     "not a hash\r\n"
+                                     "d41d8cd98f00b204e9800998ecf8427"));
+
+        Assert::AreEqual(static_cast<size_t>(3), list.Count());
+        Assert::AreEqual(static_cast<size_t>(2), list.InvalidLines());
+        Assert::IsTrue(list.Algorithms() == (Algorithm::MD5 | Algorithm::SHA1 | Algorithm::SHA256));
+
+        Assert::IsTrue(list.Contains(Algorithm::MD5, FromHex("d41d8cd98f00b204e9800998ecf8427e")));
+        Assert::IsTrue(list.Contains(Algorithm::SHA1, FromHex("da39a3ee5e6b4b0d3255bfef95601890afd80709")));
+        Assert::IsTrue(list.Contains(
+            Algorithm::SHA256, FromHex("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855")));
+
+        Assert::IsFalse(list.Contains(Algorithm::MD5, FromHex("d41d8cd98f00b204e9800998ecf8427f")));
+        Assert::IsFalse(list.Contains(Algorithm::SHA1, FromHex("d41d8cd98f00b204e9800998ecf8427e")));
+
+        // Some entries have no size: no size is rejected
+        Assert::IsFalse(list.RejectsSize(12345));
+    }
+
+    TEST_METHOD(SizesFilterStreams)
+    {
+        HashList list;
+        Assert::IsTrue(S_OK
+                       == list.Parse("d41d8cd98f00b204e9800998ecf8427e 0\n"
+                                     "00000000000000000000000000000001;4096\n"
+                                     "ffffffffffffffffffffffffffffffff\t4096\n"));
+
+        Assert::AreEqual(static_cast<size_t>(3), list.Count());
+        Assert::IsFalse(list.RejectsSize(0));
+        Assert::IsFalse(list.RejectsSize(4096));
+        Assert::IsTrue(list.RejectsSize(4095));
+
+        Assert::IsTrue(list.Contains(CryptoHashStreamAlgorithm::MD5, FromHex("00000000000000000000000000000001")));
+        Assert::IsTrue(list.Contains(CryptoHashStreamAlgorithm::MD5, FromHex("ffffffffffffffffffffffffffffffff")));
+    }
+};
+}  // namespace Orc::Test
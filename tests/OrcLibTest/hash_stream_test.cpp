@@ -7,8 +7,10 @@
 //
 #include "stdafx.h"
 
+#include "Blake3Hash.h"
 #include "CryptoHashStream.h"
 #include "MemoryStream.h"
+#include "ShaExtensionsHash.h"
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Orc;
@@ -190,5 +192,156 @@ public:
             Assert::IsTrue(!memcmp(md5.GetData(), md5Result, sizeof(md5Result)));
         }
     }
+
+    TEST_METHOD(HashStreamParallelTest)
+    {
+        // One million 'a': large enough for the algorithms to be hashed concurrently
+        std::vector<BYTE> data(1000000, 'a');
+        Assert::IsTrue(data.size() >= CryptoHashStream::kParallelHashThreshold);
+
+        const BYTE md5Result[16] = {
+            0x77, 0x07, 0xD6, 0xAE, 0x4E, 0x02, 0x7C, 0x70, 0xEE, 0xA2, 0xA9, 0x35, 0xC2, 0x29, 0x6F, 0x21};
+        const BYTE sha1Result[20] = {
+            0x34, 0xAA, 0x97, 0x3C, 0xD4, 0xC4, 0xDA, 0xA4, 0xF6, 0x1E, 0xEB, 0x2B, 0xDB, 0xAD, 0x27, 0x31,
+            0x65, 0x34, 0x01, 0x6F};
+        const BYTE sha256Result[32] = {
+            0xCD, 0xC7, 0x6E, 0x5C, 0x99, 0x14, 0xFB, 0x92, 0x81, 0xA1, 0xC7, 0xE2, 0x84, 0xD7, 0x3E, 0x67,
+            0xF1, 0x80, 0x9A, 0x48, 0xA4, 0x97, 0x20, 0x0E, 0x04, 0x6D, 0x39, 0xCC, 0xC7, 0x11, 0x2C, 0xD0};
+
+        auto algs = CryptoHashStream::Algorithm::MD5 | CryptoHashStream::Algorithm::SHA1 | CryptoHashStream::Algorithm::SHA256;
+
+        // Single write, then many small writes which are hashed sequentially
+        for (const size_t cbChunk : {data.size(), size_t(4093)})
+        {
+            auto hashstream = std::make_shared<CryptoHashStream>();
+            Assert::IsTrue(S_OK == hashstream->OpenToWrite(algs, nullptr));
+
+            for (size_t offset = 0; offset < data.size(); offset += cbChunk)
+            {
+                ULONGLONG ullHashed = 0LL;
+                const auto cbWrite = std::min(cbChunk, data.size() - offset);
+                Assert::IsTrue(S_OK == hashstream->Write(data.data() + offset, cbWrite, &ullHashed));
+            }
+
+            CBinaryBuffer md5, sha1, sha256;
+            Assert::IsTrue(S_OK == hashstream->GetHash(CryptoHashStream::Algorithm::MD5, md5));
+            Assert::IsTrue(S_OK == hashstream->GetHash(CryptoHashStream::Algorithm::SHA1, sha1));
+            Assert::IsTrue(S_OK == hashstream->GetHash(CryptoHashStream::Algorithm::SHA256, sha256));
+
+            Assert::IsTrue(md5.GetCount() == sizeof(md5Result));
+            Assert::IsTrue(!memcmp(md5.GetData(), md5Result, sizeof(md5Result)));
+            Assert::IsTrue(sha1.GetCount() == sizeof(sha1Result));
+            Assert::IsTrue(!memcmp(sha1.GetData(), sha1Result, sizeof(sha1Result)));
+            Assert::IsTrue(sha256.GetCount() == sizeof(sha256Result));
+            Assert::IsTrue(!memcmp(sha256.GetData(), sha256Result, sizeof(sha256Result)));
+        }
+    }
+
+    TEST_METHOD(ShaExtensionsHashTest)
+    {
+        if (!ShaExtensionsHash::IsSupported())
+        {
+            Logger::WriteMessage(L"SHA extensions are not available on this processor, test skipped");
+            return;
+        }
+
+        // FIPS 180 two block message: padding does not fit in the first block
+        const std::string_view message("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq");
+        const BYTE sha1Result[20] = {
+            0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE, 0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5,
+            0xE5, 0x46, 0x70, 0xF1};
+        const BYTE sha256Result[32] = {
+            0x24, 0x8D, 0x6A, 0x61, 0xD2, 0x06, 0x38, 0xB8, 0xE5, 0xC0, 0x26, 0x93, 0x0C, 0x3E, 0x60, 0x39,
+            0xA3, 0x3C, 0xE4, 0x59, 0x64, 0xFF, 0x21, 0x67, 0xF6, 0xEC, 0xED, 0xD4, 0x19, 0xDB, 0x06, 0xC1};
+
+        {
+            ShaExtensionsHash sha1(ShaExtensionsHash::Algorithm::SHA1);
+            sha1.Update(reinterpret_cast<const BYTE*>(message.data()), message.size());
+
+            BYTE digest[20] = {0};
+            Assert::IsTrue(sha1.DigestSize() == sizeof(digest));
+            sha1.Digest(digest);
+            Assert::IsTrue(!memcmp(digest, sha1Result, sizeof(sha1Result)));
+        }
+
+        {
+            ShaExtensionsHash sha256(ShaExtensionsHash::Algorithm::SHA256);
+            sha256.Update(reinterpret_cast<const BYTE*>(message.data()), message.size());
+
+            BYTE digest[32] = {0};
+            Assert::IsTrue(sha256.DigestSize() == sizeof(digest));
+            sha256.Digest(digest);
+            Assert::IsTrue(!memcmp(digest, sha256Result, sizeof(sha256Result)));
+        }
+
+        // Every length around the padding boundaries, hashed in one go and byte per byte
+        std::vector<BYTE> data(200);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<BYTE>(i * 7 + 3);
+
+        for (const auto alg : {ShaExtensionsHash::Algorithm::SHA1, ShaExtensionsHash::Algorithm::SHA256})
+        {
+            for (size_t cbData = 0; cbData <= data.size(); cbData++)
+            {
+                ShaExtensionsHash oneShot(alg);
+                ShaExtensionsHash byteWise(alg);
+
+                oneShot.Update(data.data(), cbData);
+                for (size_t i = 0; i < cbData; i++)
+                    byteWise.Update(data.data() + i, 1);
+
+                BYTE oneShotDigest[32] = {0}, byteWiseDigest[32] = {0};
+                oneShot.Digest(oneShotDigest);
+                byteWise.Digest(byteWiseDigest);
+                Assert::IsTrue(!memcmp(oneShotDigest, byteWiseDigest, oneShot.DigestSize()));
+            }
+        }
+    }
+
+    TEST_METHOD(Blake3HashTest)
+    {
+        // Reference test vectors: the input bytes are 'i % 251'
+        const std::pair<size_t, std::wstring_view> vectors[] = {
+            {0, L"AF1349B9F5F9A1A6A0404DEA36DCC9499BCB25C9ADC112B7CC9A93CAE41F3262"},
+            {1, L"2D3ADEDFF11B61F14C886E35AFA036736DCD87A74D27B5C1510225D0F592E213"},
+            {1024, L"42214739F095A406F3FC83DEB889744AC00DF831C10DAA55189B5D121C855AF7"},
+            {1025, L"D00278AE47EB27B34FAECF67B4FE263F82D5412916C1FFD97C8CB7FB814B8444"},
+            {2048, L"E776B6028C7CD22A4D0BA182A8BF62205D2EF576467E838ED6F2529B85FBA24A"},
+            {8192, L"AAE792484C8EFE4F19E2CA7D371D8C467FFB10748D8A5A1AE579948F718A2A63"},
+            {102400, L"BC3E3D41A1146B069ABFFAD3C0D44860CF664390AFCE4D9661F7902E7943E085"}};
+
+        std::vector<BYTE> data(102400);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = static_cast<BYTE>(i % 251);
+
+        for (const auto& [cbData, expected] : vectors)
+        {
+            auto hashstream = std::make_shared<CryptoHashStream>();
+            Assert::IsTrue(SUCCEEDED(hashstream->OpenToWrite(CryptoHashStream::Algorithm::BLAKE3, nullptr)));
+
+            ULONGLONG ullHashed = 0LL;
+            Assert::IsTrue(SUCCEEDED(hashstream->Write(data.data(), cbData, &ullHashed)));
+
+            std::wstring hash;
+            Assert::IsTrue(SUCCEEDED(hashstream->GetHash(CryptoHashStream::Algorithm::BLAKE3, hash)));
+            Assert::AreEqual(std::wstring(expected), hash);
+        }
+
+        // Chunks are hashed several at a time from large updates: it must not depend on how the data is split
+        for (const size_t cbUpdate : {size_t(1), size_t(63), size_t(1000), size_t(4097)})
+        {
+            Blake3Hash oneShot;
+            Blake3Hash split;
+
+            oneShot.Update(data.data(), data.size());
+            for (size_t offset = 0; offset < data.size(); offset += cbUpdate)
+                split.Update(data.data() + offset, std::min(cbUpdate, data.size() - offset));
+
+            BYTE oneShotDigest[32] = {0}, splitDigest[32] = {0};
+            oneShot.Digest(oneShotDigest);
+            split.Digest(splitDigest);
+            Assert::IsTrue(!memcmp(oneShotDigest, splitDigest, sizeof(oneShotDigest)));
+        }
+    }
 };
 }  // namespace Orc::Test
@@ -0,0 +1,106 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "HostProfile.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+constexpr ULONGLONG kGB = 1024 * 1024 * 1024ULL;
+
+HostProfile::Measures MakeMeasures(ULONG ulProcessors, ULONGLONG ullMemory, bool bSeekPenalty, ULONGLONG ullProbe)
+{
+    HostProfile::Measures measures;
+    measures.Processors = ulProcessors;
+    measures.PhysicalMemory = ullMemory;
+    measures.bSeekPenalty = bSeekPenalty;
+    measures.ProbeThroughput = ullProbe;
+    return measures;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(HostProfileTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(HostProfileDefault)
+    {
+        HostProfile profile;
+        Assert::IsTrue(profile.IsDefault());
+        Assert::AreEqual(0UL, profile.Threads());
+        Assert::AreEqual(0UL, profile.RowGroupSize());
+        Assert::IsTrue(profile.ReadProfile().IsDefault());
+    }
+
+    TEST_METHOD(HostProfileSmallVirtualMachine)
+    {
+        // 2 vCPUs, 1GB, virtual disk reported as rotational
+        const auto profile = HostProfile::Derive(MakeMeasures(2, kGB / 4 * 3, true, 80 * 1024 * 1024ULL));
+
+        Assert::AreEqual(2UL, profile.Threads());
+        Assert::AreEqual(2UL, profile.ReadProfile().QueueDepth());
+        Assert::AreEqual(64 * 1024 * 1024ULL, profile.CacheSize());
+        Assert::AreEqual(5000UL, profile.RowGroupSize());
+
+        // Not enough memory for a worker per processor
+        Assert::AreEqual(1UL, HostProfile::Derive(MakeMeasures(8, kGB / 8, true, 0LL)).Threads());
+    }
+
+    TEST_METHOD(HostProfileStorageServer)
+    {
+        // 64 cores, 256GB, NVMe
+        const auto profile = HostProfile::Derive(MakeMeasures(64, 256 * kGB, false, 3 * kGB));
+
+        Assert::AreEqual(64UL, profile.Threads());
+        Assert::AreEqual(16UL, profile.ReadProfile().QueueDepth());
+        Assert::AreEqual(kGB, profile.CacheSize());
+        Assert::AreEqual(50000UL, profile.RowGroupSize());
+
+        // Solid state disk which could not be probed
+        Assert::AreEqual(8UL, HostProfile::Derive(MakeMeasures(64, 256 * kGB, false, 0LL)).ReadProfile().QueueDepth());
+    }
+
+    TEST_METHOD(HostProfileRoundTrip)
+    {
+        const auto profile = HostProfile::Derive(MakeMeasures(8, 8 * kGB, false, 500 * 1024 * 1024ULL));
+        Assert::AreEqual(
+            L"threads:8,read:1048576:8,cache:536870912,row_group:10000", profile.ToString().c_str());
+
+        const auto parsed = HostProfile::FromString(profile.ToString());
+        Assert::IsTrue(parsed.has_value());
+        Assert::AreEqual(profile.Threads(), parsed->Threads());
+        Assert::AreEqual(profile.ReadProfile().ChunkSize(), parsed->ReadProfile().ChunkSize());
+        Assert::AreEqual(profile.ReadProfile().QueueDepth(), parsed->ReadProfile().QueueDepth());
+        Assert::AreEqual(profile.CacheSize(), parsed->CacheSize());
+        Assert::AreEqual(profile.RowGroupSize(), parsed->RowGroupSize());
+    }
+
+    TEST_METHOD(HostProfileInvalid)
+    {
+        Assert::IsFalse(HostProfile::FromString(L"").has_value());
+        Assert::IsFalse(HostProfile::FromString(L"threads:8").has_value());
+        Assert::IsFalse(HostProfile::FromString(L"threads:0,read:1048576:8,cache:1024,row_group:10").has_value());
+        Assert::IsFalse(HostProfile::FromString(L"threads:8,read:1000:8,cache:1024,row_group:10").has_value());
+        Assert::IsFalse(HostProfile::FromString(L"threads:8,read:1048576:8,cache:1KB,row_group:10").has_value());
+        Assert::IsFalse(
+            HostProfile::FromString(L"threads:8,read:1048576:8,cache:1024,row_group:10,queue:4").has_value());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,76 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "IoGovernor.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(IoGovernorTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static void Run(IoGovernor& governor, ULONGLONG ullBytes, std::chrono::microseconds duration, ULONG ulWindows)
+    {
+        for (ULONG i = 0; i < ulWindows * IoGovernor::kReadsPerWindow; i++)
+        {
+            governor.Record(ullBytes, duration);
+        }
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(IoGovernorDisabled)
+    {
+        IoGovernor governor;
+        Assert::IsFalse(governor.IsEnabled());
+
+        Run(governor, 4096, std::chrono::seconds(1), 4);
+        Assert::AreEqual(0LL, governor.Delay().count());
+        Assert::AreEqual(S_FALSE, governor.SetLowPriority(INVALID_HANDLE_VALUE));
+    }
+
+    TEST_METHOD(IoGovernorBacksOffAndRecovers)
+    {
+        IoGovernor governor(std::chrono::milliseconds(20));
+
+        Run(governor, 4096, std::chrono::milliseconds(5), 4);
+        Assert::AreEqual(0LL, governor.Delay().count());
+
+        // Busy device: the delay doubles each window up to the maximum
+        Run(governor, 4096, std::chrono::milliseconds(100), 4);
+        Assert::IsTrue(governor.Delay() >= IoGovernor::kMinDelay);
+        const auto busyDelay = governor.Delay();
+
+        Run(governor, 4096, std::chrono::milliseconds(100), 32);
+        Assert::AreEqual(IoGovernor::kMaxDelay.count(), governor.Delay().count());
+        Assert::IsTrue(governor.Delay() > busyDelay);
+
+        // Idle device: the delay is halved each window down to none
+        Run(governor, 4096, std::chrono::milliseconds(1), 32);
+        Assert::AreEqual(0LL, governor.Delay().count());
+        Assert::IsTrue(governor.Recoveries() > 0);
+    }
+
+    TEST_METHOD(IoGovernorIgnoresTransferTime)
+    {
+        // 4MB reads at 200MB/s: the time of their first reference size bytes is well under the limit
+        IoGovernor governor(std::chrono::milliseconds(20));
+        Run(governor, 4 * 1024 * 1024, std::chrono::milliseconds(20), 8);
+        Assert::AreEqual(0LL, governor.Delay().count());
+        Assert::AreEqual(0UL, governor.Backoffs());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,110 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "IoTrace.h"
+#include "Telemetry.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(IoTraceTest)
+{
+private:
+    UnitTestHelper helper;
+
+    std::wstring m_path;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        std::wstring tempPath;
+        tempPath.resize(MAX_PATH);
+        const auto length = GetTempPathW(static_cast<DWORD>(tempPath.size()), tempPath.data());
+        Assert::IsTrue(length > 0);
+        tempPath.resize(length);
+        m_path = tempPath + L"\\io_trace_test.iotrace";
+    }
+
+    TEST_METHOD_CLEANUP(Finalize) { DeleteFileW(m_path.c_str()); }
+
+    TEST_METHOD(IoTraceRoundTrip)
+    {
+        IoTrace trace;
+        trace.RecordRead(L"\\\\.\\C:", 0LL, 512LL);
+        Assert::IsFalse(trace.IsEnabled());
+
+        Assert::IsTrue(SUCCEEDED(trace.Open(m_path)));
+        Assert::IsTrue(trace.IsEnabled());
+
+        trace.RecordRead(L"\\\\.\\C:", 0LL, 4096LL);
+        {
+            Telemetry::Scope scope(Telemetry::Phase::MFTWalk);
+            trace.RecordRead(L"\\\\.\\C:", 4096LL, 1024LL);
+            trace.RecordRead(L"image.dd", 1024 * 1024LL, 65536LL);
+        }
+
+        DWORD dwOtherThread = 0L;
+        std::thread([&]() {
+            dwOtherThread = GetCurrentThreadId();
+            trace.RecordRead(L"image.dd", 512LL, 512LL);
+        }).join();
+
+        Assert::IsTrue(SUCCEEDED(trace.Close()));
+        Assert::IsFalse(trace.IsEnabled());
+
+        IoTrace::Trace loaded;
+        Assert::IsTrue(SUCCEEDED(IoTrace::Load(m_path, loaded)));
+
+        Assert::AreEqual(static_cast<size_t>(2), loaded.Locations.size());
+        Assert::AreEqual(L"\\\\.\\C:", loaded.Locations[0].c_str());
+        Assert::AreEqual(L"image.dd", loaded.Locations[1].c_str());
+
+        Assert::AreEqual(static_cast<size_t>(4), loaded.Reads.size());
+
+        const auto& first = loaded.Reads[0];
+        Assert::AreEqual(0ULL, first.Offset);
+        Assert::AreEqual(4096UL, first.Length);
+        Assert::AreEqual(static_cast<WORD>(0), first.Location);
+        Assert::AreEqual(GetCurrentThreadId(), first.ThreadId);
+        Assert::AreEqual(static_cast<UCHAR>(Telemetry::Phase::Count), first.Subsystem);
+
+        Assert::AreEqual(4096ULL, loaded.Reads[1].Offset);
+        Assert::AreEqual(static_cast<UCHAR>(Telemetry::Phase::MFTWalk), loaded.Reads[1].Subsystem);
+
+        Assert::AreEqual(1024 * 1024ULL, loaded.Reads[2].Offset);
+        Assert::AreEqual(65536UL, loaded.Reads[2].Length);
+        Assert::AreEqual(static_cast<WORD>(1), loaded.Reads[2].Location);
+
+        Assert::AreEqual(dwOtherThread, loaded.Reads[3].ThreadId);
+        Assert::AreEqual(static_cast<WORD>(1), loaded.Reads[3].Location);
+
+        for (size_t i = 1; i < loaded.Reads.size(); i++)
+            Assert::IsTrue(loaded.Reads[i - 1].Timestamp <= loaded.Reads[i].Timestamp);
+    }
+
+    TEST_METHOD(IoTraceInvalid)
+    {
+        HANDLE hFile = CreateFileW(
+            m_path.c_str(), GENERIC_WRITE, 0L, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, NULL);
+        Assert::IsTrue(hFile != INVALID_HANDLE_VALUE);
+
+        const char garbage[] = "not an I/O trace, not an I/O trace";
+        DWORD dwWritten = 0L;
+        Assert::IsTrue(WriteFile(hFile, garbage, sizeof(garbage), &dwWritten, NULL));
+        CloseHandle(hFile);
+
+        IoTrace::Trace loaded;
+        Assert::IsTrue(FAILED(IoTrace::Load(m_path, loaded)));
+    }
+};
+}  // namespace Orc::Test
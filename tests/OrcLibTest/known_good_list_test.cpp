@@ -0,0 +1,125 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "KnownGoodList.h"
+#include "MemoryStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(KnownGoodListTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::shared_ptr<MemoryStream> MakeStream(size_t size, BYTE seed)
+    {
+        std::vector<BYTE> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<BYTE>(seed + i * 31 + (i >> 7));
+        }
+
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(S_OK == stream->OpenForReadWrite(static_cast<DWORD>(size)));
+
+        ULONGLONG ullWritten = 0LL;
+        Assert::IsTrue(S_OK == stream->Write(data.data(), data.size(), &ullWritten));
+        Assert::IsTrue(S_OK == stream->SetFilePointer(0, FILE_BEGIN, nullptr));
+        return stream;
+    }
+
+    static std::string ToHex(const CBinaryBuffer& buffer)
+    {
+        std::string hex;
+        for (size_t i = 0; i < buffer.GetCount(); ++i)
+        {
+            hex += fmt::format("{:02x}", buffer.Get<BYTE>(i));
+        }
+        return hex;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(LookupBySizeAndName)
+    {
+        using Lookup = KnownGoodList::Lookup;
+
+        KnownGoodList list;
+        Assert::IsTrue(S_OK
+                       == list.Parse("# reference set\r\n"
+                                     "245760\tkernel32.dll\r\n"
+                                     "\r\n"
+                                     "16384, Program Manager.exe\r\n"
+                                     "16384;notepad.exe\r\n"
+                                     "16384;notepad.exe\r\n"
+                                     "not a size, file.txt\r\n"
+                                     "1024\r\n"
+                                     "512, short.dll, 0123"));
+
+        Assert::AreEqual(static_cast<size_t>(3), list.Count());
+        Assert::AreEqual(static_cast<size_t>(3), list.InvalidLines());
+
+        Assert::IsTrue(list.Find(245760, L"kernel32.dll") == Lookup::KnownGood);
+        Assert::IsTrue(list.Find(245760, L"KERNEL32.DLL") == Lookup::KnownGood);
+        Assert::IsTrue(list.Find(16384, L"program manager.exe") == Lookup::KnownGood);
+        Assert::IsTrue(list.Find(16384, L"NotePad.exe") == Lookup::KnownGood);
+
+        Assert::IsTrue(list.Find(245761, L"kernel32.dll") == Lookup::Unknown);
+        Assert::IsTrue(list.Find(245760, L"kernel33.dll") == Lookup::Unknown);
+        Assert::IsTrue(list.Find(16384, L"kernel32.dll") == Lookup::Unknown);
+    }
+
+    TEST_METHOD(HeadHashOfStreams)
+    {
+        using Lookup = KnownGoodList::Lookup;
+
+        auto good = MakeStream(3 * KnownGoodList::kHeadSize / 2, 7);
+        auto small = MakeStream(100, 11);
+        auto tampered = MakeStream(3 * KnownGoodList::kHeadSize / 2, 8);
+
+        CBinaryBuffer goodHead, smallHead;
+        Assert::IsTrue(S_OK == KnownGoodList::HashHead(*good, goodHead));
+        Assert::IsTrue(S_OK == KnownGoodList::HashHead(*small, smallHead));
+        Assert::AreEqual(static_cast<size_t>(BYTES_IN_SHA1_HASH), goodHead.GetCount());
+
+        const auto text = fmt::format(
+            "{}\tsvchost.exe\t{}\n{}\tsmall.ini\t{}\n",
+            good->GetSize(),
+            ToHex(goodHead),
+            small->GetSize(),
+            ToHex(smallHead));
+
+        KnownGoodList list;
+        Assert::IsTrue(S_OK == list.Parse(text));
+        Assert::AreEqual(static_cast<size_t>(2), list.Count());
+
+        Assert::IsTrue(list.Find(good->GetSize(), L"svchost.exe") == Lookup::NeedsHeadHash);
+        Assert::IsTrue(list.ContainsHead(good->GetSize(), L"svchost.exe", goodHead));
+        Assert::IsFalse(list.ContainsHead(good->GetSize(), L"svchost.exe", smallHead));
+
+        Assert::IsTrue(list.Contains(L"svchost.exe", *good));
+        Assert::IsTrue(list.Contains(L"SMALL.INI", *small));
+        Assert::IsFalse(list.Contains(L"svchost.exe", *tampered));
+        Assert::IsFalse(list.Contains(L"small.ini", *good));
+
+        // The head is read from the start of the stream, which is rewound
+        BYTE first = 0;
+        ULONGLONG ullRead = 0LL;
+        Assert::IsTrue(S_OK == tampered->Read(&first, 1, &ullRead));
+        Assert::AreEqual(1ULL, ullRead);
+        Assert::AreEqual(static_cast<BYTE>(8), first);
+    }
+};
+}  // namespace Orc::Test
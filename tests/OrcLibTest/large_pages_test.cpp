@@ -0,0 +1,105 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "LargePages.h"
+#include "BinaryBuffer.h"
+#include "MemoryStream.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(LargePagesTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    // Test processes usually do not hold SeLockMemoryPrivilege: both paths must give usable memory
+    TEST_METHOD(PreferredSize)
+    {
+        const auto cbLargePage = LargePages::Minimum();
+        if (cbLargePage == 0)
+        {
+            Assert::AreEqual(static_cast<size_t>(3 * 1024 * 1024), LargePages::PreferredSize(3 * 1024 * 1024));
+            return;
+        }
+
+        Assert::AreEqual(static_cast<size_t>(4096), LargePages::PreferredSize(4096));
+        Assert::AreEqual(cbLargePage, LargePages::PreferredSize(cbLargePage / 2));
+        Assert::AreEqual(2 * cbLargePage, LargePages::PreferredSize(cbLargePage + 1));
+    }
+
+    TEST_METHOD(Allocator)
+    {
+        const size_t cbSize = 3 * 1024 * 1024;
+
+        std::vector<uint8_t, LargePages::Allocator<uint8_t>> buffer(LargePages::Allocator<uint8_t>(true));
+        buffer.resize(cbSize);
+        buffer[0] = 0xAA;
+        buffer[cbSize - 1] = 0xBB;
+
+        // Moves keep the allocator so that the memory is released the way it was allocated
+        std::vector<uint8_t, LargePages::Allocator<uint8_t>> moved;
+        moved = std::move(buffer);
+        Assert::IsTrue(moved.get_allocator().UsesLargePages());
+        Assert::AreEqual(static_cast<uint8_t>(0xBB), moved[cbSize - 1]);
+
+        moved.resize(2 * cbSize);
+        Assert::AreEqual(static_cast<uint8_t>(0xAA), moved[0]);
+    }
+
+    TEST_METHOD(BinaryBufferFallback)
+    {
+        const size_t cbSize = 3 * 1024 * 1024;
+
+        CBinaryBuffer buffer(true);
+        Assert::IsTrue(buffer.ReserveLargePages(LargePages::PreferredSize(cbSize)));
+        Assert::IsTrue(buffer.GetCapacity() >= cbSize);
+
+        const BYTE* pointer = buffer.GetData();
+        Assert::IsTrue(buffer.CheckCount(cbSize));
+        Assert::IsTrue(buffer.GetData() == pointer);
+
+        buffer[cbSize - 1] = 0xCC;
+        Assert::IsTrue(buffer.SetCount(2 * buffer.GetCapacity()));
+        Assert::IsTrue(buffer[cbSize - 1] == 0xCC);
+    }
+
+    TEST_METHOD(MemoryStreamGrowth)
+    {
+        MemoryStream stream;
+        Assert::AreEqual(S_OK, stream.OpenForReadWrite());
+
+        // Grows past the exponential threshold and the default reservation, relocating the buffer
+        std::vector<BYTE> chunk(20 * 1024 * 1024, 0x5A);
+        for (int i = 0; i < 8; i++)
+        {
+            ULONGLONG ullWritten = 0;
+            Assert::AreEqual(S_OK, stream.Write(chunk.data(), chunk.size(), &ullWritten));
+            Assert::AreEqual(static_cast<ULONGLONG>(chunk.size()), ullWritten);
+        }
+
+        Assert::AreEqual(8ULL * chunk.size(), stream.GetSize());
+
+        BYTE value = 0;
+        ULONGLONG ullRead = 0;
+        Assert::AreEqual(S_OK, stream.SetFilePointer(8LL * chunk.size() - 1, FILE_BEGIN, nullptr));
+        Assert::AreEqual(S_OK, stream.Read(&value, 1, &ullRead));
+        Assert::AreEqual(1ULL, ullRead);
+        Assert::AreEqual(static_cast<BYTE>(0x5A), value);
+    }
+};
+}  // namespace Orc::Test
@@ -9,6 +9,9 @@
 
 #include "LocationSet.h"
 
+#include <filesystem>
+#include <fstream>
+
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 
 using namespace Orc;
@@ -107,6 +110,43 @@ public:
         Assert::IsTrue(S_OK == aSet.PrintLocationsByVolume(false));
     }
 
+    TEST_METHOD(BatchManifest)
+    {
+        std::wstring tempPath;
+        tempPath.resize(MAX_PATH);
+        const auto length = GetTempPathW(static_cast<DWORD>(tempPath.size()), tempPath.data());
+        Assert::IsTrue(length > 0);
+        tempPath.resize(length);
+
+        const std::filesystem::path directory = std::filesystem::path(tempPath) / L"batch_manifest_test";
+        std::filesystem::create_directories(directory);
+
+        const auto manifest = directory / L"manifest.txt";
+        {
+            std::ofstream ofs(manifest, std::ios_base::binary);
+            ofs << "\xEF\xBB\xBF# collected MFTs\r\n"
+                << "host1\\$MFT\r\n"
+                << "\r\n"
+                << "   C:\\cases\\host2\\$MFT   \n"
+                << "image.dd,offset=1048576\n";
+        }
+
+        std::vector<std::wstring> locations;
+        Assert::IsTrue(SUCCEEDED(LocationSet::ParseLocationsFromBatch(manifest.wstring(), locations)));
+        Assert::AreEqual(static_cast<size_t>(3), locations.size());
+        Assert::AreEqual((directory / L"host1\\$MFT").wstring(), locations[0]);
+        Assert::AreEqual(std::wstring(L"C:\\cases\\host2\\$MFT"), locations[1]);
+        Assert::AreEqual((directory / L"image.dd,offset=1048576").wstring(), locations[2]);
+
+        // A directory batch lists its files
+        locations.clear();
+        Assert::IsTrue(SUCCEEDED(LocationSet::ParseLocationsFromBatch(directory.wstring(), locations)));
+        Assert::AreEqual(static_cast<size_t>(1), locations.size());
+        Assert::AreEqual(manifest.wstring(), locations[0]);
+
+        std::filesystem::remove_all(directory);
+    }
+
 private:
 };
 }  // namespace Orc::Test
@@ -0,0 +1,190 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "NTFSCompression.h"
+#include "Filesystem/Ntfs/Compression/Engine/Lznt1/Lznt1Decompressor.h"
+#include "Filesystem/Ntfs/Compression/Engine/Nt/NtApi.h"
+
+#include <chrono>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(Lznt1Test)
+{
+private:
+    UnitTestHelper helper;
+
+    static constexpr size_t kUnitSize = 64 * 1024;  // Largest NTFS compression unit
+
+    // Text like repetitions, runs of a single byte (offset 1 matches) and random bytes (stored chunks)
+    static std::vector<uint8_t> MakeUnit(unsigned seed)
+    {
+        std::mt19937 rng(seed);
+        std::vector<uint8_t> unit;
+        unit.reserve(kUnitSize);
+
+        const std::string_view words[] = {"NTFS ", "compression ", "unit ", "LZNT1 ", "chunk ", "\r\n"};
+        while (unit.size() < kUnitSize / 2)
+        {
+            const auto word = words[rng() % std::size(words)];
+            unit.insert(std::end(unit), std::cbegin(word), std::cend(word));
+        }
+
+        unit.insert(std::end(unit), 5000, static_cast<uint8_t>(rng()));
+
+        while (unit.size() < kUnitSize)
+        {
+            unit.push_back(static_cast<uint8_t>(rng()));
+        }
+
+        unit.resize(kUnitSize);
+        return unit;
+    }
+
+    static std::vector<uint8_t> Compress(std::vector<uint8_t>& unit)
+    {
+        constexpr USHORT format = COMPRESSION_FORMAT_LZNT1 | COMPRESSION_ENGINE_STANDARD;
+
+        std::error_code ec;
+        ULONG workspaceSize = 0L, fragmentWorkspaceSize = 0L;
+        RtlGetCompressionWorkSpaceSize(format, &workspaceSize, &fragmentWorkspaceSize, ec);
+        Assert::IsFalse((bool)ec, L"Failed RtlGetCompressionWorkSpaceSize");
+
+        std::vector<uint8_t> workspace(workspaceSize);
+        std::vector<uint8_t> compressed(kUnitSize + kUnitSize / 8);
+
+        ULONG compressedSize = 0L;
+        RtlCompressBuffer(
+            format,
+            unit.data(),
+            static_cast<ULONG>(unit.size()),
+            compressed.data(),
+            static_cast<ULONG>(compressed.size()),
+            4096,
+            &compressedSize,
+            workspace.data(),
+            ec);
+        Assert::IsFalse((bool)ec, L"Failed RtlCompressBuffer");
+
+        compressed.resize(compressedSize);
+        return compressed;
+    }
+
+    template <typename Decompress>
+    static double Throughput(size_t cbUnit, Decompress decompress)
+    {
+        constexpr auto kIterations = 200;
+
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIterations; ++i)
+        {
+            decompress();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        return (static_cast<double>(cbUnit) * kIterations) / (1024.0 * 1024.0) / elapsed.count();
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(DecompressMatchesInput)
+    {
+        for (unsigned seed = 0; seed < 8; ++seed)
+        {
+            auto unit = MakeUnit(seed);
+            const auto compressed = Compress(unit);
+
+            std::vector<uint8_t> output(kUnitSize);
+            std::error_code ec;
+            const auto decoded = Lznt1Decompress(compressed, output, ec);
+            Assert::IsFalse((bool)ec, L"Failed Lznt1Decompress");
+            Assert::AreEqual(kUnitSize, decoded);
+            Assert::IsTrue(output == unit, L"Decompressed unit does not match its input");
+        }
+    }
+
+    TEST_METHOD(ShortChunkIsZeroPadded)
+    {
+        // Two compressed chunks of literals: "abc" then "d", the first one is padded to 4096 bytes
+        const uint8_t compressed[] = {0x03, 0xB0, 0x00, 'a', 'b', 'c', 0x01, 0xB0, 0x00, 'd', 0x00, 0x00};
+
+        std::vector<uint8_t> output(2 * 4096, 0xCC);
+        std::error_code ec;
+        const auto decoded = Lznt1Decompress(compressed, output, ec);
+        Assert::IsFalse((bool)ec, L"Failed Lznt1Decompress");
+        Assert::AreEqual(size_t(4097), decoded);
+
+        Assert::AreEqual(uint8_t('c'), output[2]);
+        Assert::IsTrue(std::all_of(&output[3], &output[4096], [](uint8_t b) { return b == 0; }));
+        Assert::AreEqual(uint8_t('d'), output[4096]);
+    }
+
+    TEST_METHOD(InvalidBackReferenceFails)
+    {
+        // A back reference as the very first token of a chunk has nothing to copy from
+        const uint8_t compressed[] = {0x02, 0xB0, 0x01, 0x00, 0x00};
+
+        std::vector<uint8_t> output(4096);
+        std::error_code ec;
+        Lznt1Decompress(compressed, output, ec);
+        Assert::IsTrue((bool)ec);
+    }
+
+    // Wimlib does not implement LZNT1: compare with the Nt API and the previous (Sleuthkit) decoder
+    TEST_METHOD(Benchmark)
+    {
+        auto unit = MakeUnit(42);
+        auto compressed = Compress(unit);
+        std::vector<uint8_t> output(kUnitSize);
+
+        const auto orc = Throughput(kUnitSize, [&]() {
+            std::error_code ec;
+            Lznt1Decompress(compressed, output, ec);
+        });
+
+        const auto nt = Throughput(kUnitSize, [&]() {
+            std::error_code ec;
+            ULONG processed = 0L;
+            RtlDecompressBuffer(
+                COMPRESSION_FORMAT_LZNT1,
+                output.data(),
+                static_cast<ULONG>(output.size()),
+                compressed.data(),
+                static_cast<ULONG>(compressed.size()),
+                &processed,
+                ec);
+        });
+
+        const auto sleuthkit = Throughput(kUnitSize, [&]() {
+            NTFS_COMP_INFO info;
+            info.buf_size_b = kUnitSize;
+            info.comp_buf = reinterpret_cast<char*>(compressed.data());
+            info.comp_len = compressed.size();
+            info.uncomp_buf = reinterpret_cast<char*>(output.data());
+            info.uncomp_idx = 0L;
+            ntfs_uncompress_compunit(&info);
+        });
+
+        Logger::WriteMessage(
+            fmt::format(
+                "LZNT1 decompression (MB/s): Lznt1Decompress: {:.0f}, RtlDecompressBuffer: {:.0f}, Sleuthkit: {:.0f}\n",
+                orc,
+                nt,
+                sleuthkit)
+                .c_str());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,138 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MappedFileView.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MappedFileViewTest)
+{
+private:
+    UnitTestHelper helper;
+
+    std::wstring m_path;
+    HANDLE m_hFile = INVALID_HANDLE_VALUE;
+    DWORD m_dwGranularity = 0L;
+    std::vector<BYTE> m_content;
+
+    static BYTE Expected(size_t offset) { return static_cast<BYTE>((offset * 7) ^ (offset >> 16)); }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        m_dwGranularity = info.dwAllocationGranularity;
+
+        // Several windows and a partial one at the end of the file
+        m_content.resize(3 * m_dwGranularity + 123);
+        for (size_t i = 0; i < m_content.size(); i++)
+            m_content[i] = Expected(i);
+
+        std::wstring tempPath;
+        tempPath.resize(MAX_PATH);
+        const auto length = GetTempPathW(static_cast<DWORD>(tempPath.size()), tempPath.data());
+        Assert::IsTrue(length > 0);
+        tempPath.resize(length);
+        m_path = tempPath + L"\\mapped_file_view_test.bin";
+
+        m_hFile = CreateFileW(
+            m_path.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ,
+            NULL,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY,
+            NULL);
+        Assert::IsTrue(m_hFile != INVALID_HANDLE_VALUE);
+
+        DWORD dwWritten = 0L;
+        Assert::IsTrue(WriteFile(m_hFile, m_content.data(), static_cast<DWORD>(m_content.size()), &dwWritten, NULL));
+        Assert::AreEqual(static_cast<DWORD>(m_content.size()), dwWritten);
+    }
+
+    TEST_METHOD_CLEANUP(Finalize)
+    {
+        if (m_hFile != INVALID_HANDLE_VALUE)
+            CloseHandle(m_hFile);
+        DeleteFileW(m_path.c_str());
+    }
+
+    TEST_METHOD(MappedFileViewWindowSize)
+    {
+        MappedFileView view(1);
+        Assert::AreEqual(static_cast<ULONGLONG>(m_dwGranularity), view.WindowSize());
+
+        MappedFileView larger(m_dwGranularity + 1);
+        Assert::AreEqual(2ULL * m_dwGranularity, larger.WindowSize());
+    }
+
+    TEST_METHOD(MappedFileViewAcrossWindows)
+    {
+        MappedFileView view(m_dwGranularity);
+        Assert::IsTrue(SUCCEEDED(view.Open(m_hFile)));
+        Assert::AreEqual(static_cast<ULONGLONG>(m_content.size()), view.FileSize());
+
+        // A view straddling two windows is mapped as a whole
+        const ULONGLONG offset = m_dwGranularity - 512;
+        BYTE* pData = nullptr;
+        Assert::IsTrue(SUCCEEDED(view.View(offset, 1024, pData)));
+        Assert::IsTrue(pData != nullptr);
+        for (size_t i = 0; i < 1024; i++)
+            Assert::AreEqual(Expected(static_cast<size_t>(offset) + i), pData[i]);
+
+        // The last bytes of the file
+        Assert::IsTrue(SUCCEEDED(view.View(m_content.size() - 123, 123, pData)));
+        Assert::AreEqual(Expected(m_content.size() - 1), pData[122]);
+
+        Assert::IsTrue(FAILED(view.View(m_content.size() - 123, 124, pData)));
+        Assert::IsTrue(pData == nullptr);
+    }
+
+    TEST_METHOD(MappedFileViewRead)
+    {
+        MappedFileView view(m_dwGranularity);
+        Assert::IsTrue(SUCCEEDED(view.Open(m_hFile)));
+
+        // Reads larger than a window, truncated at the end of the file
+        std::vector<BYTE> buffer(m_content.size() + 4096);
+        size_t cbRead = 0;
+        Assert::IsTrue(SUCCEEDED(view.Read(17, buffer.data(), buffer.size(), cbRead)));
+        Assert::AreEqual(m_content.size() - 17, cbRead);
+        Assert::IsTrue(memcmp(buffer.data(), m_content.data() + 17, cbRead) == 0);
+
+        Assert::IsTrue(SUCCEEDED(view.Read(m_content.size(), buffer.data(), buffer.size(), cbRead)));
+        Assert::AreEqual(static_cast<size_t>(0), cbRead);
+    }
+
+    TEST_METHOD(MappedFileViewCopyOnWrite)
+    {
+        MappedFileView view(m_dwGranularity);
+        Assert::IsTrue(SUCCEEDED(view.Open(m_hFile)));
+
+        BYTE* pData = nullptr;
+        Assert::IsTrue(SUCCEEDED(view.View(4096, 16, pData)));
+        pData[0] = static_cast<BYTE>(~Expected(4096));
+        Assert::AreEqual(static_cast<BYTE>(~Expected(4096)), pData[0]);
+
+        // The written page is private to the view, the file is unchanged
+        view.Close();
+
+        BYTE b = 0;
+        DWORD dwRead = 0L;
+        OVERLAPPED overlapped = {0};
+        overlapped.Offset = 4096;
+        Assert::IsTrue(ReadFile(m_hFile, &b, 1, &dwRead, &overlapped));
+        Assert::AreEqual(Expected(4096), b);
+    }
+};
+}  // namespace Orc::Test
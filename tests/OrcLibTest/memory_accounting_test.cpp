@@ -0,0 +1,101 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MemoryAccounting.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MemoryAccountingTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static MemoryAccounting::Usage Get(MemoryAccounting::Tag tag)
+    {
+        return MemoryAccounting::GetStatistics()[static_cast<size_t>(tag)];
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(AllocationTracksCurrentAndPeak)
+    {
+        const auto before = Get(MemoryAccounting::Tag::TableWrite);
+
+        {
+            MemoryAccounting::Allocation allocation(MemoryAccounting::Tag::TableWrite);
+            allocation.Set(4096);
+            allocation.Set(1024);
+            Assert::AreEqual(before.Current + 1024, Get(MemoryAccounting::Tag::TableWrite).Current);
+
+            auto moved = std::move(allocation);
+            Assert::AreEqual(0ULL, allocation.Bytes());
+            Assert::AreEqual(1024ULL, moved.Bytes());
+        }
+
+        const auto after = Get(MemoryAccounting::Tag::TableWrite);
+        Assert::AreEqual(before.Current, after.Current);
+        Assert::IsTrue(after.Peak >= before.Current + 4096);
+    }
+
+    TEST_METHOD(SoftLimit)
+    {
+        const auto tag = MemoryAccounting::Tag::Yara;
+        const auto current = Get(tag).Current;
+        const auto overBefore = Get(tag).OverSoftLimit;
+
+        MemoryAccounting::SetSoftLimit(tag, current + 1000);
+
+        Assert::IsTrue(MemoryAccounting::Charge(tag, 1000));
+        Assert::IsFalse(MemoryAccounting::IsOverSoftLimit(tag));
+
+        Assert::IsFalse(MemoryAccounting::Charge(tag, 1));
+        Assert::IsTrue(MemoryAccounting::IsOverSoftLimit(tag));
+        Assert::AreEqual(overBefore + 1, Get(tag).OverSoftLimit);
+
+        MemoryAccounting::Release(tag, 1001);
+        Assert::IsFalse(MemoryAccounting::IsOverSoftLimit(tag));
+
+        MemoryAccounting::SetSoftLimit(tag, 0LL);
+    }
+
+    TEST_METHOD(ConfigureSoftLimits)
+    {
+        Assert::AreEqual(S_OK, MemoryAccounting::ConfigureSoftLimits(L"mft_walk:2MB, file_find:512K"));
+        Assert::AreEqual(2ULL * 1024 * 1024, MemoryAccounting::GetSoftLimit(MemoryAccounting::Tag::MFTWalk));
+        Assert::AreEqual(512ULL * 1024, MemoryAccounting::GetSoftLimit(MemoryAccounting::Tag::FileFind));
+
+        Assert::IsTrue(FAILED(MemoryAccounting::ConfigureSoftLimits(L"heap:1MB")));
+        Assert::IsTrue(FAILED(MemoryAccounting::ConfigureSoftLimits(L"yara")));
+
+        Assert::AreEqual(S_OK, MemoryAccounting::ConfigureSoftLimits(L"mft_walk:0,file_find:0"));
+        Assert::AreEqual(0ULL, MemoryAccounting::GetSoftLimit(MemoryAccounting::Tag::MFTWalk));
+    }
+
+    TEST_METHOD(CountingResource)
+    {
+        const auto tag = MemoryAccounting::Tag::FileFind;
+        const auto before = Get(tag).Current;
+
+        {
+            std::pmr::vector<ULONGLONG> values(MemoryAccounting::GetResource(tag));
+            values.reserve(1000);
+            Assert::IsTrue(Get(tag).Current >= before + 1000 * sizeof(ULONGLONG));
+        }
+
+        Assert::AreEqual(before, Get(tag).Current);
+    }
+};
+}  // namespace Orc::Test
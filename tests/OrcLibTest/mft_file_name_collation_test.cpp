@@ -0,0 +1,53 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTUtils.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MFTFileNameCollationTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(MFTFileNameCollationOrder)
+    {
+        Assert::AreEqual(0, MFTUtils::CollateFileNames(L"ntuser.dat", L"NTUSER.DAT"));
+        Assert::AreEqual(0, MFTUtils::CollateFileNames(L"", L""));
+
+        // Names are compared upper cased: 's' (as 'S') is before '_', 'é' (as 'É') after it
+        const std::vector<std::wstring> sorted = {
+            L"", L"$MFT", L"abc", L"ABCD", L"abd", L"système32", L"_abc", L"été"};
+
+        for (size_t i = 0; i < sorted.size(); i++)
+        {
+            for (size_t j = 0; j < sorted.size(); j++)
+            {
+                const auto collation = MFTUtils::CollateFileNames(sorted[i], sorted[j]);
+                const auto message = sorted[i] + L" / " + sorted[j];
+
+                if (i < j)
+                    Assert::IsTrue(collation < 0, message.c_str());
+                else if (i > j)
+                    Assert::IsTrue(collation > 0, message.c_str());
+                else
+                    Assert::AreEqual(0, collation, message.c_str());
+            }
+        }
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,79 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTUtils.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MFTInUseRecordsTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(MFTInUseRecordSpans)
+    {
+        // Records 0-3, 5, 30-31 and 40 are in use
+        MFTUtils::InUseRecords inUse(48);
+        for (const auto record : {0, 1, 2, 3, 5, 30, 31, 40})
+            inUse.set(record);
+
+        auto span = MFTUtils::GetInUseRecordSpan(inUse, 0, 48, 64, 8);
+        Assert::AreEqual(0ULL, span.First);
+        Assert::AreEqual(6ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 6, 48, 64, 8);
+        Assert::AreEqual(30ULL, span.First);
+        Assert::AreEqual(2ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 6, 48, 64, 16);
+        Assert::AreEqual(30ULL, span.First);
+        Assert::AreEqual(11ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 30, 48, 4, 8);
+        Assert::AreEqual(30ULL, span.First);
+        Assert::AreEqual(2ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 0, 48, 64, 1);
+        Assert::AreEqual(0ULL, span.First);
+        Assert::AreEqual(4ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 41, 48, 64, 8);
+        Assert::AreEqual(0ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(inUse, 6, 30, 64, 8);
+        Assert::AreEqual(0ULL, span.Count);
+    }
+
+    TEST_METHOD(MFTInUseRecordsBeyondBitmap)
+    {
+        MFTUtils::InUseRecords inUse(8);
+        inUse.set(2);
+
+        Assert::IsTrue(MFTUtils::IsRecordInUse(inUse, 2));
+        Assert::IsFalse(MFTUtils::IsRecordInUse(inUse, 7));
+        Assert::IsTrue(MFTUtils::IsRecordInUse(inUse, 8));
+
+        auto span = MFTUtils::GetInUseRecordSpan(inUse, 3, 12, 64, 16);
+        Assert::AreEqual(8ULL, span.First);
+        Assert::AreEqual(4ULL, span.Count);
+
+        span = MFTUtils::GetInUseRecordSpan(MFTUtils::InUseRecords(), 0, 12, 64, 16);
+        Assert::AreEqual(0ULL, span.First);
+        Assert::AreEqual(12ULL, span.Count);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,190 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTRecordBatch.h"
+#include "NtfsDataStructures.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+constexpr ULONG kBytesPerFRS = 1024;
+constexpr ULONG kBytesPerSector = 512;
+constexpr WORD kArrayOffset = 0x30;
+constexpr WORD kSequenceNumber = 0x1234;
+
+using Status = MFTRecordBatch::Status;
+
+// Last word of a sector as read from the disk, a corrupted record has a torn second sector
+WORD SectorTail(Status status, ULONG sector)
+{
+    return status == Status::Corrupted && sector == 1 ? static_cast<WORD>(kSequenceNumber + 1) : kSequenceNumber;
+}
+
+// Record 'index' of 'data' as written on disk: the last word of each sector is replaced by the sequence number
+void WriteRecord(std::vector<BYTE>& data, ULONG index, Status status)
+{
+    auto p = data.data() + static_cast<size_t>(index) * kBytesPerFRS;
+    if (status == Status::NoSignature)
+        return;
+
+    memcpy(p, "FILE", 4);
+    memcpy(p + offsetof(MULTI_SECTOR_HEADER, UpdateSequenceArrayOffset), &kArrayOffset, sizeof(WORD));
+
+    const WORD wFlags = status == Status::Free ? 0 : FILE_RECORD_SEGMENT_IN_USE;
+    memcpy(p + offsetof(FILE_RECORD_SEGMENT_HEADER, Flags), &wFlags, sizeof(WORD));
+
+    memcpy(p + kArrayOffset, &kSequenceNumber, sizeof(WORD));
+    for (ULONG i = 0; i < kBytesPerFRS / kBytesPerSector; i++)
+    {
+        // Original content of the sector end, saved in the update sequence array
+        const WORD wSaved = static_cast<WORD>(index * 16 + i);
+        memcpy(p + kArrayOffset + (i + 1) * sizeof(WORD), &wSaved, sizeof(WORD));
+
+        const WORD wTail = SectorTail(status, i);
+        memcpy(p + (i + 1) * kBytesPerSector - sizeof(WORD), &wTail, sizeof(WORD));
+    }
+}
+
+WORD SectorEnd(const std::vector<BYTE>& data, ULONG index, ULONG sector)
+{
+    WORD wValue = 0;
+    memcpy(
+        &wValue,
+        data.data() + static_cast<size_t>(index) * kBytesPerFRS + (sector + 1) * kBytesPerSector - sizeof(WORD),
+        sizeof(WORD));
+    return wValue;
+}
+
+// Statuses of a batch covering full groups of 8 records and a tail
+const std::vector<Status> kStatuses = {
+    // Mixed group
+    Status::InUse,
+    Status::Free,
+    Status::NoSignature,
+    Status::Corrupted,
+    Status::InUse,
+    Status::InUse,
+    Status::Free,
+    Status::NoSignature,
+    // Empty group
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    Status::NoSignature,
+    // Tail
+    Status::InUse,
+    Status::Corrupted,
+    Status::Free,
+    Status::InUse};
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(MFTRecordBatchTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::vector<BYTE> MakeBatch()
+    {
+        std::vector<BYTE> data(kStatuses.size() * kBytesPerFRS, 0);
+        for (ULONG i = 0; i < kStatuses.size(); i++)
+            WriteRecord(data, i, kStatuses[i]);
+        return data;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(Validate)
+    {
+        auto data = MakeBatch();
+
+        // Update sequence array past the first sector
+        const WORD wOutOfBounds = 0x1FE;
+        memcpy(
+            data.data() + 5 * kBytesPerFRS + offsetof(MULTI_SECTOR_HEADER, UpdateSequenceArrayOffset),
+            &wOutOfBounds,
+            sizeof(WORD));
+
+        std::vector<Status> status;
+        MFTRecordBatch::Validate(
+            data.data(), static_cast<ULONG>(kStatuses.size()), kBytesPerFRS, kBytesPerSector, status);
+
+        Assert::AreEqual(kStatuses.size(), status.size());
+        for (size_t i = 0; i < kStatuses.size(); i++)
+        {
+            const auto expected = i == 5 ? Status::Corrupted : kStatuses[i];
+            Assert::IsTrue(expected == status[i]);
+        }
+    }
+
+    TEST_METHOD(Fixup)
+    {
+        for (const bool bKeepFree : {false, true})
+        {
+            auto data = MakeBatch();
+
+            std::vector<MFTRecordBatch::Record> records;
+            MFTRecordBatch::Statistics statistics;
+            MFTRecordBatch::Fixup(
+                data.data(),
+                static_cast<ULONG>(kStatuses.size()),
+                kBytesPerFRS,
+                kBytesPerSector,
+                bKeepFree,
+                records,
+                statistics);
+
+            Assert::AreEqual(10ULL, statistics.NoSignature);
+            Assert::AreEqual(2ULL, statistics.Corrupted);
+            Assert::AreEqual(3ULL, statistics.Free);
+            Assert::AreEqual(5ULL, statistics.InUse);
+
+            std::vector<ULONG> expected;
+            for (ULONG i = 0; i < kStatuses.size(); i++)
+            {
+                if (kStatuses[i] == Status::InUse || kStatuses[i] == Status::Corrupted
+                    || (bKeepFree && kStatuses[i] == Status::Free))
+                    expected.push_back(i);
+            }
+
+            Assert::AreEqual(expected.size(), records.size());
+            for (size_t i = 0; i < records.size(); i++)
+            {
+                const auto index = records[i].Index;
+                Assert::AreEqual(expected[i], index);
+                Assert::AreEqual(kStatuses[index] != Status::Corrupted, records[i].bFixed);
+
+                for (ULONG sector = 0; sector < kBytesPerFRS / kBytesPerSector; sector++)
+                {
+                    const WORD wSaved = static_cast<WORD>(index * 16 + sector);
+                    const WORD wExpected = records[i].bFixed ? wSaved : SectorTail(kStatuses[index], sector);
+                    Assert::AreEqual(wExpected, SectorEnd(data, index, sector));
+                }
+            }
+
+            // Free records which are not kept are left as they are
+            if (!bKeepFree)
+                Assert::AreEqual(kSequenceNumber, SectorEnd(data, 1, 0));
+        }
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,66 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTSegmentTable.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MFTSegmentTableTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(MFTSegmentTableBasic)
+    {
+        MFTSegmentTable<int*> table;
+        table.reserve(10000);
+
+        int value = 42;
+        const ULONGLONG garbage = 0x0000ABCD00000005LLU;
+
+        Assert::IsTrue(table.find(5) == table.end());
+        Assert::IsTrue(table.insert({5, &value}).second);
+        Assert::IsFalse(table.insert({5, nullptr}).second);
+        Assert::IsTrue(table.insert({8191, nullptr}).second);
+        Assert::IsTrue(table.insert({garbage, &value}).second);
+        Assert::AreEqual((size_t)3, table.size());
+
+        // A null value is still present, as with std::unordered_map
+        Assert::IsTrue(table.find(8191) != table.end());
+        Assert::IsTrue(table.find(8191)->second == nullptr);
+        Assert::IsTrue(table.find(5)->second == &value);
+        Assert::IsTrue(table.find(garbage)->second == &value);
+
+        table[5] = nullptr;
+        Assert::IsTrue(table.find(5)->second == nullptr);
+
+        // Iteration is ordered by segment number, overflow entries last
+        std::vector<ULONGLONG> keys;
+        for (const auto& [key, pValue] : table)
+            keys.push_back(key);
+
+        Assert::AreEqual((size_t)3, keys.size());
+        Assert::AreEqual(5LLU, keys[0]);
+        Assert::AreEqual(8191LLU, keys[1]);
+        Assert::AreEqual(garbage, keys[2]);
+
+        const auto& constTable = table;
+        Assert::IsTrue(constTable.find(6) == constTable.end());
+        Assert::IsTrue(constTable.find(8191) != constTable.end());
+    }
+};
+}  // namespace Orc::Test
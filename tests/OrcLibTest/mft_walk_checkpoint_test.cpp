@@ -0,0 +1,149 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "MFTWalkCheckpoint.h"
+#include "FileStream.h"
+
+#include <filesystem>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(MFTWalkCheckpointTest)
+{
+private:
+    UnitTestHelper helper;
+    std::filesystem::path m_path;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        m_path = std::filesystem::temp_directory_path() / L"mft_walk_checkpoint_test.bin";
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    TEST_METHOD_CLEANUP(Finalize)
+    {
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    TEST_METHOD(MissingCheckpointIsEmpty)
+    {
+        MFTWalkCheckpoint checkpoint;
+        Assert::IsTrue(S_FALSE == checkpoint.Load(m_path));
+        Assert::IsTrue(checkpoint.Locations().empty());
+        Assert::IsTrue(checkpoint.Outputs().empty());
+    }
+
+    TEST_METHOD(RecordSet)
+    {
+        MFTWalkCheckpoint::RecordSet records;
+        Assert::IsTrue(records.IsEmpty());
+        Assert::IsFalse(records.Contains(0));
+
+        records.Insert(0);
+        records.Insert(63);
+        records.Insert(64);
+        records.Insert(1000000);
+        records.Insert(64);
+
+        Assert::AreEqual(4ULL, records.Count());
+        Assert::IsTrue(records.Contains(0));
+        Assert::IsTrue(records.Contains(63));
+        Assert::IsTrue(records.Contains(64));
+        Assert::IsTrue(records.Contains(1000000));
+        Assert::IsFalse(records.Contains(1));
+        Assert::IsFalse(records.Contains(999999));
+        Assert::IsFalse(records.Contains(1ULL << 40));
+    }
+
+    TEST_METHOD(SaveAndLoad)
+    {
+        MFTWalkCheckpoint checkpoint;
+
+        MFTWalkCheckpoint::Location inProgress;
+        for (ULONGLONG ullRecord = 0; ullRecord < 200; ullRecord += 3)
+            inProgress.Records.Insert(ullRecord);
+        checkpoint.Set(L"Volume_C", inProgress);
+
+        MFTWalkCheckpoint::Location complete;
+        complete.bComplete = true;
+        checkpoint.Set(L"Shadow_{5C6E0D4B}", complete);
+
+        checkpoint.SetOutput(L"C:\\Temp\\NTFSInfo_Volume_C.csv", 0x12345678ULL);
+        checkpoint.SetOutput(L"C:\\Temp\\NTFSInfo_Shadow_{5C6E0D4B}.csv", 4096ULL);
+        checkpoint.SetOutput(L"C:\\Temp\\NTFSInfo_Volume_C.csv", 0x23456789ULL);
+
+        Assert::IsTrue(S_OK == checkpoint.Save(m_path));
+        Assert::IsFalse(std::filesystem::exists(std::filesystem::path(m_path) += L".tmp"));
+
+        MFTWalkCheckpoint loaded;
+        Assert::IsTrue(S_OK == loaded.Load(m_path));
+        Assert::AreEqual(static_cast<size_t>(2), loaded.Locations().size());
+        Assert::IsTrue(loaded.Find(L"Volume_D") == nullptr);
+
+        const auto pInProgress = loaded.Find(L"Volume_C");
+        Assert::IsTrue(pInProgress != nullptr);
+        Assert::IsFalse(pInProgress->bComplete);
+        Assert::AreEqual(67ULL, pInProgress->Records.Count());
+        Assert::IsTrue(pInProgress->Records.Contains(198));
+        Assert::IsFalse(pInProgress->Records.Contains(199));
+
+        const auto pComplete = loaded.Find(L"Shadow_{5C6E0D4B}");
+        Assert::IsTrue(pComplete != nullptr);
+        Assert::IsTrue(pComplete->bComplete);
+        Assert::IsTrue(pComplete->Records.IsEmpty());
+
+        Assert::AreEqual(static_cast<size_t>(2), loaded.Outputs().size());
+        const auto pSize = loaded.FindOutput(L"C:\\Temp\\NTFSInfo_Volume_C.csv");
+        Assert::IsTrue(pSize != nullptr);
+        Assert::AreEqual(0x23456789ULL, *pSize);
+        Assert::IsTrue(loaded.FindOutput(L"C:\\Temp\\NTFSInfo_Volume_D.csv") == nullptr);
+    }
+
+    TEST_METHOD(SaveReplacesPreviousCheckpoint)
+    {
+        MFTWalkCheckpoint checkpoint;
+        checkpoint.Set(L"Volume_C", MFTWalkCheckpoint::Location {});
+        checkpoint.SetOutput(L"NTFSInfo.csv", 1024ULL);
+        Assert::IsTrue(S_OK == checkpoint.Save(m_path));
+
+        checkpoint.ClearOutputs();
+        Assert::IsTrue(S_OK == checkpoint.Save(m_path));
+
+        MFTWalkCheckpoint loaded;
+        Assert::IsTrue(S_OK == loaded.Load(m_path));
+        Assert::AreEqual(static_cast<size_t>(1), loaded.Locations().size());
+        Assert::IsTrue(loaded.Outputs().empty());
+    }
+
+    TEST_METHOD(CorruptedCheckpointIsRejected)
+    {
+        {
+            FileStream stream;
+            Assert::IsTrue(S_OK == stream.WriteTo(m_path.c_str()));
+
+            // One location whose record set claims more words than the file holds
+            const BYTE garbage[] = {
+                'O', 'M', 'C', 'P', 1, 0, 0, 0, 1, 0, 0, 0, 1, 0, 'C', 0, 0, 0xFF, 0xFF, 0, 0, 0, 0, 0, 0};
+            ULONGLONG ullWritten = 0LL;
+            Assert::IsTrue(S_OK == stream.Write((PVOID)garbage, sizeof(garbage), &ullWritten));
+            stream.Close();
+        }
+
+        MFTWalkCheckpoint checkpoint;
+        Assert::IsTrue(HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == checkpoint.Load(m_path));
+        Assert::IsTrue(checkpoint.Locations().empty());
+    }
+};
+}  // namespace Orc::Test
@@ -44,12 +44,43 @@ public:
         DeleteFile(m_ArchiveItem.Path.c_str());
     };
 
+    TEST_METHOD(MFTWalkerPipelinedTest)
+    {
+        for (const bool bOutOfOrder : {false, true})
+        {
+            m_NbFiles = 0;
+            m_NbFolders = 0;
+            ProcessArchive(helper.GetDirectoryName(__WFILE__) + L"\\ntfs_images\\ntfs.7z", 4, bOutOfOrder);
+
+            Assert::IsTrue(m_NbFiles == 0x16);
+            Assert::IsTrue(m_NbFolders == 0x9);
+
+            DeleteFile(m_ArchiveItem.Path.c_str());
+        }
+    };
+
+    TEST_METHOD(MFTWalkerVisitorTest)
+    {
+        m_NbFiles = 0;
+        m_NbFolders = 0;
+        ProcessArchive(helper.GetDirectoryName(__WFILE__) + L"\\ntfs_images\\ntfs.7z", 0L, false, true);
+
+        Assert::IsTrue(m_NbFiles == 0x16);
+        Assert::IsTrue(m_NbFolders == 0x9);
+
+        DeleteFile(m_ArchiveItem.Path.c_str());
+    };
+
 private:
     DWORD64 m_NbFiles;
     DWORD64 m_NbFolders;
     OrcArchive::ArchiveItem m_ArchiveItem;
 
-    void ProcessArchive(const std::wstring& archive)
+    void ProcessArchive(
+        const std::wstring& archive,
+        DWORD dwWorkers = 0L,
+        bool bOutOfOrder = false,
+        bool bVisitor = false)
     {
         // first extract archive
         LPCWSTR archiveStr = archive.c_str();
@@ -82,12 +113,10 @@ private:
                                                 MFTRecord* pElt,
                                                 const PFILE_NAME pFileName,
                                                 const std::shared_ptr<DataAttribute>& pDataAttr) {
-            using namespace std::string_literals;
-
             std::vector<Filter> empty;
             Authenticode authenticode;
             MFTRecordFileInfo fi(
-                L"Test"s,
+                L"Test",
                 volreader,
                 Intentions::FILEINFO_ALL,
                 empty,
@@ -117,8 +146,26 @@ private:
                                           const PFILE_NAME pFileName,
                                           const std::shared_ptr<IndexAllocationAttribute>& pAttr) { m_NbFolders++; };
 
+        // Same counts from a visitor, with references instead of shared pointers
+        struct Counter
+        {
+            DWORD64& NbFiles;
+            DWORD64& NbFolders;
+
+            void OnFileNameAndData(VolumeReader&, MFTRecord&, const PFILE_NAME, DataAttribute&) { NbFiles++; }
+            void OnDirectory(VolumeReader&, MFTRecord&, const PFILE_NAME, IndexAllocationAttribute*) { NbFolders++; }
+        };
+
+        walker.SetPipeline(dwWorkers, bOutOfOrder);
+
         Assert::IsTrue(S_OK == walker.Initialize(loc, ResurrectRecordsMode::kNo));
-        Assert::IsTrue(S_OK == walker.Walk(callBacks));
+        if (bVisitor)
+        {
+            Counter counter {m_NbFiles, m_NbFolders};
+            Assert::IsTrue(S_OK == walker.Walk(counter));
+        }
+        else
+            Assert::IsTrue(S_OK == walker.Walk(callBacks));
 
         ntfsImageStream->Close();
     }
@@ -0,0 +1,114 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "PagedStreamView.h"
+#include "MemoryStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(PagedStreamViewTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static constexpr size_t kChunkSize = 64 * 1024;
+
+    static BYTE Expected(size_t offset) { return static_cast<BYTE>(offset * 31 + (offset >> 12)); }
+
+    static std::shared_ptr<MemoryStream> MakeStream(size_t size)
+    {
+        std::vector<BYTE> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = Expected(i);
+        }
+
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(S_OK == stream->OpenForReadWrite(static_cast<DWORD>(size)));
+
+        ULONGLONG ullWritten = 0LL;
+        Assert::IsTrue(S_OK == stream->Write(data.data(), data.size(), &ullWritten));
+        Assert::IsTrue(S_OK == stream->SetFilePointer(0, FILE_BEGIN, nullptr));
+        return stream;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(OnlyTouchedChunksAreRead)
+    {
+        const size_t size = 10 * kChunkSize + 4096;
+        auto stream = MakeStream(size);
+
+        PagedStreamView view;
+        Assert::IsTrue(S_OK == view.Open(*stream, kChunkSize));
+        Assert::AreEqual(static_cast<ULONG64>(size), view.Size());
+
+        const auto pData = view.Data();
+        const auto ullBefore = stream->TotalRead();
+
+        Assert::AreEqual(Expected(3 * kChunkSize + 17), pData[3 * kChunkSize + 17]);
+        Assert::AreEqual(static_cast<uint64_t>(kChunkSize), stream->TotalRead() - ullBefore);
+
+        // Same chunk: no read
+        Assert::AreEqual(Expected(3 * kChunkSize), pData[3 * kChunkSize]);
+        Assert::AreEqual(static_cast<uint64_t>(kChunkSize), stream->TotalRead() - ullBefore);
+
+        // Last, partial, chunk
+        Assert::AreEqual(Expected(size - 1), pData[size - 1]);
+        Assert::AreEqual(static_cast<uint64_t>(kChunkSize + 4096), stream->TotalRead() - ullBefore);
+
+        Assert::IsTrue(S_OK == view.LastError());
+    }
+
+    TEST_METHOD(ContentMatchesStream)
+    {
+        const size_t size = 5 * kChunkSize;
+        auto stream = MakeStream(size);
+
+        PagedStreamView view;
+        Assert::IsTrue(S_OK == view.Open(*stream, kChunkSize));
+
+        // Reads crossing chunk boundaries, backwards to make sure the order of the faults does not matter
+        const auto pData = view.Data();
+        for (ptrdiff_t i = size - 1; i >= 0; i -= 4093)
+        {
+            Assert::AreEqual(Expected(i), pData[i]);
+        }
+
+        const BYTE boundary[] = {
+            Expected(kChunkSize - 2), Expected(kChunkSize - 1), Expected(kChunkSize), Expected(kChunkSize + 1)};
+        Assert::IsTrue(memcmp(pData + kChunkSize - 2, boundary, sizeof(boundary)) == 0);
+        Assert::IsTrue(S_OK == view.LastError());
+    }
+
+    TEST_METHOD(SeveralViews)
+    {
+        auto first = MakeStream(2 * kChunkSize);
+        auto second = MakeStream(3 * kChunkSize);
+
+        PagedStreamView firstView;
+        PagedStreamView secondView;
+        Assert::IsTrue(S_OK == firstView.Open(*first, kChunkSize));
+        Assert::IsTrue(S_OK == secondView.Open(*second, kChunkSize));
+
+        Assert::AreEqual(Expected(kChunkSize + 1), secondView.Data()[kChunkSize + 1]);
+
+        firstView.Close();
+        Assert::IsTrue(firstView.Data() == nullptr);
+
+        Assert::AreEqual(Expected(2 * kChunkSize + 5), secondView.Data()[2 * kChunkSize + 5]);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,118 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "RegFind.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(RegFindTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::shared_ptr<RegFind::SearchTerm> KeyPathTerm(const std::string& path)
+    {
+        auto term = std::make_shared<RegFind::SearchTerm>();
+        term->m_criteriaRequired = RegFind::SearchTerm::Criteria::KEY_PATH;
+        term->m_strPathName = path;
+        return term;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(KeyPathTrieMatchesPrefixes)
+    {
+        RegFind::KeyPathTrie trie;
+        Assert::IsTrue(trie.empty());
+
+        trie.Add("\\Software\\Microsoft\\Windows\\CurrentVersion\\Run");
+        trie.Add("\\SYSTEM\\Select");
+        Assert::IsFalse(trie.empty());
+
+        Assert::IsTrue(trie.IsOnPath(""));
+        Assert::IsTrue(trie.IsOnPath("\\Software"));
+        Assert::IsTrue(trie.IsOnPath("\\software\\MICROSOFT\\Windows"));
+        Assert::IsTrue(trie.IsOnPath("\\Software\\Microsoft\\Windows\\CurrentVersion\\Run"));
+        Assert::IsTrue(trie.IsOnPath("\\System\\Select"));
+
+        Assert::IsFalse(trie.IsOnPath("\\Software\\Classes"));
+        Assert::IsFalse(trie.IsOnPath("\\Software\\Microsoft\\Windows\\CurrentVersion\\Run\\Sub"));
+        Assert::IsFalse(trie.IsOnPath("\\Software\\Microsoft\\WindowsNT"));
+    }
+
+    TEST_METHOD(RegFindPrunesOnlyExactKeyPaths)
+    {
+        RegFind pruned;
+        pruned.AddSearchTerm(KeyPathTerm("\\Software\\Microsoft"));
+        Assert::IsTrue(pruned.IsWalkPruned());
+
+        auto valueTerm = KeyPathTerm("\\Software\\Run");
+        valueTerm->m_criteriaRequired = static_cast<RegFind::SearchTerm::Criteria>(
+            RegFind::SearchTerm::Criteria::KEY_PATH | RegFind::SearchTerm::Criteria::VALUE_NAME);
+        valueTerm->m_strValueName = "Shell";
+        pruned.AddSearchTerm(valueTerm);
+        Assert::IsTrue(pruned.IsWalkPruned());
+
+        // A key name term can match at any depth
+        auto nameTerm = std::make_shared<RegFind::SearchTerm>();
+        nameTerm->m_criteriaRequired = RegFind::SearchTerm::Criteria::KEY_NAME;
+        nameTerm->m_strKeyName = "Run";
+        pruned.AddSearchTerm(nameTerm);
+        Assert::IsFalse(pruned.IsWalkPruned());
+
+        RegFind regex;
+        auto regexTerm = std::make_shared<RegFind::SearchTerm>();
+        regexTerm->m_criteriaRequired = RegFind::SearchTerm::Criteria::KEY_PATH_REGEX;
+        regex.AddSearchTerm(regexTerm);
+        Assert::IsFalse(regex.IsWalkPruned());
+    }
+
+    TEST_METHOD(RegFindCompilesContainsStrings)
+    {
+        const auto ContainsTerm = [](const std::string& value) {
+            auto term = std::make_shared<RegFind::SearchTerm>();
+            term->m_criteriaRequired = RegFind::SearchTerm::Criteria::DATA_CONTAINS;
+
+            const auto wide = std::wstring(std::cbegin(value), std::cend(value));
+            term->m_DataContentContains.SetData(reinterpret_cast<LPCBYTE>(value.data()), value.size());
+            term->m_WDataContentContains.SetData(
+                reinterpret_cast<LPCBYTE>(wide.data()), wide.size() * sizeof(wchar_t));
+            return term;
+        };
+
+        RegFind find;
+
+        auto mimikatz = ContainsTerm("mimikatz");
+        find.AddSearchTerm(mimikatz);
+        Assert::IsTrue(mimikatz->m_ContainsPattern.has_value());
+        Assert::IsTrue(mimikatz->m_WContainsPattern.has_value());
+        Assert::AreNotEqual(*mimikatz->m_ContainsPattern, *mimikatz->m_WContainsPattern);
+
+        // Terms share the identifiers of identical strings
+        auto same = ContainsTerm("mimikatz");
+        find.AddSearchTerm(same);
+        Assert::AreEqual(*mimikatz->m_ContainsPattern, *same->m_ContainsPattern);
+        Assert::AreEqual(*mimikatz->m_WContainsPattern, *same->m_WContainsPattern);
+
+        auto other = ContainsTerm("psexec");
+        find.AddSearchTerm(other);
+        Assert::AreNotEqual(*mimikatz->m_ContainsPattern, *other->m_ContainsPattern);
+
+        auto keyTerm = KeyPathTerm("\\Software\\Run");
+        find.AddSearchTerm(keyTerm);
+        Assert::IsFalse(keyTerm->m_ContainsPattern.has_value());
+    }
+};
+}  // namespace Orc::Test
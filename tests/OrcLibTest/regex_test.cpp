@@ -0,0 +1,99 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Utils/Regex.h"
+
+using namespace std::string_view_literals;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(RegexTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(RegexAgainstStdRegex)
+    {
+        const std::vector<std::wstring> patterns = {
+            L"[\\d_-]+",
+            L"\\x41b",
+            L"a\\.b",
+            L"[^\\s]+\\.exe",
+            L"C:\\\\Windows\\\\.*",
+            L"\\w+\\s\\w+",
+            L"a{0,3}b",
+            L"Run(Once)?",
+            L"(?:svc|host)+\\d*\\.(exe|dll)",
+            L"^\\bcmd\\b$",
+            L"(?=a)a",
+            L"(a)\\1"};
+
+        const std::vector<std::wstring> inputs = {
+            L"12_-3",
+            L"Ab",
+            L"a.b",
+            L"cmd.exe",
+            L"CMD",
+            L"C:\\Windows\\System32",
+            L"ab cd",
+            L"aaab",
+            L"aaaab",
+            L"RunOnce",
+            L"svchost32.DLL",
+            L"a",
+            L"aa",
+            L""};
+
+        for (const auto& pattern : patterns)
+        {
+            std::wregex reference(pattern, std::regex_constants::icase);
+            WRegex regex(pattern, std::regex_constants::icase);
+
+            for (const auto& input : inputs)
+            {
+                Assert::AreEqual(
+                    std::regex_match(input, reference), regex.Match(input), (pattern + L" / " + input).c_str());
+                Assert::AreEqual(
+                    std::regex_search(input, reference), regex.Search(input), (pattern + L" / " + input).c_str());
+            }
+        }
+    }
+
+    TEST_METHOD(RegexBackends)
+    {
+        Assert::IsTrue(WRegex(L"[a-z]+\\.exe"sv).IsLinear());
+        Assert::IsFalse(WRegex(L"(a)\\1"sv).IsLinear());
+        Assert::IsTrue(WRegex().empty());
+        Assert::IsFalse(WRegex().Match(L""sv));
+
+        auto invalid = []() { WRegex regex(L"(a"sv); };
+        Assert::ExpectException<std::regex_error>(invalid);
+    }
+
+    TEST_METHOD(RegexLinearTime)
+    {
+        // Exponential for a backtracking engine
+        const std::string input(64 * 1024, 'a');
+        Regex regex("(a*)*b"sv);
+
+        Assert::IsTrue(regex.IsLinear());
+        Assert::IsFalse(regex.Match(input));
+        Assert::IsFalse(regex.Search(input));
+        Assert::IsTrue(regex.Match(input + 'b'));
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,178 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "ReorderBuffer.h"
+
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(ReorderBufferTest)
+{
+private:
+    UnitTestHelper helper;
+
+    using Buffer = ReorderBuffer<uint64_t>;
+
+    static Buffer::Sink ToVector(std::vector<uint64_t>& written)
+    {
+        return [&written](uint64_t&& item) {
+            written.push_back(item);
+            return S_OK;
+        };
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(ReorderBufferWritesInSequence)
+    {
+        std::vector<uint64_t> written;
+        Buffer buffer(ToVector(written), 8);
+
+        for (auto i = 0; i < 4; i++)
+        {
+            Assert::AreEqual(static_cast<uint64_t>(i), buffer.NextSequence());
+        }
+
+        Assert::AreEqual(S_OK, buffer.Push(2, 2));
+        Assert::AreEqual(S_OK, buffer.Push(1, 1));
+        Assert::IsTrue(written.empty());
+
+        Assert::AreEqual(S_OK, buffer.Push(0, 0));
+        Assert::AreEqual(size_t(3), written.size());
+
+        Assert::AreEqual(S_OK, buffer.Skip(3));
+        Assert::AreEqual(S_OK, buffer.Flush());
+
+        Assert::IsTrue(written == std::vector<uint64_t> {0, 1, 2});
+
+        const auto stats = buffer.GetStatistics();
+        Assert::AreEqual(3ULL, stats.Written);
+        Assert::AreEqual(1ULL, stats.Skipped);
+        Assert::AreEqual(size_t(2), stats.PeakPending);
+    }
+
+    TEST_METHOD(ReorderBufferConcurrentProducers)
+    {
+        constexpr uint64_t kItems = 20000;
+        constexpr size_t kProducers = 8;
+
+        std::vector<uint64_t> written;
+        Buffer buffer(ToVector(written), 16);
+
+        // Producers take their numbers in turn but push at their own pace, skipping the multiples of 7
+        std::atomic<size_t> failures = 0;
+        std::vector<std::thread> producers;
+        for (size_t i = 0; i < kProducers; i++)
+        {
+            producers.emplace_back([&buffer, &failures, i]() {
+                for (uint64_t item = i; item < kItems; item += kProducers)
+                {
+                    const auto hr = item % 7 == 0 ? buffer.Skip(item) : buffer.Push(item, uint64_t(item));
+                    if (FAILED(hr))
+                        failures++;
+
+                    if (item % 13 == i)
+                        std::this_thread::yield();
+                }
+            });
+        }
+
+        for (auto& producer : producers)
+        {
+            producer.join();
+        }
+
+        Assert::AreEqual(size_t(0), failures.load());
+        Assert::AreEqual(S_OK, buffer.Flush());
+
+        std::vector<uint64_t> expected;
+        for (uint64_t item = 0; item < kItems; item++)
+        {
+            if (item % 7 != 0)
+                expected.push_back(item);
+        }
+
+        Assert::IsTrue(written == expected);
+        Assert::IsTrue(buffer.GetStatistics().PeakPending <= buffer.Window());
+    }
+
+    TEST_METHOD(ReorderBufferWindowWaits)
+    {
+        std::vector<uint64_t> written;
+        Buffer buffer(ToVector(written), 2);
+
+        Assert::AreEqual(S_OK, buffer.Push(1, 1));
+
+        // Item 2 is beyond the window until item 0 is written
+        HRESULT hrLate = E_FAIL;
+        std::thread late([&buffer, &hrLate]() { hrLate = buffer.Push(2, 2); });
+
+        while (buffer.GetStatistics().Waits == 0)
+        {
+            std::this_thread::yield();
+        }
+
+        Assert::IsTrue(written.empty());
+        Assert::AreEqual(S_OK, buffer.Push(0, 0));
+        late.join();
+        Assert::AreEqual(S_OK, hrLate);
+
+        Assert::AreEqual(S_OK, buffer.Flush());
+        Assert::IsTrue(written == std::vector<uint64_t> {0, 1, 2});
+    }
+
+    TEST_METHOD(ReorderBufferFlushIgnoresMissing)
+    {
+        std::vector<uint64_t> written;
+        Buffer buffer(ToVector(written), 8);
+
+        Assert::AreEqual(S_OK, buffer.Push(3, 3));
+        Assert::AreEqual(S_OK, buffer.Push(1, 1));
+        Assert::AreEqual(S_OK, buffer.Flush());
+
+        Assert::IsTrue(written == std::vector<uint64_t> {1, 3});
+
+        // Numbers before the last one written are rejected
+        Assert::AreEqual(E_INVALIDARG, buffer.Push(2, 2));
+    }
+
+    TEST_METHOD(ReorderBufferUnordered)
+    {
+        std::vector<uint64_t> written;
+        Buffer buffer(ToVector(written), 2, Buffer::Mode::Unordered);
+
+        Assert::AreEqual(S_OK, buffer.Push(5, 5));
+        Assert::AreEqual(S_OK, buffer.Push(0, 0));
+        Assert::AreEqual(S_OK, buffer.Skip(1));
+        Assert::AreEqual(S_OK, buffer.Flush());
+
+        Assert::IsTrue(written == std::vector<uint64_t> {5, 0});
+    }
+
+    TEST_METHOD(ReorderBufferSinkFailure)
+    {
+        Buffer buffer([](uint64_t&& item) { return item == 1 ? E_FAIL : S_OK; }, 8);
+
+        Assert::AreEqual(S_OK, buffer.Push(0, 0));
+        Assert::AreEqual(E_FAIL, buffer.Push(1, 1));
+        Assert::AreEqual(E_FAIL, buffer.Push(2, 2));
+        Assert::AreEqual(E_FAIL, buffer.Flush());
+        Assert::AreEqual(3ULL, buffer.GetStatistics().Written);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,151 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "RingQueue.h"
+
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(RingQueueTest)
+{
+private:
+    UnitTestHelper helper;
+
+    // Pops 'count' items, sleeping on 'event' while the queue is empty
+    template <typename Queue, typename T>
+    static void PopAll(Queue& queue, EventCount& event, size_t count, std::vector<T>& popped)
+    {
+        T batch[32];
+        while (popped.size() < count)
+        {
+            const auto dequeued = queue.TryPopBatch(batch, std::size(batch));
+            if (dequeued == 0)
+            {
+                const auto key = event.PrepareWait();
+                if (!queue.Empty())
+                    event.CancelWait();
+                else
+                    event.Wait(key);
+                continue;
+            }
+
+            popped.insert(std::end(popped), batch, batch + dequeued);
+        }
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(RingQueueCapacity)
+    {
+        SpscRingQueue<int> spsc(1000);
+        Assert::AreEqual(size_t(1024), spsc.Capacity());
+
+        MpscRingQueue<int> mpsc(3);
+        Assert::AreEqual(size_t(4), mpsc.Capacity());
+
+        int items[] = {1, 2, 3, 4, 5, 6};
+        Assert::AreEqual(size_t(4), mpsc.TryPushBatch(items, std::size(items)));
+        Assert::IsFalse(mpsc.TryPush(7));
+
+        int popped[6] = {0};
+        Assert::AreEqual(size_t(4), mpsc.TryPopBatch(popped, std::size(popped)));
+        Assert::AreEqual(4, popped[3]);
+        Assert::IsTrue(mpsc.Empty());
+        Assert::IsFalse(mpsc.TryPop().has_value());
+
+        // Cells are reused once the consumer went round
+        Assert::IsTrue(mpsc.TryPush(7));
+        Assert::AreEqual(7, *mpsc.TryPop());
+    }
+
+    TEST_METHOD(RingQueueSingleProducer)
+    {
+        constexpr size_t kItems = 200000;
+
+        SpscRingQueue<size_t> queue(64);
+        EventCount event;
+
+        std::thread producer([&]() {
+            size_t batch[7];
+            for (size_t i = 0; i < kItems;)
+            {
+                const auto count = std::min(std::size(batch), kItems - i);
+                for (size_t j = 0; j < count; ++j)
+                    batch[j] = i + j;
+
+                for (size_t pushed = 0; pushed < count;)
+                    pushed += queue.TryPushBatch(batch + pushed, count - pushed);
+
+                i += count;
+                event.NotifyOne();
+            }
+        });
+
+        std::vector<size_t> popped;
+        PopAll(queue, event, kItems, popped);
+        producer.join();
+
+        for (size_t i = 0; i < kItems; ++i)
+            Assert::AreEqual(i, popped[i]);
+    }
+
+    TEST_METHOD(RingQueueMultipleProducers)
+    {
+        constexpr size_t kProducers = 4;
+        constexpr ULONGLONG kItems = 100000;
+
+        MpscRingQueue<ULONGLONG> queue(128);
+        EventCount event;
+
+        std::vector<std::thread> producers;
+        for (ULONGLONG producer = 0; producer < kProducers; ++producer)
+        {
+            producers.emplace_back([&, producer]() {
+                ULONGLONG batch[5];
+                for (ULONGLONG i = 0; i < kItems;)
+                {
+                    const auto count = std::min<ULONGLONG>(std::size(batch), kItems - i);
+                    for (ULONGLONG j = 0; j < count; ++j)
+                        batch[j] = (producer << 32) | (i + j);
+
+                    for (size_t pushed = 0; pushed < count;)
+                        pushed += queue.TryPushBatch(batch + pushed, static_cast<size_t>(count) - pushed);
+
+                    i += count;
+                    event.NotifyOne();
+                }
+            });
+        }
+
+        std::vector<ULONGLONG> popped;
+        PopAll(queue, event, kProducers * kItems, popped);
+
+        for (auto& producer : producers)
+            producer.join();
+
+        // Items of each producer come out in order
+        std::vector<ULONGLONG> next(kProducers, 0);
+        for (const auto item : popped)
+        {
+            const auto producer = item >> 32;
+            Assert::AreEqual(next[producer], item & 0xFFFFFFFF);
+            next[producer]++;
+        }
+        Assert::IsTrue(queue.Empty());
+    }
+};
+}  // namespace Orc::Test
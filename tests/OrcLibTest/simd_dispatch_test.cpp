@@ -0,0 +1,96 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SimdDispatch.h"
+
+#include <algorithm>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+int Scalar()
+{
+    return 0;
+}
+
+int Sse2()
+{
+    return 1;
+}
+
+int Avx2()
+{
+    return 2;
+}
+
+using KernelFn = int (*)();
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(SimdDispatchTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(SelectsBestSupported)
+    {
+        const auto supported = SimdDispatch::Supported();
+
+        // Implementations are not required to be ordered
+        SimdDispatch::Kernel<KernelFn> kernel(
+            L"test_best",
+            {{SimdDispatch::Level::SSE2, Sse2},
+             {SimdDispatch::Level::Scalar, Scalar},
+             {SimdDispatch::Level::AVX2, Avx2}});
+
+        const int expected =
+            supported >= SimdDispatch::Level::AVX2 ? 2 : (supported >= SimdDispatch::Level::SSE2 ? 1 : 0);
+        Assert::AreEqual(expected, kernel.Get()());
+        Assert::IsTrue(kernel.Selected() <= supported);
+
+        const auto selections = SimdDispatch::GetSelections();
+        Assert::IsTrue(std::any_of(std::cbegin(selections), std::cend(selections), [&](const auto& selection) {
+            return selection.Name == L"test_best" && selection.Selected == kernel.Selected();
+        }));
+    }
+
+    TEST_METHOD(ForcedScalar)
+    {
+        Assert::AreEqual(S_OK, SimdDispatch::Configure(SimdDispatch::Level::Scalar));
+        Assert::IsTrue(SimdDispatch::Level::Scalar == SimdDispatch::Supported());
+
+        SimdDispatch::Kernel<KernelFn> kernel(
+            L"test_scalar", {{SimdDispatch::Level::AVX2, Avx2}, {SimdDispatch::Level::Scalar, Scalar}});
+        Assert::AreEqual(0, kernel.Get()());
+
+        Assert::AreEqual(S_OK, SimdDispatch::Configure(SimdDispatch::Level::AVX512));
+    }
+
+    TEST_METHOD(LevelNames)
+    {
+        for (size_t i = 0; i < static_cast<size_t>(SimdDispatch::Level::Count); i++)
+        {
+            const auto level = static_cast<SimdDispatch::Level>(i);
+            const auto parsed = SimdDispatch::FromString(SimdDispatch::ToString(level));
+            Assert::IsTrue(parsed.has_value() && *parsed == level);
+        }
+
+        Assert::IsTrue(SimdDispatch::FromString(L"AVX2") == SimdDispatch::Level::AVX2);
+        Assert::IsFalse(SimdDispatch::FromString(L"neon").has_value());
+    }
+};
+}  // namespace Orc::Test
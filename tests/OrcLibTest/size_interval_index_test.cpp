@@ -0,0 +1,83 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SizeIntervalIndex.h"
+
+#include <algorithm>
+#include <limits>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(SizeIntervalIndexTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(SizeIntervalIndexAgainstLinearScan)
+    {
+        const auto kMax = std::numeric_limits<ULONGLONG>::max();
+
+        const std::vector<std::pair<ULONGLONG, ULONGLONG>> ranges = {
+            {0, 0},
+            {0, 4095},
+            {4096, 4096},
+            {1024, kMax},
+            {512, 2048},
+            {2049, 1000000},
+            {100, 99},  // empty, ignored
+            {4096, kMax},
+            {1000000, 1000000},
+            {3, 7}};
+
+        SizeIntervalIndex index;
+        for (size_t i = 0; i < ranges.size(); i++)
+            index.Add(ranges[i].first, ranges[i].second, i);
+        index.Compile();
+
+        Assert::AreEqual(ranges.size() - 1, index.size());
+
+        const std::vector<ULONGLONG> sizes = {
+            0, 1, 3, 7, 8, 511, 512, 1024, 2048, 2049, 4095, 4096, 999999, 1000000, kMax};
+        for (const auto size : sizes)
+        {
+            std::vector<size_t> matches;
+            index.Match(size, matches);
+            std::sort(std::begin(matches), std::end(matches));
+
+            std::vector<size_t> expected;
+            for (size_t i = 0; i < ranges.size(); i++)
+            {
+                if (ranges[i].first <= size && size <= ranges[i].second)
+                    expected.push_back(i);
+            }
+
+            Assert::IsTrue(expected == matches);
+        }
+    }
+
+    TEST_METHOD(SizeIntervalIndexEmpty)
+    {
+        SizeIntervalIndex index;
+        index.Compile();
+
+        std::vector<size_t> matches;
+        index.Match(42, matches);
+        Assert::IsTrue(index.empty());
+        Assert::IsTrue(matches.empty());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,70 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "SlabStorage.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(SlabStorageTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(SlabStorageAllocation)
+    {
+        SlabStorage store(L"Test");
+        Assert::IsTrue(SUCCEEDED(store.InitializeStore(0L, 100, 4096)));
+
+        std::vector<LPVOID> cells;
+        for (int i = 0; i < 100; i++)
+        {
+            auto cell = store.GetNewCell();
+            Assert::IsNotNull(cell);
+            Assert::AreEqual(0, (int)(reinterpret_cast<UINT_PTR>(cell) % 16));
+            Assert::AreEqual((BYTE)0, reinterpret_cast<BYTE*>(cell)[0]);
+            FillMemory(cell, 100, 0xCC);
+            cells.push_back(cell);
+        }
+
+        Assert::AreEqual((size_t)100, store.AllocatedCells());
+        Assert::IsTrue(store.SlabCount() > 1);
+
+        size_t enumerated = 0;
+        Assert::IsTrue(SUCCEEDED(store.EnumCells([&enumerated](void*) { enumerated++; })));
+        Assert::AreEqual((size_t)100, enumerated);
+
+        // Released cells are recycled and zeroed
+        store.FreeCell(cells[10]);
+        auto cell = store.GetNewCell();
+        Assert::IsTrue(cell == cells[10]);
+        Assert::AreEqual((BYTE)0, reinterpret_cast<BYTE*>(cell)[0]);
+
+        for (auto& c : cells)
+            store.FreeCell(c);
+
+        Assert::AreEqual((size_t)0, store.AllocatedCells());
+        Assert::AreEqual((size_t)100, store.PeakAllocatedCells());
+
+        store.ReleaseEmptySlabs();
+        Assert::AreEqual((size_t)1, store.SlabCount());
+
+        store.Reset();
+        Assert::AreEqual((size_t)0, store.SlabCount());
+        Assert::IsTrue(store.PeakCommittedBytes() > 0);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,193 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include <array>
+
+#include "MemoryStream.h"
+#include "Stream/BufferStreamConcept.h"
+#include "Stream/ConceptByteStream.h"
+#include "Stream/CountStreamConcept.h"
+#include "Stream/HashStreamConcept.h"
+#include "Stream/TeeStreamConcept.h"
+#include "Stream/TransformStreamConcept.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+// Order dependent checksum standing for a real hash
+class TestHasher
+{
+public:
+    void Update(const uint8_t* data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            m_value = m_value * 31 + data[i];
+        }
+    }
+
+    uint64_t Value() const { return m_value; }
+
+private:
+    uint64_t m_value = 17;
+};
+
+class XorTransform
+{
+public:
+    void Transform(gsl::span<uint8_t> data, uint64_t offset)
+    {
+        for (size_t i = 0; i < data.size(); ++i)
+        {
+            data[i] ^= static_cast<uint8_t>(offset + i);
+        }
+    }
+};
+
+std::vector<uint8_t> MakeData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        data[i] = static_cast<uint8_t>(i * 7 + i / 251);
+    }
+    return data;
+}
+
+uint64_t Checksum(const std::vector<uint8_t>& data)
+{
+    TestHasher hasher;
+    hasher.Update(data.data(), data.size());
+    return hasher.Value();
+}
+
+using InputStreamT = BufferStreamConcept<std::vector<uint8_t>>;
+using TeeOutputT = BufferStreamConcept<std::vector<uint8_t>>;
+using PipelineT = CountStreamConcept<HashStreamConcept<
+    TeeStreamConcept<TransformStreamConcept<InputStreamT, XorTransform>, std::reference_wrapper<TeeOutputT>>,
+    TestHasher>>;
+
+PipelineT MakePipeline(std::vector<uint8_t> data, TeeOutputT& copy)
+{
+    return PipelineT(
+        {{{InputStreamT(std::move(data)), XorTransform()}, std::reference_wrapper<TeeOutputT>(copy)}, TestHasher()});
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(StreamPipelineTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(StreamPipelineRead)
+    {
+        const auto data = MakeData(10000);
+
+        auto expected = data;
+        XorTransform().Transform(gsl::span<uint8_t>(expected.data(), expected.size()), 0);
+
+        TeeOutputT copy;
+        auto pipeline = MakePipeline(data, copy);
+
+        std::vector<uint8_t> output;
+        std::array<uint8_t, 999> buffer;
+        std::error_code ec;
+        while (const auto processed = pipeline.Read(buffer, ec))
+        {
+            Assert::IsFalse(static_cast<bool>(ec));
+            output.insert(std::end(output), std::cbegin(buffer), std::cbegin(buffer) + processed);
+        }
+
+        Assert::IsTrue(expected == output);
+        Assert::IsTrue(expected == copy.Buffer());
+        Assert::AreEqual(static_cast<uint64_t>(data.size()), pipeline.BytesRead());
+    }
+
+    TEST_METHOD(StreamPipelineByteStream)
+    {
+        const auto data = MakeData(64 * 1024 + 3);
+
+        auto expected = data;
+        XorTransform().Transform(gsl::span<uint8_t>(expected.data(), expected.size()), 0);
+
+        TeeOutputT copy;
+        auto stream = std::make_shared<ConceptByteStream<PipelineT>>(MakePipeline(data, copy), data.size());
+
+        auto output = std::make_shared<MemoryStream>();
+        Assert::AreEqual(S_OK, output->OpenForReadWrite());
+
+        ULONGLONG cbCopied = 0LL;
+        Assert::AreEqual(S_OK, stream->CopyTo(*output, 4096, &cbCopied));
+        Assert::AreEqual(static_cast<ULONGLONG>(data.size()), cbCopied);
+        Assert::AreEqual(static_cast<uint64_t>(data.size()), stream->Pipeline().BytesRead());
+
+        Assert::IsTrue(expected == copy.Buffer());
+
+        Assert::AreEqual(S_OK, output->SetFilePointer(0LL, FILE_BEGIN, nullptr));
+        std::vector<uint8_t> copied(data.size());
+        ULONGLONG cbRead = 0LL;
+        Assert::AreEqual(S_OK, output->Read(copied.data(), copied.size(), &cbRead));
+        Assert::IsTrue(expected == copied);
+    }
+
+    TEST_METHOD(StreamPipelineHash)
+    {
+        const auto data = MakeData(5000);
+
+        using HashPipelineT = HashStreamConcept<InputStreamT, TestHasher>;
+        HashPipelineT pipeline(InputStreamT(data), TestHasher());
+
+        std::vector<uint8_t> output(data.size());
+        std::error_code ec;
+        Assert::AreEqual(size_t(1000), pipeline.Read(gsl::span<uint8_t>(output.data(), 1000), ec));
+        Assert::AreEqual(Checksum(std::vector<uint8_t>(data.data(), data.data() + 1000)), pipeline.Hasher().Value());
+
+        pipeline.Seek(SeekDirection::kBegin, 0, ec);
+        Assert::IsFalse(static_cast<bool>(ec));
+        Assert::AreEqual(data.size(), pipeline.Read(output, ec));
+        Assert::IsTrue(pipeline.IsValid());
+        Assert::AreEqual(Checksum(data), pipeline.Hasher().Value());
+
+        pipeline.Seek(SeekDirection::kBegin, 10, ec);
+        Assert::IsFalse(pipeline.IsValid());
+    }
+
+    TEST_METHOD(StreamPipelineWrite)
+    {
+        const auto data = MakeData(3000);
+
+        using WritePipelineT =
+            CountStreamConcept<TransformStreamConcept<std::reference_wrapper<TeeOutputT>, XorTransform>>;
+
+        TeeOutputT output;
+        WritePipelineT pipeline({std::reference_wrapper<TeeOutputT>(output), XorTransform()});
+
+        std::error_code ec;
+        Assert::AreEqual(size_t(1000), pipeline.Write(BufferView(data.data(), 1000), ec));
+        Assert::AreEqual(size_t(2000), pipeline.Write(BufferView(data.data() + 1000, 2000), ec));
+        Assert::IsFalse(static_cast<bool>(ec));
+        Assert::AreEqual(static_cast<uint64_t>(data.size()), pipeline.BytesWritten());
+
+        // Transform applied at the stream offset of each write
+        auto expected = data;
+        XorTransform().Transform(gsl::span<uint8_t>(expected.data(), expected.size()), 0);
+        Assert::IsTrue(expected == output.Buffer());
+    }
+};
+}  // namespace Orc::Test
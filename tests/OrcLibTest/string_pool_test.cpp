@@ -0,0 +1,50 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Utils/StringPool.h"
+
+using namespace std::string_view_literals;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(StringPoolTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(StringPoolIntern)
+    {
+        WStringPool pool(16);
+
+        auto root = pool.Intern(L"\\"sv);
+        auto windows = pool.Intern(root, L"Windows"sv, L'\\');
+        auto system32 = pool.Intern(windows, L"System32"sv, L'\\');
+
+        Assert::IsTrue(root == L"\\"sv);
+        Assert::IsTrue(windows == L"\\Windows\\"sv);
+        Assert::IsTrue(system32 == L"\\Windows\\System32\\"sv);
+
+        // Views are null terminated and stay valid when new chunks are allocated
+        Assert::AreEqual(L'\0', system32.data()[system32.size()]);
+        Assert::IsTrue(pool.Bytes() > 16 * sizeof(wchar_t));
+        Assert::IsTrue(windows == L"\\Windows\\"sv);
+
+        pool.Clear();
+        Assert::AreEqual((size_t)0, pool.Bytes());
+    }
+};
+}  // namespace Orc::Test
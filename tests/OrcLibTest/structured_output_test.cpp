@@ -696,6 +696,113 @@ public:
         Assert::IsTrue(SUCCEEDED(CompareTestResult(result_stream, L"3FAB138DB1BB32154972E28C3128A4DC1B78EB94")));
     }
 
+    TEST_METHOD(UnicodeTableSanitize)
+    {
+        std::wstring result;
+
+        Assert::IsTrue(SUCCEEDED(SanitizeString(xml_string_table, L"a\x0001b\xFFFF\xE9", result)));
+        Assert::AreEqual(L"a#x0001;b#xFFFF;\xE9", result.c_str());
+
+        Assert::IsTrue(SUCCEEDED(ReplaceInvalidChars(xml_element_table, L"name with:spaces", result)));
+        Assert::AreEqual(L"name_with_spaces", result.c_str());
+
+        // Long enough for the vectorized path, invalid code units in and after the first blocks
+        std::wstring text(100, L'x');
+        text[3] = 0xD800;
+        text[97] = 0x1F;
+        Assert::AreEqual(size_t(3), xml_string_table.FindInvalid(text));
+        Assert::AreEqual(size_t(97), xml_string_table.FindInvalid(std::wstring_view(text).substr(4)) + 4);
+        Assert::IsFalse(IsUnicodeStringValid(xml_comment_table, text));
+        Assert::IsTrue(IsUnicodeStringValid(xml_comment_table, std::wstring(100, L'\x4E00')));
+    }
+
+    HRESULT WriteEscapingTest(const std::shared_ptr<ByteStream>& stream, OutputSpec::Encoding encoding, bool bXmlLite)
+    {
+        auto options = std::make_unique<Orc::StructuredOutput::XML::Options>();
+        options->Encoding = encoding;
+        options->bXmlLite = bXmlLite;
+        const auto _writer = StructuredOutputWriter::GetWriter(stream, OutputSpec::Kind::XML, std::move(options));
+
+        const auto writer = std::dynamic_pointer_cast<StructuredOutput::IWriter>(_writer);
+        Assert::IsNotNull(writer.get());
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"root")));
+        Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"markup", L"say \"hi\" & <bye>")));
+        Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"surrogates", L"smile \xD83D\xDE00 \x00E9t\x00E9")));
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"empty")));
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"empty")));
+
+        Assert::IsTrue(SUCCEEDED(writer->WriteComment(L" comment <&> ")));
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"text")));
+        Assert::IsTrue(SUCCEEDED(writer->Write(L"1 < 2 && 3 > 2 \"quoted\"\t\xD83D\xDE00")));
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"text")));
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"mixed")));
+        Assert::IsTrue(SUCCEEDED(writer->Write(L"before")));
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"child")));
+        Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"attr", L"value")));
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"child")));
+        Assert::IsTrue(SUCCEEDED(writer->Write(L"after")));
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"mixed")));
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginCollection(L"item")));
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            Assert::IsTrue(SUCCEEDED(writer->BeginElement(nullptr)));
+            Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"index", i)));
+            Assert::IsTrue(SUCCEEDED(writer->EndElement(nullptr)));
+        }
+        Assert::IsTrue(SUCCEEDED(writer->EndCollection(L"item")));
+
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"root")));
+        Assert::IsTrue(SUCCEEDED(writer->Close()));
+        return S_OK;
+    }
+
+    TEST_METHOD(XmlEmitterMatchesXmlLite)
+    {
+        auto xmllite = ExtensionLibrary::GetLibrary<XmlLiteExtension>();
+
+        for (const auto encoding : {OutputSpec::Encoding::UTF8, OutputSpec::Encoding::UTF16})
+        {
+            auto buffered = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(buffered->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(WriteEscapingTest(buffered, encoding, false)));
+
+            auto reference = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(reference->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(WriteEscapingTest(reference, encoding, true)));
+
+            const auto result = buffered->GetBuffer();
+            const auto expected = reference->GetBuffer();
+            Assert::IsTrue(std::string_view(result) == std::string_view(expected), L"Output differs from XmlLite's");
+        }
+    }
+
+    TEST_METHOD(JSONEscaping)
+    {
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+
+        auto options = std::make_unique<Orc::StructuredOutput::JSON::Options>();
+        options->bPrettyPrint = false;
+        auto writer = StructuredOutput::JSON::GetWriter(stream, std::move(options));
+
+        Assert::IsTrue(SUCCEEDED(writer->BeginElement(L"element")));
+        Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"key \"q\"", L"a\"b\\c\b\f\n\r\t\x0001 \x00E9 \xD83D\xDE00")));
+        Assert::IsTrue(SUCCEEDED(writer->WriteNamed(L"key \"q\"", L"")));
+        Assert::IsTrue(SUCCEEDED(writer->EndElement(L"element")));
+        Assert::IsTrue(SUCCEEDED(writer->Close()));
+
+        const auto result = stream->GetBuffer();
+        Assert::IsTrue(
+            std::string_view(result)
+            == "{\"element\":{\"key \\\"q\\\"\":\"a\\\"b\\\\c\\b\\f\\n\\r\\t\\u0001 \xC3\xA9 \xF0\x9F\x98\x80\","
+               "\"key \\\"q\\\"\":\"\"}}");
+    }
+
     TEST_METHOD(JSONStructuredOutput)
     {
 
@@ -8,6 +8,7 @@
 #include "stdafx.h"
 
 #include <memory>
+#include <filesystem>
 #include <iostream>
 #include <iomanip>
 
@@ -140,6 +141,26 @@ public:
         Assert::IsFalse((*parentCmdLine).empty());
     }
 
+    TEST_METHOD(Snapshot)
+    {
+        const auto directory = std::filesystem::temp_directory_path() / L"OrcSystemDetailsSnapshot";
+        std::error_code ec;
+        std::filesystem::remove_all(directory, ec);
+
+        Assert::AreEqual(S_OK, SystemDetails::ConfigureSnapshot(directory.wstring()));
+        Assert::IsTrue(SystemDetails::GetSnapshotDirectory().has_value());
+        Assert::IsTrue(std::filesystem::exists(directory / L"user.tsv"));
+
+        // Queries wait for the prefetch in progress instead of running again
+        SystemDetails::PrefetchWMI();
+        auto result = SystemDetails::GetMountedVolumes();
+        Assert::IsTrue(result.has_value());
+        Assert::IsFalse((*result).empty());
+
+        SetEnvironmentVariableW(L"DFIR-ORC_SYSTEM_DETAILS", NULL);
+        std::filesystem::remove_all(directory, ec);
+    }
+
 
 };
 }  // namespace Orc::Test
@@ -10,12 +10,15 @@
 #include "OutputSpec.h"
 
 #include "TableOutputWriter.h"
+#include "TableOutputBatch.h"
+#include "TableOutputShards.h"
 #include "TableOutput.h"
 
 #include "Temporary.h"
 #include "ParameterCheck.h"
 #include "FileStream.h"
 #include "MemoryStream.h"
+#include "Text/Utf16ToUtf8.h"
 
 #include <safeint.h>
 
@@ -197,6 +200,358 @@ public:
         }
     }
 
+    TEST_METHOD(RecordBatchTest)
+    {
+        using namespace Orc::TableOutput;
+        using namespace std::string_view_literals;
+
+        Schema schema {{ColumnType::UInt32Type, L"FieldOne", L"One"},
+                       {ColumnType::UTF16Type, L"FieldTwo", L"Two"},
+                       {ColumnType::UTF8Type, L"FieldThree", L"Three"},
+                       {ColumnType::BoolType, L"FieldFour", L"Four"},
+                       {ColumnType::TimeStampType, L"FieldFive", L"Five"},
+                       {ColumnType::GUIDType, L"FieldSix", L"Six"},
+                       {ColumnType::EnumType, L"FieldSeven", L"Seven"},
+                       {ColumnType::FlagsType, L"FieldEight", L"Eight"}};
+
+        const auto writeRows = [](IOutput& output) {
+            LPCWSTR names[] = {L"ValOne", L"ValTwo", L"ValThree", L"ValFour", NULL};
+            const GUID guid = {0x01020304, 0x0506, 0x0708, {0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10}};
+
+            for (UINT i = 0; i < 100; i++)
+            {
+                output.WriteInteger((DWORD)i);
+                output.WriteFormated(L"This is a string ({})", i);
+                if (i % 3)
+                    output.WriteString("ansi"sv);
+                else
+                    output.WriteNothing();
+                output.WriteBool(i % 2);
+                output.WriteFileTime(132000000000000000LL + i * 10000000LL);
+                output.WriteGUID(guid);
+                output.WriteEnum(i % 4, names);
+                output.WriteFlags(i % 8);
+                output.WriteEndOfLine();
+            }
+        };
+
+        const auto makeWriter = [&schema](std::shared_ptr<MemoryStream>& stream) {
+            auto writer = Orc::TableOutput::GetCSVWriter(std::make_unique<CSV::Options>());
+            Assert::IsTrue((bool)writer);
+
+            stream = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(writer->WriteToStream(stream, false)));
+            Assert::IsTrue(SUCCEEDED(writer->SetSchema(schema)));
+            return writer;
+        };
+
+        std::shared_ptr<MemoryStream> rowStream;
+        auto rowWriter = makeWriter(rowStream);
+        writeRows(*rowWriter);
+        rowWriter->Close();
+
+        RecordBatch batch(schema, 100);
+        writeRows(batch);
+        Assert::IsTrue(batch.RowCount() == 100);
+        Assert::IsTrue(batch[2].NullCount() == 34);
+        Assert::IsTrue(batch[0].Integers()[42] == 42);
+
+        // CSV has no columnar path: the batch is replayed row by row and must give the same output
+        std::shared_ptr<MemoryStream> batchStream;
+        auto batchWriter = makeWriter(batchStream);
+        Assert::IsTrue(SUCCEEDED(batchWriter->WriteBatch(batch)));
+        batchWriter->Close();
+
+        const auto rowBuffer = rowStream->GetConstBuffer();
+        const auto batchBuffer = batchStream->GetConstBuffer();
+        Assert::IsTrue(rowStream->GetSize() == batchStream->GetSize());
+        Assert::IsTrue(!memcmp(rowBuffer.GetData(), batchBuffer.GetData(), (size_t)rowStream->GetSize()));
+
+        batch.Clear();
+        Assert::IsTrue(batch.empty());
+        Assert::IsTrue(batch[1].size() == 0);
+    }
+
+    TEST_METHOD(CsvBackgroundWriterTest)
+    {
+        using namespace Orc::TableOutput;
+
+        Schema schema {{ColumnType::UInt32Type, L"FieldOne", L"One"},
+                       {ColumnType::UTF16Type, L"FieldTwo", L"Two"},
+                       {ColumnType::UInt64Type, L"FieldThree", L"Three"}};
+
+        const auto writeTable = [&schema](DWORD dwWriteBuffers) {
+            auto options = std::make_unique<CSV::Options>();
+            options->dwBufferSize = 4096;
+            options->dwWriteBuffers = dwWriteBuffers;
+
+            auto writer = Orc::TableOutput::GetCSVWriter(std::move(options));
+            Assert::IsTrue((bool)writer);
+
+            auto stream = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(writer->WriteToStream(stream, false)));
+            Assert::IsTrue(SUCCEEDED(writer->SetSchema(schema)));
+
+            // Many small pages are filled, then handed to the background thread
+            for (UINT i = 0; i < 10000; i++)
+            {
+                writer->WriteInteger((DWORD)i);
+                writer->WriteFormated(L"This is a string ({})", i);
+                writer->WriteInteger((ULONGLONG)i * 3);
+                writer->WriteEndOfLine();
+
+                if (i == 5000)
+                    Assert::IsTrue(SUCCEEDED(writer->Flush()));
+            }
+
+            Assert::IsTrue(SUCCEEDED(writer->Close()));
+            return stream;
+        };
+
+        const auto syncStream = writeTable(0);
+        const auto asyncStream = writeTable(3);
+
+        const auto syncBuffer = syncStream->GetConstBuffer();
+        const auto asyncBuffer = asyncStream->GetConstBuffer();
+        Assert::IsTrue(syncStream->GetSize() > 4096 * 3);
+        Assert::IsTrue(syncStream->GetSize() == asyncStream->GetSize());
+        Assert::IsTrue(!memcmp(syncBuffer.GetData(), asyncBuffer.GetData(), (size_t)syncStream->GetSize()));
+    }
+
+    TEST_METHOD(CsvDictionaryTest)
+    {
+        using namespace Orc::TableOutput;
+        using namespace std::string_view_literals;
+
+        const auto writeTable = [](bool bDictionary) {
+            Schema schema {{ColumnType::UTF8Type, L"ComputerName", L"One"},
+                           {ColumnType::UInt64Type, L"VolumeID", L"Two", L"0x{:016X}"sv},
+                           {ColumnType::UTF16Type, L"ParentName", L"Three"},
+                           {ColumnType::UInt32Type, L"FRN", L"Four"}};
+
+            schema[L"ComputerName"].bDictionary = bDictionary;
+            schema[L"VolumeID"].bDictionary = bDictionary;
+            schema[L"ParentName"].bDictionary = bDictionary;
+
+            auto writer = Orc::TableOutput::GetCSVWriter(std::make_unique<CSV::Options>());
+            Assert::IsTrue((bool)writer);
+
+            auto stream = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(writer->WriteToStream(stream, false)));
+            Assert::IsTrue(SUCCEEDED(writer->SetSchema(schema)));
+
+            const std::wstring_view parents[] = {L"\\Windows"sv, L"\\Users\\\"quoted\""sv, L"\\Windows\\System32"sv};
+
+            for (UINT i = 0; i < 1000; i++)
+            {
+                if (i % 2)
+                    writer->WriteString("WORKSTATION"sv);
+                else
+                    writer->WriteString(L"WORKSTATION"sv);
+                writer->WriteInteger(0x1234567800000000ULL + i % 4);
+                if (i % 5)
+                    writer->WriteString(parents[i % std::size(parents)]);
+                else
+                    writer->WriteNothing();
+                writer->WriteInteger((DWORD)i);
+                writer->WriteEndOfLine();
+            }
+
+            Assert::IsTrue(SUCCEEDED(writer->Close()));
+            return stream;
+        };
+
+        // Values served from the dictionaries must be formatted exactly as the first time they were written
+        const auto plainStream = writeTable(false);
+        const auto dictionaryStream = writeTable(true);
+
+        const auto plainBuffer = plainStream->GetConstBuffer();
+        const auto dictionaryBuffer = dictionaryStream->GetConstBuffer();
+        Assert::IsTrue(plainStream->GetSize() == dictionaryStream->GetSize());
+        Assert::IsTrue(!memcmp(plainBuffer.GetData(), dictionaryBuffer.GetData(), (size_t)plainStream->GetSize()));
+    }
+
+    TEST_METHOD(CsvUtf8EncodingTest)
+    {
+        using namespace Orc::TableOutput;
+        using namespace std::string_view_literals;
+
+        const auto writeTable = [](OutputSpec::Encoding encoding, DWORD dwWriteBuffers) {
+            Schema schema {{ColumnType::UTF16Type, L"Name", L"One"},
+                           {ColumnType::UInt64Type, L"Size", L"Two"},
+                           {ColumnType::TimeStampType, L"Created", L"Three"},
+                           {ColumnType::BinaryType, L"Hash", L"Four"},
+                           {ColumnType::GUIDType, L"Id", L"Five"},
+                           {ColumnType::UInt32Type, L"Flags", L"Six", L"0x{:08X}"sv}};
+
+            auto options = std::make_unique<CSV::Options>();
+            options->Encoding = encoding;
+            options->bBOM = false;
+            options->dwBufferSize = 4096;
+            options->dwWriteBuffers = dwWriteBuffers;
+
+            auto writer = Orc::TableOutput::GetCSVWriter(std::move(options));
+            Assert::IsTrue((bool)writer);
+
+            auto stream = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(writer->WriteToStream(stream, false)));
+            Assert::IsTrue(SUCCEEDED(writer->SetSchema(schema)));
+
+            const BYTE hash[] = {0x00, 0x1F, 0xA0, 0xFF};
+            const GUID guid = {0x12345678, 0x9ABC, 0xDEF0, {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF}};
+
+            for (UINT i = 0; i < 2000; i++)
+            {
+                writer->WriteString(fmt::format(L"\\Users\\J\u00e9r\u00f4me\\\u6587\u4ef6 {}", i));
+                if (i % 3)
+                    writer->WriteInteger((ULONGLONG)i * 4096);
+                else
+                    writer->WriteNothing();
+                writer->WriteFileTime(132223104000000000LL + i * 10000000LL);
+                writer->WriteBytes(hash, sizeof(hash));
+                writer->WriteGUID(guid);
+                writer->WriteInteger((DWORD)i);
+                writer->WriteEndOfLine();
+            }
+
+            Assert::IsTrue(SUCCEEDED(writer->Close()));
+
+            const auto buffer = stream->GetConstBuffer();
+            return std::string(reinterpret_cast<const char*>(buffer.GetData()), (size_t)stream->GetSize());
+        };
+
+        // Values written straight as UTF-8 must match the transcoded UTF-16 output
+        const auto utf16 = writeTable(OutputSpec::Encoding::UTF16, 0);
+        const std::wstring_view wide(reinterpret_cast<const WCHAR*>(utf16.data()), utf16.size() / sizeof(WCHAR));
+
+        std::string expected(Text::Utf8MaxLength(wide.size()), '\0');
+        expected.resize(Text::ConvertUtf16ToUtf8(wide, expected.data()));
+
+        Assert::IsTrue(expected.size() > 4096 * 3);
+        Assert::IsTrue(writeTable(OutputSpec::Encoding::UTF8, 0) == expected);
+        Assert::IsTrue(writeTable(OutputSpec::Encoding::UTF8, 3) == expected);
+    }
+
+    TEST_METHOD(JsonLinesTest)
+    {
+        using namespace Orc::TableOutput;
+
+        Schema schema {{ColumnType::UTF16Type, L"Name", L"One"},
+                       {ColumnType::Int64Type, L"Size", L"Two"},
+                       {ColumnType::TimeStampType, L"Created", L"Three"},
+                       {ColumnType::BoolType, L"Is \"Dir\"", L"Four"},
+                       {ColumnType::GUIDType, L"Id", L"Five"}};
+
+        OutputSpec output;
+        output.TableFormat = OutputSpec::Kind::JSONL;
+
+        auto writer = Orc::TableOutput::GetStreamWriter(output);
+        Assert::IsTrue((bool)writer);
+
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+        Assert::IsTrue(SUCCEEDED(writer->WriteToStream(stream, false)));
+        Assert::IsTrue(SUCCEEDED(writer->SetSchema(schema)));
+
+        const GUID guid = {0x12345678, 0x9ABC, 0xDEF0, {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB, 0xCD, 0xEF}};
+
+        writer->WriteString(L"C:\\a\tb\"c");
+        writer->WriteInteger((ULONGLONG)4096);
+        writer->WriteFileTime(132223104000000000LL);
+        writer->WriteBool(true);
+        writer->WriteGUID(guid);
+        writer->WriteEndOfLine();
+
+        writer->WriteString(L"");
+        writer->WriteInteger((LONGLONG)-1);
+        writer->WriteFileTime(132223104015000000LL);
+        writer->WriteBool(false);
+        writer->WriteNothing();
+        writer->WriteEndOfLine();
+
+        Assert::IsTrue(SUCCEEDED(writer->Close()));
+
+        const auto buffer = stream->GetConstBuffer();
+        const std::string_view content(reinterpret_cast<const char*>(buffer.GetData()), (size_t)stream->GetSize());
+
+        const std::string_view expected =
+            R"({"Name":"C:\\a\tb\"c","Size":4096,"Created":"2020-01-01T00:00:00.000Z","Is \"Dir\"":true,)"
+            R"("Id":"{12345678-9ABC-DEF0-0123-456789ABCDEF}"})"
+            "\n"
+            R"({"Name":null,"Size":-1,"Created":"2020-01-01T00:00:01.500Z","Is \"Dir\"":false,"Id":null})"
+            "\n";
+        Assert::IsTrue(content == expected);
+    }
+
+    TEST_METHOD(ShardedWriterTest)
+    {
+        using namespace Orc::TableOutput;
+
+        Schema schema {{ColumnType::UInt32Type, L"FieldOne", L"One"}, {ColumnType::UTF16Type, L"FieldTwo", L"Two"}};
+
+        const auto writeTable = [&schema](UINT rows) {
+            std::vector<std::shared_ptr<MemoryStream>> streams;
+            std::vector<DWORD> closed;
+
+            auto writer = ShardedWriter::MakeNew(
+                [&schema, &streams](DWORD dwPart) {
+                    Assert::IsTrue(dwPart == streams.size() + 1);
+
+                    auto part = Orc::TableOutput::GetCSVWriter(std::make_unique<CSV::Options>());
+                    auto stream = std::make_shared<MemoryStream>();
+                    Assert::IsTrue(SUCCEEDED(stream->OpenForReadWrite()));
+                    Assert::IsTrue(SUCCEEDED(part->WriteToStream(stream, false)));
+                    Assert::IsTrue(SUCCEEDED(part->SetSchema(schema)));
+
+                    streams.push_back(stream);
+                    return std::shared_ptr<IWriter>(part);
+                },
+                [&closed](DWORD dwPart, const std::shared_ptr<IWriter>&) { closed.push_back(dwPart); },
+                1000,
+                std::nullopt);
+            Assert::IsTrue((bool)writer);
+
+            for (UINT i = 0; i < rows; i++)
+            {
+                writer->WriteInteger((DWORD)i);
+                writer->WriteFormated(L"This is a string ({})", i);
+                writer->WriteEndOfLine();
+            }
+            Assert::IsTrue(SUCCEEDED(writer->Close()));
+
+            Assert::IsTrue(closed.size() == streams.size());
+
+            // Each part has its own header
+            std::vector<size_t> lines;
+            for (const auto& stream : streams)
+            {
+                const auto buffer = stream->GetConstBuffer();
+                const std::string_view content(
+                    reinterpret_cast<const char*>(buffer.GetData()), static_cast<size_t>(stream->GetSize()));
+
+                size_t count = 0;
+                for (auto pos = content.find("\r\n"); pos != std::string_view::npos; pos = content.find("\r\n", pos))
+                {
+                    count++;
+                    pos += 2;
+                }
+                lines.push_back(count);
+            }
+            return lines;
+        };
+
+        Assert::IsTrue(writeTable(2500) == std::vector<size_t> {1001, 1001, 501});
+
+        // The part which reaches the limit with the last row is not followed by an empty one
+        Assert::IsTrue(writeTable(2000) == std::vector<size_t> {1001, 1001});
+
+        Assert::IsTrue(ShardedWriter::PartName(L"NTFSInfo_C", L".csv", 12) == L"NTFSInfo_C_part000012.csv");
+    }
+
     std::wstring GetFilePath(const std::wstring& strFileName)
     {
         std::wstring retval;
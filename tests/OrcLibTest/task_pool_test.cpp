@@ -0,0 +1,62 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TaskPool.h"
+
+#include <atomic>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(TaskPoolTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(TaskPoolParallelFor)
+    {
+        auto& pool = TaskPool::Instance();
+        Assert::IsTrue(pool.Processors() >= 1);
+
+        auto pScheduler = pool.GetScheduler(TaskPool::Subsystem::Hash);
+        Assert::IsNotNull(pScheduler);
+        Assert::IsTrue(pScheduler == pool.GetScheduler(TaskPool::Subsystem::Hash));
+        Assert::IsTrue(pScheduler != pool.GetScheduler(TaskPool::Subsystem::Archive));
+
+        std::vector<std::atomic<ULONG>> calls(1000);
+        TaskPool::ParallelFor(TaskPool::Subsystem::Hash, size_t(0), calls.size(), [&](size_t i) {
+            Assert::AreEqual(pScheduler->Id(), concurrency::CurrentScheduler::Id());
+            calls[i]++;
+        });
+
+        for (const auto& count : calls)
+            Assert::AreEqual(1UL, count.load());
+    }
+
+    TEST_METHOD(TaskPoolNestedParallelFor)
+    {
+        // Chores of a subsystem may start loops of the same or of another subsystem
+        std::atomic<ULONG> calls = 0;
+        TaskPool::ParallelFor(TaskPool::Subsystem::Walk, 0, 8, [&](int) {
+            TaskPool::ParallelFor(TaskPool::Subsystem::Walk, 0, 8, [&](int) { calls++; });
+            TaskPool::ParallelFor(TaskPool::Subsystem::Table, 0, 8, [&](int) { calls++; });
+        });
+
+        Assert::AreEqual(128UL, calls.load());
+    }
+};
+}  // namespace Orc::Test
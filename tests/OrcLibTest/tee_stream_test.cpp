@@ -0,0 +1,128 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include <array>
+
+#include "CryptoHashStream.h"
+#include "MemoryStream.h"
+#include "TeeStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(TeeStreamTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::vector<BYTE> Pattern(size_t size)
+    {
+        std::vector<BYTE> bytes(size);
+        for (size_t i = 0; i < size; i++)
+        {
+            bytes[i] = static_cast<BYTE>(i * 13 + i / 256);
+        }
+        return bytes;
+    }
+
+    static std::vector<BYTE> Content(MemoryStream& stream)
+    {
+        std::vector<BYTE> content(static_cast<size_t>(stream.GetSize()));
+        ULONGLONG cbRead = 0LL;
+        Assert::AreEqual(S_OK, stream.SetFilePointer(0LL, FILE_BEGIN, nullptr));
+        Assert::AreEqual(S_OK, stream.Read(content.data(), content.size(), &cbRead));
+        content.resize(static_cast<size_t>(cbRead));
+        return content;
+    }
+
+    static std::wstring Sha256(const std::vector<BYTE>& bytes)
+    {
+        CryptoHashStream hashStream;
+        Assert::AreEqual(S_OK, hashStream.OpenToWrite(CryptoHashStream::Algorithm::SHA256, nullptr));
+
+        ULONGLONG cbWritten = 0LL;
+        Assert::AreEqual(S_OK, hashStream.Write((const PVOID)bytes.data(), bytes.size(), &cbWritten));
+
+        std::wstring hash;
+        Assert::AreEqual(S_OK, hashStream.GetHash(CryptoHashStream::Algorithm::SHA256, hash));
+        return hash;
+    }
+
+    static void WriteAll(bool bConcurrent)
+    {
+        const auto bytes = Pattern(512 * 1024 + 11);
+
+        auto first = std::make_shared<MemoryStream>();
+        auto second = std::make_shared<MemoryStream>();
+        Assert::AreEqual(S_OK, first->OpenForReadWrite());
+        Assert::AreEqual(S_OK, second->OpenForReadWrite());
+
+        auto hashStream = std::make_shared<CryptoHashStream>();
+        Assert::AreEqual(S_OK, hashStream->OpenToWrite(CryptoHashStream::Algorithm::SHA256, second));
+
+        TeeStream tee;
+        Assert::AreEqual(S_OK, tee.Open({first, hashStream}, bConcurrent));
+
+        // Header, body and trailer are written without being gathered into one buffer first
+        const size_t header = 100, trailer = 4096;
+        const std::array<BufferView, 3> buffers = {
+            BufferView(bytes.data(), header),
+            BufferView(bytes.data() + header, bytes.size() - header - trailer),
+            BufferView(bytes.data() + bytes.size() - trailer, trailer)};
+
+        ULONGLONG cbWritten = 0LL;
+        Assert::AreEqual(S_OK, tee.WriteV(buffers, &cbWritten));
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbWritten);
+
+        Assert::IsTrue(bytes == Content(*first));
+        Assert::IsTrue(bytes == Content(*second));
+
+        std::wstring hash;
+        Assert::AreEqual(S_OK, hashStream->GetHash(CryptoHashStream::Algorithm::SHA256, hash));
+        Assert::AreEqual(Sha256(bytes), hash);
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(TeeStreamWriteV) { WriteAll(false); }
+
+    TEST_METHOD(TeeStreamConcurrentWriteV) { WriteAll(true); }
+
+    TEST_METHOD(ByteStreamReadV)
+    {
+        const auto bytes = Pattern(10000);
+
+        auto stream = std::make_shared<MemoryStream>();
+        Assert::AreEqual(S_OK, stream->OpenForReadWrite());
+        ULONGLONG cbWritten = 0LL;
+        Assert::AreEqual(S_OK, stream->Write((const PVOID)bytes.data(), bytes.size(), &cbWritten));
+        Assert::AreEqual(S_OK, stream->SetFilePointer(0LL, FILE_BEGIN, nullptr));
+
+        // The last buffer is only partially filled
+        std::vector<BYTE> first(4000), second(4000), third(4000);
+        const std::array<BufferSpan, 3> buffers = {
+            BufferSpan(first.data(), first.size()),
+            BufferSpan(second.data(), second.size()),
+            BufferSpan(third.data(), third.size())};
+
+        ULONGLONG cbRead = 0LL;
+        Assert::AreEqual(S_OK, stream->ReadV(buffers, &cbRead));
+        Assert::AreEqual(static_cast<ULONGLONG>(bytes.size()), cbRead);
+
+        Assert::IsTrue(std::equal(std::cbegin(first), std::cend(first), std::cbegin(bytes)));
+        Assert::IsTrue(std::equal(std::cbegin(second), std::cend(second), std::cbegin(bytes) + 4000));
+        Assert::IsTrue(std::equal(std::cbegin(third), std::cbegin(third) + 2000, std::cbegin(bytes) + 8000));
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,79 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Telemetry.h"
+
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(TelemetryTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static const Telemetry::Counters& Get(const Telemetry::Statistics& statistics, Telemetry::Phase phase)
+    {
+        return statistics[static_cast<size_t>(phase)];
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(ScopeRecordsOperationAndBytes)
+    {
+        const auto before = Telemetry::GetStatistics();
+
+        {
+            Telemetry::Scope telemetry(Telemetry::Phase::TableWrite);
+            telemetry.AddBytes(100);
+            telemetry.AddBytes(28);
+        }
+
+        const auto after = Telemetry::GetStatistics();
+        const auto& previous = Get(before, Telemetry::Phase::TableWrite);
+        const auto& current = Get(after, Telemetry::Phase::TableWrite);
+        Assert::AreEqual(previous.Operations + 1, current.Operations);
+        Assert::AreEqual(previous.Bytes + 128, current.Bytes);
+        Assert::IsTrue(current.Duration >= previous.Duration);
+    }
+
+    TEST_METHOD(ExitedThreadsAreKept)
+    {
+        const auto before = Telemetry::GetStatistics();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++)
+        {
+            threads.emplace_back([]() {
+                for (int j = 0; j < 10; j++)
+                {
+                    Telemetry::Record(Telemetry::Phase::ArchiveFlush, 10, 0);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        const auto after = Telemetry::GetStatistics();
+        Assert::AreEqual(
+            Get(before, Telemetry::Phase::ArchiveFlush).Operations + 40,
+            Get(after, Telemetry::Phase::ArchiveFlush).Operations);
+        Assert::AreEqual(
+            Get(before, Telemetry::Phase::ArchiveFlush).Bytes + 400, Get(after, Telemetry::Phase::ArchiveFlush).Bytes);
+    }
+};
+}  // namespace Orc::Test
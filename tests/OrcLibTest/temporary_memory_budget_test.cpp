@@ -0,0 +1,120 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "TemporaryMemoryBudget.h"
+#include "TemporaryStream.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(TemporaryMemoryBudgetTest)
+{
+private:
+    UnitTestHelper helper;
+    ULONGLONG m_ullPreviousLimit = TemporaryMemoryBudget::kUnlimited;
+
+    static constexpr DWORD kMemThreshold = 4 * 1024 * 1024;
+    static constexpr ULONGLONG kBudget = 1024 * 1024;
+
+    static std::shared_ptr<TemporaryStream> MakeStream(const std::wstring& tag)
+    {
+        auto stream = std::make_shared<TemporaryStream>();
+        stream->SetBudgetTag(tag);
+        Assert::IsTrue(S_OK == stream->Open(L"", L"TemporaryMemoryBudgetTest", kMemThreshold));
+        return stream;
+    }
+
+    static void WritePattern(TemporaryStream& stream, size_t size, BYTE seed)
+    {
+        std::vector<BYTE> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = static_cast<BYTE>(seed + i);
+        }
+
+        ULONGLONG ullWritten = 0LL;
+        Assert::IsTrue(S_OK == stream.Write(data.data(), data.size(), &ullWritten));
+        Assert::IsTrue(ullWritten == data.size());
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        m_ullPreviousLimit = TemporaryMemoryBudget::Instance().GetLimit();
+        TemporaryMemoryBudget::Instance().SetLimit(kBudget);
+    }
+
+    TEST_METHOD_CLEANUP(Finalize) { TemporaryMemoryBudget::Instance().SetLimit(m_ullPreviousLimit); }
+
+    TEST_METHOD(SpillOtherStreamsFirst)
+    {
+        auto& budget = TemporaryMemoryBudget::Instance();
+        budget.SetSpillPolicy(TemporaryMemoryBudget::SpillPolicy::LargestFirst);
+
+        auto first = MakeStream(L"SpillOtherStreamsFirst_1");
+        auto second = MakeStream(L"SpillOtherStreamsFirst_2");
+
+        WritePattern(*first, 600 * 1024, 1);
+        Assert::IsTrue(S_OK == first->IsMemoryStream());
+
+        // Keep a read position on the first stream: it must survive the spill
+        Assert::IsTrue(S_OK == first->SetFilePointer(1000, FILE_BEGIN, nullptr));
+
+        WritePattern(*second, 600 * 1024, 2);
+        Assert::IsTrue(S_OK == first->IsFileStream());
+        Assert::IsTrue(S_OK == second->IsMemoryStream());
+        Assert::IsTrue(budget.GetUsage() <= kBudget);
+
+        BYTE buffer[16] = {0};
+        ULONGLONG ullRead = 0LL;
+        Assert::IsTrue(S_OK == first->Read(buffer, sizeof(buffer), &ullRead));
+        Assert::IsTrue(ullRead == sizeof(buffer));
+        for (size_t i = 0; i < sizeof(buffer); ++i)
+        {
+            Assert::IsTrue(buffer[i] == static_cast<BYTE>(1 + 1000 + i));
+        }
+
+        // A single stream above the budget spills itself
+        WritePattern(*second, 600 * 1024, 3);
+        Assert::IsTrue(S_OK == second->IsFileStream());
+        Assert::IsTrue(second->GetSize() == 1200 * 1024);
+
+        const auto firstStatistics = budget.GetStatistics(L"SpillOtherStreamsFirst_1");
+        Assert::IsTrue(firstStatistics.has_value());
+        Assert::IsTrue(firstStatistics->PeakUsage == 600 * 1024);
+        Assert::IsTrue(firstStatistics->SpillCount == 1);
+
+        const auto secondStatistics = budget.GetStatistics(L"SpillOtherStreamsFirst_2");
+        Assert::IsTrue(secondStatistics.has_value());
+        Assert::IsTrue(secondStatistics->SpillCount == 1);
+    }
+
+    TEST_METHOD(ReleaseOnClose)
+    {
+        auto& budget = TemporaryMemoryBudget::Instance();
+        const auto ullUsage = budget.GetUsage();
+
+        {
+            auto stream = MakeStream(L"ReleaseOnClose");
+            WritePattern(*stream, 100 * 1024, 4);
+            Assert::IsTrue(budget.GetUsage() == ullUsage + 100 * 1024);
+
+            Assert::IsTrue(S_OK == stream->Close());
+            Assert::IsTrue(budget.GetUsage() == ullUsage);
+
+            stream = MakeStream(L"ReleaseOnClose");
+            WritePattern(*stream, 100 * 1024, 5);
+        }
+
+        Assert::IsTrue(budget.GetUsage() == ullUsage);
+    }
+};
+}  // namespace Orc::Test
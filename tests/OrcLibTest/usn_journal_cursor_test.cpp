@@ -0,0 +1,119 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "USNJournalCursor.h"
+#include "FileStream.h"
+
+#include <filesystem>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(USNJournalCursorTest)
+{
+private:
+    UnitTestHelper helper;
+    std::filesystem::path m_path;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        m_path = std::filesystem::temp_directory_path() / L"usn_journal_cursor_test.bin";
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    TEST_METHOD_CLEANUP(Finalize)
+    {
+        std::error_code ec;
+        std::filesystem::remove(m_path, ec);
+    }
+
+    TEST_METHOD(MissingCursorIsEmpty)
+    {
+        USNJournalCursor cursor;
+        Assert::IsTrue(S_FALSE == cursor.Load(m_path));
+        Assert::IsTrue(cursor.Volumes().empty());
+    }
+
+    TEST_METHOD(SaveAndLoad)
+    {
+        USNJournalCursor cursor;
+
+        USNJournalCursor::Volume volume;
+        volume.JournalID = 0x01D5A0B0C0D0E0F0ULL;
+        volume.NextUsn = 0x12345678LL;
+        volume.Directories.emplace(
+            0x0001000000000020ULL, USNJournalCursor::Directory {0x0005000000000005ULL, L"Windows"});
+        volume.Directories.emplace(
+            0x0001000000000021ULL, USNJournalCursor::Directory {0x0001000000000020ULL, L"Système"});
+        cursor.Set(0xCAFEULL, std::move(volume));
+        cursor.Set(0xBEEFULL, USNJournalCursor::Volume {});
+
+        Assert::IsTrue(S_OK == cursor.Save(m_path));
+
+        USNJournalCursor loaded;
+        Assert::IsTrue(S_OK == loaded.Load(m_path));
+        Assert::AreEqual(static_cast<size_t>(2), loaded.Volumes().size());
+        Assert::IsTrue(loaded.Find(0xBEEFULL) != nullptr);
+        Assert::IsTrue(loaded.Find(0xDEADULL) == nullptr);
+
+        const auto pVolume = loaded.Find(0xCAFEULL);
+        Assert::IsTrue(pVolume != nullptr);
+        Assert::AreEqual(0x01D5A0B0C0D0E0F0ULL, pVolume->JournalID);
+        Assert::AreEqual(0x12345678LL, pVolume->NextUsn);
+        Assert::AreEqual(static_cast<size_t>(2), pVolume->Directories.size());
+
+        const auto& directory = pVolume->Directories.at(0x0001000000000021ULL);
+        Assert::AreEqual(0x0001000000000020ULL, directory.ParentFRN);
+        Assert::AreEqual(std::wstring(L"Système"), directory.Name);
+    }
+
+    TEST_METHOD(CursorValidity)
+    {
+        USNJournalCursor::Volume volume;
+        volume.JournalID = 42;
+        volume.NextUsn = 0x1000;
+
+        USN_JOURNAL_DATA journal = {0};
+        journal.UsnJournalID = 42;
+        journal.LowestValidUsn = 0x800;
+        journal.NextUsn = 0x2000;
+        Assert::IsTrue(volume.IsValidFor(journal));
+
+        // Records following the cursor were purged
+        journal.LowestValidUsn = 0x1800;
+        Assert::IsFalse(volume.IsValidFor(journal));
+
+        // Journal was deleted and recreated
+        journal.LowestValidUsn = 0;
+        journal.UsnJournalID = 43;
+        Assert::IsFalse(volume.IsValidFor(journal));
+    }
+
+    TEST_METHOD(CorruptedCursorIsRejected)
+    {
+        {
+            FileStream stream;
+            Assert::IsTrue(S_OK == stream.WriteTo(m_path.c_str()));
+
+            const BYTE garbage[] = {'O', 'U', 'S', 'N', 1, 0, 0, 0, 5, 0, 0, 0, 0xFF};
+            ULONGLONG ullWritten = 0LL;
+            Assert::IsTrue(S_OK == stream.Write((PVOID)garbage, sizeof(garbage), &ullWritten));
+            stream.Close();
+        }
+
+        USNJournalCursor cursor;
+        Assert::IsTrue(HRESULT_FROM_WIN32(ERROR_INVALID_DATA) == cursor.Load(m_path));
+        Assert::IsTrue(cursor.Volumes().empty());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,117 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "UsnRecordScanner.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+constexpr LONGLONG kTimeStamp = 0x01D2798C00000000LL;  // 2017
+
+// Write a record named 'cchName' 'a' at 'offset', return its length
+DWORD WriteRecord(std::vector<BYTE>& data, size_t offset, bool bV3, WORD cchName = 5)
+{
+    const WORD wHeaderSize = bV3 ? 0x4C : 0x3C;
+    const WORD wNameLength = static_cast<WORD>(cchName * sizeof(WCHAR));
+    const DWORD dwLength = (wHeaderSize + wNameLength + 7) & ~7;
+    const DWORD dwVersion = bV3 ? 3 : 2;
+    const DWORD dwReason = USN_REASON_FILE_CREATE;
+
+    auto p = data.data() + offset;
+    memcpy(p, &dwLength, sizeof(dwLength));
+    memcpy(p + 4, &dwVersion, sizeof(dwVersion));
+    memcpy(p + (bV3 ? 0x30 : 0x20), &kTimeStamp, sizeof(kTimeStamp));
+    memcpy(p + (bV3 ? 0x38 : 0x28), &dwReason, sizeof(dwReason));
+    memcpy(p + (bV3 ? 0x48 : 0x38), &wNameLength, sizeof(wNameLength));
+    memcpy(p + (bV3 ? 0x4A : 0x3A), &wHeaderSize, sizeof(wHeaderSize));
+    for (WORD i = 0; i < cchName; i++)
+    {
+        const WCHAR c = L'a';
+        memcpy(p + wHeaderSize + i * sizeof(WCHAR), &c, sizeof(c));
+    }
+
+    return dwLength;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(UsnRecordScannerTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(UsnRecordScannerZeroPrefix)
+    {
+        std::vector<BYTE> data(4096 + 3);
+        Assert::AreEqual(data.size(), UsnRecordScanner::ZeroPrefix(data.data(), data.size()));
+
+        data[1000] = 1;
+        Assert::AreEqual(size_t(1000), UsnRecordScanner::ZeroPrefix(data.data(), data.size()));
+        Assert::AreEqual(size_t(0), UsnRecordScanner::ZeroPrefix(data.data() + 1000, 10));
+    }
+
+    TEST_METHOD(UsnRecordScannerFindsRecords)
+    {
+        std::vector<BYTE> data(0x10000);
+        const auto dwFirst = WriteRecord(data, 0x1000, false);
+        WriteRecord(data, 0x1000 + dwFirst, true);
+        WriteRecord(data, 0x8000, false);
+
+        // Version in a record name is not a record
+        const DWORD dwVersion = 2;
+        memcpy(data.data() + 0x1000 + 0x3C, &dwVersion, sizeof(dwVersion));
+
+        // Truncated by the end of the data
+        WriteRecord(data, data.size() - 0x40, false, 10);
+
+        UsnRecordScanner scanner(0x01BF53EB256D4000LL, 0x01F0000000000000LL);
+        std::vector<size_t> offsets;
+        scanner.Scan(data.data(), data.size(), offsets);
+
+        Assert::AreEqual(size_t(3), offsets.size());
+        Assert::AreEqual(size_t(0x1000), offsets[0]);
+        Assert::AreEqual(size_t(0x1000 + dwFirst), offsets[1]);
+        Assert::AreEqual(size_t(0x8000), offsets[2]);
+
+        // Only records starting in the scanned part
+        offsets.clear();
+        scanner.Scan(data.data(), data.size(), offsets, 0x8000);
+        Assert::AreEqual(size_t(2), offsets.size());
+    }
+
+    TEST_METHOD(UsnRecordScannerRejectsImplausible)
+    {
+        std::vector<BYTE> data(0x200);
+        WriteRecord(data, 0, false);
+
+        UsnRecordScanner scanner(0x01BF53EB256D4000LL, 0x01F0000000000000LL);
+        Assert::IsTrue(scanner.IsValid(data.data(), data.size()));
+
+        // Timestamp out of range
+        UsnRecordScanner past(0x01BF53EB256D4000LL, 0x01C0000000000000LL);
+        Assert::IsFalse(past.IsValid(data.data(), data.size()));
+
+        // Length not matching the name
+        const DWORD dwLength = 0x100;
+        memcpy(data.data(), &dwLength, sizeof(dwLength));
+        Assert::IsFalse(scanner.IsValid(data.data(), data.size()));
+    }
+};
+}  // namespace Orc::Test
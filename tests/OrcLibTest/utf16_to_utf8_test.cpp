@@ -0,0 +1,131 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Text/Utf16ToUtf8.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace std::string_literals;
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(Utf16ToUtf8Test)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::string Reference(std::wstring_view utf16)
+    {
+        if (utf16.empty())
+        {
+            return {};
+        }
+
+        const auto cbNeeded =
+            WideCharToMultiByte(CP_UTF8, 0, utf16.data(), static_cast<int>(utf16.size()), NULL, 0, NULL, NULL);
+        Assert::IsTrue(cbNeeded > 0);
+
+        std::string utf8(cbNeeded, '\0');
+        WideCharToMultiByte(
+            CP_UTF8, 0, utf16.data(), static_cast<int>(utf16.size()), utf8.data(), cbNeeded, NULL, NULL);
+        return utf8;
+    }
+
+    static std::string Convert(std::wstring_view utf16)
+    {
+        // Exact size so that vector stores past the end would be caught by the debug heap
+        auto buffer = std::make_unique<char[]>(Text::Utf8MaxLength(utf16.size()));
+        const auto cbUtf8 = Text::ConvertUtf16ToUtf8(utf16, buffer.get());
+        Assert::IsTrue(cbUtf8 <= Text::Utf8MaxLength(utf16.size()));
+        return std::string(buffer.get(), cbUtf8);
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(Utf16ToUtf8Samples)
+    {
+        const std::wstring samples[] = {
+            L""s,
+            L"a"s,
+            L"$MFT"s,
+            L"C:\\Windows\\System32\\drivers\\etc\\hosts"s,
+            L"R\u00e9sum\u00e9 d\u00e9finitif.docx"s,
+            L"\u041f\u0440\u0438\u0432\u0435\u0442 \u043c\u0438\u0440 \u043f\u0440\u0438\u0432\u0435\u0442 \u043c\u0438\u0440"s,
+            L"\u65e5\u672c\u8a9e\u306e\u30d5\u30a1\u30a4\u30eb\u540d.txt"s,
+            L"emoji \xD83D\xDE00\xD83D\xDE01 in the middle of a long enough name"s,
+            L"unpaired \xD800 high and \xDC00 low surrogates, then a reversed pair \xDC00\xD800"s,
+            L"trailing high surrogate \xD83D"s,
+            L"\u0000embedded\u0000nulls\u0000"s};
+
+        for (const auto& sample : samples)
+        {
+            Assert::AreEqual(Reference(sample), Convert(sample));
+        }
+    }
+
+    TEST_METHOD(Utf16ToUtf8Random)
+    {
+        std::mt19937 rng(0);
+
+        for (size_t i = 0; i < 10000; i++)
+        {
+            std::wstring utf16(rng() % 100, L'\0');
+            for (auto& c : utf16)
+            {
+                const auto kind = rng() % 100;
+                if (kind < 70)
+                    c = static_cast<WCHAR>(rng() % 0x80);
+                else if (kind < 85)
+                    c = static_cast<WCHAR>(rng() % 0x800);
+                else
+                    c = static_cast<WCHAR>(rng() % 0x10000);
+            }
+
+            Assert::AreEqual(Reference(utf16), Convert(utf16));
+            Assert::AreEqual(
+                std::all_of(std::cbegin(utf16), std::cend(utf16), [](WCHAR c) { return c < 0x80; }),
+                Text::IsAscii(utf16));
+        }
+    }
+
+    TEST_METHOD(Utf16ToUtf8Batch)
+    {
+        const std::wstring values[] = {
+            L"file.txt"s, L""s, L"r\u00e9pertoire"s, L"\u65e5\u672c\u8a9e"s, L"\xD83D\xDE00"s};
+
+        std::vector<WCHAR> chars;
+        std::vector<uint32_t> offsets = {0};
+        for (const auto& value : values)
+        {
+            chars.insert(std::end(chars), std::cbegin(value), std::cend(value));
+            offsets.push_back(static_cast<uint32_t>(chars.size()));
+        }
+
+        std::vector<char> utf8(Text::Utf8MaxLength(chars.size()));
+        std::vector<size_t> utf8Offsets(std::size(values) + 1);
+        const auto cbUtf8 =
+            Text::ConvertUtf16ToUtf8(chars.data(), offsets.data(), std::size(values), utf8.data(), utf8Offsets.data());
+
+        Assert::AreEqual(utf8Offsets.back(), cbUtf8);
+        for (size_t i = 0; i < std::size(values); i++)
+        {
+            Assert::AreEqual(
+                Reference(values[i]),
+                std::string(utf8.data() + utf8Offsets[i], utf8Offsets[i + 1] - utf8Offsets[i]));
+        }
+    }
+};
+}  // namespace Orc::Test
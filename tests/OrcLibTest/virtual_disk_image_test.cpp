@@ -0,0 +1,221 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "VHDVolumeReader.h"
+#include "VirtualDiskImage.h"
+
+#include <intrin.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+constexpr ULONG kBlockSize = 4096L;
+constexpr DWORD kBlocks = 4L;
+constexpr ULONGLONG kDiskSize = kBlockSize * kBlocks;
+
+constexpr size_t kTableOffset = 1536;
+constexpr size_t kLocatorOffset = 2048;
+constexpr size_t kFirstBlockOffset = 2560;
+
+constexpr UUID kParentId = {0x11111111, 0x2222, 0x3333, {0x44, 0x44, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55}};
+constexpr UUID kChildId = {0x66666666, 0x7777, 0x8888, {0x99, 0x99, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA, 0xAA}};
+
+BYTE Pattern(BYTE seed, ULONGLONG offset)
+{
+    return static_cast<BYTE>(seed + offset * 13 + (offset >> 9));
+}
+
+void PutBigEndian(std::vector<BYTE>& image, size_t offset, DWORD value)
+{
+    value = _byteswap_ulong(value);
+    CopyMemory(image.data() + offset, &value, sizeof(value));
+}
+
+void PutBigEndian(std::vector<BYTE>& image, size_t offset, ULONGLONG value)
+{
+    value = _byteswap_uint64(value);
+    CopyMemory(image.data() + offset, &value, sizeof(value));
+}
+
+struct Block
+{
+    DWORD Index;
+    BYTE Bitmap;  // eight sectors per block, most significant bit first
+    BYTE Seed;
+};
+
+// Footer copy, dynamic header, allocation table, parent locator data, the blocks and the footer
+std::vector<BYTE> BuildVHD(
+    VHDVolumeReader::DiskType type,
+    const UUID& id,
+    const std::vector<Block>& blocks,
+    const std::wstring& strParent = std::wstring())
+{
+    std::vector<BYTE> image(kFirstBlockOffset + blocks.size() * (512 + kBlockSize) + 512);
+
+    VHDVolumeReader::Footer footer;
+    ZeroMemory(&footer, sizeof(footer));
+    CopyMemory(footer.Cookie, "conectix", 8);
+    footer.Features = _byteswap_ulong(2L);
+    footer.Version = _byteswap_ulong(0x00010000L);
+    footer.DataOffset = _byteswap_uint64(512LL);
+    footer.OriginalSize = footer.CurrentSize = _byteswap_uint64(kDiskSize);
+    footer.DiskType = static_cast<VHDVolumeReader::DiskType>(_byteswap_ulong(type));
+    footer.UniqueId = id;
+    CopyMemory(image.data(), &footer, sizeof(footer));
+    CopyMemory(image.data() + image.size() - sizeof(footer), &footer, sizeof(footer));
+
+    CopyMemory(image.data() + 512, "cxsparse", 8);
+    PutBigEndian(image, 512 + 8, ~0ULL);
+    PutBigEndian(image, 512 + 16, static_cast<ULONGLONG>(kTableOffset));
+    PutBigEndian(image, 512 + 24, 0x00010000UL);
+    PutBigEndian(image, 512 + 28, kBlocks);
+    PutBigEndian(image, 512 + 32, kBlockSize);
+
+    if (!strParent.empty())
+    {
+        CopyMemory(image.data() + 512 + 40, &kParentId, sizeof(UUID));
+        CopyMemory(image.data() + 512 + 576, "W2ru", 4);
+        PutBigEndian(image, 512 + 576 + 4, 512UL);
+        PutBigEndian(image, 512 + 576 + 8, static_cast<DWORD>(strParent.size() * sizeof(WCHAR)));
+        PutBigEndian(image, 512 + 576 + 16, static_cast<ULONGLONG>(kLocatorOffset));
+        CopyMemory(image.data() + kLocatorOffset, strParent.data(), strParent.size() * sizeof(WCHAR));
+    }
+
+    for (DWORD i = 0; i < kBlocks; i++)
+        PutBigEndian(image, kTableOffset + i * sizeof(DWORD), 0xFFFFFFFFUL);
+
+    size_t offset = kFirstBlockOffset;
+    for (const auto& block : blocks)
+    {
+        PutBigEndian(image, kTableOffset + block.Index * sizeof(DWORD), static_cast<DWORD>(offset / 512));
+        image[offset] = block.Bitmap;
+        for (ULONG i = 0; i < kBlockSize; i++)
+            image[offset + 512 + i] = Pattern(block.Seed, block.Index * kBlockSize + i);
+        offset += 512 + kBlockSize;
+    }
+
+    return image;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(VirtualDiskImageTest)
+{
+private:
+    UnitTestHelper helper;
+
+    std::wstring m_parentPath;
+    std::wstring m_childPath;
+
+    static void WriteImage(const std::wstring& strPath, const std::vector<BYTE>& image)
+    {
+        HANDLE hFile = CreateFileW(strPath.c_str(), GENERIC_WRITE, 0L, NULL, CREATE_ALWAYS, 0L, NULL);
+        Assert::IsTrue(hFile != INVALID_HANDLE_VALUE);
+
+        DWORD dwWritten = 0L;
+        Assert::IsTrue(WriteFile(hFile, image.data(), static_cast<DWORD>(image.size()), &dwWritten, NULL));
+        CloseHandle(hFile);
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize)
+    {
+        std::wstring tempPath;
+        tempPath.resize(MAX_PATH);
+        const auto length = GetTempPathW(static_cast<DWORD>(tempPath.size()), tempPath.data());
+        Assert::IsTrue(length > 0);
+        tempPath.resize(length);
+
+        m_parentPath = tempPath + L"virtual_disk_parent.vhd";
+        m_childPath = tempPath + L"virtual_disk_child.vhd";
+
+        // Parent: blocks 0 and 2 allocated
+        WriteImage(
+            m_parentPath,
+            BuildVHD(VHDVolumeReader::DynamicHardDisk, kParentId, {{0, 0xFF, 1}, {2, 0xFF, 1}}));
+
+        // Child: first half of block 0 and the whole block 3 written since the snapshot
+        WriteImage(
+            m_childPath,
+            BuildVHD(
+                VHDVolumeReader::DifferencingHardDisk,
+                kChildId,
+                {{0, 0xF0, 2}, {3, 0xFF, 2}},
+                L".\\virtual_disk_parent.vhd"));
+    }
+
+    TEST_METHOD_CLEANUP(Finalize)
+    {
+        DeleteFileW(m_childPath.c_str());
+        DeleteFileW(m_parentPath.c_str());
+    }
+
+    TEST_METHOD(VirtualDiskImageDynamic)
+    {
+        std::shared_ptr<VirtualDiskImage> image;
+        Assert::IsTrue(SUCCEEDED(VirtualDiskImage::Open(m_parentPath, image)));
+        Assert::AreEqual(kDiskSize, image->VirtualSize());
+        Assert::AreEqual(kBlockSize, image->BlockSize());
+        Assert::IsFalse(image->IsDifferencing());
+
+        std::vector<VirtualDiskImage::Run> runs;
+        Assert::IsTrue(SUCCEEDED(image->Map(0LL, kDiskSize, runs)));
+        Assert::AreEqual(static_cast<size_t>(4), runs.size());
+        Assert::IsTrue(runs[0].Origin == VirtualDiskImage::Source::File);
+        Assert::IsTrue(runs[1].Origin == VirtualDiskImage::Source::Zero);
+        Assert::IsTrue(runs[2].Origin == VirtualDiskImage::Source::File);
+        Assert::IsTrue(runs[3].Origin == VirtualDiskImage::Source::Zero);
+
+        // A read across blocks, the end is beyond the virtual size
+        std::vector<BYTE> buffer(kDiskSize);
+        Assert::IsTrue(SUCCEEDED(image->Read(100LL, buffer.data(), buffer.size())));
+        for (ULONGLONG i = 0; i < buffer.size(); i++)
+        {
+            const auto offset = 100LL + i;
+            const auto block = offset / kBlockSize;
+            const BYTE expected = (offset < kDiskSize && (block == 0 || block == 2)) ? Pattern(1, offset) : 0;
+            Assert::AreEqual(expected, buffer[static_cast<size_t>(i)]);
+        }
+    }
+
+    TEST_METHOD(VirtualDiskImageDifferencing)
+    {
+        std::shared_ptr<VirtualDiskImage> image;
+        Assert::IsTrue(SUCCEEDED(VirtualDiskImage::Open(m_childPath, image)));
+        Assert::IsTrue(image->IsDifferencing());
+
+        // Absent sectors and blocks in a row are a single run from the parent
+        std::vector<VirtualDiskImage::Run> runs;
+        Assert::IsTrue(SUCCEEDED(image->Map(0LL, kDiskSize, runs)));
+        Assert::AreEqual(static_cast<size_t>(3), runs.size());
+        Assert::IsTrue(runs[0].Origin == VirtualDiskImage::Source::File);
+        Assert::AreEqual(2048ULL, runs[0].Length);
+        Assert::IsTrue(runs[1].Origin == VirtualDiskImage::Source::Parent);
+        Assert::AreEqual(3 * kBlockSize - 2048ULL, runs[1].Length);
+        Assert::IsTrue(runs[2].Origin == VirtualDiskImage::Source::File);
+
+        std::vector<BYTE> buffer(kDiskSize);
+        Assert::IsTrue(SUCCEEDED(image->Read(0LL, buffer.data(), buffer.size())));
+        for (ULONGLONG offset = 0; offset < kDiskSize; offset++)
+        {
+            BYTE expected = 0;
+            if (offset < 2048 || offset >= 3 * kBlockSize)
+                expected = Pattern(2, offset);
+            else if (offset < kBlockSize || (offset >= 2 * kBlockSize && offset < 3 * kBlockSize))
+                expected = Pattern(1, offset);
+            Assert::AreEqual(expected, buffer[static_cast<size_t>(offset)]);
+        }
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,78 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "VolumeBlockCache.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(VolumeBlockCacheTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(VolumeBlockCacheLookup)
+    {
+        VolumeBlockCache cache(512, 4 * 512);
+        std::vector<BYTE> block(512), out(512);
+
+        DWORD dwValidBytes = 0L;
+        Assert::IsFalse(cache.Lookup(0LL, out.data(), dwValidBytes));
+
+        std::fill(std::begin(block), std::end(block), static_cast<BYTE>(0x42));
+        cache.Insert(0LL, block.data(), 512);
+
+        Assert::IsTrue(cache.Lookup(0LL, out.data(), dwValidBytes));
+        Assert::AreEqual(512UL, dwValidBytes);
+        Assert::IsTrue(block == out);
+
+        // Partial last block
+        cache.Insert(512LL, block.data(), 100);
+        Assert::IsTrue(cache.Lookup(512LL, out.data(), dwValidBytes));
+        Assert::AreEqual(100UL, dwValidBytes);
+
+        const auto stats = cache.GetStatistics();
+        Assert::AreEqual(2ULL, stats.ullHits);
+        Assert::AreEqual(1ULL, stats.ullMisses);
+        Assert::AreEqual(2ULL, stats.ullInsertions);
+
+        cache.Invalidate();
+        Assert::IsFalse(cache.Lookup(0LL, out.data(), dwValidBytes));
+    }
+
+    TEST_METHOD(VolumeBlockCacheClockEviction)
+    {
+        VolumeBlockCache cache(512, 4 * 512);
+        std::vector<BYTE> block(512, 0), out(512);
+        DWORD dwValidBytes = 0L;
+
+        for (ULONGLONG i = 0; i < 4; i++)
+            cache.Insert(i * 512, block.data(), 512);
+
+        // Give block 0 a second chance: block 1 must be the first victim
+        Assert::IsTrue(cache.Lookup(0LL, out.data(), dwValidBytes));
+        cache.Insert(4 * 512, block.data(), 512);
+
+        Assert::IsTrue(cache.Lookup(0LL, out.data(), dwValidBytes));
+        Assert::IsFalse(cache.Lookup(512LL, out.data(), dwValidBytes));
+        Assert::IsTrue(cache.Lookup(4 * 512LL, out.data(), dwValidBytes));
+
+        const auto stats = cache.GetStatistics();
+        Assert::AreEqual(1ULL, stats.ullEvictions);
+        Assert::AreEqual(static_cast<size_t>(4 * 512), stats.cbPeakBytes);
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,67 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "VolumeReadProfile.h"
+#include "OverlappedReadAhead.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(VolumeReadProfileTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(VolumeReadProfileDefault)
+    {
+        VolumeReadProfile profile;
+        Assert::IsTrue(profile.IsDefault());
+        Assert::AreEqual(0UL, profile.ChunkSize());
+        Assert::AreEqual(0UL, profile.QueueDepth());
+    }
+
+    TEST_METHOD(VolumeReadProfileRoundTrip)
+    {
+        const VolumeReadProfile profile(1024 * 1024, 16);
+        Assert::AreEqual(L"1048576:16", profile.ToString().c_str());
+
+        const auto parsed = VolumeReadProfile::FromString(profile.ToString());
+        Assert::IsTrue(parsed.has_value());
+        Assert::IsFalse(parsed->IsDefault());
+        Assert::AreEqual(1024 * 1024UL, parsed->ChunkSize());
+        Assert::AreEqual(16UL, parsed->QueueDepth());
+    }
+
+    TEST_METHOD(VolumeReadProfileInvalid)
+    {
+        Assert::IsFalse(VolumeReadProfile::FromString(L"").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"65536").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"65536:").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L":8").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"64K:8").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"-65536:8").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"99999999999:8").has_value());
+
+        // Chunks are made of whole sectors
+        Assert::IsFalse(VolumeReadProfile::FromString(L"1000:8").has_value());
+        Assert::IsFalse(VolumeReadProfile::FromString(L"0:8").has_value());
+
+        Assert::IsFalse(VolumeReadProfile::FromString(L"65536:0").has_value());
+        const auto strTooDeep = L"65536:" + std::to_wstring(OverlappedReadAhead::kMaxQueueDepth + 1);
+        Assert::IsFalse(VolumeReadProfile::FromString(strTooDeep).has_value());
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,131 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "WildcardNameMatcher.h"
+
+#include <Shlwapi.h>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace Orc::Test {
+TEST_CLASS(WildcardNameMatcherTest)
+{
+private:
+    UnitTestHelper helper;
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(WildcardNameMatcherUnsupportedSpecs)
+    {
+        WildcardNameMatcher matcher;
+
+        Assert::IsFalse(matcher.Add(L"*.exe;*.dll", 0));
+        Assert::IsFalse(matcher.Add(L"readme*.", 1));
+        Assert::IsFalse(matcher.Add(L"", 2));
+        Assert::IsTrue(matcher.empty());
+    }
+
+    TEST_METHOD(WildcardNameMatcherAgainstPathMatchSpec)
+    {
+        const std::vector<std::wstring> specs = {
+            L"*.exe",
+            L"*.EXE*",
+            L"ntuser.dat*",
+            L"*log*",
+            L"?ystem32",
+            L"*.*",
+            L"*",
+            L"???.tmp",
+            L"a*b*c",
+            L"Prefetch*Setup*.pf"};
+
+        const std::vector<std::wstring> names = {
+            L"cmd.exe",
+            L"CMD.EXE",
+            L"setup.exe.bak",
+            L"NTUSER.DAT",
+            L"ntuser.dat.LOG1",
+            L"System32",
+            L"abc.tmp",
+            L"abcd.tmp",
+            L"aXbYc",
+            L"acb",
+            L"PrefetchXSetupY.pf",
+            L"noextension",
+            L"$MFT"};
+
+        WildcardNameMatcher matcher;
+        for (size_t i = 0; i < specs.size(); i++)
+            Assert::IsTrue(matcher.Add(specs[i], i));
+        matcher.Compile();
+
+        for (const auto& name : names)
+        {
+            std::vector<size_t> matches;
+            matcher.Match(name, matches);
+
+            for (size_t i = 0; i < specs.size(); i++)
+            {
+                const bool bExpected = PathMatchSpecW(name.c_str(), specs[i].c_str()) ? true : false;
+                const bool bMatched = std::find(std::cbegin(matches), std::cend(matches), i) != std::cend(matches);
+
+                Assert::AreEqual(bExpected, bMatched, (name + L" / " + specs[i]).c_str());
+            }
+        }
+    }
+
+    TEST_METHOD(WildcardPatternAgainstPathMatchSpec)
+    {
+        const std::vector<std::wstring> specs = {
+            L"*.exe",
+            L"ntuser.dat*",
+            L"*log*",
+            L"?ystem32",
+            L"*.*",
+            L"???.tmp",
+            L"a*b*c",
+            L"*.exe;*.dll",
+            L"readme*.",
+            L"\\Windows\\*\\*.dll",
+            L""};
+
+        const std::vector<std::wstring> names = {
+            L"cmd.exe",
+            L"CMD.EXE",
+            L"shell32.dll",
+            L"ntuser.dat.LOG1",
+            L"System32",
+            L"abc.tmp",
+            L"aXbYc",
+            L"acb",
+            L"readme",
+            L"\\Windows\\System32\\ntdll.dll",
+            L"\\windows\\ntdll.dll"};
+
+        for (const auto& spec : specs)
+        {
+            const WildcardPattern pattern(spec);
+
+            for (const auto& name : names)
+            {
+                const bool bExpected = PathMatchSpecW(name.c_str(), spec.c_str()) ? true : false;
+                Assert::AreEqual(bExpected, pattern.Match(name), (name + L" / " + spec).c_str());
+            }
+        }
+
+        Assert::IsTrue(WildcardPattern("Suspicious_*").Match(std::string_view("suspicious_powershell")));
+        Assert::IsFalse(WildcardPattern("Suspicious_*").Match(std::string_view("Benign_rule")));
+    }
+};
+}  // namespace Orc::Test
@@ -0,0 +1,211 @@
+//
+// SPDX-License-Identifier: LGPL-2.1-or-later
+//
+// Copyright © 2011-2019 ANSSI. All Rights Reserved.
+//
+// Author(s): Jean Gautier (ANSSI)
+//
+#include "stdafx.h"
+
+#include "Stream/BufferStreamConcept.h"
+#include "Filesystem/Ntfs/Compression/WofStreamConcept.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace Orc;
+using namespace Orc::Test;
+
+namespace {
+
+// Chunks are "compressed" with a xor so a chunk decoded to the wrong place is noticed
+class XorDecompressor
+{
+public:
+    static constexpr uint8_t kKey = 0xA5;
+
+    size_t Decompress(BufferView input, gsl::span<uint8_t> output, std::error_code& ec)
+    {
+        if (input.size() != output.size())
+        {
+            ec = std::make_error_code(std::errc::bad_message);
+            return 0;
+        }
+
+        std::transform(std::cbegin(input), std::cend(input), std::begin(output), [](uint8_t b) { return b ^ kKey; });
+        return output.size();
+    }
+};
+
+using InputStreamT = BufferStreamConcept<std::vector<uint8_t>>;
+using WofStreamT = Ntfs::WofStreamConcept<InputStreamT, std::unique_ptr<XorDecompressor>>;
+
+constexpr uint32_t kChunkSize = 4096;  // kXpress4k
+constexpr uint64_t kUncompressedSize = 10 * kChunkSize + 123;
+constexpr uint64_t kChunkCount = (kUncompressedSize + kChunkSize - 1) / kChunkSize;
+
+uint8_t Expected(uint64_t offset)
+{
+    return static_cast<uint8_t>(offset * 13 + (offset / kChunkSize));
+}
+
+// Chunk table (end offset of each chunk but the last one) followed by the chunks
+std::vector<uint8_t> MakeCompressedData()
+{
+    std::vector<uint8_t> data((kChunkCount - 1) * sizeof(uint32_t));
+    for (uint64_t i = 1; i < kChunkCount; ++i)
+    {
+        const auto end = static_cast<uint32_t>(i * kChunkSize);
+        std::copy_n(reinterpret_cast<const uint8_t*>(&end), sizeof(end), data.data() + (i - 1) * sizeof(uint32_t));
+    }
+
+    for (uint64_t i = 0; i < kUncompressedSize; ++i)
+    {
+        data.push_back(Expected(i) ^ XorDecompressor::kKey);
+    }
+
+    return data;
+}
+
+}  // namespace
+
+namespace Orc::Test {
+TEST_CLASS(WofStreamTest)
+{
+private:
+    UnitTestHelper helper;
+
+    static std::unique_ptr<WofStreamT> MakeStream(size_t readAhead)
+    {
+        auto compressed = MakeCompressedData();
+        const auto compressedSize = compressed.size();
+
+        std::error_code ec;
+        auto stream = std::make_unique<WofStreamT>(
+            std::make_unique<XorDecompressor>(),
+            InputStreamT(std::move(compressed)),
+            0,
+            Ntfs::WofAlgorithm::kXpress4k,
+            compressedSize,
+            kUncompressedSize,
+            ec);
+        Assert::IsFalse((bool)ec, L"Failed to create wof stream");
+
+        stream->EnableReadAhead(
+            readAhead, [](std::error_code&) { return std::make_unique<XorDecompressor>(); }, ec);
+        Assert::IsFalse((bool)ec, L"Failed to enable read ahead");
+        return stream;
+    }
+
+    static std::unique_ptr<WofStreamT> MakeCachedStream(size_t readAhead, WofChunkCache& cache, uint64_t fileId)
+    {
+        auto stream = MakeStream(readAhead);
+        stream->SetChunkCache(cache, fileId);
+        return stream;
+    }
+
+    static void CheckRead(WofStreamT & stream, size_t cbRead)
+    {
+        std::vector<uint8_t> buffer(cbRead);
+        uint64_t offset = 0;
+        for (;;)
+        {
+            std::error_code ec;
+            const auto processed = stream.Read(buffer, ec);
+            Assert::IsFalse((bool)ec, L"Failed to read wof stream");
+            if (processed == 0)
+            {
+                break;
+            }
+
+            for (size_t i = 0; i < processed; ++i)
+            {
+                Assert::AreEqual(Expected(offset + i), buffer[i]);
+            }
+            offset += processed;
+        }
+
+        Assert::AreEqual(kUncompressedSize, offset);
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Initialize) {}
+
+    TEST_METHOD_CLEANUP(Finalize) {}
+
+    TEST_METHOD(ReadAheadMatchesSynchronousRead)
+    {
+        for (const size_t cbRead : {size_t(1000), size_t(kChunkSize), size_t(3 * kChunkSize + 17)})
+        {
+            CheckRead(*MakeStream(0), cbRead);
+            CheckRead(*MakeStream(4), cbRead);
+        }
+    }
+
+    TEST_METHOD(ChunkCacheSharedBetweenStreams)
+    {
+        auto& cache = WofChunkCache::Instance();
+        cache.SetMaxBytes(1024 * 1024);
+
+        const auto fileId = cache.GetFileId(L"\\\\?\\WofStreamTest", 42);
+        Assert::AreEqual(fileId, cache.GetFileId(L"\\\\?\\WofStreamTest", 42));
+
+        const auto before = cache.GetStatistics();
+        CheckRead(*MakeCachedStream(0, cache, fileId), 1000);
+        CheckRead(*MakeCachedStream(4, cache, fileId), 3 * kChunkSize + 17);
+        const auto after = cache.GetStatistics();
+
+        Assert::AreEqual(before.ullInsertions + kChunkCount, after.ullInsertions);
+        Assert::IsTrue(after.ullHits - before.ullHits >= kChunkCount, L"Second stream did not use the cached chunks");
+
+        cache.SetMaxBytes(0);
+        Assert::IsFalse(cache.Contains(fileId, 0));
+    }
+
+    TEST_METHOD(ChunkCacheEvictsLeastRecentlyUsed)
+    {
+        auto& cache = WofChunkCache::Instance();
+        cache.SetMaxBytes(2 * kChunkSize);
+
+        const auto fileId = cache.GetFileId(L"\\\\?\\WofStreamTest", 43);
+        std::vector<uint8_t> chunk(kChunkSize, 0x42);
+        cache.Insert(fileId, 0, chunk.data(), kChunkSize);
+        cache.Insert(fileId, 1, chunk.data(), kChunkSize);
+
+        DWORD dwValidBytes = 0;
+        Assert::IsTrue(cache.Lookup(fileId, 0, chunk.data(), dwValidBytes));
+        Assert::AreEqual(static_cast<DWORD>(kChunkSize), dwValidBytes);
+
+        cache.Insert(fileId, 2, chunk.data(), kChunkSize);
+        Assert::IsTrue(cache.Contains(fileId, 0));
+        Assert::IsFalse(cache.Contains(fileId, 1));
+        Assert::IsTrue(cache.Contains(fileId, 2));
+
+        cache.SetMaxBytes(0);
+    }
+
+    TEST_METHOD(ReadAheadAfterSeek)
+    {
+        auto stream = MakeStream(4);
+
+        std::vector<uint8_t> buffer(100);
+        std::error_code ec;
+        stream->Read(buffer, ec);
+        Assert::IsFalse((bool)ec, L"Failed to read wof stream");
+
+        // Past the chunks decompressed ahead, back before them, then close to the partial last chunk
+        for (const uint64_t offset : {uint64_t(7 * kChunkSize + 10), uint64_t(10), uint64_t(9 * kChunkSize)})
+        {
+            stream->Seek(SeekDirection::kBegin, offset, ec);
+            Assert::IsFalse((bool)ec, L"Failed to seek wof stream");
+
+            const auto processed = stream->Read(buffer, ec);
+            Assert::IsFalse((bool)ec, L"Failed to read wof stream");
+            Assert::AreEqual(buffer.size(), processed);
+
+            for (size_t i = 0; i < processed; ++i)
+            {
+                Assert::AreEqual(Expected(offset + i), buffer[i]);
+            }
+        }
+    }
+};
+}  // namespace Orc::Test
@@ -9,6 +9,10 @@
 #include "stdafx.h"
 
 #include "YaraScanner.h"
+#include "YaraScanPool.h"
+#include "MemoryStream.h"
+
+#include <map>
 
 using namespace Microsoft::VisualStudio::CppUnitTestFramework;
 using namespace Orc;
@@ -99,5 +103,113 @@ public:
             }
         }
     }
+
+    TEST_METHOD(CompiledRules)
+    {
+        auto rules = R"(
+				rule simple_string{
+					strings:
+						$text_string = "HelloWorld"
+					condition :
+						$text_string
+				}
+			)"s;
+
+        CBinaryBuffer compiledRules;
+
+        {
+            YaraScanner scanner;
+            Assert::IsTrue(SUCCEEDED(scanner.Initialize()));
+
+            CBinaryBuffer buffer;
+            buffer.SetData((LPBYTE)rules.c_str(), rules.size());
+            Assert::IsFalse(YaraScanner::IsCompiledRules(buffer));
+            Assert::IsTrue(SUCCEEDED(scanner.AddRules(buffer)));
+            Assert::IsTrue(SUCCEEDED(scanner.CompileRules()));
+
+            auto memstream = std::make_shared<MemoryStream>();
+            Assert::IsTrue(SUCCEEDED(memstream->OpenForReadWrite()));
+            Assert::IsTrue(SUCCEEDED(scanner.SaveRules(memstream)));
+            memstream->GrabBuffer(compiledRules);
+        }
+
+        Assert::IsTrue(YaraScanner::IsCompiledRules(compiledRules));
+
+        YaraScanner scanner;
+        Assert::IsTrue(SUCCEEDED(scanner.Initialize()));
+        Assert::IsTrue(SUCCEEDED(scanner.AddRules(compiledRules)));
+
+        {
+            CBinaryBuffer buffer;
+            buffer.SetData((LPBYTE)rules.c_str(), rules.size());
+            Assert::IsTrue(FAILED(scanner.AddRules(buffer)), L"sources cannot be added to compiled rules");
+        }
+
+        auto strText = "This is a text with HelloWorld inside it"s;
+        CBinaryBuffer buffer;
+        buffer.SetData((LPBYTE)strText.c_str(), strText.size());
+
+        MatchingRuleCollection matchingRules;
+        Assert::IsTrue(SUCCEEDED(scanner.Scan(buffer, matchingRules)));
+        Assert::AreEqual(matchingRules.size(), static_cast<size_t>(1), L"we expect exactly one rule to match");
+    }
+
+    TEST_METHOD(PoolScan)
+    {
+        YaraScanner scanner;
+
+        Assert::IsTrue(SUCCEEDED(scanner.Initialize()));
+
+        auto yaraConfig = std::make_unique<YaraConfig>();
+        Assert::IsTrue(SUCCEEDED(scanner.Configure(yaraConfig)));
+
+        auto rules = R"(
+				rule simple_string{
+					strings:
+						$text_string = "HelloWorld"
+					condition :
+						$text_string
+				}
+			)"s;
+
+        {
+            CBinaryBuffer buffer;
+            buffer.SetData((LPBYTE)rules.c_str(), rules.size());
+            Assert::IsTrue(SUCCEEDED(scanner.AddRules(buffer)));
+        }
+
+        const auto matching = "This is a text with HelloWorld inside it"s;
+        const auto notMatching = "This is a text without the magic word"s;
+
+        std::map<YaraScanPool::JobId, bool> expected;
+        std::vector<YaraScanPool::Result> results;
+
+        {
+            // A pending size smaller than two buffers has each submission wait for the previous scan
+            YaraScanPool pool(scanner, 4, 64);
+            Assert::AreEqual(static_cast<DWORD>(4), pool.Workers());
+
+            for (size_t i = 0; i < 100; ++i)
+            {
+                const auto& text = i % 3 ? notMatching : matching;
+                const auto id = pool.Submit(YaraScanner::MemoryBlockBuffer(std::cbegin(text), std::cend(text)));
+                expected[id] = i % 3 == 0;
+
+                auto completed = pool.Collect();
+                std::move(std::begin(completed), std::end(completed), std::back_inserter(results));
+            }
+
+            auto completed = pool.Collect(true);
+            std::move(std::begin(completed), std::end(completed), std::back_inserter(results));
+            Assert::AreEqual(static_cast<ULONGLONG>(100), pool.SubmittedJobs());
+        }
+
+        Assert::AreEqual(expected.size(), results.size());
+        for (const auto& result : results)
+        {
+            Assert::IsTrue(SUCCEEDED(result.hr));
+            Assert::AreEqual(expected[result.Id] ? size_t(1) : size_t(0), result.MatchingRules.size());
+        }
+    }
 };
 }  // namespace Orc::Test